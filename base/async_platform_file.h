@@ -0,0 +1,91 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_ASYNC_PLATFORM_FILE_H_
+#define BASE_ASYNC_PLATFORM_FILE_H_
+#pragma once
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/memory/weak_ptr.h"
+#include "base/message_loop.h"
+#include "base/platform_file.h"
+
+namespace base {
+
+// Reads and writes a file with overlapped IO, which the completion port of
+// the MessageLoopForIO of the thread reports the end of, so that the thread
+// runs other tasks meanwhile rather than blocking in ReadPlatformFile(), and
+// large files don't need a thread of their own to be loaded. Any number of
+// reads and writes may be outstanding, and they may complete in any order.
+//
+// The file must have been opened with PLATFORM_FILE_ASYNC. If it was also
+// opened with PLATFORM_FILE_NO_BUFFERING, the offsets and sizes must be
+// multiples of the sector size of the volume, and the buffers aligned to it,
+// which those of AllocateUnbufferedBuffer() are.
+//
+// An AsyncPlatformFile lives on the thread it was made on, which must have a
+// MessageLoopForIO, and the callbacks run there. It is Windows only.
+class BASE_EXPORT AsyncPlatformFile : public MessageLoopForIO::IOHandler {
+ public:
+  // Given PLATFORM_FILE_OK and the number of bytes read or written, which is
+  // 0 for a read at the end of the file, or the error.
+  typedef Callback<void(PlatformFileError, int)> IOCallback;
+
+  // Takes ownership of |file|.
+  explicit AsyncPlatformFile(PlatformFile file);
+
+  // Cancels the reads and writes that haven't completed, whose callbacks
+  // aren't run, and closes the file. It waits for the cancelled reads and
+  // writes to be done with their buffers.
+  virtual ~AsyncPlatformFile();
+
+  // Starts reading |size| bytes at |offset| into |buffer|, or writing them
+  // from it, and runs |callback| once done. |buffer| must stay valid until
+  // then. Returns false, without running |callback|, if it couldn't be
+  // started.
+  bool ReadAsync(int64 offset, char* buffer, int size,
+                 const IOCallback& callback);
+  bool WriteAsync(int64 offset, const char* buffer, int size,
+                  const IOCallback& callback);
+
+  // The number of reads and writes that haven't completed.
+  int pending_count() const { return pending_count_; }
+
+  // Allocates and frees a buffer that is page aligned, so that it can be
+  // used with PLATFORM_FILE_NO_BUFFERING.
+  static char* AllocateUnbufferedBuffer(size_t size);
+  static void FreeUnbufferedBuffer(char* buffer);
+
+ private:
+  struct PendingIO;
+
+  // MessageLoopForIO::IOHandler methods:
+  virtual void OnIOCompleted(MessageLoopForIO::IOContext* context,
+                             DWORD bytes_transfered,
+                             DWORD error);
+
+  // Issues a ReadFile (if |is_read|) or WriteFile for |pending_io|.
+  bool StartIO(int64 offset, char* buffer, int size, bool is_read,
+               PendingIO* pending_io);
+
+  // Runs |callback| for a read that ended at the end of the file as it was
+  // started, which the completion port is not told about.
+  void RunEndOfFileCallback(const IOCallback& callback);
+
+  PlatformFile file_;
+  int pending_count_;
+
+  // Set by the destructor, once the callbacks are not to be run.
+  bool closing_;
+
+  WeakPtrFactory<AsyncPlatformFile> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncPlatformFile);
+};
+
+}  // namespace base
+
+#endif  // BASE_ASYNC_PLATFORM_FILE_H_
@@ -0,0 +1,156 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/async_platform_file.h"
+
+#include <windows.h>
+
+#include "base/bind.h"
+#include "base/compiler_specific.h"
+#include "base/logging.h"
+
+namespace base {
+
+namespace {
+
+PlatformFileError ErrorToPlatformFileError(DWORD error) {
+  switch (error) {
+    case ERROR_SUCCESS:
+    case ERROR_HANDLE_EOF:
+      return PLATFORM_FILE_OK;
+    case ERROR_OPERATION_ABORTED:
+      return PLATFORM_FILE_ERROR_ABORT;
+    case ERROR_ACCESS_DENIED:
+      return PLATFORM_FILE_ERROR_ACCESS_DENIED;
+    case ERROR_DISK_FULL:
+    case ERROR_HANDLE_DISK_FULL:
+      return PLATFORM_FILE_ERROR_NO_SPACE;
+    case ERROR_NOT_ENOUGH_MEMORY:
+    case ERROR_OUTOFMEMORY:
+      return PLATFORM_FILE_ERROR_NO_MEMORY;
+    default:
+      return PLATFORM_FILE_ERROR_FAILED;
+  }
+}
+
+}  // namespace
+
+// The OVERLAPPED of a read or write, which the completion port hands back to
+// OnIOCompleted(), and the callback to run then.
+struct AsyncPlatformFile::PendingIO : public MessageLoopForIO::IOContext {
+  IOCallback callback;
+};
+
+AsyncPlatformFile::AsyncPlatformFile(PlatformFile file)
+    : file_(file),
+      pending_count_(0),
+      closing_(false),
+      ALLOW_THIS_IN_INITIALIZER_LIST(weak_factory_(this)) {
+  DCHECK_NE(file_, kInvalidPlatformFileValue);
+  MessageLoopForIO::current()->RegisterIOHandler(file_, this);
+}
+
+AsyncPlatformFile::~AsyncPlatformFile() {
+  // The kernel writes into the buffers and the OVERLAPPEDs until the
+  // completions of the cancelled operations are dequeued, so this waits for
+  // them. OnIOCompleted() doesn't run their callbacks.
+  if (pending_count_ > 0) {
+    closing_ = true;
+    CancelIo(file_);
+    while (pending_count_ > 0) {
+      if (!MessageLoopForIO::current()->WaitForIOCompletion(INFINITE, this))
+        break;
+    }
+  }
+  ClosePlatformFile(file_);
+}
+
+bool AsyncPlatformFile::ReadAsync(int64 offset, char* buffer, int size,
+                                  const IOCallback& callback) {
+  PendingIO* pending_io = new PendingIO;
+  pending_io->callback = callback;
+  return StartIO(offset, buffer, size, true, pending_io);
+}
+
+bool AsyncPlatformFile::WriteAsync(int64 offset, const char* buffer, int size,
+                                   const IOCallback& callback) {
+  PendingIO* pending_io = new PendingIO;
+  pending_io->callback = callback;
+  // WriteFile() doesn't write to the buffer, StartIO() just takes both.
+  return StartIO(offset, const_cast<char*>(buffer), size, false, pending_io);
+}
+
+// static
+char* AsyncPlatformFile::AllocateUnbufferedBuffer(size_t size) {
+  // VirtualAlloc() gives whole pages, which are aligned to any sector size.
+  return static_cast<char*>(
+      VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+}
+
+// static
+void AsyncPlatformFile::FreeUnbufferedBuffer(char* buffer) {
+  if (buffer)
+    VirtualFree(buffer, 0, MEM_RELEASE);
+}
+
+void AsyncPlatformFile::OnIOCompleted(MessageLoopForIO::IOContext* context,
+                                      DWORD bytes_transfered,
+                                      DWORD error) {
+  PendingIO* pending_io = static_cast<PendingIO*>(context);
+  DCHECK_GT(pending_count_, 0);
+  --pending_count_;
+  IOCallback callback = pending_io->callback;
+  delete pending_io;
+
+  // The destructor is waiting for the operations it cancelled.
+  if (closing_)
+    return;
+
+  PlatformFileError result = ErrorToPlatformFileError(error);
+  callback.Run(result,
+               result == PLATFORM_FILE_OK ?
+                   static_cast<int>(bytes_transfered) : 0);
+}
+
+bool AsyncPlatformFile::StartIO(int64 offset, char* buffer, int size,
+                                bool is_read, PendingIO* pending_io) {
+  DCHECK_GE(offset, 0);
+  DCHECK_GE(size, 0);
+  memset(&pending_io->overlapped, 0, sizeof(pending_io->overlapped));
+  pending_io->overlapped.Offset = static_cast<DWORD>(offset);
+  pending_io->overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+  pending_io->handler = this;
+
+  // The completion is queued to the port whether the operation is done at
+  // once or not, unless it fails as it is started.
+  BOOL done = is_read ?
+      ReadFile(file_, buffer, size, NULL, &pending_io->overlapped) :
+      WriteFile(file_, buffer, size, NULL, &pending_io->overlapped);
+  if (done || GetLastError() == ERROR_IO_PENDING) {
+    ++pending_count_;
+    return true;
+  }
+
+  DWORD error = GetLastError();
+  IOCallback callback = pending_io->callback;
+  delete pending_io;
+  if (is_read && error == ERROR_HANDLE_EOF) {
+    // Nothing is queued for a read at the end of the file, but the callback
+    // still runs from the loop, as it does for every read that was started.
+    MessageLoop::current()->PostTask(
+        FROM_HERE,
+        Bind(&AsyncPlatformFile::RunEndOfFileCallback,
+             weak_factory_.GetWeakPtr(), callback));
+    return true;
+  }
+  DLOG(WARNING) << (is_read ? "ReadFile" : "WriteFile") << " failed: "
+                << error;
+  return false;
+}
+
+void AsyncPlatformFile::RunEndOfFileCallback(const IOCallback& callback) {
+  callback.Run(PLATFORM_FILE_OK, 0);
+}
+
+}  // namespace base
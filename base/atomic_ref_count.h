@@ -47,7 +47,18 @@ inline void AtomicRefCountInc(volatile AtomicRefCount *ptr) {
 // Decrement a reference count by 1 and return whether the result is non-zero.
 // Insert barriers to ensure that state written before the reference count
 // became zero will be visible to a thread that has just made the count zero.
+//
+// A count of one is the caller's own reference: no other thread holds one to
+// add another with, so the count is zeroed without an interlocked instruction.
+// The acquire load orders the caller's use of the object after the other
+// owners', which their decrements released.  Most objects are released by
+// their last owner this way, once the threads they were shared with are done.
 inline bool AtomicRefCountDec(volatile AtomicRefCount *ptr) {
+  if (subtle::Acquire_Load(ptr) == 1) {
+    ANNOTATE_HAPPENS_AFTER(ptr);
+    subtle::NoBarrier_Store(ptr, 0);
+    return false;
+  }
   return base::AtomicRefCountDecN(ptr, 1);
 }
 
@@ -50,16 +50,34 @@
         'third_party/dmg_fp/dtoa_wrapper.cc',
         'third_party/dmg_fp/g_fmt.cc',
         'hash_tables.h',
+        'flat_hash_tables.h',
+        'flat_map.h',
+        'flat_set.h',
+        'flat_tree.h',
+        'synchronization/condition_variable.h',
+        'synchronization/condition_variable_win.cc',
+        'synchronization/lightweight_event.h',
+        'synchronization/lightweight_event_win.cc',
         'synchronization/lock.h',
         'synchronization/lock.cc',
         'synchronization/lock_impl.h',
         'synchronization/lock_impl_win.cc',
+        'synchronization/lock_profiler.h',
+        'synchronization/lock_profiler.cc',
+        'synchronization/read_write_lock.h',
+        'synchronization/read_write_lock_win.cc',
+        'synchronization/srw_lock_functions_win.h',
+        'synchronization/srw_lock_functions_win.cc',
         'debug/debugger.h',
         'debug/debugger.cc',
         'debug/debugger_win.cc',
         'gtest_prod_util.h',
         'pickle.h',
         'pickle.cc',
+        'shared_memory.h',
+        'shared_memory_win.cc',
+        'shared_memory_channel.h',
+        'shared_memory_channel.cc',
         'at_exit.h',
         'at_exit.cc',
         'sys_string_conversions.h',
@@ -68,6 +86,8 @@
         'string16.cc',
         'lazy_instance.h',
         'lazy_instance.cc',
+        'startup_instance_report.h',
+        'startup_instance_report.cc',
         'memory/singleton.h',
         'debug/stack_trace.h',
         'debug/stack_trace.cc',
@@ -87,6 +107,8 @@
         'observer_list.h',
         'memory/scoped_handle.h',
         'memory/scoped_ptr.h',
+        'memory/task_allocator.h',
+        'memory/task_allocator.cc',
         'bind.h',
         'bind_helpers.h',
         'bind_internal.h',
@@ -106,6 +128,7 @@
         'cpu.h',
         'cpu.cc',
         'callback_old.h',
+        'cancellation_token.h',
         'message_loop.h',
         'message_loop.cc',
         'message_loop_proxy.h',
@@ -135,17 +158,36 @@
         'format_macros.h',
         'metrics/histogram.h',
         'metrics/histogram.cc',
+        'metrics/histogram_shared_memory.h',
+        'metrics/histogram_shared_memory.cc',
+        'metrics/process_metrics_sampler.h',
+        'metrics/process_metrics_sampler.cc',
+        'metrics/startup_timeline.h',
+        'metrics/startup_timeline.cc',
+        'metrics/task_timing_recorder.h',
+        'metrics/task_timing_recorder.cc',
         'debug/leak_annotations.h',
         'debug/alias.h',
         'debug/alias.cc',
+        'debug/heap_profiler.h',
+        'debug/heap_profiler.cc',
+        'debug/sampling_profiler.h',
+        'debug/sampling_profiler.cc',
+        'debug/sampling_profiler_win.cc',
         'memory/ref_counted_memory.h',
         'memory/ref_counted_memory.cc',
+        'memory/purgeable_cache.h',
+        'memory/purgeable_cache.cc',
         'file_util.h',
         'file_util.cc',
         'file_util_win.cc',
         'platform_file.h',
         'platform_file.cc',
         'platform_file_win.cc',
+        'async_platform_file.h',
+        'async_platform_file_win.cc',
+        'win/library_preloader.cc',
+        'win/library_preloader.h',
         'win/pe_image.cc',
         'win/pe_image.h',
         'win/registry.cc',
@@ -172,10 +214,14 @@
         'file_descriptor_shuffle.cc',
         'debug/trace_event.h',
         'debug/trace_event.cc',
+        'debug/trace_event_binary.h',
+        'debug/trace_event_binary.cc',
         'debug/trace_event_win.h',
         'debug/trace_event_win.cc',
         'timer.h',
         'timer.cc',
+        'timer_wheel.h',
+        'timer_wheel.cc',
         'sys_info.h',
         'sys_info_win.cc',
         'win/event_trace_provider.h',
@@ -196,6 +242,14 @@
         'message_loop_embed.cc',
         'message_pump_embed_win.h',
         'message_pump_embed_win.cc',
+        'threading/parallel_chunks.h',
+        'threading/parallel_chunks.cc',
+        'threading/work_stealing_thread_pool.h',
+        'threading/work_stealing_thread_pool.cc',
+        'threading/worker_pool.h',
+        'threading/worker_pool.cc',
+        'zlib_stream.cc',
+        'zlib_stream.h',
       ],
       'include_dirs': [
           '..',
@@ -213,6 +267,7 @@
      #],
       'dependencies': [
         'third_party/dynamic_annotations/dynamic_annotations.gyp:dynamic_annotations',
+        '../third_party/zlib/zlib.gyp:zlib',
       ],
       'direct_dependent_settings': {
         'include_dirs': [
@@ -236,5 +291,35 @@
         },],
       ],
     },
+    {
+      'target_name': 'base_unittests',
+      'type': 'executable',
+      'dependencies': [
+        'base',
+        '../testing/gtest.gyp:gtest',
+      ],
+      'include_dirs': [
+        '..',
+      ],
+      'sources': [
+        'cancellation_token_unittest.cc',
+        'test/run_all_unittests.cc',
+        'timer_wheel_unittest.cc',
+      ],
+    },
+    {
+      # The global operator new and delete with the HeapProfiler hooks, built
+      # into the executables that depend on this target.
+      'target_name': 'heap_profiler_new',
+      'type': 'none',
+      'dependencies': [
+        'base',
+      ],
+      'direct_dependent_settings': {
+        'sources': [
+          'debug/heap_profiler_new.cc',
+        ],
+      },
+    },
   ],
 }
\ No newline at end of file
@@ -4,9 +4,21 @@
 
 #include "base/callback_internal.h"
 
+#include "base/memory/task_allocator.h"
+
 namespace base {
 namespace internal {
 
+// static
+void* InvokerStorageBase::operator new(size_t size) {
+  return TaskAllocator::Allocate(size);
+}
+
+// static
+void InvokerStorageBase::operator delete(void* storage, size_t size) {
+  TaskAllocator::Free(storage, size);
+}
+
 bool CallbackBase::is_null() const {
   return invoker_storage_.get() == NULL;
 }
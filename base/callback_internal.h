@@ -23,7 +23,15 @@ namespace internal {
 // DoInvoke function to perform the function execution.  This allows
 // us to shield the Callback class from the types of the bound argument via
 // "type erasure."
-class InvokerStorageBase : public RefCountedThreadSafe<InvokerStorageBase> {
+//
+// The storage is allocated by TaskAllocator, since most of it is made to be
+// posted as a task.
+class BASE_EXPORT InvokerStorageBase
+    : public RefCountedThreadSafe<InvokerStorageBase> {
+ public:
+  static void* operator new(size_t size);
+  static void operator delete(void* storage, size_t size);
+
  protected:
   friend class RefCountedThreadSafe<InvokerStorageBase>;
   virtual ~InvokerStorageBase() {}
@@ -0,0 +1,55 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_CANCELLATION_TOKEN_H_
+#define BASE_CANCELLATION_TOKEN_H_
+#pragma once
+
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+
+namespace base {
+
+// Cancels the tasks that were posted with it.  The MessageLoop drops the
+// tasks of a cancelled token when it dequeues them, without running them or
+// recording them, and purges the cancelled delayed tasks in bulk so that
+// abandoned timeouts don't pile up in its delayed work queue.  Unlike a
+// WeakPtr or a ScopedRunnableMethodFactory, which the task checks when it
+// runs, a cancelled task never gets dispatched.
+//
+//   scoped_refptr<base::CancellationToken> token(new base::CancellationToken);
+//   MessageLoop::current()->PostDelayedTask(
+//       FROM_HERE, base::Bind(&OnTimeout), kTimeoutMs, token);
+//   ...
+//   token->Cancel();  // OnTimeout() won't run.
+//
+// A token can be cancelled on any thread.  A task that is already running on
+// another thread isn't stopped, so only a Cancel() on the loop's own thread
+// guarantees that the task won't run.
+class CancellationToken : public RefCountedThreadSafe<CancellationToken> {
+ public:
+  CancellationToken() : cancelled_(0) {}
+
+  void Cancel() {
+    subtle::Release_Store(&cancelled_, 1);
+  }
+
+  bool IsCancelled() const {
+    return subtle::Acquire_Load(&cancelled_) != 0;
+  }
+
+ private:
+  friend class RefCountedThreadSafe<CancellationToken>;
+
+  ~CancellationToken() {}
+
+  volatile subtle::Atomic32 cancelled_;
+
+  DISALLOW_COPY_AND_ASSIGN(CancellationToken);
+};
+
+}  // namespace base
+
+#endif  // BASE_CANCELLATION_TOKEN_H_
@@ -0,0 +1,71 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/cancellation_token.h"
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/message_loop.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+void RecordRun(std::vector<int>* runs, int id) {
+  runs->push_back(id);
+}
+
+void Cancel(const scoped_refptr<base::CancellationToken>& token) {
+  token->Cancel();
+}
+
+// Posts a task that quits |message_loop| after |delay_ms|, and runs it.
+void RunFor(MessageLoop* message_loop, int64 delay_ms) {
+  message_loop->PostDelayedTask(
+      FROM_HERE, base::Bind(&MessageLoop::Quit, base::Unretained(message_loop)),
+      delay_ms);
+  message_loop->Run();
+}
+
+TEST(CancellationTokenTest, CancelBeforeRun) {
+  MessageLoop message_loop;
+  std::vector<int> runs;
+  scoped_refptr<base::CancellationToken> cancelled(
+      new base::CancellationToken);
+  scoped_refptr<base::CancellationToken> kept(new base::CancellationToken);
+  message_loop.PostTask(FROM_HERE, base::Bind(&RecordRun, &runs, 0),
+                        cancelled);
+  message_loop.PostDelayedTask(FROM_HERE, base::Bind(&RecordRun, &runs, 1),
+                               5, cancelled);
+  message_loop.PostTask(FROM_HERE, base::Bind(&RecordRun, &runs, 2), kept);
+  cancelled->Cancel();
+  EXPECT_TRUE(cancelled->IsCancelled());
+  EXPECT_FALSE(kept->IsCancelled());
+
+  RunFor(&message_loop, 20);
+
+  ASSERT_EQ(1u, runs.size());
+  EXPECT_EQ(2, runs[0]);
+}
+
+TEST(CancellationTokenTest, CancelWhileQueued) {
+  MessageLoop message_loop;
+  std::vector<int> runs;
+  scoped_refptr<base::CancellationToken> token(new base::CancellationToken);
+  // The first task cancels the token of the tasks queued behind it.
+  message_loop.PostTask(FROM_HERE, base::Bind(&RecordRun, &runs, 0), token);
+  message_loop.PostTask(FROM_HERE, base::Bind(&Cancel, token));
+  message_loop.PostTask(FROM_HERE, base::Bind(&RecordRun, &runs, 1), token);
+  message_loop.PostDelayedTask(FROM_HERE, base::Bind(&RecordRun, &runs, 2),
+                               5, token);
+  message_loop.PostTask(FROM_HERE, base::Bind(&RecordRun, &runs, 3));
+
+  RunFor(&message_loop, 20);
+
+  ASSERT_EQ(2u, runs.size());
+  EXPECT_EQ(0, runs[0]);
+  EXPECT_EQ(3, runs[1]);
+}
+
+}  // namespace
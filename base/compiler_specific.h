@@ -91,6 +91,9 @@
 #if defined(COMPILER_GCC)
 #define ALLOW_UNUSED __attribute__((unused))
 #define NOINLINE __attribute__((noinline))
+#elif defined(COMPILER_MSVC)
+#define ALLOW_UNUSED
+#define NOINLINE __declspec(noinline)
 #else
 #define ALLOW_UNUSED
 #define NOINLINE
@@ -6,12 +6,15 @@
 
 #if defined(ARCH_CPU_X86_FAMILY)
 #if defined(_MSC_VER)
+#include <immintrin.h>  // For _xgetbv()
 #include <intrin.h>
 #endif
 #endif
 
 #include <string.h>
 
+#include "base/basictypes.h"
+
 namespace base {
 
 CPU::CPU()
@@ -28,6 +31,21 @@ CPU::CPU()
     has_ssse3_(false),
     has_sse41_(false),
     has_sse42_(false),
+    has_avx_(false),
+    has_avx2_(false),
+    has_fma_(false),
+    has_bmi1_(false),
+    has_bmi2_(false),
+    has_avx512f_(false),
+    has_avx512dq_(false),
+    has_avx512bw_(false),
+    has_avx512vl_(false),
+    has_non_stop_time_stamp_counter_(false),
+    cache_line_size_(0),
+    l2_cache_size_kb_(0),
+    l3_cache_size_kb_(0),
+    cores_per_package_(0),
+    logical_processors_per_package_(0),
     cpu_vendor_("unknown") {
   Initialize();
 }
@@ -76,7 +94,26 @@ void __cpuidex(int cpu_info[4], int info_type, int info_index) {
 }
 
 #endif
+
 #endif  // _MSC_VER
+
+// Reads extended control register |xcr|; only valid if the OSXSAVE bit of
+// CPUID 1 is set. Not named _xgetbv, which is the intrinsic of the compilers
+// that have it.
+uint64 ReadXCR(uint32 xcr) {
+#if defined(_MSC_VER)
+  return _xgetbv(xcr);
+#else
+  uint32 eax, edx;
+  __asm__ volatile (
+    ".byte 0x0f, 0x01, 0xd0"  // xgetbv, which older assemblers do not know.
+    : "=a"(eax), "=d"(edx)
+    : "c"(xcr)
+  );
+  return (static_cast<uint64>(edx) << 32) | eax;
+#endif
+}
+
 #endif  // ARCH_CPU_X86_FAMILY
 
 void CPU::Initialize() {
@@ -94,6 +131,7 @@ void CPU::Initialize() {
   // http://msdn.microsoft.com/en-us/library/hskdteyh.aspx
   __cpuid(cpu_info, 0);
   int num_ids = cpu_info[0];
+  uint64 xcr0 = 0;
   memset(cpu_string, 0, sizeof(cpu_string));
   *(reinterpret_cast<int*>(cpu_string)) = cpu_info[1];
   *(reinterpret_cast<int*>(cpu_string+4)) = cpu_info[3];
@@ -116,8 +154,121 @@ void CPU::Initialize() {
     has_ssse3_ = (cpu_info[2] & 0x00000200) != 0;
     has_sse41_ = (cpu_info[2] & 0x00080000) != 0;
     has_sse42_ = (cpu_info[2] & 0x00100000) != 0;
+    // AVX also needs the OS to save the XMM and YMM state on context
+    // switches, which it reports through XCR0 (OSXSAVE makes it readable).
+    // AVX-512 also needs the opmask and ZMM state.
+    if ((cpu_info[2] & 0x08000000) != 0)
+      xcr0 = ReadXCR(0);
+    has_avx_ = (cpu_info[2] & 0x10000000) != 0 && (xcr0 & 6) == 6;
+    has_fma_ = has_avx_ && (cpu_info[2] & 0x00001000) != 0;
+  }
+
+  if (num_ids >= 7) {
+    __cpuidex(cpu_info, 7, 0);
+    has_avx2_ = has_avx_ && (cpu_info[1] & 0x00000020) != 0;
+    has_bmi1_ = (cpu_info[1] & 0x00000008) != 0;
+    has_bmi2_ = (cpu_info[1] & 0x00000100) != 0;
+    if (has_avx_ && (xcr0 & 0xe0) == 0xe0) {
+      has_avx512f_ = (cpu_info[1] & 0x00010000) != 0;
+      has_avx512dq_ = has_avx512f_ && (cpu_info[1] & 0x00020000) != 0;
+      has_avx512bw_ = has_avx512f_ && (cpu_info[1] & 0x40000000) != 0;
+      has_avx512vl_ = has_avx512f_ && (cpu_info[1] & 0x80000000) != 0;
+    }
+  }
+
+  // The invariant TSC bit of the advanced power management leaf.
+  __cpuid(cpu_info, 0x80000000);
+  if (static_cast<unsigned int>(cpu_info[0]) >= 0x80000007) {
+    __cpuid(cpu_info, 0x80000007);
+    has_non_stop_time_stamp_counter_ = (cpu_info[3] & 0x00000100) != 0;
   }
+
+  InitializeTopology(num_ids);
 #endif
 }
 
+void CPU::InitializeTopology(int num_ids) {
+#if defined(ARCH_CPU_X86_FAMILY)
+  int cpu_info[4] = {-1};
+  if (num_ids < 1)
+    return;
+  __cpuid(cpu_info, 1);
+  // The CLFLUSH line size, in 8 byte units.
+  cache_line_size_ = ((cpu_info[1] >> 8) & 0xff) * 8;
+  // The logical processor count is only valid with the HTT bit.
+  logical_processors_per_package_ =
+      (cpu_info[3] & 0x10000000) ? (cpu_info[1] >> 16) & 0xff : 1;
+
+  if (cpu_vendor_ == "GenuineIntel" && num_ids >= 4) {
+    // The deterministic cache parameters, one subleaf per cache, until a
+    // cache of type 0.
+    for (int i = 0; ; ++i) {
+      __cpuidex(cpu_info, 4, i);
+      if ((cpu_info[0] & 0x1f) == 0)
+        break;
+      if (i == 0)
+        cores_per_package_ = ((cpu_info[0] >> 26) & 0x3f) + 1;
+      int level = (cpu_info[0] >> 5) & 0x7;
+      int ways = ((cpu_info[1] >> 22) & 0x3ff) + 1;
+      int partitions = ((cpu_info[1] >> 12) & 0x3ff) + 1;
+      int line_size = (cpu_info[1] & 0xfff) + 1;
+      int sets = cpu_info[2] + 1;
+      int size_kb = static_cast<int>(
+          static_cast<int64>(ways) * partitions * line_size * sets / 1024);
+      if (level == 2)
+        l2_cache_size_kb_ = size_kb;
+      else if (level == 3)
+        l3_cache_size_kb_ = size_kb;
+    }
+  } else if (cpu_vendor_ == "AuthenticAMD") {
+    __cpuid(cpu_info, 0x80000000);
+    unsigned int num_extended_ids = cpu_info[0];
+    if (num_extended_ids >= 0x80000006) {
+      __cpuid(cpu_info, 0x80000006);
+      l2_cache_size_kb_ = (cpu_info[2] >> 16) & 0xffff;
+      // In 512 KB units.
+      l3_cache_size_kb_ = ((cpu_info[3] >> 18) & 0x3fff) * 512;
+    }
+    if (num_extended_ids >= 0x80000008) {
+      __cpuid(cpu_info, 0x80000008);
+      cores_per_package_ = (cpu_info[2] & 0xff) + 1;
+    }
+  }
+  if (logical_processors_per_package_ < cores_per_package_)
+    logical_processors_per_package_ = cores_per_package_;
+#endif
+}
+
+CPU::IntelMicroArchitecture CPU::GetIntelMicroArchitecture() const {
+  if (has_avx2() && has_fma() && has_bmi1() && has_bmi2()) {
+    if (has_avx512f() && has_avx512dq() && has_avx512bw() && has_avx512vl())
+      return AVX512;
+    return AVX2;
+  }
+  if (has_avx())
+    return AVX;
+  if (has_sse42())
+    return SSE42;
+  if (has_sse41())
+    return SSE41;
+  if (has_ssse3())
+    return SSSE3;
+  if (has_sse3())
+    return SSE3;
+  if (has_sse2())
+    return SSE2;
+  if (has_sse())
+    return SSE;
+  return PENTIUM;
+}
+
+CPU::IntelMicroArchitecture GetCPUMicroArchitecture() {
+  // Threads racing to initialize this all compute the same value.
+  static CPU::IntelMicroArchitecture architecture =
+      CPU::MAX_INTEL_MICRO_ARCHITECTURE;
+  if (architecture == CPU::MAX_INTEL_MICRO_ARCHITECTURE)
+    architecture = CPU().GetIntelMicroArchitecture();
+  return architecture;
+}
+
 }  // namespace base
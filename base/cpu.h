@@ -15,6 +15,24 @@ namespace base {
 // Query information about the processor.
 class BASE_EXPORT CPU {
  public:
+  // The levels of x86 instruction sets that kernels are written for, each
+  // including the ones before. AVX2 also needs FMA, BMI1 and BMI2, and
+  // AVX512 the F, DQ, BW and VL subsets, as the processors that have them
+  // do, so that a kernel for a level may use all of them.
+  enum IntelMicroArchitecture {
+    PENTIUM,
+    SSE,
+    SSE2,
+    SSE3,
+    SSSE3,
+    SSE41,
+    SSE42,
+    AVX,
+    AVX2,
+    AVX512,
+    MAX_INTEL_MICRO_ARCHITECTURE
+  };
+
   // Constructor
   CPU();
 
@@ -33,11 +51,46 @@ class BASE_EXPORT CPU {
   int has_ssse3() const { return has_ssse3_; }
   int has_sse41() const { return has_sse41_; }
   int has_sse42() const { return has_sse42_; }
+  // Also true only if the operating system saves the AVX registers.
+  int has_avx() const { return has_avx_; }
+  int has_avx2() const { return has_avx2_; }
+  int has_fma() const { return has_fma_; }
+  int has_bmi1() const { return has_bmi1_; }
+  int has_bmi2() const { return has_bmi2_; }
+  // Also true only if the operating system saves the AVX-512 registers.
+  int has_avx512f() const { return has_avx512f_; }
+  int has_avx512dq() const { return has_avx512dq_; }
+  int has_avx512bw() const { return has_avx512bw_; }
+  int has_avx512vl() const { return has_avx512vl_; }
+  // True if the time stamp counter runs at a constant rate in all the power
+  // states, so that it can measure time.
+  int has_non_stop_time_stamp_counter() const {
+    return has_non_stop_time_stamp_counter_;
+  }
+  IntelMicroArchitecture GetIntelMicroArchitecture() const;
+
+  // The cache line size in bytes, and the sizes of the L2 and L3 caches in
+  // KB, or 0 if the processor doesn't report them.
+  int cache_line_size() const { return cache_line_size_; }
+  int l2_cache_size_kb() const { return l2_cache_size_kb_; }
+  int l3_cache_size_kb() const { return l3_cache_size_kb_; }
+
+  // The number of cores in the processor package, and of logical processors,
+  // which is larger with hyper-threading. 0 if the processor doesn't report
+  // them.
+  int cores_per_package() const { return cores_per_package_; }
+  int logical_processors_per_package() const {
+    return logical_processors_per_package_;
+  }
 
  private:
   // Query the processor for CPUID information.
   void Initialize();
 
+  // Query the cache sizes and core counts, from the CPUID leaves of
+  // |cpu_vendor_|. |num_ids| is the highest standard leaf.
+  void InitializeTopology(int num_ids);
+
   int type_;  // process type
   int family_;  // family of the processor
   int model_;  // model of processor
@@ -51,9 +104,56 @@ class BASE_EXPORT CPU {
   bool has_ssse3_;
   bool has_sse41_;
   bool has_sse42_;
+  bool has_avx_;
+  bool has_avx2_;
+  bool has_fma_;
+  bool has_bmi1_;
+  bool has_bmi2_;
+  bool has_avx512f_;
+  bool has_avx512dq_;
+  bool has_avx512bw_;
+  bool has_avx512vl_;
+  bool has_non_stop_time_stamp_counter_;
+  int cache_line_size_;
+  int l2_cache_size_kb_;
+  int l3_cache_size_kb_;
+  int cores_per_package_;
+  int logical_processors_per_package_;
   std::string cpu_vendor_;
 };
 
+// Returns CPU().GetIntelMicroArchitecture(), only querying the processor
+// the first time.
+BASE_EXPORT CPU::IntelMicroArchitecture GetCPUMicroArchitecture();
+
+// A kernel of a function, and the level of instruction sets it needs.
+template <typename Function>
+struct CPUKernel {
+  CPU::IntelMicroArchitecture needs;
+  Function function;
+};
+
+// Returns the function of the first of |kernels| that the processor can run,
+// or NULL if there is none. The kernels are ordered from the fastest, and
+// those not compiled in may have a NULL function. Keep the result, e.g. in a
+// function pointer set at startup, rather than selecting for each call:
+//
+//   static const CPUKernel<BlendFunction> kBlendKernels[] = {
+//     { CPU::AVX2, BlendAVX2 },
+//     { CPU::SSE2, BlendSSE2 },
+//     { CPU::PENTIUM, BlendC },
+//   };
+//   g_blend = SelectCPUKernel(kBlendKernels);
+template <typename Function, size_t N>
+Function SelectCPUKernel(const CPUKernel<Function> (&kernels)[N]) {
+  CPU::IntelMicroArchitecture architecture = GetCPUMicroArchitecture();
+  for (size_t i = 0; i < N; ++i) {
+    if (kernels[i].function && kernels[i].needs <= architecture)
+      return kernels[i].function;
+  }
+  return NULL;
+}
+
 }  // namespace base
 
 #endif  // BASE_CPU_H_
@@ -0,0 +1,292 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/heap_profiler.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <map>
+
+#include "base/debug/stack_trace.h"
+#include "base/format_macros.h"
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/stringprintf.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread_local.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+// The frames recorded of the stacks of the sampled allocations.
+const size_t kMaxFrames = 32;
+
+// The sampled allocations that can be live at once, beyond which the samples
+// are dropped. At the default interval, they stand for about 2GB.
+const size_t kMaxLiveSamples = 16 * 1024;
+
+// Most slots probed to find one in |Registry::samples|.
+const size_t kMaxProbes = 64;
+
+// The values of a slot's address besides those of live allocations: never
+// used, freed, and being written.
+const subtle::AtomicWord kEmptySlot = 0;
+const subtle::AtomicWord kFreedSlot = 1;
+const subtle::AtomicWord kBusySlot = 2;
+
+typedef std::map<std::vector<const void*>, HeapProfiler::Site> SiteMap;
+
+// A sampled allocation that hasn't been freed. |address| is published last,
+// and taken back first, so that the other fields are only read or written by
+// the thread that holds the slot.
+struct Sample {
+  subtle::AtomicWord address;
+  int64 bytes;
+  HeapProfiler::Site* site;
+};
+
+struct Registry {
+  Registry()
+      : sampling_interval(HeapProfiler::kDefaultSamplingInterval),
+        random_state(GG_UINT64_C(0x2545F4914F6CDD1D)),
+        dropped_samples(0),
+        samples(NULL) {
+  }
+
+  Lock lock;
+  size_t sampling_interval;
+  uint64 random_state;  // Protected by |lock|.
+  SiteMap sites;  // Protected by |lock|.
+  int64 dropped_samples;  // Protected by |lock|.
+
+  // The bytes each thread allocates until its next sample, and whether it
+  // is in the hooks, so that the allocations of the profiler itself aren't
+  // sampled.
+  ThreadLocalPointer<void> bytes_until_sample;
+  ThreadLocalBoolean in_hook;
+
+  // An open addressed table of kMaxLiveSamples, which the frees of the
+  // allocations that weren't sampled, nearly all of them, look up without
+  // locking. Allocated by the first Start(), and never freed, as frees may
+  // still be looking up after Stop().
+  Sample* samples;
+};
+
+// Leaky, as the hooks may run in the destructors of other statics.
+LazyInstance<Registry, LeakyLazyInstanceTraits<Registry> > g_registry(
+    LINKER_INITIALIZED);
+
+size_t HashAddress(const void* ptr) {
+  uintptr_t value = reinterpret_cast<uintptr_t>(ptr);
+  // The low bits of heap blocks are always 0.
+  return ((value >> 4) * 2654435761U) % kMaxLiveSamples;
+}
+
+// Returns the bytes to allocate until the next sample, drawn from an
+// exponential distribution. |registry->lock| must be held.
+intptr_t NextSampleInterval(Registry* registry) {
+  // xorshift64*, which is plenty for sampling.
+  uint64 x = registry->random_state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  registry->random_state = x;
+  double uniform = static_cast<double>((x * GG_UINT64_C(2685821657736338717)) >>
+                                       11) / static_cast<double>(1LL << 53);
+  double interval = -log(1.0 - uniform) * registry->sampling_interval;
+  return static_cast<intptr_t>(std::min(std::max(interval, 1.0), 1e9));
+}
+
+// Returns the bytes an allocation of |size| sampled at |interval| stands for:
+// the expected number of bytes allocated per sample of that size.
+int64 SampleBytes(size_t size, size_t interval) {
+  double probability = 1.0 - exp(-static_cast<double>(size) / interval);
+  return static_cast<int64>(size / probability);
+}
+
+bool CompareSitesByLiveBytes(const HeapProfiler::Site& a,
+                             const HeapProfiler::Site& b) {
+  return a.live_bytes > b.live_bytes;
+}
+
+}  // namespace
+
+subtle::Atomic32 HeapProfiler::running_ = 0;
+
+HeapProfiler::Site::Site()
+    : live_samples(0),
+      live_bytes(0),
+      total_bytes(0) {
+}
+
+HeapProfiler::Site::~Site() {
+}
+
+// static
+void HeapProfiler::Start(size_t sampling_interval) {
+  Registry* registry = g_registry.Pointer();
+  AutoLock lock(registry->lock);
+  if (IsRunning())
+    return;
+  registry->sampling_interval = std::max<size_t>(sampling_interval, 1);
+  registry->sites.clear();
+  registry->dropped_samples = 0;
+  if (!registry->samples)
+    registry->samples = new Sample[kMaxLiveSamples];
+  memset(registry->samples, 0, kMaxLiveSamples * sizeof(Sample));
+  subtle::Release_Store(&running_, 1);
+}
+
+// static
+void HeapProfiler::Stop() {
+  subtle::Release_Store(&running_, 0);
+}
+
+// static
+void HeapProfiler::GetSites(std::vector<Site>* sites) {
+  Registry* registry = g_registry.Pointer();
+  sites->clear();
+  {
+    // The copies aren't sampled, as sampling them would take the lock again.
+    bool in_hook = registry->in_hook.Get();
+    registry->in_hook.Set(true);
+    AutoLock lock(registry->lock);
+    for (SiteMap::const_iterator i = registry->sites.begin();
+         i != registry->sites.end(); ++i)
+      sites->push_back(i->second);
+    registry->in_hook.Set(in_hook);
+  }
+  std::sort(sites->begin(), sites->end(), CompareSitesByLiveBytes);
+}
+
+// static
+void HeapProfiler::WriteAscii(std::string* output) {
+  std::vector<Site> sites;
+  GetSites(&sites);
+  int64 dropped_samples;
+  size_t sampling_interval;
+  {
+    Registry* registry = g_registry.Pointer();
+    AutoLock lock(registry->lock);
+    dropped_samples = registry->dropped_samples;
+    sampling_interval = registry->sampling_interval;
+  }
+  StringAppendF(output, "Heap allocation sites by live bytes, sampled every "
+                "%" PRIuS " bytes on average", sampling_interval);
+  if (dropped_samples)
+    StringAppendF(output, ", %" PRId64 " samples dropped", dropped_samples);
+  output->append("\n  live(KB)  samples   total(KB)\n");
+  for (size_t i = 0; i < sites.size(); ++i) {
+    const Site& site = sites[i];
+    StringAppendF(output, "%10" PRId64 " %8" PRId64 " %11" PRId64 "\n",
+                  site.live_bytes / 1024, site.live_samples,
+                  site.total_bytes / 1024);
+    for (size_t j = 0; j < site.stack.size(); ++j) {
+      std::string symbol, file;
+      int line;
+      if (StackTrace::GetSymbol(site.stack[j], &symbol, &file, &line))
+        StringAppendF(output, "\t%s", symbol.c_str());
+      else
+        StringAppendF(output, "\t(No symbol) [%p]", site.stack[j]);
+      if (!file.empty())
+        StringAppendF(output, " (%s:%d)", file.c_str(), line);
+      output->append("\n");
+    }
+  }
+}
+
+// static
+void HeapProfiler::SampleAlloc(void* ptr, size_t size) {
+  if (!ptr)
+    return;
+  Registry* registry = g_registry.Pointer();
+  if (registry->in_hook.Get())
+    return;
+
+  // 0 is a thread's first allocation, whose interval is yet to be drawn.
+  intptr_t remaining =
+      reinterpret_cast<intptr_t>(registry->bytes_until_sample.Get());
+  bool sampled = remaining != 0;
+  if (sampled) {
+    remaining -= static_cast<intptr_t>(size);
+    if (remaining > 0) {
+      registry->bytes_until_sample.Set(reinterpret_cast<void*>(remaining));
+      return;
+    }
+  }
+
+  registry->in_hook.Set(true);
+  const void* frames[kMaxFrames];
+  // Skips the hooks and the allocator.
+  size_t count = StackTrace::CaptureAddresses(
+      const_cast<void**>(frames), kMaxFrames, 2);
+  {
+    AutoLock lock(registry->lock);
+    registry->bytes_until_sample.Set(
+        reinterpret_cast<void*>(NextSampleInterval(registry)));
+    if (sampled) {
+      Site& site =
+          registry->sites[std::vector<const void*>(frames, frames + count)];
+      if (site.stack.empty())
+        site.stack.assign(frames, frames + count);
+      int64 bytes = SampleBytes(size, registry->sampling_interval);
+      site.total_bytes += bytes;
+
+      bool stored = false;
+      size_t slot = HashAddress(ptr);
+      for (size_t i = 0; i < kMaxProbes && !stored; ++i) {
+        Sample* sample = &registry->samples[(slot + i) % kMaxLiveSamples];
+        subtle::AtomicWord address = subtle::NoBarrier_Load(&sample->address);
+        if ((address == kEmptySlot || address == kFreedSlot) &&
+            subtle::NoBarrier_CompareAndSwap(&sample->address, address,
+                                             kBusySlot) == address) {
+          sample->bytes = bytes;
+          sample->site = &site;
+          subtle::Release_Store(&sample->address,
+                                reinterpret_cast<subtle::AtomicWord>(ptr));
+          stored = true;
+        }
+      }
+      if (stored) {
+        ++site.live_samples;
+        site.live_bytes += bytes;
+      } else {
+        ++registry->dropped_samples;
+      }
+    }
+  }
+  registry->in_hook.Set(false);
+}
+
+// static
+void HeapProfiler::SampleFree(void* ptr) {
+  if (!ptr)
+    return;
+  Registry* registry = g_registry.Pointer();
+  subtle::AtomicWord address = reinterpret_cast<subtle::AtomicWord>(ptr);
+  size_t slot = HashAddress(ptr);
+  for (size_t i = 0; i < kMaxProbes; ++i) {
+    Sample* sample = &registry->samples[(slot + i) % kMaxLiveSamples];
+    subtle::AtomicWord value = subtle::Acquire_Load(&sample->address);
+    if (value == kEmptySlot)
+      return;
+    if (value != address ||
+        subtle::Acquire_CompareAndSwap(&sample->address, address,
+                                       kBusySlot) != address)
+      continue;
+    {
+      AutoLock lock(registry->lock);
+      --sample->site->live_samples;
+      sample->site->live_bytes -= sample->bytes;
+    }
+    subtle::Release_Store(&sample->address, kFreedSlot);
+    return;
+  }
+}
+
+}  // namespace debug
+}  // namespace base
@@ -0,0 +1,96 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_DEBUG_HEAP_PROFILER_H_
+#define BASE_DEBUG_HEAP_PROFILER_H_
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/basictypes.h"
+
+namespace base {
+namespace debug {
+
+// HeapProfiler tells which code holds the most memory, by sampling the heap
+// allocations while it runs. Each allocation is sampled with a probability
+// proportional to its size: on each thread, the allocator hooks count down
+// the bytes allocated, and the allocation that crosses zero is sampled, with
+// the next count drawn from an exponential distribution whose mean is the
+// sampling interval. The stacks of the sampled allocations are recorded, and
+// the estimated bytes grouped by allocation site, that is by stack.
+//
+// The allocations are seen through RecordAlloc() and RecordFree(), which
+// Skia's sk_malloc() family calls, and the operator new and delete of the
+// executables that depend on base.gyp:heap_profiler_new. Other malloc()
+// calls aren't seen. The hooks only read a flag while the profiler isn't
+// running.
+class BASE_EXPORT HeapProfiler {
+ public:
+  // The estimated allocations of a site.
+  struct BASE_EXPORT Site {
+    Site();
+    ~Site();
+
+    // The stack of the allocations, innermost frame first.
+    std::vector<const void*> stack;
+
+    // The sampled allocations that haven't been freed, and the bytes of the
+    // site's allocations they stand for.
+    int64 live_samples;
+    int64 live_bytes;
+
+    // The bytes of all the site's allocations since Start(), freed or not.
+    int64 total_bytes;
+  };
+
+  // The mean bytes allocated between two samples, unless Start() is given
+  // another.
+  static const size_t kDefaultSamplingInterval = 128 * 1024;
+
+  // Starts sampling, dropping the sites of a previous run.
+  static void Start(size_t sampling_interval);
+
+  // Stops sampling. The sites stay readable, with their live counts as of
+  // now.
+  static void Stop();
+
+  static bool IsRunning() {
+    return subtle::NoBarrier_Load(&running_) != 0;
+  }
+
+  // The allocator hooks. |ptr| is the block of |size| bytes just allocated,
+  // or about to be freed. Either may be NULL.
+  static void RecordAlloc(void* ptr, size_t size) {
+    if (IsRunning())
+      SampleAlloc(ptr, size);
+  }
+  static void RecordFree(void* ptr) {
+    if (IsRunning())
+      SampleFree(ptr);
+  }
+
+  // Returns the sites that allocated, those with the most live bytes first.
+  static void GetSites(std::vector<Site>* sites);
+
+  // Writes the sites as a table, each with its symbolized stack.
+  static void WriteAscii(std::string* output);
+
+ private:
+  // The slow paths of the hooks, while the profiler runs.
+  static void SampleAlloc(void* ptr, size_t size);
+  static void SampleFree(void* ptr);
+
+  static subtle::Atomic32 running_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(HeapProfiler);
+};
+
+}  // namespace debug
+}  // namespace base
+
+#endif  // BASE_DEBUG_HEAP_PROFILER_H_
@@ -0,0 +1,74 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// The global operator new and delete, through malloc() and free(), with the
+// HeapProfiler hooks. Only built into the executables that depend on
+// base.gyp:heap_profiler_new, as an executable may only have one.
+
+#include <stdlib.h>
+
+#include <new>
+
+#include "base/debug/heap_profiler.h"
+
+namespace {
+
+void* ProfiledNew(size_t size, bool nothrow) {
+  for (;;) {
+    void* ptr = malloc(size ? size : 1);
+    if (ptr) {
+      base::debug::HeapProfiler::RecordAlloc(ptr, size);
+      return ptr;
+    }
+    // There is no std::get_new_handler() before C++11.
+    std::new_handler handler = std::set_new_handler(NULL);
+    std::set_new_handler(handler);
+    if (!handler) {
+      if (nothrow)
+        return NULL;
+      // Exceptions are disabled.
+      abort();
+    }
+    handler();
+  }
+}
+
+void ProfiledDelete(void* ptr) {
+  base::debug::HeapProfiler::RecordFree(ptr);
+  free(ptr);
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  return ProfiledNew(size, false);
+}
+
+void* operator new[](size_t size) {
+  return ProfiledNew(size, false);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) throw() {
+  return ProfiledNew(size, true);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) throw() {
+  return ProfiledNew(size, true);
+}
+
+void operator delete(void* ptr) throw() {
+  ProfiledDelete(ptr);
+}
+
+void operator delete[](void* ptr) throw() {
+  ProfiledDelete(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) throw() {
+  ProfiledDelete(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) throw() {
+  ProfiledDelete(ptr);
+}
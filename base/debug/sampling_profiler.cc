@@ -0,0 +1,229 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/sampling_profiler.h"
+
+#include "base/debug/stack_trace.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/stl_util.h"
+#include "base/stringprintf.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+// Appends |value| as a JSON string, inserting a backslash before the special
+// characters as TraceLog does.
+void AppendQuoted(const std::string& value, std::string* out) {
+  *out += "\"";
+  std::string::size_type start_pos = out->size();
+  *out += value;
+  while ((start_pos = out->find_first_of("\\\"", start_pos)) !=
+         std::string::npos) {
+    out->insert(start_pos, 1, '\\');
+    // skip inserted escape character and following character.
+    start_pos += 2;
+  }
+  *out += "\"";
+}
+
+// Appends |word| in the native word size and byte order, as pprof reads.
+void AppendWord(uintptr_t word, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&word), sizeof(word));
+}
+
+}  // namespace
+
+SamplingProfiler::Node::Node()
+    : address(NULL),
+      self_samples(0),
+      total_samples(0) {
+}
+
+SamplingProfiler::Node::~Node() {
+  STLDeleteValues(&children);
+}
+
+SamplingProfiler::SamplingProfiler()
+    : sampling_thread_(kNullThreadHandle),
+      running_(false),
+      stop_event_(true, false),
+      sample_count_(0),
+      failed_sample_count_(0) {
+}
+
+SamplingProfiler::~SamplingProfiler() {
+  Stop();
+  for (size_t i = 0; i < targets_.size(); ++i)
+    CloseThread(targets_[i]->handle);
+  STLDeleteElements(&targets_);
+}
+
+bool SamplingProfiler::AddThread(PlatformThreadId thread_id) {
+  DCHECK(!running_);
+  scoped_ptr<Target> target(new Target);
+  target->thread_id = thread_id;
+  if (!OpenThread(thread_id, &target->handle, &target->stack_base))
+    return false;
+  targets_.push_back(target.release());
+  return true;
+}
+
+bool SamplingProfiler::Start(TimeDelta interval, TimeDelta duration) {
+  DCHECK(!running_);
+  if (targets_.empty())
+    return false;
+  interval_ = interval;
+  duration_ = duration;
+  stop_event_.Reset();
+  running_ = PlatformThread::Create(0, this, &sampling_thread_);
+  return running_;
+}
+
+void SamplingProfiler::Stop() {
+  if (!running_)
+    return;
+  stop_event_.Signal();
+  PlatformThread::Join(sampling_thread_);
+  sampling_thread_ = kNullThreadHandle;
+  running_ = false;
+}
+
+const SamplingProfiler::Node* SamplingProfiler::GetCallTree(
+    PlatformThreadId thread_id) const {
+  DCHECK(!running_);
+  for (size_t i = 0; i < targets_.size(); ++i) {
+    if (targets_[i]->thread_id == thread_id)
+      return &targets_[i]->call_tree;
+  }
+  return NULL;
+}
+
+void SamplingProfiler::AppendAsJSON(std::string* out) const {
+  DCHECK(!running_);
+  StringAppendF(out, "{\"interval_us\":%lld,\"samples\":%lld,\"threads\":[",
+                static_cast<long long>(interval_.InMicroseconds()),
+                static_cast<long long>(sample_count_));
+  for (size_t i = 0; i < targets_.size(); ++i) {
+    if (i > 0)
+      *out += ",";
+    StringAppendF(out, "{\"tid\":%i,\"tree\":",
+                  static_cast<int>(targets_[i]->thread_id));
+    AppendNodeAsJSON(targets_[i]->call_tree, out);
+    *out += "}";
+  }
+  *out += "]}";
+}
+
+void SamplingProfiler::AppendAsPprof(std::string* out) const {
+  DCHECK(!running_);
+  // The header: its size in words, the format version, the sampling period,
+  // and padding.
+  AppendWord(0, out);
+  AppendWord(3, out);
+  AppendWord(0, out);
+  AppendWord(static_cast<uintptr_t>(interval_.InMicroseconds()), out);
+  AppendWord(0, out);
+
+  std::vector<const void*> stack;
+  for (size_t i = 0; i < targets_.size(); ++i) {
+    const Node::Children& children = targets_[i]->call_tree.children;
+    for (Node::Children::const_iterator child = children.begin();
+         child != children.end(); ++child)
+      AppendNodeAsPprof(*child->second, &stack, out);
+  }
+
+  // The trailer, a record of one sample of no frame, with the pc 0.
+  AppendWord(0, out);
+  AppendWord(1, out);
+  AppendWord(0, out);
+
+  AppendModuleMaps(out);
+}
+
+void SamplingProfiler::ThreadMain() {
+  PlatformThread::SetName("SamplingProfiler");
+  TimeTicks end_time = TimeTicks::Now() + duration_;
+  const void* addresses[kMaxFrames];
+  while (!stop_event_.TimedWait(interval_) && TimeTicks::Now() < end_time) {
+    for (size_t i = 0; i < targets_.size(); ++i) {
+      Target* target = targets_[i];
+      size_t count = SampleThread(target->handle, target->stack_base,
+                                  addresses, kMaxFrames);
+      ++sample_count_;
+      // The thread is running again, so allocating is safe.
+      if (count)
+        AddSample(addresses, count, &target->call_tree);
+      else
+        ++failed_sample_count_;
+    }
+  }
+}
+
+// static
+void SamplingProfiler::AddSample(const void* const* addresses,
+                                 size_t count,
+                                 Node* tree) {
+  Node* node = tree;
+  ++node->total_samples;
+  for (size_t i = count; i > 0; --i) {
+    Node*& child = node->children[addresses[i - 1]];
+    if (!child) {
+      child = new Node;
+      child->address = addresses[i - 1];
+    }
+    node = child;
+    ++node->total_samples;
+  }
+  ++node->self_samples;
+}
+
+// static
+void SamplingProfiler::AppendNodeAsJSON(const Node& node, std::string* out) {
+  std::string name("(root)");
+  std::string file;
+  int line = 0;
+  if (node.address &&
+      !StackTrace::GetSymbol(node.address, &name, &file, &line))
+    name = "(No symbol)";
+  *out += "{\"name\":";
+  AppendQuoted(name, out);
+  *out += ",\"file\":";
+  AppendQuoted(file, out);
+  StringAppendF(out, ",\"line\":%i,\"address\":\"%p\","
+                "\"self\":%lld,\"total\":%lld,\"children\":[",
+                line, node.address,
+                static_cast<long long>(node.self_samples),
+                static_cast<long long>(node.total_samples));
+  for (Node::Children::const_iterator i = node.children.begin();
+       i != node.children.end(); ++i) {
+    if (i != node.children.begin())
+      *out += ",";
+    AppendNodeAsJSON(*i->second, out);
+  }
+  *out += "]}";
+}
+
+// static
+void SamplingProfiler::AppendNodeAsPprof(const Node& node,
+                                         std::vector<const void*>* stack,
+                                         std::string* out) {
+  stack->push_back(node.address);
+  if (node.self_samples) {
+    // The sample count, the depth, then the frames innermost first.
+    AppendWord(static_cast<uintptr_t>(node.self_samples), out);
+    AppendWord(stack->size(), out);
+    for (size_t i = stack->size(); i > 0; --i)
+      AppendWord(reinterpret_cast<uintptr_t>((*stack)[i - 1]), out);
+  }
+  for (Node::Children::const_iterator i = node.children.begin();
+       i != node.children.end(); ++i)
+    AppendNodeAsPprof(*i->second, stack, out);
+  stack->pop_back();
+}
+
+}  // namespace debug
+}  // namespace base
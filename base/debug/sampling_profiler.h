@@ -0,0 +1,165 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_DEBUG_SAMPLING_PROFILER_H_
+#define BASE_DEBUG_SAMPLING_PROFILER_H_
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
+#include "base/time.h"
+
+namespace base {
+namespace debug {
+
+// SamplingProfiler finds the hot code of threads of the current process
+// without external tools. A thread of its own suspends each of the threads
+// added to it at the sampling interval, records its stack, and resumes it.
+// The samples are aggregated into a call tree per thread, which can be
+// written as JSON, with the symbols resolved through StackTrace, or in the
+// legacy binary format of pprof's CPU profiles.
+//
+// Nothing allocates or takes locks while a thread is suspended, since it may
+// be holding the heap lock. On x86 the stack is walked through the frame
+// pointers, which misses the callers of functions built without them. On x64
+// the stack is copied while the thread is suspended, and the copy is walked
+// with the unwind data once the thread runs again, as looking that up may
+// take the loader lock.
+//
+// A profiler is used on one thread, and samples once.
+class BASE_EXPORT SamplingProfiler : public PlatformThread::Delegate {
+ public:
+  // A frame of the call tree, and the samples that went through it.
+  struct BASE_EXPORT Node {
+    Node();
+    ~Node();
+
+    // The return address of the frame, or its program counter for the
+    // innermost frames of the samples. NULL for the root.
+    const void* address;
+
+    // The samples whose innermost frame this is, and all those through it.
+    int64 self_samples;
+    int64 total_samples;
+
+    // The frames this one called, owned.
+    typedef std::map<const void*, Node*> Children;
+    Children children;
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(Node);
+  };
+
+  SamplingProfiler();
+  // Stops the sampling.
+  virtual ~SamplingProfiler();
+
+  // Adds |thread_id|, a thread of the current process such as
+  // base::Thread::thread_id() or PlatformThread::CurrentId(), to the threads
+  // sampled. Returns false if the thread can't be sampled. Must be called
+  // before Start().
+  bool AddThread(PlatformThreadId thread_id);
+
+  // Starts sampling every |interval| for |duration|, or until Stop(). Returns
+  // false if no thread was added, or the sampling thread couldn't start.
+  bool Start(TimeDelta interval, TimeDelta duration);
+
+  // Stops the sampling, waiting for the sampling thread to exit, if the
+  // duration hasn't run out already. The profile can then be read.
+  void Stop();
+
+  // Returns the call tree of |thread_id|, or NULL if it wasn't sampled.
+  const Node* GetCallTree(PlatformThreadId thread_id) const;
+
+  // The number of samples taken of all the threads, and of the samples that
+  // failed, e.g. because the thread had exited.
+  int64 sample_count() const { return sample_count_; }
+  int64 failed_sample_count() const { return failed_sample_count_; }
+
+  // Appends the call trees, as
+  //   {"interval_us":...,"samples":...,"threads":[{"tid":...,"tree":NODE}]}
+  // where a NODE is
+  //   {"name":...,"file":...,"line":...,"address":...,"self":...,
+  //    "total":...,"children":[NODE, ...]}
+  void AppendAsJSON(std::string* out) const;
+
+  // Appends the samples in the legacy CPU profile format of pprof, followed
+  // by the address ranges of the loaded modules.
+  void AppendAsPprof(std::string* out) const;
+
+ private:
+  // A sampled thread.
+  struct Target {
+    PlatformThreadId thread_id;
+    void* handle;
+    // The highest address of the thread's stack.
+    const void* stack_base;
+    Node call_tree;
+  };
+
+  // The deepest stacks recorded.
+  static const size_t kMaxFrames = 128;
+
+  // PlatformThread::Delegate:
+  virtual void ThreadMain();
+
+  // Adds the stack in |addresses|, innermost frame first, to |tree|.
+  static void AddSample(const void* const* addresses,
+                        size_t count,
+                        Node* tree);
+
+  // Appends |node| and its children.
+  static void AppendNodeAsJSON(const Node& node, std::string* out);
+
+  // Appends a pprof record for each stack that ended in |node| or its
+  // children. |stack| holds the frames from the root to |node|'s parent.
+  static void AppendNodeAsPprof(const Node& node,
+                                std::vector<const void*>* stack,
+                                std::string* out);
+
+  // Platform specific. Opens |thread_id| for sampling, setting |handle| and
+  // |stack_base|; closes it.
+  static bool OpenThread(PlatformThreadId thread_id,
+                         void** handle,
+                         const void** stack_base);
+  static void CloseThread(void* handle);
+
+  // Platform specific. Suspends |handle|, stores up to |max_count| frames of
+  // its stack into |addresses|, innermost first, and resumes it. Returns the
+  // number of frames stored, 0 on failure.
+  static size_t SampleThread(void* handle,
+                             const void* stack_base,
+                             const void** addresses,
+                             size_t max_count);
+
+  // Platform specific. Appends the address ranges of the loaded modules, as
+  // the lines of /proc/self/maps.
+  static void AppendModuleMaps(std::string* out);
+
+  std::vector<Target*> targets_;
+
+  TimeDelta interval_;
+  TimeDelta duration_;
+  PlatformThreadHandle sampling_thread_;
+  bool running_;
+
+  // Signaled by Stop().
+  WaitableEvent stop_event_;
+
+  int64 sample_count_;
+  int64 failed_sample_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(SamplingProfiler);
+};
+
+}  // namespace debug
+}  // namespace base
+
+#endif  // BASE_DEBUG_SAMPLING_PROFILER_H_
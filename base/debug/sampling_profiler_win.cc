@@ -0,0 +1,233 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/sampling_profiler.h"
+
+#include <windows.h>
+#include <psapi.h>
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/stringprintf.h"
+#include "base/utf_string_conversions.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+// NtQueryInformationThread function pointer, and the part of its
+// ThreadBasicInformation record that gives the thread's TEB, from
+// winternl.h.
+typedef LONG (WINAPI* NtQueryInformationThreadFunction)(HANDLE, ULONG, PVOID,
+                                                        ULONG, PULONG);
+const ULONG kThreadBasicInformation = 0;
+
+struct ThreadBasicInformation {
+  LONG exit_status;
+  NT_TIB* teb;
+  void* unique_process;
+  void* unique_thread;
+  ULONG_PTR affinity_mask;
+  LONG priority;
+  LONG base_priority;
+};
+
+#if defined(_M_X64)
+// The deepest stack that is copied. The samples of deeper stacks fail, as
+// unwinding part of a stack could read past its copy.
+const size_t kMaxStackCopyWords = 256 * 1024 / sizeof(uintptr_t);
+
+// Points |*value| at |copy| if it points into [top, end) of the stack.
+void RelocateStackPointer(uintptr_t top,
+                          uintptr_t end,
+                          const uintptr_t* copy,
+                          DWORD64* value) {
+  if (*value >= top && *value < end)
+    *value = *value - top + reinterpret_cast<uintptr_t>(copy);
+}
+
+// Copies the stack of the suspended thread whose registers are |context|,
+// up to |stack_base|, into |copy|, and points the registers and the words of
+// the copy that point into the stack, such as the saved frame pointers, at
+// the copy. Neither allocates nor takes locks. Returns the end of the copy,
+// or NULL if the stack pointer is off or the stack is too deep.
+const void* CopyStack(CONTEXT* context,
+                      const void* stack_base,
+                      uintptr_t* copy) {
+  uintptr_t top = context->Rsp;
+  uintptr_t end = reinterpret_cast<uintptr_t>(stack_base);
+  if (top >= end || (top & (sizeof(uintptr_t) - 1)) != 0 ||
+      (end - top) / sizeof(uintptr_t) > kMaxStackCopyWords)
+    return NULL;
+  size_t words = (end - top) / sizeof(uintptr_t);
+  const uintptr_t* stack = reinterpret_cast<const uintptr_t*>(top);
+  for (size_t i = 0; i < words; ++i) {
+    DWORD64 word = stack[i];
+    RelocateStackPointer(top, end, copy, &word);
+    copy[i] = static_cast<uintptr_t>(word);
+  }
+
+  DWORD64* registers[] = {
+    &context->Rsp, &context->Rbp, &context->Rbx, &context->Rsi,
+    &context->Rdi, &context->R12, &context->R13, &context->R14,
+    &context->R15,
+  };
+  for (size_t i = 0; i < arraysize(registers); ++i)
+    RelocateStackPointer(top, end, copy, registers[i]);
+  return copy + words;
+}
+#endif
+
+// Walks the stack whose innermost frame has the registers |context|, up to
+// |stack_end|, storing the frames into |addresses|. On x86 the stack is the
+// suspended thread's, and the walk neither allocates nor takes locks. On x64
+// it is the copy made by CopyStack(), since looking up the unwind data may
+// take the loader lock.
+size_t WalkStack(CONTEXT* context,
+                 const void* stack_end_pointer,
+                 const void** addresses,
+                 size_t max_count) {
+  uintptr_t stack_end = reinterpret_cast<uintptr_t>(stack_end_pointer);
+  size_t count = 0;
+#if defined(_M_X64)
+  while (count < max_count && context->Rip) {
+    addresses[count++] = reinterpret_cast<const void*>(context->Rip);
+    DWORD64 image_base = 0;
+    PRUNTIME_FUNCTION function =
+        RtlLookupFunctionEntry(context->Rip, &image_base, NULL);
+    if (function) {
+      void* handler_data = NULL;
+      DWORD64 establisher_frame = 0;
+      RtlVirtualUnwind(UNW_FLAG_NHANDLER, image_base, context->Rip, function,
+                       context, &handler_data, &establisher_frame, NULL);
+    } else {
+      // A leaf function, which doesn't move the stack pointer: the return
+      // address is on the top of the stack.
+      if (context->Rsp + sizeof(DWORD64) > stack_end)
+        break;
+      context->Rip = *reinterpret_cast<DWORD64*>(context->Rsp);
+      context->Rsp += sizeof(DWORD64);
+    }
+    if (context->Rsp >= stack_end)
+      break;
+  }
+#elif defined(_M_IX86)
+  addresses[count++] = reinterpret_cast<const void*>(context->Eip);
+  // Each frame starts with the caller's frame pointer, then the return
+  // address. The frames are followed as long as they go up the stack.
+  uintptr_t frame = context->Ebp;
+  uintptr_t stack_top = context->Esp;
+  while (count < max_count && frame >= stack_top && (frame & 3) == 0 &&
+         frame + 2 * sizeof(uintptr_t) <= stack_end) {
+    const uintptr_t* words = reinterpret_cast<const uintptr_t*>(frame);
+    if (!words[1])
+      break;
+    addresses[count++] = reinterpret_cast<const void*>(words[1]);
+    stack_top = frame + 2 * sizeof(uintptr_t);
+    frame = words[0];
+  }
+#endif
+  return count;
+}
+
+}  // namespace
+
+// static
+bool SamplingProfiler::OpenThread(PlatformThreadId thread_id,
+                                  void** handle,
+                                  const void** stack_base) {
+  static NtQueryInformationThreadFunction query_information_thread =
+      reinterpret_cast<NtQueryInformationThreadFunction>(GetProcAddress(
+          GetModuleHandle(L"ntdll.dll"), "NtQueryInformationThread"));
+  if (!query_information_thread)
+    return false;
+
+  HANDLE thread = ::OpenThread(
+      THREAD_GET_CONTEXT | THREAD_SUSPEND_RESUME | THREAD_QUERY_INFORMATION,
+      FALSE, thread_id);
+  if (!thread)
+    return false;
+
+  // The stack base in the TEB doesn't change while the thread runs.
+  ThreadBasicInformation information = {0};
+  if (query_information_thread(thread, kThreadBasicInformation, &information,
+                               sizeof(information), NULL) < 0 ||
+      !information.teb) {
+    CloseHandle(thread);
+    return false;
+  }
+  *handle = thread;
+  *stack_base = information.teb->StackBase;
+  return true;
+}
+
+// static
+void SamplingProfiler::CloseThread(void* handle) {
+  CloseHandle(handle);
+}
+
+// static
+size_t SamplingProfiler::SampleThread(void* handle,
+                                      const void* stack_base,
+                                      const void** addresses,
+                                      size_t max_count) {
+  HANDLE thread = static_cast<HANDLE>(handle);
+#if defined(_M_X64)
+  scoped_array<uintptr_t> stack_copy(new uintptr_t[kMaxStackCopyWords]);
+#endif
+  if (::SuspendThread(thread) == static_cast<DWORD>(-1))
+    return 0;
+
+  // Nothing between the suspension and the resumption may allocate or take
+  // a lock, which the suspended thread may hold. The x64 stacks are copied,
+  // and unwound once the thread runs again.
+  CONTEXT context;
+  memset(&context, 0, sizeof(context));
+  context.ContextFlags = CONTEXT_FULL;
+  size_t count = 0;
+#if defined(_M_X64)
+  const void* stack_end = NULL;
+  if (::GetThreadContext(thread, &context))
+    stack_end = CopyStack(&context, stack_base, stack_copy.get());
+#else
+  if (::GetThreadContext(thread, &context))
+    count = WalkStack(&context, stack_base, addresses, max_count);
+#endif
+
+  ::ResumeThread(thread);
+
+#if defined(_M_X64)
+  if (stack_end)
+    count = WalkStack(&context, stack_end, addresses, max_count);
+#endif
+  return count;
+}
+
+// static
+void SamplingProfiler::AppendModuleMaps(std::string* out) {
+  HANDLE process = GetCurrentProcess();
+  HMODULE modules[1024];
+  DWORD needed = 0;
+  if (!EnumProcessModules(process, modules, sizeof(modules), &needed))
+    return;
+  size_t count = std::min<size_t>(needed / sizeof(HMODULE),
+                                  arraysize(modules));
+  for (size_t i = 0; i < count; ++i) {
+    MODULEINFO info;
+    wchar_t path[MAX_PATH];
+    if (!GetModuleInformation(process, modules[i], &info, sizeof(info)) ||
+        !GetModuleFileName(modules[i], path, arraysize(path)))
+      continue;
+    uintptr_t start = reinterpret_cast<uintptr_t>(info.lpBaseOfDll);
+    StringAppendF(out, "%08Ix-%08Ix r-xp 00000000 00:00 0 %s\n",
+                  start, start + info.SizeOfImage,
+                  WideToUTF8(path).c_str());
+  }
+}
+
+}  // namespace debug
+}  // namespace base
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <iosfwd>
+#include <string>
 
 #include "base/base_export.h"
 #include "build/build_config.h"
@@ -52,6 +53,29 @@ class BASE_EXPORT StackTrace {
   // Resolves backtrace to symbols and write to stream.
   void OutputToStream(std::ostream* os) const;
 
+  // Stores the return addresses of the current stack into |addresses|, at
+  // most |max_count| of them, skipping the |frames_to_skip| innermost frames
+  // besides this function's. Returns the number stored. Doesn't allocate or
+  // take locks, so that sampling profilers and allocation hooks can call it.
+  static size_t CaptureAddresses(void** addresses,
+                                 size_t max_count,
+                                 size_t frames_to_skip);
+
+  // Resolves the symbol of |address|, setting |symbol| to its name and
+  // |file| and |line| to its source line, which are empty and 0 if unknown.
+  // Returns false if it has no symbol. The results are cached, so that each
+  // address is only resolved once, here, by PrefetchSymbols() or by
+  // OutputToStream().
+  static bool GetSymbol(const void* address,
+                        std::string* symbol,
+                        std::string* file,
+                        int* line);
+
+  // Resolves the symbols of the |count| |addresses| into the cache on a
+  // worker thread, so that printing the traces they come from later doesn't
+  // wait for the symbol files, or for a symbol server. Returns immediately.
+  static void PrefetchSymbols(const void* const* addresses, size_t count);
+
  private:
   // From http://msdn.microsoft.com/en-us/library/bb204633.aspx,
   // the sum of FramesToSkip and FramesToCapture must be less than 63,
@@ -7,12 +7,17 @@
 #include <windows.h>
 #include <dbghelp.h>
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 #include "base/basictypes.h"
+#include "base/bind.h"
+#include "base/hash_tables.h"
 #include "base/logging.h"
 #include "base/memory/singleton.h"
 #include "base/synchronization/lock.h"
+#include "base/threading/worker_pool.h"
 
 namespace base {
 namespace debug {
@@ -34,6 +39,11 @@ namespace {
 //
 // This is a very unlikely edge case, and the current solution is to
 // just ignore it.
+//
+// The resolved symbols are cached by address, under their own lock, so that
+// the traces which repeat addresses, as those of a sampling profiler do, only
+// go through DbgHelp once per address, and that looking up a cached symbol
+// doesn't wait for another thread resolving one.
 class SymbolContext {
  public:
   static SymbolContext* GetInstance() {
@@ -48,6 +58,32 @@ class SymbolContext {
     return init_error_;
   }
 
+  // The symbol of an address, and its source line.
+  struct Symbol {
+    Symbol() : has_symbol(false), displacement(0), line(0) {}
+
+    bool has_symbol;
+    std::string name;
+    DWORD64 displacement;
+    std::string file;  // Empty if the line isn't known.
+    int line;
+  };
+
+  // Returns the symbol of |address|, from the cache or resolved with DbgHelp.
+  Symbol GetSymbol(const void* address) {
+    {
+      base::AutoLock lock(cache_lock_);
+      SymbolCache::const_iterator i = cache_.find(address);
+      if (i != cache_.end())
+        return i->second;
+    }
+    Symbol symbol = ResolveSymbol(address);
+    base::AutoLock lock(cache_lock_);
+    if (cache_.size() < kMaxCachedSymbols)
+      cache_[address] = symbol;
+    return symbol;
+  }
+
   // For the given trace, attempts to resolve the symbols, and output a trace
   // to the ostream os.  The format for each line of the backtrace is:
   //
@@ -59,52 +95,35 @@ class SymbolContext {
   void OutputTraceToStream(const void* const* trace,
                            int count,
                            std::ostream* os) {
-    base::AutoLock lock(lock_);
-
     for (size_t i = 0; (i < count) && os->good(); ++i) {
-      const int kMaxNameLength = 256;
-      DWORD_PTR frame = reinterpret_cast<DWORD_PTR>(trace[i]);
-
-      // Code adapted from MSDN example:
-      // http://msdn.microsoft.com/en-us/library/ms680578(VS.85).aspx
-      ULONG64 buffer[
-        (sizeof(SYMBOL_INFO) +
-          kMaxNameLength * sizeof(wchar_t) +
-          sizeof(ULONG64) - 1) /
-        sizeof(ULONG64)];
-      memset(buffer, 0, sizeof(buffer));
-
-      // Initialize symbol information retrieval structures.
-      DWORD64 sym_displacement = 0;
-      PSYMBOL_INFO symbol = reinterpret_cast<PSYMBOL_INFO>(&buffer[0]);
-      symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
-      symbol->MaxNameLen = kMaxNameLength - 1;
-      BOOL has_symbol = SymFromAddr(GetCurrentProcess(), frame,
-                                    &sym_displacement, symbol);
-
-      // Attempt to retrieve line number information.
-      DWORD line_displacement = 0;
-      IMAGEHLP_LINE64 line = {};
-      line.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
-      BOOL has_line = SymGetLineFromAddr64(GetCurrentProcess(), frame,
-                                           &line_displacement, &line);
+      Symbol symbol = GetSymbol(trace[i]);
 
       // Output the backtrace line.
       (*os) << "\t";
-      if (has_symbol) {
-        (*os) << symbol->Name << " [0x" << trace[i] << "+"
-              << sym_displacement << "]";
+      if (symbol.has_symbol) {
+        (*os) << symbol.name << " [0x" << trace[i] << "+"
+              << symbol.displacement << "]";
       } else {
         // If there is no symbol informtion, add a spacer.
         (*os) << "(No symbol) [0x" << trace[i] << "]";
       }
-      if (has_line) {
-        (*os) << " (" << line.FileName << ":" << line.LineNumber << ")";
+      if (!symbol.file.empty()) {
+        (*os) << " (" << symbol.file << ":" << symbol.line << ")";
       }
       (*os) << "\n";
     }
   }
 
+  // Resolves the symbols of |addresses| into the cache. Runs on a worker
+  // thread.
+  static void PrefetchSymbols(const std::vector<const void*>& addresses) {
+    SymbolContext* context = GetInstance();
+    if (context->init_error() != ERROR_SUCCESS)
+      return;
+    for (size_t i = 0; i < addresses.size(); ++i)
+      context->GetSymbol(addresses[i]);
+  }
+
  private:
   friend struct DefaultSingletonTraits<SymbolContext>;
 
@@ -128,8 +147,60 @@ class SymbolContext {
     }
   }
 
+  typedef base::hash_map<const void*, Symbol> SymbolCache;
+
+  // Bounds the memory of the cache. Beyond this, the symbols are resolved
+  // each time.
+  static const size_t kMaxCachedSymbols = 64 * 1024;
+
+  // Resolves the symbol of |address| with DbgHelp.
+  Symbol ResolveSymbol(const void* address) {
+    base::AutoLock lock(lock_);
+
+    const int kMaxNameLength = 256;
+    DWORD_PTR frame = reinterpret_cast<DWORD_PTR>(address);
+
+    // Code adapted from MSDN example:
+    // http://msdn.microsoft.com/en-us/library/ms680578(VS.85).aspx
+    ULONG64 buffer[
+      (sizeof(SYMBOL_INFO) +
+        kMaxNameLength * sizeof(wchar_t) +
+        sizeof(ULONG64) - 1) /
+      sizeof(ULONG64)];
+    memset(buffer, 0, sizeof(buffer));
+
+    // Initialize symbol information retrieval structures.
+    Symbol result;
+    PSYMBOL_INFO symbol = reinterpret_cast<PSYMBOL_INFO>(&buffer[0]);
+    symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+    symbol->MaxNameLen = kMaxNameLength - 1;
+    if (SymFromAddr(GetCurrentProcess(), frame, &result.displacement,
+                    symbol)) {
+      result.has_symbol = true;
+      result.name = symbol->Name;
+    }
+
+    // Attempt to retrieve line number information.
+    DWORD line_displacement = 0;
+    IMAGEHLP_LINE64 line = {};
+    line.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
+    if (SymGetLineFromAddr64(GetCurrentProcess(), frame, &line_displacement,
+                             &line)) {
+      result.file = line.FileName;
+      result.line = line.LineNumber;
+    }
+    return result;
+  }
+
   DWORD init_error_;
+
+  // Serializes the Sym* calls.
   base::Lock lock_;
+
+  // Protects |cache_|.
+  base::Lock cache_lock_;
+  SymbolCache cache_;
+
   DISALLOW_COPY_AND_ASSIGN(SymbolContext);
 };
 
@@ -149,6 +220,20 @@ StackTrace::StackTrace() {
   count_ = CaptureStackBackTrace(0, arraysize(trace_), trace_, NULL);
 }
 
+// static
+size_t StackTrace::CaptureAddresses(void** addresses,
+                                    size_t max_count,
+                                    size_t frames_to_skip) {
+  // The sum of the frames to skip and capture must be less than 63 before
+  // Vista.
+  if (frames_to_skip + 1 >= static_cast<size_t>(kMaxTraces))
+    return 0;
+  DWORD count = static_cast<DWORD>(
+      std::min(max_count, kMaxTraces - frames_to_skip - 1));
+  return CaptureStackBackTrace(static_cast<DWORD>(frames_to_skip + 1), count,
+                               addresses, NULL);
+}
+
 #if defined(COMPILER_MSVC)
 #pragma optimize("", on)
 #endif
@@ -187,6 +272,31 @@ StackTrace::StackTrace(EXCEPTION_POINTERS* exception_pointers) {
   }
 }
 
+// static
+bool StackTrace::GetSymbol(const void* address,
+                           std::string* symbol,
+                           std::string* file,
+                           int* line) {
+  SymbolContext* context = SymbolContext::GetInstance();
+  SymbolContext::Symbol result;
+  if (context->init_error() == ERROR_SUCCESS)
+    result = context->GetSymbol(address);
+  *symbol = result.name;
+  *file = result.file;
+  *line = result.line;
+  return result.has_symbol;
+}
+
+// static
+void StackTrace::PrefetchSymbols(const void* const* addresses, size_t count) {
+  // Slow, since the symbols may come from a symbol server.
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&SymbolContext::PrefetchSymbols,
+                 std::vector<const void*>(addresses, addresses + count)),
+      true);
+}
+
 void StackTrace::PrintBacktrace() const {
   OutputToStream(&std::cerr);
 }
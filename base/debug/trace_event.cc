@@ -6,6 +6,7 @@
 
 #include <algorithm>
 
+#include "base/debug/trace_event_binary.h"
 #if defined(OS_WIN)
 #include "base/debug/trace_event_win.h"
 #endif
@@ -13,7 +14,7 @@
 #include "base/memory/ref_counted_memory.h"
 #include "base/process_util.h"
 #include "base/stringprintf.h"
-#include "base/threading/thread_local.h"
+#include "base/threading/platform_thread.h"
 #include "base/utf_string_conversions.h"
 #include "base/stl_util.h"
 #include "base/time.h"
@@ -27,6 +28,8 @@ namespace debug {
 // before throwing them away.
 const size_t kTraceEventBufferSize = 500000;
 const size_t kTraceEventBatchSize = 1000;
+// The number of events each thread keeps in RECORD_CONTINUOUSLY mode.
+const size_t kTraceEventContinuousThreadBufferSize = 65536;
 
 #define TRACE_EVENT_MAX_CATEGORIES 100
 
@@ -45,9 +48,6 @@ static const TraceCategory* const g_category_metadata =
     &g_categories[2];
 static int g_category_index = 3; // skip initial 3 categories
 
-// Flag to indicate whether we captured the current thread name
-static ThreadLocalBoolean g_current_thread_name_captured;
-
 ////////////////////////////////////////////////////////////////////////////////
 //
 // TraceValue
@@ -252,6 +252,111 @@ void TraceEvent::AppendAsJSON(std::string* out) const {
   *out += "}}";
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// TraceLog::ThreadBuffer
+//
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Event ids handed out by AddTraceEvent wrap within the positive ints.
+const int64 kEventIdMask = 0x7FFFFFFF;
+
+bool TraceEventTimestampLess(const TraceEvent& a, const TraceEvent& b) {
+  return a.timestamp() < b.timestamp();
+}
+
+}  // namespace
+
+// A ring of events written only by its owning thread. The owner and Flush()
+// hand the buffer back and forth with an atomic busy flag rather than a lock:
+// the owner never waits for it, and drops its event instead if a flush is
+// draining the buffer at that moment.
+class TraceLog::ThreadBuffer {
+ public:
+  ThreadBuffer(PlatformThreadId thread_id, size_t capacity)
+      : thread_id_(thread_id),
+        thread_name_(NULL),
+        capacity_(capacity),
+        base_(0),
+        written_(0),
+        busy_(0) {
+  }
+
+  PlatformThreadId thread_id() const { return thread_id_; }
+
+  // The name the owning thread had when it last logged an event.
+  const char* thread_name() const { return thread_name_; }
+  void set_thread_name(const char* name) { thread_name_ = name; }
+
+  // Owning thread only. Returns false if Flush() holds the buffer.
+  bool TryAcquire() {
+    return subtle::Acquire_CompareAndSwap(&busy_, 0, 1) == 0;
+  }
+
+  // Flush() only. Waits for the owning thread to finish its event.
+  void Acquire() {
+    while (!TryAcquire())
+      PlatformThread::YieldCurrentThread();
+  }
+
+  void Release() {
+    subtle::Release_Store(&busy_, 0);
+  }
+
+  // Stores |event|, overwriting the oldest event if the ring is full, and
+  // returns its id.
+  int Append(const TraceEvent& event) {
+    size_t slot = static_cast<size_t>(written_ % capacity_);
+    if (slot == events_.size())
+      events_.push_back(event);
+    else
+      events_[slot] = event;
+    return static_cast<int>((base_ + written_++) & kEventIdMask);
+  }
+
+  // Returns the event with |id|, or NULL if it has been overwritten or taken.
+  TraceEvent* GetEvent(int id) {
+    int64 index = (id - base_) & kEventIdMask;
+    if (index >= written_ ||
+        index + static_cast<int64>(capacity_) < written_)
+      return NULL;
+    return &events_[static_cast<size_t>(index % capacity_)];
+  }
+
+  // Appends the stored events to |events| oldest first, skipping discarded
+  // ones, and empties the ring. The ring then holds up to |capacity| events.
+  void TakeEvents(std::vector<TraceEvent>* events, size_t capacity) {
+    size_t start = written_ > static_cast<int64>(capacity_) ?
+        static_cast<size_t>(written_ % capacity_) : 0;
+    for (size_t i = 0; i < events_.size(); ++i) {
+      const TraceEvent& event = events_[(start + i) % events_.size()];
+      if (event.name())
+        events->push_back(event);
+    }
+    std::vector<TraceEvent>().swap(events_);
+    base_ += written_;
+    written_ = 0;
+    capacity_ = capacity;
+  }
+
+ private:
+  const PlatformThreadId thread_id_;
+  const char* thread_name_;
+
+  std::vector<TraceEvent> events_;
+  size_t capacity_;
+  // The id of the first event written since the last TakeEvents().
+  int64 base_;
+  // Events written since the last TakeEvents(), including overwritten ones.
+  int64 written_;
+
+  volatile subtle::Atomic32 busy_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadBuffer);
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // TraceLog
@@ -264,10 +369,15 @@ TraceLog* TraceLog::GetInstance() {
 }
 
 TraceLog::TraceLog()
-    : enabled_(false) {
+    : enabled_(false),
+      record_mode_(RECORD_UNTIL_FULL),
+      active_record_mode_(RECORD_UNTIL_FULL),
+      output_format_(OUTPUT_FORMAT_JSON),
+      event_count_(0) {
 }
 
 TraceLog::~TraceLog() {
+  STLDeleteElements(&thread_buffers_);
 }
 
 const TraceCategory* TraceLog::GetCategory(const char* name) {
@@ -301,16 +411,34 @@ static void EnableMatchingCategories(const std::vector<std::string>& patterns,
     EnableMatchingCategory(i, patterns, is_included);
 }
 
+// Returns the category named |name|, or NULL if there is none yet. Must be
+// called with category_lock_ or lock_ held.
+static const TraceCategory* FindCategory(const char* name) {
+  for (int i = 0; i < g_category_index; i++) {
+    if (strcmp(g_categories[i].name, name) == 0)
+      return &g_categories[i];
+  }
+  return NULL;
+}
+
 const TraceCategory* TraceLog::GetCategoryInternal(const char* name) {
-  AutoLock lock(lock_);
   DCHECK(!strchr(name, '"')) << "Category names may not contain double quote";
 
   // Search for pre-existing category matching this name
-  for (int i = 0; i < g_category_index; i++) {
-    if (strcmp(g_categories[i].name, name) == 0)
-      return &g_categories[i];
+  {
+    AutoReadLock read_lock(category_lock_);
+    const TraceCategory* category = FindCategory(name);
+    if (category)
+      return category;
   }
 
+  AutoLock lock(lock_);
+  AutoWriteLock write_lock(category_lock_);
+  // Another thread may have created it since.
+  const TraceCategory* category = FindCategory(name);
+  if (category)
+    return category;
+
   // Create a new category
   DCHECK(g_category_index < TRACE_EVENT_MAX_CATEGORIES) <<
       "must increase TRACE_EVENT_MAX_CATEGORIES";
@@ -335,7 +463,7 @@ const TraceCategory* TraceLog::GetCategoryInternal(const char* name) {
 }
 
 void TraceLog::GetKnownCategories(std::vector<std::string>* categories) {
-  AutoLock lock(lock_);
+  AutoReadLock read_lock(category_lock_);
   for (int i = 0; i < g_category_index; i++)
     categories->push_back(g_categories[i].name);
 }
@@ -346,6 +474,13 @@ void TraceLog::SetEnabled(const std::vector<std::string>& included_categories,
   if (enabled_)
     return;
   logged_events_.reserve(1024);
+  active_record_mode_ = record_mode_;
+  // Keep anything logged since the last flush, and resize the thread buffers
+  // for the new mode. What is kept counts against a RECORD_UNTIL_FULL limit.
+  MergeThreadBuffersLocked();
+  subtle::NoBarrier_Store(&event_count_,
+                          static_cast<subtle::Atomic32>(std::min(
+                              logged_events_.size(), kTraceEventBufferSize)));
   enabled_ = true;
   included_categories_ = included_categories;
   excluded_categories_ = excluded_categories;
@@ -367,6 +502,7 @@ void TraceLog::SetDisabled() {
     excluded_categories_.clear();
     for (int i = 0; i < g_category_index; i++)
       g_categories[i].enabled = false;
+    MergeThreadBuffersLocked();
     AddCurrentMetadataEvents();
   }  // release lock
   Flush();
@@ -379,14 +515,31 @@ void TraceLog::SetEnabled(bool enabled) {
     SetDisabled();
 }
 
+void TraceLog::SetRecordMode(RecordMode mode) {
+  AutoLock lock(lock_);
+  record_mode_ = mode;
+}
+
 float TraceLog::GetBufferPercentFull() const {
-  return (float)((double)logged_events_.size()/(double)kTraceEventBufferSize);
+  if (active_record_mode_ == RECORD_CONTINUOUSLY)
+    return 0;
+  size_t count = std::min(
+      static_cast<size_t>(subtle::NoBarrier_Load(&event_count_)),
+      kTraceEventBufferSize);
+  return (float)((double)count/(double)kTraceEventBufferSize);
 }
 
 void TraceLog::SetOutputCallback(const TraceLog::OutputCallback& cb) {
   AutoLock lock(lock_);
   output_callback_ = cb;
+  MergeThreadBuffersLocked();
   logged_events_.clear();
+  subtle::NoBarrier_Store(&event_count_, 0);
+}
+
+void TraceLog::SetOutputFormat(OutputFormat format) {
+  AutoLock lock(lock_);
+  output_format_ = format;
 }
 
 void TraceLog::SetBufferFullCallback(const TraceLog::BufferFullCallback& cb) {
@@ -397,15 +550,30 @@ void TraceLog::SetBufferFullCallback(const TraceLog::BufferFullCallback& cb) {
 void TraceLog::Flush() {
   std::vector<TraceEvent> previous_logged_events;
   OutputCallback output_callback_copy;
+  OutputFormat output_format_copy;
   {
     AutoLock lock(lock_);
+    MergeThreadBuffersLocked();
     previous_logged_events.swap(logged_events_);
+    subtle::NoBarrier_Store(&event_count_, 0);
     output_callback_copy = output_callback_;
+    output_format_copy = output_format_;
   }  // release lock
 
   if (output_callback_copy.is_null())
     return;
 
+  if (output_format_copy == OUTPUT_FORMAT_BINARY) {
+    TraceBinaryWriter writer(output_callback_copy);
+    for (size_t i = 0; i < previous_logged_events.size(); ++i) {
+      writer.AddEvent(previous_logged_events[i]);
+      // Release any copied strings as we go, to keep peak memory down.
+      previous_logged_events[i] = TraceEvent();
+    }
+    writer.Finish();
+    return;
+  }
+
   for (size_t i = 0;
        i < previous_logged_events.size();
        i += kTraceEventBatchSize) {
@@ -431,79 +599,93 @@ int TraceLog::AddTraceEvent(TraceEventPhase phase,
 #ifdef USE_UNRELIABLE_NOW
   TimeTicks now = TimeTicks::HighResNow();
 #else
-  TimeTicks now = TimeTicks::Now();
+  // The result doesn't change, so all the events have the same clock.
+  TimeTicks now = TimeTicks::IsHighResNowFastAndReliable() ?
+      TimeTicks::HighResNow() : TimeTicks::Now();
 #endif
-  BufferFullCallback buffer_full_callback_copy;
-  int ret_begin_id = -1;
-  {
-    AutoLock lock(lock_);
-    if (!category->enabled)
-      return -1;
-    if (logged_events_.size() >= kTraceEventBufferSize)
+  if (!category->enabled)
+    return -1;
+
+  ThreadBuffer* buffer = GetThreadBuffer();
+  const char* cur_name = PlatformThread::GetName();
+  if (cur_name != buffer->thread_name()) {
+    UpdateThreadName(buffer->thread_id(), cur_name);
+    buffer->set_thread_name(cur_name);
+  }
+
+  bool buffer_full = false;
+  if (active_record_mode_ == RECORD_UNTIL_FULL && threshold_begin_id <= -1) {
+    // The end event of a threshold pair is always kept once its begin event
+    // was, so only count the other events against the limit.
+    int count = subtle::NoBarrier_AtomicIncrement(&event_count_, 1);
+    if (static_cast<size_t>(count) > kTraceEventBufferSize)
       return -1;
+    buffer_full = static_cast<size_t>(count) == kTraceEventBufferSize;
+  }
 
-    PlatformThreadId thread_id = PlatformThread::CurrentId();
-
-    // Record the name of the calling thread, if not done already.
-    if (!g_current_thread_name_captured.Get()) {
-      const char* cur_name = PlatformThread::GetName();
-      base::hash_map<PlatformThreadId, std::string>::iterator existing_name =
-          thread_names_.find(thread_id);
-      if (existing_name == thread_names_.end()) {
-        // This is a new thread id, and a new name.
-        thread_names_[thread_id] = cur_name ? cur_name : "";
-      } else if(cur_name != NULL) {
-        // This is a thread id that we've seen before, but potentially with a
-        // new name.
-        std::vector<std::string> existing_names;
-        Tokenize(existing_name->second, std::string(","), &existing_names);
-        bool found = std::find(existing_names.begin(),
-                               existing_names.end(),
-                               cur_name) != existing_names.end();
-        if (!found) {
-          existing_names.push_back(cur_name);
-          thread_names_[thread_id] =
-              JoinString(existing_names, ',');
-        }
-      }
-    }
+  int ret_begin_id = AddTraceEventToBuffer(buffer, now, phase, category, name,
+                                           arg1_name, arg1_val,
+                                           arg2_name, arg2_val,
+                                           threshold_begin_id, threshold,
+                                           flags);
 
-    if (threshold_begin_id > -1) {
-      DCHECK(phase == base::debug::TRACE_EVENT_PHASE_END);
-      size_t begin_i = static_cast<size_t>(threshold_begin_id);
-      // Return now if there has been a flush since the begin event was posted.
-      if (begin_i >= logged_events_.size())
-        return -1;
-      // Determine whether to drop the begin/end pair.
-      TimeDelta elapsed = now - logged_events_[begin_i].timestamp();
-      if (elapsed < TimeDelta::FromMicroseconds(threshold)) {
-        // Remove begin event and do not add end event.
-        // This will be expensive if there have been other events in the
-        // mean time (should be rare).
-        logged_events_.erase(logged_events_.begin() + begin_i);
-        return -1;
-      }
-    }
-    ret_begin_id = static_cast<int>(logged_events_.size());
-    logged_events_.push_back(
-        TraceEvent(static_cast<unsigned long>(base::GetCurrentProcId()),
-                   thread_id,
-                   now, phase, category, name,
-                   arg1_name, arg1_val,
-                   arg2_name, arg2_val,
-                   flags & EVENT_FLAG_COPY));
-
-    if (logged_events_.size() == kTraceEventBufferSize) {
+  if (buffer_full) {
+    BufferFullCallback buffer_full_callback_copy;
+    {
+      AutoLock lock(lock_);
       buffer_full_callback_copy = buffer_full_callback_;
     }
-  }  // release lock
-
-  if (!buffer_full_callback_copy.is_null())
-    buffer_full_callback_copy.Run();
+    if (!buffer_full_callback_copy.is_null())
+      buffer_full_callback_copy.Run();
+  }
 
   return ret_begin_id;
 }
 
+int TraceLog::AddTraceEventToBuffer(ThreadBuffer* buffer,
+                                    TimeTicks now,
+                                    TraceEventPhase phase,
+                                    const TraceCategory* category,
+                                    const char* name,
+                                    const char* arg1_name,
+                                    const TraceValue& arg1_val,
+                                    const char* arg2_name,
+                                    const TraceValue& arg2_val,
+                                    int threshold_begin_id,
+                                    int64 threshold,
+                                    EventFlags flags) {
+  if (!buffer->TryAcquire())
+    return -1;  // Flush() is draining this thread's events.
+
+  if (threshold_begin_id > -1) {
+    DCHECK(phase == base::debug::TRACE_EVENT_PHASE_END);
+    // The begin event is gone if there has been a flush since it was posted
+    // or the ring has wrapped over it.
+    TraceEvent* begin_event = buffer->GetEvent(threshold_begin_id);
+    if (!begin_event || !begin_event->name()) {
+      buffer->Release();
+      return -1;
+    }
+    // Determine whether to drop the begin/end pair.
+    TimeDelta elapsed = now - begin_event->timestamp();
+    if (elapsed < TimeDelta::FromMicroseconds(threshold)) {
+      // Discard the begin event in place and do not add the end event.
+      *begin_event = TraceEvent();
+      buffer->Release();
+      return -1;
+    }
+  }
+  int id = buffer->Append(
+      TraceEvent(static_cast<unsigned long>(base::GetCurrentProcId()),
+                 buffer->thread_id(),
+                 now, phase, category, name,
+                 arg1_name, arg1_val,
+                 arg2_name, arg2_val,
+                 flags & EVENT_FLAG_COPY));
+  buffer->Release();
+  return id;
+}
+
 void TraceLog::AddTraceEventEtw(TraceEventPhase phase,
                                 const char* name,
                                 const void* id,
@@ -547,6 +729,70 @@ void TraceLog::AddCurrentMetadataEvents() {
   }
 }
 
+size_t TraceLog::GetEventsSize() {
+  AutoLock lock(lock_);
+  MergeThreadBuffersLocked();
+  return logged_events_.size();
+}
+
+TraceLog::ThreadBuffer* TraceLog::GetThreadBuffer() {
+  ThreadBuffer* buffer = current_thread_buffer_.Get();
+  if (buffer)
+    return buffer;
+  AutoLock lock(lock_);
+  buffer = new ThreadBuffer(PlatformThread::CurrentId(),
+                            active_record_mode_ == RECORD_CONTINUOUSLY ?
+                                kTraceEventContinuousThreadBufferSize :
+                                kTraceEventBufferSize);
+  thread_buffers_.push_back(buffer);
+  current_thread_buffer_.Set(buffer);
+  return buffer;
+}
+
+void TraceLog::UpdateThreadName(PlatformThreadId thread_id,
+                                const char* cur_name) {
+  AutoLock lock(lock_);
+  base::hash_map<PlatformThreadId, std::string>::iterator existing_name =
+      thread_names_.find(thread_id);
+  if (existing_name == thread_names_.end()) {
+    // This is a new thread id, and a new name.
+    thread_names_[thread_id] = cur_name ? cur_name : "";
+  } else if(cur_name != NULL) {
+    // This is a thread id that we've seen before, but potentially with a
+    // new name.
+    std::vector<std::string> existing_names;
+    Tokenize(existing_name->second, std::string(","), &existing_names);
+    bool found = std::find(existing_names.begin(),
+                           existing_names.end(),
+                           cur_name) != existing_names.end();
+    if (!found) {
+      existing_names.push_back(cur_name);
+      thread_names_[thread_id] =
+          JoinString(existing_names, ',');
+    }
+  }
+}
+
+void TraceLog::MergeThreadBuffersLocked() {
+  lock_.AssertAcquired();
+  size_t capacity = active_record_mode_ == RECORD_CONTINUOUSLY ?
+      kTraceEventContinuousThreadBufferSize : kTraceEventBufferSize;
+  std::vector<TraceEvent> events;
+  for (size_t i = 0; i < thread_buffers_.size(); ++i) {
+    ThreadBuffer* buffer = thread_buffers_[i];
+    buffer->Acquire();
+    buffer->TakeEvents(&events, capacity);
+    buffer->Release();
+  }
+  // The events stay counted in |event_count_| once they are merged; it only
+  // goes back to 0 as |logged_events_| is emptied.
+  if (events.empty())
+    return;
+  // Each thread's events are already in order; interleave them.
+  std::stable_sort(events.begin(), events.end(), TraceEventTimestampLess);
+  logged_events_.insert(logged_events_.end(), events.begin(), events.end());
+}
+
 void TraceLog::Resurrect() {
   StaticMemorySingletonTraits<TraceLog>::Resurrect();
 }
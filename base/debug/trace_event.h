@@ -75,13 +75,13 @@
 // multiple calls will return the same pointer to the category.
 //
 // Then the category.enabled flag is checked. This is a volatile bool, and
-// not intended to be multithread safe. It optimizes access to AddTraceEvent
-// which is threadsafe internally via TraceLog::lock_. The enabled flag may
+// not intended to be multithread safe. It optimizes access to AddTraceEvent,
+// which records into a buffer owned by the calling thread and so takes no
+// lock once that thread has logged its first event. The enabled flag may
 // cause some threads to incorrectly call or skip calling AddTraceEvent near
 // the time of the system being enabled or disabled. This is acceptable as
-// we tolerate some data loss while the system is being enabled/disabled and
-// because AddTraceEvent is threadsafe internally and checks the enabled state
-// again under lock.
+// we tolerate some data loss while the system is being enabled/disabled.
+// The per-thread buffers are merged into one stream only by Flush().
 //
 // Without the use of these static category pointers and enabled flags all
 // trace points would carry a significant performance cost of aquiring a lock
@@ -100,11 +100,14 @@
 #include <string>
 #include <vector>
 
+#include "base/atomicops.h"
 #include "base/callback.h"
 #include "base/hash_tables.h"
 #include "base/memory/singleton.h"
 #include "base/string_util.h"
+#include "base/synchronization/read_write_lock.h"
 #include "base/third_party/dynamic_annotations/dynamic_annotations.h"
+#include "base/threading/thread_local.h"
 #include "base/timer.h"
 
 // By default, const char* argument values are assumed to have long-lived scope
@@ -476,7 +479,15 @@ class TraceEvent {
                                  std::string* out);
   void AppendAsJSON(std::string* out) const;
 
+  unsigned long process_id() const { return process_id_; }
+  unsigned long thread_id() const { return thread_id_; }
   TimeTicks timestamp() const { return timestamp_; }
+  TraceEventPhase phase() const { return phase_; }
+  const TraceCategory* category() const { return category_; }
+  const char* arg_name(size_t index) const { return arg_names_[index]; }
+  const TraceValue& arg_value(size_t index) const {
+    return arg_values_[index];
+  }
 
   // Exposed for unittesting:
 
@@ -507,6 +518,16 @@ class BASE_EXPORT TraceLog {
     EVENT_FLAG_COPY = 1<<0
   };
 
+  // How events are kept once a thread's buffer fills up.
+  enum RecordMode {
+    // Stop recording once kTraceEventBufferSize events have been logged
+    // across all threads, and run the buffer full callback.
+    RECORD_UNTIL_FULL,
+    // Keep recording indefinitely, overwriting each thread's oldest events.
+    // Suitable for leaving tracing on in the field and flushing on demand.
+    RECORD_CONTINUOUSLY
+  };
+
   static TraceLog* GetInstance();
 
   // Get set of known categories. This can change as new code paths are reached.
@@ -529,6 +550,11 @@ class BASE_EXPORT TraceLog {
   void SetEnabled(bool enabled);
   bool IsEnabled() { return enabled_; }
 
+  // Selects the RecordMode for the next time tracing is enabled.  The default
+  // is RECORD_UNTIL_FULL.  Has no effect on a trace that is already running.
+  void SetRecordMode(RecordMode mode);
+
+  // Always 0 in RECORD_CONTINUOUSLY mode, which never fills up.
   float GetBufferPercentFull() const;
 
   // When enough events are collected, they are handed (in bulk) to
@@ -538,6 +564,18 @@ class BASE_EXPORT TraceLog {
   typedef base::Callback<void(scoped_refptr<RefCountedString>)> OutputCallback;
   void SetOutputCallback(const OutputCallback& cb);
 
+  // The encoding of the data handed to the output callback.
+  enum OutputFormat {
+    // Each callback receives a JSON array of up to 1000 events.
+    OUTPUT_FORMAT_JSON,
+    // The callbacks receive consecutive chunks of one binary stream, which
+    // is several times smaller and cheaper to produce. The chunks can be
+    // appended to a file as they arrive; see trace_event_binary.h for the
+    // format and for converting it back to JSON.
+    OUTPUT_FORMAT_BINARY
+  };
+  void SetOutputFormat(OutputFormat format);
+
   // The trace buffer does not flush dynamically, so when it fills up,
   // subsequent trace events will be dropped. This callback is generated when
   // the trace buffer is full. The callback must be thread safe.
@@ -551,11 +589,12 @@ class BASE_EXPORT TraceLog {
   static const TraceCategory* GetCategory(const char* name);
 
   // Called by TRACE_EVENT* macros, don't call this directly.
-  // Returns the index in the internal vector of the event if it was added, or
-  //         -1 if the event was not added.
+  // Returns the index of the event in the calling thread's buffer if it was
+  //         added, or -1 if the event was not added.
   // On end events, the return value of the begin event can be specified along
   // with a threshold in microseconds. If the elapsed time between begin and end
-  // is less than the threshold, the begin/end event pair is dropped.
+  // is less than the threshold, the begin/end event pair is dropped. The end
+  // event must be added on the same thread as the begin event.
   // If |copy| is set, |name|, |arg_name1| and |arg_name2| will be deep copied
   // into the event; see "Memory scoping note" and TRACE_EVENT_COPY_XXX above.
   int AddTraceEvent(TraceEventPhase phase,
@@ -580,8 +619,10 @@ class BASE_EXPORT TraceLog {
   // Allows resurrecting our singleton instance post-AtExit processing.
   static void Resurrect();
 
-  // Allow tests to inspect TraceEvents.
-  size_t GetEventsSize() const { return logged_events_.size(); }
+  // Allow tests to inspect TraceEvents. The per-thread buffers are merged
+  // (in timestamp order) into the inspected events first, so these must not
+  // race with other threads adding events.
+  size_t GetEventsSize();
   const TraceEvent& GetEventAt(size_t index) const {
     DCHECK(index < logged_events_.size());
     return logged_events_[index];
@@ -592,21 +633,68 @@ class BASE_EXPORT TraceLog {
   // by the Singleton class.
   friend struct StaticMemorySingletonTraits<TraceLog>;
 
+  // The events recorded by one thread. Only the owning thread writes to it,
+  // so adding an event takes no lock. Defined in trace_event.cc.
+  class ThreadBuffer;
+
   TraceLog();
   ~TraceLog();
   const TraceCategory* GetCategoryInternal(const char* name);
   void AddCurrentMetadataEvents();
 
-  // TODO(nduca): switch to per-thread trace buffers to reduce thread
-  // synchronization.
+  // The part of AddTraceEvent() that runs while the calling thread owns
+  // |buffer|.
+  int AddTraceEventToBuffer(ThreadBuffer* buffer,
+                            TimeTicks now,
+                            TraceEventPhase phase,
+                            const TraceCategory* category,
+                            const char* name,
+                            const char* arg1_name, const TraceValue& arg1_val,
+                            const char* arg2_name, const TraceValue& arg2_val,
+                            int threshold_begin_id,
+                            int64 threshold,
+                            EventFlags flags);
+
+  // Returns the calling thread's buffer, creating and registering it on the
+  // thread's first event.
+  ThreadBuffer* GetThreadBuffer();
+
+  // Records the calling thread's (possibly changed) name for the metadata
+  // events.
+  void UpdateThreadName(PlatformThreadId thread_id, const char* name);
+
+  // Moves the events out of every thread buffer and appends them to
+  // |logged_events_| in timestamp order.
+  void MergeThreadBuffersLocked();
+
+  // Protects the names of the categories, and their count, which
+  // GetCategoryInternal() looks up with it held for reading only. They are
+  // changed with |lock_| held too, so holding |lock_| is enough to read them.
+  ReadWriteLock category_lock_;
+
+  // Protects everything below except |event_count_|. Not taken when adding
+  // events, except for a thread's first event or a thread name change.
   Lock lock_;
   bool enabled_;
+  RecordMode record_mode_;
+  // The mode of the current (or last) trace; read without |lock_|.
+  volatile RecordMode active_record_mode_;
+  OutputFormat output_format_;
   OutputCallback output_callback_;
   BufferFullCallback buffer_full_callback_;
   std::vector<TraceEvent> logged_events_;
   std::vector<std::string> included_categories_;
   std::vector<std::string> excluded_categories_;
 
+  // Every thread that has logged an event. Never shrinks, since the threads'
+  // TLS slots keep pointing at their buffers.
+  std::vector<ThreadBuffer*> thread_buffers_;
+  ThreadLocalPointer<ThreadBuffer> current_thread_buffer_;
+
+  // Events logged since the last flush, across all threads. Only maintained
+  // in RECORD_UNTIL_FULL mode.
+  volatile subtle::Atomic32 event_count_;
+
   base::hash_map<PlatformThreadId, std::string> thread_names_;
 
   DISALLOW_COPY_AND_ASSIGN(TraceLog);
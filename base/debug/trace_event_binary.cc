@@ -0,0 +1,413 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/trace_event_binary.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+#include "base/memory/ref_counted_memory.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+const char kMagic[] = "TRCB";
+const uint64 kVersion = 1;
+
+enum RecordTag {
+  kStreamHeader = 1,
+  kString = 2,
+  kEvent = 3
+};
+
+bool ReadVarint(const std::string& chunk, size_t* pos, uint64* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && *pos < chunk.size(); shift += 7) {
+    uint8 byte = static_cast<uint8>(chunk[(*pos)++]);
+    *value |= static_cast<uint64>(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+bool ReadZigZag(const std::string& chunk, size_t* pos, int64* value) {
+  uint64 encoded;
+  if (!ReadVarint(chunk, pos, &encoded))
+    return false;
+  *value = static_cast<int64>(encoded >> 1) ^ -static_cast<int64>(encoded & 1);
+  return true;
+}
+
+bool ReadByte(const std::string& chunk, size_t* pos, uint8* value) {
+  if (*pos >= chunk.size())
+    return false;
+  *value = static_cast<uint8>(chunk[(*pos)++]);
+  return true;
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// TraceBinaryWriter
+//
+////////////////////////////////////////////////////////////////////////////////
+
+TraceBinaryWriter::TraceBinaryWriter(const TraceLog::OutputCallback& callback)
+    : callback_(callback),
+      chunk_(new TraceLog::RefCountedString),
+      last_timestamp_(0) {
+  chunk_->data.reserve(kChunkSize + 256);
+  chunk_->data += static_cast<char>(kStreamHeader);
+  AppendBytes(kMagic, arraysize(kMagic) - 1);
+  AppendVarint(kVersion);
+}
+
+TraceBinaryWriter::~TraceBinaryWriter() {
+  DCHECK(chunk_->data.empty()) << "Finish() was not called";
+}
+
+void TraceBinaryWriter::AddEvent(const TraceEvent& event) {
+  // Define any new strings ahead of the event record.
+  uint64 category_id = InternString(event.category()->name);
+  uint64 name_id = InternString(event.name());
+  uint64 arg_name_ids[kTraceMaxNumArgs];
+  uint64 arg_value_ids[kTraceMaxNumArgs];
+  size_t num_args = 0;
+  for (; num_args < kTraceMaxNumArgs && event.arg_name(num_args); ++num_args) {
+    arg_name_ids[num_args] = InternString(event.arg_name(num_args));
+    const TraceValue& value = event.arg_value(num_args);
+    if (value.type() == TraceValue::TRACE_TYPE_STATIC_STRING &&
+        value.as_string()) {
+      arg_value_ids[num_args] = InternString(value.as_string());
+    }
+  }
+
+  int64 timestamp = event.timestamp().ToInternalValue();
+  chunk_->data += static_cast<char>(kEvent);
+  AppendVarint(event.process_id());
+  AppendVarint(event.thread_id());
+  AppendZigZag(timestamp - last_timestamp_);
+  last_timestamp_ = timestamp;
+  chunk_->data += static_cast<char>(event.phase());
+  AppendVarint(category_id);
+  AppendVarint(name_id);
+  chunk_->data += static_cast<char>(num_args);
+  for (size_t i = 0; i < num_args; ++i) {
+    AppendVarint(arg_name_ids[i]);
+    const TraceValue& value = event.arg_value(i);
+    if (value.type() == TraceValue::TRACE_TYPE_STATIC_STRING &&
+        value.as_string()) {
+      chunk_->data += static_cast<char>(TraceValue::TRACE_TYPE_STATIC_STRING);
+      AppendVarint(arg_value_ids[i]);
+    } else {
+      AppendValue(value);
+    }
+  }
+
+  if (chunk_->data.size() >= kChunkSize)
+    FlushChunk();
+}
+
+void TraceBinaryWriter::Finish() {
+  FlushChunk();
+}
+
+uint64 TraceBinaryWriter::InternString(const char* str) {
+  std::string key(str);
+  base::hash_map<std::string, uint64>::const_iterator it =
+      string_ids_.find(key);
+  if (it != string_ids_.end())
+    return it->second;
+
+  uint64 id = string_ids_.size();
+  string_ids_[key] = id;
+  chunk_->data += static_cast<char>(kString);
+  AppendVarint(id);
+  AppendVarint(key.size());
+  AppendBytes(key.data(), key.size());
+  return id;
+}
+
+void TraceBinaryWriter::AppendVarint(uint64 value) {
+  while (value >= 0x80) {
+    chunk_->data += static_cast<char>((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  chunk_->data += static_cast<char>(value);
+}
+
+void TraceBinaryWriter::AppendZigZag(int64 value) {
+  AppendVarint((static_cast<uint64>(value) << 1) ^
+               static_cast<uint64>(value >> 63));
+}
+
+void TraceBinaryWriter::AppendBytes(const char* data, size_t length) {
+  chunk_->data.append(data, length);
+}
+
+void TraceBinaryWriter::AppendValue(const TraceValue& value) {
+  // Static strings are interned by AddEvent(); any that get here are NULL and
+  // are stored inline like copied strings.
+  TraceValue::Type type = value.type();
+  if (type == TraceValue::TRACE_TYPE_STATIC_STRING)
+    type = TraceValue::TRACE_TYPE_STRING;
+  chunk_->data += static_cast<char>(type);
+  switch (type) {
+    case TraceValue::TRACE_TYPE_BOOL:
+      chunk_->data += static_cast<char>(value.as_bool() ? 1 : 0);
+      break;
+    case TraceValue::TRACE_TYPE_UINT:
+      AppendVarint(value.as_uint());
+      break;
+    case TraceValue::TRACE_TYPE_INT:
+      AppendZigZag(value.as_int());
+      break;
+    case TraceValue::TRACE_TYPE_DOUBLE: {
+      double d = value.as_double();
+      uint64 bits;
+      memcpy(&bits, &d, sizeof(bits));
+      // Little endian, independent of the host.
+      for (int i = 0; i < 8; ++i)
+        chunk_->data += static_cast<char>((bits >> (8 * i)) & 0xFF);
+      break;
+    }
+    case TraceValue::TRACE_TYPE_POINTER:
+      AppendVarint(static_cast<uint64>(
+          reinterpret_cast<uintptr_t>(value.as_pointer())));
+      break;
+    case TraceValue::TRACE_TYPE_STRING: {
+      const char* str = value.as_string() ? value.as_string() : "NULL";
+      size_t length = strlen(str);
+      AppendVarint(length);
+      AppendBytes(str, length);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void TraceBinaryWriter::FlushChunk() {
+  if (chunk_->data.empty())
+    return;
+  callback_.Run(chunk_);
+  chunk_ = new TraceLog::RefCountedString;
+  chunk_->data.reserve(kChunkSize + 256);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// TraceBinaryReader
+//
+////////////////////////////////////////////////////////////////////////////////
+
+TraceBinaryReader::TraceBinaryReader()
+    : last_timestamp_(0),
+      failed_(false) {
+}
+
+TraceBinaryReader::~TraceBinaryReader() {
+}
+
+bool TraceBinaryReader::AppendChunkAsJSON(const std::string& chunk,
+                                          std::string* json) {
+  if (failed_)
+    return false;
+
+  std::vector<TraceEvent> events;
+  size_t pos = 0;
+  bool ok = true;
+  while (ok && pos < chunk.size())
+    ok = ReadRecord(chunk, &pos, &events);
+  // The events hold their own copies of these.
+  value_strings_.clear();
+  if (!ok) {
+    failed_ = true;
+    return false;
+  }
+  TraceEvent::AppendEventsAsJSON(events, 0, events.size(), json);
+  return true;
+}
+
+bool TraceBinaryReader::ReadRecord(const std::string& chunk,
+                                   size_t* pos,
+                                   std::vector<TraceEvent>* events) {
+  uint8 tag;
+  if (!ReadByte(chunk, pos, &tag))
+    return false;
+
+  switch (tag) {
+    case kStreamHeader: {
+      const size_t magic_length = arraysize(kMagic) - 1;
+      if (chunk.compare(*pos, magic_length, kMagic) != 0)
+        return false;
+      *pos += magic_length;
+      uint64 version;
+      if (!ReadVarint(chunk, pos, &version) || version != kVersion)
+        return false;
+      // Events already decoded in this chunk own copies of their strings, and
+      // the categories keep theirs.
+      strings_.clear();
+      categories_.clear();
+      last_timestamp_ = 0;
+      return true;
+    }
+
+    case kString: {
+      uint64 id, length;
+      if (!ReadVarint(chunk, pos, &id) || id != strings_.size() ||
+          !ReadVarint(chunk, pos, &length) || length > chunk.size() - *pos)
+        return false;
+      strings_.push_back(chunk.substr(*pos, static_cast<size_t>(length)));
+      categories_.push_back(NULL);
+      *pos += static_cast<size_t>(length);
+      return true;
+    }
+
+    case kEvent: {
+      uint64 pid, tid, category_id;
+      int64 delta;
+      uint8 phase, num_args;
+      const std::string* name;
+      if (!ReadVarint(chunk, pos, &pid) ||
+          !ReadVarint(chunk, pos, &tid) ||
+          !ReadZigZag(chunk, pos, &delta) ||
+          !ReadByte(chunk, pos, &phase) ||
+          phase > TRACE_EVENT_PHASE_METADATA ||
+          !ReadVarint(chunk, pos, &category_id) ||
+          category_id >= strings_.size() ||
+          !ReadString(chunk, pos, &name) ||
+          !ReadByte(chunk, pos, &num_args) ||
+          num_args > kTraceMaxNumArgs)
+        return false;
+
+      const char* arg_names[kTraceMaxNumArgs] = { NULL, NULL };
+      TraceValue arg_values[kTraceMaxNumArgs];
+      for (size_t i = 0; i < num_args; ++i) {
+        const std::string* arg_name;
+        if (!ReadString(chunk, pos, &arg_name) ||
+            !ReadValue(chunk, pos, &arg_values[i]))
+          return false;
+        arg_names[i] = arg_name->c_str();
+      }
+
+      size_t category_index = static_cast<size_t>(category_id);
+      if (!categories_[category_index]) {
+        TraceCategory category = { NULL, false };
+        category_storage_.push_back(category);
+        // Copy the name too; the string table is reset by the next header.
+        category_names_.push_back(strings_[category_index]);
+        category_storage_.back().name = category_names_.back().c_str();
+        categories_[category_index] = &category_storage_.back();
+      }
+
+      last_timestamp_ += delta;
+      // Copying the strings keeps |events| valid across a stream header.
+      events->push_back(TraceEvent(
+          static_cast<unsigned long>(pid),
+          static_cast<unsigned long>(tid),
+          TimeTicks::FromInternalValue(last_timestamp_),
+          static_cast<TraceEventPhase>(phase),
+          categories_[category_index],
+          name->c_str(),
+          arg_names[0], arg_values[0],
+          arg_names[1], arg_values[1],
+          true));
+      return true;
+    }
+
+    default:
+      return false;
+  }
+}
+
+bool TraceBinaryReader::ReadString(const std::string& chunk,
+                                   size_t* pos,
+                                   const std::string** str) {
+  uint64 id;
+  if (!ReadVarint(chunk, pos, &id) || id >= strings_.size())
+    return false;
+  *str = &strings_[static_cast<size_t>(id)];
+  return true;
+}
+
+bool TraceBinaryReader::ReadValue(const std::string& chunk,
+                                  size_t* pos,
+                                  TraceValue* value) {
+  uint8 type;
+  if (!ReadByte(chunk, pos, &type))
+    return false;
+
+  switch (type) {
+    case TraceValue::TRACE_TYPE_BOOL: {
+      uint8 b;
+      if (!ReadByte(chunk, pos, &b))
+        return false;
+      *value = TraceValue(b != 0);
+      return true;
+    }
+    case TraceValue::TRACE_TYPE_UINT: {
+      uint64 u;
+      if (!ReadVarint(chunk, pos, &u))
+        return false;
+      *value = TraceValue(u);
+      return true;
+    }
+    case TraceValue::TRACE_TYPE_INT: {
+      int64 i;
+      if (!ReadZigZag(chunk, pos, &i))
+        return false;
+      *value = TraceValue(i);
+      return true;
+    }
+    case TraceValue::TRACE_TYPE_DOUBLE: {
+      if (chunk.size() - *pos < 8)
+        return false;
+      uint64 bits = 0;
+      for (int i = 0; i < 8; ++i)
+        bits |= static_cast<uint64>(static_cast<uint8>(chunk[*pos + i])) <<
+            (8 * i);
+      *pos += 8;
+      double d;
+      memcpy(&d, &bits, sizeof(d));
+      *value = TraceValue(d);
+      return true;
+    }
+    case TraceValue::TRACE_TYPE_POINTER: {
+      uint64 p;
+      if (!ReadVarint(chunk, pos, &p))
+        return false;
+      *value = TraceValue(
+          reinterpret_cast<const void*>(static_cast<uintptr_t>(p)));
+      return true;
+    }
+    case TraceValue::TRACE_TYPE_STATIC_STRING: {
+      const std::string* str;
+      if (!ReadString(chunk, pos, &str))
+        return false;
+      *value = TraceValue::StringWithCopy(str->c_str());
+      return true;
+    }
+    case TraceValue::TRACE_TYPE_STRING: {
+      uint64 length;
+      if (!ReadVarint(chunk, pos, &length) || length > chunk.size() - *pos)
+        return false;
+      // Kept alive until the TraceEvent built from |value| has copied it.
+      value_strings_.push_back(
+          chunk.substr(*pos, static_cast<size_t>(length)));
+      *pos += static_cast<size_t>(length);
+      *value = TraceValue::StringWithCopy(value_strings_.back().c_str());
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+}  // namespace debug
+}  // namespace base
@@ -0,0 +1,119 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A compact binary encoding of trace events, used by TraceLog::Flush() in
+// TraceLog::OUTPUT_FORMAT_BINARY mode.
+//
+// A stream is a sequence of records, each starting with a one byte tag:
+//   kStreamHeader  "TRCB", version varint. Starts every Flush() and resets
+//                  the string table, so the output of several flushes can be
+//                  concatenated.
+//   kString        id varint, length varint, bytes. Defines the next string
+//                  table entry; ids count up from 0 within a stream.
+//   kEvent         pid varint, tid varint, timestamp delta zigzag varint
+//                  (microseconds since the previous event in the stream),
+//                  phase byte, category string id, name string id, argument
+//                  count byte, then per argument a name string id, a
+//                  TraceValue::Type byte and the value.
+// Categories, event names, argument names and static string values are
+// interned in the string table; copied string values are stored inline.
+//
+// Records are never split across the chunks handed to the output callback,
+// so chunks can be decoded, or written out, one at a time.
+
+#ifndef BASE_DEBUG_TRACE_EVENT_BINARY_H_
+#define BASE_DEBUG_TRACE_EVENT_BINARY_H_
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/debug/trace_event.h"
+#include "base/hash_tables.h"
+#include "base/memory/scoped_ptr.h"
+
+namespace base {
+namespace debug {
+
+// Encodes events into a binary stream handed to |callback| in chunks of
+// roughly kChunkSize bytes.
+class BASE_EXPORT TraceBinaryWriter {
+ public:
+  static const size_t kChunkSize = 64 * 1024;
+
+  explicit TraceBinaryWriter(const TraceLog::OutputCallback& callback);
+  ~TraceBinaryWriter();
+
+  void AddEvent(const TraceEvent& event);
+
+  // Hands any buffered records to the callback. Call once all events have
+  // been added.
+  void Finish();
+
+ private:
+  // Returns the string table id of |str|, defining it first if needed.
+  uint64 InternString(const char* str);
+
+  void AppendVarint(uint64 value);
+  void AppendZigZag(int64 value);
+  void AppendBytes(const char* data, size_t length);
+  void AppendValue(const TraceValue& value);
+
+  void FlushChunk();
+
+  TraceLog::OutputCallback callback_;
+  scoped_refptr<TraceLog::RefCountedString> chunk_;
+  base::hash_map<std::string, uint64> string_ids_;
+  int64 last_timestamp_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceBinaryWriter);
+};
+
+// Decodes a binary stream back into the JSON that TraceLog would have
+// produced in OUTPUT_FORMAT_JSON mode.
+class BASE_EXPORT TraceBinaryReader {
+ public:
+  TraceBinaryReader();
+  ~TraceBinaryReader();
+
+  // Decodes |chunk|, which must be the next chunk of the stream, and appends
+  // its events to |json| as a JSON array. Returns false if the chunk is
+  // malformed; the reader is unusable afterwards.
+  bool AppendChunkAsJSON(const std::string& chunk, std::string* json);
+
+ private:
+  // Reads the next record of |chunk| at |*pos| into |events|.
+  bool ReadRecord(const std::string& chunk, size_t* pos,
+                  std::vector<TraceEvent>* events);
+
+  bool ReadString(const std::string& chunk, size_t* pos,
+                  const std::string** str);
+  bool ReadValue(const std::string& chunk, size_t* pos, TraceValue* value);
+
+  // The string table, indexed by id. A deque so that the decoded events can
+  // point into it.
+  std::deque<std::string> strings_;
+  // The categories created for the decoded events, parallel to |strings_|
+  // (NULL for strings that are not category names). The categories and their
+  // names outlive the string table, which is reset by each stream header.
+  std::vector<const TraceCategory*> categories_;
+  std::deque<TraceCategory> category_storage_;
+  std::deque<std::string> category_names_;
+
+  // Copied string argument values of the chunk being decoded.
+  std::deque<std::string> value_strings_;
+
+  int64 last_timestamp_;
+  bool failed_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceBinaryReader);
+};
+
+}  // namespace debug
+}  // namespace base
+
+#endif  // BASE_DEBUG_TRACE_EVENT_BINARY_H_
@@ -25,10 +25,102 @@ const GUID kTraceEventClass32 = {
 const GUID kTraceEventClass64 = {
     0x97be602d, 0x2930, 0x4ac3, 0x80, 0x46, 0xb6, 0x76, 0x3b, 0x63, 0x1d, 0xfe};
 
+// {A3778307-46E5-4822-80FD-3648E13C178F}
+const GUID kChromeTraceManifestProviderName = {
+    0xa3778307, 0x46e5, 0x4822, 0x80, 0xfd, 0x36, 0x48, 0xe1, 0x3c, 0x17, 0x8f};
+
+namespace {
+
+// The manifest-based ETW functions, which advapi32 only has on Vista and
+// later.
+typedef ULONG (WINAPI *EventRegisterFunc)(LPCGUID provider_id,
+                                          PENABLECALLBACK enable_callback,
+                                          PVOID context,
+                                          PREGHANDLE handle);
+typedef ULONG (WINAPI *EventUnregisterFunc)(REGHANDLE handle);
+typedef ULONG (WINAPI *EventWriteTransferFunc)(
+    REGHANDLE handle,
+    PCEVENT_DESCRIPTOR descriptor,
+    LPCGUID activity_id,
+    LPCGUID related_activity_id,
+    ULONG data_count,
+    PEVENT_DATA_DESCRIPTOR data);
+
+EventRegisterFunc g_event_register = NULL;
+EventUnregisterFunc g_event_unregister = NULL;
+EventWriteTransferFunc g_event_write_transfer = NULL;
+
+// The descriptors of the manifest-based events: id, version, channel, level,
+// opcode, task and keyword.
+const EVENT_DESCRIPTOR kBeginEventDescriptor = {
+    kTraceEventIdBegin, 0, 0, TRACE_LEVEL_INFORMATION,
+    WINEVENT_OPCODE_START, 0, KEYWORD_TRACE_EVENTS };
+const EVENT_DESCRIPTOR kEndEventDescriptor = {
+    kTraceEventIdEnd, 0, 0, TRACE_LEVEL_INFORMATION,
+    WINEVENT_OPCODE_STOP, 0, KEYWORD_TRACE_EVENTS };
+const EVENT_DESCRIPTOR kInstantEventDescriptor = {
+    kTraceEventIdInstant, 0, 0, TRACE_LEVEL_INFORMATION,
+    WINEVENT_OPCODE_INFO, 0, KEYWORD_TRACE_EVENTS };
+
+bool LoadManifestFunctions() {
+  HMODULE advapi32 = ::GetModuleHandle(L"advapi32.dll");
+  if (!advapi32)
+    return false;
+  g_event_register = reinterpret_cast<EventRegisterFunc>(
+      ::GetProcAddress(advapi32, "EventRegister"));
+  g_event_unregister = reinterpret_cast<EventUnregisterFunc>(
+      ::GetProcAddress(advapi32, "EventUnregister"));
+  g_event_write_transfer = reinterpret_cast<EventWriteTransferFunc>(
+      ::GetProcAddress(advapi32, "EventWriteTransfer"));
+  return g_event_register && g_event_unregister && g_event_write_transfer;
+}
+
+}  // namespace
 
 TraceEventETWProvider::TraceEventETWProvider() :
-    EtwTraceProvider(kChromeTraceProviderName) {
+    EtwTraceProvider(kChromeTraceProviderName),
+    manifest_handle_(0),
+    manifest_state_(0) {
   Register();
+  if (LoadManifestFunctions() &&
+      g_event_register(&kChromeTraceManifestProviderName,
+                       &ManifestEnableCallback,
+                       this,
+                       &manifest_handle_) != ERROR_SUCCESS) {
+    manifest_handle_ = 0;
+  }
+}
+
+TraceEventETWProvider::~TraceEventETWProvider() {
+  if (manifest_handle_ != 0)
+    g_event_unregister(manifest_handle_);
+}
+
+// static
+void NTAPI TraceEventETWProvider::ManifestEnableCallback(
+    LPCGUID source_id,
+    ULONG is_enabled,
+    UCHAR level,
+    ULONGLONG match_any_keyword,
+    ULONGLONG match_all_keyword,
+    PEVENT_FILTER_DESCRIPTOR filter_data,
+    PVOID context) {
+  TraceEventETWProvider* provider =
+      reinterpret_cast<TraceEventETWProvider*>(context);
+  // EVENT_CONTROL_CODE_CAPTURE_STATE asks for a rundown, which we don't have.
+  if (is_enabled == EVENT_CONTROL_CODE_CAPTURE_STATE)
+    return;
+
+  subtle::Atomic32 state = 0;
+  if (is_enabled == EVENT_CONTROL_CODE_ENABLE_PROVIDER &&
+      (level == 0 || level >= TRACE_LEVEL_INFORMATION) &&
+      (match_any_keyword == 0 ||
+       (match_any_keyword & KEYWORD_TRACE_EVENTS) != 0)) {
+    state = MANIFEST_EVENTS;
+    if (match_any_keyword & KEYWORD_STACK_TRACE)
+      state |= MANIFEST_STACK_TRACES;
+  }
+  subtle::NoBarrier_Store(&provider->manifest_state_, state);
 }
 
 TraceEventETWProvider* TraceEventETWProvider::GetInstance() {
@@ -94,6 +186,59 @@ void TraceEventETWProvider::TraceEvent(const char* name,
   Log(event.get());
 }
 
+void TraceEventETWProvider::TraceManifestEvent(const char* name,
+                                               size_t name_len,
+                                               TraceEventPhase type,
+                                               const void* id,
+                                               const char* extra,
+                                               size_t extra_len) {
+  // Make sure we don't touch NULL.
+  if (name == NULL)
+    name = "";
+  if (extra == NULL)
+    extra = "";
+
+  const EVENT_DESCRIPTOR* descriptor = NULL;
+  switch (type) {
+    case TRACE_EVENT_PHASE_BEGIN:
+      descriptor = &kBeginEventDescriptor;
+      break;
+    case TRACE_EVENT_PHASE_END:
+      descriptor = &kEndEventDescriptor;
+      break;
+
+    case TRACE_EVENT_PHASE_INSTANT:
+      descriptor = &kInstantEventDescriptor;
+      break;
+
+    default:
+      NOTREACHED() << "Unknown event type";
+      descriptor = &kInstantEventDescriptor;
+      break;
+  }
+
+  // The descriptors point straight at the strings, with their terminating
+  // NUL, as the MOF event's fields do.
+  EVENT_DATA_DESCRIPTOR data[5];
+  ULONG data_count = 3;
+  EventDataDescCreate(&data[0], name, static_cast<ULONG>(name_len + 1));
+  EventDataDescCreate(&data[1], &id, sizeof(id));
+  EventDataDescCreate(&data[2], extra, static_cast<ULONG>(extra_len + 1));
+
+  void* backtrace[32];
+  DWORD depth = 0;
+  if (subtle::NoBarrier_Load(&manifest_state_) & MANIFEST_STACK_TRACES) {
+    DWORD hash = 0;
+    depth = CaptureStackBackTrace(0, arraysize(backtrace), backtrace, &hash);
+    EventDataDescCreate(&data[3], &depth, sizeof(depth));
+    EventDataDescCreate(&data[4], backtrace, sizeof(backtrace[0]) * depth);
+    data_count = 5;
+  }
+
+  g_event_write_transfer(manifest_handle_, descriptor, NULL, NULL,
+                         data_count, data);
+}
+
 void TraceEventETWProvider::Trace(const char* name,
                                   size_t name_len,
                                   TraceEventPhase type,
@@ -101,15 +246,23 @@ void TraceEventETWProvider::Trace(const char* name,
                                   const char* extra,
                                   size_t extra_len) {
   TraceEventETWProvider* provider = TraceEventETWProvider::GetInstance();
-  if (provider && provider->IsTracing()) {
-    // Compute the name & extra lengths if not supplied already.
-    if (name_len == -1)
-      name_len = (name == NULL) ? 0 : strlen(name);
-    if (extra_len == -1)
-      extra_len = (extra == NULL) ? 0 : strlen(extra);
+  if (!provider)
+    return;
+  bool manifest_tracing = provider->IsManifestTracing();
+  bool mof_tracing = provider->IsTracing();
+  if (!manifest_tracing && !mof_tracing)
+    return;
 
+  // Compute the name & extra lengths if not supplied already.
+  if (name_len == -1)
+    name_len = (name == NULL) ? 0 : strlen(name);
+  if (extra_len == -1)
+    extra_len = (extra == NULL) ? 0 : strlen(extra);
+
+  if (manifest_tracing)
+    provider->TraceManifestEvent(name, name_len, type, id, extra, extra_len);
+  if (mof_tracing)
     provider->TraceEvent(name, name_len, type, id, extra, extra_len);
-  }
 }
 
 void TraceEventETWProvider::Resurrect() {
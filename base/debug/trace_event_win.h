@@ -7,8 +7,10 @@
 #define BASE_DEBUG_TRACE_EVENT_WIN_H_
 #pragma once
 
+#include <evntprov.h>
 #include <string>
 
+#include "base/atomicops.h"
 #include "base/base_export.h"
 #include "base/debug/trace_event.h"
 #include "base/win/event_trace_provider.h"
@@ -22,6 +24,14 @@ namespace debug {
 
 // This EtwTraceProvider subclass implements ETW logging
 // for the macros above on Windows.
+//
+// Where the OS has manifest-based ETW (Vista and later), the events are also
+// written as manifest-based events of kChromeTraceManifestProviderName, which
+// xperf and WPA trace with level and keyword filtering (see
+// TraceEventKeywords). Those are written with EventWriteTransfer() straight
+// from the strings, without the header and memset of a MOF event. The enable
+// callback sums up the sessions' level and keywords in one flag, so the
+// disabled path is a load of it and of the MOF level.
 class BASE_EXPORT TraceEventETWProvider : public base::win::EtwTraceProvider {
  public:
   // Start logging trace events.
@@ -63,11 +73,16 @@ class BASE_EXPORT TraceEventETWProvider : public base::win::EtwTraceProvider {
   // Note that this may return NULL post-AtExit processing.
   static TraceEventETWProvider* GetInstance();
 
-  // Returns true iff tracing is turned on.
+  // Returns true iff tracing of the MOF events is turned on.
   bool IsTracing() {
     return enable_level() >= TRACE_LEVEL_INFORMATION;
   }
 
+  // Returns true iff a session traces the manifest-based events.
+  bool IsManifestTracing() {
+    return subtle::NoBarrier_Load(&manifest_state_) != 0;
+  }
+
   // Emit a trace of type |type| containing |name|, |id|, and |extra|.
   // Note: |name| and |extra| must be NULL, or a zero-terminated string of
   //    length |name_len| or |extra_len| respectively.
@@ -80,14 +95,46 @@ class BASE_EXPORT TraceEventETWProvider : public base::win::EtwTraceProvider {
                   const char* extra,
                   size_t extra_len);
 
+  // Emits the manifest-based event of type |type|, with the same payload as
+  // TraceEvent(), to the sessions tracing kChromeTraceManifestProviderName.
+  void TraceManifestEvent(const char* name,
+                          size_t name_len,
+                          TraceEventPhase type,
+                          const void* id,
+                          const char* extra,
+                          size_t extra_len);
+
   // Exposed for unittesting only, allows resurrecting our
   // singleton instance post-AtExit processing.
   static void Resurrect();
 
  private:
+  // The bits of |manifest_state_|.
+  enum ManifestState {
+    MANIFEST_EVENTS = 0x1,
+    MANIFEST_STACK_TRACES = 0x2,
+  };
+
   // Ensure only the provider can construct us.
   friend struct StaticMemorySingletonTraits<TraceEventETWProvider>;
   TraceEventETWProvider();
+  virtual ~TraceEventETWProvider();
+
+  // Updates |manifest_state_| from the sessions enabling the manifest-based
+  // provider, on ETW's thread.
+  static void NTAPI ManifestEnableCallback(
+      LPCGUID source_id,
+      ULONG is_enabled,
+      UCHAR level,
+      ULONGLONG match_any_keyword,
+      ULONGLONG match_all_keyword,
+      PEVENT_FILTER_DESCRIPTOR filter_data,
+      PVOID context);
+
+  // The registration of the manifest-based provider, 0 if the OS doesn't
+  // have it, and whether its events, and their stacks, are traced.
+  REGHANDLE manifest_handle_;
+  subtle::Atomic32 manifest_state_;
 
   DISALLOW_COPY_AND_ASSIGN(TraceEventETWProvider);
 };
@@ -95,6 +142,9 @@ class BASE_EXPORT TraceEventETWProvider : public base::win::EtwTraceProvider {
 // The ETW trace provider GUID.
 BASE_EXPORT extern const GUID kChromeTraceProviderName;
 
+// The manifest-based ETW trace provider GUID.
+BASE_EXPORT extern const GUID kChromeTraceManifestProviderName;
+
 // The ETW event class GUID for 32 bit events.
 BASE_EXPORT extern const GUID kTraceEventClass32;
 
@@ -111,12 +161,27 @@ enum TraceEventFlags {
   CAPTURE_STACK_TRACE = 0x0001,
 };
 
+// The keywords of the manifest-based provider. A session enabling it with no
+// keyword gets the events, without their stacks.
+enum TraceEventKeywords {
+  KEYWORD_TRACE_EVENTS = 0x0001,
+  KEYWORD_STACK_TRACE = 0x0002,
+};
+
+// The IDs of the manifest-based events, whose opcodes are the start, stop
+// and info ones, so that xperf pairs up the begin and end events.
+const USHORT kTraceEventIdBegin = 1;
+const USHORT kTraceEventIdEnd = 2;
+const USHORT kTraceEventIdInstant = 3;
+
 // The event format consists of:
 // The "name" string as a zero-terminated ASCII string.
 // The id pointer in the machine bitness.
 // The "extra" string as a zero-terminated ASCII string.
 // Optionally the stack trace, consisting of a DWORD "depth", followed
 //    by an array of void* (machine bitness) of length "depth".
+// The manifest-based events have the same format, the stack trace being
+// there when a session enables KEYWORD_STACK_TRACE.
 
 // Forward decl.
 struct TraceLogSingletonTraits;
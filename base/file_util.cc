@@ -6,6 +6,10 @@
 
 #if defined(OS_WIN)
 #include <io.h>
+#include <windows.h>
+#elif defined(OS_POSIX)
+#include <sys/mman.h>
+#include <unistd.h>
 #endif
 #include <stdio.h>
 
@@ -307,10 +311,20 @@ MemoryMappedFile::~MemoryMappedFile() {
 }
 
 bool MemoryMappedFile::Initialize(const FilePath& file_name) {
+  return Initialize(file_name, 0, 0, READ_ONLY);
+}
+
+bool MemoryMappedFile::Initialize(base::PlatformFile file) {
+  return Initialize(file, 0, 0, READ_ONLY);
+}
+
+bool MemoryMappedFile::Initialize(const FilePath& file_name, int64 offset,
+                                  size_t size, Access access) {
   if (IsValid())
     return false;
 
-  if (!MapFileToMemory(file_name)) {
+  access_ = access;
+  if (!MapFileToMemory(file_name, offset, size)) {
     CloseHandles();
     return false;
   }
@@ -318,13 +332,15 @@ bool MemoryMappedFile::Initialize(const FilePath& file_name) {
   return true;
 }
 
-bool MemoryMappedFile::Initialize(base::PlatformFile file) {
+bool MemoryMappedFile::Initialize(base::PlatformFile file, int64 offset,
+                                  size_t size, Access access) {
   if (IsValid())
     return false;
 
   file_ = file;
+  access_ = access;
 
-  if (!MapFileToMemoryInternal()) {
+  if (!MapFileToMemoryInternal(offset, size)) {
     CloseHandles();
     return false;
   }
@@ -336,17 +352,49 @@ bool MemoryMappedFile::IsValid() const {
   return data_ != NULL;
 }
 
-bool MemoryMappedFile::MapFileToMemory(const FilePath& file_name) {
-  file_ = base::CreatePlatformFile(
-      file_name, base::PLATFORM_FILE_OPEN | base::PLATFORM_FILE_READ,
-      NULL, NULL);
+void MemoryMappedFile::Prefetch(size_t offset, size_t length) const {
+  DCHECK(IsValid());
+  DCHECK_LE(offset, length_);
+  DCHECK_LE(length, length_ - offset);
+  if (!length)
+    return;
+  uint8* start = data_ + offset;
+#if defined(OS_WIN)
+  struct MemoryRangeEntry {
+    PVOID virtual_address;
+    SIZE_T number_of_bytes;
+  };
+  typedef BOOL (WINAPI* PrefetchVirtualMemoryFunction)(
+      HANDLE process, ULONG_PTR number_of_entries,
+      MemoryRangeEntry* virtual_addresses, ULONG flags);
+  static PrefetchVirtualMemoryFunction prefetch_virtual_memory =
+      reinterpret_cast<PrefetchVirtualMemoryFunction>(GetProcAddress(
+          GetModuleHandle(L"kernel32.dll"), "PrefetchVirtualMemory"));
+  if (!prefetch_virtual_memory)
+    return;
+  MemoryRangeEntry range = { start, static_cast<SIZE_T>(length) };
+  prefetch_virtual_memory(GetCurrentProcess(), 1, &range, 0);
+#elif defined(OS_POSIX)
+  uintptr_t page_size = sysconf(_SC_PAGESIZE);
+  uintptr_t begin = reinterpret_cast<uintptr_t>(start) & ~(page_size - 1);
+  uintptr_t end = reinterpret_cast<uintptr_t>(start) + length;
+  madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+#endif
+}
+
+bool MemoryMappedFile::MapFileToMemory(const FilePath& file_name,
+                                       int64 offset, size_t size) {
+  int flags = base::PLATFORM_FILE_OPEN | base::PLATFORM_FILE_READ;
+  if (access_ == READ_WRITE)
+    flags |= base::PLATFORM_FILE_WRITE;
+  file_ = base::CreatePlatformFile(file_name, flags, NULL, NULL);
 
   if (file_ == base::kInvalidPlatformFileValue) {
     LOG(ERROR) << "Couldn't open " << file_name.value();
     return false;
   }
 
-  return MapFileToMemoryInternal();
+  return MapFileToMemoryInternal(offset, size);
 }
 
 // Deprecated functions ----------------------------------------------------
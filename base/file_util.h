@@ -26,6 +26,7 @@
 
 #include "base/base_export.h"
 #include "base/basictypes.h"
+#include "base/callback.h"
 #include "base/file_path.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/platform_file.h"
@@ -127,6 +128,24 @@ BASE_EXPORT bool ReplaceFile(const FilePath& from_path,
 // Copies a single file. Use CopyDirectory to copy directories.
 BASE_EXPORT bool CopyFile(const FilePath& from_path, const FilePath& to_path);
 
+#if defined(OS_WIN)
+// Told the number of bytes copied so far and the size of the file by
+// CopyLargeFile(). Returning false cancels the copy.
+typedef base::Callback<bool(int64, int64)> CopyProgressCallback;
+
+// Copies a single file, as CopyFile does, for files large enough that the
+// cache of the system gets in the way: the file is copied without buffering,
+// in large chunks, with several reads and writes outstanding so that reading
+// the next chunks overlaps with writing those read. |progress|, which may be
+// null, is run on this thread after each chunk is written. The copy has the
+// attributes and the modification time of |from_path|. If the copy fails or
+// is cancelled, the partial |to_path| is deleted. Falls back to CopyFile()
+// where the file can't be opened unbuffered.
+BASE_EXPORT bool CopyLargeFile(const FilePath& from_path,
+                               const FilePath& to_path,
+                               const CopyProgressCallback& progress);
+#endif  // OS_WIN
+
 // Copies the given path, and optionally all subdirectories and their contents
 // as well.
 // If there are files existing under to_path, always overwrite.
@@ -536,8 +555,42 @@ class BASE_EXPORT FileEnumerator {
   DISALLOW_COPY_AND_ASSIGN(FileEnumerator);
 };
 
+#if defined(OS_WIN)
+// Receives a file or directory found by EnumerateFilesInParallel(): its path
+// and what FindFirstFileEx() returned for it. May be run on several threads
+// at once.
+typedef base::Callback<void(const FilePath&, const FileEnumerator::FindInfo&)>
+    ParallelFileEnumeratorCallback;
+
+// Enumerates the files and directories under |root_path| recursively, as a
+// recursive FileEnumerator of |file_type| does, and runs |callback| for each
+// of them as it is found rather than collecting them. The subdirectories are
+// read in parallel on the slow threads of base::WorkerPool, so the entries
+// come in no particular order. The finds fetch large batches and skip the
+// short names, which are left empty in the FindInfos. Returns once all of
+// them have been enumerated and the callbacks have returned.
+//
+// Must not be called on a WorkerPool thread, which it blocks.
+BASE_EXPORT void EnumerateFilesInParallel(
+    const FilePath& root_path,
+    FileEnumerator::FileType file_type,
+    const ParallelFileEnumeratorCallback& callback);
+#endif  // OS_WIN
+
 class BASE_EXPORT MemoryMappedFile {
  public:
+  // How the view of the file may be accessed.
+  enum Access {
+    // The view is read only.
+    READ_ONLY,
+    // The view can be written to, and the writes go to the file, which is
+    // opened for writing.
+    READ_WRITE,
+    // The view can be written to, but the writes stay in the pages of the
+    // process, the file is left as it is.
+    READ_COPY_ON_WRITE,
+  };
+
   // The default constructor sets all members to invalid/null values.
   MemoryMappedFile();
   ~MemoryMappedFile();
@@ -546,12 +599,20 @@ class BASE_EXPORT MemoryMappedFile {
   // read only. If this object already points to a valid memory mapped file
   // then this method will fail and return false. If it cannot open the file,
   // the file does not exist, or the memory mapping fails, it will return false.
-  // Later we may want to allow the user to specify access.
   bool Initialize(const FilePath& file_name);
   // As above, but works with an already-opened file. MemoryMappedFile will take
   // ownership of |file| and close it when done.
   bool Initialize(base::PlatformFile file);
 
+  // As above, but maps only the |size| bytes of the file from |offset|, or
+  // all those from |offset| on if |size| is 0, with |access|. The range must
+  // be within the file; |offset| needn't be aligned to anything. A file given
+  // for READ_WRITE must have been opened for writing.
+  bool Initialize(const FilePath& file_name, int64 offset, size_t size,
+                  Access access);
+  bool Initialize(base::PlatformFile file, int64 offset, size_t size,
+                  Access access);
+
 #if defined(OS_WIN)
   // Opens an existing file and maps it as an image section. Please refer to
   // the Initialize function above for additional information.
@@ -561,16 +622,31 @@ class BASE_EXPORT MemoryMappedFile {
   const uint8* data() const { return data_; }
   size_t length() const { return length_; }
 
+  // The view, to write to. NULL if it was mapped READ_ONLY.
+  uint8* writable_data() { return access_ == READ_ONLY ? NULL : data_; }
+
   // Is file_ a valid file handle that points to an open, memory mapped file?
   bool IsValid() const;
 
+  // Asks the OS to read the |length| bytes of the view from |offset| ahead of
+  // their use, without waiting for them. This is only a hint: before Windows
+  // 8, which has PrefetchVirtualMemory(), the pages are read as they are
+  // touched.
+  void Prefetch(size_t offset, size_t length) const;
+
+  // Starts writing the pages of a READ_WRITE view that were written to back
+  // to the file. Returns false if that couldn't be started. Does nothing for
+  // the other views.
+  bool Flush();
+
  private:
   // Open the given file and pass it to MapFileToMemoryInternal().
-  bool MapFileToMemory(const FilePath& file_name);
+  bool MapFileToMemory(const FilePath& file_name, int64 offset, size_t size);
 
-  // Map the file to memory, set data_ to that memory address. Return true on
-  // success, false on any kind of failure. This is a helper for Initialize().
-  bool MapFileToMemoryInternal();
+  // Map |size| bytes of the file from |offset| to memory, with access_, and
+  // set data_ to that memory address. Return true on success, false on any
+  // kind of failure. This is a helper for Initialize().
+  bool MapFileToMemoryInternal(int64 offset, size_t size);
 
   // Closes all open handles. Later we may want to make this public.
   void CloseHandles();
@@ -578,13 +654,17 @@ class BASE_EXPORT MemoryMappedFile {
 #if defined(OS_WIN)
   // MapFileToMemoryInternal calls this function. It provides the ability to
   // pass in flags which control the mapped section.
-  bool MapFileToMemoryInternalEx(int flags);
+  bool MapFileToMemoryInternalEx(int flags, int64 offset, size_t size);
 
   HANDLE file_mapping_;
 #endif
   base::PlatformFile file_;
+  // The start of the mapping, which is aligned down from data_ to what the
+  // OS maps from.
+  uint8* view_;
   uint8* data_;
   size_t length_;
+  Access access_;
 
   DISALLOW_COPY_AND_ASSIGN(MemoryMappedFile);
 };
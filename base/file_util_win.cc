@@ -14,12 +14,16 @@
 #include <limits>
 #include <string>
 
+#include "base/bind.h"
 #include "base/file_path.h"
 #include "base/logging.h"
+#include "base/memory/ref_counted.h"
 #include "base/metrics/histogram.h"
 #include "base/string_number_conversions.h"
 #include "base/string_util.h"
+#include "base/synchronization/waitable_event.h"
 #include "base/threading/thread_restrictions.h"
+#include "base/threading/worker_pool.h"
 #include "base/time.h"
 #include "base/utf_string_conversions.h"
 #include "base/win/pe_image.h"
@@ -245,6 +249,185 @@ bool CopyFile(const FilePath& from_path, const FilePath& to_path) {
                      false) != 0);
 }
 
+namespace {
+
+// CopyLargeFile() reads and writes chunks of kCopyChunkSize bytes, and has
+// kCopyChunkCount of them in flight. Unbuffered writes must be of a multiple
+// of the sector size, so the last chunk is written up to a multiple of
+// kCopyChunkAlignment, which is at least any sector size, and the copy is
+// truncated after.
+const DWORD kCopyChunkSize = 1024 * 1024;
+const int kCopyChunkCount = 4;
+const DWORD kCopyChunkAlignment = 64 * 1024;
+
+// A chunk of CopyLargeFile(), which is read into its buffer, then written from
+// it, and then reused for a chunk further in the file.
+struct CopyChunk {
+  enum State {
+    IDLE,
+    READING,
+    WRITING,
+  };
+
+  CopyChunk() : buffer(NULL), state(IDLE), offset(0), size(0) {
+    memset(&overlapped, 0, sizeof(overlapped));
+  }
+
+  ~CopyChunk() {
+    if (buffer)
+      ::VirtualFree(buffer, 0, MEM_RELEASE);
+  }
+
+  // Page aligned, as unbuffered IO requires.
+  char* buffer;
+  OVERLAPPED overlapped;
+  base::win::ScopedHandle event;
+  State state;
+  // Where the chunk is in the file, and the number of bytes read.
+  int64 offset;
+  DWORD size;
+};
+
+// Starts reading |size| bytes at the offset of |chunk| into its buffer if
+// |is_read|, or writing them from it.
+bool StartCopyChunkIO(HANDLE file, CopyChunk* chunk, DWORD size,
+                      bool is_read) {
+  memset(&chunk->overlapped, 0, sizeof(chunk->overlapped));
+  chunk->overlapped.Offset = static_cast<DWORD>(chunk->offset);
+  chunk->overlapped.OffsetHigh = static_cast<DWORD>(chunk->offset >> 32);
+  chunk->overlapped.hEvent = chunk->event.Get();
+  BOOL done = is_read ?
+      ::ReadFile(file, chunk->buffer, size, NULL, &chunk->overlapped) :
+      ::WriteFile(file, chunk->buffer, size, NULL, &chunk->overlapped);
+  return done || ::GetLastError() == ERROR_IO_PENDING;
+}
+
+// Copies the |file_size| bytes of |from| to |to|, which are opened for
+// overlapped, unbuffered IO. Returns false if that failed or was cancelled.
+bool CopyChunks(HANDLE from, HANDLE to, int64 file_size,
+                const CopyProgressCallback& progress) {
+  CopyChunk chunks[kCopyChunkCount];
+  for (int i = 0; i < kCopyChunkCount; ++i) {
+    chunks[i].buffer = static_cast<char*>(::VirtualAlloc(
+        NULL, kCopyChunkSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+    chunks[i].event.Set(::CreateEvent(NULL, TRUE, FALSE, NULL));
+    if (!chunks[i].buffer || !chunks[i].event.IsValid())
+      return false;
+  }
+
+  bool success = true;
+  int64 next_offset = 0;
+  int64 copied = 0;
+  int active_chunks = 0;
+  for (int i = 0; i < kCopyChunkCount && next_offset < file_size; ++i) {
+    chunks[i].offset = next_offset;
+    next_offset += kCopyChunkSize;
+    if (!StartCopyChunkIO(from, &chunks[i], kCopyChunkSize, true)) {
+      success = false;
+      break;
+    }
+    chunks[i].state = CopyChunk::READING;
+    ++active_chunks;
+  }
+
+  // The chunks are waited for in turn, and each one is written once read and
+  // read again once written, so the file is read ahead of the writes. Once
+  // something fails the chunks in flight are only waited for.
+  for (int i = 0; active_chunks > 0; i = (i + 1) % kCopyChunkCount) {
+    CopyChunk& chunk = chunks[i];
+    if (chunk.state == CopyChunk::IDLE)
+      continue;
+
+    DWORD bytes = 0;
+    HANDLE file = chunk.state == CopyChunk::READING ? from : to;
+    if (!::GetOverlappedResult(file, &chunk.overlapped, &bytes, TRUE))
+      success = false;
+
+    if (success && chunk.state == CopyChunk::READING) {
+      // Only the last chunk is short, and its end is padded with zeros up
+      // to the size it is written with.
+      chunk.size = bytes;
+      DWORD write_size = (bytes + kCopyChunkAlignment - 1) &
+          ~(kCopyChunkAlignment - 1);
+      memset(chunk.buffer + bytes, 0, write_size - bytes);
+      if (bytes > 0 && StartCopyChunkIO(to, &chunk, write_size, false)) {
+        chunk.state = CopyChunk::WRITING;
+        continue;
+      }
+      success = false;
+    } else if (success) {
+      copied += chunk.size;
+      if (!progress.is_null() && !progress.Run(copied, file_size)) {
+        success = false;
+      } else if (next_offset < file_size) {
+        chunk.offset = next_offset;
+        next_offset += kCopyChunkSize;
+        if (StartCopyChunkIO(from, &chunk, kCopyChunkSize, true)) {
+          chunk.state = CopyChunk::READING;
+          continue;
+        }
+        success = false;
+      }
+    }
+    chunk.state = CopyChunk::IDLE;
+    --active_chunks;
+  }
+  return success;
+}
+
+}  // namespace
+
+bool CopyLargeFile(const FilePath& from_path, const FilePath& to_path,
+                   const CopyProgressCallback& progress) {
+  base::ThreadRestrictions::AssertIOAllowed();
+
+  if (from_path.value().length() >= MAX_PATH ||
+      to_path.value().length() >= MAX_PATH) {
+    return false;
+  }
+
+  base::win::ScopedHandle from(::CreateFile(
+      from_path.value().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+      OPEN_EXISTING,
+      FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED |
+          FILE_FLAG_SEQUENTIAL_SCAN,
+      NULL));
+  if (!from.IsValid())
+    return CopyFile(from_path, to_path);
+  BY_HANDLE_FILE_INFORMATION info;
+  if (!::GetFileInformationByHandle(from, &info))
+    return false;
+  ULARGE_INTEGER file_size;
+  file_size.HighPart = info.nFileSizeHigh;
+  file_size.LowPart = info.nFileSizeLow;
+
+  base::win::ScopedHandle to(::CreateFile(
+      to_path.value().c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+      FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED, NULL));
+  if (!to.IsValid()) {
+    from.Close();
+    return CopyFile(from_path, to_path);
+  }
+
+  bool success = CopyChunks(from, to, static_cast<int64>(file_size.QuadPart),
+                            progress);
+  if (success) {
+    // Drops the padding of the last chunk.
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(file_size.QuadPart);
+    success = ::SetFilePointerEx(to, end, NULL, FILE_BEGIN) &&
+              ::SetEndOfFile(to) &&
+              ::SetFileTime(to, NULL, NULL, &info.ftLastWriteTime);
+  }
+  to.Close();
+  if (!success) {
+    ::DeleteFile(to_path.value().c_str());
+    return false;
+  }
+  ::SetFileAttributes(to_path.value().c_str(), info.dwFileAttributes);
+  return true;
+}
+
 bool ShellCopy(const FilePath& from_path, const FilePath& to_path,
                bool recursive) {
   base::ThreadRestrictions::AssertIOAllowed();
@@ -949,14 +1132,115 @@ FilePath FileEnumerator::Next() {
   return FilePath();
 }
 
+namespace {
+
+// The state of an EnumerateFilesInParallel(), which the tasks reading its
+// directories share.
+class ParallelEnumeration
+    : public base::RefCountedThreadSafe<ParallelEnumeration> {
+ public:
+  ParallelEnumeration(FileEnumerator::FileType file_type,
+                      const ParallelFileEnumeratorCallback& callback)
+      : file_type_(file_type),
+        callback_(callback),
+        pending_directories_(0),
+        done_(true, false) {
+    // FindExInfoBasic and FIND_FIRST_EX_LARGE_FETCH are Windows 7 and later.
+    if (base::win::GetVersion() >= base::win::VERSION_WIN7) {
+      info_level_ = FindExInfoBasic;
+      find_flags_ = FIND_FIRST_EX_LARGE_FETCH;
+    } else {
+      info_level_ = FindExInfoStandard;
+      find_flags_ = 0;
+    }
+  }
+
+  // Reads |directory| on a worker thread.
+  void PostDirectory(const FilePath& directory) {
+    base::subtle::NoBarrier_AtomicIncrement(&pending_directories_, 1);
+    if (!base::WorkerPool::PostTask(
+            FROM_HERE,
+            base::Bind(&ParallelEnumeration::EnumerateDirectory, this,
+                       directory),
+            true)) {
+      EnumerateDirectory(directory);
+    }
+  }
+
+  void WaitUntilDone() { done_.Wait(); }
+
+ private:
+  friend class base::RefCountedThreadSafe<ParallelEnumeration>;
+
+  ~ParallelEnumeration() {}
+
+  void EnumerateDirectory(const FilePath& directory) {
+    base::ThreadRestrictions::AssertIOAllowed();
+    WIN32_FIND_DATA find_data;
+    HANDLE find_handle = FindFirstFileEx(
+        directory.Append(L"*").value().c_str(), info_level_, &find_data,
+        FindExSearchNameMatch, NULL, find_flags_);
+    if (find_handle != INVALID_HANDLE_VALUE) {
+      do {
+        FilePath name(find_data.cFileName);
+        if (name.value() == L"." || name.value() == L"..")
+          continue;
+        FilePath path = directory.Append(name);
+        if (FileEnumerator::IsDirectory(find_data)) {
+          // Its subdirectory is counted before this directory is done, so
+          // the count drops to 0 only once all of them are.
+          PostDirectory(path);
+          if (file_type_ & FileEnumerator::DIRECTORIES)
+            callback_.Run(path, find_data);
+        } else if (file_type_ & FileEnumerator::FILES) {
+          callback_.Run(path, find_data);
+        }
+      } while (FindNextFile(find_handle, &find_data));
+      FindClose(find_handle);
+    }
+
+    if (base::subtle::Barrier_AtomicIncrement(&pending_directories_, -1) == 0)
+      done_.Signal();
+  }
+
+  const FileEnumerator::FileType file_type_;
+  const ParallelFileEnumeratorCallback callback_;
+  FINDEX_INFO_LEVELS info_level_;
+  DWORD find_flags_;
+
+  // The directories posted that haven't been read yet.
+  volatile base::subtle::Atomic32 pending_directories_;
+
+  // Signaled once all the directories have been read.
+  base::WaitableEvent done_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelEnumeration);
+};
+
+}  // namespace
+
+void EnumerateFilesInParallel(const FilePath& root_path,
+                              FileEnumerator::FileType file_type,
+                              const ParallelFileEnumeratorCallback& callback) {
+  DCHECK(!base::WorkerPool::RunsTasksOnCurrentThread());
+  DCHECK(!(file_type & FileEnumerator::INCLUDE_DOT_DOT));
+  // The thread waits for the workers, which do the IO.
+  scoped_refptr<ParallelEnumeration> enumeration(
+      new ParallelEnumeration(file_type, callback));
+  enumeration->PostDirectory(root_path);
+  enumeration->WaitUntilDone();
+}
+
 ///////////////////////////////////////////////
 // MemoryMappedFile
 
 MemoryMappedFile::MemoryMappedFile()
     : file_(INVALID_HANDLE_VALUE),
       file_mapping_(INVALID_HANDLE_VALUE),
+      view_(NULL),
       data_(NULL),
-      length_(INVALID_FILE_SIZE) {
+      length_(INVALID_FILE_SIZE),
+      access_(READ_ONLY) {
 }
 
 bool MemoryMappedFile::InitializeAsImageSection(const FilePath& file_name) {
@@ -971,7 +1255,8 @@ bool MemoryMappedFile::InitializeAsImageSection(const FilePath& file_name) {
     return false;
   }
 
-  if (!MapFileToMemoryInternalEx(SEC_IMAGE)) {
+  access_ = READ_ONLY;
+  if (!MapFileToMemoryInternalEx(SEC_IMAGE, 0, 0)) {
     CloseHandles();
     return false;
   }
@@ -979,21 +1264,42 @@ bool MemoryMappedFile::InitializeAsImageSection(const FilePath& file_name) {
   return true;
 }
 
-bool MemoryMappedFile::MapFileToMemoryInternal() {
-  return MapFileToMemoryInternalEx(0);
+bool MemoryMappedFile::MapFileToMemoryInternal(int64 offset, size_t size) {
+  return MapFileToMemoryInternalEx(0, offset, size);
 }
 
-bool MemoryMappedFile::MapFileToMemoryInternalEx(int flags) {
+bool MemoryMappedFile::MapFileToMemoryInternalEx(int flags, int64 offset,
+                                                 size_t size) {
   base::ThreadRestrictions::AssertIOAllowed();
 
   if (file_ == INVALID_HANDLE_VALUE)
     return false;
 
-  length_ = ::GetFileSize(file_, NULL);
-  if (length_ == INVALID_FILE_SIZE)
+  LARGE_INTEGER file_size;
+  if (!::GetFileSizeEx(file_, &file_size))
+    return false;
+  if (offset < 0 || offset > file_size.QuadPart)
+    return false;
+  int64 available = file_size.QuadPart - offset;
+  if (size == 0) {
+    if (available > static_cast<int64>(std::numeric_limits<size_t>::max()))
+      return false;
+    size = static_cast<size_t>(available);
+  } else if (static_cast<uint64>(size) > static_cast<uint64>(available)) {
     return false;
+  }
+
+  DWORD protection = PAGE_READONLY;
+  DWORD view_access = FILE_MAP_READ;
+  if (access_ == READ_WRITE) {
+    protection = PAGE_READWRITE;
+    view_access = FILE_MAP_WRITE;
+  } else if (access_ == READ_COPY_ON_WRITE) {
+    protection = PAGE_WRITECOPY;
+    view_access = FILE_MAP_COPY;
+  }
 
-  file_mapping_ = ::CreateFileMapping(file_, NULL, PAGE_READONLY | flags,
+  file_mapping_ = ::CreateFileMapping(file_, NULL, protection | flags,
                                       0, 0, NULL);
   if (!file_mapping_) {
     // According to msdn, system error codes are only reserved up to 15999.
@@ -1003,26 +1309,50 @@ bool MemoryMappedFile::MapFileToMemoryInternalEx(int flags) {
     return false;
   }
 
-  data_ = static_cast<uint8*>(
-      ::MapViewOfFile(file_mapping_, FILE_MAP_READ, 0, 0, 0));
-  if (!data_) {
+  // Views start at a multiple of the allocation granularity, so the view
+  // starts before |offset| and data_ points into it.
+  SYSTEM_INFO system_info;
+  ::GetSystemInfo(&system_info);
+  int64 view_offset =
+      offset - offset % system_info.dwAllocationGranularity;
+  size_t data_offset = static_cast<size_t>(offset - view_offset);
+  // An image section is mapped whole.
+  size_t view_size = (flags & SEC_IMAGE) ? 0 : size + data_offset;
+
+  view_ = static_cast<uint8*>(::MapViewOfFile(
+      file_mapping_, view_access, static_cast<DWORD>(view_offset >> 32),
+      static_cast<DWORD>(view_offset), view_size));
+  if (!view_) {
     UMA_HISTOGRAM_ENUMERATION("MemoryMappedFile.MapViewOfFile",
                               logging::GetLastSystemErrorCode(), 16000);
+    return false;
   }
-  return data_ != NULL;
+  data_ = view_ + data_offset;
+  length_ = size;
+  return true;
+}
+
+bool MemoryMappedFile::Flush() {
+  DCHECK(IsValid());
+  if (access_ != READ_WRITE)
+    return true;
+  base::ThreadRestrictions::AssertIOAllowed();
+  return ::FlushViewOfFile(data_, length_) != 0;
 }
 
 void MemoryMappedFile::CloseHandles() {
-  if (data_)
-    ::UnmapViewOfFile(data_);
+  if (view_)
+    ::UnmapViewOfFile(view_);
   if (file_mapping_ != INVALID_HANDLE_VALUE)
     ::CloseHandle(file_mapping_);
   if (file_ != INVALID_HANDLE_VALUE)
     ::CloseHandle(file_);
 
+  view_ = NULL;
   data_ = NULL;
   file_mapping_ = file_ = INVALID_HANDLE_VALUE;
   length_ = INVALID_FILE_SIZE;
+  access_ = READ_ONLY;
 }
 
 bool HasFileBeenModifiedSince(const FileEnumerator::FindInfo& find_info,
@@ -0,0 +1,477 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// base::FlatHashMap and base::FlatHashSet are hash tables with open
+// addressing: the values are kept in one array, and a key that collides is
+// put in the next free slot after the one it hashes to. Unlike
+// base::hash_map and base::hash_set, which allocate a node for each value and
+// chain the nodes of a bucket, a lookup reads from one or two cache lines and
+// inserting doesn't allocate, unless the table grows. They are for small keys
+// and values that are looked up often, such as ids and pointers.
+//
+// The interface is that of the STL, with these differences:
+//  . Inserting into the table may move all of its values, and invalidates the
+//    iterators, references and pointers to them. Erasing only invalidates
+//    those to the value erased, so erase(it++) works while iterating.
+//  . The values must be copyable, since they are copied when the table grows.
+//  . The keys of a FlatHashSet must not be changed through its iterators.
+//
+//   base::FlatHashMap<int, gfx::Image*> images;
+//   images[id] = image;
+//   base::FlatHashMap<int, gfx::Image*>::const_iterator i = images.find(id);
+
+#ifndef BASE_FLAT_HASH_TABLES_H_
+#define BASE_FLAT_HASH_TABLES_H_
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+#include <new>
+#include <utility>
+
+#include "base/basictypes.h"
+#include "base/hash_tables.h"
+#include "base/logging.h"
+
+namespace base {
+
+namespace internal {
+
+// The default hash of the keys, which is that of base::hash_map.
+template <typename Key>
+struct FlatHash {
+  size_t operator()(const Key& key) const {
+#if defined(COMPILER_MSVC)
+    return stdext::hash_value(key);
+#else
+    return BASE_HASH_NAMESPACE::hash<Key>()(key);
+#endif
+  }
+};
+
+template <typename T>
+struct FlatHash<T*> {
+  size_t operator()(T* key) const {
+    return reinterpret_cast<uintptr_t>(key);
+  }
+};
+
+// Return the key of a value of the tables.
+template <typename Pair>
+struct FlatHashSelectFirst {
+  const typename Pair::first_type& operator()(const Pair& value) const {
+    return value.first;
+  }
+};
+
+template <typename Key>
+struct FlatHashIdentity {
+  const Key& operator()(const Key& value) const {
+    return value;
+  }
+};
+
+// The table that FlatHashMap and FlatHashSet are made of. |KeyOfValue|
+// returns the key of a value.
+template <typename Value, typename Key, typename KeyOfValue, typename Hash,
+          typename KeyEqual>
+class FlatHashTable {
+ private:
+  // The states of the slots. Erasing a value leaves its slot DELETED rather
+  // than EMPTY, so that the lookups of the keys after it go on past it.
+  enum SlotState {
+    EMPTY = 0,
+    FULL,
+    DELETED
+  };
+
+ public:
+  typedef Key key_type;
+  typedef Value value_type;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  typedef Hash hasher;
+  typedef KeyEqual key_equal;
+  typedef Value& reference;
+  typedef const Value& const_reference;
+  typedef Value* pointer;
+  typedef const Value* const_pointer;
+
+  class const_iterator;
+
+  class iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef Value value_type;
+    typedef ptrdiff_t difference_type;
+    typedef Value* pointer;
+    typedef Value& reference;
+
+    iterator() : table_(NULL), index_(0) {}
+
+    Value& operator*() const { return table_->slots_[index_]; }
+    Value* operator->() const { return &table_->slots_[index_]; }
+
+    iterator& operator++() {
+      index_ = table_->NextFull(index_ + 1);
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator copy(*this);
+      ++*this;
+      return copy;
+    }
+
+    bool operator==(const iterator& other) const {
+      return index_ == other.index_;
+    }
+    bool operator!=(const iterator& other) const {
+      return index_ != other.index_;
+    }
+
+   private:
+    friend class FlatHashTable;
+    friend class const_iterator;
+
+    iterator(FlatHashTable* table, size_t index)
+        : table_(table), index_(index) {}
+
+    FlatHashTable* table_;
+    size_t index_;
+  };
+
+  class const_iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef Value value_type;
+    typedef ptrdiff_t difference_type;
+    typedef const Value* pointer;
+    typedef const Value& reference;
+
+    const_iterator() : table_(NULL), index_(0) {}
+    const_iterator(const iterator& other)
+        : table_(other.table_), index_(other.index_) {}
+
+    const Value& operator*() const { return table_->slots_[index_]; }
+    const Value* operator->() const { return &table_->slots_[index_]; }
+
+    const_iterator& operator++() {
+      index_ = table_->NextFull(index_ + 1);
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator copy(*this);
+      ++*this;
+      return copy;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return index_ == other.index_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return index_ != other.index_;
+    }
+
+   private:
+    friend class FlatHashTable;
+
+    const_iterator(const FlatHashTable* table, size_t index)
+        : table_(table), index_(index) {}
+
+    const FlatHashTable* table_;
+    size_t index_;
+  };
+
+  friend class iterator;
+  friend class const_iterator;
+
+  FlatHashTable()
+      : states_(NULL),
+        slots_(NULL),
+        capacity_(0),
+        size_(0),
+        used_(0) {
+  }
+
+  explicit FlatHashTable(size_type expected_size)
+      : states_(NULL),
+        slots_(NULL),
+        capacity_(0),
+        size_(0),
+        used_(0) {
+    reserve(expected_size);
+  }
+
+  FlatHashTable(const FlatHashTable& other)
+      : states_(NULL),
+        slots_(NULL),
+        capacity_(0),
+        size_(0),
+        used_(0),
+        hash_(other.hash_),
+        equal_(other.equal_) {
+    reserve(other.size_);
+    for (const_iterator i = other.begin(); i != other.end(); ++i)
+      insert(*i);
+  }
+
+  ~FlatHashTable() {
+    DestroyValues();
+    delete[] states_;
+    ::operator delete(slots_);
+  }
+
+  FlatHashTable& operator=(const FlatHashTable& other) {
+    FlatHashTable copy(other);
+    swap(copy);
+    return *this;
+  }
+
+  void swap(FlatHashTable& other) {
+    std::swap(states_, other.states_);
+    std::swap(slots_, other.slots_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(size_, other.size_);
+    std::swap(used_, other.used_);
+    std::swap(hash_, other.hash_);
+    std::swap(equal_, other.equal_);
+  }
+
+  iterator begin() { return iterator(this, NextFull(0)); }
+  iterator end() { return iterator(this, capacity_); }
+  const_iterator begin() const { return const_iterator(this, NextFull(0)); }
+  const_iterator end() const { return const_iterator(this, capacity_); }
+
+  bool empty() const { return size_ == 0; }
+  size_type size() const { return size_; }
+
+  // Makes room for |size| values, so that inserting as many doesn't grow the
+  // table.
+  void reserve(size_type size) {
+    size_type capacity = GetCapacityFor(size);
+    if (capacity > capacity_)
+      Rehash(capacity);
+  }
+
+  void clear() {
+    DestroyValues();
+    if (states_)
+      memset(states_, EMPTY, capacity_);
+    size_ = 0;
+    used_ = 0;
+  }
+
+  iterator find(const Key& key) {
+    size_t index = FindIndex(key);
+    return iterator(this, index == kNotFound ? capacity_ : index);
+  }
+
+  const_iterator find(const Key& key) const {
+    size_t index = FindIndex(key);
+    return const_iterator(this, index == kNotFound ? capacity_ : index);
+  }
+
+  size_type count(const Key& key) const {
+    return FindIndex(key) == kNotFound ? 0 : 1;
+  }
+
+  // Inserts |value| unless there is a value with its key already. Returns the
+  // value with the key, and whether it was inserted.
+  std::pair<iterator, bool> insert(const Value& value) {
+    const Key& key = KeyOfValue()(value);
+    size_t index = FindIndex(key);
+    if (index != kNotFound)
+      return std::make_pair(iterator(this, index), false);
+
+    if (GetCapacityFor(used_ + 1) > capacity_) {
+      // The table grows only if the values need it, rather than the ones that
+      // were erased.
+      Rehash(std::max(capacity_, GetCapacityFor(size_ + 1)));
+    }
+    index = GetBucket(key);
+    while (states_[index] == FULL)
+      index = (index + 1) & (capacity_ - 1);
+    if (states_[index] == EMPTY)
+      ++used_;
+    new (&slots_[index]) Value(value);
+    states_[index] = FULL;
+    ++size_;
+    return std::make_pair(iterator(this, index), true);
+  }
+
+  void erase(iterator position) {
+    DCHECK(position.table_ == this);
+    EraseIndex(position.index_);
+  }
+
+  size_type erase(const Key& key) {
+    size_t index = FindIndex(key);
+    if (index == kNotFound)
+      return 0;
+    EraseIndex(index);
+    return 1;
+  }
+
+  hasher hash_function() const { return hash_; }
+  key_equal key_eq() const { return equal_; }
+
+ private:
+  static const size_t kNotFound = static_cast<size_t>(-1);
+
+  // The smallest capacity of a table with values, which is a power of two,
+  // like all others.
+  static const size_t kMinCapacity = 8;
+
+  // Returns the capacity the table needs for |size| values, which are at most
+  // 3/4 of it, to keep the runs of the slots that are in use short.
+  static size_t GetCapacityFor(size_t size) {
+    if (size == 0)
+      return 0;
+    size_t capacity = kMinCapacity;
+    while (capacity / 4 * 3 < size)
+      capacity *= 2;
+    return capacity;
+  }
+
+  // Returns the slot |key| hashes to. The hash is mixed, since those of the
+  // integers and pointers are commonly the value itself, of which the low
+  // bits, that the slot is taken from, are alike.
+  size_t GetBucket(const Key& key) const {
+    size_t hash = hash_(key);
+    uint32 mixed = static_cast<uint32>(hash ^ ((hash >> 16) >> 16));
+    mixed *= 0x9e3779b1u;
+    mixed ^= mixed >> 15;
+    return mixed & (capacity_ - 1);
+  }
+
+  size_t FindIndex(const Key& key) const {
+    if (!size_)
+      return kNotFound;
+    // The table always has an EMPTY slot, so this ends.
+    for (size_t index = GetBucket(key); ;
+         index = (index + 1) & (capacity_ - 1)) {
+      if (states_[index] == EMPTY)
+        return kNotFound;
+      if (states_[index] == FULL && equal_(KeyOfValue()(slots_[index]), key))
+        return index;
+    }
+  }
+
+  // Returns the index of the first value at or after |index|, or capacity_.
+  size_t NextFull(size_t index) const {
+    while (index < capacity_ && states_[index] != FULL)
+      ++index;
+    return index;
+  }
+
+  void EraseIndex(size_t index) {
+    DCHECK_LT(index, capacity_);
+    DCHECK_EQ(FULL, states_[index]);
+    slots_[index].~Value();
+    states_[index] = DELETED;
+    --size_;
+  }
+
+  void DestroyValues() {
+    for (size_t i = 0; i < capacity_; ++i) {
+      if (states_[i] == FULL)
+        slots_[i].~Value();
+    }
+  }
+
+  // Moves the values to a table of |capacity| slots, which drops the DELETED
+  // ones.
+  void Rehash(size_t capacity) {
+    DCHECK_GE(capacity, GetCapacityFor(size_));
+    uint8* old_states = states_;
+    Value* old_slots = slots_;
+    size_t old_capacity = capacity_;
+
+    states_ = new uint8[capacity];
+    memset(states_, EMPTY, capacity);
+    slots_ = static_cast<Value*>(::operator new(capacity * sizeof(Value)));
+    capacity_ = capacity;
+    used_ = size_;
+    for (size_t i = 0; i < old_capacity; ++i) {
+      if (old_states[i] != FULL)
+        continue;
+      size_t index = GetBucket(KeyOfValue()(old_slots[i]));
+      while (states_[index] != EMPTY)
+        index = (index + 1) & (capacity_ - 1);
+      new (&slots_[index]) Value(old_slots[i]);
+      states_[index] = FULL;
+      old_slots[i].~Value();
+    }
+    delete[] old_states;
+    ::operator delete(old_slots);
+  }
+
+  uint8* states_;
+  Value* slots_;
+  size_t capacity_;
+
+  // The number of values, and of the slots that aren't EMPTY.
+  size_t size_;
+  size_t used_;
+
+  Hash hash_;
+  KeyEqual equal_;
+};
+
+}  // namespace internal
+
+template <typename Key, typename T,
+          typename Hash = internal::FlatHash<Key>,
+          typename KeyEqual = std::equal_to<Key> >
+class FlatHashMap
+    : public internal::FlatHashTable<
+          std::pair<const Key, T>, Key,
+          internal::FlatHashSelectFirst<std::pair<const Key, T> >,
+          Hash, KeyEqual> {
+ private:
+  typedef internal::FlatHashTable<
+      std::pair<const Key, T>, Key,
+      internal::FlatHashSelectFirst<std::pair<const Key, T> >,
+      Hash, KeyEqual> Table;
+
+ public:
+  typedef T mapped_type;
+  typedef typename Table::value_type value_type;
+  typedef typename Table::iterator iterator;
+  typedef typename Table::const_iterator const_iterator;
+
+  FlatHashMap() {}
+  explicit FlatHashMap(typename Table::size_type expected_size)
+      : Table(expected_size) {}
+
+  T& operator[](const Key& key) {
+    iterator found = this->find(key);
+    if (found != this->end())
+      return found->second;
+    return this->insert(value_type(key, T())).first->second;
+  }
+};
+
+template <typename Key,
+          typename Hash = internal::FlatHash<Key>,
+          typename KeyEqual = std::equal_to<Key> >
+class FlatHashSet
+    : public internal::FlatHashTable<Key, Key, internal::FlatHashIdentity<Key>,
+                                     Hash, KeyEqual> {
+ private:
+  typedef internal::FlatHashTable<Key, Key, internal::FlatHashIdentity<Key>,
+                                  Hash, KeyEqual> Table;
+
+ public:
+  FlatHashSet() {}
+  explicit FlatHashSet(typename Table::size_type expected_size)
+      : Table(expected_size) {}
+};
+
+}  // namespace base
+
+#endif  // BASE_FLAT_HASH_TABLES_H_
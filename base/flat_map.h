@@ -0,0 +1,110 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_FLAT_MAP_H_
+#define BASE_FLAT_MAP_H_
+#pragma once
+
+#include <functional>
+#include <utility>
+
+#include "base/flat_tree.h"
+#include "base/stack_container.h"
+
+namespace base {
+
+namespace internal {
+
+template <typename Pair>
+struct FlatMapSelectFirst {
+  const typename Pair::first_type& operator()(const Pair& value) const {
+    return value.first;
+  }
+};
+
+template <typename Key, typename T, typename Compare, typename Storage>
+class FlatMapBase
+    : public FlatTree<Key, std::pair<Key, T>,
+                      FlatMapSelectFirst<std::pair<Key, T> >, Compare,
+                      Storage> {
+ private:
+  typedef FlatTree<Key, std::pair<Key, T>,
+                   FlatMapSelectFirst<std::pair<Key, T> >, Compare,
+                   Storage> Tree;
+
+ public:
+  typedef T mapped_type;
+  typedef typename Tree::value_type value_type;
+  typedef typename Tree::iterator iterator;
+  typedef typename Tree::const_iterator const_iterator;
+
+  FlatMapBase() {}
+
+  template <typename InputIterator>
+  FlatMapBase(InputIterator first, InputIterator last) : Tree(first, last) {}
+
+  T& operator[](const Key& key) {
+    iterator position = this->lower_bound(key);
+    if (position == this->end() || Compare()(key, position->first))
+      position = this->insert(value_type(key, T())).first;
+    return position->second;
+  }
+};
+
+}  // namespace internal
+
+// FlatMap is a map kept in a vector, sorted by key, which for the maps of a
+// few dozen entries is both smaller and faster to look up than std::map: a
+// lookup is a binary search of contiguous memory, and the map takes one
+// allocation rather than one for each entry. Inserting and erasing move the
+// entries after the one inserted or erased, so they are linear in the size of
+// the map, except for building a map from a range, which sorts it once:
+//
+//   std::vector<std::pair<uint16, base::StringPiece> > resources;
+//   ...
+//   base::FlatMap<uint16, base::StringPiece> map(resources.begin(),
+//                                                resources.end());
+//
+// The entries are std::pair<Key, T>, so their keys are copyable, but must
+// not be changed through the iterators. Inserting invalidates the iterators,
+// erasing those to the entry erased and after it.
+template <typename Key, typename T, typename Compare = std::less<Key> >
+class FlatMap
+    : public internal::FlatMapBase<
+          Key, T, Compare,
+          internal::FlatVectorStorage<std::pair<Key, T> > > {
+ private:
+  typedef internal::FlatMapBase<
+      Key, T, Compare,
+      internal::FlatVectorStorage<std::pair<Key, T> > > Base;
+
+ public:
+  FlatMap() {}
+
+  template <typename InputIterator>
+  FlatMap(InputIterator first, InputIterator last) : Base(first, last) {}
+};
+
+// Same as FlatMap, with room for |stack_capacity| entries in the map itself,
+// so that a map that doesn't hold more than that doesn't allocate. See
+// StackVector for what to watch out for when copying.
+template <typename Key, typename T, size_t stack_capacity,
+          typename Compare = std::less<Key> >
+class StackFlatMap
+    : public internal::FlatMapBase<
+          Key, T, Compare, StackVector<std::pair<Key, T>, stack_capacity> > {
+ private:
+  typedef internal::FlatMapBase<
+      Key, T, Compare, StackVector<std::pair<Key, T>, stack_capacity> > Base;
+
+ public:
+  StackFlatMap() {}
+
+  template <typename InputIterator>
+  StackFlatMap(InputIterator first, InputIterator last) : Base(first, last) {}
+};
+
+}  // namespace base
+
+#endif  // BASE_FLAT_MAP_H_
@@ -0,0 +1,63 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_FLAT_SET_H_
+#define BASE_FLAT_SET_H_
+#pragma once
+
+#include <functional>
+
+#include "base/flat_tree.h"
+#include "base/stack_container.h"
+
+namespace base {
+
+namespace internal {
+
+template <typename Key>
+struct FlatSetIdentity {
+  const Key& operator()(const Key& value) const {
+    return value;
+  }
+};
+
+}  // namespace internal
+
+// FlatSet is a set kept in a sorted vector, the set of FlatMap, see
+// flat_map.h. The keys must not be changed through the iterators.
+template <typename Key, typename Compare = std::less<Key> >
+class FlatSet
+    : public internal::FlatTree<Key, Key, internal::FlatSetIdentity<Key>,
+                                Compare, internal::FlatVectorStorage<Key> > {
+ private:
+  typedef internal::FlatTree<Key, Key, internal::FlatSetIdentity<Key>,
+                             Compare, internal::FlatVectorStorage<Key> > Tree;
+
+ public:
+  FlatSet() {}
+
+  template <typename InputIterator>
+  FlatSet(InputIterator first, InputIterator last) : Tree(first, last) {}
+};
+
+// Same as FlatSet, with room for |stack_capacity| keys in the set itself.
+template <typename Key, size_t stack_capacity,
+          typename Compare = std::less<Key> >
+class StackFlatSet
+    : public internal::FlatTree<Key, Key, internal::FlatSetIdentity<Key>,
+                                Compare, StackVector<Key, stack_capacity> > {
+ private:
+  typedef internal::FlatTree<Key, Key, internal::FlatSetIdentity<Key>,
+                             Compare, StackVector<Key, stack_capacity> > Tree;
+
+ public:
+  StackFlatSet() {}
+
+  template <typename InputIterator>
+  StackFlatSet(InputIterator first, InputIterator last) : Tree(first, last) {}
+};
+
+}  // namespace base
+
+#endif  // BASE_FLAT_SET_H_
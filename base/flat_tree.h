@@ -0,0 +1,195 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// The implementation of base::FlatMap and base::FlatSet, see flat_map.h and
+// flat_set.h.
+
+#ifndef BASE_FLAT_TREE_H_
+#define BASE_FLAT_TREE_H_
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace base {
+namespace internal {
+
+// Holds the std::vector of a FlatTree. StackVector is the other storage, the
+// two have container() in common.
+template <typename Value>
+class FlatVectorStorage {
+ public:
+  typedef std::vector<Value> ContainerType;
+
+  ContainerType& container() { return container_; }
+  const ContainerType& container() const { return container_; }
+
+ private:
+  ContainerType container_;
+
+  // Copy and assignment are allowed.
+};
+
+// The values of the tree, in a vector sorted by their keys, which |KeyOfValue|
+// returns. |Storage| holds the vector.
+template <typename Key, typename Value, typename KeyOfValue, typename Compare,
+          typename Storage>
+class FlatTree {
+ public:
+  typedef typename Storage::ContainerType ContainerType;
+  typedef Key key_type;
+  typedef Value value_type;
+  typedef Compare key_compare;
+  typedef typename ContainerType::size_type size_type;
+  typedef typename ContainerType::difference_type difference_type;
+  typedef typename ContainerType::reference reference;
+  typedef typename ContainerType::const_reference const_reference;
+  typedef typename ContainerType::iterator iterator;
+  typedef typename ContainerType::const_iterator const_iterator;
+  typedef typename ContainerType::reverse_iterator reverse_iterator;
+  typedef typename ContainerType::const_reverse_iterator
+      const_reverse_iterator;
+
+  FlatTree() {}
+
+  template <typename InputIterator>
+  FlatTree(InputIterator first, InputIterator last) {
+    insert(first, last);
+  }
+
+  iterator begin() { return values().begin(); }
+  iterator end() { return values().end(); }
+  const_iterator begin() const { return values().begin(); }
+  const_iterator end() const { return values().end(); }
+  reverse_iterator rbegin() { return values().rbegin(); }
+  reverse_iterator rend() { return values().rend(); }
+  const_reverse_iterator rbegin() const { return values().rbegin(); }
+  const_reverse_iterator rend() const { return values().rend(); }
+
+  bool empty() const { return values().empty(); }
+  size_type size() const { return values().size(); }
+
+  void reserve(size_type size) { values().reserve(size); }
+  void clear() { values().clear(); }
+
+  iterator lower_bound(const Key& key) {
+    return Bound(begin(), end(), key, false);
+  }
+  const_iterator lower_bound(const Key& key) const {
+    return Bound(begin(), end(), key, false);
+  }
+
+  iterator upper_bound(const Key& key) {
+    return Bound(begin(), end(), key, true);
+  }
+  const_iterator upper_bound(const Key& key) const {
+    return Bound(begin(), end(), key, true);
+  }
+
+  iterator find(const Key& key) {
+    iterator found = lower_bound(key);
+    if (found == end() || Compare()(key, KeyOfValue()(*found)))
+      return end();
+    return found;
+  }
+  const_iterator find(const Key& key) const {
+    const_iterator found = lower_bound(key);
+    if (found == end() || Compare()(key, KeyOfValue()(*found)))
+      return end();
+    return found;
+  }
+
+  size_type count(const Key& key) const {
+    return find(key) == end() ? 0 : 1;
+  }
+
+  // Inserts |value| unless there is a value with its key already. Returns the
+  // value with the key, and whether it was inserted. The values after it are
+  // moved, so this is linear in the size of the tree.
+  std::pair<iterator, bool> insert(const value_type& value) {
+    iterator position = lower_bound(KeyOfValue()(value));
+    if (position != end() &&
+        !Compare()(KeyOfValue()(value), KeyOfValue()(*position))) {
+      return std::make_pair(position, false);
+    }
+    return std::make_pair(values().insert(position, value), true);
+  }
+
+  // Inserts the values of the range whose keys aren't in the tree, nor before
+  // them in the range. The values are appended and sorted once, rather than
+  // put in place one at a time, so building a tree from a range is
+  // O(n log(n)).
+  template <typename InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    values().insert(values().end(), first, last);
+    // The sort keeps the values that were first among those of the same key
+    // in front of the others.
+    std::stable_sort(begin(), end(), ValueCompare());
+    values().erase(std::unique(begin(), end(), ValueEqual()), end());
+  }
+
+  // Erasing invalidates the iterators to the value and to those after it.
+  iterator erase(iterator position) { return values().erase(position); }
+  iterator erase(iterator first, iterator last) {
+    return values().erase(first, last);
+  }
+  size_type erase(const Key& key) {
+    iterator found = find(key);
+    if (found == end())
+      return 0;
+    erase(found);
+    return 1;
+  }
+
+  key_compare key_comp() const { return Compare(); }
+
+ private:
+  // The vector the values are kept in, sorted.
+  ContainerType& values() { return storage_.container(); }
+  const ContainerType& values() const { return storage_.container(); }
+
+  // Returns the first value in [first, last) whose key isn't before |key|,
+  // or, if |upper|, the first whose key is after it. std::lower_bound() can't
+  // be given the comparisons of a key with a value, as they're the same for
+  // a set.
+  template <typename Iterator>
+  static Iterator Bound(Iterator first, Iterator last, const Key& key,
+                        bool upper) {
+    difference_type count = last - first;
+    while (count > 0) {
+      difference_type step = count / 2;
+      Iterator middle = first + step;
+      const Key& middle_key = KeyOfValue()(*middle);
+      if (upper ? !Compare()(key, middle_key) : Compare()(middle_key, key)) {
+        first = middle + 1;
+        count -= step + 1;
+      } else {
+        count = step;
+      }
+    }
+    return first;
+  }
+
+  struct ValueCompare {
+    bool operator()(const value_type& a, const value_type& b) const {
+      return Compare()(KeyOfValue()(a), KeyOfValue()(b));
+    }
+  };
+
+  struct ValueEqual {
+    bool operator()(const value_type& a, const value_type& b) const {
+      return !Compare()(KeyOfValue()(a), KeyOfValue()(b)) &&
+             !Compare()(KeyOfValue()(b), KeyOfValue()(a));
+    }
+  };
+
+  Storage storage_;
+};
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_FLAT_TREE_H_
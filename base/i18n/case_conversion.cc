@@ -9,6 +9,7 @@
 #endif
 
 #include "base/string16.h"
+#include "base/string_util.h"
 // #include "unicode/unistr.h"
 
 
@@ -26,20 +27,41 @@ namespace i18n {
 //   unicode_string.toUpper();
 //   return string16(unicode_string.getBuffer(), unicode_string.length());
 //}
-string16 ToLower(const StringPiece16& string)
-{
-    // WLW TODO: fix it.
-    string16 lower(string.data());
-    CharLowerW(const_cast<LPWSTR>(lower.c_str()));
-    return lower;
+namespace {
+
+// Adds |delta| to the code units of |str| from |first| to |last|.
+void ShiftASCIIRange(string16* str, char16 first, char16 last, int delta) {
+  for (string16::iterator it = str->begin(); it != str->end(); ++it) {
+    if (*it >= first && *it <= last)
+      *it = static_cast<char16>(*it + delta);
+  }
+}
+
+bool IsASCII(const string16& str) {
+  return FindFirstCodeUnitAbove(str.data(), str.size(), 0x7F) == str.size();
+}
+
+}  // namespace
+
+// Most UI text is ASCII, whose case is converted without calling Windows.
+string16 ToLower(const StringPiece16& string) {
+  string16 lower(string.data(), string.size());
+  if (IsASCII(lower)) {
+    ShiftASCIIRange(&lower, 'A', 'Z', 'a' - 'A');
+  } else {
+    CharLowerBuffW(&lower[0], static_cast<DWORD>(lower.size()));
+  }
+  return lower;
 }
 
-string16 ToUpper(const StringPiece16& string)
-{
-    // WLW TODO: fix it.
-    string16 upper(string.data());
-    CharUpperW(const_cast<LPWSTR>(upper.c_str()));
-    return upper;
+string16 ToUpper(const StringPiece16& string) {
+  string16 upper(string.data(), string.size());
+  if (IsASCII(upper)) {
+    ShiftASCIIRange(&upper, 'a', 'z', 'A' - 'a');
+  } else {
+    CharUpperBuffW(&upper[0], static_cast<DWORD>(upper.size()));
+  }
+  return upper;
 }
 
 }  // namespace i18n
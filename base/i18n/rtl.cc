@@ -92,9 +92,12 @@ inline BOOL IsRTLCharCore(WCHAR ch)
         ((MASK_RTLPUNCT>>(ch-0x200f))&1))); // Mask of RTL punct chars
 }
 
+// The lowest code unit for which IsRTLChar() is true.
+const WCHAR kFirstRTLChar = 0x0590;
+
 inline BOOL IsRTLChar(WCHAR ch)
 {
-    return (IN_RANGE(0x0590/* First RTL char */, ch, 0x202e/* RLO */) &&
+    return (IN_RANGE(kFirstRTLChar, ch, 0x202e/* RLO */) &&
         IsRTLCharCore(ch));
 }
 
@@ -224,6 +227,38 @@ bool IsRTL()
 //   return LEFT_TO_RIGHT;
 // }
 
+TextDirection GetFirstStrongCharacterDirection(const string16& text) {
+  const char16* string = text.data();
+  size_t length = text.length();
+  for (size_t position = 0; position < length; ++position) {
+    char16 character = string[position];
+    if (character <= 0x7F) {
+      // Most text is ASCII, of which only the letters are strong.
+      char16 lower = character | 0x20;
+      if (lower >= 'a' && lower <= 'z')
+        return LEFT_TO_RIGHT;
+      continue;
+    }
+    switch (character) {
+      case kLeftToRightEmbeddingMark:
+      case kLeftToRightOverride:
+        return LEFT_TO_RIGHT;
+      case kRightToLeftEmbeddingMark:
+      case kRightToLeftOverride:
+        return RIGHT_TO_LEFT;
+    }
+    // CT_CTYPE2 is the Windows BiDi character type.
+    WORD type = 0;
+    if (!GetStringTypeW(CT_CTYPE2, &string[position], 1, &type))
+      continue;
+    if (type == C2_LEFTTORIGHT)
+      return LEFT_TO_RIGHT;
+    if (type == C2_RIGHTTOLEFT)
+      return RIGHT_TO_LEFT;
+  }
+  return LEFT_TO_RIGHT;
+}
+
 #if defined(OS_WIN)
 bool AdjustStringForLocaleDirection(string16* text) {
   if (!IsRTL() || text->empty())
@@ -312,17 +347,20 @@ bool AdjustStringForLocaleDirection(string16* text) {
 //   return false;
 // }
 
-bool StringContainsStrongRTLChars(const string16& text)
-{
-    size_t length = text.length();
-    for(size_t i=0; i<length; ++i)
-    {
-        if(IsRTLChar(text[i]))
-        {
-            return true;
-        }
-    }
-    return false;
+bool StringContainsStrongRTLChars(const string16& text) {
+  // Most text has no code unit from the first RTL block up, and is skipped
+  // a vector at a time.
+  const char16* string = text.data();
+  size_t length = text.length();
+  size_t position = FindFirstCodeUnitAbove(string, length, kFirstRTLChar - 1);
+  while (position < length) {
+    if (IsRTLChar(string[position]))
+      return true;
+    ++position;
+    position += FindFirstCodeUnitAbove(string + position, length - position,
+                                       kFirstRTLChar - 1);
+  }
+  return false;
 }
 
 void WrapStringWithLTRFormatting(string16* text) {
@@ -41,6 +41,8 @@
 #include "base/atomicops.h"
 #include "base/base_export.h"
 #include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/startup_instance_report.h"
 #include "base/third_party/dynamic_annotations/dynamic_annotations.h"
 #include "base/threading/thread_restrictions.h"
 
@@ -143,20 +145,10 @@ class LazyInstance : public LazyInstanceHelper {
     // state_ == STATE_CREATED needs to acquire visibility over
     // the associated data (buf_). Pairing Release_Store is in
     // CompleteInstance().
-    if ((base::subtle::Acquire_Load(&state_) != STATE_CREATED) &&
-        NeedsInstance()) {
-      // Create the instance in the space provided by |buf_|.
-      instance_ = Traits::New(buf_);
-      // Traits::Delete will be null for LeakyLazyInstanceTraits
-      void (*dtor)(void*) = Traits::Delete;
-      CompleteInstance(this, (dtor == NULL) ? NULL : OnExit);
-    }
+    if (base::subtle::Acquire_Load(&state_) != STATE_CREATED)
+      return CreateInstance();
 
-    // This annotation helps race detectors recognize correct lock-less
-    // synchronization between different threads calling Pointer().
-    // We suggest dynamic race detection tool that "Traits::New" above
-    // and CompleteInstance(...) happens before "return instance_" below.
-    // See the corresponding HAPPENS_BEFORE in CompleteInstance(...).
+    // See the comment in CreateInstance().
     ANNOTATE_HAPPENS_AFTER(&state_);
     return instance_;
   }
@@ -175,6 +167,29 @@ class LazyInstance : public LazyInstanceHelper {
   }
 
  private:
+  // The slow path of Pointer(), which is out of line so that the load and
+  // compare of the fast path are all that is inlined where Pointer() is used.
+  NOINLINE Type* CreateInstance() {
+    if (NeedsInstance()) {
+      {
+        internal::ScopedInstanceCreation creation(BASE_INSTANCE_CREATION_NAME);
+        // Create the instance in the space provided by |buf_|.
+        instance_ = Traits::New(buf_);
+      }
+      // Traits::Delete will be null for LeakyLazyInstanceTraits
+      void (*dtor)(void*) = Traits::Delete;
+      CompleteInstance(this, (dtor == NULL) ? NULL : OnExit);
+    }
+
+    // This annotation helps race detectors recognize correct lock-less
+    // synchronization between different threads calling Pointer().
+    // We suggest dynamic race detection tool that "Traits::New" above
+    // and CompleteInstance(...) happens before "return instance_" below.
+    // See the corresponding HAPPENS_BEFORE in CompleteInstance(...).
+    ANNOTATE_HAPPENS_AFTER(&state_);
+    return instance_;
+  }
+
   // Adapter function for use with AtExit.  This should be called single
   // threaded, so don't use atomic operations.
   // Calling OnExit while the instance is in use by other threads is a mistake.
@@ -40,11 +40,13 @@ typedef pthread_mutex_t* MutexHandle;
 #endif
 
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <iomanip>
 #include <ostream>
 
+#include "base/atomicops.h"
 #include "base/base_switches.h"
 #include "base/command_line.h"
 #include "base/debug/debugger.h"
@@ -52,6 +54,8 @@ typedef pthread_mutex_t* MutexHandle;
 #include "base/eintr_wrapper.h"
 #include "base/string_piece.h"
 #include "base/synchronization/lock_impl.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
 #include "base/utf_string_conversions.h"
 #include "base/vlog.h"
 #if defined(OS_POSIX)
@@ -67,6 +71,21 @@ namespace logging {
 DcheckState g_dcheck_state = DISABLE_DCHECK_FOR_NON_OFFICIAL_RELEASE_BUILDS;
 VlogInfo* g_vlog_info = NULL;
 
+// Counts the changes to the settings that vlog levels are read from, so that
+// the levels VlogFileCaches keep from before a change aren't used. It's kept
+// to kVlogGenerationBits bits, and is never 0, which marks an empty cache.
+base::subtle::Atomic32 g_vlog_generation = 1;
+const int kVlogGenerationBits = 23;
+
+// Makes the VlogFileCaches read the levels again.
+void InvalidateVlogLevels() {
+  base::subtle::Atomic32 generation =
+      (base::subtle::NoBarrier_Load(&g_vlog_generation) + 1) &
+      ((1 << kVlogGenerationBits) - 1);
+  base::subtle::Release_Store(&g_vlog_generation,
+                              generation ? generation : 1);
+}
+
 const char* const log_severity_names[LOG_NUM_SEVERITIES] = {
   "INFO", "WARNING", "ERROR", "ERROR_REPORT", "FATAL" };
 
@@ -352,6 +371,98 @@ bool InitializeLogFileHandle() {
   return true;
 }
 
+// Appends |size| characters at |data| to the log file, which must be open.
+// The caller must hold the LoggingLock.
+void WriteToLogFile(const char* data, size_t size) {
+#if defined(OS_WIN)
+  SetFilePointer(log_file, 0, 0, SEEK_END);
+  DWORD num_written;
+  WriteFile(log_file,
+            static_cast<const void*>(data),
+            static_cast<DWORD>(size),
+            &num_written,
+            NULL);
+#else
+  fwrite(data, 1, size, log_file);
+  fflush(log_file);
+#endif
+}
+
+// The messages waiting to be written to the log file by the writer thread,
+// when SetAsyncLogFileWrites() is on. |pending_log_lock| protects
+// |pending_log|. |log_flush_lock| is held while a batch of messages is
+// written, so that the batches go to the file in the order they were taken.
+// They're LockImpls as Lock makes logging calls. |pending_log_event| is
+// signaled when a message is queued while none are pending, so that the
+// writer thread only wakes up when there is something to write.
+bool async_log_file_writes = false;
+std::string* pending_log = NULL;
+base::internal::LockImpl* pending_log_lock = NULL;
+base::internal::LockImpl* log_flush_lock = NULL;
+base::WaitableEvent* pending_log_event = NULL;
+
+// How long the writer thread lets the messages pile up after the first one
+// is queued, and how long they may get before the thread that logs writes
+// them itself.
+const int kLogFileWriteIntervalMs = 100;
+const size_t kMaxPendingLogSize = 1024 * 1024;
+
+// Writes the pending messages to the log file, in one write. If |wait| is
+// false, it gives up rather than waiting for another thread that is writing,
+// which at exit may have been killed while it did.
+void FlushPendingLog(bool wait) {
+  if (!log_flush_lock)
+    return;
+  if (wait)
+    log_flush_lock->Lock();
+  else if (!log_flush_lock->Try())
+    return;
+
+  std::string batch;
+  pending_log_lock->Lock();
+  batch.swap(*pending_log);
+  pending_log_lock->Unlock();
+
+  if (!batch.empty()) {
+    LoggingLock logging_lock;
+    if (InitializeLogFileHandle())
+      WriteToLogFile(batch.data(), batch.size());
+  }
+  log_flush_lock->Unlock();
+}
+
+void AppendToPendingLog(const std::string& message) {
+  pending_log_lock->Lock();
+  bool was_empty = pending_log->empty();
+  pending_log->append(message);
+  size_t pending_size = pending_log->size();
+  pending_log_lock->Unlock();
+
+  if (was_empty)
+    pending_log_event->Signal();
+  // Don't let the messages pile up if the writer thread falls behind.
+  if (pending_size > kMaxPendingLogSize)
+    FlushPendingLog(true);
+}
+
+void FlushPendingLogAtExit() {
+  FlushPendingLog(false);
+}
+
+// Waits for a message to be queued, and writes the pending messages
+// kLogFileWriteIntervalMs later. It runs until the process exits.
+class LogFileWriterThread : public base::PlatformThread::Delegate {
+ public:
+  virtual void ThreadMain() {
+    base::PlatformThread::SetName("LogFileWriter");
+    for (;;) {
+      pending_log_event->Wait();
+      base::PlatformThread::Sleep(kLogFileWriteIntervalMs);
+      FlushPendingLog(true);
+    }
+  }
+};
+
 bool BaseInitLoggingImpl(const PathChar* new_log_file,
                          LoggingDestination logging_dest,
                          LogLockingState lock_log,
@@ -370,9 +481,13 @@ bool BaseInitLoggingImpl(const PathChar* new_log_file,
                      command_line->GetSwitchValueASCII(switches::kVModule),
                      &min_log_level);
   }
+  InvalidateVlogLevels();
 
   LoggingLock::Init(lock_log, new_log_file);
 
+  // The pending messages go to the log file they were logged for.
+  FlushPendingLog(true);
+
   LoggingLock logging_lock;
 
   if (log_file) {
@@ -400,6 +515,7 @@ bool BaseInitLoggingImpl(const PathChar* new_log_file,
 
 void SetMinLogLevel(int level) {
   min_log_level = std::min(LOG_ERROR_REPORT, level);
+  InvalidateVlogLevels();
 }
 
 int GetMinLogLevel() {
@@ -417,6 +533,43 @@ int GetVlogLevelHelper(const char* file, size_t N) {
       GetVlogVerbosity();
 }
 
+int GetCachedVlogLevelHelper(VlogFileCache* cache,
+                             const char* file, size_t N) {
+  // The state is the generation of the settings the level was read with,
+  // and the level, offset to fit in the low byte.
+  const int kLevelBits = 8;
+  const int kLevelOffset = 1 << (kLevelBits - 1);
+  base::subtle::AtomicWord* cached_file =
+      reinterpret_cast<base::subtle::AtomicWord*>(&cache->file);
+  base::subtle::Atomic32* state =
+      reinterpret_cast<base::subtle::Atomic32*>(&cache->state);
+  base::subtle::AtomicWord file_word = reinterpret_cast<intptr_t>(file);
+
+  base::subtle::Atomic32 generation = base::subtle::Acquire_Load(
+      &g_vlog_generation);
+  base::subtle::AtomicWord cached = base::subtle::NoBarrier_Load(cached_file);
+  if (cached == file_word) {
+    base::subtle::Atomic32 cached_state = base::subtle::Acquire_Load(state);
+    if ((cached_state >> kLevelBits) == generation)
+      return (cached_state & ((1 << kLevelBits) - 1)) - kLevelOffset;
+  }
+
+  int level = GetVlogLevelHelper(file, N);
+  if (!cached) {
+    // The first file asked for is the one the cache is for.
+    cached = base::subtle::NoBarrier_CompareAndSwap(cached_file, 0,
+                                                     file_word);
+    if (!cached)
+      cached = file_word;
+  }
+  if (cached == file_word && level >= -kLevelOffset &&
+      level < kLevelOffset) {
+    base::subtle::Release_Store(
+        state, (generation << kLevelBits) | (level + kLevelOffset));
+  }
+  return level;
+}
+
 void SetLogItems(bool enable_process_id, bool enable_thread_id,
                  bool enable_timestamp, bool enable_tickcount) {
   log_process_id = enable_process_id;
@@ -425,6 +578,26 @@ void SetLogItems(bool enable_process_id, bool enable_thread_id,
   log_tickcount = enable_tickcount;
 }
 
+void SetAsyncLogFileWrites(bool enabled) {
+  if (enabled && !log_flush_lock) {
+    pending_log = new std::string;
+    pending_log_lock = new base::internal::LockImpl();
+    log_flush_lock = new base::internal::LockImpl();
+    pending_log_event = new base::WaitableEvent(false, false);
+    // Leaked, like the thread, so that messages logged in the destructors of
+    // statics are still written.
+    base::PlatformThread::CreateNonJoinable(0, new LogFileWriterThread);
+    atexit(&FlushPendingLogAtExit);
+  }
+  async_log_file_writes = enabled;
+  if (!enabled)
+    FlushPendingLog(true);
+}
+
+void FlushLogFile() {
+  FlushPendingLog(true);
+}
+
 void SetShowErrorDialogs(bool enable_dialogs) {
   show_error_dialogs = enable_dialogs;
 }
@@ -522,22 +695,26 @@ LogMessage::SaveLastError::~SaveLastError() {
 
 LogMessage::LogMessage(const char* file, int line, LogSeverity severity,
                        int ctr)
-    : severity_(severity), file_(file), line_(line) {
+    : severity_(severity), stream_(&message_buffer_), file_(file),
+      line_(line) {
   Init(file, line);
 }
 
 LogMessage::LogMessage(const char* file, int line)
-    : severity_(LOG_INFO), file_(file), line_(line) {
+    : severity_(LOG_INFO), stream_(&message_buffer_), file_(file),
+      line_(line) {
   Init(file, line);
 }
 
 LogMessage::LogMessage(const char* file, int line, LogSeverity severity)
-    : severity_(severity), file_(file), line_(line) {
+    : severity_(severity), stream_(&message_buffer_), file_(file),
+      line_(line) {
   Init(file, line);
 }
 
 LogMessage::LogMessage(const char* file, int line, std::string* result)
-    : severity_(LOG_FATAL), file_(file), line_(line) {
+    : severity_(LOG_FATAL), stream_(&message_buffer_), file_(file),
+      line_(line) {
   Init(file, line);
   stream_ << "Check failed: " << *result;
   delete result;
@@ -545,7 +722,8 @@ LogMessage::LogMessage(const char* file, int line, std::string* result)
 
 LogMessage::LogMessage(const char* file, int line, LogSeverity severity,
                        std::string* result)
-    : severity_(severity), file_(file), line_(line) {
+    : severity_(severity), stream_(&message_buffer_), file_(file),
+      line_(line) {
   Init(file, line);
   stream_ << "Check failed: " << *result;
   delete result;
@@ -563,7 +741,7 @@ LogMessage::~LogMessage() {
   }
 #endif
   stream_ << std::endl;
-  std::string str_newline(stream_.str());
+  std::string str_newline(message_buffer_.str());
 
   // Give any log message handler first dibs on the message.
   if (log_message_handler && log_message_handler(severity_, file_, line_,
@@ -616,20 +794,15 @@ LogMessage::~LogMessage() {
   // write to log file
   if (logging_destination != LOG_NONE &&
       logging_destination != LOG_ONLY_TO_SYSTEM_DEBUG_LOG) {
-    LoggingLock logging_lock;
-    if (InitializeLogFileHandle()) {
-#if defined(OS_WIN)
-      SetFilePointer(log_file, 0, 0, SEEK_END);
-      DWORD num_written;
-      WriteFile(log_file,
-                static_cast<const void*>(str_newline.c_str()),
-                static_cast<DWORD>(str_newline.length()),
-                &num_written,
-                NULL);
-#else
-      fprintf(log_file, "%s", str_newline.c_str());
-      fflush(log_file);
-#endif
+    if (async_log_file_writes && severity_ != LOG_FATAL) {
+      AppendToPendingLog(str_newline);
+    } else {
+      // What was logged before this message goes to the file before it, in
+      // particular before a FATAL message brings the process down.
+      FlushPendingLog(true);
+      LoggingLock logging_lock;
+      if (InitializeLogFileHandle())
+        WriteToLogFile(str_newline.data(), str_newline.size());
     }
   }
 
@@ -640,7 +813,7 @@ LogMessage::~LogMessage() {
     } else {
       if (log_assert_handler) {
         // make a copy of the string for the handler out of paranoia
-        log_assert_handler(std::string(stream_.str()));
+        log_assert_handler(message_buffer_.str());
       } else {
         // Don't use the string with the newline, get a fresh version to send to
         // the debug message process. We also don't display assertions to the
@@ -648,7 +821,7 @@ LogMessage::~LogMessage() {
         // information, and displaying message boxes when the application is
         // hosed can cause additional problems.
 #ifndef NDEBUG
-        DisplayDebugMessageInDialog(stream_.str());
+        DisplayDebugMessageInDialog(message_buffer_.str());
 #endif
         // Crash the process to generate a dump.
         base::debug::BreakDebugger();
@@ -657,9 +830,9 @@ LogMessage::~LogMessage() {
   } else if (severity_ == LOG_ERROR_REPORT) {
     // We are here only if the user runs with --enable-dcheck in release mode.
     if (log_report_handler) {
-      log_report_handler(std::string(stream_.str()));
+      log_report_handler(message_buffer_.str());
     } else {
-      DisplayDebugMessageInDialog(stream_.str());
+      DisplayDebugMessageInDialog(message_buffer_.str());
     }
   }
 }
@@ -705,7 +878,33 @@ void LogMessage::Init(const char* file, int line) {
 
   stream_ << ":" << filename << "(" << line << ")] ";
 
-  message_start_ = stream_.tellp();
+  message_start_ = message_buffer_.size();
+}
+
+LogMessage::MessageBuffer::MessageBuffer() {
+  setp(stack_buffer_, stack_buffer_ + kStackBufferSize);
+}
+
+std::string LogMessage::MessageBuffer::str() const {
+  std::string message;
+  message.reserve(size());
+  message.append(heap_buffer_);
+  message.append(pbase(), pptr() - pbase());
+  return message;
+}
+
+size_t LogMessage::MessageBuffer::size() const {
+  return heap_buffer_.size() + (pptr() - pbase());
+}
+
+LogMessage::MessageBuffer::int_type LogMessage::MessageBuffer::overflow(
+    int_type c) {
+  // The stack buffer is full, move what's in it to the heap and start over.
+  heap_buffer_.append(pbase(), pptr() - pbase());
+  if (!traits_type::eq_int_type(c, traits_type::eof()))
+    heap_buffer_.push_back(traits_type::to_char_type(c));
+  setp(stack_buffer_, stack_buffer_ + kStackBufferSize);
+  return traits_type::not_eof(c);
 }
 
 #if defined(OS_WIN)
@@ -797,6 +996,8 @@ ErrnoLogMessage::~ErrnoLogMessage() {
 #endif  // OS_WIN
 
 void CloseLogFile() {
+  FlushPendingLog(true);
+
   LoggingLock logging_lock;
 
   if (!log_file)
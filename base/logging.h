@@ -243,6 +243,47 @@ int GetVlogLevel(const char (&file)[N]) {
   return GetVlogLevelHelper(file, N);
 }
 
+// The vlog level of a translation unit, which VLOG_IS_ON() keeps so that it
+// doesn't match the file against the --vmodule patterns each time. It holds
+// the level of the first file of the unit asked for, which is the .cc file
+// itself unless a header it includes logs first; the others aren't cached.
+// The level is dropped when the logging settings change. It is a POD with no
+// constructor so that it needs no static initializer.
+struct VlogFileCache {
+  // The file, as an AtomicWord.
+  intptr_t file;
+  // The level and the settings it was read with, as an Atomic32.
+  int32 state;
+};
+
+// Returns the cache of the translation unit this is compiled in.
+static inline VlogFileCache* GetVlogFileCache() {
+  static VlogFileCache cache = { 0, 0 };
+  return &cache;
+}
+
+// Like GetVlogLevelHelper(), but returns the level kept in |cache| if it was
+// read for |file| with the current settings, and keeps it otherwise.
+BASE_EXPORT int GetCachedVlogLevelHelper(VlogFileCache* cache,
+                                         const char* file_start, size_t N);
+
+template <size_t N>
+int GetCachedVlogLevel(VlogFileCache* cache, const char (&file)[N]) {
+  return GetCachedVlogLevelHelper(cache, file, N);
+}
+
+// Makes the messages that go to the log file be written by a thread of their
+// own, in batches, rather than by the threads that log them. FATAL messages,
+// and what was logged before them, are still written before LogMessage
+// handles them, and the pending messages are written at exit, by
+// FlushLogFile(), CloseLogFile() and InitLogging(). Call it from the main
+// thread at startup, like InitLogging().
+BASE_EXPORT void SetAsyncLogFileWrites(bool enabled);
+
+// Writes the messages that SetAsyncLogFileWrites() left pending to the log
+// file now.
+BASE_EXPORT void FlushLogFile();
+
 // Sets the common items you want to be prepended to each log message.
 // process and thread IDs default to off, the timestamp defaults to on.
 // If this function is not called, logging defaults to writing the timestamp
@@ -345,12 +386,12 @@ const LogSeverity LOG_0 = LOG_ERROR;
 #define LOG_IS_ON(severity) \
   ((::logging::LOG_ ## severity) >= ::logging::GetMinLogLevel())
 
-// We can't do any caching tricks with VLOG_IS_ON() like the
-// google-glog version since it requires GCC extensions.  This means
-// that using the v-logging functions in conjunction with --vmodule
-// may be slow.
+// We can't cache the level of each VLOG_IS_ON() like the google-glog
+// version since it requires GCC extensions, so the level is cached for the
+// translation unit instead. See VlogFileCache.
 #define VLOG_IS_ON(verboselevel) \
-  ((verboselevel) <= ::logging::GetVlogLevel(__FILE__))
+  ((verboselevel) <= ::logging::GetCachedVlogLevel( \
+      ::logging::GetVlogFileCache(), __FILE__))
 
 // Helper macro which avoids evaluating the arguments to a stream if
 // the condition doesn't hold.
@@ -771,10 +812,37 @@ class BASE_EXPORT LogMessage {
   std::ostream& stream() { return stream_; }
 
  private:
+  // The streambuf of |stream_|. The message is written into a buffer inside
+  // it, which is on the stack with the LogMessage, and only goes to the heap
+  // past kStackBufferSize characters.
+  class MessageBuffer : public std::streambuf {
+   public:
+    MessageBuffer();
+
+    // Returns the message written so far.
+    std::string str() const;
+    size_t size() const;
+
+   protected:
+    virtual int_type overflow(int_type c);
+
+   private:
+    enum { kStackBufferSize = 512 };
+
+    char stack_buffer_[kStackBufferSize];
+
+    // What didn't fit in |stack_buffer_|, which the characters after it are
+    // moved to as it fills up.
+    std::string heap_buffer_;
+
+    DISALLOW_COPY_AND_ASSIGN(MessageBuffer);
+  };
+
   void Init(const char* file, int line);
 
   LogSeverity severity_;
-  std::ostringstream stream_;
+  MessageBuffer message_buffer_;
+  std::ostream stream_;
   size_t message_start_;  // Offset of the start of the message (past prefix
                           // info).
   // The file and line information passed in to the constructor.
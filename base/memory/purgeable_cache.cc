@@ -0,0 +1,59 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/purgeable_cache.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/synchronization/lock.h"
+
+namespace base {
+
+namespace {
+
+struct Registry {
+  // Held while the caches are purged, so that Unregister() waits for them.
+  Lock lock;
+  std::vector<PurgeableCache*> caches;
+};
+
+// Leaky, as caches that are statics may unregister at exit.
+LazyInstance<Registry, LeakyLazyInstanceTraits<Registry> > g_registry(
+    LINKER_INITIALIZED);
+
+}  // namespace
+
+// static
+void PurgeableCache::Register(PurgeableCache* cache) {
+  Registry* registry = g_registry.Pointer();
+  AutoLock lock(registry->lock);
+  DCHECK(std::find(registry->caches.begin(), registry->caches.end(), cache) ==
+         registry->caches.end());
+  registry->caches.push_back(cache);
+}
+
+// static
+void PurgeableCache::Unregister(PurgeableCache* cache) {
+  Registry* registry = g_registry.Pointer();
+  AutoLock lock(registry->lock);
+  std::vector<PurgeableCache*>::iterator i =
+      std::find(registry->caches.begin(), registry->caches.end(), cache);
+  if (i != registry->caches.end())
+    registry->caches.erase(i);
+}
+
+// static
+void PurgeableCache::PurgeAll(SystemMonitor::MemoryPressureLevel level) {
+  if (level == SystemMonitor::MEMORY_PRESSURE_NONE)
+    return;
+  Registry* registry = g_registry.Pointer();
+  AutoLock lock(registry->lock);
+  for (size_t i = 0; i < registry->caches.size(); ++i)
+    registry->caches[i]->PurgeMemory(level);
+}
+
+}  // namespace base
@@ -0,0 +1,44 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_MEMORY_PURGEABLE_CACHE_H_
+#define BASE_MEMORY_PURGEABLE_CACHE_H_
+#pragma once
+
+#include "base/base_export.h"
+#include "base/system_monitor/system_monitor.h"
+
+namespace base {
+
+// A cache whose memory can be freed, to be rebuilt later, when the system is
+// short of it. The caches register themselves, and are purged by the
+// SystemMonitor when the memory pressure rises, or by PurgeAll().
+//
+// Unlike the SystemMonitor's observers, the caches can register on any
+// thread, before the SystemMonitor or a MessageLoop exists, and are purged
+// synchronously on the thread that calls PurgeAll(), usually the
+// SystemMonitor's. PurgeMemory() must thus be thread safe. Unregister() waits
+// for the purges in progress, so that a cache can't be purged once deleted.
+class BASE_EXPORT PurgeableCache {
+ public:
+  // Frees the memory of the cache that can be rebuilt: what is least likely
+  // to be used again for MEMORY_PRESSURE_MODERATE, all of it for
+  // MEMORY_PRESSURE_CRITICAL. Must not register or unregister a cache.
+  virtual void PurgeMemory(SystemMonitor::MemoryPressureLevel level) = 0;
+
+  // Adds or removes |cache| from the caches purged. A cache must not be
+  // registered twice.
+  static void Register(PurgeableCache* cache);
+  static void Unregister(PurgeableCache* cache);
+
+  // Purges all the registered caches for |level|.
+  static void PurgeAll(SystemMonitor::MemoryPressureLevel level);
+
+ protected:
+  virtual ~PurgeableCache() {}
+};
+
+}  // namespace base
+
+#endif  // BASE_MEMORY_PURGEABLE_CACHE_H_
@@ -22,6 +22,8 @@
 
 #include "base/at_exit.h"
 #include "base/atomicops.h"
+#include "base/compiler_specific.h"
+#include "base/startup_instance_report.h"
 #include "base/third_party/dynamic_annotations/dynamic_annotations.h"
 #include "base/threading/platform_thread.h"
 #include "base/threading/thread_restrictions.h"
@@ -213,16 +215,23 @@ class Singleton {
     if (!Traits::kAllowedToAccessOnNonjoinableThread)
       base::ThreadRestrictions::AssertSingletonAllowed();
 
-    // Our AtomicWord doubles as a spinlock, where a value of
-    // kBeingCreatedMarker means the spinlock is being held for creation.
-    static const base::subtle::AtomicWord kBeingCreatedMarker = 1;
-
     base::subtle::AtomicWord value = base::subtle::NoBarrier_Load(&instance_);
     if (value != 0 && value != kBeingCreatedMarker) {
-      // See the corresponding HAPPENS_BEFORE below.
+      // See the corresponding HAPPENS_BEFORE in CreateInstance().
       ANNOTATE_HAPPENS_AFTER(&instance_);
       return reinterpret_cast<Type*>(value);
     }
+    return CreateInstance();
+  }
+
+  // Our AtomicWord doubles as a spinlock, where a value of
+  // kBeingCreatedMarker means the spinlock is being held for creation.
+  static const base::subtle::AtomicWord kBeingCreatedMarker = 1;
+
+  // The slow path of get(), which is out of line so that the load and compares
+  // of the fast path are all that is inlined where get() is used.
+  static NOINLINE Type* CreateInstance() {
+    base::subtle::AtomicWord value;
 
     // Object isn't created yet, maybe we will get to create it, let's try...
     if (base::subtle::Acquire_CompareAndSwap(&instance_,
@@ -231,7 +240,12 @@ class Singleton {
       // instance_ was NULL and is now kBeingCreatedMarker.  Only one thread
       // will ever get here.  Threads might be spinning on us, and they will
       // stop right after we do this store.
-      Type* newval = Traits::New();
+      Type* newval;
+      {
+        base::internal::ScopedInstanceCreation creation(
+            BASE_INSTANCE_CREATION_NAME);
+        newval = Traits::New();
+      }
 
       // This annotation helps race detectors recognize correct lock-less
       // synchronization between different threads calling get().
@@ -0,0 +1,262 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/task_allocator.h"
+
+#include <new>
+
+#include "base/atomicops.h"
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread_local_storage.h"
+
+namespace base {
+
+namespace {
+
+// The blocks are cached in sizes that are multiples of kGranularity, up to
+// kMaxCachedSize, which is more than the Tasks and bound arguments of the
+// tree take. A thread keeps at most kMaxCachedBlocks blocks of each size.
+const size_t kGranularity = 16;
+const size_t kMaxCachedSize = 256;
+const size_t kSizeCount = kMaxCachedSize / kGranularity;
+const int kMaxCachedBlocks = 64;
+
+// A thread's counts are moved into the Registry's when one of them reaches
+// this, so that they never overflow.
+const subtle::Atomic32 kMaxThreadCount = 1 << 30;
+
+// Returns the index of the size that blocks of |size| bytes are cached in.
+size_t GetSizeIndex(size_t size) {
+  DCHECK_GT(size, 0u);
+  DCHECK_LE(size, kMaxCachedSize);
+  return (size - 1) / kGranularity;
+}
+
+// A block in the cache, which holds the link to the next one of its size.
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+// The blocks, and the counts, of a thread. Only the thread writes them, but
+// GetStats() reads the counts from other threads, so they are Atomic32s.
+struct ThreadCache {
+  ThreadCache()
+      : allocations(0),
+        cache_hits(0),
+        frees(0),
+        cached_frees(0),
+        uncached_allocations(0),
+        next(NULL) {
+    for (size_t i = 0; i < kSizeCount; ++i) {
+      blocks[i] = NULL;
+      block_counts[i] = 0;
+    }
+  }
+
+  ~ThreadCache() {
+    for (size_t i = 0; i < kSizeCount; ++i) {
+      while (blocks[i]) {
+        FreeBlock* block = blocks[i];
+        blocks[i] = block->next;
+        ::operator delete(block);
+      }
+    }
+  }
+
+  int64 GetCachedBytes() const {
+    int64 bytes = 0;
+    for (size_t i = 0; i < kSizeCount; ++i) {
+      bytes += static_cast<int64>(subtle::NoBarrier_Load(&block_counts[i])) *
+          (i + 1) * kGranularity;
+    }
+    return bytes;
+  }
+
+  FreeBlock* blocks[kSizeCount];
+  subtle::Atomic32 block_counts[kSizeCount];
+
+  // The counts of TaskAllocator::Stats, since they were last moved into the
+  // Registry's.
+  subtle::Atomic32 allocations;
+  subtle::Atomic32 cache_hits;
+  subtle::Atomic32 frees;
+  subtle::Atomic32 cached_frees;
+  subtle::Atomic32 uncached_allocations;
+
+  // The next cache in the list of Registry.
+  ThreadCache* next;
+};
+
+void OnThreadExit(void* value);
+
+// Set in the slot of a thread once its cache is freed, so that what it
+// allocates and frees from then on goes to the heap.
+ThreadCache* const kCacheFreed = reinterpret_cast<ThreadCache*>(1);
+
+// The list of the caches of the threads, which GetStats() reads, and the
+// counts moved out of them: all those of the threads that have exited, and
+// the large ones of the others.
+struct Registry {
+  Registry() : first(NULL), slot(&OnThreadExit) {
+  }
+
+  Lock lock;
+  ThreadCache* first;
+  TaskAllocator::Stats moved_stats;
+  ThreadLocalStorage::Slot slot;
+};
+
+// Leaky, as tasks may be deleted by the destructors of other statics.
+LazyInstance<Registry, LeakyLazyInstanceTraits<Registry> > g_registry(
+    LINKER_INITIALIZED);
+
+// Adds the counts of |cache| to |to|.
+void AddCounts(const ThreadCache& cache, TaskAllocator::Stats* to) {
+  to->allocations += subtle::NoBarrier_Load(&cache.allocations);
+  to->cache_hits += subtle::NoBarrier_Load(&cache.cache_hits);
+  to->frees += subtle::NoBarrier_Load(&cache.frees);
+  to->cached_frees += subtle::NoBarrier_Load(&cache.cached_frees);
+  to->uncached_allocations +=
+      subtle::NoBarrier_Load(&cache.uncached_allocations);
+}
+
+// Moves the counts of |cache|, the current thread's, into the Registry's.
+void MoveCounts(ThreadCache* cache) {
+  Registry* registry = g_registry.Pointer();
+  AutoLock lock(registry->lock);
+  AddCounts(*cache, &registry->moved_stats);
+  subtle::NoBarrier_Store(&cache->allocations, 0);
+  subtle::NoBarrier_Store(&cache->cache_hits, 0);
+  subtle::NoBarrier_Store(&cache->frees, 0);
+  subtle::NoBarrier_Store(&cache->cached_frees, 0);
+  subtle::NoBarrier_Store(&cache->uncached_allocations, 0);
+}
+
+// Adds |delta| to |count|, which only the current thread writes, so this
+// needs no locked instruction.
+void AddToCount(subtle::Atomic32* count, subtle::Atomic32 delta) {
+  subtle::NoBarrier_Store(count, subtle::NoBarrier_Load(count) + delta);
+}
+
+// Counts one more in |count|, one of those of |cache|, the current thread's.
+void Increment(ThreadCache* cache, subtle::Atomic32* count) {
+  AddToCount(count, 1);
+  if (subtle::NoBarrier_Load(count) >= kMaxThreadCount)
+    MoveCounts(cache);
+}
+
+// Returns the cache of the current thread, or NULL if it has been freed.
+ThreadCache* GetThreadCache() {
+  Registry* registry = g_registry.Pointer();
+  ThreadCache* cache = static_cast<ThreadCache*>(registry->slot.Get());
+  if (cache == kCacheFreed)
+    return NULL;
+  if (!cache) {
+    cache = new ThreadCache;
+    AutoLock lock(registry->lock);
+    cache->next = registry->first;
+    registry->first = cache;
+    registry->slot.Set(cache);
+  }
+  return cache;
+}
+
+void OnThreadExit(void* value) {
+  ThreadCache* cache = static_cast<ThreadCache*>(value);
+  if (!cache || cache == kCacheFreed)
+    return;
+  Registry* registry = g_registry.Pointer();
+  {
+    AutoLock lock(registry->lock);
+    ThreadCache** link = &registry->first;
+    while (*link != cache)
+      link = &(*link)->next;
+    *link = cache->next;
+    AddCounts(*cache, &registry->moved_stats);
+  }
+  registry->slot.Set(kCacheFreed);
+  delete cache;
+}
+
+}  // namespace
+
+TaskAllocator::Stats::Stats()
+    : allocations(0),
+      cache_hits(0),
+      frees(0),
+      cached_frees(0),
+      uncached_allocations(0),
+      cached_bytes(0),
+      threads(0) {
+}
+
+// static
+void* TaskAllocator::Allocate(size_t size) {
+  ThreadCache* cache = GetThreadCache();
+  if (size == 0 || size > kMaxCachedSize) {
+    if (cache) {
+      Increment(cache, &cache->allocations);
+      Increment(cache, &cache->uncached_allocations);
+    }
+    return ::operator new(size);
+  }
+
+  // The blocks are always of the size they are cached in, since any thread
+  // may cache them when they are freed.
+  size_t index = GetSizeIndex(size);
+  if (!cache)
+    return ::operator new((index + 1) * kGranularity);
+  Increment(cache, &cache->allocations);
+  FreeBlock* block = cache->blocks[index];
+  if (!block)
+    return ::operator new((index + 1) * kGranularity);
+  Increment(cache, &cache->cache_hits);
+  cache->blocks[index] = block->next;
+  AddToCount(&cache->block_counts[index], -1);
+  return block;
+}
+
+// static
+void TaskAllocator::Free(void* block, size_t size) {
+  if (!block)
+    return;
+  ThreadCache* cache = GetThreadCache();
+  if (!cache) {
+    ::operator delete(block);
+    return;
+  }
+  Increment(cache, &cache->frees);
+  if (size == 0 || size > kMaxCachedSize) {
+    ::operator delete(block);
+    return;
+  }
+
+  size_t index = GetSizeIndex(size);
+  if (subtle::NoBarrier_Load(&cache->block_counts[index]) >=
+      kMaxCachedBlocks) {
+    ::operator delete(block);
+    return;
+  }
+  Increment(cache, &cache->cached_frees);
+  FreeBlock* free_block = static_cast<FreeBlock*>(block);
+  free_block->next = cache->blocks[index];
+  cache->blocks[index] = free_block;
+  AddToCount(&cache->block_counts[index], 1);
+}
+
+// static
+void TaskAllocator::GetStats(Stats* stats) {
+  Registry* registry = g_registry.Pointer();
+  AutoLock lock(registry->lock);
+  *stats = registry->moved_stats;
+  for (ThreadCache* cache = registry->first; cache; cache = cache->next) {
+    AddCounts(*cache, stats);
+    stats->cached_bytes += cache->GetCachedBytes();
+    ++stats->threads;
+  }
+}
+
+}  // namespace base
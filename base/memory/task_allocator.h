@@ -0,0 +1,68 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_MEMORY_TASK_ALLOCATOR_H_
+#define BASE_MEMORY_TASK_ALLOCATOR_H_
+#pragma once
+
+#include <stddef.h>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+
+namespace base {
+
+// TaskAllocator gives out the memory of the objects that live as long as a
+// posted task: the Tasks themselves, and the storage of the arguments bound
+// by base::Bind(). They are small, made at a high rate and deleted as soon as
+// the task has run, so rather than going to the heap, and its lock, for each
+// of them, the blocks they are freed into are kept in a cache of the thread
+// that freed them, for the next ones of that size made on the thread.
+//
+// A thread caches a bounded number of blocks of each size, the others go back
+// to the heap. The cache of a thread is freed when the thread exits. Task and
+// internal::InvokerStorageBase allocate through here with their operator new.
+class BASE_EXPORT TaskAllocator {
+ public:
+  // How the allocations have gone so far, over all threads.
+  struct BASE_EXPORT Stats {
+    Stats();
+
+    // The number of allocations, and how many of them were given a block
+    // cached by their thread.
+    int64 allocations;
+    int64 cache_hits;
+
+    // The number of blocks freed, and how many of them were kept in the cache
+    // of the thread that freed them.
+    int64 frees;
+    int64 cached_frees;
+
+    // The number of allocations too large to be cached.
+    int64 uncached_allocations;
+
+    // The sum of the sizes of the blocks in the caches now.
+    int64 cached_bytes;
+
+    // The number of threads with a cache now.
+    int threads;
+  };
+
+  // Returns a block of at least |size| bytes, and frees one that was returned
+  // for |size|. The block may be freed on a thread other than the one it was
+  // allocated on.
+  static void* Allocate(size_t size);
+  static void Free(void* block, size_t size);
+
+  // Returns the counts of all threads. The counts of the threads that are
+  // running aren't synchronized with, so they may be a little behind.
+  static void GetStats(Stats* stats);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(TaskAllocator);
+};
+
+}  // namespace base
+
+#endif  // BASE_MEMORY_TASK_ALLOCATOR_H_
@@ -5,7 +5,9 @@
 #include "base/message_loop.h"
 
 #include <algorithm>
+#include <functional>
 
+#include "base/atomicops.h"
 #include "base/bind.h"
 #include "base/compiler_specific.h"
 #include "base/debug/alias.h"
@@ -15,6 +17,7 @@
 #include "base/message_loop_proxy_impl.h"
 #include "base/message_pump_default.h"
 #include "base/metrics/histogram.h"
+#include "base/metrics/task_timing_recorder.h"
 #include "base/third_party/dynamic_annotations/dynamic_annotations.h"
 #include "base/threading/thread_local.h"
 #include "base/time.h"
@@ -44,6 +47,20 @@ namespace {
 base::LazyInstance<base::ThreadLocalPointer<MessageLoop> > lazy_tls_ptr(
     base::LINKER_INITIALIZED);
 
+#if defined(BASE_COMPILER_THREAD_LOCAL)
+// The same pointer as |lazy_tls_ptr|, which current() reads instead where it
+// can, as it is called for every task posted.
+BASE_COMPILER_THREAD_LOCAL MessageLoop* g_current_message_loop = NULL;
+#endif
+
+void SetCurrentMessageLoop(MessageLoop* loop) {
+  lazy_tls_ptr.Pointer()->Set(loop);
+#if defined(BASE_COMPILER_THREAD_LOCAL)
+  if (base::CompilerThreadLocalIsUsable())
+    g_current_message_loop = loop;
+#endif
+}
+
 // Logical events for Histogram profiling. Run with -message-loop-histogrammer
 // to get an accounting of messages and actions taken on each thread.
 const int kTaskRunEvent = 0x1;
@@ -83,8 +100,30 @@ const base::LinearHistogram::DescriptionPair event_descriptions_[] = {
 
 bool enable_histogrammer_ = false;
 
+bool enable_task_timing_histograms_ = false;
+
+bool enable_lock_free_incoming_queue_ = true;
+
+// Read by every MessageLoop thread and written by the SystemMonitor thread.
+base::subtle::Atomic32 g_enable_timer_coalescing = 0;
+
 MessageLoop::MessagePumpFactory* message_pump_for_ui_factory_ = NULL;
 
+// AddToDelayedWorkQueue() purges the cancelled delayed tasks when there are
+// twice as many tasks as after the last purge, and at least this many.
+const size_t kMinDelayedWorkQueuePurgeSize = 64;
+
+// The TaskTimingRecorder names of the MessageLoop::TaskPriority values.
+const char* const kTaskPriorityNames[] = {
+  "UrgentPriority",
+  "NormalPriority",
+  "IdlePriority",
+};
+
+COMPILE_ASSERT(arraysize(kTaskPriorityNames) ==
+                   MessageLoop::NUM_TASK_PRIORITIES,
+               task_priority_names_mismatch);
+
 }  // namespace
 
 //------------------------------------------------------------------------------
@@ -124,9 +163,20 @@ MessageLoop::DestructionObserver::~DestructionObserver() {
 
 MessageLoop::MessageLoop(Type type)
     : type_(type),
+      urgent_tasks_in_a_row_(0),
+      delayed_work_queue_purge_size_(kMinDelayedWorkQueuePurgeSize),
+      task_depth_(0),
       nestable_tasks_allowed_(true),
       exception_restoration_(false),
       message_histogram_(NULL),
+      incoming_queue_has_priorities_(false),
+      lock_free_incoming_queue_(enable_lock_free_incoming_queue_),
+      incoming_head_(0),
+      incoming_posts_(0),
+      incoming_contended_(0),
+      incoming_reloads_(0),
+      incoming_tasks_reloaded_(0),
+      incoming_urgent_tasks_(0),
       state_(NULL),
       should_leak_tasks_(true),
 #ifdef OS_WIN
@@ -134,7 +184,7 @@ MessageLoop::MessageLoop(Type type)
 #endif  // OS_WIN
       next_sequence_num_(0) {
   DCHECK(!current()) << "should only have one message loop per thread";
-  lazy_tls_ptr.Pointer()->Set(this);
+  SetCurrentMessageLoop(this);
 
   message_loop_proxy_ = new base::MessageLoopProxyImpl();
 
@@ -211,7 +261,7 @@ MessageLoop::~MessageLoop() {
   message_loop_proxy_ = NULL;
 
   // OK, now make it so that no one can find us.
-  lazy_tls_ptr.Pointer()->Set(NULL);
+  SetCurrentMessageLoop(NULL);
 
 #if defined(OS_WIN)
   // If we left the high-resolution timer activated, deactivate it now.
@@ -229,6 +279,10 @@ MessageLoop* MessageLoop::current() {
   // TODO(darin): sadly, we cannot enable this yet since people call us even
   // when they have no intention of using us.
   // DCHECK(loop) << "Ouch, did you forget to initialize me?";
+#if defined(BASE_COMPILER_THREAD_LOCAL)
+  if (base::CompilerThreadLocalIsUsable())
+    return g_current_message_loop;
+#endif
   return lazy_tls_ptr.Pointer()->Get();
 }
 
@@ -237,6 +291,21 @@ void MessageLoop::EnableHistogrammer(bool enable) {
   enable_histogrammer_ = enable;
 }
 
+// static
+void MessageLoop::EnableTaskTimingHistograms(bool enable) {
+  enable_task_timing_histograms_ = enable;
+}
+
+// static
+void MessageLoop::EnableLockFreeIncomingQueue(bool enable) {
+  enable_lock_free_incoming_queue_ = enable;
+}
+
+// static
+void MessageLoop::EnableTimerCoalescing(bool enable) {
+  base::subtle::NoBarrier_Store(&g_enable_timer_coalescing, enable ? 1 : 0);
+}
+
 // static
 void MessageLoop::InitMessagePumpForUIFactory(MessagePumpFactory* factory) {
   DCHECK(!message_pump_for_ui_factory_);
@@ -335,6 +404,75 @@ void MessageLoop::PostNonNestableDelayedTask(
   AddToIncomingQueue(&pending_task);
 }
 
+void MessageLoop::PostTask(
+    const tracked_objects::Location& from_here, const base::Closure& task,
+    const scoped_refptr<base::CancellationToken>& cancellation_token) {
+  CHECK(!task.is_null());
+  PendingTask pending_task(task, from_here, CalculateDelayedRuntime(0), true);
+  pending_task.cancellation_token = cancellation_token;
+  AddToIncomingQueue(&pending_task);
+}
+
+void MessageLoop::PostDelayedTask(
+    const tracked_objects::Location& from_here, const base::Closure& task,
+    int64 delay_ms,
+    const scoped_refptr<base::CancellationToken>& cancellation_token) {
+  CHECK(!task.is_null());
+  PendingTask pending_task(task, from_here,
+                           CalculateDelayedRuntime(delay_ms), true);
+  pending_task.cancellation_token = cancellation_token;
+  AddToIncomingQueue(&pending_task);
+}
+
+void MessageLoop::PostTaskWithPriority(
+    const tracked_objects::Location& from_here, const base::Closure& task,
+    TaskPriority priority) {
+  CHECK(!task.is_null());
+  DCHECK_GE(priority, 0);
+  DCHECK_LT(priority, NUM_TASK_PRIORITIES);
+  PendingTask pending_task(task, from_here, CalculateDelayedRuntime(0), true);
+  pending_task.priority = priority;
+  AddToIncomingQueue(&pending_task);
+}
+
+void MessageLoop::ScheduleTimerWheelEntry(base::TimerWheel::Entry* entry,
+                                          int64 delay_ms) {
+  DCHECK_EQ(this, current());
+  TimeTicks run_time = CalculateDelayedRuntime(delay_ms);
+  if (run_time.is_null())
+    run_time = TimeTicks::Now();
+  ScheduleTimerWheelEntryAt(entry, run_time);
+}
+
+void MessageLoop::ScheduleDeferrableTimerWheelEntry(
+    base::TimerWheel::Entry* entry,
+    int64 delay_ms,
+    int64 tolerance_ms) {
+  DCHECK_EQ(this, current());
+  if (!base::subtle::NoBarrier_Load(&g_enable_timer_coalescing) ||
+      tolerance_ms <= 0) {
+    ScheduleTimerWheelEntry(entry, delay_ms);
+    return;
+  }
+  // The multiples of the tolerance are counted from the same origin in all
+  // the loops, so that their timers line up.
+  int64 run_time_us =
+      (TimeTicks::Now() + TimeDelta::FromMilliseconds(delay_ms))
+          .ToInternalValue();
+  int64 tolerance_us = tolerance_ms * base::Time::kMicrosecondsPerMillisecond;
+  run_time_us = (run_time_us + tolerance_us - 1) / tolerance_us * tolerance_us;
+  ScheduleTimerWheelEntryAt(entry, TimeTicks::FromInternalValue(run_time_us));
+}
+
+void MessageLoop::ScheduleTimerWheelEntryAt(base::TimerWheel::Entry* entry,
+                                            TimeTicks run_time) {
+  TimeTicks previous_next_run_time = GetNextDelayedWorkTime();
+  timer_wheel_.Schedule(entry, run_time);
+  // If this is now the first thing due, the pump has to wake up earlier.
+  if (previous_next_run_time.is_null() || run_time < previous_next_run_time)
+    pump_->ScheduleDelayedWork(run_time);
+}
+
 void MessageLoop::Run() {
   AutoRunState save_state(this);
   RunHandler();
@@ -374,6 +512,20 @@ void MessageLoop::SetNestableTasksAllowed(bool allowed) {
   }
 }
 
+base::TimeTicks MessageLoop::GetCachedNow() {
+  if (!task_depth_)
+    return TimeTicks::Now();
+  if (cached_now_.is_null())
+    cached_now_ = TimeTicks::Now();
+  return cached_now_;
+}
+
+// static
+base::TimeTicks MessageLoop::CachedNow() {
+  MessageLoop* loop = current();
+  return loop ? loop->GetCachedNow() : TimeTicks::Now();
+}
+
 bool MessageLoop::NestableTasksAllowed() const {
   return nestable_tasks_allowed_;
 }
@@ -392,8 +544,24 @@ void MessageLoop::RemoveTaskObserver(TaskObserver* task_observer) {
   task_observers_.RemoveObserver(task_observer);
 }
 
+MessageLoop::IncomingQueueStats MessageLoop::GetIncomingQueueStats() const {
+  IncomingQueueStats stats;
+  stats.posts = base::subtle::NoBarrier_Load(&incoming_posts_);
+  stats.contended = base::subtle::NoBarrier_Load(&incoming_contended_);
+  stats.reloads = base::subtle::NoBarrier_Load(&incoming_reloads_);
+  stats.tasks_reloaded =
+      base::subtle::NoBarrier_Load(&incoming_tasks_reloaded_);
+  stats.lock_free = lock_free_incoming_queue_;
+  return stats;
+}
+
 void MessageLoop::AssertIdle() const {
-  // We only check |incoming_queue_|, since we don't want to lock |work_queue_|.
+  // We only check the incoming queue, since we don't want to lock
+  // |work_queue_|.
+  if (lock_free_incoming_queue_) {
+    DCHECK(!base::subtle::Acquire_Load(&incoming_head_));
+    return;
+  }
   base::AutoLock lock(incoming_queue_lock_);
   DCHECK(incoming_queue_.empty());
 }
@@ -447,6 +615,9 @@ bool MessageLoop::ProcessNextDelayedNonNestableTask() {
   if (state_->run_depth != 1)
     return false;
 
+  while (!deferred_non_nestable_work_queue_.empty() &&
+         deferred_non_nestable_work_queue_.front().IsCancelled())
+    deferred_non_nestable_work_queue_.pop();
   if (deferred_non_nestable_work_queue_.empty())
     return false;
 
@@ -473,7 +644,28 @@ void MessageLoop::RunTask(const PendingTask& pending_task) {
   HistogramEvent(kTaskRunEvent);
   FOR_EACH_OBSERVER(TaskObserver, task_observers_,
                     WillProcessTask(pending_task.time_posted));
+  TimeTicks start_time;
+  if (task_timing_recorder_.get())
+    start_time = TimeTicks::Now();
+  // A task run in a nested loop ends the cache of the task that nested it,
+  // which then reads the clock again.
+  cached_now_ = TimeTicks();
+  ++task_depth_;
   pending_task.task.Run();
+  --task_depth_;
+  cached_now_ = TimeTicks();
+  if (task_timing_recorder_.get()) {
+    // Delayed tasks only start queueing once their run time has come.
+    TimeTicks runnable_time = pending_task.delayed_run_time.is_null() ?
+        pending_task.time_posted : pending_task.delayed_run_time;
+    task_timing_recorder_->RecordTask(
+        tracked_objects::Location(pending_task.posted_from_function,
+                                  pending_task.posted_from_file,
+                                  pending_task.posted_from_line,
+                                  pending_task.birth_program_counter),
+        kTaskPriorityNames[pending_task.priority],
+        runnable_time, start_time, TimeTicks::Now());
+  }
   FOR_EACH_OBSERVER(TaskObserver, task_observers_,
                     DidProcessTask(pending_task.time_posted));
 
@@ -501,6 +693,39 @@ bool MessageLoop::DeferOrRunPendingTask(
   return false;
 }
 
+void MessageLoop::RunTimerWheelEntry(base::TimerWheel::Entry* entry) {
+  DCHECK(nestable_tasks_allowed_);
+  nestable_tasks_allowed_ = false;
+
+  // Timers are reported to observers as if they had been posted when they
+  // were last scheduled.
+  TimeTicks time_posted = entry->time_scheduled();
+
+  HistogramEvent(kTimerEvent);
+  FOR_EACH_OBSERVER(TaskObserver, task_observers_,
+                    WillProcessTask(time_posted));
+  // |entry| may delete itself while firing.
+  cached_now_ = TimeTicks();
+  ++task_depth_;
+  entry->Fire();
+  --task_depth_;
+  cached_now_ = TimeTicks();
+  FOR_EACH_OBSERVER(TaskObserver, task_observers_,
+                    DidProcessTask(time_posted));
+
+  nestable_tasks_allowed_ = true;
+}
+
+TimeTicks MessageLoop::GetNextDelayedWorkTime() const {
+  TimeTicks next_run_time = timer_wheel_.NextWakeupTime();
+  if (!delayed_work_queue_.empty()) {
+    TimeTicks queue_run_time = delayed_work_queue_.top().delayed_run_time;
+    if (next_run_time.is_null() || queue_run_time < next_run_time)
+      next_run_time = queue_run_time;
+  }
+  return next_run_time;
+}
+
 void MessageLoop::AddToDelayedWorkQueue(const PendingTask& pending_task) {
   // Move to the delayed work queue.  Initialize the sequence number
   // before inserting into the delayed_work_queue_.  The sequence number
@@ -509,28 +734,142 @@ void MessageLoop::AddToDelayedWorkQueue(const PendingTask& pending_task) {
   PendingTask new_pending_task(pending_task);
   new_pending_task.sequence_num = next_sequence_num_++;
   delayed_work_queue_.push(new_pending_task);
+
+  if (delayed_work_queue_.size() >= delayed_work_queue_purge_size_) {
+    delayed_work_queue_.RemoveCancelledTasks();
+    delayed_work_queue_purge_size_ = std::max(kMinDelayedWorkQueuePurgeSize,
+                                              2 * delayed_work_queue_.size());
+  }
 }
 
 void MessageLoop::ReloadWorkQueue() {
   // We can improve performance of our loading tasks from incoming_queue_ to
   // work_queue_ by waiting until the last minute (work_queue_ is empty) to
   // load.  That reduces the number of locks-per-task significantly when our
-  // queues get large.
-  if (!work_queue_.empty())
+  // queues get large.  Urgent tasks can't wait for that.
+  if (!work_queue_.empty() &&
+      !base::subtle::NoBarrier_Load(&incoming_urgent_tasks_))
     return;  // Wait till we *really* need to lock and load.
 
-  // Acquire all we can from the inter-thread queue with one lock acquisition.
-  {
+  int reloaded = 0;
+  if (lock_free_incoming_queue_) {
+    reloaded = ReloadFromLockFreeQueue();
+    if (!reloaded)
+      return;
+  } else {
+    // Acquire all we can from the inter-thread queue with one lock
+    // acquisition.
     base::AutoLock lock(incoming_queue_lock_);
     if (incoming_queue_.empty())
       return;
-    incoming_queue_.Swap(&work_queue_);  // Constant time
+    reloaded = static_cast<int>(incoming_queue_.size());
+    if (work_queue_.empty() && !incoming_queue_has_priorities_) {
+      incoming_queue_.Swap(&work_queue_);  // Constant time
+    } else {
+      while (!incoming_queue_.empty()) {
+        AddToWorkQueue(incoming_queue_.front());
+        incoming_queue_.pop();
+      }
+    }
+    incoming_queue_has_priorities_ = false;
     DCHECK(incoming_queue_.empty());
   }
+
+  // Only this thread writes these counters, so plain stores are enough.
+  base::subtle::NoBarrier_Store(
+      &incoming_reloads_, base::subtle::NoBarrier_Load(&incoming_reloads_) + 1);
+  base::subtle::NoBarrier_Store(
+      &incoming_tasks_reloaded_,
+      base::subtle::NoBarrier_Load(&incoming_tasks_reloaded_) + reloaded);
+}
+
+int MessageLoop::ReloadFromLockFreeQueue() {
+  // Detach the whole list at once.  Producers only ever push, so there is no
+  // ABA hazard: once we own the list nobody else can touch its nodes.
+  IncomingTaskNode* node = reinterpret_cast<IncomingTaskNode*>(
+      base::subtle::NoBarrier_AtomicExchange(&incoming_head_, 0));
+  if (!node)
+    return 0;
+  // Pairs with the release in PushLockFree() so that the node contents are
+  // visible before we read them.
+  base::subtle::MemoryBarrier();
+
+  // The list is newest-first; reverse it to restore posting order.
+  IncomingTaskNode* reversed = NULL;
+  while (node) {
+    IncomingTaskNode* next = node->next;
+    node->next = reversed;
+    reversed = node;
+    node = next;
+  }
+
+  int count = 0;
+  while (reversed) {
+    IncomingTaskNode* next = reversed->next;
+    AddToWorkQueue(reversed->pending_task);
+    delete reversed;
+    reversed = next;
+    ++count;
+  }
+  return count;
+}
+
+void MessageLoop::AddToWorkQueue(const PendingTask& pending_task) {
+  switch (pending_task.priority) {
+    case URGENT_PRIORITY:
+      urgent_work_queue_.push(pending_task);
+      base::subtle::NoBarrier_AtomicIncrement(&incoming_urgent_tasks_, -1);
+      break;
+    case IDLE_PRIORITY:
+      idle_work_queue_.push(pending_task);
+      break;
+    default:
+      work_queue_.push(pending_task);
+      break;
+  }
+}
+
+MessageLoop::PendingTask MessageLoop::PopWorkQueue() {
+  bool urgent = !urgent_work_queue_.empty() &&
+      (work_queue_.empty() || urgent_tasks_in_a_row_ < kMaxUrgentTasksInARow);
+  TaskQueue* queue = urgent ? &urgent_work_queue_ : &work_queue_;
+  urgent_tasks_in_a_row_ = urgent ? urgent_tasks_in_a_row_ + 1 : 0;
+  PendingTask pending_task = queue->front();
+  queue->pop();
+  return pending_task;
+}
+
+void MessageLoop::PromoteStarvedIdleTasks() {
+  if (idle_work_queue_.empty())
+    return;
+  TimeTicks starved_time =
+      TimeTicks::Now() - TimeDelta::FromMilliseconds(kMaxIdleTaskDelayMs);
+  while (!idle_work_queue_.empty() &&
+         idle_work_queue_.front().time_posted <= starved_time) {
+    work_queue_.push(idle_work_queue_.front());
+    idle_work_queue_.pop();
+  }
+}
+
+bool MessageLoop::ProcessNextIdleTask() {
+  if (!nestable_tasks_allowed_)
+    return false;
+
+  while (!idle_work_queue_.empty() && idle_work_queue_.front().IsCancelled())
+    idle_work_queue_.pop();
+  if (idle_work_queue_.empty())
+    return false;
+
+  PendingTask pending_task = idle_work_queue_.front();
+  idle_work_queue_.pop();
+
+  RunTask(pending_task);
+  return true;
 }
 
 bool MessageLoop::DeletePendingTasks() {
-  bool did_work = !work_queue_.empty();
+  bool did_work = !work_queue_.empty() || !urgent_work_queue_.empty() ||
+      !idle_work_queue_.empty();
   // TODO(darin): Delete all tasks once it is safe to do so.
   // Until it is totally safe, just do it when running Valgrind.
   //
@@ -552,6 +891,10 @@ bool MessageLoop::DeletePendingTasks() {
       AddToDelayedWorkQueue(pending_task);
     }
   }
+  while (!urgent_work_queue_.empty())
+    urgent_work_queue_.pop();
+  while (!idle_work_queue_.empty())
+    idle_work_queue_.pop();
   did_work |= !deferred_non_nestable_work_queue_.empty();
   while (!deferred_non_nestable_work_queue_.empty()) {
     deferred_non_nestable_work_queue_.pop();
@@ -616,24 +959,58 @@ void MessageLoop::AddToIncomingQueue(PendingTask* pending_task) {
   // directly, as it could starve handling of foreign threads.  Put every task
   // into this queue.
 
-  scoped_refptr<base::MessagePump> pump;
-  {
-    base::AutoLock locked(incoming_queue_lock_);
+  // Since the incoming queue may contain a task that destroys this message
+  // loop, we cannot touch |this| once the task has been published.  Take a
+  // stack-based reference to the message pump first so that we can call
+  // ScheduleWork afterwards (and outside of incoming_queue_lock_ on the locked
+  // path).
+  scoped_refptr<base::MessagePump> pump = pump_;
+
+  base::subtle::NoBarrier_AtomicIncrement(&incoming_posts_, 1);
+  // Counted before the task is published, after which |this| may be gone.
+  if (pending_task->priority == URGENT_PRIORITY)
+    base::subtle::NoBarrier_AtomicIncrement(&incoming_urgent_tasks_, 1);
+  bool was_empty = lock_free_incoming_queue_ ? PushLockFree(pending_task) :
+                                               PushLocked(pending_task);
+  if (!was_empty)
+    return;  // Someone else should have started the sub-pump.
 
-    bool was_empty = incoming_queue_.empty();
-    incoming_queue_.push(*pending_task);
-    pending_task->task.Reset();
-    if (!was_empty)
-      return;  // Someone else should have started the sub-pump.
+  pump->ScheduleWork();
+}
 
-    pump = pump_;
+bool MessageLoop::PushLockFree(PendingTask* pending_task) {
+  IncomingTaskNode* node = new IncomingTaskNode(*pending_task);
+  pending_task->task.Reset();
+
+  base::subtle::AtomicWord new_head =
+      reinterpret_cast<base::subtle::AtomicWord>(node);
+  base::subtle::AtomicWord old_head =
+      base::subtle::NoBarrier_Load(&incoming_head_);
+  for (;;) {
+    node->next = reinterpret_cast<IncomingTaskNode*>(old_head);
+    base::subtle::AtomicWord previous =
+        base::subtle::Release_CompareAndSwap(&incoming_head_, old_head,
+                                             new_head);
+    if (previous == old_head)
+      break;
+    old_head = previous;
+    base::subtle::NoBarrier_AtomicIncrement(&incoming_contended_, 1);
   }
-  // Since the incoming_queue_ may contain a task that destroys this message
-  // loop, we cannot exit incoming_queue_lock_ until we are done with |this|.
-  // We use a stack-based reference to the message pump so that we can call
-  // ScheduleWork outside of incoming_queue_lock_.
+  return old_head == 0;
+}
 
-  pump->ScheduleWork();
+bool MessageLoop::PushLocked(PendingTask* pending_task) {
+  if (!incoming_queue_lock_.Try()) {
+    base::subtle::NoBarrier_AtomicIncrement(&incoming_contended_, 1);
+    incoming_queue_lock_.Acquire();
+  }
+  bool was_empty = incoming_queue_.empty();
+  incoming_queue_.push(*pending_task);
+  if (pending_task->priority != NORMAL_PRIORITY)
+    incoming_queue_has_priorities_ = true;
+  pending_task->task.Reset();
+  incoming_queue_lock_.Release();
+  return was_empty;
 }
 
 //------------------------------------------------------------------------------
@@ -651,6 +1028,11 @@ void MessageLoop::StartHistogrammer() {
         message_histogram_->kHexRangePrintingFlag);
     message_histogram_->SetRangeDescriptions(event_descriptions_);
   }
+  if (enable_task_timing_histograms_ && !task_timing_recorder_.get() &&
+      base::StatisticsRecorder::IsActive()) {
+    task_timing_recorder_.reset(new base::TaskTimingRecorder(
+        thread_name_.empty() ? "Unnamed" : thread_name_));
+  }
 }
 
 void MessageLoop::HistogramEvent(int event) {
@@ -666,23 +1048,27 @@ bool MessageLoop::DoWork() {
 
   for (;;) {
     ReloadWorkQueue();
-    if (work_queue_.empty())
+    PromoteStarvedIdleTasks();
+    if (work_queue_.empty() && urgent_work_queue_.empty())
       break;
 
-    // Execute oldest task.
+    // Execute oldest urgent task, or oldest task.
     do {
-      PendingTask pending_task = work_queue_.front();
-      work_queue_.pop();
+      PendingTask pending_task = PopWorkQueue();
+      if (pending_task.IsCancelled())
+        continue;
       if (!pending_task.delayed_run_time.is_null()) {
         AddToDelayedWorkQueue(pending_task);
-        // If we changed the topmost task, then it is time to reschedule.
-        if (delayed_work_queue_.top().task.Equals(pending_task.task))
-          pump_->ScheduleDelayedWork(pending_task.delayed_run_time);
+        // If we changed the topmost task, then it is time to reschedule.  The
+        // purge in AddToDelayedWorkQueue() may have emptied the queue.
+        if (!delayed_work_queue_.empty() &&
+            delayed_work_queue_.top().task.Equals(pending_task.task))
+          pump_->ScheduleDelayedWork(GetNextDelayedWorkTime());
       } else {
         if (DeferOrRunPendingTask(pending_task))
           return true;
       }
-    } while (!work_queue_.empty());
+    } while (!work_queue_.empty() || !urgent_work_queue_.empty());
   }
 
   // Nothing happened.
@@ -690,11 +1076,17 @@ bool MessageLoop::DoWork() {
 }
 
 bool MessageLoop::DoDelayedWork(TimeTicks* next_delayed_work_time) {
-  if (!nestable_tasks_allowed_ || delayed_work_queue_.empty()) {
+  if (!nestable_tasks_allowed_ ||
+      (delayed_work_queue_.empty() && timer_wheel_.empty())) {
     recent_time_ = *next_delayed_work_time = TimeTicks();
     return false;
   }
 
+  // Cancelled tasks aren't waited for.
+  while (!delayed_work_queue_.empty() &&
+         delayed_work_queue_.top().IsCancelled())
+    delayed_work_queue_.pop();
+
   // When we "fall behind," there will be a lot of tasks in the delayed work
   // queue that are ready to run.  To increase efficiency when we fall behind,
   // we will only call Time::Now() intermittently, and then process all tasks
@@ -702,7 +1094,7 @@ bool MessageLoop::DoDelayedWork(TimeTicks* next_delayed_work_time) {
   // fall behind (and have a lot of ready-to-run delayed tasks), the more
   // efficient we'll be at handling the tasks.
 
-  TimeTicks next_run_time = delayed_work_queue_.top().delayed_run_time;
+  TimeTicks next_run_time = GetNextDelayedWorkTime();
   if (next_run_time > recent_time_) {
     recent_time_ = TimeTicks::Now();  // Get a better view of Now();
     if (next_run_time > recent_time_) {
@@ -711,11 +1103,25 @@ bool MessageLoop::DoDelayedWork(TimeTicks* next_delayed_work_time) {
     }
   }
 
+  // The timer wheel only reports a lower bound for entries that are far out,
+  // so being due does not guarantee that an entry has expired.
+  base::TimerWheel::Entry* entry = timer_wheel_.PopExpired(recent_time_);
+  if (entry) {
+    *next_delayed_work_time = GetNextDelayedWorkTime();
+    RunTimerWheelEntry(entry);
+    return true;
+  }
+
+  if (delayed_work_queue_.empty() ||
+      delayed_work_queue_.top().delayed_run_time > recent_time_) {
+    *next_delayed_work_time = GetNextDelayedWorkTime();
+    return false;
+  }
+
   PendingTask pending_task = delayed_work_queue_.top();
   delayed_work_queue_.pop();
 
-  if (!delayed_work_queue_.empty())
-    *next_delayed_work_time = delayed_work_queue_.top().delayed_run_time;
+  *next_delayed_work_time = GetNextDelayedWorkTime();
 
   return DeferOrRunPendingTask(pending_task);
 }
@@ -724,6 +1130,9 @@ bool MessageLoop::DoIdleWork() {
   if (ProcessNextDelayedNonNestableTask())
     return true;
 
+  if (ProcessNextIdleTask())
+    return true;
+
   if (state_->quit_received)
     pump_->Quit();
 
@@ -767,7 +1176,11 @@ MessageLoop::PendingTask::PendingTask(
       delayed_run_time(delayed_run_time),
       sequence_num(0),
       nestable(nestable),
-      birth_program_counter(posted_from.program_counter()) {
+      priority(NORMAL_PRIORITY),
+      birth_program_counter(posted_from.program_counter()),
+      posted_from_function(posted_from.function_name()),
+      posted_from_file(posted_from.file_name()),
+      posted_from_line(posted_from.line_number()) {
 #if defined(TRACK_ALL_TASK_OBJECTS)
   post_births = tracked_objects::ThreadData::TallyABirthIfActive(posted_from);
 #endif  // defined(TRACK_ALL_TASK_OBJECTS)
@@ -792,6 +1205,20 @@ bool MessageLoop::PendingTask::operator<(const PendingTask& other) const {
   return (sequence_num - other.sequence_num) > 0;
 }
 
+bool MessageLoop::PendingTask::IsCancelled() const {
+  return cancellation_token.get() && cancellation_token->IsCancelled();
+}
+
+//------------------------------------------------------------------------------
+// MessageLoop::DelayedTaskQueue
+
+void MessageLoop::DelayedTaskQueue::RemoveCancelledTasks() {
+  c.erase(std::remove_if(c.begin(), c.end(),
+                         std::mem_fun_ref(&PendingTask::IsCancelled)),
+          c.end());
+  std::make_heap(c.begin(), c.end(), comp);
+}
+
 //------------------------------------------------------------------------------
 // MessageLoopForUI
 
@@ -799,6 +1226,10 @@ bool MessageLoop::PendingTask::operator<(const PendingTask& other) const {
 void MessageLoopForUI::DidProcessMessage(const MSG& message) {
   pump_win()->DidProcessMessage(message);
 }
+
+void MessageLoopForUI::SetWorkBatchTimeSlice(base::TimeDelta time_slice) {
+  pump_ui()->set_work_batch_time_slice(time_slice);
+}
 #endif  // defined(OS_WIN)
 
 #if defined(OS_ANDROID)
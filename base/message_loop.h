@@ -9,17 +9,21 @@
 #include <queue>
 #include <string>
 
+#include "base/atomicops.h"
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "base/callback.h"
+#include "base/cancellation_token.h"
 #include "base/location.h"
 #include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/message_loop_proxy.h"
 #include "base/message_pump.h"
 #include "base/observer_list.h"
 #include "base/synchronization/lock.h"
 #include "base/task.h"
 #include "base/time.h"
+#include "base/timer_wheel.h"
 
 #if defined(OS_WIN)
 // We need this to declare base::MessagePumpWin::Dispatcher, which we should
@@ -42,6 +46,7 @@
 
 namespace base {
 class Histogram;
+class TaskTimingRecorder;
 }
 
 #if defined(TRACK_ALL_TASK_OBJECTS)
@@ -120,6 +125,24 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
 
   static void EnableHistogrammer(bool enable_histogrammer);
 
+  // Enables per-task queue delay and run time histograms, overall and per
+  // posting site, for MessageLoops that start running after this call.  See
+  // base::TaskTimingRecorder for the histogram names.  Like the histogrammer
+  // this requires an active StatisticsRecorder.
+  static void EnableTaskTimingHistograms(bool enable);
+
+  // Selects the incoming queue implementation used by MessageLoops created
+  // after this call.  When enabled (the default), PostTask pushes onto a
+  // lock-free multi-producer list that the owning thread detaches in a single
+  // atomic exchange.  When disabled, the legacy locked TaskQueue::Swap path is
+  // used.  Both paths maintain IncomingQueueStats so they can be compared.
+  static void EnableLockFreeIncomingQueue(bool enable);
+
+  // Enables the coalescing of the deferrable timers of all the MessageLoops;
+  // see ScheduleDeferrableTimerWheelEntry(). The SystemMonitor enables it
+  // while the computer is on battery power. May be called on any thread.
+  static void EnableTimerCoalescing(bool enable);
+
   typedef base::MessagePump* (MessagePumpFactory)();
   // Using the given base::MessagePumpForUIFactory to override the default
   // MessagePump implementation for 'TYPE_UI'.
@@ -201,11 +224,77 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
       const tracked_objects::Location& from_here,
       const base::Closure& task, int64 delay_ms);
 
+  // Like PostTask and PostDelayedTask, for a task that is dropped instead of
+  // run once |cancellation_token| is cancelled; see base::CancellationToken.
+  void PostTask(
+      const tracked_objects::Location& from_here,
+      const base::Closure& task,
+      const scoped_refptr<base::CancellationToken>& cancellation_token);
+
+  void PostDelayedTask(
+      const tracked_objects::Location& from_here,
+      const base::Closure& task, int64 delay_ms,
+      const scoped_refptr<base::CancellationToken>& cancellation_token);
+
+  // The classes of PostTaskWithPriority().  Tasks of the same priority run in
+  // FIFO order.
+  enum TaskPriority {
+    // Input and paint work.  Runs before the normal tasks that are already
+    // queued, but at most kMaxUrgentTasksInARow of them in a row, so that the
+    // normal tasks make progress.
+    URGENT_PRIORITY,
+
+    // The priority of the rest of the PostTask family.
+    NORMAL_PRIORITY,
+
+    // Deferrable bookkeeping.  Runs only when the loop is idle: there are no
+    // normal or urgent tasks, no expired delayed tasks and, for a UI loop, no
+    // native events.  A task that waited kMaxIdleTaskDelayMs runs as a normal
+    // task, so that a busy loop doesn't starve it forever.
+    IDLE_PRIORITY,
+
+    NUM_TASK_PRIORITIES
+  };
+
+  static const int kMaxUrgentTasksInARow = 8;
+  static const int kMaxIdleTaskDelayMs = 1000;
+
+  // Like PostTask, with a |priority|.  The queue delay of each priority is
+  // recorded under its own name by EnableTaskTimingHistograms(), e.g.
+  // "MsgLoop.QueueDelay:UI:IdlePriority".
+  void PostTaskWithPriority(
+      const tracked_objects::Location& from_here,
+      const base::Closure& task,
+      TaskPriority priority);
+
+  // Schedules |entry| on this loop's timer wheel to fire after |delay_ms| on
+  // the thread that executes MessageLoop::Run().  Rescheduling an entry that
+  // is already scheduled moves it; Entry::Cancel() unschedules it without
+  // leaving anything behind.  Entries fire as nestable tasks and are notified
+  // to TaskObservers like tasks.  This is the backend of base::OneShotTimer
+  // and base::RepeatingTimer.
+  //
+  // NOTE: Unlike the PostTask family, this may only be called on the loop's
+  // own thread, and the loop does not take ownership of |entry|.
+  void ScheduleTimerWheelEntry(base::TimerWheel::Entry* entry, int64 delay_ms);
+
+  // Like ScheduleTimerWheelEntry(), for an entry that may fire up to
+  // |tolerance_ms| late. While timer coalescing is enabled, the deadline is
+  // rounded up to a multiple of |tolerance_ms|, so that the deferrable
+  // entries of all the loops with the same tolerance fire in the same
+  // wakeups. Otherwise the entry fires on time.
+  void ScheduleDeferrableTimerWheelEntry(base::TimerWheel::Entry* entry,
+                                         int64 delay_ms,
+                                         int64 tolerance_ms);
+
   // A variant on PostTask that deletes the given object.  This is useful
   // if the object needs to live until the next run of the MessageLoop (for
   // example, deleting a RenderProcessHost from within an IPC callback is not
   // good).
   //
+  // The object is deleted by a task, so that the tasks posted before, which
+  // may still use it, run first.
+  //
   // NOTE: This method may be called on any thread.  The object will be deleted
   // on the thread that executes MessageLoop::Run().  If this is not the same
   // as the thread that calls PostDelayedTask(FROM_HERE, ), then T MUST inherit
@@ -323,6 +412,27 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   // Returns true if we are currently running a nested message loop.
   bool IsNested();
 
+  // Counters describing the traffic through the incoming queue.  |contended|
+  // counts posts that could not proceed on the first attempt: a failed
+  // compare-and-swap on the lock-free path, or a failed Lock::Try() on the
+  // locked path.  The counters are updated without barriers and are only
+  // approximately consistent with each other.
+  struct IncomingQueueStats {
+    IncomingQueueStats() : posts(0), contended(0), reloads(0),
+                           tasks_reloaded(0), lock_free(false) {}
+
+    int posts;
+    int contended;
+    // Number of times the owning thread moved tasks into its work queue, and
+    // the total number of tasks moved.
+    int reloads;
+    int tasks_reloaded;
+    bool lock_free;
+  };
+
+  // May be called on any thread.
+  IncomingQueueStats GetIncomingQueueStats() const;
+
   // A TaskObserver is an object that receives task notifications from the
   // MessageLoop.
   //
@@ -346,6 +456,18 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   void AddTaskObserver(TaskObserver* task_observer);
   void RemoveTaskObserver(TaskObserver* task_observer);
 
+  // Returns TimeTicks::Now() as of the first call during the task or timer
+  // being run, so that the callers reading the time repeatedly within a task
+  // read the clock once. The value may be as old as the time the task has
+  // run, so only use it where that precision is enough. Outside of tasks,
+  // e.g. while the pump handles native events, returns TimeTicks::Now().
+  // Can only be called on the thread |this| is running on.
+  base::TimeTicks GetCachedNow();
+
+  // Returns current()->GetCachedNow(), or TimeTicks::Now() on a thread
+  // without a MessageLoop.
+  static base::TimeTicks CachedNow();
+
   // Returns true if the message loop has high resolution timers enabled.
   // Provided for testing.
   bool high_resolution_timers_enabled() {
@@ -416,6 +538,9 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
     // Used to support sorting.
     bool operator<(const PendingTask& other) const;
 
+    // Returns true if the task was cancelled through |cancellation_token|.
+    bool IsCancelled() const;
+
     // The task to run.
     base::Closure task;
 
@@ -436,8 +561,20 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
     // OK to dispatch from a nested loop.
     bool nestable;
 
+    // Set by PostTaskWithPriority(), NORMAL_PRIORITY otherwise.
+    TaskPriority priority;
+
+    // Cancels the task if set; see base::CancellationToken.
+    scoped_refptr<base::CancellationToken> cancellation_token;
+
     // The site this PendingTask was posted from.
     const void* birth_program_counter;
+
+    // The rest of the posting Location, for TaskTimingRecorder.  The strings
+    // are long-lived constants such as __FILE__.
+    const char* posted_from_function;
+    const char* posted_from_file;
+    int posted_from_line;
   };
 
   class TaskQueue : public std::queue<PendingTask> {
@@ -447,7 +584,22 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
     }
   };
 
-  typedef std::priority_queue<PendingTask> DelayedTaskQueue;
+  class DelayedTaskQueue : public std::priority_queue<PendingTask> {
+   public:
+    // Removes the cancelled tasks in linear time, and restores the heap.
+    void RemoveCancelledTasks();
+  };
+
+  // A node of the lock-free incoming list.  Producers link nodes onto
+  // |incoming_head_| so the list is in LIFO order; ReloadWorkQueue() reverses
+  // it before appending to |work_queue_|.
+  struct IncomingTaskNode {
+    explicit IncomingTaskNode(const PendingTask& task)
+        : pending_task(task), next(NULL) {}
+
+    PendingTask pending_task;
+    IncomingTaskNode* next;
+  };
 
 #if defined(OS_WIN)
   base::MessagePumpWin* pump_win() {
@@ -484,9 +636,18 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   // cannot be run right now.  Returns true if the task was run.
   bool DeferOrRunPendingTask(const PendingTask& pending_task);
 
-  // Adds the pending task to delayed_work_queue_.
+  // Adds the pending task to delayed_work_queue_.  Every time the queue
+  // doubles in size this also purges its cancelled tasks, which would
+  // otherwise stay until their run time came.
   void AddToDelayedWorkQueue(const PendingTask& pending_task);
 
+  // Runs an expired timer wheel entry the way RunTask runs a task.
+  void RunTimerWheelEntry(base::TimerWheel::Entry* entry);
+
+  // Returns the earliest time at which either delayed_work_queue_ or
+  // timer_wheel_ needs attention, or a null TimeTicks if both are empty.
+  base::TimeTicks GetNextDelayedWorkTime() const;
+
   // Adds the pending task to our incoming_queue_.
   //
   // Caller retains ownership of |pending_task|, but this function will
@@ -495,11 +656,35 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   // beyond this function call.
   void AddToIncomingQueue(PendingTask* pending_task);
 
+  // Implementations of AddToIncomingQueue() for each incoming queue type.
+  // Both return true if the queue was empty, i.e. the pump must be woken up.
+  bool PushLockFree(PendingTask* pending_task);
+  bool PushLocked(PendingTask* pending_task);
+
   // Load tasks from the incoming_queue_ into work_queue_ if the latter is
-  // empty.  The former requires a lock to access, while the latter is directly
-  // accessible on this thread.
+  // empty, or urgent tasks were posted.  The former requires a lock (or an
+  // atomic exchange) to access, while the latter is directly accessible on
+  // this thread.
   void ReloadWorkQueue();
 
+  // Detaches the whole lock-free incoming list and appends it to the work
+  // queues in posting order.  Returns the number of tasks moved.
+  int ReloadFromLockFreeQueue();
+
+  // Appends |pending_task|, which was just taken from the incoming queue, to
+  // the work queue of its priority.
+  void AddToWorkQueue(const PendingTask& pending_task);
+
+  // Pops the next task from |urgent_work_queue_| or |work_queue_|, one of
+  // which must not be empty.
+  PendingTask PopWorkQueue();
+
+  // Moves the idle tasks that waited kMaxIdleTaskDelayMs to |work_queue_|.
+  void PromoteStarvedIdleTasks();
+
+  // Runs the next idle task, if there is one and it can be run.
+  bool ProcessNextIdleTask();
+
   // Delete tasks that haven't run yet without running them.  Used in the
   // destructor to make sure all the task's destructors get called.  Returns
   // true if some work was done.
@@ -508,6 +693,11 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   // Calcuates the time at which a PendingTask should run.
   base::TimeTicks CalculateDelayedRuntime(int64 delay_ms);
 
+  // Schedules |entry| to fire at |run_time|, waking the pump earlier if
+  // needed.
+  void ScheduleTimerWheelEntryAt(base::TimerWheel::Entry* entry,
+                                 base::TimeTicks run_time);
+
   // Start recording histogram info about events and action IF it was enabled
   // and IF the statistics recorder can accept a registration of our histogram.
   void StartHistogrammer();
@@ -528,12 +718,35 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   // this queue is only accessed (push/pop) by our current thread.
   TaskQueue work_queue_;
 
+  // Like |work_queue_|, for the urgent and idle tasks, which are never
+  // delayed.
+  TaskQueue urgent_work_queue_;
+  TaskQueue idle_work_queue_;
+
+  // The number of urgent tasks that DoWork() ran since it last ran a normal
+  // task.
+  int urgent_tasks_in_a_row_;
+
   // Contains delayed tasks, sorted by their 'delayed_run_time' property.
   DelayedTaskQueue delayed_work_queue_;
 
+  // The size at which AddToDelayedWorkQueue() next purges the cancelled
+  // tasks from |delayed_work_queue_|.
+  size_t delayed_work_queue_purge_size_;
+
+  // Timers scheduled through ScheduleTimerWheelEntry().
+  base::TimerWheel timer_wheel_;
+
   // A recent snapshot of Time::Now(), used to check delayed_work_queue_.
   base::TimeTicks recent_time_;
 
+  // The value of GetCachedNow() for the task being run, null until it is
+  // first called. Cleared when a task or timer starts and ends.
+  base::TimeTicks cached_now_;
+
+  // The number of tasks and timers being run, more than one in nested loops.
+  int task_depth_;
+
   // A queue of non-nestable tasks that we had to defer because when it came
   // time to execute them we were in a nested message loop.  They will execute
   // once we're out of nested message loops.
@@ -553,6 +766,10 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   // A profiling histogram showing the counts of various messages and events.
   base::Histogram* message_histogram_;
 
+  // Records task timing histograms if EnableTaskTimingHistograms() was on
+  // when this loop started running.  NULL otherwise.
+  scoped_ptr<base::TaskTimingRecorder> task_timing_recorder_;
+
   // A null terminated list which creates an incoming_queue of tasks that are
   // acquired under a mutex for processing on this instance's thread. These
   // tasks have not yet been sorted out into items for our work_queue_ vs items
@@ -560,6 +777,29 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   TaskQueue incoming_queue_;
   // Protect access to incoming_queue_.
   mutable base::Lock incoming_queue_lock_;
+  // True if |incoming_queue_| may hold tasks that aren't of NORMAL_PRIORITY,
+  // which ReloadWorkQueue() can't just swap into |work_queue_|.  Guarded by
+  // |incoming_queue_lock_|.
+  bool incoming_queue_has_priorities_;
+
+  // True if this loop uses |incoming_head_| instead of |incoming_queue_|.
+  const bool lock_free_incoming_queue_;
+
+  // Head of the lock-free incoming list (an IncomingTaskNode*), or 0 if the
+  // list is empty.  Pushed to by any thread, detached by this thread only.
+  volatile base::subtle::AtomicWord incoming_head_;
+
+  // Backing store for IncomingQueueStats.
+  volatile base::subtle::Atomic32 incoming_posts_;
+  volatile base::subtle::Atomic32 incoming_contended_;
+  // Only written on this thread.
+  volatile base::subtle::Atomic32 incoming_reloads_;
+  volatile base::subtle::Atomic32 incoming_tasks_reloaded_;
+
+  // The number of urgent tasks posted that aren't in |urgent_work_queue_|
+  // yet.  While it isn't zero ReloadWorkQueue() doesn't wait for
+  // |work_queue_| to be empty.
+  volatile base::subtle::Atomic32 incoming_urgent_tasks_;
 
   RunState* state_;
 
@@ -607,6 +847,10 @@ class BASE_EXPORT MessageLoopForUI : public MessageLoop {
 
 #if defined(OS_WIN)
   virtual void DidProcessMessage(const MSG& message);
+
+  // See MessagePumpForUI::set_work_batch_time_slice().  Must not be called on
+  // a MessageLoopForEmbed, whose pump is not a MessagePumpForUI.
+  void SetWorkBatchTimeSlice(base::TimeDelta time_slice);
 #endif  // defined(OS_WIN)
 
 #if defined(OS_ANDROID)
@@ -9,6 +9,14 @@
 
 namespace base {
 
+namespace {
+
+// The flag of |target_message_loop_users_| that WillDestroyCurrentMessageLoop()
+// sets.  Above any plausible number of concurrent posts.
+const subtle::Atomic32 kTargetLoopDestroyed = 1 << 30;
+
+}  // namespace
+
 MessageLoopProxyImpl::~MessageLoopProxyImpl() {
 }
 
@@ -65,17 +73,44 @@ bool MessageLoopProxyImpl::BelongsToCurrentThread() {
   // function.
   // http://crbug.com/63678
   base::ThreadRestrictions::ScopedAllowSingleton allow_singleton;
-  AutoLock lock(message_loop_lock_);
-  return (target_message_loop_ &&
-          (MessageLoop::current() == target_message_loop_));
+  if (!AcquireTargetLoop())
+    return false;
+  bool belongs = MessageLoop::current() == target_message_loop_;
+  ReleaseTargetLoop();
+  return belongs;
 }
 
 // MessageLoop::DestructionObserver implementation
 void MessageLoopProxyImpl::WillDestroyCurrentMessageLoop() {
-  AutoLock lock(message_loop_lock_);
+  // No new use starts once the flag is set. The uses in progress may be on
+  // threads of a lower priority, so this blocks until the last one leaves
+  // instead of spinning.
+  if (subtle::Barrier_AtomicIncrement(&target_message_loop_users_,
+                                      kTargetLoopDestroyed) !=
+      kTargetLoopDestroyed)
+    target_message_loop_users_done_.Wait();
   target_message_loop_ = NULL;
 }
 
+bool MessageLoopProxyImpl::AcquireTargetLoop() const {
+  subtle::Atomic32 users = subtle::NoBarrier_Load(&target_message_loop_users_);
+  for (;;) {
+    if (users & kTargetLoopDestroyed)
+      return false;
+    subtle::Atomic32 previous = subtle::Acquire_CompareAndSwap(
+        &target_message_loop_users_, users, users + 1);
+    if (previous == users)
+      return true;
+    users = previous;
+  }
+}
+
+void MessageLoopProxyImpl::ReleaseTargetLoop() const {
+  if (subtle::Barrier_AtomicIncrement(&target_message_loop_users_, -1) ==
+      kTargetLoopDestroyed)
+    target_message_loop_users_done_.Signal();
+}
+
 void MessageLoopProxyImpl::OnDestruct() const {
   // We shouldn't use MessageLoop::current() since it uses LazyInstance which
   // may be deleted by ~AtExitManager when a WorkerPool thread calls this
@@ -83,57 +118,53 @@ void MessageLoopProxyImpl::OnDestruct() const {
   // http://crbug.com/63678
   base::ThreadRestrictions::ScopedAllowSingleton allow_singleton;
   bool delete_later = false;
-  {
-    AutoLock lock(message_loop_lock_);
-    if (target_message_loop_ &&
-        (MessageLoop::current() != target_message_loop_)) {
+  if (AcquireTargetLoop()) {
+    if (MessageLoop::current() != target_message_loop_) {
       target_message_loop_->DeleteSoon(FROM_HERE, this);
       delete_later = true;
     }
+    ReleaseTargetLoop();
   }
   if (!delete_later)
     delete this;
 }
 
 MessageLoopProxyImpl::MessageLoopProxyImpl()
-    : target_message_loop_(MessageLoop::current()) {
+    : target_message_loop_users_(0),
+      target_message_loop_users_done_(false, false),
+      target_message_loop_(MessageLoop::current()) {
 }
 
 bool MessageLoopProxyImpl::PostTaskHelper(
     const tracked_objects::Location& from_here, Task* task, int64 delay_ms,
     bool nestable) {
-  bool ret = false;
-  {
-    AutoLock lock(message_loop_lock_);
-    if (target_message_loop_) {
-      if (nestable) {
-        target_message_loop_->PostDelayedTask(from_here, task, delay_ms);
-      } else {
-        target_message_loop_->PostNonNestableDelayedTask(from_here, task,
-                                                         delay_ms);
-      }
-      ret = true;
-    }
-  }
-  if (!ret)
+  if (!AcquireTargetLoop()) {
     delete task;
-  return ret;
+    return false;
+  }
+  if (nestable) {
+    target_message_loop_->PostDelayedTask(from_here, task, delay_ms);
+  } else {
+    target_message_loop_->PostNonNestableDelayedTask(from_here, task,
+                                                     delay_ms);
+  }
+  ReleaseTargetLoop();
+  return true;
 }
 
 bool MessageLoopProxyImpl::PostTaskHelper(
     const tracked_objects::Location& from_here, const base::Closure& task,
     int64 delay_ms, bool nestable) {
-  AutoLock lock(message_loop_lock_);
-  if (target_message_loop_) {
-    if (nestable) {
-      target_message_loop_->PostDelayedTask(from_here, task, delay_ms);
-    } else {
-      target_message_loop_->PostNonNestableDelayedTask(from_here, task,
-                                                       delay_ms);
-    }
-    return true;
+  if (!AcquireTargetLoop())
+    return false;
+  if (nestable) {
+    target_message_loop_->PostDelayedTask(from_here, task, delay_ms);
+  } else {
+    target_message_loop_->PostNonNestableDelayedTask(from_here, task,
+                                                     delay_ms);
   }
-  return false;
+  ReleaseTargetLoop();
+  return true;
 }
 
 scoped_refptr<MessageLoopProxy>
@@ -6,16 +6,23 @@
 #define BASE_MESSAGE_LOOP_PROXY_IMPL_H_
 #pragma once
 
+#include "base/atomicops.h"
 #include "base/base_export.h"
 #include "base/message_loop.h"
 #include "base/message_loop_proxy.h"
-#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
 
 namespace base {
 
 // A stock implementation of MessageLoopProxy that is created and managed by a
 // MessageLoop. For now a MessageLoopProxyImpl can only be created as part of a
 // MessageLoop.
+//
+// Posting takes no lock of its own: each post counts itself in an atomic
+// word for as long as it uses the target loop, and the loop's destruction
+// flags the word, then waits for the last post in progress to signal it.  So
+// a post through a proxy costs what a MessageLoop::PostTask() costs, which is
+// no lock with the lock-free incoming queue.
 class BASE_EXPORT MessageLoopProxyImpl
     : public MessageLoopProxy {
  public:
@@ -57,6 +64,10 @@ class BASE_EXPORT MessageLoopProxyImpl
   // Called directly by MessageLoop::~MessageLoop.
   virtual void WillDestroyCurrentMessageLoop();
 
+  // Returns true if the target loop isn't being destroyed, in which case it
+  // stays alive until the matching ReleaseTargetLoop().
+  bool AcquireTargetLoop() const;
+  void ReleaseTargetLoop() const;
 
   // TODO(ajwong): Remove this after we've fully migrated to base::Closure.
   bool PostTaskHelper(const tracked_objects::Location& from_here,
@@ -71,8 +82,16 @@ class BASE_EXPORT MessageLoopProxyImpl
   // Allow the messageLoop to create a MessageLoopProxyImpl.
   friend class ::MessageLoop;
 
-  // The lock that protects access to target_message_loop_.
-  mutable base::Lock message_loop_lock_;
+  // The number of callers between AcquireTargetLoop() and
+  // ReleaseTargetLoop(), plus kTargetLoopDestroyed once
+  // WillDestroyCurrentMessageLoop() was called.
+  mutable volatile base::subtle::Atomic32 target_message_loop_users_;
+
+  // Signaled by the ReleaseTargetLoop() that leaves the word at
+  // kTargetLoopDestroyed, for WillDestroyCurrentMessageLoop() to wait on.
+  mutable WaitableEvent target_message_loop_users_done_;
+
+  // Only read between AcquireTargetLoop() and ReleaseTargetLoop().
   MessageLoop* target_message_loop_;
 
   DISALLOW_COPY_AND_ASSIGN(MessageLoopProxyImpl);
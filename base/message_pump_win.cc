@@ -18,6 +18,16 @@ static const wchar_t kWndClass[] = L"Chrome_MessagePumpWindow";
 // task (a series of such messages creates a continuous task pump).
 static const int kMsgHaveWork = WM_USER + 1;
 
+// Why a batch of work started by DoBatchedWork() ended.  Used for histograms,
+// so only append to this list.
+enum WorkBatchEndReason {
+  BATCH_DRAINED,
+  BATCH_INPUT_PENDING,
+  BATCH_TIME_SLICE_EXPIRED,
+  BATCH_QUIT,
+  BATCH_END_REASON_COUNT
+};
+
 //-----------------------------------------------------------------------------
 // MessagePumpWin public:
 
@@ -200,7 +210,7 @@ void MessagePumpForUI::DoRunLoop() {
     if (state_->should_quit)
       break;
 
-    more_work_is_plausible |= state_->delegate->DoWork();
+    more_work_is_plausible |= DoBatchedWork();
     if (state_->should_quit)
       break;
 
@@ -295,7 +305,7 @@ void MessagePumpForUI::HandleWorkMessage() {
 
   // Now give the delegate a chance to do some work.  He'll let us know if he
   // needs to do more work.
-  if (state_->delegate->DoWork())
+  if (DoBatchedWork())
     ScheduleWork();
 }
 
@@ -404,6 +414,40 @@ bool MessagePumpForUI::ProcessPumpReplacementMessage() {
   return ProcessMessageHelper(msg);
 }
 
+bool MessagePumpForUI::DoBatchedWork() {
+  if (work_batch_time_slice_ <= TimeDelta())
+    return state_->delegate->DoWork();
+
+  TimeTicks batch_end = TimeTicks::Now() + work_batch_time_slice_;
+  int batch_size = 0;
+  WorkBatchEndReason reason = BATCH_DRAINED;
+  bool more_work = false;
+  while ((more_work = state_->delegate->DoWork())) {
+    ++batch_size;
+    if (state_->should_quit) {
+      reason = BATCH_QUIT;
+      break;
+    }
+    // Never make input wait behind more than one task.  The high word of
+    // GetQueueStatus() describes what is currently in the queue.
+    if (HIWORD(GetQueueStatus(QS_INPUT | QS_SENDMESSAGE))) {
+      reason = BATCH_INPUT_PENDING;
+      break;
+    }
+    if (TimeTicks::Now() >= batch_end) {
+      reason = BATCH_TIME_SLICE_EXPIRED;
+      break;
+    }
+  }
+
+  if (batch_size) {
+    HISTOGRAM_COUNTS_10000("Loop.WorkBatchSize", batch_size);
+    HISTOGRAM_ENUMERATION("Loop.WorkBatchEndReason", reason,
+                          BATCH_END_REASON_COUNT);
+  }
+  return more_work;
+}
+
 //-----------------------------------------------------------------------------
 // MessagePumpForIO public:
 
@@ -174,6 +174,17 @@ class BASE_EXPORT MessagePumpForUI : public MessagePumpWin {
   // queue can provide, up to some fixed number (to avoid any infinite loops).
   void PumpOutPendingPaintMessages();
 
+  // Enables batched dispatch: each time the pump asks the delegate for work it
+  // keeps running tasks for up to |time_slice|, instead of returning to the
+  // Windows message queue after every task.  A batch also ends as soon as
+  // input or sent messages are waiting, so input is never starved for longer
+  // than one task.  A zero |time_slice| (the default) restores one task per
+  // wakeup.  Batch sizes are recorded in the "Loop.WorkBatchSize" histogram.
+  void set_work_batch_time_slice(TimeDelta time_slice) {
+    work_batch_time_slice_ = time_slice;
+  }
+  TimeDelta work_batch_time_slice() const { return work_batch_time_slice_; }
+
  private:
   static LRESULT CALLBACK WndProcThunk(
       HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam);
@@ -186,8 +197,15 @@ class BASE_EXPORT MessagePumpForUI : public MessagePumpWin {
   bool ProcessMessageHelper(const MSG& msg);
   bool ProcessPumpReplacementMessage();
 
+  // Calls the delegate's DoWork(), repeatedly if batching is enabled.  Returns
+  // the result of the last DoWork() call.
+  bool DoBatchedWork();
+
   // A hidden message-only window.
   HWND message_hwnd_;
+
+  // See set_work_batch_time_slice().
+  TimeDelta work_batch_time_slice_;
 };
 
 //-----------------------------------------------------------------------------
@@ -16,12 +16,54 @@
 
 #include "base/debug/leak_annotations.h"
 #include "base/logging.h"
+#include "base/metrics/histogram_shared_memory.h"
 #include "base/pickle.h"
 #include "base/stringprintf.h"
 #include "base/synchronization/lock.h"
+#include "base/synchronization/read_write_lock.h"
 
 namespace base {
 
+namespace {
+
+// The varints of SampleSet::SerializeCompact(): seven bits per byte, the low
+// ones first, with the high bit set on all bytes but the last.  The signed
+// values are zigzag encoded, so that the small negative ones are short too.
+
+void AppendVarint(uint64 value, std::string* output) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+void AppendSignedVarint(int64 value, std::string* output) {
+  AppendVarint((static_cast<uint64>(value) << 1) ^
+               static_cast<uint64>(value >> 63), output);
+}
+
+bool ReadVarint(const char** data, const char* end, uint64* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && *data < end; shift += 7) {
+    uint8 byte = static_cast<uint8>(*(*data)++);
+    *value |= static_cast<uint64>(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+bool ReadSignedVarint(const char** data, const char* end, int64* value) {
+  uint64 zigzag;
+  if (!ReadVarint(data, end, &zigzag))
+    return false;
+  *value = static_cast<int64>(zigzag >> 1) ^ -static_cast<int64>(zigzag & 1);
+  return true;
+}
+
+}  // namespace
+
 // Static table of checksums for all possible 8 bit bytes.
 const uint32 Histogram::kCrcTable[256] = {0x0, 0x77073096L, 0xee0e612cL,
 0x990951baL, 0x76dc419L, 0x706af48fL, 0xe963a535L, 0x9e6495a3L, 0xedb8832L,
@@ -114,6 +156,74 @@ Histogram* Histogram::FactoryTimeGet(const std::string& name,
                     bucket_count, flags);
 }
 
+// Bucket counts, sum and count of a kThreadSafeFlag histogram, laid out as
+// described by HistogramSharedMemory::CounterIndex.  The sum is kept in two
+// 32 bit halves because 64 bit atomic operations are not available on every
+// platform; carries are propagated by whichever thread causes them, so a
+// snapshot may (rarely) see a sum that is off by 2^32.
+class Histogram::AtomicSampleSet {
+ public:
+  // Uses |counters| if given (they must be zero), or else allocates them.
+  AtomicSampleSet(size_t bucket_count, volatile subtle::Atomic32* counters)
+      : bucket_count_(bucket_count),
+        counters_(counters) {
+    if (!counters_) {
+      size_t size = HistogramSharedMemory::kFirstBucketIndex + bucket_count;
+      owned_counters_.reset(new volatile subtle::Atomic32[size]);
+      for (size_t i = 0; i < size; ++i)
+        owned_counters_[i] = 0;
+      counters_ = owned_counters_.get();
+    }
+  }
+
+  void Accumulate(Sample value, Count count, size_t index) {
+    DCHECK_LT(index, bucket_count_);
+    subtle::NoBarrier_AtomicIncrement(
+        &counters_[HistogramSharedMemory::kFirstBucketIndex + index], count);
+    subtle::NoBarrier_AtomicIncrement(
+        &counters_[HistogramSharedMemory::kRedundantCountIndex], count);
+
+    int64 delta = static_cast<int64>(count) * value;
+    uint32 low_delta = static_cast<uint32>(delta);
+    uint32 new_low = static_cast<uint32>(subtle::NoBarrier_AtomicIncrement(
+        &counters_[HistogramSharedMemory::kSumLowIndex],
+        static_cast<subtle::Atomic32>(low_delta)));
+    // Adding |low_delta| carried out of the low half iff the result is
+    // below |low_delta|.
+    int32 high_delta = static_cast<int32>(delta >> 32);
+    if (new_low < low_delta)
+      ++high_delta;
+    if (high_delta) {
+      subtle::NoBarrier_AtomicIncrement(
+          &counters_[HistogramSharedMemory::kSumHighIndex], high_delta);
+    }
+  }
+
+  void AddTo(SampleSet* sample) const {
+    Counts counts(bucket_count_);
+    for (size_t i = 0; i < bucket_count_; ++i) {
+      counts[i] = subtle::NoBarrier_Load(
+          &counters_[HistogramSharedMemory::kFirstBucketIndex + i]);
+    }
+    uint32 low = static_cast<uint32>(subtle::NoBarrier_Load(
+        &counters_[HistogramSharedMemory::kSumLowIndex]));
+    int64 high = subtle::NoBarrier_Load(
+        &counters_[HistogramSharedMemory::kSumHighIndex]);
+    sample->AddCounts(counts, (high << 32) + low,
+                      subtle::NoBarrier_Load(&counters_[
+                          HistogramSharedMemory::kRedundantCountIndex]));
+  }
+
+  bool is_shared() const { return !owned_counters_.get(); }
+
+ private:
+  const size_t bucket_count_;
+  volatile subtle::Atomic32* counters_;
+  scoped_array<volatile subtle::Atomic32> owned_counters_;
+
+  DISALLOW_COPY_AND_ASSIGN(AtomicSampleSet);
+};
+
 void Histogram::Add(int value) {
   if (value > kSampleType_MAX - 1)
     value = kSampleType_MAX - 1;
@@ -133,6 +243,21 @@ void Histogram::AddSampleSet(const SampleSet& sample) {
   sample_.Add(sample);
 }
 
+void Histogram::SetFlags(Flags flags) {
+  if ((flags & kThreadSafeFlag) && !atomic_sample_.get()) {
+    // Switching storage under a live histogram would lose samples.
+    DCHECK_EQ(0, sample_.TotalCount());
+    atomic_sample_.reset(new AtomicSampleSet(bucket_count_, NULL));
+  }
+  flags_ = static_cast<Flags>(flags_ | flags);
+}
+
+void Histogram::UseSharedCounters(volatile subtle::Atomic32* counters) {
+  DCHECK_EQ(0, sample_.TotalCount());
+  DCHECK(!atomic_sample_.get() || !atomic_sample_->is_shared());
+  atomic_sample_.reset(new AtomicSampleSet(bucket_count_, counters));
+}
+
 void Histogram::SetRangeDescriptions(const DescriptionPair descriptions[]) {
   DCHECK(false);
 }
@@ -212,6 +337,29 @@ void Histogram::WriteAscii(bool graph_it, const std::string& newline,
 // static
 std::string Histogram::SerializeHistogramInfo(const Histogram& histogram,
                                               const SampleSet& snapshot) {
+  return SerializeHistogram(histogram, snapshot, false);
+}
+
+// static
+bool Histogram::DeserializeHistogramInfo(const std::string& histogram_info) {
+  return DeserializeHistogram(histogram_info, false);
+}
+
+// static
+std::string Histogram::SerializeHistogramDelta(const Histogram& histogram,
+                                               const SampleSet& delta) {
+  return SerializeHistogram(histogram, delta, true);
+}
+
+// static
+bool Histogram::DeserializeHistogramDelta(const std::string& histogram_delta) {
+  return DeserializeHistogram(histogram_delta, true);
+}
+
+// static
+std::string Histogram::SerializeHistogram(const Histogram& histogram,
+                                          const SampleSet& snapshot,
+                                          bool compact) {
   DCHECK_NE(NOT_VALID_IN_RENDERER, histogram.histogram_type());
 
   Pickle pickle;
@@ -223,12 +371,16 @@ std::string Histogram::SerializeHistogramInfo(const Histogram& histogram,
   pickle.WriteInt(histogram.histogram_type());
   pickle.WriteInt(histogram.flags());
 
-  snapshot.Serialize(&pickle);
+  if (compact)
+    snapshot.SerializeCompact(&pickle);
+  else
+    snapshot.Serialize(&pickle);
   return std::string(static_cast<const char*>(pickle.data()), pickle.size());
 }
 
 // static
-bool Histogram::DeserializeHistogramInfo(const std::string& histogram_info) {
+bool Histogram::DeserializeHistogram(const std::string& histogram_info,
+                                     bool compact) {
   if (histogram_info.empty()) {
       return false;
   }
@@ -252,7 +404,9 @@ bool Histogram::DeserializeHistogramInfo(const std::string& histogram_info) {
       !pickle.ReadUInt32(&iter, &range_checksum) ||
       !pickle.ReadInt(&iter, &histogram_type) ||
       !pickle.ReadInt(&iter, &pickle_flags) ||
-      !sample.Histogram::SampleSet::Deserialize(&iter, pickle)) {
+      !(compact ?
+        sample.DeserializeCompact(&iter, pickle, bucket_count) :
+        sample.Histogram::SampleSet::Deserialize(&iter, pickle))) {
     LOG(ERROR) << "Pickle error decoding Histogram: " << histogram_name;
     return false;
   }
@@ -367,6 +521,8 @@ size_t Histogram::bucket_count() const {
 void Histogram::SnapshotSample(SampleSet* sample) const {
   // Note locking not done in this version!!!
   *sample = sample_;
+  if (atomic_sample_.get())
+    atomic_sample_->AddTo(sample);
 }
 
 bool Histogram::HasConstructorArguments(Sample minimum,
@@ -518,6 +674,10 @@ const std::string Histogram::GetAsciiBucketRange(size_t i) const {
 
 // Update histogram data with new sample.
 void Histogram::Accumulate(Sample value, Count count, size_t index) {
+  if (atomic_sample_.get()) {
+    atomic_sample_->Accumulate(value, count, index);
+    return;
+  }
   // Note locking not done in this version!!!
   sample_.Accumulate(value, count, index);
 }
@@ -724,6 +884,16 @@ void Histogram::SampleSet::Subtract(const SampleSet& other) {
   }
 }
 
+void Histogram::SampleSet::AddCounts(const Counts& counts,
+                                     int64 sum,
+                                     int64 redundant_count) {
+  DCHECK_EQ(counts_.size(), counts.size());
+  sum_ += sum;
+  redundant_count_ += redundant_count;
+  for (size_t index = 0; index < counts_.size(); ++index)
+    counts_[index] += counts[index];
+}
+
 bool Histogram::SampleSet::Serialize(Pickle* pickle) const {
   pickle->WriteInt64(sum_);
   pickle->WriteInt64(redundant_count_);
@@ -764,6 +934,74 @@ bool Histogram::SampleSet::Deserialize(void** iter, const Pickle& pickle) {
   return count == redundant_count_;
 }
 
+bool Histogram::SampleSet::SerializeCompact(Pickle* pickle) const {
+  // The buckets are written as the distance from the previous one written,
+  // and the count.
+  std::string data;
+  AppendSignedVarint(sum_, &data);
+  AppendSignedVarint(redundant_count_, &data);
+  size_t previous = 0;
+  for (size_t index = 0; index < counts_.size(); ++index) {
+    if (!counts_[index])
+      continue;
+    AppendVarint(index - previous, &data);
+    AppendSignedVarint(counts_[index], &data);
+    previous = index;
+  }
+  return pickle->WriteData(data.data(), static_cast<int>(data.size()));
+}
+
+bool Histogram::SampleSet::DeserializeCompact(void** iter,
+                                              const Pickle& pickle,
+                                              size_t bucket_count) {
+  DCHECK_EQ(counts_.size(), 0u);
+  DCHECK_EQ(sum_, 0);
+  DCHECK_EQ(redundant_count_, 0);
+
+  const char* data;
+  int length;
+  if (!pickle.ReadData(iter, &data, &length))
+    return false;
+  const char* end = data + length;
+  if (!ReadSignedVarint(&data, end, &sum_) ||
+      !ReadSignedVarint(&data, end, &redundant_count_))
+    return false;
+
+  // The bucket count comes from the untrusted header.
+  if (bucket_count == 0 || INT_MAX / sizeof(Count) <= bucket_count)
+    return false;
+  counts_.resize(bucket_count, 0);
+  int64 count = 0;
+  uint64 index = 0;
+  bool first = true;
+  while (data < end) {
+    uint64 distance;
+    int64 bucket_samples;
+    if (!ReadVarint(&data, end, &distance) ||
+        !ReadSignedVarint(&data, end, &bucket_samples))
+      return false;
+    // After the first, the buckets are in increasing order.
+    if ((!first && distance == 0) || distance >= counts_.size() - index)
+      return false;
+    index += distance;
+    first = false;
+    counts_[index] = static_cast<Count>(bucket_samples);
+    count += counts_[index];
+  }
+  DCHECK_EQ(count, redundant_count_);
+  return count == redundant_count_;
+}
+
+bool Histogram::SampleSet::HasSamples() const {
+  if (sum_ || redundant_count_)
+    return true;
+  for (size_t index = 0; index < counts_.size(); ++index) {
+    if (counts_[index])
+      return true;
+  }
+  return false;
+}
+
 //------------------------------------------------------------------------------
 // LinearHistogram: This histogram uses a traditional set of evenly spaced
 // buckets.
@@ -996,9 +1234,14 @@ StatisticsRecorder::StatisticsRecorder() {
     // during the termination phase. Since it's a static data member, we will
     // leak one per process, which would be similar to the instance allocated
     // during static initialization and released only on  process termination.
-    lock_ = new base::Lock;
+    lock_ = new base::ReadWriteLock;
+    logged_samples_lock_ = new base::Lock;
+  }
+  {
+    base::AutoLock auto_lock(*logged_samples_lock_);
+    logged_samples_ = new LoggedSampleMap;
   }
-  base::AutoLock auto_lock(*lock_);
+  base::AutoWriteLock auto_lock(*lock_);
   histograms_ = new HistogramMap;
 }
 
@@ -1013,20 +1256,48 @@ StatisticsRecorder::~StatisticsRecorder() {
   // Clean up.
   HistogramMap* histograms = NULL;
   {
-    base::AutoLock auto_lock(*lock_);
+    base::AutoWriteLock auto_lock(*lock_);
     histograms = histograms_;
     histograms_ = NULL;
   }
   delete histograms;
+  LoggedSampleMap* logged_samples = NULL;
+  {
+    base::AutoLock auto_lock(*logged_samples_lock_);
+    logged_samples = logged_samples_;
+    logged_samples_ = NULL;
+  }
+  delete logged_samples;
   // We don't delete lock_ on purpose to avoid having to properly protect
   // against it going away after we checked for NULL in the static methods.
 }
 
+// static
+bool StatisticsRecorder::EnableSharedMemoryExport(uint32 size) {
+  DCHECK(lock_);
+  base::AutoWriteLock auto_lock(*lock_);
+  DCHECK(!shared_memory_);
+  scoped_ptr<HistogramSharedMemory> shared_memory(new HistogramSharedMemory);
+  if (!shared_memory->Create(size))
+    return false;
+  // Leaked, like the histograms that point into it.
+  shared_memory_ = shared_memory.release();
+  return true;
+}
+
+// static
+SharedMemory* StatisticsRecorder::GetExportSharedMemory() {
+  if (!lock_)
+    return NULL;
+  base::AutoReadLock auto_lock(*lock_);
+  return shared_memory_ ? shared_memory_->shared_memory() : NULL;
+}
+
 // static
 bool StatisticsRecorder::IsActive() {
   if (lock_ == NULL)
     return false;
-  base::AutoLock auto_lock(*lock_);
+  base::AutoReadLock auto_lock(*lock_);
   return NULL != histograms_;
 }
 
@@ -1041,7 +1312,7 @@ Histogram* StatisticsRecorder::RegisterOrDeleteDuplicate(Histogram* histogram) {
     ANNOTATE_LEAKING_OBJECT_PTR(histogram);  // see crbug.com/79322
     return histogram;
   }
-  base::AutoLock auto_lock(*lock_);
+  base::AutoWriteLock auto_lock(*lock_);
   if (!histograms_) {
     ANNOTATE_LEAKING_OBJECT_PTR(histogram);  // see crbug.com/79322
     return histogram;
@@ -1052,6 +1323,16 @@ Histogram* StatisticsRecorder::RegisterOrDeleteDuplicate(Histogram* histogram) {
   if (histograms_->end() == it) {
     (*histograms_)[name] = histogram;
     ANNOTATE_LEAKING_OBJECT_PTR(histogram);  // see crbug.com/79322
+    // Custom ranges can't be described in a shared memory record.
+    if (shared_memory_ &&
+        histogram->histogram_type() != Histogram::CUSTOM_HISTOGRAM) {
+      volatile subtle::Atomic32* counters =
+          shared_memory_->AllocateRecord(*histogram);
+      if (counters)
+        histogram->UseSharedCounters(counters);
+      else
+        DLOG(WARNING) << "Histogram shared memory full; not sharing " << name;
+    }
   } else {
     delete histogram;  // We already have one by this name.
     histogram = it->second;
@@ -1099,7 +1380,7 @@ void StatisticsRecorder::WriteGraph(const std::string& query,
 void StatisticsRecorder::GetHistograms(Histograms* output) {
   if (lock_ == NULL)
     return;
-  base::AutoLock auto_lock(*lock_);
+  base::AutoReadLock auto_lock(*lock_);
   if (!histograms_)
     return;
   for (HistogramMap::iterator it = histograms_->begin();
@@ -1114,7 +1395,7 @@ bool StatisticsRecorder::FindHistogram(const std::string& name,
                                        Histogram** histogram) {
   if (lock_ == NULL)
     return false;
-  base::AutoLock auto_lock(*lock_);
+  base::AutoReadLock auto_lock(*lock_);
   if (!histograms_)
     return false;
   HistogramMap::iterator it = histograms_->find(name);
@@ -1124,12 +1405,48 @@ bool StatisticsRecorder::FindHistogram(const std::string& name,
   return true;
 }
 
+// static
+void StatisticsRecorder::GetHistogramDeltas(Histogram::Flags required_flags,
+                                            std::vector<std::string>* deltas) {
+  if (!IsActive())
+    return;
+  Histograms histograms;
+  GetHistograms(&histograms);
+
+  base::AutoLock auto_lock(*logged_samples_lock_);
+  if (!logged_samples_)
+    return;
+  for (Histograms::const_iterator it = histograms.begin();
+       it != histograms.end();
+       ++it) {
+    Histogram* histogram = *it;
+    if ((histogram->flags() & required_flags) != required_flags)
+      continue;
+
+    Histogram::SampleSet snapshot;
+    histogram->SnapshotSample(&snapshot);
+    if (histogram->FindCorruption(snapshot) != Histogram::NO_INCONSISTENCIES)
+      continue;
+
+    Histogram::SampleSet delta = snapshot;
+    LoggedSampleMap::iterator logged =
+        logged_samples_->find(histogram->histogram_name());
+    if (logged != logged_samples_->end())
+      delta.Subtract(logged->second);
+    if (!delta.HasSamples())
+      continue;
+
+    deltas->push_back(Histogram::SerializeHistogramDelta(*histogram, delta));
+    (*logged_samples_)[histogram->histogram_name()] = snapshot;
+  }
+}
+
 // private static
 void StatisticsRecorder::GetSnapshot(const std::string& query,
                                      Histograms* snapshot) {
   if (lock_ == NULL)
     return;
-  base::AutoLock auto_lock(*lock_);
+  base::AutoReadLock auto_lock(*lock_);
   if (!histograms_)
     return;
   for (HistogramMap::iterator it = histograms_->begin();
@@ -1143,8 +1460,15 @@ void StatisticsRecorder::GetSnapshot(const std::string& query,
 // static
 StatisticsRecorder::HistogramMap* StatisticsRecorder::histograms_ = NULL;
 // static
-base::Lock* StatisticsRecorder::lock_ = NULL;
+base::ReadWriteLock* StatisticsRecorder::lock_ = NULL;
 // static
 bool StatisticsRecorder::dump_on_exit_ = false;
+// static
+HistogramSharedMemory* StatisticsRecorder::shared_memory_ = NULL;
+// static
+StatisticsRecorder::LoggedSampleMap* StatisticsRecorder::logged_samples_ =
+    NULL;
+// static
+base::Lock* StatisticsRecorder::logged_samples_lock_ = NULL;
 
 }  // namespace base
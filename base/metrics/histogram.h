@@ -36,6 +36,11 @@
 // is also completely thread safe, which results in a completely thread safe,
 // and relatively fast, set of counters.  To avoid races at shutdown, the static
 // pointer is NOT deleted, and we leak the histograms at process termination.
+//
+// Adding samples to an ordinary histogram is not synchronized, so concurrent
+// Add() calls on several threads may lose counts.  Histograms created with
+// kThreadSafeFlag instead keep their counts in atomic counters, and may take
+// Add() calls from any number of threads without a lock.
 
 #ifndef BASE_METRICS_HISTOGRAM_H_
 #define BASE_METRICS_HISTOGRAM_H_
@@ -49,13 +54,17 @@
 #include "base/base_export.h"
 #include "base/gtest_prod_util.h"
 #include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/time.h"
 
 class Pickle;
 
 namespace base {
 
+class HistogramSharedMemory;
 class Lock;
+class ReadWriteLock;
+class SharedMemory;
 //------------------------------------------------------------------------------
 // Histograms are often put in areas where they are called many many times, and
 // performance is critical.  As a result, they are designed to have a very low
@@ -314,6 +323,11 @@ class BASE_EXPORT Histogram {
     kNoFlags = 0,
     kUmaTargetedHistogramFlag = 0x1,  // Histogram should be UMA uploaded.
 
+    // Accumulate samples with atomic operations, so that Add() may be called
+    // on several threads at once.  Must be passed to FactoryGet() on
+    // creation; it cannot be added to an existing histogram.
+    kThreadSafeFlag = 0x2,
+
     // Indicate that the histogram was pickled to be sent across an IPC Channel.
     // If we observe this flag on a histogram being aggregated into after IPC,
     // then we are running in a single process mode, and the aggregation should
@@ -364,9 +378,25 @@ class BASE_EXPORT Histogram {
     void Add(const SampleSet& other);
     void Subtract(const SampleSet& other);
 
+    // Adds samples that were accumulated outside of a SampleSet, such as the
+    // atomic counters of a kThreadSafeFlag histogram.
+    void AddCounts(const Counts& counts, int64 sum, int64 redundant_count);
+
     bool Serialize(Pickle* pickle) const;
     bool Deserialize(void** iter, const Pickle& pickle);
 
+    // Like Serialize(), but only writes the buckets with a count, as varints,
+    // which is smaller when few have one, as in the deltas of
+    // StatisticsRecorder::GetHistogramDeltas().  The counts may be negative.
+    bool SerializeCompact(Pickle* pickle) const;
+    // Reads what SerializeCompact() wrote, for a histogram of |bucket_count|
+    // buckets.
+    bool DeserializeCompact(void** iter, const Pickle& pickle,
+                            size_t bucket_count);
+
+    // Whether a bucket, the sum or the redundant count isn't 0.
+    bool HasSamples() const;
+
    protected:
     // Actual histogram data is stored in buckets, showing the count of values
     // that fit into each bucket.
@@ -426,8 +456,9 @@ class BASE_EXPORT Histogram {
 
   // Support generic flagging of Histograms.
   // 0x1 Currently used to mark this histogram to be recorded by UMA..
+  // 0x2 means samples are accumulated atomically.
   // 0x8000 means print ranges in hex.
-  void SetFlags(Flags flags) { flags_ = static_cast<Flags> (flags_ | flags); }
+  void SetFlags(Flags flags);
   void ClearFlags(Flags flags) { flags_ = static_cast<Flags>(flags_ & ~flags); }
   int flags() const { return flags_; }
 
@@ -446,6 +477,15 @@ class BASE_EXPORT Histogram {
   // browser process.
   static bool DeserializeHistogramInfo(const std::string& histogram_info);
 
+  // Like SerializeHistogramInfo(), but |delta| is written with
+  // SampleSet::SerializeCompact(), for the samples added since an earlier
+  // snapshot.
+  static std::string SerializeHistogramDelta(const Histogram& histogram,
+                                             const SampleSet& delta);
+  // Reads what SerializeHistogramDelta() wrote, and adds the samples the way
+  // DeserializeHistogramInfo() does.
+  static bool DeserializeHistogramDelta(const std::string& histogram_delta);
+
   // Check to see if bucket ranges, counts and tallies in the snapshot are
   // consistent with the bucket ranges and checksums in our histogram.  This can
   // produce a false-alarm if a race occurred in the reading of the data during
@@ -524,6 +564,13 @@ class BASE_EXPORT Histogram {
   virtual uint32 CalculateRangeChecksum() const;
 
  private:
+  // Implement both the full and the compact (the delta) serializations.
+  static std::string SerializeHistogram(const Histogram& histogram,
+                                        const SampleSet& snapshot,
+                                        bool compact);
+  static bool DeserializeHistogram(const std::string& histogram_info,
+                                   bool compact);
+
   // Allow tests to corrupt our innards for testing purposes.
   FRIEND_TEST(HistogramTest, CorruptBucketBounds);
   FRIEND_TEST(HistogramTest, CorruptSampleCounts);
@@ -535,6 +582,11 @@ class BASE_EXPORT Histogram {
   // Post constructor initialization.
   void Initialize();
 
+  // Moves the sample counters into |counters|, a record in the
+  // StatisticsRecorder's shared memory segment.  Only called before the
+  // histogram is handed out.
+  void UseSharedCounters(volatile subtle::Atomic32* counters);
+
   // Checksum function for accumulating range values into a checksum.
   static uint32 Crc32(uint32 sum, Sample range);
 
@@ -594,6 +646,12 @@ class BASE_EXPORT Histogram {
   // sample.
   SampleSet sample_;
 
+  // The counters that Accumulate() updates instead of |sample_| when
+  // kThreadSafeFlag is set.  Samples merged in through AddSampleSet() still
+  // go to |sample_|.  NULL for other histograms.
+  class AtomicSampleSet;
+  scoped_ptr<AtomicSampleSet> atomic_sample_;
+
   DISALLOW_COPY_AND_ASSIGN(Histogram);
 };
 
@@ -749,19 +807,52 @@ class BASE_EXPORT StatisticsRecorder {
   // pointer to be copied.
   static void GetSnapshot(const std::string& query, Histograms* snapshot);
 
+  // Creates a shared memory segment of |size| bytes that will hold the
+  // samples of all histograms registered from now on, so that another
+  // process can read them with a HistogramSharedMemoryReader.  Histograms
+  // registered before this call, and any that don't fit, stay private.
+  // Returns false if the segment couldn't be created.
+  static bool EnableSharedMemoryExport(uint32 size);
+
+  // Returns the segment created by EnableSharedMemoryExport(), for sharing
+  // with the reading process, or NULL.
+  static SharedMemory* GetExportSharedMemory();
+
+  // Serializes, with Histogram::SerializeHistogramDelta(), the samples each
+  // histogram with all of |required_flags| gained since the last call, and
+  // appends them to |deltas|.  The histograms without new samples are
+  // skipped, so that the cost of a metrics upload follows the activity
+  // rather than the number of histograms; the first call gives all the
+  // samples.  Corrupt snapshots are skipped and retried on the next call.
+  // As for SerializeHistogramInfo(), the histograms whose deltas are sent
+  // over IPC need kIPCSerializationSourceFlag first.
+  static void GetHistogramDeltas(Histogram::Flags required_flags,
+                                 std::vector<std::string>* deltas);
 
  private:
   // We keep all registered histograms in a map, from name to histogram.
   typedef std::map<std::string, Histogram*> HistogramMap;
 
+  // The samples of each histogram as of the last GetHistogramDeltas().
+  typedef std::map<std::string, Histogram::SampleSet> LoggedSampleMap;
+
   static HistogramMap* histograms_;
 
-  // lock protects access to the above map.
-  static base::Lock* lock_;
+  // lock protects access to the above map. Looking histograms up, which is
+  // most of what is done with it, only takes it for reading.
+  static base::ReadWriteLock* lock_;
 
   // Dump all known histograms to log.
   static bool dump_on_exit_;
 
+  // Set by EnableSharedMemoryExport(); protected by |lock_|.
+  static HistogramSharedMemory* shared_memory_;
+
+  // Only used by GetHistogramDeltas(), under |logged_samples_lock_|, which
+  // is leaked like |lock_|.
+  static LoggedSampleMap* logged_samples_;
+  static base::Lock* logged_samples_lock_;
+
   DISALLOW_COPY_AND_ASSIGN(StatisticsRecorder);
 };
 
@@ -0,0 +1,244 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/metrics/histogram_shared_memory.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+#include "base/process_util.h"
+
+namespace base {
+
+namespace {
+
+const uint32 kMagic = 0x48495354;  // "HIST"
+const uint32 kVersion = 1;
+
+struct SegmentHeader {
+  uint32 magic;
+  uint32 version;
+  // The creating process, to detect single process mode.
+  uint32 process_id;
+  uint32 size;
+  // Bytes in use, including this header.  Stored with release semantics once
+  // the record it covers is complete.
+  volatile subtle::Atomic32 used;
+};
+
+struct RecordHeader {
+  // Including this header, the name and the counters.
+  uint32 record_size;
+  int32 histogram_type;
+  int32 declared_min;
+  int32 declared_max;
+  uint32 bucket_count;
+  uint32 range_checksum;
+  int32 flags;
+  uint32 name_length;
+  // Followed by the name, padded to a multiple of 4 bytes, and then
+  // HistogramSharedMemory::kFirstBucketIndex + bucket_count counters.
+};
+
+uint32 PaddedNameLength(uint32 name_length) {
+  return (name_length + 3) & ~3;
+}
+
+}  // namespace
+
+//------------------------------------------------------------------------------
+// HistogramSharedMemory
+
+HistogramSharedMemory::HistogramSharedMemory() {
+}
+
+HistogramSharedMemory::~HistogramSharedMemory() {
+}
+
+bool HistogramSharedMemory::Create(uint32 size) {
+  if (size < sizeof(SegmentHeader) ||
+      !shared_memory_.CreateAndMapAnonymous(size))
+    return false;
+  SegmentHeader* header = static_cast<SegmentHeader*>(shared_memory_.memory());
+  header->magic = kMagic;
+  header->version = kVersion;
+  header->process_id = static_cast<uint32>(GetCurrentProcId());
+  header->size = size;
+  subtle::Release_Store(&header->used, sizeof(SegmentHeader));
+  return true;
+}
+
+volatile subtle::Atomic32* HistogramSharedMemory::AllocateRecord(
+    const Histogram& histogram) {
+  SegmentHeader* header = static_cast<SegmentHeader*>(shared_memory_.memory());
+  DCHECK(header);
+  const std::string& name = histogram.histogram_name();
+  uint32 name_length = static_cast<uint32>(name.size());
+  uint32 record_size = sizeof(RecordHeader) + PaddedNameLength(name_length) +
+      (kFirstBucketIndex + histogram.bucket_count()) * sizeof(subtle::Atomic32);
+  uint32 used = subtle::NoBarrier_Load(&header->used);
+  if (record_size > header->size - used)
+    return NULL;
+
+  char* start = static_cast<char*>(shared_memory_.memory()) + used;
+  RecordHeader* record = reinterpret_cast<RecordHeader*>(start);
+  record->record_size = record_size;
+  record->histogram_type = histogram.histogram_type();
+  record->declared_min = histogram.declared_min();
+  record->declared_max = histogram.declared_max();
+  record->bucket_count = static_cast<uint32>(histogram.bucket_count());
+  record->range_checksum = histogram.range_checksum();
+  record->flags = histogram.flags();
+  record->name_length = name_length;
+  memcpy(start + sizeof(RecordHeader), name.data(), name_length);
+  // The rest of an anonymous mapping is already zero.
+
+  subtle::Release_Store(&header->used, used + record_size);
+  return reinterpret_cast<volatile subtle::Atomic32*>(
+      start + sizeof(RecordHeader) + PaddedNameLength(name_length));
+}
+
+//------------------------------------------------------------------------------
+// HistogramSharedMemoryReader
+
+HistogramSharedMemoryReader::Record::Record()
+    : histogram(NULL),
+      counters(NULL) {
+}
+
+HistogramSharedMemoryReader::Record::~Record() {
+}
+
+HistogramSharedMemoryReader::HistogramSharedMemoryReader(
+    SharedMemoryHandle handle,
+    uint32 size)
+    : shared_memory_(handle, true),
+      size_(size),
+      read_offset_(sizeof(SegmentHeader)),
+      same_process_(false) {
+}
+
+HistogramSharedMemoryReader::~HistogramSharedMemoryReader() {
+}
+
+bool HistogramSharedMemoryReader::Init() {
+  if (size_ < sizeof(SegmentHeader) || !shared_memory_.Map(size_))
+    return false;
+  const SegmentHeader* header =
+      static_cast<const SegmentHeader*>(shared_memory_.memory());
+  if (header->magic != kMagic || header->version != kVersion ||
+      header->size != size_) {
+    LOG(ERROR) << "Invalid histogram shared memory segment";
+    shared_memory_.Unmap();
+    return false;
+  }
+  same_process_ =
+      header->process_id == static_cast<uint32>(GetCurrentProcId());
+  return true;
+}
+
+size_t HistogramSharedMemoryReader::MergeIntoLocalHistograms() {
+  if (!shared_memory_.memory() || same_process_)
+    return 0;
+  ReadNewRecords();
+
+  size_t updated = 0;
+  for (size_t i = 0; i < records_.size(); ++i) {
+    Record& record = records_[i];
+    if (!record.histogram)
+      continue;
+    size_t bucket_count = record.histogram->bucket_count();
+    Histogram::Counts counts(bucket_count);
+    for (size_t j = 0; j < bucket_count; ++j) {
+      counts[j] = subtle::NoBarrier_Load(
+          &record.counters[HistogramSharedMemory::kFirstBucketIndex + j]);
+    }
+    uint32 sum_low = static_cast<uint32>(subtle::NoBarrier_Load(
+        &record.counters[HistogramSharedMemory::kSumLowIndex]));
+    int64 sum_high = subtle::NoBarrier_Load(
+        &record.counters[HistogramSharedMemory::kSumHighIndex]);
+    Histogram::SampleSet current;
+    current.Resize(*record.histogram);
+    current.AddCounts(counts, (sum_high << 32) + sum_low,
+                      subtle::NoBarrier_Load(
+                          &record.counters[
+                              HistogramSharedMemory::kRedundantCountIndex]));
+
+    Histogram::SampleSet delta = current;
+    delta.Subtract(record.merged);
+    if (delta.redundant_count() == 0)
+      continue;
+    record.histogram->AddSampleSet(delta);
+    record.merged = current;
+    ++updated;
+  }
+  return updated;
+}
+
+void HistogramSharedMemoryReader::ReadNewRecords() {
+  const char* base = static_cast<const char*>(shared_memory_.memory());
+  const SegmentHeader* header = reinterpret_cast<const SegmentHeader*>(base);
+  uint32 used = subtle::Acquire_Load(&header->used);
+  // The segment may come from an untrusted process; check everything.
+  if (used > size_)
+    used = size_;
+
+  while (used - read_offset_ >= sizeof(RecordHeader)) {
+    const RecordHeader* record_header =
+        reinterpret_cast<const RecordHeader*>(base + read_offset_);
+    uint32 record_size = record_header->record_size;
+    uint32 name_length = record_header->name_length;
+    uint32 bucket_count = record_header->bucket_count;
+    if (record_size > used - read_offset_ ||
+        name_length > record_size ||
+        bucket_count < 2 ||
+        bucket_count > Histogram::kBucketCount_MAX ||
+        record_size != sizeof(RecordHeader) + PaddedNameLength(name_length) +
+            (HistogramSharedMemory::kFirstBucketIndex + bucket_count) *
+                sizeof(subtle::Atomic32)) {
+      LOG(ERROR) << "Corrupt histogram shared memory record";
+      read_offset_ = used;
+      return;
+    }
+
+    const char* name_start = base + read_offset_ + sizeof(RecordHeader);
+    std::string name(name_start, name_length);
+    Histogram::Flags flags =
+        static_cast<Histogram::Flags>(record_header->flags);
+    int declared_min = record_header->declared_min;
+    int declared_max = record_header->declared_max;
+    Histogram* histogram = NULL;
+    if (declared_max <= 0 || declared_min <= 0 ||
+        declared_max < declared_min) {
+      LOG(ERROR) << "Values error in shared histogram: " << name;
+    } else if (record_header->histogram_type == Histogram::HISTOGRAM) {
+      histogram = Histogram::FactoryGet(
+          name, declared_min, declared_max, bucket_count, flags);
+    } else if (record_header->histogram_type == Histogram::LINEAR_HISTOGRAM) {
+      histogram = LinearHistogram::FactoryGet(
+          name, declared_min, declared_max, bucket_count, flags);
+    } else if (record_header->histogram_type == Histogram::BOOLEAN_HISTOGRAM) {
+      histogram = BooleanHistogram::FactoryGet(name, flags);
+    } else {
+      LOG(ERROR) << "Unknown type in shared histogram: " << name;
+    }
+    if (histogram &&
+        (histogram->bucket_count() != bucket_count ||
+         histogram->range_checksum() != record_header->range_checksum)) {
+      LOG(ERROR) << "Shared histogram does not match local one: " << name;
+      histogram = NULL;
+    }
+
+    Record record;
+    record.histogram = histogram;
+    record.counters = reinterpret_cast<const volatile subtle::Atomic32*>(
+        name_start + PaddedNameLength(name_length));
+    if (histogram)
+      record.merged.Resize(*histogram);
+    records_.push_back(record);
+    read_offset_ += record_size;
+  }
+}
+
+}  // namespace base
@@ -0,0 +1,111 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Support for keeping histogram samples in a shared memory segment, so that
+// another process can read them in place instead of receiving pickled copies
+// (see Histogram::SerializeHistogramInfo).
+//
+// A child process calls StatisticsRecorder::EnableSharedMemoryExport() early
+// on; every histogram registered afterwards (other than CustomHistograms,
+// whose ranges cannot be described in a record) keeps its counters in the
+// segment, and is thread safe as if created with Histogram::kThreadSafeFlag.
+// The child shares the segment's handle with its parent once, and the parent
+// periodically calls HistogramSharedMemoryReader::MergeIntoLocalHistograms().
+//
+// The segment holds a header followed by one record per histogram.  Records
+// are only ever appended, under the StatisticsRecorder lock; the header's
+// |used| size is published with a release store after each record is
+// complete, so readers never see a partially written record.
+
+#ifndef BASE_METRICS_HISTOGRAM_SHARED_MEMORY_H_
+#define BASE_METRICS_HISTOGRAM_SHARED_MEMORY_H_
+#pragma once
+
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/metrics/histogram.h"
+#include "base/shared_memory.h"
+
+namespace base {
+
+// The writer side: owns the segment and appends records to it.
+class BASE_EXPORT HistogramSharedMemory {
+ public:
+  // The counters of a record, in order.  Histogram::AtomicSampleSet uses the
+  // same layout for histograms that are not in shared memory.
+  enum CounterIndex {
+    kSumLowIndex,
+    kSumHighIndex,
+    kRedundantCountIndex,
+    kFirstBucketIndex
+  };
+
+  HistogramSharedMemory();
+  ~HistogramSharedMemory();
+
+  // Creates and maps a segment of |size| bytes.
+  bool Create(uint32 size);
+
+  // Appends a record describing |histogram| and returns its counters, all
+  // zero, or returns NULL if the segment is full.  Must be called with the
+  // StatisticsRecorder lock held.
+  volatile subtle::Atomic32* AllocateRecord(const Histogram& histogram);
+
+  // The segment, for sharing its handle with the reading process.
+  SharedMemory* shared_memory() { return &shared_memory_; }
+
+ private:
+  SharedMemory shared_memory_;
+
+  DISALLOW_COPY_AND_ASSIGN(HistogramSharedMemory);
+};
+
+// The reader side: maps another process's segment read-only and folds the
+// samples it has gained into this process's histograms.
+class BASE_EXPORT HistogramSharedMemoryReader {
+ public:
+  // |size| is the size the segment was created with.
+  HistogramSharedMemoryReader(SharedMemoryHandle handle, uint32 size);
+  ~HistogramSharedMemoryReader();
+
+  // Maps the segment and checks its header.
+  bool Init();
+
+  // Adds the samples recorded since the previous call to the identically
+  // named histograms of this process, creating them if needed.  Nothing is
+  // merged if the segment was created by this process (single process mode),
+  // since the samples are already in its histograms.  Returns the number of
+  // histograms that had new samples.
+  size_t MergeIntoLocalHistograms();
+
+ private:
+  struct Record {
+    Record();
+    ~Record();
+
+    Histogram* histogram;
+    const volatile subtle::Atomic32* counters;
+    // The samples merged so far.
+    Histogram::SampleSet merged;
+  };
+
+  // Picks up records appended since the last call.
+  void ReadNewRecords();
+
+  SharedMemory shared_memory_;
+  const uint32 size_;
+  // Offset of the first record not yet picked up.
+  uint32 read_offset_;
+  bool same_process_;
+  std::vector<Record> records_;
+
+  DISALLOW_COPY_AND_ASSIGN(HistogramSharedMemoryReader);
+};
+
+}  // namespace base
+
+#endif  // BASE_METRICS_HISTOGRAM_SHARED_MEMORY_H_
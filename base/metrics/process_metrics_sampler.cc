@@ -0,0 +1,179 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/metrics/process_metrics_sampler.h"
+
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/metrics/histogram.h"
+#include "base/process_util.h"
+
+namespace base {
+
+namespace {
+
+const size_t kBucketCount = 50;
+
+Histogram* CreateHistogram(const std::string& name,
+                           const std::string& type,
+                           int maximum) {
+  return Histogram::FactoryGet("Process." + name + ":" + type, 1, maximum,
+                               kBucketCount, Histogram::kNoFlags);
+}
+
+// Adds |value| to |histogram|, clamped to the int range it takes.
+void AddSample(Histogram* histogram, int64 value) {
+  if (value < 0)
+    value = 0;
+  if (value > kint32max)
+    value = kint32max;
+  histogram->Add(static_cast<int>(value));
+}
+
+// Returns |count| per second of |elapsed|.
+int64 PerSecond(uint64 count, TimeDelta elapsed) {
+  int64 elapsed_us = elapsed.InMicroseconds();
+  if (elapsed_us <= 0)
+    return 0;
+  return static_cast<int64>(count * Time::kMicrosecondsPerSecond /
+                            elapsed_us);
+}
+
+uint64 GetIOBytes(const IoCounters& counters) {
+  return counters.ReadTransferCount + counters.WriteTransferCount +
+         counters.OtherTransferCount;
+}
+
+}  // namespace
+
+ProcessMetricsSampler::TypeHistograms::TypeHistograms()
+    : cpu_usage(NULL),
+      working_set_mb(NULL),
+      private_mb(NULL),
+      io_kb_per_second(NULL),
+      page_faults_per_second(NULL),
+      handles(NULL) {
+}
+
+ProcessMetricsSampler::SampledProcess::SampledProcess()
+    : metrics(NULL),
+      histograms(NULL),
+      io_bytes(0),
+      page_faults(0),
+      has_previous_sample(false) {
+}
+
+ProcessMetricsSampler::ProcessMetricsSampler(TimeDelta interval)
+    : interval_(interval) {
+}
+
+ProcessMetricsSampler::~ProcessMetricsSampler() {
+  for (ProcessMap::iterator i = processes_.begin(); i != processes_.end();
+       ++i)
+    delete i->second.metrics;
+}
+
+void ProcessMetricsSampler::AddProcess(ProcessHandle process,
+                                       const std::string& type) {
+  DCHECK(!processes_.count(process));
+  SampledProcess& sampled = processes_[process];
+#if defined(OS_MACOSX)
+  sampled.metrics = ProcessMetrics::CreateProcessMetrics(process, NULL);
+#else
+  sampled.metrics = ProcessMetrics::CreateProcessMetrics(process);
+#endif
+  sampled.histograms = GetTypeHistograms(type);
+  // Starts the CPU usage interval.
+  sampled.metrics->GetCPUUsage();
+  SampleProcess(&sampled, TimeTicks::Now());
+
+  if (!timer_.IsRunning())
+    timer_.Start(FROM_HERE, interval_, this, &ProcessMetricsSampler::Sample);
+}
+
+void ProcessMetricsSampler::RemoveProcess(ProcessHandle process) {
+  ProcessMap::iterator i = processes_.find(process);
+  if (i == processes_.end())
+    return;
+  delete i->second.metrics;
+  processes_.erase(i);
+  if (processes_.empty())
+    timer_.Stop();
+}
+
+const ProcessMetricsSampler::TypeHistograms*
+ProcessMetricsSampler::GetTypeHistograms(const std::string& type) {
+  std::map<std::string, TypeHistograms>::iterator i =
+      type_histograms_.find(type);
+  if (i != type_histograms_.end())
+    return &i->second;
+
+  TypeHistograms& histograms = type_histograms_[type];
+  histograms.cpu_usage = CreateHistogram("CPUUsage", type, 100);
+  histograms.working_set_mb = CreateHistogram("WorkingSetMB", type, 4096);
+  histograms.private_mb = CreateHistogram("PrivateMB", type, 4096);
+  histograms.io_kb_per_second =
+      CreateHistogram("IOKBPerSecond", type, 1000 * 1000);
+#if defined(OS_WIN)
+  histograms.page_faults_per_second =
+      CreateHistogram("PageFaultsPerSecond", type, 1000 * 1000);
+  histograms.handles = CreateHistogram("Handles", type, 100 * 1000);
+#endif
+  return &histograms;
+}
+
+void ProcessMetricsSampler::Sample() {
+  TimeTicks now = TimeTicks::Now();
+  for (ProcessMap::iterator i = processes_.begin(); i != processes_.end();
+       ++i)
+    SampleProcess(&i->second, now);
+}
+
+void ProcessMetricsSampler::SampleProcess(SampledProcess* process,
+                                          TimeTicks now) {
+  ProcessMetrics* metrics = process->metrics;
+  const TypeHistograms* histograms = process->histograms;
+  const size_t kMegabyte = 1024 * 1024;
+
+  AddSample(histograms->working_set_mb,
+            metrics->GetWorkingSetSize() / kMegabyte);
+  size_t private_bytes = 0;
+  if (metrics->GetMemoryBytes(&private_bytes, NULL))
+    AddSample(histograms->private_mb, private_bytes / kMegabyte);
+#if defined(OS_WIN)
+  AddSample(histograms->handles, metrics->GetHandleCount());
+#endif
+
+  // The counters are only read here, and turned into rates from the next
+  // sample on.
+  IoCounters io_counters;
+  bool has_io_counters = metrics->GetIOCounters(&io_counters);
+  uint64 io_bytes = has_io_counters ? GetIOBytes(io_counters) : 0;
+#if defined(OS_WIN)
+  size_t page_faults = metrics->GetPageFaultCount();
+#endif
+  if (process->has_previous_sample) {
+    TimeDelta elapsed = now - process->sample_time;
+    AddSample(histograms->cpu_usage,
+              static_cast<int64>(metrics->GetCPUUsage()));
+    if (has_io_counters && io_bytes >= process->io_bytes) {
+      AddSample(histograms->io_kb_per_second,
+                PerSecond(io_bytes - process->io_bytes, elapsed) / 1024);
+    }
+#if defined(OS_WIN)
+    if (page_faults >= process->page_faults) {
+      AddSample(histograms->page_faults_per_second,
+                PerSecond(page_faults - process->page_faults, elapsed));
+    }
+#endif
+  }
+  process->sample_time = now;
+  process->io_bytes = io_bytes;
+#if defined(OS_WIN)
+  process->page_faults = page_faults;
+#endif
+  process->has_previous_sample = true;
+}
+
+}  // namespace base
@@ -0,0 +1,101 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_METRICS_PROCESS_METRICS_SAMPLER_H_
+#define BASE_METRICS_PROCESS_METRICS_SAMPLER_H_
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/process.h"
+#include "base/time.h"
+#include "base/timer.h"
+
+namespace base {
+
+class Histogram;
+class ProcessMetrics;
+
+// Samples the resource usage of a set of processes at a fixed interval, into
+// histograms, so that the jank measured elsewhere can be correlated with
+// memory pressure. The processes are grouped by type, such as "Browser" or
+// "Renderer", and the processes of a type share their histograms:
+//
+//   Process.CPUUsage:Renderer          percent of all the CPUs
+//   Process.WorkingSetMB:Renderer
+//   Process.PrivateMB:Renderer
+//   Process.IOKBPerSecond:Renderer     read, written and other
+//   Process.PageFaultsPerSecond:Renderer  (Windows only)
+//   Process.Handles:Renderer              (Windows only)
+//
+// The rates are over the time since the previous sample, so the first sample
+// of a process has none. Only the counters that the OS keeps for the process
+// are read, such as GetProcessMemoryInfo() on Windows, and not the working
+// set breakdown, which walks the pages of the process.
+//
+// A sampler is used on a single thread, which must have a MessageLoop.
+class BASE_EXPORT ProcessMetricsSampler {
+ public:
+  explicit ProcessMetricsSampler(TimeDelta interval);
+  ~ProcessMetricsSampler();
+
+  // Starts sampling |process| into the histograms of |type|. The handle isn't
+  // owned, and must stay valid until RemoveProcess().
+  void AddProcess(ProcessHandle process, const std::string& type);
+
+  // Stops sampling |process|.
+  void RemoveProcess(ProcessHandle process);
+
+ private:
+  // The histograms of a type of process. Owned by the StatisticsRecorder.
+  struct TypeHistograms {
+    TypeHistograms();
+
+    Histogram* cpu_usage;
+    Histogram* working_set_mb;
+    Histogram* private_mb;
+    Histogram* io_kb_per_second;
+    Histogram* page_faults_per_second;
+    Histogram* handles;
+  };
+
+  struct SampledProcess {
+    SampledProcess();
+
+    // Owned, deleted by RemoveProcess() or the destructor.
+    ProcessMetrics* metrics;
+    const TypeHistograms* histograms;
+
+    // The time and the counters of the previous sample, for the rates.
+    TimeTicks sample_time;
+    uint64 io_bytes;
+    size_t page_faults;
+    bool has_previous_sample;
+  };
+
+  typedef std::map<ProcessHandle, SampledProcess> ProcessMap;
+
+  // Returns the histograms of |type|, creating them if needed.
+  const TypeHistograms* GetTypeHistograms(const std::string& type);
+
+  // Samples all the processes. Run by |timer_|.
+  void Sample();
+
+  // Samples |process| at |now|.
+  void SampleProcess(SampledProcess* process, TimeTicks now);
+
+  const TimeDelta interval_;
+  RepeatingTimer<ProcessMetricsSampler> timer_;
+  ProcessMap processes_;
+  std::map<std::string, TypeHistograms> type_histograms_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProcessMetricsSampler);
+};
+
+}  // namespace base
+
+#endif  // BASE_METRICS_PROCESS_METRICS_SAMPLER_H_
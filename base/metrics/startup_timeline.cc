@@ -0,0 +1,189 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/metrics/startup_timeline.h"
+
+#include <string.h>
+
+#include "base/atomicops.h"
+#include "base/debug/trace_event.h"
+#include "base/lazy_instance.h"
+#include "base/metrics/histogram.h"
+#include "base/stringprintf.h"
+#include "base/synchronization/lock.h"
+
+#if defined(OS_WIN)
+#include <windows.h>
+#endif
+
+namespace base {
+
+namespace {
+
+// Set by Finish(), read without the lock by IsRecording().
+subtle::Atomic32 g_finished = 0;
+
+// Returns the TimeTicks at which the process was created, or a null TimeTicks
+// if the OS doesn't tell.
+TimeTicks GetProcessCreationTicks() {
+#if defined(OS_WIN)
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  if (::GetProcessTimes(::GetCurrentProcess(), &creation_time, &exit_time,
+                        &kernel_time, &user_time)) {
+    TimeDelta age = Time::Now() - Time::FromFileTime(creation_time);
+    if (age >= TimeDelta())
+      return TimeTicks::Now() - age;
+  }
+#endif
+  return TimeTicks();
+}
+
+struct Timeline {
+  Timeline() : start(GetProcessCreationTicks()) {
+  }
+
+  // Returns the record called |name| in |records|, or NULL.
+  StartupTimeline::Record* Find(std::vector<StartupTimeline::Record>* records,
+                                const char* name) {
+    for (size_t i = 0; i < records->size(); ++i) {
+      if (strcmp((*records)[i].name, name) == 0)
+        return &(*records)[i];
+    }
+    return NULL;
+  }
+
+  Lock lock;
+  TimeTicks start;
+  std::vector<StartupTimeline::Record> milestones;
+  std::vector<StartupTimeline::Record> steps;
+};
+
+// Leaky, as the first records come before there is an AtExitManager.
+LazyInstance<Timeline, LeakyLazyInstanceTraits<Timeline> > g_timeline(
+    LINKER_INITIALIZED);
+
+Histogram* GetHistogram(const char* name) {
+  return Histogram::FactoryTimeGet(std::string("Startup.") + name,
+                                   TimeDelta::FromMilliseconds(1),
+                                   TimeDelta::FromSeconds(60), 50,
+                                   Histogram::kUmaTargetedHistogramFlag);
+}
+
+}  // namespace
+
+StartupTimeline::Record::Record() : name(""), count(0) {
+}
+
+StartupTimeline::ScopedStep::ScopedStep(const char* name) : name_(name) {
+  if (IsRecording())
+    start_ = TimeTicks::Now();
+}
+
+StartupTimeline::ScopedStep::~ScopedStep() {
+  if (!start_.is_null())
+    AddStepTime(name_, TimeTicks::Now() - start_);
+}
+
+// static
+void StartupTimeline::RecordMilestone(const char* name) {
+  if (!IsRecording())
+    return;
+  TimeTicks now = TimeTicks::Now();
+  Timeline& timeline = g_timeline.Get();
+  AutoLock lock(timeline.lock);
+  if (timeline.start.is_null())
+    timeline.start = now;
+  if (timeline.Find(&timeline.milestones, name))
+    return;
+  Record record;
+  record.name = name;
+  record.time = now - timeline.start;
+  timeline.milestones.push_back(record);
+}
+
+// static
+void StartupTimeline::AddStepTime(const char* name, TimeDelta time) {
+  if (!IsRecording())
+    return;
+  Timeline& timeline = g_timeline.Get();
+  AutoLock lock(timeline.lock);
+  if (timeline.start.is_null())
+    timeline.start = TimeTicks::Now() - time;
+  Record* record = timeline.Find(&timeline.steps, name);
+  if (!record) {
+    timeline.steps.push_back(Record());
+    record = &timeline.steps.back();
+    record->name = name;
+  }
+  record->time += time;
+  record->count++;
+}
+
+// static
+bool StartupTimeline::IsRecording() {
+  return !subtle::Acquire_Load(&g_finished);
+}
+
+// static
+void StartupTimeline::Finish() {
+  if (subtle::NoBarrier_CompareAndSwap(&g_finished, 0, 1) != 0)
+    return;
+
+  std::vector<Record> milestones;
+  std::vector<Record> steps;
+  GetMilestones(&milestones);
+  GetSteps(&steps);
+  for (size_t i = 0; i < milestones.size(); ++i) {
+    GetHistogram(milestones[i].name)->AddTime(milestones[i].time);
+    TRACE_EVENT_INSTANT1("startup", milestones[i].name,
+                         "us", milestones[i].time.InMicroseconds());
+  }
+  for (size_t i = 0; i < steps.size(); ++i) {
+    GetHistogram(steps[i].name)->AddTime(steps[i].time);
+    TRACE_EVENT_INSTANT2("startup", steps[i].name,
+                         "us", steps[i].time.InMicroseconds(),
+                         "count", steps[i].count);
+  }
+}
+
+// static
+void StartupTimeline::GetMilestones(std::vector<Record>* milestones) {
+  Timeline& timeline = g_timeline.Get();
+  AutoLock lock(timeline.lock);
+  *milestones = timeline.milestones;
+}
+
+// static
+void StartupTimeline::GetSteps(std::vector<Record>* steps) {
+  Timeline& timeline = g_timeline.Get();
+  AutoLock lock(timeline.lock);
+  *steps = timeline.steps;
+}
+
+// static
+void StartupTimeline::WriteAscii(std::string* output) {
+  std::vector<Record> milestones;
+  std::vector<Record> steps;
+  GetMilestones(&milestones);
+  GetSteps(&steps);
+
+  output->append("Milestones  at(ms)  since previous(ms)\n");
+  TimeDelta previous;
+  for (size_t i = 0; i < milestones.size(); ++i) {
+    StringAppendF(output, "%10.1f %10.1f  %s\n",
+                  milestones[i].time.InMillisecondsF(),
+                  (milestones[i].time - previous).InMillisecondsF(),
+                  milestones[i].name);
+    previous = milestones[i].time;
+  }
+
+  output->append("Steps  total(ms)  count\n");
+  for (size_t i = 0; i < steps.size(); ++i) {
+    StringAppendF(output, "%10.1f %6d  %s\n",
+                  steps[i].time.InMillisecondsF(), steps[i].count,
+                  steps[i].name);
+  }
+}
+
+}  // namespace base
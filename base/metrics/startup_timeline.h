@@ -0,0 +1,90 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_METRICS_STARTUP_TIMELINE_H_
+#define BASE_METRICS_STARTUP_TIMELINE_H_
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/time.h"
+
+namespace base {
+
+// StartupTimeline tells where the time goes between the start of the process
+// and its first paint. It keeps two kinds of records:
+//
+//   Milestones, the points startup passes once, such as the first Widget
+//   being created. Only the first RecordMilestone() of a name counts.
+//
+//   Steps, the work startup does many times, such as PathService lookups.
+//   Their times are summed per name by ScopedStep.
+//
+// Times are monotonic, and measured from the creation of the process where
+// the OS tells it, else from the first record. Recording is cheap and stops at
+// Finish(), which also reports the records as "Startup.<name>" histograms and
+// as "startup" trace events. Reporting waits for Finish() because the
+// earliest records, such as CommandLine::Init(), come before the
+// AtExitManager that the StatisticsRecorder and the TraceLog depend on.
+class BASE_EXPORT StartupTimeline {
+ public:
+  struct BASE_EXPORT Record {
+    Record();
+
+    // A milestone or step name, which lives as long as the process.
+    const char* name;
+
+    // For a milestone, the time from the start of the process to it. For a
+    // step, the total time spent in it.
+    TimeDelta time;
+
+    // How many times a step was taken; 0 for a milestone.
+    int count;
+  };
+
+  // Times the scope it lives in as one taking of the step |name|, which lives
+  // as long as the process.
+  class BASE_EXPORT ScopedStep {
+   public:
+    explicit ScopedStep(const char* name);
+    ~ScopedStep();
+
+   private:
+    const char* name_;
+    TimeTicks start_;  // Null if not recording.
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedStep);
+  };
+
+  // Records that startup has reached |name|, unless it already did.
+  static void RecordMilestone(const char* name);
+
+  // Adds |time| to the step |name|.
+  static void AddStepTime(const char* name, TimeDelta time);
+
+  // True until Finish().
+  static bool IsRecording();
+
+  // Stops recording and reports the records. Later calls do nothing.
+  static void Finish();
+
+  // Returns the milestones, in the order they were reached, and the steps, in
+  // the order they were first taken.
+  static void GetMilestones(std::vector<Record>* milestones);
+  static void GetSteps(std::vector<Record>* steps);
+
+  // Writes the milestones, with the time between each and the previous one,
+  // and the steps, as a table.
+  static void WriteAscii(std::string* output);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(StartupTimeline);
+};
+
+}  // namespace base
+
+#endif  // BASE_METRICS_STARTUP_TIMELINE_H_
@@ -0,0 +1,120 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/metrics/task_timing_recorder.h"
+
+#include "base/location.h"
+#include "base/metrics/histogram.h"
+#include "base/stringprintf.h"
+
+namespace base {
+
+namespace {
+
+// Histogram range, in microseconds: 1us to 10s.
+const int kMinSampleUs = 1;
+const int kMaxSampleUs = 10 * 1000 * 1000;
+const size_t kBucketCount = 50;
+
+// Returns the last path component of |file_name|.
+const char* BaseName(const char* file_name) {
+  if (!file_name)
+    return "";
+  const char* base_name = file_name;
+  for (const char* p = file_name; *p; ++p) {
+    if (*p == '/' || *p == '\\')
+      base_name = p + 1;
+  }
+  return base_name;
+}
+
+void AddSample(Histogram* histogram, TimeDelta delta) {
+  int64 us = delta.InMicroseconds();
+  if (us < 0)
+    us = 0;
+  if (us > kMaxSampleUs)
+    us = kMaxSampleUs;
+  histogram->Add(static_cast<int>(us));
+}
+
+}  // namespace
+
+// static
+const size_t TaskTimingRecorder::kMaxSites;
+
+TaskTimingRecorder::TaskTimingRecorder(const std::string& thread_name)
+    : thread_name_(thread_name),
+      loop_histograms_(CreateHistograms(std::string())),
+      other_histograms_(CreateHistograms(":Other")) {
+}
+
+TaskTimingRecorder::~TaskTimingRecorder() {
+  // The histograms are owned by the StatisticsRecorder.
+}
+
+void TaskTimingRecorder::RecordTask(
+    const tracked_objects::Location& posted_from,
+    const char* priority_name,
+    TimeTicks runnable_time,
+    TimeTicks start_time,
+    TimeTicks end_time) {
+  TimeDelta queue_delay = start_time - runnable_time;
+  TimeDelta run_time = end_time - start_time;
+
+  AddSample(loop_histograms_.queue_delay, queue_delay);
+  AddSample(loop_histograms_.run_time, run_time);
+
+  const SiteHistograms& site = GetSiteHistograms(posted_from);
+  AddSample(site.queue_delay, queue_delay);
+  AddSample(site.run_time, run_time);
+
+  AddSample(GetPriorityHistogram(priority_name), queue_delay);
+}
+
+TaskTimingRecorder::SiteHistograms TaskTimingRecorder::CreateHistograms(
+    const std::string& suffix) const {
+  SiteHistograms histograms;
+  histograms.queue_delay = Histogram::FactoryGet(
+      "MsgLoop.QueueDelay:" + thread_name_ + suffix,
+      kMinSampleUs, kMaxSampleUs, kBucketCount, Histogram::kNoFlags);
+  histograms.run_time = Histogram::FactoryGet(
+      "MsgLoop.RunTime:" + thread_name_ + suffix,
+      kMinSampleUs, kMaxSampleUs, kBucketCount, Histogram::kNoFlags);
+  return histograms;
+}
+
+const TaskTimingRecorder::SiteHistograms&
+TaskTimingRecorder::GetSiteHistograms(
+    const tracked_objects::Location& posted_from) {
+  SiteKey key(posted_from.file_name(), posted_from.line_number());
+  SiteMap::iterator it = sites_.find(key);
+  if (it != sites_.end())
+    return it->second;
+
+  if (sites_.size() >= kMaxSites)
+    return other_histograms_;
+
+  std::string suffix = StringPrintf(
+      ":%s@%s:%d",
+      posted_from.function_name() ? posted_from.function_name() : "",
+      BaseName(posted_from.file_name()),
+      posted_from.line_number());
+  return sites_.insert(std::make_pair(key, CreateHistograms(suffix))).
+      first->second;
+}
+
+Histogram* TaskTimingRecorder::GetPriorityHistogram(
+    const char* priority_name) {
+  PriorityMap::iterator it = priorities_.find(priority_name);
+  if (it != priorities_.end())
+    return it->second;
+
+  Histogram* histogram = Histogram::FactoryGet(
+      "MsgLoop.QueueDelay:" + thread_name_ + ":" + priority_name,
+      kMinSampleUs, kMaxSampleUs, kBucketCount, Histogram::kNoFlags);
+  priorities_[priority_name] = histogram;
+  return histogram;
+}
+
+}  // namespace base
@@ -0,0 +1,98 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_METRICS_TASK_TIMING_RECORDER_H_
+#define BASE_METRICS_TASK_TIMING_RECORDER_H_
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/time.h"
+
+namespace tracked_objects {
+class Location;
+}  // namespace tracked_objects
+
+namespace base {
+
+class Histogram;
+
+// Records how long tasks wait in a MessageLoop's queues and how long they run,
+// both for the loop as a whole and per posting site, into fixed-bucket
+// histograms.  Samples are in microseconds.  The histograms are registered
+// with the StatisticsRecorder, so they show up in
+// StatisticsRecorder::WriteHTMLGraph("MsgLoop.", ...).  For a loop whose
+// thread is named "UI" the histograms are:
+//
+//   MsgLoop.QueueDelay:UI                        all tasks
+//   MsgLoop.RunTime:UI                           all tasks
+//   MsgLoop.QueueDelay:UI:Function@file.cc:123   one posting site
+//   MsgLoop.RunTime:UI:Function@file.cc:123      one posting site
+//   MsgLoop.QueueDelay:UI:IdlePriority           one task priority
+//
+// To keep the cost bounded only the first kMaxSites posting sites get their
+// own histograms; later sites are folded into a ":Other" pair.
+//
+// A recorder is owned by and used only on its MessageLoop's thread.  See
+// MessageLoop::EnableTaskTimingHistograms().
+class BASE_EXPORT TaskTimingRecorder {
+ public:
+  static const size_t kMaxSites = 200;
+
+  explicit TaskTimingRecorder(const std::string& thread_name);
+  ~TaskTimingRecorder();
+
+  // Records one task.  |priority_name| names the queue the task waited in;
+  // it must be a long-lived string such as a literal.  |runnable_time| is
+  // when the task became eligible to run: the time it was posted, or for a
+  // delayed task its run time.
+  void RecordTask(const tracked_objects::Location& posted_from,
+                  const char* priority_name,
+                  TimeTicks runnable_time,
+                  TimeTicks start_time,
+                  TimeTicks end_time);
+
+ private:
+  struct SiteHistograms {
+    SiteHistograms() : queue_delay(NULL), run_time(NULL) {}
+
+    Histogram* queue_delay;
+    Histogram* run_time;
+  };
+
+  // Posting sites are identified by the (long-lived) file name string and
+  // line number of their Location.
+  typedef std::pair<const char*, int> SiteKey;
+  typedef std::map<SiteKey, SiteHistograms> SiteMap;
+
+  // Queue delay histograms, by priority name.
+  typedef std::map<const char*, Histogram*> PriorityMap;
+
+  // Creates the queue delay and run time histograms for |suffix|.
+  SiteHistograms CreateHistograms(const std::string& suffix) const;
+
+  // Returns the histograms for |posted_from|, creating them if needed.
+  const SiteHistograms& GetSiteHistograms(
+      const tracked_objects::Location& posted_from);
+
+  // Returns the queue delay histogram of |priority_name|, creating it if
+  // needed.
+  Histogram* GetPriorityHistogram(const char* priority_name);
+
+  const std::string thread_name_;
+  SiteHistograms loop_histograms_;
+  SiteHistograms other_histograms_;
+  SiteMap sites_;
+  PriorityMap priorities_;
+
+  DISALLOW_COPY_AND_ASSIGN(TaskTimingRecorder);
+};
+
+}  // namespace base
+
+#endif  // BASE_METRICS_TASK_TIMING_RECORDER_H_
@@ -7,16 +7,17 @@
 #pragma once
 
 #include <algorithm>
-#include <map>
 
 #include "base/basictypes.h"
 #include "base/callback_old.h"
+#include "base/flat_map.h"
 #include "base/location.h"
 #include "base/logging.h"
 #include "base/memory/ref_counted.h"
 #include "base/message_loop.h"
 #include "base/message_loop_proxy.h"
 #include "base/observer_list.h"
+#include "base/stack_container.h"
 #include "base/task.h"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -48,7 +49,9 @@
 //   The ObserverListThreadSafe maintains an ObserverList for each thread
 //   which uses the ThreadSafeObserver.  When Notifying the observers,
 //   we simply call PostTask to each registered thread, and then each thread
-//   will notify its regular ObserverList.
+//   will notify its regular ObserverList.  The method and its arguments are
+//   copied once into a ref-counted payload which all the tasks share, and
+//   the tasks are posted after |list_lock_| is released.
 //
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -97,9 +100,11 @@ class ObserverListThreadSafe
       return;  // Some unittests may access this without a message loop.
     {
       base::AutoLock lock(list_lock_);
-      if (observer_lists_.find(loop) == observer_lists_.end())
-        observer_lists_[loop] = new ObserverListContext(type_);
-      list = &(observer_lists_[loop]->list);
+      ObserverListContext*& context = observer_lists_[loop];
+      if (!context)
+        context = new ObserverListContext(type_);
+      ++context->observer_count;
+      list = &context->list;
     }
     list->AddObserver(obs);
   }
@@ -126,10 +131,13 @@ class ObserverListThreadSafe
       context = it->second;
       list = &context->list;
 
-      // If we're about to remove the last observer from the list,
-      // then we can remove this observer_list entirely.
-      if (list->HasObserver(obs) && list->size() == 1)
-        observer_lists_.erase(it);
+      if (list->HasObserver(obs)) {
+        --context->observer_count;
+        // If we're about to remove the last observer from the list,
+        // then we can remove this observer_list entirely.
+        if (list->size() == 1)
+          observer_lists_.erase(it);
+      }
     }
     list->RemoveObserver(obs);
 
@@ -187,15 +195,40 @@ class ObserverListThreadSafe
   struct ObserverListContext {
     explicit ObserverListContext(NotificationType type)
         : loop(base::MessageLoopProxy::current()),
-          list(type) {
+          list(type),
+          observer_count(0) {
     }
 
     scoped_refptr<base::MessageLoopProxy> loop;
     ObserverList<ObserverType> list;
 
+    // The number of observers in |list|, which other threads may read under
+    // |list_lock_|, unlike |list| itself.
+    int observer_count;
+
     DISALLOW_COPY_AND_ASSIGN(ObserverListContext);
   };
 
+  // The method of a Notify() and its arguments, which the tasks posted to
+  // each thread share.
+  template <class Method, class Params>
+  struct NotificationPayload
+      : public base::RefCountedThreadSafe<
+            NotificationPayload<Method, Params> > {
+    explicit NotificationPayload(
+        const UnboundMethod<ObserverType, Method, Params>& method)
+        : method(method) {
+    }
+
+    const UnboundMethod<ObserverType, Method, Params> method;
+  };
+
+  // A thread to post a notification to.
+  struct NotificationTarget {
+    scoped_refptr<base::MessageLoopProxy> loop;
+    ObserverListContext* context;
+  };
+
   ~ObserverListThreadSafe() {
     typename ObserversListMap::const_iterator it;
     for (it = observer_lists_.begin(); it != observer_lists_.end(); ++it)
@@ -205,15 +238,35 @@ class ObserverListThreadSafe
 
   template <class Method, class Params>
   void Notify(const UnboundMethod<ObserverType, Method, Params>& method) {
-    base::AutoLock lock(list_lock_);
-    typename ObserversListMap::iterator it;
-    for (it = observer_lists_.begin(); it != observer_lists_.end(); ++it) {
-      ObserverListContext* context = (*it).second;
-      context->loop->PostTask(
+    typedef NotificationPayload<Method, Params> Payload;
+
+    // Only the threads are gathered under the lock; the tasks are posted
+    // after it is released, as posting takes the lock of each loop.
+    StackVector<NotificationTarget, 4> targets;
+    {
+      base::AutoLock lock(list_lock_);
+      typename ObserversListMap::iterator it;
+      for (it = observer_lists_.begin(); it != observer_lists_.end(); ++it) {
+        ObserverListContext* context = (*it).second;
+        if (context->observer_count == 0)
+          continue;
+        NotificationTarget target;
+        target.loop = context->loop;
+        target.context = context;
+        targets->push_back(target);
+      }
+    }
+    if (targets->empty())
+      return;
+
+    scoped_refptr<Payload> payload(new Payload(method));
+    for (size_t i = 0; i < targets->size(); ++i) {
+      targets[i].loop->PostTask(
           FROM_HERE,
           NewRunnableMethod(this,
               &ObserverListThreadSafe<ObserverType>::
-                 template NotifyWrapper<Method, Params>, context, method));
+                 template NotifyWrapper<Method, Params>,
+              targets[i].context, payload));
     }
   }
 
@@ -221,8 +274,11 @@ class ObserverListThreadSafe
   // ObserverList.  This function MUST be called on the thread which owns
   // the unsafe ObserverList.
   template <class Method, class Params>
-  void NotifyWrapper(ObserverListContext* context,
-      const UnboundMethod<ObserverType, Method, Params>& method) {
+  void NotifyWrapper(
+      ObserverListContext* context,
+      const scoped_refptr<NotificationPayload<Method, Params> >& payload) {
+    const UnboundMethod<ObserverType, Method, Params>& method =
+        payload->method;
 
     // Check that this list still needs notifications.
     {
@@ -261,7 +317,9 @@ class ObserverListThreadSafe
     }
   }
 
-  typedef std::map<MessageLoop*, ObserverListContext*> ObserversListMap;
+  // The threads with observers are few, and notifying walks all of them.
+  typedef base::StackFlatMap<MessageLoop*, ObserverListContext*, 4>
+      ObserversListMap;
 
   base::Lock list_lock_;  // Protects the observer_lists_.
   ObserversListMap observer_lists_;
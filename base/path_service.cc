@@ -10,11 +10,16 @@
 #include <shlobj.h>
 #endif
 
+#include <vector>
+
+#include "base/atomicops.h"
 #include "base/file_path.h"
 #include "base/file_util.h"
 #include "base/hash_tables.h"
 #include "base/lazy_instance.h"
 #include "base/logging.h"
+#include "base/metrics/startup_timeline.h"
+#include "base/stl_util.h"
 #include "base/synchronization/lock.h"
 
 namespace base {
@@ -104,14 +109,36 @@ static Provider base_provider_posix = {
 };
 #endif
 
+// Cache mappings from path key to path value. A cache is never changed once it
+// is published in PathData::cache; adding a path publishes a copy.
+struct PathCache {
+  PathCache() : generation(0) {}
+
+  PathMap paths;
+  // Incremented by each Override(), which starts a new cache.
+  int generation;
+};
 
 struct PathData {
-  base::Lock lock;
-  PathMap cache;        // Cache mappings from path key to path value.
+  base::Lock lock;      // Protects everything but |cache| and the counts.
+  // The current const PathCache*, read without the lock.
+  base::subtle::AtomicWord cache;
+  // The caches that were replaced. Readers may still be using them, so they
+  // live as long as the PathData; there is one for each computed path.
+  std::vector<const PathCache*> old_caches;
   PathMap overrides;    // Track path overrides.
   Provider* providers;  // Linked list of path service providers.
+#ifndef NDEBUG
+  base::subtle::Atomic32 cache_hits;
+  base::subtle::Atomic32 cache_misses;
+#endif
 
   PathData() {
+    cache = reinterpret_cast<base::subtle::AtomicWord>(new PathCache);
+#ifndef NDEBUG
+    cache_hits = 0;
+    cache_misses = 0;
+#endif
 #if defined(OS_WIN)
     providers = &base_provider_win;
 #elif defined(OS_MACOSX)
@@ -124,6 +151,9 @@ struct PathData {
   }
 
   ~PathData() {
+    delete GetCache();
+    STLDeleteElements(&old_caches);
+
     Provider* p = providers;
     while (p) {
       Provider* next = p->next;
@@ -132,6 +162,18 @@ struct PathData {
       p = next;
     }
   }
+
+  const PathCache* GetCache() const {
+    return reinterpret_cast<const PathCache*>(
+        base::subtle::Acquire_Load(&cache));
+  }
+
+  // Publishes |new_cache| in place of the current cache. Called with |lock|.
+  void SetCache(const PathCache* new_cache) {
+    old_caches.push_back(GetCache());
+    base::subtle::Release_Store(
+        &cache, reinterpret_cast<base::subtle::AtomicWord>(new_cache));
+  }
 };
 
 static base::LazyInstance<PathData> g_path_data(base::LINKER_INITIALIZED);
@@ -144,13 +186,13 @@ static PathData* GetPathData() {
 
 
 // static
-bool PathService::GetFromCache(int key, FilePath* result) {
-  PathData* path_data = GetPathData();
-  base::AutoLock scoped_lock(path_data->lock);
+bool PathService::GetFromCache(int key, FilePath* result, int* generation) {
+  const PathCache* cache = GetPathData()->GetCache();
+  *generation = cache->generation;
 
   // check for a cached version
-  PathMap::const_iterator it = path_data->cache.find(key);
-  if (it != path_data->cache.end()) {
+  PathMap::const_iterator it = cache->paths.find(key);
+  if (it != cache->paths.end()) {
     *result = it->second;
     return true;
   }
@@ -172,11 +214,19 @@ bool PathService::GetFromOverrides(int key, FilePath* result) {
 }
 
 // static
-void PathService::AddToCache(int key, const FilePath& path) {
+void PathService::AddToCache(int key, const FilePath& path, int generation) {
   PathData* path_data = GetPathData();
   base::AutoLock scoped_lock(path_data->lock);
-  // Save the computed path in our cache.
-  path_data->cache[key] = path;
+  const PathCache* cache = path_data->GetCache();
+  // The path may depend on a path that was overridden since it was computed,
+  // or another thread may have cached it already.
+  if (cache->generation != generation || cache->paths.count(key))
+    return;
+
+  // Save the computed path in a copy of our cache.
+  PathCache* new_cache = new PathCache(*cache);
+  new_cache->paths[key] = path;
+  path_data->SetCache(new_cache);
 }
 
 // TODO(brettw): this function does not handle long paths (filename > MAX_PATH)
@@ -184,6 +234,7 @@ void PathService::AddToCache(int key, const FilePath& path) {
 // moot, but we should keep this in mind for the future.
 // static
 bool PathService::Get(int key, FilePath* result) {
+  base::StartupTimeline::ScopedStep startup_step("PathServiceGet");
   PathData* path_data = GetPathData();
   DCHECK(path_data);
   DCHECK(result);
@@ -193,13 +244,23 @@ bool PathService::Get(int key, FilePath* result) {
   if (key == base::DIR_CURRENT)
     return file_util::GetCurrentDirectory(result);
 
-  if (GetFromCache(key, result))
-    return true;
-
-  if (GetFromOverrides(key, result))
+  int generation;
+  if (GetFromCache(key, result, &generation)) {
+#ifndef NDEBUG
+    base::subtle::NoBarrier_AtomicIncrement(&path_data->cache_hits, 1);
+#endif
     return true;
+  }
+#ifndef NDEBUG
+  base::subtle::NoBarrier_AtomicIncrement(&path_data->cache_misses, 1);
+#endif
 
   FilePath path;
+  if (GetFromOverrides(key, &path)) {
+    AddToCache(key, path, generation);
+    *result = path;
+    return true;
+  }
 
   // search providers for the requested path
   // NOTE: it should be safe to iterate here without the lock
@@ -215,7 +276,7 @@ bool PathService::Get(int key, FilePath* result) {
   if (path.empty())
     return false;
 
-  AddToCache(key, path);
+  AddToCache(key, path, generation);
 
   *result = path;
   return true;
@@ -245,9 +306,11 @@ bool PathService::Override(int key, const FilePath& path) {
 
   // Clear the cache now. Some of its entries could have depended
   // on the value we are overriding, and are now out of sync with reality.
-  path_data->cache.clear();
+  PathCache* new_cache = new PathCache;
+  new_cache->generation = path_data->GetCache()->generation + 1;
+  new_cache->paths[key] = file_path;
+  path_data->SetCache(new_cache);
 
-  path_data->cache[key] = file_path;
   path_data->overrides[key] = file_path;
 
   return true;
@@ -282,3 +345,15 @@ void PathService::RegisterProvider(ProviderFunc func, int key_start,
 #endif
   path_data->providers = p;
 }
+
+// static
+bool PathService::GetCacheStats(int* hits, int* misses) {
+#ifndef NDEBUG
+  PathData* path_data = GetPathData();
+  *hits = base::subtle::NoBarrier_Load(&path_data->cache_hits);
+  *misses = base::subtle::NoBarrier_Load(&path_data->cache_misses);
+  return true;
+#else
+  return false;
+#endif
+}
@@ -15,7 +15,8 @@
 class FilePath;
 
 // The path service is a global table mapping keys to file system paths.  It is
-// OK to use this service from multiple threads.
+// OK to use this service from multiple threads.  Paths are cached once they
+// are computed, and cached paths are read without taking a lock.
 //
 class BASE_EXPORT PathService {
  public:
@@ -55,10 +56,19 @@ class BASE_EXPORT PathService {
   static void RegisterProvider(ProviderFunc provider,
                                int key_start,
                                int key_end);
+
+  // Returns how many Get() calls were answered from the cache, and how many
+  // had to ask the overrides or the providers. The calls are only counted in
+  // debug builds, since all threads would share the counters; returns false
+  // in release builds.
+  static bool GetCacheStats(int* hits, int* misses);
+
  private:
-  static bool GetFromCache(int key, FilePath* path);
+  // Cached paths are only added to the cache they were computed from, which
+  // Override() replaces. |generation| identifies it.
+  static bool GetFromCache(int key, FilePath* path, int* generation);
   static bool GetFromOverrides(int key, FilePath* path);
-  static void AddToCache(int key, const FilePath& path);
+  static void AddToCache(int key, const FilePath& path, int generation);
 };
 
 #endif  // BASE_PATH_SERVICE_H_
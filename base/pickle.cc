@@ -96,6 +96,16 @@ Pickle& Pickle::operator=(const Pickle& other) {
   return *this;
 }
 
+bool Pickle::Reserve(size_t payload_capacity) {
+  DCHECK_NE(capacity_, kCapacityReadOnly);
+  if (capacity_ == kCapacityReadOnly)
+    return false;
+  size_t needed_size = header_size_ + payload_capacity;
+  if (needed_size <= capacity_)
+    return true;
+  return Resize(needed_size);
+}
+
 bool Pickle::ReadBool(void** iter, bool* result) const {
   DCHECK(iter);
 
@@ -229,6 +239,21 @@ bool Pickle::ReadString(void** iter, std::string* result) const {
   return true;
 }
 
+bool Pickle::ReadStringPiece(void** iter, base::StringPiece* result) const {
+  DCHECK(iter);
+
+  int len;
+  if (!ReadLength(iter, &len))
+    return false;
+  if (!IteratorHasRoomFor(*iter, len))
+    return false;
+
+  result->set(reinterpret_cast<const char*>(*iter), len);
+
+  UpdateIter(iter, len);
+  return true;
+}
+
 bool Pickle::ReadWString(void** iter, std::wstring* result) const {
   DCHECK(iter);
 
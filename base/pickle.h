@@ -13,6 +13,7 @@
 #include "base/gtest_prod_util.h"
 #include "base/logging.h"
 #include "base/string16.h"
+#include "base/string_piece.h"
 
 // This class provides facilities for basic binary value packing and unpacking.
 //
@@ -55,6 +56,12 @@ class BASE_EXPORT Pickle {
   // Performs a deep copy.
   Pickle& operator=(const Pickle& other);
 
+  // Makes room for a payload of |payload_capacity| bytes, so that writing as
+  // much doesn't grow the buffer, and copy what was written, once for each
+  // time it doubles. Returns false if the buffer couldn't be made as large.
+  // Only for the Pickles that own their data.
+  bool Reserve(size_t payload_capacity);
+
   // Returns the size of the Pickle's data.
   size_t size() const { return header_size_ + header_->payload_size; }
 
@@ -74,6 +81,9 @@ class BASE_EXPORT Pickle {
   bool ReadInt64(void** iter, int64* result) const;
   bool ReadUInt64(void** iter, uint64* result) const;
   bool ReadString(void** iter, std::string* result) const;
+  // Same as ReadString(), but |result| points into the Pickle rather than
+  // copying the string out, so it is only valid as long as the Pickle is.
+  bool ReadStringPiece(void** iter, base::StringPiece* result) const;
   bool ReadWString(void** iter, std::wstring* result) const;
   bool ReadString16(void** iter, string16* result) const;
   bool ReadData(void** iter, const char** data, int* length) const;
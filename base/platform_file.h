@@ -52,6 +52,9 @@ enum PlatformFileFlags {
   PLATFORM_FILE_ENUMERATE = 16384,  // May enumerate directory
 
   PLATFORM_FILE_SHARE_DELETE = 32768,  // Used on Windows only
+
+  // Reads and writes bypass the cache of the system, see AsyncPlatformFile.
+  PLATFORM_FILE_NO_BUFFERING = 65536,  // Used on Windows only
 };
 
 // PLATFORM_FILE_ERROR_ACCESS_DENIED is returned when a call fails because of
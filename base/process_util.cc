@@ -4,8 +4,18 @@
 
 #include "base/process_util.h"
 
+#include <algorithm>
+
 namespace base {
 
+namespace {
+
+bool HasLowerPid(const ProcessEntry& a, const ProcessEntry& b) {
+  return a.pid() < b.pid();
+}
+
+}  // namespace
+
 #if defined(OS_POSIX)
 ProcessEntry::ProcessEntry() : pid_(0), ppid_(0), gid_(0) {}
 ProcessEntry::~ProcessEntry() {}
@@ -76,4 +86,128 @@ NamedProcessIterator::NamedProcessIterator(
 NamedProcessIterator::~NamedProcessIterator() {
 }
 
+ProcessSnapshot::ProcessSnapshot() {
+}
+
+ProcessSnapshot::~ProcessSnapshot() {
+}
+
+bool ProcessSnapshot::Refresh() {
+  std::vector<ProcessEntry> current;
+  if (!ReadProcesses(&current))
+    return false;
+  std::sort(current.begin(), current.end(), HasLowerPid);
+
+  // Both lists are ordered by pid, so they are merged in one pass. The
+  // processes running at both refreshes only have their entries updated,
+  // unless the pid was reused by another executable.
+  EntryMap::iterator old_entry = entries_.begin();
+  for (size_t i = 0; i < current.size(); ++i) {
+    const ProcessEntry& entry = current[i];
+    while (old_entry != entries_.end() && old_entry->first < entry.pid()) {
+      RemoveFromNameIndex(old_entry->second);
+      entries_.erase(old_entry++);
+    }
+    if (old_entry != entries_.end() && old_entry->first == entry.pid()) {
+      bool renamed = FilePath::StringType(old_entry->second.exe_file()) !=
+                     entry.exe_file();
+      if (renamed)
+        RemoveFromNameIndex(old_entry->second);
+      old_entry->second = entry;
+      if (renamed)
+        AddToNameIndex(entry);
+      ++old_entry;
+    } else {
+      entries_.insert(old_entry, std::make_pair(entry.pid(), entry));
+      AddToNameIndex(entry);
+    }
+  }
+  while (old_entry != entries_.end()) {
+    RemoveFromNameIndex(old_entry->second);
+    entries_.erase(old_entry++);
+  }
+  return true;
+}
+
+const ProcessEntry* ProcessSnapshot::GetProcess(ProcessId pid) const {
+  EntryMap::const_iterator i = entries_.find(pid);
+  return i == entries_.end() ? NULL : &i->second;
+}
+
+void ProcessSnapshot::GetProcessesByName(
+    const FilePath::StringType& executable_name,
+    const ProcessFilter* filter,
+    EntryList* entries) const {
+  entries->clear();
+  std::pair<NameIndex::const_iterator, NameIndex::const_iterator> range =
+      name_index_.equal_range(GetNameKey(executable_name));
+  for (NameIndex::const_iterator i = range.first; i != range.second; ++i) {
+    const ProcessEntry& entry = entries_.find(i->second)->second;
+    if (!filter || filter->Includes(entry))
+      entries->push_back(&entry);
+  }
+}
+
+int ProcessSnapshot::GetProcessCount(
+    const FilePath::StringType& executable_name,
+    const ProcessFilter* filter) const {
+  EntryList entries;
+  GetProcessesByName(executable_name, filter, &entries);
+  return static_cast<int>(entries.size());
+}
+
+bool ProcessSnapshot::KillProcesses(
+    const FilePath::StringType& executable_name,
+    int exit_code,
+    const ProcessFilter* filter) const {
+  EntryList entries;
+  GetProcessesByName(executable_name, filter, &entries);
+  bool result = true;
+  for (size_t i = 0; i < entries.size(); ++i) {
+#if defined(OS_WIN)
+    result &= KillProcessById(entries[i]->pid(), exit_code, true);
+#else
+    result &= KillProcess(entries[i]->pid(), exit_code, true);
+#endif
+  }
+  return result;
+}
+
+// static
+bool ProcessSnapshot::ReadProcessesWithIterator(
+    std::vector<ProcessEntry>* entries) {
+  ProcessIterator iter(NULL);
+  while (const ProcessEntry* entry = iter.NextProcessEntry())
+    entries->push_back(*entry);
+  return !entries->empty();
+}
+
+#if !defined(OS_WIN)
+bool ProcessSnapshot::ReadProcesses(std::vector<ProcessEntry>* entries) {
+  return ReadProcessesWithIterator(entries);
+}
+
+// static
+FilePath::StringType ProcessSnapshot::GetNameKey(
+    const FilePath::StringType& executable_name) {
+  return executable_name;
+}
+#endif  // !defined(OS_WIN)
+
+void ProcessSnapshot::AddToNameIndex(const ProcessEntry& entry) {
+  name_index_.insert(std::make_pair(GetNameKey(entry.exe_file()),
+                                    entry.pid()));
+}
+
+void ProcessSnapshot::RemoveFromNameIndex(const ProcessEntry& entry) {
+  std::pair<NameIndex::iterator, NameIndex::iterator> range =
+      name_index_.equal_range(GetNameKey(entry.exe_file()));
+  for (NameIndex::iterator i = range.first; i != range.second; ++i) {
+    if (i->second == entry.pid()) {
+      name_index_.erase(i);
+      return;
+    }
+  }
+}
+
 }  // namespace base
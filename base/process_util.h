@@ -29,6 +29,7 @@ typedef struct _malloc_zone_t malloc_zone_t;
 #endif
 
 #include <list>
+#include <map>
 #include <string>
 #include <utility>
 #include <vector>
@@ -557,6 +558,82 @@ class BASE_EXPORT NamedProcessIterator : public ProcessIterator {
   DISALLOW_COPY_AND_ASSIGN(NamedProcessIterator);
 };
 
+// A list of the processes on the current machine, indexed by pid and by
+// executable name, for the callers that look at processes at regular
+// intervals: a watchdog checking on several executables each second refreshes
+// one snapshot per tick, rather than having GetProcessCount(),
+// KillProcesses() and WaitForProcessesToExit() enumerate all the processes
+// for each executable. Refresh() only updates the name index for the
+// processes that started or exited since the previous refresh. On Windows,
+// the processes are read with a single NtQuerySystemInformation() call, or
+// with a toolhelp snapshot if that fails.
+class BASE_EXPORT ProcessSnapshot {
+ public:
+  typedef std::vector<const ProcessEntry*> EntryList;
+
+  ProcessSnapshot();
+  ~ProcessSnapshot();
+
+  // Reads the processes running now. Returns false on failure, and then
+  // keeps the processes of the previous refresh.
+  bool Refresh();
+
+  // Returns the number of processes at the last refresh.
+  size_t size() const { return entries_.size(); }
+
+  // Returns the process |pid|, or NULL if it wasn't running at the last
+  // refresh. The entries stay valid until the next refresh.
+  const ProcessEntry* GetProcess(ProcessId pid) const;
+
+  // Sets |entries| to the processes running from |executable_name| at the
+  // last refresh, case insensitively on Windows, which |filter| includes if
+  // it is not NULL.
+  void GetProcessesByName(const FilePath::StringType& executable_name,
+                          const ProcessFilter* filter,
+                          EntryList* entries) const;
+
+  // As the functions of the same names, over the processes of the last
+  // refresh.
+  int GetProcessCount(const FilePath::StringType& executable_name,
+                      const ProcessFilter* filter) const;
+  bool KillProcesses(const FilePath::StringType& executable_name,
+                     int exit_code,
+                     const ProcessFilter* filter) const;
+#if defined(OS_WIN)
+  bool WaitForProcessesToExit(const FilePath::StringType& executable_name,
+                              int64 wait_milliseconds,
+                              const ProcessFilter* filter) const;
+#endif  // defined(OS_WIN)
+
+ private:
+  typedef std::map<ProcessId, ProcessEntry> EntryMap;
+  typedef std::multimap<FilePath::StringType, ProcessId> NameIndex;
+
+  // Sets |entries| to the processes running now. Returns false on failure.
+  bool ReadProcesses(std::vector<ProcessEntry>* entries);
+
+  // Reads the processes with a ProcessIterator.
+  static bool ReadProcessesWithIterator(std::vector<ProcessEntry>* entries);
+
+  // Returns the key of |executable_name| in |name_index_|.
+  static FilePath::StringType GetNameKey(
+      const FilePath::StringType& executable_name);
+
+  void AddToNameIndex(const ProcessEntry& entry);
+  void RemoveFromNameIndex(const ProcessEntry& entry);
+
+  EntryMap entries_;
+  NameIndex name_index_;
+
+#if defined(OS_WIN)
+  // The buffer NtQuerySystemInformation() fills, kept from one refresh to
+  // the next. uint64s for the alignment of the records.
+  std::vector<uint64> buffer_;
+#endif
+
+  DISALLOW_COPY_AND_ASSIGN(ProcessSnapshot);
+};
+
 // Working Set (resident) memory usage broken down by
 //
 // On Windows:
@@ -683,6 +760,15 @@ class BASE_EXPORT ProcessMetrics {
   // otherwise.
   bool GetIOCounters(IoCounters* io_counters) const;
 
+#if defined(OS_WIN)
+  // Returns the number of page faults, hard and soft, since the process
+  // started, or 0 on failure.
+  size_t GetPageFaultCount() const;
+
+  // Returns the number of handles the process has open, or 0 on failure.
+  size_t GetHandleCount() const;
+#endif  // defined(OS_WIN)
+
  private:
 #if !defined(OS_MACOSX)
   explicit ProcessMetrics(ProcessHandle process);
@@ -48,6 +48,34 @@ const DWORD kProcessKilledExitCode = 1;
 // HeapSetInformation function pointer.
 typedef BOOL (WINAPI* HeapSetFn)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T);
 
+// NtQuerySystemInformation function pointer, and the parts of its
+// SystemProcessInformation records ProcessSnapshot reads, from winternl.h.
+typedef LONG (WINAPI* NtQuerySystemInformationFunction)(ULONG, PVOID, ULONG,
+                                                        PULONG);
+const ULONG kSystemProcessInformation = 5;
+const LONG kStatusInfoLengthMismatch = 0xC0000004;
+
+// The size of the first buffer of SystemProcessInformation records, about
+// the size of 300 processes and their threads.
+const ULONG kInitialProcessInformationSize = 256 * 1024;
+
+struct SystemProcessInformation {
+  ULONG next_entry_offset;
+  ULONG number_of_threads;
+  LARGE_INTEGER reserved[3];
+  LARGE_INTEGER create_time;
+  LARGE_INTEGER user_time;
+  LARGE_INTEGER kernel_time;
+  struct {
+    USHORT length;
+    USHORT maximum_length;
+    PWSTR buffer;
+  } image_name;
+  LONG base_priority;
+  HANDLE unique_process_id;
+  HANDLE inherited_from_unique_process_id;
+};
+
 // Previous unhandled filter. Will be called if not NULL when we intercept an
 // exception. Only used in unit tests.
 LPTOP_LEVEL_EXCEPTION_FILTER g_previous_filter = NULL;
@@ -534,6 +562,92 @@ bool WaitForProcessesToExit(const std::wstring& executable_name,
   return result;
 }
 
+bool ProcessSnapshot::WaitForProcessesToExit(
+    const std::wstring& executable_name,
+    int64 wait_milliseconds,
+    const ProcessFilter* filter) const {
+  EntryList entries;
+  GetProcessesByName(executable_name, filter, &entries);
+  bool result = true;
+  DWORD start_time = GetTickCount();
+  for (size_t i = 0; i < entries.size(); ++i) {
+    DWORD remaining_wait =
+        std::max<int64>(0, wait_milliseconds - (GetTickCount() - start_time));
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, entries[i]->pid());
+    // The process may have exited since the refresh.
+    if (!process)
+      continue;
+    DWORD wait_result = WaitForSingleObject(process, remaining_wait);
+    CloseHandle(process);
+    result = result && (wait_result == WAIT_OBJECT_0);
+  }
+  return result;
+}
+
+bool ProcessSnapshot::ReadProcesses(std::vector<ProcessEntry>* entries) {
+  static NtQuerySystemInformationFunction query_system_information =
+      reinterpret_cast<NtQuerySystemInformationFunction>(GetProcAddress(
+          GetModuleHandle(L"ntdll.dll"), "NtQuerySystemInformation"));
+  if (!query_system_information)
+    return ReadProcessesWithIterator(entries);
+
+  if (buffer_.empty())
+    buffer_.resize(kInitialProcessInformationSize / sizeof(uint64));
+  LONG status = kStatusInfoLengthMismatch;
+  for (int retries = 0; retries < 5; ++retries) {
+    ULONG size = static_cast<ULONG>(buffer_.size() * sizeof(uint64));
+    ULONG needed_size = 0;
+    status = query_system_information(kSystemProcessInformation, &buffer_[0],
+                                      size, &needed_size);
+    if (status != kStatusInfoLengthMismatch)
+      break;
+    // Leaves room for the processes that start in the meantime.
+    buffer_.resize(
+        (std::max(needed_size, size) + kInitialProcessInformationSize) /
+        sizeof(uint64));
+  }
+  if (status < 0)
+    return ReadProcessesWithIterator(entries);
+
+  const char* record = reinterpret_cast<const char*>(&buffer_[0]);
+  for (;;) {
+    const SystemProcessInformation* info =
+        reinterpret_cast<const SystemProcessInformation*>(record);
+    ProcessEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.dwSize = sizeof(entry);
+    entry.th32ProcessID = static_cast<DWORD>(
+        reinterpret_cast<ULONG_PTR>(info->unique_process_id));
+    entry.th32ParentProcessID = static_cast<DWORD>(
+        reinterpret_cast<ULONG_PTR>(info->inherited_from_unique_process_id));
+    entry.cntThreads = info->number_of_threads;
+    entry.pcPriClassBase = info->base_priority;
+    if (info->image_name.buffer) {
+      size_t length = std::min<size_t>(
+          info->image_name.length / sizeof(wchar_t),
+          arraysize(entry.szExeFile) - 1);
+      wmemcpy(entry.szExeFile, info->image_name.buffer, length);
+    } else if (entry.th32ProcessID == 0) {
+      // The name toolhelp gives the idle process.
+      wcscpy_s(entry.szExeFile, L"[System Process]");
+    }
+    entries->push_back(entry);
+    if (!info->next_entry_offset)
+      break;
+    record += info->next_entry_offset;
+  }
+  return true;
+}
+
+// static
+std::wstring ProcessSnapshot::GetNameKey(const std::wstring& executable_name) {
+  // As _wcsicmp() in NamedProcessIterator.
+  std::wstring key(executable_name);
+  if (!key.empty())
+    CharLowerBuffW(&key[0], static_cast<DWORD>(key.size()));
+  return key;
+}
+
 bool WaitForSingleProcess(ProcessHandle handle, int64 wait_milliseconds) {
   bool retval = WaitForSingleObject(handle, wait_milliseconds) == WAIT_OBJECT_0;
   return retval;
@@ -787,6 +901,21 @@ bool ProcessMetrics::GetIOCounters(IoCounters* io_counters) const {
   return GetProcessIoCounters(process_, io_counters) != FALSE;
 }
 
+size_t ProcessMetrics::GetPageFaultCount() const {
+  PROCESS_MEMORY_COUNTERS pmc;
+  if (GetProcessMemoryInfo(process_, &pmc, sizeof(pmc))) {
+    return pmc.PageFaultCount;
+  }
+  return 0;
+}
+
+size_t ProcessMetrics::GetHandleCount() const {
+  DWORD handle_count;
+  if (GetProcessHandleCount(process_, &handle_count))
+    return handle_count;
+  return 0;
+}
+
 bool ProcessMetrics::CalculateFreeMemory(FreeMBytes* free) const {
   const SIZE_T kTopAddress = 0x7F000000;
   const SIZE_T kMegabyte = 1024 * 1024;
@@ -0,0 +1,239 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/shared_memory_channel.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/atomicops.h"
+#include "base/logging.h"
+#include "base/pickle.h"
+#include "base/shared_memory.h"
+#include "base/synchronization/waitable_event.h"
+
+namespace base {
+
+namespace {
+
+const uint32 kMagic = 0x52494e47;  // 'RING'
+
+// Keeps the members that each end writes on cache lines of their own.
+const size_t kCacheLineSize = 64;
+
+bool IsPowerOfTwo(uint32 value) {
+  return value && !(value & (value - 1));
+}
+
+// The largest ring the positions, which wrap around at 2^32, can tell full
+// from empty in.
+const uint32 kMaxCapacity = 0x80000000u;
+
+}  // namespace
+
+// The start of the memory, followed by the ring. Its members are 32 bits
+// wide, so that 32 and 64 bit processes agree on it. The positions only grow,
+// wrapping around at 2^32; the bytes between the read and the write position
+// are the messages not yet read, each the size of its Pickle followed by the
+// Pickle.
+struct SharedMemoryChannel::Header {
+  uint32 magic;
+  uint32 capacity;
+  char padding0[kCacheLineSize - 2 * sizeof(uint32)];
+
+  // Written by the writer.
+  volatile subtle::Atomic32 write_position;
+  volatile subtle::Atomic32 writer_waiting;
+  char padding1[kCacheLineSize - 2 * sizeof(subtle::Atomic32)];
+
+  // Written by the reader.
+  volatile subtle::Atomic32 read_position;
+  volatile subtle::Atomic32 reader_waiting;
+  char padding2[kCacheLineSize - 2 * sizeof(subtle::Atomic32)];
+};
+
+SharedMemoryChannel::SharedMemoryChannel(SharedMemory* memory,
+                                         uint32 memory_size,
+                                         WaitableEvent* data_event,
+                                         WaitableEvent* space_event)
+    : memory_(memory),
+      memory_size_(memory_size),
+      data_event_(data_event),
+      space_event_(space_event),
+      header_(NULL),
+      ring_(NULL),
+      capacity_(0) {
+}
+
+SharedMemoryChannel::~SharedMemoryChannel() {
+}
+
+// static
+uint32 SharedMemoryChannel::GetMemorySize(uint32 capacity) {
+  DCHECK(IsPowerOfTwo(capacity));
+  return sizeof(Header) + capacity;
+}
+
+bool SharedMemoryChannel::Initialize(uint32 capacity) {
+  DCHECK(!header_);
+  if (!memory_->memory() || !IsValidCapacity(capacity))
+    return false;
+
+  Header* header = static_cast<Header*>(memory_->memory());
+  memset(header, 0, sizeof(Header));
+  header->capacity = capacity;
+  // Written last, for Attach(), although the other end isn't to attach before
+  // it is told the memory is ready.
+  subtle::MemoryBarrier();
+  header->magic = kMagic;
+
+  header_ = header;
+  ring_ = reinterpret_cast<char*>(header + 1);
+  capacity_ = capacity;
+  return true;
+}
+
+bool SharedMemoryChannel::Attach() {
+  DCHECK(!header_);
+  if (!memory_->memory() || memory_size_ < sizeof(Header))
+    return false;
+
+  Header* header = static_cast<Header*>(memory_->memory());
+  // Read once: the other process may change it after it is checked.
+  uint32 capacity = *static_cast<volatile uint32*>(&header->capacity);
+  if (header->magic != kMagic || !IsValidCapacity(capacity))
+    return false;
+
+  header_ = header;
+  ring_ = reinterpret_cast<char*>(header + 1);
+  capacity_ = capacity;
+  return true;
+}
+
+bool SharedMemoryChannel::IsValidCapacity(uint32 capacity) const {
+  return IsPowerOfTwo(capacity) && capacity <= kMaxCapacity &&
+      static_cast<uint64>(sizeof(Header)) + capacity <= memory_size_;
+}
+
+bool SharedMemoryChannel::Send(const Pickle& message) {
+  DCHECK(header_);
+  uint32 message_size = static_cast<uint32>(message.size());
+  uint32 frame_size = sizeof(message_size) + message_size;
+  if (message.size() > capacity_ || frame_size > capacity_)
+    return false;
+
+  uint32 write_position =
+      static_cast<uint32>(subtle::NoBarrier_Load(&header_->write_position));
+  for (;;) {
+    uint32 read_position =
+        static_cast<uint32>(subtle::Acquire_Load(&header_->read_position));
+    if (capacity_ - (write_position - read_position) >= frame_size)
+      break;
+
+    // Full. The reader rings if it sees |writer_waiting|, which is why the
+    // position is read again after setting it, before waiting.
+    subtle::NoBarrier_Store(&header_->writer_waiting, 1);
+    subtle::MemoryBarrier();
+    read_position =
+        static_cast<uint32>(subtle::Acquire_Load(&header_->read_position));
+    if (capacity_ - (write_position - read_position) < frame_size)
+      space_event_->Wait();
+    subtle::NoBarrier_Store(&header_->writer_waiting, 0);
+  }
+
+  CopyToRing(write_position, &message_size, sizeof(message_size));
+  CopyToRing(write_position + sizeof(message_size), message.data(),
+             message_size);
+  subtle::Release_Store(&header_->write_position,
+                        static_cast<subtle::Atomic32>(write_position +
+                                                      frame_size));
+
+  // Orders the store of the position before the load of |reader_waiting|,
+  // which the reader sets before reading the position again.
+  subtle::MemoryBarrier();
+  if (subtle::NoBarrier_Load(&header_->reader_waiting))
+    data_event_->Signal();
+  return true;
+}
+
+bool SharedMemoryChannel::TryReceive(Pickle* message) {
+  return Read(message) == READ_MESSAGE;
+}
+
+bool SharedMemoryChannel::Receive(Pickle* message) {
+  for (;;) {
+    ReadResult result = Read(message);
+    if (result != READ_EMPTY)
+      return result == READ_MESSAGE;
+
+    // As in Send(), the writer rings if it sees |reader_waiting|.
+    subtle::NoBarrier_Store(&header_->reader_waiting, 1);
+    subtle::MemoryBarrier();
+    if (subtle::Acquire_Load(&header_->write_position) ==
+        subtle::NoBarrier_Load(&header_->read_position)) {
+      data_event_->Wait();
+    }
+    subtle::NoBarrier_Store(&header_->reader_waiting, 0);
+  }
+}
+
+SharedMemoryChannel::ReadResult SharedMemoryChannel::Read(Pickle* message) {
+  DCHECK(header_);
+  uint32 read_position =
+      static_cast<uint32>(subtle::NoBarrier_Load(&header_->read_position));
+  uint32 write_position =
+      static_cast<uint32>(subtle::Acquire_Load(&header_->write_position));
+  uint32 available = write_position - read_position;
+  if (!available)
+    return READ_EMPTY;
+
+  // The writer publishes whole messages, so anything else is the other
+  // process writing where it shouldn't.
+  uint32 message_size;
+  if (available > capacity_ || available < sizeof(message_size))
+    return READ_ERROR;
+  CopyFromRing(read_position, &message_size, sizeof(message_size));
+  if (message_size > available - sizeof(message_size) ||
+      message_size > static_cast<uint32>(kint32max)) {
+    return READ_ERROR;
+  }
+
+  read_buffer_.resize(std::max<size_t>(message_size, 1));
+  CopyFromRing(read_position + sizeof(message_size), &read_buffer_[0],
+               message_size);
+  subtle::Release_Store(&header_->read_position,
+                        static_cast<subtle::Atomic32>(
+                            read_position + sizeof(message_size) +
+                            message_size));
+
+  subtle::MemoryBarrier();
+  if (subtle::NoBarrier_Load(&header_->writer_waiting))
+    space_event_->Signal();
+
+  Pickle received(&read_buffer_[0], static_cast<int>(message_size));
+  if (!received.data())
+    return READ_ERROR;
+  *message = received;
+  return READ_MESSAGE;
+}
+
+void SharedMemoryChannel::CopyToRing(uint32 position, const void* data,
+                                     uint32 size) {
+  uint32 offset = position & (capacity_ - 1);
+  uint32 first_size = std::min(size, capacity_ - offset);
+  memcpy(ring_ + offset, data, first_size);
+  memcpy(ring_, static_cast<const char*>(data) + first_size,
+         size - first_size);
+}
+
+void SharedMemoryChannel::CopyFromRing(uint32 position, void* data,
+                                       uint32 size) const {
+  uint32 offset = position & (capacity_ - 1);
+  uint32 first_size = std::min(size, capacity_ - offset);
+  memcpy(data, ring_ + offset, first_size);
+  memcpy(static_cast<char*>(data) + first_size, ring_, size - first_size);
+}
+
+}  // namespace base
@@ -0,0 +1,116 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_SHARED_MEMORY_CHANNEL_H_
+#define BASE_SHARED_MEMORY_CHANNEL_H_
+#pragma once
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+
+class Pickle;
+
+namespace base {
+
+class SharedMemory;
+class WaitableEvent;
+
+// SharedMemoryChannel sends Pickles one way between two processes, through a
+// ring buffer in a SharedMemory, so that bulk data such as bitmaps and
+// histograms isn't copied through a pipe. There is a single writer, which
+// calls Send(), and a single reader, which calls Receive(); neither takes a
+// lock. Each end has its own SharedMemoryChannel over the same memory:
+//
+//   // The creating process.
+//   uint32 size = SharedMemoryChannel::GetMemorySize(kCapacity);
+//   memory.CreateAndMapAnonymous(size);
+//   SharedMemoryChannel channel(&memory, size, &data_event, &space_event);
+//   channel.Initialize(kCapacity);
+//   ...
+//   // The other, once the memory and the events were shared to it.
+//   memory.Map(size);
+//   SharedMemoryChannel channel(&memory, size, &data_event, &space_event);
+//   if (channel.Attach()) ...
+//
+// The events are the doorbells, auto-reset and shared by both processes, on
+// Windows by duplicating their handles. They are only signaled when the other
+// end is waiting: |data_event| by Send() when the reader waits for a message,
+// |space_event| by Receive() when the writer waits for space. A reader that
+// can't block may wait for |data_event| with an ObjectWatcher and call
+// TryReceive().
+class BASE_EXPORT SharedMemoryChannel {
+ public:
+  // |memory| must be mapped for as long as the channel is used, and
+  // |memory_size| is the number of bytes of it that are mapped.
+  SharedMemoryChannel(SharedMemory* memory,
+                      uint32 memory_size,
+                      WaitableEvent* data_event,
+                      WaitableEvent* space_event);
+  ~SharedMemoryChannel();
+
+  // Returns the size of the memory for a ring of |capacity| bytes, which must
+  // be a power of two.
+  static uint32 GetMemorySize(uint32 capacity);
+
+  // Lays out an empty ring of |capacity| bytes in the memory. Called once, by
+  // the end that created the memory, before either end uses the channel.
+  bool Initialize(uint32 capacity);
+
+  // Uses the ring that the other end initialized. Returns false if the memory
+  // doesn't hold one, or if the ring doesn't fit in the mapped memory.
+  bool Attach();
+
+  // Copies |message| into the ring, waiting for the reader to make room for it
+  // if the ring is full. Returns false if the message is larger than the ring.
+  bool Send(const Pickle& message);
+
+  // Takes the next message from the ring into |message|. TryReceive() returns
+  // false at once if there is none, Receive() waits for one. Both return false
+  // if the ring is corrupt.
+  bool TryReceive(Pickle* message);
+  bool Receive(Pickle* message);
+
+ private:
+  struct Header;
+
+  enum ReadResult {
+    READ_MESSAGE,
+    READ_EMPTY,
+    READ_ERROR,
+  };
+
+  ReadResult Read(Pickle* message);
+
+  // Whether a ring of |capacity| bytes is one the positions can handle, and
+  // fits in the mapped memory after the header.
+  bool IsValidCapacity(uint32 capacity) const;
+
+  // Copy |size| bytes to or from the ring at |position|, wrapping around its
+  // end.
+  void CopyToRing(uint32 position, const void* data, uint32 size);
+  void CopyFromRing(uint32 position, void* data, uint32 size) const;
+
+  SharedMemory* memory_;
+  uint32 memory_size_;
+  WaitableEvent* data_event_;
+  WaitableEvent* space_event_;
+
+  // NULL until Initialize() or Attach(). |capacity_| is copied from the
+  // header once, and checked against |memory_size_|, since the other process
+  // can write the header at any time.
+  Header* header_;
+  char* ring_;
+  uint32 capacity_;
+
+  // The reader's copy of the message it reads, kept for the next one.
+  std::vector<char> read_buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedMemoryChannel);
+};
+
+}  // namespace base
+
+#endif  // BASE_SHARED_MEMORY_CHANNEL_H_
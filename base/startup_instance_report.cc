@@ -0,0 +1,145 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/startup_instance_report.h"
+
+#include <algorithm>
+
+#include "base/atomicops.h"
+#include "base/stringprintf.h"
+
+#if defined(OS_WIN)
+#include <windows.h>
+#elif defined(OS_POSIX)
+#include <time.h>
+#endif
+
+namespace base {
+
+namespace {
+
+// An instance as it's recorded. The records are PODs, as are the other
+// globals, so they're initialized before any constructor runs.
+struct InstanceRecord {
+  // The const char* name, stored last.
+  subtle::AtomicWord name;
+  int64 ticks;
+  PlatformThreadId thread_id;
+};
+
+// 1 once StopRecording() is called.
+subtle::Atomic32 g_stopped = 0;
+
+// The number of entries of |g_records| that have been claimed, which may be
+// more than kMaxInstances. An entry is complete once its |name| is set.
+subtle::Atomic32 g_record_count = 0;
+InstanceRecord g_records[StartupInstanceReport::kMaxInstances];
+
+// Not TimeTicks::HighResNow(), which creates a Singleton.
+int64 GetTicks() {
+#if defined(OS_WIN)
+  LARGE_INTEGER ticks;
+  QueryPerformanceCounter(&ticks);
+  return ticks.QuadPart;
+#elif defined(OS_POSIX)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64>(ts.tv_sec) * Time::kNanosecondsPerSecond +
+         ts.tv_nsec;
+#endif
+}
+
+TimeDelta TicksToTimeDelta(int64 ticks) {
+#if defined(OS_WIN)
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  int64 ticks_per_second = frequency.QuadPart;
+#elif defined(OS_POSIX)
+  int64 ticks_per_second = Time::kNanosecondsPerSecond;
+#endif
+  return TimeDelta::FromMicroseconds(
+      ticks / ticks_per_second * Time::kMicrosecondsPerSecond +
+      ticks % ticks_per_second * Time::kMicrosecondsPerSecond /
+          ticks_per_second);
+}
+
+bool CompareInstancesByCost(const StartupInstanceReport::Instance& a,
+                            const StartupInstanceReport::Instance& b) {
+  return a.cost > b.cost;
+}
+
+}  // namespace
+
+// static
+bool StartupInstanceReport::IsRecording() {
+  return !subtle::Acquire_Load(&g_stopped) &&
+         subtle::NoBarrier_Load(&g_record_count) < kMaxInstances;
+}
+
+// static
+void StartupInstanceReport::StopRecording() {
+  subtle::Release_Store(&g_stopped, 1);
+}
+
+// static
+void StartupInstanceReport::GetInstances(std::vector<Instance>* instances) {
+  instances->clear();
+  int count = std::min(
+      static_cast<int>(subtle::NoBarrier_Load(&g_record_count)),
+      static_cast<int>(kMaxInstances));
+  for (int i = 0; i < count; ++i) {
+    const InstanceRecord& record = g_records[i];
+    subtle::AtomicWord name = subtle::Acquire_Load(&record.name);
+    if (!name)
+      continue;
+    Instance instance;
+    instance.name = reinterpret_cast<const char*>(name);
+    instance.cost = TicksToTimeDelta(record.ticks);
+    instance.thread_id = record.thread_id;
+    instances->push_back(instance);
+  }
+  std::sort(instances->begin(), instances->end(), &CompareInstancesByCost);
+}
+
+// static
+void StartupInstanceReport::WriteAscii(std::string* output) {
+  std::vector<Instance> instances;
+  GetInstances(&instances);
+  StringAppendF(output, "%d instances created during startup\n",
+                static_cast<int>(instances.size()));
+  output->append("cost(ms)  thread  created by\n");
+  for (size_t i = 0; i < instances.size(); ++i) {
+    StringAppendF(output, "%8.3f %7d  %s\n",
+                  instances[i].cost.InMillisecondsF(),
+                  static_cast<int>(instances[i].thread_id),
+                  instances[i].name);
+  }
+}
+
+namespace internal {
+
+ScopedInstanceCreation::ScopedInstanceCreation(const char* name)
+    : name_(name),
+      start_ticks_(StartupInstanceReport::IsRecording() ? GetTicks() : 0) {
+}
+
+ScopedInstanceCreation::~ScopedInstanceCreation() {
+  if (!start_ticks_)
+    return;
+  int64 ticks = GetTicks() - start_ticks_;
+  int index = subtle::NoBarrier_AtomicIncrement(&g_record_count, 1) - 1;
+  if (index >= StartupInstanceReport::kMaxInstances)
+    return;
+
+  InstanceRecord& record = g_records[index];
+  record.ticks = ticks;
+  record.thread_id = PlatformThread::CurrentId();
+  // Published last: GetInstances() skips the entries without a name.
+  subtle::Release_Store(&record.name,
+                        reinterpret_cast<subtle::AtomicWord>(name_));
+}
+
+}  // namespace internal
+
+}  // namespace base
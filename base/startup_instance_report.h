@@ -0,0 +1,84 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_STARTUP_INSTANCE_REPORT_H_
+#define BASE_STARTUP_INSTANCE_REPORT_H_
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/threading/platform_thread.h"
+#include "base/time.h"
+
+// The name of the function it is used in, with its template arguments, which
+// names the type of a LazyInstance or Singleton in the report.
+#if defined(COMPILER_MSVC)
+#define BASE_INSTANCE_CREATION_NAME __FUNCSIG__
+#else
+#define BASE_INSTANCE_CREATION_NAME __PRETTY_FUNCTION__
+#endif
+
+namespace base {
+
+// StartupInstanceReport lists the LazyInstances and Singletons created during
+// startup, with how long each took to construct, to find the expensive ones
+// that could be created later or not at all. It records from the start of the
+// process until StopRecording(), which views calls at the first paint of a
+// window, or until it has recorded kMaxInstances.
+//
+// The time of an instance includes that of those its constructor creates. To
+// record nothing but the name and the time, it takes no lock and allocates
+// nothing, and so may run before main().
+class BASE_EXPORT StartupInstanceReport {
+ public:
+  enum { kMaxInstances = 512 };
+
+  struct Instance {
+    // What created the instance: LazyInstance<Type, ...>::CreateInstance() or
+    // Singleton<Type, ...>::CreateInstance().
+    const char* name;
+    TimeDelta cost;
+    PlatformThreadId thread_id;
+  };
+
+  static bool IsRecording();
+  static void StopRecording();
+
+  // Returns the instances created until recording stopped, the most expensive
+  // first. Those still being created, or created while stopping, may be
+  // missing.
+  static void GetInstances(std::vector<Instance>* instances);
+
+  // Writes the instances as a table, the most expensive first.
+  static void WriteAscii(std::string* output);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(StartupInstanceReport);
+};
+
+namespace internal {
+
+// Records the creation of an instance, from its construction to its
+// destruction, when StartupInstanceReport is recording.
+class BASE_EXPORT ScopedInstanceCreation {
+ public:
+  explicit ScopedInstanceCreation(const char* name);
+  ~ScopedInstanceCreation();
+
+ private:
+  const char* name_;
+  // 0 if not recording.
+  int64 start_ticks_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedInstanceCreation);
+};
+
+}  // namespace internal
+
+}  // namespace base
+
+#endif  // BASE_STARTUP_INSTANCE_REPORT_H_
@@ -19,6 +19,41 @@ namespace base {
 
 namespace {
 
+// The two digits of each number below 100, so that the digits of an integer
+// are made two at a time.
+const char kDigitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Writes the digits of |value| so that they end at |end|, and returns where
+// they start.
+template <typename UINT>
+char* FormatUnsigned(UINT value, char* end) {
+  char* it = end;
+  while (value >= 100) {
+    const char* pair = &kDigitPairs[(value % 100) * 2];
+    value /= 100;
+    *--it = pair[1];
+    *--it = pair[0];
+  }
+  if (value >= 10) {
+    const char* pair = &kDigitPairs[value * 2];
+    *--it = pair[1];
+    *--it = pair[0];
+  } else {
+    *--it = static_cast<char>('0' + value);
+  }
+  return it;
+}
+
 template <typename STR, typename INT, typename UINT, bool NEG>
 struct IntToStringT {
   // This is to avoid a compiler warning about unary minus on unsigned type.
@@ -63,41 +98,72 @@ struct IntToStringT {
     }
   };
 
-  static STR IntToString(INT value) {
-    // log10(2) ~= 0.3 bytes needed per bit or per byte log10(2**8) ~= 2.4.
-    // So round up to allocate 3 output characters per byte, plus 1 for '-'.
-    const int kOutputBufSize = 3 * sizeof(INT) + 1;
-
-    // Allocate the whole string right away, we will right back to front, and
-    // then return the substr of what we ended up using.
-    STR outbuf(kOutputBufSize, 0);
+  // log10(2) ~= 0.3 bytes needed per bit or per byte log10(2**8) ~= 2.4.
+  // So round up to allocate 3 output characters per byte, plus 1 for '-'.
+  static const int kOutputBufSize = 3 * sizeof(INT) + 1;
 
+  // Writes |value| so that it ends at |end|, which has kOutputBufSize
+  // characters before it, and returns where it starts.
+  static char* Format(INT value, char* end) {
     bool is_neg = TestNegT<INT, NEG>::TestNeg(value);
     // Even though is_neg will never be true when INT is parameterized as
     // unsigned, even the presence of the unary operation causes a warning.
     UINT res = ToUnsignedT<INT, UINT, NEG>::ToUnsigned(value);
 
-    for (typename STR::iterator it = outbuf.end();;) {
-      --it;
-      DCHECK(it != outbuf.begin());
-      *it = static_cast<typename STR::value_type>((res % 10) + '0');
-      res /= 10;
-
-      // We're done..
-      if (res == 0) {
-        if (is_neg) {
-          --it;
-          DCHECK(it != outbuf.begin());
-          *it = static_cast<typename STR::value_type>('-');
-        }
-        return STR(it, outbuf.end());
-      }
-    }
-    NOTREACHED();
-    return STR();
+    char* begin = FormatUnsigned(res, end);
+    if (is_neg)
+      *--begin = '-';
+    return begin;
+  }
+
+  static STR IntToString(INT value) {
+    // The digits are written back to front into a buffer on the stack, and
+    // the string is made from the ones that were used.
+    char buffer[kOutputBufSize];
+    char* end = buffer + kOutputBufSize;
+    return STR(Format(value, end), end);
+  }
+
+  static void AppendIntToString(INT value, STR* output) {
+    char buffer[kOutputBufSize];
+    char* end = buffer + kOutputBufSize;
+    output->append(Format(value, end), end);
   }
 };
 
+// Writes |value| into |buffer| as dmg_fp::g_fmt() does if |value| is an
+// integer that a double holds exactly, without going through dtoa, and
+// returns the end of it. Returns NULL otherwise and for zero, whose sign
+// g_fmt() keeps.
+char* FormatIntegralDouble(double value, char* buffer, char* buffer_end) {
+  // Below 2**53, the shortest digits that round-trip an integer are its own,
+  // without the trailing zeros.
+  const double kMaxExactInteger = 9007199254740992.0;
+  double magnitude = value < 0 ? -value : value;
+  if (!(magnitude >= 1 && magnitude < kMaxExactInteger))
+    return NULL;
+  uint64 integer = static_cast<uint64>(magnitude);
+  if (static_cast<double>(integer) != magnitude)
+    return NULL;
+
+  char* digits = FormatUnsigned(integer, buffer_end);
+  int digit_count = static_cast<int>(buffer_end - digits);
+  int significant_count = digit_count;
+  while (digits[significant_count - 1] == '0')
+    --significant_count;
+  // g_fmt() uses an exponent for the integers with more than five trailing
+  // zeros, leave those to it.
+  if (digit_count > significant_count + 5)
+    return NULL;
+
+  char* it = buffer;
+  if (value < 0)
+    *it++ = '-';
+  for (int i = 0; i < digit_count; ++i)
+    *it++ = digits[i];
+  return it;
+}
+
 // Utility to convert a character to a digit in a given base
 template<typename CHAR, int BASE, bool BASE_LTE_10> class BaseCharToDigit {
 };
@@ -383,11 +449,45 @@ string16 Uint64ToString16(uint64 value) {
       IntToString(value);
 }
 
+void AppendIntToString(int value, std::string* output) {
+  IntToStringT<std::string, int, unsigned int, true>::
+      AppendIntToString(value, output);
+}
+
+void AppendUintToString(unsigned int value, std::string* output) {
+  IntToStringT<std::string, unsigned int, unsigned int, false>::
+      AppendIntToString(value, output);
+}
+
+void AppendInt64ToString(int64 value, std::string* output) {
+  IntToStringT<std::string, int64, uint64, true>::
+      AppendIntToString(value, output);
+}
+
+void AppendUint64ToString(uint64 value, std::string* output) {
+  IntToStringT<std::string, uint64, uint64, false>::
+      AppendIntToString(value, output);
+}
+
 std::string DoubleToString(double value) {
+  std::string output;
+  AppendDoubleToString(value, &output);
+  return output;
+}
+
+void AppendDoubleToString(double value, std::string* output) {
   // According to g_fmt.cc, it is sufficient to declare a buffer of size 32.
   char buffer[32];
+  // The integers, which most of the numbers we format are, can be written
+  // without dtoa, which makes its digits with big integer arithmetic.
+  char* buffer_end = buffer + arraysize(buffer);
+  char* end = FormatIntegralDouble(value, buffer, buffer_end);
+  if (end) {
+    output->append(buffer, end);
+    return;
+  }
   dmg_fp::g_fmt(buffer, value);
-  return std::string(buffer);
+  output->append(buffer);
 }
 
 bool StringToInt(const std::string& input, int* output) {
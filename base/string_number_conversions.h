@@ -44,6 +44,14 @@ BASE_EXPORT string16 Uint64ToString16(uint64 value);
 // locale. If you want to use locale specific formatting, use ICU.
 BASE_EXPORT std::string DoubleToString(double value);
 
+// These append the number to |output|, as the functions above format it,
+// for when a string is built from several of them.
+BASE_EXPORT void AppendIntToString(int value, std::string* output);
+BASE_EXPORT void AppendUintToString(unsigned value, std::string* output);
+BASE_EXPORT void AppendInt64ToString(int64 value, std::string* output);
+BASE_EXPORT void AppendUint64ToString(uint64 value, std::string* output);
+BASE_EXPORT void AppendDoubleToString(double value, std::string* output);
+
 // String -> number conversions ------------------------------------------------
 
 // Perform a best-effort conversion of the input string to a numeric type,
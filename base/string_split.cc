@@ -11,6 +11,58 @@
 
 namespace base {
 
+namespace {
+
+StringPiece TrimWhitespacePiece(const StringPiece& piece) {
+  StringPiece::size_type first = piece.find_first_not_of(kWhitespaceASCII);
+  if (first == StringPiece::npos)
+    return StringPiece();
+  StringPiece::size_type last = piece.find_last_not_of(kWhitespaceASCII);
+  return piece.substr(first, last - first + 1);
+}
+
+void SplitStringPieceT(const StringPiece& str,
+                       char c,
+                       bool trim_whitespace,
+                       std::vector<StringPiece>* r) {
+  StringPieceSplitter splitter(str, c);
+  splitter.set_trim_whitespace(trim_whitespace);
+  while (splitter.GetNext())
+    r->push_back(splitter.token());
+}
+
+void AppendPieces(const std::vector<StringPiece>& pieces,
+                  std::vector<std::string>* r) {
+  r->reserve(r->size() + pieces.size());
+  for (size_t i = 0; i < pieces.size(); ++i)
+    r->push_back(pieces[i].as_string());
+}
+
+}  // namespace
+
+StringPieceSplitter::StringPieceSplitter(const StringPiece& str, char c)
+    : str_(str),
+      c_(c),
+      trim_whitespace_(false),
+      next_(0) {
+}
+
+bool StringPieceSplitter::GetNext() {
+  if (next_ == StringPiece::npos)
+    return false;
+  StringPiece::size_type end = str_.find(c_, next_);
+  if (end == StringPiece::npos) {
+    token_ = str_.substr(next_);
+    next_ = StringPiece::npos;
+  } else {
+    token_ = str_.substr(next_, end - next_);
+    next_ = end + 1;
+  }
+  if (trim_whitespace_)
+    token_ = TrimWhitespacePiece(token_);
+  return true;
+}
+
 template<typename STR>
 static void SplitStringT(const STR& str,
                          const typename STR::value_type s,
@@ -46,7 +98,16 @@ void SplitString(const std::string& str,
                  char c,
                  std::vector<std::string>* r) {
   DCHECK(c >= 0 && c < 0x7F);
-  SplitStringT(str, c, true, r);
+  std::vector<StringPiece> pieces;
+  SplitStringPieceT(str, c, true, &pieces);
+  AppendPieces(pieces, r);
+}
+
+void SplitStringPiece(const StringPiece& str,
+                      char c,
+                      std::vector<StringPiece>* r) {
+  DCHECK(c >= 0 && c < 0x7F);
+  SplitStringPieceT(str, c, true, r);
 }
 
 bool SplitStringIntoKeyValues(
@@ -86,27 +147,57 @@ bool SplitStringIntoKeyValuePairs(
     std::vector<std::pair<std::string, std::string> >* kv_pairs) {
   kv_pairs->clear();
 
-  std::vector<std::string> pairs;
-  SplitString(line, key_value_pair_delimiter, &pairs);
+  std::vector<std::pair<StringPiece, StringPiece> > pairs;
+  bool success = SplitStringPieceIntoKeyValuePairs(line,
+                                                   key_value_delimiter,
+                                                   key_value_pair_delimiter,
+                                                   &pairs);
+  kv_pairs->reserve(pairs.size());
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    kv_pairs->push_back(make_pair(pairs[i].first.as_string(),
+                                  pairs[i].second.as_string()));
+  }
+  return success;
+}
+
+bool SplitStringPieceIntoKeyValuePairs(
+    const StringPiece& line,
+    char key_value_delimiter,
+    char key_value_pair_delimiter,
+    std::vector<std::pair<StringPiece, StringPiece> >* kv_pairs) {
+  kv_pairs->clear();
 
   bool success = true;
-  for (size_t i = 0; i < pairs.size(); ++i) {
+  StringPieceSplitter pairs(line, key_value_pair_delimiter);
+  pairs.set_trim_whitespace(true);
+  while (pairs.GetNext()) {
     // Empty pair. SplitStringIntoKeyValues is more strict about an empty pair
     // line, so continue with the next pair.
-    if (pairs[i].empty())
+    const StringPiece& pair = pairs.token();
+    if (pair.empty())
       continue;
 
-    std::string key;
-    std::vector<std::string> value;
-    if (!SplitStringIntoKeyValues(pairs[i],
-                                  key_value_delimiter,
-                                  &key, &value)) {
-      // Don't return here, to allow for keys without associated
-      // values; just record that our split failed.
+    // Don't stop at a pair that doesn't parse, to allow for keys without
+    // associated values; just record that our split failed. As with
+    // SplitStringIntoKeyValues, a pair without a key has an empty key.
+    StringPiece key;
+    StringPiece value;
+    StringPiece::size_type end_key_pos = pair.find(key_value_delimiter);
+    if (end_key_pos == StringPiece::npos) {
+      DVLOG(1) << "cannot parse key from line: " << pair;
       success = false;
+    } else {
+      key = pair.substr(0, end_key_pos);
+      StringPiece::size_type begin_value_pos =
+          pair.find_first_not_of(key_value_delimiter, end_key_pos);
+      if (begin_value_pos == StringPiece::npos) {
+        DVLOG(1) << "cannot parse value from line: " << pair;
+        success = false;
+      } else {
+        value = pair.substr(begin_value_pos);
+      }
     }
-    DCHECK_LE(value.size(), 1U);
-    kv_pairs->push_back(make_pair(key, value.empty()? "" : value[0]));
+    kv_pairs->push_back(std::make_pair(key, value));
   }
   return success;
 }
@@ -157,11 +248,21 @@ void SplitStringDontTrim(const std::string& str,
                          std::vector<std::string>* r) {
   DCHECK(IsStringUTF8(str));
   DCHECK(c >= 0 && c < 0x7F);
-  SplitStringT(str, c, false, r);
+  std::vector<StringPiece> pieces;
+  SplitStringPieceT(str, c, false, &pieces);
+  AppendPieces(pieces, r);
 }
 
-template<typename STR>
-void SplitStringAlongWhitespaceT(const STR& str, std::vector<STR>* result) {
+void SplitStringPieceDontTrim(const StringPiece& str,
+                              char c,
+                              std::vector<StringPiece>* r) {
+  DCHECK(c >= 0 && c < 0x7F);
+  SplitStringPieceT(str, c, false, r);
+}
+
+template<typename STR, typename OUTPUT_STR>
+void SplitStringAlongWhitespaceT(const STR& str,
+                                 std::vector<OUTPUT_STR>* result) {
   const size_t length = str.length();
   if (!length)
     return;
@@ -210,4 +311,9 @@ void SplitStringAlongWhitespace(const std::string& str,
   SplitStringAlongWhitespaceT(str, result);
 }
 
+void SplitStringPieceAlongWhitespace(const StringPiece& str,
+                                     std::vector<StringPiece>* result) {
+  SplitStringAlongWhitespaceT(str, result);
+}
+
 }  // namespace base
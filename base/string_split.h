@@ -12,6 +12,7 @@
 
 #include "base/base_export.h"
 #include "base/string16.h"
+#include "base/string_piece.h"
 
 namespace base {
 
@@ -77,6 +78,60 @@ BASE_EXPORT void SplitStringAlongWhitespace(const string16& str,
 BASE_EXPORT void SplitStringAlongWhitespace(const std::string& str,
                                             std::vector<std::string>* result);
 
+// StringPiece versions of the above, for the 8-bit strings. The pieces point
+// into |str| rather than being copied out of it, so that splitting doesn't
+// allocate for each of them, and are only valid as long as |str| is.
+BASE_EXPORT void SplitStringPiece(const StringPiece& str,
+                                  char c,
+                                  std::vector<StringPiece>* r);
+BASE_EXPORT void SplitStringPieceDontTrim(const StringPiece& str,
+                                          char c,
+                                          std::vector<StringPiece>* r);
+BASE_EXPORT bool SplitStringPieceIntoKeyValuePairs(
+    const StringPiece& line,
+    char key_value_delimiter,
+    char key_value_pair_delimiter,
+    std::vector<std::pair<StringPiece, StringPiece> >* kv_pairs);
+BASE_EXPORT void SplitStringPieceAlongWhitespace(
+    const StringPiece& str,
+    std::vector<StringPiece>* result);
+
+// Goes through the pieces of |str| delimited by |c| one at a time, without
+// a vector of them, as in:
+//
+//   base::StringPieceSplitter splitter(input, ',');
+//   while (splitter.GetNext())
+//     Use(splitter.token());
+//
+// The pieces are the ones SplitStringPieceDontTrim() gives, or
+// SplitStringPiece() after set_trim_whitespace(true).
+class BASE_EXPORT StringPieceSplitter {
+ public:
+  StringPieceSplitter(const StringPiece& str, char c);
+
+  void set_trim_whitespace(bool trim_whitespace) {
+    trim_whitespace_ = trim_whitespace;
+  }
+
+  // Moves to the next piece, returns false when there are no more.
+  bool GetNext();
+
+  // The current piece, which points into the string being split.
+  const StringPiece& token() const { return token_; }
+
+ private:
+  StringPiece str_;
+  char c_;
+  bool trim_whitespace_;
+
+  // Where the next piece starts, or npos after the last one.
+  StringPiece::size_type next_;
+
+  StringPiece token_;
+
+  // Copy and assignment are allowed.
+};
+
 }  // namespace base
 
 #endif  // BASE_STRING_SPLIT_H
@@ -20,6 +20,12 @@
 #include <algorithm>
 #include <vector>
 
+#if defined(ARCH_CPU_X86_FAMILY) && (defined(__x86_64__) || \
+    defined(_M_X64) || defined(__SSE2__) || _M_IX86_FP == 2)
+#define STRING_UTIL_SSE2 1
+#include <emmintrin.h>
+#endif
+
 #include "base/basictypes.h"
 #include "base/logging.h"
 #include "base/memory/singleton.h"
@@ -453,6 +459,26 @@ bool IsStringASCII(const base::StringPiece& str) {
   return DoIsStringASCII(str);
 }
 
+size_t FindFirstCodeUnitAbove(const char16* str, size_t length, char16 max) {
+  size_t i = 0;
+#if defined(STRING_UTIL_SSE2)
+  const __m128i threshold = _mm_set1_epi16(static_cast<short>(max));
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 8 <= length; i += 8) {
+    __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+    // The unsigned saturating difference is zero in the lanes up to |max|.
+    __m128i above = _mm_subs_epu16(units, threshold);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(above, zero)) != 0xFFFF)
+      break;  // The loop below finds which lane.
+  }
+#endif
+  for (; i < length; ++i) {
+    if (str[i] > max)
+      return i;
+  }
+  return length;
+}
+
 bool IsStringUTF8(const std::string& str) {
   const char *src = str.data();
   int32 src_len = static_cast<int32>(str.length());
@@ -284,6 +284,15 @@ BASE_EXPORT bool IsStringASCII(const std::wstring& str);
 BASE_EXPORT bool IsStringASCII(const base::StringPiece& str);
 BASE_EXPORT bool IsStringASCII(const string16& str);
 
+// Returns the index of the first code unit of |str| that is above |max|, or
+// |length| if there is none.  Scans 8 code units at a time with SSE2 where
+// the compiler targets it.  This is the fast path of the functions that only
+// need to look closer at the rare code units above a threshold, such as the
+// non-ASCII ones above 0x7F.
+BASE_EXPORT size_t FindFirstCodeUnitAbove(const char16* str,
+                                          size_t length,
+                                          char16 max);
+
 // Converts the elements of the given string.  This version uses a pointer to
 // clearly differentiate it from the non-pointer variant.
 template <class str> inline void StringToLowerASCII(str* s) {
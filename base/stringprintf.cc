@@ -89,6 +89,8 @@ static void StringAppendVT(StringType* dst,
       return;
     }
 
+    // Not formatted in place at the end of |dst|: an argument may point into
+    // |dst|, which resizing it would move.
     std::vector<typename StringType::value_type> mem_buf(mem_length);
 
     // NOTE: You can only use a va_list once.  Since we're in a while loop, we
@@ -0,0 +1,94 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// ConditionVariable wraps the OS condition variable, so that a thread can
+// wait with a Lock released for another to change what the Lock protects.
+//
+// A ConditionVariable is used with one Lock, which is held around each call
+// to Wait() or TimedWait(). The waiter checks its condition in a loop, as
+// another thread may have changed it again before the waiter got the Lock
+// back, and as a wait may return without a Signal():
+//
+//   AutoLock auto_lock(lock_);
+//   while (queue_.empty())
+//     queue_not_empty_.Wait();
+//
+// Signal() and Broadcast() may be called with the Lock held or not.
+//
+// Use a ConditionVariable rather than a WaitableEvent and a Lock when the
+// condition is more than a boolean, such as a queue having items: a signal
+// then takes no kernel call when nothing is waiting.
+
+#ifndef BASE_SYNCHRONIZATION_CONDITION_VARIABLE_H_
+#define BASE_SYNCHRONIZATION_CONDITION_VARIABLE_H_
+#pragma once
+
+#include "build/build_config.h"
+
+#if defined(OS_WIN)
+#include <windows.h>
+#include <list>
+#elif defined(OS_POSIX)
+#include <pthread.h>
+#endif
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/synchronization/lock.h"
+
+namespace base {
+
+class TimeDelta;
+
+#if defined(OS_WIN)
+namespace internal {
+struct ConditionVariableFunctions;
+}  // namespace internal
+#endif
+
+class BASE_EXPORT ConditionVariable {
+ public:
+  // Construct a cv for use with ONLY one user lock.
+  explicit ConditionVariable(Lock* user_lock);
+
+  ~ConditionVariable();
+
+  // Wait() releases the caller's critical section atomically as it starts to
+  // sleep, and the reacquires it when it is signaled.
+  void Wait();
+  void TimedWait(const TimeDelta& max_time);
+
+  // Broadcast() revives all waiting threads.
+  void Broadcast();
+  // Signal() revives one waiting thread.
+  void Signal();
+
+ private:
+#if defined(OS_WIN)
+  void WaitForMilliseconds(DWORD timeout);
+
+  // The CONDITION_VARIABLE functions of kernel32, which are looked up as they
+  // aren't on XP. NULL functions if they aren't there.
+  const internal::ConditionVariableFunctions* functions_;
+  CONDITION_VARIABLE cv_;
+
+  // Without CONDITION_VARIABLE, each waiter waits for an auto-reset event of
+  // its own, which it puts in |waiting_events_| before releasing the user lock
+  // and Signal() sets. The events are kept for later waits in |free_events_|.
+  // Both lists are protected by |internal_lock_|.
+  internal::LockImpl internal_lock_;
+  std::list<HANDLE> waiting_events_;
+  std::list<HANDLE> free_events_;
+#elif defined(OS_POSIX)
+  pthread_cond_t condition_;
+#endif
+
+  Lock* const user_lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConditionVariable);
+};
+
+}  // namespace base
+
+#endif  // BASE_SYNCHRONIZATION_CONDITION_VARIABLE_H_
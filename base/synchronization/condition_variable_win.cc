@@ -0,0 +1,157 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/synchronization/condition_variable.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/time.h"
+
+namespace base {
+namespace internal {
+
+struct ConditionVariableFunctions {
+  typedef VOID (WINAPI* WakeFunction)(PCONDITION_VARIABLE condition);
+  typedef BOOL (WINAPI* SleepFunction)(PCONDITION_VARIABLE condition,
+                                       PCRITICAL_SECTION critical_section,
+                                       DWORD milliseconds);
+
+  ConditionVariableFunctions() {
+    HMODULE kernel32 = ::GetModuleHandle(L"kernel32.dll");
+    wake = reinterpret_cast<WakeFunction>(
+        ::GetProcAddress(kernel32, "WakeConditionVariable"));
+    wake_all = reinterpret_cast<WakeFunction>(
+        ::GetProcAddress(kernel32, "WakeAllConditionVariable"));
+    sleep = reinterpret_cast<SleepFunction>(
+        ::GetProcAddress(kernel32, "SleepConditionVariableCS"));
+  }
+
+  bool available() const {
+    return wake && wake_all && sleep;
+  }
+
+  WakeFunction wake;
+  WakeFunction wake_all;
+  SleepFunction sleep;
+};
+
+}  // namespace internal
+
+namespace {
+
+// Leaky, as condition variables may be used by the destructors of other
+// statics.
+LazyInstance<internal::ConditionVariableFunctions,
+             LeakyLazyInstanceTraits<internal::ConditionVariableFunctions> >
+    g_condition_variable_functions(LINKER_INITIALIZED);
+
+}  // namespace
+
+ConditionVariable::ConditionVariable(Lock* user_lock)
+    : functions_(g_condition_variable_functions.Pointer()),
+      user_lock_(user_lock) {
+  DCHECK(user_lock);
+  // InitializeConditionVariable() just sets it to CONDITION_VARIABLE_INIT.
+  cv_.Ptr = NULL;
+}
+
+ConditionVariable::~ConditionVariable() {
+  // A CONDITION_VARIABLE holds no resources.
+  DCHECK(waiting_events_.empty());
+  for (std::list<HANDLE>::iterator it = free_events_.begin();
+       it != free_events_.end(); ++it) {
+    CloseHandle(*it);
+  }
+}
+
+void ConditionVariable::Wait() {
+  WaitForMilliseconds(INFINITE);
+}
+
+void ConditionVariable::TimedWait(const TimeDelta& max_time) {
+  DCHECK(max_time >= TimeDelta::FromMicroseconds(0));
+  // Rounded up, so as not to return before |max_time|.
+  double timeout = ceil(max_time.InMillisecondsF());
+  WaitForMilliseconds(static_cast<DWORD>(
+      std::min(timeout, static_cast<double>(INFINITE - 1))));
+}
+
+void ConditionVariable::Broadcast() {
+  if (functions_->available()) {
+    functions_->wake_all(&cv_);
+    return;
+  }
+  internal_lock_.Lock();
+  for (std::list<HANDLE>::iterator it = waiting_events_.begin();
+       it != waiting_events_.end(); ++it) {
+    SetEvent(*it);
+  }
+  waiting_events_.clear();
+  internal_lock_.Unlock();
+}
+
+void ConditionVariable::Signal() {
+  if (functions_->available()) {
+    functions_->wake(&cv_);
+    return;
+  }
+  internal_lock_.Lock();
+  if (!waiting_events_.empty()) {
+    SetEvent(waiting_events_.front());
+    waiting_events_.pop_front();
+  }
+  internal_lock_.Unlock();
+}
+
+void ConditionVariable::WaitForMilliseconds(DWORD timeout) {
+  if (functions_->available()) {
+#if !defined(NDEBUG)
+    user_lock_->CheckHeldAndUnmark();
+#endif
+    // Times out with ERROR_TIMEOUT, which the caller learns by checking its
+    // condition, as it does after a spurious wake.
+    functions_->sleep(&cv_, user_lock_->lock_.os_lock(), timeout);
+#if !defined(NDEBUG)
+    user_lock_->CheckUnheldAndMark();
+#endif
+    return;
+  }
+
+  internal_lock_.Lock();
+  HANDLE event;
+  if (free_events_.empty()) {
+    event = CreateEvent(NULL, FALSE, FALSE, NULL);
+    CHECK(event);
+  } else {
+    event = free_events_.front();
+    free_events_.pop_front();
+  }
+  waiting_events_.push_back(event);
+  internal_lock_.Unlock();
+
+  // A Signal() after the release sets |event|, so none is missed before the
+  // wait starts.
+  user_lock_->Release();
+  WaitForSingleObject(event, timeout);
+
+  internal_lock_.Lock();
+  std::list<HANDLE>::iterator it =
+      std::find(waiting_events_.begin(), waiting_events_.end(), event);
+  if (it != waiting_events_.end()) {
+    // Timed out without a Signal().
+    waiting_events_.erase(it);
+  } else {
+    // Signaled. If that was as the wait timed out, |event| is still set.
+    ResetEvent(event);
+  }
+  free_events_.push_back(event);
+  internal_lock_.Unlock();
+  user_lock_->Acquire();
+}
+
+}  // namespace base
@@ -0,0 +1,85 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_SYNCHRONIZATION_LIGHTWEIGHT_EVENT_H_
+#define BASE_SYNCHRONIZATION_LIGHTWEIGHT_EVENT_H_
+#pragma once
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+
+namespace base {
+
+class TimeDelta;
+
+#if defined(OS_WIN)
+namespace internal {
+struct WaitOnAddressFunctions;
+}  // namespace internal
+#endif
+
+// An event for handing work from one thread to another with little latency,
+// in the manner of a futex. Its state is a word in memory: Signal() takes no
+// kernel call while no thread is waiting, and Wait() spins for a while before
+// it sleeps, so that a thread which is signaled soon after it starts waiting
+// doesn't go through the kernel either. The waiters sleep with WaitOnAddress
+// where there is one (Windows 8), and with a ConditionVariable elsewhere.
+//
+// Unlike a WaitableEvent, it has no handle, so it can't be waited for along
+// with other objects, nor by MessageLoop's WaitableEventWatcher.
+class BASE_EXPORT LightweightEvent {
+ public:
+  // As for WaitableEvent: an auto-reset event releases a single waiter for a
+  // Signal(), and is reset by it, a manual-reset one stays signaled until
+  // Reset().
+  LightweightEvent(bool manual_reset, bool initially_signaled);
+  ~LightweightEvent();
+
+  void Signal();
+  void Reset();
+
+  // Returns whether the event is signaled, and resets it if it is an
+  // auto-reset event.
+  bool IsSignaled();
+
+  void Wait();
+
+  // Returns true if the event was signaled before |max_time| passed.
+  bool TimedWait(const TimeDelta& max_time);
+
+ private:
+  struct Fallback;
+
+  // Takes the signal, as IsSignaled().
+  bool TryConsume();
+
+  // Waits at most |timeout_ms| milliseconds, or forever for INFINITE.
+  bool WaitForMilliseconds(uint32 timeout_ms);
+
+  const bool manual_reset_;
+
+  // 1 while the event is signaled, else 0.
+  volatile subtle::Atomic32 state_;
+
+  // The number of threads that are no longer spinning in Wait(), which
+  // Signal() has to wake.
+  volatile subtle::Atomic32 waiters_;
+
+#if defined(OS_WIN)
+  // NULL functions before Windows 8.
+  const internal::WaitOnAddressFunctions* functions_;
+#endif
+
+  // The lock and condition variable the waiters sleep on where there is no
+  // WaitOnAddress.
+  scoped_ptr<Fallback> fallback_;
+
+  DISALLOW_COPY_AND_ASSIGN(LightweightEvent);
+};
+
+}  // namespace base
+
+#endif  // BASE_SYNCHRONIZATION_LIGHTWEIGHT_EVENT_H_
@@ -0,0 +1,189 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/synchronization/lightweight_event.h"
+
+#include <windows.h>
+#include <math.h>
+
+#include <algorithm>
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/time.h"
+
+namespace base {
+namespace internal {
+
+struct WaitOnAddressFunctions {
+  typedef BOOL (WINAPI* WaitFunction)(volatile VOID* address,
+                                      PVOID compare_address,
+                                      SIZE_T address_size,
+                                      DWORD milliseconds);
+  typedef VOID (WINAPI* WakeFunction)(PVOID address);
+
+  WaitOnAddressFunctions() {
+    // Exported by kernelbase.dll, which every process has loaded, rather than
+    // kernel32.dll.
+    HMODULE kernelbase = ::GetModuleHandle(L"kernelbase.dll");
+    if (kernelbase) {
+      wait = reinterpret_cast<WaitFunction>(
+          ::GetProcAddress(kernelbase, "WaitOnAddress"));
+      wake_single = reinterpret_cast<WakeFunction>(
+          ::GetProcAddress(kernelbase, "WakeByAddressSingle"));
+      wake_all = reinterpret_cast<WakeFunction>(
+          ::GetProcAddress(kernelbase, "WakeByAddressAll"));
+    } else {
+      wait = NULL;
+      wake_single = NULL;
+      wake_all = NULL;
+    }
+  }
+
+  bool available() const {
+    return wait && wake_single && wake_all;
+  }
+
+  WaitFunction wait;
+  WakeFunction wake_single;
+  WakeFunction wake_all;
+};
+
+}  // namespace internal
+
+namespace {
+
+// How many times Wait() checks the state before it sleeps. About as long as a
+// context switch.
+const int kSpinCount = 1000;
+
+// Leaky, as events may be used by the destructors of other statics.
+LazyInstance<internal::WaitOnAddressFunctions,
+             LeakyLazyInstanceTraits<internal::WaitOnAddressFunctions> >
+    g_wait_on_address_functions(LINKER_INITIALIZED);
+
+}  // namespace
+
+struct LightweightEvent::Fallback {
+  Fallback() : condition(&lock) {}
+
+  Lock lock;
+  ConditionVariable condition;
+};
+
+LightweightEvent::LightweightEvent(bool manual_reset, bool initially_signaled)
+    : manual_reset_(manual_reset),
+      state_(initially_signaled ? 1 : 0),
+      waiters_(0),
+      functions_(g_wait_on_address_functions.Pointer()) {
+  if (!functions_->available())
+    fallback_.reset(new Fallback);
+}
+
+LightweightEvent::~LightweightEvent() {
+  DCHECK_EQ(0, subtle::NoBarrier_Load(&waiters_));
+}
+
+void LightweightEvent::Signal() {
+  subtle::Release_Store(&state_, 1);
+  // Orders the store before the load of |waiters_|. A waiter counts itself
+  // before it checks |state_|, so either it sees the store, or this sees it.
+  subtle::MemoryBarrier();
+  if (subtle::NoBarrier_Load(&waiters_) == 0)
+    return;
+
+  if (fallback_.get()) {
+    AutoLock lock(fallback_->lock);
+    if (manual_reset_)
+      fallback_->condition.Broadcast();
+    else
+      fallback_->condition.Signal();
+  } else {
+    void* address = const_cast<subtle::Atomic32*>(&state_);
+    if (manual_reset_)
+      functions_->wake_all(address);
+    else
+      functions_->wake_single(address);
+  }
+}
+
+void LightweightEvent::Reset() {
+  subtle::Release_Store(&state_, 0);
+}
+
+bool LightweightEvent::IsSignaled() {
+  return TryConsume();
+}
+
+void LightweightEvent::Wait() {
+  WaitForMilliseconds(INFINITE);
+}
+
+bool LightweightEvent::TimedWait(const TimeDelta& max_time) {
+  DCHECK(max_time >= TimeDelta::FromMicroseconds(0));
+  // Rounded up, so as not to return before |max_time|.
+  double timeout = ceil(max_time.InMillisecondsF());
+  return WaitForMilliseconds(static_cast<uint32>(
+      std::min(timeout, static_cast<double>(INFINITE - 1))));
+}
+
+bool LightweightEvent::TryConsume() {
+  if (manual_reset_)
+    return subtle::Acquire_Load(&state_) != 0;
+  return subtle::Acquire_CompareAndSwap(&state_, 1, 0) == 1;
+}
+
+bool LightweightEvent::WaitForMilliseconds(uint32 timeout_ms) {
+  if (TryConsume())
+    return true;
+  if (timeout_ms == 0)
+    return false;
+  for (int i = 0; i < kSpinCount; ++i) {
+    YieldProcessor();
+    if (subtle::NoBarrier_Load(&state_) && TryConsume())
+      return true;
+  }
+
+  const bool infinite = timeout_ms == INFINITE;
+  const TimeTicks end_time =
+      TimeTicks::Now() + TimeDelta::FromMilliseconds(timeout_ms);
+  TimeDelta remaining = TimeDelta::FromMilliseconds(timeout_ms);
+
+  subtle::Barrier_AtomicIncrement(&waiters_, 1);
+  bool signaled = false;
+  if (fallback_.get()) {
+    AutoLock lock(fallback_->lock);
+    while (!(signaled = TryConsume())) {
+      if (infinite) {
+        fallback_->condition.Wait();
+      } else {
+        if (remaining <= TimeDelta())
+          break;
+        fallback_->condition.TimedWait(remaining);
+        remaining = end_time - TimeTicks::Now();
+      }
+    }
+  } else {
+    while (!(signaled = TryConsume())) {
+      DWORD wait_ms = INFINITE;
+      if (!infinite) {
+        if (remaining <= TimeDelta())
+          break;
+        wait_ms = static_cast<DWORD>(ceil(remaining.InMillisecondsF()));
+      }
+      // Returns at once if |state_| isn't 0 any more, so a Signal() between
+      // the check and the wait isn't missed.
+      subtle::Atomic32 unsignaled = 0;
+      functions_->wait(&state_, &unsignaled, sizeof(unsignaled), wait_ms);
+      if (!infinite)
+        remaining = end_time - TimeTicks::Now();
+    }
+  }
+  subtle::Barrier_AtomicIncrement(&waiters_, -1);
+  return signaled;
+}
+
+}  // namespace base
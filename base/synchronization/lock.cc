@@ -4,20 +4,73 @@
 
 // This file is used for debugging assertion support.  The Lock class
 // is functionally a wrapper around the LockImpl class, so the only
-// real intelligence in the class is in the debugging logic.
+// real intelligence in the class is in the debugging logic, and in the
+// constructors that tell a profiled lock where it was made.
 
-#if !defined(NDEBUG)
+#if !defined(NDEBUG) || defined(ENABLE_LOCK_PROFILING)
+
+#include "build/build_config.h"
+
+#if defined(ENABLE_LOCK_PROFILING) && defined(COMPILER_MSVC)
+// MSDN says to #include <intrin.h>, but that breaks the VS2005 build.
+extern "C" {
+  void* _ReturnAddress();
+}
+#endif
 
 #include "base/synchronization/lock.h"
 #include "base/logging.h"
 
 namespace base {
 
+#if defined(ENABLE_LOCK_PROFILING)
+
+// Not inlined, so that the return address is in the constructor of whatever
+// holds the lock.
+#if defined(COMPILER_MSVC)
+__declspec(noinline)
+#elif defined(COMPILER_GCC)
+__attribute__((noinline))
+#endif
+Lock::Lock()
+    : lock_(tracked_objects::Location(
+#if defined(COMPILER_MSVC)
+          "", "", 0, _ReturnAddress()
+#elif defined(COMPILER_GCC)
+          "", "", 0,
+          __builtin_extract_return_addr(__builtin_return_address(0))
+#endif
+          )) {
+#if !defined(NDEBUG)
+  owned_by_thread_ = false;
+  owning_thread_id_ = static_cast<PlatformThreadId>(0);
+#endif
+}
+
+Lock::Lock(const tracked_objects::Location& constructed_at)
+    : lock_(constructed_at) {
+#if !defined(NDEBUG)
+  owned_by_thread_ = false;
+  owning_thread_id_ = static_cast<PlatformThreadId>(0);
+#endif
+}
+
+#endif  // ENABLE_LOCK_PROFILING
+
+#if !defined(NDEBUG)
+
+#if !defined(ENABLE_LOCK_PROFILING)
 Lock::Lock() : lock_() {
   owned_by_thread_ = false;
   owning_thread_id_ = static_cast<PlatformThreadId>(0);
 }
 
+Lock::Lock(const tracked_objects::Location& constructed_at) : lock_() {
+  owned_by_thread_ = false;
+  owning_thread_id_ = static_cast<PlatformThreadId>(0);
+}
+#endif
+
 void Lock::AssertAcquired() const {
   DCHECK(owned_by_thread_);
   DCHECK_EQ(owning_thread_id_, PlatformThread::CurrentId());
@@ -36,6 +89,8 @@ void Lock::CheckUnheldAndMark() {
   owning_thread_id_ = PlatformThread::CurrentId();
 }
 
+#endif  // NDEBUG
+
 }  // namespace base
 
-#endif  // NDEBUG
+#endif  // !NDEBUG || ENABLE_LOCK_PROFILING
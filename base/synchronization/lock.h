@@ -7,9 +7,14 @@
 #pragma once
 
 #include "base/base_export.h"
+#include "base/location.h"
 #include "base/synchronization/lock_impl.h"
 #include "base/threading/platform_thread.h"
 
+#if defined(ENABLE_LOCK_PROFILING)
+#include "base/synchronization/lock_profiler.h"
+#endif
+
 namespace base {
 
 // A convenient wrapper for an OS specific critical section.  The only real
@@ -17,8 +22,18 @@ namespace base {
 // AssertAcquired() method.
 class BASE_EXPORT Lock {
  public:
-#if defined(NDEBUG)             // Optimized wrapper implementation
+  // In builds with ENABLE_LOCK_PROFILING, LockProfiler counts the lock as one
+  // constructed by the caller, or at |constructed_at|, which other builds
+  // ignore.
+#if defined(NDEBUG) && !defined(ENABLE_LOCK_PROFILING)
   Lock() : lock_() {}
+  explicit Lock(const tracked_objects::Location& constructed_at) : lock_() {}
+#else
+  Lock();
+  explicit Lock(const tracked_objects::Location& constructed_at);
+#endif
+
+#if defined(NDEBUG)             // Optimized wrapper implementation
   ~Lock() {}
   void Acquire() { lock_.Lock(); }
   void Release() { lock_.Unlock(); }
@@ -32,7 +47,6 @@ class BASE_EXPORT Lock {
   // Null implementation if not debug.
   void AssertAcquired() const {}
 #else
-  Lock();
   ~Lock() {}
 
   // NOTE: Although windows critical sections support recursive locks, we do not
@@ -58,13 +72,10 @@ class BASE_EXPORT Lock {
   void AssertAcquired() const;
 #endif                          // NDEBUG
 
-#if defined(OS_POSIX)
-  // The posix implementation of ConditionVariable needs to be able
-  // to see our lock and tweak our debugging counters, as it releases
-  // and acquires locks inside of pthread_cond_{timed,}wait.
-  // Windows doesn't need to do this as it calls the Lock::* methods.
+  // ConditionVariable needs to be able to see our lock and tweak our
+  // debugging counters, as it releases and acquires locks inside of
+  // pthread_cond_{timed,}wait and SleepConditionVariableCS.
   friend class ConditionVariable;
-#endif
 
  private:
 #if !defined(NDEBUG)
@@ -86,7 +97,11 @@ class BASE_EXPORT Lock {
 #endif  // NDEBUG
 
   // Platform specific underlying lock implementation.
+#if defined(ENABLE_LOCK_PROFILING)
+  internal::ProfiledLockImpl lock_;
+#else
   internal::LockImpl lock_;
+#endif
 
   DISALLOW_COPY_AND_ASSIGN(Lock);
 };
@@ -0,0 +1,243 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/synchronization/lock_profiler.h"
+
+#include <algorithm>
+#include <map>
+
+#include "base/format_macros.h"
+#include "base/lazy_instance.h"
+#include "base/stringprintf.h"
+
+#if defined(OS_POSIX)
+#include <time.h>
+#endif
+
+namespace base {
+
+namespace {
+
+#if defined(ENABLE_LOCK_PROFILING)
+
+// Orders the sites by where they are, for the map of the Registry.
+struct LocationLess {
+  bool operator()(const tracked_objects::Location& a,
+                  const tracked_objects::Location& b) const {
+    if (a.program_counter() != b.program_counter())
+      return a.program_counter() < b.program_counter();
+    if (a.line_number() != b.line_number())
+      return a.line_number() < b.line_number();
+    if (a.file_name() != b.file_name())
+      return a.file_name() < b.file_name();
+    return a.function_name() < b.function_name();
+  }
+};
+
+typedef std::map<tracked_objects::Location, LockProfiler::Site, LocationLess>
+    SiteMap;
+
+// The locks that are alive, and the counts of those that have been destroyed.
+// Its lock is a LockImpl, as a Lock would profile itself.
+struct Registry {
+  Registry() : first(NULL) {
+#if defined(OS_WIN)
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    ticks_per_second = frequency.QuadPart;
+#elif defined(OS_POSIX)
+    ticks_per_second = Time::kNanosecondsPerSecond;
+#endif
+  }
+
+  internal::LockImpl lock;
+  internal::ProfiledLockImpl* first;
+  SiteMap destroyed_locks;
+  int64 ticks_per_second;
+};
+
+// Leaky, as locks are used by the destructors of other statics.
+LazyInstance<Registry, LeakyLazyInstanceTraits<Registry> > g_registry(
+    LINKER_INITIALIZED);
+
+TimeDelta TicksToTimeDelta(int64 ticks, int64 ticks_per_second) {
+  return TimeDelta::FromMicroseconds(
+      ticks / ticks_per_second * Time::kMicrosecondsPerSecond +
+      ticks % ticks_per_second * Time::kMicrosecondsPerSecond /
+          ticks_per_second);
+}
+
+#endif  // ENABLE_LOCK_PROFILING
+
+bool CompareSitesByWait(const LockProfiler::Site& a,
+                        const LockProfiler::Site& b) {
+  return a.total_wait > b.total_wait;
+}
+
+void WriteSites(const std::string& newline, bool html, std::string* output) {
+  if (!LockProfiler::IsEnabled()) {
+    output->append("Lock profiling is not enabled, build with "
+                   "enable_lock_profiling=1.");
+    output->append(newline);
+    return;
+  }
+
+  std::vector<LockProfiler::Site> sites;
+  LockProfiler::GetSites(&sites);
+  output->append("Locks by the time spent waiting for them");
+  output->append(newline);
+  output->append("wait(ms) max hold(ms) contended/acquisitions  locks  "
+                 "constructed at");
+  output->append(newline);
+  for (size_t i = 0; i < sites.size(); ++i) {
+    const LockProfiler::Site& site = sites[i];
+    StringAppendF(output, "%8.3f %12.3f %10" PRId64 "/%-12" PRId64 " %5d  ",
+                  site.total_wait.InMillisecondsF(),
+                  site.max_hold.InMillisecondsF(),
+                  site.contended_acquisitions, site.acquisitions, site.locks);
+    if (site.line_number > 0) {
+      tracked_objects::Location location(site.function_name, site.file_name,
+                                         site.line_number,
+                                         site.program_counter);
+      StringAppendF(output, "%s[%d] ", site.file_name, site.line_number);
+      if (html)
+        location.WriteFunctionName(output);
+      else
+        output->append(site.function_name);
+    } else {
+      StringAppendF(output, "pc %p", site.program_counter);
+    }
+    output->append(newline);
+  }
+}
+
+}  // namespace
+
+LockProfiler::Site::Site()
+    : function_name(""),
+      file_name(""),
+      line_number(0),
+      program_counter(NULL),
+      locks(0),
+      acquisitions(0),
+      contended_acquisitions(0) {
+}
+
+// static
+bool LockProfiler::IsEnabled() {
+#if defined(ENABLE_LOCK_PROFILING)
+  return true;
+#else
+  return false;
+#endif
+}
+
+// static
+void LockProfiler::GetSites(std::vector<Site>* sites) {
+  sites->clear();
+#if defined(ENABLE_LOCK_PROFILING)
+  Registry* registry = g_registry.Pointer();
+  registry->lock.Lock();
+  SiteMap site_map = registry->destroyed_locks;
+  for (internal::ProfiledLockImpl* lock = registry->first; lock;
+       lock = lock->next_) {
+    AddCounts(*lock, registry->ticks_per_second,
+              &site_map[lock->constructed_at_]);
+  }
+  registry->lock.Unlock();
+
+  for (SiteMap::const_iterator it = site_map.begin(); it != site_map.end();
+       ++it) {
+    if (it->second.acquisitions)
+      sites->push_back(it->second);
+  }
+  std::sort(sites->begin(), sites->end(), &CompareSitesByWait);
+#endif
+}
+
+#if defined(ENABLE_LOCK_PROFILING)
+// static
+void LockProfiler::AddCounts(const internal::ProfiledLockImpl& lock,
+                             int64 ticks_per_second, Site* site) {
+  const tracked_objects::Location& location = lock.constructed_at_;
+  site->function_name = location.function_name();
+  site->file_name = location.file_name();
+  site->line_number = location.line_number();
+  site->program_counter = location.program_counter();
+  ++site->locks;
+  site->acquisitions += lock.acquisitions_;
+  site->contended_acquisitions += lock.contended_acquisitions_;
+  site->total_wait += TicksToTimeDelta(lock.total_wait_ticks_,
+                                       ticks_per_second);
+  site->max_hold = std::max(
+      site->max_hold, TicksToTimeDelta(lock.max_hold_ticks_, ticks_per_second));
+}
+#endif
+
+// static
+void LockProfiler::WriteHTML(std::string* output) {
+  output->append("<PRE>");
+  WriteSites("<br>", true, output);
+  output->append("</PRE>");
+}
+
+// static
+void LockProfiler::WriteAscii(std::string* output) {
+  WriteSites("\n", false, output);
+}
+
+#if defined(ENABLE_LOCK_PROFILING)
+namespace internal {
+
+int64 GetLockProfilerTicks() {
+#if defined(OS_WIN)
+  LARGE_INTEGER ticks;
+  QueryPerformanceCounter(&ticks);
+  return ticks.QuadPart;
+#elif defined(OS_POSIX)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64>(ts.tv_sec) * Time::kNanosecondsPerSecond +
+         ts.tv_nsec;
+#endif
+}
+
+ProfiledLockImpl::ProfiledLockImpl(
+    const tracked_objects::Location& constructed_at)
+    : constructed_at_(constructed_at),
+      acquisitions_(0),
+      contended_acquisitions_(0),
+      total_wait_ticks_(0),
+      max_hold_ticks_(0),
+      acquired_ticks_(0),
+      previous_(NULL),
+      next_(NULL) {
+  Registry* registry = g_registry.Pointer();
+  registry->lock.Lock();
+  next_ = registry->first;
+  if (next_)
+    next_->previous_ = this;
+  registry->first = this;
+  registry->lock.Unlock();
+}
+
+ProfiledLockImpl::~ProfiledLockImpl() {
+  Registry* registry = g_registry.Pointer();
+  registry->lock.Lock();
+  if (previous_)
+    previous_->next_ = next_;
+  else
+    registry->first = next_;
+  if (next_)
+    next_->previous_ = previous_;
+
+  LockProfiler::AddCounts(*this, registry->ticks_per_second,
+                          &registry->destroyed_locks[constructed_at_]);
+  registry->lock.Unlock();
+}
+
+}  // namespace internal
+#endif  // ENABLE_LOCK_PROFILING
+
+}  // namespace base
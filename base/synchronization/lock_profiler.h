@@ -0,0 +1,148 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_SYNCHRONIZATION_LOCK_PROFILER_H_
+#define BASE_SYNCHRONIZATION_LOCK_PROFILER_H_
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/location.h"
+#include "base/synchronization/lock_impl.h"
+#include "base/time.h"
+
+namespace base {
+
+namespace internal {
+class ProfiledLockImpl;
+}  // namespace internal
+
+// LockProfiler tells which base::Locks are contended, to find those worth
+// replacing by a ReadWriteLock, splitting, or holding for less time. It only
+// has something to tell in builds with ENABLE_LOCK_PROFILING (gyp's
+// enable_lock_profiling=1), where every Lock counts its acquisitions, how
+// many of them had to wait and for how long, and the longest it was held.
+//
+// The counts are those of where the locks were constructed: the Location
+// given to Lock(const tracked_objects::Location&), or else the caller of
+// Lock(), which is a constructor of the object that holds the lock, and is
+// reported by its program counter.
+class BASE_EXPORT LockProfiler {
+ public:
+  // The counts of the locks constructed at a site, both those that are alive
+  // and those that have been destroyed.
+  struct BASE_EXPORT Site {
+    Site();
+
+    // Where the locks were constructed. The names are empty, and the line 0,
+    // for the locks known by the program counter of their constructor only.
+    const char* function_name;
+    const char* file_name;
+    int line_number;
+    const void* program_counter;
+
+    int locks;
+    int64 acquisitions;
+    int64 contended_acquisitions;
+    TimeDelta total_wait;
+    TimeDelta max_hold;
+  };
+
+  // Whether the locks are profiled in this build.
+  static bool IsEnabled();
+
+  // Returns the sites that locks were acquired at, those that spent the most
+  // time waiting first. The counts of the locks that are alive aren't
+  // synchronized with, so they may be a little behind.
+  static void GetSites(std::vector<Site>* sites);
+
+  // Writes the sites as a table, in HTML or in ASCII.
+  static void WriteHTML(std::string* output);
+  static void WriteAscii(std::string* output);
+
+ private:
+#if defined(ENABLE_LOCK_PROFILING)
+  friend class internal::ProfiledLockImpl;
+
+  // Adds the counts of |lock| to those of |site|.
+  static void AddCounts(const internal::ProfiledLockImpl& lock,
+                        int64 ticks_per_second, Site* site);
+#endif
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(LockProfiler);
+};
+
+#if defined(ENABLE_LOCK_PROFILING)
+namespace internal {
+
+// The clock of the profiler, which doesn't take a Lock, as TimeTicks::Now()
+// does on Windows.
+BASE_EXPORT int64 GetLockProfilerTicks();
+
+// The LockImpl of a Lock in profiling builds, which counts what is done with
+// it. The counts are only changed with the lock held.
+class BASE_EXPORT ProfiledLockImpl {
+ public:
+  explicit ProfiledLockImpl(const tracked_objects::Location& constructed_at);
+  ~ProfiledLockImpl();
+
+  bool Try() {
+    if (!lock_.Try())
+      return false;
+    OnAcquired();
+    return true;
+  }
+
+  void Lock() {
+    if (!lock_.Try()) {
+      int64 wait_start = GetLockProfilerTicks();
+      lock_.Lock();
+      ++contended_acquisitions_;
+      total_wait_ticks_ += GetLockProfilerTicks() - wait_start;
+    }
+    OnAcquired();
+  }
+
+  void Unlock() {
+    int64 hold_ticks = GetLockProfilerTicks() - acquired_ticks_;
+    if (hold_ticks > max_hold_ticks_)
+      max_hold_ticks_ = hold_ticks;
+    lock_.Unlock();
+  }
+
+  LockImpl::OSLockType* os_lock() { return lock_.os_lock(); }
+
+ private:
+  friend class base::LockProfiler;
+
+  void OnAcquired() {
+    ++acquisitions_;
+    acquired_ticks_ = GetLockProfilerTicks();
+  }
+
+  LockImpl lock_;
+  const tracked_objects::Location constructed_at_;
+
+  int64 acquisitions_;
+  int64 contended_acquisitions_;
+  int64 total_wait_ticks_;
+  int64 max_hold_ticks_;
+  int64 acquired_ticks_;
+
+  // The list of the locks that are alive, which LockProfiler reads.
+  ProfiledLockImpl* previous_;
+  ProfiledLockImpl* next_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProfiledLockImpl);
+};
+
+}  // namespace internal
+#endif  // ENABLE_LOCK_PROFILING
+
+}  // namespace base
+
+#endif  // BASE_SYNCHRONIZATION_LOCK_PROFILER_H_
@@ -0,0 +1,99 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_SYNCHRONIZATION_READ_WRITE_LOCK_H_
+#define BASE_SYNCHRONIZATION_READ_WRITE_LOCK_H_
+#pragma once
+
+#include "build/build_config.h"
+
+#if defined(OS_WIN)
+#include <windows.h>
+#elif defined(OS_POSIX)
+#include <pthread.h>
+#endif
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/lock_impl.h"
+
+namespace base {
+
+#if defined(OS_WIN)
+namespace internal {
+struct SRWLockFunctions;
+}  // namespace internal
+#endif
+
+// A lock that any number of readers may hold at once, or a single writer, for
+// the structures that are read much more often than they are changed. On
+// Windows it is a SRWLOCK, which also makes it a cheaper lock than Lock, whose
+// CRITICAL_SECTION spins, when only WriteAcquire() is used. Before Vista,
+// which has no SRWLOCK, the readers take a CRITICAL_SECTION as the writers do.
+//
+// As with Lock, a thread may not acquire it again while holding it, not even
+// for reading: a writer waiting in between would block the thread.
+class BASE_EXPORT ReadWriteLock {
+ public:
+  ReadWriteLock();
+  ~ReadWriteLock();
+
+  void ReadAcquire();
+  void ReadRelease();
+
+  void WriteAcquire();
+  void WriteRelease();
+
+ private:
+#if defined(OS_WIN)
+  // The SRWLOCK functions of kernel32, which are looked up as they aren't
+  // on XP. NULL functions if they aren't there.
+  const internal::SRWLockFunctions* functions_;
+  SRWLOCK srw_lock_;
+
+  // The lock taken instead of |srw_lock_| when there is no SRWLOCK.
+  scoped_ptr<internal::LockImpl> fallback_lock_;
+#elif defined(OS_POSIX)
+  pthread_rwlock_t os_lock_;
+#endif
+
+  DISALLOW_COPY_AND_ASSIGN(ReadWriteLock);
+};
+
+// Holds the given ReadWriteLock for reading while in scope.
+class AutoReadLock {
+ public:
+  explicit AutoReadLock(ReadWriteLock& lock) : lock_(lock) {
+    lock_.ReadAcquire();
+  }
+
+  ~AutoReadLock() {
+    lock_.ReadRelease();
+  }
+
+ private:
+  ReadWriteLock& lock_;
+  DISALLOW_COPY_AND_ASSIGN(AutoReadLock);
+};
+
+// Holds the given ReadWriteLock for writing while in scope.
+class AutoWriteLock {
+ public:
+  explicit AutoWriteLock(ReadWriteLock& lock) : lock_(lock) {
+    lock_.WriteAcquire();
+  }
+
+  ~AutoWriteLock() {
+    lock_.WriteRelease();
+  }
+
+ private:
+  ReadWriteLock& lock_;
+  DISALLOW_COPY_AND_ASSIGN(AutoWriteLock);
+};
+
+}  // namespace base
+
+#endif  // BASE_SYNCHRONIZATION_READ_WRITE_LOCK_H_
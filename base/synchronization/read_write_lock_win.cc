@@ -0,0 +1,51 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/synchronization/read_write_lock.h"
+
+#include "base/synchronization/srw_lock_functions_win.h"
+
+namespace base {
+
+ReadWriteLock::ReadWriteLock()
+    : functions_(internal::GetSRWLockFunctions()) {
+  // InitializeSRWLock() just sets it to SRWLOCK_INIT.
+  srw_lock_.Ptr = NULL;
+  if (!functions_->available())
+    fallback_lock_.reset(new internal::LockImpl);
+}
+
+ReadWriteLock::~ReadWriteLock() {
+  // A SRWLOCK holds no resources.
+}
+
+void ReadWriteLock::ReadAcquire() {
+  if (fallback_lock_.get())
+    fallback_lock_->Lock();
+  else
+    functions_->acquire_shared(&srw_lock_);
+}
+
+void ReadWriteLock::ReadRelease() {
+  if (fallback_lock_.get())
+    fallback_lock_->Unlock();
+  else
+    functions_->release_shared(&srw_lock_);
+}
+
+void ReadWriteLock::WriteAcquire() {
+  if (fallback_lock_.get())
+    fallback_lock_->Lock();
+  else
+    functions_->acquire_exclusive(&srw_lock_);
+}
+
+void ReadWriteLock::WriteRelease() {
+  if (fallback_lock_.get())
+    fallback_lock_->Unlock();
+  else
+    functions_->release_exclusive(&srw_lock_);
+}
+
+}  // namespace base
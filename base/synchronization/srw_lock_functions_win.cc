@@ -0,0 +1,37 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/synchronization/srw_lock_functions_win.h"
+
+#include "base/lazy_instance.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+// Leaky, as locks may be used by the destructors of other statics.
+LazyInstance<SRWLockFunctions, LeakyLazyInstanceTraits<SRWLockFunctions> >
+    g_srw_lock_functions(LINKER_INITIALIZED);
+
+}  // namespace
+
+SRWLockFunctions::SRWLockFunctions() {
+  HMODULE kernel32 = ::GetModuleHandle(L"kernel32.dll");
+  acquire_shared = reinterpret_cast<SRWLockFunction>(
+      ::GetProcAddress(kernel32, "AcquireSRWLockShared"));
+  release_shared = reinterpret_cast<SRWLockFunction>(
+      ::GetProcAddress(kernel32, "ReleaseSRWLockShared"));
+  acquire_exclusive = reinterpret_cast<SRWLockFunction>(
+      ::GetProcAddress(kernel32, "AcquireSRWLockExclusive"));
+  release_exclusive = reinterpret_cast<SRWLockFunction>(
+      ::GetProcAddress(kernel32, "ReleaseSRWLockExclusive"));
+}
+
+const SRWLockFunctions* GetSRWLockFunctions() {
+  return g_srw_lock_functions.Pointer();
+}
+
+}  // namespace internal
+}  // namespace base
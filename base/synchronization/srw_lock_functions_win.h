@@ -0,0 +1,43 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_SYNCHRONIZATION_SRW_LOCK_FUNCTIONS_WIN_H_
+#define BASE_SYNCHRONIZATION_SRW_LOCK_FUNCTIONS_WIN_H_
+#pragma once
+
+#include <windows.h>
+
+#include "base/base_export.h"
+
+namespace base {
+namespace internal {
+
+// The slim reader/writer lock functions of kernel32, which are looked up as
+// they aren't on XP. An SRWLOCK needs no cleanup, and is initialized by
+// setting it to SRWLOCK_INIT, i.e. to NULL.
+struct SRWLockFunctions {
+  typedef VOID (WINAPI* SRWLockFunction)(PSRWLOCK lock);
+
+  SRWLockFunctions();
+
+  // Whether all the functions were found.
+  bool available() const {
+    return acquire_shared && release_shared && acquire_exclusive &&
+           release_exclusive;
+  }
+
+  SRWLockFunction acquire_shared;
+  SRWLockFunction release_shared;
+  SRWLockFunction acquire_exclusive;
+  SRWLockFunction release_exclusive;
+};
+
+// Returns the functions, which are looked up once for the process. May be
+// called before main() and from the destructors of statics.
+BASE_EXPORT const SRWLockFunctions* GetSRWLockFunctions();
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_SYNCHRONIZATION_SRW_LOCK_FUNCTIONS_WIN_H_
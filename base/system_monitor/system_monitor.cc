@@ -5,6 +5,7 @@
 #include "base/system_monitor/system_monitor.h"
 
 #include "base/logging.h"
+#include "base/memory/purgeable_cache.h"
 #include "base/message_loop.h"
 #include "base/time.h"
 
@@ -18,10 +19,18 @@ static SystemMonitor* g_system_monitor = NULL;
 static int kDelayedBatteryCheckMs = 10 * 1000;
 #endif  // defined(ENABLE_BATTERY_MONITORING)
 
+#if defined(ENABLE_MEMORY_PRESSURE_MONITORING)
+// The amount of time (in ms) between the memory pressure checks.
+static int kMemoryPressureCheckMs = 5 * 1000;
+#endif  // defined(ENABLE_MEMORY_PRESSURE_MONITORING)
+
 SystemMonitor::SystemMonitor()
     : observer_list_(new ObserverListThreadSafe<PowerObserver>()),
+      memory_pressure_observer_list_(
+          new ObserverListThreadSafe<MemoryPressureObserver>()),
       battery_in_use_(false),
-      suspended_(false) {
+      suspended_(false),
+      memory_pressure_level_(MEMORY_PRESSURE_NONE) {
   DCHECK(!g_system_monitor);
   g_system_monitor = this;
 
@@ -31,6 +40,14 @@ SystemMonitor::SystemMonitor()
       base::TimeDelta::FromMilliseconds(kDelayedBatteryCheckMs), this,
       &SystemMonitor::BatteryCheck);
 #endif  // defined(ENABLE_BATTERY_MONITORING)
+#if defined(ENABLE_MEMORY_PRESSURE_MONITORING)
+  MemoryPressureInit();
+  memory_pressure_timer_.set_tolerance(
+      base::TimeDelta::FromMilliseconds(kMemoryPressureCheckMs / 5));
+  memory_pressure_timer_.Start(FROM_HERE,
+      base::TimeDelta::FromMilliseconds(kMemoryPressureCheckMs), this,
+      &SystemMonitor::MemoryPressureCheck);
+#endif  // defined(ENABLE_MEMORY_PRESSURE_MONITORING)
 #if defined(OS_MACOSX)
   PlatformInit();
 #endif
@@ -39,9 +56,13 @@ SystemMonitor::SystemMonitor()
 SystemMonitor::~SystemMonitor() {
 #if defined(OS_MACOSX)
   PlatformDestroy();
+#endif
+#if defined(ENABLE_MEMORY_PRESSURE_MONITORING)
+  MemoryPressureDestroy();
 #endif
   DCHECK_EQ(this, g_system_monitor);
   g_system_monitor = NULL;
+  MessageLoop::EnableTimerCoalescing(false);
 }
 
 // static
@@ -77,6 +98,21 @@ void SystemMonitor::ProcessPowerMessage(PowerEvent event_id) {
   }
 }
 
+void SystemMonitor::ProcessMemoryPressure(MemoryPressureLevel level) {
+  MemoryPressureLevel old_level = memory_pressure_level();
+  if (level == old_level)
+    return;
+  bool rising = level > old_level;
+  base::subtle::NoBarrier_Store(&memory_pressure_level_, level);
+  VLOG(1) << "MemoryPressure: " << level;
+  // The caches are purged once per rise, rather than at every check, since
+  // what they keep after a purge is what they need.
+  if (rising)
+    PurgeableCache::PurgeAll(level);
+  memory_pressure_observer_list_->Notify(
+      &MemoryPressureObserver::OnMemoryPressure, level);
+}
+
 void SystemMonitor::AddObserver(PowerObserver* obs) {
   observer_list_->AddObserver(obs);
 }
@@ -85,9 +121,20 @@ void SystemMonitor::RemoveObserver(PowerObserver* obs) {
   observer_list_->RemoveObserver(obs);
 }
 
+void SystemMonitor::AddMemoryPressureObserver(MemoryPressureObserver* obs) {
+  memory_pressure_observer_list_->AddObserver(obs);
+}
+
+void SystemMonitor::RemoveMemoryPressureObserver(
+    MemoryPressureObserver* obs) {
+  memory_pressure_observer_list_->RemoveObserver(obs);
+}
+
 void SystemMonitor::NotifyPowerStateChange() {
   VLOG(1) << "PowerStateChange: " << (BatteryPower() ? "On" : "Off")
           << " battery";
+  // On battery power, every wakeup saved counts.
+  MessageLoop::EnableTimerCoalescing(BatteryPower());
   observer_list_->Notify(&PowerObserver::OnPowerStateChange, BatteryPower());
 }
 
@@ -105,4 +152,10 @@ void SystemMonitor::BatteryCheck() {
   ProcessPowerMessage(SystemMonitor::POWER_STATE_EVENT);
 }
 
+#if defined(ENABLE_MEMORY_PRESSURE_MONITORING)
+void SystemMonitor::MemoryPressureCheck() {
+  ProcessMemoryPressure(GetMemoryPressure());
+}
+#endif  // defined(ENABLE_MEMORY_PRESSURE_MONITORING)
+
 }  // namespace base
@@ -6,6 +6,7 @@
 #define BASE_SYSTEM_MONITOR_SYSTEM_MONITOR_H_
 #pragma once
 
+#include "base/atomicops.h"
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "build/build_config.h"
@@ -18,10 +19,18 @@
 #undef ENABLE_BATTERY_MONITORING
 #endif  // !OS_WIN
 
+// Windows is polled for memory pressure. Other platforms don't report it yet.
+#if defined(OS_WIN)
+#define ENABLE_MEMORY_PRESSURE_MONITORING 1
+#else
+#undef ENABLE_MEMORY_PRESSURE_MONITORING
+#endif  // !OS_WIN
+
 #include "base/observer_list_threadsafe.h"
-#if defined(ENABLE_BATTERY_MONITORING)
+#if defined(ENABLE_BATTERY_MONITORING) || \
+    defined(ENABLE_MEMORY_PRESSURE_MONITORING)
 #include "base/timer.h"
-#endif  // defined(ENABLE_BATTERY_MONITORING)
+#endif
 
 #if defined(OS_MACOSX)
 #include <IOKit/pwr_mgt/IOPMLib.h>
@@ -42,6 +51,15 @@ class BASE_EXPORT SystemMonitor {
     RESUME_EVENT        // The system is being resumed.
   };
 
+  // How short the system is of physical memory, from least to most.
+  enum MemoryPressureLevel {
+    MEMORY_PRESSURE_NONE,
+    // Paging is likely: the caches should shrink to what they need most.
+    MEMORY_PRESSURE_MODERATE,
+    // The system is paging: the caches should free all that can be rebuilt.
+    MEMORY_PRESSURE_CRITICAL
+  };
+
   // Create SystemMonitor. Only one SystemMonitor instance per application
   // is allowed.
   SystemMonitor();
@@ -110,6 +128,40 @@ class BASE_EXPORT SystemMonitor {
   // Cross-platform handling of a power event.
   void ProcessPowerMessage(PowerEvent event_id);
 
+  //
+  // Memory-related APIs
+  //
+
+  // The memory pressure as of the last check.
+  // Can be called on any thread.
+  MemoryPressureLevel memory_pressure_level() const {
+    return static_cast<MemoryPressureLevel>(
+        base::subtle::NoBarrier_Load(&memory_pressure_level_));
+  }
+
+  // Called on the thread which creates the SystemMonitor, as for
+  // PowerObserver. The caches that can be purged from any thread should
+  // rather register with base::PurgeableCache, which the SystemMonitor purges
+  // when the pressure rises.
+  class BASE_EXPORT MemoryPressureObserver {
+   public:
+    // Notification of a change of the memory pressure.
+    virtual void OnMemoryPressure(MemoryPressureLevel level) = 0;
+
+   protected:
+    virtual ~MemoryPressureObserver() {}
+  };
+
+  // Add or remove a memory pressure observer, as for AddObserver() and
+  // RemoveObserver().
+  void AddMemoryPressureObserver(MemoryPressureObserver* obs);
+  void RemoveMemoryPressureObserver(MemoryPressureObserver* obs);
+
+  // Cross-platform handling of a memory pressure check. Purges the
+  // PurgeableCaches when |level| is higher than the last one, and notifies
+  // the observers when it changed.
+  void ProcessMemoryPressure(MemoryPressureLevel level);
+
  private:
 #if defined(OS_MACOSX)
   void PlatformInit();
@@ -125,19 +177,42 @@ class BASE_EXPORT SystemMonitor {
   // status has changed.
   void BatteryCheck();
 
+#if defined(ENABLE_MEMORY_PRESSURE_MONITORING)
+  // Platform-specific methods to set up and tear down the memory pressure
+  // checks, and to return the current memory pressure.
+  void MemoryPressureInit();
+  void MemoryPressureDestroy();
+  MemoryPressureLevel GetMemoryPressure();
+
+  // Checks the memory pressure and notifies observers if it has changed.
+  void MemoryPressureCheck();
+#endif
+
   // Functions to trigger notifications.
   void NotifyPowerStateChange();
   void NotifySuspend();
   void NotifyResume();
 
   scoped_refptr<ObserverListThreadSafe<PowerObserver> > observer_list_;
+  scoped_refptr<ObserverListThreadSafe<MemoryPressureObserver> >
+      memory_pressure_observer_list_;
   bool battery_in_use_;
   bool suspended_;
+  // A MemoryPressureLevel, which other threads read.
+  base::subtle::Atomic32 memory_pressure_level_;
 
 #if defined(ENABLE_BATTERY_MONITORING)
   base::OneShotTimer<SystemMonitor> delayed_battery_check_;
 #endif
 
+#if defined(ENABLE_MEMORY_PRESSURE_MONITORING)
+  base::RepeatingTimer<SystemMonitor> memory_pressure_timer_;
+#if defined(OS_WIN)
+  // Signaled by the system while physical memory is low.
+  HANDLE low_memory_notification_;
+#endif
+#endif
+
   DISALLOW_COPY_AND_ASSIGN(SystemMonitor);
 };
 
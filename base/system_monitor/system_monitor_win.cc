@@ -4,8 +4,21 @@
 
 #include "base/system_monitor/system_monitor.h"
 
+#include "base/logging.h"
+
 namespace base {
 
+namespace {
+
+// The available physical memory, in percent of the total, below which the
+// pressure is moderate or critical. The system's low memory notification
+// also reports critical pressure; it is signaled at about 32MB per 4GB of
+// physical memory, which is late for the caches to help.
+const DWORDLONG kModeratePressureAvailablePercent = 15;
+const DWORDLONG kCriticalPressureAvailablePercent = 5;
+
+}  // namespace
+
 void SystemMonitor::ProcessWmPowerBroadcastMessage(int event_id) {
   PowerEvent power_event;
   switch (event_id) {
@@ -47,4 +60,38 @@ bool SystemMonitor::IsBatteryPower() {
   return (status.ACLineStatus == 0);
 }
 
+void SystemMonitor::MemoryPressureInit() {
+  low_memory_notification_ =
+      CreateMemoryResourceNotification(LowMemoryResourceNotification);
+  if (!low_memory_notification_)
+    LOG(ERROR) << "CreateMemoryResourceNotification failed: "
+               << GetLastError();
+}
+
+void SystemMonitor::MemoryPressureDestroy() {
+  if (low_memory_notification_)
+    CloseHandle(low_memory_notification_);
+}
+
+SystemMonitor::MemoryPressureLevel SystemMonitor::GetMemoryPressure() {
+  BOOL low_memory = FALSE;
+  if (low_memory_notification_ &&
+      QueryMemoryResourceNotification(low_memory_notification_,
+                                      &low_memory) &&
+      low_memory)
+    return MEMORY_PRESSURE_CRITICAL;
+
+  MEMORYSTATUSEX status;
+  status.dwLength = sizeof(status);
+  if (!GlobalMemoryStatusEx(&status) || !status.ullTotalPhys)
+    return MEMORY_PRESSURE_NONE;
+  DWORDLONG available_percent =
+      status.ullAvailPhys * 100 / status.ullTotalPhys;
+  if (available_percent < kCriticalPressureAvailablePercent)
+    return MEMORY_PRESSURE_CRITICAL;
+  if (available_percent < kModeratePressureAvailablePercent)
+    return MEMORY_PRESSURE_MODERATE;
+  return MEMORY_PRESSURE_NONE;
+}
+
 }  // namespace base
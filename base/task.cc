@@ -4,12 +4,24 @@
 
 #include "base/task.h"
 
+#include "base/memory/task_allocator.h"
+
 Task::Task() {
 }
 
 Task::~Task() {
 }
 
+// static
+void* Task::operator new(size_t size) {
+  return base::TaskAllocator::Allocate(size);
+}
+
+// static
+void Task::operator delete(void* task, size_t size) {
+  base::TaskAllocator::Free(task, size);
+}
+
 CancelableTask::CancelableTask() {
 }
 
@@ -58,6 +70,16 @@ void TaskClosureAdapter::Run() {
   task_ = NULL;
 }
 
+// static
+void* TaskClosureAdapter::operator new(size_t size) {
+  return TaskAllocator::Allocate(size);
+}
+
+// static
+void TaskClosureAdapter::operator delete(void* adapter, size_t size) {
+  TaskAllocator::Free(adapter, size);
+}
+
 // Don't leak tasks by default.
 bool TaskClosureAdapter::kTaskLeakingDefault = false;
 
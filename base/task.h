@@ -28,6 +28,10 @@ class BASE_EXPORT Task {
 
   // Tasks are automatically deleted after Run is called.
   virtual void Run() = 0;
+
+  // Tasks are allocated by base::TaskAllocator.
+  static void* operator new(size_t size);
+  static void operator delete(void* task, size_t size);
 };
 
 class BASE_EXPORT CancelableTask : public Task {
@@ -592,6 +596,10 @@ class TaskClosureAdapter : public RefCounted<TaskClosureAdapter> {
 
   void Run();
 
+  // Allocated by base::TaskAllocator, like the Task it runs.
+  static void* operator new(size_t size);
+  static void operator delete(void* adapter, size_t size);
+
  private:
   friend class base::RefCounted<TaskClosureAdapter>;
 
@@ -0,0 +1,119 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/threading/parallel_chunks.h"
+
+#include <algorithm>
+
+#include "base/atomicops.h"
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/worker_pool.h"
+
+namespace base {
+
+namespace {
+
+// The chunks of one RunParallelChunks() or PostParallelChunks() call. Every
+// thread running them holds a reference, so the object outlives the last
+// one to finish, even after the caller of RunParallelChunks() returned.
+class ParallelChunks : public RefCountedThreadSafe<ParallelChunks> {
+ public:
+  ParallelChunks(int num_chunks,
+                 const Callback<void(int)>& chunk_callback,
+                 const Closure& done_callback)
+      : num_chunks_(num_chunks),
+        chunk_callback_(chunk_callback),
+        done_callback_(done_callback),
+        next_chunk_(0),
+        chunks_done_(0),
+        done_(true, false) {
+  }
+
+  // Posts |num_threads| tasks that run chunks to the worker pool.
+  void PostWorkers(int num_threads) {
+    for (int i = 0; i < num_threads; ++i) {
+      WorkerPool::PostTask(
+          FROM_HERE, Bind(&ParallelChunks::RunChunks, this), false);
+    }
+  }
+
+  // Runs chunks until there are none left.
+  void RunChunks() {
+    for (;;) {
+      int chunk = subtle::NoBarrier_AtomicIncrement(&next_chunk_, 1) - 1;
+      if (chunk >= num_chunks_)
+        return;
+      chunk_callback_.Run(chunk);
+      // The barrier publishes this chunk's writes to the thread that sees
+      // the last one done.
+      if (subtle::Barrier_AtomicIncrement(&chunks_done_, 1) == num_chunks_)
+        Finish();
+    }
+  }
+
+  void Wait() {
+    done_.Wait();
+  }
+
+ private:
+  friend class RefCountedThreadSafe<ParallelChunks>;
+
+  ~ParallelChunks() {}
+
+  void Finish() {
+    if (!done_callback_.is_null())
+      done_callback_.Run();
+    done_.Signal();
+  }
+
+  const int num_chunks_;
+  const Callback<void(int)> chunk_callback_;
+  const Closure done_callback_;
+
+  // The next chunk to run, and the number of chunks done.
+  subtle::Atomic32 next_chunk_;
+  subtle::Atomic32 chunks_done_;
+
+  // Signaled when the last chunk is done.
+  WaitableEvent done_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelChunks);
+};
+
+int GetNumberOfThreads(int num_chunks) {
+  return std::min(WorkerPool::GetNumberOfCpuWorkers(), num_chunks);
+}
+
+}  // namespace
+
+void RunParallelChunks(int num_chunks,
+                       const Callback<void(int)>& chunk_callback) {
+  DCHECK_GE(num_chunks, 0);
+  if (num_chunks == 0)
+    return;
+  scoped_refptr<ParallelChunks> chunks(
+      new ParallelChunks(num_chunks, chunk_callback, Closure()));
+  chunks->PostWorkers(GetNumberOfThreads(num_chunks) - 1);
+  chunks->RunChunks();
+  chunks->Wait();
+}
+
+void PostParallelChunks(int num_chunks,
+                        const Callback<void(int)>& chunk_callback,
+                        const Closure& done_callback) {
+  DCHECK_GE(num_chunks, 0);
+  if (num_chunks == 0) {
+    done_callback.Run();
+    return;
+  }
+  scoped_refptr<ParallelChunks> chunks(
+      new ParallelChunks(num_chunks, chunk_callback, done_callback));
+  chunks->PostWorkers(std::max(GetNumberOfThreads(num_chunks), 1));
+}
+
+}  // namespace base
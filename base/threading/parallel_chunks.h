@@ -0,0 +1,36 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_THREADING_PARALLEL_CHUNKS_H_
+#define BASE_THREADING_PARALLEL_CHUNKS_H_
+#pragma once
+
+#include "base/base_export.h"
+#include "base/callback.h"
+
+namespace base {
+
+// Runs |chunk_callback| once with each index in [0, |num_chunks|). The
+// chunks are handed out to whichever thread asks first: the calling thread
+// and up to WorkerPool::GetNumberOfCpuWorkers() - 1 base::WorkerPool
+// threads. Returns once every chunk is done, and their writes are then
+// visible to the caller.
+//
+// Typical usage:
+//   base::RunParallelChunks(num_bands,
+//                           base::Bind(&Resizer::ResizeBand, resizer));
+BASE_EXPORT void RunParallelChunks(int num_chunks,
+                                   const Callback<void(int)>& chunk_callback);
+
+// Like RunParallelChunks(), but runs the chunks only on base::WorkerPool
+// threads and returns immediately. |done_callback| runs on the thread that
+// finishes the last chunk, which sees the writes of all of them, or on the
+// calling thread before returning if |num_chunks| is 0.
+BASE_EXPORT void PostParallelChunks(int num_chunks,
+                                    const Callback<void(int)>& chunk_callback,
+                                    const Closure& done_callback);
+
+}  // namespace base
+
+#endif  // BASE_THREADING_PARALLEL_CHUNKS_H_
@@ -51,7 +51,14 @@ const PlatformThreadId kInvalidThreadId = 0;
 enum ThreadPriority{
   kThreadPriority_Normal,
   // Suitable for low-latency, glitch-resistant audio.
-  kThreadPriority_RealtimeAudio
+  kThreadPriority_RealtimeAudio,
+  // Suitable for threads which produce frames for the display, above the
+  // normal threads but below audio.
+  kThreadPriority_Display,
+  // Suitable for work the user isn't waiting on, such as decoding ahead. On
+  // Windows Vista and later this also lowers the thread's I/O and memory
+  // priorities, which only works on the current thread.
+  kThreadPriority_Background
 };
 
 // A namespace for low-level thread functions.
@@ -68,6 +75,11 @@ class BASE_EXPORT PlatformThread {
   // Gets the current thread id, which may be useful for logging purposes.
   static PlatformThreadId CurrentId();
 
+  // Gets a handle to the current thread, to pass to SetThreadPriority() and
+  // SetThreadAffinity(). On Windows it is a pseudo handle, which only refers
+  // to the current thread and needn't be closed.
+  static PlatformThreadHandle CurrentHandle();
+
   // Yield the current thread so another thread can be scheduled.
   static void YieldCurrentThread();
 
@@ -103,9 +115,17 @@ class BASE_EXPORT PlatformThread {
   // |thread_handle|.
   static void Join(PlatformThreadHandle thread_handle);
 
+  // Sets the priority of the thread. kThreadPriority_Background only applies
+  // its I/O and memory priorities when |handle| is CurrentHandle().
   static void SetThreadPriority(PlatformThreadHandle handle,
                                 ThreadPriority priority);
 
+  // Restricts the thread to the processors whose bits are set in
+  // |affinity_mask|, which must include one the process may run on. Returns
+  // false if the mask was not applied.
+  static bool SetThreadAffinity(PlatformThreadHandle handle,
+                                uint64 affinity_mask);
+
  private:
   DISALLOW_IMPLICIT_CONSTRUCTORS(PlatformThread);
 };
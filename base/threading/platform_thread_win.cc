@@ -87,6 +87,11 @@ PlatformThreadId PlatformThread::CurrentId() {
   return GetCurrentThreadId();
 }
 
+// static
+PlatformThreadHandle PlatformThread::CurrentHandle() {
+  return ::GetCurrentThread();
+}
+
 // static
 void PlatformThread::YieldCurrentThread() {
   ::Sleep(0);
@@ -157,9 +162,54 @@ void PlatformThread::Join(PlatformThreadHandle thread_handle) {
 }
 
 // static
-void PlatformThread::SetThreadPriority(PlatformThreadHandle, ThreadPriority) {
-  // TODO(crogers): implement
-  NOTIMPLEMENTED();
+void PlatformThread::SetThreadPriority(PlatformThreadHandle handle,
+                                       ThreadPriority priority) {
+  DCHECK(handle);
+  // Background mode lowers the I/O and memory priorities along with the
+  // scheduling one, but Windows only lets a thread enter it itself.
+  bool use_background_mode = handle == ::GetCurrentThread() &&
+      base::win::GetVersion() >= base::win::VERSION_VISTA;
+
+  int win_priority;
+  switch (priority) {
+    case kThreadPriority_RealtimeAudio:
+      win_priority = THREAD_PRIORITY_TIME_CRITICAL;
+      break;
+    case kThreadPriority_Display:
+      win_priority = THREAD_PRIORITY_ABOVE_NORMAL;
+      break;
+    case kThreadPriority_Background:
+      win_priority = use_background_mode ? THREAD_MODE_BACKGROUND_BEGIN :
+                                           THREAD_PRIORITY_LOWEST;
+      break;
+    default:
+      win_priority = THREAD_PRIORITY_NORMAL;
+      break;
+  }
+
+  // Leaving background mode restores the priority the thread had before it.
+  // This fails, harmlessly, if the thread wasn't in background mode.
+  if (use_background_mode && priority != kThreadPriority_Background)
+    ::SetThreadPriority(handle, THREAD_MODE_BACKGROUND_END);
+
+  if (!::SetThreadPriority(handle, win_priority))
+    DPLOG(ERROR) << "Failed to set the thread priority to " << priority;
+}
+
+// static
+bool PlatformThread::SetThreadAffinity(PlatformThreadHandle handle,
+                                       uint64 affinity_mask) {
+  DCHECK(handle);
+  DWORD_PTR win_mask = static_cast<DWORD_PTR>(affinity_mask);
+  if (!win_mask || win_mask != affinity_mask) {
+    DLOG(ERROR) << "Processor mask " << affinity_mask << " is out of range";
+    return false;
+  }
+  if (!::SetThreadAffinityMask(handle, win_mask)) {
+    DPLOG(ERROR) << "Failed to set the thread affinity to " << affinity_mask;
+    return false;
+  }
+  return true;
 }
 
 }  // namespace base
@@ -152,6 +152,16 @@ void Thread::ThreadMain() {
     message_loop.set_thread_name(name_);
     message_loop_ = &message_loop;
 
+    const Options& options = startup_data_->options;
+    if (options.priority != kThreadPriority_Normal) {
+      PlatformThread::SetThreadPriority(PlatformThread::CurrentHandle(),
+                                        options.priority);
+    }
+    if (options.affinity_mask) {
+      PlatformThread::SetThreadAffinity(PlatformThread::CurrentHandle(),
+                                        options.affinity_mask);
+    }
+
     // Let the thread do extra initialization.
     // Let's do this before signaling we are started.
     Init();
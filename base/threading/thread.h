@@ -29,9 +29,16 @@ namespace base {
 class BASE_EXPORT Thread : PlatformThread::Delegate {
  public:
   struct Options {
-    Options() : message_loop_type(MessageLoop::TYPE_DEFAULT), stack_size(0) {}
+    Options()
+        : message_loop_type(MessageLoop::TYPE_DEFAULT),
+          stack_size(0),
+          priority(kThreadPriority_Normal),
+          affinity_mask(0) {}
     Options(MessageLoop::Type type, size_t size)
-        : message_loop_type(type), stack_size(size) {}
+        : message_loop_type(type),
+          stack_size(size),
+          priority(kThreadPriority_Normal),
+          affinity_mask(0) {}
 
     // Specifies the type of message loop that will be allocated on the thread.
     MessageLoop::Type message_loop_type;
@@ -40,6 +47,15 @@ class BASE_EXPORT Thread : PlatformThread::Delegate {
     // This does not necessarily correspond to the thread's initial stack size.
     // A value of 0 indicates that the default maximum should be used.
     size_t stack_size;
+
+    // Specifies the priority the thread runs at. It is set by the thread
+    // itself before Init(), which kThreadPriority_Background needs.
+    ThreadPriority priority;
+
+    // Specifies the processors the thread may run on, one bit each, as for
+    // PlatformThread::SetThreadAffinity(). A value of 0 leaves the thread on
+    // those of the process.
+    uint64 affinity_mask;
   };
 
   // Constructor.
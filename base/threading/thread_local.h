@@ -51,11 +51,23 @@
 
 #include "base/base_export.h"
 #include "base/basictypes.h"
+#include "build/build_config.h"
 
 #if defined(OS_POSIX)
 #include <pthread.h>
 #endif
 
+// BASE_COMPILER_THREAD_LOCAL declares a variable in the compiler's thread local
+// storage, which is read in a couple of instructions rather than by calling
+// TlsGetValue(), for the pointers that are read on every task, such as
+// MessageLoop::current(). XP gives no such storage to a DLL that is loaded by
+// LoadLibrary(), so the variable is only to be used if
+// CompilerThreadLocalIsUsable(), with a ThreadLocalPointer to fall back to.
+// The variable must be a POD, initialized with a constant.
+#if defined(COMPILER_MSVC)
+#define BASE_COMPILER_THREAD_LOCAL __declspec(thread)
+#endif
+
 namespace base {
 
 namespace internal {
@@ -76,6 +88,12 @@ struct BASE_EXPORT ThreadLocalPlatform {
 
 }  // namespace internal
 
+#if defined(BASE_COMPILER_THREAD_LOCAL)
+// Whether the BASE_COMPILER_THREAD_LOCAL variables work in this process, which
+// they always do after XP.
+BASE_EXPORT bool CompilerThreadLocalIsUsable();
+#endif
+
 template <typename Type>
 class ThreadLocalPointer {
  public:
@@ -39,4 +39,16 @@ void ThreadLocalPlatform::SetValueInSlot(SlotType& slot, void* value) {
 
 }  // namespace internal
 
+bool CompilerThreadLocalIsUsable() {
+  // 1 or 0 once it is known, which threads racing to find out agree on.
+  static int usable = -1;
+  if (usable < 0) {
+    // Not base::win::GetVersion(), whose Singleton is more than this is worth.
+    OSVERSIONINFO version_info = { sizeof(version_info) };
+    GetVersionEx(&version_info);
+    usable = version_info.dwMajorVersion >= 6 ? 1 : 0;
+  }
+  return usable == 1;
+}
+
 }  // namespace base
@@ -0,0 +1,254 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/threading/work_stealing_thread_pool.h"
+
+#include "base/bind.h"
+#include "base/debug/alias.h"
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/stringprintf.h"
+#include "base/sys_info.h"
+#include "base/task.h"
+#include "base/threading/thread_local.h"
+#include "base/tracked_objects.h"
+
+namespace base {
+
+namespace {
+
+// Identifies the pool worker running on the current thread.
+struct CurrentWorker {
+  const WorkStealingThreadPool* pool;
+  int index;
+};
+
+// Leaky, as the workers of a pool that is never shut down may still read it
+// at exit.
+LazyInstance<ThreadLocalPointer<CurrentWorker>,
+             LeakyLazyInstanceTraits<ThreadLocalPointer<CurrentWorker> > >
+    lazy_tls_worker(LINKER_INITIALIZED);
+
+}  // namespace
+
+class WorkStealingThreadPool::Worker : public PlatformThread::Delegate {
+ public:
+  Worker(WorkStealingThreadPool* pool, int index)
+      : pool_(pool),
+        index_(index),
+        name_(StringPrintf("%s/%d", pool->name_prefix_.c_str(), index)),
+        handle_(kNullThreadHandle) {
+  }
+
+  bool Start() {
+    return PlatformThread::Create(0, this, &handle_);
+  }
+
+  void Join() {
+    if (handle_ == kNullThreadHandle)
+      return;
+    PlatformThread::Join(handle_);
+    handle_ = kNullThreadHandle;
+  }
+
+  // PlatformThread::Delegate implementation.
+  virtual void ThreadMain();
+
+ private:
+  WorkStealingThreadPool* pool_;
+  const int index_;
+  const std::string name_;
+  PlatformThreadHandle handle_;
+
+  DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
+void WorkStealingThreadPool::Worker::ThreadMain() {
+  PlatformThread::SetName(name_.c_str());
+  CurrentWorker current = { pool_, index_ };
+  lazy_tls_worker.Pointer()->Set(&current);
+  pool_->WorkerMain(index_);
+  lazy_tls_worker.Pointer()->Set(NULL);
+}
+
+WorkStealingThreadPool::PendingWork::PendingWork(
+    const Closure& task,
+    const tracked_objects::Location& posted_from)
+    : task(task),
+      birth_program_counter(posted_from.program_counter()) {
+}
+
+WorkStealingThreadPool::PendingWork::~PendingWork() {
+}
+
+WorkStealingThreadPool::WorkStealingThreadPool(const std::string& name_prefix,
+                                               int num_threads)
+    : name_prefix_(name_prefix),
+      num_threads_(num_threads > 0 ? num_threads :
+                                     SysInfo::NumberOfProcessors()),
+      deques_(num_threads_),
+      pending_count_(0),
+      next_worker_(0),
+      steal_count_(0),
+      work_available_(false, false),
+      shutdown_event_(true, false),
+      shutting_down_(0),
+      started_(false) {
+  DCHECK_GT(num_threads_, 0);
+  for (int i = 0; i < num_threads_; ++i) {
+    workers_.push_back(new Worker(this, i));
+    deque_locks_.push_back(new Lock());
+  }
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+  Shutdown();
+  for (int i = 0; i < num_threads_; ++i) {
+    delete workers_[i];
+    delete deque_locks_[i];
+  }
+}
+
+bool WorkStealingThreadPool::Start() {
+  DCHECK(!started_);
+  started_ = true;
+  bool all_started = true;
+  for (int i = 0; i < num_threads_; ++i) {
+    if (!workers_[i]->Start()) {
+      DLOG(ERROR) << "Failed to start worker " << i << " of " << name_prefix_;
+      all_started = false;
+    }
+  }
+  return all_started;
+}
+
+void WorkStealingThreadPool::Shutdown() {
+  DCHECK(!RunsTasksOnCurrentThread());
+  // The flag is set with every deque locked, so that each PostTask() either
+  // queued its work before, and the work is run, or sees the flag.
+  for (int i = 0; i < num_threads_; ++i)
+    deque_locks_[i]->Acquire();
+  bool was_shutting_down =
+      subtle::NoBarrier_AtomicExchange(&shutting_down_, 1) != 0;
+  for (int i = num_threads_ - 1; i >= 0; --i)
+    deque_locks_[i]->Release();
+  if (was_shutting_down)
+    return;
+  shutdown_event_.Signal();
+  for (int i = 0; i < num_threads_; ++i)
+    workers_[i]->Join();
+
+  // If the pool was never started, or some workers failed to start, drop
+  // whatever is left without running it.
+  for (int i = 0; i < num_threads_; ++i) {
+    AutoLock lock(*deque_locks_[i]);
+    deques_[i].clear();
+  }
+}
+
+bool WorkStealingThreadPool::PostTask(
+    const tracked_objects::Location& from_here,
+    const Closure& task) {
+  DCHECK(!task.is_null());
+  if (subtle::Acquire_Load(&shutting_down_))
+    return false;
+
+  int index = CurrentWorkerIndex();
+  if (index < 0) {
+    index = subtle::NoBarrier_AtomicIncrement(&next_worker_, 1) %
+        num_threads_;
+    if (index < 0)
+      index += num_threads_;
+  }
+  return Enqueue(index, PendingWork(task, from_here));
+}
+
+bool WorkStealingThreadPool::PostTask(
+    const tracked_objects::Location& from_here,
+    Task* task) {
+  CHECK(task);
+  return PostTask(from_here,
+                  Bind(&subtle::TaskClosureAdapter::Run,
+                       new subtle::TaskClosureAdapter(task)));
+}
+
+bool WorkStealingThreadPool::RunsTasksOnCurrentThread() const {
+  return CurrentWorkerIndex() >= 0;
+}
+
+bool WorkStealingThreadPool::Enqueue(int index, const PendingWork& work) {
+  {
+    AutoLock lock(*deque_locks_[index]);
+    // Shutdown() sets the flag under all the deque locks.
+    if (subtle::NoBarrier_Load(&shutting_down_))
+      return false;
+    deques_[index].push_back(work);
+  }
+  subtle::Barrier_AtomicIncrement(&pending_count_, 1);
+  work_available_.Signal();
+  return true;
+}
+
+bool WorkStealingThreadPool::GetWork(int index, PendingWork* work) {
+  bool found = false;
+  {
+    AutoLock lock(*deque_locks_[index]);
+    if (!deques_[index].empty()) {
+      *work = deques_[index].back();
+      deques_[index].pop_back();
+      found = true;
+    }
+  }
+
+  for (int i = 1; !found && i < num_threads_; ++i) {
+    int victim = (index + i) % num_threads_;
+    AutoLock lock(*deque_locks_[victim]);
+    if (!deques_[victim].empty()) {
+      *work = deques_[victim].front();
+      deques_[victim].pop_front();
+      found = true;
+      subtle::NoBarrier_AtomicIncrement(&steal_count_, 1);
+    }
+  }
+
+  if (!found)
+    return false;
+
+  // If more work is waiting, hand the wakeup on to another idle worker.
+  if (subtle::Barrier_AtomicIncrement(&pending_count_, -1) > 0)
+    work_available_.Signal();
+  return true;
+}
+
+void WorkStealingThreadPool::WorkerMain(int index) {
+  WaitableEvent* events[] = { &work_available_, &shutdown_event_ };
+  PendingWork work((Closure()), tracked_objects::Location());
+  for (;;) {
+    // Read before looking for work: once the flag is set nothing more is
+    // queued, so if the deques are empty then, the worker is done.
+    bool shutting_down = subtle::Acquire_Load(&shutting_down_) != 0;
+    if (GetWork(index, &work)) {
+      // Keep the posting site on the stack in case the task crashes, as
+      // MessageLoop::RunTask does.
+      const void* program_counter = work.birth_program_counter;
+      debug::Alias(&program_counter);
+      work.task.Run();
+      // Drop any references held by the closure before sleeping.
+      work.task.Reset();
+      continue;
+    }
+    if (shutting_down)
+      return;
+    WaitableEvent::WaitMany(events, arraysize(events));
+  }
+}
+
+int WorkStealingThreadPool::CurrentWorkerIndex() const {
+  CurrentWorker* current = lazy_tls_worker.Pointer()->Get();
+  if (!current || current->pool != this)
+    return -1;
+  return current->index;
+}
+
+}  // namespace base
@@ -0,0 +1,145 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_THREADING_WORK_STEALING_THREAD_POOL_H_
+#define BASE_THREADING_WORK_STEALING_THREAD_POOL_H_
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/location.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
+
+class Task;
+
+namespace base {
+
+// A fixed-size pool of threads that run fire-and-forget work.  Each worker
+// owns a deque of pending work: tasks posted from a worker thread are pushed
+// onto that worker's own deque and popped LIFO (good cache locality for work
+// that fans out), while idle workers steal FIFO from the front of their
+// peers' deques.  Tasks posted from threads outside the pool are distributed
+// round-robin.
+//
+// Unlike base::Thread there is no MessageLoop on the workers, so posted work
+// must not rely on MessageLoop::current().  There are no ordering guarantees
+// between tasks.
+//
+// Typical usage:
+//   base::WorkStealingThreadPool pool("ImageDecode", 0);
+//   pool.Start();
+//   pool.PostTask(FROM_HERE, base::Bind(&DecodeBand, band));
+//   ...
+//   pool.Shutdown();  // Runs everything still queued, then joins.
+//
+// Most callers should use the process-wide pool behind base::WorkerPool
+// rather than creating their own.
+class BASE_EXPORT WorkStealingThreadPool {
+ public:
+  // |num_threads| of 0 sizes the pool from SysInfo::NumberOfProcessors().
+  // |name_prefix| is used to name the worker threads for debuggers.
+  WorkStealingThreadPool(const std::string& name_prefix, int num_threads);
+
+  // Calls Shutdown() if necessary.
+  ~WorkStealingThreadPool();
+
+  // Spawns the worker threads.  Returns false if any thread failed to start;
+  // the threads that did start keep servicing the pool.
+  bool Start();
+
+  // Runs all work that has already been posted, then stops and joins the
+  // workers.  Work posted after Shutdown() has begun is rejected.  Must not be
+  // called from one of the pool's own threads.
+  void Shutdown();
+
+  // Posts |task| to run on one of the workers.  Returns false if the pool is
+  // shutting down, in which case |task| is not run.  May be called on any
+  // thread, including the pool's own workers.  The Task* variant takes
+  // ownership of |task| and deletes it after it has been Run().
+  bool PostTask(const tracked_objects::Location& from_here,
+                const Closure& task);
+  bool PostTask(const tracked_objects::Location& from_here, Task* task);
+
+  // Returns true if called on one of this pool's worker threads.
+  bool RunsTasksOnCurrentThread() const;
+
+  int num_threads() const { return num_threads_; }
+
+  // Number of tasks that a worker took from another worker's deque.  For
+  // tuning only; updated without barriers.
+  int steal_count() const {
+    return subtle::NoBarrier_Load(&steal_count_);
+  }
+
+ private:
+  class Worker;
+
+  struct PendingWork {
+    PendingWork(const Closure& task,
+                const tracked_objects::Location& posted_from);
+    ~PendingWork();
+
+    Closure task;
+
+    // The site this work was posted from; kept on the stack while it runs.
+    const void* birth_program_counter;
+  };
+
+  typedef std::deque<PendingWork> WorkDeque;
+
+  // Finds work for worker |index|: first from the back of its own deque, then
+  // from the front of the other workers' deques.  Returns false if every deque
+  // is empty.
+  bool GetWork(int index, PendingWork* work);
+
+  // Pushes onto worker |index|'s deque and wakes an idle worker.  Returns
+  // false, without queuing, if the pool is shutting down.
+  bool Enqueue(int index, const PendingWork& work);
+
+  // The body of each worker thread.
+  void WorkerMain(int index);
+
+  // Returns the index of the calling worker thread, or -1 if the caller is not
+  // one of this pool's workers.
+  int CurrentWorkerIndex() const;
+
+  const std::string name_prefix_;
+  const int num_threads_;
+
+  // One deque and lock per worker; |workers_| and |deques_| are parallel.
+  std::vector<Worker*> workers_;
+  std::vector<WorkDeque> deques_;
+  std::vector<Lock*> deque_locks_;
+
+  // Number of tasks sitting in any deque.  Lets an idle worker decide whether
+  // to wake one of its peers after it takes a task.
+  volatile subtle::Atomic32 pending_count_;
+
+  // Picks the target deque for tasks posted from outside the pool.
+  volatile subtle::Atomic32 next_worker_;
+
+  volatile subtle::Atomic32 steal_count_;
+
+  // Signaled (auto-reset) when new work is queued.
+  WaitableEvent work_available_;
+  // Signaled (manual-reset) once Shutdown() has started.
+  WaitableEvent shutdown_event_;
+
+  volatile subtle::Atomic32 shutting_down_;
+  bool started_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingThreadPool);
+};
+
+}  // namespace base
+
+#endif  // BASE_THREADING_WORK_STEALING_THREAD_POOL_H_
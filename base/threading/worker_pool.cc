@@ -0,0 +1,72 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/threading/worker_pool.h"
+
+#include <algorithm>
+
+#include "base/lazy_instance.h"
+#include "base/sys_info.h"
+#include "base/threading/work_stealing_thread_pool.h"
+
+namespace base {
+
+namespace {
+
+// Upper bound on threads dedicated to slow (blocking) tasks.
+const int kMaxSlowWorkers = 4;
+
+class WorkerPools {
+ public:
+  WorkerPools()
+      : cpu_pool_("WorkerPool", SysInfo::NumberOfProcessors()),
+        slow_pool_("SlowWorkerPool",
+                   std::min(kMaxSlowWorkers, SysInfo::NumberOfProcessors())) {
+    cpu_pool_.Start();
+    slow_pool_.Start();
+  }
+
+  WorkStealingThreadPool* GetPool(bool task_is_slow) {
+    return task_is_slow ? &slow_pool_ : &cpu_pool_;
+  }
+
+  bool RunsTasksOnCurrentThread() const {
+    return cpu_pool_.RunsTasksOnCurrentThread() ||
+        slow_pool_.RunsTasksOnCurrentThread();
+  }
+
+ private:
+  WorkStealingThreadPool cpu_pool_;
+  WorkStealingThreadPool slow_pool_;
+};
+
+// The pools are leaked: their threads are never joined on shutdown.
+LazyInstance<WorkerPools, LeakyLazyInstanceTraits<WorkerPools> >
+    g_worker_pools(LINKER_INITIALIZED);
+
+}  // namespace
+
+// static
+bool WorkerPool::PostTask(const tracked_objects::Location& from_here,
+                          Task* task, bool task_is_slow) {
+  return g_worker_pools.Get().GetPool(task_is_slow)->PostTask(from_here, task);
+}
+
+// static
+bool WorkerPool::PostTask(const tracked_objects::Location& from_here,
+                          const Closure& task, bool task_is_slow) {
+  return g_worker_pools.Get().GetPool(task_is_slow)->PostTask(from_here, task);
+}
+
+// static
+int WorkerPool::GetNumberOfCpuWorkers() {
+  return g_worker_pools.Get().GetPool(false)->num_threads();
+}
+
+// static
+bool WorkerPool::RunsTasksOnCurrentThread() {
+  return g_worker_pools.Get().RunsTasksOnCurrentThread();
+}
+
+}  // namespace base
@@ -479,9 +479,27 @@ class BASE_EXPORT TimeTicks {
   // Returns a platform-dependent high-resolution tick count. Implementation
   // is hardware dependent and may or may not return sub-millisecond
   // resolution.  THIS CALL IS GENERALLY MUCH MORE EXPENSIVE THAN Now() AND
-  // SHOULD ONLY BE USED WHEN IT IS REALLY NEEDED.
+  // SHOULD ONLY BE USED WHEN IT IS REALLY NEEDED, unless
+  // IsHighResNowFastAndReliable().
   static TimeTicks HighResNow();
 
+  // Returns true if HighResNow() is cheaper than Now(), as it is where it
+  // reads an invariant time stamp counter: one that runs at a constant rate
+  // in all the power states, and is synchronized between processors. The
+  // result doesn't change while the process runs, even in the rare case where
+  // the calibration of the counter fails and HighResNow() keeps using the
+  // slower clock.
+  static bool IsHighResNowFastAndReliable();
+
+  // Returns the CPU time the current thread has used, to measure the cost of
+  // a task without the time it was descheduled. Only the difference between
+  // two calls on the same thread is meaningful.
+  static TimeTicks ThreadNow();
+
+  // Returns true if ThreadNow() has microsecond resolution. Otherwise it
+  // only counts the scheduler quanta the thread ran, about 15ms on Windows.
+  static bool IsThreadNowHighResolution();
+
 #if defined(OS_WIN)
   // Get the absolute value of QPC time drift. For testing.
   static int64 GetQPCDriftMicroseconds();
@@ -40,6 +40,10 @@
 #include <windows.h>
 #include <mmsystem.h>
 
+#include <intrin.h>
+#include <math.h>
+
+#include "base/atomicops.h"
 #include "base/basictypes.h"
 #include "base/logging.h"
 #include "base/cpu.h"
@@ -337,6 +341,14 @@ TimeDelta RolloverProtectedNow() {
 // (3) System time. The system time provides a low-resolution (typically 10ms
 // to 55 milliseconds) time stamp but is comparatively less expensive to
 // retrieve and more reliable.
+//
+// The processors that report an invariant TSC fix the issues of (1): the
+// counter runs at a constant rate in all the power states, and is
+// synchronized between the processors. On those, once QPC works, the TSC is
+// calibrated against QPC over the first 50ms it is used for, and then read in
+// its place. Until then QPC is used, and the TSC values continue from the last
+// QPC one. The calibration measures the rate over two halves of the period;
+// if they disagree, the TSC isn't trusted and QPC stays in use.
 class HighResNowSingleton {
  public:
   static HighResNowSingleton* GetInstance() {
@@ -349,16 +361,58 @@ class HighResNowSingleton {
 
   void DisableHighResClock() {
     ticks_per_microsecond_ = 0.0;
+    use_tsc_ = false;
+  }
+
+  bool IsTSCSupported() {
+    return tsc_supported_;
   }
 
   TimeDelta Now() {
-    if (IsUsingHighResClock())
+    if (base::subtle::Acquire_Load(&tsc_calibrated_))
+      return TimeDelta::FromMicroseconds(TSCNow());
+
+    if (IsUsingHighResClock()) {
+      if (use_tsc_) {
+        int64 now = CalibrateTSC();
+        if (now)
+          return TimeDelta::FromMicroseconds(now);
+      }
       return TimeDelta::FromMicroseconds(UnreliableNow());
+    }
 
     // Just fallback to the slower clock.
     return RolloverProtectedNow();
   }
 
+  bool IsThreadNowHighResolution() {
+    return use_tsc_ && query_thread_cycle_time_;
+  }
+
+  TimeDelta ThreadNow() {
+    HANDLE thread = ::GetCurrentThread();
+    if (IsThreadNowHighResolution()) {
+      // The cycles need the calibrated rate. Waiting for it here, once,
+      // rather than counting the first threads' time in quanta, keeps the
+      // values of each thread on one clock.
+      while (!base::subtle::Acquire_Load(&tsc_calibrated_) && use_tsc_) {
+        CalibrateTSC();
+        ::Sleep(1);
+      }
+      ULONG64 cycles = 0;
+      if (use_tsc_ && query_thread_cycle_time_(thread, &cycles)) {
+        return TimeDelta::FromMicroseconds(
+            static_cast<int64>(cycles / tsc_ticks_per_microsecond_));
+      }
+    }
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (!::GetThreadTimes(thread, &creation_time, &exit_time, &kernel_time,
+                          &user_time))
+      return TimeDelta();
+    return TimeDelta::FromMicroseconds(FileTimeToMicroseconds(kernel_time) +
+                                       FileTimeToMicroseconds(user_time));
+  }
+
   int64 GetQPCDriftMicroseconds() {
     if (!IsUsingHighResClock())
       return 0;
@@ -372,9 +426,20 @@ class HighResNowSingleton {
   }
 
  private:
+  // QueryThreadCycleTime function pointer, from Vista on.
+  typedef BOOL (WINAPI* QueryThreadCycleTimeFunction)(HANDLE, PULONG64);
+
   HighResNowSingleton()
     : ticks_per_microsecond_(0.0),
-      skew_(0) {
+      skew_(0),
+      tsc_supported_(false),
+      use_tsc_(false),
+      calibration_samples_(0),
+      tsc_ticks_per_microsecond_(0.0),
+      tsc_base_(0),
+      tsc_base_microseconds_(0),
+      tsc_calibrated_(0),
+      query_thread_cycle_time_(NULL) {
     InitializeClock();
 
     // On Athlon X2 CPUs (e.g. model 15) QueryPerformanceCounter is
@@ -382,6 +447,63 @@ class HighResNowSingleton {
     base::CPU cpu;
     if (cpu.vendor_name() == "AuthenticAMD" && cpu.family() == 15)
       DisableHighResClock();
+
+    if (IsUsingHighResClock() && cpu.has_non_stop_time_stamp_counter()) {
+      tsc_supported_ = true;
+      use_tsc_ = true;
+      query_thread_cycle_time_ = reinterpret_cast<QueryThreadCycleTimeFunction>(
+          ::GetProcAddress(::GetModuleHandle(L"kernel32.dll"),
+                           "QueryThreadCycleTime"));
+    }
+  }
+
+  // Takes a calibration sample if the previous one is old enough, and
+  // completes the calibration with the last one. Returns the time of the
+  // last sample if it completed the calibration, so that the caller returns
+  // the value the TSC continues from, or 0 otherwise.
+  int64 CalibrateTSC() {
+    base::AutoLock locked(calibration_lock_);
+    if (tsc_calibrated_ || !use_tsc_)
+      return 0;
+    int64 now = UnreliableNow();
+    uint64 tsc = __rdtsc();
+    if (calibration_samples_ > 0 &&
+        now - calibration_microseconds_[calibration_samples_ - 1] <
+            kTSCCalibrationMicroseconds / 2)
+      return 0;
+    calibration_microseconds_[calibration_samples_] = now;
+    calibration_tsc_[calibration_samples_] = tsc;
+    if (++calibration_samples_ < 3)
+      return 0;
+
+    double first_rate = Rate(0, 1);
+    double second_rate = Rate(1, 2);
+    if (first_rate <= 0.0 || second_rate <= 0.0 ||
+        fabs(first_rate - second_rate) > second_rate * kTSCRateTolerance) {
+      use_tsc_ = false;
+      return 0;
+    }
+    tsc_ticks_per_microsecond_ = Rate(0, 2);
+    tsc_base_ = tsc;
+    tsc_base_microseconds_ = now;
+    base::subtle::Release_Store(&tsc_calibrated_, 1);
+    return now;
+  }
+
+  // The TSC ticks per microsecond between calibration samples |from| and
+  // |to|.
+  double Rate(int from, int to) {
+    return static_cast<double>(calibration_tsc_[to] - calibration_tsc_[from]) /
+        (calibration_microseconds_[to] - calibration_microseconds_[from]);
+  }
+
+  // Get the number of microseconds since boot from the TSC, once calibrated.
+  int64 TSCNow() {
+    // Signed, as the TSC of another processor may be a few ticks behind the
+    // one the base was read on.
+    int64 ticks = static_cast<int64>(__rdtsc() - tsc_base_);
+    return tsc_base_microseconds_ +
+        static_cast<int64>(ticks / tsc_ticks_per_microsecond_);
   }
 
   // Synchronize the QPC clock with GetSystemTimeAsFileTime.
@@ -412,9 +534,38 @@ class HighResNowSingleton {
   float ticks_per_microsecond_;  // 0 indicates QPF failed and we're broken.
   int64 skew_;  // Skew between lo-res and hi-res clocks (for debugging).
 
+  // The TSC calibration against QPC: the period it runs over, and how much
+  // the rates of its two halves may differ.
+  static const int64 kTSCCalibrationMicroseconds = 50000;
+  static const double kTSCRateTolerance;
+
+  // True if the processor has an invariant TSC, and QPC works to calibrate
+  // it against.
+  bool tsc_supported_;
+
+  // True while the TSC is, or may be once calibrated, read in place of QPC.
+  bool use_tsc_;
+
+  // Protects the calibration. The members below it are only written before
+  // |tsc_calibrated_| is set.
+  base::Lock calibration_lock_;
+  int calibration_samples_;
+  int64 calibration_microseconds_[3];
+  uint64 calibration_tsc_[3];
+
+  double tsc_ticks_per_microsecond_;
+  uint64 tsc_base_;  // A TSC value...
+  int64 tsc_base_microseconds_;  // ...and the QPC time it was read at.
+  base::subtle::Atomic32 tsc_calibrated_;
+
+  QueryThreadCycleTimeFunction query_thread_cycle_time_;
+
   friend struct DefaultSingletonTraits<HighResNowSingleton>;
 };
 
+// A tenth of a percent.
+const double HighResNowSingleton::kTSCRateTolerance = 0.001;
+
 }  // namespace
 
 // static
@@ -435,6 +586,21 @@ TimeTicks TimeTicks::HighResNow() {
   return TimeTicks() + HighResNowSingleton::GetInstance()->Now();
 }
 
+// static
+bool TimeTicks::IsHighResNowFastAndReliable() {
+  return HighResNowSingleton::GetInstance()->IsTSCSupported();
+}
+
+// static
+TimeTicks TimeTicks::ThreadNow() {
+  return TimeTicks() + HighResNowSingleton::GetInstance()->ThreadNow();
+}
+
+// static
+bool TimeTicks::IsThreadNowHighResolution() {
+  return HighResNowSingleton::GetInstance()->IsThreadNowHighResolution();
+}
+
 // static
 int64 TimeTicks::GetQPCDriftMicroseconds() {
   return HighResNowSingleton::GetInstance()->GetQPCDriftMicroseconds();
@@ -9,20 +9,16 @@
 namespace base {
 
 void BaseTimer_Helper::OrphanDelayedTask() {
-  if (delayed_task_) {
-    delayed_task_->timer_ = NULL;
-    delayed_task_ = NULL;
-  }
+  Cancel();
 }
 
-void BaseTimer_Helper::InitiateDelayedTask(TimerTask* timer_task) {
-  OrphanDelayedTask();
-
-  delayed_task_ = timer_task;
-  delayed_task_->timer_ = this;
-  MessageLoop::current()->PostDelayedTask(
-      timer_task->posted_from_, timer_task,
-      static_cast<int>(timer_task->delay_.InMillisecondsRoundedUp()));
+void BaseTimer_Helper::InitiateDelayedTask(
+    const tracked_objects::Location& posted_from,
+    TimeDelta delay) {
+  posted_from_ = posted_from;
+  delay_ = delay;
+  MessageLoop::current()->ScheduleDeferrableTimerWheelEntry(
+      this, delay.InMillisecondsRoundedUp(), tolerance_.InMilliseconds());
 }
 
 }  // namespace base
@@ -52,6 +52,7 @@
 #include "base/logging.h"
 #include "base/task.h"
 #include "base/time.h"
+#include "base/timer_wheel.h"
 
 class MessageLoop;
 
@@ -62,52 +63,50 @@ namespace base {
 // Please do not use this class directly.
 //
 // This class exists to share code between BaseTimer<T> template instantiations.
+// Timers are entries in the current MessageLoop's TimerWheel, so starting,
+// resetting and stopping a timer never allocates, and a stopped timer leaves
+// nothing behind in the MessageLoop.
 //
-class BASE_EXPORT BaseTimer_Helper {
+class BASE_EXPORT BaseTimer_Helper : public TimerWheel::Entry {
  public:
   // Stops the timer.
-  ~BaseTimer_Helper() {
-    OrphanDelayedTask();
-  }
+  virtual ~BaseTimer_Helper() {}
 
   // Returns true if the timer is running (i.e., not stopped).
   bool IsRunning() const {
-    return delayed_task_ != NULL;
+    return IsScheduled();
   }
 
   // Returns the current delay for this timer.  May only call this method when
   // the timer is running!
   TimeDelta GetCurrentDelay() const {
     DCHECK(IsRunning());
-    return delayed_task_->delay_;
+    return delay_;
   }
 
+  // Makes the timer deferrable, from the next time it is started or reset:
+  // while the computer is on battery power, it may fire up to |tolerance|
+  // late, in the same wakeup as the other deferrable timers. Meant for the
+  // timers whose exact time doesn't matter, like those of periodic cleanups
+  // or polls. Zero, the default, makes it fire on time.
+  void set_tolerance(TimeDelta tolerance) { tolerance_ = tolerance; }
+  TimeDelta tolerance() const { return tolerance_; }
+
  protected:
-  BaseTimer_Helper() : delayed_task_(NULL) {}
-
-  // We have access to the timer_ member so we can orphan this task.
-  class TimerTask : public Task {
-   public:
-    TimerTask(const tracked_objects::Location& posted_from,
-              TimeDelta delay)
-        : posted_from_(posted_from),
-          timer_(NULL),
-          delay_(delay) {
-    }
-    virtual ~TimerTask() {}
-    tracked_objects::Location posted_from_;
-    BaseTimer_Helper* timer_;
-    TimeDelta delay_;
-  };
+  BaseTimer_Helper() {}
 
-  // Used to orphan delayed_task_ so that when it runs it does nothing.
+  // Used to stop the timer so that it does not fire.
   void OrphanDelayedTask();
 
-  // Used to initiated a new delayed task.  This has the side-effect of
-  // orphaning delayed_task_ if it is non-null.
-  void InitiateDelayedTask(TimerTask* timer_task);
+  // Used to (re)schedule the timer on the current MessageLoop to fire after
+  // |delay|.  This has the side-effect of cancelling the pending expiry, if
+  // any.
+  void InitiateDelayedTask(const tracked_objects::Location& posted_from,
+                           TimeDelta delay);
 
-  TimerTask* delayed_task_;
+  tracked_objects::Location posted_from_;
+  TimeDelta delay_;
+  TimeDelta tolerance_;
 
   DISALLOW_COPY_AND_ASSIGN(BaseTimer_Helper);
 };
@@ -120,6 +119,8 @@ class BaseTimer : public BaseTimer_Helper {
  public:
   typedef void (Receiver::*ReceiverMethod)();
 
+  BaseTimer() : receiver_(NULL), method_(NULL) {}
+
   // Call this method to start the timer.  It is an error to call this method
   // while the timer is already running.
   void Start(const tracked_objects::Location& posted_from,
@@ -127,7 +128,9 @@ class BaseTimer : public BaseTimer_Helper {
              Receiver* receiver,
              ReceiverMethod method) {
     DCHECK(!IsRunning());
-    InitiateDelayedTask(new TimerTask(posted_from, delay, receiver, method));
+    receiver_ = receiver;
+    method_ = method;
+    InitiateDelayedTask(posted_from, delay);
   }
 
   // Call this method to stop the timer.  It is a no-op if the timer is not
@@ -139,72 +142,21 @@ class BaseTimer : public BaseTimer_Helper {
   // Call this method to reset the timer delay of an already running timer.
   void Reset() {
     DCHECK(IsRunning());
-    InitiateDelayedTask(static_cast<TimerTask*>(delayed_task_)->Clone());
+    InitiateDelayedTask(posted_from_, delay_);
   }
 
  private:
-  typedef BaseTimer<Receiver, kIsRepeating> SelfType;
-
-  class TimerTask : public BaseTimer_Helper::TimerTask {
-   public:
-    TimerTask(const tracked_objects::Location& posted_from,
-              TimeDelta delay,
-              Receiver* receiver,
-              ReceiverMethod method)
-        : BaseTimer_Helper::TimerTask(posted_from, delay),
-          receiver_(receiver),
-          method_(method) {
-    }
-
-    virtual ~TimerTask() {
-      // This task may be getting cleared because the MessageLoop has been
-      // destructed.  If so, don't leave the Timer with a dangling pointer
-      // to this now-defunct task.
-      ClearBaseTimer();
-    }
-
-    virtual void Run() {
-      if (!timer_)  // timer_ is null if we were orphaned.
-        return;
-      if (kIsRepeating)
-        ResetBaseTimer();
-      else
-        ClearBaseTimer();
-      DispatchToMethod(receiver_, method_, Tuple0());
-    }
-
-    TimerTask* Clone() const {
-      return new TimerTask(posted_from_, delay_, receiver_, method_);
-    }
-
-   private:
-    // Inform the Base that the timer is no longer active.
-    void ClearBaseTimer() {
-      if (timer_) {
-        SelfType* self = static_cast<SelfType*>(timer_);
-        // It is possible that the Timer has already been reset, and that this
-        // Task is old.  So, if the Timer points to a different task, assume
-        // that the Timer has already taken care of properly setting the task.
-        if (self->delayed_task_ == this)
-          self->delayed_task_ = NULL;
-        // By now the delayed_task_ in the Timer does not point to us anymore.
-        // We should reset our own timer_ because the Timer can not do this
-        // for us in its destructor.
-        timer_ = NULL;
-      }
-    }
-
-    // Inform the Base that we're resetting the timer.
-    void ResetBaseTimer() {
-      DCHECK(timer_);
-      DCHECK(kIsRepeating);
-      SelfType* self = static_cast<SelfType*>(timer_);
-      self->Reset();
-    }
+  // TimerWheel::Entry implementation.  The wheel has already unscheduled us,
+  // so a one-shot timer reports !IsRunning() while |method_| runs.
+  virtual void OnTimerWheelFire() {
+    if (kIsRepeating)
+      InitiateDelayedTask(posted_from_, delay_);
+    // |this| may be deleted by the callback; do not touch it afterwards.
+    DispatchToMethod(receiver_, method_, Tuple0());
+  }
 
-    Receiver* receiver_;
-    ReceiverMethod method_;
-  };
+  Receiver* receiver_;
+  ReceiverMethod method_;
 };
 
 //-----------------------------------------------------------------------------
@@ -0,0 +1,270 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/timer_wheel.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/logging.h"
+
+namespace base {
+
+namespace {
+
+// Number of ticks covered by the root level and all levels below |level|.
+int64 SpanBelowLevel(int level) {
+  return GG_INT64_C(1) << (8 + 6 * (level - 1));
+}
+
+}  // namespace
+
+//------------------------------------------------------------------------------
+// TimerWheel::Entry
+
+TimerWheel::Entry::Entry()
+    : wheel_(NULL),
+      list_(NULL),
+      prev_(NULL),
+      next_(NULL),
+      tick_(0) {
+}
+
+TimerWheel::Entry::~Entry() {
+  Cancel();
+}
+
+void TimerWheel::Entry::Cancel() {
+  if (!wheel_)
+    return;
+  TimerWheel* wheel = wheel_;
+  wheel->UnlinkEntry(this);
+  --wheel->size_;
+}
+
+//------------------------------------------------------------------------------
+// TimerWheel
+
+TimerWheel::TimerWheel()
+    : origin_(TimeTicks::Now()),
+      current_tick_(0),
+      expired_(NULL),
+      expired_tail_(NULL),
+      size_(0) {
+  memset(root_, 0, sizeof(root_));
+  memset(levels_, 0, sizeof(levels_));
+}
+
+TimerWheel::~TimerWheel() {
+  // Detach the remaining entries so that their destructors do not touch us.
+  for (int i = 0; i < kRootSize && size_; ++i) {
+    while (root_[i])
+      root_[i]->Cancel();
+  }
+  for (int level = 1; level < kNumLevels && size_; ++level) {
+    for (int i = 0; i < kLevelSize; ++i) {
+      while (levels_[level - 1][i])
+        levels_[level - 1][i]->Cancel();
+    }
+  }
+  while (expired_)
+    expired_->Cancel();
+  DCHECK_EQ(0u, size_);
+}
+
+void TimerWheel::Schedule(Entry* entry, TimeTicks deadline) {
+  DCHECK(entry);
+  entry->Cancel();
+  entry->wheel_ = this;
+  entry->deadline_ = deadline;
+  entry->time_scheduled_ = TimeTicks::Now();
+  entry->tick_ = TickForTime(deadline);
+  ++size_;
+  Insert(entry);
+}
+
+TimerWheel::Entry* TimerWheel::PopExpired(TimeTicks now) {
+  if (!size_)
+    return NULL;
+
+  int64 now_tick = (now - origin_).InMilliseconds();
+  while (!expired_ && current_tick_ <= now_tick) {
+    int root_index = static_cast<int>(current_tick_ & kRootMask);
+    if (root_index != 0 && !root_[root_index]) {
+      // Skip straight to the next occupied root slot or cascade point.
+      int next = NextNonEmptyRootSlot();
+      int64 next_tick = next < 0 ? (current_tick_ | kRootMask) + 1 :
+          current_tick_ + (next - root_index);
+      current_tick_ = std::min(next_tick, now_tick + 1);
+      continue;
+    }
+    Tick();
+  }
+
+  Entry* entry = expired_;
+  if (entry)
+    entry->Cancel();
+  return entry;
+}
+
+TimeTicks TimerWheel::NextWakeupTime() const {
+  if (!size_)
+    return TimeTicks();
+  if (expired_)
+    return TimeTicks::Now();
+
+  int root_index = static_cast<int>(current_tick_ & kRootMask);
+  int next = NextNonEmptyRootSlot();
+  if (next >= 0)
+    return TimeForTick(current_tick_ + (next - root_index));
+
+  // Root slots before the current index belong to the next rotation.
+  int64 earliest = kint64max;
+  for (int i = 0; i < root_index; ++i) {
+    if (root_[i]) {
+      earliest = (current_tick_ | kRootMask) + 1 + i;
+      break;
+    }
+  }
+
+  // The earliest entry in the upper levels cannot expire before the first
+  // occupied slot of its level is cascaded.
+  for (int level = 1; level < kNumLevels; ++level) {
+    int shift = kRootBits + kLevelBits * (level - 1);
+    int64 level_tick = current_tick_ >> shift;
+    // If |current_tick_| itself is a cascade point for this level, the
+    // current slot has not been cascaded yet.
+    int first = (level_tick << shift) == current_tick_ ? 0 : 1;
+    for (int distance = first; distance <= kLevelSize; ++distance) {
+      int index = static_cast<int>((level_tick + distance) & kLevelMask);
+      if (levels_[level - 1][index]) {
+        earliest = std::min(earliest, (level_tick + distance) << shift);
+        break;
+      }
+    }
+  }
+  DCHECK_NE(kint64max, earliest);
+  return TimeForTick(earliest);
+}
+
+void TimerWheel::Insert(Entry* entry) {
+  int64 delta = entry->tick_ - current_tick_;
+  if (delta < 0) {
+    // Already due.
+    entry->list_ = &expired_;
+    entry->next_ = NULL;
+    entry->prev_ = expired_tail_;
+    if (expired_tail_)
+      expired_tail_->next_ = entry;
+    else
+      expired_ = entry;
+    expired_tail_ = entry;
+    return;
+  }
+
+  if (delta < kRootSize) {
+    LinkEntry(&root_[entry->tick_ & kRootMask], entry);
+    return;
+  }
+
+  int64 tick = entry->tick_;
+  int level = 1;
+  while (level < kNumLevels - 1 && delta >= SpanBelowLevel(level + 1))
+    ++level;
+  if (delta >= SpanBelowLevel(kNumLevels)) {
+    // Beyond the range of the wheel: park it in the furthest slot.  It will
+    // be re-filed, with its real tick, when that slot cascades.
+    tick = current_tick_ + SpanBelowLevel(kNumLevels) - 1;
+  }
+  int shift = kRootBits + kLevelBits * (level - 1);
+  LinkEntry(&levels_[level - 1][(tick >> shift) & kLevelMask], entry);
+}
+
+int TimerWheel::Cascade(int level, int index) {
+  Entry** list = SlotList(level, index);
+  Entry* entry = *list;
+  *list = NULL;
+  while (entry) {
+    Entry* next = entry->next_;
+    Insert(entry);
+    entry = next;
+  }
+  return index;
+}
+
+void TimerWheel::Tick() {
+  int root_index = static_cast<int>(current_tick_ & kRootMask);
+  if (root_index == 0) {
+    // The root level wrapped: pull the next slot of each higher level down,
+    // stopping at the first level that did not wrap as well.
+    for (int level = 1; level < kNumLevels; ++level) {
+      int shift = kRootBits + kLevelBits * (level - 1);
+      int index = static_cast<int>((current_tick_ >> shift) & kLevelMask);
+      if (Cascade(level, index) != 0)
+        break;
+    }
+  }
+
+  // Move the slot for this tick onto the expired list, oldest first.  Slots
+  // are built by prepending, so walk them back to front.
+  Entry* entry = root_[root_index];
+  root_[root_index] = NULL;
+  ++current_tick_;
+  while (entry && entry->next_)
+    entry = entry->next_;
+  while (entry) {
+    Entry* prev = entry->prev_;
+    // |entry->tick_| is now behind |current_tick_|, so this expires it.
+    Insert(entry);
+    entry = prev;
+  }
+}
+
+int TimerWheel::NextNonEmptyRootSlot() const {
+  for (int i = static_cast<int>(current_tick_ & kRootMask); i < kRootSize;
+       ++i) {
+    if (root_[i])
+      return i;
+  }
+  return -1;
+}
+
+// static
+void TimerWheel::LinkEntry(Entry** list, Entry* entry) {
+  entry->list_ = list;
+  entry->prev_ = NULL;
+  entry->next_ = *list;
+  if (*list)
+    (*list)->prev_ = entry;
+  *list = entry;
+}
+
+void TimerWheel::UnlinkEntry(Entry* entry) {
+  if (entry->prev_)
+    entry->prev_->next_ = entry->next_;
+  else
+    *entry->list_ = entry->next_;
+  if (entry->next_)
+    entry->next_->prev_ = entry->prev_;
+  else if (entry->list_ == &expired_)
+    expired_tail_ = entry->prev_;
+  entry->wheel_ = NULL;
+  entry->list_ = NULL;
+  entry->prev_ = entry->next_ = NULL;
+}
+
+int64 TimerWheel::TickForTime(TimeTicks time) const {
+  // Round up so that entries never fire early.
+  TimeDelta offset = time - origin_;
+  if (offset <= TimeDelta())
+    return 0;
+  return offset.InMillisecondsRoundedUp();
+}
+
+TimeTicks TimerWheel::TimeForTick(int64 tick) const {
+  return origin_ + TimeDelta::FromMilliseconds(tick);
+}
+
+}  // namespace base
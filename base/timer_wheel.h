@@ -0,0 +1,159 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TIMER_WHEEL_H_
+#define BASE_TIMER_WHEEL_H_
+#pragma once
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/time.h"
+
+namespace base {
+
+// A hierarchical timing wheel with millisecond ticks.  Scheduling and
+// cancelling a timer are O(1) and never allocate: timers are intrusive
+// TimerWheel::Entry objects which unlink themselves when cancelled or
+// destroyed, so cancelled timers leave nothing behind (unlike delayed tasks in
+// MessageLoop's priority queue, which stay in the heap until they expire).
+//
+// The wheel has four levels.  Level 0 has 256 one-tick slots; each higher
+// level has 64 slots, each spanning a whole rotation of the level below it.
+// Entries trickle down a level every time the level below wraps ("cascading"),
+// so every entry is touched at most once per level.  Deadlines beyond the
+// range of the top level (about 18 hours) are parked in its furthest slot and
+// re-filed when it cascades.
+//
+// The wheel is not thread safe.  MessageLoop owns one wheel per loop, which
+// backs base::OneShotTimer and base::RepeatingTimer; see
+// MessageLoop::ScheduleTimerWheelEntry().
+class BASE_EXPORT TimerWheel {
+ public:
+  // An intrusive timer.  Subclasses implement OnTimerWheelFire().
+  class BASE_EXPORT Entry {
+   public:
+    Entry();
+
+    // Returns true if the entry is waiting in a wheel (or has expired but has
+    // not yet been popped).
+    bool IsScheduled() const { return wheel_ != NULL; }
+
+    // Removes the entry from its wheel.  No-op if not scheduled.
+    void Cancel();
+
+    // The time passed to TimerWheel::Schedule().
+    TimeTicks deadline() const { return deadline_; }
+
+    // The time at which the entry was last scheduled.
+    TimeTicks time_scheduled() const { return time_scheduled_; }
+
+    // Called by the wheel's owner once the entry has been popped.  The entry
+    // may delete itself from within OnTimerWheelFire().
+    void Fire() { OnTimerWheelFire(); }
+
+   protected:
+    // Cancels the entry.
+    virtual ~Entry();
+
+    virtual void OnTimerWheelFire() = 0;
+
+   private:
+    friend class TimerWheel;
+
+    TimerWheel* wheel_;
+    // The list the entry is linked into, and its neighbours in that list.
+    Entry** list_;
+    Entry* prev_;
+    Entry* next_;
+
+    // |deadline_| rounded up to a wheel tick.
+    int64 tick_;
+    TimeTicks deadline_;
+    TimeTicks time_scheduled_;
+
+    DISALLOW_COPY_AND_ASSIGN(Entry);
+  };
+
+  TimerWheel();
+
+  // Unschedules every remaining entry without firing it.
+  ~TimerWheel();
+
+  // Schedules |entry| to expire at |deadline|, cancelling it first if it is
+  // already scheduled (in this or another wheel).  A deadline in the past
+  // expires at the next call to PopExpired().
+  void Schedule(Entry* entry, TimeTicks deadline);
+
+  // Advances the wheel to |now| and removes and returns one expired entry, or
+  // returns NULL if no entry has expired yet.  Entries are returned in
+  // deadline order at tick (millisecond) granularity.
+  Entry* PopExpired(TimeTicks now);
+
+  // Returns a time at or before which the next entry may expire: exact for
+  // entries due within the next 256 ticks, otherwise the time at which the
+  // level holding the earliest entry next cascades.  Returns a null TimeTicks
+  // if the wheel is empty.
+  TimeTicks NextWakeupTime() const;
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+ private:
+  enum {
+    kRootBits = 8,
+    kLevelBits = 6,
+    kRootSize = 1 << kRootBits,
+    kLevelSize = 1 << kLevelBits,
+    kRootMask = kRootSize - 1,
+    kLevelMask = kLevelSize - 1,
+    kNumLevels = 4,  // Including the root level.
+  };
+
+  // Files |entry| into the slot that matches its tick.
+  void Insert(Entry* entry);
+
+  // Re-files every entry in |level|'s slot |index|.  Returns |index|, so the
+  // caller knows whether the next level wrapped as well.
+  int Cascade(int level, int index);
+
+  // Moves the wheel forward one tick: cascades if needed, then moves the
+  // current root slot onto |expired_|.
+  void Tick();
+
+  // Returns the index of the first non-empty root slot at or after the
+  // current tick and before the next cascade, or -1.
+  int NextNonEmptyRootSlot() const;
+
+  static void LinkEntry(Entry** list, Entry* entry);
+  void UnlinkEntry(Entry* entry);
+
+  int64 TickForTime(TimeTicks time) const;
+  TimeTicks TimeForTick(int64 tick) const;
+
+  Entry** SlotList(int level, int index) {
+    return level == 0 ? &root_[index] :
+                        &levels_[level - 1][index];
+  }
+
+  // All ticks are measured from |origin_|.
+  TimeTicks origin_;
+
+  // The next tick to be processed.  Every tick before it has been expired.
+  int64 current_tick_;
+
+  Entry* root_[kRootSize];
+  Entry* levels_[kNumLevels - 1][kLevelSize];
+
+  // Entries whose tick has passed, in firing order.
+  Entry* expired_;
+  Entry* expired_tail_;
+
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+}  // namespace base
+
+#endif  // BASE_TIMER_WHEEL_H_
@@ -0,0 +1,197 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/timer_wheel.h"
+
+#include <vector>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop.h"
+#include "base/timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using base::TimeDelta;
+using base::TimeTicks;
+using base::TimerWheel;
+
+namespace {
+
+// Appends its id to a list when it fires.
+class TestEntry : public TimerWheel::Entry {
+ public:
+  TestEntry(int id, std::vector<int>* fired) : id_(id), fired_(fired) {}
+  virtual ~TestEntry() {}
+
+ private:
+  virtual void OnTimerWheelFire() {
+    fired_->push_back(id_);
+  }
+
+  const int id_;
+  std::vector<int>* fired_;
+};
+
+// Fires the entries of |wheel| that expired by |now|.
+void FireExpired(TimerWheel* wheel, TimeTicks now) {
+  while (TimerWheel::Entry* entry = wheel->PopExpired(now))
+    entry->Fire();
+}
+
+TEST(TimerWheelTest, FiresInDeadlineOrder) {
+  // Deadlines in the root level, in each of the higher levels, and beyond
+  // the range of the top one, scheduled out of order.
+  const int64 kDelaysMs[] = {
+    300, 5, 70000, 256, 1, 17000000, 4000, 100000000, 260,
+  };
+  const int kNumEntries = static_cast<int>(arraysize(kDelaysMs));
+
+  TimerWheel wheel;
+  TimeTicks start = TimeTicks::Now();
+  std::vector<int> fired;
+  std::vector<TestEntry*> entries;
+  for (int i = 0; i < kNumEntries; ++i) {
+    entries.push_back(new TestEntry(i, &fired));
+    wheel.Schedule(entries.back(),
+                   start + TimeDelta::FromMilliseconds(kDelaysMs[i]));
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumEntries), wheel.size());
+
+  std::vector<int> expected;
+  std::vector<bool> done(kNumEntries, false);
+  for (int n = 0; n < kNumEntries; ++n) {
+    int next = -1;
+    for (int i = 0; i < kNumEntries; ++i) {
+      if (!done[i] && (next < 0 || kDelaysMs[i] < kDelaysMs[next]))
+        next = i;
+    }
+    done[next] = true;
+
+    // A tick early, the entry has not fired; a tick late, it has, after all
+    // the earlier ones.
+    FireExpired(&wheel,
+                start + TimeDelta::FromMilliseconds(kDelaysMs[next] - 1));
+    EXPECT_EQ(expected, fired) << "delay " << kDelaysMs[next];
+    expected.push_back(next);
+    FireExpired(&wheel,
+                start + TimeDelta::FromMilliseconds(kDelaysMs[next] + 1));
+    EXPECT_EQ(expected, fired) << "delay " << kDelaysMs[next];
+  }
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_TRUE(wheel.NextWakeupTime().is_null());
+
+  for (int i = 0; i < kNumEntries; ++i)
+    delete entries[i];
+}
+
+TEST(TimerWheelTest, CancelledEntriesDoNotFire) {
+  TimerWheel wheel;
+  TimeTicks start = TimeTicks::Now();
+  std::vector<int> fired;
+  TestEntry cancelled(0, &fired);
+  scoped_ptr<TestEntry> deleted(new TestEntry(1, &fired));
+  TestEntry rescheduled(2, &fired);
+  TestEntry kept(3, &fired);
+
+  wheel.Schedule(&cancelled, start + TimeDelta::FromMilliseconds(10));
+  wheel.Schedule(deleted.get(), start + TimeDelta::FromMilliseconds(20));
+  wheel.Schedule(&rescheduled, start + TimeDelta::FromMilliseconds(30));
+  wheel.Schedule(&kept, start + TimeDelta::FromMilliseconds(40));
+  EXPECT_EQ(4u, wheel.size());
+
+  cancelled.Cancel();
+  EXPECT_FALSE(cancelled.IsScheduled());
+  deleted.reset();
+  wheel.Schedule(&rescheduled, start + TimeDelta::FromMilliseconds(5000));
+  EXPECT_EQ(2u, wheel.size());
+
+  FireExpired(&wheel, start + TimeDelta::FromMilliseconds(100));
+  ASSERT_EQ(1u, fired.size());
+  EXPECT_EQ(3, fired[0]);
+  EXPECT_TRUE(rescheduled.IsScheduled());
+
+  rescheduled.Cancel();
+  EXPECT_TRUE(wheel.empty());
+  FireExpired(&wheel, start + TimeDelta::FromMilliseconds(10000));
+  EXPECT_EQ(1u, fired.size());
+}
+
+TEST(TimerWheelTest, PastDeadlineExpiresAtOnce) {
+  TimerWheel wheel;
+  std::vector<int> fired;
+  TestEntry entry(0, &fired);
+  wheel.Schedule(&entry, TimeTicks::Now() - TimeDelta::FromMilliseconds(50));
+  FireExpired(&wheel, TimeTicks::Now());
+  ASSERT_EQ(1u, fired.size());
+  EXPECT_FALSE(entry.IsScheduled());
+}
+
+// Records the order in which its timers fire, and stops the loop after the
+// last one.
+class TimerOrderRecorder {
+ public:
+  explicit TimerOrderRecorder(int num_to_fire)
+      : num_to_fire_(num_to_fire) {
+  }
+
+  void FireA() { Fire(0); }
+  void FireB() { Fire(1); }
+  void FireC() { Fire(2); }
+  void FireCancelled() { Fire(-1); }
+
+  const std::vector<int>& fired() const { return fired_; }
+
+ private:
+  void Fire(int id) {
+    fired_.push_back(id);
+    if (static_cast<int>(fired_.size()) == num_to_fire_)
+      MessageLoop::current()->Quit();
+  }
+
+  const int num_to_fire_;
+  std::vector<int> fired_;
+};
+
+TEST(TimerWheelTest, MessageLoopTimersFireInOrder) {
+  MessageLoop message_loop;
+  TimerOrderRecorder recorder(3);
+  base::OneShotTimer<TimerOrderRecorder> a, b, c, cancelled;
+  c.Start(FROM_HERE, TimeDelta::FromMilliseconds(30), &recorder,
+          &TimerOrderRecorder::FireC);
+  a.Start(FROM_HERE, TimeDelta::FromMilliseconds(10), &recorder,
+          &TimerOrderRecorder::FireA);
+  cancelled.Start(FROM_HERE, TimeDelta::FromMilliseconds(15), &recorder,
+                  &TimerOrderRecorder::FireCancelled);
+  b.Start(FROM_HERE, TimeDelta::FromMilliseconds(20), &recorder,
+          &TimerOrderRecorder::FireB);
+  cancelled.Stop();
+  EXPECT_FALSE(cancelled.IsRunning());
+
+  MessageLoop::current()->Run();
+
+  ASSERT_EQ(3u, recorder.fired().size());
+  EXPECT_EQ(0, recorder.fired()[0]);
+  EXPECT_EQ(1, recorder.fired()[1]);
+  EXPECT_EQ(2, recorder.fired()[2]);
+  EXPECT_FALSE(a.IsRunning());
+}
+
+TEST(TimerWheelTest, DeletedMessageLoopTimerDoesNotFire) {
+  MessageLoop message_loop;
+  TimerOrderRecorder recorder(1);
+  scoped_ptr<base::OneShotTimer<TimerOrderRecorder> > deleted(
+      new base::OneShotTimer<TimerOrderRecorder>);
+  deleted->Start(FROM_HERE, TimeDelta::FromMilliseconds(5), &recorder,
+                 &TimerOrderRecorder::FireCancelled);
+  base::OneShotTimer<TimerOrderRecorder> last;
+  last.Start(FROM_HERE, TimeDelta::FromMilliseconds(20), &recorder,
+             &TimerOrderRecorder::FireA);
+  deleted.reset();
+
+  MessageLoop::current()->Run();
+
+  ASSERT_EQ(1u, recorder.fired().size());
+  EXPECT_EQ(0, recorder.fired()[0]);
+}
+
+}  // namespace
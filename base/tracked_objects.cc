@@ -7,15 +7,74 @@
 #include <math.h>
 
 #include "base/format_macros.h"
+#include "base/memory/task_allocator.h"
 #include "base/message_loop.h"
+#include "base/pickle.h"
 #include "base/string_util.h"
 #include "base/stringprintf.h"
+#include "base/threading/thread_local.h"
 #include "base/threading/thread_restrictions.h"
 
 using base::TimeDelta;
 
 namespace tracked_objects {
 
+namespace {
+
+// The initial number of slots in each of the ThreadData hash tables.
+const size_t kInitialTableSize = 64;
+
+// Version of the ThreadData::WriteBinarySnapshot() format.
+const int kBinarySnapshotVersion = 1;
+
+// Locations hold string literals, and Births are heap allocated, so the low
+// bits of these pointers carry little information.
+size_t HashPointer(const void* pointer) {
+  size_t value = reinterpret_cast<uintptr_t>(pointer);
+  return value ^ (value >> 4) ^ (value >> 12);
+}
+
+size_t HashLocation(const Location& location) {
+  return HashPointer(location.file_name()) * 31 +
+         HashPointer(location.function_name()) * 7 +
+         static_cast<size_t>(location.line_number());
+}
+
+// Like Location::operator<, this relies on the strings being unique.
+bool SameLocation(const Location& a, const Location& b) {
+  return a.line_number() == b.line_number() &&
+         a.file_name() == b.file_name() &&
+         a.function_name() == b.function_name();
+}
+
+// Assigns consecutive ids to strings, for WriteBinarySnapshot().
+class StringTable {
+ public:
+  int Intern(const std::string& str) {
+    std::map<std::string, int>::iterator it = ids_.find(str);
+    if (it != ids_.end())
+      return it->second;
+    int id = static_cast<int>(strings_.size());
+    ids_[str] = id;
+    strings_.push_back(str);
+    return id;
+  }
+
+  const std::vector<std::string>& strings() const { return strings_; }
+
+ private:
+  std::map<std::string, int> ids_;
+  std::vector<std::string> strings_;
+};
+
+#if defined(BASE_COMPILER_THREAD_LOCAL)
+// The same pointer as ThreadData::tls_index_ holds, which ThreadData::current()
+// reads instead where it can, as it is called for every task posted.
+BASE_COMPILER_THREAD_LOCAL ThreadData* g_current_thread_data = NULL;
+#endif
+
+}  // namespace
+
 // A TLS slot to the TrackRegistry for the current thread.
 // static
 base::ThreadLocalStorage::Slot ThreadData::tls_index_(base::LINKER_INITIALIZED);
@@ -28,10 +87,14 @@ AutoTracking::State AutoTracking::state_ = AutoTracking::kNeverBeenRun;
 // Death data tallies durations when a death takes place.
 
 void DeathData::RecordDeath(const TimeDelta& duration) {
-  ++count_;
-  life_duration_ += duration;
+  RecordDeaths(duration, 1);
+}
+
+void DeathData::RecordDeaths(const TimeDelta& duration, int count) {
+  count_ += count;
+  life_duration_ += duration * count;
   int64 milliseconds = duration.InMilliseconds();
-  square_duration_ += milliseconds * milliseconds;
+  square_duration_ += milliseconds * milliseconds * count;
 }
 
 int DeathData::AverageMsDuration() const {
@@ -77,7 +140,7 @@ BirthOnThread::BirthOnThread(const Location& location)
 //------------------------------------------------------------------------------
 Births::Births(const Location& location)
     : BirthOnThread(location),
-      birth_count_(1) { }
+      birth_count_(0) { }
 
 //------------------------------------------------------------------------------
 // ThreadData maintains the central data for all births and death.
@@ -90,7 +153,14 @@ base::Lock ThreadData::list_lock_;
 // static
 ThreadData::Status ThreadData::status_ = ThreadData::UNINITIALIZED;
 
-ThreadData::ThreadData() : next_(NULL) {
+// static
+int ThreadData::sampling_interval_ = 1;
+
+ThreadData::ThreadData()
+    : next_(NULL),
+      birth_table_used_(0),
+      death_table_used_(0),
+      sampling_countdown_(0) {
   // This shouldn't use the MessageLoop::current() LazyInstance since this might
   // be used on a non-joinable thread.
   // http://crbug.com/62728
@@ -105,6 +175,12 @@ ThreadData* ThreadData::current() {
   if (!tls_index_.initialized())
     return NULL;
 
+#if defined(BASE_COMPILER_THREAD_LOCAL)
+  bool compiler_storage_is_usable = base::CompilerThreadLocalIsUsable();
+  if (compiler_storage_is_usable && g_current_thread_data)
+    return g_current_thread_data;
+#endif
+
   ThreadData* registry = static_cast<ThreadData*>(tls_index_.Get());
   if (!registry) {
     // We have to create a new registry for ThreadData.
@@ -128,6 +204,10 @@ ThreadData* ThreadData::current() {
       tls_index_.Set(registry);
     }
   }
+#if defined(BASE_COMPILER_THREAD_LOCAL)
+  if (compiler_storage_is_usable)
+    g_current_thread_data = registry;
+#endif
   return registry;
 }
 
@@ -157,8 +237,24 @@ void ThreadData::WriteHTML(const std::string& query, std::string* output) {
 
   comparator.Sort(&match_array);
 
+  if (sampling_interval_ > 1) {
+    base::StringAppendF(output,
+                        "Sampling 1 in %d tasks; counts and durations are"
+                        " scaled estimates.<br><br>", sampling_interval_);
+  }
+
   WriteHTMLTotalAndSubtotals(match_array, comparator, output);
 
+  base::TaskAllocator::Stats allocator_stats;
+  base::TaskAllocator::GetStats(&allocator_stats);
+  base::StringAppendF(output,
+                      "<br>Task storage: %" PRId64 " allocations, %" PRId64
+                      " from thread caches, %" PRId64 " too large to cache;"
+                      " %" PRId64 " bytes cached by %d threads.<br>",
+                      allocator_stats.allocations, allocator_stats.cache_hits,
+                      allocator_stats.uncached_allocations,
+                      allocator_stats.cached_bytes, allocator_stats.threads);
+
   comparator.Clear();  // Delete tiebreaker_ instances.
 
   output->append("</pre>");
@@ -234,6 +330,15 @@ void ThreadData::WriteHTMLTotalAndSubtotals(
 }
 
 Births* ThreadData::TallyABirth(const Location& location) {
+  return TallyBirths(location, 1);
+}
+
+void ThreadData::TallyADeath(const Births& lifetimes,
+                             const TimeDelta& duration) {
+  TallyDeaths(lifetimes, duration, 1);
+}
+
+Births* ThreadData::TallyBirths(const Location& location, int count) {
   {
     // This shouldn't use the MessageLoop::current() LazyInstance since this
     // might be used on a non-joinable thread.
@@ -243,22 +348,29 @@ Births* ThreadData::TallyABirth(const Location& location) {
       message_loop_ = MessageLoop::current();  // Find it now.
   }
 
-  BirthMap::iterator it = birth_map_.find(location);
-  if (it != birth_map_.end()) {
-    it->second->RecordBirth();
-    return it->second;
+  if (!birth_table_.empty()) {
+    Births** slot = FindBirthSlot(location);
+    if (*slot) {
+      (*slot)->RecordBirths(count);
+      return *slot;
+    }
   }
 
   Births* tracker = new Births(location);
-  // Lock since the map may get relocated now, and other threads sometimes
+  tracker->RecordBirths(count);
+  // Lock since the table may get relocated now, and other threads sometimes
   // snapshot it (but they lock before copying it).
   base::AutoLock lock(lock_);
-  birth_map_[location] = tracker;
+  if ((birth_table_used_ + 1) * 4 > birth_table_.size() * 3)
+    GrowBirthTable();
+  *FindBirthSlot(location) = tracker;
+  ++birth_table_used_;
   return tracker;
 }
 
-void ThreadData::TallyADeath(const Births& lifetimes,
-                             const TimeDelta& duration) {
+void ThreadData::TallyDeaths(const Births& lifetimes,
+                             const TimeDelta& duration,
+                             int count) {
   {
     // http://crbug.com/62728
     base::ThreadRestrictions::ScopedAllowSingleton scoped_allow_singleton;
@@ -266,14 +378,60 @@ void ThreadData::TallyADeath(const Births& lifetimes,
       message_loop_ = MessageLoop::current();  // Find it now.
   }
 
-  DeathMap::iterator it = death_map_.find(&lifetimes);
-  if (it != death_map_.end()) {
-    it->second.RecordDeath(duration);
-    return;
+  if (!death_table_.empty()) {
+    DeathSlot* slot = FindDeathSlot(&lifetimes);
+    if (slot->births) {
+      slot->death_data.RecordDeaths(duration, count);
+      return;
+    }
+  }
+
+  base::AutoLock lock(lock_);  // Lock since the table may get relocated now.
+  if ((death_table_used_ + 1) * 4 > death_table_.size() * 3)
+    GrowDeathTable();
+  DeathSlot* slot = FindDeathSlot(&lifetimes);
+  slot->death_data.RecordDeaths(duration, count);
+  slot->births = &lifetimes;
+  ++death_table_used_;
+}
+
+Births** ThreadData::FindBirthSlot(const Location& location) {
+  size_t mask = birth_table_.size() - 1;
+  size_t index = HashLocation(location) & mask;
+  while (birth_table_[index] &&
+         !SameLocation(birth_table_[index]->location(), location))
+    index = (index + 1) & mask;
+  return &birth_table_[index];
+}
+
+ThreadData::DeathSlot* ThreadData::FindDeathSlot(const Births* lifetimes) {
+  size_t mask = death_table_.size() - 1;
+  size_t index = HashPointer(lifetimes) & mask;
+  while (death_table_[index].births && death_table_[index].births != lifetimes)
+    index = (index + 1) & mask;
+  return &death_table_[index];
+}
+
+void ThreadData::GrowBirthTable() {
+  lock_.AssertAcquired();
+  std::vector<Births*> old_table(
+      birth_table_.empty() ? kInitialTableSize : birth_table_.size() * 2);
+  old_table.swap(birth_table_);
+  for (size_t i = 0; i < old_table.size(); ++i) {
+    if (old_table[i])
+      *FindBirthSlot(old_table[i]->location()) = old_table[i];
   }
+}
 
-  base::AutoLock lock(lock_);  // Lock since the map may get relocated now.
-  death_map_[&lifetimes].RecordDeath(duration);
+void ThreadData::GrowDeathTable() {
+  lock_.AssertAcquired();
+  std::vector<DeathSlot> old_table(
+      death_table_.empty() ? kInitialTableSize : death_table_.size() * 2);
+  old_table.swap(death_table_);
+  for (size_t i = 0; i < old_table.size(); ++i) {
+    if (old_table[i].births)
+      *FindDeathSlot(old_table[i].births) = old_table[i];
+  }
 }
 
 // static
@@ -281,7 +439,12 @@ Births* ThreadData::TallyABirthIfActive(const Location& location) {
   if (IsActive()) {
     ThreadData* current_thread_data = current();
     if (current_thread_data) {
-      return current_thread_data->TallyABirth(location);
+      if (sampling_interval_ > 1) {
+        if (--current_thread_data->sampling_countdown_ > 0)
+          return NULL;
+        current_thread_data->sampling_countdown_ = sampling_interval_;
+      }
+      return current_thread_data->TallyBirths(location, sampling_interval_);
     }
   }
 
@@ -292,10 +455,17 @@ Births* ThreadData::TallyABirthIfActive(const Location& location) {
 void ThreadData::TallyADeathIfActive(const Births* the_birth,
                                      const base::TimeDelta& duration) {
   if (IsActive() && the_birth) {
-    current()->TallyADeath(*the_birth, duration);
+    current()->TallyDeaths(*the_birth, duration, sampling_interval_);
   }
 }
 
+// static
+void ThreadData::SetSamplingInterval(int interval) {
+  DCHECK_GE(interval, 1);
+  DCHECK(!IsActive());
+  sampling_interval_ = interval;
+}
+
 // static
 ThreadData* ThreadData::first() {
   base::AutoLock lock(list_lock_);
@@ -311,17 +481,114 @@ const std::string ThreadData::ThreadName() const {
 // This may be called from another thread.
 void ThreadData::SnapshotBirthMap(BirthMap *output) const {
   base::AutoLock lock(lock_);
-  for (BirthMap::const_iterator it = birth_map_.begin();
-       it != birth_map_.end(); ++it)
-    (*output)[it->first] = it->second;
+  for (size_t i = 0; i < birth_table_.size(); ++i) {
+    if (birth_table_[i])
+      (*output)[birth_table_[i]->location()] = birth_table_[i];
+  }
 }
 
 // This may be called from another thread.
 void ThreadData::SnapshotDeathMap(DeathMap *output) const {
   base::AutoLock lock(lock_);
-  for (DeathMap::const_iterator it = death_map_.begin();
-       it != death_map_.end(); ++it)
-    (*output)[it->first] = it->second;
+  for (size_t i = 0; i < death_table_.size(); ++i) {
+    if (death_table_[i].births)
+      (*output)[death_table_[i].births] = death_table_[i].death_data;
+  }
+}
+
+// static
+void ThreadData::WriteBinarySnapshot(std::string* output) {
+  if (!IsActive())
+    return;
+
+  ThreadData* my_list = first();
+  std::map<const ThreadData*, int> thread_indices;
+  std::vector<ThreadData::BirthMap> birth_maps;
+  std::vector<ThreadData::DeathMap> death_maps;
+  for (ThreadData* thread_data = my_list;
+       thread_data;
+       thread_data = thread_data->next()) {
+    int index = static_cast<int>(thread_indices.size());
+    thread_indices[thread_data] = index;
+    birth_maps.push_back(BirthMap());
+    thread_data->SnapshotBirthMap(&birth_maps.back());
+    death_maps.push_back(DeathMap());
+    thread_data->SnapshotDeathMap(&death_maps.back());
+  }
+
+  // The string table comes first, so intern every string before writing.
+  StringTable strings;
+  std::vector<int> thread_names(thread_indices.size());
+  for (ThreadData* thread_data = my_list;
+       thread_data;
+       thread_data = thread_data->next()) {
+    thread_names[thread_indices[thread_data]] =
+        strings.Intern(thread_data->ThreadName());
+  }
+  size_t birth_record_count = 0;
+  for (size_t i = 0; i < birth_maps.size(); ++i) {
+    for (BirthMap::const_iterator it = birth_maps[i].begin();
+         it != birth_maps[i].end(); ++it) {
+      strings.Intern(it->first.file_name());
+      strings.Intern(it->first.function_name());
+      ++birth_record_count;
+    }
+  }
+  size_t death_record_count = 0;
+  for (size_t i = 0; i < death_maps.size(); ++i) {
+    for (DeathMap::const_iterator it = death_maps[i].begin();
+         it != death_maps[i].end(); ++it) {
+      strings.Intern(it->first->location().file_name());
+      strings.Intern(it->first->location().function_name());
+      ++death_record_count;
+    }
+  }
+
+  Pickle pickle;
+  pickle.WriteInt(kBinarySnapshotVersion);
+  pickle.WriteInt(sampling_interval_);
+  pickle.WriteSize(strings.strings().size());
+  for (size_t i = 0; i < strings.strings().size(); ++i)
+    pickle.WriteString(strings.strings()[i]);
+  pickle.WriteSize(thread_names.size());
+  for (size_t i = 0; i < thread_names.size(); ++i)
+    pickle.WriteInt(thread_names[i]);
+
+  // Birth records: thread, file, function, line, count.
+  pickle.WriteSize(birth_record_count);
+  for (size_t i = 0; i < birth_maps.size(); ++i) {
+    for (BirthMap::const_iterator it = birth_maps[i].begin();
+         it != birth_maps[i].end(); ++it) {
+      pickle.WriteInt(static_cast<int>(i));
+      pickle.WriteInt(strings.Intern(it->first.file_name()));
+      pickle.WriteInt(strings.Intern(it->first.function_name()));
+      pickle.WriteInt(it->first.line_number());
+      pickle.WriteInt(it->second->birth_count());
+    }
+  }
+
+  // Death records: birth thread (-1 if unknown), file, function, line, death
+  // thread, count, total lifetime in microseconds, sum of squared lifetimes
+  // in milliseconds.
+  pickle.WriteSize(death_record_count);
+  for (size_t i = 0; i < death_maps.size(); ++i) {
+    for (DeathMap::const_iterator it = death_maps[i].begin();
+         it != death_maps[i].end(); ++it) {
+      const Location location = it->first->location();
+      std::map<const ThreadData*, int>::const_iterator birth_thread =
+          thread_indices.find(it->first->birth_thread());
+      pickle.WriteInt(birth_thread == thread_indices.end() ?
+                      -1 : birth_thread->second);
+      pickle.WriteInt(strings.Intern(location.file_name()));
+      pickle.WriteInt(strings.Intern(location.function_name()));
+      pickle.WriteInt(location.line_number());
+      pickle.WriteInt(static_cast<int>(i));
+      pickle.WriteInt(it->second.count());
+      pickle.WriteInt64(it->second.life_duration().InMicroseconds());
+      pickle.WriteInt64(it->second.square_duration());
+    }
+  }
+  output->append(static_cast<const char*>(pickle.data()), pickle.size());
 }
 
 // static
@@ -336,12 +603,12 @@ void ThreadData::ResetAllThreadData() {
 
 void ThreadData::Reset() {
   base::AutoLock lock(lock_);
-  for (DeathMap::iterator it = death_map_.begin();
-       it != death_map_.end(); ++it)
-    it->second.Clear();
-  for (BirthMap::iterator it = birth_map_.begin();
-       it != birth_map_.end(); ++it)
-    it->second->Clear();
+  for (size_t i = 0; i < death_table_.size(); ++i)
+    death_table_[i].death_data.Clear();
+  for (size_t i = 0; i < birth_table_.size(); ++i) {
+    if (birth_table_[i])
+      birth_table_[i]->Clear();
+  }
 }
 
 #ifdef OS_WIN
@@ -500,14 +767,18 @@ void ThreadData::ShutdownSingleThreadedCleanup() {
     ThreadData* next_thread_data = thread_data_list;
     thread_data_list = thread_data_list->next();
 
-    for (BirthMap::iterator it = next_thread_data->birth_map_.begin();
-         next_thread_data->birth_map_.end() != it; ++it)
-      delete it->second;  // Delete the Birth Records.
-    next_thread_data->birth_map_.clear();
-    next_thread_data->death_map_.clear();
+    for (size_t i = 0; i < next_thread_data->birth_table_.size(); ++i)
+      delete next_thread_data->birth_table_[i];  // Delete the Birth Records.
+    next_thread_data->birth_table_.clear();
+    next_thread_data->death_table_.clear();
     delete next_thread_data;  // Includes all Death Records.
   }
 
+#if defined(BASE_COMPILER_THREAD_LOCAL)
+  // The only thread left is this one, the others' storage is gone with them.
+  if (base::CompilerThreadLocalIsUsable())
+    g_current_thread_data = NULL;
+#endif
   CHECK(tls_index_.initialized());
   tls_index_.Free();
   DCHECK(!tls_index_.initialized());
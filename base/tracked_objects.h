@@ -190,6 +190,9 @@ class BASE_EXPORT Births: public BirthOnThread {
   // When we have a birth we update the count for this BirhPLace.
   void RecordBirth() { ++birth_count_; }
 
+  // When sampling, each recorded birth stands for |count| births.
+  void RecordBirths(int count) { birth_count_ += count; }
+
   // When a birthplace is changed (updated), we need to decrement the counter
   // for the old instance.
   void ForgetBirth() { --birth_count_; }  // We corrected a birth place.
@@ -221,6 +224,10 @@ class BASE_EXPORT DeathData {
 
   void RecordDeath(const base::TimeDelta& duration);
 
+  // When sampling, each recorded death stands for |count| deaths of the same
+  // duration.
+  void RecordDeaths(const base::TimeDelta& duration, int count);
+
   // Metrics accessors.
   int count() const { return count_; }
   base::TimeDelta life_duration() const { return life_duration_; }
@@ -499,11 +506,21 @@ class BASE_EXPORT ThreadData {
 
   // Helper methods to only tally if the current thread has tracking active.
   //
-  // TallyABirthIfActive will returns NULL if the birth cannot be tallied.
+  // TallyABirthIfActive will returns NULL if the birth cannot be tallied, or
+  // if it was not sampled (see SetSamplingInterval()).
   static Births* TallyABirthIfActive(const Location& location);
   static void TallyADeathIfActive(const Births* lifetimes,
                                   const base::TimeDelta& duration);
 
+  // Only tally one in |interval| of the births passed to TallyABirthIfActive()
+  // on each thread (and the deaths of those births), weighting each tallied
+  // one by |interval| so that the reported counts and durations are estimates
+  // of the totals.  The default interval of 1 tallies everything.  This must
+  // be called before StartTracking(), so that deaths are weighted like the
+  // births they match.
+  static void SetSamplingInterval(int interval);
+  static int sampling_interval() { return sampling_interval_; }
+
   // (Thread safe) Get start of list of instances.
   static ThreadData* first();
   // Iterate through the null terminated list of instances.
@@ -518,6 +535,15 @@ class BASE_EXPORT ThreadData {
   void SnapshotBirthMap(BirthMap *output) const;
   void SnapshotDeathMap(DeathMap *output) const;
 
+  // Append a compact binary (Pickle) encoding of the births and deaths of all
+  // threads to |output|, for consumers that do their own aggregation.  The
+  // pickle holds a version, the sampling interval, a table of strings (file
+  // names, function names and thread names), the index of each thread's name
+  // in that table, and then the birth and death records, which refer to
+  // threads and strings by index.  Counts and durations are already weighted
+  // by the sampling interval.
+  static void WriteBinarySnapshot(std::string* output);
+
   // Hack: asynchronously clear all birth counts and death tallies data values
   // in all ThreadData instances.  The numerical (zeroing) part is done without
   // use of a locks or atomics exchanges, and may (for int64 values) produce
@@ -574,6 +600,28 @@ class BASE_EXPORT ThreadData {
   class RunTheStatic;
 #endif
 
+  // One slot of death_table_.
+  struct DeathSlot {
+    DeathSlot() : births(NULL) {}
+
+    const Births* births;  // NULL for an empty slot.
+    DeathData death_data;
+  };
+
+  // Tally |count| births, or deaths, at once.
+  Births* TallyBirths(const Location& location, int count);
+  void TallyDeaths(const Births& lifetimes, const base::TimeDelta& duration,
+                   int count);
+
+  // Find the slot of the tables below holding |location| or |lifetimes|, or
+  // the empty slot where it belongs.  The tables must not be empty.
+  Births** FindBirthSlot(const Location& location);
+  DeathSlot* FindDeathSlot(const Births* lifetimes);
+
+  // Double the size of a table, with lock_ held.
+  void GrowBirthTable();
+  void GrowDeathTable();
+
   // Each registered thread is called to set status_ to SHUTDOWN.
   // This is done redundantly on every registered thread because it is not
   // protected by a mutex.  Running on all threads guarantees we get the
@@ -594,6 +642,9 @@ class BASE_EXPORT ThreadData {
   // and avoid additional calls into the  service.
   static Status status_;
 
+  // See SetSamplingInterval().
+  static int sampling_interval_;
+
   // Link to next instance (null terminated list). Used to globally track all
   // registered instances (corresponds to all registered threads where we keep
   // data).
@@ -604,19 +655,27 @@ class BASE_EXPORT ThreadData {
   // instances have data that can't be (safely) modified externally.
   MessageLoop* message_loop_;
 
-  // A map used on each thread to keep track of Births on this thread.
-  // This map should only be accessed on the thread it was constructed on.
+  // An open addressing hash table (power of two size, linear probing, NULL
+  // for empty slots) used on each thread to keep track of Births on this
+  // thread.  Slots are only filled, never emptied, so a tally costs a hash and
+  // usually one probe, with no allocation once a location has been seen.
+  // This table should only be written on the thread it was constructed on.
   // When a snapshot is needed, this structure can be locked in place for the
   // duration of the snapshotting activity.
-  BirthMap birth_map_;
+  std::vector<Births*> birth_table_;
+  size_t birth_table_used_;
 
-  // Similar to birth_map_, this records informations about death of tracked
+  // Similar to birth_table_, this records informations about death of tracked
   // instances (i.e., when a tracked instance was destroyed on this thread).
-  // It is locked before changing, and hence other threads may access it by
-  // locking before reading it.
-  DeathMap death_map_;
+  // It is locked before adding a slot, and hence other threads may access it
+  // by locking before reading it.
+  std::vector<DeathSlot> death_table_;
+  size_t death_table_used_;
+
+  // Countdown to the next sampled birth on this thread.
+  int sampling_countdown_;
 
-  // Lock to protect *some* access to BirthMap and DeathMap.  The maps are
+  // Lock to protect *some* access to the birth and death tables.  They are
   // regularly read and written on this thread, but may only be read from other
   // threads.  To support this, we acquire this lock if we are writing from this
   // thread, or reading from another thread.  For reading from this thread we
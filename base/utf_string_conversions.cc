@@ -15,12 +15,50 @@ using base::WriteUnicodeCharacter;
 
 namespace {
 
+// ASCII runs ------------------------------------------------------------------
+
+// Returns the bits that are set in a machine word of CHARs only if one of them
+// is not ASCII: 0x80 in each byte for char, 0xFF80 in each unit for char16.
+template<typename CHAR>
+uintptr_t NonASCIIMask() {
+  typedef typename ToUnsigned<CHAR>::Unsigned UnsignedChar;
+  const uintptr_t max_char = static_cast<UnsignedChar>(~0);
+  return (~static_cast<uintptr_t>(0) / max_char) * (max_char - 0x7F);
+}
+
+// Returns how many of the |src_len| characters at |src| are ASCII before the
+// first one that isn't. Text is mostly ASCII, so the characters are checked a
+// machine word at a time once |src| is aligned. This is portable C++ rather
+// than SSE2, which not all of the x86 machines we run on have.
+template<typename CHAR>
+size_t CountASCII(const CHAR* src, size_t src_len) {
+  typedef typename ToUnsigned<CHAR>::Unsigned UnsignedChar;
+  const size_t kCharsPerWord = sizeof(uintptr_t) / sizeof(CHAR);
+  const uintptr_t non_ascii_mask = NonASCIIMask<CHAR>();
+
+  size_t i = 0;
+  while (i < src_len &&
+         (reinterpret_cast<uintptr_t>(src + i) & (sizeof(uintptr_t) - 1))) {
+    if (static_cast<UnsignedChar>(src[i]) > 0x7F)
+      return i;
+    ++i;
+  }
+  while (i + kCharsPerWord <= src_len &&
+         !(*reinterpret_cast<const uintptr_t*>(src + i) & non_ascii_mask)) {
+    i += kCharsPerWord;
+  }
+  while (i < src_len && static_cast<UnsignedChar>(src[i]) <= 0x7F)
+    ++i;
+  return i;
+}
+
 // Generalized Unicode converter -----------------------------------------------
 
 // Converts the given source Unicode character type to the given destination
 // Unicode character type as a STL string. The given input buffer and size
-// determine the source, and the given output STL string will be replaced by
-// the result.
+// determine the source, and the result is appended to the given output STL
+// string. Runs of ASCII, which are the same in every encoding, are appended
+// at once; the other characters are decoded one at a time.
 template<typename SRC_CHAR, typename DEST_STRING>
 bool ConvertUnicode(const SRC_CHAR* src,
                     size_t src_len,
@@ -29,6 +67,14 @@ bool ConvertUnicode(const SRC_CHAR* src,
   bool success = true;
   int32 src_len32 = static_cast<int32>(src_len);
   for (int32 i = 0; i < src_len32; i++) {
+    size_t ascii_len = CountASCII(src + i, src_len - i);
+    if (ascii_len) {
+      output->append(src + i, src + i + ascii_len);
+      i += static_cast<int32>(ascii_len);
+      if (i == src_len32)
+        break;
+    }
+
     uint32 code_point;
     if (ReadUnicodeCharacter(src, src_len32, &i, &code_point)) {
       WriteUnicodeCharacter(code_point, output);
@@ -41,6 +87,13 @@ bool ConvertUnicode(const SRC_CHAR* src,
   return success;
 }
 
+// Makes room at the end of |output| for the conversion of |src_len|
+// characters, guessing that they are ASCII.
+template<typename STRING>
+void ReserveForAppend(size_t src_len, STRING* output) {
+  output->reserve(output->size() + src_len);
+}
+
 }  // namespace
 
 // UTF-8 <-> Wide --------------------------------------------------------------
@@ -69,6 +122,18 @@ std::wstring UTF8ToWide(const base::StringPiece& utf8) {
   return ret;
 }
 
+bool AppendWideToUTF8(const wchar_t* src, size_t src_len,
+                      std::string* output) {
+  ReserveForAppend(src_len, output);
+  return ConvertUnicode(src, src_len, output);
+}
+
+bool AppendUTF8ToWide(const char* src, size_t src_len,
+                      std::wstring* output) {
+  ReserveForAppend(src_len, output);
+  return ConvertUnicode(src, src_len, output);
+}
+
 // UTF-16 <-> Wide -------------------------------------------------------------
 
 #if defined(WCHAR_T_IS_UTF16)
@@ -154,6 +219,17 @@ std::string UTF16ToUTF8(const string16& utf16) {
   return ret;
 }
 
+bool AppendUTF8ToUTF16(const char* src, size_t src_len, string16* output) {
+  ReserveForAppend(src_len, output);
+  return ConvertUnicode(src, src_len, output);
+}
+
+bool AppendUTF16ToUTF8(const char16* src, size_t src_len,
+                       std::string* output) {
+  ReserveForAppend(src_len, output);
+  return ConvertUnicode(src, src_len, output);
+}
+
 #elif defined(WCHAR_T_IS_UTF16)
 // Easy case since we can use the "wide" versions we already wrote above.
 
@@ -173,6 +249,15 @@ std::string UTF16ToUTF8(const string16& utf16) {
   return WideToUTF8(utf16);
 }
 
+bool AppendUTF8ToUTF16(const char* src, size_t src_len, string16* output) {
+  return AppendUTF8ToWide(src, src_len, output);
+}
+
+bool AppendUTF16ToUTF8(const char16* src, size_t src_len,
+                       std::string* output) {
+  return AppendWideToUTF8(src, src_len, output);
+}
+
 #endif
 
 std::wstring ASCIIToWide(const base::StringPiece& ascii) {
@@ -38,6 +38,19 @@ BASE_EXPORT bool UTF16ToUTF8(const char16* src, size_t src_len,
                              std::string* output);
 BASE_EXPORT std::string UTF16ToUTF8(const string16& utf16);
 
+// These append the conversion to |output| rather than replacing it, so that
+// a string can be built from several pieces without a temporary for each.
+// Like the low-level versions above, they return whether the conversion was
+// 100% valid.
+BASE_EXPORT bool AppendWideToUTF8(const wchar_t* src, size_t src_len,
+                                  std::string* output);
+BASE_EXPORT bool AppendUTF8ToWide(const char* src, size_t src_len,
+                                  std::wstring* output);
+BASE_EXPORT bool AppendUTF8ToUTF16(const char* src, size_t src_len,
+                                   string16* output);
+BASE_EXPORT bool AppendUTF16ToUTF8(const char16* src, size_t src_len,
+                                   std::string* output);
+
 // We are trying to get rid of wstring as much as possible, but it's too big
 // a mess to do it all at once.  These conversions should be used when we
 // really should just be passing a string16 around, but we haven't finished
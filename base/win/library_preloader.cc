@@ -0,0 +1,90 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/win/library_preloader.h"
+
+#include <algorithm>
+
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/metrics/startup_timeline.h"
+#include "base/threading/thread_restrictions.h"
+#include "base/threading/worker_pool.h"
+#include "base/win/pe_image.h"
+
+namespace base {
+namespace win {
+
+namespace {
+
+bool PrefetchSection(const PEImage& image,
+                     PIMAGE_SECTION_HEADER header,
+                     PVOID section_start,
+                     DWORD section_size,
+                     PVOID cookie) {
+  // Uninitialized data is zero-filled rather than read, and discardable
+  // sections, such as the relocations, are done with once the image is
+  // loaded.
+  if (header->Characteristics &
+      (IMAGE_SCN_CNT_UNINITIALIZED_DATA | IMAGE_SCN_MEM_DISCARDABLE)) {
+    return true;
+  }
+  DWORD page_size = *reinterpret_cast<DWORD*>(cookie);
+  DWORD size = std::min(section_size, header->SizeOfRawData);
+  const volatile char* start =
+      static_cast<const volatile char*>(section_start);
+  for (DWORD offset = 0; offset < size; offset += page_size)
+    start[offset];
+  return true;
+}
+
+}  // namespace
+
+// static
+void LibraryPreloader::PreloadAsync(
+    const std::vector<string16>& library_names) {
+  WorkerPool::PostTask(
+      FROM_HERE,
+      Bind(&LibraryPreloader::PreloadLibraries, library_names),
+      false);
+}
+
+// static
+HMODULE LibraryPreloader::Preload(const string16& library_name) {
+  // LoadLibrary() opens the file off disk.
+  ThreadRestrictions::AssertIOAllowed();
+
+  HMODULE module = LoadLibraryEx(library_name.c_str(), NULL, 0);
+  if (!module) {
+    DLOG(WARNING) << "Can't preload " << library_name << ": "
+                  << GetLastError();
+    return NULL;
+  }
+  PrefetchImage(module);
+  return module;
+}
+
+// static
+void LibraryPreloader::PrefetchImage(HMODULE module) {
+  PEImage image(module);
+  if (!image.VerifyMagic())
+    return;
+  SYSTEM_INFO system_info;
+  GetSystemInfo(&system_info);
+  DWORD page_size = system_info.dwPageSize;
+  image.EnumSections(&PrefetchSection, &page_size);
+}
+
+// static
+void LibraryPreloader::PreloadLibraries(
+    const std::vector<string16>& library_names) {
+  // The modules are never freed, so that they stay loaded until first used.
+  for (size_t i = 0; i < library_names.size(); ++i)
+    Preload(library_names[i]);
+  StartupTimeline::RecordMilestone("LibraryPreload");
+}
+
+}  // namespace win
+}  // namespace base
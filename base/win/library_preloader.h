@@ -0,0 +1,55 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_WIN_LIBRARY_PRELOADER_H_
+#define BASE_WIN_LIBRARY_PRELOADER_H_
+#pragma once
+
+#include <windows.h>
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/string16.h"
+
+namespace base {
+namespace win {
+
+// Loads the DLLs that a process loads on first use, such as uxtheme.dll for
+// NativeThemeWin, d3d10.dll for the compositor or dbghelp.dll for stack
+// traces, on a worker thread at startup. That way their first use on the UI
+// thread finds them mapped and their pages in memory, rather than waiting
+// for the disk. The libraries stay loaded for the life of the process, so a
+// later LoadLibrary() of one only takes a reference to it.
+//
+// Loading a library holds the loader lock, so a LoadLibrary() on another
+// thread while a preload runs waits for it; that never takes longer than
+// loading the library there would have.
+class BASE_EXPORT LibraryPreloader {
+ public:
+  // Starts loading |library_names| on a worker thread, in order. They are
+  // searched for the way LoadLibrary() does; the ones that are not found are
+  // skipped. Records the "LibraryPreload" StartupTimeline milestone when the
+  // last is loaded.
+  static void PreloadAsync(const std::vector<string16>& library_names);
+
+  // Loads |library_name| and prefetches it on the calling thread. Returns
+  // NULL if it can't be loaded.
+  static HMODULE Preload(const string16& library_name);
+
+  // Reads a byte of each page of the sections of |module| that are in its
+  // file, so that the page faults happen now rather than at first use.
+  static void PrefetchImage(HMODULE module);
+
+ private:
+  static void PreloadLibraries(const std::vector<string16>& library_names);
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(LibraryPreloader);
+};
+
+}  // namespace win
+}  // namespace base
+
+#endif  // BASE_WIN_LIBRARY_PRELOADER_H_
@@ -6,6 +6,8 @@
 
 #include <shlwapi.h>
 
+#include <algorithm>
+
 #include "base/logging.h"
 #include "base/threading/thread_restrictions.h"
 
@@ -14,6 +16,51 @@
 namespace base {
 namespace win {
 
+namespace {
+
+// The longest string the std::wstring ReadValue()s return, after expansion.
+const size_t kMaxStringLength = 1024;
+
+// The conversions of the typed ReadValue()s, from the |type| and data of a
+// value.
+LONG StringFromValue(const wchar_t* raw_value,
+                     DWORD type,
+                     std::wstring* value) {
+  if (type == REG_SZ) {
+    *value = raw_value;
+  } else if (type == REG_EXPAND_SZ) {
+    wchar_t expanded[kMaxStringLength];
+    DWORD size = ExpandEnvironmentStrings(raw_value, expanded,
+                                          kMaxStringLength);
+    // Success: returns the number of wchar_t's copied
+    // Fail: buffer too small, returns the size required
+    // Fail: other, returns 0
+    if (size == 0 || size > kMaxStringLength)
+      return ERROR_MORE_DATA;
+    *value = expanded;
+  } else {
+    // Not a string. Oops.
+    return ERROR_CANTREAD;
+  }
+  return ERROR_SUCCESS;
+}
+
+LONG DWORDFromValue(const void* data, DWORD size, DWORD type, DWORD* value) {
+  if ((type != REG_DWORD && type != REG_BINARY) || size != sizeof(DWORD))
+    return ERROR_CANTREAD;
+  memcpy(value, data, sizeof(DWORD));
+  return ERROR_SUCCESS;
+}
+
+LONG Int64FromValue(const void* data, DWORD size, DWORD type, int64* value) {
+  if ((type != REG_QWORD && type != REG_BINARY) || size != sizeof(int64))
+    return ERROR_CANTREAD;
+  memcpy(value, data, sizeof(int64));
+  return ERROR_SUCCESS;
+}
+
+}  // namespace
+
 // RegKey ----------------------------------------------------------------------
 
 RegKey::RegKey()
@@ -152,30 +199,12 @@ LONG RegKey::ReadValue(const wchar_t* name, void* data, DWORD* dsize,
 LONG RegKey::ReadValue(const wchar_t* name, std::wstring* value) const {
   base::ThreadRestrictions::AssertIOAllowed();
   DCHECK(value);
-  const size_t kMaxStringLength = 1024;  // This is after expansion.
   // Use the one of the other forms of ReadValue if 1024 is too small for you.
   wchar_t raw_value[kMaxStringLength];
   DWORD type = REG_SZ, size = sizeof(raw_value);
   LONG result = ReadValue(name, raw_value, &size, &type);
-  if (result == ERROR_SUCCESS) {
-    if (type == REG_SZ) {
-      *value = raw_value;
-    } else if (type == REG_EXPAND_SZ) {
-      wchar_t expanded[kMaxStringLength];
-      size = ExpandEnvironmentStrings(raw_value, expanded, kMaxStringLength);
-      // Success: returns the number of wchar_t's copied
-      // Fail: buffer too small, returns the size required
-      // Fail: other, returns 0
-      if (size == 0 || size > kMaxStringLength) {
-        result = ERROR_MORE_DATA;
-      } else {
-        *value = expanded;
-      }
-    } else {
-      // Not a string. Oops.
-      result = ERROR_CANTREAD;
-    }
-  }
+  if (result == ERROR_SUCCESS)
+    result = StringFromValue(raw_value, type, value);
 
   return result;
 }
@@ -186,13 +215,8 @@ LONG RegKey::ReadValueDW(const wchar_t* name, DWORD* value) const {
   DWORD size = sizeof(DWORD);
   DWORD local_value = 0;
   LONG result = ReadValue(name, &local_value, &size, &type);
-  if (result == ERROR_SUCCESS) {
-    if ((type == REG_DWORD || type == REG_BINARY) && size == sizeof(DWORD)) {
-      *value = local_value;
-    } else {
-      result = ERROR_CANTREAD;
-    }
-  }
+  if (result == ERROR_SUCCESS)
+    result = DWORDFromValue(&local_value, size, type, value);
 
   return result;
 }
@@ -203,14 +227,8 @@ LONG RegKey::ReadInt64(const wchar_t* name, int64* value) const {
   int64 local_value = 0;
   DWORD size = sizeof(local_value);
   LONG result = ReadValue(name, &local_value, &size, &type);
-  if (result == ERROR_SUCCESS) {
-    if ((type == REG_QWORD || type == REG_BINARY) &&
-        size == sizeof(local_value)) {
-      *value = local_value;
-    } else {
-      result = ERROR_CANTREAD;
-    }
-  }
+  if (result == ERROR_SUCCESS)
+    result = Int64FromValue(&local_value, size, type, value);
 
   return result;
 }
@@ -274,6 +292,155 @@ LONG RegKey::StopWatching() {
   return result;
 }
 
+// RegistryValueSnapshot ------------------------------------------------------
+
+RegistryValueSnapshot::Value::Value()
+    : type(REG_NONE) {
+}
+
+RegistryValueSnapshot::Value::~Value() {
+}
+
+bool RegistryValueSnapshot::NameLess::operator()(const std::wstring& a,
+                                                 const std::wstring& b) const {
+  return _wcsicmp(a.c_str(), b.c_str()) < 0;
+}
+
+RegistryValueSnapshot::RegistryValueSnapshot(HKEY rootkey,
+                                             const wchar_t* subkey)
+    : key_(rootkey, subkey, KEY_QUERY_VALUE | KEY_NOTIFY) {
+  if (!key_.Valid())
+    return;
+  // Watch first, so that a change made while the values are read reloads
+  // them.
+  key_.StartWatching();
+  Reload();
+}
+
+RegistryValueSnapshot::~RegistryValueSnapshot() {
+}
+
+LONG RegistryValueSnapshot::Reload() {
+  base::ThreadRestrictions::AssertIOAllowed();
+  values_.clear();
+  if (!key_.Valid())
+    return ERROR_INVALID_HANDLE;
+
+  DWORD count = 0, max_name_length = 0, max_data_size = 0;
+  LONG result = ::RegQueryInfoKey(key_.Handle(), NULL, NULL, NULL, NULL, NULL,
+                                  NULL, &count, &max_name_length,
+                                  &max_data_size, NULL, NULL);
+  if (result != ERROR_SUCCESS)
+    return result;
+
+  // The buffers fit the longest name and data, so that each value takes one
+  // RegEnumValue call, unless it grew since.
+  std::vector<wchar_t> name(max_name_length + 1);
+  std::vector<BYTE> data(std::max<DWORD>(max_data_size, 1));
+  DWORD index = 0;
+  while (index < count) {
+    DWORD name_length = static_cast<DWORD>(name.size());
+    DWORD data_size = static_cast<DWORD>(data.size());
+    DWORD type = REG_NONE;
+    result = ::RegEnumValue(key_.Handle(), index, &name[0], &name_length, NULL,
+                            &type, &data[0], &data_size);
+    if (result == ERROR_MORE_DATA) {
+      name.resize(std::max<size_t>(name.size() * 2, MAX_PATH));
+      data.resize(std::max<size_t>(data.size(), data_size));
+      continue;
+    }
+    if (result == ERROR_NO_MORE_ITEMS)
+      break;
+    if (result != ERROR_SUCCESS)
+      return result;
+
+    Value& value = values_[std::wstring(&name[0], name_length)];
+    value.type = type;
+    value.data.assign(data.begin(), data.begin() + data_size);
+    ++index;
+  }
+  return ERROR_SUCCESS;
+}
+
+DWORD RegistryValueSnapshot::ValueCount() {
+  ReloadIfChanged();
+  return static_cast<DWORD>(values_.size());
+}
+
+bool RegistryValueSnapshot::ValueExists(const wchar_t* name) {
+  return FindValue(name) != NULL;
+}
+
+LONG RegistryValueSnapshot::ReadValue(const wchar_t* name, void* data,
+                                      DWORD* dsize, DWORD* dtype) {
+  DCHECK(!data || dsize);
+  const Value* value = FindValue(name);
+  if (!value)
+    return ERROR_FILE_NOT_FOUND;
+  DWORD size = static_cast<DWORD>(value->data.size());
+  if (dtype)
+    *dtype = value->type;
+  if (data && dsize && *dsize < size) {
+    *dsize = size;
+    return ERROR_MORE_DATA;
+  }
+  if (data && size)
+    memcpy(data, &value->data[0], size);
+  if (dsize)
+    *dsize = size;
+  return ERROR_SUCCESS;
+}
+
+LONG RegistryValueSnapshot::ReadValue(const wchar_t* name,
+                                      std::wstring* value) {
+  DCHECK(value);
+  const Value* raw_value = FindValue(name);
+  if (!raw_value)
+    return ERROR_FILE_NOT_FOUND;
+  if (raw_value->type != REG_SZ && raw_value->type != REG_EXPAND_SZ)
+    return ERROR_CANTREAD;
+  // The data may not be NUL terminated.
+  std::wstring string;
+  if (!raw_value->data.empty()) {
+    string.assign(reinterpret_cast<const wchar_t*>(&raw_value->data[0]),
+                  raw_value->data.size() / sizeof(wchar_t));
+  }
+  return StringFromValue(string.c_str(), raw_value->type, value);
+}
+
+LONG RegistryValueSnapshot::ReadValueDW(const wchar_t* name, DWORD* value) {
+  DCHECK(value);
+  const Value* raw_value = FindValue(name);
+  if (!raw_value)
+    return ERROR_FILE_NOT_FOUND;
+  return DWORDFromValue(
+      raw_value->data.empty() ? NULL : &raw_value->data[0],
+      static_cast<DWORD>(raw_value->data.size()), raw_value->type, value);
+}
+
+LONG RegistryValueSnapshot::ReadInt64(const wchar_t* name, int64* value) {
+  DCHECK(value);
+  const Value* raw_value = FindValue(name);
+  if (!raw_value)
+    return ERROR_FILE_NOT_FOUND;
+  return Int64FromValue(
+      raw_value->data.empty() ? NULL : &raw_value->data[0],
+      static_cast<DWORD>(raw_value->data.size()), raw_value->type, value);
+}
+
+void RegistryValueSnapshot::ReloadIfChanged() {
+  if (key_.HasChanged())
+    Reload();
+}
+
+const RegistryValueSnapshot::Value* RegistryValueSnapshot::FindValue(
+    const wchar_t* name) {
+  ReloadIfChanged();
+  // NULL and "" name the key's default value.
+  ValueMap::const_iterator i = values_.find(name ? name : L"");
+  return i == values_.end() ? NULL : &i->second;
+}
+
 // RegistryValueIterator ------------------------------------------------------
 
 RegistryValueIterator::RegistryValueIterator(HKEY root_key,
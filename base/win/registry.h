@@ -7,7 +7,9 @@
 #pragma once
 
 #include <windows.h>
+#include <map>
 #include <string>
+#include <vector>
 
 #include "base/base_export.h"
 #include "base/basictypes.h"
@@ -95,6 +97,69 @@ class BASE_EXPORT RegKey {
   DISALLOW_COPY_AND_ASSIGN(RegKey);
 };
 
+// A copy of all the values of a key, read in one enumeration, that the
+// ReadValue family reads without going to the registry. For code that reads
+// many values of a key, or the same values repeatedly: RegKey makes a
+// RegQueryValueEx call per read.
+//
+// The key is watched with RegNotifyChangeKeyValue, and the values read again
+// on the first read after it, or one of its subkeys, changes. If the key
+// can't be watched, the values are only read again by Reload(). The reads
+// aren't const, as they may reload. Like RegKey, the methods follow the
+// ReadValue guarantees, and the class isn't thread safe.
+class BASE_EXPORT RegistryValueSnapshot {
+ public:
+  RegistryValueSnapshot(HKEY rootkey, const wchar_t* subkey);
+  ~RegistryValueSnapshot();
+
+  // True if the key could be opened.
+  bool Valid() const { return key_.Valid(); }
+
+  // True while the key is watched for changes.
+  bool IsWatching() const { return key_.IsWatching(); }
+
+  // Reads all the values of the key again.
+  LONG Reload();
+
+  DWORD ValueCount();
+
+  bool ValueExists(const wchar_t* name);
+
+  // The same as RegKey's. The first fails with ERROR_MORE_DATA, setting
+  // |*dsize| to the size needed, as RegQueryValueEx does.
+  LONG ReadValue(const wchar_t* name, void* data, DWORD* dsize, DWORD* dtype);
+  LONG ReadValue(const wchar_t* name, std::wstring* value);
+  LONG ReadValueDW(const wchar_t* name, DWORD* value);
+  LONG ReadInt64(const wchar_t* name, int64* value);
+
+ private:
+  struct Value {
+    Value();
+    ~Value();
+
+    DWORD type;
+    std::vector<BYTE> data;
+  };
+
+  // Orders the value names as the registry does, ignoring case.
+  struct NameLess {
+    bool operator()(const std::wstring& a, const std::wstring& b) const;
+  };
+
+  typedef std::map<std::wstring, Value, NameLess> ValueMap;
+
+  // Reads the values again if the key changed since they were read.
+  void ReloadIfChanged();
+
+  // Returns the value |name| after ReloadIfChanged(), or NULL.
+  const Value* FindValue(const wchar_t* name);
+
+  RegKey key_;
+  ValueMap values_;
+
+  DISALLOW_COPY_AND_ASSIGN(RegistryValueSnapshot);
+};
+
 // Iterates the entries found in a particular folder on the registry.
 // For this application I happen to know I wont need data size larger
 // than MAX_PATH, but in real life this wouldn't neccessarily be
@@ -11,11 +11,13 @@
 #include <sddl.h>
 #include <shlobj.h>
 
+#include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/win/registry.h"
 #include "base/string_util.h"
 #include "base/stringprintf.h"
+#include "base/synchronization/lock.h"
 #include "base/threading/thread_restrictions.h"
 #include "base/win/scoped_handle.h"
 #include "base/win/windows_version.h"
@@ -23,6 +25,24 @@
 namespace base {
 namespace win {
 
+namespace {
+
+const wchar_t kSystemPoliciesKeyPath[] =
+    L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Policies\\System";
+
+// The system policies key, which UserAccountControlIsEnabled() reads.
+struct SystemPolicies {
+  SystemPolicies() : values(HKEY_LOCAL_MACHINE, kSystemPoliciesKeyPath) {}
+
+  Lock lock;
+  RegistryValueSnapshot values;  // Protected by |lock|.
+};
+
+LazyInstance<SystemPolicies, LeakyLazyInstanceTraits<SystemPolicies> >
+    g_system_policies(LINKER_INITIALIZED);
+
+}  // namespace
+
 #define SIZEOF_STRUCT_WITH_SPECIFIED_LAST_MEMBER(struct_name, member) \
     offsetof(struct_name, member) + \
     (sizeof static_cast<struct_name*>(NULL)->member)
@@ -84,16 +104,16 @@ bool IsAltPressed() {
 }
 
 bool UserAccountControlIsEnabled() {
-  // This can be slow if Windows ends up going to disk.  Should watch this key
-  // for changes and only read it once, preferably on the file thread.
+  // This can be slow if Windows ends up going to disk, so the key is only
+  // read again once it changes.
   //   http://code.google.com/p/chromium/issues/detail?id=61644
   base::ThreadRestrictions::ScopedAllowIO allow_io;
 
-  base::win::RegKey key(HKEY_LOCAL_MACHINE,
-      L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Policies\\System",
-      KEY_READ);
+  SystemPolicies* policies = g_system_policies.Pointer();
+  AutoLock lock(policies->lock);
   DWORD uac_enabled;
-  if (key.ReadValueDW(L"EnableLUA", &uac_enabled) != ERROR_SUCCESS)
+  if (policies->values.ReadValueDW(L"EnableLUA", &uac_enabled) !=
+      ERROR_SUCCESS)
     return true;
   // Users can set the EnableLUA value to something arbitrary, like 2, which
   // Vista will treat as UAC enabled, so we make sure it is not set to 0.
@@ -0,0 +1,439 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/zlib_stream.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/synchronization/lock.h"
+
+#if defined(USE_SYSTEM_ZLIB)
+#include <zlib.h>
+#else
+#include "third_party/zlib/zlib.h"
+#endif
+
+namespace base {
+
+namespace {
+
+// The size of the output buffer of each stream. The output goes out in
+// chunks of at most this size.
+const size_t kBufferSize = 16 * 1024;
+
+// The most that Run() gives zlib at once, which counts in uInts.
+const size_t kMaxRunSize = 1 << 30;
+
+// The most streams with the same settings that the pool keeps. A deflate
+// stream at level 9 is about 300K.
+const size_t kMaxPooledStates = 4;
+
+// deflateInit2()'s default.
+const int kMemLevel = 8;
+
+int WindowBits(ZlibStream::Format format) {
+  switch (format) {
+    case ZlibStream::FORMAT_GZIP:
+      return MAX_WBITS + 16;
+    case ZlibStream::FORMAT_RAW:
+      return -MAX_WBITS;
+    default:
+      return MAX_WBITS;
+  }
+}
+
+int PresetLevel(ZlibCompressor::Preset preset) {
+  switch (preset) {
+    case ZlibCompressor::PRESET_FASTEST:
+    case ZlibCompressor::PRESET_HUFFMAN_ONLY:
+      return Z_BEST_SPEED;
+    case ZlibCompressor::PRESET_SMALLEST:
+      return Z_BEST_COMPRESSION;
+    default:
+      return Z_DEFAULT_COMPRESSION;
+  }
+}
+
+int PresetStrategy(ZlibCompressor::Preset preset) {
+  switch (preset) {
+    case ZlibCompressor::PRESET_FILTERED:
+      return Z_FILTERED;
+    case ZlibCompressor::PRESET_HUFFMAN_ONLY:
+      return Z_HUFFMAN_ONLY;
+    default:
+      return Z_DEFAULT_STRATEGY;
+  }
+}
+
+}  // namespace
+
+struct ZlibStream::State {
+  State(bool compress, int window_bits, int level, int strategy)
+      : compress(compress),
+        window_bits(window_bits),
+        level(level),
+        strategy(strategy),
+        buffer(kBufferSize) {
+    memset(&stream, 0, sizeof(stream));
+  }
+
+  // Points the output of |stream| at all of |buffer|.
+  void EmptyBuffer() {
+    stream.next_out = &buffer[0];
+    stream.avail_out = static_cast<uInt>(buffer.size());
+  }
+
+  // Resets |stream| for the next payload. Returns false if it can't be.
+  bool ResetStream() {
+    EmptyBuffer();
+    return (compress ? deflateReset(&stream) : inflateReset(&stream)) == Z_OK;
+  }
+
+  void EndStream() {
+    if (compress)
+      deflateEnd(&stream);
+    else
+      inflateEnd(&stream);
+  }
+
+  z_stream stream;
+  bool compress;
+  int window_bits;
+  int level;
+  int strategy;
+  std::vector<unsigned char> buffer;
+};
+
+namespace {
+
+// The reset streams, by their settings.
+class StatePool {
+ public:
+  StatePool() {}
+
+  // Returns a stream with the settings of |key|, or NULL if there is none.
+  ZlibStream::State* Acquire(const ZlibStream::State& key) {
+    AutoLock lock(lock_);
+    StateMap::iterator it = states_.find(Key(key));
+    if (it == states_.end() || it->second.empty())
+      return NULL;
+    ZlibStream::State* state = it->second.back();
+    it->second.pop_back();
+    return state;
+  }
+
+  // Keeps |state|, which is reset, unless there are enough like it.
+  void Release(ZlibStream::State* state) {
+    {
+      AutoLock lock(lock_);
+      std::vector<ZlibStream::State*>& states = states_[Key(*state)];
+      if (states.size() < kMaxPooledStates) {
+        states.push_back(state);
+        return;
+      }
+    }
+    state->EndStream();
+    delete state;
+  }
+
+ private:
+  // Compressing, window bits, level and strategy.
+  typedef std::pair<std::pair<bool, int>, std::pair<int, int> > StateKey;
+  typedef std::map<StateKey, std::vector<ZlibStream::State*> > StateMap;
+
+  static StateKey Key(const ZlibStream::State& state) {
+    return StateKey(std::make_pair(state.compress, state.window_bits),
+                    std::make_pair(state.level, state.strategy));
+  }
+
+  Lock lock_;
+  StateMap states_;
+
+  DISALLOW_COPY_AND_ASSIGN(StatePool);
+};
+
+LazyInstance<StatePool, LeakyLazyInstanceTraits<StatePool> >
+    g_state_pool(LINKER_INITIALIZED);
+
+}  // namespace
+
+// static
+size_t ZlibStream::GetSize(const Chunks& chunks) {
+  size_t size = 0;
+  for (size_t i = 0; i < chunks.size(); ++i)
+    size += chunks[i]->size();
+  return size;
+}
+
+// static
+void ZlibStream::Flatten(const Chunks& chunks,
+                         std::vector<unsigned char>* output) {
+  output->reserve(output->size() + GetSize(chunks));
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    const unsigned char* front = chunks[i]->front();
+    output->insert(output->end(), front, front + chunks[i]->size());
+  }
+}
+
+ZlibStream::ZlibStream(bool compress, Format format, int level, int strategy)
+    : state_(NULL),
+      ended_(false),
+      compress_(compress),
+      window_bits_(WindowBits(format)),
+      level_(level),
+      strategy_(strategy),
+      total_in_(0),
+      total_out_(0) {
+  AcquireState();
+}
+
+ZlibStream::~ZlibStream() {
+  if (state_ && state_->ResetStream())
+    g_state_pool.Get().Release(state_);
+  else
+    Fail();
+}
+
+bool ZlibStream::Write(const unsigned char* data, size_t size) {
+  while (size) {
+    size_t run_size = std::min(size, kMaxRunSize);
+    if (!Run(data, run_size, Z_NO_FLUSH))
+      return false;
+    data += run_size;
+    size -= run_size;
+  }
+  return !failed();
+}
+
+bool ZlibStream::Write(const RefCountedMemory* chunk) {
+  return Write(chunk->front(), chunk->size());
+}
+
+bool ZlibStream::Write(const Chunks& chunks) {
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    if (!Write(chunks[i]))
+      return false;
+  }
+  return !failed();
+}
+
+void ZlibStream::Reset() {
+  pending_.clear();
+  ended_ = false;
+  dictionary_.clear();
+  total_in_ = 0;
+  total_out_ = 0;
+  if (state_ && !state_->ResetStream())
+    Fail();
+  if (!state_)
+    AcquireState();
+}
+
+bool ZlibStream::Run(const unsigned char* data, size_t size, int flush) {
+  if (!state_)
+    return false;
+  if (ended_) {
+    // There is data after the end of the compressed data.
+    if (size)
+      Fail();
+    return !failed();
+  }
+  z_stream* stream = &state_->stream;
+  stream->next_in = const_cast<unsigned char*>(data);
+  stream->avail_in = static_cast<uInt>(size);
+  for (;;) {
+    if (!stream->avail_out)
+      MoveBuffer();
+    uInt avail_in = stream->avail_in;
+    uInt avail_out = stream->avail_out;
+    int result = state_->compress ? deflate(stream, flush) :
+        inflate(stream, flush);
+    total_in_ += avail_in - stream->avail_in;
+    total_out_ += avail_out - stream->avail_out;
+    if (result == Z_NEED_DICT) {
+      if (dictionary_.empty() ||
+          inflateSetDictionary(stream, &dictionary_[0],
+                               static_cast<uInt>(dictionary_.size())) !=
+              Z_OK) {
+        Fail();
+        return false;
+      }
+      continue;
+    }
+    if (result == Z_STREAM_END) {
+      ended_ = true;
+      if (stream->avail_in) {
+        Fail();
+        return false;
+      }
+      return true;
+    }
+    // Z_BUF_ERROR means that no progress was possible, which is not an
+    // error when all of the input is consumed and the buffer has room.
+    if (result != Z_OK && result != Z_BUF_ERROR) {
+      Fail();
+      return false;
+    }
+    if (!stream->avail_out)
+      continue;
+    if (stream->avail_in) {
+      // Only a full buffer stops zlib from consuming its input.
+      Fail();
+      return false;
+    }
+    if (flush != Z_FINISH || !state_->compress)
+      return true;
+    if (result == Z_BUF_ERROR) {
+      // Finishing made no progress.
+      Fail();
+      return false;
+    }
+  }
+}
+
+void ZlibStream::MoveBuffer() {
+  std::vector<unsigned char>& buffer = state_->buffer;
+  size_t used = buffer.size() - state_->stream.avail_out;
+  if (used) {
+    scoped_refptr<RefCountedBytes> chunk(new RefCountedBytes);
+    chunk->data().assign(buffer.begin(), buffer.begin() + used);
+    pending_.push_back(chunk);
+  }
+  state_->EmptyBuffer();
+}
+
+void ZlibStream::TakeOutput(Chunks* output) {
+  MoveBuffer();
+  // The chunks are passed on rather than copied, whose references would be
+  // added and then released.
+  if (output->empty()) {
+    output->swap(pending_);
+    return;
+  }
+  for (size_t i = 0; i < pending_.size(); ++i) {
+    output->push_back(NULL);
+    output->back() = pending_[i].Pass();
+  }
+  pending_.clear();
+}
+
+void ZlibStream::Fail() {
+  if (!state_)
+    return;
+  state_->EndStream();
+  delete state_;
+  state_ = NULL;
+}
+
+void ZlibStream::AcquireState() {
+  State key(compress_, window_bits_, level_, strategy_);
+  state_ = g_state_pool.Get().Acquire(key);
+  if (state_)
+    return;
+  state_ = new State(compress_, window_bits_, level_, strategy_);
+  int result = compress_ ?
+      deflateInit2(&state_->stream, level_, Z_DEFLATED, window_bits_,
+                   kMemLevel, strategy_) :
+      inflateInit2(&state_->stream, window_bits_);
+  if (result != Z_OK) {
+    DLOG(ERROR) << "Can't set up a zlib stream: " << result;
+    delete state_;
+    state_ = NULL;
+    return;
+  }
+  state_->EmptyBuffer();
+}
+
+ZlibCompressor::ZlibCompressor(Format format, Preset preset)
+    : ZlibStream(true, format, PresetLevel(preset), PresetStrategy(preset)) {
+}
+
+ZlibCompressor::ZlibCompressor(Format format, int level, int strategy)
+    : ZlibStream(true, format, level, strategy) {
+}
+
+ZlibCompressor::~ZlibCompressor() {
+}
+
+// static
+bool ZlibCompressor::Compress(const Chunks& input,
+                              Format format,
+                              Preset preset,
+                              Chunks* output) {
+  ZlibCompressor compressor(format, preset);
+  return compressor.Write(input) && compressor.Finish(output);
+}
+
+bool ZlibCompressor::SetDictionary(const unsigned char* data, size_t size) {
+  if (!state_)
+    return false;
+  DCHECK_EQ(0u, total_in());
+  if (deflateSetDictionary(&state_->stream, data,
+                           static_cast<uInt>(size)) != Z_OK) {
+    Fail();
+    return false;
+  }
+  return true;
+}
+
+bool ZlibCompressor::Flush(Chunks* output) {
+  if (!Run(NULL, 0, Z_SYNC_FLUSH))
+    return false;
+  TakeOutput(output);
+  return true;
+}
+
+bool ZlibCompressor::Finish(Chunks* output) {
+  bool succeeded = Run(NULL, 0, Z_FINISH);
+  if (succeeded)
+    TakeOutput(output);
+  Reset();
+  return succeeded;
+}
+
+ZlibDecompressor::ZlibDecompressor(Format format)
+    : ZlibStream(false, format, 0, 0) {
+}
+
+ZlibDecompressor::~ZlibDecompressor() {
+}
+
+// static
+bool ZlibDecompressor::Decompress(const Chunks& input,
+                                  Format format,
+                                  Chunks* output) {
+  ZlibDecompressor decompressor(format);
+  return decompressor.Write(input) && decompressor.Finish(output);
+}
+
+bool ZlibDecompressor::SetDictionary(const unsigned char* data,
+                                     size_t size) {
+  if (!state_)
+    return false;
+  dictionary_.assign(data, data + size);
+  // A raw stream has no header to ask for the dictionary with, so it is set
+  // now.
+  if (state_->window_bits < 0 &&
+      inflateSetDictionary(&state_->stream, data,
+                           static_cast<uInt>(size)) != Z_OK) {
+    Fail();
+    return false;
+  }
+  return true;
+}
+
+bool ZlibDecompressor::Finish(Chunks* output) {
+  bool succeeded = state_ && ended_;
+  if (succeeded)
+    TakeOutput(output);
+  Reset();
+  return succeeded;
+}
+
+}  // namespace base
@@ -0,0 +1,186 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_ZLIB_STREAM_H_
+#define BASE_ZLIB_STREAM_H_
+#pragma once
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/ref_counted_memory.h"
+
+namespace base {
+
+// Streaming zlib compression and decompression of data held in chains of
+// RefCountedMemory chunks, e.g.:
+//
+//   ZlibCompressor compressor(ZlibStream::FORMAT_GZIP,
+//                             ZlibCompressor::PRESET_FASTEST);
+//   for (...)
+//     compressor.Write(chunk);
+//   ZlibStream::Chunks compressed;
+//   if (!compressor.Finish(&compressed))
+//     ...
+//
+// Setting up a z_stream allocates and clears its window and hash tables,
+// which costs more than compressing a small payload. So Finish() resets the
+// stream for the next payload rather than ending it, and the streams that
+// are destroyed go to a pool that the next ZlibCompressor or
+// ZlibDecompressor with the same settings takes them from, along with their
+// output buffer. Compressing many small payloads pays for the setup once.
+//
+// A stream is used on one thread at a time; the pool may be used from any.
+class BASE_EXPORT ZlibStream {
+ public:
+  enum Format {
+    FORMAT_ZLIB,  // RFC 1950: a header, deflate data and an Adler-32.
+    FORMAT_GZIP,  // RFC 1952: a header, deflate data and a CRC-32.
+    FORMAT_RAW,   // RFC 1951: the deflate data only.
+  };
+
+  typedef std::vector<scoped_refptr<RefCountedMemory> > Chunks;
+
+  // Returns the total size of |chunks|.
+  static size_t GetSize(const Chunks& chunks);
+
+  // Appends the bytes of |chunks| to |output|.
+  static void Flatten(const Chunks& chunks,
+                      std::vector<unsigned char>* output);
+
+  // Processes the data, appending the output that fills the buffer to the
+  // output of the payload. Returns false if the stream failed, e.g. on
+  // corrupt compressed data; it then fails until Reset().
+  bool Write(const unsigned char* data, size_t size);
+  bool Write(const RefCountedMemory* chunk);
+  bool Write(const Chunks& chunks);
+
+  // Drops the payload so far, and starts the next one.
+  void Reset();
+
+  bool failed() const { return state_ == NULL; }
+
+  // The number of bytes written and output in the payload so far.
+  size_t total_in() const { return total_in_; }
+  size_t total_out() const { return total_out_; }
+
+  // The z_stream and output buffer, which the pool keeps.
+  struct State;
+
+ protected:
+  ZlibStream(bool compress, Format format, int level, int strategy);
+  ~ZlibStream();
+
+  // Runs deflate() or inflate() with |flush| on |size| bytes at |data|,
+  // until they are consumed and, for a flush, all of the output is in the
+  // buffer. Returns false, after failing the stream, on an error.
+  bool Run(const unsigned char* data, size_t size, int flush);
+
+  // Appends the used part of the buffer to |pending_|, and empties it.
+  void MoveBuffer();
+
+  // Moves the output of the payload so far to |output|.
+  void TakeOutput(Chunks* output);
+
+  // Ends the z_stream, failing the stream.
+  void Fail();
+
+  State* state_;
+
+  // The output that is not in the buffer.
+  Chunks pending_;
+
+  // True once inflate() found the end of the compressed data.
+  bool ended_;
+
+  // For inflate(), the dictionary to use when the data asks for one.
+  std::vector<unsigned char> dictionary_;
+
+ private:
+  // Takes a state with the settings from the pool, or makes one.
+  void AcquireState();
+
+  bool compress_;
+  int window_bits_;
+  int level_;
+  int strategy_;
+
+  size_t total_in_;
+  size_t total_out_;
+
+  DISALLOW_COPY_AND_ASSIGN(ZlibStream);
+};
+
+class BASE_EXPORT ZlibCompressor : public ZlibStream {
+ public:
+  enum Preset {
+    // Level 1, for data that is compressed once and read once, such as log
+    // uploads.
+    PRESET_FASTEST,
+    // zlib's default level, 6.
+    PRESET_DEFAULT,
+    // Level 9, for data that is compressed once and read many times, such as
+    // resource packs.
+    PRESET_SMALLEST,
+    // The default level with Z_FILTERED, for data of mostly small values with
+    // few repeats, such as PNG-filtered rows.
+    PRESET_FILTERED,
+    // Level 1 with Z_HUFFMAN_ONLY, which doesn't look for repeats at all.
+    PRESET_HUFFMAN_ONLY,
+  };
+
+  ZlibCompressor(Format format, Preset preset);
+
+  // |level| and |strategy| as deflateInit2() takes them.
+  ZlibCompressor(Format format, int level, int strategy);
+
+  ~ZlibCompressor();
+
+  // Compresses |input| as one payload, with a stream from the pool.
+  static bool Compress(const Chunks& input,
+                       Format format,
+                       Preset preset,
+                       Chunks* output);
+
+  // Primes the payload with |size| bytes at |data|, which the data can then
+  // refer back to; the decompressor needs the same dictionary. Must be
+  // called before the first Write() of a payload. Not for FORMAT_GZIP.
+  bool SetDictionary(const unsigned char* data, size_t size);
+
+  // Ends the output so far on a byte boundary, and moves it to |output|.
+  // The payload goes on.
+  bool Flush(Chunks* output);
+
+  // Ends the payload, moves the rest of its output to |output| and resets
+  // the stream for the next one.
+  bool Finish(Chunks* output);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ZlibCompressor);
+};
+
+class BASE_EXPORT ZlibDecompressor : public ZlibStream {
+ public:
+  explicit ZlibDecompressor(Format format);
+  ~ZlibDecompressor();
+
+  // Decompresses |input| as one payload, with a stream from the pool.
+  static bool Decompress(const Chunks& input, Format format, Chunks* output);
+
+  // Sets the dictionary the payload was compressed with. Reset() clears it.
+  bool SetDictionary(const unsigned char* data, size_t size);
+
+  // Moves the output of the payload to |output| and resets the stream for
+  // the next one. Returns false if the compressed data is incomplete.
+  bool Finish(Chunks* output);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ZlibDecompressor);
+};
+
+}  // namespace base
+
+#endif  // BASE_ZLIB_STREAM_H_
@@ -4,6 +4,8 @@
       'target_name': 'notification',
       'type': 'static_library',
       'sources': [
+        'notification_broadcaster.cc',
+        'notification_broadcaster.h',
         'notification_details.h',
         'notification_observer.h',
         'notification_registrar.cc',
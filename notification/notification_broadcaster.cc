@@ -0,0 +1,75 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "notification/notification_broadcaster.h"
+
+#include "base/bind.h"
+#include "base/message_loop.h"
+#include "base/message_loop_proxy.h"
+#include "notification/notification_details.h"
+#include "notification/notification_service.h"
+#include "notification/notification_types.h"
+
+namespace content {
+
+NotificationBroadcaster::NotificationBroadcaster()
+    : observers_(new ObserverListThreadSafe<NotificationObserver>()),
+      message_loop_(base::MessageLoopProxy::current()) {
+  DCHECK(message_loop_) << "Notifications are sent by a task.";
+}
+
+NotificationBroadcaster::~NotificationBroadcaster() {
+}
+
+void NotificationBroadcaster::AddObserver(NotificationObserver* observer) {
+  DCHECK(MessageLoop::current()) << "Observers are notified by a task.";
+  observers_->AddObserver(observer);
+}
+
+void NotificationBroadcaster::RemoveObserver(NotificationObserver* observer) {
+  observers_->RemoveObserver(observer);
+}
+
+void NotificationBroadcaster::Post(int type,
+                                   const NotificationSource& source) {
+  DCHECK(type > NOTIFICATION_ALL) << "Allowed for observing, but not posting.";
+
+  bool first_pending;
+  {
+    base::AutoLock lock(lock_);
+    if (!pending_keys_.insert(std::make_pair(type, source.map_key())).second)
+      return;
+    first_pending = pending_.empty();
+    pending_.push_back(Notification(type, source));
+  }
+
+  // The notifications posted from here on, until the task runs, go out with
+  // this one.
+  if (first_pending &&
+      !message_loop_->PostTask(
+          FROM_HERE,
+          base::Bind(&NotificationBroadcaster::SendPendingNotifications,
+                     this))) {
+    // The creating thread's loop is gone, so nothing else would send them.
+    SendPendingNotifications();
+  }
+}
+
+void NotificationBroadcaster::SendPendingNotifications() {
+  NotificationList pending;
+  {
+    base::AutoLock lock(lock_);
+    pending.swap(pending_);
+    pending_keys_.clear();
+  }
+
+  NotificationDetails no_details = NotificationService::NoDetails();
+  for (NotificationList::const_iterator it = pending.begin();
+       it != pending.end(); ++it) {
+    observers_->Notify(&NotificationObserver::Observe, it->first, it->second,
+                       no_details);
+  }
+}
+
+}  // namespace content
@@ -0,0 +1,87 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_PUBLIC_BROWSER_NOTIFICATION_BROADCASTER_H_
+#define CONTENT_PUBLIC_BROWSER_NOTIFICATION_BROADCASTER_H_
+#pragma once
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "base/memory/ref_counted.h"
+#include "base/message_loop_proxy.h"
+#include "base/observer_list_threadsafe.h"
+#include "base/synchronization/lock.h"
+#include "notification/notification_observer.h"
+#include "notification/notification_source.h"
+
+namespace content {
+
+// Delivers notifications to observers on several threads. Unlike the
+// NotificationService, which is per thread and calls its observers at once,
+// a NotificationBroadcaster may be posted to from any thread, and calls each
+// observer from a task on the thread that added it, which needs a
+// MessageLoop.
+//
+// Notifications of the same type and source posted before they are sent are
+// coalesced into one, so that a burst of changes to an object costs each
+// thread a single Observe(). The observers are passed
+// NotificationService::NoDetails(), as the details of all but one would be
+// lost, and the source is only for comparing, as the object it points to may
+// have been deleted or be in use by another thread.
+//
+// The notifications are sent from a task on the thread that created the
+// broadcaster, whose MessageLoop must outlive the posting, such as the UI
+// thread's. Posts from threads whose loops come and go then can't strand the
+// notifications of the others.
+class NotificationBroadcaster
+    : public base::RefCountedThreadSafe<NotificationBroadcaster> {
+ public:
+  // Must be called on a thread with a MessageLoop.
+  NotificationBroadcaster();
+
+  // Adds or removes an observer of every type, which is notified on the
+  // current thread. RemoveObserver() must be called from the thread that
+  // added the observer, and drops its notifications still in transit.
+  void AddObserver(NotificationObserver* observer);
+  void RemoveObserver(NotificationObserver* observer);
+
+  // Posts a notification of |type| from |source| to all the observers, unless
+  // one is pending already. Any thread may post; the notification is sent
+  // when the creating thread's MessageLoop runs its next task, or at once if
+  // that loop is gone.
+  void Post(int type, const NotificationSource& source);
+
+ private:
+  friend class base::RefCountedThreadSafe<NotificationBroadcaster>;
+
+  typedef std::pair<int, NotificationSource> Notification;
+  typedef std::vector<Notification> NotificationList;
+  typedef std::set<std::pair<int, uintptr_t> > NotificationKeySet;
+
+  ~NotificationBroadcaster();
+
+  // Sends the pending notifications to the observers' threads.
+  void SendPendingNotifications();
+
+  scoped_refptr<ObserverListThreadSafe<NotificationObserver> > observers_;
+
+  // The loop of the creating thread, which sends the notifications.
+  scoped_refptr<base::MessageLoopProxy> message_loop_;
+
+  // Protects the members below.
+  base::Lock lock_;
+
+  // The notifications posted since they were last sent, in the order they
+  // were first posted, and their types and sources for finding duplicates.
+  NotificationList pending_;
+  NotificationKeySet pending_keys_;
+
+  DISALLOW_COPY_AND_ASSIGN(NotificationBroadcaster);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_PUBLIC_BROWSER_NOTIFICATION_BROADCASTER_H_
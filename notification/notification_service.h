@@ -10,6 +10,8 @@
 #define CONTENT_PUBLIC_NOTIFICATION_SERVICE_H_
 #pragma once
 
+#include <vector>
+
 #include "notification/notification_details.h"
 #include "notification/notification_source.h"
 
@@ -35,6 +37,15 @@ class NotificationService {
                       const NotificationSource& source,
                       const NotificationDetails& details) = 0;
 
+  // Posts a notification of |type| from |source| for each of |details|, in
+  // order, as Notify() would. The observers are looked up once for the whole
+  // batch, so it is cheaper than a Notify() for each when firing many
+  // notifications at once. An observer added for a type and source that had
+  // none when the batch started isn't notified until the next one.
+  virtual void NotifyMany(int type,
+                          const NotificationSource& source,
+                          const std::vector<NotificationDetails>& details) = 0;
+
   // Returns a NotificationSource that represents all notification sources
   // (for the purpose of registering an observer for events from all sources).
   static Source<void> AllSources() { return Source<void>(NULL); }
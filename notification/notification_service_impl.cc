@@ -22,12 +22,6 @@ content::NotificationService* content::NotificationService::current() {
   return NotificationServiceImpl::current();
 }
 
-// static
-bool NotificationServiceImpl::HasKey(const NotificationSourceMap& map,
-                                 const content::NotificationSource& source) {
-  return map.find(source.map_key()) != map.end();
-}
-
 NotificationServiceImpl::NotificationServiceImpl() {
   DCHECK(current() == NULL);
   lazy_tls_ptr.Pointer()->Set(this);
@@ -43,14 +37,14 @@ void NotificationServiceImpl::AddObserver(
   // in release mode so we know what code to blame the crash on (since this is
   // guaranteed to crash later).
   CHECK(observer);
+  DCHECK_GE(type, content::NOTIFICATION_ALL);
 
-  NotificationObserverList* observer_list;
-  if (HasKey(observers_[type], source)) {
-    observer_list = observers_[type][source.map_key()];
-  } else {
+  if (type >= static_cast<int>(observers_.size()))
+    observers_.resize(type + 1);
+  NotificationObserverList*& observer_list =
+      observers_[type][source.map_key()];
+  if (!observer_list)
     observer_list = new NotificationObserverList;
-    observers_[type][source.map_key()] = observer_list;
-  }
 
   observer_list->AddObserver(observer);
 #ifndef NDEBUG
@@ -62,64 +56,95 @@ void NotificationServiceImpl::RemoveObserver(
     content::NotificationObserver* observer,
     int type,
     const content::NotificationSource& source) {
+  NotificationObserverList* observer_list = FindObserverList(type, source);
   // This is a very serious bug.  An object is most likely being deleted on
   // the wrong thread, and as a result another thread's NotificationServiceImpl
   // has its deleted pointer in its map.  A garbge object will be called in the
   // future.
   // NOTE: when this check shows crashes, use BrowserThread::DeleteOnIOThread or
   // other variants as the trait on the object.
-  CHECK(HasKey(observers_[type], source));
+  CHECK(observer_list);
 
-  NotificationObserverList* observer_list =
-      observers_[type][source.map_key()];
-  if (observer_list) {
-    observer_list->RemoveObserver(observer);
+  observer_list->RemoveObserver(observer);
 #ifndef NDEBUG
-    --observer_counts_[type];
+  --observer_counts_[type];
 #endif
-  }
 
   // TODO(jhughes): Remove observer list from map if empty?
 }
 
-void NotificationServiceImpl::Notify(
+NotificationServiceImpl::NotificationObserverList*
+NotificationServiceImpl::FindObserverList(
     int type,
-    const content::NotificationSource& source,
-    const content::NotificationDetails& details) {
-  DCHECK(type > content::NOTIFICATION_ALL) <<
-      "Allowed for observing, but not posting.";
+    const content::NotificationSource& source) const {
+  if (type < 0 || type >= static_cast<int>(observers_.size()))
+    return NULL;
+  const NotificationSourceMap& source_map = observers_[type];
+  NotificationSourceMap::const_iterator found =
+      source_map.find(source.map_key());
+  return found == source_map.end() ? NULL : found->second;
+}
 
+int NotificationServiceImpl::FindObserverLists(
+    int type,
+    const content::NotificationSource& source,
+    NotificationObserverList* lists[kMaxObserverLists]) const {
   // There's no particular reason for the order in which the different
   // classes of observers get notified here.
-
-  // Notify observers of all types and all sources
-  if (HasKey(observers_[content::NOTIFICATION_ALL], AllSources()) &&
-      source != AllSources()) {
-    FOR_EACH_OBSERVER(content::NotificationObserver,
-       *observers_[content::NOTIFICATION_ALL][AllSources().map_key()],
-       Observe(type, source, details));
+  bool from_all_sources = source == AllSources();
+  NotificationObserverList* candidates[kMaxObserverLists] = {
+    // Observers of all types and all sources
+    from_all_sources ? NULL :
+        FindObserverList(content::NOTIFICATION_ALL, AllSources()),
+    // Observers of all types and the given source
+    FindObserverList(content::NOTIFICATION_ALL, source),
+    // Observers of the given type and all sources
+    from_all_sources ? NULL : FindObserverList(type, AllSources()),
+    // Observers of the given type and the given source
+    FindObserverList(type, source),
+  };
+
+  int count = 0;
+  for (int i = 0; i < kMaxObserverLists; ++i) {
+    if (candidates[i])
+      lists[count++] = candidates[i];
   }
+  return count;
+}
 
-  // Notify observers of all types and the given source
-  if (HasKey(observers_[content::NOTIFICATION_ALL], source)) {
-    FOR_EACH_OBSERVER(content::NotificationObserver,
-        *observers_[content::NOTIFICATION_ALL][source.map_key()],
-        Observe(type, source, details));
-  }
+void NotificationServiceImpl::Notify(
+    int type,
+    const content::NotificationSource& source,
+    const content::NotificationDetails& details) {
+  DCHECK(type > content::NOTIFICATION_ALL) <<
+      "Allowed for observing, but not posting.";
 
-  // Notify observers of the given type and all sources
-  if (HasKey(observers_[type], AllSources()) &&
-      source != AllSources()) {
-    FOR_EACH_OBSERVER(content::NotificationObserver,
-                      *observers_[type][AllSources().map_key()],
+  // The lists are never deleted while the service is alive, so an observer
+  // adding or removing observers doesn't invalidate them.
+  NotificationObserverList* lists[kMaxObserverLists];
+  int count = FindObserverLists(type, source, lists);
+  for (int i = 0; i < count; ++i) {
+    FOR_EACH_OBSERVER(content::NotificationObserver, *lists[i],
                       Observe(type, source, details));
   }
+}
 
-  // Notify observers of the given type and the given source
-  if (HasKey(observers_[type], source)) {
-    FOR_EACH_OBSERVER(content::NotificationObserver,
-                      *observers_[type][source.map_key()],
-                      Observe(type, source, details));
+void NotificationServiceImpl::NotifyMany(
+    int type,
+    const content::NotificationSource& source,
+    const std::vector<content::NotificationDetails>& details) {
+  DCHECK(type > content::NOTIFICATION_ALL) <<
+      "Allowed for observing, but not posting.";
+
+  NotificationObserverList* lists[kMaxObserverLists];
+  int count = FindObserverLists(type, source, lists);
+  if (!count)
+    return;
+  for (size_t i = 0; i < details.size(); ++i) {
+    for (int j = 0; j < count; ++j) {
+      FOR_EACH_OBSERVER(content::NotificationObserver, *lists[j],
+                        Observe(type, source, details[i]));
+    }
   }
 }
 
@@ -138,8 +163,8 @@ NotificationServiceImpl::~NotificationServiceImpl() {
   }
 #endif
 
-  for (int i = 0; i < static_cast<int>(observers_.size()); i++) {
-    NotificationSourceMap omap = observers_[i];
+  for (size_t i = 0; i < observers_.size(); i++) {
+    NotificationSourceMap& omap = observers_[i];
     for (NotificationSourceMap::iterator it = omap.begin();
          it != omap.end(); ++it)
       delete it->second;
@@ -7,7 +7,9 @@
 #pragma once
 
 #include <map>
+#include <vector>
 
+#include "base/flat_map.h"
 #include "base/observer_list.h"
 #include "notification/notification_service.h"
 
@@ -30,19 +32,39 @@ class NotificationServiceImpl
   virtual void Notify(int type,
               const content::NotificationSource& source,
               const content::NotificationDetails& details);
+  virtual void NotifyMany(
+      int type,
+      const content::NotificationSource& source,
+      const std::vector<content::NotificationDetails>& details);
 
  private:
   friend class content::NotificationRegistrar;
 
   typedef ObserverList<content::NotificationObserver> NotificationObserverList;
-  typedef std::map<uintptr_t, NotificationObserverList*> NotificationSourceMap;
-  typedef std::map<int, NotificationSourceMap> NotificationObserverMap;
+  // The sources of a type are few, so they're kept in a sorted vector.
+  typedef base::FlatMap<uintptr_t, NotificationObserverList*>
+      NotificationSourceMap;
+  // Indexed by type.
+  typedef std::vector<NotificationSourceMap> NotificationObserverMap;
   typedef std::map<int, int> NotificationObserverCount;
 
-  // Convenience function to determine whether a source has a
-  // NotificationObserverList in the given map;
-  static bool HasKey(const NotificationSourceMap& map,
-                     const content::NotificationSource& source);
+  // The most lists a notification is dispatched to: those of its type and of
+  // all types, each for its source and for all sources.
+  enum { kMaxObserverLists = 4 };
+
+  // Returns the list of the observers of |type| and |source|, or NULL if
+  // there is none.
+  NotificationObserverList* FindObserverList(
+      int type,
+      const content::NotificationSource& source) const;
+
+  // Puts the lists of the observers a notification of |type| from |source| is
+  // dispatched to in |lists|, in the order they're notified, and returns how
+  // many there are.
+  int FindObserverLists(
+      int type,
+      const content::NotificationSource& source,
+      NotificationObserverList* lists[kMaxObserverLists]) const;
 
   // NOTE: Rather than using this directly, you should use a
   // NotificationRegistrar.
@@ -77,7 +99,8 @@ class NotificationServiceImpl
 
   // Keeps track of the observers for each type of notification.
   // Until we get a prohibitively large number of notification types,
-  // a simple array is probably the fastest way to dispatch.
+  // a simple array is probably the fastest way to dispatch. It grows to the
+  // largest type observed.
   NotificationObserverMap observers_;
 
 #ifndef NDEBUG
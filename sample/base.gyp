@@ -99,6 +99,16 @@
       'dependencies': [
         '../base/base.gyp:*',
       ],
+    },
+    {
+      'target_name': 'threading_benchmark',
+      'type': 'executable',
+      'sources': [
+        'threading_benchmark/main.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:*',
+      ],
     },
   	{
       'target_name': 'testing',
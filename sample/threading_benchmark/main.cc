@@ -0,0 +1,418 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the costs of base's threading primitives: posting tasks to the
+// same and to another thread, scheduling and cancelling delayed work, the
+// round trip between two threads, creating and running callbacks, and the
+// fan-out of ObserverListThreadSafe::Notify().
+//
+// Each benchmark runs a warm-up trial, then --repetitions trials of
+// --iterations operations. The time per operation is reported as the median,
+// mean, standard deviation and 95% confidence interval of the mean across
+// the trials, so that two builds are only told apart when their intervals
+// don't overlap. --filter=<substring> runs the benchmarks whose name matches.
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/command_line.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop.h"
+#include "base/observer_list_threadsafe.h"
+#include "base/stl_util.h"
+#include "base/string_number_conversions.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/thread.h"
+#include "base/time.h"
+#include "base/timer.h"
+
+namespace {
+
+const int kDefaultIterations = 10000;
+const int kDefaultRepetitions = 10;
+
+// The threads ObserverListThreadSafe notifies, and the observers on each.
+const int kObserverThreads = 4;
+const int kObserversPerThread = 4;
+
+// Keeps the compiler from optimizing away the work being measured.
+volatile int g_sink = 0;
+
+// A trial: runs |iterations| operations, and returns the time they took.
+typedef base::TimeDelta (*BenchmarkFunction)(int iterations);
+
+// Returns the two-sided 95% quantile of Student's t distribution with
+// |degrees| degrees of freedom.
+double StudentT95(int degrees) {
+  static const double kTable[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+  };
+  if (degrees <= 0)
+    return 0;
+  if (degrees <= static_cast<int>(arraysize(kTable)))
+    return kTable[degrees - 1];
+  return 1.960;
+}
+
+// Runs |function| and prints the statistics of its time per operation, in
+// nanoseconds.
+void RunBenchmark(const char* name,
+                  BenchmarkFunction function,
+                  int iterations,
+                  int repetitions) {
+  function(iterations);
+
+  std::vector<double> samples;
+  for (int i = 0; i < repetitions; ++i) {
+    base::TimeDelta elapsed = function(iterations);
+    samples.push_back(elapsed.InMillisecondsF() * 1000000.0 / iterations);
+  }
+  std::sort(samples.begin(), samples.end());
+
+  size_t count = samples.size();
+  double median = count % 2 ? samples[count / 2] :
+      (samples[count / 2 - 1] + samples[count / 2]) / 2;
+  double mean = 0;
+  for (size_t i = 0; i < count; ++i)
+    mean += samples[i];
+  mean /= count;
+  double variance = 0;
+  for (size_t i = 0; i < count; ++i)
+    variance += (samples[i] - mean) * (samples[i] - mean);
+  double stddev = count > 1 ? sqrt(variance / (count - 1)) : 0;
+  double interval = StudentT95(static_cast<int>(count) - 1) * stddev /
+      sqrt(static_cast<double>(count));
+
+  printf("%-28s %12.1f %12.1f %10.1f %10.1f %10.1f\n", name, median, mean,
+         stddev, mean - interval, mean + interval);
+}
+
+// Counts down the tasks of a trial, and signals |done| on the last one.
+class TaskCounter {
+ public:
+  TaskCounter(int count, base::WaitableEvent* done)
+      : remaining_(count),
+        done_(done) {
+  }
+
+  void Run() {
+    if (--remaining_ == 0)
+      done_->Signal();
+  }
+
+ private:
+  int remaining_;
+  base::WaitableEvent* done_;
+
+  DISALLOW_COPY_AND_ASSIGN(TaskCounter);
+};
+
+void QuitCurrent() {
+  MessageLoop::current()->Quit();
+}
+
+void Increment(int* count) {
+  ++*count;
+}
+
+int Add(int a, int b) {
+  return a + b;
+}
+
+// PostTask to the current loop, then running the tasks.
+base::TimeDelta PostTaskSameThread(int iterations) {
+  MessageLoop loop;
+  int count = 0;
+  base::TimeTicks start = base::TimeTicks::HighResNow();
+  for (int i = 0; i < iterations; ++i)
+    loop.PostTask(FROM_HERE, base::Bind(&Increment, &count));
+  loop.PostTask(FROM_HERE, base::Bind(&QuitCurrent));
+  loop.Run();
+  base::TimeDelta elapsed = base::TimeTicks::HighResNow() - start;
+  CHECK_EQ(iterations, count);
+  return elapsed;
+}
+
+// PostTask to another thread, until that thread has run them all.
+base::TimeDelta PostTaskCrossThread(int iterations) {
+  base::Thread thread("PostTaskTarget");
+  CHECK(thread.Start());
+  base::WaitableEvent done(false, false);
+  TaskCounter counter(iterations, &done);
+  MessageLoop* target = thread.message_loop();
+
+  base::TimeTicks start = base::TimeTicks::HighResNow();
+  for (int i = 0; i < iterations; ++i) {
+    target->PostTask(FROM_HERE,
+                     base::Bind(&TaskCounter::Run, base::Unretained(&counter)));
+  }
+  done.Wait();
+  return base::TimeTicks::HighResNow() - start;
+}
+
+// PostDelayedTask with distinct delays, none of which runs in the trial.
+base::TimeDelta PostDelayedTaskInsertion(int iterations) {
+  MessageLoop loop;
+  int count = 0;
+  base::TimeTicks start = base::TimeTicks::HighResNow();
+  for (int i = 0; i < iterations; ++i) {
+    loop.PostDelayedTask(FROM_HERE, base::Bind(&Increment, &count),
+                         3600 * 1000 + (i * 7919) % iterations);
+  }
+  base::TimeDelta elapsed = base::TimeTicks::HighResNow() - start;
+  CHECK_EQ(0, count);
+  return elapsed;
+}
+
+class TimerReceiver {
+ public:
+  void OnTimer() { ++g_sink; }
+};
+
+// Starting then stopping OneShotTimers, the way delayed work is cancelled:
+// the timers are started with distinct delays, then all are stopped.
+base::TimeDelta DelayedTaskCancellation(int iterations) {
+  MessageLoop loop;
+  TimerReceiver receiver;
+  std::vector<base::OneShotTimer<TimerReceiver>*> timers;
+  for (int i = 0; i < iterations; ++i)
+    timers.push_back(new base::OneShotTimer<TimerReceiver>);
+
+  base::TimeTicks start = base::TimeTicks::HighResNow();
+  for (int i = 0; i < iterations; ++i) {
+    timers[i]->Start(FROM_HERE,
+                     base::TimeDelta::FromMilliseconds(
+                         3600 * 1000 + (i * 7919) % iterations),
+                     &receiver, &TimerReceiver::OnTimer);
+  }
+  for (int i = 0; i < iterations; ++i)
+    timers[i]->Stop();
+  base::TimeDelta elapsed = base::TimeTicks::HighResNow() - start;
+
+  STLDeleteElements(&timers);
+  return elapsed;
+}
+
+// Bounces a task between two threads, |remaining| times.
+class PingPong {
+ public:
+  PingPong(MessageLoop* ping, MessageLoop* pong, int round_trips,
+           base::WaitableEvent* done)
+      : ping_(ping),
+        pong_(pong),
+        remaining_(round_trips),
+        done_(done) {
+  }
+
+  void Ping() {
+    if (remaining_-- == 0) {
+      done_->Signal();
+      return;
+    }
+    pong_->PostTask(FROM_HERE,
+                    base::Bind(&PingPong::Pong, base::Unretained(this)));
+  }
+
+  void Pong() {
+    ping_->PostTask(FROM_HERE,
+                    base::Bind(&PingPong::Ping, base::Unretained(this)));
+  }
+
+ private:
+  MessageLoop* ping_;
+  MessageLoop* pong_;
+  int remaining_;
+  base::WaitableEvent* done_;
+
+  DISALLOW_COPY_AND_ASSIGN(PingPong);
+};
+
+// The round trips of a task between two base::Threads.
+base::TimeDelta RoundTripLatency(int iterations) {
+  base::Thread ping_thread("Ping");
+  base::Thread pong_thread("Pong");
+  CHECK(ping_thread.Start());
+  CHECK(pong_thread.Start());
+  base::WaitableEvent done(false, false);
+  PingPong ping_pong(ping_thread.message_loop(), pong_thread.message_loop(),
+                     iterations, &done);
+
+  base::TimeTicks start = base::TimeTicks::HighResNow();
+  ping_thread.message_loop()->PostTask(
+      FROM_HERE, base::Bind(&PingPong::Ping, base::Unretained(&ping_pong)));
+  done.Wait();
+  return base::TimeTicks::HighResNow() - start;
+}
+
+// base::Bind() of a function and a bound argument, then destroying it.
+base::TimeDelta BindCreation(int iterations) {
+  base::TimeTicks start = base::TimeTicks::HighResNow();
+  for (int i = 0; i < iterations; ++i) {
+    base::Callback<int(int)> callback = base::Bind(&Add, i);
+    g_sink += callback.is_null() ? 0 : 1;
+  }
+  return base::TimeTicks::HighResNow() - start;
+}
+
+// Running a bound callback.
+base::TimeDelta CallbackInvocation(int iterations) {
+  base::Callback<int(int)> callback = base::Bind(&Add, 1);
+  int total = 0;
+  base::TimeTicks start = base::TimeTicks::HighResNow();
+  for (int i = 0; i < iterations; ++i)
+    total = callback.Run(total);
+  base::TimeDelta elapsed = base::TimeTicks::HighResNow() - start;
+  g_sink += total;
+  return elapsed;
+}
+
+class Notified {
+ public:
+  virtual void OnNotify() = 0;
+
+ protected:
+  virtual ~Notified() {}
+};
+
+// Counts the notifications of all the observers of a trial, and signals
+// |done| on the last one.
+class NotifiedCounter : public Notified {
+ public:
+  NotifiedCounter(base::subtle::Atomic32* remaining,
+                  base::WaitableEvent* done)
+      : remaining_(remaining),
+        done_(done) {
+  }
+
+  virtual void OnNotify() OVERRIDE {
+    if (base::subtle::Barrier_AtomicIncrement(remaining_, -1) == 0)
+      done_->Signal();
+  }
+
+ private:
+  base::subtle::Atomic32* remaining_;
+  base::WaitableEvent* done_;
+
+  DISALLOW_COPY_AND_ASSIGN(NotifiedCounter);
+};
+
+typedef ObserverListThreadSafe<Notified> NotifiedList;
+
+void AddObserver(NotifiedList* list,
+                 Notified* observer,
+                 base::WaitableEvent* added) {
+  list->AddObserver(observer);
+  added->Signal();
+}
+
+void RemoveObserver(NotifiedList* list,
+                    Notified* observer,
+                    base::WaitableEvent* removed) {
+  list->RemoveObserver(observer);
+  removed->Signal();
+}
+
+// ObserverListThreadSafe::Notify() to observers on kObserverThreads threads,
+// until all have been notified. Each Notify() is an operation.
+base::TimeDelta NotifyFanOut(int iterations) {
+  const int kObservers = kObserverThreads * kObserversPerThread;
+  scoped_refptr<NotifiedList> list(new NotifiedList);
+  base::subtle::Atomic32 remaining = iterations * kObservers;
+  base::WaitableEvent done(false, false);
+  base::WaitableEvent event(false, false);
+
+  std::vector<base::Thread*> threads;
+  std::vector<NotifiedCounter*> observers;
+  for (int i = 0; i < kObserverThreads; ++i) {
+    base::Thread* thread = new base::Thread("Observer");
+    CHECK(thread->Start());
+    threads.push_back(thread);
+    for (int j = 0; j < kObserversPerThread; ++j) {
+      NotifiedCounter* observer = new NotifiedCounter(&remaining, &done);
+      observers.push_back(observer);
+      thread->message_loop()->PostTask(
+          FROM_HERE, base::Bind(&AddObserver, list, observer, &event));
+      event.Wait();
+    }
+  }
+
+  base::TimeTicks start = base::TimeTicks::HighResNow();
+  for (int i = 0; i < iterations; ++i)
+    list->Notify(&Notified::OnNotify);
+  done.Wait();
+  base::TimeDelta elapsed = base::TimeTicks::HighResNow() - start;
+
+  for (size_t i = 0; i < observers.size(); ++i) {
+    threads[i / kObserversPerThread]->message_loop()->PostTask(
+        FROM_HERE, base::Bind(&RemoveObserver, list, observers[i], &event));
+    event.Wait();
+  }
+  STLDeleteElements(&threads);
+  STLDeleteElements(&observers);
+  return elapsed;
+}
+
+struct Benchmark {
+  const char* name;
+  BenchmarkFunction function;
+};
+
+const Benchmark kBenchmarks[] = {
+  { "PostTaskSameThread", &PostTaskSameThread },
+  { "PostTaskCrossThread", &PostTaskCrossThread },
+  { "PostDelayedTaskInsertion", &PostDelayedTaskInsertion },
+  { "DelayedTaskCancellation", &DelayedTaskCancellation },
+  { "RoundTripLatency", &RoundTripLatency },
+  { "BindCreation", &BindCreation },
+  { "CallbackInvocation", &CallbackInvocation },
+  { "NotifyFanOut", &NotifyFanOut },
+};
+
+int GetIntSwitch(const CommandLine& command_line,
+                 const char* name,
+                 int default_value) {
+  int value;
+  if (!command_line.HasSwitch(name) ||
+      !base::StringToInt(command_line.GetSwitchValueASCII(name), &value) ||
+      value <= 0)
+    return default_value;
+  return value;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  base::AtExitManager at_exit;
+  CommandLine::Init(argc, argv);
+  const CommandLine& command_line = *CommandLine::ForCurrentProcess();
+
+  int iterations = GetIntSwitch(command_line, "iterations", kDefaultIterations);
+  int repetitions =
+      GetIntSwitch(command_line, "repetitions", kDefaultRepetitions);
+  std::string filter = command_line.GetSwitchValueASCII("filter");
+
+  printf("%d trials of %d operations, in ns per operation\n", repetitions,
+         iterations);
+  printf("%-28s %12s %12s %10s %21s\n", "benchmark", "median", "mean",
+         "stddev", "95% CI of mean");
+  for (size_t i = 0; i < arraysize(kBenchmarks); ++i) {
+    if (!filter.empty() &&
+        std::string(kBenchmarks[i].name).find(filter) == std::string::npos)
+      continue;
+    RunBenchmark(kBenchmarks[i].name, kBenchmarks[i].function, iterations,
+                 repetitions);
+  }
+  return 0;
+}
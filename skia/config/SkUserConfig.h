@@ -174,6 +174,11 @@
 SK_API void SkDebugf_FileLine(const char* file, int line, bool fatal,
                               const char* format, ...);
 
+// The glyph cache budget of the font hosts, which skia::SetFontCacheBudget()
+// in skia/ext/font_cache.h sets at run time.
+SK_API unsigned SkFontCacheBudget_Chrome();
+#define FONT_CACHE_MEMORY_BUDGET SkFontCacheBudget_Chrome()
+
 // Marking the debug print as "fatal" will cause a debug break, so we don't need
 // a separate crash call here.
 #define SK_DEBUGBREAK(cond) do { if (!(cond)) { \
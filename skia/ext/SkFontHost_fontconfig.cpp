@@ -64,9 +64,6 @@ static SkMutex global_remote_font_map_lock;
 static std::map<uint32_t, std::pair<uint8_t*, size_t> > global_remote_fonts;
 static unsigned global_next_remote_font_id;
 
-// This is the maximum size of the font cache.
-static const unsigned kFontCacheMemoryBudget = 2 * 1024 * 1024;  // 2MB
-
 // UniqueIds are encoded as (filefaceid << 8) | style
 // For system fonts, filefaceid = (fileid << 4) | face_index.
 // For remote fonts, filefaceid = fileid.
@@ -328,8 +325,10 @@ SkStream* SkFontHost::OpenStream(uint32_t id)
 
 size_t SkFontHost::ShouldPurgeFontCache(size_t sizeAllocatedSoFar)
 {
-    if (sizeAllocatedSoFar > kFontCacheMemoryBudget)
-        return sizeAllocatedSoFar - kFontCacheMemoryBudget;
+    // The budget is skia::SetFontCacheBudget()'s, see SkUserConfig.h.
+    const size_t budget = FONT_CACHE_MEMORY_BUDGET;
+    if (sizeAllocatedSoFar > budget)
+        return sizeAllocatedSoFar - budget;
     else
         return 0;   // nothing to do
 }
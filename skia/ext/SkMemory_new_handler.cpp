@@ -6,13 +6,17 @@
 #include <stdlib.h>
 #include <new>
 
+#include "base/debug/heap_profiler.h"
 #include "third_party/skia/include/core/SkTypes.h"
 #include "third_party/skia/include/core/SkThread.h"
 
 // This implementation of sk_malloc_flags() and friends is identical
 // to SkMemory_malloc.c, except that it disables the CRT's new_handler
 // during malloc(), when SK_MALLOC_THROW is not set (ie., when
-// sk_malloc_flags() would not abort on NULL).
+// sk_malloc_flags() would not abort on NULL), and that it tells
+// base::debug::HeapProfiler about the blocks.
+
+using base::debug::HeapProfiler;
 
 static SkMutex gSkNewHandlerMutex;
 
@@ -31,6 +35,8 @@ void* sk_malloc_throw(size_t size) {
 }
 
 void* sk_realloc_throw(void* addr, size_t size) {
+    // Told before realloc(), which may give the block to another thread.
+    HeapProfiler::RecordFree(addr);
     void* p = realloc(addr, size);
     if (size == 0) {
         return p;
@@ -38,11 +44,13 @@ void* sk_realloc_throw(void* addr, size_t size) {
     if (p == NULL) {
         sk_throw();
     }
+    HeapProfiler::RecordAlloc(p, size);
     return p;
 }
 
 void sk_free(void* p) {
     if (p) {
+        HeapProfiler::RecordFree(p);
         free(p);
     }
 }
@@ -67,5 +75,6 @@ void* sk_malloc_flags(size_t size, unsigned flags) {
             sk_throw();
         }
     }
+    HeapProfiler::RecordAlloc(p, size);
     return p;
 }
@@ -10,36 +10,101 @@
 #include "base/basictypes.h"
 #include "base/logging.h"
 #include "base/synchronization/lock.h"
+#include "build/build_config.h"
+
+#if defined(OS_WIN)
+#include <windows.h>
+
+#include "base/synchronization/srw_lock_functions_win.h"
+#endif
 
 int32_t sk_atomic_inc(int32_t* addr) {
-  // sk_atomic_inc is expected to return the old value, Barrier_AtomicIncrement
-  // returns the new value.
-  return base::subtle::Barrier_AtomicIncrement(addr, 1) - 1;
+  // Skia increments reference counts, which the caller already holds one of
+  // so they can't reach zero meanwhile, and id counters, which only need
+  // unique values. Neither orders other memory, so no barrier is needed.
+  // sk_atomic_inc is expected to return the old value,
+  // NoBarrier_AtomicIncrement returns the new value.
+  return base::subtle::NoBarrier_AtomicIncrement(addr, 1) - 1;
 }
 
 int32_t sk_atomic_dec(int32_t* addr) {
+  // The decrement that drops the last reference deletes the object, so it
+  // must follow the other owners' writes to it: each decrement releases, and
+  // the last one acquires. Barrier_AtomicIncrement is the increment that is
+  // both.
   // sk_atomic_dec is expected to return the old value, Barrier_AtomicIncrement
   // returns the new value.
   return base::subtle::Barrier_AtomicIncrement(addr, -1) + 1;
 }
 
+#if defined(OS_WIN)
+using base::internal::GetSRWLockFunctions;
+#endif
+
+namespace {
+
+#if defined(OS_WIN)
+// An SRWLOCK is a pointer that needs no cleanup, and an uncontended acquire
+// and release is one interlocked instruction each, where base::Lock's
+// CRITICAL_SECTION also checks the owning thread and the recursion count.
+// The SRWLOCK functions are shared with base::ReadWriteLock, and are only on
+// Vista and later.
+bool HasSRWLock() {
+  return GetSRWLockFunctions()->available();
+}
+
+// Returns the SRWLOCK in |storage|, aligned as a pointer.
+PSRWLOCK GetSRWLock(uint32_t* storage) {
+  uintptr_t address = reinterpret_cast<uintptr_t>(storage);
+  return reinterpret_cast<PSRWLOCK>(
+      (address + sizeof(void*) - 1) & ~(sizeof(void*) - 1));
+}
+#endif
+
+}  // namespace
+
 SkMutex::SkMutex(bool isGlobal) : fIsGlobal(isGlobal) {
+#if defined(OS_WIN)
+  if (HasSRWLock()) {
+    COMPILE_ASSERT(2 * sizeof(void*) <= sizeof(fStorage),
+                   SRWLOCK_is_too_big_for_SkMutex);
+    // InitializeSRWLock() just sets it to SRWLOCK_INIT.
+    GetSRWLock(fStorage)->Ptr = NULL;
+    return;
+  }
+#endif
   COMPILE_ASSERT(sizeof(base::Lock) <= sizeof(fStorage), Lock_is_too_big_for_SkMutex);
   base::Lock* lock = reinterpret_cast<base::Lock*>(fStorage);
   new(lock) base::Lock();
 }
 
 SkMutex::~SkMutex() {
+#if defined(OS_WIN)
+  if (HasSRWLock())
+    return;
+#endif
   base::Lock* lock = reinterpret_cast<base::Lock*>(fStorage);
   lock->~Lock();
 }
 
 void SkMutex::acquire() {
+#if defined(OS_WIN)
+  if (HasSRWLock()) {
+    GetSRWLockFunctions()->acquire_exclusive(GetSRWLock(fStorage));
+    return;
+  }
+#endif
   base::Lock* lock = reinterpret_cast<base::Lock*>(fStorage);
   lock->Acquire();
 }
 
 void SkMutex::release() {
+#if defined(OS_WIN)
+  if (HasSRWLock()) {
+    GetSRWLockFunctions()->release_exclusive(GetSRWLock(fStorage));
+    return;
+  }
+#endif
   base::Lock* lock = reinterpret_cast<base::Lock*>(fStorage);
   lock->Release();
 }
@@ -8,6 +8,7 @@
 #include "skia/ext/bitmap_platform_device_win.h"
 
 #include "skia/ext/bitmap_platform_device_data.h"
+#include "skia/ext/dib_section_pool_win.h"
 #include "third_party/skia/include/core/SkMatrix.h"
 #include "third_party/skia/include/core/SkRefCnt.h"
 #include "third_party/skia/include/core/SkRegion.h"
@@ -35,8 +36,9 @@ BitmapPlatformDevice::BitmapPlatformDeviceData::~BitmapPlatformDeviceData() {
   if (hdc_)
     ReleaseBitmapDC();
 
-  // this will free the bitmap data as well as the bitmap handle
-  DeleteObject(bitmap_context_);
+  // This gives the bitmap back to the pool it came from, or frees the bitmap
+  // data as well as the bitmap handle.
+  DIBSectionPool::GetInstance()->Release(bitmap_context_);
 }
 
 HDC BitmapPlatformDevice::BitmapPlatformDeviceData::GetBitmapDC() {
@@ -103,29 +105,38 @@ BitmapPlatformDevice* BitmapPlatformDevice::create(
     height = 1;
   }
 
-  BITMAPINFOHEADER hdr = {0};
-  hdr.biSize = sizeof(BITMAPINFOHEADER);
-  hdr.biWidth = width;
-  hdr.biHeight = -height;  // minus means top-down bitmap
-  hdr.biPlanes = 1;
-  hdr.biBitCount = 32;
-  hdr.biCompression = BI_RGB;  // no compression
-  hdr.biSizeImage = 0;
-  hdr.biXPelsPerMeter = 1;
-  hdr.biYPelsPerMeter = 1;
-  hdr.biClrUsed = 0;
-  hdr.biClrImportant = 0;
-
   void* data = NULL;
-  HBITMAP hbitmap = CreateDIBSection(screen_dc,
-                                     reinterpret_cast<BITMAPINFO*>(&hdr), 0,
-                                     &data,
-                                     shared_section, 0);
+  int row_bytes = width * 4;
+  HBITMAP hbitmap = NULL;
+  if (shared_section) {
+    BITMAPINFOHEADER hdr = {0};
+    hdr.biSize = sizeof(BITMAPINFOHEADER);
+    hdr.biWidth = width;
+    hdr.biHeight = -height;  // minus means top-down bitmap
+    hdr.biPlanes = 1;
+    hdr.biBitCount = 32;
+    hdr.biCompression = BI_RGB;  // no compression
+    hdr.biSizeImage = 0;
+    hdr.biXPelsPerMeter = 1;
+    hdr.biYPelsPerMeter = 1;
+    hdr.biClrUsed = 0;
+    hdr.biClrImportant = 0;
+
+    hbitmap = CreateDIBSection(screen_dc,
+                               reinterpret_cast<BITMAPINFO*>(&hdr), 0,
+                               &data,
+                               shared_section, 0);
+  } else {
+    // The bitmap may be bigger than asked for, in which case the device uses
+    // its top left corner.
+    hbitmap = DIBSectionPool::GetInstance()->Acquire(screen_dc, width, height,
+                                                     &data, &row_bytes);
+  }
   if (!hbitmap) {
     return NULL;
   }
 
-  bitmap.setConfig(SkBitmap::kARGB_8888_Config, width, height);
+  bitmap.setConfig(SkBitmap::kARGB_8888_Config, width, height, row_bytes);
   bitmap.setPixels(data);
   bitmap.setIsOpaque(is_opaque);
 
@@ -2,9 +2,13 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <string.h>
+
 #include <algorithm>
 
+#include "base/atomicops.h"
 #include "skia/ext/convolver.h"
+#include "skia/ext/convolver_simd.h"
 #include "third_party/skia/include/core/SkTypes.h"
 
 #if defined(SIMD_SSE2)
@@ -25,6 +29,8 @@ inline unsigned char ClampTo8(int a) {
   return 255;
 }
 
+}  // namespace
+
 // Stores a list of rows in a circular buffer. The usage is you write into it
 // by calling AdvanceRow. It will keep track of which row in the buffer it
 // should use next, and the total number of rows added.
@@ -112,6 +118,8 @@ class CircularRowBuffer {
   std::vector<unsigned char*> row_addresses_;
 };
 
+namespace {
+
 // Convolves horizontally along a single row. The row data is given in
 // |src_data| and continues for the num_values() of the filter.
 template<bool has_alpha>
@@ -158,6 +166,32 @@ void ConvolveHorizontally(const unsigned char* src_data,
   }
 }
 
+// Same as ConvolveHorizontally, but |filter| has three values per output
+// pixel, one for each subpixel, and channel |c| of each output pixel is
+// convolved with the filter of subpixel |channel_subpixels[c]|.
+template<bool has_alpha>
+void ConvolveHorizontallySubpixel(const unsigned char* src_data,
+                                  const ConvolutionFilter1D& filter,
+                                  const int channel_subpixels[4],
+                                  unsigned char* out_row) {
+  int num_values = filter.num_values() / 3;
+  for (int out_x = 0; out_x < num_values; out_x++) {
+    for (int c = 0; c < (has_alpha ? 4 : 3); c++) {
+      int filter_offset, filter_length;
+      const ConvolutionFilter1D::Fixed* filter_values =
+          filter.FilterForValue(out_x * 3 + channel_subpixels[c],
+                                &filter_offset, &filter_length);
+      const unsigned char* row_to_filter = &src_data[filter_offset * 4 + c];
+
+      int accum = 0;
+      for (int filter_x = 0; filter_x < filter_length; filter_x++)
+        accum += filter_values[filter_x] * row_to_filter[filter_x * 4];
+      out_row[out_x * 4 + c] =
+          ClampTo8(accum >> ConvolutionFilter1D::kShiftBits);
+    }
+  }
+}
+
 // Does vertical convolution to produce one output row. The filter values and
 // length are given in the first two parameters. These are applied to each
 // of the rows pointed to in the |source_data_rows| array, with each row
@@ -650,8 +684,106 @@ void ConvolveVertically_SSE2(const ConvolutionFilter1D::Fixed* filter_values,
 #endif
 }
 
+void ConvolveVertically_SSE2(const ConvolutionFilter1D::Fixed* filter_values,
+                             int filter_length,
+                             unsigned char* const* source_data_rows,
+                             int pixel_width,
+                             unsigned char* out_row,
+                             bool has_alpha) {
+  if (has_alpha) {
+    ConvolveVertically_SSE2<true>(filter_values, filter_length,
+                                  source_data_rows, pixel_width, out_row);
+  } else {
+    ConvolveVertically_SSE2<false>(filter_values, filter_length,
+                                   source_data_rows, pixel_width, out_row);
+  }
+}
+
+// The result of BestConvolutionSIMD(), or CONVOLUTION_SIMD_COUNT if it has not
+// been computed yet. Read and written by the resize worker threads.
+base::subtle::Atomic32 g_best_simd = CONVOLUTION_SIMD_COUNT;
+
+// Fills |procs| with the kernels for |simd| and returns true, or returns
+// false if they were not compiled in.
+bool SetupConvolveProcs(ConvolutionSIMD simd, ConvolveProcs* procs) {
+  switch (simd) {
+    case CONVOLUTION_SIMD_SSE2:
+#if defined(SIMD_SSE2)
+      procs->convolve_horizontally = &ConvolveHorizontally_SSE2;
+      procs->convolve_4rows_horizontally = &ConvolveHorizontally4_SSE2;
+      procs->convolve_vertically = &ConvolveVertically_SSE2;
+      return true;
+#else
+      return false;
+#endif
+    case CONVOLUTION_SIMD_AVX2:
+      return SetupAVX2ConvolveProcs(procs);
+    case CONVOLUTION_SIMD_NEON:
+      return SetupNEONConvolveProcs(procs);
+    default:
+      return false;
+  }
+}
+
 }  // namespace
 
+bool IsConvolutionSIMDSupported(ConvolutionSIMD simd) {
+  if (simd == CONVOLUTION_SIMD_NONE)
+    return true;
+  ConvolveProcs procs;
+  if (!SetupConvolveProcs(simd, &procs))
+    return false;
+#if defined(ARCH_CPU_X86_FAMILY)
+  // The processor is only queried once.
+  base::CPU::IntelMicroArchitecture architecture =
+      base::GetCPUMicroArchitecture();
+  if (simd == CONVOLUTION_SIMD_SSE2)
+    return architecture >= base::CPU::SSE2;
+  if (simd == CONVOLUTION_SIMD_AVX2)
+    return architecture >= base::CPU::AVX2;
+#endif
+  // NEON is only compiled in for processors that have it.
+  return true;
+}
+
+ConvolutionSIMD BestConvolutionSIMD() {
+  // Threads racing to initialize this all compute the same value.
+  base::subtle::Atomic32 best = base::subtle::NoBarrier_Load(&g_best_simd);
+  if (best == CONVOLUTION_SIMD_COUNT) {
+    ConvolutionSIMD simd = CONVOLUTION_SIMD_NONE;
+    if (IsConvolutionSIMDSupported(CONVOLUTION_SIMD_AVX2))
+      simd = CONVOLUTION_SIMD_AVX2;
+    else if (IsConvolutionSIMDSupported(CONVOLUTION_SIMD_SSE2))
+      simd = CONVOLUTION_SIMD_SSE2;
+    else if (IsConvolutionSIMDSupported(CONVOLUTION_SIMD_NEON))
+      simd = CONVOLUTION_SIMD_NEON;
+    best = simd;
+    base::subtle::NoBarrier_Store(&g_best_simd, best);
+  }
+  return static_cast<ConvolutionSIMD>(best);
+}
+
+void SetBestConvolutionSIMDForTesting(ConvolutionSIMD simd) {
+  SkASSERT(simd == CONVOLUTION_SIMD_COUNT ||
+           IsConvolutionSIMDSupported(simd));
+  base::subtle::NoBarrier_Store(&g_best_simd, simd);
+}
+
+const char* ConvolutionSIMDName(ConvolutionSIMD simd) {
+  switch (simd) {
+    case CONVOLUTION_SIMD_NONE:
+      return "C";
+    case CONVOLUTION_SIMD_SSE2:
+      return "SSE2";
+    case CONVOLUTION_SIMD_AVX2:
+      return "AVX2";
+    case CONVOLUTION_SIMD_NEON:
+      return "NEON";
+    default:
+      return "unknown";
+  }
+}
+
 // ConvolutionFilter1D ---------------------------------------------------------
 
 ConvolutionFilter1D::ConvolutionFilter1D()
@@ -722,12 +854,46 @@ void BGRAConvolve2D(const unsigned char* source_data,
                     const ConvolutionFilter1D& filter_y,
                     int output_byte_row_stride,
                     unsigned char* output,
-                    bool use_sse2) {
-#if !defined(SIMD_SSE2)
-  // Even we have runtime support for SSE2 instructions, since the binary
-  // was not built with SSE2 support, we had to fallback to C version.
-  use_sse2 = false;
-#endif
+                    bool use_simd) {
+  BGRAConvolve2D(source_data, source_byte_row_stride, source_has_alpha,
+                 filter_x, filter_y, output_byte_row_stride, output,
+                 use_simd ? BestConvolutionSIMD() : CONVOLUTION_SIMD_NONE);
+}
+
+void BGRAConvolve2D(const unsigned char* source_data,
+                    int source_byte_row_stride,
+                    bool source_has_alpha,
+                    const ConvolutionFilter1D& filter_x,
+                    const ConvolutionFilter1D& filter_y,
+                    int output_byte_row_stride,
+                    unsigned char* output,
+                    ConvolutionSIMD simd) {
+  BGRAConvolve2DRows(source_data, source_byte_row_stride, source_has_alpha,
+                     filter_x, filter_y, output_byte_row_stride, output, simd,
+                     0, filter_y.num_values());
+}
+
+void BGRAConvolve2DRows(const unsigned char* source_data,
+                        int source_byte_row_stride,
+                        bool source_has_alpha,
+                        const ConvolutionFilter1D& filter_x,
+                        const ConvolutionFilter1D& filter_y,
+                        int output_byte_row_stride,
+                        unsigned char* output,
+                        ConvolutionSIMD simd,
+                        int first_output_row,
+                        int num_output_rows) {
+  SkASSERT(first_output_row >= 0 && num_output_rows >= 0 &&
+           first_output_row + num_output_rows <= filter_y.num_values());
+  if (num_output_rows == 0)
+    return;
+
+  ConvolveProcs simd_procs;
+  bool use_simd = simd != CONVOLUTION_SIMD_NONE &&
+                  SetupConvolveProcs(simd, &simd_procs);
+  // Even if we have runtime support for the instructions, the binary may
+  // have been built without them; fall back to the C version then.
+  SkASSERT(use_simd || simd == CONVOLUTION_SIMD_NONE);
 
   int max_y_filter_size = filter_y.max_filter();
 
@@ -738,7 +904,7 @@ void BGRAConvolve2D(const unsigned char* source_data,
   // row for convolution as the first pixel for the first vertical filter.
   int filter_offset, filter_length;
   const ConvolutionFilter1D::Fixed* filter_values =
-      filter_y.FilterForValue(0, &filter_offset, &filter_length);
+      filter_y.FilterForValue(first_output_row, &filter_offset, &filter_length);
   int next_x_row = filter_offset;
 
   // We loop over each row in the input doing a horizontal convolution. This
@@ -752,7 +918,8 @@ void BGRAConvolve2D(const unsigned char* source_data,
   // TODO(jiesun): We do not use aligned load from row buffer in vertical
   // convolution pass yet. Somehow Windows does not like it.
   int row_buffer_width = (filter_x.num_values() + 15) & ~0xF;
-  int row_buffer_height = max_y_filter_size + (use_sse2 ? 4 : 0);
+  bool use_4rows = use_simd && simd_procs.convolve_4rows_horizontally;
+  int row_buffer_height = max_y_filter_size + (use_4rows ? 4 : 0);
   CircularRowBuffer row_buffer(row_buffer_width,
                                row_buffer_height,
                                filter_offset);
@@ -760,33 +927,35 @@ void BGRAConvolve2D(const unsigned char* source_data,
   // Loop over every possible output row, processing just enough horizontal
   // convolutions to run each subsequent vertical convolution.
   SkASSERT(output_byte_row_stride >= filter_x.num_values() * 4);
-  int num_output_rows = filter_y.num_values();
 
   // We need to check which is the last line to convolve before we advance 4
-  // lines in one iteration.
+  // lines in one iteration. This is the last line of the whole image, not
+  // just of the rows we produce, since the SIMD kernels may read beyond it.
   int last_filter_offset, last_filter_length;
-  filter_y.FilterForValue(num_output_rows - 1, &last_filter_offset,
+  filter_y.FilterForValue(filter_y.num_values() - 1, &last_filter_offset,
                           &last_filter_length);
 
-  for (int out_y = 0; out_y < num_output_rows; out_y++) {
+  int end_output_row = first_output_row + num_output_rows;
+  for (int out_y = first_output_row; out_y < end_output_row; out_y++) {
     filter_values = filter_y.FilterForValue(out_y,
                                             &filter_offset, &filter_length);
 
     // Generate output rows until we have enough to run the current filter.
-    if (use_sse2) {
+    if (use_simd) {
       while (next_x_row < filter_offset + filter_length) {
-        if (next_x_row + 3 < last_filter_offset + last_filter_length - 1) {
+        if (use_4rows &&
+            next_x_row + 3 < last_filter_offset + last_filter_length - 1) {
           const unsigned char* src[4];
           unsigned char* out_row[4];
           for (int i = 0; i < 4; ++i) {
             src[i] = &source_data[(next_x_row + i) * source_byte_row_stride];
             out_row[i] = row_buffer.AdvanceRow();
           }
-          ConvolveHorizontally4_SSE2(src, filter_x, out_row);
+          simd_procs.convolve_4rows_horizontally(src, filter_x, out_row);
           next_x_row += 4;
         } else {
-          // For the last row, SSE2 load possibly to access data beyond the
-          // image area. therefore we use C version here. 
+          // For the last row, SIMD load possibly to access data beyond the
+          // image area. therefore we use C version here.
           if (next_x_row == last_filter_offset + last_filter_length - 1) {
             if (source_has_alpha) {
               ConvolveHorizontally<true>(
@@ -798,7 +967,7 @@ void BGRAConvolve2D(const unsigned char* source_data,
                   filter_x, row_buffer.AdvanceRow());
             }
           } else {
-            ConvolveHorizontally_SSE2(
+            simd_procs.convolve_horizontally(
                 &source_data[next_x_row * source_byte_row_stride],
                 filter_x, row_buffer.AdvanceRow());
           }
@@ -833,28 +1002,465 @@ void BGRAConvolve2D(const unsigned char* source_data,
     unsigned char* const* first_row_for_filter =
         &rows_to_convolve[filter_offset - first_row_in_circular_buffer];
 
-    if (source_has_alpha) {
-      if (use_sse2) {
-        ConvolveVertically_SSE2<true>(filter_values, filter_length,
-                                      first_row_for_filter,
-                                      filter_x.num_values(), cur_output_row);
+    if (use_simd) {
+      simd_procs.convolve_vertically(filter_values, filter_length,
+                                     first_row_for_filter,
+                                     filter_x.num_values(), cur_output_row,
+                                     source_has_alpha);
+    } else if (source_has_alpha) {
+      ConvolveVertically<true>(filter_values, filter_length,
+                               first_row_for_filter,
+                               filter_x.num_values(), cur_output_row);
+    } else {
+      ConvolveVertically<false>(filter_values, filter_length,
+                                first_row_for_filter,
+                                filter_x.num_values(), cur_output_row);
+    }
+  }
+}
+
+void BGRAConvolve2DSubpixel(const unsigned char* source_data,
+                            int source_byte_row_stride,
+                            bool source_has_alpha,
+                            const ConvolutionFilter1D& filter_x,
+                            const int channel_subpixels[4],
+                            const ConvolutionFilter1D& filter_y,
+                            int output_byte_row_stride,
+                            unsigned char* output,
+                            ConvolutionSIMD simd) {
+  SkASSERT(filter_x.num_values() % 3 == 0);
+  ConvolveProcs simd_procs;
+  bool use_simd = simd != CONVOLUTION_SIMD_NONE &&
+                  SetupConvolveProcs(simd, &simd_procs);
+  SkASSERT(use_simd || simd == CONVOLUTION_SIMD_NONE);
+
+  int output_width = filter_x.num_values() / 3;
+  int filter_offset, filter_length;
+  filter_y.FilterForValue(0, &filter_offset, &filter_length);
+  int next_x_row = filter_offset;
+  // Padded as in BGRAConvolve2DRows for the vertical SIMD kernels.
+  int row_buffer_width = (output_width + 15) & ~0xF;
+  CircularRowBuffer row_buffer(row_buffer_width, filter_y.max_filter(),
+                               filter_offset);
+
+  for (int out_y = 0; out_y < filter_y.num_values(); out_y++) {
+    const ConvolutionFilter1D::Fixed* filter_values =
+        filter_y.FilterForValue(out_y, &filter_offset, &filter_length);
+
+    // The horizontal pass is only done in C, since each channel has its own
+    // filter; it produces a third of the pixels of a full resolution pass.
+    while (next_x_row < filter_offset + filter_length) {
+      const unsigned char* source_row =
+          &source_data[next_x_row * source_byte_row_stride];
+      if (source_has_alpha) {
+        ConvolveHorizontallySubpixel<true>(source_row, filter_x,
+                                           channel_subpixels,
+                                           row_buffer.AdvanceRow());
       } else {
-        ConvolveVertically<true>(filter_values, filter_length,
-                                 first_row_for_filter,
-                                 filter_x.num_values(), cur_output_row);
+        ConvolveHorizontallySubpixel<false>(source_row, filter_x,
+                                            channel_subpixels,
+                                            row_buffer.AdvanceRow());
       }
+      next_x_row++;
+    }
+
+    unsigned char* cur_output_row = &output[out_y * output_byte_row_stride];
+    int first_row_in_circular_buffer;
+    unsigned char* const* rows_to_convolve =
+        row_buffer.GetRowAddresses(&first_row_in_circular_buffer);
+    unsigned char* const* first_row_for_filter =
+        &rows_to_convolve[filter_offset - first_row_in_circular_buffer];
+
+    if (use_simd) {
+      simd_procs.convolve_vertically(filter_values, filter_length,
+                                     first_row_for_filter, output_width,
+                                     cur_output_row, source_has_alpha);
+    } else if (source_has_alpha) {
+      ConvolveVertically<true>(filter_values, filter_length,
+                               first_row_for_filter, output_width,
+                               cur_output_row);
     } else {
-      if (use_sse2) {
-        ConvolveVertically_SSE2<false>(filter_values, filter_length,
-                                       first_row_for_filter,
-                                       filter_x.num_values(), cur_output_row);
-      } else {
-        ConvolveVertically<false>(filter_values, filter_length,
-                                 first_row_for_filter,
-                                 filter_x.num_values(), cur_output_row);
+      ConvolveVertically<false>(filter_values, filter_length,
+                                first_row_for_filter, output_width,
+                                cur_output_row);
+    }
+  }
+}
+
+// Box downsampling ------------------------------------------------------------
+
+namespace {
+
+// Above this block size, the reciprocal in BoxDivisor is not exact.
+const int kMaxReciprocalBlockSize = 4096;
+
+// Divides the sums of blocks of |block_size| pixels, rounding down.
+class BoxDivisor {
+ public:
+  explicit BoxDivisor(uint32 block_size)
+      : block_size_(block_size),
+        // Multiplying by the rounded up reciprocal gives the exact quotient
+        // for all possible sums of blocks of up to kMaxReciprocalBlockSize
+        // pixels.
+        reciprocal_((GG_UINT64_C(1) << 32) / block_size + 1),
+        use_reciprocal_(block_size <= kMaxReciprocalBlockSize),
+        shift_(-1) {
+    if ((block_size & (block_size - 1)) == 0) {
+      shift_ = 0;
+      while ((1U << shift_) < block_size)
+        shift_++;
+    }
+  }
+
+  unsigned char Divide(uint32 sum) const {
+    if (use_reciprocal_)
+      return static_cast<unsigned char>((sum * reciprocal_) >> 32);
+    return static_cast<unsigned char>(sum / block_size_);
+  }
+
+  // The log2 of the block size if it is a power of 2, or -1.
+  int shift() const { return shift_; }
+
+ private:
+  uint32 block_size_;
+  uint64 reciprocal_;
+  bool use_reciprocal_;
+  int shift_;
+};
+
+// Adds the |num_bytes| bytes of |row| to |sums|.
+inline void AccumulateRow(const unsigned char* row, int num_bytes,
+                          uint16* sums) {
+  for (int i = 0; i < num_bytes; i++)
+    sums[i] += row[i];
+}
+
+// Writes the averages of the blocks of |factor_x| pixels of |sums|, which has
+// |source_width| pixels, for the output pixels [begin_x, end_x). The last
+// pixel is repeated to fill the last block.
+void AverageColumns(const uint16* sums, int source_width, int factor_x,
+                    const BoxDivisor& divisor, int begin_x, int end_x,
+                    unsigned char* out_row) {
+  for (int out_x = begin_x; out_x < end_x; out_x++) {
+    uint32 block_sums[4] = { 0, 0, 0, 0 };
+    int first_x = out_x * factor_x;
+    if (first_x + factor_x <= source_width) {
+      const uint16* column_sums = &sums[first_x * 4];
+      for (int i = 0; i < factor_x; i++, column_sums += 4) {
+        block_sums[0] += column_sums[0];
+        block_sums[1] += column_sums[1];
+        block_sums[2] += column_sums[2];
+        block_sums[3] += column_sums[3];
+      }
+    } else {
+      for (int i = 0; i < factor_x; i++) {
+        int source_x = std::min(first_x + i, source_width - 1);
+        const uint16* column_sums = &sums[source_x * 4];
+        block_sums[0] += column_sums[0];
+        block_sums[1] += column_sums[1];
+        block_sums[2] += column_sums[2];
+        block_sums[3] += column_sums[3];
+      }
+    }
+    for (int c = 0; c < 4; c++)
+      out_row[out_x * 4 + c] = divisor.Divide(block_sums[c]);
+  }
+}
+
+// Averages the 2x2 blocks of |row0| and |row1|, which have |source_width|
+// pixels, for the output pixels [begin_x, (source_width + 1) / 2). The last
+// pixel is repeated to fill the last block.
+void Downsample2x2(const unsigned char* row0, const unsigned char* row1,
+                   int source_width, int begin_x, unsigned char* out_row) {
+  const uint32* src0 = reinterpret_cast<const uint32*>(row0);
+  const uint32* src1 = reinterpret_cast<const uint32*>(row1);
+  uint32* dst = reinterpret_cast<uint32*>(out_row);
+  int output_width = (source_width + 1) / 2;
+  for (int out_x = begin_x; out_x < output_width; out_x++) {
+    // This is based on downsampleby2_proc32 in SkBitmap.cpp. It does two
+    // channels at once: alpha and green ("ag") and red and blue ("rb"). Each
+    // channel gets averaged across 4 pixels to get the result.
+    int x = out_x * 2;
+    int bump_x = x < source_width - 1;
+    uint32 tmp, ag, rb;
+    tmp = src0[x];
+    ag = (tmp >> 8) & 0xFF00FF;
+    rb = tmp & 0xFF00FF;
+    tmp = src0[x + bump_x];
+    ag += (tmp >> 8) & 0xFF00FF;
+    rb += tmp & 0xFF00FF;
+    tmp = src1[x];
+    ag += (tmp >> 8) & 0xFF00FF;
+    rb += tmp & 0xFF00FF;
+    tmp = src1[x + bump_x];
+    ag += (tmp >> 8) & 0xFF00FF;
+    rb += tmp & 0xFF00FF;
+    // Put the channels back together, dividing each by 4 to get the average.
+    // |ag| has the alpha and green channels shifted right by 8 bits from
+    // there they should end up, so shifting left by 6 gives them in the
+    // correct position divided by 4.
+    dst[out_x] = ((rb >> 2) & 0xFF00FF) | ((ag << 6) & 0xFF00FF00);
+  }
+}
+
+#if defined(SIMD_SSE2)
+void Downsample2x2_SSE2(const unsigned char* row0, const unsigned char* row1,
+                        int source_width, int begin_x,
+                        unsigned char* out_row) {
+  __m128i zero = _mm_setzero_si128();
+  // Four output pixels from eight pixels of each row at a time.
+  int out_x = begin_x;
+  for (; out_x * 2 + 8 <= source_width; out_x += 4) {
+    const __m128i* src0 = reinterpret_cast<const __m128i*>(row0 + out_x * 8);
+    const __m128i* src1 = reinterpret_cast<const __m128i*>(row1 + out_x * 8);
+    __m128i a0 = _mm_loadu_si128(src0);
+    __m128i a1 = _mm_loadu_si128(src0 + 1);
+    __m128i b0 = _mm_loadu_si128(src1);
+    __m128i b1 = _mm_loadu_si128(src1 + 1);
+    // [16] column sums of pixels 0-1, 2-3, 4-5 and 6-7.
+    __m128i s01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero),
+                                _mm_unpacklo_epi8(b0, zero));
+    __m128i s23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero),
+                                _mm_unpackhi_epi8(b0, zero));
+    __m128i s45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero),
+                                _mm_unpacklo_epi8(b1, zero));
+    __m128i s67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero),
+                                _mm_unpackhi_epi8(b1, zero));
+    // Add the even columns to the odd ones.
+    __m128i out01 = _mm_add_epi16(_mm_unpacklo_epi64(s01, s23),
+                                  _mm_unpackhi_epi64(s01, s23));
+    __m128i out23 = _mm_add_epi16(_mm_unpacklo_epi64(s45, s67),
+                                  _mm_unpackhi_epi64(s45, s67));
+    out01 = _mm_srli_epi16(out01, 2);
+    out23 = _mm_srli_epi16(out23, 2);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out_row + out_x * 4),
+                     _mm_packus_epi16(out01, out23));
+  }
+  Downsample2x2(row0, row1, source_width, out_x, out_row);
+}
+
+void AccumulateRow_SSE2(const unsigned char* row, int num_bytes,
+                        uint16* sums) {
+  __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 16 <= num_bytes; i += 16) {
+    __m128i src8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+    __m128i* sums_lo = reinterpret_cast<__m128i*>(sums + i);
+    __m128i* sums_hi = reinterpret_cast<__m128i*>(sums + i + 8);
+    _mm_storeu_si128(sums_lo, _mm_add_epi16(_mm_loadu_si128(sums_lo),
+                                            _mm_unpacklo_epi8(src8, zero)));
+    _mm_storeu_si128(sums_hi, _mm_add_epi16(_mm_loadu_si128(sums_hi),
+                                            _mm_unpackhi_epi8(src8, zero)));
+  }
+  AccumulateRow(row + i, num_bytes - i, sums + i);
+}
+
+// Same as AverageColumns for all the output pixels, but the blocks that are
+// entirely within the row are done with SSE2 when the block size is a power
+// of 2, which is the common case.
+void AverageColumns_SSE2(const uint16* sums, int source_width, int factor_x,
+                         const BoxDivisor& divisor, int begin_x, int end_x,
+                         unsigned char* out_row) {
+  int full_blocks = std::min(end_x, source_width / factor_x);
+  int out_x = begin_x;
+  if (divisor.shift() >= 0) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i shift = _mm_cvtsi32_si128(divisor.shift());
+    for (; out_x < full_blocks; out_x++) {
+      // 32 bits per channel for one pixel.
+      const uint16* column_sums = &sums[out_x * factor_x * 4];
+      __m128i accum = zero;
+      int i = 0;
+      for (; i + 2 <= factor_x; i += 2) {
+        __m128i two_columns = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(column_sums + i * 4));
+        accum = _mm_add_epi32(accum, _mm_unpacklo_epi16(two_columns, zero));
+        accum = _mm_add_epi32(accum, _mm_unpackhi_epi16(two_columns, zero));
+      }
+      if (i < factor_x) {
+        __m128i column = _mm_loadl_epi64(
+            reinterpret_cast<const __m128i*>(column_sums + i * 4));
+        accum = _mm_add_epi32(accum, _mm_unpacklo_epi16(column, zero));
       }
+      // The averages are at most 255, so packing does not saturate.
+      accum = _mm_srl_epi32(accum, shift);
+      accum = _mm_packs_epi32(accum, zero);
+      accum = _mm_packus_epi16(accum, zero);
+      *reinterpret_cast<int*>(&out_row[out_x * 4]) = _mm_cvtsi128_si32(accum);
     }
   }
+  AverageColumns(sums, source_width, factor_x, divisor, out_x, end_x,
+                 out_row);
+}
+#endif
+
+}  // namespace
+
+void BGRABoxDownsample(const unsigned char* source_data,
+                       int source_byte_row_stride,
+                       int source_width, int source_height,
+                       int factor_x, int factor_y,
+                       int output_byte_row_stride,
+                       unsigned char* output,
+                       ConvolutionSIMD simd) {
+  SkASSERT(source_width > 0 && source_height > 0);
+  SkASSERT(factor_x > 0 && factor_y > 0 &&
+           factor_y <= kMaxBoxDownsampleFactorY);
+  int output_width = (source_width + factor_x - 1) / factor_x;
+  int output_height = (source_height + factor_y - 1) / factor_y;
+
+  void (*downsample_2x2)(const unsigned char*, const unsigned char*, int, int,
+                         unsigned char*) = &Downsample2x2;
+  void (*accumulate_row)(const unsigned char*, int, uint16*) = &AccumulateRow;
+  void (*average_columns)(const uint16*, int, int, const BoxDivisor&, int, int,
+                          unsigned char*) = &AverageColumns;
+#if defined(SIMD_SSE2)
+  if (simd == CONVOLUTION_SIMD_SSE2 || simd == CONVOLUTION_SIMD_AVX2) {
+    downsample_2x2 = &Downsample2x2_SSE2;
+    accumulate_row = &AccumulateRow_SSE2;
+    average_columns = &AverageColumns_SSE2;
+  }
+#endif
+
+  // Halving is by far the most common, and is done straight from the source.
+  if (factor_x == 2 && factor_y == 2) {
+    for (int out_y = 0; out_y < output_height; out_y++) {
+      int source_y = out_y * 2;
+      downsample_2x2(
+          &source_data[source_y * source_byte_row_stride],
+          &source_data[std::min(source_y + 1, source_height - 1) *
+                       source_byte_row_stride],
+          source_width, 0, &output[out_y * output_byte_row_stride]);
+    }
+    return;
+  }
+
+  BoxDivisor divisor(factor_x * factor_y);
+
+  // The sums of the |factor_y| rows of the current block row, per channel.
+  // They fit in 16 bits since |factor_y| is at most kMaxBoxDownsampleFactorY.
+  int row_bytes = source_width * 4;
+  std::vector<uint16> sums(row_bytes);
+  for (int out_y = 0; out_y < output_height; out_y++) {
+    std::fill(sums.begin(), sums.end(), 0);
+    for (int i = 0; i < factor_y; i++) {
+      int source_y = std::min(out_y * factor_y + i, source_height - 1);
+      accumulate_row(&source_data[source_y * source_byte_row_stride],
+                     row_bytes, &sums[0]);
+    }
+    average_columns(&sums[0], source_width, factor_x, divisor, 0,
+                    output_width, &output[out_y * output_byte_row_stride]);
+  }
+}
+
+// BGRAStreamingConvolver ------------------------------------------------------
+
+BGRAStreamingConvolver::BGRAStreamingConvolver(
+    const ConvolutionFilter1D& filter_x,
+    const ConvolutionFilter1D& filter_y,
+    bool source_has_alpha,
+    ConvolutionSIMD simd)
+    : filter_x_(filter_x),
+      filter_y_(filter_y),
+      source_has_alpha_(source_has_alpha),
+      simd_procs_(new ConvolveProcs),
+      use_simd_(false),
+      source_row_bytes_(0),
+      next_source_row_(0),
+      first_source_row_(0),
+      end_source_row_(0),
+      next_output_row_(0) {
+  SkASSERT(filter_y.num_values() > 0);
+  use_simd_ = simd != CONVOLUTION_SIMD_NONE &&
+              SetupConvolveProcs(simd, simd_procs_.get());
+  SkASSERT(use_simd_ || simd == CONVOLUTION_SIMD_NONE);
+
+  // Only the source rows from the first one that the first output row needs
+  // to the last one that the last output row needs are convolved.
+  int filter_offset, filter_length;
+  filter_y.FilterForValue(0, &filter_offset, &filter_length);
+  first_source_row_ = filter_offset;
+  filter_y.FilterForValue(filter_y.num_values() - 1,
+                          &filter_offset, &filter_length);
+  end_source_row_ = filter_offset + filter_length;
+
+  // The horizontal SIMD kernels may read past the last pixel that the filter
+  // covers, which may be past the end of a decoder's row; they are given a
+  // padded copy of each row instead.
+  for (int out_x = 0; out_x < filter_x.num_values(); out_x++) {
+    filter_x.FilterForValue(out_x, &filter_offset, &filter_length);
+    source_row_bytes_ = std::max(source_row_bytes_,
+                                 (filter_offset + filter_length) * 4);
+  }
+  if (use_simd_)
+    padded_row_.resize(source_row_bytes_ + 16);
+
+  int row_buffer_width = (filter_x.num_values() + 15) & ~0xF;
+  row_buffer_.reset(new CircularRowBuffer(row_buffer_width,
+                                          filter_y.max_filter(),
+                                          first_source_row_));
+}
+
+BGRAStreamingConvolver::~BGRAStreamingConvolver() {
+}
+
+void BGRAStreamingConvolver::AddSourceRow(const unsigned char* source_row) {
+  // Otherwise the row buffer could drop rows that are still needed.
+  SkASSERT(!HasOutputRow());
+  int source_y = next_source_row_++;
+  if (source_y < first_source_row_ || source_y >= end_source_row_)
+    return;
+
+  unsigned char* out_row = row_buffer_->AdvanceRow();
+  if (use_simd_) {
+    memcpy(&padded_row_[0], source_row, source_row_bytes_);
+    simd_procs_->convolve_horizontally(&padded_row_[0], filter_x_, out_row);
+  } else if (source_has_alpha_) {
+    ConvolveHorizontally<true>(source_row, filter_x_, out_row);
+  } else {
+    ConvolveHorizontally<false>(source_row, filter_x_, out_row);
+  }
+}
+
+bool BGRAStreamingConvolver::HasOutputRow() const {
+  if (next_output_row_ >= filter_y_.num_values())
+    return false;
+  int filter_offset, filter_length;
+  filter_y_.FilterForValue(next_output_row_, &filter_offset, &filter_length);
+  return filter_offset + filter_length <= next_source_row_;
+}
+
+bool BGRAStreamingConvolver::WriteNextOutputRow(unsigned char* output_row) {
+  if (!HasOutputRow())
+    return false;
+
+  int filter_offset, filter_length;
+  const ConvolutionFilter1D::Fixed* filter_values =
+      filter_y_.FilterForValue(next_output_row_, &filter_offset,
+                               &filter_length);
+  next_output_row_++;
+
+  int first_row_in_circular_buffer;
+  unsigned char* const* rows_to_convolve =
+      row_buffer_->GetRowAddresses(&first_row_in_circular_buffer);
+  unsigned char* const* first_row_for_filter =
+      &rows_to_convolve[filter_offset - first_row_in_circular_buffer];
+
+  if (use_simd_) {
+    simd_procs_->convolve_vertically(filter_values, filter_length,
+                                     first_row_for_filter,
+                                     filter_x_.num_values(), output_row,
+                                     source_has_alpha_);
+  } else if (source_has_alpha_) {
+    ConvolveVertically<true>(filter_values, filter_length,
+                             first_row_for_filter,
+                             filter_x_.num_values(), output_row);
+  } else {
+    ConvolveVertically<false>(filter_values, filter_length,
+                              first_row_for_filter,
+                              filter_x_.num_values(), output_row);
+  }
+  return true;
 }
 
 }  // namespace skia
@@ -11,6 +11,7 @@
 
 #include "base/basictypes.h"
 #include "base/cpu.h"
+#include "base/memory/scoped_ptr.h"
 #include "third_party/skia/include/core/SkTypes.h"
 
 #if defined(ARCH_CPU_X86_FAMILY)
@@ -69,6 +70,12 @@ class ConvolutionFilter1D {
   // output image.
   int num_values() const { return static_cast<int>(filters_.size()); }
 
+  // Returns the number of bytes allocated for the filter tables.
+  size_t memory_usage() const {
+    return filters_.capacity() * sizeof(FilterInstance) +
+           filter_values_.capacity() * sizeof(Fixed);
+  }
+
   // Appends the given list of scaling values for generating a given output
   // pixel. |filter_offset| is the distance from the edge of the image to where
   // the scaling factors start. The scaling factors apply to the source pixels
@@ -160,6 +167,9 @@ class ConvolutionFilter1D {
 //
 // The layout in memory is assumed to be 4-bytes per pixel in B-G-R-A order
 // (this is ARGB when loaded into 32-bit words on a little-endian machine).
+//
+// If |use_simd| is true, the fastest SIMD instruction set supported by both
+// the binary and the processor is used (see BestConvolutionSIMD()).
 SK_API void BGRAConvolve2D(const unsigned char* source_data,
                            int source_byte_row_stride,
                            bool source_has_alpha,
@@ -167,7 +177,168 @@ SK_API void BGRAConvolve2D(const unsigned char* source_data,
                            const ConvolutionFilter1D& yfilter,
                            int output_byte_row_stride,
                            unsigned char* output,
-                           bool use_sse2);
+                           bool use_simd);
+
+// The instruction sets that BGRAConvolve2D can use. The results are the same
+// whichever is used.
+enum ConvolutionSIMD {
+  CONVOLUTION_SIMD_NONE,
+  CONVOLUTION_SIMD_SSE2,
+  CONVOLUTION_SIMD_AVX2,
+  CONVOLUTION_SIMD_NEON,
+  CONVOLUTION_SIMD_COUNT
+};
+
+// Returns true if |simd| was compiled in and is supported by the processor.
+// CONVOLUTION_SIMD_NONE is always supported.
+SK_API bool IsConvolutionSIMDSupported(ConvolutionSIMD simd);
+
+// Returns the fastest supported instruction set. The processor is only
+// queried once.
+SK_API ConvolutionSIMD BestConvolutionSIMD();
+
+// Makes BestConvolutionSIMD() return |simd|, which must be supported, so that
+// benchmarks can compare the instruction sets through ImageOperations.
+// CONVOLUTION_SIMD_COUNT restores the default.
+SK_API void SetBestConvolutionSIMDForTesting(ConvolutionSIMD simd);
+
+// Returns a short name for |simd|, such as "AVX2".
+SK_API const char* ConvolutionSIMDName(ConvolutionSIMD simd);
+
+// Same as above, using |simd|, which must be supported. Mostly useful to
+// compare the instruction sets.
+SK_API void BGRAConvolve2D(const unsigned char* source_data,
+                           int source_byte_row_stride,
+                           bool source_has_alpha,
+                           const ConvolutionFilter1D& xfilter,
+                           const ConvolutionFilter1D& yfilter,
+                           int output_byte_row_stride,
+                           unsigned char* output,
+                           ConvolutionSIMD simd);
+
+// Same as above, but only produces the |num_output_rows| output rows starting
+// at |first_output_row|, which are still written at their place in |output|.
+// Bands of rows of the same image can be convolved in parallel; the rows of
+// the source image that the vertical filter of each band covers are
+// convolved horizontally again for every band.
+SK_API void BGRAConvolve2DRows(const unsigned char* source_data,
+                               int source_byte_row_stride,
+                               bool source_has_alpha,
+                               const ConvolutionFilter1D& xfilter,
+                               const ConvolutionFilter1D& yfilter,
+                               int output_byte_row_stride,
+                               unsigned char* output,
+                               ConvolutionSIMD simd,
+                               int first_output_row,
+                               int num_output_rows);
+
+// Same as BGRAConvolve2D, for rendering into the subpixels of an LCD with
+// horizontal stripes in a single pass: |xfilter| has three values for each
+// output pixel, one for each subpixel from the left, and channel |c| (in
+// memory order) of each output pixel is convolved horizontally with the
+// filter of subpixel |channel_subpixels[c]|. The output has
+// xfilter.num_values() / 3 pixels per row.
+SK_API void BGRAConvolve2DSubpixel(const unsigned char* source_data,
+                                   int source_byte_row_stride,
+                                   bool source_has_alpha,
+                                   const ConvolutionFilter1D& xfilter,
+                                   const int channel_subpixels[4],
+                                   const ConvolutionFilter1D& yfilter,
+                                   int output_byte_row_stride,
+                                   unsigned char* output,
+                                   ConvolutionSIMD simd);
+
+// Downsamples the given source image by |factor_x| horizontally and
+// |factor_y| vertically, averaging each block of source pixels. The output
+// is (source_width + factor_x - 1) / factor_x by
+// (source_height + factor_y - 1) / factor_y pixels; when the source size is
+// not a multiple of the factor, the last row and column are repeated to fill
+// the blocks at the edges. The averages are rounded down, as
+// SkBitmapOperations::DownsampleByTwo always did, and are computed in
+// integers, so all instruction sets give the same result.
+//
+// |factor_y| may be at most kMaxBoxDownsampleFactorY.
+//
+// This is much faster than a box filter through BGRAConvolve2D with the
+// same ratio. SSE2 is used for CONVOLUTION_SIMD_SSE2 and
+// CONVOLUTION_SIMD_AVX2; other instruction sets use the C version.
+enum { kMaxBoxDownsampleFactorY = 65535 / 255 };
+SK_API void BGRABoxDownsample(const unsigned char* source_data,
+                              int source_byte_row_stride,
+                              int source_width, int source_height,
+                              int factor_x, int factor_y,
+                              int output_byte_row_stride,
+                              unsigned char* output,
+                              ConvolutionSIMD simd);
+
+class CircularRowBuffer;
+struct ConvolveProcs;
+
+// Does the same convolution as BGRAConvolve2D, but the rows of the source
+// image are added one at a time, for example as an image decoder produces
+// them, and output rows are written as soon as the source rows they depend
+// on have been added. Only yfilter.max_filter() horizontally convolved rows
+// are kept, so the source image never needs to be in memory.
+//
+// After adding each source row, write out every output row that became
+// available:
+//   convolver.AddSourceRow(row);
+//   while (convolver.WriteNextOutputRow(output_row))
+//     output_row += output_byte_row_stride;
+class SK_API BGRAStreamingConvolver {
+ public:
+  // The filters must outlive this object. |simd| must be supported.
+  BGRAStreamingConvolver(const ConvolutionFilter1D& xfilter,
+                         const ConvolutionFilter1D& yfilter,
+                         bool source_has_alpha,
+                         ConvolutionSIMD simd);
+  ~BGRAStreamingConvolver();
+
+  // Adds the next row of the source image, starting with row 0. Rows that no
+  // output row depends on are skipped. Must not be called while
+  // WriteNextOutputRow() would still write a row.
+  void AddSourceRow(const unsigned char* source_row);
+
+  // If the next output row only depends on source rows that were added,
+  // writes its xfilter.num_values() pixels to |output_row| and returns true.
+  bool WriteNextOutputRow(unsigned char* output_row);
+
+  // Returns true once all output rows have been written.
+  bool IsComplete() const {
+    return next_output_row_ == filter_y_.num_values();
+  }
+
+  // The number of the next source and output rows.
+  int next_source_row() const { return next_source_row_; }
+  int next_output_row() const { return next_output_row_; }
+
+ private:
+  bool HasOutputRow() const;
+
+  const ConvolutionFilter1D& filter_x_;
+  const ConvolutionFilter1D& filter_y_;
+  bool source_has_alpha_;
+
+  scoped_ptr<ConvolveProcs> simd_procs_;
+  bool use_simd_;
+
+  // The bytes of a source row that the horizontal filter covers, and a
+  // padded copy of the current row for the SIMD kernels.
+  int source_row_bytes_;
+  std::vector<unsigned char> padded_row_;
+
+  // Horizontally convolved rows.
+  scoped_ptr<CircularRowBuffer> row_buffer_;
+
+  int next_source_row_;
+  // The source rows the output depends on are [first, end).
+  int first_source_row_;
+  int end_source_row_;
+  int next_output_row_;
+
+  DISALLOW_COPY_AND_ASSIGN(BGRAStreamingConvolver);
+};
+
 }  // namespace skia
 
 #endif  // SKIA_EXT_CONVOLVER_H_
@@ -0,0 +1,263 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "skia/ext/convolver_simd.h"
+
+#include <string.h>
+
+// This file is compiled with AVX2 code generation enabled (see skia.gyp), so
+// __AVX2__ tells whether the compiler supports it.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace skia {
+
+#if defined(__AVX2__)
+
+namespace {
+
+// Both kernels use _mm256_madd_epi16, which multiplies pairs of 16 bit values
+// and adds each pair into a 32 bit value, on a channel of two pixels
+// interleaved with their two coefficients. The products of 8 bit pixels and
+// 16 bit coefficients, and their sums, fit in 32 bits, so the results are
+// exactly those of the C versions.
+
+// Reorders the bytes of four pixels so that the channels of pixels 0 and 1,
+// then of pixels 2 and 3, are interleaved:
+// [8] a3 a2 b3 b2 g3 g2 r3 r2 a1 a0 b1 b0 g1 g0 r1 r0
+inline __m128i InterleavePixelPairs(__m128i src8) {
+  const __m128i order = _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7,
+                                      8, 12, 9, 13, 10, 14, 11, 15);
+  return _mm_shuffle_epi8(src8, order);
+}
+
+// Loads four coefficients, keeping only the first |count|, and spreads them
+// so that they match the pixels of AccumulateFourTaps:
+// [16] c3 c2 c3 c2 c3 c2 c3 c2 c1 c0 c1 c0 c1 c0 c1 c0
+inline __m256i LoadFourCoefficients(const ConvolutionFilter1D::Fixed* values,
+                                    int count) {
+  __m128i coeff =
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(values));
+  if (count < 4) {
+    __m128i mask = _mm_cmplt_epi16(_mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7),
+                                   _mm_set1_epi16(count));
+    coeff = _mm_and_si128(coeff, mask);
+  }
+  return _mm256_permutevar8x32_epi32(_mm256_castsi128_si256(coeff),
+                                     _mm256_setr_epi32(0, 0, 0, 0,
+                                                       1, 1, 1, 1));
+}
+
+// Adds the four pixels at |src| multiplied by |coeff| to |accum|, whose low
+// half gathers the contributions of pixels 0 and 1, and whose high half those
+// of pixels 2 and 3 (32 bits per RGBA channel).
+inline __m256i AccumulateFourTaps(const unsigned char* src, __m256i coeff,
+                                  __m256i accum) {
+  __m128i src8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  // [16] a3 a2 b3 b2 g3 g2 r3 r2 | a1 a0 b1 b0 g1 g0 r1 r0
+  __m256i src16 = _mm256_cvtepu8_epi16(InterleavePixelPairs(src8));
+  return _mm256_add_epi32(accum, _mm256_madd_epi16(src16, coeff));
+}
+
+// Folds the halves of |accum| together and stores the resulting pixel.
+inline void StorePixel(__m256i accum, unsigned char* out) {
+  __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(accum),
+                              _mm256_extracti128_si256(accum, 1));
+  // Shift right for fixed point implementation.
+  sum = _mm_srai_epi32(sum, ConvolutionFilter1D::kShiftBits);
+  // Packing 32 bits to 16 bits per channel (signed saturation), and then to
+  // 8 bits (unsigned saturation).
+  sum = _mm_packs_epi32(sum, sum);
+  sum = _mm_packus_epi16(sum, sum);
+  *(reinterpret_cast<int*>(out)) = _mm_cvtsi128_si32(sum);
+}
+
+void ConvolveHorizontally_AVX2(const unsigned char* src_data,
+                               const ConvolutionFilter1D& filter,
+                               unsigned char* out_row) {
+  int num_values = filter.num_values();
+  int filter_offset, filter_length;
+  for (int out_x = 0; out_x < num_values; out_x++) {
+    const ConvolutionFilter1D::Fixed* filter_values =
+        filter.FilterForValue(out_x, &filter_offset, &filter_length);
+    const unsigned char* row_to_filter = &src_data[filter_offset << 2];
+
+    __m256i accum = _mm256_setzero_si256();
+    for (int filter_x = 0; filter_x < filter_length; filter_x += 4) {
+      __m256i coeff = LoadFourCoefficients(filter_values + filter_x,
+                                           filter_length - filter_x);
+      accum = AccumulateFourTaps(row_to_filter + (filter_x << 2), coeff,
+                                 accum);
+    }
+    StorePixel(accum, out_row);
+    out_row += 4;
+  }
+}
+
+void Convolve4RowsHorizontally_AVX2(const unsigned char* src_data[4],
+                                    const ConvolutionFilter1D& filter,
+                                    unsigned char* out_row[4]) {
+  int num_values = filter.num_values();
+  int filter_offset, filter_length;
+  for (int out_x = 0; out_x < num_values; out_x++) {
+    const ConvolutionFilter1D::Fixed* filter_values =
+        filter.FilterForValue(out_x, &filter_offset, &filter_length);
+    int start = filter_offset << 2;
+
+    __m256i accum0 = _mm256_setzero_si256();
+    __m256i accum1 = _mm256_setzero_si256();
+    __m256i accum2 = _mm256_setzero_si256();
+    __m256i accum3 = _mm256_setzero_si256();
+    for (int filter_x = 0; filter_x < filter_length; filter_x += 4) {
+      __m256i coeff = LoadFourCoefficients(filter_values + filter_x,
+                                           filter_length - filter_x);
+      int offset = start + (filter_x << 2);
+      accum0 = AccumulateFourTaps(src_data[0] + offset, coeff, accum0);
+      accum1 = AccumulateFourTaps(src_data[1] + offset, coeff, accum1);
+      accum2 = AccumulateFourTaps(src_data[2] + offset, coeff, accum2);
+      accum3 = AccumulateFourTaps(src_data[3] + offset, coeff, accum3);
+    }
+    StorePixel(accum0, out_row[0]);
+    StorePixel(accum1, out_row[1]);
+    StorePixel(accum2, out_row[2]);
+    StorePixel(accum3, out_row[3]);
+
+    out_row[0] += 4;
+    out_row[1] += 4;
+    out_row[2] += 4;
+    out_row[3] += 4;
+  }
+}
+
+// Convolves eight pixels (32 bytes) of the output starting at |byte_offset|,
+// two source rows per iteration.
+template<bool has_alpha>
+inline __m256i ConvolveEightPixelsVertically(
+    const ConvolutionFilter1D::Fixed* filter_values,
+    int filter_length,
+    unsigned char* const* source_data_rows,
+    int byte_offset) {
+  __m256i zero = _mm256_setzero_si256();
+  // Accumulated result for each pixel, 32 bits per RGBA channel. Within each
+  // 128 bit lane the pixels are in order, so accum0 holds pixels 0 and 4,
+  // accum1 pixels 1 and 5 and so on.
+  __m256i accum0 = zero;
+  __m256i accum1 = zero;
+  __m256i accum2 = zero;
+  __m256i accum3 = zero;
+  for (int filter_y = 0; filter_y < filter_length; filter_y += 2) {
+    const unsigned char* row_a = &source_data_rows[filter_y][byte_offset];
+    // An odd last row is paired with itself, with a zero coefficient.
+    bool has_b = filter_y + 1 < filter_length;
+    const unsigned char* row_b = has_b ?
+        &source_data_rows[filter_y + 1][byte_offset] : row_a;
+    unsigned coeff_b = has_b ?
+        static_cast<unsigned short>(filter_values[filter_y + 1]) : 0;
+    unsigned coeff_a = static_cast<unsigned short>(filter_values[filter_y]);
+    // [16] cb ca cb ca ...
+    __m256i coeff = _mm256_set1_epi32(static_cast<int>((coeff_b << 16) |
+                                                       coeff_a));
+
+    __m256i src_a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_a));
+    __m256i src_b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_b));
+    // [8] ... g1b g1a r1b r1a a0b a0a b0b b0a g0b g0a r0b r0a (per lane)
+    __m256i interleaved = _mm256_unpacklo_epi8(src_a, src_b);
+    accum0 = _mm256_add_epi32(accum0, _mm256_madd_epi16(
+        _mm256_unpacklo_epi8(interleaved, zero), coeff));
+    accum1 = _mm256_add_epi32(accum1, _mm256_madd_epi16(
+        _mm256_unpackhi_epi8(interleaved, zero), coeff));
+    interleaved = _mm256_unpackhi_epi8(src_a, src_b);
+    accum2 = _mm256_add_epi32(accum2, _mm256_madd_epi16(
+        _mm256_unpacklo_epi8(interleaved, zero), coeff));
+    accum3 = _mm256_add_epi32(accum3, _mm256_madd_epi16(
+        _mm256_unpackhi_epi8(interleaved, zero), coeff));
+  }
+
+  // Shift right for fixed point implementation.
+  accum0 = _mm256_srai_epi32(accum0, ConvolutionFilter1D::kShiftBits);
+  accum1 = _mm256_srai_epi32(accum1, ConvolutionFilter1D::kShiftBits);
+  accum2 = _mm256_srai_epi32(accum2, ConvolutionFilter1D::kShiftBits);
+  accum3 = _mm256_srai_epi32(accum3, ConvolutionFilter1D::kShiftBits);
+
+  // Packing to 16 and then 8 bits per channel puts the pixels back in order:
+  // [8] p7 p6 p5 p4 | p3 p2 p1 p0
+  accum0 = _mm256_packs_epi32(accum0, accum1);
+  accum2 = _mm256_packs_epi32(accum2, accum3);
+  accum0 = _mm256_packus_epi16(accum0, accum2);
+
+  if (has_alpha) {
+    // Make sure the value of alpha channel is always larger than maximum
+    // value of color channels; see ConvolveVertically_SSE2.
+    __m256i a = _mm256_srli_epi32(accum0, 8);
+    __m256i b = _mm256_max_epu8(a, accum0);  // Max of r and g.
+    a = _mm256_srli_epi32(accum0, 16);
+    b = _mm256_max_epu8(a, b);  // Max of r and g and b.
+    b = _mm256_slli_epi32(b, 24);
+    accum0 = _mm256_max_epu8(b, accum0);
+  } else {
+    // Set value of alpha channels to 0xFF.
+    accum0 = _mm256_or_si256(accum0, _mm256_set1_epi32(0xff000000));
+  }
+  return accum0;
+}
+
+template<bool has_alpha>
+void ConvolveVertically_AVX2(const ConvolutionFilter1D::Fixed* filter_values,
+                             int filter_length,
+                             unsigned char* const* source_data_rows,
+                             int pixel_width,
+                             unsigned char* out_row) {
+  int width = pixel_width & ~7;
+  for (int out_x = 0; out_x < width; out_x += 8) {
+    __m256i pixels = ConvolveEightPixelsVertically<has_alpha>(
+        filter_values, filter_length, source_data_rows, out_x << 2);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out_row + (out_x << 2)),
+                        pixels);
+  }
+
+  // The rows are padded, so the remaining pixels can be convolved as a block
+  // of eight; only the ones that belong to the output are stored.
+  if (pixel_width & 7) {
+    unsigned char block[32];
+    __m256i pixels = ConvolveEightPixelsVertically<has_alpha>(
+        filter_values, filter_length, source_data_rows, width << 2);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(block), pixels);
+    memcpy(out_row + (width << 2), block, (pixel_width & 7) << 2);
+  }
+}
+
+void ConvolveVertically_AVX2(const ConvolutionFilter1D::Fixed* filter_values,
+                             int filter_length,
+                             unsigned char* const* source_data_rows,
+                             int pixel_width,
+                             unsigned char* out_row,
+                             bool has_alpha) {
+  if (has_alpha) {
+    ConvolveVertically_AVX2<true>(filter_values, filter_length,
+                                  source_data_rows, pixel_width, out_row);
+  } else {
+    ConvolveVertically_AVX2<false>(filter_values, filter_length,
+                                   source_data_rows, pixel_width, out_row);
+  }
+}
+
+}  // namespace
+
+bool SetupAVX2ConvolveProcs(ConvolveProcs* procs) {
+  procs->convolve_horizontally = &ConvolveHorizontally_AVX2;
+  procs->convolve_4rows_horizontally = &Convolve4RowsHorizontally_AVX2;
+  procs->convolve_vertically = &ConvolveVertically_AVX2;
+  return true;
+}
+
+#else  // !defined(__AVX2__)
+
+bool SetupAVX2ConvolveProcs(ConvolveProcs* procs) {
+  return false;
+}
+
+#endif  // defined(__AVX2__)
+
+}  // namespace skia
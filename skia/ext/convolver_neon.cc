@@ -0,0 +1,185 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "skia/ext/convolver_simd.h"
+
+#include <string.h>
+
+// Builds with arm_neon == 1 target processors that all have NEON, so there is
+// no runtime check; __ARM_HAVE_NEON comes from skia.gyp.
+#if defined(__ARM_HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace skia {
+
+#if defined(__ARM_HAVE_NEON)
+
+namespace {
+
+// Multiplies the four pixels (16 bytes) at |src| by the four coefficients in
+// |coeff| and adds the products to |accum|, 32 bits per RGBA channel.
+inline int32x4_t AccumulateFourTaps(const unsigned char* src, int16x4_t coeff,
+                                    int32x4_t accum) {
+  uint8x16_t src8 = vld1q_u8(src);
+  // [16] a1 b1 g1 r1 a0 b0 g0 r0
+  int16x8_t src16 = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(src8)));
+  accum = vmlal_lane_s16(accum, vget_low_s16(src16), coeff, 0);
+  accum = vmlal_lane_s16(accum, vget_high_s16(src16), coeff, 1);
+  // [16] a3 b3 g3 r3 a2 b2 g2 r2
+  src16 = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(src8)));
+  accum = vmlal_lane_s16(accum, vget_low_s16(src16), coeff, 2);
+  accum = vmlal_lane_s16(accum, vget_high_s16(src16), coeff, 3);
+  return accum;
+}
+
+void ConvolveHorizontally_NEON(const unsigned char* src_data,
+                               const ConvolutionFilter1D& filter,
+                               unsigned char* out_row) {
+  // |mask| will be used to decimate all extra filter coefficients that are
+  // loaded when |filter_length| is not divisible by 4.
+  static const int16_t kMasks[4][4] = {
+    { 0, 0, 0, 0 },  // Not used.
+    { -1, 0, 0, 0 },
+    { -1, -1, 0, 0 },
+    { -1, -1, -1, 0 },
+  };
+
+  int num_values = filter.num_values();
+  int filter_offset, filter_length;
+  for (int out_x = 0; out_x < num_values; out_x++) {
+    const ConvolutionFilter1D::Fixed* filter_values =
+        filter.FilterForValue(out_x, &filter_offset, &filter_length);
+    const unsigned char* row_to_filter = &src_data[filter_offset << 2];
+
+    int32x4_t accum = vdupq_n_s32(0);
+    int filter_x = 0;
+    for (; filter_x + 4 <= filter_length; filter_x += 4) {
+      accum = AccumulateFourTaps(row_to_filter + (filter_x << 2),
+                                 vld1_s16(filter_values + filter_x), accum);
+    }
+    int r = filter_length & 3;
+    if (r) {
+      int16x4_t coeff = vand_s16(vld1_s16(filter_values + filter_x),
+                                 vld1_s16(kMasks[r]));
+      accum = AccumulateFourTaps(row_to_filter + (filter_x << 2), coeff,
+                                 accum);
+    }
+
+    // Shift right for fixed point implementation, then narrow to 16 and 8
+    // bits per channel with unsigned saturation.
+    accum = vshrq_n_s32(accum, ConvolutionFilter1D::kShiftBits);
+    uint16x4_t accum16 = vqmovun_s32(accum);
+    uint8x8_t accum8 = vqmovn_u16(vcombine_u16(accum16, accum16));
+    vst1_lane_u32(reinterpret_cast<uint32_t*>(out_row),
+                  vreinterpret_u32_u8(accum8), 0);
+    out_row += 4;
+  }
+}
+
+// Convolves four pixels (16 bytes) of the output starting at |byte_offset|.
+template<bool has_alpha>
+inline uint8x16_t ConvolveFourPixelsVertically(
+    const ConvolutionFilter1D::Fixed* filter_values,
+    int filter_length,
+    unsigned char* const* source_data_rows,
+    int byte_offset) {
+  // Accumulated result for each pixel. 32 bits per RGBA channel.
+  int32x4_t accum0 = vdupq_n_s32(0);
+  int32x4_t accum1 = vdupq_n_s32(0);
+  int32x4_t accum2 = vdupq_n_s32(0);
+  int32x4_t accum3 = vdupq_n_s32(0);
+  for (int filter_y = 0; filter_y < filter_length; filter_y++) {
+    int16_t coeff = filter_values[filter_y];
+    uint8x16_t src8 = vld1q_u8(&source_data_rows[filter_y][byte_offset]);
+    int16x8_t src16 = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(src8)));
+    accum0 = vmlal_n_s16(accum0, vget_low_s16(src16), coeff);
+    accum1 = vmlal_n_s16(accum1, vget_high_s16(src16), coeff);
+    src16 = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(src8)));
+    accum2 = vmlal_n_s16(accum2, vget_low_s16(src16), coeff);
+    accum3 = vmlal_n_s16(accum3, vget_high_s16(src16), coeff);
+  }
+
+  // Shift right for fixed point implementation, and narrow to 8 bits per
+  // channel with unsigned saturation.
+  uint16x8_t accum01 = vcombine_u16(
+      vqmovun_s32(vshrq_n_s32(accum0, ConvolutionFilter1D::kShiftBits)),
+      vqmovun_s32(vshrq_n_s32(accum1, ConvolutionFilter1D::kShiftBits)));
+  uint16x8_t accum23 = vcombine_u16(
+      vqmovun_s32(vshrq_n_s32(accum2, ConvolutionFilter1D::kShiftBits)),
+      vqmovun_s32(vshrq_n_s32(accum3, ConvolutionFilter1D::kShiftBits)));
+  uint8x16_t pixels = vcombine_u8(vqmovn_u16(accum01), vqmovn_u16(accum23));
+
+  uint32x4_t pixels32 = vreinterpretq_u32_u8(pixels);
+  if (has_alpha) {
+    // Make sure the value of alpha channel is always larger than maximum
+    // value of color channels; see ConvolveVertically_SSE2.
+    uint8x16_t a = vreinterpretq_u8_u32(vshrq_n_u32(pixels32, 8));
+    uint8x16_t b = vmaxq_u8(a, pixels);  // Max of r and g.
+    a = vreinterpretq_u8_u32(vshrq_n_u32(pixels32, 16));
+    b = vmaxq_u8(a, b);  // Max of r and g and b.
+    b = vreinterpretq_u8_u32(vshlq_n_u32(vreinterpretq_u32_u8(b), 24));
+    return vmaxq_u8(b, pixels);
+  }
+  // Set value of alpha channels to 0xFF.
+  return vreinterpretq_u8_u32(vorrq_u32(pixels32, vdupq_n_u32(0xff000000)));
+}
+
+template<bool has_alpha>
+void ConvolveVertically_NEON(const ConvolutionFilter1D::Fixed* filter_values,
+                             int filter_length,
+                             unsigned char* const* source_data_rows,
+                             int pixel_width,
+                             unsigned char* out_row) {
+  int width = pixel_width & ~3;
+  for (int out_x = 0; out_x < width; out_x += 4) {
+    vst1q_u8(out_row + (out_x << 2),
+             ConvolveFourPixelsVertically<has_alpha>(
+                 filter_values, filter_length, source_data_rows, out_x << 2));
+  }
+
+  // The rows are padded, so the remaining pixels can be convolved as a block
+  // of four; only the ones that belong to the output are stored.
+  if (pixel_width & 3) {
+    unsigned char block[16];
+    vst1q_u8(block,
+             ConvolveFourPixelsVertically<has_alpha>(
+                 filter_values, filter_length, source_data_rows, width << 2));
+    memcpy(out_row + (width << 2), block, (pixel_width & 3) << 2);
+  }
+}
+
+void ConvolveVertically_NEON(const ConvolutionFilter1D::Fixed* filter_values,
+                             int filter_length,
+                             unsigned char* const* source_data_rows,
+                             int pixel_width,
+                             unsigned char* out_row,
+                             bool has_alpha) {
+  if (has_alpha) {
+    ConvolveVertically_NEON<true>(filter_values, filter_length,
+                                  source_data_rows, pixel_width, out_row);
+  } else {
+    ConvolveVertically_NEON<false>(filter_values, filter_length,
+                                   source_data_rows, pixel_width, out_row);
+  }
+}
+
+}  // namespace
+
+bool SetupNEONConvolveProcs(ConvolveProcs* procs) {
+  procs->convolve_horizontally = &ConvolveHorizontally_NEON;
+  procs->convolve_4rows_horizontally = NULL;
+  procs->convolve_vertically = &ConvolveVertically_NEON;
+  return true;
+}
+
+#else  // !defined(__ARM_HAVE_NEON)
+
+bool SetupNEONConvolveProcs(ConvolveProcs* procs) {
+  return false;
+}
+
+#endif  // defined(__ARM_HAVE_NEON)
+
+}  // namespace skia
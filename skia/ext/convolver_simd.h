@@ -0,0 +1,52 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Internal to the convolver: the tables of SIMD kernels that BGRAConvolve2D
+// picks from. The AVX2 and NEON kernels live in their own files, since they
+// must be compiled with their own flags (see skia.gyp).
+
+#ifndef SKIA_EXT_CONVOLVER_SIMD_H_
+#define SKIA_EXT_CONVOLVER_SIMD_H_
+#pragma once
+
+#include "skia/ext/convolver.h"
+
+namespace skia {
+
+// The kernels for one instruction set. They compute exactly what the C
+// versions in convolver.cc compute, with the same restrictions as the SSE2
+// ones: the horizontal kernels may read up to 12 bytes past the last pixel
+// that the filter covers (so BGRAConvolve2D uses the C version for the last
+// row of the image), may read 3 coefficients past the end of the last filter
+// (see ConvolutionFilter1D::PaddingForSIMD), and the vertical kernel
+// may read and convolve up to 7 pixels past |pixel_width| (the row buffer is
+// padded for this), but only writes |pixel_width| pixels.
+struct ConvolveProcs {
+  // Convolves one row; see ConvolveHorizontally in convolver.cc.
+  void (*convolve_horizontally)(const unsigned char* src_data,
+                                const ConvolutionFilter1D& filter,
+                                unsigned char* out_row);
+
+  // Convolves four rows at once, or NULL if there is no such kernel.
+  void (*convolve_4rows_horizontally)(const unsigned char* src_data[4],
+                                      const ConvolutionFilter1D& filter,
+                                      unsigned char* out_row[4]);
+
+  // Produces one output row; see ConvolveVertically in convolver.cc.
+  void (*convolve_vertically)(const ConvolutionFilter1D::Fixed* filter_values,
+                              int filter_length,
+                              unsigned char* const* source_data_rows,
+                              int pixel_width,
+                              unsigned char* out_row,
+                              bool has_alpha);
+};
+
+// Fill |procs| and return true if the kernels were compiled into this binary.
+// They do not check that the processor supports them.
+bool SetupAVX2ConvolveProcs(ConvolveProcs* procs);
+bool SetupNEONConvolveProcs(ConvolveProcs* procs);
+
+}  // namespace skia
+
+#endif  // SKIA_EXT_CONVOLVER_SIMD_H_
@@ -4,6 +4,8 @@
 
 #include <string.h>
 #include <time.h>
+
+#include <algorithm>
 #include <vector>
 
 #include "base/basictypes.h"
@@ -211,10 +213,6 @@ TEST(Convolver, AddFilter) {
 }
 
 TEST(Convolver, SIMDVerification) {
-#if defined(SIMD_SSE2)
-  base::CPU cpu;
-  if (!cpu.has_sse2()) return;
-
   int source_sizes[][2] = { {1920, 1080}, {720, 480}, {1377, 523}, {325, 241} };
   int dest_sizes[][2] = { {1280, 1024}, {480, 270}, {177, 123} };
   float filter[] = { 0.05f, -0.15f, 0.6f, 0.6f, -0.15f, 0.05f };
@@ -245,16 +243,16 @@ TEST(Convolver, SIMDVerification) {
       }
 
       // Allocate input and output skia bitmap.
-      SkBitmap source, result_c, result_sse;
+      SkBitmap source, result_c, result_simd;
       source.setConfig(SkBitmap::kARGB_8888_Config,
                        source_width, source_height);
       source.allocPixels();
       result_c.setConfig(SkBitmap::kARGB_8888_Config,
                          dest_width, dest_height);
       result_c.allocPixels();
-      result_sse.setConfig(SkBitmap::kARGB_8888_Config,
-                           dest_width, dest_height);
-      result_sse.allocPixels();
+      result_simd.setConfig(SkBitmap::kARGB_8888_Config,
+                            dest_width, dest_height);
+      result_simd.allocPixels();
 
       // Randomize source bitmap for testing.
       unsigned char* src_ptr = static_cast<unsigned char*>(source.getPixels());
@@ -264,58 +262,129 @@ TEST(Convolver, SIMDVerification) {
         src_ptr += source.rowBytes();
       }
 
-      // Test both cases with different has_alpha.
+      // Test both cases with different has_alpha, with every instruction set.
       for (int alpha = 0; alpha < 2; alpha++) {
         // Convolve using C code.
         base::TimeTicks resize_start;
-        base::TimeDelta delta_c, delta_sse;
-        unsigned char* r1 = static_cast<unsigned char*>(result_c.getPixels());
-        unsigned char* r2 = static_cast<unsigned char*>(result_sse.getPixels());
-
+        base::TimeDelta delta_c, delta_simd;
         resize_start = base::TimeTicks::Now();
         BGRAConvolve2D(static_cast<const uint8*>(source.getPixels()),
                        static_cast<int>(source.rowBytes()),
                        alpha ? true : false, x_filter, y_filter,
-                       static_cast<int>(result_c.rowBytes()), r1, false);
+                       static_cast<int>(result_c.rowBytes()),
+                       static_cast<unsigned char*>(result_c.getPixels()),
+                       CONVOLUTION_SIMD_NONE);
         delta_c = base::TimeTicks::Now() - resize_start;
 
-        resize_start = base::TimeTicks::Now();
-        // Convolve using SSE2 code
-        BGRAConvolve2D(static_cast<const uint8*>(source.getPixels()),
-                       static_cast<int>(source.rowBytes()),
-                       alpha ? true : false, x_filter, y_filter,
-                       static_cast<int>(result_sse.rowBytes()), r2, true);
-        delta_sse = base::TimeTicks::Now() - resize_start;
-
-        // Unfortunately I could not enable the performance check now.
-        // Most bots use debug version, and there are great difference between
-        // the code generation for intrinsic, etc. In release version speed
-        // difference was 150%-200% depend on alpha channel presence;
-        // while in debug version speed difference was 96%-120%.
-        // TODO(jiesun): optimize further until we could enable this for
-        // debug version too.
-        // EXPECT_LE(delta_sse, delta_c);
-
-        int64 c_us = delta_c.InMicroseconds();
-        int64 sse_us = delta_sse.InMicroseconds();
-        LOG(INFO) << "from:" << source_width << "x" << source_height
-                  << " to:" << dest_width << "x" << dest_height
-                  << (alpha ? " with alpha" : " w/o alpha");
-        LOG(INFO) << "c:" << c_us << " sse:" << sse_us;
-        LOG(INFO) << "ratio:" << static_cast<float>(c_us) / sse_us;
-
-        // Comparing result.
-        for (unsigned int i = 0; i < dest_height; i++) {
-          for (unsigned int x = 0; x < dest_width * 4; x++) {  // RGBA always.
-            EXPECT_EQ(r1[x], r2[x]);
+        for (int k = CONVOLUTION_SIMD_NONE + 1; k < CONVOLUTION_SIMD_COUNT;
+             ++k) {
+          ConvolutionSIMD simd = static_cast<ConvolutionSIMD>(k);
+          if (!IsConvolutionSIMDSupported(simd))
+            continue;
+
+          resize_start = base::TimeTicks::Now();
+          BGRAConvolve2D(static_cast<const uint8*>(source.getPixels()),
+                         static_cast<int>(source.rowBytes()),
+                         alpha ? true : false, x_filter, y_filter,
+                         static_cast<int>(result_simd.rowBytes()),
+                         static_cast<unsigned char*>(result_simd.getPixels()),
+                         simd);
+          delta_simd = base::TimeTicks::Now() - resize_start;
+
+          // Unfortunately I could not enable the performance check now.
+          // Most bots use debug version, and there are great difference
+          // between the code generation for intrinsic, etc. In release
+          // version speed difference was 150%-200% depend on alpha channel
+          // presence; while in debug version speed difference was 96%-120%.
+          // TODO(jiesun): optimize further until we could enable this for
+          // debug version too.
+          // EXPECT_LE(delta_simd, delta_c);
+
+          int64 c_us = delta_c.InMicroseconds();
+          int64 simd_us = delta_simd.InMicroseconds();
+          LOG(INFO) << "from:" << source_width << "x" << source_height
+                    << " to:" << dest_width << "x" << dest_height
+                    << (alpha ? " with alpha" : " w/o alpha");
+          LOG(INFO) << "c:" << c_us << " " << ConvolutionSIMDName(simd)
+                    << ":" << simd_us;
+          LOG(INFO) << "ratio:" << static_cast<float>(c_us) / simd_us;
+
+          // Comparing result.
+          unsigned char* r1 = static_cast<unsigned char*>(result_c.getPixels());
+          unsigned char* r2 =
+              static_cast<unsigned char*>(result_simd.getPixels());
+          for (unsigned int i = 0; i < dest_height; i++) {
+            for (unsigned int x = 0; x < dest_width * 4; x++) {  // RGBA.
+              EXPECT_EQ(r1[x], r2[x]) << ConvolutionSIMDName(simd);
+            }
+            r1 += result_c.rowBytes();
+            r2 += result_simd.rowBytes();
           }
-          r1 += result_c.rowBytes();
-          r2 += result_sse.rowBytes();
         }
       }
     }
   }
-#endif
+}
+
+// Adding the source rows one at a time should give the same result as
+// convolving the whole image, with every instruction set.
+TEST(Convolver, Streaming) {
+  int source_width = 131, source_height = 97;
+  int dest_width = 53, dest_height = 61;
+  float filter[] = { 0.05f, -0.15f, 0.6f, 0.6f, -0.15f, 0.05f };
+
+  // The filters do not cover the first and last rows, which the streaming
+  // convolver should skip.
+  ConvolutionFilter1D x_filter, y_filter;
+  for (int p = 0; p < dest_width; ++p) {
+    int offset = std::min(source_width * p / dest_width,
+                          source_width - static_cast<int>(arraysize(filter)));
+    x_filter.AddFilter(offset, filter, arraysize(filter));
+  }
+  for (int p = 0; p < dest_height; ++p) {
+    int offset = std::min(1 + (source_height - 2) * p / dest_height,
+                          source_height - 1 -
+                              static_cast<int>(arraysize(filter)));
+    y_filter.AddFilter(offset, filter, arraysize(filter));
+  }
+  x_filter.PaddingForSIMD(8);
+  y_filter.PaddingForSIMD(8);
+
+  int source_row_bytes = source_width * 4;
+  std::vector<unsigned char> source(source_row_bytes * source_height);
+  for (size_t i = 0; i < source.size(); i++)
+    source[i] = rand() % 255;
+
+  int dest_row_bytes = dest_width * 4;
+  std::vector<unsigned char> expected(dest_row_bytes * dest_height);
+  std::vector<unsigned char> streamed(dest_row_bytes * dest_height);
+  for (int alpha = 0; alpha < 2; alpha++) {
+    BGRAConvolve2D(&source[0], source_row_bytes, alpha ? true : false,
+                   x_filter, y_filter, dest_row_bytes, &expected[0],
+                   CONVOLUTION_SIMD_NONE);
+
+    for (int k = CONVOLUTION_SIMD_NONE; k < CONVOLUTION_SIMD_COUNT; ++k) {
+      ConvolutionSIMD simd = static_cast<ConvolutionSIMD>(k);
+      if (!IsConvolutionSIMDSupported(simd))
+        continue;
+
+      memset(&streamed[0], 0, streamed.size());
+      BGRAStreamingConvolver convolver(x_filter, y_filter,
+                                       alpha ? true : false, simd);
+      unsigned char* output_row = &streamed[0];
+      for (int y = 0; y < source_height; y++) {
+        // Each row in its own buffer, like a decoder's.
+        std::vector<unsigned char> row(&source[y * source_row_bytes],
+                                       &source[(y + 1) * source_row_bytes]);
+        convolver.AddSourceRow(&row[0]);
+        while (convolver.WriteNextOutputRow(output_row))
+          output_row += dest_row_bytes;
+      }
+      EXPECT_TRUE(convolver.IsComplete()) << ConvolutionSIMDName(simd);
+      EXPECT_EQ(source_height, convolver.next_source_row());
+      EXPECT_TRUE(expected == streamed) << ConvolutionSIMDName(simd);
+    }
+  }
 }
 
 }  // namespace skia
@@ -0,0 +1,132 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "skia/ext/dib_section_pool_win.h"
+
+#include "base/memory/singleton.h"
+
+namespace skia {
+
+namespace {
+
+// The width and height of the DIB sections are rounded up to a multiple of
+// this, so that a DIB section serves the sizes a window is painted in, which
+// differ by a few pixels.
+const int kSizeStep = 64;
+
+// The most bytes of free DIB sections kept. DIB sections bigger than this
+// aren't kept at all.
+const size_t kMaxFreeBytes = 16 * 1024 * 1024;
+
+// Free DIB sections aren't kept for longer than this.
+const DWORD kMaxFreeTimeMs = 30 * 1000;
+
+int RoundUpToSizeStep(int size) {
+  return (size + kSizeStep - 1) / kSizeStep * kSizeStep;
+}
+
+HBITMAP CreateDIB(HDC screen_dc, int width, int height, void** data) {
+  BITMAPINFOHEADER hdr = {0};
+  hdr.biSize = sizeof(BITMAPINFOHEADER);
+  hdr.biWidth = width;
+  hdr.biHeight = -height;  // minus means top-down bitmap
+  hdr.biPlanes = 1;
+  hdr.biBitCount = 32;
+  hdr.biCompression = BI_RGB;  // no compression
+  hdr.biSizeImage = 0;
+  hdr.biXPelsPerMeter = 1;
+  hdr.biYPelsPerMeter = 1;
+  hdr.biClrUsed = 0;
+  hdr.biClrImportant = 0;
+
+  return CreateDIBSection(screen_dc, reinterpret_cast<BITMAPINFO*>(&hdr), 0,
+                          data, NULL, 0);
+}
+
+}  // namespace
+
+// static
+DIBSectionPool* DIBSectionPool::GetInstance() {
+  // Leaky, since the devices of other threads may still give back their DIB
+  // sections at exit.
+  return Singleton<DIBSectionPool,
+                   LeakySingletonTraits<DIBSectionPool> >::get();
+}
+
+HBITMAP DIBSectionPool::Acquire(HDC screen_dc, int width, int height,
+                                void** data, int* row_bytes) {
+  DIBSection section;
+  section.width = RoundUpToSizeStep(width);
+  section.height = RoundUpToSizeStep(height);
+  if (GetByteSize(section) > kMaxFreeBytes) {
+    // Too big to keep, so it's not worth handing out a bigger one.
+    *row_bytes = width * 4;
+    return CreateDIB(screen_dc, width, height, data);
+  }
+
+  base::AutoLock lock(lock_);
+  std::list<DIBSection>::iterator i = free_.begin();
+  while (i != free_.end() &&
+         (i->width != section.width || i->height != section.height))
+    ++i;
+  if (i != free_.end()) {
+    section = *i;
+    free_.erase(i);
+    free_bytes_ -= GetByteSize(section);
+  } else {
+    section.hbitmap = CreateDIB(screen_dc, section.width, section.height,
+                                &section.data);
+    if (!section.hbitmap)
+      return NULL;
+  }
+  in_use_[section.hbitmap] = section;
+  *data = section.data;
+  *row_bytes = section.width * 4;
+  return section.hbitmap;
+}
+
+void DIBSectionPool::Release(HBITMAP hbitmap) {
+  base::AutoLock lock(lock_);
+  std::map<HBITMAP, DIBSection>::iterator i = in_use_.find(hbitmap);
+  if (i == in_use_.end()) {
+    DeleteObject(hbitmap);
+    return;
+  }
+  DIBSection section = i->second;
+  in_use_.erase(i);
+  section.release_time = GetTickCount();
+  free_.push_front(section);
+  free_bytes_ += GetByteSize(section);
+  TrimToSize(kMaxFreeBytes);
+}
+
+void DIBSectionPool::Trim() {
+  base::AutoLock lock(lock_);
+  TrimToSize(0);
+}
+
+DIBSectionPool::DIBSectionPool() : free_bytes_(0) {
+}
+
+DIBSectionPool::~DIBSectionPool() {
+}
+
+// static
+size_t DIBSectionPool::GetByteSize(const DIBSection& section) {
+  return static_cast<size_t>(section.width) * section.height * 4;
+}
+
+void DIBSectionPool::TrimToSize(size_t max_bytes) {
+  lock_.AssertAcquired();
+  DWORD now = GetTickCount();
+  while (!free_.empty() &&
+         (free_bytes_ > max_bytes ||
+          now - free_.back().release_time > kMaxFreeTimeMs)) {
+    free_bytes_ -= GetByteSize(free_.back());
+    DeleteObject(free_.back().hbitmap);
+    free_.pop_back();
+  }
+}
+
+}  // namespace skia
@@ -0,0 +1,87 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SKIA_EXT_DIB_SECTION_POOL_WIN_H_
+#define SKIA_EXT_DIB_SECTION_POOL_WIN_H_
+#pragma once
+
+#include <windows.h>
+
+#include <list>
+#include <map>
+
+#include "base/basictypes.h"
+#include "base/synchronization/lock.h"
+#include "third_party/skia/include/core/SkTypes.h"
+
+template <typename T> struct DefaultSingletonTraits;
+
+namespace skia {
+
+// Keeps the DIB sections of the BitmapPlatformDevices that went away, so that
+// the next devices of about the same size use them rather than calling
+// CreateDIBSection(), which is a kernel call that takes longer than painting
+// most of what is painted into them. The sizes of the DIB sections are rounded
+// up, so that devices of close sizes share them, and the DIB sections that
+// aren't in use are deleted, least recently used first, past a memory cap, and
+// by Trim().
+class SK_API DIBSectionPool {
+ public:
+  static DIBSectionPool* GetInstance();
+
+  // Returns a top-down 32 bpp DIB section of at least |width| by |height|
+  // pixels, creating it with |screen_dc| if none is free, or NULL on failure.
+  // Sets |data| to its pixels and |row_bytes| to the length of its rows. The
+  // pixels are left as they were.
+  HBITMAP Acquire(HDC screen_dc, int width, int height, void** data,
+                  int* row_bytes);
+
+  // Gives back a DIB section, which must not be selected into a DC. The DIB
+  // sections Acquire() didn't return are deleted.
+  void Release(HBITMAP hbitmap);
+
+  // Deletes the DIB sections that aren't in use. Meant for when the
+  // application goes idle or to the background.
+  void Trim();
+
+ private:
+  friend struct DefaultSingletonTraits<DIBSectionPool>;
+
+  struct DIBSection {
+    HBITMAP hbitmap;
+    void* data;
+    int width;
+    int height;
+
+    // The GetTickCount() when the DIB section was given back.
+    DWORD release_time;
+  };
+
+  DIBSectionPool();
+  ~DIBSectionPool();
+
+  static size_t GetByteSize(const DIBSection& section);
+
+  // Deletes the least recently used free DIB sections until they take no more
+  // than |max_bytes|, and those that were freed over a while ago. |lock_| must
+  // be held.
+  void TrimToSize(size_t max_bytes);
+
+  // Protects the members below, since devices are created on several threads.
+  base::Lock lock_;
+
+  // The DIB sections that are free, most recently used first, and the bytes
+  // they take.
+  std::list<DIBSection> free_;
+  size_t free_bytes_;
+
+  // The DIB sections that were handed out, by handle.
+  std::map<HBITMAP, DIBSection> in_use_;
+
+  DISALLOW_COPY_AND_ASSIGN(DIBSectionPool);
+};
+
+}  // namespace skia
+
+#endif  // SKIA_EXT_DIB_SECTION_POOL_WIN_H_
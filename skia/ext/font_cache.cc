@@ -0,0 +1,128 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "skia/ext/font_cache.h"
+
+#include <algorithm>
+#include <map>
+
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/lazy_instance.h"
+#include "base/memory/purgeable_cache.h"
+#include "build/build_config.h"
+#include "third_party/skia/include/core/SkDescriptor.h"
+#include "third_party/skia/include/core/SkGraphics.h"
+#include "third_party/skia/include/core/SkScalerContext.h"
+#include "third_party/skia/src/core/SkGlyphCache.h"
+
+namespace skia {
+
+#if defined(OS_WIN)
+const size_t kDefaultFontCacheBudget = 1024 * 1024;
+#else
+const size_t kDefaultFontCacheBudget = 2 * 1024 * 1024;
+#endif
+
+namespace {
+
+// Read by the font hosts with the strikes' mutex held, so not guarded by it.
+base::subtle::AtomicWord g_font_cache_budget = kDefaultFontCacheBudget;
+
+// Purges the strikes on memory pressure.
+class FontCachePurger : public base::PurgeableCache {
+ public:
+  FontCachePurger() {
+    base::PurgeableCache::Register(this);
+  }
+
+  virtual void PurgeMemory(base::SystemMonitor::MemoryPressureLevel level) {
+    if (level == base::SystemMonitor::MEMORY_PRESSURE_CRITICAL)
+      PurgeFontCache(0);
+    else
+      PurgeFontCache(GetFontCacheBudget() / 4);
+  }
+
+ private:
+  // Never deleted, so never unregistered.
+  virtual ~FontCachePurger() {}
+
+  DISALLOW_COPY_AND_ASSIGN(FontCachePurger);
+};
+
+base::LazyInstance<FontCachePurger,
+                   base::LeakyLazyInstanceTraits<FontCachePurger> >
+    g_font_cache_purger(base::LINKER_INITIALIZED);
+
+typedef std::map<uint32_t, TypefaceCacheStats> StatsMap;
+
+// Adds the strike |cache| to the StatsMap |context|. Called with the
+// strikes' mutex held.
+bool AddStrikeStats(SkGlyphCache* cache, void* context) {
+  StatsMap* stats = static_cast<StatsMap*>(context);
+  const SkScalerContext::Rec* rec =
+      static_cast<const SkScalerContext::Rec*>(
+          cache->getDescriptor().findEntry(kRec_SkDescriptorTag, NULL));
+  if (!rec)
+    return false;
+  TypefaceCacheStats& typeface = (*stats)[rec->fFontID];
+  typeface.font_id = rec->fFontID;
+  typeface.strike_count++;
+  typeface.memory_used += cache->getMemoryUsed();
+  // Keep visiting.
+  return false;
+}
+
+bool UsesMoreMemory(const TypefaceCacheStats& a,
+                    const TypefaceCacheStats& b) {
+  return a.memory_used > b.memory_used;
+}
+
+}  // namespace
+
+void SetFontCacheBudget(size_t bytes) {
+  base::subtle::NoBarrier_Store(&g_font_cache_budget,
+                                static_cast<base::subtle::AtomicWord>(bytes));
+  PurgeFontCache(bytes);
+}
+
+size_t GetFontCacheBudget() {
+  return static_cast<size_t>(
+      base::subtle::NoBarrier_Load(&g_font_cache_budget));
+}
+
+size_t GetFontCacheUsed() {
+  return SkGraphics::GetFontCacheUsed();
+}
+
+void PurgeFontCache(size_t bytes) {
+  SkGraphics::SetFontCacheUsed(bytes);
+}
+
+void EnableFontCachePurging() {
+  g_font_cache_purger.Get();
+}
+
+TypefaceCacheStats::TypefaceCacheStats()
+    : font_id(0),
+      strike_count(0),
+      memory_used(0) {
+}
+
+void GetTypefaceCacheStats(std::vector<TypefaceCacheStats>* stats) {
+  StatsMap stats_map;
+  SkGlyphCache::VisitAllCaches(&AddStrikeStats, &stats_map);
+  stats->clear();
+  for (StatsMap::const_iterator it = stats_map.begin();
+       it != stats_map.end(); ++it)
+    stats->push_back(it->second);
+  std::sort(stats->begin(), stats->end(), &UsesMoreMemory);
+}
+
+}  // namespace skia
+
+// Declared in SkUserConfig.h, for the font hosts' FONT_CACHE_MEMORY_BUDGET.
+unsigned SkFontCacheBudget_Chrome() {
+  return static_cast<unsigned>(skia::GetFontCacheBudget());
+}
@@ -0,0 +1,58 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SKIA_EXT_FONT_CACHE_H_
+#define SKIA_EXT_FONT_CACHE_H_
+#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "third_party/skia/include/core/SkTypes.h"
+
+// Skia keeps the glyphs it rasterized in strikes, one per typeface, size and
+// style, in one list with the most recently used first. The font hosts free
+// the least recently used strikes when the strikes use more than the budget,
+// as each new one is added.
+
+namespace skia {
+
+// The budget until SetFontCacheBudget(): 1MB on Windows, 2MB with
+// fontconfig, which the font hosts used to hard-code.
+SK_API extern const size_t kDefaultFontCacheBudget;
+
+// Sets the most memory that the strikes may use, and frees the strikes over
+// it now. Can be called on any thread.
+SK_API void SetFontCacheBudget(size_t bytes);
+SK_API size_t GetFontCacheBudget();
+
+// Returns the memory that the strikes use.
+SK_API size_t GetFontCacheUsed();
+
+// Frees the least recently used strikes until they use at most |bytes|.
+SK_API void PurgeFontCache(size_t bytes);
+
+// Registers the strikes as a base::PurgeableCache, so that the
+// SystemMonitor's memory pressure notifications purge them: to a quarter of
+// the budget when moderate, all of them when critical. Later calls do
+// nothing.
+SK_API void EnableFontCachePurging();
+
+// The strikes of one typeface.
+struct SK_API TypefaceCacheStats {
+  TypefaceCacheStats();
+
+  uint32_t font_id;  // SkTypeface::uniqueID().
+  int strike_count;
+  size_t memory_used;
+};
+
+// Returns the stats of each typeface that has strikes, the ones using the
+// most memory first.
+SK_API void GetTypefaceCacheStats(std::vector<TypefaceCacheStats>* stats);
+
+}  // namespace skia
+
+#endif  // SKIA_EXT_FONT_CACHE_H_
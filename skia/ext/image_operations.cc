@@ -6,14 +6,22 @@
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <list>
+#include <map>
 
 #include "skia/ext/image_operations.h"
 
 // TODO(pkasting): skia/ext should not depend on base/!
+#include "base/bind.h"
 #include "base/debug/trace_event.h"
+#include "base/lazy_instance.h"
 #include "base/logging.h"
+#include "base/memory/ref_counted.h"
 #include "base/metrics/histogram.h"
 #include "base/stack_container.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/parallel_chunks.h"
+#include "base/threading/worker_pool.h"
 #include "base/time.h"
 #include "build/build_config.h"
 #include "skia/ext/convolver.h"
@@ -91,8 +99,9 @@ float EvalHamming(int filter_size, float x) {
 // ResizeFilter ----------------------------------------------------------------
 
 // Encapsulates computation and storage of the filters required for one complete
-// resize operation.
-class ResizeFilter {
+// resize operation. Filters are immutable once computed, and shared through
+// the ResizeFilterCache.
+class ResizeFilter : public base::RefCountedThreadSafe<ResizeFilter> {
  public:
   ResizeFilter(ImageOperations::ResizeMethod method,
                int src_full_width, int src_full_height,
@@ -107,7 +116,16 @@ class ResizeFilter {
   const ConvolutionFilter1D& x_filter() { return x_filter_; }
   const ConvolutionFilter1D& y_filter() { return y_filter_; }
 
+  // Returns the number of bytes used by the filters.
+  size_t memory_usage() const {
+    return sizeof(*this) + x_filter_.memory_usage() + y_filter_.memory_usage();
+  }
+
  private:
+  friend class base::RefCountedThreadSafe<ResizeFilter>;
+
+  ~ResizeFilter() {}
+
   // Returns the number of pixels that the filer spans, in filter space (the
   // destination image).
   float GetFilterSupport(float scale) {
@@ -350,6 +368,203 @@ ImageOperations::ResizeMethod ResizeMethodToAlgorithmMethod(
   }
 }
 
+// ResizeFilterCache -----------------------------------------------------------
+
+// Upper bound of the memory used by the cached filters. A downscale of a
+// 1000 pixel wide image with Lanczos3 takes roughly 50KB of filters, and
+// thumbnails and favicons need far less.
+const size_t kMaxFilterCacheBytes = 1024 * 1024;
+
+// Cache of ResizeFilters, most recently used first. Lookups and insertions
+// are made under a lock, since images are resized on many threads; the
+// filters themselves are refcounted so that evicting one does not affect a
+// resize that is using it.
+class ResizeFilterCache {
+ public:
+  ResizeFilterCache() : bytes_(0), hits_(0), misses_(0) {}
+
+  // Returns the filters for the given geometry, computing them on a miss.
+  scoped_refptr<ResizeFilter> GetFilter(ImageOperations::ResizeMethod method,
+                                        int src_full_width,
+                                        int src_full_height,
+                                        int dest_width, int dest_height,
+                                        const SkIRect& dest_subset) {
+    Key key(method, src_full_width, src_full_height, dest_width, dest_height,
+            dest_subset);
+    {
+      base::AutoLock lock(lock_);
+      KeyMap::iterator found = map_.find(key);
+      if (found != map_.end()) {
+        hits_++;
+        // Move the entry to the front.
+        entries_.splice(entries_.begin(), entries_, found->second);
+        return found->second->second;
+      }
+      misses_++;
+    }
+
+    // Compute outside of the lock, so that misses on different threads do
+    // not wait for each other. Two threads may both compute the same
+    // filters; only the first to finish caches them.
+    scoped_refptr<ResizeFilter> filter(new ResizeFilter(
+        method, src_full_width, src_full_height, dest_width, dest_height,
+        dest_subset));
+    size_t filter_bytes = filter->memory_usage();
+    if (filter_bytes > kMaxFilterCacheBytes)
+      return filter;
+
+    base::AutoLock lock(lock_);
+    if (map_.find(key) != map_.end())
+      return filter;
+    while (!entries_.empty() && bytes_ + filter_bytes > kMaxFilterCacheBytes) {
+      bytes_ -= entries_.back().second->memory_usage();
+      map_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+    entries_.push_front(std::make_pair(key, filter));
+    map_[key] = entries_.begin();
+    bytes_ += filter_bytes;
+    return filter;
+  }
+
+  ImageOperations::FilterCacheStats GetStats() {
+    base::AutoLock lock(lock_);
+    ImageOperations::FilterCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.entries = entries_.size();
+    stats.bytes = bytes_;
+    return stats;
+  }
+
+  void Clear() {
+    base::AutoLock lock(lock_);
+    map_.clear();
+    entries_.clear();
+    bytes_ = 0;
+    hits_ = 0;
+    misses_ = 0;
+  }
+
+ private:
+  // Everything the filters are computed from.
+  struct Key {
+    Key(ImageOperations::ResizeMethod method,
+        int src_full_width, int src_full_height,
+        int dest_width, int dest_height,
+        const SkIRect& dest_subset) {
+      values[0] = method;
+      values[1] = src_full_width;
+      values[2] = src_full_height;
+      values[3] = dest_width;
+      values[4] = dest_height;
+      values[5] = dest_subset.fLeft;
+      values[6] = dest_subset.fTop;
+      values[7] = dest_subset.fRight;
+      values[8] = dest_subset.fBottom;
+    }
+
+    bool operator<(const Key& other) const {
+      return std::lexicographical_compare(values, values + arraysize(values),
+                                          other.values,
+                                          other.values + arraysize(values));
+    }
+
+    int values[9];
+  };
+
+  typedef std::list<std::pair<Key, scoped_refptr<ResizeFilter> > > EntryList;
+  typedef std::map<Key, EntryList::iterator> KeyMap;
+
+  base::Lock lock_;
+  EntryList entries_;
+  KeyMap map_;
+  size_t bytes_;
+  size_t hits_;
+  size_t misses_;
+
+  DISALLOW_COPY_AND_ASSIGN(ResizeFilterCache);
+};
+
+// Leaky, as the resize workers may still be using the filters at exit, and
+// the benchmarks and tools that resize have no AtExitManager.
+base::LazyInstance<ResizeFilterCache,
+                   base::LeakyLazyInstanceTraits<ResizeFilterCache> >
+    g_filter_cache(base::LINKER_INITIALIZED);
+
+// ParallelConvolution ---------------------------------------------------------
+
+// Resizes smaller than this are not worth the cost of posting tasks.
+const int kMinParallelResizePixels = 256 * 256;
+
+// The fewest output rows that a band may have. Each band convolves the
+// source rows under its first output rows horizontally again, so thin bands
+// repeat a lot of work.
+const int kMinRowsPerBand = 16;
+
+// Splits one BGRAConvolve2D into |num_bands| horizontal bands of the output,
+// which share the same filters. base::RunParallelChunks() hands the bands out
+// to whichever thread asks first, so the calling thread of Run() never waits
+// for a band that no worker has started.
+class ParallelConvolution
+    : public base::RefCountedThreadSafe<ParallelConvolution> {
+ public:
+  ParallelConvolution(const unsigned char* source_data,
+                      int source_byte_row_stride,
+                      bool source_has_alpha,
+                      const ConvolutionFilter1D& filter_x,
+                      const ConvolutionFilter1D& filter_y,
+                      int output_byte_row_stride,
+                      unsigned char* output,
+                      int num_bands)
+      : source_data_(source_data),
+        source_byte_row_stride_(source_byte_row_stride),
+        source_has_alpha_(source_has_alpha),
+        filter_x_(filter_x),
+        filter_y_(filter_y),
+        output_byte_row_stride_(output_byte_row_stride),
+        output_(output),
+        simd_(BestConvolutionSIMD()),
+        num_bands_(num_bands) {
+  }
+
+  // Convolves all bands, using up to |num_bands_| - 1 worker threads, and
+  // returns when the output is complete.
+  void Run() {
+    base::RunParallelChunks(
+        num_bands_, base::Bind(&ParallelConvolution::ConvolveBand, this));
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<ParallelConvolution>;
+
+  ~ParallelConvolution() {}
+
+  void ConvolveBand(int band) {
+    int num_rows = filter_y_.num_values();
+    int first_row = static_cast<int>(
+        static_cast<int64>(num_rows) * band / num_bands_);
+    int end_row = static_cast<int>(
+        static_cast<int64>(num_rows) * (band + 1) / num_bands_);
+    BGRAConvolve2DRows(source_data_, source_byte_row_stride_,
+                       source_has_alpha_, filter_x_, filter_y_,
+                       output_byte_row_stride_, output_, simd_,
+                       first_row, end_row - first_row);
+  }
+
+  const unsigned char* source_data_;
+  int source_byte_row_stride_;
+  bool source_has_alpha_;
+  const ConvolutionFilter1D& filter_x_;
+  const ConvolutionFilter1D& filter_y_;
+  int output_byte_row_stride_;
+  unsigned char* output_;
+  ConvolutionSIMD simd_;
+  int num_bands_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelConvolution);
+};
+
 }  // namespace
 
 // Resize ----------------------------------------------------------------------
@@ -359,16 +574,122 @@ SkBitmap ImageOperations::Resize(const SkBitmap& source,
                                  ResizeMethod method,
                                  int dest_width, int dest_height,
                                  const SkIRect& dest_subset) {
+  if (method == ImageOperations::RESIZE_SUBPIXEL ||
+      method == ImageOperations::RESIZE_SUBPIXEL_FAST) {
+    return ResizeSubpixel(source, method, dest_width, dest_height, dest_subset,
+                          false);
+  } else {
+    return ResizeBasic(source, method, dest_width, dest_height, dest_subset,
+                       false);
+  }
+}
+
+// static
+SkBitmap ImageOperations::ResizeInParallel(const SkBitmap& source,
+                                           ResizeMethod method,
+                                           int dest_width, int dest_height,
+                                           const SkIRect& dest_subset) {
+  if (method == ImageOperations::RESIZE_SUBPIXEL ||
+      method == ImageOperations::RESIZE_SUBPIXEL_FAST) {
+    return ResizeSubpixel(source, method, dest_width, dest_height, dest_subset,
+                          true);
+  } else {
+    return ResizeBasic(source, method, dest_width, dest_height, dest_subset,
+                       true);
+  }
+}
+
+// StreamingImageResizer -------------------------------------------------------
+
+struct StreamingImageResizer::Core {
+  Core(const scoped_refptr<ResizeFilter>& resize_filter, bool source_has_alpha)
+      : filter(resize_filter),
+        convolver(filter->x_filter(), filter->y_filter(), source_has_alpha,
+                  BestConvolutionSIMD()) {
+  }
+
+  scoped_refptr<ResizeFilter> filter;
+  BGRAStreamingConvolver convolver;
+};
+
+StreamingImageResizer::StreamingImageResizer(
+    ImageOperations::ResizeMethod method,
+    int source_width, int source_height,
+    bool source_is_opaque,
+    int dest_width, int dest_height,
+    const SkIRect& dest_subset) {
+  Init(method, source_width, source_height, source_is_opaque,
+       dest_width, dest_height, dest_subset);
+}
+
+StreamingImageResizer::StreamingImageResizer(
+    ImageOperations::ResizeMethod method,
+    int source_width, int source_height,
+    bool source_is_opaque,
+    int dest_width, int dest_height) {
+  SkIRect dest_subset = { 0, 0, dest_width, dest_height };
+  Init(method, source_width, source_height, source_is_opaque,
+       dest_width, dest_height, dest_subset);
+}
+
+StreamingImageResizer::~StreamingImageResizer() {
+}
+
+void StreamingImageResizer::Init(ImageOperations::ResizeMethod method,
+                                 int source_width, int source_height,
+                                 bool source_is_opaque,
+                                 int dest_width, int dest_height,
+                                 const SkIRect& dest_subset) {
+  DCHECK(source_width > 0 && source_height > 0 &&
+         dest_width > 0 && dest_height > 0);
+  SkIRect dest = { 0, 0, dest_width, dest_height };
+  DCHECK(dest.contains(dest_subset)) <<
+      "The supplied subset does not fall within the destination image.";
+
+  method = ResizeMethodToAlgorithmMethod(method);
   if (method == ImageOperations::RESIZE_SUBPIXEL)
-    return ResizeSubpixel(source, dest_width, dest_height, dest_subset);
-  else
-    return ResizeBasic(source, method, dest_width, dest_height, dest_subset);
+    method = ImageOperations::RESIZE_LANCZOS3;
+  else if (method == ImageOperations::RESIZE_SUBPIXEL_FAST)
+    method = ImageOperations::RESIZE_LANCZOS2;
+  else if (method == ImageOperations::RESIZE_INTEGER_BOX)
+    method = ImageOperations::RESIZE_BOX;
+
+  core_.reset(new Core(g_filter_cache.Get().GetFilter(
+                           method, source_width, source_height,
+                           dest_width, dest_height, dest_subset),
+                       !source_is_opaque));
+}
+
+void StreamingImageResizer::AddSourceRow(const void* source_row) {
+  core_->convolver.AddSourceRow(
+      static_cast<const unsigned char*>(source_row));
+}
+
+bool StreamingImageResizer::WriteNextDestRow(void* dest_row) {
+  return core_->convolver.WriteNextOutputRow(
+      static_cast<unsigned char*>(dest_row));
+}
+
+bool StreamingImageResizer::IsComplete() const {
+  return core_->convolver.IsComplete();
+}
+
+// static
+ImageOperations::FilterCacheStats ImageOperations::GetFilterCacheStats() {
+  return g_filter_cache.Get().GetStats();
+}
+
+// static
+void ImageOperations::ClearFilterCache() {
+  g_filter_cache.Get().Clear();
 }
 
 // static
 SkBitmap ImageOperations::ResizeSubpixel(const SkBitmap& source,
+                                         ResizeMethod method,
                                          int dest_width, int dest_height,
-                                         const SkIRect& dest_subset) {
+                                         const SkIRect& dest_subset,
+                                         bool in_parallel) {
   TRACE_EVENT2("skia", "ImageOperations::ResizeSubpixel",
                "src_pixels", source.width()*source.height(),
                "dst_pixels", dest_width*dest_height);
@@ -395,11 +716,51 @@ SkBitmap ImageOperations::ResizeSubpixel(const SkBitmap& source,
   // Resize the image.
   const int width = dest_width * w;
   const int height = dest_height * h;
-  SkIRect subset = { dest_subset.fLeft, dest_subset.fTop,
-                     dest_subset.fLeft + dest_subset.width() * w,
-                     dest_subset.fTop + dest_subset.height() * h };
-  SkBitmap img = ResizeBasic(source, ImageOperations::RESIZE_LANCZOS3, width,
-                             height, subset);
+  SkIRect subset = { dest_subset.fLeft * w, dest_subset.fTop * h,
+                     dest_subset.fRight * w, dest_subset.fBottom * h };
+  const ResizeMethod kernel = method == RESIZE_SUBPIXEL_FAST ?
+      RESIZE_LANCZOS2 : RESIZE_LANCZOS3;
+
+  if (method == RESIZE_SUBPIXEL_FAST && w == 3 &&
+      order != SkFontHost::kNONE_LCDOrder) {
+    if (source.width() < 1 || source.height() < 1 ||
+        dest_width < 1 || dest_height < 1)
+      return SkBitmap();
+    SkAutoLockPixels locker(source);
+    if (!source.readyToDraw())
+      return SkBitmap();
+
+    scoped_refptr<ResizeFilter> filter = g_filter_cache.Get().GetFilter(
+        kernel, source.width(), source.height(), width, height, subset);
+
+    SkBitmap result;
+    result.setConfig(SkBitmap::kARGB_8888_Config, dest_subset.width(),
+                     dest_subset.height());
+    result.allocPixels();
+    if (!result.readyToDraw())
+      return SkBitmap();
+
+    // The channel of each byte of a pixel, and the subpixel it comes from.
+    // Alpha is taken from the middle one.
+    bool rgb = order == SkFontHost::kRGB_LCDOrder;
+    int channel_subpixels[4];
+    channel_subpixels[SK_R32_SHIFT / 8] = rgb ? 0 : 2;
+    channel_subpixels[SK_G32_SHIFT / 8] = 1;
+    channel_subpixels[SK_B32_SHIFT / 8] = rgb ? 2 : 0;
+    channel_subpixels[SK_A32_SHIFT / 8] = 1;
+    BGRAConvolve2DSubpixel(
+        reinterpret_cast<const uint8*>(source.getPixels()),
+        static_cast<int>(source.rowBytes()), !source.isOpaque(),
+        filter->x_filter(), channel_subpixels, filter->y_filter(),
+        static_cast<int>(result.rowBytes()),
+        static_cast<unsigned char*>(result.getPixels()),
+        BestConvolutionSIMD());
+    result.setIsOpaque(source.isOpaque());
+    return result;
+  }
+
+  SkBitmap img = ResizeBasic(source, kernel, width, height, subset,
+                             in_parallel);
   const int row_words = img.rowBytes() / 4;
   if (w == 1 && h == 1)
     return img;
@@ -480,7 +841,8 @@ SkBitmap ImageOperations::ResizeSubpixel(const SkBitmap& source,
 SkBitmap ImageOperations::ResizeBasic(const SkBitmap& source,
                                       ResizeMethod method,
                                       int dest_width, int dest_height,
-                                      const SkIRect& dest_subset) {
+                                      const SkIRect& dest_subset,
+                                      bool in_parallel) {
   TRACE_EVENT2("skia", "ImageOperations::ResizeBasic",
                "src_pixels", source.width()*source.height(),
                "dst_pixels", dest_width*dest_height);
@@ -512,8 +874,41 @@ SkBitmap ImageOperations::ResizeBasic(const SkBitmap& source,
   if (!source.readyToDraw())
       return SkBitmap();
 
-  ResizeFilter filter(method, source.width(), source.height(),
-                      dest_width, dest_height, dest_subset);
+  if (method == ImageOperations::RESIZE_INTEGER_BOX) {
+    int factor_x = source.width() / dest_width;
+    int factor_y = source.height() / dest_height;
+    if (factor_x * dest_width == source.width() &&
+        factor_y * dest_height == source.height() &&
+        factor_y <= kMaxBoxDownsampleFactorY) {
+      SkBitmap result;
+      result.setConfig(SkBitmap::kARGB_8888_Config,
+                       dest_subset.width(), dest_subset.height());
+      result.allocPixels();
+      if (!result.readyToDraw())
+        return SkBitmap();
+
+      // The blocks under the subset are a subset of the source.
+      BGRABoxDownsample(
+          reinterpret_cast<const uint8*>(source.getAddr32(
+              dest_subset.fLeft * factor_x, dest_subset.fTop * factor_y)),
+          static_cast<int>(source.rowBytes()),
+          dest_subset.width() * factor_x, dest_subset.height() * factor_y,
+          factor_x, factor_y,
+          static_cast<int>(result.rowBytes()),
+          static_cast<unsigned char*>(result.getPixels()),
+          BestConvolutionSIMD());
+      result.setIsOpaque(source.isOpaque());
+
+      base::TimeDelta delta = base::TimeTicks::Now() - resize_start;
+      UMA_HISTOGRAM_TIMES("Image.ResampleMS", delta);
+      return result;
+    }
+    method = ImageOperations::RESIZE_BOX;
+  }
+
+  scoped_refptr<ResizeFilter> filter = g_filter_cache.Get().GetFilter(
+      method, source.width(), source.height(),
+      dest_width, dest_height, dest_subset);
 
   // Get a source bitmap encompassing this touched area. We construct the
   // offsets and row strides such that it looks like a new bitmap, while
@@ -522,7 +917,6 @@ SkBitmap ImageOperations::ResizeBasic(const SkBitmap& source,
       reinterpret_cast<const uint8*>(source.getPixels());
 
   // Convolve into the result.
-  base::CPU cpu;
   SkBitmap result;
   result.setConfig(SkBitmap::kARGB_8888_Config,
                    dest_subset.width(), dest_subset.height());
@@ -530,11 +924,27 @@ SkBitmap ImageOperations::ResizeBasic(const SkBitmap& source,
   if (!result.readyToDraw())
     return SkBitmap();
 
-  BGRAConvolve2D(source_subset, static_cast<int>(source.rowBytes()),
-                 !source.isOpaque(), filter.x_filter(), filter.y_filter(),
-                 static_cast<int>(result.rowBytes()),
-                 static_cast<unsigned char*>(result.getPixels()),
-                 cpu.has_sse2());
+  int num_bands = 1;
+  if (in_parallel &&
+      dest_subset.width() * dest_subset.height() >= kMinParallelResizePixels) {
+    num_bands = std::min(base::WorkerPool::GetNumberOfCpuWorkers(),
+                         dest_subset.height() / kMinRowsPerBand);
+  }
+  if (num_bands > 1) {
+    scoped_refptr<ParallelConvolution> convolution(new ParallelConvolution(
+        source_subset, static_cast<int>(source.rowBytes()),
+        !source.isOpaque(), filter->x_filter(), filter->y_filter(),
+        static_cast<int>(result.rowBytes()),
+        static_cast<unsigned char*>(result.getPixels()),
+        num_bands));
+    convolution->Run();
+  } else {
+    BGRAConvolve2D(source_subset, static_cast<int>(source.rowBytes()),
+                   !source.isOpaque(), filter->x_filter(), filter->y_filter(),
+                   static_cast<int>(result.rowBytes()),
+                   static_cast<unsigned char*>(result.getPixels()),
+                   BestConvolutionSIMD());
+  }
 
   // Preserve the "opaque" flag for use as an optimization later.
   result.setIsOpaque(source.isOpaque());
@@ -553,4 +963,13 @@ SkBitmap ImageOperations::Resize(const SkBitmap& source,
   return Resize(source, method, dest_width, dest_height, dest_subset);
 }
 
+// static
+SkBitmap ImageOperations::ResizeInParallel(const SkBitmap& source,
+                                           ResizeMethod method,
+                                           int dest_width, int dest_height) {
+  SkIRect dest_subset = { 0, 0, dest_width, dest_height };
+  return ResizeInParallel(source, method, dest_width, dest_height,
+                          dest_subset);
+}
+
 }  // namespace skia
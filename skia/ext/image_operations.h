@@ -6,6 +6,8 @@
 #define SKIA_EXT_IMAGE_OPERATIONS_H_
 #pragma once
 
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
 #include "third_party/skia/include/core/SkTypes.h"
 
 class SkBitmap;
@@ -84,11 +86,24 @@ class SK_API ImageOperations {
     // appropriate we automatically fall back to Lanczos.
     RESIZE_SUBPIXEL,
 
+    // Faster RESIZE_SUBPIXEL, using a 2-cycle Lanczos filter. On LCDs with
+    // horizontal stripes, the most common, each channel is convolved with
+    // the filter of its own subpixel in a single pass, instead of resizing
+    // to three times the width and then picking the channels.
+    RESIZE_SUBPIXEL_FAST,
+
+    // Exact average of the block of source pixels covering each destination
+    // pixel, rounded down, when the source is an integer multiple of the
+    // destination size in each direction (such as a 2x, 4x or 8x reduction).
+    // This is much faster than the other methods. Other sizes, and
+    // reductions of more than 257x vertically, fall back to RESIZE_BOX.
+    RESIZE_INTEGER_BOX,
+
     // enum aliases for first and last methods by algorithm or by quality.
     RESIZE_FIRST_QUALITY_METHOD = RESIZE_GOOD,
     RESIZE_LAST_QUALITY_METHOD = RESIZE_BEST,
     RESIZE_FIRST_ALGORITHM_METHOD = RESIZE_BOX,
-    RESIZE_LAST_ALGORITHM_METHOD = RESIZE_SUBPIXEL,
+    RESIZE_LAST_ALGORITHM_METHOD = RESIZE_INTEGER_BOX,
   };
 
   // Resizes the given source bitmap using the specified resize method, so that
@@ -110,19 +125,105 @@ class SK_API ImageOperations {
                          ResizeMethod method,
                          int dest_width, int dest_height);
 
+  // Same as Resize, but large destinations are split into horizontal bands
+  // that are convolved in parallel on base::WorkerPool threads, sharing the
+  // same filters. The calling thread convolves bands too, and blocks until
+  // all are done. The result is identical to that of Resize.
+  static SkBitmap ResizeInParallel(const SkBitmap& source,
+                                   ResizeMethod method,
+                                   int dest_width, int dest_height,
+                                   const SkIRect& dest_subset);
+  static SkBitmap ResizeInParallel(const SkBitmap& source,
+                                   ResizeMethod method,
+                                   int dest_width, int dest_height);
+
+  // Resizes share a cache of the filters computed for each geometry (source
+  // size, destination size and subset, and algorithm), so that resizing many
+  // images to the same few sizes only computes the filters once. The cache is
+  // bounded in memory and evicts the least recently used filters.
+  struct FilterCacheStats {
+    size_t hits;
+    size_t misses;
+    size_t entries;
+    size_t bytes;
+  };
+  static FilterCacheStats GetFilterCacheStats();
+
+  // Empties the filter cache and resets its counters.
+  static void ClearFilterCache();
+
  private:
   ImageOperations();  // Class for scoping only.
 
-  // Supports all methods except RESIZE_SUBPIXEL.
+  // Supports all methods except RESIZE_SUBPIXEL and RESIZE_SUBPIXEL_FAST.
   static SkBitmap ResizeBasic(const SkBitmap& source,
                               ResizeMethod method,
                               int dest_width, int dest_height,
-                              const SkIRect& dest_subset);
+                              const SkIRect& dest_subset,
+                              bool in_parallel);
 
-  // Subpixel renderer.
+  // Subpixel renderer, for RESIZE_SUBPIXEL and RESIZE_SUBPIXEL_FAST.
   static SkBitmap ResizeSubpixel(const SkBitmap& source,
+                                 ResizeMethod method,
                                  int dest_width, int dest_height,
-                                 const SkIRect& dest_subset);
+                                 const SkIRect& dest_subset,
+                                 bool in_parallel);
+};
+
+// Resizes an image whose rows are supplied one at a time, for example by an
+// image decoder, so that the whole source image never needs to be decoded
+// into memory: only as many horizontally resized rows as the vertical filter
+// spans are kept. The output is the same as that of ImageOperations::Resize
+// with the same arguments, except that RESIZE_SUBPIXEL is done as
+// RESIZE_LANCZOS3, RESIZE_SUBPIXEL_FAST as RESIZE_LANCZOS2 and
+// RESIZE_INTEGER_BOX as RESIZE_BOX.
+//
+// After adding each source row, write out every destination row that became
+// available:
+//   resizer.AddSourceRow(row);
+//   while (resizer.WriteNextDestRow(dest_row))
+//     dest_row += dest_row_bytes;
+class SK_API StreamingImageResizer {
+ public:
+  // All sizes must be at least 1, and |dest_subset| must be a non-empty
+  // rectangle within the destination image. Only the |dest_subset| part of
+  // the destination is produced.
+  StreamingImageResizer(ImageOperations::ResizeMethod method,
+                        int source_width, int source_height,
+                        bool source_is_opaque,
+                        int dest_width, int dest_height,
+                        const SkIRect& dest_subset);
+  StreamingImageResizer(ImageOperations::ResizeMethod method,
+                        int source_width, int source_height,
+                        bool source_is_opaque,
+                        int dest_width, int dest_height);
+  ~StreamingImageResizer();
+
+  // Adds the next row of the source image, |source_width| pixels laid out as
+  // in an SkBitmap::kARGB_8888_Config bitmap. Must not be called while
+  // WriteNextDestRow() would still write a row.
+  void AddSourceRow(const void* source_row);
+
+  // If the next row of the destination subset is available, writes its
+  // pixels to |dest_row| and returns true.
+  bool WriteNextDestRow(void* dest_row);
+
+  // Returns true once all rows of the destination subset have been written.
+  bool IsComplete() const;
+
+ private:
+  // Holds the filters and the convolver.
+  struct Core;
+
+  void Init(ImageOperations::ResizeMethod method,
+            int source_width, int source_height,
+            bool source_is_opaque,
+            int dest_width, int dest_height,
+            const SkIRect& dest_subset);
+
+  scoped_ptr<Core> core_;
+
+  DISALLOW_COPY_AND_ASSIGN(StreamingImageResizer);
 };
 
 }  // namespace skia
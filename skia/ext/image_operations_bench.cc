@@ -13,6 +13,9 @@
 // source surface + destination surface and dividing by the elapsed time.
 // This number is somewhat reasonable way to measure this, given our current
 // implementation which somewhat scales this way.
+// The run is repeated with each SIMD instruction set that the convolver
+// supports on this machine, which also reports the throughput in megapixels
+// per second, counting the source and destination pixels for the same reason.
 
 #include <stdio.h>
 
@@ -24,6 +27,7 @@
 #include "base/string_util.h"
 #include "base/time.h"
 #include "base/utf_string_conversions.h"
+#include "skia/ext/convolver.h"
 #include "skia/ext/image_operations.h"
 #include "third_party/skia/include/core/SkBitmap.h"
 #include "third_party/skia/include/core/SkRect.h"
@@ -43,7 +47,9 @@ const StringMethodPair resize_methods[] = {
   ADD_METHOD(HAMMING1),
   ADD_METHOD(LANCZOS2),
   ADD_METHOD(LANCZOS3),
-  ADD_METHOD(SUBPIXEL)
+  ADD_METHOD(SUBPIXEL),
+  ADD_METHOD(SUBPIXEL_FAST),
+  ADD_METHOD(INTEGER_BOX)
 };
 
 // converts a string into one of the image operation method to resize.
@@ -151,6 +157,10 @@ class Benchmark {
 
   static void Usage();
  private:
+  // Runs the benchmark with the convolver using |simd|, and returns the
+  // time it took in microseconds.
+  int64 RunWithSIMD(skia::ConvolutionSIMD simd, const SkBitmap& source) const;
+
   int num_iterations_;
   skia::ImageOperations::ResizeMethod method_;
   Dimensions source_;
@@ -234,6 +244,28 @@ bool Benchmark::Run() const {
   source.allocPixels();
   source.eraseARGB(0, 0, 0, 0);
 
+  // The speedups are relative to the C version, which is always run first.
+  int64 c_elapsed_us = 0;
+  for (int i = 0; i < skia::CONVOLUTION_SIMD_COUNT; ++i) {
+    skia::ConvolutionSIMD simd = static_cast<skia::ConvolutionSIMD>(i);
+    if (!skia::IsConvolutionSIMDSupported(simd))
+      continue;
+    int64 elapsed_us = RunWithSIMD(simd, source);
+    if (simd == skia::CONVOLUTION_SIMD_NONE)
+      c_elapsed_us = elapsed_us;
+    else if (elapsed_us > 0)
+      printf("%-4s speedup over C: %.2fx\n", skia::ConvolutionSIMDName(simd),
+             static_cast<double>(c_elapsed_us) / elapsed_us);
+  }
+  skia::SetBestConvolutionSIMDForTesting(skia::CONVOLUTION_SIMD_COUNT);
+
+  return true;
+}
+
+int64 Benchmark::RunWithSIMD(skia::ConvolutionSIMD simd,
+                             const SkBitmap& source) const {
+  skia::SetBestConvolutionSIMDForTesting(simd);
+
   SkBitmap dest;
 
   const base::TimeTicks start = base::TimeTicks::Now();
@@ -249,12 +281,17 @@ bool Benchmark::Run() const {
   const uint64 num_bytes = static_cast<uint64>(num_iterations_) *
       (GetBitmapSize(&source) + GetBitmapSize(&dest));
 
-  printf("%"PRIu64" MB/s,\telapsed = %"PRIu64" source=%d dest=%d\n",
+  const uint64 num_pixels = static_cast<uint64>(num_iterations_) *
+      (source.width() * source.height() + dest.width() * dest.height());
+
+  printf("%-4s %"PRIu64" MB/s,\t%.1f MP/s,\telapsed = %"PRIu64
+         " source=%d dest=%d\n",
+         skia::ConvolutionSIMDName(simd),
          static_cast<uint64>(elapsed_us == 0 ? 0 : num_bytes / elapsed_us),
+         elapsed_us == 0 ? 0.0 : static_cast<double>(num_pixels) / elapsed_us,
          static_cast<uint64>(elapsed_us),
          GetBitmapSize(&source), GetBitmapSize(&dest));
-
-  return true;
+  return elapsed_us;
 }
 
 // A small class to automatically call Reset on the global command line to
@@ -8,9 +8,11 @@
 
 #include "base/basictypes.h"
 #include "base/file_util.h"
+#include "base/logging.h"
 #include "base/string_util.h"
 #include "skia/ext/image_operations.h"
 #include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf_test.h"
 #include "third_party/skia/include/core/SkBitmap.h"
 #include "third_party/skia/include/core/SkRect.h"
 #include "ui/gfx/codec/png_codec.h"
@@ -470,6 +472,177 @@ TEST(ImageOperations, HalveSubset) {
   }
 }
 
+// An integer ratio reduction should average each block of source pixels,
+// also for a subset.
+TEST(ImageOperations, IntegerBox) {
+  int src_w = 32, src_h = 27;
+  SkBitmap src;
+  FillDataToBitmap(src_w, src_h, &src);
+
+  int dest_w = src_w / 4, dest_h = src_h / 3;
+  SkIRect subset_rect = { 1, 2, 7, 8 };
+  for (int i = 0; i < 2; i++) {
+    SkIRect dest_subset = { 0, 0, dest_w, dest_h };
+    if (i == 1)
+      dest_subset = subset_rect;
+    SkBitmap actual_results = skia::ImageOperations::Resize(
+        src, skia::ImageOperations::RESIZE_INTEGER_BOX, dest_w, dest_h,
+        dest_subset);
+    ASSERT_EQ(dest_subset.width(), actual_results.width());
+    ASSERT_EQ(dest_subset.height(), actual_results.height());
+
+    SkAutoLockPixels lock(actual_results);
+    for (int y = 0; y < actual_results.height(); y++) {
+      for (int x = 0; x < actual_results.width(); x++) {
+        int first_x = (x + dest_subset.fLeft) * 4;
+        int first_y = (y + dest_subset.fTop) * 3;
+        EXPECT_EQ(AveragePixel(src, first_x, first_x + 3,
+                               first_y, first_y + 2),
+                  *actual_results.getAddr32(x, y))
+            << "pixel tested: (" << x << ", " << y << ")";
+      }
+    }
+  }
+}
+
+// Resizing in parallel bands should give exactly the same result as resizing
+// on one thread, including for a subset.
+TEST(ImageOperations, ResizeInParallel) {
+  int src_w = 700, src_h = 500;
+  SkBitmap src;
+  FillDataToBitmap(src_w, src_h, &src);
+
+  int dest_w = 497, dest_h = 911;
+  SkIRect subset_rect = { 13, 17, 480, 890 };
+  for (int i = 0; i < 2; i++) {
+    SkIRect dest_subset = { 0, 0, dest_w, dest_h };
+    if (i == 1)
+      dest_subset = subset_rect;
+    SkBitmap serial_results = skia::ImageOperations::Resize(
+        src, skia::ImageOperations::RESIZE_LANCZOS3, dest_w, dest_h,
+        dest_subset);
+    SkBitmap parallel_results = skia::ImageOperations::ResizeInParallel(
+        src, skia::ImageOperations::RESIZE_LANCZOS3, dest_w, dest_h,
+        dest_subset);
+    ASSERT_EQ(dest_subset.width(), parallel_results.width());
+    ASSERT_EQ(dest_subset.height(), parallel_results.height());
+
+    SkAutoLockPixels serial_lock(serial_results);
+    SkAutoLockPixels parallel_lock(parallel_results);
+    for (int y = 0; y < dest_subset.height(); y++) {
+      for (int x = 0; x < dest_subset.width(); x++) {
+        ASSERT_EQ(*serial_results.getAddr32(x, y),
+                  *parallel_results.getAddr32(x, y))
+            << "pixel tested: (" << x << ", " << y << ")";
+      }
+    }
+  }
+}
+
+class ImageOperationsPerfTest : public testing::PerfTest {
+ protected:
+  virtual void SetUp() {
+    FillDataToBitmap(640, 480, &src_);
+  }
+
+  SkBitmap src_;
+};
+
+// Guards the speed of the common thumbnailing resize, with
+// --perf_baselines.
+PERF_TEST_F(ImageOperationsPerfTest, ResizeLanczos3) {
+  SkBitmap dest = skia::ImageOperations::Resize(
+      src_, skia::ImageOperations::RESIZE_LANCZOS3, 212, 132);
+  ASSERT_EQ(212, dest.width());
+  ASSERT_EQ(132, dest.height());
+}
+
+// Resizing twice to the same geometry should reuse the filters, and give the
+// same result.
+TEST(ImageOperations, FilterCache) {
+  skia::ImageOperations::ClearFilterCache();
+
+  int src_w = 40, src_h = 30;
+  SkBitmap src;
+  FillDataToBitmap(src_w, src_h, &src);
+
+  SkBitmap first = skia::ImageOperations::Resize(
+      src, skia::ImageOperations::RESIZE_LANCZOS3, 16, 16);
+  skia::ImageOperations::FilterCacheStats stats =
+      skia::ImageOperations::GetFilterCacheStats();
+  EXPECT_EQ(0U, stats.hits);
+  EXPECT_EQ(1U, stats.misses);
+  EXPECT_EQ(1U, stats.entries);
+  EXPECT_LT(0U, stats.bytes);
+
+  SkBitmap second = skia::ImageOperations::Resize(
+      src, skia::ImageOperations::RESIZE_LANCZOS3, 16, 16);
+  stats = skia::ImageOperations::GetFilterCacheStats();
+  EXPECT_EQ(1U, stats.hits);
+  EXPECT_EQ(1U, stats.misses);
+  EXPECT_EQ(1U, stats.entries);
+
+  // A different method or subset needs different filters.
+  skia::ImageOperations::Resize(
+      src, skia::ImageOperations::RESIZE_BOX, 16, 16);
+  SkIRect subset_rect = { 2, 3, 10, 12 };
+  skia::ImageOperations::Resize(
+      src, skia::ImageOperations::RESIZE_LANCZOS3, 16, 16, subset_rect);
+  stats = skia::ImageOperations::GetFilterCacheStats();
+  EXPECT_EQ(1U, stats.hits);
+  EXPECT_EQ(3U, stats.misses);
+  EXPECT_EQ(3U, stats.entries);
+
+  SkAutoLockPixels first_lock(first);
+  SkAutoLockPixels second_lock(second);
+  for (int y = 0; y < 16; y++) {
+    for (int x = 0; x < 16; x++)
+      ASSERT_EQ(*first.getAddr32(x, y), *second.getAddr32(x, y));
+  }
+
+  skia::ImageOperations::ClearFilterCache();
+  stats = skia::ImageOperations::GetFilterCacheStats();
+  EXPECT_EQ(0U, stats.hits);
+  EXPECT_EQ(0U, stats.entries);
+  EXPECT_EQ(0U, stats.bytes);
+}
+
+// Streaming the source rows through a StreamingImageResizer should give the
+// same result as resizing the whole bitmap.
+TEST(ImageOperations, StreamingResize) {
+  int src_w = 91, src_h = 73;
+  SkBitmap src;
+  FillDataToBitmap(src_w, src_h, &src);
+
+  int dest_w = 40, dest_h = 150;
+  SkIRect dest_subset = { 3, 20, 37, 130 };
+  SkBitmap expected = skia::ImageOperations::Resize(
+      src, skia::ImageOperations::RESIZE_LANCZOS2, dest_w, dest_h,
+      dest_subset);
+
+  skia::StreamingImageResizer resizer(
+      skia::ImageOperations::RESIZE_LANCZOS2, src_w, src_h, src.isOpaque(),
+      dest_w, dest_h, dest_subset);
+  std::vector<uint32_t> dest(dest_subset.width() * dest_subset.height());
+  uint32_t* dest_row = &dest[0];
+  SkAutoLockPixels src_lock(src);
+  for (int y = 0; y < src_h; y++) {
+    EXPECT_FALSE(resizer.IsComplete());
+    resizer.AddSourceRow(src.getAddr32(0, y));
+    while (resizer.WriteNextDestRow(dest_row))
+      dest_row += dest_subset.width();
+  }
+  EXPECT_TRUE(resizer.IsComplete());
+
+  SkAutoLockPixels expected_lock(expected);
+  for (int y = 0; y < dest_subset.height(); y++) {
+    for (int x = 0; x < dest_subset.width(); x++) {
+      ASSERT_EQ(*expected.getAddr32(x, y), dest[y * dest_subset.width() + x])
+          << "pixel tested: (" << x << ", " << y << ")";
+    }
+  }
+}
+
 // Resamples an image to the same image, it should give the same result.
 TEST(ImageOperations, ResampleToSameHamming1) {
   CheckResampleToSame(skia::ImageOperations::RESIZE_HAMMING1);
@@ -525,6 +698,10 @@ TEST(ImageOperations, ResizeShouldAverageColors) {
     // a distance limit for each tested pixel for each method was judged to add
     // unneeded complexity.
     { skia::ImageOperations::RESIZE_SUBPIXEL, "SUBPIXEL", 6.4f },
+    // SUBPIXEL_FAST samples the red and blue subpixels with a shorter filter,
+    // which averages fewer checker periods near the top edge (10.77 in the
+    // top right corner).
+    { skia::ImageOperations::RESIZE_SUBPIXEL_FAST, "SUBPIXEL_FAST", 11.0f },
 #endif
   };
 
@@ -642,3 +819,74 @@ TEST(ImageOperations, CompareLanczosMethods) {
 #endif  // #if DEBUG_BITMAP_GENERATION
   }
 }
+
+#if defined(OS_POSIX) && !defined(GTV) && !defined(OS_MACOSX)
+// Reports how much RESIZE_SUBPIXEL_FAST differs from RESIZE_SUBPIXEL on the
+// grid of CompareLanczosMethods. The maximum observed distance is 10.0 and
+// the average 0.59; as above, the limits only catch egregious regressions.
+TEST(ImageOperations, CompareSubpixelMethods) {
+  const int src_w = 640, src_h = 480, src_grid_pitch = 8, src_grid_width = 4;
+
+  const int dest_w = src_w / 4;
+  const int dest_h = src_h / 4;
+
+  const float max_color_distance = 12.1f;
+  const float max_average_color_distance = 1.0f;
+
+  SkColor grid_color = SK_ColorRED, background_color = SK_ColorBLUE;
+  SkBitmap src;
+  DrawGridToBitmap(src_w, src_h,
+                   background_color, grid_color,
+                   src_grid_pitch, src_grid_width,
+                   &src);
+
+  SkBitmap dest = skia::ImageOperations::Resize(
+      src,
+      skia::ImageOperations::RESIZE_SUBPIXEL,
+      dest_w, dest_h);
+  ASSERT_EQ(dest_w, dest.width());
+  ASSERT_EQ(dest_h, dest.height());
+
+  SkBitmap dest_fast = skia::ImageOperations::Resize(
+      src,
+      skia::ImageOperations::RESIZE_SUBPIXEL_FAST,
+      dest_w, dest_h);
+  ASSERT_EQ(dest_w, dest_fast.width());
+  ASSERT_EQ(dest_h, dest_fast.height());
+
+  float max_observed_distance = 0.0f;
+  float total_distance = 0.0f;
+
+  SkAutoLockPixels dest_lock(dest);
+  SkAutoLockPixels dest_fast_lock(dest_fast);
+  for (int y = 0; y < dest_h; ++y) {
+    for (int x = 0; x < dest_w; ++x) {
+      const SkColor color = *dest.getAddr32(x, y);
+      const SkColor color_fast = *dest_fast.getAddr32(x, y);
+
+      float distance = ColorsEuclidianDistance(color, color_fast);
+      EXPECT_LE(distance, max_color_distance)
+          << "pixel tested: (" << x << ", " << y
+          << std::hex << std::showbase
+          << "), subpixel hex: " << color
+          << ", subpixel fast hex: " << color_fast
+          << std::setprecision(2)
+          << ", distance: " << distance;
+
+      max_observed_distance = std::max(max_observed_distance, distance);
+      total_distance += distance;
+    }
+  }
+
+  float average_distance = total_distance / (dest_w * dest_h);
+  EXPECT_LE(average_distance, max_average_color_distance);
+  LOG(INFO) << "RESIZE_SUBPIXEL_FAST color distance to RESIZE_SUBPIXEL: "
+            << "max " << max_observed_distance
+            << ", average " << average_distance;
+
+#if DEBUG_BITMAP_GENERATION
+  SaveBitmapToPNG(dest, "/tmp/CompareSubpixelMethods_subpixel.png");
+  SaveBitmapToPNG(dest_fast, "/tmp/CompareSubpixelMethods_subpixel_fast.png");
+#endif  // #if DEBUG_BITMAP_GENERATION
+}
+#endif
@@ -5,8 +5,14 @@
 #include "skia/ext/platform_canvas.h"
 
 #include "skia/ext/bitmap_platform_device.h"
+#include "skia/ext/convolver.h"
+#include "third_party/skia/include/core/SkColorPriv.h"
 #include "third_party/skia/include/core/SkTypes.h"
 
+#if defined(SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+
 namespace skia {
 
 PlatformCanvas::PlatformCanvas() {}
@@ -80,6 +86,65 @@ static SkPMColor MakeOpaqueXfermodeProc(SkPMColor src, SkPMColor dst) {
     return dst | (0xFF << SK_A32_SHIFT);
 }
 
+// Sets the alpha of the |width| pixels of |row| to opaque.
+static void MakeRowOpaque(uint32_t* row, int width, bool use_sse2) {
+  const uint32_t opaque = 0xFFu << SK_A32_SHIFT;
+  int x = 0;
+#if defined(SIMD_SSE2)
+  if (use_sse2) {
+    const __m128i alpha = _mm_set1_epi32(opaque);
+    for (; x + 4 <= width; x += 4) {
+      __m128i* pixels = reinterpret_cast<__m128i*>(row + x);
+      _mm_storeu_si128(pixels, _mm_or_si128(_mm_loadu_si128(pixels), alpha));
+    }
+  }
+#endif
+  for (; x < width; ++x)
+    row[x] |= opaque;
+}
+
+// Sets the pixels of |rect| opaque directly in the pixels of the top device of
+// |canvas|, within its clip. Returns false if the device has no pixels or is
+// a layer, or if the canvas has a matrix that doesn't just translate; the
+// drawing must then handle it.
+static bool MakeOpaqueInPixels(SkCanvas* canvas, const SkRect& rect) {
+  const SkMatrix& matrix = canvas->getTotalMatrix();
+  if (matrix.getType() & ~SkMatrix::kTranslate_Mask)
+    return false;
+  // The layers have their own origins, which only SkCanvas knows.
+  SkDevice* device = canvas->getTopDevice();
+  if (device != canvas->getDevice() ||
+      (device->getDeviceCapabilities() & SkDevice::kVector_Capability))
+    return false;
+
+  // Flushes GDI, which drew the pixels that are to be made opaque.
+  const SkBitmap& bitmap = device->accessBitmap(true);
+  if (bitmap.config() != SkBitmap::kARGB_8888_Config)
+    return false;
+  SkAutoLockPixels lock(bitmap);
+  if (!bitmap.getPixels())
+    return false;
+
+  SkRect device_rect;
+  matrix.mapRect(&device_rect, rect);
+  SkIRect bounds;
+  device_rect.round(&bounds);
+  bool use_sse2 = false;
+#if defined(SIMD_SSE2)
+  ConvolutionSIMD simd = BestConvolutionSIMD();
+  use_sse2 = simd == CONVOLUTION_SIMD_SSE2 || simd == CONVOLUTION_SIMD_AVX2;
+#endif
+  for (SkRegion::Cliperator i(canvas->getTotalClip(), bounds); !i.done();
+       i.next()) {
+    SkIRect r = i.rect();
+    if (!r.intersect(0, 0, bitmap.width(), bitmap.height()))
+      continue;
+    for (int y = r.fTop; y < r.fBottom; ++y)
+      MakeRowOpaque(bitmap.getAddr32(r.fLeft, y), r.width(), use_sse2);
+  }
+  return true;
+}
+
 void MakeOpaque(SkCanvas* canvas, int x, int y, int width, int height) {
   if (width <= 0 || height <= 0)
     return;
@@ -87,6 +152,9 @@ void MakeOpaque(SkCanvas* canvas, int x, int y, int width, int height) {
   SkRect rect;
   rect.setXYWH(SkIntToScalar(x), SkIntToScalar(y),
                SkIntToScalar(width), SkIntToScalar(height));
+  if (MakeOpaqueInPixels(canvas, rect))
+    return;
+
   SkPaint paint;
   // so we don't draw anything on a device that ignores xfermodes
   paint.setColor(0);
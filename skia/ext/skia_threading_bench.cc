@@ -0,0 +1,231 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This small program measures the threading primitives that SkThread_chrome
+// gives Skia, and the painting that leans on them: every SkBitmap copy refs
+// its SkPixelRef, every SkPaint copy its SkTypeface and shader, and every
+// text draw takes the glyph cache's SkMutex.
+//
+// Each benchmark runs on -threads threads at once, which share the counter,
+// the lock or the bitmap that is drawn, and prints the time per operation on
+// each thread. The full barrier increment and base::Lock are the primitives
+// that sk_atomic_inc() and SkMutex used before; they are measured next to
+// what they use now to show the difference. The painting numbers compare
+// between builds.
+
+#include <stdio.h>
+
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/command_line.h"
+#include "base/string_number_conversions.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
+#include "base/time.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkCanvas.h"
+#include "third_party/skia/include/core/SkPaint.h"
+#include "third_party/skia/include/core/SkShader.h"
+#include "third_party/skia/include/core/SkThread.h"
+
+namespace {
+
+const int kDefaultIterations = 1000000;
+const int kDefaultThreads = 1;
+
+// The size of the canvas each thread paints into, and of the bitmap drawn.
+const int kCanvasSize = 256;
+const int kBitmapSize = 16;
+
+const char kText[] = "Skia";
+
+// What the threads of a benchmark share.
+struct Shared {
+  Shared() : count(0) {
+    bitmap.setConfig(SkBitmap::kARGB_8888_Config, kBitmapSize, kBitmapSize);
+    bitmap.allocPixels();
+    bitmap.eraseARGB(255, 0, 128, 255);
+    shader = SkShader::CreateBitmapShader(bitmap, SkShader::kRepeat_TileMode,
+                                          SkShader::kRepeat_TileMode);
+  }
+  ~Shared() {
+    shader->unref();
+  }
+
+  int32_t count;
+  base::Lock lock;
+  SkMutex mutex;
+  SkBitmap bitmap;
+  SkShader* shader;
+};
+
+// One operation of a benchmark, the |i|th on a thread.
+typedef void (*Operation)(Shared* shared, SkCanvas* canvas, int i);
+
+void FullBarrierRefUnref(Shared* shared, SkCanvas* canvas, int i) {
+  base::subtle::Barrier_AtomicIncrement(&shared->count, 1);
+  base::subtle::Barrier_AtomicIncrement(&shared->count, -1);
+}
+
+void SkAtomicRefUnref(Shared* shared, SkCanvas* canvas, int i) {
+  sk_atomic_inc(&shared->count);
+  sk_atomic_dec(&shared->count);
+}
+
+void BaseLockAcquireRelease(Shared* shared, SkCanvas* canvas, int i) {
+  shared->lock.Acquire();
+  shared->lock.Release();
+}
+
+void SkMutexAcquireRelease(Shared* shared, SkCanvas* canvas, int i) {
+  shared->mutex.acquire();
+  shared->mutex.release();
+}
+
+void CopyPaint(Shared* shared, SkCanvas* canvas, int i) {
+  SkPaint paint;
+  paint.setShader(shared->shader);
+  SkPaint copy(paint);
+}
+
+void DrawBitmap(Shared* shared, SkCanvas* canvas, int i) {
+  SkScalar position =
+      SkIntToScalar((i * kBitmapSize) % (kCanvasSize - kBitmapSize));
+  canvas->drawBitmap(shared->bitmap, position, position);
+}
+
+void DrawText(Shared* shared, SkCanvas* canvas, int i) {
+  SkPaint paint;
+  paint.setAntiAlias(true);
+  paint.setTextSize(SkIntToScalar(12));
+  canvas->drawText(kText, arraysize(kText) - 1, SkIntToScalar(i % 200),
+                   SkIntToScalar(100), paint);
+}
+
+struct Benchmark {
+  const char* name;
+  Operation operation;
+};
+
+const Benchmark kBenchmarks[] = {
+  { "full barrier ref/unref", &FullBarrierRefUnref },
+  { "sk_atomic ref/unref", &SkAtomicRefUnref },
+  { "base::Lock", &BaseLockAcquireRelease },
+  { "SkMutex", &SkMutexAcquireRelease },
+  { "SkPaint copy", &CopyPaint },
+  { "drawBitmap", &DrawBitmap },
+  { "drawText", &DrawText },
+};
+
+// Runs the iterations of an operation, into a canvas of its own.
+class OperationThread : public base::PlatformThread::Delegate {
+ public:
+  OperationThread(Operation operation, Shared* shared, int iterations)
+      : operation_(operation),
+        shared_(shared),
+        iterations_(iterations),
+        handle_(base::kNullThreadHandle) {
+  }
+  virtual ~OperationThread() {}
+
+  bool Start() {
+    return base::PlatformThread::Create(0, this, &handle_);
+  }
+
+  void Join() {
+    base::PlatformThread::Join(handle_);
+  }
+
+  virtual void ThreadMain() {
+    SkBitmap target;
+    target.setConfig(SkBitmap::kARGB_8888_Config, kCanvasSize, kCanvasSize);
+    target.allocPixels();
+    SkCanvas canvas(target);
+    for (int i = 0; i < iterations_; ++i)
+      operation_(shared_, &canvas, i);
+  }
+
+ private:
+  Operation operation_;
+  Shared* shared_;
+  int iterations_;
+  base::PlatformThreadHandle handle_;
+
+  DISALLOW_COPY_AND_ASSIGN(OperationThread);
+};
+
+// Returns the nanoseconds that each of |num_threads| took per operation of
+// |benchmark|, or a negative number if a thread couldn't be started.
+double RunBenchmark(const Benchmark& benchmark, int num_threads,
+                    int iterations) {
+  Shared shared;
+  std::vector<OperationThread*> threads;
+  for (int i = 0; i < num_threads; ++i)
+    threads.push_back(new OperationThread(benchmark.operation, &shared,
+                                          iterations));
+
+  const base::TimeTicks start = base::TimeTicks::Now();
+  size_t started = 0;
+  while (started < threads.size() && threads[started]->Start())
+    ++started;
+  for (size_t i = 0; i < started; ++i)
+    threads[i]->Join();
+  const base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+
+  for (size_t i = 0; i < threads.size(); ++i)
+    delete threads[i];
+  if (started < threads.size())
+    return -1;
+  return elapsed.InMillisecondsF() * 1000000.0 / iterations;
+}
+
+void Usage() {
+  printf("skia_threading_bench [-iterations i] [-threads t] [-help]\n"
+         "  -iterations i: perform i operations on each thread (default:%d)\n"
+         "  -threads t: run each benchmark on t threads at once (default:%d)\n"
+         "  -help: prints this help and exits\n",
+         kDefaultIterations, kDefaultThreads);
+}
+
+// Reads the positive int switch |name| into |value|, if it is there.
+bool ReadIntSwitch(const CommandLine* command_line, const char* name,
+                   int* value) {
+  if (!command_line->HasSwitch(name))
+    return true;
+  std::string string_value = command_line->GetSwitchValueASCII(name);
+  return base::StringToInt(string_value, value) && *value > 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  CommandLine::Init(argc, argv);
+  const CommandLine* command_line = CommandLine::ForCurrentProcess();
+  int iterations = kDefaultIterations;
+  int num_threads = kDefaultThreads;
+  if (command_line->HasSwitch("help") ||
+      !ReadIntSwitch(command_line, "iterations", &iterations) ||
+      !ReadIntSwitch(command_line, "threads", &num_threads)) {
+    Usage();
+    CommandLine::Reset();
+    return 1;
+  }
+
+  printf("%d operations on each of %d threads\n", iterations, num_threads);
+  int result = 0;
+  for (size_t i = 0; i < arraysize(kBenchmarks); ++i) {
+    double ns = RunBenchmark(kBenchmarks[i], num_threads, iterations);
+    if (ns < 0) {
+      printf("%-24s failed to start the threads\n", kBenchmarks[i].name);
+      result = 1;
+      continue;
+    }
+    printf("%-24s %10.1f ns/op\n", kBenchmarks[i].name, ns);
+  }
+
+  CommandLine::Reset();
+  return result;
+}
@@ -15,6 +15,7 @@
 #include "base/stringprintf.h"
 #include "base/utf_string_conversions.h"
 #include "skia/ext/vector_canvas.h"
+#include "skia/ext/vector_page_recorder_win.h"
 #include "skia/ext/vector_platform_device_emf_win.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "third_party/skia/include/effects/SkDashPathEffect.h"
@@ -931,6 +932,31 @@ TEST_F(VectorCanvasTest, ClippingClean) {
   }
 }
 
+TEST_F(VectorCanvasTest, RecordedPage) {
+  SkBitmap opaque;
+  LoadPngFileToSkBitmap(test_file(L"..\\bitmaps\\bitmap_opaque.png"),
+                        &opaque, true);
+  SkBitmap alpha;
+  LoadPngFileToSkBitmap(test_file(L"..\\bitmaps\\bitmap_alpha.png"), &alpha,
+                        false);
+
+  // The bitmaps are drawn twice, to go through the EMF device's cache.
+  VectorPageRecorder recorder(size_, size_);
+  recorder.canvas()->drawARGB(255, 255, 255, 255, SkXfermode::kSrc_Mode);
+  recorder.canvas()->drawBitmap(opaque, 13, 3, NULL);
+  recorder.canvas()->drawBitmap(alpha, 5, 15, NULL);
+  recorder.canvas()->drawBitmap(opaque, 40, 50, NULL);
+  recorder.canvas()->drawBitmap(alpha, 50, 5, NULL);
+  recorder.FinishRecording();
+  EXPECT_TRUE(recorder.EmitToDC(context_->context()));
+
+  pcanvas_->drawBitmap(opaque, 13, 3, NULL);
+  pcanvas_->drawBitmap(alpha, 5, 15, NULL);
+  pcanvas_->drawBitmap(opaque, 40, 50, NULL);
+  pcanvas_->drawBitmap(alpha, 50, 5, NULL);
+  EXPECT_EQ(0., Image(*vcanvas_).PercentageDifferent(Image(*pcanvas_)));
+}
+
 // See http://crbug.com/26938
 TEST_F(VectorCanvasTest, DISABLED_Matrix) {
   SkBitmap bitmap;
@@ -0,0 +1,36 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "skia/ext/vector_page_recorder_win.h"
+
+#include "skia/ext/vector_canvas.h"
+#include "skia/ext/vector_platform_device_emf_win.h"
+
+namespace skia {
+
+VectorPageRecorder::VectorPageRecorder(int width, int height)
+    : canvas_(picture_.beginRecording(width, height)) {
+}
+
+VectorPageRecorder::~VectorPageRecorder() {
+}
+
+void VectorPageRecorder::FinishRecording() {
+  SkASSERT(canvas_);
+  picture_.endRecording();
+  canvas_ = NULL;
+}
+
+bool VectorPageRecorder::EmitToDC(HDC dc) {
+  SkASSERT(!canvas_);
+  SkDevice* device = VectorPlatformDeviceEmf::CreateDevice(
+      picture_.width(), picture_.height(), true, dc);
+  if (!device)
+    return false;
+  VectorCanvas canvas(device);
+  picture_.draw(&canvas);
+  return true;
+}
+
+}  // namespace skia
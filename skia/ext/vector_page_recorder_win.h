@@ -0,0 +1,57 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SKIA_EXT_VECTOR_PAGE_RECORDER_WIN_H_
+#define SKIA_EXT_VECTOR_PAGE_RECORDER_WIN_H_
+#pragma once
+
+#include <windows.h>
+
+#include "base/basictypes.h"
+#include "third_party/skia/include/core/SkPicture.h"
+
+class SkCanvas;
+
+namespace skia {
+
+// Records the drawing of a page into an SkPicture, then emits it into an EMF
+// in one go, rather than having a VectorCanvas turn every call into EMF
+// records as the page is drawn. The recording keeps a single copy of the
+// bitmaps drawn several times, which VectorPlatformDeviceEmf then scans and
+// converts once, and the emission can run on another thread than the one
+// drawing the next page.
+//
+// The recording canvas has no HDC, so the pages drawn with platform calls
+// must still be drawn into a VectorCanvas directly.
+class SK_API VectorPageRecorder {
+ public:
+  // Starts recording a page of |width| by |height|.
+  VectorPageRecorder(int width, int height);
+  ~VectorPageRecorder();
+
+  // The canvas the page is drawn into, until FinishRecording().
+  SkCanvas* canvas() const { return canvas_; }
+
+  // Ends the recording. Nothing must be drawn into canvas() after this.
+  void FinishRecording();
+
+  // Plays the page back into |dc|, an EMF DC, through a VectorCanvas.
+  // FinishRecording() must have been called. The recording is then only read,
+  // so this can be called on any thread, but not on two at once. Returns
+  // false if the device can't be created.
+  bool EmitToDC(HDC dc);
+
+ private:
+  SkPicture picture_;
+
+  // The recording canvas, owned by |picture_|. NULL once the recording is
+  // finished.
+  SkCanvas* canvas_;
+
+  DISALLOW_COPY_AND_ASSIGN(VectorPageRecorder);
+};
+
+}  // namespace skia
+
+#endif  // SKIA_EXT_VECTOR_PAGE_RECORDER_WIN_H_
@@ -44,6 +44,20 @@ SkDevice* VectorPlatformDeviceEmf::CreateDevice(
   return device;
 }
 
+// Returns true if any pixel of |bitmap|, whose pixels must be locked, isn't
+// opaque. There is no quick way to tell.
+static bool BitmapHasAlpha(const SkBitmap& bitmap) {
+  const uint32_t* pixels = static_cast<const uint32_t*>(bitmap.getPixels());
+  int row_length = bitmap.rowBytesAsPixels();
+  for (int y = 0; y < bitmap.height(); ++y) {
+    for (int x = 0; x < bitmap.width(); ++x) {
+      if (SkColorGetA(pixels[(y * row_length) + x]) != 255)
+        return true;
+    }
+  }
+  return false;
+}
+
 static void FillBitmapInfoHeader(int width, int height, BITMAPINFOHEADER* hdr) {
   hdr->biSize = sizeof(BITMAPINFOHEADER);
   hdr->biWidth = width;
@@ -105,6 +119,11 @@ VectorPlatformDeviceEmf::VectorPlatformDeviceEmf(HDC dc, const SkBitmap& bitmap)
 VectorPlatformDeviceEmf::~VectorPlatformDeviceEmf() {
   SkASSERT(previous_brush_ == NULL);
   SkASSERT(previous_pen_ == NULL);
+  for (std::map<BitmapKey, CachedBitmap>::iterator i = bitmap_cache_.begin();
+       i != bitmap_cache_.end(); ++i) {
+    if (i->second.dib)
+      DeleteObject(i->second.dib);
+  }
 }
 
 HDC VectorPlatformDeviceEmf::BeginPlatformPaint() {
@@ -779,46 +798,26 @@ void VectorPlatformDeviceEmf::InternalDrawBitmap(const SkBitmap& bitmap,
     return;
   }
 
-  if (!is_translucent) {
-    int row_length = bitmap.rowBytesAsPixels();
-    // There is no quick way to determine if an image is opaque.
-    for (int y2 = 0; y2 < src_size_y; ++y2) {
-      for (int x2 = 0; x2 < src_size_x; ++x2) {
-        if (SkColorGetA(pixels[(y2 * row_length) + x2]) != 255) {
-          is_translucent = true;
-          y2 = src_size_y;
-          break;
-        }
-      }
-    }
+  CachedBitmap uncached;
+  CachedBitmap* cached = GetCachedBitmap(bitmap);
+  if (!cached) {
+    uncached.has_alpha = BitmapHasAlpha(bitmap);
+    uncached.dib = NULL;
+    cached = &uncached;
   }
+  is_translucent = is_translucent || cached->has_alpha;
 
   HDC dc = BeginPlatformPaint();
   BITMAPINFOHEADER hdr;
   FillBitmapInfoHeader(src_size_x, src_size_y, &hdr);
   if (is_translucent) {
-    // The image must be loaded as a bitmap inside a device context.
+    // The image must be loaded as a bitmap inside a device context. Its DIB
+    // section is kept for the next time the bitmap is drawn in the page.
+    if (!cached->dib)
+      cached->dib = CreateDIBFromBitmap(bitmap);
+    SkASSERT(cached->dib);
     HDC bitmap_dc = ::CreateCompatibleDC(dc);
-    void* bits = NULL;
-    HBITMAP hbitmap = ::CreateDIBSection(
-        bitmap_dc, reinterpret_cast<const BITMAPINFO*>(&hdr),
-        DIB_RGB_COLORS, &bits, NULL, 0);
-
-    // static cast to a char so we can do byte ptr arithmatic to
-    // get the offset.
-    unsigned char* dest_buffer = static_cast<unsigned char *>(bits);
-
-    // We will copy row by row to avoid having to worry about
-    // the row strides being different.
-    const int dest_row_size = hdr.biBitCount / 8 * hdr.biWidth;
-    for (int row = 0; row < bitmap.height(); ++row) {
-      int dest_offset = row * dest_row_size;
-      // pixels_offset in terms of pixel count.
-      int src_offset = row * bitmap.rowBytesAsPixels();
-      memcpy(dest_buffer + dest_offset, pixels + src_offset, dest_row_size);
-    }
-    SkASSERT(hbitmap);
-    HGDIOBJ old_bitmap = ::SelectObject(bitmap_dc, hbitmap);
+    HGDIOBJ old_bitmap = ::SelectObject(bitmap_dc, cached->dib);
 
     // After some analysis of IE7's behavior, this is the thing to do. I was
     // sure IE7 was doing so kind of bitmasking due to the way translucent image
@@ -845,8 +844,9 @@ void VectorPlatformDeviceEmf::InternalDrawBitmap(const SkBitmap& bitmap,
     alpha_blend_used_ = true;
 
     ::SelectObject(bitmap_dc, static_cast<HBITMAP>(old_bitmap));
-    DeleteObject(hbitmap);
     DeleteDC(bitmap_dc);
+    if (cached == &uncached)
+      DeleteObject(uncached.dib);
   } else {
     int nCopied = StretchDIBits(dc,
                                 x, y,  // Destination origin.
@@ -862,4 +862,62 @@ void VectorPlatformDeviceEmf::InternalDrawBitmap(const SkBitmap& bitmap,
   Cleanup();
 }
 
+bool VectorPlatformDeviceEmf::BitmapKey::operator<(
+    const BitmapKey& other) const {
+  if (generation_id != other.generation_id)
+    return generation_id < other.generation_id;
+  if (pixels != other.pixels)
+    return pixels < other.pixels;
+  if (width != other.width)
+    return width < other.width;
+  return height < other.height;
+}
+
+VectorPlatformDeviceEmf::CachedBitmap*
+VectorPlatformDeviceEmf::GetCachedBitmap(const SkBitmap& bitmap) {
+  if (!bitmap.pixelRef())
+    return NULL;
+
+  BitmapKey key;
+  key.generation_id = bitmap.getGenerationID();
+  key.pixels = bitmap.getPixels();
+  key.width = bitmap.width();
+  key.height = bitmap.height();
+  std::map<BitmapKey, CachedBitmap>::iterator i = bitmap_cache_.find(key);
+  if (i != bitmap_cache_.end())
+    return &i->second;
+
+  CachedBitmap& cached = bitmap_cache_[key];
+  cached.has_alpha = BitmapHasAlpha(bitmap);
+  cached.dib = NULL;
+  return &cached;
+}
+
+HBITMAP VectorPlatformDeviceEmf::CreateDIBFromBitmap(const SkBitmap& bitmap) {
+  BITMAPINFOHEADER hdr;
+  FillBitmapInfoHeader(bitmap.width(), bitmap.height(), &hdr);
+  void* bits = NULL;
+  HBITMAP hbitmap = ::CreateDIBSection(
+      NULL, reinterpret_cast<const BITMAPINFO*>(&hdr), DIB_RGB_COLORS, &bits,
+      NULL, 0);
+  if (!hbitmap)
+    return NULL;
+
+  // static cast to a char so we can do byte ptr arithmatic to
+  // get the offset.
+  unsigned char* dest_buffer = static_cast<unsigned char *>(bits);
+  const uint32_t* pixels = static_cast<const uint32_t*>(bitmap.getPixels());
+
+  // We will copy row by row to avoid having to worry about
+  // the row strides being different.
+  const int dest_row_size = hdr.biBitCount / 8 * hdr.biWidth;
+  for (int row = 0; row < bitmap.height(); ++row) {
+    int dest_offset = row * dest_row_size;
+    // pixels_offset in terms of pixel count.
+    int src_offset = row * bitmap.rowBytesAsPixels();
+    memcpy(dest_buffer + dest_offset, pixels + src_offset, dest_row_size);
+  }
+  return hbitmap;
+}
+
 }  // namespace skia
@@ -6,6 +6,8 @@
 #define SKIA_EXT_VECTOR_PLATFORM_DEVICE_EMF_WIN_H_
 #pragma once
 
+#include <map>
+
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
 #include "skia/ext/platform_device.h"
@@ -106,10 +108,39 @@ class VectorPlatformDeviceEmf : public PlatformDevice, public SkDevice {
   bool CreatePen(bool use_pen, COLORREF color, int stroke_width,
                  float stroke_miter, DWORD pen_style);
 
+  // Identifies the pixels of an SkBitmap that has a pixel ref, which the
+  // generation ID of changes with them.
+  struct BitmapKey {
+    bool operator<(const BitmapKey& other) const;
+
+    uint32_t generation_id;
+    const void* pixels;
+    int width;
+    int height;
+  };
+
+  // What is known of bitmaps drawn before in the page.
+  struct CachedBitmap {
+    // Whether any of the pixels isn't opaque.
+    bool has_alpha;
+
+    // The DIB section of the pixels, made when the bitmap was first drawn
+    // translucent. NULL until then.
+    HBITMAP dib;
+  };
+
   // Draws a bitmap in the the device, using the currently loaded matrix.
   void InternalDrawBitmap(const SkBitmap& bitmap, int x, int y,
                           const SkPaint& paint);
 
+  // Returns the cache entry of |bitmap|, whose pixels must be locked, adding
+  // it the first time. Returns NULL for the bitmaps without a pixel ref,
+  // whose pixels can change without the generation ID.
+  CachedBitmap* GetCachedBitmap(const SkBitmap& bitmap);
+
+  // Creates a DIB section holding the pixels of |bitmap|.
+  HBITMAP CreateDIBFromBitmap(const SkBitmap& bitmap);
+
   // The Windows Device Context handle. It is the backend used with GDI drawing.
   // This backend is write-only and vectorial.
   HDC hdc_;
@@ -130,6 +161,11 @@ class VectorPlatformDeviceEmf : public PlatformDevice, public SkDevice {
   // True if AlphaBlend() was called during this print.
   bool alpha_blend_used_;
 
+  // The bitmaps drawn in the page, so that those drawn several times, which
+  // SkPicture playback gives as the same SkBitmap, are scanned and copied
+  // once. The DIB sections are deleted with the device.
+  std::map<BitmapKey, CachedBitmap> bitmap_cache_;
+
   DISALLOW_COPY_AND_ASSIGN(VectorPlatformDeviceEmf);
 };
 
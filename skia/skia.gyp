@@ -676,6 +676,11 @@
         'ext/bitmap_platform_device_win.h',
         'ext/convolver.cc',
         'ext/convolver.h',
+        'ext/convolver_simd.h',
+        'ext/dib_section_pool_win.cc',
+        'ext/dib_section_pool_win.h',
+        'ext/font_cache.cc',
+        'ext/font_cache.h',
         'ext/google_logging.cc',
         'ext/image_operations.cc',
         'ext/image_operations.h',
@@ -697,6 +702,8 @@
         'ext/skia_utils_win.h',
         'ext/vector_canvas.cc',
         'ext/vector_canvas.h',
+        'ext/vector_page_recorder_win.cc',
+        'ext/vector_page_recorder_win.h',
         'ext/vector_platform_device_emf_win.cc',
         'ext/vector_platform_device_emf_win.h',
         'ext/vector_platform_device_skia.cc',
@@ -833,8 +840,8 @@
         [ 'OS == "win"', {
           'sources!': [
             '../third_party/skia/src/core/SkMMapStream.cpp',
+            '../third_party/skia/src/ports/SkThread_win.cpp',
             '../third_party/skia/src/ports/SkTime_Unix.cpp',
-            'ext/SkThread_chrome.cc',
           ],
           'include_dirs': [
             'config/win',
@@ -865,6 +872,7 @@
       ],
       'dependencies': [
         'skia_opts',
+        'skia_opts_avx2',
         'skia_libtess',
         '../base/third_party/dynamic_annotations/dynamic_annotations.gyp:dynamic_annotations',
        #'../third_party/sfntly/sfntly.gyp:sfntly',
@@ -969,6 +977,50 @@
           ],
         }],
       ],
+      'sources': [
+        # Only has the kernels when NEON is enabled (see above).
+        'ext/convolver_neon.cc',
+      ],
+    },
+    # The AVX2 convolver kernels need -mavx2 for the same reason, and must not
+    # share a target with the SSE2 files, which have to run on processors
+    # without AVX2. They are only used if base::CPU reports AVX2 support; with
+    # compilers that do not support AVX2, the file is empty.
+    {
+      'target_name': 'skia_opts_avx2',
+      'type': 'static_library',
+      'include_dirs': [
+        '..',
+        'config',
+        '../third_party/skia/include/config',
+        '../third_party/skia/include/core',
+      ],
+      'conditions': [
+        [ 'os_posix == 1 and OS != "mac" and target_arch != "arm"', {
+          'cflags': [
+            '-mavx2',
+          ],
+        }],
+        [ 'OS == "mac"', {
+          'xcode_settings': {
+            'OTHER_CFLAGS': [
+              '-mavx2',
+            ],
+          },
+        }],
+        [ 'OS == "win"', {
+          'msvs_settings': {
+            'VCCLCompilerTool': {
+              'AdditionalOptions': [
+                '/arch:AVX2',
+              ],
+            },
+          },
+        }],
+      ],
+      'sources': [
+        'ext/convolver_avx2.cc',
+      ],
     },
     {
       'target_name': 'skia_libtess',
@@ -1023,5 +1075,19 @@
         'ext/image_operations_bench.cc',
       ],
     },
+    {
+      'target_name': 'skia_threading_bench',
+      'type': 'executable',
+      'dependencies': [
+        '../base/base.gyp:base',
+        'skia',
+      ],
+      'include_dirs': [
+        '..',
+      ],
+      'sources': [
+        'ext/skia_threading_bench.cc',
+      ],
+    },
   ],
 }
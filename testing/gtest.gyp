@@ -39,6 +39,8 @@
         'gtest/src/gtest.cc',
         'multiprocess_func_list.cc',
         'multiprocess_func_list.h',
+        'perf_test.cc',
+        'perf_test.h',
         'platform_test.h',
       ],
       'sources!': [
@@ -0,0 +1,253 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "perf_test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if GTEST_OS_WINDOWS
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif
+
+namespace testing {
+
+namespace {
+
+// The batches until the iterations to time are found take at least
+// kMinBatchUs, and at most kMaxIterations.
+const double kMinBatchUs = 20000;
+const int kMaxIterations = 1 << 20;
+
+const int kDefaultRepetitions = 5;
+const double kDefaultTolerance = 0.25;
+
+int g_repetitions = kDefaultRepetitions;
+double g_tolerance = kDefaultTolerance;
+AllocationCounter g_allocation_counter = NULL;
+
+// The baseline wall time per iteration of each test, in microseconds, by
+// "<test case>.<test>".
+typedef std::map<std::string, double> BaselineMap;
+BaselineMap* g_baselines = NULL;
+
+#if GTEST_OS_WINDOWS
+double NowWallUs() {
+  static LARGE_INTEGER frequency = { 0 };
+  if (!frequency.QuadPart)
+    QueryPerformanceFrequency(&frequency);
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  return static_cast<double>(now.QuadPart) * 1000000.0 / frequency.QuadPart;
+}
+
+double FileTimeToUs(const FILETIME& time) {
+  ULARGE_INTEGER value;
+  value.LowPart = time.dwLowDateTime;
+  value.HighPart = time.dwHighDateTime;
+  // FILETIMEs count 100ns.
+  return static_cast<double>(value.QuadPart) / 10;
+}
+
+double NowCpuUs() {
+  FILETIME creation, exit, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+    return 0;
+  return FileTimeToUs(kernel) + FileTimeToUs(user);
+}
+#else
+double NowWallUs() {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec * 1000000.0 + now.tv_usec;
+}
+
+double NowCpuUs() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage))
+    return 0;
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000.0 +
+      usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+#endif
+
+double Median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  size_t count = values.size();
+  if (!count)
+    return 0;
+  return count % 2 ? values[count / 2] :
+      (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+// Returns |value| with |precision| decimals, as recorded in the XML report.
+std::string FormatDouble(double value, int precision) {
+  std::ostringstream stream;
+  stream << std::fixed << std::setprecision(precision) << value;
+  return stream.str();
+}
+
+// Reads the baselines in |path|. If it can't be read, no test has a
+// baseline.
+void ReadBaselines(const char* path) {
+  g_baselines = new BaselineMap;
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "Can't read the perf baselines in %s\n", path);
+    return;
+  }
+  char line[1024];
+  while (fgets(line, sizeof(line), file)) {
+    char* comment = strchr(line, '#');
+    if (comment)
+      *comment = '\0';
+    char name[1024];
+    double wall_us;
+    if (sscanf(line, "%1023s %lf", name, &wall_us) == 2)
+      (*g_baselines)[name] = wall_us;
+  }
+  fclose(file);
+}
+
+// Returns the value of |flag| if |arg| is "--<flag>=<value>", or NULL.
+const char* ParseFlag(const char* arg, const char* flag) {
+  if (strncmp(arg, "--", 2) != 0)
+    return NULL;
+  size_t length = strlen(flag);
+  if (strncmp(arg + 2, flag, length) != 0 || arg[2 + length] != '=')
+    return NULL;
+  return arg + 3 + length;
+}
+
+}  // namespace
+
+void InitPerfTest(int* argc, char** argv) {
+  int kept = 1;
+  for (int i = 1; i < *argc; ++i) {
+    const char* value;
+    if ((value = ParseFlag(argv[i], "perf_baselines")) != NULL) {
+      ReadBaselines(value);
+    } else if ((value = ParseFlag(argv[i], "perf_tolerance")) != NULL) {
+      g_tolerance = atof(value);
+    } else if ((value = ParseFlag(argv[i], "perf_repetitions")) != NULL) {
+      g_repetitions = std::max(atoi(value), 1);
+    } else {
+      argv[kept++] = argv[i];
+    }
+  }
+  *argc = kept;
+  argv[kept] = NULL;
+}
+
+void SetAllocationCounter(AllocationCounter counter) {
+  g_allocation_counter = counter;
+}
+
+PerfResult::PerfResult()
+    : iterations(0),
+      wall_us(0),
+      cpu_us(0),
+      allocations(-1) {
+}
+
+PerfTest::PerfTest() {
+}
+
+PerfTest::~PerfTest() {
+}
+
+void PerfTest::RunPerfBody() {
+  // Warm up, doubling the iterations until a batch takes long enough.
+  int iterations = 1;
+  for (;;) {
+    double wall_us, cpu_us;
+    size_t allocations;
+    if (!RunBatch(iterations, &wall_us, &cpu_us, &allocations))
+      return;
+    if (wall_us >= kMinBatchUs || iterations >= kMaxIterations)
+      break;
+    iterations *= 2;
+  }
+
+  std::vector<double> wall_samples;
+  std::vector<double> cpu_samples;
+  size_t total_allocations = 0;
+  for (int i = 0; i < g_repetitions; ++i) {
+    double wall_us, cpu_us;
+    size_t allocations;
+    if (!RunBatch(iterations, &wall_us, &cpu_us, &allocations))
+      return;
+    wall_samples.push_back(wall_us / iterations);
+    cpu_samples.push_back(cpu_us / iterations);
+    total_allocations += allocations;
+  }
+
+  perf_result_.iterations = iterations;
+  perf_result_.wall_us = Median(wall_samples);
+  perf_result_.cpu_us = Median(cpu_samples);
+  if (g_allocation_counter) {
+    perf_result_.allocations = static_cast<double>(total_allocations) /
+        (static_cast<double>(iterations) * g_repetitions);
+  }
+
+  const TestInfo* info = UnitTest::GetInstance()->current_test_info();
+  std::string name = std::string(info->test_case_name()) + "." + info->name();
+  std::string allocations = perf_result_.allocations >= 0 ?
+      FormatDouble(perf_result_.allocations, 1) : "?";
+  RecordProperty("perf_wall_us",
+                 FormatDouble(perf_result_.wall_us, 3).c_str());
+  RecordProperty("perf_cpu_us", FormatDouble(perf_result_.cpu_us, 3).c_str());
+  RecordProperty("perf_iterations", iterations);
+  if (perf_result_.allocations >= 0)
+    RecordProperty("perf_allocations", allocations.c_str());
+  // In the baselines file format, so that the lines can be pasted there.
+  printf("[   PERF   ] %s %.3f  # cpu %.3f us, %s allocations, %d x %d\n",
+         name.c_str(), perf_result_.wall_us, perf_result_.cpu_us,
+         allocations.c_str(), g_repetitions, iterations);
+
+  if (!g_baselines)
+    return;
+  BaselineMap::const_iterator baseline = g_baselines->find(name);
+  if (baseline == g_baselines->end())
+    return;
+  RecordProperty("perf_baseline_us",
+                 FormatDouble(baseline->second, 3).c_str());
+  EXPECT_LE(perf_result_.wall_us, baseline->second * (1 + g_tolerance))
+      << name << " takes " << perf_result_.wall_us << " us per iteration, "
+      << "more than its baseline of " << baseline->second << " us and "
+      << g_tolerance * 100 << "% tolerance.";
+}
+
+bool PerfTest::RunBatch(int iterations,
+                        double* wall_us,
+                        double* cpu_us,
+                        size_t* allocations) {
+  size_t allocations_start =
+      g_allocation_counter ? g_allocation_counter() : 0;
+  double cpu_start = NowCpuUs();
+  double wall_start = NowWallUs();
+  for (int i = 0; i < iterations; ++i) {
+    PerfBody();
+    if (HasFatalFailure())
+      return false;
+  }
+  *wall_us = NowWallUs() - wall_start;
+  *cpu_us = NowCpuUs() - cpu_start;
+  *allocations =
+      (g_allocation_counter ? g_allocation_counter() : 0) - allocations_start;
+  return true;
+}
+
+}  // namespace testing
@@ -0,0 +1,116 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TESTING_PERF_TEST_H_
+#define TESTING_PERF_TEST_H_
+
+#include <stddef.h>
+
+#include <gtest/gtest.h>
+
+// PERF_TEST() is a TEST() whose body is timed: it is run repeatedly, first
+// to warm up and to find how many iterations take long enough to be timed,
+// then in several batches of that many iterations. The wall clock time, CPU
+// time and, with an allocation counter, heap allocations per iteration are
+// recorded as properties of the test, so that they are in the XML report of
+// --gtest_output=xml along with its results, e.g.:
+//
+//   PERF_TEST(ImageOperations, ResizeLanczos3) {
+//     SkBitmap result = skia::ImageOperations::Resize(...);
+//     EXPECT_FALSE(result.isNull());
+//   }
+//
+// The body may use the EXPECT and ASSERT macros; the iterations stop at the
+// first fatal failure. PERF_TEST_F() is its TEST_F(), for a fixture that
+// derives from testing::PerfTest. SetUp() and TearDown() run once around all
+// the iterations.
+//
+// Given --perf_baselines=<file>, the median wall time per iteration of each
+// test listed in the file is compared to its baseline, and is a failure when
+// slower by more than --perf_tolerance, 0.25 by default. The file has one
+// "<test case>.<test> <microseconds>" line per test, as the tests print;
+// '#' starts a comment. --perf_repetitions sets the number of batches, 5 by
+// default. The test's main() must call testing::InitPerfTest() after
+// testing::InitGoogleTest() for those flags to be read.
+
+#define PERF_TEST_FIXTURE_NAME_(test_case_name, test_name) \
+    test_case_name##_##test_name##_PerfFixture
+
+#define PERF_TEST_(test_case_name, test_name, parent_class, parent_id) \
+  class PERF_TEST_FIXTURE_NAME_(test_case_name, test_name) \
+      : public parent_class { \
+   protected: \
+    virtual void PerfBody(); \
+  }; \
+  GTEST_TEST_(test_case_name, test_name, \
+              PERF_TEST_FIXTURE_NAME_(test_case_name, test_name), \
+              parent_id) { \
+    RunPerfBody(); \
+  } \
+  void PERF_TEST_FIXTURE_NAME_(test_case_name, test_name)::PerfBody()
+
+#define PERF_TEST(test_case_name, test_name) \
+  PERF_TEST_(test_case_name, test_name, ::testing::PerfTest, \
+             ::testing::internal::GetTypeId< ::testing::PerfTest>())
+
+#define PERF_TEST_F(test_fixture, test_name) \
+  PERF_TEST_(test_fixture, test_name, test_fixture, \
+             ::testing::internal::GetTypeId<test_fixture>())
+
+namespace testing {
+
+// Parses and removes the perf test flags from the command line.
+void InitPerfTest(int* argc, char** argv);
+
+// Returns the number of heap allocations made since the start of the
+// process. The count may wrap around.
+typedef size_t (*AllocationCounter)();
+
+// Sets the function PerfTest reads the allocation counts with, e.g. one
+// counting the calls of an executable's own operator new. Without one, the
+// allocations aren't recorded.
+void SetAllocationCounter(AllocationCounter counter);
+
+// The measurements of a PerfTest, per iteration.
+struct PerfResult {
+  PerfResult();
+
+  int iterations;
+  double wall_us;
+  double cpu_us;
+  double allocations;  // Negative without an allocation counter.
+};
+
+class PerfTest : public Test {
+ protected:
+  PerfTest();
+  virtual ~PerfTest();
+
+  // The code to time, which PERF_TEST() defines.
+  virtual void PerfBody() = 0;
+
+  // Times PerfBody(), records the results and checks them against the
+  // baseline.
+  void RunPerfBody();
+
+  // The results of RunPerfBody(), for tests that want to check more.
+  const PerfResult& perf_result() const { return perf_result_; }
+
+ private:
+  // Runs |iterations| of PerfBody(), and returns the wall and CPU time and
+  // allocations they took in the out params. Returns false on a fatal
+  // failure.
+  bool RunBatch(int iterations,
+                double* wall_us,
+                double* cpu_us,
+                size_t* allocations);
+
+  PerfResult perf_result_;
+
+  GTEST_DISALLOW_COPY_AND_ASSIGN_(PerfTest);
+};
+
+}  // namespace testing
+
+#endif  // TESTING_PERF_TEST_H_
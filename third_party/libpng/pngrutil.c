@@ -2930,12 +2930,171 @@ png_do_read_interlace(png_structp png_ptr)
 }
 #endif /* PNG_READ_INTERLACING_SUPPORTED */
 
+#ifdef PNG_CHROMIUM_SSE2_FILTERS
+/* Chromium: SSE2 versions of the filters below, for the images of 3 and 4
+ * bytes per pixel, RGB and RGBA with 8 bits per channel, and of the Up filter
+ * for all the images.  The Sub, Avg and Paeth filters depend on the previous
+ * pixel, so they go one pixel at a time, with its channels in parallel.
+ * They give exactly the rows of the C versions.
+ */
+#include <emmintrin.h>
+
+static __m128i
+png_load_pixel_sse2(png_bytep p, png_uint_32 bpp)
+{
+   png_uint_32 v = 0;
+   png_memcpy(&v, p, bpp);
+   return _mm_cvtsi32_si128((int)v);
+}
+
+static void
+png_store_pixel_sse2(png_bytep p, png_uint_32 bpp, __m128i pixel)
+{
+   png_uint_32 v = (png_uint_32)_mm_cvtsi128_si32(pixel);
+   png_memcpy(p, &v, bpp);
+}
+
+static void
+png_read_filter_row_up_sse2(png_uint_32 rowbytes, png_bytep row,
+   png_bytep prev_row)
+{
+   png_uint_32 i;
+
+   for (i = 0; i + 16 <= rowbytes; i += 16)
+   {
+      __m128i x = _mm_loadu_si128((__m128i *)(row + i));
+      __m128i b = _mm_loadu_si128((__m128i *)(prev_row + i));
+      _mm_storeu_si128((__m128i *)(row + i), _mm_add_epi8(x, b));
+   }
+   for (; i < rowbytes; i++)
+      row[i] = (png_byte)((row[i] + prev_row[i]) & 0xff);
+}
+
+static void
+png_read_filter_row_sub_sse2(png_uint_32 rowbytes, png_uint_32 bpp,
+   png_bytep row)
+{
+   __m128i a = _mm_setzero_si128();
+   png_uint_32 i;
+
+   for (i = 0; i + bpp <= rowbytes; i += bpp)
+   {
+      a = _mm_add_epi8(a, png_load_pixel_sse2(row + i, bpp));
+      png_store_pixel_sse2(row + i, bpp, a);
+   }
+}
+
+static void
+png_read_filter_row_avg_sse2(png_uint_32 rowbytes, png_uint_32 bpp,
+   png_bytep row, png_bytep prev_row)
+{
+   __m128i ones = _mm_set1_epi8(1);
+   __m128i a = _mm_setzero_si128();
+   png_uint_32 i;
+
+   for (i = 0; i + bpp <= rowbytes; i += bpp)
+   {
+      __m128i b = png_load_pixel_sse2(prev_row + i, bpp);
+      /* _mm_avg_epu8() rounds up, the filter rounds down. */
+      __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+         _mm_and_si128(_mm_xor_si128(a, b), ones));
+      a = _mm_add_epi8(png_load_pixel_sse2(row + i, bpp), avg);
+      png_store_pixel_sse2(row + i, bpp, a);
+   }
+}
+
+static __m128i
+png_abs_epi16_sse2(__m128i x)
+{
+   return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static __m128i
+png_if_then_else_sse2(__m128i mask, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static void
+png_read_filter_row_paeth_sse2(png_uint_32 rowbytes, png_uint_32 bpp,
+   png_bytep row, png_bytep prev_row)
+{
+   /* The channels are in 16 bits, where the differences fit. */
+   __m128i zero = _mm_setzero_si128();
+   __m128i low_bytes = _mm_set1_epi16(0xff);
+   __m128i a = zero;
+   __m128i c = zero;
+   png_uint_32 i;
+
+   for (i = 0; i + bpp <= rowbytes; i += bpp)
+   {
+      __m128i b = _mm_unpacklo_epi8(png_load_pixel_sse2(prev_row + i, bpp),
+         zero);
+      __m128i x = _mm_unpacklo_epi8(png_load_pixel_sse2(row + i, bpp), zero);
+      __m128i pa = _mm_sub_epi16(b, c);
+      __m128i pb = _mm_sub_epi16(a, c);
+      __m128i pc = _mm_add_epi16(pa, pb);
+      __m128i smallest, nearest;
+
+      pa = png_abs_epi16_sse2(pa);
+      pb = png_abs_epi16_sse2(pb);
+      pc = png_abs_epi16_sse2(pc);
+      smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+      /* The same ties as the C version: a, then b, then c. */
+      nearest = png_if_then_else_sse2(_mm_cmpeq_epi16(pa, smallest), a,
+         png_if_then_else_sse2(_mm_cmpeq_epi16(pb, smallest), b, c));
+
+      a = _mm_and_si128(_mm_add_epi16(x, nearest), low_bytes);
+      png_store_pixel_sse2(row + i, bpp, _mm_packus_epi16(a, a));
+      c = b;
+   }
+}
+
+/* Unfilters |row| and returns 1 if there is an SSE2 version of |filter| for
+ * the row, otherwise returns 0.
+ */
+static int
+png_read_filter_row_sse2(png_row_infop row_info, png_bytep row,
+   png_bytep prev_row, int filter)
+{
+   png_uint_32 rowbytes = row_info->rowbytes;
+   png_uint_32 bpp = (row_info->pixel_depth + 7) >> 3;
+
+   if (filter == PNG_FILTER_VALUE_UP)
+   {
+      png_read_filter_row_up_sse2(rowbytes, row, prev_row);
+      return 1;
+   }
+   if (bpp != 3 && bpp != 4)
+      return 0;
+   switch (filter)
+   {
+      case PNG_FILTER_VALUE_SUB:
+         png_read_filter_row_sub_sse2(rowbytes, bpp, row);
+         return 1;
+      case PNG_FILTER_VALUE_AVG:
+         png_read_filter_row_avg_sse2(rowbytes, bpp, row, prev_row);
+         return 1;
+      case PNG_FILTER_VALUE_PAETH:
+         png_read_filter_row_paeth_sse2(rowbytes, bpp, row, prev_row);
+         return 1;
+      default:
+         return 0;
+   }
+}
+#endif /* PNG_CHROMIUM_SSE2_FILTERS */
+
 void /* PRIVATE */
 png_read_filter_row(png_structp png_ptr, png_row_infop row_info, png_bytep row,
    png_bytep prev_row, int filter)
 {
    png_debug(1, "in png_read_filter_row");
    png_debug2(2, "row = %lu, filter = %d", png_ptr->row_number, filter);
+#ifdef PNG_CHROMIUM_SSE2_FILTERS
+   if (png_read_filter_row_sse2(row_info, row, prev_row, filter))
+      return;
+#endif
    switch (filter)
    {
       case PNG_FILTER_VALUE_NONE:
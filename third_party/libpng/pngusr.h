@@ -72,6 +72,14 @@
 #define PNG_NO_READ_EMPTY_PLTE
 #define PNG_NO_READ_OPT_PLTE
 
+/* Chromium: the SSE2 versions of the row filters of png_read_filter_row(),
+ * when the compiler generates SSE2 code, which all x86-64 processors run. */
+#if (defined(__SSE2__) || defined(__x86_64__) || defined(_M_X64) || \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && \
+    !defined(PNG_NO_CHROMIUM_SSE2_FILTERS)
+#define PNG_CHROMIUM_SSE2_FILTERS
+#endif
+
 #ifdef CHROME_PNG_WRITE_SUPPORT
 #define PNG_NO_WRITE_BACKGROUND
 #define PNG_NO_WRITE_DITHER
@@ -90,6 +90,10 @@ public:
 
     const SkDescriptor& getDescriptor() const { return *fDesc; }
 
+    /** Returns roughly how much memory this strike uses.
+    */
+    size_t getMemoryUsed() const { return fMemoryUsed; }
+
     SkMask::Format getMaskFormat() const {
         return fScalerContext->getMaskFormat();
     }
@@ -67,8 +67,10 @@ using namespace skia_advanced_typeface_metrics_utils;
 static const uint16_t BUFFERSIZE = (16384 - 32);
 static uint8_t glyphbuf[BUFFERSIZE];
 
-// Give 1MB font cache budget
+// Give 1MB font cache budget, unless the port sets its own
+#ifndef FONT_CACHE_MEMORY_BUDGET
 #define FONT_CACHE_MEMORY_BUDGET    (1024 * 1024)
+#endif
 
 /**
  *  Since LOGFONT wants its textsize as an int, and we support fractional sizes,
@@ -11,26 +11,146 @@ import exceptions
 import os
 import struct
 import sys
+import zlib
 
 sys.path.append(os.path.join(os.path.dirname(__file__), '..', '..'))
 from grit.format import interface
+from grit.format import png_optimizer
 from grit.node import include
 from grit.node import message
 from grit.node import misc
 
 
-PACK_FILE_VERSION = 4
+PACK_FILE_VERSION = 8
+# Packs of the previous versions, which have no aligned data, before that
+# their data in the order of the index, before that no compressed resources,
+# and before that no hash table, can still be read.
+PACK_FILE_VERSION_WITHOUT_ALIGNMENT = 7
+PACK_FILE_VERSION_WITHOUT_DATA_ORDER = 6
+PACK_FILE_VERSION_WITHOUT_COMPRESSION = 5
+PACK_FILE_VERSION_WITHOUT_HASH_TABLE = 4
 HEADER_LENGTH = 2 * 4 + 1  # Two uint32s. (file version, number of entries) and
                            # one uint8 (encoding of text resources)
 BINARY, UTF8, UTF16 = range(3)
 
+# Each index entry is a uint16 (id) and a uint32 (offset), and each slot of the
+# hash table an int32 (displacement) and a uint16 (index entry).
+INDEX_ENTRY_SIZE = 2 + 4
+HASH_TABLE_SLOT_SIZE = 4 + 2
+
+# Set in the offset of the index entries of compressed resources, whose data is
+# their uncompressed length, as a uint32, followed by a zlib stream.
+COMPRESSED_FLAG = 0x80000000
+
+# The data order table follows the hash table: for each index entry, as a
+# uint16, the index entry whose data follows its data, then the length of the
+# hot region, as a uint32. The hot region is at the start of the data, and
+# holds the resources used at startup, which DataPack::Load() prefetches.
+DATA_ORDER_ENTRY_SIZE = 2
+
+# The entry table follows the data order table: for each index entry, a uint8
+# whose high 4 bits are the encoding of the resource, and whose low 4 bits the
+# padding that follows its data. The data starts at the next multiple of
+# DATA_ALIGNMENT, and the data of the uncompressed UTF-16 resources is aligned
+# to 4 bytes, and that of the raw images to DATA_ALIGNMENT, so that they can be
+# used in place.
+ENTRY_TABLE_ENTRY_SIZE = 1
+DATA_ALIGNMENT = 16
+TEXT_ALIGNMENT = 4
+
 class WrongFileVersion(Exception):
   pass
 
+def HashId(seed, id):
+  """Hashes |id| with |seed|: MurmurHash3's 32 bit finalizer of |id| xor
+  |seed| times 0x9E3779B9.  Must match HashId() in
+  ui/base/resource/data_pack.cc."""
+  hash = (id ^ (seed * 0x9E3779B9)) & 0xFFFFFFFF
+  hash ^= hash >> 16
+  hash = (hash * 0x85EBCA6B) & 0xFFFFFFFF
+  hash ^= hash >> 13
+  hash = (hash * 0xC2B2AE35) & 0xFFFFFFFF
+  hash ^= hash >> 16
+  return hash
+
+
+def BuildHashTable(ids):
+  """Returns the minimal perfect hash table of |ids|, the sorted ids of the
+  index: a list of displacements, and a list of the index entries of the
+  slots, both as long as |ids|.
+
+  An id is first hashed with a seed of 0 into a bucket, whose displacement d
+  gives its slot: hash(d, id) modulo the number of slots if d is positive, or
+  -d - 1 if d is negative.  The displacements of buckets with several ids are
+  searched, from the largest bucket down, until all their ids land in free
+  slots; single ids then fill the remaining slots directly, and empty buckets
+  keep a displacement of 0.  See DataPack::GetStringPiece() in
+  ui/base/resource/data_pack.cc."""
+  count = len(ids)
+  buckets = [[] for _ in range(count)]
+  for index in range(count):
+    buckets[HashId(0, ids[index]) % count].append(index)
+
+  displacements = [0] * count
+  slots = [None] * count
+  by_size = sorted(range(count), key=lambda bucket: -len(buckets[bucket]))
+  position = 0
+  while position < count and len(buckets[by_size[position]]) > 1:
+    bucket = buckets[by_size[position]]
+    displacement = 1
+    while True:
+      taken = [HashId(displacement, ids[index]) % count for index in bucket]
+      if (len(set(taken)) == len(taken) and
+          not [slot for slot in taken if slots[slot] is not None]):
+        break
+      displacement += 1
+    displacements[by_size[position]] = displacement
+    for slot, index in zip(taken, bucket):
+      slots[slot] = index
+    position += 1
+
+  free_slots = [slot for slot in range(count) if slots[slot] is None]
+  while position < count and len(buckets[by_size[position]]) == 1:
+    slot = free_slots.pop()
+    displacements[by_size[position]] = -slot - 1
+    slots[slot] = buckets[by_size[position]][0]
+    position += 1
+
+  return displacements, slots
+
+
+def CompressResource(data):
+  """Returns |data| as stored in a data pack when compressed, or None if that
+  isn't smaller."""
+  compressed = struct.pack("<I", len(data)) + zlib.compress(data, 9)
+  if len(compressed) < len(data):
+    return compressed
+  return None
+
+
+def GetAlignment(data, encoding, compressed):
+  """Returns the alignment of the data of a resource of |encoding|, as written
+  in a data pack."""
+  if compressed:
+    return 1
+  if png_optimizer.IsRawImage(data):
+    return DATA_ALIGNMENT
+  if encoding == UTF16:
+    return TEXT_ALIGNMENT
+  return 1
+
+
 class DataPackContents:
-  def __init__(self, resources, encoding):
+  def __init__(self, resources, encoding, compressed_ids=None, hot_ids=None,
+               entry_encodings=None):
     self.resources = resources
     self.encoding = encoding
+    # The ids of the resources that were compressed in the pack.
+    self.compressed_ids = compressed_ids or set()
+    # The ids of the resources in the hot region of the pack, in order.
+    self.hot_ids = hot_ids or []
+    # The encoding of each resource, by id.
+    self.entry_encodings = entry_encodings or {}
 
 class DataPack(interface.ItemFormatter):
   '''Writes out the data pack file format (platform agnostic resource file).'''
@@ -42,10 +162,17 @@ class DataPack(interface.ItemFormatter):
 
     nodes = DataPack.GetDataNodes(item)
     data = {}
+    compressed_ids = set()
+    entry_encodings = {}
     for node in nodes:
       id, value = node.GetDataPackPair(lang, UTF8)
       data[id] = value
-    return DataPack.WriteDataPackToString(data, UTF8)
+      if node.attrs.get('compress') == 'true':
+        compressed_ids.add(id)
+      if isinstance(node, include.IncludeNode):
+        entry_encodings[id] = BINARY
+    return DataPack.WriteDataPackToString(data, UTF8, compressed_ids,
+                                          entry_encodings=entry_encodings)
 
   @staticmethod
   def GetDataNodes(item):
@@ -65,72 +192,217 @@ class DataPack(interface.ItemFormatter):
 
   @staticmethod
   def ReadDataPack(input_file):
-    """Reads a data pack file and returns a dictionary."""
+    """Reads a data pack file and returns a dictionary, with the compressed
+    resources decompressed."""
     data = open(input_file, "rb").read()
     original_data = data
 
     # Read the header.
     version, num_entries, encoding = struct.unpack("<IIB",
                                                    data[:HEADER_LENGTH])
-    if version != PACK_FILE_VERSION:
+    if version not in (PACK_FILE_VERSION,
+                       PACK_FILE_VERSION_WITHOUT_ALIGNMENT,
+                       PACK_FILE_VERSION_WITHOUT_DATA_ORDER,
+                       PACK_FILE_VERSION_WITHOUT_COMPRESSION,
+                       PACK_FILE_VERSION_WITHOUT_HASH_TABLE):
       print "Wrong file version in ", input_file
       raise WrongFileVersion
 
     resources = {}
+    compressed_ids = set()
+    entry_encodings = {}
     if num_entries == 0:
       return DataPackContents(resources, encoding)
 
-    # Read the index and data.
+    # Read the index.
+    offset_mask = 0xFFFFFFFF
+    if version >= PACK_FILE_VERSION_WITHOUT_DATA_ORDER:
+      offset_mask &= ~COMPRESSED_FLAG
+    index = []
     data = data[HEADER_LENGTH:]
-    kIndexEntrySize = 2 + 4  # Each entry is a uint16 and a uint32.
-    for _ in range(num_entries):
-      id, offset = struct.unpack("<HI", data[:kIndexEntrySize])
-      data = data[kIndexEntrySize:]
-      next_id, next_offset = struct.unpack("<HI", data[:kIndexEntrySize])
-      resources[id] = original_data[offset:next_offset]
+    for _ in range(num_entries + 1):
+      index.append(struct.unpack("<HI", data[:INDEX_ENTRY_SIZE]))
+      data = data[INDEX_ENTRY_SIZE:]
+
+    # Read the data order table, which follows the hash table, which isn't
+    # needed here, and the entry table.
+    next_entries = range(1, num_entries + 1)
+    hot_ids = []
+    attributes = [encoding << 4] * num_entries
+    if version >= PACK_FILE_VERSION_WITHOUT_ALIGNMENT:
+      data = data[num_entries * HASH_TABLE_SLOT_SIZE:]
+      next_entries = struct.unpack("<%dH" % num_entries,
+                                   data[:num_entries * DATA_ORDER_ENTRY_SIZE])
+      data = data[num_entries * DATA_ORDER_ENTRY_SIZE:]
+      hot_length, = struct.unpack("<I", data[:4])
+      data = data[4:]
+      if version >= PACK_FILE_VERSION:
+        attributes = struct.unpack("<%dB" % num_entries,
+                                   data[:num_entries * ENTRY_TABLE_ENTRY_SIZE])
+        data = data[num_entries * ENTRY_TABLE_ENTRY_SIZE:]
+      data_start = len(original_data) - len(data)
+      if version >= PACK_FILE_VERSION:
+        data_start += -data_start % DATA_ALIGNMENT
+      for i in range(num_entries):
+        if index[i][1] & offset_mask < data_start + hot_length:
+          hot_ids.append(i)
+      hot_ids.sort(key=lambda i: index[i][1] & offset_mask)
+      hot_ids = [index[i][0] for i in hot_ids]
 
-    return DataPackContents(resources, encoding)
+    # Read the data.
+    for i in range(num_entries):
+      id, offset = index[i]
+      next_offset = index[next_entries[i]][1]
+      padding = attributes[i] & 0xF
+      value = original_data[offset & offset_mask:
+                            (next_offset & offset_mask) - padding]
+      entry_encodings[id] = attributes[i] >> 4
+      if offset & ~offset_mask:
+        length, = struct.unpack("<I", value[:4])
+        value = zlib.decompress(value[4:])
+        assert len(value) == length
+        compressed_ids.add(id)
+      resources[id] = value
+
+    return DataPackContents(resources, encoding, compressed_ids, hot_ids,
+                            entry_encodings)
 
   @staticmethod
-  def WriteDataPackToString(resources, encoding):
+  def WriteDataPackToString(resources, encoding, compressed_ids=(),
+                            hot_ids=(), entry_encodings=None):
     """Write a map of id=>data into a string in the data pack format and return
-    it."""
+    it.  The resources whose ids are in |compressed_ids| are compressed with
+    zlib, unless that doesn't make them smaller.  The data of the resources
+    whose ids are in |hot_ids|, usually those of a startup profile written by
+    ResourceBundle::WriteResourceUseProfiles(), is laid out first, in that
+    order, in the hot region of the pack; the rest follows in the order of
+    the ids.  The encoding of each resource is that in |entry_encodings|, or
+    |encoding| if it isn't there."""
     ids = sorted(resources.keys())
     ret = []
 
+    # The data of each resource, as written in the pack.
+    packed = dict(resources)
+    compressed = set()
+    for id in compressed_ids:
+      if id in resources:
+        data = CompressResource(resources[id])
+        if data is not None:
+          packed[id] = data
+          compressed.add(id)
+
     # Write file header.
     ret.append(struct.pack("<IIB", PACK_FILE_VERSION, len(ids), encoding))
     HEADER_LENGTH = 2 * 4 + 1            # Two uint32s and one uint8.
 
     # Each entry is a uint16 + a uint32s. We have one extra entry for the last
     # item.
-    index_length = (len(ids) + 1) * (2 + 4)
+    index_length = (len(ids) + 1) * INDEX_ENTRY_SIZE
+
+    # The hash table follows the index, with one slot per resource, and then
+    # the data order table and the entry table.
+    hash_table_length = len(ids) * HASH_TABLE_SLOT_SIZE
+    data_order_length = len(ids) * DATA_ORDER_ENTRY_SIZE + 4
+    entry_table_length = len(ids) * ENTRY_TABLE_ENTRY_SIZE
+
+    encodings = dict([(id, encoding) for id in ids])
+    encodings.update(entry_encodings or {})
+
+    # Lay out the data, starting with the hot region.
+    data_order = []
+    for id in hot_ids:
+      if id in resources and id not in data_order:
+        data_order.append(id)
+    hot_count = len(data_order)
+    hot = set(data_order)
+    data_order.extend([id for id in ids if id not in hot])
+
+    # The padding that follows the data of each resource aligns the data of
+    # the next one.
+    tables_end = (HEADER_LENGTH + index_length + hash_table_length +
+                  data_order_length + entry_table_length)
+    data_start = tables_end + -tables_end % DATA_ALIGNMENT
+    data_offset = data_start
+    offsets = {}
+    padding = {}
+    hot_length = 0
+    for i in range(len(data_order)):
+      id = data_order[i]
+      offsets[id] = data_offset
+      data_offset += len(packed[id])
+      if i + 1 < len(data_order):
+        next_id = data_order[i + 1]
+        alignment = GetAlignment(packed[next_id], encodings[next_id],
+                                 next_id in compressed)
+        padding[id] = -data_offset % alignment
+      else:
+        padding[id] = 0
+      data_offset += padding[id]
+      if i + 1 == hot_count:
+        hot_length = data_offset - data_start
 
     # Write index.
-    data_offset = HEADER_LENGTH + index_length
     for id in ids:
-      ret.append(struct.pack("<HI", id, data_offset))
-      data_offset += len(resources[id])
+      offset = offsets[id]
+      if id in compressed:
+        offset |= COMPRESSED_FLAG
+      ret.append(struct.pack("<HI", id, offset))
 
     ret.append(struct.pack("<HI", 0, data_offset))
 
-    # Write data.
+    # Write hash table: all the displacements, then all the slots.
+    displacements, slots = BuildHashTable(ids)
+    for displacement in displacements:
+      ret.append(struct.pack("<i", displacement))
+    for slot in slots:
+      ret.append(struct.pack("<H", slot))
+
+    # Write data order table: the index entry of the data that follows that
+    # of each entry, the extra one for the last data, and the hot length.
+    entries = dict([(ids[i], i) for i in range(len(ids))])
+    next_entries = {}
+    for i in range(len(data_order)):
+      if i + 1 < len(data_order):
+        next_entries[data_order[i]] = entries[data_order[i + 1]]
+      else:
+        next_entries[data_order[i]] = len(ids)
     for id in ids:
-      ret.append(resources[id])
+      ret.append(struct.pack("<H", next_entries[id]))
+    ret.append(struct.pack("<I", hot_length))
+
+    # Write entry table, then the padding up to the data.
+    for id in ids:
+      ret.append(struct.pack("<B", encodings[id] << 4 | padding[id]))
+    ret.append('\0' * (data_start - tables_end))
+
+    # Write data.
+    for id in data_order:
+      ret.append(packed[id])
+      ret.append('\0' * padding[id])
     return ''.join(ret)
 
   @staticmethod
-  def WriteDataPack(resources, output_file, encoding):
+  def WriteDataPack(resources, output_file, encoding, compressed_ids=(),
+                    hot_ids=(), entry_encodings=None):
     """Write a map of id=>data into output_file as a data pack."""
     file = open(output_file, "wb")
-    content = DataPack.WriteDataPackToString(resources, encoding)
+    content = DataPack.WriteDataPackToString(resources, encoding,
+                                             compressed_ids, hot_ids,
+                                             entry_encodings)
     file.write(content)
 
   @staticmethod
-  def RePack(output_file, input_files):
+  def RePack(output_file, input_files, hot_ids=None, transform=None):
     """Write a new data pack to |output_file| based on a list of filenames
-    (|input_files|)"""
+    (|input_files|).  Resources that were compressed stay compressed.  The
+    resources of |hot_ids| make up the hot region of the new pack if it is
+    given, and those of the hot regions of the input files otherwise.  If
+    |transform| is given, each resource is replaced by what it returns when
+    called with the id and the data of the resource, and whether it is hot."""
     resources = {}
+    compressed_ids = set()
+    input_hot_ids = []
+    entry_encodings = {}
     encoding = None
     for filename in input_files:
       new_content = DataPack.ReadDataPack(filename)
@@ -150,11 +422,21 @@ class DataPack(interface.ItemFormatter):
                                     str(new_content.encoding))
 
       resources.update(new_content.resources)
+      compressed_ids.update(new_content.compressed_ids)
+      input_hot_ids.extend(new_content.hot_ids)
+      entry_encodings.update(new_content.entry_encodings)
 
     # Encoding is 0 for BINARY, 1 for UTF8 and 2 for UTF16
     if encoding is None:
       encoding = BINARY
-    DataPack.WriteDataPack(resources, output_file, encoding)
+    if hot_ids is None:
+      hot_ids = input_hot_ids
+    if transform:
+      hot = set(hot_ids)
+      for id in resources:
+        resources[id] = transform(id, resources[id], id in hot)
+    DataPack.WriteDataPack(resources, output_file, encoding, compressed_ids,
+                           hot_ids, entry_encodings)
 
 def main():
   # Just write a simple file.
@@ -6,9 +6,12 @@
 '''Unit tests for grit.format.data_pack'''
 
 import os
+import shutil
+import struct
 import sys
 if __name__ == '__main__':
   sys.path.append(os.path.join(os.path.dirname(sys.argv[0]), '../..'))
+import tempfile
 import unittest
 
 from grit.format import data_pack
@@ -16,19 +19,121 @@ from grit.format import data_pack
 class FormatDataPackUnittest(unittest.TestCase):
   def testWriteDataPack(self):
     expected = (
-        '\x04\x00\x00\x00'                  # header(version
+        '\x08\x00\x00\x00'                  # header(version
         '\x04\x00\x00\x00'                  #        no. entries,
         '\x01'                              #        encoding)
-        '\x01\x00\x27\x00\x00\x00'          # index entry 1
-        '\x04\x00\x27\x00\x00\x00'          # index entry 4
-        '\x06\x00\x33\x00\x00\x00'          # index entry 6
-        '\x0a\x00\x3f\x00\x00\x00'          # index entry 10
-        '\x00\x00\x3f\x00\x00\x00'          # extra entry for the size of last
+        '\x01\x00\x50\x00\x00\x00'          # index entry 1
+        '\x04\x00\x50\x00\x00\x00'          # index entry 4
+        '\x06\x00\x5c\x00\x00\x00'          # index entry 6
+        '\x0a\x00\x68\x00\x00\x00'          # index entry 10
+        '\x00\x00\x68\x00\x00\x00'          # extra entry for the size of last
+        '\x01\x00\x00\x00\xfc\xff\xff\xff'  # hash table displacements
+        '\x00\x00\x00\x00\xff\xff\xff\xff'
+        '\x00\x00\x03\x00\x02\x00\x01\x00'  # hash table slots
+        '\x01\x00\x02\x00\x03\x00\x04\x00'  # data order
+        '\x00\x00\x00\x00'                  # hot region length
+        '\x10\x10\x10\x10'                  # entry table
+        '\x00'                              # padding up to the data
         'this is id 4this is id 6')         # data
     input = { 1: "", 4: "this is id 4", 6: "this is id 6", 10: "" }
     output = data_pack.DataPack.WriteDataPackToString(input, data_pack.UTF8)
     self.failUnless(output == expected)
 
+  def testCompressedResources(self):
+    input = { 1: "short", 4: "this is id 4 " * 20, 6: "this is id 6" }
+    output = data_pack.DataPack.WriteDataPackToString(input, data_pack.UTF8,
+                                                      [1, 4])
+    # Only id 4 is made smaller by compression.
+    index = output[data_pack.HEADER_LENGTH:]
+    offsets = [struct.unpack("<HI", index[i:i + 6])[1] for i in (0, 6, 12)]
+    self.failUnless(offsets[0] & data_pack.COMPRESSED_FLAG == 0)
+    self.failUnless(offsets[1] & data_pack.COMPRESSED_FLAG)
+    self.failUnless(offsets[2] & data_pack.COMPRESSED_FLAG == 0)
+
+    dir = tempfile.mkdtemp()
+    try:
+      filename = os.path.join(dir, 'test.pak')
+      open(filename, 'wb').write(output)
+      contents = data_pack.DataPack.ReadDataPack(filename)
+    finally:
+      shutil.rmtree(dir)
+    self.failUnless(contents.resources == input)
+    self.failUnless(contents.compressed_ids == set([4]))
+
+  def testHotResources(self):
+    input = { 1: "one", 4: "four", 6: "six", 10: "ten" }
+    output = data_pack.DataPack.WriteDataPackToString(input, data_pack.UTF8,
+                                                      hot_ids=[6, 1, 99])
+    # Six and one come first, then four and ten.
+    self.failUnless(output.endswith('sixonefourten'))
+    hot_length, = struct.unpack("<I", output[-22:-18])
+    self.failUnless(hot_length == 6)
+
+    dir = tempfile.mkdtemp()
+    try:
+      filename = os.path.join(dir, 'test.pak')
+      open(filename, 'wb').write(output)
+      contents = data_pack.DataPack.ReadDataPack(filename)
+    finally:
+      shutil.rmtree(dir)
+    self.failUnless(contents.resources == input)
+    self.failUnless(contents.hot_ids == [6, 1])
+
+  def testAlignedResources(self):
+    raw_image = data_pack.png_optimizer.RAW_IMAGE_SIGNATURE + '\0' * 40
+    input = { 1: "odd", 4: "\x41\x00\x42\x00", 6: raw_image, 10: "ten" }
+    output = data_pack.DataPack.WriteDataPackToString(
+        input, data_pack.UTF16, entry_encodings={ 6: data_pack.BINARY })
+    index = output[data_pack.HEADER_LENGTH:]
+    offsets = [struct.unpack("<HI", index[i:i + 6])[1] for i in range(0, 30, 6)]
+    # The data starts aligned, UTF-16 text follows at a multiple of 4 and raw
+    # images at a multiple of 16, and the rest isn't padded.
+    self.failUnless(offsets[0] % 16 == 0)
+    self.failUnless(offsets[1] == offsets[0] + 4)
+    self.failUnless(offsets[2] == offsets[0] + 16)
+    self.failUnless(offsets[3] == offsets[2] + len(raw_image))
+    self.failUnless(offsets[4] == len(output))
+
+    dir = tempfile.mkdtemp()
+    try:
+      filename = os.path.join(dir, 'test.pak')
+      open(filename, 'wb').write(output)
+      contents = data_pack.DataPack.ReadDataPack(filename)
+    finally:
+      shutil.rmtree(dir)
+    self.failUnless(contents.resources == input)
+    self.failUnless(contents.entry_encodings == { 1: data_pack.UTF16,
+                                                  4: data_pack.UTF16,
+                                                  6: data_pack.BINARY,
+                                                  10: data_pack.UTF16 })
+
+  def testRePackTransform(self):
+    dir = tempfile.mkdtemp()
+    try:
+      input = os.path.join(dir, 'input.pak')
+      output = os.path.join(dir, 'output.pak')
+      data_pack.DataPack.WriteDataPack({ 1: "one", 4: "four" }, input,
+                                       data_pack.UTF8, hot_ids=[4])
+      data_pack.DataPack.RePack(
+          output, [input],
+          transform=lambda id, data, hot: hot and data.upper() or data)
+      contents = data_pack.DataPack.ReadDataPack(output)
+    finally:
+      shutil.rmtree(dir)
+    self.failUnless(contents.resources == { 1: "one", 4: "FOUR" })
+    self.failUnless(contents.hot_ids == [4])
+
+  def testBuildHashTable(self):
+    ids = range(0, 65536, 97)
+    displacements, slots = data_pack.BuildHashTable(ids)
+    self.failUnless(sorted(slots) == range(len(ids)))
+    for index in range(len(ids)):
+      displacement = displacements[data_pack.HashId(0, ids[index]) % len(ids)]
+      if displacement < 0:
+        slot = -displacement - 1
+      else:
+        slot = data_pack.HashId(displacement, ids[index]) % len(ids)
+      self.failUnless(slots[slot] == index)
 
 if __name__ == '__main__':
   unittest.main()
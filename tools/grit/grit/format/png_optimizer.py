@@ -0,0 +1,405 @@
+#!/usr/bin/python2.4
+# Copyright (c) 2011 The Chromium Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+'''Build time processing of the PNG resources of data packs: recompressing
+them, decoding them into the premultiplied BGRA pixels that ResourceBundle
+uses as is, and scaling them for other DPIs.  See repack.py.
+
+Only what the resources use is decoded: 8 bit samples, without interlacing.
+The other PNGs are only recompressed.
+'''
+
+import array
+import struct
+import zlib
+
+
+PNG_SIGNATURE = '\x89PNG\r\n\x1a\n'
+
+# The signature of the pre-decoded images, which is followed by the width, the
+# height and the flags, as uint32s, and 3 reserved uint32s, then by the rows of
+# premultiplied BGRA pixels.  The header is 32 bytes long so that the pixels of
+# an image aligned to 16 bytes in a data pack are too.  Must match
+# ui/base/resource/resource_image.cc.
+RAW_IMAGE_SIGNATURE = '\x89PMA\r\n\x1a\n'
+RAW_IMAGE_HEADER_LENGTH = len(RAW_IMAGE_SIGNATURE) + 6 * 4
+RAW_IMAGE_OPAQUE_FLAG = 1
+
+GRAY, RGB, PALETTE, GRAY_ALPHA, RGBA = 0, 2, 3, 4, 6
+CHANNELS = { GRAY: 1, RGB: 3, PALETTE: 1, GRAY_ALPHA: 2, RGBA: 4 }
+
+# The chunks that don't change what the image looks like, which are dropped.
+STRIPPED_CHUNKS = ('tEXt', 'zTXt', 'iTXt', 'tIME', 'pHYs', 'bKGD', 'hIST',
+                   'sPLT')
+
+# The chunks that are kept when an image is encoded again: those of the color
+# space, which don't depend on the color type.
+COLOR_SPACE_CHUNKS = ('gAMA', 'cHRM', 'sRGB', 'iCCP')
+
+NONE, SUB, UP, AVERAGE, PAETH = range(5)
+
+
+class Image:
+  '''Unpremultiplied RGBA pixels, as an array of bytes, row by row.'''
+  def __init__(self, width, height, pixels):
+    self.width = width
+    self.height = height
+    self.pixels = pixels
+
+  def IsOpaque(self):
+    return min(self.pixels[3::4] or [255]) == 255
+
+  def IsGray(self):
+    p = self.pixels
+    return p[0::4] == p[1::4] and p[1::4] == p[2::4]
+
+
+def ReadChunks(data):
+  '''Returns the (type, body) pairs of the chunks of the PNG |data|, or None if
+  it isn't a PNG.'''
+  if not data.startswith(PNG_SIGNATURE):
+    return None
+  chunks = []
+  position = len(PNG_SIGNATURE)
+  while position + 8 <= len(data):
+    length, type = struct.unpack('>I4s', data[position:position + 8])
+    body = data[position + 8:position + 8 + length]
+    if len(body) != length:
+      return None
+    chunks.append((type, body))
+    position += 12 + length
+    if type == 'IEND':
+      break
+  if not chunks or chunks[0][0] != 'IHDR' or chunks[-1][0] != 'IEND':
+    return None
+  return chunks
+
+
+def WriteChunks(chunks):
+  '''Returns the PNG made of the (type, body) pairs |chunks|.'''
+  ret = [PNG_SIGNATURE]
+  for type, body in chunks:
+    crc = zlib.crc32(type + body) & 0xFFFFFFFF
+    ret.append(struct.pack('>I4s', len(body), type) + body +
+               struct.pack('>I', crc))
+  return ''.join(ret)
+
+
+def _Paeth(a, b, c):
+  p = a + b - c
+  pa = abs(p - a)
+  pb = abs(p - b)
+  pc = abs(p - c)
+  if pa <= pb and pa <= pc:
+    return a
+  if pb <= pc:
+    return b
+  return c
+
+
+def _Unfilter(filter, row, prior, bpp):
+  '''Undoes |filter| on the bytes of |row| in place, |prior| being the
+  unfiltered bytes of the row above.'''
+  if filter == SUB:
+    for i in range(bpp, len(row)):
+      row[i] = (row[i] + row[i - bpp]) & 0xFF
+  elif filter == UP:
+    for i in range(len(row)):
+      row[i] = (row[i] + prior[i]) & 0xFF
+  elif filter == AVERAGE:
+    for i in range(len(row)):
+      left = 0
+      if i >= bpp:
+        left = row[i - bpp]
+      row[i] = (row[i] + ((left + prior[i]) >> 1)) & 0xFF
+  elif filter == PAETH:
+    for i in range(len(row)):
+      left = upper_left = 0
+      if i >= bpp:
+        left = row[i - bpp]
+        upper_left = prior[i - bpp]
+      row[i] = (row[i] + _Paeth(left, prior[i], upper_left)) & 0xFF
+  elif filter != NONE:
+    raise ValueError('Unknown PNG filter %d' % filter)
+
+
+def _Filter(filter, row, prior, bpp):
+  '''Returns the bytes of |row| filtered with |filter|.'''
+  if filter == NONE:
+    return array.array('B', row)
+  out = array.array('B', [0] * len(row))
+  for i in range(len(row)):
+    left = upper_left = 0
+    if i >= bpp:
+      left = row[i - bpp]
+      upper_left = prior[i - bpp]
+    if filter == SUB:
+      predictor = left
+    elif filter == UP:
+      predictor = prior[i]
+    elif filter == AVERAGE:
+      predictor = (left + prior[i]) >> 1
+    else:
+      predictor = _Paeth(left, prior[i], upper_left)
+    out[i] = (row[i] - predictor) & 0xFF
+  return out
+
+
+def Decode(data):
+  '''Returns the Image of the PNG |data|, or None if it isn't a PNG this
+  decodes.'''
+  chunks = ReadChunks(data)
+  if not chunks:
+    return None
+  width, height, bit_depth, color_type, compression, filter_method, \
+      interlace = struct.unpack('>IIBBBBB', chunks[0][1])
+  if (bit_depth != 8 or color_type not in CHANNELS or compression or
+      filter_method or interlace):
+    return None
+  palette = None
+  transparency = ''
+  for type, body in chunks:
+    if type == 'PLTE':
+      palette = body
+    elif type == 'tRNS':
+      transparency = body
+  if color_type == PALETTE and not palette:
+    return None
+  # A tRNS chunk for the color types without alpha gives a transparent color,
+  # which the resources don't use.
+  if transparency and color_type in (GRAY, RGB):
+    return None
+
+  try:
+    raw = zlib.decompress(''.join([body for type, body in chunks
+                                   if type == 'IDAT']))
+  except zlib.error:
+    return None
+  bpp = CHANNELS[color_type]
+  stride = width * bpp
+  if len(raw) < (stride + 1) * height:
+    return None
+
+  pixels = array.array('B')
+  prior = array.array('B', [0] * stride)
+  for y in range(height):
+    start = y * (stride + 1)
+    row = array.array('B', raw[start + 1:start + 1 + stride])
+    _Unfilter(ord(raw[start]), row, prior, bpp)
+    prior = row
+    for x in range(width):
+      sample = row[x * bpp:(x + 1) * bpp]
+      if color_type == GRAY:
+        pixels.extend([sample[0]] * 3 + [255])
+      elif color_type == GRAY_ALPHA:
+        pixels.extend([sample[0]] * 3 + [sample[1]])
+      elif color_type == RGB:
+        pixels.extend(sample)
+        pixels.append(255)
+      elif color_type == RGBA:
+        pixels.extend(sample)
+      else:
+        index = sample[0]
+        if index * 3 + 3 > len(palette):
+          return None
+        pixels.extend([ord(c) for c in palette[index * 3:index * 3 + 3]])
+        if index < len(transparency):
+          pixels.append(ord(transparency[index]))
+        else:
+          pixels.append(255)
+  return Image(width, height, pixels)
+
+
+def _Compress(scanlines):
+  '''Returns the smallest zlib stream of |scanlines| of those tried.'''
+  best = None
+  for strategy in (zlib.Z_DEFAULT_STRATEGY, zlib.Z_FILTERED):
+    compressor = zlib.compressobj(9, zlib.DEFLATED, 15, 9, strategy)
+    stream = compressor.compress(scanlines) + compressor.flush()
+    if best is None or len(stream) < len(best):
+      best = stream
+  return best
+
+
+def Encode(image, extra_chunks=()):
+  '''Returns |image| as the smallest PNG of the color types and filters tried,
+  with |extra_chunks| before its data.'''
+  opaque = image.IsOpaque()
+  if image.IsGray():
+    color_type = GRAY_ALPHA
+    if opaque:
+      color_type = GRAY
+  else:
+    color_type = RGBA
+    if opaque:
+      color_type = RGB
+  bpp = CHANNELS[color_type]
+  stride = image.width * bpp
+
+  # The samples of the color type, row by row.
+  samples = array.array('B')
+  if color_type == RGBA:
+    samples = image.pixels
+  else:
+    channels = {
+      GRAY: (0,), GRAY_ALPHA: (0, 3), RGB: (0, 1, 2)
+    }[color_type]
+    for i in range(0, len(image.pixels), 4):
+      for channel in channels:
+        samples.append(image.pixels[i + channel])
+
+  # No filter, which is best for palette like images, and the filter of each
+  # row that gives the smallest sum of the filtered bytes taken as signed, the
+  # heuristic of libpng, which is best for photo like images.
+  no_filter = []
+  adaptive = []
+  prior = array.array('B', [0] * stride)
+  for y in range(image.height):
+    row = samples[y * stride:(y + 1) * stride]
+    no_filter.append(chr(NONE) + row.tostring())
+    best = None
+    for filter in (NONE, SUB, UP, AVERAGE, PAETH):
+      filtered = _Filter(filter, row, prior, bpp)
+      cost = sum([min(value, 256 - value) for value in filtered])
+      if best is None or cost < best[0]:
+        best = (cost, filter, filtered)
+    adaptive.append(chr(best[1]) + best[2].tostring())
+    prior = row
+
+  stream = None
+  for scanlines in (no_filter, adaptive):
+    compressed = _Compress(''.join(scanlines))
+    if stream is None or len(compressed) < len(stream):
+      stream = compressed
+
+  header = struct.pack('>IIBBBBB', image.width, image.height, 8, color_type,
+                       0, 0, 0)
+  return WriteChunks([('IHDR', header)] + list(extra_chunks) +
+                     [('IDAT', stream), ('IEND', '')])
+
+
+def Optimize(data):
+  '''Returns the PNG |data| recompressed, without the chunks that don't change
+  what it looks like, or |data| if that isn't smaller or it isn't a PNG.'''
+  chunks = ReadChunks(data)
+  if not chunks:
+    return data
+
+  # The same scanlines recompressed, which works for any PNG.
+  candidates = []
+  try:
+    scanlines = zlib.decompress(''.join([body for type, body in chunks
+                                         if type == 'IDAT']))
+    kept = [(type, body) for type, body in chunks
+            if type not in STRIPPED_CHUNKS and type not in ('IDAT', 'IEND')]
+    candidates.append(WriteChunks(kept + [('IDAT', _Compress(scanlines)),
+                                          ('IEND', '')]))
+  except zlib.error:
+    return data
+
+  # Encoded again, with the color type and filters that suit it best.
+  image = Decode(data)
+  if image:
+    color_space = [(type, body) for type, body in chunks
+                   if type in COLOR_SPACE_CHUNKS]
+    candidates.append(Encode(image, color_space))
+
+  best = data
+  for candidate in candidates:
+    if len(candidate) < len(best):
+      best = candidate
+  return best
+
+
+def _MulDiv255Round(a, b):
+  '''a * b / 255, rounded, as SkMulDiv255Round() computes it.'''
+  product = a * b + 128
+  return (product + (product >> 8)) >> 8
+
+
+def ToRawImage(image):
+  '''Returns the pre-decoded image resource of |image|: its premultiplied
+  pixels, in the BGRA byte order of SkPMColor on Windows.'''
+  header = RAW_IMAGE_SIGNATURE + struct.pack(
+      '<IIIIII', image.width, image.height,
+      image.IsOpaque() and RAW_IMAGE_OPAQUE_FLAG or 0, 0, 0, 0)
+  pixels = array.array('B', [0] * len(image.pixels))
+  p = image.pixels
+  for i in range(0, len(p), 4):
+    alpha = p[i + 3]
+    pixels[i] = _MulDiv255Round(p[i + 2], alpha)
+    pixels[i + 1] = _MulDiv255Round(p[i + 1], alpha)
+    pixels[i + 2] = _MulDiv255Round(p[i], alpha)
+    pixels[i + 3] = alpha
+  return header + pixels.tostring()
+
+
+def IsRawImage(data):
+  return data.startswith(RAW_IMAGE_SIGNATURE)
+
+
+def _ScaleWeights(source_size, size):
+  '''Returns, for each of the |size| pixels of a row or a column scaled from
+  |source_size| pixels, the (source pixel, weight) pairs it averages: the
+  parts of the source pixels that it covers.'''
+  ratio = float(source_size) / size
+  weights = []
+  for i in range(size):
+    start = i * ratio
+    end = min((i + 1) * ratio, source_size)
+    pairs = []
+    j = int(start)
+    while j < end:
+      coverage = min(j + 1, end) - max(j, start)
+      if coverage > 0:
+        pairs.append((j, coverage / ratio))
+      j += 1
+    weights.append(pairs)
+  return weights
+
+
+def Scale(image, scale):
+  '''Returns |image| scaled by |scale|, each pixel the average of the source
+  pixels it covers, weighted by their alpha so that transparent pixels don't
+  darken the edges.'''
+  width = max(1, int(round(image.width * scale)))
+  height = max(1, int(round(image.height * scale)))
+  columns = _ScaleWeights(image.width, width)
+  rows = _ScaleWeights(image.height, height)
+
+  # Premultiplied, as floats, for the averages.
+  source = []
+  p = image.pixels
+  for i in range(0, len(p), 4):
+    alpha = p[i + 3] / 255.0
+    source.append((p[i] * alpha, p[i + 1] * alpha, p[i + 2] * alpha,
+                   p[i + 3]))
+
+  # Horizontally, then vertically.
+  horizontal = []
+  for y in range(image.height):
+    for pairs in columns:
+      sums = [0.0] * 4
+      for x, weight in pairs:
+        pixel = source[y * image.width + x]
+        for c in range(4):
+          sums[c] += pixel[c] * weight
+      horizontal.append(sums)
+
+  pixels = array.array('B')
+  for pairs in rows:
+    for x in range(width):
+      sums = [0.0] * 4
+      for y, weight in pairs:
+        pixel = horizontal[y * width + x]
+        for c in range(4):
+          sums[c] += pixel[c] * weight
+      for c in range(3):
+        value = 0
+        if sums[3] > 0:
+          value = min(255, int(sums[c] * 255.0 / sums[3] + 0.5))
+        pixels.append(value)
+      pixels.append(min(255, int(sums[3] + 0.5)))
+  return Image(width, height, pixels)
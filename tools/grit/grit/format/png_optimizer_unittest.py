@@ -0,0 +1,95 @@
+#!/usr/bin/python2.4
+# Copyright (c) 2011 The Chromium Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+'''Unit tests for grit.format.png_optimizer'''
+
+import array
+import os
+import struct
+import sys
+if __name__ == '__main__':
+  sys.path.append(os.path.join(os.path.dirname(sys.argv[0]), '../..'))
+import unittest
+import zlib
+
+from grit.format import png_optimizer
+
+def MakeImage(width, height, pixel):
+  '''Returns an image whose pixel at x, y is |pixel|(x, y), as RGBA.'''
+  pixels = array.array('B')
+  for y in range(height):
+    for x in range(width):
+      pixels.extend(pixel(x, y))
+  return png_optimizer.Image(width, height, pixels)
+
+class PngOptimizerUnittest(unittest.TestCase):
+  def testEncodeDecode(self):
+    for pixel in (lambda x, y: (x * 30, y * 40, 7, 255),
+                  lambda x, y: (x * 30, y * 40, 7, x * 50),
+                  lambda x, y: (x * 30, x * 30, x * 30, 255),
+                  lambda x, y: (y * 20, y * 20, y * 20, x * 10)):
+      image = MakeImage(5, 4, pixel)
+      decoded = png_optimizer.Decode(png_optimizer.Encode(image))
+      self.failUnless(decoded.width == 5 and decoded.height == 4)
+      self.failUnless(decoded.pixels == image.pixels)
+
+  def testDecodePalette(self):
+    header = struct.pack('>IIBBBBB', 2, 1, 8, png_optimizer.PALETTE, 0, 0, 0)
+    data = png_optimizer.WriteChunks([
+        ('IHDR', header),
+        ('PLTE', '\x01\x02\x03\x04\x05\x06'),
+        ('tRNS', '\x80'),
+        ('IDAT', zlib.compress('\x00\x00\x01')),
+        ('IEND', '')])
+    image = png_optimizer.Decode(data)
+    self.failUnless(image.pixels.tolist() == [1, 2, 3, 128, 4, 5, 6, 255])
+
+  def testOptimize(self):
+    image = MakeImage(16, 16, lambda x, y: (x * 16, 0, 0, 255))
+    header = struct.pack('>IIBBBBB', 16, 16, 8, png_optimizer.RGBA, 0, 0, 0)
+    scanlines = ''.join(['\x00' + image.pixels[y * 64:(y + 1) * 64].tostring()
+                         for y in range(16)])
+    data = png_optimizer.WriteChunks([
+        ('IHDR', header),
+        ('tEXt', 'Comment\x00' + 'x' * 100),
+        ('IDAT', zlib.compress(scanlines, 1)),
+        ('IEND', '')])
+    optimized = png_optimizer.Optimize(data)
+    self.failUnless(len(optimized) < len(data))
+    self.failUnless('tEXt' not in
+                    [type for type, body in
+                     png_optimizer.ReadChunks(optimized)])
+    self.failUnless(png_optimizer.Decode(optimized).pixels == image.pixels)
+
+    # What isn't a PNG is left alone.
+    self.failUnless(png_optimizer.Optimize('GIF89a') == 'GIF89a')
+
+  def testToRawImage(self):
+    image = MakeImage(2, 1, lambda x, y: (255, 128, 0, x * 127 + 1))
+    raw = png_optimizer.ToRawImage(image)
+    self.failUnless(png_optimizer.IsRawImage(raw))
+    header = raw[:png_optimizer.RAW_IMAGE_HEADER_LENGTH]
+    width, height, flags = struct.unpack('<III', header[8:20])
+    self.failUnless((width, height, flags) == (2, 1, 0))
+    pixels = [ord(c) for c in raw[png_optimizer.RAW_IMAGE_HEADER_LENGTH:]]
+    self.failUnless(pixels == [0, 1, 1, 1, 0, 64, 128, 128])
+
+  def testScale(self):
+    image = MakeImage(4, 2, lambda x, y: (x < 2 and 200 or 100, 50, 0, 255))
+    scaled = png_optimizer.Scale(image, 0.5)
+    self.failUnless(scaled.width == 2 and scaled.height == 1)
+    self.failUnless(scaled.pixels.tolist() == [200, 50, 0, 255,
+                                               100, 50, 0, 255])
+
+    # The color of transparent pixels doesn't bleed into the others.
+    image = MakeImage(2, 1, lambda x, y: (x and 255 or 0, 0, 0, x and 255))
+    scaled = png_optimizer.Scale(image, 0.5)
+    self.failUnless(scaled.pixels.tolist() == [255, 0, 0, 128])
+
+    scaled = png_optimizer.Scale(image, 1.5)
+    self.failUnless(scaled.width == 3 and scaled.height == 2)
+
+if __name__ == '__main__':
+  unittest.main()
@@ -7,18 +7,80 @@
 A simple utility function to merge data pack files into a single data pack. See
 http://dev.chromium.org/developers/design-documents/linuxresourcesandlocalizedstrings
 for details about the file format.
+
+With --hot-ids=<file>, the resources listed in the file, one id per line, as
+written by ResourceBundle::WriteResourceUseProfiles(), are laid out first in
+the pack, where they are prefetched at startup.
+
+The PNG resources can also be processed on the way:
+  --optimize-images      recompresses them, and strips their metadata.
+  --predecode-hot-images stores the hot ones as the premultiplied pixels that
+                         ResourceBundle uses, so that they aren't decoded at
+                         runtime.  They take more space, so this is meant for
+                         the few used at startup.
+  --scale=<factor>       scales them, for the pack of the images of displays
+                         of another DPI, e.g. 1.25 for 120 DPI.
 """
 
 import sys
 
 import data_pack
+import png_optimizer
+
+def ReadHotIds(filename):
+  """Returns the ids listed in the startup profile |filename|."""
+  return [int(line) for line in open(filename) if line.strip()]
+
+class ImageTransform:
+  """Processes the PNG resources as the options ask; see
+  data_pack.DataPack.RePack()."""
+  def __init__(self, optimize, predecode_hot, scale):
+    self.optimize = optimize
+    self.predecode_hot = predecode_hot
+    self.scale = scale
+
+  def __call__(self, id, data, hot):
+    if not data.startswith(png_optimizer.PNG_SIGNATURE):
+      return data
+    image = None
+    if self.scale != 1.0 or (hot and self.predecode_hot):
+      image = png_optimizer.Decode(data)
+    if image and self.scale != 1.0:
+      image = png_optimizer.Scale(image, self.scale)
+      data = png_optimizer.Encode(image)
+    if image and hot and self.predecode_hot:
+      return png_optimizer.ToRawImage(image)
+    if self.optimize:
+      data = png_optimizer.Optimize(data)
+    return data
 
 def main(argv):
-  if len(argv) < 3:
-    print ("Usage:\n  %s <output_filename> <input_file1> [input_file2] ... " %
-           argv[0])
+  hot_ids = None
+  optimize = False
+  predecode_hot = False
+  scale = 1.0
+  args = argv[1:]
+  while args and args[0].startswith('--'):
+    option = args.pop(0)
+    if option.startswith('--hot-ids='):
+      hot_ids = ReadHotIds(option[len('--hot-ids='):])
+    elif option == '--optimize-images':
+      optimize = True
+    elif option == '--predecode-hot-images':
+      predecode_hot = True
+    elif option.startswith('--scale='):
+      scale = float(option[len('--scale='):])
+    else:
+      args = []
+  if len(args) < 2:
+    print ("Usage:\n  %s [--hot-ids=<ids_file>] [--optimize-images] "
+           "[--predecode-hot-images] [--scale=<factor>] <output_filename> "
+           "<input_file1> [input_file2] ... " % argv[0])
     sys.exit(-1)
-  data_pack.DataPack.RePack(argv[1], argv[2:])
+  transform = None
+  if optimize or predecode_hot or scale != 1.0:
+    transform = ImageTransform(optimize, predecode_hot, scale)
+  data_pack.DataPack.RePack(args[0], args[1:], hot_ids, transform)
 
 if '__main__' == __name__:
   main(sys.argv)
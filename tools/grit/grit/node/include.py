@@ -48,6 +48,7 @@ class IncludeNode(base.Node):
       'flattenhtml': 'false',
       'allowexternalscript': 'false',
       'relativepath': 'false',
+      'compress': 'false',
       }
 
   def ItemFormatter(self, t):
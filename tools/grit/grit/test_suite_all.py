@@ -34,6 +34,7 @@ class TestSuiteAll(unittest.TestSuite):
     from grit import tclib_unittest
     import grit.format.rc_unittest
     import grit.format.data_pack_unittest
+    import grit.format.png_optimizer_unittest
     from grit.tool import rc2grd_unittest
     from grit.tool import transl2tc_unittest
     from grit.gather import txt_unittest
@@ -62,6 +63,7 @@ class TestSuiteAll(unittest.TestSuite):
       tclib_unittest.TclibUnittest,
       grit.format.rc_unittest.FormatRcUnittest,
       grit.format.data_pack_unittest.FormatDataPackUnittest,
+      grit.format.png_optimizer_unittest.PngOptimizerUnittest,
       rc2grd_unittest.Rc2GrdUnittest,
       transl2tc_unittest.TranslationToTcUnittest,
       txt_unittest.TxtUnittest,
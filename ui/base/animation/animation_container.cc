@@ -4,6 +4,9 @@
 
 #include "ui/base/animation/animation_container.h"
 
+#include <algorithm>
+
+#include "base/message_loop.h"
 #include "ui/base/animation/animation_container_element.h"
 #include "ui/base/animation/animation_container_observer.h"
 
@@ -14,6 +17,7 @@ namespace ui {
 
 AnimationContainer::AnimationContainer()
     : last_tick_time_(TimeTicks::Now()),
+      suspended_(false),
       observer_(NULL) {
 }
 
@@ -28,10 +32,14 @@ void AnimationContainer::Start(AnimationContainerElement* element) {
                                           // element isn't running.
 
   if (elements_.empty()) {
-    last_tick_time_ = TimeTicks::Now();
-    SetMinTimerInterval(element->GetTimerInterval());
+    // Reads the clock at most once per task, however many containers it
+    // starts.
+    last_tick_time_ = MessageLoop::CachedNow();
+    min_timer_interval_ = element->GetTimerInterval();
+    if (!suspended_)
+      FrameClock::GetInstance()->AddObserver(this);
   } else if (element->GetTimerInterval() < min_timer_interval_) {
-    SetMinTimerInterval(element->GetTimerInterval());
+    min_timer_interval_ = element->GetTimerInterval();
   }
 
   element->SetStartTime(last_tick_time_);
@@ -44,25 +52,49 @@ void AnimationContainer::Stop(AnimationContainerElement* element) {
   elements_.erase(element);
 
   if (elements_.empty()) {
-    timer_.Stop();
+    if (!suspended_)
+      FrameClock::GetInstance()->RemoveObserver(this);
     if (observer_)
       observer_->AnimationContainerEmpty(this);
   } else {
-    TimeDelta min_timer_interval = GetMinInterval();
-    if (min_timer_interval > min_timer_interval_)
-      SetMinTimerInterval(min_timer_interval);
+    min_timer_interval_ = GetMinInterval();
+  }
+}
+
+void AnimationContainer::SetSuspended(bool suspended) {
+  if (suspended == suspended_)
+    return;
+  suspended_ = suspended;
+  if (elements_.empty())
+    return;
+
+  if (suspended_) {
+    FrameClock::GetInstance()->RemoveObserver(this);
+  } else {
+    FrameClock::GetInstance()->AddObserver(this);
+    Run(MessageLoop::CachedNow());
   }
 }
 
-void AnimationContainer::Run() {
+void AnimationContainer::OnFrame(base::TimeTicks frame_time) {
+  // The time of a frame is when its tick is handled, which may be a little
+  // before the time the last element was started at.
+  TimeTicks current_time = std::max(frame_time, last_tick_time_);
+
+  // The frames in between those closest to the timer interval are skipped.
+  TimeDelta half_frame = FrameClock::GetInstance()->frame_interval() / 2;
+  if (current_time - last_tick_time_ + half_frame < min_timer_interval_)
+    return;
+  Run(current_time);
+}
+
+void AnimationContainer::Run(base::TimeTicks current_time) {
   // We notify the observer after updating all the elements. If all the elements
   // are deleted as a result of updating then our ref count would go to zero and
   // we would be deleted before we notify our observer. We add a reference to
   // ourself here to make sure we're still valid after running all the elements.
   scoped_refptr<AnimationContainer> this_ref(this);
 
-  TimeTicks current_time = TimeTicks::Now();
-
   last_tick_time_ = current_time;
 
   // Make a copy of the elements to iterate over so that if any elements are
@@ -80,14 +112,6 @@ void AnimationContainer::Run() {
     observer_->AnimationContainerProgressed(this);
 }
 
-void AnimationContainer::SetMinTimerInterval(base::TimeDelta delta) {
-  // This doesn't take into account how far along the current element is, but
-  // that shouldn't be a problem for uses of Animation/AnimationContainer.
-  timer_.Stop();
-  min_timer_interval_ = delta;
-  timer_.Start(FROM_HERE, min_timer_interval_, this, &AnimationContainer::Run);
-}
-
 TimeDelta AnimationContainer::GetMinInterval() {
   DCHECK(!elements_.empty());
 
@@ -8,9 +8,10 @@
 
 #include <set>
 
+#include "base/compiler_specific.h"
 #include "base/memory/ref_counted.h"
 #include "base/time.h"
-#include "base/timer.h"
+#include "ui/base/animation/frame_clock.h"
 #include "ui/base/ui_export.h"
 
 namespace ui {
@@ -24,10 +25,16 @@ class AnimationContainerObserver;
 // Animation::SetContainer. Grouping a set of Animations into the same
 // AnimationContainer ensures they all update and start at the same time.
 //
+// The containers step their animations on the frames of the FrameClock, so
+// that all of the running animations are updated together, once per frame of
+// the display. A container whose animations ask for a longer timer interval
+// skips the frames in between.
+//
 // AnimationContainer is ref counted. Each Animation contained within the
 // AnimationContainer own it.
 class UI_EXPORT AnimationContainer
-    : public base::RefCounted<AnimationContainer> {
+    : public base::RefCounted<AnimationContainer>,
+      public FrameClock::Observer {
  public:
   AnimationContainer();
 
@@ -42,6 +49,14 @@ class UI_EXPORT AnimationContainer
   // directly.
   void Stop(AnimationContainerElement* animation);
 
+  // Suspends the animations, for a container whose animations can't be seen,
+  // so that they don't wake the UI thread. They aren't stepped until resumed,
+  // when they are stepped to the current time, as if they had run all along.
+  // Animations whose end something waits on mustn't be in a container that
+  // may be suspended.
+  void SetSuspended(bool suspended);
+  bool suspended() const { return suspended_; }
+
   void set_observer(AnimationContainerObserver* observer) {
     observer_ = observer;
   }
@@ -57,13 +72,13 @@ class UI_EXPORT AnimationContainer
 
   typedef std::set<AnimationContainerElement*> Elements;
 
-  ~AnimationContainer();
+  virtual ~AnimationContainer();
 
-  // Timer callback method.
-  void Run();
+  // FrameClock::Observer:
+  virtual void OnFrame(base::TimeTicks frame_time) OVERRIDE;
 
-  // Sets min_timer_interval_ and restarts the timer.
-  void SetMinTimerInterval(base::TimeDelta delta);
+  // Steps the elements to |current_time|.
+  void Run(base::TimeTicks current_time);
 
   // Returns the min timer interval of all the timers.
   base::TimeDelta GetMinInterval();
@@ -80,7 +95,8 @@ class UI_EXPORT AnimationContainer
   // Minimum interval the timers run at.
   base::TimeDelta min_timer_interval_;
 
-  base::RepeatingTimer<AnimationContainer> timer_;
+  // See SetSuspended().
+  bool suspended_;
 
   AnimationContainerObserver* observer_;
 
@@ -0,0 +1,300 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/base/animation/frame_clock.h"
+
+#if defined(OS_WIN)
+#include <windows.h>
+#include <dwmapi.h>
+#endif
+
+#include "base/logging.h"
+#include "base/memory/singleton.h"
+#include "base/metrics/histogram.h"
+
+#if defined(OS_WIN)
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/message_loop_proxy.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/thread.h"
+#include "base/win/windows_version.h"
+#endif
+
+namespace {
+
+// The refresh rate assumed when the display's isn't known.
+const int kDefaultFrameRate = 60;
+
+// The frames per tick on battery power.
+const int kBatteryFramesPerTick = 2;
+
+}  // namespace
+
+namespace ui {
+
+#if defined(OS_WIN)
+
+// FrameClock::VSyncWaiter -----------------------------------------------------
+
+// Waits for the frames of the DWM on a thread of its own, for as long as the
+// clock is active, and posts FrameClock::Tick() for them. A frame that comes
+// while the UI thread hasn't handled the tick of the last one is dropped, so
+// that a busy UI thread doesn't pile up ticks.
+class FrameClock::VSyncWaiter {
+ public:
+  explicit VSyncWaiter(FrameClock* clock);
+  ~VSyncWaiter();
+
+  // Returns false if the thread can't be started.
+  bool Start();
+
+  // Sets whether the frames are waited for.
+  void SetActive(bool active);
+
+  // Sets the frames waited for per tick.
+  void SetFramesPerTick(int frames_per_tick);
+
+  // Invoked by FrameClock::Tick(), on the UI thread.
+  void TickHandled();
+
+ private:
+  // Runs on |thread_| until the waiter is deleted.
+  void WaitForFrames();
+
+  FrameClock* clock_;
+  scoped_refptr<base::MessageLoopProxy> ui_loop_;
+  base::Thread thread_;
+
+  // Signaled while the clock is active.
+  base::WaitableEvent active_event_;
+
+  // Guards the members below it.
+  base::Lock lock_;
+  bool tick_pending_;
+  bool quit_;
+  int frames_per_tick_;
+
+  DISALLOW_COPY_AND_ASSIGN(VSyncWaiter);
+};
+
+FrameClock::VSyncWaiter::VSyncWaiter(FrameClock* clock)
+    : clock_(clock),
+      ui_loop_(base::MessageLoopProxy::current()),
+      thread_("FrameClock"),
+      active_event_(true, false),
+      tick_pending_(false),
+      quit_(false),
+      frames_per_tick_(1) {
+}
+
+FrameClock::VSyncWaiter::~VSyncWaiter() {
+  {
+    base::AutoLock lock(lock_);
+    quit_ = true;
+  }
+  active_event_.Signal();
+  thread_.Stop();
+}
+
+bool FrameClock::VSyncWaiter::Start() {
+  if (!thread_.Start())
+    return false;
+  thread_.message_loop_proxy()->PostTask(
+      FROM_HERE, base::Bind(&VSyncWaiter::WaitForFrames,
+                            base::Unretained(this)));
+  return true;
+}
+
+void FrameClock::VSyncWaiter::SetActive(bool active) {
+  if (active)
+    active_event_.Signal();
+  else
+    active_event_.Reset();
+}
+
+void FrameClock::VSyncWaiter::SetFramesPerTick(int frames_per_tick) {
+  base::AutoLock lock(lock_);
+  frames_per_tick_ = frames_per_tick;
+}
+
+void FrameClock::VSyncWaiter::TickHandled() {
+  base::AutoLock lock(lock_);
+  tick_pending_ = false;
+}
+
+void FrameClock::VSyncWaiter::WaitForFrames() {
+  while (true) {
+    active_event_.Wait();
+    int frames_per_tick;
+    {
+      base::AutoLock lock(lock_);
+      if (quit_)
+        return;
+      frames_per_tick = frames_per_tick_;
+    }
+
+    for (int i = 0; i < frames_per_tick; ++i) {
+      // Fails when desktop composition is turned off.
+      if (FAILED(DwmFlush())) {
+        ui_loop_->PostTask(FROM_HERE,
+                           base::Bind(&FrameClock::FallBackToTimer,
+                                      base::Unretained(clock_)));
+        return;
+      }
+    }
+
+    bool post_tick;
+    {
+      base::AutoLock lock(lock_);
+      post_tick = !tick_pending_;
+      tick_pending_ = true;
+    }
+    if (post_tick) {
+      ui_loop_->PostTask(FROM_HERE, base::Bind(&FrameClock::Tick,
+                                               base::Unretained(clock_)));
+    }
+  }
+}
+
+#endif  // defined(OS_WIN)
+
+// FrameClock ------------------------------------------------------------------
+
+// static
+FrameClock* FrameClock::GetInstance() {
+  return Singleton<FrameClock>::get();
+}
+
+void FrameClock::AddObserver(Observer* observer) {
+  DCHECK(!observers_.HasObserver(observer));
+  observers_.AddObserver(observer);
+  if (++observer_count_ == 1)
+    Start();
+}
+
+void FrameClock::RemoveObserver(Observer* observer) {
+  DCHECK(observers_.HasObserver(observer));
+  observers_.RemoveObserver(observer);
+  if (--observer_count_ == 0)
+    Stop();
+}
+
+FrameClock::FrameClock()
+    : observer_count_(0),
+      frame_interval_(base::TimeDelta::FromMicroseconds(
+          base::Time::kMicrosecondsPerSecond / kDefaultFrameRate)),
+      frames_per_tick_(1),
+      wakeup_count_(0) {
+  base::SystemMonitor* monitor = base::SystemMonitor::Get();
+  if (monitor) {
+    monitor->AddObserver(this);
+    if (monitor->BatteryPower())
+      frames_per_tick_ = kBatteryFramesPerTick;
+  }
+
+#if defined(OS_WIN)
+  // dwmapi.dll is delay loaded, and only there from Vista on.
+  BOOL composition_enabled = FALSE;
+  if (base::win::GetVersion() < base::win::VERSION_VISTA ||
+      FAILED(DwmIsCompositionEnabled(&composition_enabled)) ||
+      !composition_enabled) {
+    return;
+  }
+
+  DWM_TIMING_INFO timing_info = { sizeof(timing_info) };
+  if (SUCCEEDED(DwmGetCompositionTimingInfo(NULL, &timing_info)) &&
+      timing_info.rateRefresh.uiNumerator &&
+      timing_info.rateRefresh.uiDenominator) {
+    frame_interval_ = base::TimeDelta::FromMicroseconds(
+        base::Time::kMicrosecondsPerSecond *
+        timing_info.rateRefresh.uiDenominator /
+        timing_info.rateRefresh.uiNumerator);
+  }
+
+  vsync_waiter_.reset(new VSyncWaiter(this));
+  vsync_waiter_->SetFramesPerTick(frames_per_tick_);
+  if (!vsync_waiter_->Start())
+    vsync_waiter_.reset();
+#endif
+}
+
+FrameClock::~FrameClock() {
+  // The SystemMonitor is usually gone by the time the singletons are.
+  base::SystemMonitor* monitor = base::SystemMonitor::Get();
+  if (monitor)
+    monitor->RemoveObserver(this);
+}
+
+void FrameClock::OnPowerStateChange(bool on_battery_power) {
+  int frames_per_tick = on_battery_power ? kBatteryFramesPerTick : 1;
+  if (frames_per_tick == frames_per_tick_)
+    return;
+  frames_per_tick_ = frames_per_tick;
+#if defined(OS_WIN)
+  if (vsync_waiter_.get()) {
+    vsync_waiter_->SetFramesPerTick(frames_per_tick_);
+    return;
+  }
+#endif
+  // Restarts the timer at the new interval.
+  if (timer_.IsRunning()) {
+    timer_.Stop();
+    timer_.Start(FROM_HERE, frame_interval(), this, &FrameClock::Tick);
+  }
+}
+
+void FrameClock::Start() {
+  // The seconds the clock stops in aren't recorded.
+  wakeup_count_ = 0;
+  wakeup_count_start_ = base::TimeTicks::Now();
+
+#if defined(OS_WIN)
+  if (vsync_waiter_.get()) {
+    vsync_waiter_->SetActive(true);
+    return;
+  }
+#endif
+  timer_.Start(FROM_HERE, frame_interval(), this, &FrameClock::Tick);
+}
+
+void FrameClock::Stop() {
+#if defined(OS_WIN)
+  if (vsync_waiter_.get()) {
+    vsync_waiter_->SetActive(false);
+    return;
+  }
+#endif
+  timer_.Stop();
+}
+
+void FrameClock::Tick() {
+#if defined(OS_WIN)
+  if (vsync_waiter_.get())
+    vsync_waiter_->TickHandled();
+#endif
+  // Without observers, this is the tick of a frame waited for before the
+  // last one was removed.
+  if (observer_count_ == 0)
+    return;
+  base::TimeTicks frame_time = base::TimeTicks::Now();
+  ++wakeup_count_;
+  if (frame_time - wakeup_count_start_ >= base::TimeDelta::FromSeconds(1)) {
+    UMA_HISTOGRAM_COUNTS_100("Animation.WakeupsPerSecond", wakeup_count_);
+    wakeup_count_ = 0;
+    wakeup_count_start_ = frame_time;
+  }
+  FOR_EACH_OBSERVER(Observer, observers_, OnFrame(frame_time));
+}
+
+void FrameClock::FallBackToTimer() {
+#if defined(OS_WIN)
+  vsync_waiter_.reset();
+#endif
+  if (observer_count_)
+    Start();
+}
+
+}  // namespace ui
@@ -0,0 +1,105 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef UI_BASE_ANIMATION_FRAME_CLOCK_H_
+#define UI_BASE_ANIMATION_FRAME_CLOCK_H_
+#pragma once
+
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/observer_list.h"
+#include "base/system_monitor/system_monitor.h"
+#include "base/time.h"
+#include "base/timer.h"
+#include "build/build_config.h"
+#include "ui/base/ui_export.h"
+
+template <typename T> struct DefaultSingletonTraits;
+
+namespace ui {
+
+// FrameClock ticks once per frame of the display, on the UI thread, so that
+// the animations stepped on its ticks are all stepped together, in time with
+// the display, with a single wakeup. On Windows, with desktop composition,
+// the frames are those of the DWM, waited for with DwmFlush() on a thread of
+// the clock. Otherwise a timer at the refresh rate stands in for them.
+//
+// While the computer is on battery power, as the SystemMonitor tells, the
+// clock ticks every other frame, halving the wakeups of the animations.
+class UI_EXPORT FrameClock : public base::SystemMonitor::PowerObserver {
+ public:
+  class UI_EXPORT Observer {
+   public:
+    // Invoked for each frame, with the same |frame_time| for all of the
+    // observers.
+    virtual void OnFrame(base::TimeTicks frame_time) = 0;
+
+   protected:
+    virtual ~Observer() {}
+  };
+
+  // Returns the clock of the UI thread, which is the only one it is used on.
+  static FrameClock* GetInstance();
+
+  // The clock only ticks while it has observers.
+  void AddObserver(Observer* observer);
+  void RemoveObserver(Observer* observer);
+
+  // Returns the time between two ticks.
+  base::TimeDelta frame_interval() const {
+    return frame_interval_ * frames_per_tick_;
+  }
+
+  // base::SystemMonitor::PowerObserver:
+  virtual void OnPowerStateChange(bool on_battery_power) OVERRIDE;
+
+ private:
+  friend struct DefaultSingletonTraits<FrameClock>;
+
+#if defined(OS_WIN)
+  class VSyncWaiter;
+#endif
+
+  FrameClock();
+  virtual ~FrameClock();
+
+  // Starts the ticks, when the first observer is added, and stops them, when
+  // the last is removed.
+  void Start();
+  void Stop();
+
+  // Notifies the observers of a frame.
+  void Tick();
+
+  // Ticks with |timer_| from then on, when the frames can no longer be
+  // waited for.
+  void FallBackToTimer();
+
+  ObserverList<Observer> observers_;
+  size_t observer_count_;
+
+  // The time between two frames of the display, and the frames per tick.
+  base::TimeDelta frame_interval_;
+  int frames_per_tick_;
+
+  // The ticks, each of which wakes the UI thread, counted since
+  // |wakeup_count_start_|, for the wakeups per second recorded in UMA.
+  int wakeup_count_;
+  base::TimeTicks wakeup_count_start_;
+
+  // Ticks when there is no |vsync_waiter_|.
+  base::RepeatingTimer<FrameClock> timer_;
+
+#if defined(OS_WIN)
+  // Posts Tick() for the frames of the DWM.
+  scoped_ptr<VSyncWaiter> vsync_waiter_;
+#endif
+
+  DISALLOW_COPY_AND_ASSIGN(FrameClock);
+};
+
+}  // namespace ui
+
+#endif  // UI_BASE_ANIMATION_FRAME_CLOCK_H_
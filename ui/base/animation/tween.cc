@@ -17,37 +17,79 @@ namespace ui {
 
 // static
 double Tween::CalculateValue(Tween::Type type, double state) {
-  DCHECK_GE(state, 0);
-  DCHECK_LE(state, 1);
+  double value;
+  CalculateValues(type, &state, &value, 1);
+  return value;
+}
 
+// static
+void Tween::CalculateValues(Tween::Type type,
+                            const double* states,
+                            double* values,
+                            size_t count) {
+  // The curves are squares and cubes, which are multiplied out rather than
+  // given to pow(), a call into the CRT for each value.
   switch (type) {
     case EASE_IN:
-      return pow(state, 2);
+      for (size_t i = 0; i < count; ++i) {
+        DCHECK(states[i] >= 0 && states[i] <= 1);
+        values[i] = states[i] * states[i];
+      }
+      return;
 
     case EASE_IN_OUT:
-      if (state < 0.5)
-        return pow(state * 2, 2) / 2.0;
-      return 1.0 - (pow((state - 1.0) * 2, 2) / 2.0);
+      for (size_t i = 0; i < count; ++i) {
+        DCHECK(states[i] >= 0 && states[i] <= 1);
+        double state = states[i];
+        if (state < 0.5) {
+          values[i] = 2.0 * state * state;
+        } else {
+          double remaining = 1.0 - state;
+          values[i] = 1.0 - 2.0 * remaining * remaining;
+        }
+      }
+      return;
 
     case FAST_IN_OUT:
-      return (pow(state - 0.5, 3) + 0.125) / 0.25;
+      for (size_t i = 0; i < count; ++i) {
+        DCHECK(states[i] >= 0 && states[i] <= 1);
+        double offset = states[i] - 0.5;
+        values[i] = (offset * offset * offset + 0.125) * 4.0;
+      }
+      return;
 
     case LINEAR:
-      return state;
+      for (size_t i = 0; i < count; ++i) {
+        DCHECK(states[i] >= 0 && states[i] <= 1);
+        values[i] = states[i];
+      }
+      return;
 
     case EASE_OUT_SNAP:
-      state = 0.95 * (1.0 - pow(1.0 - state, 2));
-      break;
+      for (size_t i = 0; i < count; ++i) {
+        DCHECK(states[i] >= 0 && states[i] <= 1);
+        double remaining = 1.0 - states[i];
+        values[i] = 0.95 * (1.0 - remaining * remaining);
+      }
+      return;
 
     case EASE_OUT:
-      return 1.0 - pow(1.0 - state, 2);
+      for (size_t i = 0; i < count; ++i) {
+        DCHECK(states[i] >= 0 && states[i] <= 1);
+        double remaining = 1.0 - states[i];
+        values[i] = 1.0 - remaining * remaining;
+      }
+      return;
 
     case ZERO:
-      return 0;
+      for (size_t i = 0; i < count; ++i)
+        values[i] = 0;
+      return;
   }
 
   NOTREACHED();
-  return state;
+  for (size_t i = 0; i < count; ++i)
+    values[i] = states[i];
 }
 
 // static
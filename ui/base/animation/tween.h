@@ -30,6 +30,15 @@ class UI_EXPORT Tween {
   // Returns the value based on the tween type. |state| is from 0-1.
   static double CalculateValue(Type type, double state);
 
+  // Same as CalculateValue() for the |count| states of |states|, written to
+  // |values|, which may be |states|. The type is only switched on once, so
+  // this is the one to use when many animations with the same type step at
+  // once.
+  static void CalculateValues(Type type,
+                              const double* states,
+                              double* values,
+                              size_t count);
+
   // Conveniences for getting a value between a start and end point.
   static double ValueBetween(double value, double start, double target);
   static int ValueBetween(double value, int start, int target);
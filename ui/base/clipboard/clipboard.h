@@ -10,7 +10,9 @@
 #include <string>
 #include <vector>
 
+#include "base/callback.h"
 #include "base/gtest_prod_util.h"
+#include "base/memory/ref_counted.h"
 #include "base/process.h"
 #include "base/shared_memory.h"
 #include "base/string16.h"
@@ -233,12 +235,36 @@ class UI_EXPORT Clipboard {
                  const char* data_data, size_t data_len);
 #endif
 #if defined(OS_WIN)
+  // A format offered with delayed rendering. It keeps a copy of the data that
+  // was written, and converts it to the clipboard's representation only when
+  // some application asks for that format.
+  class DeferredFormat;
+  typedef std::map<unsigned int, scoped_refptr<DeferredFormat> >
+      DeferredFormatMap;
+
   void WriteBitmapFromHandle(HBITMAP source_hbitmap,
                              const gfx::Size& size);
 
   // Safely write to system clipboard. Free |handle| on failure.
   void WriteToClipboard(unsigned int format, HANDLE handle);
 
+  // Puts |format| on the clipboard with a NULL handle, to be rendered by
+  // |render| when the owner window receives WM_RENDERFORMAT. |render| runs on
+  // a worker thread as soon as possible if |data_size| is large.
+  void WriteDeferred(unsigned int format,
+                     size_t data_size,
+                     const base::Callback<HANDLE(void)>& render);
+
+  // Handle the clipboard messages that the owner window receives for the
+  // formats in |deferred_formats_|.
+  void RenderFormat(unsigned int format);
+  void RenderAllFormats();
+
+  static LRESULT CALLBACK ClipboardOwnerWndProc(HWND hwnd,
+                                                UINT message,
+                                                WPARAM wparam,
+                                                LPARAM lparam);
+
   static void ParseBookmarkClipboardFormat(const string16& bookmark,
                                            string16* title,
                                            std::string* url);
@@ -255,6 +281,10 @@ class UI_EXPORT Clipboard {
 
   // True if we can create a window.
   bool create_window_;
+
+  // The formats that were written with delayed rendering and are not rendered
+  // yet. Emptied when another owner takes the clipboard.
+  DeferredFormatMap deferred_formats_;
 #elif defined(TOOLKIT_USES_GTK)
   // The public API is via WriteObjects() which dispatches to multiple
   // Write*() calls, but on GTK we must write all the clipboard types
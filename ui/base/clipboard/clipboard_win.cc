@@ -10,13 +10,19 @@
 #include <shlobj.h>
 #include <shellapi.h>
 
+#include "base/bind.h"
+#include "base/callback.h"
 #include "base/file_path.h"
+#include "base/location.h"
 #include "base/logging.h"
 #include "base/message_loop.h"
 #include "base/shared_memory.h"
 #include "base/stl_util.h"
 #include "base/string_util.h"
 #include "base/string_number_conversions.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/worker_pool.h"
 #include "base/utf_string_conversions.h"
 #include "base/win/scoped_gdi_object.h"
 #include "base/win/scoped_hdc.h"
@@ -90,36 +96,9 @@ class ScopedClipboard {
   bool opened_;
 };
 
-LRESULT CALLBACK ClipboardOwnerWndProc(HWND hwnd,
-                                       UINT message,
-                                       WPARAM wparam,
-                                       LPARAM lparam) {
-  LRESULT lresult = 0;
-
-  switch (message) {
-  case WM_RENDERFORMAT:
-    // This message comes when SetClipboardData was sent a null data handle
-    // and now it's come time to put the data on the clipboard.
-    // We always set data, so there isn't a need to actually do anything here.
-    break;
-  case WM_RENDERALLFORMATS:
-    // This message comes when SetClipboardData was sent a null data handle
-    // and now this application is about to quit, so it must put data on
-    // the clipboard before it exits.
-    // We always set data, so there isn't a need to actually do anything here.
-    break;
-  case WM_DRAWCLIPBOARD:
-    break;
-  case WM_DESTROY:
-    break;
-  case WM_CHANGECBCHAIN:
-    break;
-  default:
-    lresult = DefWindowProc(hwnd, message, wparam, lparam);
-    break;
-  }
-  return lresult;
-}
+// Formats whose data is at least this large start rendering on a worker
+// thread as soon as they are written, rather than when they are pasted.
+const size_t kMinBackgroundRenderSize = 256 * 1024;
 
 template <typename charT>
 HGLOBAL CreateGlobalData(const std::basic_string<charT>& str) {
@@ -155,8 +134,220 @@ void MakeBitmapOpaque(const SkBitmap& bitmap) {
   }
 }
 
+HANDLE RenderText(const std::string& utf8_text) {
+  string16 text;
+  UTF8ToUTF16(utf8_text.data(), utf8_text.size(), &text);
+  return CreateGlobalData(text);
+}
+
+HANDLE RenderHTML(const std::string& markup, const std::string& url) {
+  return CreateGlobalData(ClipboardUtil::HtmlToCFHtml(markup, url));
+}
+
+// Returns a bitmap that can be put on the clipboard, with |source_hbitmap|
+// blended into it, or NULL.
+HBITMAP CreateClipboardBitmap(HBITMAP source_hbitmap, const gfx::Size& size) {
+  // We would like to just call ::SetClipboardData on the source_hbitmap,
+  // but that bitmap might not be of a sort we can write to the clipboard.
+  // For this reason, we create a new bitmap, copy the bits over, and then
+  // write that to the clipboard.
+
+  HDC dc = ::GetDC(NULL);
+  HDC compatible_dc = ::CreateCompatibleDC(NULL);
+  HDC source_dc = ::CreateCompatibleDC(NULL);
+
+  // This is the HBITMAP we will eventually write to the clipboard
+  HBITMAP hbitmap = ::CreateCompatibleBitmap(dc, size.width(), size.height());
+  if (!hbitmap) {
+    // Failed to create the bitmap
+    ::DeleteDC(compatible_dc);
+    ::DeleteDC(source_dc);
+    ::ReleaseDC(NULL, dc);
+    return NULL;
+  }
+
+  HBITMAP old_hbitmap = (HBITMAP)SelectObject(compatible_dc, hbitmap);
+  HBITMAP old_source = (HBITMAP)SelectObject(source_dc, source_hbitmap);
+
+  // Now we need to blend it into an HBITMAP we can place on the clipboard
+  BLENDFUNCTION bf = {AC_SRC_OVER, 0, 255, AC_SRC_ALPHA};
+  ::GdiAlphaBlend(compatible_dc, 0, 0, size.width(), size.height(),
+                  source_dc, 0, 0, size.width(), size.height(), bf);
+
+  // Clean up all the handles we just opened
+  ::SelectObject(compatible_dc, old_hbitmap);
+  ::SelectObject(source_dc, old_source);
+  ::DeleteObject(old_hbitmap);
+  ::DeleteObject(old_source);
+  ::DeleteDC(compatible_dc);
+  ::DeleteDC(source_dc);
+  ::ReleaseDC(NULL, dc);
+
+  return hbitmap;
+}
+
+HANDLE RenderBitmap(const std::vector<char>& pixels, const gfx::Size& size) {
+  HDC dc = ::GetDC(NULL);
+
+  // TODO(darin): share data in gfx/bitmap_header.cc somehow
+  BITMAPINFO bm_info = {0};
+  bm_info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+  bm_info.bmiHeader.biWidth = size.width();
+  bm_info.bmiHeader.biHeight = -size.height();  // sets vertical orientation
+  bm_info.bmiHeader.biPlanes = 1;
+  bm_info.bmiHeader.biBitCount = 32;
+  bm_info.bmiHeader.biCompression = BI_RGB;
+
+  // ::CreateDIBSection allocates memory for us to copy our bitmap into.
+  // Unfortunately, we can't write the created bitmap to the clipboard,
+  // (see http://msdn2.microsoft.com/en-us/library/ms532292.aspx)
+  void *bits;
+  HBITMAP source_hbitmap =
+      ::CreateDIBSection(dc, &bm_info, DIB_RGB_COLORS, &bits, NULL, 0);
+
+  HBITMAP hbitmap = NULL;
+  if (bits && source_hbitmap && !pixels.empty()) {
+    memcpy(bits, &pixels[0], pixels.size());
+    hbitmap = CreateClipboardBitmap(source_hbitmap, size);
+  }
+
+  ::DeleteObject(source_hbitmap);
+  ::ReleaseDC(NULL, dc);
+  return hbitmap;
+}
+
 }  // namespace
 
+// Whoever first asks for the handle renders it: either a worker, started by
+// StartRenderingInBackground(), or TakeHandle() on the thread that owns the
+// clipboard, which waits if a worker is already rendering.
+class Clipboard::DeferredFormat
+    : public base::RefCountedThreadSafe<Clipboard::DeferredFormat> {
+ public:
+  DeferredFormat(unsigned int format,
+                 const base::Callback<HANDLE(void)>& render)
+      : format_(format),
+        render_(render),
+        state_(NOT_RENDERED),
+        rendered_(true, false),
+        handle_(NULL) {
+  }
+
+  void StartRenderingInBackground() {
+    base::WorkerPool::PostTask(
+        FROM_HERE,
+        base::Bind(&DeferredFormat::RenderInBackground, this),
+        false);
+  }
+
+  // Returns the rendered handle, which the caller owns. Called once.
+  HANDLE TakeHandle() {
+    bool render_here = false;
+    {
+      base::AutoLock lock(lock_);
+      if (state_ == NOT_RENDERED) {
+        state_ = RENDERING;
+        render_here = true;
+      }
+    }
+    if (render_here)
+      Render();
+    else
+      rendered_.Wait();
+
+    base::AutoLock lock(lock_);
+    HANDLE handle = handle_;
+    handle_ = NULL;
+    return handle;
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<DeferredFormat>;
+
+  enum State {
+    NOT_RENDERED,
+    RENDERING,
+    RENDERED,
+  };
+
+  ~DeferredFormat() {
+    if (handle_)
+      FreeData(format_, handle_);
+  }
+
+  void RenderInBackground() {
+    {
+      base::AutoLock lock(lock_);
+      if (state_ != NOT_RENDERED)
+        return;
+      state_ = RENDERING;
+    }
+    Render();
+  }
+
+  // Called without |lock_| by whoever set |state_| to RENDERING.
+  void Render() {
+    HANDLE handle = render_.Run();
+    base::AutoLock lock(lock_);
+    // The data isn't needed anymore, and may be large.
+    render_.Reset();
+    handle_ = handle;
+    state_ = RENDERED;
+    rendered_.Signal();
+  }
+
+  const unsigned int format_;
+  base::Callback<HANDLE(void)> render_;
+
+  base::Lock lock_;
+  State state_;
+  base::WaitableEvent rendered_;
+  HANDLE handle_;
+
+  DISALLOW_COPY_AND_ASSIGN(DeferredFormat);
+};
+
+// static
+LRESULT CALLBACK Clipboard::ClipboardOwnerWndProc(HWND hwnd,
+                                                  UINT message,
+                                                  WPARAM wparam,
+                                                  LPARAM lparam) {
+  Clipboard* clipboard = reinterpret_cast<Clipboard*>(
+      ::GetWindowLongPtr(hwnd, GWLP_USERDATA));
+  LRESULT lresult = 0;
+
+  switch (message) {
+  case WM_RENDERFORMAT:
+    // This message comes when SetClipboardData was sent a null data handle
+    // and now it's come time to put the data on the clipboard.
+    if (clipboard)
+      clipboard->RenderFormat(static_cast<unsigned int>(wparam));
+    break;
+  case WM_RENDERALLFORMATS:
+    // This message comes when SetClipboardData was sent a null data handle
+    // and now this application is about to quit, so it must put data on
+    // the clipboard before it exits.
+    if (clipboard)
+      clipboard->RenderAllFormats();
+    break;
+  case WM_DESTROYCLIPBOARD:
+    // Someone emptied the clipboard, so the formats we offered are gone.
+    if (clipboard)
+      clipboard->deferred_formats_.clear();
+    break;
+  case WM_DRAWCLIPBOARD:
+    break;
+  case WM_DESTROY:
+    break;
+  case WM_CHANGECBCHAIN:
+    break;
+  default:
+    lresult = DefWindowProc(hwnd, message, wparam, lparam);
+    break;
+  }
+  return lresult;
+}
+
 Clipboard::Clipboard() : create_window_(false) {
   if (MessageLoop::current()->type() == MessageLoop::TYPE_UI) {
     // Make a dummy HWND to be the clipboard's owner.
@@ -173,6 +364,8 @@ Clipboard::Clipboard() : create_window_(false) {
 }
 
 Clipboard::~Clipboard() {
+  // If we still own formats that weren't rendered, destroying the window sends
+  // it WM_RENDERALLFORMATS, so that they outlive us.
   if (clipboard_owner_)
     ::DestroyWindow(clipboard_owner_);
   clipboard_owner_ = NULL;
@@ -189,6 +382,7 @@ void Clipboard::WriteObjects(const ObjectMap& objects,
     return;
 
   ::EmptyClipboard();
+  deferred_formats_.clear();
 
   for (ObjectMap::const_iterator iter = objects.begin();
        iter != objects.end(); ++iter) {
@@ -197,11 +391,8 @@ void Clipboard::WriteObjects(const ObjectMap& objects,
 }
 
 void Clipboard::WriteText(const char* text_data, size_t text_len) {
-  string16 text;
-  UTF8ToUTF16(text_data, text_len, &text);
-  HGLOBAL glob = CreateGlobalData(text);
-
-  WriteToClipboard(CF_UNICODETEXT, glob);
+  WriteDeferred(CF_UNICODETEXT, text_len,
+                base::Bind(&RenderText, std::string(text_data, text_len)));
 }
 
 void Clipboard::WriteHTML(const char* markup_data,
@@ -214,10 +405,9 @@ void Clipboard::WriteHTML(const char* markup_data,
   if (url_len > 0)
     url.assign(url_data, url_len);
 
-  std::string html_fragment = ClipboardUtil::HtmlToCFHtml(markup, url);
-  HGLOBAL glob = CreateGlobalData(html_fragment);
-
-  WriteToClipboard(ClipboardUtil::GetHtmlFormat()->cfFormat, glob);
+  WriteDeferred(ClipboardUtil::GetHtmlFormat()->cfFormat,
+                markup_len + url_len,
+                base::Bind(&RenderHTML, markup, url));
 }
 
 void Clipboard::WriteBookmark(const char* title_data,
@@ -242,79 +432,19 @@ void Clipboard::WriteWebSmartPaste() {
 
 void Clipboard::WriteBitmap(const char* pixel_data, const char* size_data) {
   const gfx::Size* size = reinterpret_cast<const gfx::Size*>(size_data);
-  HDC dc = ::GetDC(NULL);
 
-  // This doesn't actually cost us a memcpy when the bitmap comes from the
-  // renderer as we load it into the bitmap using setPixels which just sets a
-  // pointer.  Someone has to memcpy it into GDI, it might as well be us here.
-
-  // TODO(darin): share data in gfx/bitmap_header.cc somehow
-  BITMAPINFO bm_info = {0};
-  bm_info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-  bm_info.bmiHeader.biWidth = size->width();
-  bm_info.bmiHeader.biHeight = -size->height();  // sets vertical orientation
-  bm_info.bmiHeader.biPlanes = 1;
-  bm_info.bmiHeader.biBitCount = 32;
-  bm_info.bmiHeader.biCompression = BI_RGB;
-
-  // ::CreateDIBSection allocates memory for us to copy our bitmap into.
-  // Unfortunately, we can't write the created bitmap to the clipboard,
-  // (see http://msdn2.microsoft.com/en-us/library/ms532292.aspx)
-  void *bits;
-  HBITMAP source_hbitmap =
-      ::CreateDIBSection(dc, &bm_info, DIB_RGB_COLORS, &bits, NULL, 0);
-
-  if (bits && source_hbitmap) {
-    // Copy the bitmap out of shared memory and into GDI
-    memcpy(bits, pixel_data, 4 * size->width() * size->height());
-
-    // Now we have an HBITMAP, we can write it to the clipboard
-    WriteBitmapFromHandle(source_hbitmap, *size);
-  }
-
-  ::DeleteObject(source_hbitmap);
-  ::ReleaseDC(NULL, dc);
+  // The pixels may be in shared memory that is unmapped once we return, so
+  // they are copied until the bitmap is rendered. Someone has to memcpy them,
+  // it might as well be us here.
+  std::vector<char> pixels(pixel_data,
+                           pixel_data + 4 * size->width() * size->height());
+  WriteDeferred(CF_BITMAP, pixels.size(),
+                base::Bind(&RenderBitmap, pixels, *size));
 }
 
 void Clipboard::WriteBitmapFromHandle(HBITMAP source_hbitmap,
                                       const gfx::Size& size) {
-  // We would like to just call ::SetClipboardData on the source_hbitmap,
-  // but that bitmap might not be of a sort we can write to the clipboard.
-  // For this reason, we create a new bitmap, copy the bits over, and then
-  // write that to the clipboard.
-
-  HDC dc = ::GetDC(NULL);
-  HDC compatible_dc = ::CreateCompatibleDC(NULL);
-  HDC source_dc = ::CreateCompatibleDC(NULL);
-
-  // This is the HBITMAP we will eventually write to the clipboard
-  HBITMAP hbitmap = ::CreateCompatibleBitmap(dc, size.width(), size.height());
-  if (!hbitmap) {
-    // Failed to create the bitmap
-    ::DeleteDC(compatible_dc);
-    ::DeleteDC(source_dc);
-    ::ReleaseDC(NULL, dc);
-    return;
-  }
-
-  HBITMAP old_hbitmap = (HBITMAP)SelectObject(compatible_dc, hbitmap);
-  HBITMAP old_source = (HBITMAP)SelectObject(source_dc, source_hbitmap);
-
-  // Now we need to blend it into an HBITMAP we can place on the clipboard
-  BLENDFUNCTION bf = {AC_SRC_OVER, 0, 255, AC_SRC_ALPHA};
-  ::GdiAlphaBlend(compatible_dc, 0, 0, size.width(), size.height(),
-                  source_dc, 0, 0, size.width(), size.height(), bf);
-
-  // Clean up all the handles we just opened
-  ::SelectObject(compatible_dc, old_hbitmap);
-  ::SelectObject(source_dc, old_source);
-  ::DeleteObject(old_hbitmap);
-  ::DeleteObject(old_source);
-  ::DeleteDC(compatible_dc);
-  ::DeleteDC(source_dc);
-  ::ReleaseDC(NULL, dc);
-
-  WriteToClipboard(CF_BITMAP, hbitmap);
+  WriteToClipboard(CF_BITMAP, CreateClipboardBitmap(source_hbitmap, size));
 }
 
 void Clipboard::WriteData(const char* format_name, size_t format_len,
@@ -341,6 +471,45 @@ void Clipboard::WriteToClipboard(unsigned int format, HANDLE handle) {
   }
 }
 
+void Clipboard::WriteDeferred(unsigned int format,
+                              size_t data_size,
+                              const base::Callback<HANDLE(void)>& render) {
+  DCHECK(clipboard_owner_);
+  scoped_refptr<DeferredFormat> deferred(new DeferredFormat(format, render));
+  ::SetClipboardData(format, NULL);
+  deferred_formats_[format] = deferred;
+
+  if (data_size >= kMinBackgroundRenderSize)
+    deferred->StartRenderingInBackground();
+}
+
+void Clipboard::RenderFormat(unsigned int format) {
+  DeferredFormatMap::iterator it = deferred_formats_.find(format);
+  if (it == deferred_formats_.end())
+    return;
+  scoped_refptr<DeferredFormat> deferred(it->second.Pass());
+  deferred_formats_.erase(it);
+
+  // The application that asked for |format| has the clipboard open.
+  WriteToClipboard(format, deferred->TakeHandle());
+}
+
+void Clipboard::RenderAllFormats() {
+  if (deferred_formats_.empty())
+    return;
+
+  ScopedClipboard clipboard;
+  if (!clipboard.Acquire(clipboard_owner_))
+    return;
+
+  // Another owner may have emptied the clipboard after we wrote it.
+  if (::GetClipboardOwner() == clipboard_owner_) {
+    while (!deferred_formats_.empty())
+      RenderFormat(deferred_formats_.begin()->first);
+  }
+  deferred_formats_.clear();
+}
+
 bool Clipboard::IsFormatAvailable(const Clipboard::FormatType& format,
                                   Clipboard::Buffer buffer) const {
   DCHECK_EQ(buffer, BUFFER_STANDARD);
@@ -717,6 +886,11 @@ HWND Clipboard::GetClipboardWindow() const {
                                       0, 0, 0, 0, 0,
                                       HWND_MESSAGE,
                                       0, 0, 0);
+    if (clipboard_owner_) {
+      // For the window procedure, which renders our deferred formats.
+      ::SetWindowLongPtr(clipboard_owner_, GWLP_USERDATA,
+                         reinterpret_cast<LONG_PTR>(this));
+    }
   }
   return clipboard_owner_;
 }
@@ -127,6 +127,11 @@ void OSExchangeData::SetFileContents(const FilePath& filename,
   provider_->SetFileContents(filename, file_contents);
 }
 
+void OSExchangeData::SetFileContentsSource(const FilePath& filename,
+                                           FileContentsSource* source) {
+  provider_->SetFileContentsSource(filename, source);
+}
+
 // void OSExchangeData::SetHtml(const string16& html, const GURL& base_url) {
 //   provider_->SetHtml(html, base_url);
 // }
@@ -19,6 +19,7 @@
 
 #include "base/basictypes.h"
 #include "base/file_path.h"
+#include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
 #include "ui/base/dragdrop/download_file_interface.h"
 #include "ui/base/ui_export.h"
@@ -76,6 +77,27 @@ class UI_EXPORT OSExchangeData {
     scoped_refptr<DownloadFileProvider> downloader;
   };
 
+#if defined(OS_WIN)
+  // Produces the bytes of a dragged file while the drop target reads them, so
+  // that they needn't all be in memory when the drag starts. The drop target
+  // may read on a thread of its own, and more than once.
+  class UI_EXPORT FileContentsSource
+      : public base::RefCountedThreadSafe<FileContentsSource> {
+   public:
+    // Returns the size of the contents in bytes, or -1 if it isn't known.
+    virtual int64 GetSize() = 0;
+
+    // Copies up to |size| bytes of the contents, starting at |offset|, into
+    // |buffer|. Returns the number of bytes copied, which is 0 at the end of
+    // the contents, or -1 on failure.
+    virtual int Read(int64 offset, char* buffer, int size) = 0;
+
+   protected:
+    friend class base::RefCountedThreadSafe<FileContentsSource>;
+    virtual ~FileContentsSource() {}
+  };
+#endif
+
   // Provider defines the platform specific part of OSExchangeData that
   // interacts with the native system.
   class UI_EXPORT Provider {
@@ -103,6 +125,8 @@ class UI_EXPORT OSExchangeData {
     virtual void SetFileContents(const FilePath& filename,
                                  const std::string& file_contents) = 0;
     // virtual void SetHtml(const string16& html, const GURL& base_url) = 0;
+    virtual void SetFileContentsSource(const FilePath& filename,
+                                       FileContentsSource* source) = 0;
     virtual bool GetFileContents(FilePath* filename,
                                  std::string* file_contents) const = 0;
     // virtual bool GetHtml(string16* html, GURL* base_url) const = 0;
@@ -175,6 +199,10 @@ class UI_EXPORT OSExchangeData {
   // Adds the bytes of a file (CFSTR_FILECONTENTS and CFSTR_FILEDESCRIPTOR).
   void SetFileContents(const FilePath& filename,
                        const std::string& file_contents);
+  // As above, but the bytes are read from |source| when the drop target asks
+  // for them. Drop targets that take an IStream read them as they go.
+  void SetFileContentsSource(const FilePath& filename,
+                             FileContentsSource* source);
   // Adds a snippet of HTML.  |html| is just raw html but this sets both
   // text/html and CF_HTML.
   // void SetHtml(const string16& html, const GURL& base_url);
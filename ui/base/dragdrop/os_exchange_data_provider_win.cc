@@ -40,6 +40,12 @@ static STGMEDIUM* GetStorageForFileName(const FilePath& path);
 // Creates a File Descriptor for the creation of a file to the given URL and
 // returns a handle to it.
 static STGMEDIUM* GetStorageForFileDescriptor(const FilePath& path);
+// Fills |medium| with the contents of |source|, as a stream that reads them
+// on demand if |tymed| allows, else as a copy of all of them.
+static HRESULT GetStorageForFileContentsSource(
+    OSExchangeData::FileContentsSource* source,
+    DWORD tymed,
+    STGMEDIUM* medium);
 
 ///////////////////////////////////////////////////////////////////////////////
 // FormatEtcEnumerator
@@ -206,6 +212,204 @@ FormatEtcEnumerator* FormatEtcEnumerator::CloneFromOther(
   return e;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// FileContentsStream
+
+//
+// A read-only IStream over an OSExchangeData::FileContentsSource, which is
+// handed to drop targets that ask for CFSTR_FILECONTENTS as TYMED_ISTREAM.
+// Each stream has its own position, so every GetData() gets a new one.
+//
+class FileContentsStream : public IStream {
+ public:
+  explicit FileContentsStream(OSExchangeData::FileContentsSource* source);
+  ~FileContentsStream();
+
+  // ISequentialStream implementation:
+  HRESULT __stdcall Read(void* buffer, ULONG size, ULONG* bytes_read);
+  HRESULT __stdcall Write(const void* buffer, ULONG size, ULONG* bytes_written);
+
+  // IStream implementation:
+  HRESULT __stdcall Seek(LARGE_INTEGER move, DWORD origin,
+                         ULARGE_INTEGER* new_position);
+  HRESULT __stdcall SetSize(ULARGE_INTEGER new_size);
+  HRESULT __stdcall CopyTo(IStream* stream, ULARGE_INTEGER size,
+                           ULARGE_INTEGER* bytes_read,
+                           ULARGE_INTEGER* bytes_written);
+  HRESULT __stdcall Commit(DWORD flags);
+  HRESULT __stdcall Revert();
+  HRESULT __stdcall LockRegion(ULARGE_INTEGER offset, ULARGE_INTEGER size,
+                               DWORD lock_type);
+  HRESULT __stdcall UnlockRegion(ULARGE_INTEGER offset, ULARGE_INTEGER size,
+                                 DWORD lock_type);
+  HRESULT __stdcall Stat(STATSTG* stat, DWORD flags);
+  HRESULT __stdcall Clone(IStream** clone);
+
+  // IUnknown implementation:
+  HRESULT __stdcall QueryInterface(const IID& iid, void** object);
+  ULONG __stdcall AddRef();
+  ULONG __stdcall Release();
+
+ private:
+  scoped_refptr<OSExchangeData::FileContentsSource> source_;
+
+  // The offset of the next Read().
+  int64 position_;
+
+  LONG ref_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(FileContentsStream);
+};
+
+FileContentsStream::FileContentsStream(
+    OSExchangeData::FileContentsSource* source)
+    : source_(source),
+      position_(0),
+      ref_count_(0) {
+}
+
+FileContentsStream::~FileContentsStream() {
+}
+
+STDMETHODIMP FileContentsStream::Read(void* buffer,
+                                      ULONG size,
+                                      ULONG* bytes_read) {
+  // Fill the whole buffer unless the contents end, since a short read means
+  // the end to ISequentialStream callers.
+  ULONG total = 0;
+  while (total < size) {
+    int read = source_->Read(position_, static_cast<char*>(buffer) + total,
+                             static_cast<int>(std::min<ULONG>(size - total,
+                                                              kint32max)));
+    if (read < 0) {
+      if (bytes_read)
+        *bytes_read = total;
+      return STG_E_READFAULT;
+    }
+    if (read == 0)
+      break;
+    position_ += read;
+    total += read;
+  }
+  if (bytes_read)
+    *bytes_read = total;
+  return total == size ? S_OK : S_FALSE;
+}
+
+STDMETHODIMP FileContentsStream::Write(const void* buffer,
+                                       ULONG size,
+                                       ULONG* bytes_written) {
+  return STG_E_ACCESSDENIED;
+}
+
+STDMETHODIMP FileContentsStream::Seek(LARGE_INTEGER move,
+                                      DWORD origin,
+                                      ULARGE_INTEGER* new_position) {
+  int64 base;
+  switch (origin) {
+    case STREAM_SEEK_SET:
+      base = 0;
+      break;
+    case STREAM_SEEK_CUR:
+      base = position_;
+      break;
+    case STREAM_SEEK_END:
+      base = source_->GetSize();
+      if (base < 0)
+        return STG_E_INVALIDFUNCTION;
+      break;
+    default:
+      return STG_E_INVALIDFUNCTION;
+  }
+  if (base + move.QuadPart < 0)
+    return STG_E_INVALIDFUNCTION;
+
+  position_ = base + move.QuadPart;
+  if (new_position)
+    new_position->QuadPart = position_;
+  return S_OK;
+}
+
+STDMETHODIMP FileContentsStream::SetSize(ULARGE_INTEGER new_size) {
+  return STG_E_ACCESSDENIED;
+}
+
+STDMETHODIMP FileContentsStream::CopyTo(IStream* stream,
+                                        ULARGE_INTEGER size,
+                                        ULARGE_INTEGER* bytes_read,
+                                        ULARGE_INTEGER* bytes_written) {
+  return E_NOTIMPL;
+}
+
+STDMETHODIMP FileContentsStream::Commit(DWORD flags) {
+  return S_OK;
+}
+
+STDMETHODIMP FileContentsStream::Revert() {
+  return S_OK;
+}
+
+STDMETHODIMP FileContentsStream::LockRegion(ULARGE_INTEGER offset,
+                                            ULARGE_INTEGER size,
+                                            DWORD lock_type) {
+  return STG_E_INVALIDFUNCTION;
+}
+
+STDMETHODIMP FileContentsStream::UnlockRegion(ULARGE_INTEGER offset,
+                                              ULARGE_INTEGER size,
+                                              DWORD lock_type) {
+  return STG_E_INVALIDFUNCTION;
+}
+
+STDMETHODIMP FileContentsStream::Stat(STATSTG* stat, DWORD flags) {
+  if (!stat)
+    return STG_E_INVALIDPOINTER;
+
+  memset(stat, 0, sizeof(STATSTG));
+  stat->type = STGTY_STREAM;
+  stat->grfMode = STGM_READ;
+  // The stream has no name: the file's is in CFSTR_FILEDESCRIPTOR.
+  int64 size = source_->GetSize();
+  if (size >= 0)
+    stat->cbSize.QuadPart = size;
+  return S_OK;
+}
+
+STDMETHODIMP FileContentsStream::Clone(IStream** clone) {
+  FileContentsStream* stream = new FileContentsStream(source_);
+  stream->position_ = position_;
+  stream->AddRef();
+  *clone = stream;
+  return S_OK;
+}
+
+STDMETHODIMP FileContentsStream::QueryInterface(const IID& iid,
+                                                void** object) {
+  *object = NULL;
+  if (IsEqualIID(iid, IID_IUnknown) ||
+      IsEqualIID(iid, IID_ISequentialStream) ||
+      IsEqualIID(iid, IID_IStream)) {
+    *object = this;
+  } else {
+    return E_NOINTERFACE;
+  }
+  AddRef();
+  return S_OK;
+}
+
+ULONG FileContentsStream::AddRef() {
+  return InterlockedIncrement(&ref_count_);
+}
+
+ULONG FileContentsStream::Release() {
+  if (InterlockedDecrement(&ref_count_) == 0) {
+    ULONG copied_refcnt = ref_count_;
+    delete this;
+    return copied_refcnt;
+  }
+  return ref_count_;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // OSExchangeDataProviderWin, public:
 
@@ -350,6 +554,32 @@ void OSExchangeDataProviderWin::SetFileContents(
       ClipboardUtil::GetFileContentFormatZero(), storage));
 }
 
+void OSExchangeDataProviderWin::SetFileContentsSource(
+    const FilePath& filename,
+    OSExchangeData::FileContentsSource* source) {
+  // Add CFSTR_FILEDESCRIPTOR, with the size if it is known, which lets the
+  // Shell show progress as it copies.
+  STGMEDIUM* storage = GetStorageForFileDescriptor(filename);
+  int64 size = source->GetSize();
+  if (size >= 0) {
+    base::win::ScopedHGlobal<FILEGROUPDESCRIPTOR> descriptor(storage->hGlobal);
+    descriptor->fgd[0].dwFlags |= FD_FILESIZE;
+    descriptor->fgd[0].nFileSizeLow = static_cast<DWORD>(size);
+    descriptor->fgd[0].nFileSizeHigh = static_cast<DWORD>(size >> 32);
+  }
+  data_->contents_.push_back(new DataObjectImpl::StoredDataInfo(
+      ClipboardUtil::GetFileDescriptorFormat()->cfFormat, storage));
+
+  // Add CFSTR_FILECONTENTS, which is read from |source| by GetData().
+  FORMATETC format_etc = *ClipboardUtil::GetFileContentFormatZero();
+  format_etc.tymed = TYMED_ISTREAM | TYMED_HGLOBAL;
+  DataObjectImpl::StoredDataInfo* info =
+      new DataObjectImpl::StoredDataInfo(&format_etc, NULL);
+  info->owns_medium = false;
+  info->contents_source = source;
+  data_->contents_.push_back(info);
+}
+
 // void OSExchangeDataProviderWin::SetHtml(const string16& html,
 //                                         const GURL& base_url) {
 //   // Add both MS CF_HTML and text/html format.  CF_HTML should be in utf-8.
@@ -627,6 +857,10 @@ HRESULT DataObjectImpl::GetData(FORMATETC* format_etc, STGMEDIUM* medium) {
     if ((*iter)->format_etc.cfFormat == format_etc->cfFormat &&
         (*iter)->format_etc.lindex == format_etc->lindex &&
         ((*iter)->format_etc.tymed & format_etc->tymed)) {
+      if ((*iter)->contents_source.get()) {
+        return GetStorageForFileContentsSource((*iter)->contents_source,
+                                               format_etc->tymed, medium);
+      }
       // If medium is NULL, delay-rendering will be used.
       if ((*iter)->medium) {
         DuplicateMedium((*iter)->format_etc.cfFormat, (*iter)->medium, medium);
@@ -933,6 +1167,37 @@ static STGMEDIUM* GetStorageForFileDescriptor(
   return storage;
 }
 
+static HRESULT GetStorageForFileContentsSource(
+    OSExchangeData::FileContentsSource* source,
+    DWORD tymed,
+    STGMEDIUM* medium) {
+  if (tymed & TYMED_ISTREAM) {
+    FileContentsStream* stream = new FileContentsStream(source);
+    stream->AddRef();
+    medium->tymed = TYMED_ISTREAM;
+    medium->pstm = stream;
+    medium->pUnkForRelease = NULL;
+    return S_OK;
+  }
+
+  // The target can only take memory, so read all of the contents now.
+  std::string contents;
+  char buffer[64 * 1024];
+  for (int64 offset = 0;;) {
+    int read = source->Read(offset, buffer, sizeof(buffer));
+    if (read < 0)
+      return STG_E_READFAULT;
+    if (read == 0)
+      break;
+    contents.append(buffer, read);
+    offset += read;
+  }
+  STGMEDIUM* storage = GetStorageForBytes(contents.data(), contents.size());
+  *medium = *storage;
+  delete storage;
+  return S_OK;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // OSExchangeData, public:
 
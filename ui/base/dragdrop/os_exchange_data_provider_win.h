@@ -87,6 +87,8 @@ class DataObjectImpl : public DownloadFileObserver,
     bool owns_medium;
     bool in_delay_rendering;
     scoped_refptr<DownloadFileProvider> downloader;
+    // If set, |medium| is NULL and each GetData() reads the contents afresh.
+    scoped_refptr<OSExchangeData::FileContentsSource> contents_source;
 
     StoredDataInfo(CLIPFORMAT cf, STGMEDIUM* medium)
         : medium(medium),
@@ -156,6 +158,9 @@ class UI_EXPORT OSExchangeDataProviderWin : public OSExchangeData::Provider {
                               const Pickle& data);
   virtual void SetFileContents(const FilePath& filename,
                                const std::string& file_contents);
+  virtual void SetFileContentsSource(
+      const FilePath& filename,
+      OSExchangeData::FileContentsSource* source);
   // virtual void SetHtml(const string16& html, const GURL& base_url);
 
   virtual bool GetString(string16* data) const;
@@ -619,6 +619,11 @@ string16 GetStringUTF16(int message_id) {
   return str;
 }
 
+base::StringPiece16 GetStringPieceUTF16(int message_id) {
+  return ResourceBundle::GetSharedInstance().GetLocalizedStringPiece(
+      message_id);
+}
+
 static string16 GetStringF(int message_id,
                            const std::vector<string16>& replacements,
                            std::vector<size_t>* offsets) {
@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "base/string16.h"
+#include "base/string_piece.h"
 #include "base/string_util.h"
 #include "ui/base/ui_export.h"
 
@@ -78,6 +79,12 @@ UI_EXPORT std::string GetApplicationLocale(const std::string& pref_locale);
 UI_EXPORT std::string GetStringUTF8(int message_id);
 UI_EXPORT string16 GetStringUTF16(int message_id);
 
+// Returns the string GetStringUTF16() does, without making a copy of it for
+// each call, for the UI that holds on to its strings. The string is shared,
+// and stays valid until the locale resources are reloaded. See
+// ResourceBundle::GetLocalizedStringPiece().
+UI_EXPORT base::StringPiece16 GetStringPieceUTF16(int message_id);
+
 // Get a resource string and replace $1-$2-$3 with |a| and |b|
 // respectively.  Additionally, $$ is replaced by $.
 UI_EXPORT string16 GetStringFUTF16(int message_id,
@@ -132,6 +139,8 @@ UI_EXPORT string16 GetStringFUTF16Int(int message_id, int a);
 string16 GetStringFUTF16Int(int message_id, int64 a);
 
 // In place sorting of string16 strings using collation rules for |locale|.
+// The strings are sorted by their collation sort keys, which are computed
+// once per string, in parallel on base::WorkerPool threads for long lists.
 UI_EXPORT void SortStrings16(const std::string& locale,
                              std::vector<string16>* strings);
 
@@ -7,10 +7,17 @@
 #include <windowsx.h>
 #include <algorithm>
 #include <iterator>
+#include <map>
 
+#include "base/bind.h"
 #include "base/i18n/rtl.h"
 #include "base/lazy_instance.h"
+#include "base/memory/ref_counted.h"
 #include "base/string_number_conversions.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/parallel_chunks.h"
+#include "base/threading/worker_pool.h"
+#include "base/utf_string_conversions.h"
 //#include "base/win/i18n.h"
 #include "base/win/windows_version.h"
 #include "grit/app_locale_settings.h"
@@ -70,6 +77,135 @@ class OverrideLocaleHolder {
 base::LazyInstance<OverrideLocaleHolder>
     override_locale_holder(base::LINKER_INITIALIZED);
 
+// SortStrings16() sorts lists with fewer strings on the calling thread.
+const size_t kMinParallelSortStrings = 4096;
+
+// The fewest strings that are given to one thread of a parallel sort.
+const size_t kMinStringsPerSortChunk = 1024;
+
+// LocaleNameToLCID(), which kernel32.dll has from Vista.
+typedef LCID (WINAPI* LocaleNameToLCIDFunction)(LPCWSTR name, DWORD flags);
+
+// The LCIDs that the strings of each locale are collated with.
+class CollationLocaleCache {
+ public:
+  CollationLocaleCache()
+      : locale_name_to_lcid_(reinterpret_cast<LocaleNameToLCIDFunction>(
+            GetProcAddress(GetModuleHandle(L"kernel32.dll"),
+                           "LocaleNameToLCID"))) {
+  }
+
+  // Returns the LCID of |locale|, e.g. "pt-BR", or the user's default
+  // locale if it is empty or Windows doesn't know it.
+  LCID GetLCID(const std::string& locale) {
+    if (locale.empty() || !locale_name_to_lcid_)
+      return LOCALE_USER_DEFAULT;
+    base::AutoLock lock(lock_);
+    LCIDMap::const_iterator it = lcids_.find(locale);
+    if (it != lcids_.end())
+      return it->second;
+    LCID lcid = locale_name_to_lcid_(ASCIIToWide(locale).c_str(), 0);
+    if (!lcid)
+      lcid = LOCALE_USER_DEFAULT;
+    lcids_[locale] = lcid;
+    return lcid;
+  }
+
+ private:
+  typedef std::map<std::string, LCID> LCIDMap;
+
+  const LocaleNameToLCIDFunction locale_name_to_lcid_;
+  base::Lock lock_;
+  LCIDMap lcids_;
+
+  DISALLOW_COPY_AND_ASSIGN(CollationLocaleCache);
+};
+
+base::LazyInstance<CollationLocaleCache,
+                   base::LeakyLazyInstanceTraits<CollationLocaleCache> >
+    collation_locale_cache(base::LINKER_INITIALIZED);
+
+// A string to sort: its collation sort key, which compares byte by byte as
+// CompareString compares the string, and its index in the list.
+struct SortEntry {
+  bool operator<(const SortEntry& other) const {
+    int result = key.compare(other.key);
+    return result < 0 || (result == 0 && index < other.index);
+  }
+
+  std::string key;
+  size_t index;
+};
+
+// Sets |sort_key| to the sort key of |string| for |lcid|, or clears it if
+// there is none.
+void GetSortKey(LCID lcid, const string16& string, std::string* sort_key) {
+  sort_key->clear();
+  int size = LCMapStringW(lcid, LCMAP_SORTKEY, string.c_str(),
+                          static_cast<int>(string.size()), NULL, 0);
+  if (size <= 0)
+    return;
+  sort_key->resize(size);
+  size = LCMapStringW(lcid, LCMAP_SORTKEY, string.c_str(),
+                      static_cast<int>(string.size()),
+                      reinterpret_cast<LPWSTR>(&(*sort_key)[0]), size);
+  // The key ends with a 0, which only the longer keys would have in its
+  // place.
+  sort_key->resize(size > 0 ? size - 1 : 0);
+}
+
+// Gets the sort keys of the strings and sorts them, in chunks that
+// base::RunParallelChunks() hands out to the calling thread and
+// base::WorkerPool threads.  Each chunk is sorted by the thread that got its
+// keys; the caller then merges them.
+class ParallelSortKeys : public base::RefCountedThreadSafe<ParallelSortKeys> {
+ public:
+  ParallelSortKeys(LCID lcid,
+                   const std::vector<string16>& strings,
+                   size_t num_chunks)
+      : lcid_(lcid),
+        strings_(&strings),
+        entries_(strings.size()),
+        num_chunks_(num_chunks) {
+  }
+
+  // Returns the entries of the strings, sorted within each chunk, once all
+  // the chunks are done.
+  std::vector<SortEntry>* Run() {
+    base::RunParallelChunks(static_cast<int>(num_chunks_),
+                            base::Bind(&ParallelSortKeys::SortChunk, this));
+    return &entries_;
+  }
+
+  // The index of the first entry of |chunk|; chunk |num_chunks_| ends them.
+  size_t ChunkBegin(size_t chunk) const {
+    return entries_.size() * chunk / num_chunks_;
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<ParallelSortKeys>;
+
+  ~ParallelSortKeys() {}
+
+  // |strings_| is only read while a chunk is left, when the caller is still
+  // waiting.
+  void SortChunk(int chunk) {
+    size_t end = ChunkBegin(chunk + 1);
+    for (size_t i = ChunkBegin(chunk); i < end; ++i) {
+      entries_[i].index = i;
+      GetSortKey(lcid_, (*strings_)[i], &entries_[i].key);
+    }
+    std::sort(entries_.begin() + ChunkBegin(chunk), entries_.begin() + end);
+  }
+
+  const LCID lcid_;
+  const std::vector<string16>* strings_;
+  std::vector<SortEntry> entries_;
+  const size_t num_chunks_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelSortKeys);
+};
+
 }  // namespace
 
 namespace l10n_util {
@@ -165,6 +301,48 @@ void AdjustUIFontForWindow(HWND hwnd) {
   }
 }
 
+void SortStrings16(const std::string& locale,
+                   std::vector<string16>* strings) {
+  if (strings->size() < 2)
+    return;
+  LCID lcid = collation_locale_cache.Get().GetLCID(locale);
+
+  // Comparing sort keys is much faster than comparing the strings, which
+  // CompareString does by getting much of their keys each time.
+  std::vector<SortEntry> serial_entries;
+  std::vector<SortEntry>* entries = &serial_entries;
+  scoped_refptr<ParallelSortKeys> parallel;
+  size_t num_chunks = std::min(
+      static_cast<size_t>(base::WorkerPool::GetNumberOfCpuWorkers()) + 1,
+      strings->size() / kMinStringsPerSortChunk);
+  if (strings->size() >= kMinParallelSortStrings && num_chunks > 1) {
+    parallel = new ParallelSortKeys(lcid, *strings, num_chunks);
+    entries = parallel->Run();
+    // Merges the sorted chunks pairwise.
+    for (size_t width = 1; width < num_chunks; width *= 2) {
+      for (size_t chunk = 0; chunk + width < num_chunks; chunk += 2 * width) {
+        std::inplace_merge(
+            entries->begin() + parallel->ChunkBegin(chunk),
+            entries->begin() + parallel->ChunkBegin(chunk + width),
+            entries->begin() + parallel->ChunkBegin(
+                std::min(chunk + 2 * width, num_chunks)));
+      }
+    }
+  } else {
+    serial_entries.resize(strings->size());
+    for (size_t i = 0; i < strings->size(); ++i) {
+      serial_entries[i].index = i;
+      GetSortKey(lcid, (*strings)[i], &serial_entries[i].key);
+    }
+    std::sort(serial_entries.begin(), serial_entries.end());
+  }
+
+  std::vector<string16> sorted(strings->size());
+  for (size_t i = 0; i < entries->size(); ++i)
+    sorted[i].swap((*strings)[(*entries)[i].index]);
+  strings->swap(sorted);
+}
+
 // void OverrideLocaleWithUILanguageList() {
 //   std::vector<std::wstring> ui_languages;
 //   if (base::win::i18n::GetThreadPreferredUILanguageList(&ui_languages)) {
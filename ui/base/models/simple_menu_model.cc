@@ -209,6 +209,14 @@ void SimpleMenuModel::InsertSubMenuWithStringIdAt(
                   model);
 }
 
+void SimpleMenuModel::AddItems(const SimpleMenuModel& items) {
+  InsertItemsAtIndex(items.items_, static_cast<int>(items_.size()));
+}
+
+void SimpleMenuModel::InsertItemsAt(int index, const SimpleMenuModel& items) {
+  InsertItemsAtIndex(items.items_, FlipIndex(index));
+}
+
 void SimpleMenuModel::SetIcon(int index, const SkBitmap& icon) {
   items_[index].icon = icon;
 }
@@ -377,6 +385,14 @@ void SimpleMenuModel::InsertItemAtIndex(const Item& item, int index) {
   items_.insert(items_.begin() + FlipIndex(index), item);
 }
 
+void SimpleMenuModel::InsertItemsAtIndex(const std::vector<Item>& items,
+                                         int index) {
+  DCHECK_NE(&items, &items_);
+  for (size_t i = 0; i < items.size(); ++i)
+    ValidateItem(items[i]);
+  items_.insert(items_.begin() + index, items.begin(), items.end());
+}
+
 void SimpleMenuModel::ValidateItem(const Item& item) {
 #ifndef NDEBUG
   if (item.type == TYPE_SEPARATOR) {
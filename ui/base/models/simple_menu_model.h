@@ -97,6 +97,15 @@ class UI_EXPORT SimpleMenuModel : public MenuModel {
   void InsertSubMenuWithStringIdAt(
       int index, int command_id, int string_id, MenuModel* model);
 
+  // Methods for adding or inserting copies of all the items of |items| at
+  // once, which is quicker than adding them one at a time when the items
+  // after them have to move. The sub-models are shared rather than copied,
+  // and the items' labels and icons are still asked of this model's delegate.
+  // A model that flips its indices gets the items in the order it stores
+  // them.
+  void AddItems(const SimpleMenuModel& items);
+  void InsertItemsAt(int index, const SimpleMenuModel& items);
+
   // Sets the icon for the item at |index|.
   void SetIcon(int index, const SkBitmap& icon);
 
@@ -150,6 +159,8 @@ class UI_EXPORT SimpleMenuModel : public MenuModel {
   // Functions for inserting items into |items_|.
   void AppendItem(const Item& item);
   void InsertItemAtIndex(const Item& item, int index);
+  // Inserts |items| at |index| of |items_|, which is not flipped.
+  void InsertItemsAtIndex(const std::vector<Item>& items, int index);
   void ValidateItem(const Item& item);
 
   // Notify the delegate that the menu is closed.
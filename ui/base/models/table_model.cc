@@ -145,4 +145,23 @@ int TableModel::CompareValues(int row1, int row2, int column_id)
     return lstrcmpW(value1.c_str(), value2.c_str());
 }
 
+bool TableModel::GetSortKey(int row, int column_id, std::string* sort_key) {
+  DCHECK(row >= 0 && row < RowCount());
+  string16 value = GetText(row, column_id);
+  // lstrcmpW compares as CompareString does for the user's locale, and the
+  // sort keys of LCMapString compare, byte by byte, the same way.
+  int size = LCMapStringW(LOCALE_USER_DEFAULT, LCMAP_SORTKEY, value.c_str(),
+                          -1, NULL, 0);
+  if (size <= 0)
+    return false;
+  sort_key->resize(size);
+  size = LCMapStringW(LOCALE_USER_DEFAULT, LCMAP_SORTKEY, value.c_str(), -1,
+                      reinterpret_cast<LPWSTR>(&(*sort_key)[0]), size);
+  if (size <= 0)
+    return false;
+  // Drops the terminating 0.
+  sort_key->resize(size - 1);
+  return true;
+}
+
 }  // namespace ui
@@ -6,6 +6,7 @@
 #define UI_BASE_MODELS_TABLE_MODEL_H_
 #pragma once
 
+#include <string>
 #include <vector>
 
 #include "base/string16.h"
@@ -79,6 +80,16 @@ class UI_EXPORT TableModel {
   // comparison.
   virtual int CompareValues(int row1, int row2, int column_id);
 
+  // Sets |sort_key| to a key of the value in the column with id |column_id|
+  // for |row|, such that comparing the keys of two rows byte by byte orders
+  // them as CompareValues does. Getting a key per row once is much faster
+  // than comparing the rows while sorting. Returns false if there is no such
+  // key.
+  //
+  // This implementation returns the collation sort key of the text, so models
+  // that override CompareValues must override this too.
+  virtual bool GetSortKey(int row, int column_id, std::string* sort_key);
+
   // Reset the collator.
   void ClearCollator();
 
@@ -13,6 +13,19 @@ void TreeModel::SetTitle(TreeModelNode* node,
   NOTREACHED();
 }
 
+bool TreeModel::HasChildren(TreeModelNode* parent) {
+  return GetChildCount(parent) > 0;
+}
+
+bool TreeModel::AreChildrenLoaded(TreeModelNode* parent) {
+  return true;
+}
+
+void TreeModel::LoadChildren(TreeModelNode* parent) {
+  // Models that load their children lazily must override this.
+  NOTREACHED();
+}
+
 int TreeModel::GetIconIndex(TreeModelNode* node) {
   return -1;
 }
@@ -47,6 +47,12 @@ class UI_EXPORT TreeModelObserver {
   // Notification that the contents of a node has changed.
   virtual void TreeNodeChanged(TreeModel* model, TreeModelNode* node) = 0;
 
+  // Notification that the children of |parent| were loaded, after being asked
+  // for by TreeModel::LoadChildren. TreeNodesAdded was notified for them
+  // before, if there are any.
+  virtual void TreeNodeChildrenLoaded(TreeModel* model,
+                                      TreeModelNode* parent) {}
+
  protected:
   virtual ~TreeModelObserver() {}
 };
@@ -54,6 +60,15 @@ class UI_EXPORT TreeModelObserver {
 // TreeModel ------------------------------------------------------------------
 
 // The model for TreeView.
+//
+// A model may load the children of its nodes lazily, as they are expanded:
+// until AreChildrenLoaded returns true for a node, GetChildCount and GetChild
+// only give the children loaded so far, if any, and HasChildren tells whether
+// the node has children at all. LoadChildren is invoked when the children are
+// needed, and the model notifies TreeNodesAdded and then
+// TreeNodeChildrenLoaded once it has loaded them, right away or later, for
+// example on a background thread. With such a model, a tree of any size
+// loads in constant time.
 class UI_EXPORT TreeModel {
  public:
   // Returns the root of the tree. This may or may not be shown in the tree,
@@ -72,6 +87,19 @@ class UI_EXPORT TreeModel {
   // Returns the parent of |node|, or NULL if |node| is the root.
   virtual TreeModelNode* GetParent(TreeModelNode* node) = 0;
 
+  // Returns true if |parent| has children, which may not be loaded yet. This
+  // implementation returns true if GetChildCount is not 0.
+  virtual bool HasChildren(TreeModelNode* parent);
+
+  // Returns true if all the children of |parent| are loaded. This
+  // implementation returns true.
+  virtual bool AreChildrenLoaded(TreeModelNode* parent);
+
+  // Asks for the children of |parent| to be loaded. Only invoked when
+  // AreChildrenLoaded is false, and not again until TreeNodeChildrenLoaded
+  // is notified.
+  virtual void LoadChildren(TreeModelNode* parent);
+
   // Adds an observer of the model.
   virtual void AddObserver(TreeModelObserver* observer) = 0;
 
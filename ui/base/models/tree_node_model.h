@@ -7,6 +7,7 @@
 #pragma once
 
 #include <algorithm>
+#include <set>
 #include <vector>
 
 #include "base/basictypes.h"
@@ -58,6 +59,15 @@ namespace ui {
 //
 // Regardless of which TreeNode you use, if you are using the nodes with a
 // TreeView take care to notify the observer when mutating the nodes.
+//
+// Rather than building all the nodes up front, a TreeNodeModel may be given a
+// TreeNodeLoader that creates the children of the nodes as they are expanded.
+//
+// To make many changes at once, use AddMany and RemoveRange, or make them
+// within a TreeNodeModel::ScopedUpdate, so that a TreeView updates itself once
+// per range of nodes rather than once per node.
+
+template <class NodeType> class TreeNodeModel;
 
 // TreeNode -------------------------------------------------------------------
 
@@ -95,6 +105,35 @@ class TreeNode : public TreeModelNode {
     return node;
   }
 
+  // Adds |nodes|, which have no parent, as children of this one from |index|
+  // on. Unlike calling Add for each, this moves the children after |index|
+  // once.
+  void AddMany(const std::vector<NodeType*>& nodes, int index) {
+    DCHECK_GE(index, 0);
+    DCHECK_LE(index, child_count());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      DCHECK(nodes[i] && !nodes[i]->parent_);
+      nodes[i]->parent_ = static_cast<NodeType*>(this);
+    }
+    children_->insert(children_->begin() + index, nodes.begin(), nodes.end());
+  }
+
+  // Removes the |count| children from |start| on and appends them to |nodes|.
+  // It's up to the caller to delete them.
+  void RemoveRange(int start, int count, std::vector<NodeType*>* nodes) {
+    DCHECK(nodes);
+    DCHECK_GE(start, 0);
+    DCHECK_GE(count, 0);
+    DCHECK_LE(start + count, child_count());
+    typename std::vector<NodeType*>::iterator first =
+        children_->begin() + start;
+    typename std::vector<NodeType*>::iterator last = first + count;
+    for (typename std::vector<NodeType*>::iterator i = first; i != last; ++i)
+      (*i)->parent_ = NULL;
+    nodes->insert(nodes->end(), first, last);
+    children_->erase(first, last);
+  }
+
   // Removes all the children from this node. This does NOT delete the nodes.
   void RemoveAll() {
     for (size_t i = 0; i < children_->size(); ++i)
@@ -197,16 +236,105 @@ class TreeNodeWithValue : public TreeNode< TreeNodeWithValue<ValueType> > {
   DISALLOW_COPY_AND_ASSIGN(TreeNodeWithValue);
 };
 
+// TreeNodeLoader -------------------------------------------------------------
+
+// Creates the children of the nodes of a TreeNodeModel as they are needed, see
+// TreeNodeModel::SetLoader.
+template <class NodeType>
+class TreeNodeLoader {
+ public:
+  // Returns true if |node| has children, without creating them.
+  virtual bool HasChildren(NodeType* node) = 0;
+
+  // Creates the children of |node|, and hands them to
+  // TreeNodeModel::SetLoadedChildren, right away or later. The children may be
+  // created on a background thread, as long as SetLoadedChildren is invoked
+  // on the thread of the model.
+  virtual void LoadChildren(TreeNodeModel<NodeType>* model,
+                            NodeType* node) = 0;
+
+ protected:
+  virtual ~TreeNodeLoader() {}
+};
+
 // TreeNodeModel --------------------------------------------------------------
 
 // TreeModel implementation intended to be used with TreeNodes.
 template <class NodeType>
 class TreeNodeModel : public TreeModel {
  public:
+  // Defers the notifications of the cover methods of |model| for its scope,
+  // see BeginUpdate.
+  class ScopedUpdate {
+   public:
+    explicit ScopedUpdate(TreeNodeModel* model) : model_(model) {
+      model_->BeginUpdate();
+    }
+    ~ScopedUpdate() { model_->EndUpdate(); }
+
+   private:
+    TreeNodeModel* model_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedUpdate);
+  };
+
   // Creates a TreeNodeModel with the specified root node. The root is owned
   // by the TreeNodeModel.
-  explicit TreeNodeModel(NodeType* root) : root_(root) {}
-  virtual ~TreeNodeModel() {}
+  explicit TreeNodeModel(NodeType* root)
+      : root_(root),
+        loader_(NULL),
+        update_depth_(0),
+        pending_change_(NO_PENDING_CHANGE),
+        pending_parent_(NULL),
+        pending_start_(0),
+        pending_count_(0) {}
+  virtual ~TreeNodeModel() {
+    DCHECK_EQ(0, update_depth_);
+  }
+
+  // Makes the model load the children of the nodes with |loader|, which is
+  // not owned, and may be NULL to stop doing so. Nodes that already have
+  // children are considered loaded.
+  void SetLoader(TreeNodeLoader<NodeType>* loader) { loader_ = loader; }
+
+  // Adds the loaded |children| of |parent|, which were asked for by
+  // TreeNodeLoader::LoadChildren, and takes ownership of them. |children|
+  // is cleared.
+  void SetLoadedChildren(NodeType* parent, std::vector<NodeType*>* children) {
+    DCHECK(parent && children);
+    if (!loading_nodes_.erase(parent)) {
+      // |parent| was removed while its children were loading.
+      for (size_t i = 0; i < children->size(); ++i)
+        delete (*children)[i];
+      children->clear();
+      return;
+    }
+    loaded_nodes_.insert(parent);
+    // The children are notified right away, as TreeNodeChildrenLoaded has to
+    // follow them.
+    FlushPendingNotifications();
+    int start = parent->child_count();
+    int count = static_cast<int>(children->size());
+    parent->AddMany(*children, start);
+    children->clear();
+    if (count)
+      NotifyObserverTreeNodesAdded(parent, start, count);
+    FOR_EACH_OBSERVER(TreeModelObserver,
+                      observer_list_,
+                      TreeNodeChildrenLoaded(this, parent));
+  }
+
+  // Defers the notifications of the cover methods until the matching
+  // EndUpdate, which sends one TreeNodesAdded or TreeNodesRemoved for each run
+  // of adds or removes that make up a single range of children of one parent,
+  // and one TreeNodeChanged for each changed node. The calls nest. Until the
+  // outermost EndUpdate, mutate the nodes through the cover methods only.
+  void BeginUpdate() { ++update_depth_; }
+  void EndUpdate() {
+    DCHECK_GT(update_depth_, 0);
+    if (--update_depth_ == 0)
+      FlushPendingNotifications();
+  }
 
   NodeType* AsNode(TreeModelNode* model_node) {
     return static_cast<NodeType*>(model_node);
@@ -214,31 +342,76 @@ class TreeNodeModel : public TreeModel {
 
   void Add(NodeType* parent, NodeType* node, int index) {
     DCHECK(parent && node);
+    WillAddNodes(parent, index);
     parent->Add(node, index);
-    NotifyObserverTreeNodesAdded(parent, index, 1);
+    DidAddNodes(parent, index, 1);
+  }
+
+  // Adds |nodes|, which have no parent, as children of |parent| from |index|
+  // on, with one notification, and takes ownership of them. |nodes| is
+  // cleared.
+  void AddMany(NodeType* parent, std::vector<NodeType*>* nodes, int index) {
+    DCHECK(parent && nodes);
+    if (nodes->empty())
+      return;
+    int count = static_cast<int>(nodes->size());
+    WillAddNodes(parent, index);
+    parent->AddMany(*nodes, index);
+    nodes->clear();
+    DidAddNodes(parent, index, count);
   }
 
   NodeType* Remove(NodeType* parent, NodeType* node) {
     DCHECK(parent);
     int index = parent->GetIndexOf(node);
+    WillRemoveNodes(parent, index, 1);
     NodeType* delete_node = parent->Remove(node);
-    NotifyObserverTreeNodesRemoved(parent, index, 1);
+    ForgetLoadState(delete_node);
+    DidRemoveNodes(parent, index, 1);
     return delete_node;
   }
 
+  // Removes the |count| children of |parent| from |start| on, with one
+  // notification, and appends them to |nodes|. It's up to the caller to
+  // delete them.
+  void RemoveRange(NodeType* parent,
+                   int start,
+                   int count,
+                   std::vector<NodeType*>* nodes) {
+    DCHECK(parent && nodes);
+    if (!count)
+      return;
+    WillRemoveNodes(parent, start, count);
+    size_t first_removed = nodes->size();
+    parent->RemoveRange(start, count, nodes);
+    for (size_t i = first_removed; i < nodes->size(); ++i)
+      ForgetLoadState((*nodes)[i]);
+    DidRemoveNodes(parent, start, count);
+  }
+
+  // These notify right away, after the notifications that are pending.
   void NotifyObserverTreeNodesAdded(NodeType* parent, int start, int count) {
+    FlushPendingNotifications();
     FOR_EACH_OBSERVER(TreeModelObserver,
                       observer_list_,
                       TreeNodesAdded(this, parent, start, count));
   }
 
   void NotifyObserverTreeNodesRemoved(NodeType* parent, int start, int count) {
+    FlushPendingNotifications();
     FOR_EACH_OBSERVER(TreeModelObserver,
                       observer_list_,
                       TreeNodesRemoved(this, parent, start, count));
   }
 
+  // Within an update, a node that is pending as added isn't notified as
+  // changed too, and the other nodes are notified once, at its end.
   void NotifyObserverTreeNodeChanged(TreeModelNode* node) {
+    if (update_depth_) {
+      if (!IsPendingAdd(node))
+        pending_changed_nodes_.insert(node);
+      return;
+    }
     FOR_EACH_OBSERVER(TreeModelObserver,
                       observer_list_,
                       TreeNodeChanged(this, node));
@@ -269,6 +442,27 @@ class TreeNodeModel : public TreeModel {
     return AsNode(node)->parent();
   }
 
+  virtual bool HasChildren(TreeModelNode* parent) OVERRIDE {
+    DCHECK(parent);
+    if (AreChildrenLoaded(parent))
+      return AsNode(parent)->child_count() > 0;
+    return loader_->HasChildren(AsNode(parent));
+  }
+
+  virtual bool AreChildrenLoaded(TreeModelNode* parent) OVERRIDE {
+    DCHECK(parent);
+    NodeType* node = AsNode(parent);
+    return !loader_ || node->child_count() > 0 || loaded_nodes_.count(node);
+  }
+
+  virtual void LoadChildren(TreeModelNode* parent) OVERRIDE {
+    DCHECK(parent && loader_);
+    NodeType* node = AsNode(parent);
+    // Only one load per node at a time.
+    if (loading_nodes_.insert(node).second)
+      loader_->LoadChildren(this, node);
+  }
+
   virtual void AddObserver(TreeModelObserver* observer) OVERRIDE {
     observer_list_.AddObserver(observer);
   }
@@ -284,12 +478,141 @@ class TreeNodeModel : public TreeModel {
   }
 
  private:
+  // The notification that is pending within an update, for the children
+  // |pending_start_| to |pending_start_| + |pending_count_| of
+  // |pending_parent_|. The range of removed children is where they were
+  // before the first of them was removed.
+  enum PendingChange {
+    NO_PENDING_CHANGE,
+    PENDING_ADD,
+    PENDING_REMOVE
+  };
+
+  // Called before nodes are added to |parent| at |index|. Sends the pending
+  // notifications unless the nodes extend the pending range of added nodes.
+  void WillAddNodes(NodeType* parent, int index) {
+    if (pending_change_ != PENDING_ADD || pending_parent_ != parent ||
+        index < pending_start_ || index > pending_start_ + pending_count_) {
+      FlushPendingNotifications();
+    }
+  }
+
+  // Called once |count| nodes were added to |parent| at |index|.
+  void DidAddNodes(NodeType* parent, int index, int count) {
+    if (!update_depth_) {
+      NotifyObserverTreeNodesAdded(parent, index, count);
+    } else if (pending_change_ == PENDING_ADD) {
+      pending_count_ += count;
+    } else {
+      SetPendingChange(PENDING_ADD, parent, index, count);
+    }
+  }
+
+  // Called before the |count| children of |parent| from |start| on are
+  // removed. Sends the pending notifications unless the nodes extend the
+  // pending range of removed nodes. Since the caller may delete the removed
+  // nodes, the changed nodes are always notified first.
+  void WillRemoveNodes(NodeType* parent, int start, int count) {
+    if (pending_change_ != PENDING_REMOVE || pending_parent_ != parent ||
+        !pending_changed_nodes_.empty() ||
+        (start != pending_start_ && start + count != pending_start_)) {
+      FlushPendingNotifications();
+    }
+  }
+
+  // Called once the |count| children of |parent| from |start| on were
+  // removed.
+  void DidRemoveNodes(NodeType* parent, int start, int count) {
+    if (!update_depth_) {
+      NotifyObserverTreeNodesRemoved(parent, start, count);
+    } else if (pending_change_ == PENDING_REMOVE) {
+      pending_start_ = std::min(pending_start_, start);
+      pending_count_ += count;
+    } else {
+      SetPendingChange(PENDING_REMOVE, parent, start, count);
+    }
+  }
+
+  void SetPendingChange(PendingChange change,
+                        NodeType* parent,
+                        int start,
+                        int count) {
+    pending_change_ = change;
+    pending_parent_ = parent;
+    pending_start_ = start;
+    pending_count_ = count;
+  }
+
+  // Returns true if |node| is in the pending range of added nodes.
+  bool IsPendingAdd(TreeModelNode* node) {
+    if (pending_change_ != PENDING_ADD ||
+        AsNode(node)->parent() != pending_parent_) {
+      return false;
+    }
+    int index = pending_parent_->GetIndexOf(AsNode(node));
+    return index >= pending_start_ && index < pending_start_ + pending_count_;
+  }
+
+  // Sends the pending notifications, if any. They're taken first, in case an
+  // observer changes the model.
+  void FlushPendingNotifications() {
+    PendingChange change = pending_change_;
+    pending_change_ = NO_PENDING_CHANGE;
+    if (change == PENDING_ADD) {
+      FOR_EACH_OBSERVER(TreeModelObserver,
+                        observer_list_,
+                        TreeNodesAdded(this, pending_parent_, pending_start_,
+                                       pending_count_));
+    } else if (change == PENDING_REMOVE) {
+      FOR_EACH_OBSERVER(TreeModelObserver,
+                        observer_list_,
+                        TreeNodesRemoved(this, pending_parent_, pending_start_,
+                                         pending_count_));
+    }
+    if (pending_changed_nodes_.empty())
+      return;
+    std::set<TreeModelNode*> changed_nodes;
+    changed_nodes.swap(pending_changed_nodes_);
+    for (std::set<TreeModelNode*>::const_iterator i = changed_nodes.begin();
+         i != changed_nodes.end(); ++i) {
+      FOR_EACH_OBSERVER(TreeModelObserver,
+                        observer_list_,
+                        TreeNodeChanged(this, *i));
+    }
+  }
+
+  // Forgets the load state of |node| and its descendants, which were removed,
+  // so that nodes created later at the same addresses are not taken for them.
+  void ForgetLoadState(NodeType* node) {
+    if (loaded_nodes_.empty() && loading_nodes_.empty())
+      return;
+    loaded_nodes_.erase(node);
+    loading_nodes_.erase(node);
+    for (int i = 0; i < node->child_count(); ++i)
+      ForgetLoadState(node->GetChild(i));
+  }
+
   // The observers.
   ObserverList<TreeModelObserver> observer_list_;
 
   // The root.
   scoped_ptr<NodeType> root_;
 
+  // Loads the children of the nodes, if not NULL. The nodes whose children
+  // were loaded, and those whose children are loading.
+  TreeNodeLoader<NodeType>* loader_;
+  std::set<NodeType*> loaded_nodes_;
+  std::set<NodeType*> loading_nodes_;
+
+  // The depth of the BeginUpdate calls, and what is pending until the last
+  // EndUpdate.
+  int update_depth_;
+  PendingChange pending_change_;
+  NodeType* pending_parent_;
+  int pending_start_;
+  int pending_count_;
+  std::set<TreeModelNode*> pending_changed_nodes_;
+
   DISALLOW_COPY_AND_ASSIGN(TreeNodeModel);
 };
 
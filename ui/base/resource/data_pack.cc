@@ -6,21 +6,66 @@
 
 #include <errno.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "base/file_util.h"
 #include "base/logging.h"
 #include "base/memory/ref_counted_memory.h"
 #include "base/metrics/histogram.h"
+#include "base/stl_util.h"
+#include "base/string_number_conversions.h"
 #include "base/string_piece.h"
+#include "ui/base/resource/resource_image.h"
+
+#if defined(USE_SYSTEM_ZLIB)
+#include <zlib.h>
+#else
+#include "third_party/zlib/zlib.h"
+#endif
 
 // For details of the file layout, see
 // http://dev.chromium.org/developers/design-documents/linuxresourcesandlocalizedstrings
 
 namespace {
 
-static const uint32 kFileFormatVersion = 4;
+static const uint32 kFileFormatVersion = 8;
+// Packs of the previous versions have no aligned data, before that their data
+// in the order of the index, before that no compressed resources, and before
+// that no hash table, but can still be read.
+static const uint32 kFileFormatVersionWithoutAlignment = 7;
+static const uint32 kFileFormatVersionWithoutDataOrder = 6;
+static const uint32 kFileFormatVersionWithoutCompression = 5;
+static const uint32 kFileFormatVersionWithoutHashTable = 4;
 // Length of file header: version, entry count and text encoding type.
 static const size_t kHeaderLength = 2 * sizeof(uint32) + sizeof(uint8);
 
+// The hash table follows the index, with a slot per resource: first the
+// int32 displacement of each bucket, then the uint16 index entry of each slot.
+static const size_t kHashTableSlotLength = sizeof(int32) + sizeof(uint16);
+
+// Set in the offset of the index entries of compressed resources, whose data
+// is their uncompressed length, as a uint32, followed by a zlib stream.
+static const uint32 kCompressedFlag = 0x80000000;
+
+// The data order table follows the hash table: for each index entry, as a
+// uint16, the index entry whose data follows its data, then the length of the
+// hot region, as a uint32. The hot region is at the start of the data, and
+// holds the resources used at startup, which are prefetched.
+static const size_t kDataOrderEntryLength = sizeof(uint16);
+
+// The entry table follows the data order table: for each index entry, a uint8
+// whose high 4 bits are the encoding of the resource, and whose low 4 bits the
+// padding that follows its data. The data starts at the next multiple of
+// kDataAlignment, and the data of the uncompressed UTF-16 resources is aligned
+// to kTextAlignment, and that of the pre-decoded images to kDataAlignment, so
+// that they can be used in place.
+static const size_t kEntryTableEntryLength = sizeof(uint8);
+static const uint8 kEntryPaddingMask = 0xF;
+static const int kEntryEncodingShift = 4;
+static const uint32 kDataAlignment = 16;
+static const uint32 kTextAlignment = 4;
+
 #pragma pack(push,2)
 struct DataPackEntry {
   uint16 resource_id;
@@ -43,6 +88,118 @@ struct DataPackEntry {
 
 COMPILE_ASSERT(sizeof(DataPackEntry) == 6, size_of_entry_must_be_six);
 
+// The hash of the minimal perfect hash table of the resource ids, which the
+// grit tools write too (see tools/grit/grit/format/data_pack.py): MurmurHash3's
+// 32 bit finalizer of |resource_id| xor |seed| times 0x9E3779B9.
+uint32 HashId(uint32 seed, uint16 resource_id) {
+  uint32 hash = resource_id ^ (seed * 0x9E3779B9u);
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6Bu;
+  hash ^= hash >> 13;
+  hash *= 0xC2B2AE35u;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+// Reads the |index|th element of an array of T in the pack, which need not be
+// aligned.
+template<typename T>
+T ReadArrayElement(const uint8* array, size_t index) {
+  T value;
+  memcpy(&value, array + index * sizeof(T), sizeof(T));
+  return value;
+}
+
+// Returns |offset| rounded up to a multiple of |alignment|.
+uint32 AlignOffset(uint32 offset, uint32 alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Returns the slot, in a hash table of |count| slots, of an id whose bucket
+// has |displacement|.
+size_t GetSlot(int32 displacement, uint16 resource_id, size_t count) {
+  if (displacement < 0)
+    return -(displacement + 1);
+  return HashId(displacement, resource_id) % count;
+}
+
+// Orders buckets of ids from the largest.
+class BucketIsLarger {
+ public:
+  explicit BucketIsLarger(const std::vector<std::vector<size_t> >& buckets)
+      : buckets_(buckets) {
+  }
+  bool operator()(size_t a, size_t b) const {
+    return buckets_[a].size() > buckets_[b].size();
+  }
+
+ private:
+  const std::vector<std::vector<size_t> >& buckets_;
+};
+
+// Builds the hash table of the sorted |ids|, as BuildHashTable() in
+// data_pack.py does: the first hash of an id, with a seed of 0, gives its
+// bucket, and the displacement of the bucket its slot. The displacements of
+// the buckets of several ids are searched, from the largest bucket down,
+// until all their ids land in free slots. Buckets of one id then give the
+// remaining slots directly, as negative displacements.
+void BuildHashTable(const std::vector<uint16>& ids,
+                    std::vector<int32>* displacements,
+                    std::vector<uint16>* slots) {
+  size_t count = ids.size();
+  std::vector<std::vector<size_t> > buckets(count);
+  for (size_t i = 0; i < count; ++i)
+    buckets[HashId(0, ids[i]) % count].push_back(i);
+
+  std::vector<size_t> by_size(count);
+  for (size_t i = 0; i < count; ++i)
+    by_size[i] = i;
+  std::stable_sort(by_size.begin(), by_size.end(), BucketIsLarger(buckets));
+
+  displacements->assign(count, 0);
+  slots->assign(count, 0);
+  std::vector<bool> taken(count, false);
+  size_t position = 0;
+  for (; position < count && buckets[by_size[position]].size() > 1;
+       ++position) {
+    const std::vector<size_t>& bucket = buckets[by_size[position]];
+    std::vector<size_t> bucket_slots;
+    for (int32 displacement = 1; ; ++displacement) {
+      bucket_slots.clear();
+      for (size_t i = 0; i < bucket.size(); ++i) {
+        size_t slot = GetSlot(displacement, ids[bucket[i]], count);
+        if (taken[slot] ||
+            std::find(bucket_slots.begin(), bucket_slots.end(), slot) !=
+                bucket_slots.end()) {
+          break;
+        }
+        bucket_slots.push_back(slot);
+      }
+      if (bucket_slots.size() == bucket.size()) {
+        (*displacements)[by_size[position]] = displacement;
+        break;
+      }
+    }
+    for (size_t i = 0; i < bucket.size(); ++i) {
+      taken[bucket_slots[i]] = true;
+      (*slots)[bucket_slots[i]] = static_cast<uint16>(bucket[i]);
+    }
+  }
+
+  std::vector<size_t> free_slots;
+  for (size_t slot = 0; slot < count; ++slot) {
+    if (!taken[slot])
+      free_slots.push_back(slot);
+  }
+  for (; position < count && buckets[by_size[position]].size() == 1;
+       ++position) {
+    size_t slot = free_slots.back();
+    free_slots.pop_back();
+    (*displacements)[by_size[position]] = -static_cast<int32>(slot) - 1;
+    (*slots)[slot] = static_cast<uint16>(buckets[by_size[position]][0]);
+  }
+}
+
 // We're crashing when trying to load a pak file on Windows.  Add some error
 // codes for logging.
 // http://crbug.com/58056
@@ -51,6 +208,9 @@ enum LoadErrors {
   BAD_VERSION,
   INDEX_TRUNCATED,
   ENTRY_NOT_FOUND,
+  HASH_TABLE_CORRUPT,
+  DECOMPRESSION_FAILED,
+  DATA_ORDER_CORRUPT,
 
   LOAD_ERRORS_COUNT,
 };
@@ -60,7 +220,14 @@ enum LoadErrors {
 namespace ui {
 
 // In .cc for MemoryMappedFile dtor.
-DataPack::DataPack() : resource_count_(0), text_encoding_type_(BINARY) {
+DataPack::DataPack()
+    : resource_count_(0),
+      text_encoding_type_(BINARY),
+      has_hash_table_(false),
+      has_compressed_flags_(false),
+      has_data_order_(false),
+      has_entry_table_(false),
+      recording_resource_use_(0) {
 }
 DataPack::~DataPack() {
 }
@@ -86,7 +253,11 @@ bool DataPack::Load(const FilePath& path) {
   // First uint32: version; second: resource count;
   const uint32* ptr = reinterpret_cast<const uint32*>(mmap_->data());
   uint32 version = ptr[0];
-  if (version != kFileFormatVersion) {
+  if (version != kFileFormatVersion &&
+      version != kFileFormatVersionWithoutAlignment &&
+      version != kFileFormatVersionWithoutDataOrder &&
+      version != kFileFormatVersionWithoutCompression &&
+      version != kFileFormatVersionWithoutHashTable) {
     LOG(ERROR) << "Bad data pack version: got " << version << ", expected "
                << kFileFormatVersion;
     UMA_HISTOGRAM_ENUMERATION("DataPack.Load", BAD_VERSION,
@@ -95,6 +266,10 @@ bool DataPack::Load(const FilePath& path) {
     return false;
   }
   resource_count_ = ptr[1];
+  has_hash_table_ = version >= kFileFormatVersionWithoutCompression;
+  has_compressed_flags_ = version >= kFileFormatVersionWithoutDataOrder;
+  has_data_order_ = version >= kFileFormatVersionWithoutAlignment;
+  has_entry_table_ = version >= kFileFormatVersion;
 
   // third: text encoding.
   const uint8* ptr_encoding = reinterpret_cast<const uint8*>(ptr + 2);
@@ -108,9 +283,20 @@ bool DataPack::Load(const FilePath& path) {
   }
 
   // Sanity check the file.
-  // 1) Check we have enough entries.
-  if (kHeaderLength + resource_count_ * sizeof(DataPackEntry) >
-      mmap_->length()) {
+  // 1) Check we have enough entries, and room for the hash table, the data
+  // order table and the entry table.
+  size_t index_length = (resource_count_ + 1) * sizeof(DataPackEntry);
+  size_t hash_table_length =
+      has_hash_table_ ? resource_count_ * kHashTableSlotLength : 0;
+  size_t data_order_length = has_data_order_ ?
+      resource_count_ * kDataOrderEntryLength + sizeof(uint32) : 0;
+  size_t entry_table_length =
+      has_entry_table_ ? resource_count_ * kEntryTableEntryLength : 0;
+  size_t data_start = kHeaderLength + index_length + hash_table_length +
+      data_order_length + entry_table_length;
+  if (has_entry_table_)
+    data_start = AlignOffset(data_start, kDataAlignment);
+  if (data_start > mmap_->length()) {
     LOG(ERROR) << "Data pack file corruption: too short for number of "
                   "entries specified.";
     UMA_HISTOGRAM_ENUMERATION("DataPack.Load", INDEX_TRUNCATED,
@@ -120,10 +306,11 @@ bool DataPack::Load(const FilePath& path) {
   }
   // 2) Verify the entries are within the appropriate bounds. There's an extra
   // entry after the last item which gives us the length of the last item.
+  uint32 offset_mask = has_compressed_flags_ ? ~kCompressedFlag : ~0u;
   for (size_t i = 0; i < resource_count_ + 1; ++i) {
     const DataPackEntry* entry = reinterpret_cast<const DataPackEntry*>(
         mmap_->data() + kHeaderLength + (i * sizeof(DataPackEntry)));
-    if (entry->file_offset > mmap_->length()) {
+    if ((entry->file_offset & offset_mask) > mmap_->length()) {
       LOG(ERROR) << "Entry #" << i << " in data pack points off end of file. "
                  << "Was the file corrupted?";
       UMA_HISTOGRAM_ENUMERATION("DataPack.Load", ENTRY_NOT_FOUND,
@@ -132,12 +319,77 @@ bool DataPack::Load(const FilePath& path) {
       return false;
     }
   }
+  // 3) Verify the slots of the hash table are within the index, so that
+  // lookups need no checks.
+  if (has_hash_table_) {
+    const uint8* displacements = mmap_->data() + kHeaderLength + index_length;
+    const uint8* slots =
+        displacements + resource_count_ * sizeof(int32);
+    for (size_t i = 0; i < resource_count_; ++i) {
+      int32 displacement = ReadArrayElement<int32>(displacements, i);
+      if ((displacement < 0 &&
+           static_cast<size_t>(-(displacement + 1)) >= resource_count_) ||
+          ReadArrayElement<uint16>(slots, i) >= resource_count_) {
+        LOG(ERROR) << "Hash table slot #" << i << " in data pack is out of "
+                   << "range. Was the file corrupted?";
+        UMA_HISTOGRAM_ENUMERATION("DataPack.Load", HASH_TABLE_CORRUPT,
+                                  LOAD_ERRORS_COUNT);
+        mmap_.reset();
+        return false;
+      }
+    }
+  }
+  // 4) Verify the data of each entry is followed by that of an entry of the
+  // index, after no more padding than there is room for, that the encodings
+  // are known, and that the hot region is within the file.
+  size_t hot_length = 0;
+  if (has_data_order_) {
+    const DataPackEntry* index = reinterpret_cast<const DataPackEntry*>(
+        mmap_->data() + kHeaderLength);
+    const uint8* next_entries =
+        mmap_->data() + kHeaderLength + index_length + hash_table_length;
+    const uint8* entry_table = next_entries + data_order_length;
+    for (size_t i = 0; i < resource_count_; ++i) {
+      uint16 next = ReadArrayElement<uint16>(next_entries, i);
+      uint8 attributes = has_entry_table_ ? entry_table[i] : 0;
+      if (next > resource_count_ ||
+          (index[next].file_offset & offset_mask) <
+              (index[i].file_offset & offset_mask) +
+                  (attributes & kEntryPaddingMask) ||
+          (attributes >> kEntryEncodingShift) > UTF16) {
+        LOG(ERROR) << "Data order entry #" << i << " in data pack is out of "
+                   << "range. Was the file corrupted?";
+        UMA_HISTOGRAM_ENUMERATION("DataPack.Load", DATA_ORDER_CORRUPT,
+                                  LOAD_ERRORS_COUNT);
+        mmap_.reset();
+        return false;
+      }
+    }
+    hot_length = ReadArrayElement<uint32>(
+        next_entries + resource_count_ * kDataOrderEntryLength, 0);
+    if (hot_length > mmap_->length() - data_start) {
+      LOG(ERROR) << "Hot region of data pack points off end of file. "
+                 << "Was the file corrupted?";
+      UMA_HISTOGRAM_ENUMERATION("DataPack.Load", DATA_ORDER_CORRUPT,
+                                LOAD_ERRORS_COUNT);
+      mmap_.reset();
+      return false;
+    }
+  }
 
+  mmap_->Prefetch(data_start, hot_length);
   return true;
 }
 
 bool DataPack::GetStringPiece(uint16 resource_id,
                               base::StringPiece* data) const {
+  TextEncodingType encoding;
+  return GetStringPieceWithEncoding(resource_id, data, &encoding);
+}
+
+bool DataPack::GetStringPieceWithEncoding(uint16 resource_id,
+                                          base::StringPiece* data,
+                                          TextEncodingType* encoding) const {
   // It won't be hard to make this endian-agnostic, but it's not worth
   // bothering to do right now.
 #if defined(__BYTE_ORDER)
@@ -149,20 +401,135 @@ bool DataPack::GetStringPiece(uint16 resource_id,
   #error DataPack assumes little endian
 #endif
 
-  const DataPackEntry* target = reinterpret_cast<const DataPackEntry*>(
-      bsearch(&resource_id, mmap_->data() + kHeaderLength, resource_count_,
-              sizeof(DataPackEntry), DataPackEntry::CompareById));
-  if (!target) {
-    return false;
+  const DataPackEntry* index = reinterpret_cast<const DataPackEntry*>(
+      mmap_->data() + kHeaderLength);
+  const DataPackEntry* target = NULL;
+  if (has_hash_table_) {
+    if (resource_count_ == 0)
+      return false;
+    // The id maps to a single slot, which holds the one entry it can be.
+    const uint8* displacements = reinterpret_cast<const uint8*>(
+        index + resource_count_ + 1);
+    const uint8* slots = displacements + resource_count_ * sizeof(int32);
+    int32 displacement = ReadArrayElement<int32>(
+        displacements, HashId(0, resource_id) % resource_count_);
+    size_t slot = GetSlot(displacement, resource_id, resource_count_);
+    target = index + ReadArrayElement<uint16>(slots, slot);
+    if (target->resource_id != resource_id)
+      return false;
+  } else {
+    target = reinterpret_cast<const DataPackEntry*>(
+        bsearch(&resource_id, index, resource_count_,
+                sizeof(DataPackEntry), DataPackEntry::CompareById));
+    if (!target) {
+      return false;
+    }
   }
 
+  if (base::subtle::NoBarrier_Load(&recording_resource_use_))
+    RecordResourceUse(resource_id);
+
+  // The data of the resource ends where that of the next entry in the data
+  // order starts, less the padding.
   const DataPackEntry* next_entry = target + 1;
-  size_t length = next_entry->file_offset - target->file_offset;
+  uint8 padding = 0;
+  *encoding = text_encoding_type_;
+  if (has_data_order_) {
+    const uint8* next_entries = reinterpret_cast<const uint8*>(
+        index + resource_count_ + 1) + resource_count_ * kHashTableSlotLength;
+    next_entry = index + ReadArrayElement<uint16>(next_entries,
+                                                  target - index);
+    if (has_entry_table_) {
+      uint8 attributes = next_entries[resource_count_ * kDataOrderEntryLength +
+                                      sizeof(uint32) + (target - index)];
+      padding = attributes & kEntryPaddingMask;
+      *encoding = static_cast<TextEncodingType>(
+          attributes >> kEntryEncodingShift);
+    }
+  }
+  uint32 offset = target->file_offset;
+  uint32 next_offset = next_entry->file_offset;
+  bool compressed = false;
+  if (has_compressed_flags_) {
+    compressed = (offset & kCompressedFlag) != 0;
+    offset &= ~kCompressedFlag;
+    next_offset &= ~kCompressedFlag;
+  }
+  size_t length = next_offset - offset - padding;
 
-  data->set(mmap_->data() + target->file_offset, length);
+  if (compressed)
+    return GetDecompressed(resource_id, mmap_->data() + offset, length, data);
+  data->set(mmap_->data() + offset, length);
   return true;
 }
 
+bool DataPack::GetDecompressed(uint16 resource_id,
+                               const uint8* compressed,
+                               size_t length,
+                               base::StringPiece* data) const {
+  base::AutoLock lock(decompressed_lock_);
+  std::map<uint16, std::string>::const_iterator found =
+      decompressed_.find(resource_id);
+  if (found == decompressed_.end()) {
+    uint32 decompressed_length = 0;
+    if (length >= sizeof(decompressed_length))
+      memcpy(&decompressed_length, compressed, sizeof(decompressed_length));
+    std::string decompressed(decompressed_length, '\0');
+    uLongf output_length = decompressed_length;
+    if (length < sizeof(decompressed_length) ||
+        uncompress(reinterpret_cast<Bytef*>(string_as_array(&decompressed)),
+                   &output_length, compressed + sizeof(decompressed_length),
+                   length - sizeof(decompressed_length)) != Z_OK ||
+        output_length != decompressed_length) {
+      LOG(ERROR) << "Failed to decompress resource " << resource_id
+                 << " of data pack. Was the file corrupted?";
+      UMA_HISTOGRAM_ENUMERATION("DataPack.Load", DECOMPRESSION_FAILED,
+                                LOAD_ERRORS_COUNT);
+      return false;
+    }
+    std::string& cached = decompressed_[resource_id];
+    cached.swap(decompressed);
+    found = decompressed_.find(resource_id);
+  }
+
+  // The string is never modified again, so its data stays valid.
+  data->set(found->second.data(), found->second.size());
+  return true;
+}
+
+void DataPack::GetResourceIds(std::vector<uint16>* ids) const {
+  if (!mmap_.get())
+    return;
+  const DataPackEntry* index = reinterpret_cast<const DataPackEntry*>(
+      mmap_->data() + kHeaderLength);
+  ids->reserve(ids->size() + resource_count_);
+  for (size_t i = 0; i < resource_count_; ++i)
+    ids->push_back(index[i].resource_id);
+}
+
+void DataPack::StartRecordingResourceUse() {
+  base::subtle::NoBarrier_Store(&recording_resource_use_, 1);
+}
+
+bool DataPack::WriteResourceUseProfile(const FilePath& path) const {
+  std::string profile;
+  {
+    base::AutoLock lock(recorded_lock_);
+    for (size_t i = 0; i < recorded_ids_.size(); ++i) {
+      profile += base::UintToString(recorded_ids_[i]);
+      profile += '\n';
+    }
+  }
+  return file_util::WriteFile(path, profile.data(), profile.size()) ==
+      static_cast<int>(profile.size());
+}
+
+void DataPack::RecordResourceUse(uint16 resource_id) const {
+  base::AutoLock lock(recorded_lock_);
+  if (recorded_id_set_.insert(resource_id).second)
+    recorded_ids_.push_back(resource_id);
+}
+
 RefCountedStaticMemory* DataPack::GetStaticMemory(uint16 resource_id) const {
   base::StringPiece piece;
   if (!GetStringPiece(resource_id, &piece))
@@ -176,6 +543,40 @@ RefCountedStaticMemory* DataPack::GetStaticMemory(uint16 resource_id) const {
 bool DataPack::WritePack(const FilePath& path,
                          const std::map<uint16, base::StringPiece>& resources,
                          TextEncodingType textEncodingType) {
+  return WritePack(path, resources, textEncodingType, std::set<uint16>());
+}
+
+// static
+bool DataPack::WritePack(const FilePath& path,
+                         const std::map<uint16, base::StringPiece>& resources,
+                         TextEncodingType textEncodingType,
+                         const std::set<uint16>& compressed_ids) {
+  // Compresses the resources first, since their offsets depend on their
+  // compressed length.
+  std::map<uint16, std::string> compressed;
+  for (std::set<uint16>::const_iterator it = compressed_ids.begin();
+       it != compressed_ids.end(); ++it) {
+    std::map<uint16, base::StringPiece>::const_iterator resource =
+        resources.find(*it);
+    if (resource == resources.end())
+      continue;
+    uint32 length = resource->second.length();
+    uLongf compressed_length = compressBound(length);
+    std::string output(sizeof(length) + compressed_length, '\0');
+    memcpy(string_as_array(&output), &length, sizeof(length));
+    if (compress2(reinterpret_cast<Bytef*>(
+                      string_as_array(&output) + sizeof(length)),
+                  &compressed_length,
+                  reinterpret_cast<const Bytef*>(resource->second.data()),
+                  length, Z_BEST_COMPRESSION) != Z_OK) {
+      LOG(ERROR) << "Failed to compress resource " << *it;
+      return false;
+    }
+    output.resize(sizeof(length) + compressed_length);
+    if (output.size() < length)
+      compressed[*it].swap(output);
+  }
+
   FILE* file = file_util::OpenFile(path, "wb");
   if (!file)
     return false;
@@ -211,12 +612,54 @@ bool DataPack::WritePack(const FilePath& path,
   }
 
   // Each entry is a uint16 + a uint32. We have an extra entry after the last
-  // item so we can compute the size of the list item.
+  // item so we can compute the size of the list item. The hash table, the
+  // data order table and the entry table follow.
   uint32 index_length = (entry_count + 1) * sizeof(DataPackEntry);
-  uint32 data_offset = kHeaderLength + index_length;
+  uint32 hash_table_length = entry_count * kHashTableSlotLength;
+  uint32 data_order_length =
+      entry_count * kDataOrderEntryLength + sizeof(uint32);
+  uint32 entry_table_length = entry_count * kEntryTableEntryLength;
+  uint32 tables_end = kHeaderLength + index_length + hash_table_length +
+      data_order_length + entry_table_length;
+  uint32 data_start = AlignOffset(tables_end, kDataAlignment);
+
+  // Lays out the data, with the padding that aligns each resource after the
+  // data of the previous one.
+  std::vector<base::StringPiece> packed;
+  std::vector<uint32> offsets;
+  std::vector<uint8> attributes;
+  uint32 data_offset = data_start;
   for (std::map<uint16, base::StringPiece>::const_iterator it =
            resources.begin();
        it != resources.end(); ++it) {
+    std::map<uint16, std::string>::const_iterator compressed_data =
+        compressed.find(it->first);
+    base::StringPiece data = it->second;
+    TextEncodingType encoding = textEncodingType;
+    uint32 alignment = 1;
+    if (compressed_data != compressed.end()) {
+      data = compressed_data->second;
+    } else if (IsRawResourceImage(
+                   reinterpret_cast<const unsigned char*>(data.data()),
+                   data.length())) {
+      encoding = BINARY;
+      alignment = kDataAlignment;
+    } else if (encoding == UTF16) {
+      alignment = kTextAlignment;
+    }
+    uint32 offset = AlignOffset(data_offset, alignment);
+    if (!attributes.empty())
+      attributes.back() |= offset - data_offset;
+    packed.push_back(data);
+    offsets.push_back(offset);
+    attributes.push_back(encoding << kEntryEncodingShift);
+    data_offset = offset + data.length();
+  }
+
+  size_t entry = 0;
+  for (std::map<uint16, base::StringPiece>::const_iterator it =
+           resources.begin();
+       it != resources.end(); ++it, ++entry) {
     uint16 resource_id = it->first;
     if (fwrite(&resource_id, sizeof(resource_id), 1, file) != 1) {
       LOG(ERROR) << "Failed to write id for " << resource_id;
@@ -224,13 +667,14 @@ bool DataPack::WritePack(const FilePath& path,
       return false;
     }
 
-    if (fwrite(&data_offset, sizeof(data_offset), 1, file) != 1) {
+    uint32 offset = offsets[entry];
+    if (compressed.find(resource_id) != compressed.end())
+      offset |= kCompressedFlag;
+    if (fwrite(&offset, sizeof(offset), 1, file) != 1) {
       LOG(ERROR) << "Failed to write offset for " << resource_id;
       file_util::CloseFile(file);
       return false;
     }
-
-    data_offset += it->second.length();
   }
 
   // We place an extra entry after the last item that allows us to read the
@@ -248,10 +692,60 @@ bool DataPack::WritePack(const FilePath& path,
     return false;
   }
 
+  if (entry_count) {
+    std::vector<uint16> ids;
+    for (std::map<uint16, base::StringPiece>::const_iterator it =
+             resources.begin();
+         it != resources.end(); ++it) {
+      ids.push_back(it->first);
+    }
+    std::vector<int32> displacements;
+    std::vector<uint16> slots;
+    BuildHashTable(ids, &displacements, &slots);
+    if (fwrite(&displacements[0], sizeof(int32), entry_count, file) !=
+            entry_count ||
+        fwrite(&slots[0], sizeof(uint16), entry_count, file) != entry_count) {
+      LOG(ERROR) << "Failed to write hash table.";
+      file_util::CloseFile(file);
+      return false;
+    }
+  }
+
+  // The data is written in the order of the index, with no hot region.
+  for (uint32 i = 0; i < entry_count; ++i) {
+    uint16 next = i + 1;
+    if (fwrite(&next, sizeof(next), 1, file) != 1) {
+      LOG(ERROR) << "Failed to write data order.";
+      file_util::CloseFile(file);
+      return false;
+    }
+  }
+  uint32 hot_length = 0;
+  if (fwrite(&hot_length, sizeof(hot_length), 1, file) != 1) {
+    LOG(ERROR) << "Failed to write hot region length.";
+    file_util::CloseFile(file);
+    return false;
+  }
+
+  const char padding[kDataAlignment] = { 0 };
+  if ((entry_count &&
+       fwrite(&attributes[0], sizeof(uint8), entry_count, file) !=
+           entry_count) ||
+      fwrite(padding, 1, data_start - tables_end, file) !=
+          data_start - tables_end) {
+    LOG(ERROR) << "Failed to write entry table.";
+    file_util::CloseFile(file);
+    return false;
+  }
+
+  entry = 0;
   for (std::map<uint16, base::StringPiece>::const_iterator it =
            resources.begin();
-       it != resources.end(); ++it) {
-    if (fwrite(it->second.data(), it->second.length(), 1, file) != 1) {
+       it != resources.end(); ++it, ++entry) {
+    const base::StringPiece& data = packed[entry];
+    size_t padding_length = attributes[entry] & kEntryPaddingMask;
+    if (fwrite(data.data(), 1, data.length(), file) != data.length() ||
+        fwrite(padding, 1, padding_length, file) != padding_length) {
       LOG(ERROR) << "Failed to write data for " << it->first;
       file_util::CloseFile(file);
       return false;
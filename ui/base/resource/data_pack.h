@@ -11,9 +11,14 @@
 #pragma once
 
 #include <map>
+#include <set>
+#include <string>
+#include <vector>
 
+#include "base/atomicops.h"
 #include "base/basictypes.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/synchronization/lock.h"
 #include "ui/base/ui_export.h"
 
 class FilePath;
@@ -41,31 +46,74 @@ class UI_EXPORT DataPack {
   DataPack();
   ~DataPack();
 
-  // Load a pack file from |path|, returning false on error.
+  // Load a pack file from |path|, returning false on error. The hot region of
+  // the pack, where the resources used at startup are, is prefetched.
   bool Load(const FilePath& path);
 
   // Get resource by id |resource_id|, filling in |data|.
   // The data is owned by the DataPack object and should not be modified.
-  // Returns false if the resource id isn't found.
+  // Returns false if the resource id isn't found. The resource is found in
+  // constant time with the hash table of the pack, or with a binary search of
+  // its index if it was written before packs had one. Compressed resources
+  // are decompressed the first time they are needed, and kept until the
+  // DataPack is deleted.
   bool GetStringPiece(uint16 resource_id, base::StringPiece* data) const;
 
+  // Like GetStringPiece(), but also sets |encoding| to that of the resource,
+  // which packs written before resources had their own have for all.
+  bool GetStringPieceWithEncoding(uint16 resource_id,
+                                  base::StringPiece* data,
+                                  TextEncodingType* encoding) const;
+
   // Like GetStringPiece(), but returns a reference to memory. This interface
   // is used for image data, while the StringPiece interface is usually used
   // for localization strings.
   RefCountedStaticMemory* GetStaticMemory(uint16 resource_id) const;
 
-  // Writes a pack file containing |resources| to |path|. If there are any
-  // text resources to be written, their encoding must already agree to the
-  // |textEncodingType| specified. If no text resources are present, please
-  // indicate BINARY.
+  // Writes a pack file containing |resources| to |path|, with a hash table
+  // of their ids. If there are any text resources to be written, their
+  // encoding must already agree to the |textEncodingType| specified. If no
+  // text resources are present, please indicate BINARY. The data of UTF-16
+  // resources is aligned to 4 bytes, and that of pre-decoded images to 16, so
+  // that they can be used in place.
   static bool WritePack(const FilePath& path,
                         const std::map<uint16, base::StringPiece>& resources,
                         TextEncodingType textEncodingType);
 
+  // Like WritePack(), but compresses with zlib the resources whose ids are in
+  // |compressed_ids|, unless that doesn't make them smaller. Compressed
+  // resources take less disk space and I/O, at the cost of a copy in memory
+  // once they are read.
+  static bool WritePack(const FilePath& path,
+                        const std::map<uint16, base::StringPiece>& resources,
+                        TextEncodingType textEncodingType,
+                        const std::set<uint16>& compressed_ids);
+
+  // Appends the ids of the resources of the pack to |ids|.
+  void GetResourceIds(std::vector<uint16>* ids) const;
+
+  // Records the resources looked up from now on, in the order they are first
+  // used, for the startup profile of the pack, which lays out the hot region
+  // of the packs the grit tools write (see the --hot-ids option of repack.py).
+  void StartRecordingResourceUse();
+
+  // Writes the ids of the resources recorded so far to |path|, one per line.
+  // Returns false on error.
+  bool WriteResourceUseProfile(const FilePath& path) const;
+
   // Get the encoding type of text resources.
   TextEncodingType GetTextEncodingType() const { return text_encoding_type_; }
 
  private:
+  // Decompresses the |length| bytes of the compressed resource |resource_id|
+  // at |compressed| into |decompressed_|, unless it already is there, and
+  // points |data| to it. Returns false if the data is corrupt.
+  bool GetDecompressed(uint16 resource_id, const uint8* compressed,
+                       size_t length, base::StringPiece* data) const;
+
+  // Adds |resource_id| to |recorded_ids_| if it isn't there yet.
+  void RecordResourceUse(uint16 resource_id) const;
+
   // The memory-mapped data.
   scoped_ptr<file_util::MemoryMappedFile> mmap_;
 
@@ -75,6 +123,28 @@ class UI_EXPORT DataPack {
   // Type of encoding for text resources.
   TextEncodingType text_encoding_type_;
 
+  // Whether the pack has a hash table following its index, whether its index
+  // flags the compressed resources, whether it has a data order table, which
+  // gives the order of the data of the resources, and whether it has an entry
+  // table, which gives the encoding of each resource and the padding after
+  // its data.
+  bool has_hash_table_;
+  bool has_compressed_flags_;
+  bool has_data_order_;
+  bool has_entry_table_;
+
+  // The compressed resources that were read, by id. The lock serializes their
+  // decompression.
+  mutable base::Lock decompressed_lock_;
+  mutable std::map<uint16, std::string> decompressed_;
+
+  // Set by StartRecordingResourceUse(). The lock protects the resources that
+  // were recorded, in the order of their first use.
+  base::subtle::Atomic32 recording_resource_use_;
+  mutable base::Lock recorded_lock_;
+  mutable std::vector<uint16> recorded_ids_;
+  mutable std::set<uint16> recorded_id_set_;
+
   DISALLOW_COPY_AND_ASSIGN(DataPack);
 };
 
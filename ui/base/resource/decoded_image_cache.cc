@@ -0,0 +1,176 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/base/resource/decoded_image_cache.h"
+
+#include "base/logging.h"
+#include "base/memory/ref_counted_memory.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkPixelRef.h"
+#include "third_party/skia/include/core/SkThread.h"
+#include "ui/base/resource/resource_image.h"
+
+namespace ui {
+
+// PurgeablePixelRef -----------------------------------------------------------
+
+// Holds the pixels in a bitmap of its own, which the cache resets to free
+// them. Each pixel ref has its own mutex, rather than Skia's global one, so
+// that decoding doesn't block the locking of other pixel refs.
+class DecodedImageCache::PurgeablePixelRef : public SkPixelRef {
+ public:
+  PurgeablePixelRef(DecodedImageCache* cache,
+                    const SkBitmap& decoded,
+                    RefCountedMemory* png_data)
+      : SkPixelRef(&mutex_),
+        cache_(cache),
+        png_data_(png_data),
+        decoded_(decoded),
+        size_(decoded.getSize()),
+        in_unlocked_list(false) {
+    decoded_.lockPixels();
+  }
+
+  virtual ~PurgeablePixelRef() {
+    cache_->OnDelete(this);
+  }
+
+  size_t size() const { return size_; }
+
+  // Frees the pixels. The cache calls this under its lock, and only when the
+  // pixel ref is not locked.
+  void Purge() {
+    decoded_.reset();
+  }
+
+  // Where the pixel ref is in DecodedImageCache::unlocked_, if it is there.
+  bool in_unlocked_list;
+  PixelRefList::iterator unlocked_position;
+
+ protected:
+  // SkPixelRef overrides. They are called with |mutex_| held.
+  virtual void* onLockPixels(SkColorTable** ctable) {
+    cache_->OnLock(this);
+    *ctable = NULL;
+    if (!decoded_.getPixels()) {
+      SkBitmap bitmap;
+      if (!DecodeResourceImage(png_data_->front(), png_data_->size(),
+                               &bitmap)) {
+        NOTREACHED() << "Unable to decode image resource again";
+        return NULL;
+      }
+      DCHECK_EQ(size_, bitmap.getSize());
+      decoded_ = bitmap;
+      decoded_.lockPixels();
+    }
+    return decoded_.getPixels();
+  }
+
+  virtual void onUnlockPixels() {
+    // There is nothing to free if decoding failed.
+    if (decoded_.getPixels())
+      cache_->OnUnlock(this);
+  }
+
+ private:
+  SkMutex mutex_;
+  scoped_refptr<DecodedImageCache> cache_;
+  scoped_refptr<RefCountedMemory> png_data_;
+
+  // Locked while it has pixels.
+  SkBitmap decoded_;
+  const size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(PurgeablePixelRef);
+};
+
+// DecodedImageCache -----------------------------------------------------------
+
+DecodedImageCache::DecodedImageCache(size_t max_bytes)
+    : max_bytes_(max_bytes),
+      unlocked_bytes_(0) {
+  base::PurgeableCache::Register(this);
+}
+
+DecodedImageCache::~DecodedImageCache() {
+  // Waits for a purge in progress.
+  base::PurgeableCache::Unregister(this);
+  // Each pixel ref holds a reference to the cache.
+  DCHECK(unlocked_.empty());
+}
+
+SkBitmap* DecodedImageCache::CreatePurgeableBitmap(
+    const SkBitmap& decoded,
+    RefCountedMemory* png_data) {
+  DCHECK_EQ(SkBitmap::kARGB_8888_Config, decoded.config());
+  PurgeablePixelRef* pixel_ref =
+      new PurgeablePixelRef(this, decoded, png_data);
+
+  SkBitmap* bitmap = new SkBitmap();
+  bitmap->setConfig(decoded.config(), decoded.width(), decoded.height(),
+                    decoded.rowBytes());
+  bitmap->setIsOpaque(decoded.isOpaque());
+  bitmap->setPixelRef(pixel_ref)->unref();
+
+  // Nothing has locked the pixels yet.
+  OnUnlock(pixel_ref);
+  return bitmap;
+}
+
+size_t DecodedImageCache::GetUnlockedBytes() const {
+  base::AutoLock lock(lock_);
+  return unlocked_bytes_;
+}
+
+void DecodedImageCache::PurgeMemory(
+    base::SystemMonitor::MemoryPressureLevel level) {
+  base::AutoLock lock(lock_);
+  if (level == base::SystemMonitor::MEMORY_PRESSURE_CRITICAL)
+    PurgeUnlocked(0, 0);
+  else
+    PurgeUnlocked(max_bytes_ / 4, 0);
+}
+
+void DecodedImageCache::OnLock(PurgeablePixelRef* pixel_ref) {
+  base::AutoLock lock(lock_);
+  RemoveUnlocked(pixel_ref);
+}
+
+void DecodedImageCache::OnUnlock(PurgeablePixelRef* pixel_ref) {
+  base::AutoLock lock(lock_);
+  DCHECK(!pixel_ref->in_unlocked_list);
+  unlocked_.push_front(pixel_ref);
+  pixel_ref->in_unlocked_list = true;
+  pixel_ref->unlocked_position = unlocked_.begin();
+  unlocked_bytes_ += pixel_ref->size();
+
+  // Keeps at least the pixels that were just used, even when larger than the
+  // budget, since they are the most likely to be used again.
+  PurgeUnlocked(max_bytes_, 1);
+}
+
+void DecodedImageCache::OnDelete(PurgeablePixelRef* pixel_ref) {
+  base::AutoLock lock(lock_);
+  RemoveUnlocked(pixel_ref);
+}
+
+void DecodedImageCache::RemoveUnlocked(PurgeablePixelRef* pixel_ref) {
+  lock_.AssertAcquired();
+  if (!pixel_ref->in_unlocked_list)
+    return;
+  unlocked_.erase(pixel_ref->unlocked_position);
+  pixel_ref->in_unlocked_list = false;
+  unlocked_bytes_ -= pixel_ref->size();
+}
+
+void DecodedImageCache::PurgeUnlocked(size_t max_bytes, size_t min_count) {
+  lock_.AssertAcquired();
+  while (unlocked_bytes_ > max_bytes && unlocked_.size() > min_count) {
+    PurgeablePixelRef* oldest = unlocked_.back();
+    RemoveUnlocked(oldest);
+    oldest->Purge();
+  }
+}
+
+}  // namespace ui
@@ -0,0 +1,95 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef UI_BASE_RESOURCE_DECODED_IMAGE_CACHE_H_
+#define UI_BASE_RESOURCE_DECODED_IMAGE_CACHE_H_
+#pragma once
+
+#include <list>
+
+#include "base/basictypes.h"
+#include "base/memory/purgeable_cache.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/lock.h"
+
+class RefCountedMemory;
+class SkBitmap;
+
+namespace ui {
+
+// Bounds the memory used by the pixels of the images of the ResourceBundle
+// that are not in use. The pixels of the bitmaps that it creates are freed,
+// least recently used first, when the unlocked ones take more than the budget
+// of the cache, and are decoded again from the resource data the next time
+// the bitmap is locked, for example to be drawn. Only the memory of the
+// encoded image, usually mapped from the resource pak, stays in use.
+//
+// The cache is used by the ResourceBundle; see
+// ResourceBundle::SetDecodedImageBudget(). It is thread safe, and the bitmaps
+// that it creates keep it alive. Under memory pressure, it frees the unlocked
+// pixels beyond a quarter of its budget, or all of them when the pressure is
+// critical.
+class DecodedImageCache : public base::RefCountedThreadSafe<DecodedImageCache>,
+                          public base::PurgeableCache {
+ public:
+  explicit DecodedImageCache(size_t max_bytes);
+
+  // Returns a bitmap with the pixels of |decoded|, which is |png_data|
+  // decoded, whose pixels can be freed when no copy of the bitmap has them
+  // locked, and are then decoded again from |png_data| as needed. The caller
+  // owns the returned bitmap. Since the pixels may be decoded again at any
+  // time, they must not be modified.
+  SkBitmap* CreatePurgeableBitmap(const SkBitmap& decoded,
+                                  RefCountedMemory* png_data);
+
+  // Returns the size of the unlocked pixels that are still decoded.
+  size_t GetUnlockedBytes() const;
+
+  // base::PurgeableCache:
+  virtual void PurgeMemory(base::SystemMonitor::MemoryPressureLevel level);
+
+ private:
+  friend class base::RefCountedThreadSafe<DecodedImageCache>;
+
+  // The pixel refs of the bitmaps of the cache; see decoded_image_cache.cc.
+  class PurgeablePixelRef;
+  friend class PurgeablePixelRef;
+  typedef std::list<PurgeablePixelRef*> PixelRefList;
+
+  virtual ~DecodedImageCache();
+
+  // Called by |pixel_ref| when it is first locked, before it decodes its
+  // pixels if they were freed. The cache won't free them from then on.
+  void OnLock(PurgeablePixelRef* pixel_ref);
+
+  // Called by |pixel_ref| once it is no longer locked, or, before it is
+  // deleted, not referenced. Frees the least recently used pixels that do
+  // not fit in the budget.
+  void OnUnlock(PurgeablePixelRef* pixel_ref);
+  void OnDelete(PurgeablePixelRef* pixel_ref);
+
+  // Removes |pixel_ref| from |unlocked_|, if it is there.
+  void RemoveUnlocked(PurgeablePixelRef* pixel_ref);
+
+  // Frees the least recently used unlocked pixels until they take no more
+  // than |max_bytes|, keeping at least |min_count| of them.
+  void PurgeUnlocked(size_t max_bytes, size_t min_count);
+
+  const size_t max_bytes_;
+
+  // Protects the members below, and the decoded pixels of the pixel refs in
+  // |unlocked_|.
+  mutable base::Lock lock_;
+
+  // The pixel refs that are not locked and still have their pixels, most
+  // recently used first, and the size of their pixels.
+  PixelRefList unlocked_;
+  size_t unlocked_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(DecodedImageCache);
+};
+
+}  // namespace ui
+
+#endif  // UI_BASE_RESOURCE_DECODED_IMAGE_CACHE_H_
@@ -4,24 +4,40 @@
 
 #include "ui/base/resource/resource_bundle.h"
 
+#include "base/bind.h"
 #include "base/command_line.h"
 #include "base/file_util.h"
+#include "base/i18n/rtl.h"
+#include "base/lazy_instance.h"
+#include "base/location.h"
 #include "base/logging.h"
+#include "base/message_loop_proxy.h"
+#include "base/metrics/startup_timeline.h"
 #include "base/path_service.h"
 #include "base/stl_util.h"
 #include "base/string_piece.h"
 #include "base/synchronization/lock.h"
+#include "base/synchronization/read_write_lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/worker_pool.h"
 #include "base/utf_string_conversions.h"
 #include "build/build_config.h"
 #include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkPixelRef.h"
 #include "ui/base/l10n/l10n_util.h"
 #include "ui/base/resource/data_pack.h"
+#include "ui/base/resource/decoded_image_cache.h"
+#include "ui/base/resource/resource_image.h"
 #include "ui/base/ui_base_paths.h"
 #include "ui/base/ui_base_switches.h"
-#include "ui/gfx/codec/png_codec.h"
 #include "ui/gfx/font.h"
 #include "ui/gfx/image/image.h"
 
+#if defined(OS_WIN)
+#include "base/win/win_util.h"
+#include "ui/gfx/platform_font_win.h"
+#endif
+
 namespace ui {
 
 namespace {
@@ -37,6 +53,12 @@ const int kMediumFontSizeDelta = 3;
 const int kLargeFontSizeDelta = 8;
 #endif
 
+// Protects the shared instance from being deleted while images are decoded
+// into it by PreDecodeImagesAsync(). Leaky, since the worker thread may still
+// use it at exit.
+base::LazyInstance<base::Lock, base::LeakyLazyInstanceTraits<base::Lock> >
+    g_shared_instance_lock(base::LINKER_INITIALIZED);
+
 }  // namespace
 
 ResourceBundle* ResourceBundle::g_shared_instance_ = NULL;
@@ -68,7 +90,50 @@ std::string ResourceBundle::InitSharedInstance(
   g_shared_instance_ = new ResourceBundle();
 
   g_shared_instance_->LoadCommonResources();
-  return g_shared_instance_->LoadLocaleResources(pref_locale);
+  std::string locale = g_shared_instance_->LoadLocaleResources(pref_locale);
+  base::StartupTimeline::RecordMilestone("ResourceBundleInit");
+  return locale;
+}
+
+/* static */
+std::string ResourceBundle::InitSharedInstanceAsync(
+    const std::string& pref_locale) {
+  DCHECK(g_shared_instance_ == NULL) << "ResourceBundle initialized twice";
+  g_shared_instance_ = new ResourceBundle();
+
+  // Choosing the locale looks at which packs there are, and the switches, so
+  // it is done here, leaving the mapping of the packs to the workers.
+  std::string app_locale = l10n_util::GetApplicationLocale(pref_locale);
+  FilePath locale_file_path =
+      g_shared_instance_->GetLocaleResourcesPath(app_locale);
+  if (locale_file_path.empty()) {
+    // It's possible that there is no locale.pak.
+    NOTREACHED();
+    app_locale.clear();
+  }
+
+  ResourceBundle* bundle = g_shared_instance_;
+  bundle->async_loads_done_.reset(new base::WaitableEvent(true, false));
+  base::subtle::NoBarrier_Store(&bundle->pending_async_loads_,
+                                locale_file_path.empty() ? 1 : 2);
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&ResourceBundle::LoadCommonResourcesAsync,
+                 base::Unretained(bundle)),
+      false);
+  if (!locale_file_path.empty()) {
+    base::WorkerPool::PostTask(
+        FROM_HERE,
+        base::Bind(&ResourceBundle::LoadLocaleResourcesAsync,
+                   base::Unretained(bundle), locale_file_path),
+        false);
+  }
+#if defined(OS_WIN)
+  base::WorkerPool::PostTask(FROM_HERE,
+                             base::Bind(&ResourceBundle::WarmUpFonts),
+                             false);
+#endif
+  return app_locale;
 }
 
 /* static */
@@ -96,17 +161,30 @@ std::string ResourceBundle::ReloadSharedInstance(
   DCHECK(g_shared_instance_ != NULL) << "ResourceBundle not initialized";
 
   g_shared_instance_->UnloadLocaleResources();
+#if defined(OS_WIN)
+  // The text direction, which text is measured with, may have changed.
+  gfx::PlatformFontWin::ClearTextCaches();
+#endif
   return g_shared_instance_->LoadLocaleResources(pref_locale);
 }
 
 /* static */
 void ResourceBundle::AddDataPackToSharedInstance(const FilePath& path) {
   DCHECK(g_shared_instance_ != NULL) << "ResourceBundle not initialized";
-  g_shared_instance_->data_packs_.push_back(new LoadedDataPack(path));
+  LoadedDataPack* data_pack = new LoadedDataPack(path);
+  g_shared_instance_->data_packs_.push_back(data_pack);
+  std::vector<uint16> ids;
+  data_pack->GetResourceIds(&ids);
+  DataPackIndex& index = g_shared_instance_->data_pack_index_;
+  index.reserve(index.size() + ids.size());
+  // The packs added before keep the ids they have too.
+  for (size_t i = 0; i < ids.size(); ++i)
+    index.insert(std::make_pair(static_cast<int>(ids[i]), data_pack));
 }
 
 /* static */
 void ResourceBundle::CleanupSharedInstance() {
+  base::AutoLock lock(g_shared_instance_lock.Get());
   if (g_shared_instance_) {
     delete g_shared_instance_;
     g_shared_instance_ = NULL;
@@ -145,6 +223,18 @@ std::string ResourceBundle::LoadLocaleResources(
     const std::string& pref_locale) {
   DCHECK(!locale_resources_data_.get()) << "locale.pak already loaded";
   std::string app_locale = l10n_util::GetApplicationLocale(pref_locale);
+  FilePath locale_file_path = GetLocaleResourcesPath(app_locale);
+  if (locale_file_path.empty()) {
+    // It's possible that there is no locale.pak.
+    NOTREACHED();
+    return std::string();
+  }
+  LoadLocaleResourcesFromPath(locale_file_path);
+  return app_locale;
+}
+
+FilePath ResourceBundle::GetLocaleResourcesPath(
+    const std::string& app_locale) {
   FilePath locale_file_path = GetOverriddenPakPath();
   if (locale_file_path.empty()) {
     CommandLine *command_line = CommandLine::ForCurrentProcess();
@@ -155,21 +245,54 @@ std::string ResourceBundle::LoadLocaleResources(
       locale_file_path = GetLocaleFilePath(app_locale);
     }
   }
-  if (locale_file_path.empty()) {
-    // It's possible that there is no locale.pak.
-    NOTREACHED();
-    return std::string();
-  }
+  return locale_file_path;
+}
+
+void ResourceBundle::LoadLocaleResourcesFromPath(
+    const FilePath& locale_file_path) {
   locale_resources_data_.reset(LoadResourcesDataPak(locale_file_path));
   CHECK(locale_resources_data_.get()) << "failed to load locale.pak";
-  return app_locale;
+}
+
+void ResourceBundle::LoadCommonResourcesAsync() {
+  LoadCommonResources();
+  AsyncLoadDone();
+}
+
+void ResourceBundle::LoadLocaleResourcesAsync(
+    const FilePath& locale_file_path) {
+  LoadLocaleResourcesFromPath(locale_file_path);
+  AsyncLoadDone();
+}
+
+void ResourceBundle::AsyncLoadDone() {
+  if (base::subtle::Barrier_AtomicIncrement(&pending_async_loads_, -1) == 0) {
+    base::StartupTimeline::RecordMilestone("ResourceBundleInit");
+    async_loads_done_->Signal();
+  }
+}
+
+void ResourceBundle::WaitForAsyncLoads() const {
+  if (!base::subtle::Acquire_Load(&pending_async_loads_))
+    return;
+  base::StartupTimeline::ScopedStep step("ResourceBundleWait");
+  async_loads_done_->Wait();
 }
 
 void ResourceBundle::UnloadLocaleResources() {
+  WaitForAsyncLoads();
+  {
+    base::AutoWriteLock lock_scope(*cache_lock_);
+    STLDeleteContainerPairSecondPointers(localized_strings_.begin(),
+                                         localized_strings_.end());
+    localized_strings_.clear();
+  }
   locale_resources_data_.reset();
 }
 
 string16 ResourceBundle::GetLocalizedString(int message_id) {
+  WaitForAsyncLoads();
+
   // If for some reason we were unable to load a resource pak, return an empty
   // string (better than crashing).
   if (!locale_resources_data_.get()) {
@@ -204,6 +327,55 @@ string16 ResourceBundle::GetLocalizedString(int message_id) {
   return msg;
 }
 
+base::StringPiece16 ResourceBundle::GetLocalizedStringPiece(int message_id) {
+  WaitForAsyncLoads();
+  if (!locale_resources_data_.get()) {
+    LOG(WARNING) << "locale resources are not loaded";
+    return base::StringPiece16();
+  }
+
+  {
+    base::AutoReadLock lock_scope(*cache_lock_);
+    LocalizedStringMap::const_iterator found =
+        localized_strings_.find(message_id);
+    if (found != localized_strings_.end())
+      return *found->second;
+  }
+
+  // The strings are used in place if they are UTF-16 and aligned, as the
+  // packs the grit tools write have them.
+  base::StringPiece data;
+  DataPack::TextEncodingType encoding;
+  if (locale_resources_data_->GetStringPieceWithEncoding(message_id, &data,
+                                                         &encoding) &&
+      encoding == DataPack::UTF16 &&
+      reinterpret_cast<uintptr_t>(data.data()) % sizeof(char16) == 0) {
+    base::StringPiece16 msg(reinterpret_cast<const char16*>(data.data()),
+                            data.length() / 2);
+    bool needs_mark = false;
+#if defined(OS_POSIX) && !defined(OS_MACOSX)
+    // l10n_util::GetStringUTF16() starts these with a right-to-left mark,
+    // which the pack doesn't have.
+    needs_mark = base::i18n::IsRTL() &&
+        base::i18n::StringContainsStrongRTLChars(msg.as_string16());
+#endif
+    if (!needs_mark)
+      return msg;
+  }
+
+  // The string has to be made: converted from UTF-8, found in the main data
+  // pack (which is only done in unittests), or given the mark.
+  string16 str = l10n_util::GetStringUTF16(message_id);
+  base::AutoWriteLock lock_scope(*cache_lock_);
+  std::pair<LocalizedStringMap::iterator, bool> inserted =
+      localized_strings_.insert(std::make_pair(message_id,
+                                               static_cast<string16*>(NULL)));
+  // Another thread may have made the string in the meantime.
+  if (inserted.second)
+    inserted.first->second = new string16(str);
+  return *inserted.first->second;
+}
+
 void ResourceBundle::OverrideLocalePakForTest(const FilePath& pak_path) {
   overridden_pak_path_ = pak_path;
 }
@@ -221,22 +393,32 @@ SkBitmap* ResourceBundle::GetBitmapNamed(int resource_id) {
 gfx::Image& ResourceBundle::GetImageNamed(int resource_id) {
   // Check to see if the image is already in the cache.
   {
-    base::AutoLock lock_scope(*lock_);
+    base::AutoReadLock lock_scope(*cache_lock_);
     ImageMap::const_iterator found = images_.find(resource_id);
     if (found != images_.end())
       return *found->second;
   }
 
+  scoped_refptr<DecodedImageCache> decoded_image_cache;
+  {
+    base::AutoLock lock_scope(*lock_);
+    decoded_image_cache = decoded_image_cache_;
+  }
+
+  WaitForAsyncLoads();
   DCHECK(resources_data_) << "Missing call to SetResourcesDataDLL?";
-  scoped_ptr<SkBitmap> bitmap(LoadBitmap(resources_data_, resource_id));
+  scoped_ptr<SkBitmap> bitmap(LoadBitmap(resources_data_, resource_id,
+                                         decoded_image_cache));
   if (bitmap.get()) {
     // Check if there's a large version of the image as well.
     scoped_ptr<SkBitmap> large_bitmap;
-    if (large_icon_resources_data_)
-      large_bitmap.reset(LoadBitmap(large_icon_resources_data_, resource_id));
+    if (large_icon_resources_data_) {
+      large_bitmap.reset(LoadBitmap(large_icon_resources_data_, resource_id,
+                                    decoded_image_cache));
+    }
 
     // The load was successful, so cache the image.
-    base::AutoLock lock_scope(*lock_);
+    base::AutoWriteLock lock_scope(*cache_lock_);
 
     // Another thread raced the load and has already cached the image.
     if (images_.count(resource_id))
@@ -257,22 +439,63 @@ gfx::Image& ResourceBundle::GetImageNamed(int resource_id) {
   return *GetEmptyImage();
 }
 
+void ResourceBundle::PreDecodeImagesAsync(
+    const std::vector<int>& resource_ids) {
+  DCHECK_EQ(this, g_shared_instance_);
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&ResourceBundle::PreDecodeImages, resource_ids),
+      false);
+}
+
+void ResourceBundle::SetDecodedImageBudget(size_t max_bytes) {
+  base::AutoLock lock_scope(*lock_);
+  if (max_bytes)
+    decoded_image_cache_ = new DecodedImageCache(max_bytes);
+  else
+    decoded_image_cache_ = NULL;
+}
+
+void ResourceBundle::StartRecordingResourceUse() {
+  WaitForAsyncLoads();
+  if (locale_resources_data_.get())
+    locale_resources_data_->StartRecordingResourceUse();
+  for (size_t i = 0; i < data_packs_.size(); ++i)
+    data_packs_[i]->StartRecordingResourceUse();
+}
+
+bool ResourceBundle::WriteResourceUseProfiles(const FilePath& dir) const {
+  WaitForAsyncLoads();
+  bool success = true;
+  if (locale_resources_data_.get()) {
+    success &= locale_resources_data_->WriteResourceUseProfile(
+        dir.AppendASCII("locale.ids"));
+  }
+  for (size_t i = 0; i < data_packs_.size(); ++i)
+    success &= data_packs_[i]->WriteResourceUseProfile(dir);
+  return success;
+}
+
 RefCountedStaticMemory* ResourceBundle::LoadDataResourceBytes(
     int resource_id) const {
+  WaitForAsyncLoads();
   RefCountedStaticMemory* bytes =
       LoadResourceBytes(resources_data_, resource_id);
 
-  // Check all our additional data packs for the resources if it wasn't loaded
+  // Check our additional data packs for the resources if it wasn't loaded
   // from our main source.
-  for (std::vector<LoadedDataPack*>::const_iterator it = data_packs_.begin();
-       !bytes && it != data_packs_.end(); ++it) {
-    bytes = (*it)->GetStaticMemory(resource_id);
+  if (!bytes) {
+    const LoadedDataPack* data_pack = FindDataPack(resource_id);
+    if (data_pack)
+      bytes = data_pack->GetStaticMemory(resource_id);
   }
 
   return bytes;
 }
 
 const gfx::Font& ResourceBundle::GetFont(FontStyle style) {
+  // The fonts are adjusted for the locale.
+  WaitForAsyncLoads();
   {
     base::AutoLock lock_scope(*lock_);
     LoadFontsIfNecessary();
@@ -295,14 +518,163 @@ const gfx::Font& ResourceBundle::GetFont(FontStyle style) {
   }
 }
 
+#if defined(OS_WIN)
+// Measures the base font, then the fonts kFontLoadSpecs derives from it.
+class ResourceBundle::FontLoadJob
+    : public base::RefCountedThreadSafe<FontLoadJob> {
+ public:
+  // How each font other than the base font is derived from it.
+  struct FontLoadSpec {
+    scoped_ptr<gfx::Font> ResourceBundle::*font;
+    int size_delta;
+    int style;
+  };
+  static const FontLoadSpec kFontLoadSpecs[];
+  static const size_t kFontLoadSpecCount;
+
+  FontLoadJob()
+      : origin_loop_(base::MessageLoopProxy::current()) {
+    // The callbacks that adjust the fonts for the locale read its resources,
+    // so the font infos are set up here, on the UI thread.
+    LOGFONT base_font_info;
+    gfx::PlatformFontWin::GetBaseFontInfo(&base_font_info);
+    int base_style = 0;
+    if (base_font_info.lfItalic)
+      base_style |= gfx::Font::ITALIC;
+    if (base_font_info.lfUnderline)
+      base_style |= gfx::Font::UNDERLINED;
+    if (base_font_info.lfWeight >= FW_BOLD)
+      base_style |= gfx::Font::BOLD;
+    font_infos_.push_back(base_font_info);
+    for (size_t i = 0; i < kFontLoadSpecCount; ++i) {
+      LOGFONT font_info = base_font_info;
+      gfx::PlatformFontWin::DeriveFontInfo(kFontLoadSpecs[i].size_delta,
+                                           base_style | kFontLoadSpecs[i].style,
+                                           &font_info);
+      font_infos_.push_back(font_info);
+    }
+  }
+
+  void Start() {
+    base::WorkerPool::PostTask(FROM_HERE,
+                               base::Bind(&FontLoadJob::Measure, this),
+                               false);
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<FontLoadJob>;
+
+  ~FontLoadJob() {
+    DeleteFonts();
+  }
+
+  // Runs on the worker thread.
+  void Measure() {
+    for (size_t i = 0; i < font_infos_.size(); ++i) {
+      gfx::PlatformFontWin::MeasuredFont font;
+      if (!gfx::PlatformFontWin::CreateMeasuredFont(font_infos_[i], &font)) {
+        DeleteFonts();
+        return;
+      }
+      fonts_.push_back(font);
+    }
+    origin_loop_->PostTask(FROM_HERE, base::Bind(&FontLoadJob::Done, this));
+  }
+
+  // Runs on the UI thread. Makes the fonts those of GetFont(), unless they
+  // were loaded since.
+  void Done() {
+    if (g_shared_instance_)
+      SetFonts(g_shared_instance_);
+    DeleteFonts();
+  }
+
+  void SetFonts(ResourceBundle* bundle) {
+    DCHECK_EQ(kFontLoadSpecCount + 1, fonts_.size());
+    base::AutoLock lock_scope(*bundle->lock_);
+    if (bundle->base_font_.get())
+      return;
+
+    // The base font of the fonts is that of their HFontRef.
+    gfx::PlatformFontWin::SetBaseFont(fonts_[0]);
+    bundle->base_font_.reset(new gfx::Font());
+    for (size_t i = 0; i < kFontLoadSpecCount; ++i) {
+      (bundle->*kFontLoadSpecs[i].font).reset(
+          new gfx::Font(new gfx::PlatformFontWin(fonts_[i + 1])));
+    }
+    // The fonts own the HFONTs now.
+    fonts_.clear();
+  }
+
+  // Deletes the fonts that weren't handed to the ResourceBundle.
+  void DeleteFonts() {
+    for (size_t i = 0; i < fonts_.size(); ++i)
+      DeleteObject(fonts_[i].hfont);
+    fonts_.clear();
+  }
+
+  std::vector<LOGFONT> font_infos_;
+  std::vector<gfx::PlatformFontWin::MeasuredFont> fonts_;
+
+  const scoped_refptr<base::MessageLoopProxy> origin_loop_;
+
+  DISALLOW_COPY_AND_ASSIGN(FontLoadJob);
+};
+
+// static
+const ResourceBundle::FontLoadJob::FontLoadSpec
+    ResourceBundle::FontLoadJob::kFontLoadSpecs[] = {
+  { &ResourceBundle::bold_font_, 0, gfx::Font::BOLD },
+  { &ResourceBundle::small_font_, kSmallFontSizeDelta, 0 },
+  { &ResourceBundle::medium_font_, kMediumFontSizeDelta, 0 },
+  { &ResourceBundle::medium_bold_font_, kMediumFontSizeDelta,
+    gfx::Font::BOLD },
+  { &ResourceBundle::large_font_, kLargeFontSizeDelta, 0 },
+  { &ResourceBundle::large_bold_font_, kLargeFontSizeDelta, gfx::Font::BOLD },
+};
+
+// static
+const size_t ResourceBundle::FontLoadJob::kFontLoadSpecCount =
+    arraysize(ResourceBundle::FontLoadJob::kFontLoadSpecs);
+
+void ResourceBundle::LoadFontsAsync() {
+  DCHECK_EQ(this, g_shared_instance_);
+  WaitForAsyncLoads();
+  {
+    base::AutoLock lock_scope(*lock_);
+    if (base_font_.get())
+      return;
+  }
+  scoped_refptr<FontLoadJob> job(new FontLoadJob);
+  job->Start();
+}
+
+/* static */
+void ResourceBundle::WarmUpFonts() {
+  // The LOGFONT isn't adjusted for the locale, which the font files loaded
+  // don't depend on, so that this doesn't wait for the locale pack.
+  NONCLIENTMETRICS metrics;
+  base::win::GetNonClientMetrics(&metrics);
+  gfx::PlatformFontWin::MeasuredFont font;
+  if (gfx::PlatformFontWin::CreateMeasuredFont(metrics.lfMessageFont, &font))
+    DeleteObject(font.hfont);
+}
+#endif  // defined(OS_WIN)
+
 void ResourceBundle::ReloadFonts() {
+  WaitForAsyncLoads();
   base::AutoLock lock_scope(*lock_);
   base_font_.reset();
+#if defined(OS_WIN)
+  gfx::PlatformFontWin::ClearTextCaches();
+#endif
   LoadFontsIfNecessary();
 }
 
 ResourceBundle::ResourceBundle()
     : lock_(new base::Lock),
+      cache_lock_(new base::ReadWriteLock),
+      pending_async_loads_(0),
       resources_data_(NULL),
       large_icon_resources_data_(NULL) {
 }
@@ -313,6 +685,24 @@ void ResourceBundle::FreeImages() {
   images_.clear();
 }
 
+/* static */
+void ResourceBundle::PreDecodeImages(const std::vector<int>& resource_ids) {
+  for (size_t i = 0; i < resource_ids.size(); ++i) {
+    // Holds the lock for one image at a time, so that CleanupSharedInstance()
+    // waits for at most one decode.
+    base::AutoLock lock(g_shared_instance_lock.Get());
+    if (!g_shared_instance_)
+      return;
+    g_shared_instance_->GetImageNamed(resource_ids[i]);
+  }
+}
+
+const ResourceBundle::LoadedDataPack* ResourceBundle::FindDataPack(
+    int resource_id) const {
+  DataPackIndex::const_iterator found = data_pack_index_.find(resource_id);
+  return found != data_pack_index_.end() ? found->second : NULL;
+}
+
 void ResourceBundle::LoadFontsIfNecessary() {
   lock_->AssertAcquired();
   if (!base_font_.get()) {
@@ -344,19 +734,31 @@ void ResourceBundle::LoadFontsIfNecessary() {
 }
 
 /* static */
-SkBitmap* ResourceBundle::LoadBitmap(DataHandle data_handle, int resource_id) {
+SkBitmap* ResourceBundle::LoadBitmap(DataHandle data_handle, int resource_id,
+                                     DecodedImageCache* cache) {
   scoped_refptr<RefCountedMemory> memory(
       LoadResourceBytes(data_handle, resource_id));
   if (!memory)
     return NULL;
 
   SkBitmap bitmap;
-  if (!gfx::PNGCodec::Decode(memory->front(), memory->size(), &bitmap)) {
+  if (!DecodeResourceImage(memory->front(), memory->size(), &bitmap)) {
     NOTREACHED() << "Unable to decode theme image resource " << resource_id;
     return NULL;
   }
 
-  return new SkBitmap(bitmap);
+  // Pre-decoded images use the memory of the pack, so there's nothing to
+  // purge.
+  SkBitmap* result;
+  if (cache && !IsRawResourceImage(memory->front(), memory->size()))
+    result = cache->CreatePurgeableBitmap(bitmap, memory);
+  else
+    result = new SkBitmap(bitmap);
+  // The resource bitmaps are shared, and never change, which lets
+  // SkBitmapOperations cache what it makes of them.
+  if (result && result->pixelRef())
+    result->pixelRef()->setImmutable();
+  return result;
 }
 
 gfx::Image* ResourceBundle::GetEmptyImage() {
@@ -410,4 +812,23 @@ RefCountedStaticMemory* ResourceBundle::LoadedDataPack::GetStaticMemory(
   return data_pack_->GetStaticMemory(resource_id);
 }
 
+void ResourceBundle::LoadedDataPack::GetResourceIds(
+    std::vector<uint16>* ids) const {
+  if (data_pack_.get())
+    data_pack_->GetResourceIds(ids);
+}
+
+void ResourceBundle::LoadedDataPack::StartRecordingResourceUse() {
+  if (data_pack_.get())
+    data_pack_->StartRecordingResourceUse();
+}
+
+bool ResourceBundle::LoadedDataPack::WriteResourceUseProfile(
+    const FilePath& dir) const {
+  if (!data_pack_.get())
+    return true;
+  return data_pack_->WriteResourceUseProfile(
+      dir.Append(path_.BaseName().ReplaceExtension(FILE_PATH_LITERAL("ids"))));
+}
+
 }  // namespace ui
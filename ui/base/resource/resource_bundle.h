@@ -12,12 +12,13 @@
 #include <windows.h>
 #endif
 
-#include <map>
 #include <string>
 #include <vector>
 
+#include "base/atomicops.h"
 #include "base/basictypes.h"
 #include "base/file_path.h"
+#include "base/flat_hash_tables.h"
 #include "base/gtest_prod_util.h"
 #include "base/memory/ref_counted_memory.h"
 #include "base/memory/scoped_ptr.h"
@@ -30,7 +31,10 @@ typedef uint32 SkColor;
 
 namespace base {
 class Lock;
+class ReadWriteLock;
 class StringPiece;
+class StringPiece16;
+class WaitableEvent;
 }
 
 namespace gfx {
@@ -53,6 +57,7 @@ typedef struct _GdkPixbuf GdkPixbuf;
 namespace ui {
 
 class DataPack;
+class DecodedImageCache;
 
 // ResourceBundle is a central facility to load images and other resources,
 // such as theme graphics.
@@ -80,6 +85,13 @@ class UI_EXPORT ResourceBundle {
   // defined by the Cocoa UI (ie-NSBundle does the langange work).
   static std::string InitSharedInstance(const std::string& pref_locale);
 
+  // Like InitSharedInstance(), but returns as soon as the locale is chosen:
+  // the common and locale data packs are mapped and checked, which touches
+  // the pages of their indexes and prefetches their hot regions, on worker
+  // threads, while the files of the system UI font are loaded on another.
+  // The first use of a resource before the packs are loaded waits for them.
+  static std::string InitSharedInstanceAsync(const std::string& pref_locale);
+
   // Initialize the ResourceBundle using given data pack path for testing.
   static void InitSharedInstanceForTest(const FilePath& path);
 
@@ -119,6 +131,10 @@ class UI_EXPORT ResourceBundle {
 
   // Gets an image resource from the current module data. This will load the
   // image in Skia format by default. The ResourceBundle owns this.
+  //
+  // The bitmaps of the images that repack.py pre-decoded use the pixels in
+  // the data pack, which is read-only: they and their copies stay valid only
+  // while the pack is loaded, and their pixel refs are immutable.
   gfx::Image& GetImageNamed(int resource_id);
 
   // Similar to GetImageNamed, but rather than loading the image in Skia format,
@@ -130,6 +146,38 @@ class UI_EXPORT ResourceBundle {
   // loading code of ResourceBundle.
   gfx::Image& GetNativeImageNamed(int resource_id);
 
+  // Decodes the images with the given resource ids on a worker thread, so
+  // that the first GetImageNamed() of each of them, usually on the UI thread,
+  // finds it already decoded. Meant for the images needed at startup.
+  void PreDecodeImagesAsync(const std::vector<int>& resource_ids);
+
+  // Decodes the images like PreDecodeImagesAsync(), but on the calling
+  // thread, which may be any, as long as there is a shared instance. For
+  // work that is already on a worker thread.
+  static void PreDecodeImages(const std::vector<int>& resource_ids);
+
+  // Bounds the memory used by the pixels of the images loaded from now on that
+  // are not in use, that is whose pixels no bitmap has locked: when they take
+  // more than |max_bytes|, the least recently used are freed, and decoded
+  // again from the resource data the next time they are locked. The images
+  // stay valid, but their pixels must not be modified, and no copy of them
+  // may outlive the ResourceBundle. Passing 0 keeps all the pixels of the
+  // images loaded from then on, which is the default.
+  void SetDecodedImageBudget(size_t max_bytes);
+
+  // Starts the startup profile mode: records the resources used from the data
+  // packs from now on, until WriteResourceUseProfiles() writes them. Meant to
+  // be called right after InitSharedInstance(), and the profiles written a few
+  // seconds into startup.
+  void StartRecordingResourceUse();
+
+  // Writes the startup profile of each data pack to |dir|: "locale.ids" for
+  // the locale pack, and the name of the pack with an ".ids" extension for
+  // the others. The profiles are then given to the grit repack tool, which
+  // lays out the resources they list at the start of the packs, where
+  // DataPack::Load() prefetches them. Returns false on error.
+  bool WriteResourceUseProfiles(const FilePath& dir) const;
+
   // Loads the raw bytes of a data resource into |bytes|,
   // without doing any processing or interpretation of
   // the resource. Returns whether we successfully read the resource.
@@ -142,6 +190,14 @@ class UI_EXPORT ResourceBundle {
   // string if the message_id is not found.
   string16 GetLocalizedString(int message_id);
 
+  // Returns the string l10n_util::GetStringUTF16() returns for |message_id|,
+  // without copying it. The string points into the locale pack when the pack
+  // is UTF-16 and the string is used as is, otherwise it is converted the
+  // first time it's asked for and kept. It stays valid until the locale
+  // resources are unloaded, by ReloadSharedInstance() or
+  // CleanupSharedInstance().
+  base::StringPiece16 GetLocalizedStringPiece(int message_id);
+
   // Returns the font for the specified style.
   const gfx::Font& GetFont(FontStyle style);
 
@@ -149,6 +205,15 @@ class UI_EXPORT ResourceBundle {
   // system have changed, for example, when the locale has changed.
   void ReloadFonts();
 
+#if defined(OS_WIN)
+  // Creates the fonts of GetFont() and measures them on a worker thread, so
+  // that the first GetFont(), usually on the UI thread at startup, doesn't
+  // wait for GDI to load the font files. The fonts, including the UI font of
+  // the locale, are handed back to the thread this is called on, which must
+  // be the UI thread. Does nothing if the fonts were loaded by then.
+  void LoadFontsAsync();
+#endif
+
   // Overrides the path to the pak file from which the locale resources will be
   // loaded. Pass an empty path to undo.
   void OverrideLocalePakForTest(const FilePath& pak_path);
@@ -203,6 +268,9 @@ class UI_EXPORT ResourceBundle {
     ~LoadedDataPack();
     bool GetStringPiece(int resource_id, base::StringPiece* data) const;
     RefCountedStaticMemory* GetStaticMemory(int resource_id) const;
+    void GetResourceIds(std::vector<uint16>* ids) const;
+    void StartRecordingResourceUse();
+    bool WriteResourceUseProfile(const FilePath& dir) const;
 
    private:
     void Load();
@@ -230,6 +298,9 @@ class UI_EXPORT ResourceBundle {
   // Free skia_images_.
   void FreeImages();
 
+  // Returns the first of |data_packs_| that has |resource_id|, or NULL.
+  const LoadedDataPack* FindDataPack(int resource_id) const;
+
   // Load the main resources.
   void LoadCommonResources();
 
@@ -237,6 +308,23 @@ class UI_EXPORT ResourceBundle {
   // Returns the locale that is loaded.
   std::string LoadLocaleResources(const std::string& pref_locale);
 
+  // Returns the path of the pack LoadLocaleResources() loads for
+  // |app_locale|, or an empty path if there is none.
+  FilePath GetLocaleResourcesPath(const std::string& app_locale);
+
+  // Loads the locale pack at |locale_file_path|.
+  void LoadLocaleResourcesFromPath(const FilePath& locale_file_path);
+
+  // The loads of InitSharedInstanceAsync(), which run on worker threads.
+  void LoadCommonResourcesAsync();
+  void LoadLocaleResourcesAsync(const FilePath& locale_file_path);
+
+  // Called on a worker thread when one of the loads above is done.
+  void AsyncLoadDone();
+
+  // Blocks until the loads of InitSharedInstanceAsync(), if any, are done.
+  void WaitForAsyncLoads() const;
+
   // Load test resources in given path.
   void LoadTestResources(const FilePath& path);
 
@@ -247,6 +335,17 @@ class UI_EXPORT ResourceBundle {
   // Initialize all the gfx::Font members if they haven't yet been initialized.
   void LoadFontsIfNecessary();
 
+#if defined(OS_WIN)
+  // Creates and measures the system UI font and throws it away, on a worker
+  // thread, so that the font files are loaded by the time GetFont() is first
+  // called.
+  static void WarmUpFonts();
+
+  // Creates and measures the fonts of LoadFontsAsync() on a worker thread.
+  class FontLoadJob;
+  friend class FontLoadJob;
+#endif
+
 #if defined(OS_POSIX)
   // Returns the full pathname of the main resources file to load.  May return
   // an empty string if no main resources data files are found.
@@ -268,8 +367,10 @@ class UI_EXPORT ResourceBundle {
 
   // Creates and returns a new SkBitmap given the data file to look in and the
   // resource id.  It's up to the caller to free the returned bitmap when
-  // done.
-  static SkBitmap* LoadBitmap(DataHandle dll_inst, int resource_id);
+  // done. If |cache| is not NULL, it may free the pixels of the bitmap when
+  // they are not in use.
+  static SkBitmap* LoadBitmap(DataHandle dll_inst, int resource_id,
+                              DecodedImageCache* cache);
 
   // Returns an empty image for when a resource cannot be loaded. This is a
   // bright red bitmap.
@@ -278,9 +379,20 @@ class UI_EXPORT ResourceBundle {
   const FilePath& GetOverriddenPakPath();
 
   // Class level lock.  Used to protect internal data structures that may be
-  // accessed from other threads (e.g., images_).
+  // accessed from other threads (e.g., the fonts).
   scoped_ptr<base::Lock> lock_;
 
+  // Protects images_ and localized_strings_, which are looked up with it held
+  // for reading, so that the threads finding their images and strings in
+  // them don't wait on each other.
+  scoped_ptr<base::ReadWriteLock> cache_lock_;
+
+  // The number of loads of InitSharedInstanceAsync() that aren't done, read
+  // without a lock by WaitForAsyncLoads(), and the event signaled when there
+  // are none left, which is NULL if the ResourceBundle was loaded in place.
+  base::subtle::Atomic32 pending_async_loads_;
+  scoped_ptr<base::WaitableEvent> async_loads_done_;
+
   // Handles for data sources.
   DataHandle resources_data_;
   DataHandle large_icon_resources_data_;
@@ -289,11 +401,27 @@ class UI_EXPORT ResourceBundle {
   // References to extra data packs loaded via AddDataPackToSharedInstance.
   std::vector<LoadedDataPack*> data_packs_;
 
+  // The first of |data_packs_| that has each resource id, so that a lookup
+  // costs one search rather than one per pack. Like |data_packs_|, it only
+  // changes before the bundle is used from other threads, so it is read
+  // without a lock.
+  typedef base::FlatHashMap<int, const LoadedDataPack*> DataPackIndex;
+  DataPackIndex data_pack_index_;
+
   // Cached images. The ResourceBundle caches all retrieved images and keeps
   // ownership of the pointers.
-  typedef std::map<int, gfx::Image*> ImageMap;
+  typedef base::FlatHashMap<int, gfx::Image*> ImageMap;
   ImageMap images_;
 
+  // The localized strings that GetLocalizedStringPiece() couldn't point into
+  // the locale pack for, which the ResourceBundle owns.
+  typedef base::FlatHashMap<int, string16*> LocalizedStringMap;
+  LocalizedStringMap localized_strings_;
+
+  // Bounds the memory of the pixels of the images that are not in use, if
+  // SetDecodedImageBudget() was called. Protected by |lock_|.
+  scoped_refptr<DecodedImageCache> decoded_image_cache_;
+
   // The various fonts used. Cached to avoid repeated GDI creation/destruction.
   scoped_ptr<gfx::Font> base_font_;
   scoped_ptr<gfx::Font> bold_font_;
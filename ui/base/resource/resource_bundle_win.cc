@@ -15,6 +15,7 @@
 #include "base/win/resource_util.h"
 #include "base/win/windows_version.h"
 #include "ui/base/resource/data_pack.h"
+#include "ui/base/resource/decoded_image_cache.h"
 #include "ui/gfx/font.h"
 
 namespace ui {
@@ -34,6 +35,8 @@ DWORD GetDataDllLoadFlags() {
 }  // end anonymous namespace
 
 ResourceBundle::~ResourceBundle() {
+  // The workers of InitSharedInstanceAsync() load into this.
+  WaitForAsyncLoads();
   FreeImages();
   UnloadLocaleResources();
   STLDeleteContainerPointers(data_packs_.begin(),
@@ -77,10 +80,12 @@ void ResourceBundle::SetResourcesDataDLL(HINSTANCE handle) {
 }
 
 HICON ResourceBundle::LoadThemeIcon(int icon_id) {
+  WaitForAsyncLoads();
   return ::LoadIcon(resources_data_, MAKEINTRESOURCE(icon_id));
 }
 
 base::StringPiece ResourceBundle::GetRawDataResource(int resource_id) const {
+  WaitForAsyncLoads();
   void* data_ptr;
   size_t data_size;
   base::StringPiece data;
@@ -103,16 +108,16 @@ base::StringPiece ResourceBundle::GetRawDataResource(int resource_id) const {
                              image->nLength * 2);
   }
 
-  for (size_t i = 0; i < data_packs_.size(); ++i) {
-    if (data_packs_[i]->GetStringPiece(resource_id, &data))
-      return data;
-  }
+  const LoadedDataPack* data_pack = FindDataPack(resource_id);
+  if (data_pack && data_pack->GetStringPiece(resource_id, &data))
+    return data;
 
   return base::StringPiece();
 }
 
 // Loads and returns a cursor from the current module.
 HCURSOR ResourceBundle::LoadCursor(int cursor_id) {
+  WaitForAsyncLoads();
   return ::LoadCursor(resources_data_, MAKEINTRESOURCE(cursor_id));
 }
 
@@ -0,0 +1,110 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/base/resource/resource_image.h"
+
+#include <string.h>
+
+#include "base/basictypes.h"
+#include "build/build_config.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkPixelRef.h"
+#include "ui/gfx/codec/png_codec.h"
+
+namespace ui {
+
+namespace {
+
+// The pre-decoded images start with this signature, then the width, the
+// height and the flags, as little endian uint32s, and three reserved uint32s,
+// then the rows of pixels. Must match RAW_IMAGE_SIGNATURE in
+// png_optimizer.py.
+const char kRawImageSignature[] = "\x89PMA\r\n\x1a\n";
+const size_t kRawImageSignatureLength = sizeof(kRawImageSignature) - 1;
+const size_t kRawImageHeaderLength = kRawImageSignatureLength + 6 * 4;
+const uint32 kRawImageOpaqueFlag = 1;
+
+// The pixels of a pre-decoded image in the memory of its data pack, which is
+// read-only. The pixel ref is immutable, so that Skia copies the pixels
+// rather than writing to them.
+class PackPixelRef : public SkPixelRef {
+ public:
+  explicit PackPixelRef(const unsigned char* pixels) : pixels_(pixels) {
+    setImmutable();
+  }
+
+ protected:
+  // SkPixelRef overrides.
+  virtual void* onLockPixels(SkColorTable** ctable) {
+    *ctable = NULL;
+    return const_cast<unsigned char*>(pixels_);
+  }
+
+  virtual void onUnlockPixels() {
+  }
+
+  virtual bool onLockPixelsAreWritable() const {
+    return false;
+  }
+
+ private:
+  const unsigned char* pixels_;
+
+  DISALLOW_COPY_AND_ASSIGN(PackPixelRef);
+};
+
+uint32 ReadUInt32(const unsigned char* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) |
+         (static_cast<uint32>(data[3]) << 24);
+}
+
+bool DecodeRawImage(const unsigned char* data,
+                    size_t size,
+                    SkBitmap* bitmap) {
+  // The pixels are stored in the byte order of SkPMColor on little endian
+  // machines with Skia's default, BGRA, layout, which Windows uses.
+#if SK_A32_SHIFT == 24 && SK_R32_SHIFT == 16 && SK_G32_SHIFT == 8 && \
+    SK_B32_SHIFT == 0 && defined(ARCH_CPU_LITTLE_ENDIAN)
+  uint32 width = ReadUInt32(data + kRawImageSignatureLength);
+  uint32 height = ReadUInt32(data + kRawImageSignatureLength + 4);
+  uint32 flags = ReadUInt32(data + kRawImageSignatureLength + 8);
+  if (!width || !height || width > kint32max / 4 ||
+      (size - kRawImageHeaderLength) / (width * 4) < height)
+    return false;
+
+  bitmap->setConfig(SkBitmap::kARGB_8888_Config, width, height);
+  bitmap->setIsOpaque((flags & kRawImageOpaqueFlag) != 0);
+  const unsigned char* pixels = data + kRawImageHeaderLength;
+  // Data packs align the images, so that their pixels can be used in place.
+  if (reinterpret_cast<uintptr_t>(pixels) % sizeof(SkPMColor) == 0) {
+    bitmap->setPixelRef(new PackPixelRef(pixels))->unref();
+    return true;
+  }
+  if (!bitmap->allocPixels())
+    return false;
+  SkAutoLockPixels lock(*bitmap);
+  for (uint32 y = 0; y < height; ++y)
+    memcpy(bitmap->getAddr32(0, y), pixels + y * width * 4, width * 4);
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // namespace
+
+bool IsRawResourceImage(const unsigned char* data, size_t size) {
+  return size >= kRawImageHeaderLength &&
+      memcmp(data, kRawImageSignature, kRawImageSignatureLength) == 0;
+}
+
+bool DecodeResourceImage(const unsigned char* data,
+                         size_t size,
+                         SkBitmap* bitmap) {
+  if (IsRawResourceImage(data, size))
+    return DecodeRawImage(data, size, bitmap);
+  return gfx::PNGCodec::Decode(data, size, bitmap);
+}
+
+}  // namespace ui
@@ -0,0 +1,32 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef UI_BASE_RESOURCE_RESOURCE_IMAGE_H_
+#define UI_BASE_RESOURCE_RESOURCE_IMAGE_H_
+#pragma once
+
+#include <stddef.h>
+
+class SkBitmap;
+
+namespace ui {
+
+// Returns whether the image resource |data| of |size| bytes was pre-decoded
+// by repack.py, rather than being a PNG.
+bool IsRawResourceImage(const unsigned char* data, size_t size);
+
+// Decodes the image resource |data| of |size| bytes into |bitmap|. The
+// resource is either a PNG, or, for the images that repack.py was told to
+// pre-decode, the premultiplied pixels of the bitmap; see
+// tools/grit/grit/format/png_optimizer.py. The pixels of pre-decoded images
+// are used in place when they are aligned, as data packs write them, so
+// |data| must then outlive |bitmap| and its copies. Their pixel ref is then
+// immutable. Returns false on error.
+bool DecodeResourceImage(const unsigned char* data,
+                         size_t size,
+                         SkBitmap* bitmap);
+
+}  // namespace ui
+
+#endif  // UI_BASE_RESOURCE_RESOURCE_IMAGE_H_
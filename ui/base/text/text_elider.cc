@@ -10,6 +10,7 @@
 // #include "base/i18n/break_iterator.h"
 // #include "base/i18n/char_iterator.h"
 #include "base/i18n/rtl.h"
+#include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/string_split.h"
 #include "base/string_util.h"
@@ -52,6 +53,22 @@ string16 CutString(const string16& text,
       text.substr(text.length() - half_length, half_length);
 }
 
+// Returns the width of |text| cut to |length| characters by CutString(), not
+// counting the ellipsis, from the widths of the prefixes of |text|.
+int GetCutWidth(const std::vector<int>& prefix_widths,
+                size_t length,
+                bool cut_in_middle) {
+  if (length == 0)
+    return 0;
+  if (!cut_in_middle)
+    return prefix_widths[length - 1];
+  const size_t half_length = length / 2;
+  const size_t head_length = length - half_length;
+  const size_t tail_start = prefix_widths.size() - half_length;
+  return prefix_widths[head_length - 1] + prefix_widths.back() -
+      (tail_start ? prefix_widths[tail_start - 1] : 0);
+}
+
 // Build a path from the first |num_components| elements in |path_elements|.
 // Prepends |path_prefix|, appends |filename|, inserts ellipsis if appropriate.
 string16 BuildPathFromComponents(const string16& path_prefix,
@@ -369,30 +386,104 @@ string16 ElideText(const string16& text,
   if (current_text_pixel_width <= available_pixel_width)
     return text;
 
-  if (font.GetStringWidth(UTF8ToUTF16(kEllipsis)) > available_pixel_width)
+  const int ellipsis_width = font.GetStringWidth(UTF8ToUTF16(kEllipsis));
+  if (ellipsis_width > available_pixel_width)
     return string16();
 
-  // Use binary search to compute the elided text.
+  // Measures all the prefixes of the text at once, so that the widths of the
+  // cuts are sums of them, and binary searching for the longest cut that fits
+  // doesn't measure anything.
+  std::vector<int> prefix_widths;
+  font.GetPrefixWidths(text, &prefix_widths);
   size_t lo = 0;
-  size_t hi = text.length() - 1;
+  size_t hi = text.length();
   for (size_t guess = (lo + hi) / 2; guess != lo; guess = (lo + hi) / 2) {
-    // We check the length of the whole desired string at once to ensure we
-    // handle kerning/ligatures/etc. correctly.
-    int guess_length = font.GetStringWidth(
-        CutString(text, guess, elide_in_middle, true));
-    // Check again that we didn't hit a Pango width overflow. If so, cut the
-    // current string in half and start over.
-    if (guess_length <= 0) {
-      return ElideText(CutString(text, guess / 2, elide_in_middle, false),
-                       font, available_pixel_width, elide_in_middle);
-    }
-    if (guess_length > available_pixel_width)
+    if (GetCutWidth(prefix_widths, guess, elide_in_middle) + ellipsis_width >
+        available_pixel_width) {
       hi = guess;
-    else
+    } else {
       lo = guess;
+    }
   }
 
-  return CutString(text, lo, elide_in_middle, true);
+  // The sums don't account for kerning/ligatures/etc. where the string is
+  // cut, so the cut string is measured whole, and shortened until it fits.
+  string16 elided_text = CutString(text, lo, elide_in_middle, true);
+  while (lo > 0 && font.GetStringWidth(elided_text) > available_pixel_width)
+    elided_text = CutString(text, --lo, elide_in_middle, true);
+  return elided_text;
+}
+
+// ElidedTextCache -------------------------------------------------------------
+
+// static
+const size_t ElidedTextCache::kDefaultMaxEntries = 128;
+
+ElidedTextCache::ElidedTextCache() : max_entries_(kDefaultMaxEntries) {
+}
+
+ElidedTextCache::ElidedTextCache(size_t max_entries)
+    : max_entries_(max_entries) {
+  DCHECK_GT(max_entries_, 0u);
+}
+
+ElidedTextCache::~ElidedTextCache() {
+}
+
+string16 ElidedTextCache::ElideText(const string16& text,
+                                    const gfx::Font& font,
+                                    int available_pixel_width,
+                                    bool elide_in_middle) {
+  Key key(text, font, available_pixel_width, elide_in_middle);
+  EntryMap::iterator i = entry_map_.find(key);
+  if (i != entry_map_.end()) {
+    entries_.splice(entries_.begin(), entries_, i->second);
+    return i->second->second;
+  }
+
+  string16 elided_text = ui::ElideText(text, font, available_pixel_width,
+                                       elide_in_middle);
+  if (entries_.size() >= max_entries_) {
+    entry_map_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  entries_.push_front(std::make_pair(key, elided_text));
+  entry_map_[key] = entries_.begin();
+  return elided_text;
+}
+
+void ElidedTextCache::Clear() {
+  entries_.clear();
+  entry_map_.clear();
+}
+
+ElidedTextCache::Key::Key(const string16& text,
+                          const gfx::Font& font,
+                          int available_pixel_width,
+                          bool elide_in_middle)
+    : text(text),
+      font_name(font.GetFontName()),
+      font_height(font.GetHeight()),
+      font_style(font.GetStyle()),
+      available_pixel_width(available_pixel_width),
+      elide_in_middle(elide_in_middle) {
+}
+
+ElidedTextCache::Key::~Key() {
+}
+
+bool ElidedTextCache::Key::operator<(const Key& other) const {
+  if (available_pixel_width != other.available_pixel_width)
+    return available_pixel_width < other.available_pixel_width;
+  if (elide_in_middle != other.elide_in_middle)
+    return elide_in_middle < other.elide_in_middle;
+  if (font_height != other.font_height)
+    return font_height < other.font_height;
+  if (font_style != other.font_style)
+    return font_style < other.font_style;
+  if (font_name != other.font_name)
+    return font_name < other.font_name;
+  return text < other.text;
 }
 
 // SortedDisplayURL::SortedDisplayURL(const GURL& url,
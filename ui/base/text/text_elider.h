@@ -9,6 +9,10 @@
 // #include <unicode/coll.h>
 // #include <unicode/uchar.h>
 
+#include <list>
+#include <map>
+#include <utility>
+
 #include "base/basictypes.h"
 #include "base/string16.h"
 #include "ui/base/ui_export.h"
@@ -47,6 +51,57 @@ UI_EXPORT string16 ElideText(const string16& text,
                              int available_pixel_width,
                              bool elide_in_middle);
 
+// Remembers what ElideText() returned for the last (text, font, width,
+// elide mode)s it was asked for, so that views that elide the same text every
+// time they paint, like labels and tab titles, only measure it once. Fonts
+// are told apart by their name, height and style.
+class UI_EXPORT ElidedTextCache {
+ public:
+  // The number of elided texts kept by default.
+  static const size_t kDefaultMaxEntries;
+
+  ElidedTextCache();
+  explicit ElidedTextCache(size_t max_entries);
+  ~ElidedTextCache();
+
+  // Like ui::ElideText().
+  string16 ElideText(const string16& text,
+                     const gfx::Font& font,
+                     int available_pixel_width,
+                     bool elide_in_middle);
+
+  // Forgets all the elided texts.
+  void Clear();
+
+ private:
+  struct Key {
+    Key(const string16& text,
+        const gfx::Font& font,
+        int available_pixel_width,
+        bool elide_in_middle);
+    ~Key();
+
+    bool operator<(const Key& other) const;
+
+    string16 text;
+    string16 font_name;
+    int font_height;
+    int font_style;
+    int available_pixel_width;
+    bool elide_in_middle;
+  };
+
+  // The most recently used elided texts are at the front.
+  typedef std::list<std::pair<Key, string16> > EntryList;
+  typedef std::map<Key, EntryList::iterator> EntryMap;
+
+  const size_t max_entries_;
+  EntryList entries_;
+  EntryMap entry_map_;
+
+  DISALLOW_COPY_AND_ASSIGN(ElidedTextCache);
+};
+
 // Elide a filename to fit a given pixel width, with an emphasis on not hiding
 // the extension unless we have to. If filename contains a path, the path will
 // be removed if filename doesn't fit into available_pixel_width. The elided
@@ -14,4 +14,15 @@ const char kLang[]                          = "lang";
 // path should point to a locale.pak file.
 const char kLocalePak[]                     = "locale_pak";
 
+// Times the painting and layout of the views, by class, for the trace and
+// the log.
+const char kProfileViews[]                  = "profile-views";
+
+// Profiles the views, and tints each one in red by how long it takes to paint.
+const char kShowViewPaintHeatMap[]          = "show-view-paint-heat-map";
+
+// Draws the menus and popups that fit in their window into it, rather than
+// in windows of their own.
+const char kWindowlessPopups[]              = "windowless-popups";
+
 }  // namespace switches
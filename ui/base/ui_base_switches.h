@@ -14,6 +14,9 @@ namespace switches {
 
 UI_EXPORT extern const char kLang[];
 UI_EXPORT extern const char kLocalePak[];
+UI_EXPORT extern const char kProfileViews[];
+UI_EXPORT extern const char kShowViewPaintHeatMap[];
+UI_EXPORT extern const char kWindowlessPopups[];
 
 }  // namespace switches
 
@@ -4,6 +4,8 @@
 
 #include "ui/gfx/blit.h"
 
+#include <math.h>
+
 #include "base/logging.h"
 #include "build/build_config.h"
 #include "skia/ext/platform_canvas.h"
@@ -18,6 +20,11 @@
 #include "base/mac/scoped_cftyperef.h"
 #endif
 
+#if defined(OS_WIN)
+#include "base/memory/scoped_ptr.h"
+#include "base/win/scoped_gdi_object.h"
+#endif
+
 namespace gfx {
 
 namespace {
@@ -44,6 +51,56 @@ bool HasClipOrTransform(const SkCanvas& canvas) {
   return false;
 }
 
+#if defined(OS_WIN)
+
+Rect GetBounds(const std::vector<Rect>& rects) {
+  Rect bounds;
+  for (size_t i = 0; i < rects.size(); ++i)
+    bounds = bounds.Union(rects[i]);
+  return bounds;
+}
+
+// Saves |dc| and intersects its clip with |rects|, in logical coordinates.
+// Returns the saved state to restore, or 0 if the world transform of the DC,
+// which is where Skia loads the matrices of canvases, is not a translation.
+int SaveAndClipContextToRects(HDC dc, const std::vector<Rect>& rects) {
+  XFORM xform;
+  if (!GetWorldTransform(dc, &xform) || xform.eM11 != 1 || xform.eM12 != 0 ||
+      xform.eM21 != 0 || xform.eM22 != 1)
+    return 0;
+
+  // The clip region is in device coordinates.
+  size_t rects_size = rects.size() * sizeof(RECT);
+  scoped_array<char> buffer(new char[sizeof(RGNDATAHEADER) + rects_size]);
+  RGNDATA* region_data = reinterpret_cast<RGNDATA*>(buffer.get());
+  region_data->rdh.dwSize = sizeof(RGNDATAHEADER);
+  region_data->rdh.iType = RDH_RECTANGLES;
+  region_data->rdh.nCount = static_cast<DWORD>(rects.size());
+  region_data->rdh.nRgnSize = static_cast<DWORD>(rects_size);
+  RECT* region_rects = reinterpret_cast<RECT*>(region_data->Buffer);
+  Rect bounds;
+  for (size_t i = 0; i < rects.size(); ++i) {
+    Rect rect(rects[i]);
+    rect.Offset(static_cast<int>(floor(xform.eDx + 0.5f)),
+                static_cast<int>(floor(xform.eDy + 0.5f)));
+    region_rects[i] = rect.ToRECT();
+    bounds = bounds.Union(rect);
+  }
+  region_data->rdh.rcBound = bounds.ToRECT();
+  base::win::ScopedRegion region(ExtCreateRegion(
+      NULL, static_cast<DWORD>(sizeof(RGNDATAHEADER) + rects_size),
+      region_data));
+  if (!region.Get())
+    return 0;
+
+  int saved_dc = SaveDC(dc);
+  if (saved_dc)
+    ExtSelectClipRgn(dc, region, RGN_AND);
+  return saved_dc;
+}
+
+#endif  // defined(OS_WIN)
+
 }  // namespace
 
 void BlitContextToContext(NativeDrawingContext dst_context,
@@ -122,6 +179,52 @@ void BlitCanvasToCanvas(SkCanvas *dst_canvas,
   skia::EndPlatformPaint(dst_canvas);
 }
 
+void BlitContextToContext(NativeDrawingContext dst_context,
+                          const std::vector<Rect>& dst_rects,
+                          NativeDrawingContext src_context,
+                          const Point& src_offset) {
+#if defined(OS_WIN)
+  if (dst_rects.size() > 1) {
+    int saved_dc = SaveAndClipContextToRects(dst_context, dst_rects);
+    if (saved_dc) {
+      Rect bounds = GetBounds(dst_rects);
+      BlitContextToContext(dst_context, bounds, src_context,
+                           bounds.origin().Add(src_offset));
+      RestoreDC(dst_context, saved_dc);
+      return;
+    }
+  }
+#endif
+  for (size_t i = 0; i < dst_rects.size(); ++i) {
+    BlitContextToContext(dst_context, dst_rects[i], src_context,
+                         dst_rects[i].origin().Add(src_offset));
+  }
+}
+
+void BlitContextToCanvas(SkCanvas *dst_canvas,
+                         const std::vector<Rect>& dst_rects,
+                         NativeDrawingContext src_context,
+                         const Point& src_offset) {
+  if (dst_rects.empty())
+    return;
+  DCHECK(skia::SupportsPlatformPaint(dst_canvas));
+  BlitContextToContext(skia::BeginPlatformPaint(dst_canvas), dst_rects,
+                       src_context, src_offset);
+  skia::EndPlatformPaint(dst_canvas);
+}
+
+void BlitCanvasToContext(NativeDrawingContext dst_context,
+                         const std::vector<Rect>& dst_rects,
+                         SkCanvas *src_canvas,
+                         const Point& src_offset) {
+  if (dst_rects.empty())
+    return;
+  DCHECK(skia::SupportsPlatformPaint(src_canvas));
+  BlitContextToContext(dst_context, dst_rects,
+                       skia::BeginPlatformPaint(src_canvas), src_offset);
+  skia::EndPlatformPaint(src_canvas);
+}
+
 #if defined(OS_WIN)
 
 void ScrollCanvas(SkCanvas* canvas,
@@ -6,6 +6,8 @@
 #define UI_GFX_BLIT_H_
 #pragma once
 
+#include <vector>
+
 #include "ui/gfx/native_widget_types.h"
 #include "ui/base/ui_export.h"
 
@@ -40,6 +42,25 @@ UI_EXPORT void BlitCanvasToCanvas(SkCanvas *dst_canvas,
                                   SkCanvas *src_canvas,
                                   const Point& src_origin);
 
+// Blits several rectangles, such as those of a gfx::DamageRegion, from the
+// source into the destination, in one go. The pixel at a point of the
+// destination comes from that point offset by |src_offset| in the source. On
+// Windows, one BitBlt() of the bounds of the rectangles, clipped to them,
+// copies them all, rather than one BitBlt() each. Only the translations of
+// the transforms of the destinations are supported.
+UI_EXPORT void BlitContextToContext(NativeDrawingContext dst_context,
+                                    const std::vector<Rect>& dst_rects,
+                                    NativeDrawingContext src_context,
+                                    const Point& src_offset);
+UI_EXPORT void BlitContextToCanvas(SkCanvas *dst_canvas,
+                                   const std::vector<Rect>& dst_rects,
+                                   NativeDrawingContext src_context,
+                                   const Point& src_offset);
+UI_EXPORT void BlitCanvasToContext(NativeDrawingContext dst_context,
+                                   const std::vector<Rect>& dst_rects,
+                                   SkCanvas *src_canvas,
+                                   const Point& src_offset);
+
 // Scrolls the given subset of the given canvas by the given amount.
 // The canvas should not have a clip or a transform applied, since platforms
 // may implement those operations differently.
@@ -5,6 +5,7 @@
 #include "ui/gfx/canvas_skia.h"
 
 #include <limits>
+#include <vector>
 
 #include "base/i18n/rtl.h"
 #include "base/logging.h"
@@ -15,6 +16,8 @@
 #include "third_party/skia/include/core/SkShader.h"
 #include "ui/gfx/color_utils.h"
 #include "ui/gfx/font.h"
+#include "ui/gfx/glyph_cache_win.h"
+#include "ui/gfx/platform_font_win.h"
 #include "ui/gfx/rect.h"
 
 namespace {
@@ -140,6 +143,70 @@ int ComputeFormatFlags(int flags, const string16& text) {
   return f;
 }
 
+// Draws |text| with the glyphs of |font|, without going through GDI, when it
+// is a single line of LTR text that the glyph cache can lay out and that
+// doesn't need an ellipsis, into a canvas without layers or transforms other
+// than translation. Returns false if DrawText() must draw it instead.
+bool DrawStringWithGlyphCache(gfx::CanvasSkia* canvas,
+                              const string16& text,
+                              const gfx::Font& font,
+                              const SkColor& color,
+                              int x, int y, int w, int h,
+                              int flags) {
+  if (flags & (gfx::Canvas::MULTI_LINE | gfx::Canvas::SHOW_PREFIX))
+    return false;
+  if ((flags & gfx::Canvas::HIDE_PREFIX) && text.find(L'&') != string16::npos)
+    return false;
+  int f = ComputeFormatFlags(flags, text);
+  if (f & DT_RTLREADING)
+    return false;
+
+  SkDevice* device = canvas->getTopDevice();
+  if (device != canvas->getDevice() ||
+      canvas->getClipType() == SkCanvas::kComplex_ClipType) {
+    return false;
+  }
+  const SkMatrix& matrix = canvas->getTotalMatrix();
+  if (matrix.getType() & ~SkMatrix::kTranslate_Mask)
+    return false;
+  SkBitmap bitmap = device->accessBitmap(true);
+  if (bitmap.config() != SkBitmap::kARGB_8888_Config)
+    return false;
+
+  gfx::GlyphCache* glyph_cache =
+      static_cast<gfx::PlatformFontWin*>(font.platform_font())->
+          GetGlyphCache();
+  gfx::GlyphCache::Run run;
+  if (!glyph_cache->LayoutString(text, color, &run))
+    return false;
+  if (run.width > w && !(flags & gfx::Canvas::NO_ELLIPSIS))
+    return false;
+
+  // Aligns the run in the text bounds the way DrawText() does, in device
+  // coordinates.
+  SkIRect text_bounds;
+  text_bounds.setXYWH(x + SkScalarRound(matrix.getTranslateX()),
+                      y + SkScalarRound(matrix.getTranslateY()), w, h);
+  int text_x = text_bounds.fLeft;
+  if (f & DT_CENTER)
+    text_x += (w - run.width) / 2;
+  else if (f & DT_RIGHT)
+    text_x += w - run.width;
+  int text_y = text_bounds.fTop;
+  if (f & DT_VCENTER)
+    text_y += (h - glyph_cache->height()) / 2;
+  else if (f & DT_BOTTOM)
+    text_y += h - glyph_cache->height();
+
+  SkIRect clip = canvas->getTotalClip().getBounds();
+  if (clip.intersect(text_bounds) &&
+      clip.intersect(0, 0, bitmap.width(), bitmap.height())) {
+    glyph_cache->DrawRun(run, color, text_x, text_y + glyph_cache->ascent(),
+                         clip, &bitmap);
+  }
+  return true;
+}
+
 // Changes the alpha of the given bitmap.
 // If |fade_to_right| is true then the rect fades from opaque to clear,
 // otherwise the rect fades from clear to opaque.
@@ -211,15 +278,20 @@ void DrawTextAndClearBackground(SkCanvas* bmp_canvas,
 
   // At this point the bitmap has black text on white.
   // The intensity of black tells us the alpha value of the text.
+  int width = draw_rect.right - draw_rect.left;
+  if (width <= 0)
+    return;
+  std::vector<BYTE> lumas(width);
   for (int y = draw_rect.top; y < draw_rect.bottom; y++) {
-    for (int x = draw_rect.left; x < draw_rect.right; x++) {
-      // Gets the color directly. DrawText doesn't premultiply alpha so
-      // using SkBitmap::getColor() won't work here.
-      SkColor color = *bmp.getAddr32(x, y);
+    // Reads the colors directly. DrawText doesn't premultiply alpha so
+    // using SkBitmap::getColor() won't work here.
+    uint32_t* row = bmp.getAddr32(draw_rect.left, y);
+    color_utils::GetLuminancesForColors(row, width, &lumas[0]);
+    for (int x = 0; x < width; x++) {
       // Calculate the alpha using the luminance. Since this is black text
       // on a white background the luminosity must be inverted.
-      BYTE alpha = 0xFF - color_utils::GetLuminanceForColor(color);
-      *bmp.getAddr32(x, y) = SkPreMultiplyColor(
+      BYTE alpha = 0xFF - lumas[x];
+      row[x] = SkPreMultiplyColor(
           SkColorSetARGB(alpha, text_color_r, text_color_g, text_color_b));
     }
   }
@@ -302,6 +374,18 @@ void CanvasSkia::SizeStringInt(const string16& text,
   const int kMaxStringLength = 2048 - 1;  // So the trailing \0 fits in 2K.
   string16 clamped_string(text.substr(0, kMaxStringLength));
 
+  // Layout measures the same strings over and over, so the sizes are kept
+  // with the font.
+  const PlatformFontWin* platform_font =
+      static_cast<PlatformFontWin*>(font.platform_font());
+  const int in_width = *width;
+  const int in_height = *height;
+  const int in_flags = flags;
+  if (platform_font->GetCachedStringSize(clamped_string, in_flags, width,
+                                         height)) {
+    return;
+  }
+
   if (*width == 0) {
     // If multi-line + character break are on, the computed width will be one
     // character wide (useless).  Furthermore, if in this case the provided text
@@ -328,6 +412,8 @@ void CanvasSkia::SizeStringInt(const string16& text,
 
   *width = r.right;
   *height = r.bottom;
+  platform_font->CacheStringSize(clamped_string, in_flags, in_width,
+                                 in_height, *width, *height);
 }
 
 void CanvasSkia::DrawStringInt(const string16& text,
@@ -382,6 +468,8 @@ void CanvasSkia::DrawStringInt(const string16& text,
                                const SkColor& color,
                                int x, int y, int w, int h,
                                int flags) {
+  if (DrawStringWithGlyphCache(this, text, font, color, x, y, w, h, flags))
+    return;
   DrawStringInt(text, font.GetNativeFont(), color, x, y, w, h, flags);
 }
 
@@ -6,6 +6,8 @@
 
 #include <setjmp.h>
 
+#include <algorithm>
+
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
 #include "third_party/skia/include/core/SkBitmap.h"
@@ -47,13 +49,38 @@ void ErrorExit(jpeg_common_struct* cinfo) {
 
 namespace {
 
-// Initial size for the output buffer in the JpegEncoderState below.
+// Smallest initial size for the output buffer in the JpegEncoderState below.
 static const int initial_output_buffer_size = 8192;
 
+// The room for the headers, the quantization and Huffman tables, in the
+// estimate of the size of the output below.
+static const size_t kEstimatedHeaderSize = 1024;
+
+// Estimates the size of a w x h image encoded at |quality|, so that the
+// output buffer rarely needs to grow. The typical pictures and screenshots
+// compress to about 1 bit per pixel up to quality 75, 2 bits up to 90, 4 up
+// to 95 and 8 above that. A little too large costs less than growing, which
+// copies the data.
+size_t EstimateEncodedSize(int w, int h, int quality) {
+  size_t pixels = static_cast<size_t>(w) * h;
+  size_t size;
+  if (quality <= 75)
+    size = pixels / 8;
+  else if (quality <= 90)
+    size = pixels / 4;
+  else if (quality <= 95)
+    size = pixels / 2;
+  else
+    size = pixels;
+  return std::max(static_cast<size_t>(initial_output_buffer_size),
+                  size + kEstimatedHeaderSize);
+}
+
 struct JpegEncoderState {
-  explicit JpegEncoderState(std::vector<unsigned char>* o)
+  JpegEncoderState(std::vector<unsigned char>* o, size_t initial_size)
       : out(o),
-        image_buffer_used(0) {
+        image_buffer_used(0),
+        initial_buffer_size(initial_size) {
   }
 
   // Output buffer, of which 'image_buffer_used' bytes are actually used (this
@@ -63,6 +90,9 @@ struct JpegEncoderState {
 
   // Number of bytes in the 'out' buffer that are actually used (see above).
   size_t image_buffer_used;
+
+  // The size the 'out' buffer starts with, the estimated size of the image.
+  size_t initial_buffer_size;
 };
 
 // Initializes the JpegEncoderState for encoding, and tells libjpeg about where
@@ -76,11 +106,11 @@ void InitDestination(jpeg_compress_struct* cinfo) {
   JpegEncoderState* state = static_cast<JpegEncoderState*>(cinfo->client_data);
   DCHECK(state->image_buffer_used == 0) << "initializing after use";
 
-  state->out->resize(initial_output_buffer_size);
+  state->out->resize(state->initial_buffer_size);
   state->image_buffer_used = 0;
 
   cinfo->dest->next_output_byte = &(*state->out)[0];
-  cinfo->dest->free_in_buffer = initial_output_buffer_size;
+  cinfo->dest->free_in_buffer = state->out->size();
 }
 
 // Resize the buffer that we give to libjpeg and update our and its state.
@@ -189,6 +219,14 @@ class CompressDestroyer {
 bool JPEGCodec::Encode(const unsigned char* input, ColorFormat format,
                        int w, int h, int row_byte_width,
                        int quality, std::vector<unsigned char>* output) {
+  return Encode(input, format, w, h, row_byte_width, quality, ENCODE_DEFAULT,
+                output);
+}
+
+bool JPEGCodec::Encode(const unsigned char* input, ColorFormat format,
+                       int w, int h, int row_byte_width,
+                       int quality, EncodeSpeed speed,
+                       std::vector<unsigned char>* output) {
   jpeg_compress_struct cinfo;
   CompressDestroyer destroyer;
   destroyer.SetManagedObject(&cinfo);
@@ -245,6 +283,8 @@ bool JPEGCodec::Encode(const unsigned char* input, ColorFormat format,
 
   jpeg_set_defaults(&cinfo);
   jpeg_set_quality(&cinfo, quality, 1);  // quality here is 0-100
+  if (speed == ENCODE_FAST)
+    cinfo.dct_method = JDCT_IFAST;
 
   // set up the destination manager
   jpeg_destination_mgr destmgr;
@@ -253,7 +293,7 @@ bool JPEGCodec::Encode(const unsigned char* input, ColorFormat format,
   destmgr.term_destination = TermDestination;
   cinfo.dest = &destmgr;
 
-  JpegEncoderState state(output);
+  JpegEncoderState state(output, EstimateEncodedSize(w, h, quality));
   cinfo.client_data = &state;
 
   jpeg_start_compress(&cinfo, 1);
@@ -431,15 +471,55 @@ class DecompressDestroyer {
   jpeg_decompress_struct* cinfo_;
 };
 
+// Sets the scale at which libjpeg decodes the image to the smallest of the
+// ones that its inverse DCT supports (1/8, 1/4 and 1/2) that gives an image of
+// at least |min_width| x |min_height| pixels, or to 1 if there is none. Must
+// be called after jpeg_read_header().
+void SetOutputScale(jpeg_decompress_struct* cinfo,
+                    int min_width, int min_height) {
+  cinfo->scale_num = 1;
+  cinfo->scale_denom = 1;
+  for (unsigned int denom = 8; denom > 1; denom /= 2) {
+    // libjpeg rounds the scaled dimensions up.
+    unsigned int scaled_width = (cinfo->image_width + denom - 1) / denom;
+    unsigned int scaled_height = (cinfo->image_height + denom - 1) / denom;
+    if (static_cast<int>(scaled_width) >= min_width &&
+        static_cast<int>(scaled_height) >= min_height) {
+      cinfo->scale_denom = denom;
+      return;
+    }
+  }
+}
+
 }  // namespace
 
 bool JPEGCodec::Decode(const unsigned char* input, size_t input_size,
                        ColorFormat format, std::vector<unsigned char>* output,
                        int* w, int* h) {
+  // No scaled image is at least that big.
+  return Decode(input, input_size, format, output, w, h, kint32max, kint32max);
+}
+
+bool JPEGCodec::Decode(const unsigned char* input, size_t input_size,
+                       ColorFormat format, std::vector<unsigned char>* output,
+                       int* w, int* h, int min_width, int min_height) {
+  return DecodeImpl(input, input_size, format, min_width, min_height,
+                    output, NULL, NULL, w, h);
+}
+
+// static
+bool JPEGCodec::DecodeImpl(const unsigned char* input, size_t input_size,
+                           ColorFormat format, int min_width, int min_height,
+                           std::vector<unsigned char>* output,
+                           SkBitmap* bitmap, SkBitmap::Allocator* allocator,
+                           int* w, int* h) {
+  DCHECK(!output != !bitmap);
+  DCHECK(!bitmap || format == FORMAT_SkBitmap);
   jpeg_decompress_struct cinfo;
   DecompressDestroyer destroyer;
   destroyer.SetManagedObject(&cinfo);
-  output->clear();
+  if (output)
+    output->clear();
 
   // We set up the normal JPEG error routines, then override error_exit.
   // This must be done before the call to create_decompress.
@@ -518,6 +598,7 @@ bool JPEGCodec::Decode(const unsigned char* input, size_t input_size,
   cinfo.output_components = 3;
 #endif
 
+  SetOutputScale(&cinfo, min_width, min_height);
   jpeg_calc_output_dimensions(&cinfo);
   *w = cinfo.output_width;
   *h = cinfo.output_height;
@@ -528,25 +609,38 @@ bool JPEGCodec::Decode(const unsigned char* input, size_t input_size,
   // how to align row lengths as we do for the compressor.
   int row_read_stride = cinfo.output_width * cinfo.output_components;
 
-#ifdef JCS_EXTENSIONS
-  // Create memory for a decoded image and write decoded lines to the memory
-  // without conversions same as JPEGCodec::Encode().
+  // Where the decoded rows go: straight into the pixels of the bitmap, whose
+  // rows may be padded, or into |output|.
   int row_write_stride = row_read_stride;
-  output->resize(row_write_stride * cinfo.output_height);
+#ifndef JCS_EXTENSIONS
+  if (format != FORMAT_RGB)
+    row_write_stride = cinfo.output_width * 4;
+#endif
+  unsigned char* rows;
+  if (bitmap) {
+    bitmap->setConfig(SkBitmap::kARGB_8888_Config, *w, *h);
+    if (!bitmap->allocPixels(allocator, NULL))
+      return false;
+    rows = static_cast<unsigned char*>(bitmap->getPixels());
+    row_write_stride = static_cast<int>(bitmap->rowBytes());
+  } else {
+    output->resize(row_write_stride * cinfo.output_height);
+    rows = &output->front();
+  }
 
+#ifdef JCS_EXTENSIONS
+  // Write decoded lines to the memory without conversions same as
+  // JPEGCodec::Encode().
   for (int row = 0; row < static_cast<int>(cinfo.output_height); row++) {
-    unsigned char* rowptr = &(*output)[row * row_write_stride];
+    unsigned char* rowptr = rows + row * row_write_stride;
     if (!jpeg_read_scanlines(&cinfo, &rowptr, 1))
       return false;
   }
 #else
   if (format == FORMAT_RGB) {
     // easy case, row needs no conversion
-    int row_write_stride = row_read_stride;
-    output->resize(row_write_stride * cinfo.output_height);
-
     for (int row = 0; row < static_cast<int>(cinfo.output_height); row++) {
-      unsigned char* rowptr = &(*output)[row * row_write_stride];
+      unsigned char* rowptr = rows + row * row_write_stride;
       if (!jpeg_read_scanlines(&cinfo, &rowptr, 1))
         return false;
     }
@@ -554,15 +648,12 @@ bool JPEGCodec::Decode(const unsigned char* input, size_t input_size,
     // Rows need conversion to output format: read into a temporary buffer and
     // expand to the final one. Performance: we could avoid the extra
     // allocation by doing the expansion in-place.
-    int row_write_stride;
     void (*converter)(const unsigned char* rgb, int w, unsigned char* out);
     if (format == FORMAT_RGBA ||
         (format == FORMAT_SkBitmap && SK_R32_SHIFT == 0)) {
-      row_write_stride = cinfo.output_width * 4;
       converter = AddAlpha;
     } else if (format == FORMAT_BGRA ||
                (format == FORMAT_SkBitmap && SK_B32_SHIFT == 0)) {
-      row_write_stride = cinfo.output_width * 4;
       converter = RGBtoBGRA;
     } else {
       NOTREACHED() << "Invalid pixel format";
@@ -570,14 +661,12 @@ bool JPEGCodec::Decode(const unsigned char* input, size_t input_size,
       return false;
     }
 
-    output->resize(row_write_stride * cinfo.output_height);
-
     scoped_array<unsigned char> row_data(new unsigned char[row_read_stride]);
     unsigned char* rowptr = row_data.get();
     for (int row = 0; row < static_cast<int>(cinfo.output_height); row++) {
       if (!jpeg_read_scanlines(&cinfo, &rowptr, 1))
         return false;
-      converter(rowptr, *w, &(*output)[row * row_write_stride]);
+      converter(rowptr, *w, rows + row * row_write_stride);
     }
   }
 #endif
@@ -588,21 +677,34 @@ bool JPEGCodec::Decode(const unsigned char* input, size_t input_size,
 }
 
 // static
-SkBitmap* JPEGCodec::Decode(const unsigned char* input, size_t input_size) {
-  int w, h;
-  std::vector<unsigned char> data_vector;
-  if (!Decode(input, input_size, FORMAT_SkBitmap, &data_vector, &w, &h))
-    return NULL;
+bool JPEGCodec::Decode(const unsigned char* input, size_t input_size,
+                       SkBitmap* bitmap, SkBitmap::Allocator* allocator) {
+  // No scaled image is at least that big.
+  return Decode(input, input_size, kint32max, kint32max, bitmap, allocator);
+}
 
-  // Skia only handles 32 bit images.
-  int data_length = w * h * 4;
+// static
+bool JPEGCodec::Decode(const unsigned char* input, size_t input_size,
+                       int min_width, int min_height,
+                       SkBitmap* bitmap, SkBitmap::Allocator* allocator) {
+  DCHECK(bitmap);
+  int w, h;
+  return DecodeImpl(input, input_size, FORMAT_SkBitmap, min_width, min_height,
+                    NULL, bitmap, allocator, &w, &h);
+}
 
-  SkBitmap* bitmap = new SkBitmap();
-  bitmap->setConfig(SkBitmap::kARGB_8888_Config, w, h);
-  bitmap->allocPixels();
-  memcpy(bitmap->getAddr32(0, 0), &data_vector[0], data_length);
+// static
+SkBitmap* JPEGCodec::Decode(const unsigned char* input, size_t input_size) {
+  return Decode(input, input_size, kint32max, kint32max);
+}
 
-  return bitmap;
+// static
+SkBitmap* JPEGCodec::Decode(const unsigned char* input, size_t input_size,
+                            int min_width, int min_height) {
+  scoped_ptr<SkBitmap> bitmap(new SkBitmap());
+  if (!Decode(input, input_size, min_width, min_height, bitmap.get(), NULL))
+    return NULL;
+  return bitmap.release();
 }
 
 }  // namespace gfx
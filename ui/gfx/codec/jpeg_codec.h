@@ -9,10 +9,9 @@
 #include <stddef.h>
 #include <vector>
 
+#include "third_party/skia/include/core/SkBitmap.h"
 #include "ui/base/ui_export.h"
 
-class SkBitmap;
-
 namespace gfx {
 
 // Interface for encoding/decoding JPEG data. This is a wrapper around libjpeg,
@@ -38,6 +37,17 @@ class UI_EXPORT JPEGCodec {
     FORMAT_SkBitmap
   };
 
+  // How the encoder trades the fidelity of the image for speed.
+  enum EncodeSpeed {
+    // The accurate integer DCT, the default of libjpeg.
+    ENCODE_DEFAULT,
+
+    // The fast integer DCT, which is less accurate at qualities above 90,
+    // where the difference starts to show. Meant for thumbnails and other
+    // images that are encoded often and at a quality of 90 or less.
+    ENCODE_FAST
+  };
+
   // Encodes the given raw 'input' data, with each pixel being represented as
   // given in 'format'. The encoded JPEG data will be written into the supplied
   // vector and true will be returned on success. On failure (false), the
@@ -48,10 +58,20 @@ class UI_EXPORT JPEGCodec {
   //   w * bytes_per_pixel if there is extra padding at the end of each row
   //   (often, each row is padded to the next machine word).
   // quality: an integer in the range 0-100, where 100 is the highest quality.
+  //
+  // With libjpeg-turbo, the pixels are given to libjpeg as they are, whatever
+  // the format. The output buffer is allocated for the size the image is
+  // likely to compress to, rather than grown from a few kilobytes.
   static bool Encode(const unsigned char* input, ColorFormat format,
                      int w, int h, int row_byte_width,
                      int quality, std::vector<unsigned char>* output);
 
+  // Same as above, with the trade-off between speed and fidelity of |speed|.
+  static bool Encode(const unsigned char* input, ColorFormat format,
+                     int w, int h, int row_byte_width,
+                     int quality, EncodeSpeed speed,
+                     std::vector<unsigned char>* output);
+
   // Decodes the JPEG data contained in input of length input_size. The
   // decoded data will be placed in *output with the dimensions in *w and *h
   // on success (returns true). This data will be written in the'format'
@@ -60,10 +80,49 @@ class UI_EXPORT JPEGCodec {
                      ColorFormat format, std::vector<unsigned char>* output,
                      int* w, int* h);
 
+  // Same as above, but for callers that only need an image of at least
+  // min_width x min_height pixels, such as thumbnails: the image is decoded
+  // at the smallest of 1/8, 1/4 or 1/2 of its size that is still at least
+  // that big, by having libjpeg scale the inverse DCT. This is much faster,
+  // and uses much less memory, than decoding the whole image and resizing it.
+  // Images that are not larger than twice the target size in both dimensions
+  // are decoded at full size. *w and *h are set to the decoded size.
+  static bool Decode(const unsigned char* input, size_t input_size,
+                     ColorFormat format, std::vector<unsigned char>* output,
+                     int* w, int* h, int min_width, int min_height);
+
   // Decodes the JPEG data contained in input of length input_size. If
   // successful, a SkBitmap is created and returned. It is up to the caller
   // to delete the returned bitmap.
   static SkBitmap* Decode(const unsigned char* input, size_t input_size);
+
+  // Same as above, but decodes a reduced image of at least min_width x
+  // min_height pixels when possible, as the scaled Decode() above does.
+  static SkBitmap* Decode(const unsigned char* input, size_t input_size,
+                          int min_width, int min_height);
+
+  // Decodes the JPEG data straight into the pixels of |bitmap|, which are
+  // allocated with |allocator|, for example from a pool of pixel buffers, or
+  // with the default heap allocator if it is NULL. This saves the copy and
+  // the side buffer of the vector<unsigned char> version of Decode(). Returns
+  // false if the data can't be decoded or the allocation fails.
+  static bool Decode(const unsigned char* input, size_t input_size,
+                     SkBitmap* bitmap, SkBitmap::Allocator* allocator);
+
+  // Same as above, but decodes a reduced image of at least min_width x
+  // min_height pixels when possible, as the scaled Decode() above does.
+  static bool Decode(const unsigned char* input, size_t input_size,
+                     int min_width, int min_height,
+                     SkBitmap* bitmap, SkBitmap::Allocator* allocator);
+
+ private:
+  // Decodes into either |output|, or the pixels of |bitmap| allocated with
+  // |allocator|, whichever is not NULL.
+  static bool DecodeImpl(const unsigned char* input, size_t input_size,
+                         ColorFormat format, int min_width, int min_height,
+                         std::vector<unsigned char>* output,
+                         SkBitmap* bitmap, SkBitmap::Allocator* allocator,
+                         int* w, int* h);
 };
 
 }  // namespace gfx
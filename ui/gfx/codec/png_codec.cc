@@ -4,14 +4,29 @@
 
 #include "ui/gfx/codec/png_codec.h"
 
+#include <algorithm>
+
+#include "base/bind.h"
 #include "base/logging.h"
+#include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/string_util.h"
+#include "base/threading/parallel_chunks.h"
+#include "base/threading/worker_pool.h"
+#include "base/zlib_stream.h"
+#include "skia/ext/convolver.h"
 #include "ui/gfx/size.h"
 #include "third_party/skia/include/core/SkBitmap.h"
 #include "third_party/skia/include/core/SkUnPreMultiply.h"
 #include "third_party/skia/include/core/SkColorPriv.h"
 
+// The SSE2 row converters handle the two orders Skia is built with.
+#if defined(SIMD_SSE2) && SK_A32_SHIFT == 24 && \
+    (SK_R32_SHIFT == 16 || SK_R32_SHIFT == 0)
+#define PNG_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
 extern "C" {
 #if defined(USE_SYSTEM_LIBPNG)
 #include <png.h>
@@ -30,10 +45,128 @@ namespace gfx {
 
 namespace {
 
+#if defined(PNG_CODEC_SSE2)
+
+// Whether the SSE2 row converters can run.
+bool UseSSE2() {
+  skia::ConvolutionSIMD simd = skia::BestConvolutionSIMD();
+  return simd == skia::CONVOLUTION_SIMD_SSE2 ||
+      simd == skia::CONVOLUTION_SIMD_AVX2;
+}
+
+// Swaps the first and third bytes of each of the four pixels.
+inline __m128i SwapRedAndBlue(__m128i pixels) {
+  const __m128i green_alpha = _mm_set1_epi32(0xFF00FF00);
+  const __m128i red_blue = _mm_set1_epi32(0x00FF00FF);
+  __m128i rb = _mm_and_si128(pixels, red_blue);
+  return _mm_or_si128(_mm_and_si128(pixels, green_alpha),
+                      _mm_or_si128(_mm_slli_epi32(rb, 16),
+                                   _mm_srli_epi32(rb, 16)));
+}
+
+// Puts the four RGBA pixels in the order of Skia's.
+inline __m128i RGBAToSkiaOrder(__m128i pixels) {
+#if SK_R32_SHIFT == 16
+  return SwapRedAndBlue(pixels);
+#else
+  return pixels;
+#endif
+}
+
+// The SSE2 versions of the converters below do blocks of four pixels, and
+// return the number of pixels they did.
+
+int ConvertBetweenBGRAandRGBA_SSE2(const unsigned char* input,
+                                   int pixel_width,
+                                   unsigned char* output) {
+  int x = 0;
+  for (; x + 4 <= pixel_width; x += 4) {
+    __m128i pixels =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + x * 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + x * 4),
+                     SwapRedAndBlue(pixels));
+  }
+  return x;
+}
+
+// Expands RGB to RGBA, or to BGRA if |swap_red_and_blue|.
+int ExpandRGB_SSE2(const unsigned char* rgb, int pixel_width,
+                   unsigned char* rgba, bool swap_red_and_blue) {
+  const __m128i color_mask = _mm_set1_epi32(0x00FFFFFF);
+  const __m128i opaque = _mm_set1_epi32(0xFF000000);
+  int x = 0;
+  // The four pixels are 12 bytes, and the load reads 16, which are within
+  // the row while there are two pixels more.
+  for (; x + 6 <= pixel_width; x += 4) {
+    __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + x * 3));
+    __m128i pixels = _mm_unpacklo_epi64(
+        _mm_unpacklo_epi32(bytes, _mm_srli_si128(bytes, 3)),
+        _mm_unpacklo_epi32(_mm_srli_si128(bytes, 6),
+                           _mm_srli_si128(bytes, 9)));
+    pixels = _mm_or_si128(_mm_and_si128(pixels, color_mask), opaque);
+    if (swap_red_and_blue)
+      pixels = SwapRedAndBlue(pixels);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + x * 4), pixels);
+  }
+  return x;
+}
+
+// Premultiplies the colors by the alpha with the rounding of
+// SkMulDiv255Round(), as SkPreMultiplyARGB() does.
+int ConvertRGBAtoSkia_SSE2(const unsigned char* rgba_in, int pixel_width,
+                           unsigned char* rgba, bool* is_opaque) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i all_ones = _mm_set1_epi32(-1);
+  // Keeps the alpha of each pixel as it is, by multiplying it by 255.
+  const __m128i alpha_lane = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+  const __m128i alpha_255 = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+  const __m128i round = _mm_set1_epi16(128);
+  bool opaque = true;
+  int x = 0;
+  for (; x + 4 <= pixel_width; x += 4) {
+    __m128i pixels =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba_in + x * 4));
+    // The alphas are the bytes 3, 7, 11 and 15.
+    if ((_mm_movemask_epi8(_mm_cmpeq_epi8(pixels, all_ones)) & 0x8888) ==
+        0x8888) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + x * 4),
+                       RGBAToSkiaOrder(pixels));
+      continue;
+    }
+    opaque = false;
+
+    __m128i halves[2] = { _mm_unpacklo_epi8(pixels, zero),
+                          _mm_unpackhi_epi8(pixels, zero) };
+    for (int i = 0; i < 2; ++i) {
+      __m128i alpha = _mm_shufflehi_epi16(
+          _mm_shufflelo_epi16(halves[i], _MM_SHUFFLE(3, 3, 3, 3)),
+          _MM_SHUFFLE(3, 3, 3, 3));
+      alpha = _mm_or_si128(_mm_andnot_si128(alpha_lane, alpha), alpha_255);
+      __m128i product =
+          _mm_add_epi16(_mm_mullo_epi16(halves[i], alpha), round);
+      halves[i] = _mm_srli_epi16(
+          _mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + x * 4),
+                     RGBAToSkiaOrder(_mm_packus_epi16(halves[0], halves[1])));
+  }
+  if (!opaque)
+    *is_opaque = false;
+  return x;
+}
+
+#endif  // defined(PNG_CODEC_SSE2)
+
 // Converts BGRA->RGBA and RGBA->BGRA.
 void ConvertBetweenBGRAandRGBA(const unsigned char* input, int pixel_width,
                                unsigned char* output, bool* is_opaque) {
-  for (int x = 0; x < pixel_width; x++) {
+  int x = 0;
+#if defined(PNG_CODEC_SSE2)
+  if (UseSSE2())
+    x = ConvertBetweenBGRAandRGBA_SSE2(input, pixel_width, output);
+#endif
+  for (; x < pixel_width; x++) {
     const unsigned char* pixel_in = &input[x * 4];
     unsigned char* pixel_out = &output[x * 4];
     pixel_out[0] = pixel_in[2];
@@ -56,7 +189,12 @@ void ConvertRGBAtoRGB(const unsigned char* rgba, int pixel_width,
 
 void ConvertRGBtoSkia(const unsigned char* rgb, int pixel_width,
                       unsigned char* rgba, bool* is_opaque) {
-  for (int x = 0; x < pixel_width; x++) {
+  int x = 0;
+#if defined(PNG_CODEC_SSE2)
+  if (UseSSE2())
+    x = ExpandRGB_SSE2(rgb, pixel_width, rgba, SK_R32_SHIFT == 16);
+#endif
+  for (; x < pixel_width; x++) {
     const unsigned char* pixel_in = &rgb[x * 3];
     uint32_t* pixel_out = reinterpret_cast<uint32_t*>(&rgba[x * 4]);
     *pixel_out = SkPackARGB32(0xFF, pixel_in[0], pixel_in[1], pixel_in[2]);
@@ -66,7 +204,12 @@ void ConvertRGBtoSkia(const unsigned char* rgb, int pixel_width,
 void ConvertRGBAtoSkia(const unsigned char* rgb, int pixel_width,
                        unsigned char* rgba, bool* is_opaque) {
   int total_length = pixel_width * 4;
-  for (int x = 0; x < total_length; x += 4) {
+  int x = 0;
+#if defined(PNG_CODEC_SSE2)
+  if (UseSSE2())
+    x = ConvertRGBAtoSkia_SSE2(rgb, pixel_width, rgba, is_opaque) * 4;
+#endif
+  for (; x < total_length; x += 4) {
     const unsigned char* pixel_in = &rgb[x];
     uint32_t* pixel_out = reinterpret_cast<uint32_t*>(&rgba[x]);
 
@@ -146,24 +289,35 @@ class PngDecoderState {
       : output_format(ofmt),
         output_channels(0),
         bitmap(NULL),
+        allocator(NULL),
         is_opaque(true),
         output(o),
         row_converter(NULL),
+        input_channels(0),
         width(0),
         height(0),
+        first_updated_row(0),
+        end_updated_row(0),
+        clear_bitmap(false),
         done(false) {
   }
 
-  // Output is an SkBitmap.
-  explicit PngDecoderState(SkBitmap* skbitmap)
+  // Output is an SkBitmap, whose pixels are allocated with |alloc|, or with
+  // the default allocator when it is NULL.
+  PngDecoderState(SkBitmap* skbitmap, SkBitmap::Allocator* alloc)
       : output_format(PNGCodec::FORMAT_SkBitmap),
         output_channels(0),
         bitmap(skbitmap),
+        allocator(alloc),
         is_opaque(true),
         output(NULL),
         row_converter(NULL),
+        input_channels(0),
         width(0),
         height(0),
+        first_updated_row(0),
+        end_updated_row(0),
+        clear_bitmap(false),
         done(false) {
   }
 
@@ -172,6 +326,7 @@ class PngDecoderState {
 
   // An incoming SkBitmap to write to. If NULL, we write to output instead.
   SkBitmap* bitmap;
+  SkBitmap::Allocator* allocator;
 
   // Used during the reading of an SkBitmap. Defaults to true until we see a
   // pixel with anything other than an alpha of 255.
@@ -186,10 +341,26 @@ class PngDecoderState {
   void (*row_converter)(const unsigned char* in, int w, unsigned char* out,
                         bool* is_opaque);
 
+  // Number of channels of the rows that libpng produces.
+  int input_channels;
+
+  // For interlaced images, the rows as libpng produces them, into which each
+  // pass is combined before the rows are converted. Empty otherwise.
+  std::vector<unsigned char> interlace_buffer;
+
   // Size of the image, set in the info callback.
   int width;
   int height;
 
+  // The rows written since the range was last reset; empty when
+  // |first_updated_row| >= |end_updated_row|.
+  int first_updated_row;
+  int end_updated_row;
+
+  // When true, the bitmap is cleared once allocated, since it may be shown
+  // before every row is decoded.
+  bool clear_bitmap;
+
   // Set to true when we've found the end of the data.
   bool done;
 
@@ -199,7 +370,12 @@ class PngDecoderState {
 
 void ConvertRGBtoRGBA(const unsigned char* rgb, int pixel_width,
                       unsigned char* rgba, bool* is_opaque) {
-  for (int x = 0; x < pixel_width; x++) {
+  int x = 0;
+#if defined(PNG_CODEC_SSE2)
+  if (UseSSE2())
+    x = ExpandRGB_SSE2(rgb, pixel_width, rgba, false);
+#endif
+  for (; x < pixel_width; x++) {
     const unsigned char* pixel_in = &rgb[x * 3];
     unsigned char* pixel_out = &rgba[x * 4];
     pixel_out[0] = pixel_in[0];
@@ -211,7 +387,12 @@ void ConvertRGBtoRGBA(const unsigned char* rgb, int pixel_width,
 
 void ConvertRGBtoBGRA(const unsigned char* rgb, int pixel_width,
                       unsigned char* bgra, bool* is_opaque) {
-  for (int x = 0; x < pixel_width; x++) {
+  int x = 0;
+#if defined(PNG_CODEC_SSE2)
+  if (UseSSE2())
+    x = ExpandRGB_SSE2(rgb, pixel_width, bgra, true);
+#endif
+  for (; x < pixel_width; x++) {
     const unsigned char* pixel_in = &rgb[x * 3];
     unsigned char* pixel_out = &bgra[x * 4];
     pixel_out[0] = pixel_in[2];
@@ -282,6 +463,7 @@ void DecodeInfoCallback(png_struct* png_ptr, png_info* info_ptr) {
   // Update our info now
   png_read_update_info(png_ptr, info_ptr);
   channels = png_get_channels(png_ptr, info_ptr);
+  state->input_channels = channels;
 
   // Pick our row format converter necessary for this data.
   if (channels == 3) {
@@ -333,10 +515,16 @@ void DecodeInfoCallback(png_struct* png_ptr, png_info* info_ptr) {
     longjmp(png_jmpbuf(png_ptr), 1);
   }
 
+  if (interlace_type == PNG_INTERLACE_ADAM7)
+    state->interlace_buffer.resize(state->width * channels * state->height);
+
   if (state->bitmap) {
     state->bitmap->setConfig(SkBitmap::kARGB_8888_Config,
                              state->width, state->height);
-    state->bitmap->allocPixels();
+    if (!state->bitmap->allocPixels(state->allocator, NULL))
+      longjmp(png_jmpbuf(png_ptr), 1);
+    if (state->clear_bitmap)
+      state->bitmap->eraseARGB(0, 0, 0, 0);
   } else if (state->output) {
     state->output->resize(
         state->width * state->output_channels * state->height);
@@ -348,30 +536,68 @@ void DecodeRowCallback(png_struct* png_ptr, png_byte* new_row,
   PngDecoderState* state = static_cast<PngDecoderState*>(
       png_get_progressive_ptr(png_ptr));
 
-  DCHECK(pass == 0) << "We didn't turn on interlace handling, but libpng is "
-                       "giving us interlaced data.";
-  if (static_cast<int>(row_num) > state->height) {
+  DCHECK(pass == 0 || !state->interlace_buffer.empty())
+      << "We didn't turn on interlace handling, but libpng is giving us "
+         "interlaced data.";
+  if (static_cast<int>(row_num) >= state->height) {
     NOTREACHED() << "Invalid row";
     return;
   }
 
-  unsigned char* base = NULL;
-  if (state->bitmap)
-    base = reinterpret_cast<unsigned char*>(state->bitmap->getAddr32(0, 0));
-  else if (state->output)
-    base = &state->output->front();
+  // Interlaced images have rows that the current pass leaves unchanged.
+  if (!new_row)
+    return;
+
+  const unsigned char* row = new_row;
+  bool* is_opaque = &state->is_opaque;
+  bool partial_is_opaque = true;
+  if (!state->interlace_buffer.empty()) {
+    unsigned char* combined_row = &state->interlace_buffer[
+        state->width * state->input_channels * row_num];
+    png_progressive_combine_row(png_ptr, combined_row, new_row);
+    row = combined_row;
+    // The pixels of later passes are still missing, so the opacity is only
+    // computed once all passes are done (see DecodeEndCallback()).
+    is_opaque = &partial_is_opaque;
+  }
+
+  // The rows of the bitmap may be padded by its allocator.
+  unsigned char* dest = NULL;
+  if (state->bitmap) {
+    dest = reinterpret_cast<unsigned char*>(
+        state->bitmap->getAddr32(0, row_num));
+  } else if (state->output) {
+    dest = &state->output->front() +
+        state->width * state->output_channels * row_num;
+  }
 
-  unsigned char* dest = &base[state->width * state->output_channels * row_num];
   if (state->row_converter)
-    state->row_converter(new_row, state->width, dest, &state->is_opaque);
+    state->row_converter(row, state->width, dest, is_opaque);
   else
-    memcpy(dest, new_row, state->width * state->output_channels);
+    memcpy(dest, row, state->width * state->output_channels);
+
+  int row_index = static_cast<int>(row_num);
+  if (state->first_updated_row >= state->end_updated_row) {
+    state->first_updated_row = row_index;
+    state->end_updated_row = row_index + 1;
+  } else {
+    state->first_updated_row = std::min(state->first_updated_row, row_index);
+    state->end_updated_row = std::max(state->end_updated_row, row_index + 1);
+  }
 }
 
 void DecodeEndCallback(png_struct* png_ptr, png_info* info) {
   PngDecoderState* state = static_cast<PngDecoderState*>(
       png_get_progressive_ptr(png_ptr));
 
+  // An interlaced image is opaque if all the alpha values of its final rows
+  // are.
+  if (state->input_channels == 4 && !state->interlace_buffer.empty()) {
+    const std::vector<unsigned char>& rows = state->interlace_buffer;
+    for (size_t i = 3; i < rows.size() && state->is_opaque; i += 4)
+      state->is_opaque = rows[i] == 0xFF;
+  }
+
   // Mark the image as complete, this will tell the Decode function that we
   // have successfully found the end of the data.
   state->done = true;
@@ -456,6 +682,12 @@ bool PNGCodec::Decode(const unsigned char* input, size_t input_size,
 // static
 bool PNGCodec::Decode(const unsigned char* input, size_t input_size,
                       SkBitmap* bitmap) {
+  return Decode(input, input_size, bitmap, NULL);
+}
+
+// static
+bool PNGCodec::Decode(const unsigned char* input, size_t input_size,
+                      SkBitmap* bitmap, SkBitmap::Allocator* allocator) {
   DCHECK(bitmap);
   png_struct* png_ptr = NULL;
   png_info* info_ptr = NULL;
@@ -470,7 +702,7 @@ bool PNGCodec::Decode(const unsigned char* input, size_t input_size,
     return false;
   }
 
-  PngDecoderState state(bitmap);
+  PngDecoderState state(bitmap, allocator);
 
   png_set_progressive_read_fn(png_ptr, &state, &DecodeInfoCallback,
                               &DecodeRowCallback, &DecodeEndCallback);
@@ -489,6 +721,103 @@ bool PNGCodec::Decode(const unsigned char* input, size_t input_size,
   return true;
 }
 
+// IncrementalPNGDecoder -------------------------------------------------------
+
+struct IncrementalPNGDecoder::Core {
+  Core()
+      : png_ptr(NULL),
+        info_ptr(NULL),
+        state(&bitmap, NULL),
+        failed(false) {
+    state.clear_bitmap = true;
+  }
+
+  ~Core() {
+    if (png_ptr)
+      png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+  }
+
+  png_struct* png_ptr;
+  png_info* info_ptr;
+  SkBitmap bitmap;
+  PngDecoderState state;
+
+  // Set once libpng reported an error.
+  bool failed;
+};
+
+IncrementalPNGDecoder::IncrementalPNGDecoder() : core_(new Core) {
+  // Unlike BuildPNGStruct(), this leaves checking the signature to libpng,
+  // since the first chunk may be shorter than it.
+  core_->png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL,
+                                          NULL);
+  if (core_->png_ptr)
+    core_->info_ptr = png_create_info_struct(core_->png_ptr);
+  if (!core_->info_ptr) {
+    core_->failed = true;
+    return;
+  }
+  png_set_progressive_read_fn(core_->png_ptr, &core_->state,
+                              &DecodeInfoCallback, &DecodeRowCallback,
+                              &DecodeEndCallback);
+}
+
+IncrementalPNGDecoder::~IncrementalPNGDecoder() {
+}
+
+bool IncrementalPNGDecoder::AppendData(const unsigned char* data,
+                                       size_t size) {
+  if (core_->failed)
+    return false;
+  if (core_->state.done || size == 0)
+    return true;
+
+  int first_row = core_->state.first_updated_row;
+  int end_row = core_->state.end_updated_row;
+  if (setjmp(png_jmpbuf(core_->png_ptr))) {
+    // The structures are destroyed with |core_|.
+    core_->failed = true;
+    return false;
+  }
+  png_process_data(core_->png_ptr, core_->info_ptr,
+                   const_cast<unsigned char*>(data), size);
+
+  // The pixels changed behind Skia's back, so users of their generation ID
+  // (such as caches of images derived from the bitmap) must be told.
+  if (core_->state.first_updated_row != first_row ||
+      core_->state.end_updated_row != end_row)
+    core_->bitmap.notifyPixelsChanged();
+  if (core_->state.done)
+    core_->bitmap.setIsOpaque(core_->state.is_opaque);
+  return true;
+}
+
+bool IncrementalPNGDecoder::HasSize() const {
+  return !core_->failed && !core_->bitmap.isNull();
+}
+
+bool IncrementalPNGDecoder::IsComplete() const {
+  return !core_->failed && core_->state.done;
+}
+
+bool IncrementalPNGDecoder::HasFailed() const {
+  return core_->failed;
+}
+
+bool IncrementalPNGDecoder::TakeUpdatedRows(int* first_row, int* end_row) {
+  PngDecoderState& state = core_->state;
+  if (core_->failed || state.first_updated_row >= state.end_updated_row)
+    return false;
+  *first_row = state.first_updated_row;
+  *end_row = state.end_updated_row;
+  state.first_updated_row = state.end_updated_row = 0;
+  return true;
+}
+
+const SkBitmap& IncrementalPNGDecoder::bitmap() const {
+  return core_->bitmap;
+}
+
 // static
 SkBitmap* PNGCodec::CreateSkBitmapFromBGRAFormat(
     std::vector<unsigned char>& bgra, int width, int height) {
@@ -606,10 +935,101 @@ class CommentWriter {
 };
 #endif  // PNG_TEXT_SUPPORTED
 
+// Returns the libpng flags for a combination of PNGCodec::EncodeOptions
+// filters.
+int LibpngFilters(int filters) {
+  DCHECK(filters != 0);
+  int png_filters = 0;
+  if (filters & PNGCodec::EncodeOptions::FILTER_NONE)
+    png_filters |= PNG_FILTER_NONE;
+  if (filters & PNGCodec::EncodeOptions::FILTER_SUB)
+    png_filters |= PNG_FILTER_SUB;
+  if (filters & PNGCodec::EncodeOptions::FILTER_UP)
+    png_filters |= PNG_FILTER_UP;
+  if (filters & PNGCodec::EncodeOptions::FILTER_AVG)
+    png_filters |= PNG_FILTER_AVG;
+  if (filters & PNGCodec::EncodeOptions::FILTER_PAETH)
+    png_filters |= PNG_FILTER_PAETH;
+  return png_filters;
+}
+
 // The type of functions usable for converting between pixel formats.
 typedef void (*FormatConverter)(const unsigned char* in, int w,
                                 unsigned char* out, bool* is_opaque);
 
+// Returns a guess of the size of an encoded image, for reserving the output.
+size_t EstimateEncodedSize(const Size& size, int output_color_components,
+                           const PNGCodec::EncodeOptions& options) {
+  size_t raw_size = static_cast<size_t>(size.width()) * size.height() *
+      output_color_components;
+  // Screenshots compress 4x (photos) to 16x (text and flat colors), with
+  // either profile.
+  return raw_size / 8 + 1024;
+}
+
+// Picks the converter and the layout of the rows written for |format|.
+// Returns false for unknown formats.
+bool GetEncoderFormat(PNGCodec::ColorFormat format,
+                      bool discard_transparency,
+                      FormatConverter* converter,
+                      int* input_color_components,
+                      int* output_color_components,
+                      int* png_output_color_type) {
+  *converter = NULL;
+  switch (format) {
+    case PNGCodec::FORMAT_RGB:
+      *input_color_components = 3;
+      *output_color_components = 3;
+      *png_output_color_type = PNG_COLOR_TYPE_RGB;
+      break;
+
+    case PNGCodec::FORMAT_RGBA:
+      *input_color_components = 4;
+      if (discard_transparency) {
+        *output_color_components = 3;
+        *png_output_color_type = PNG_COLOR_TYPE_RGB;
+        *converter = ConvertRGBAtoRGB;
+      } else {
+        *output_color_components = 4;
+        *png_output_color_type = PNG_COLOR_TYPE_RGB_ALPHA;
+        *converter = NULL;
+      }
+      break;
+
+    case PNGCodec::FORMAT_BGRA:
+      *input_color_components = 4;
+      if (discard_transparency) {
+        *output_color_components = 3;
+        *png_output_color_type = PNG_COLOR_TYPE_RGB;
+        *converter = ConvertBGRAtoRGB;
+      } else {
+        *output_color_components = 4;
+        *png_output_color_type = PNG_COLOR_TYPE_RGB_ALPHA;
+        *converter = ConvertBetweenBGRAandRGBA;
+      }
+      break;
+
+    case PNGCodec::FORMAT_SkBitmap:
+      *input_color_components = 4;
+      if (discard_transparency) {
+        *output_color_components = 3;
+        *png_output_color_type = PNG_COLOR_TYPE_RGB;
+        *converter = ConvertSkiatoRGB;
+      } else {
+        *output_color_components = 4;
+        *png_output_color_type = PNG_COLOR_TYPE_RGB_ALPHA;
+        *converter = ConvertSkiatoRGBA;
+      }
+      break;
+
+    default:
+      NOTREACHED() << "Unknown pixel format";
+      return false;
+  }
+
+  return true;
+}
+
 // libpng uses a wacky setjmp-based API, which makes the compiler nervous.
 // We constrain all of the calls we make to libpng where the setjmp() is in
 // place to this function.
@@ -617,7 +1037,8 @@ typedef void (*FormatConverter)(const unsigned char* in, int w,
 bool DoLibpngWrite(png_struct* png_ptr, png_info* info_ptr,
                    PngEncoderState* state,
                    int width, int height, int row_byte_width,
-                   const unsigned char* input, int compression_level,
+                   const unsigned char* input,
+                   const PNGCodec::EncodeOptions& options,
                    int png_output_color_type, int output_color_components,
                    FormatConverter converter,
                    const std::vector<PNGCodec::Comment>& comments) {
@@ -627,7 +1048,23 @@ bool DoLibpngWrite(png_struct* png_ptr, png_info* info_ptr,
   if (setjmp(png_jmpbuf(png_ptr)))
     return false;
 
-  png_set_compression_level(png_ptr, compression_level);
+  png_set_compression_level(png_ptr, options.compression_level);
+  png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE,
+                 LibpngFilters(options.filters));
+  // Without a strategy, libpng uses Z_FILTERED for filtered rows.
+  switch (options.strategy) {
+    case PNGCodec::EncodeOptions::STRATEGY_DEFAULT:
+      break;
+    case PNGCodec::EncodeOptions::STRATEGY_FILTERED:
+      png_set_compression_strategy(png_ptr, Z_FILTERED);
+      break;
+    case PNGCodec::EncodeOptions::STRATEGY_HUFFMAN_ONLY:
+      png_set_compression_strategy(png_ptr, Z_HUFFMAN_ONLY);
+      break;
+    case PNGCodec::EncodeOptions::STRATEGY_RLE:
+      png_set_compression_strategy(png_ptr, Z_RLE);
+      break;
+  }
 
   // Set our callback for libpng to give us the data.
   png_set_write_fn(png_ptr, state, EncoderWriteCallback, FakeFlushCallback);
@@ -689,63 +1126,29 @@ bool PNGCodec::EncodeWithCompressionLevel(const unsigned char* input,
                                           const std::vector<Comment>& comments,
                                           int compression_level,
                                           std::vector<unsigned char>* output) {
+  EncodeOptions options(EncodeOptions::PROFILE_DEFAULT);
+  options.compression_level = compression_level;
+  return EncodeWithOptions(input, format, size, row_byte_width,
+                           discard_transparency, comments, options, output);
+}
+
+// static
+bool PNGCodec::EncodeWithOptions(const unsigned char* input,
+                                 ColorFormat format, const Size& size,
+                                 int row_byte_width,
+                                 bool discard_transparency,
+                                 const std::vector<Comment>& comments,
+                                 const EncodeOptions& options,
+                                 std::vector<unsigned char>* output) {
   // Run to convert an input row into the output row format, NULL means no
   // conversion is necessary.
-  FormatConverter converter = NULL;
-
+  FormatConverter converter;
   int input_color_components, output_color_components;
   int png_output_color_type;
-  switch (format) {
-    case FORMAT_RGB:
-      input_color_components = 3;
-      output_color_components = 3;
-      png_output_color_type = PNG_COLOR_TYPE_RGB;
-      discard_transparency = false;
-      break;
-
-    case FORMAT_RGBA:
-      input_color_components = 4;
-      if (discard_transparency) {
-        output_color_components = 3;
-        png_output_color_type = PNG_COLOR_TYPE_RGB;
-        converter = ConvertRGBAtoRGB;
-      } else {
-        output_color_components = 4;
-        png_output_color_type = PNG_COLOR_TYPE_RGB_ALPHA;
-        converter = NULL;
-      }
-      break;
-
-    case FORMAT_BGRA:
-      input_color_components = 4;
-      if (discard_transparency) {
-        output_color_components = 3;
-        png_output_color_type = PNG_COLOR_TYPE_RGB;
-        converter = ConvertBGRAtoRGB;
-      } else {
-        output_color_components = 4;
-        png_output_color_type = PNG_COLOR_TYPE_RGB_ALPHA;
-        converter = ConvertBetweenBGRAandRGBA;
-      }
-      break;
-
-    case FORMAT_SkBitmap:
-      input_color_components = 4;
-      if (discard_transparency) {
-        output_color_components = 3;
-        png_output_color_type = PNG_COLOR_TYPE_RGB;
-        converter = ConvertSkiatoRGB;
-      } else {
-        output_color_components = 4;
-        png_output_color_type = PNG_COLOR_TYPE_RGB_ALPHA;
-        converter = ConvertSkiatoRGBA;
-      }
-      break;
-
-    default:
-      NOTREACHED() << "Unknown pixel format";
-      return false;
-  }
+  if (!GetEncoderFormat(format, discard_transparency, &converter,
+                        &input_color_components, &output_color_components,
+                        &png_output_color_type))
+    return false;
 
   // Row stride should be at least as long as the length of the data.
   DCHECK(input_color_components * size.width() <= row_byte_width);
@@ -760,10 +1163,17 @@ bool PNGCodec::EncodeWithCompressionLevel(const unsigned char* input,
     return false;
   }
 
+  size_t output_size_hint = options.output_size_hint;
+  if (output_size_hint == 0) {
+    output_size_hint = EstimateEncodedSize(size, output_color_components,
+                                           options);
+  }
+  output->reserve(output->size() + output_size_hint);
+
   PngEncoderState state(output);
   bool success = DoLibpngWrite(png_ptr, info_ptr, &state,
                                size.width(), size.height(), row_byte_width,
-                               input, compression_level, png_output_color_type,
+                               input, options, png_output_color_type,
                                output_color_components, converter, comments);
   png_destroy_write_struct(&png_ptr, &info_ptr);
 
@@ -774,15 +1184,462 @@ bool PNGCodec::EncodeWithCompressionLevel(const unsigned char* input,
 bool PNGCodec::EncodeBGRASkBitmap(const SkBitmap& input,
                                   bool discard_transparency,
                                   std::vector<unsigned char>* output) {
+  return EncodeBGRASkBitmapWithOptions(
+      input, discard_transparency,
+      EncodeOptions(EncodeOptions::PROFILE_DEFAULT), output);
+}
+
+// static
+bool PNGCodec::EncodeBGRASkBitmapWithOptions(
+    const SkBitmap& input,
+    bool discard_transparency,
+    const EncodeOptions& options,
+    std::vector<unsigned char>* output) {
   static const int bbp = 4;
 
   SkAutoLockPixels lock_input(input);
   DCHECK(input.empty() || input.bytesPerPixel() == bbp);
 
-  return Encode(reinterpret_cast<unsigned char*>(input.getAddr32(0, 0)),
-                FORMAT_SkBitmap, Size(input.width(), input.height()),
-                input.width() * bbp, discard_transparency,
-                std::vector<Comment>(), output);
+  return EncodeWithOptions(
+      reinterpret_cast<unsigned char*>(input.getAddr32(0, 0)),
+      FORMAT_SkBitmap, Size(input.width(), input.height()),
+      input.width() * bbp, discard_transparency, std::vector<Comment>(),
+      options, output);
+}
+
+// Parallel encoder ------------------------------------------------------------
+//
+// Large images are split into bands of rows which are filtered and deflated
+// on base::WorkerPool threads, like pigz does: each band is a raw deflate
+// stream primed with the last 32K of filtered data of the rows before it,
+// ending on a byte boundary, so that the bands concatenate into the single
+// zlib stream of the image data. Each band is written as its own IDAT chunk.
+
+namespace {
+
+// Bands are at least this many rows, and this many bytes of raw data.
+const int kMinRowsPerBand = 32;
+const size_t kMinBytesPerBand = 256 * 1024;
+
+// The window of deflate, which is the most of the preceding data that a band
+// can refer to.
+const size_t kDeflateWindowSize = 32768;
+
+const unsigned char kPNGSignature[8] = {
+  0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'
+};
+
+void AppendUint32(uint32 value, std::vector<unsigned char>* out) {
+  out->push_back(static_cast<unsigned char>(value >> 24));
+  out->push_back(static_cast<unsigned char>(value >> 16));
+  out->push_back(static_cast<unsigned char>(value >> 8));
+  out->push_back(static_cast<unsigned char>(value));
+}
+
+void WriteUint32(uint32 value, unsigned char* out) {
+  out[0] = static_cast<unsigned char>(value >> 24);
+  out[1] = static_cast<unsigned char>(value >> 16);
+  out[2] = static_cast<unsigned char>(value >> 8);
+  out[3] = static_cast<unsigned char>(value);
+}
+
+// Appends a chunk of |type| whose data is |size| bytes at |data|.
+void AppendChunk(const char* type, const unsigned char* data, size_t size,
+                 std::vector<unsigned char>* out) {
+  AppendUint32(static_cast<uint32>(size), out);
+  size_t type_offset = out->size();
+  out->insert(out->end(), type, type + 4);
+  out->insert(out->end(), data, data + size);
+  uLong crc = crc32(0L, Z_NULL, 0);
+  crc = crc32(crc, &(*out)[type_offset], static_cast<uInt>(size + 4));
+  AppendUint32(static_cast<uint32>(crc), out);
+}
+
+unsigned char PaethPredictor(int a, int b, int c) {
+  int p = a + b - c;
+  int pa = abs(p - a);
+  int pb = abs(p - b);
+  int pc = abs(p - c);
+  if (pa <= pb && pa <= pc)
+    return static_cast<unsigned char>(a);
+  if (pb <= pc)
+    return static_cast<unsigned char>(b);
+  return static_cast<unsigned char>(c);
+}
+
+// Writes the filter type byte of |filter| (a PNG_FILTER_VALUE_*) and |row|
+// filtered with it to |out|. |prior| is the previous row, or NULL for the
+// first row of the image.
+void FilterRow(int filter, const unsigned char* row,
+               const unsigned char* prior, size_t row_bytes, int bpp,
+               unsigned char* out) {
+  out[0] = static_cast<unsigned char>(filter);
+  ++out;
+  for (size_t i = 0; i < row_bytes; ++i) {
+    int left = i >= static_cast<size_t>(bpp) ? row[i - bpp] : 0;
+    int up = prior ? prior[i] : 0;
+    int up_left = prior && i >= static_cast<size_t>(bpp) ? prior[i - bpp] : 0;
+    int predicted = 0;
+    switch (filter) {
+      case PNG_FILTER_VALUE_SUB:
+        predicted = left;
+        break;
+      case PNG_FILTER_VALUE_UP:
+        predicted = up;
+        break;
+      case PNG_FILTER_VALUE_AVG:
+        predicted = (left + up) / 2;
+        break;
+      case PNG_FILTER_VALUE_PAETH:
+        predicted = PaethPredictor(left, up, up_left);
+        break;
+    }
+    out[i] = static_cast<unsigned char>(row[i] - predicted);
+  }
+}
+
+// Filters |row| with the filter among |filters| (a combination of
+// PNGCodec::EncodeOptions filters) whose output has the smallest sum of
+// absolute values, the same heuristic that libpng uses. |out| and, when
+// there are several filters, |scratch| are |row_bytes| + 1 long.
+void FilterRowAdaptively(int filters, const unsigned char* row,
+                         const unsigned char* prior, size_t row_bytes,
+                         int bpp, unsigned char* out,
+                         unsigned char* scratch) {
+  static const int kFilters[] = {
+    PNGCodec::EncodeOptions::FILTER_NONE,
+    PNGCodec::EncodeOptions::FILTER_SUB,
+    PNGCodec::EncodeOptions::FILTER_UP,
+    PNGCodec::EncodeOptions::FILTER_AVG,
+    PNGCodec::EncodeOptions::FILTER_PAETH,
+  };
+  DCHECK(filters != 0);
+  uint64 best_sum = 0;
+  bool have_best = false;
+  for (int filter = 0; filter < static_cast<int>(arraysize(kFilters));
+       ++filter) {
+    if (!(filters & kFilters[filter]))
+      continue;
+    if (filters == kFilters[filter]) {
+      FilterRow(filter, row, prior, row_bytes, bpp, out);
+      return;
+    }
+    FilterRow(filter, row, prior, row_bytes, bpp, scratch);
+    uint64 sum = 0;
+    for (size_t i = 1; i <= row_bytes; ++i)
+      sum += abs(static_cast<signed char>(scratch[i]));
+    if (!have_best || sum < best_sum) {
+      best_sum = sum;
+      have_best = true;
+      memcpy(out, scratch, row_bytes + 1);
+    }
+  }
+}
+
+// The zlib strategy for |options|, as libpng would pick it.
+int ZlibStrategy(const PNGCodec::EncodeOptions& options) {
+  switch (options.strategy) {
+    case PNGCodec::EncodeOptions::STRATEGY_FILTERED:
+      return Z_FILTERED;
+    case PNGCodec::EncodeOptions::STRATEGY_HUFFMAN_ONLY:
+      return Z_HUFFMAN_ONLY;
+    case PNGCodec::EncodeOptions::STRATEGY_RLE:
+      return Z_RLE;
+    default:
+      return options.filters == PNGCodec::EncodeOptions::FILTER_NONE ?
+          Z_DEFAULT_STRATEGY : Z_FILTERED;
+  }
+}
+
+// Filters and deflates the bands of an image, on the calling thread and
+// on base::WorkerPool threads.
+class ParallelPNGEncoder
+    : public base::RefCountedThreadSafe<ParallelPNGEncoder> {
+ public:
+  ParallelPNGEncoder(const unsigned char* input,
+                     int row_byte_width,
+                     FormatConverter converter,
+                     int width,
+                     int height,
+                     int output_color_components,
+                     const PNGCodec::EncodeOptions& options,
+                     int num_bands)
+      : input_(input),
+        row_byte_width_(row_byte_width),
+        converter_(converter),
+        width_(width),
+        height_(height),
+        output_color_components_(output_color_components),
+        options_(options),
+        bands_(num_bands) {
+  }
+
+  // Encodes all bands, and returns when they are done.
+  void Run() {
+    base::RunParallelChunks(
+        static_cast<int>(bands_.size()),
+        base::Bind(&ParallelPNGEncoder::EncodeBand, this));
+  }
+
+  // Appends the IDAT chunks of the bands and the one holding the checksum
+  // of the stream to |output|. Returns false if deflate failed.
+  bool AppendImageData(std::vector<unsigned char>* output) const {
+    uLong adler = adler32(0L, Z_NULL, 0);
+    for (size_t i = 0; i < bands_.size(); i++) {
+      if (!bands_[i].succeeded)
+        return false;
+      adler = adler32_combine(adler, bands_[i].adler,
+                              static_cast<z_off_t>(bands_[i].filtered_size));
+    }
+    for (size_t i = 0; i < bands_.size(); i++)
+      output->insert(output->end(), bands_[i].chunk.begin(),
+                     bands_[i].chunk.end());
+    unsigned char trailer[4];
+    WriteUint32(static_cast<uint32>(adler), trailer);
+    AppendChunk("IDAT", trailer, sizeof(trailer), output);
+    return true;
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<ParallelPNGEncoder>;
+
+  struct Band {
+    Band() : adler(0), filtered_size(0), succeeded(false) {}
+
+    // The complete IDAT chunk of the band.
+    std::vector<unsigned char> chunk;
+    // Adler-32 and size of the filtered rows.
+    uLong adler;
+    size_t filtered_size;
+    bool succeeded;
+  };
+
+  ~ParallelPNGEncoder() {}
+
+  void EncodeBand(int band) {
+    int num_bands = static_cast<int>(bands_.size());
+    int first_row = static_cast<int>(
+        static_cast<int64>(height_) * band / num_bands);
+    int end_row = static_cast<int>(
+        static_cast<int64>(height_) * (band + 1) / num_bands);
+    bands_[band].succeeded = EncodeRows(band == 0, band == num_bands - 1,
+                                        first_row, end_row, &bands_[band]);
+  }
+
+  // Returns row |y| in the output format, converting it into |buffer| if
+  // needed.
+  const unsigned char* GetRow(int y, unsigned char* buffer) const {
+    const unsigned char* row = &input_[static_cast<size_t>(y) *
+                                       row_byte_width_];
+    if (!converter_)
+      return row;
+    converter_(row, width_, buffer, NULL);
+    return buffer;
+  }
+
+  bool EncodeRows(bool first, bool last, int first_row, int end_row,
+                  Band* band) {
+    size_t row_bytes = static_cast<size_t>(width_) * output_color_components_;
+    size_t filtered_row_bytes = row_bytes + 1;
+
+    // Filter the rows of the band, preceded by enough rows before it for the
+    // dictionary. Filtering them again gives the same bytes that the
+    // previous band deflated.
+    int dictionary_rows = static_cast<int>(std::min<size_t>(
+        first_row,
+        (kDeflateWindowSize + filtered_row_bytes - 1) / filtered_row_bytes));
+    int filter_first_row = first_row - dictionary_rows;
+    std::vector<unsigned char> filtered(
+        filtered_row_bytes * (end_row - filter_first_row));
+    std::vector<unsigned char> rows(row_bytes * 2);
+    std::vector<unsigned char> scratch(filtered_row_bytes);
+    // |prior| is converted into the half of |rows| that row
+    // |filter_first_row| - 1 would use, so that the first row doesn't
+    // overwrite it.
+    const unsigned char* prior = filter_first_row > 0 ?
+        GetRow(filter_first_row - 1,
+               &rows[((filter_first_row - 1) % 2) * row_bytes]) : NULL;
+    for (int y = filter_first_row; y < end_row; y++) {
+      // Alternate between the halves of |rows|, so |prior| stays valid.
+      unsigned char* buffer = &rows[(y % 2) * row_bytes];
+      const unsigned char* row = GetRow(y, buffer);
+      FilterRowAdaptively(
+          options_.filters, row, prior, row_bytes, output_color_components_,
+          &filtered[(y - filter_first_row) * filtered_row_bytes],
+          &scratch[0]);
+      prior = row;
+    }
+
+    size_t dictionary_size = dictionary_rows * filtered_row_bytes;
+    const unsigned char* data = &filtered[dictionary_size];
+    size_t data_size = filtered.size() - dictionary_size;
+    band->adler = adler32(adler32(0L, Z_NULL, 0), data,
+                          static_cast<uInt>(data_size));
+    band->filtered_size = data_size;
+
+    // A raw stream: the zlib header and checksum are written around the
+    // bands.
+    base::ZlibCompressor compressor(base::ZlibStream::FORMAT_RAW,
+                                    options_.compression_level,
+                                    ZlibStrategy(options_));
+    if (dictionary_size) {
+      size_t size = std::min(dictionary_size, kDeflateWindowSize);
+      if (!compressor.SetDictionary(&filtered[dictionary_size - size], size))
+        return false;
+    }
+
+    // The chunk's length and type, then the data, then the CRC.
+    std::vector<unsigned char>& chunk = band->chunk;
+    chunk.resize(8);
+    memcpy(&chunk[4], "IDAT", 4);
+    if (first) {
+      // The zlib header, with the compression level flags that zlib writes.
+      int level = options_.compression_level == Z_DEFAULT_COMPRESSION ?
+          6 : options_.compression_level;
+      int level_flags = 3;
+      if (ZlibStrategy(options_) >= Z_HUFFMAN_ONLY || level < 2)
+        level_flags = 0;
+      else if (level < 6)
+        level_flags = 1;
+      else if (level == 6)
+        level_flags = 2;
+      int header = (0x78 << 8) | (level_flags << 6);
+      header += 31 - (header % 31);
+      chunk.push_back(static_cast<unsigned char>(header >> 8));
+      chunk.push_back(static_cast<unsigned char>(header));
+    }
+
+    // Only the last band ends the stream; the others end on a byte boundary
+    // so that the next band's stream can follow.
+    base::ZlibStream::Chunks compressed;
+    if (!compressor.Write(data, data_size))
+      return false;
+    bool flushed = last ? compressor.Finish(&compressed) :
+        compressor.Flush(&compressed);
+    if (!flushed)
+      return false;
+    base::ZlibStream::Flatten(compressed, &chunk);
+    WriteUint32(static_cast<uint32>(chunk.size() - 8), &chunk[0]);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, &chunk[4], static_cast<uInt>(chunk.size() - 4));
+    AppendUint32(static_cast<uint32>(crc), &chunk);
+    return true;
+  }
+
+  const unsigned char* input_;
+  int row_byte_width_;
+  FormatConverter converter_;
+  int width_;
+  int height_;
+  int output_color_components_;
+  const PNGCodec::EncodeOptions options_;
+  std::vector<Band> bands_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelPNGEncoder);
+};
+
+}  // namespace
+
+// static
+bool PNGCodec::EncodeInParallel(const unsigned char* input,
+                                ColorFormat format, const Size& size,
+                                int row_byte_width,
+                                bool discard_transparency,
+                                const std::vector<Comment>& comments,
+                                const EncodeOptions& options,
+                                std::vector<unsigned char>* output) {
+  FormatConverter converter;
+  int input_color_components, output_color_components;
+  int png_output_color_type;
+  if (!GetEncoderFormat(format, discard_transparency, &converter,
+                        &input_color_components, &output_color_components,
+                        &png_output_color_type))
+    return false;
+  DCHECK(input_color_components * size.width() <= row_byte_width);
+
+  size_t raw_size = static_cast<size_t>(size.width()) * size.height() *
+      output_color_components;
+  int num_bands = options.num_bands > 0 ?
+      std::min(options.num_bands, size.height()) :
+      std::min(std::min(base::WorkerPool::GetNumberOfCpuWorkers(),
+                        size.height() / kMinRowsPerBand),
+               static_cast<int>(raw_size / kMinBytesPerBand));
+  if (num_bands <= 1) {
+    return EncodeWithOptions(input, format, size, row_byte_width,
+                             discard_transparency, comments, options, output);
+  }
+
+  size_t output_size_hint = options.output_size_hint;
+  if (output_size_hint == 0) {
+    output_size_hint = EstimateEncodedSize(size, output_color_components,
+                                           options);
+  }
+  size_t old_size = output->size();
+  output->reserve(old_size + output_size_hint);
+
+  output->insert(output->end(), kPNGSignature,
+                 kPNGSignature + sizeof(kPNGSignature));
+  unsigned char header[13];
+  WriteUint32(size.width(), &header[0]);
+  WriteUint32(size.height(), &header[4]);
+  header[8] = 8;  // Bit depth.
+  header[9] = static_cast<unsigned char>(png_output_color_type);
+  header[10] = PNG_COMPRESSION_TYPE_BASE;
+  header[11] = PNG_FILTER_TYPE_BASE;
+  header[12] = PNG_INTERLACE_NONE;
+  AppendChunk("IHDR", header, sizeof(header), output);
+
+  // Same as CommentWriter.
+  for (size_t i = 0; i < comments.size(); ++i) {
+    DCHECK(comments[i].key.length() < 79);
+    std::string text = comments[i].key.substr(0, 78);
+    text.push_back('\0');
+    text.append(comments[i].text);
+    AppendChunk("tEXt", reinterpret_cast<const unsigned char*>(text.data()),
+                text.size(), output);
+  }
+
+  scoped_refptr<ParallelPNGEncoder> encoder(new ParallelPNGEncoder(
+      input, row_byte_width, converter, size.width(), size.height(),
+      output_color_components, options, num_bands));
+  encoder->Run();
+  if (!encoder->AppendImageData(output)) {
+    output->resize(old_size);
+    return false;
+  }
+  AppendChunk("IEND", NULL, 0, output);
+  return true;
+}
+
+// static
+bool PNGCodec::EncodeBGRASkBitmapInParallel(
+    const SkBitmap& input,
+    bool discard_transparency,
+    const EncodeOptions& options,
+    std::vector<unsigned char>* output) {
+  static const int bbp = 4;
+
+  SkAutoLockPixels lock_input(input);
+  DCHECK(input.empty() || input.bytesPerPixel() == bbp);
+
+  return EncodeInParallel(
+      reinterpret_cast<unsigned char*>(input.getAddr32(0, 0)),
+      FORMAT_SkBitmap, Size(input.width(), input.height()),
+      input.width() * bbp, discard_transparency, std::vector<Comment>(),
+      options, output);
+}
+
+PNGCodec::EncodeOptions::EncodeOptions(Profile profile)
+    : compression_level(Z_DEFAULT_COMPRESSION),
+      strategy(STRATEGY_DEFAULT),
+      filters(FILTER_ALL),
+      output_size_hint(0),
+      num_bands(0) {
+  if (profile == PROFILE_SPEED) {
+    compression_level = 1;
+    strategy = STRATEGY_FILTERED;
+    filters = FILTER_SUB;
+  }
 }
 
 PNGCodec::Comment::Comment(const std::string& k, const std::string& t)
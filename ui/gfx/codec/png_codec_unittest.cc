@@ -0,0 +1,272 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "ui/gfx/codec/png_codec.h"
+#include "ui/gfx/size.h"
+
+extern "C" {
+#if defined(USE_SYSTEM_LIBPNG)
+#include <png.h>
+#else
+#include "third_party/libpng/png.h"
+#endif
+}
+
+namespace gfx {
+
+namespace {
+
+// Large enough to be split into several bands on a machine with several
+// cores. An odd height puts some bands' dictionary rows on odd rows.
+const int kWidth = 500;
+const int kHeight = 1029;
+
+// Makes an image of gradients with some noise, so that the adaptive filters
+// don't all pick the same filter.
+void MakeBGRAImage(std::vector<unsigned char>* image) {
+  image->resize(kWidth * kHeight * 4);
+  uint32 seed = 1;
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      seed = seed * 1103515245 + 12345;
+      unsigned char noise = static_cast<unsigned char>((seed >> 16) & 0x0F);
+      unsigned char* pixel = &(*image)[(y * kWidth + x) * 4];
+      pixel[0] = static_cast<unsigned char>(x + noise);
+      pixel[1] = static_cast<unsigned char>(y + noise);
+      pixel[2] = static_cast<unsigned char>(x ^ y);
+      pixel[3] = static_cast<unsigned char>(0x80 + (y & 0x7F));
+    }
+  }
+}
+
+// Decodes |encoded| to RGBA, checking that it is kWidth by kHeight.
+void DecodeToRGBA(const std::vector<unsigned char>& encoded,
+                  std::vector<unsigned char>* decoded) {
+  int width, height;
+  ASSERT_TRUE(PNGCodec::Decode(&encoded[0], encoded.size(),
+                               PNGCodec::FORMAT_RGBA, decoded, &width,
+                               &height));
+  ASSERT_EQ(kWidth, width);
+  ASSERT_EQ(kHeight, height);
+}
+
+void ExpectSamePixels(const std::vector<unsigned char>& expected,
+                      const std::vector<unsigned char>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < actual.size(); ++i)
+    ASSERT_EQ(expected[i], actual[i]) << "at byte " << i;
+}
+
+// Encodes the BGRA |image| in |num_bands| bands, or as many as the encoder
+// picks if 0, and checks that it decodes to |expected_rgba|. Either way,
+// each row is converted as it is filtered.
+void CheckParallelEncode(const std::vector<unsigned char>& image,
+                         bool discard_transparency,
+                         int num_bands,
+                         const std::vector<unsigned char>& expected_rgba) {
+  PNGCodec::EncodeOptions options(PNGCodec::EncodeOptions::PROFILE_DEFAULT);
+  options.num_bands = num_bands;
+  std::vector<unsigned char> encoded;
+  ASSERT_TRUE(PNGCodec::EncodeInParallel(
+      &image[0], PNGCodec::FORMAT_BGRA, Size(kWidth, kHeight), kWidth * 4,
+      discard_transparency, std::vector<PNGCodec::Comment>(), options,
+      &encoded));
+
+  std::vector<unsigned char> decoded;
+  DecodeToRGBA(encoded, &decoded);
+  ExpectSamePixels(expected_rgba, decoded);
+}
+
+// The kinds of images the incremental decoder is checked with.
+enum IncrementalImage {
+  INCREMENTAL_RGB,
+  INCREMENTAL_RGBA,
+  // RGBA, with every pixel opaque.
+  INCREMENTAL_OPAQUE_RGBA,
+};
+
+uint32 NextRandom(uint32* seed) {
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 16;
+}
+
+void WritePNGData(png_structp png_ptr, png_bytep data, png_size_t length) {
+  std::vector<unsigned char>* output =
+      static_cast<std::vector<unsigned char>*>(png_get_io_ptr(png_ptr));
+  output->insert(output->end(), data, data + length);
+}
+
+void FlushPNGData(png_structp png_ptr) {
+}
+
+// Encodes random pixels through libpng, which unlike PNGCodec can interlace
+// them.
+bool EncodeRandomImage(IncrementalImage kind,
+                       bool interlaced,
+                       int width,
+                       int height,
+                       uint32 seed,
+                       std::vector<unsigned char>* output) {
+  png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL,
+                                                NULL, NULL);
+  if (!png_ptr)
+    return false;
+  png_infop info_ptr = png_create_info_struct(png_ptr);
+  if (!info_ptr) {
+    png_destroy_write_struct(&png_ptr, NULL);
+    return false;
+  }
+
+  int channels = kind == INCREMENTAL_RGB ? 3 : 4;
+  std::vector<unsigned char> pixels(width * height * channels);
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    pixels[i] = static_cast<unsigned char>(NextRandom(&seed));
+    if (kind == INCREMENTAL_OPAQUE_RGBA && i % 4 == 3)
+      pixels[i] = 0xFF;
+  }
+
+  if (setjmp(png_jmpbuf(png_ptr))) {
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    return false;
+  }
+  png_set_write_fn(png_ptr, output, WritePNGData, FlushPNGData);
+  png_set_IHDR(png_ptr, info_ptr, width, height, 8,
+               channels == 3 ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_RGB_ALPHA,
+               interlaced ? PNG_INTERLACE_ADAM7 : PNG_INTERLACE_NONE,
+               PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png_ptr, info_ptr);
+  // libpng picks the pixels of each pass out of the whole rows.
+  int passes = png_set_interlace_handling(png_ptr);
+  for (int pass = 0; pass < passes; ++pass) {
+    for (int y = 0; y < height; ++y)
+      png_write_row(png_ptr, &pixels[y * width * channels]);
+  }
+  png_write_end(png_ptr, info_ptr);
+  png_destroy_write_struct(&png_ptr, &info_ptr);
+  return true;
+}
+
+void ExpectSameBitmaps(const SkBitmap& expected, const SkBitmap& actual) {
+  ASSERT_EQ(expected.width(), actual.width());
+  ASSERT_EQ(expected.height(), actual.height());
+  EXPECT_EQ(expected.isOpaque(), actual.isOpaque());
+  SkAutoLockPixels expected_lock(expected);
+  SkAutoLockPixels actual_lock(actual);
+  for (int y = 0; y < expected.height(); ++y) {
+    ASSERT_EQ(0, memcmp(expected.getAddr32(0, y), actual.getAddr32(0, y),
+                        expected.width() * 4)) << "at row " << y;
+  }
+}
+
+}  // namespace
+
+TEST(PNGCodec, EncodeInParallelBGRAToRGBA) {
+  std::vector<unsigned char> bgra;
+  MakeBGRAImage(&bgra);
+  std::vector<unsigned char> expected(bgra);
+  for (int i = 0; i < kWidth * kHeight; ++i)
+    std::swap(expected[i * 4 + 0], expected[i * 4 + 2]);
+  CheckParallelEncode(bgra, false, 0, expected);
+}
+
+TEST(PNGCodec, EncodeInParallelBGRAToRGB) {
+  std::vector<unsigned char> bgra;
+  MakeBGRAImage(&bgra);
+  std::vector<unsigned char> expected(bgra);
+  for (int i = 0; i < kWidth * kHeight; ++i) {
+    std::swap(expected[i * 4 + 0], expected[i * 4 + 2]);
+    expected[i * 4 + 3] = 0xFF;
+  }
+  CheckParallelEncode(bgra, true, 0, expected);
+}
+
+// Forces the banded path, which the encoder doesn't pick on a single core,
+// and compares it with the serial encoder. Seven bands don't divide the
+// height, so some bands start on odd rows.
+TEST(PNGCodec, EncodeInBandsMatchesSerialEncode) {
+  std::vector<unsigned char> bgra;
+  MakeBGRAImage(&bgra);
+  for (int discard_transparency = 0; discard_transparency < 2;
+       ++discard_transparency) {
+    PNGCodec::EncodeOptions options(PNGCodec::EncodeOptions::PROFILE_DEFAULT);
+    std::vector<unsigned char> serial;
+    ASSERT_TRUE(PNGCodec::EncodeWithOptions(
+        &bgra[0], PNGCodec::FORMAT_BGRA, Size(kWidth, kHeight), kWidth * 4,
+        discard_transparency != 0, std::vector<PNGCodec::Comment>(), options,
+        &serial));
+    std::vector<unsigned char> expected;
+    DecodeToRGBA(serial, &expected);
+
+    const int kNumBands[] = { 2, 7 };
+    for (size_t i = 0; i < arraysize(kNumBands); ++i)
+      CheckParallelEncode(bgra, discard_transparency != 0, kNumBands[i],
+                          expected);
+  }
+}
+
+// Feeds images to IncrementalPNGDecoder in chunks of random sizes, and
+// compares the result with that of PNGCodec::Decode().
+TEST(IncrementalPNGDecoder, MatchesDecodeWithRandomChunks) {
+  const IncrementalImage kKinds[] = {
+    INCREMENTAL_RGB, INCREMENTAL_RGBA, INCREMENTAL_OPAQUE_RGBA,
+  };
+  uint32 seed = 7;
+  for (size_t kind = 0; kind < arraysize(kKinds); ++kind) {
+    for (int interlaced = 0; interlaced < 2; ++interlaced) {
+      SCOPED_TRACE(testing::Message() << "kind " << kind << ", interlaced "
+                                      << interlaced);
+      // Odd sizes leave some Adam7 passes with partial blocks.
+      std::vector<unsigned char> png;
+      ASSERT_TRUE(EncodeRandomImage(kKinds[kind], interlaced != 0, 67, 45,
+                                    NextRandom(&seed), &png));
+      SkBitmap expected;
+      ASSERT_TRUE(PNGCodec::Decode(&png[0], png.size(), &expected));
+
+      IncrementalPNGDecoder decoder;
+      size_t offset = 0;
+      while (offset < png.size()) {
+        EXPECT_FALSE(decoder.IsComplete());
+        size_t size = std::min<size_t>(1 + NextRandom(&seed) % 512,
+                                       png.size() - offset);
+        ASSERT_TRUE(decoder.AppendData(&png[offset], size));
+        offset += size;
+
+        int first_row, end_row;
+        if (decoder.TakeUpdatedRows(&first_row, &end_row)) {
+          EXPECT_TRUE(decoder.HasSize());
+          EXPECT_LE(0, first_row);
+          EXPECT_LT(first_row, end_row);
+          EXPECT_LE(end_row, expected.height());
+        }
+      }
+      EXPECT_TRUE(decoder.IsComplete());
+      EXPECT_FALSE(decoder.HasFailed());
+      ExpectSameBitmaps(expected, decoder.bitmap());
+    }
+  }
+}
+
+TEST(IncrementalPNGDecoder, FailsOnGarbage) {
+  uint32 seed = 3;
+  std::vector<unsigned char> garbage(1000);
+  for (size_t i = 0; i < garbage.size(); ++i)
+    garbage[i] = static_cast<unsigned char>(NextRandom(&seed));
+
+  IncrementalPNGDecoder decoder;
+  EXPECT_FALSE(decoder.AppendData(&garbage[0], garbage.size()));
+  EXPECT_TRUE(decoder.HasFailed());
+  EXPECT_FALSE(decoder.IsComplete());
+  // Further data is ignored.
+  EXPECT_FALSE(decoder.AppendData(&garbage[0], garbage.size()));
+}
+
+}  // namespace gfx
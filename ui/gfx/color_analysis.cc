@@ -7,8 +7,18 @@
 #include <algorithm>
 #include <vector>
 
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/message_loop_proxy.h"
+#include "base/threading/parallel_chunks.h"
+#include "skia/ext/convolver.h"
 #include "ui/gfx/codec/png_codec.h"
 
+#if defined(SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+
 namespace {
 
 // RGBA KMean Constants
@@ -76,6 +86,14 @@ class KMeanCluster {
     ++counter;
   }
 
+  // Adds |count| points whose components sum to |r|, |g| and |b|.
+  inline void AddPoints(uint32_t r, uint32_t g, uint32_t b, uint32_t count) {
+    aggregate[0] += r;
+    aggregate[1] += g;
+    aggregate[2] += b;
+    counter += count;
+  }
+
   // Just returns the distance^2. Since we are comparing relative distances
   // there is no need to perform the expensive sqrt() operation.
   inline uint32_t GetDistanceSqr(uint8_t r, uint8_t g, uint8_t b) {
@@ -121,6 +139,185 @@ class KMeanCluster {
   uint32_t weight;
 };
 
+// Adds each of the |pixel_count| BGRA pixels at |pixels| to the cluster whose
+// centroid is closest to it, the first one in case of a tie.
+void AddPixelsToClusters(const uint8_t* pixels,
+                         size_t pixel_count,
+                         std::vector<KMeanCluster>* clusters) {
+  for (size_t i = 0; i < pixel_count; ++i) {
+    uint8_t b = pixels[i * 4];
+    uint8_t g = pixels[i * 4 + 1];
+    uint8_t r = pixels[i * 4 + 2];
+
+    uint32_t distance_sqr_to_closest_cluster = UINT_MAX;
+    std::vector<KMeanCluster>::iterator closest_cluster = clusters->begin();
+
+    // Figure out which cluster this color is closest to in RGB space.
+    for (std::vector<KMeanCluster>::iterator cluster = clusters->begin();
+        cluster != clusters->end(); ++cluster) {
+      uint32_t distance_sqr = cluster->GetDistanceSqr(r, g, b);
+
+      if (distance_sqr < distance_sqr_to_closest_cluster) {
+        distance_sqr_to_closest_cluster = distance_sqr;
+        closest_cluster = cluster;
+      }
+    }
+
+    closest_cluster->AddPoint(r, g, b);
+  }
+}
+
+#if defined(SIMD_SSE2)
+
+// Same as AddPixelsToClusters(), four pixels at a time. Each of the 32 bit
+// lanes of the registers holds the channel of one pixel, so the distances
+// and the sums are exact; the sums of the lanes wrap around like those of
+// the aggregates do.
+void AddPixelsToClusters_SSE2(const uint8_t* pixels,
+                              size_t pixel_count,
+                              std::vector<KMeanCluster>* clusters) {
+  DCHECK(clusters->size() <= kNumberOfClusters);
+  size_t num_clusters = clusters->size();
+  if (num_clusters == 0)
+    return;
+
+  __m128i centroid_r[kNumberOfClusters];
+  __m128i centroid_g[kNumberOfClusters];
+  __m128i centroid_b[kNumberOfClusters];
+  __m128i sum_r[kNumberOfClusters];
+  __m128i sum_g[kNumberOfClusters];
+  __m128i sum_b[kNumberOfClusters];
+  __m128i count[kNumberOfClusters];
+  for (size_t k = 0; k < num_clusters; ++k) {
+    uint8_t r, g, b;
+    (*clusters)[k].GetCentroid(&r, &g, &b);
+    centroid_r[k] = _mm_set1_epi32(r);
+    centroid_g[k] = _mm_set1_epi32(g);
+    centroid_b[k] = _mm_set1_epi32(b);
+    sum_r[k] = sum_g[k] = sum_b[k] = count[k] = _mm_setzero_si128();
+  }
+
+  const __m128i mask = _mm_set1_epi32(0xFF);
+  size_t i = 0;
+  for (; i + 4 <= pixel_count; i += 4) {
+    __m128i bgra =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i * 4));
+    __m128i b = _mm_and_si128(bgra, mask);
+    __m128i g = _mm_and_si128(_mm_srli_epi32(bgra, 8), mask);
+    __m128i r = _mm_and_si128(_mm_srli_epi32(bgra, 16), mask);
+
+    __m128i closest_distance = _mm_setzero_si128();
+    __m128i closest = _mm_setzero_si128();
+    for (size_t k = 0; k < num_clusters; ++k) {
+      // The differences are 16 bit values in the low half of each lane, with
+      // zero in the high half, so _mm_madd_epi16() squares them exactly.
+      __m128i dr = _mm_sub_epi16(r, centroid_r[k]);
+      __m128i dg = _mm_sub_epi16(g, centroid_g[k]);
+      __m128i db = _mm_sub_epi16(b, centroid_b[k]);
+      __m128i distance = _mm_add_epi32(
+          _mm_add_epi32(_mm_madd_epi16(dr, dr), _mm_madd_epi16(dg, dg)),
+          _mm_madd_epi16(db, db));
+      if (k == 0) {
+        closest_distance = distance;
+        continue;
+      }
+      __m128i closer = _mm_cmplt_epi32(distance, closest_distance);
+      closest_distance = _mm_or_si128(
+          _mm_and_si128(closer, distance),
+          _mm_andnot_si128(closer, closest_distance));
+      closest = _mm_or_si128(
+          _mm_and_si128(closer, _mm_set1_epi32(static_cast<int>(k))),
+          _mm_andnot_si128(closer, closest));
+    }
+
+    for (size_t k = 0; k < num_clusters; ++k) {
+      __m128i in_cluster =
+          _mm_cmpeq_epi32(closest, _mm_set1_epi32(static_cast<int>(k)));
+      sum_r[k] = _mm_add_epi32(sum_r[k], _mm_and_si128(in_cluster, r));
+      sum_g[k] = _mm_add_epi32(sum_g[k], _mm_and_si128(in_cluster, g));
+      sum_b[k] = _mm_add_epi32(sum_b[k], _mm_and_si128(in_cluster, b));
+      // |in_cluster| is -1 in the lanes of the pixels in the cluster.
+      count[k] = _mm_sub_epi32(count[k], in_cluster);
+    }
+  }
+
+  for (size_t k = 0; k < num_clusters; ++k) {
+    uint32_t lanes[4][4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes[0]), sum_r[k]);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes[1]), sum_g[k]);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes[2]), sum_b[k]);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes[3]), count[k]);
+    (*clusters)[k].AddPoints(
+        lanes[0][0] + lanes[0][1] + lanes[0][2] + lanes[0][3],
+        lanes[1][0] + lanes[1][1] + lanes[1][2] + lanes[1][3],
+        lanes[2][0] + lanes[2][1] + lanes[2][2] + lanes[2][3],
+        lanes[3][0] + lanes[3][1] + lanes[3][2] + lanes[3][3]);
+  }
+
+  AddPixelsToClusters(pixels + i * 4, pixel_count - i, clusters);
+}
+
+#endif  // defined(SIMD_SSE2)
+
+// Computes the colors of a batch of PNGs on base::WorkerPool threads, through
+// base::PostParallelChunks(). The worker that finishes the last image posts
+// the reply back to the thread that started the batch.
+class KMeanColorsBatch
+    : public base::RefCountedThreadSafe<KMeanColorsBatch> {
+ public:
+  KMeanColorsBatch(
+      const std::vector<scoped_refptr<RefCountedMemory> >& pngs,
+      uint32_t darkness_limit,
+      uint32_t brightness_limit,
+      const color_utils::KMeanColorsCallback& callback)
+      : pngs_(pngs),
+        darkness_limit_(darkness_limit),
+        brightness_limit_(brightness_limit),
+        callback_(callback),
+        origin_loop_(base::MessageLoopProxy::current()),
+        colors_(pngs.size(), kDefaultBgColor) {
+    DCHECK(origin_loop_) << "The batch replies through a MessageLoop";
+  }
+
+  void Start() {
+    base::PostParallelChunks(
+        static_cast<int>(pngs_.size()),
+        base::Bind(&KMeanColorsBatch::CalculateColor, this),
+        base::Bind(&KMeanColorsBatch::PostReply, this));
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<KMeanColorsBatch>;
+
+  ~KMeanColorsBatch() {}
+
+  void CalculateColor(int image) {
+    // Each image gets its own sampler, so the results do not depend on the
+    // order in which the images are processed.
+    color_utils::GridSampler sampler;
+    colors_[image] = color_utils::CalculateKMeanColorOfPNG(
+        pngs_[image], darkness_limit_, brightness_limit_, sampler);
+  }
+
+  void PostReply() {
+    origin_loop_->PostTask(
+        FROM_HERE, base::Bind(&KMeanColorsBatch::Reply, this));
+  }
+
+  void Reply() {
+    callback_.Run(colors_);
+  }
+
+  const std::vector<scoped_refptr<RefCountedMemory> > pngs_;
+  const uint32_t darkness_limit_;
+  const uint32_t brightness_limit_;
+  const color_utils::KMeanColorsCallback callback_;
+  const scoped_refptr<base::MessageLoopProxy> origin_loop_;
+  std::vector<SkColor> colors_;
+
+  DISALLOW_COPY_AND_ASSIGN(KMeanColorsBatch);
+};
+
 } // namespace
 
 namespace color_utils {
@@ -243,41 +440,22 @@ SkColor CalculateKMeanColorOfPNG(scoped_refptr<RefCountedMemory> png,
       }
     }
 
+    void (*add_pixels)(const uint8_t*, size_t, std::vector<KMeanCluster>*) =
+        &AddPixelsToClusters;
+#if defined(SIMD_SSE2)
+    skia::ConvolutionSIMD simd = skia::BestConvolutionSIMD();
+    if (simd == skia::CONVOLUTION_SIMD_SSE2 ||
+        simd == skia::CONVOLUTION_SIMD_AVX2)
+      add_pixels = &AddPixelsToClusters_SSE2;
+#endif
+
     bool convergence = false;
     for (int iteration = 0;
         iteration < kNumberOfIterations && !convergence && !clusters.empty();
         ++iteration) {
 
-      // Loop through each pixel so we can place it in the appropriate cluster.
-      std::vector<uint8_t>::iterator pixel = decoded_data.begin();
-      while (pixel != decoded_data.end()) {
-        uint8_t b = *(pixel++);
-        if (pixel == decoded_data.end())
-          continue;
-        uint8_t g = *(pixel++);
-        if (pixel == decoded_data.end())
-          continue;
-        uint8_t r = *(pixel++);
-        if (pixel == decoded_data.end())
-          continue;
-        ++pixel; // Ignore the alpha channel.
-
-        uint32_t distance_sqr_to_closest_cluster = UINT_MAX;
-        std::vector<KMeanCluster>::iterator closest_cluster = clusters.begin();
-
-        // Figure out which cluster this color is closest to in RGB space.
-        for (std::vector<KMeanCluster>::iterator cluster = clusters.begin();
-            cluster != clusters.end(); ++cluster) {
-          uint32_t distance_sqr = cluster->GetDistanceSqr(r, g, b);
-
-          if (distance_sqr < distance_sqr_to_closest_cluster) {
-            distance_sqr_to_closest_cluster = distance_sqr;
-            closest_cluster = cluster;
-          }
-        }
-
-        closest_cluster->AddPoint(r, g, b);
-      }
+      // Place each pixel in the appropriate cluster.
+      add_pixels(&decoded_data[0], decoded_data.size() / 4, &clusters);
 
       // Calculate the new cluster centers and see if we've converged or not.
       convergence = true;
@@ -322,4 +500,14 @@ SkColor CalculateKMeanColorOfPNG(scoped_refptr<RefCountedMemory> png,
   return color;
 }
 
+void CalculateKMeanColorsOfPNGs(
+    const std::vector<scoped_refptr<RefCountedMemory> >& pngs,
+    uint32_t darkness_limit,
+    uint32_t brightness_limit,
+    const KMeanColorsCallback& callback) {
+  scoped_refptr<KMeanColorsBatch> batch(new KMeanColorsBatch(
+      pngs, darkness_limit, brightness_limit, callback));
+  batch->Start();
+}
+
 }  // color_utils
@@ -6,7 +6,10 @@
 #define UI_GFX_COLOR_ANALYSIS_H_
 #pragma once
 
+#include <vector>
+
 #include "base/basictypes.h"
+#include "base/callback.h"
 #include "base/compiler_specific.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/ref_counted_memory.h"
@@ -108,6 +111,21 @@ UI_EXPORT SkColor CalculateKMeanColorOfPNG(scoped_refptr<RefCountedMemory> png,
                                            uint32_t brightness_limit,
                                            KMeanImageSampler& sampler);
 
+// Receives the colors of a batch of images, in the order of the images.
+typedef base::Callback<void(const std::vector<SkColor>&)> KMeanColorsCallback;
+
+// Computes CalculateKMeanColorOfPNG() of each of |pngs| on base::WorkerPool
+// threads, sampling each image with its own GridSampler, and runs |callback|
+// with the colors once they are all done. Returns immediately.
+//
+// The calling thread must have a MessageLoop, which runs |callback|, even for
+// an empty batch. The colors are dropped if that loop is gone by then.
+UI_EXPORT void CalculateKMeanColorsOfPNGs(
+    const std::vector<scoped_refptr<RefCountedMemory> >& pngs,
+    uint32_t darkness_limit,
+    uint32_t brightness_limit,
+    const KMeanColorsCallback& callback);
+
 }  // namespace color_utils
 
 #endif  // UI_GFX_COLOR_ANALYSIS_H_
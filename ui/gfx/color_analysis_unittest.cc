@@ -0,0 +1,89 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/gfx/color_analysis.h"
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/memory/ref_counted_memory.h"
+#include "base/message_loop.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "ui/gfx/codec/png_codec.h"
+#include "ui/gfx/size.h"
+
+namespace {
+
+const int kWidth = 40;
+const int kHeight = 30;
+
+// Encodes a kWidth by kHeight image of two colors, with |first| covering
+// |first_rows| rows on top of |second|.
+scoped_refptr<RefCountedMemory> MakePNG(SkColor first,
+                                        SkColor second,
+                                        int first_rows) {
+  std::vector<unsigned char> rgba(kWidth * kHeight * 4);
+  for (int y = 0; y < kHeight; ++y) {
+    SkColor color = y < first_rows ? first : second;
+    for (int x = 0; x < kWidth; ++x) {
+      unsigned char* pixel = &rgba[(y * kWidth + x) * 4];
+      pixel[0] = SkColorGetR(color);
+      pixel[1] = SkColorGetG(color);
+      pixel[2] = SkColorGetB(color);
+      pixel[3] = SkColorGetA(color);
+    }
+  }
+  RefCountedBytes* png = new RefCountedBytes;
+  EXPECT_TRUE(gfx::PNGCodec::Encode(
+      &rgba[0], gfx::PNGCodec::FORMAT_RGBA, gfx::Size(kWidth, kHeight),
+      kWidth * 4, false, std::vector<gfx::PNGCodec::Comment>(), &png->data()));
+  return png;
+}
+
+void StoreColors(std::vector<SkColor>* stored,
+                 const std::vector<SkColor>& colors) {
+  *stored = colors;
+  MessageLoop::current()->Quit();
+}
+
+// Runs CalculateKMeanColorsOfPNGs() on |pngs| and returns its colors.
+std::vector<SkColor> CalculateBatch(
+    const std::vector<scoped_refptr<RefCountedMemory> >& pngs) {
+  std::vector<SkColor> colors;
+  color_utils::CalculateKMeanColorsOfPNGs(
+      pngs, 100, 600, base::Bind(&StoreColors, &colors));
+  MessageLoop::current()->Run();
+  return colors;
+}
+
+}  // namespace
+
+TEST(ColorAnalysis, BatchMatchesSingleImages) {
+  MessageLoop message_loop;
+  std::vector<scoped_refptr<RefCountedMemory> > pngs;
+  pngs.push_back(MakePNG(SK_ColorRED, SK_ColorBLUE, 20));
+  pngs.push_back(MakePNG(SK_ColorGREEN, SK_ColorWHITE, 5));
+  pngs.push_back(MakePNG(SkColorSetRGB(0x80, 0x40, 0x20), SK_ColorBLACK, 15));
+  pngs.push_back(MakePNG(SK_ColorYELLOW, SK_ColorYELLOW, 0));
+
+  std::vector<SkColor> colors = CalculateBatch(pngs);
+  ASSERT_EQ(pngs.size(), colors.size());
+  for (size_t i = 0; i < pngs.size(); ++i) {
+    // The batch samples each image with a GridSampler of its own.
+    color_utils::GridSampler sampler;
+    EXPECT_EQ(color_utils::CalculateKMeanColorOfPNG(pngs[i], 100, 600,
+                                                    sampler),
+              colors[i]) << "image " << i;
+  }
+}
+
+TEST(ColorAnalysis, EmptyBatchReplies) {
+  MessageLoop message_loop;
+  std::vector<SkColor> colors(1, SK_ColorRED);
+  color_utils::CalculateKMeanColorsOfPNGs(
+      std::vector<scoped_refptr<RefCountedMemory> >(), 100, 600,
+      base::Bind(&StoreColors, &colors));
+  MessageLoop::current()->Run();
+  EXPECT_TRUE(colors.empty());
+}
@@ -20,7 +20,14 @@ struct HSL {
   double l;
 };
 
-unsigned char GetLuminanceForColor(SkColor color);
+// Returns the luma of |color|, 0.3 * R + 0.59 * G + 0.11 * B, truncated.
+UI_EXPORT unsigned char GetLuminanceForColor(SkColor color);
+
+// Sets each of the |count| |luminances| to GetLuminanceForColor() of the
+// matching one of |colors|, several at a time where SIMD is available.
+UI_EXPORT void GetLuminancesForColors(const SkColor* colors,
+                                      int count,
+                                      unsigned char* luminances);
 
 // Calculated according to http://www.w3.org/TR/WCAG20/#relativeluminancedef
 UI_EXPORT double RelativeLuminance(SkColor color);
@@ -0,0 +1,384 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/gfx/compositor/committed_layer_tree.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "third_party/skia/include/core/SkCanvas.h"
+#include "ui/gfx/compositor/compositor.h"
+
+namespace {
+
+// Draws the region of |texture| if it isn't empty. |origin| is where the
+// layer is in the texture, which is only away from 0, 0 in a strip of frames.
+void DrawRegion(ui::Texture* texture,
+                const ui::TextureDrawParams& params,
+                const gfx::Point& origin,
+                const gfx::Rect& region_to_draw) {
+  if (region_to_draw.IsEmpty())
+    return;
+  if (origin.x() == 0 && origin.y() == 0) {
+    texture->Draw(params, region_to_draw);
+    return;
+  }
+  ui::TextureDrawParams region_params = params;
+  region_params.transform.SetTranslate(static_cast<float>(-origin.x()),
+                                       static_cast<float>(-origin.y()));
+  region_params.transform.ConcatTransform(params.transform);
+  region_params.filter_texture_bounds.Offset(origin.x(), origin.y());
+  gfx::Rect region(region_to_draw);
+  region.Offset(origin.x(), origin.y());
+  texture->Draw(region_params, region);
+}
+
+}  // namespace
+
+namespace ui {
+
+// CompositorAnimation ---------------------------------------------------------
+
+CompositorAnimation::CompositorAnimation()
+    : property(TRANSFORM),
+      tween_type(Tween::LINEAR),
+      start_opacity(1.0f),
+      target_opacity(1.0f),
+      value(0.0) {
+}
+
+CompositorAnimation::~CompositorAnimation() {
+}
+
+double CompositorAnimation::GetState(base::TimeTicks now) const {
+  if (IsDone(now))
+    return 1.0;
+  double state = (now - start_time).InMillisecondsF() /
+      duration.InMillisecondsF();
+  return std::max(state, 0.0);
+}
+
+bool CompositorAnimation::IsDone(base::TimeTicks now) const {
+  return now >= start_time + duration;
+}
+
+// CommittedLayerTree ----------------------------------------------------------
+
+CommittedLayerTree::Upload::Upload() {
+}
+
+CommittedLayerTree::Upload::~Upload() {
+}
+
+CommittedLayerTree::Node::Node()
+    : parent(-1),
+      subtree_end(0),
+      opacity(1.0f),
+      fills_bounds_opaquely(false),
+      masks_to_bounds(false),
+      has_valid_alpha_channel(true),
+      frame_count(0) {
+}
+
+CommittedLayerTree::Node::~Node() {
+}
+
+CommittedLayerTree::CommittedLayerTree() {
+}
+
+CommittedLayerTree::~CommittedLayerTree() {
+}
+
+void CommittedLayerTree::SetNow(base::TimeTicks now) {
+  now_ = now;
+
+  // The animations are tweened a run of the same type at a time, which is
+  // most of them, since they mostly come as sets, from the same settings.
+  std::vector<CompositorAnimation*> animations;
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    for (size_t j = 0; j < nodes_[i].animations.size(); ++j)
+      animations.push_back(&nodes_[i].animations[j]);
+  }
+  if (animations.empty())
+    return;
+  std::vector<double> values(animations.size());
+  for (size_t i = 0; i < animations.size(); ++i)
+    values[i] = animations[i]->GetState(now_);
+  size_t run_start = 0;
+  for (size_t i = 1; i <= animations.size(); ++i) {
+    if (i < animations.size() &&
+        animations[i]->tween_type == animations[run_start]->tween_type) {
+      continue;
+    }
+    Tween::CalculateValues(animations[run_start]->tween_type,
+                           &values[run_start], &values[run_start],
+                           i - run_start);
+    run_start = i;
+  }
+  for (size_t i = 0; i < animations.size(); ++i)
+    animations[i]->value = values[i];
+}
+
+void CommittedLayerTree::UploadPixels() {
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    Node& node = nodes_[i];
+    for (size_t j = 0; j < node.uploads.size(); ++j) {
+      SkCanvas canvas(node.uploads[j].bitmap);
+      node.texture->SetCanvas(canvas, node.uploads[j].origin,
+                              node.bounds.size());
+    }
+    node.uploads.clear();
+    for (size_t j = 0; j < node.filter_uploads.size(); ++j) {
+      const SkBitmap& bitmap = node.filter_uploads[j].bitmap;
+      SkCanvas canvas(bitmap);
+      node.filter_texture->SetCanvas(
+          canvas, node.filter_uploads[j].origin,
+          gfx::Size(bitmap.width(), bitmap.height()));
+    }
+    node.filter_uploads.clear();
+    for (size_t j = 0; j < node.frames_uploads.size(); ++j) {
+      const SkBitmap& bitmap = node.frames_uploads[j].bitmap;
+      SkCanvas canvas(bitmap);
+      node.frames_texture->SetCanvas(
+          canvas, gfx::Point(), gfx::Size(bitmap.width(), bitmap.height()));
+    }
+    node.frames_uploads.clear();
+  }
+}
+
+void CommittedLayerTree::DamageAnimatedLayers(gfx::Rect* damage_rect) const {
+  for (int i = 0; i < static_cast<int>(nodes_.size()); ++i) {
+    if (nodes_[i].animations.empty())
+      continue;
+    for (int j = i; j < nodes_[i].subtree_end; ++j) {
+      if (!nodes_[j].texture.get())
+        continue;
+      gfx::Rect rect(GetBounds(j).size());
+      GetTargetTransform(j).TransformRect(&rect);
+      // The transformed corners are rounded, see Layer::DamageRect().
+      rect.Inset(-1, -1);
+      *damage_rect = damage_rect->Union(rect);
+    }
+  }
+}
+
+bool CommittedLayerTree::HasRunningAnimations() const {
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    if (nodes_[i].frames_texture.get())
+      return true;
+    const std::vector<CompositorAnimation>& animations = nodes_[i].animations;
+    for (size_t j = 0; j < animations.size(); ++j) {
+      if (!animations[j].IsDone(now_))
+        return true;
+    }
+  }
+  return false;
+}
+
+bool CommittedLayerTree::IsRootAnimated() const {
+  return !nodes_.empty() && !nodes_[0].animations.empty();
+}
+
+void CommittedLayerTree::Animate(base::TimeTicks now, gfx::Rect* damage_rect) {
+  // A layer with frames only needs drawing when it steps to another one.
+  // Those that other animations move are damaged below.
+  for (int i = 0; i < static_cast<int>(nodes_.size()); ++i) {
+    if (!nodes_[i].frames_texture.get() ||
+        GetFrame(i, now) == GetFrame(i, now_))
+      continue;
+    gfx::Rect rect(GetBounds(i).size());
+    GetTargetTransform(i).TransformRect(&rect);
+    rect.Inset(-1, -1);
+    *damage_rect = damage_rect->Union(rect);
+  }
+
+  if (!HasRunningAnimations()) {
+    SetNow(now);
+    return;
+  }
+  DamageAnimatedLayers(damage_rect);
+  SetNow(now);
+  DamageAnimatedLayers(damage_rect);
+}
+
+void CommittedLayerTree::Draw(const gfx::Size& compositor_size) {
+  for (int i = 0; i < static_cast<int>(nodes_.size()); ++i)
+    DrawNode(i, compositor_size);
+}
+
+gfx::Rect CommittedLayerTree::GetBounds(int index) const {
+  const Node& node = nodes_[index];
+  for (size_t i = 0; i < node.animations.size(); ++i) {
+    const CompositorAnimation& animation = node.animations[i];
+    if (animation.property != CompositorAnimation::LOCATION)
+      continue;
+    double value = animation.value;
+    return gfx::Rect(
+        Tween::ValueBetween(value, animation.start_location.x(),
+                            animation.target_location.x()),
+        Tween::ValueBetween(value, animation.start_location.y(),
+                            animation.target_location.y()),
+        node.bounds.width(), node.bounds.height());
+  }
+  return node.bounds;
+}
+
+Transform CommittedLayerTree::GetTransform(int index) const {
+  const Node& node = nodes_[index];
+  for (size_t i = 0; i < node.animations.size(); ++i) {
+    const CompositorAnimation& animation = node.animations[i];
+    if (animation.property != CompositorAnimation::TRANSFORM)
+      continue;
+    double value = animation.value;
+    Transform transform;
+    for (int row = 0; row < 4; ++row) {
+      for (int col = 0; col < 4; ++col) {
+        transform.matrix().set(row, col, static_cast<SkMScalar>(
+            Tween::ValueBetween(
+                value, animation.start_transform.matrix().get(row, col),
+                animation.target_transform.matrix().get(row, col))));
+      }
+    }
+    return transform;
+  }
+  return node.transform;
+}
+
+float CommittedLayerTree::GetOpacity(int index) const {
+  const Node& node = nodes_[index];
+  for (size_t i = 0; i < node.animations.size(); ++i) {
+    const CompositorAnimation& animation = node.animations[i];
+    if (animation.property != CompositorAnimation::OPACITY)
+      continue;
+    return static_cast<float>(Tween::ValueBetween(
+        animation.value, animation.start_opacity,
+        animation.target_opacity));
+  }
+  return node.opacity;
+}
+
+int CommittedLayerTree::GetFrame(int index, base::TimeTicks now) const {
+  const Node& node = nodes_[index];
+  if (node.frame_count <= 1 || node.frame_time <= base::TimeDelta() ||
+      now <= node.frames_start_time)
+    return 0;
+  return static_cast<int>(
+      ((now - node.frames_start_time) / node.frame_time) % node.frame_count);
+}
+
+float CommittedLayerTree::GetCombinedOpacity(int index) const {
+  float opacity = 1.0f;
+  for (int i = index; i != -1; i = nodes_[i].parent)
+    opacity *= GetOpacity(i);
+  return opacity;
+}
+
+Transform CommittedLayerTree::GetTargetTransform(int index) const {
+  Transform transform;
+  for (int i = index; i != -1; i = nodes_[i].parent) {
+    transform.ConcatTransform(GetTransform(i));
+    gfx::Rect bounds = GetBounds(i);
+    transform.ConcatTranslate(static_cast<float>(bounds.x()),
+                              static_cast<float>(bounds.y()));
+  }
+  return transform;
+}
+
+gfx::Rect CommittedLayerTree::GetHoleRect(int index) const {
+  for (int i = index + 1; i < nodes_[index].subtree_end;
+       i = nodes_[i].subtree_end) {
+    DCHECK_EQ(index, nodes_[i].parent);
+    if (nodes_[i].fills_bounds_opaquely &&
+        GetCombinedOpacity(i) == 1.0f &&
+        !GetTransform(i).HasChange()) {
+      return GetBounds(i);
+    }
+  }
+  return gfx::Rect();
+}
+
+gfx::Rect CommittedLayerTree::GetClipRect(int index) const {
+  gfx::Rect clip_rect(GetBounds(index).size());
+  // The origin of the node in the coordinates of the parent of |i|.
+  gfx::Point origin;
+  for (int i = index; nodes_[i].parent != -1; i = nodes_[i].parent) {
+    gfx::Rect bounds = GetBounds(i);
+    origin.Offset(bounds.x(), bounds.y());
+    int parent = nodes_[i].parent;
+    if (!nodes_[parent].masks_to_bounds)
+      continue;
+    gfx::Rect parent_clip(GetBounds(parent).size());
+    parent_clip.Offset(-origin.x(), -origin.y());
+    clip_rect = clip_rect.Intersect(parent_clip);
+  }
+  return clip_rect;
+}
+
+void CommittedLayerTree::DrawNode(int index,
+                                  const gfx::Size& compositor_size) {
+  const Node& node = nodes_[index];
+  const float combined_opacity = GetCombinedOpacity(index);
+  Texture* texture = node.frames_texture.get() ? node.frames_texture.get() :
+                                                 node.texture.get();
+  if (!texture || combined_opacity == 0.0f)
+    return;
+
+  ui::TextureDrawParams texture_draw_params;
+  texture_draw_params.transform = GetTargetTransform(index);
+
+  // Only blend for transparent child layers (and when we're forcing
+  // transparency). The root layer will clobber the cleared bg.
+  const bool is_root = node.parent == -1;
+  const bool forcing_transparency = combined_opacity < 1.0f;
+  const bool is_opaque =
+      node.fills_bounds_opaquely || !node.has_valid_alpha_channel;
+  texture_draw_params.blend = !is_root && (forcing_transparency || !is_opaque);
+
+  texture_draw_params.compositor_size = compositor_size;
+  texture_draw_params.opacity = combined_opacity;
+  texture_draw_params.has_valid_alpha_channel = node.has_valid_alpha_channel;
+  texture_draw_params.filter = node.filter;
+  texture_draw_params.filter_texture = node.filter_texture.get();
+  texture_draw_params.filter_texture_bounds = gfx::Rect(node.bounds.size());
+
+  // The frames are side by side in their strip, so that only the region of
+  // the strip drawn changes from one to the next.
+  int width = node.bounds.width();
+  int height = node.bounds.height();
+  gfx::Point origin;
+  if (node.frames_texture.get()) {
+    width = std::min(width, node.frame_size.width());
+    height = std::min(height, node.frame_size.height());
+    origin.set_x(GetFrame(index, now_) * node.frame_size.width());
+  }
+  gfx::Rect clip_rect =
+      GetClipRect(index).Intersect(gfx::Rect(0, 0, width, height));
+  if (clip_rect.IsEmpty())
+    return;
+  gfx::Rect hole_rect = GetHoleRect(index).Intersect(clip_rect);
+  if (hole_rect.IsEmpty()) {
+    DrawRegion(texture, texture_draw_params, origin, clip_rect);
+    return;
+  }
+
+  // Top (above the hole).
+  DrawRegion(texture, texture_draw_params, origin,
+             gfx::Rect(clip_rect.x(), clip_rect.y(), clip_rect.width(),
+                       hole_rect.y() - clip_rect.y()));
+  // Left (of the hole).
+  DrawRegion(texture, texture_draw_params, origin,
+             gfx::Rect(clip_rect.x(), hole_rect.y(),
+                       hole_rect.x() - clip_rect.x(), hole_rect.height()));
+  // Right (of the hole).
+  DrawRegion(texture, texture_draw_params, origin,
+             gfx::Rect(hole_rect.right(), hole_rect.y(),
+                       clip_rect.right() - hole_rect.right(),
+                       hole_rect.height()));
+  // Bottom (below the hole).
+  DrawRegion(texture, texture_draw_params, origin,
+             gfx::Rect(clip_rect.x(), hole_rect.bottom(), clip_rect.width(),
+                       clip_rect.bottom() - hole_rect.bottom()));
+}
+
+}  // namespace ui
@@ -0,0 +1,193 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef UI_GFX_COMPOSITOR_COMMITTED_LAYER_TREE_H_
+#define UI_GFX_COMPOSITOR_COMMITTED_LAYER_TREE_H_
+#pragma once
+
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+#include "base/time.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "ui/base/animation/tween.h"
+#include "ui/gfx/compositor/compositor.h"
+#include "ui/gfx/compositor/compositor_export.h"
+#include "ui/gfx/point.h"
+#include "ui/gfx/rect.h"
+#include "ui/gfx/size.h"
+#include "ui/gfx/transform.h"
+
+namespace ui {
+
+// An animation of a property of a Layer that the compositor runs itself, as a
+// curve evaluated when it draws, so that the UI thread has nothing to do for
+// its frames, and, when compositing is threaded, so that it goes on at the
+// frame rate while the UI thread is busy. See Layer::SetCompositorAnimation().
+struct COMPOSITOR_EXPORT CompositorAnimation {
+  enum Property {
+    LOCATION,
+    TRANSFORM,
+    OPACITY
+  };
+
+  CompositorAnimation();
+  ~CompositorAnimation();
+
+  // Returns how far along the animation is at |now|, from 0 to 1, before it
+  // is tweened.
+  double GetState(base::TimeTicks now) const;
+
+  // Returns true if the animation is over at |now|.
+  bool IsDone(base::TimeTicks now) const;
+
+  Property property;
+  base::TimeTicks start_time;
+  base::TimeDelta duration;
+  Tween::Type tween_type;
+
+  // The values the animation goes between, for its |property|.
+  gfx::Point start_location;
+  gfx::Point target_location;
+  Transform start_transform;
+  Transform target_transform;
+  float start_opacity;
+  float target_opacity;
+
+  // The tweened value at the current time of the tree, which the tree keeps
+  // rather than tweening once for each time a layer is looked at.
+  double value;
+
+  // Copy and assignment are allowed.
+};
+
+// A copy of a tree of Layers, made by Layer::CommitTree() on the UI thread,
+// that the compositor draws, and animates, without touching the Layers. The
+// tree keeps the textures of its layers alive, and the pixels painted into
+// them since the last commit, which UploadPixels() gives to the textures
+// before the tree is first drawn.
+class COMPOSITOR_EXPORT CommittedLayerTree {
+ public:
+  // The pixels of a region of a texture.
+  struct Upload {
+    Upload();
+    ~Upload();
+
+    // Not shared with the canvas it was painted into.
+    SkBitmap bitmap;
+    gfx::Point origin;
+  };
+
+  // A visible Layer. The nodes are kept in the order the layers are drawn,
+  // parents before their children.
+  struct Node {
+    Node();
+    ~Node();
+
+    // NULL for the layers without a texture.
+    scoped_refptr<Texture> texture;
+
+    // The index of the parent, -1 for the root, and one past that of the last
+    // descendant.
+    int parent;
+    int subtree_end;
+
+    gfx::Rect bounds;
+    Transform transform;
+    float opacity;
+    bool fills_bounds_opaquely;
+    bool masks_to_bounds;
+    bool has_valid_alpha_channel;
+
+    // The properties above that are animated by the compositor.
+    std::vector<CompositorAnimation> animations;
+
+    std::vector<Upload> uploads;
+
+    // The filter of the layer, the texture it samples, if any, and the
+    // pixels painted into that texture since the last commit.
+    TextureFilter filter;
+    scoped_refptr<Texture> filter_texture;
+    std::vector<Upload> filter_uploads;
+
+    // The strip of frames drawn instead of |texture|, if any, the pixels
+    // given to it since the last commit, and how it steps through them. See
+    // Layer::SetFrames().
+    scoped_refptr<Texture> frames_texture;
+    std::vector<Upload> frames_uploads;
+    int frame_count;
+    gfx::Size frame_size;
+    base::TimeTicks frames_start_time;
+    base::TimeDelta frame_time;
+  };
+
+  CommittedLayerTree();
+  ~CommittedLayerTree();
+
+  std::vector<Node>* nodes() { return &nodes_; }
+
+  // Sets the time the animations are drawn at, which Animate() moves forward.
+  void SetNow(base::TimeTicks now);
+
+  // Gives the textures the pixels painted since the last commit.
+  void UploadPixels();
+
+  // Adds to |damage_rect| the area covered by the layers that are animated,
+  // and by their descendants, as they are at the current time.
+  void DamageAnimatedLayers(gfx::Rect* damage_rect) const;
+
+  // Returns true if some animation isn't over at the current time, or some
+  // layer steps through frames, which it does until it is committed without.
+  bool HasRunningAnimations() const;
+
+  // Returns true if the root has animations, which may keep it from covering
+  // the compositor.
+  bool IsRootAnimated() const;
+
+  // Moves the animations to |now|, adding to |damage_rect| where the layers
+  // they move were and are now, and the layers that step to another frame.
+  void Animate(base::TimeTicks now, gfx::Rect* damage_rect);
+
+  // Draws the layers, as Layer::Draw() used to, on a compositor of
+  // |compositor_size|.
+  void Draw(const gfx::Size& compositor_size);
+
+ private:
+  // The animated properties of the node at |index|, at the current time.
+  gfx::Rect GetBounds(int index) const;
+  Transform GetTransform(int index) const;
+  float GetOpacity(int index) const;
+
+  // Returns the frame the node at |index| draws at |now|, if it has frames.
+  int GetFrame(int index, base::TimeTicks now) const;
+
+  // Returns the opacity of the node at |index| combined with those of its
+  // ancestors.
+  float GetCombinedOpacity(int index) const;
+
+  // Returns the transform from the node at |index| to the compositor.
+  Transform GetTargetTransform(int index) const;
+
+  // Returns the area of the node at |index| that is covered by an opaque
+  // child, and need not be drawn. See Layer::RecomputeHole().
+  gfx::Rect GetHoleRect(int index) const;
+
+  // Returns the area of the node at |index| that the ancestors that mask to
+  // their bounds let it draw, all of it if none do. See
+  // Layer::SetMasksToBounds().
+  gfx::Rect GetClipRect(int index) const;
+
+  void DrawNode(int index, const gfx::Size& compositor_size);
+
+  std::vector<Node> nodes_;
+
+  base::TimeTicks now_;
+
+  DISALLOW_COPY_AND_ASSIGN(CommittedLayerTree);
+};
+
+}  // namespace ui
+
+#endif  // UI_GFX_COMPOSITOR_COMMITTED_LAYER_TREE_H_
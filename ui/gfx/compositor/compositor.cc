@@ -4,27 +4,142 @@
 
 #include "ui/gfx/compositor/compositor.h"
 
+#include "base/bind.h"
+#include "base/compiler_specific.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/message_loop_proxy.h"
+#include "base/threading/thread.h"
+#include "base/time.h"
+#include "ui/gfx/compositor/committed_layer_tree.h"
 #include "ui/gfx/compositor/compositor_observer.h"
 #include "ui/gfx/compositor/layer.h"
 
+namespace {
+
+// Started by Compositor::Initialize() for the compositors to draw on.
+base::Thread* g_compositor_thread = NULL;
+
+// The time between the frames drawn while animations are running.
+const int kAnimationFrameDelayMs = 16;
+
+}  // namespace
+
 namespace ui {
 
+// static
+void Compositor::Initialize(bool use_thread) {
+  DCHECK(!g_compositor_thread);
+  if (!use_thread)
+    return;
+  g_compositor_thread = new base::Thread("Compositor");
+  if (!g_compositor_thread->Start()) {
+    delete g_compositor_thread;
+    g_compositor_thread = NULL;
+  }
+}
+
+// static
+void Compositor::Terminate() {
+  if (!g_compositor_thread)
+    return;
+  g_compositor_thread->Stop();
+  delete g_compositor_thread;
+  g_compositor_thread = NULL;
+}
+
+// static
+bool Compositor::IsThreaded() {
+  return g_compositor_thread != NULL;
+}
+
 Compositor::Compositor(CompositorDelegate* delegate, const gfx::Size& size)
     : delegate_(delegate),
       size_(size),
-      root_layer_(NULL) {
+      damage_rect_(size),
+      paint_scheduled_(false),
+      root_layer_(NULL),
+      ui_loop_(base::MessageLoopProxy::current()),
+      animation_frame_pending_(false),
+      ALLOW_THIS_IN_INITIALIZER_LIST(weak_factory_(this)) {
 }
 
 Compositor::~Compositor() {
+  for (size_t i = 0; i < pending_commits_.size(); ++i)
+    delete pending_commits_[i].tree;
+}
+
+void Compositor::AddDamage(const gfx::Rect& damage_rect) {
+  damage_rect_ = damage_rect_.Union(damage_rect.Intersect(gfx::Rect(size_)));
+}
+
+void Compositor::set_root_layer(Layer* root_layer) {
+  if (root_layer == root_layer_)
+    return;
+  root_layer_ = root_layer;
+  if (root_layer_)
+    return;
+
+  // The textures of the committed tree keep the compositor alive.
+  if (g_compositor_thread) {
+    g_compositor_thread->message_loop_proxy()->PostTask(
+        FROM_HERE, base::Bind(&Compositor::ReleaseCommittedTree, this));
+  } else {
+    ReleaseCommittedTree();
+  }
 }
 
 void Compositor::Draw(bool force_clear) {
+  paint_scheduled_ = false;
   if (!root_layer_)
     return;
 
-  NotifyStart(force_clear);
-  root_layer_->DrawTree();
-  NotifyEnd();
+  // The last frame is kept outside of what is damaged. Clearing throws it
+  // away, so then all of the frame is drawn.
+  if (force_clear)
+    damage_rect_ = gfx::Rect(size_);
+  gfx::Rect damage_rect = damage_rect_.Intersect(gfx::Rect(size_));
+  damage_rect_ = gfx::Rect();
+  if (damage_rect.IsEmpty()) {
+    // Nothing changed in the layers since the last commit, so this is a paint
+    // for the compositor animations, or one that lost nothing.
+    if (!g_compositor_thread) {
+      base::AutoLock lock(draw_lock_);
+      DrawFrame();
+    }
+    return;
+  }
+
+  CommittedLayerTree* tree = new CommittedLayerTree;
+  root_layer_->CommitTree(tree);
+  if (!g_compositor_thread) {
+    base::AutoLock lock(draw_lock_);
+    ApplyCommit(tree, damage_rect);
+    DrawFrame();
+    return;
+  }
+
+  // The trees wait for the compositor thread in order, since each has pixels
+  // for the textures. The task posted for the first one draws them all.
+  bool post_task;
+  {
+    base::AutoLock lock(commit_lock_);
+    post_task = pending_commits_.empty();
+    PendingCommit commit = { tree, damage_rect };
+    pending_commits_.push_back(commit);
+  }
+  if (post_task) {
+    g_compositor_thread->message_loop_proxy()->PostTask(
+        FROM_HERE, base::Bind(&Compositor::DrawPendingCommits, this));
+  }
+}
+
+void Compositor::WidgetSizeChanged(const gfx::Size& size) {
+  base::AutoLock lock(draw_lock_);
+  size_ = size;
+  damage_rect_ = gfx::Rect(size_);
+  frame_damage_rect_ = gfx::Rect(size_);
+  OnWidgetSizeChanged();
 }
 
 void Compositor::AddObserver(CompositorObserver* observer) {
@@ -39,12 +154,104 @@ bool Compositor::HasObserver(CompositorObserver* observer) {
   return observer_list_.HasObserver(observer);
 }
 
-void Compositor::NotifyStart(bool clear) {
-  OnNotifyStart(clear);
+void Compositor::DrawPendingCommits() {
+  std::vector<PendingCommit> commits;
+  {
+    base::AutoLock lock(commit_lock_);
+    commits.swap(pending_commits_);
+  }
+  base::AutoLock lock(draw_lock_);
+  for (size_t i = 0; i < commits.size(); ++i)
+    ApplyCommit(commits[i].tree, commits[i].damage_rect);
+  DrawFrame();
+}
+
+void Compositor::DrawAnimationFrame() {
+  base::AutoLock lock(draw_lock_);
+  animation_frame_pending_ = false;
+  DrawFrame();
+}
+
+void Compositor::ScheduleAnimationPaint() {
+  {
+    base::AutoLock lock(draw_lock_);
+    animation_frame_pending_ = false;
+  }
+  SchedulePaint();
+}
+
+void Compositor::ReleaseCommittedTree() {
+  base::AutoLock lock(draw_lock_);
+  committed_tree_.reset();
+}
+
+void Compositor::ApplyCommit(CommittedLayerTree* tree,
+                             const gfx::Rect& damage_rect) {
+  draw_lock_.AssertAcquired();
+  tree->UploadPixels();
+
+  // The UI thread doesn't know where the compositor has the layers it
+  // animates, so all they cover is damaged, in the old tree and the new one.
+  tree->SetNow(base::TimeTicks::Now());
+  if (committed_tree_.get())
+    committed_tree_->DamageAnimatedLayers(&frame_damage_rect_);
+  tree->DamageAnimatedLayers(&frame_damage_rect_);
+  frame_damage_rect_ = frame_damage_rect_.Union(damage_rect);
+  committed_tree_.reset(tree);
+}
+
+void Compositor::DrawFrame() {
+  draw_lock_.AssertAcquired();
+  if (!committed_tree_.get())
+    return;
+
+  // The UI thread only knows if the root layer covers the widget for the
+  // values it has, so while the root is animated, all of the frames are
+  // cleared.
+  if (committed_tree_->IsRootAnimated())
+    frame_damage_rect_ = gfx::Rect(size_);
+  committed_tree_->Animate(base::TimeTicks::Now(), &frame_damage_rect_);
+  gfx::Rect damage_rect = frame_damage_rect_.Intersect(gfx::Rect(size_));
+  frame_damage_rect_ = gfx::Rect();
+  if (!damage_rect.IsEmpty()) {
+    NotifyStart(damage_rect.size() == size_, damage_rect);
+    committed_tree_->Draw(size_);
+    NotifyEnd();
+  }
+
+  if (animation_frame_pending_ || !committed_tree_->HasRunningAnimations())
+    return;
+  animation_frame_pending_ = true;
+  if (g_compositor_thread) {
+    g_compositor_thread->message_loop_proxy()->PostDelayedTask(
+        FROM_HERE, base::Bind(&Compositor::DrawAnimationFrame, this),
+        kAnimationFrameDelayMs);
+  } else {
+    // The frame is drawn by the Draw() of the paint, which commits nothing
+    // unless the layers changed.
+    ui_loop_->PostDelayedTask(
+        FROM_HERE,
+        base::Bind(&Compositor::ScheduleAnimationPaint,
+                   weak_factory_.GetWeakPtr()),
+        kAnimationFrameDelayMs);
+  }
+}
+
+void Compositor::NotifyStart(bool clear, const gfx::Rect& damage_rect) {
+  OnNotifyStart(clear, damage_rect);
 }
 
 void Compositor::NotifyEnd() {
   OnNotifyEnd();
+  if (g_compositor_thread) {
+    ui_loop_->PostTask(FROM_HERE,
+                       base::Bind(&Compositor::NotifyCompositingEnded, this));
+  } else {
+    NotifyCompositingEnded();
+  }
+}
+
+void Compositor::NotifyCompositingEnded() {
   FOR_EACH_OBSERVER(CompositorObserver,
                     observer_list_,
                     OnCompositingEnded(this));
@@ -35,6 +35,8 @@
         'COMPOSITOR_IMPLEMENTATION',
       ],
       'sources': [
+        'committed_layer_tree.cc',
+        'committed_layer_tree.h',
         'compositor.cc',
         'compositor.h',
         'compositor_export.h',
@@ -47,6 +49,8 @@
         'layer.h',
         'layer_animator.cc',
         'layer_animator.h',
+        'tiled_texture.cc',
+        'tiled_texture.h',
       ],
       'conditions': [
         ['os_posix == 1 and OS != "mac"', {
@@ -66,6 +70,7 @@
           'link_settings': {
             'libraries': [
               '-ld3d10.lib',
+              '-ld3d10_1.lib',
               '-ld3dx10d.lib',
               '-ldxerr.lib',
               '-ldxguid.lib',
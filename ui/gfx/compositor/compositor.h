@@ -6,29 +6,77 @@
 #define UI_GFX_COMPOSITOR_COMPOSITOR_H_
 #pragma once
 
+#include <vector>
+
 #include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/weak_ptr.h"
 #include "base/observer_list.h"
+#include "base/synchronization/lock.h"
+#include "ui/gfx/color_utils.h"
 #include "ui/gfx/compositor/compositor_export.h"
 #include "ui/gfx/transform.h"
 #include "ui/gfx/native_widget_types.h"
+#include "ui/gfx/rect.h"
 #include "ui/gfx/size.h"
 
 class SkCanvas;
+namespace base {
+class MessageLoopProxy;
+}
 namespace gfx {
 class Point;
-class Rect;
 }
 
 namespace ui {
 
+class CommittedLayerTree;
 class CompositorObserver;
 class Layer;
+class Texture;
+
+// A filter the compositor applies to the pixels of a texture as it draws
+// them, for the effects that would otherwise be painted with
+// SkBitmapOperations: changing the filter, or animating its parameters,
+// repaints nothing. See Layer::SetFilter().
+struct TextureFilter {
+  enum Type {
+    // The pixels are drawn as they are.
+    FILTER_NONE,
+    // The colors are moved towards gray by |amount|, 1 removing all color.
+    FILTER_GRAYSCALE,
+    // The colors are shifted by |hsl_shift|, as by color_utils::HSLShift().
+    FILTER_HSL_SHIFT,
+    // The pixels are masked by the alpha of the filter texture, as by
+    // SkBitmapOperations::CreateMaskedBitmap().
+    FILTER_MASK,
+    // The filter texture is blended over the pixels with an opacity of
+    // |amount|, as by SkBitmapOperations::CreateBlendedBitmap().
+    FILTER_BLEND,
+  };
+
+  TextureFilter() : type(FILTER_NONE), amount(1.0f) {
+    hsl_shift.h = hsl_shift.s = hsl_shift.l = -1;
+  }
+
+  // Returns true if the filter samples the filter texture.
+  bool UsesFilterTexture() const {
+    return type == FILTER_MASK || type == FILTER_BLEND;
+  }
+
+  Type type;
+  float amount;
+  color_utils::HSL hsl_shift;
+
+  // Copy and assignment are allowed.
+};
 
 struct TextureDrawParams {
   TextureDrawParams()
       : blend(false),
         has_valid_alpha_channel(false),
-        opacity(1.0f) {
+        opacity(1.0f),
+        filter_texture(NULL) {
   }
 
   // The transform to be applied to the texture.
@@ -48,6 +96,14 @@ struct TextureDrawParams {
   // The size of the surface that the texture is drawn to.
   gfx::Size compositor_size;
 
+  // The filter the pixels are drawn through, and the texture the mask and
+  // blend filters sample, which is stretched over |filter_texture_bounds|,
+  // in the coordinates of the texture drawn. The pixels are drawn as they are
+  // when the filter needs a texture, and there is none.
+  TextureFilter filter;
+  Texture* filter_texture;
+  gfx::Rect filter_texture_bounds;
+
   // Copy and assignment are allowed.
 };
 
@@ -58,8 +114,11 @@ struct TextureDrawParams {
 // Texture is really a proxy to the gpu. Texture does not itself keep a copy of
 // the bitmap.
 //
-// Views own the Texture.
-class COMPOSITOR_EXPORT Texture : public base::RefCounted<Texture> {
+// Views own the Texture. When compositing is threaded, SetCanvas() and Draw()
+// are called on the compositor thread, and the committed layer trees it draws
+// keep references to the textures of their layers.
+class COMPOSITOR_EXPORT Texture
+    : public base::RefCountedThreadSafe<Texture> {
  public:
   // Sets the canvas of this texture. The origin is at |origin|.
   // |overall_size| gives the total size of texture.
@@ -75,7 +134,7 @@ class COMPOSITOR_EXPORT Texture : public base::RefCounted<Texture> {
   virtual ~Texture() {}
 
  private:
-  friend class base::RefCounted<Texture>;
+  friend class base::RefCountedThreadSafe<Texture>;
 };
 
 // An interface to allow the compositor to communicate with its owner.
@@ -93,8 +152,24 @@ class COMPOSITOR_EXPORT CompositorDelegate {
 // displayable form of pixels comprising a single widget's contents. It draws an
 // appropriately transformed texture for each transformed view in the widget's
 // view hierarchy.
-class COMPOSITOR_EXPORT Compositor : public base::RefCounted<Compositor> {
+//
+// Each Draw() commits a copy of the layer tree, which the compositor draws on
+// the compositor thread when compositing is threaded, and otherwise right
+// away. While a committed tree has compositor animations running, the
+// compositor draws frames of its own, without committing, so the animations
+// don't need the UI thread: on the compositor thread, or, without one, from
+// the paints it schedules.
+class COMPOSITOR_EXPORT Compositor
+    : public base::RefCountedThreadSafe<Compositor> {
  public:
+  // Starts the compositor thread if |use_thread| is true. Must be called
+  // before any compositor is created, and matched by Terminate().
+  static void Initialize(bool use_thread);
+  static void Terminate();
+
+  // Returns true if the compositors draw on the compositor thread.
+  static bool IsThreaded();
+
   // Create a compositor from the provided handle.
   static Compositor* Create(CompositorDelegate* delegate,
                             gfx::AcceleratedWidget widget,
@@ -108,28 +183,41 @@ class COMPOSITOR_EXPORT Compositor : public base::RefCounted<Compositor> {
 
   // Schedules a paint on the widget this Compositor was created for.
   void SchedulePaint() {
+    paint_scheduled_ = true;
     delegate_->ScheduleCompositorPaint();
   }
 
-  // Sets the root of the layer tree drawn by this Compositor.
-  // The Compositor does not own the root layer.
-  void set_root_layer(Layer* root_layer) {
-    root_layer_ = root_layer;
-  }
+  // Returns true if SchedulePaint() was called since the last Draw(), which
+  // the compositor does for the damage of its layers and the frames of its
+  // animations.
+  bool paint_scheduled() const { return paint_scheduled_; }
 
-  // Draws the scene created by the layer tree and any visual effects. If
-  // |force_clear| is true, this will cause the compositor to clear before
-  // compositing.
+  // Adds |damage_rect|, in the coordinates of the widget, to the area that
+  // the next Draw() redraws. Layers add the areas their changes affect, so
+  // that the frames only redraw those. Doesn't schedule a paint.
+  void AddDamage(const gfx::Rect& damage_rect);
+
+  // Sets the root of the layer tree drawn by this Compositor.
+  // The Compositor does not own the root layer. Setting it to NULL drops the
+  // committed tree, and the references it has to the textures.
+  void set_root_layer(Layer* root_layer);
+  Layer* root_layer() { return root_layer_; }
+
+  // Commits the layer tree, painting the layers that need it, and draws the
+  // scene it makes and any visual effects, within the damaged area. Nothing
+  // is committed if none of the widget is damaged; without a compositor
+  // thread, the frame of the running compositor animations, if any, is then
+  // drawn from the last tree committed. If
+  // |force_clear| is true, this will cause the compositor to clear and redraw
+  // the whole widget.
   void Draw(bool force_clear);
 
   // Notifies the compositor that the size of the widget that it is
-  // drawing to has changed.
-  void WidgetSizeChanged(const gfx::Size& size) {
-    size_ = size;
-    OnWidgetSizeChanged();
-  }
+  // drawing to has changed. All of it is redrawn by the next Draw().
+  void WidgetSizeChanged(const gfx::Size& size);
 
-  // Returns the size of the widget that is being drawn to.
+  // Returns the size of the widget that is being drawn to. On the compositor
+  // thread, only valid while drawing.
   const gfx::Size& size() { return size_; }
 
   // Compositor does not own observers. It is the responsibility of the
@@ -142,33 +230,100 @@ class COMPOSITOR_EXPORT Compositor : public base::RefCounted<Compositor> {
   Compositor(CompositorDelegate* delegate, const gfx::Size& size);
   virtual ~Compositor();
 
-  // Notifies the compositor that compositing is about to start.
-  virtual void OnNotifyStart(bool clear) = 0;
+  // Notifies the compositor that compositing is about to start. Only what is
+  // within |damage_rect| needs to be drawn; the rest of the frame is that
+  // of the last Draw(). |clear| is true if the whole frame is redrawn.
+  virtual void OnNotifyStart(bool clear, const gfx::Rect& damage_rect) = 0;
 
   // Notifies the compositor that compositing is complete.
   virtual void OnNotifyEnd() = 0;
 
+  // Called with the drawing lock held, on the compositor thread if there is
+  // one.
   virtual void OnWidgetSizeChanged() = 0;
 
   CompositorDelegate* delegate() { return delegate_; }
 
  private:
+  friend class base::RefCountedThreadSafe<Compositor>;
+
+  // A tree committed by Draw(), and the damage of the widget since the last
+  // commit.
+  struct PendingCommit {
+    CommittedLayerTree* tree;
+    gfx::Rect damage_rect;
+  };
+
+  // Draws the trees committed since the last time, on the compositor thread.
+  void DrawPendingCommits();
+
+  // Draws a frame of the animations of the committed tree, on the compositor
+  // thread.
+  void DrawAnimationFrame();
+
+  // Without a compositor thread, schedules the paint that draws the next
+  // frame of the animations of the committed tree.
+  void ScheduleAnimationPaint();
+
+  // Drops the committed tree, on the compositor thread.
+  void ReleaseCommittedTree();
+
+  // Gives the textures of |tree| its pixels, and makes it the committed tree.
+  // Takes ownership of |tree|.
+  void ApplyCommit(CommittedLayerTree* tree, const gfx::Rect& damage_rect);
+
+  // Draws the damaged area of the committed tree, after moving its animations
+  // to the current time, and schedules the next frame of those still running.
+  void DrawFrame();
+
   // Notifies the compositor that compositing is about to start. See Draw() for
   // notes about |force_clear|.
-  void NotifyStart(bool force_clear);
+  void NotifyStart(bool force_clear, const gfx::Rect& damage_rect);
 
   // Notifies the compositor that compositing is complete.
   void NotifyEnd();
 
+  // Notifies the observers, on the UI thread.
+  void NotifyCompositingEnded();
+
   CompositorDelegate* delegate_;
   gfx::Size size_;
 
+  // The area of the widget the next Draw() redraws.
+  gfx::Rect damage_rect_;
+
+  // See paint_scheduled().
+  bool paint_scheduled_;
+
   // The root of the Layer tree drawn by this compositor.
   Layer* root_layer_;
 
   ObserverList<CompositorObserver> observer_list_;
 
-  friend class base::RefCounted<Compositor>;
+  // The thread the compositor was created on.
+  scoped_refptr<base::MessageLoopProxy> ui_loop_;
+
+  // Held while drawing, and while the size changes. Guards the members below
+  // it, and |size_| on the compositor thread.
+  base::Lock draw_lock_;
+
+  // The last tree committed, and the area of the widget the next frame is to
+  // redraw.
+  scoped_ptr<CommittedLayerTree> committed_tree_;
+  gfx::Rect frame_damage_rect_;
+
+  // True if DrawAnimationFrame(), or ScheduleAnimationPaint(), was posted,
+  // and hasn't run yet.
+  bool animation_frame_pending_;
+
+  // The trees committed and not yet drawn by the compositor thread, in order,
+  // guarded by |commit_lock_|.
+  base::Lock commit_lock_;
+  std::vector<PendingCommit> pending_commits_;
+
+  // Used for ScheduleAnimationPaint(), on the UI thread, since the delegate
+  // goes away with the widget.
+  base::WeakPtrFactory<Compositor> weak_factory_;
 };
 
 }  // namespace ui
@@ -5,6 +5,7 @@
 #include "ui/gfx/compositor/compositor.h"
 
 #include <algorithm>
+#include <d3d10_1.h>
 #include <d3dx10.h>
 #include <vector>
 
@@ -12,6 +13,7 @@
 #include "base/logging.h"
 #include "base/stl_util.h"
 #include "base/string_piece.h"
+#include "base/synchronization/lock.h"
 #include "base/win/scoped_comptr.h"
 #include "grit/gfx_resources.h"
 #include "third_party/skia/include/core/SkCanvas.h"
@@ -58,13 +60,32 @@ class ViewTexture : public Texture {
   virtual void Draw(const ui::TextureDrawParams& params,
                     const gfx::Rect& clip_bounds_in_texture) OVERRIDE;
 
+  // Returns the view of the pixels for the shaders, and sets |origin| and
+  // |size| to where they are in it, in texture coordinates. Returns NULL if
+  // the texture has no pixels.
+  ID3D10ShaderResourceView* GetShaderView(D3DXVECTOR2* origin,
+                                          D3DXVECTOR2* size);
+
  private:
   ~ViewTexture();
 
+  // Selects the technique that draws through |params.filter|, and sets its
+  // parameters. Returns NULL on failure.
+  ID3D10EffectTechnique* PrepareFilter(const ui::TextureDrawParams& params);
+
   void Errored(HRESULT result);
 
-  void ConvertBitmapToD3DData(const SkBitmap& bitmap,
-                              scoped_array<uint32>* converted_data);
+  // Makes room for a texture of |view_size_|, in a cell of the atlas if it is
+  // small enough, or else in a texture of its own. Returns false on failure.
+  bool AllocateStorage();
+
+  // Releases the cell in the atlas, or the texture, holding the pixels.
+  void ReleaseStorage();
+
+  // Converts the pixels of |bitmap| in |rect| to ABGR in |converted_data_|.
+  // |rect| may extend one pixel past the edges of the bitmap, which are then
+  // repeated.
+  void ConvertBitmapToD3DData(const SkBitmap& bitmap, const gfx::Rect& rect);
 
   // Creates vertex buffer for specified region
   void CreateVertexBufferForRegion(const gfx::Rect& bounds);
@@ -74,12 +95,23 @@ class ViewTexture : public Texture {
   // Size of the corresponding View.
   gfx::Size view_size_;
 
+  // The size the storage was allocated for.
+  gfx::Size storage_size_;
+
+  // If true the pixels are in the atlas of the compositor, the cell of which
+  // starts at |atlas_origin_|. Otherwise they are in |texture_|.
+  bool in_atlas_;
+  gfx::Point atlas_origin_;
+
   ScopedComPtr<ID3D10Device> device_;
   ScopedComPtr<ID3D10Effect, NULL> effect_;
   ScopedComPtr<ID3D10Texture2D> texture_;
   ScopedComPtr<ID3D10ShaderResourceView> shader_view_;
   ScopedComPtr<ID3D10Buffer> vertex_buffer_;
 
+  // Kept from one upload to the next, to not allocate it every time.
+  std::vector<uint32> converted_data_;
+
   DISALLOW_COPY_AND_ASSIGN(ViewTexture);
 };
 
@@ -100,13 +132,28 @@ class CompositorWin : public Compositor {
   // Returns the index buffer used for drawing a texture.
   ID3D10Buffer* GetTextureIndexBuffer();
 
+  // Small layers share the atlas texture, each in a cell of its own, rather
+  // than having a texture each. Sets |origin| to the top left of a free cell
+  // and returns true, or returns false if there are none left, or the atlas
+  // can't be created.
+  bool AllocateAtlasCell(gfx::Point* origin);
+
+  // Returns the cell at |origin| to those that are free.
+  void FreeAtlasCell(const gfx::Point& origin);
+
+  ID3D10Texture2D* atlas_texture() { return atlas_texture_.get(); }
+  ID3D10ShaderResourceView* atlas_shader_view() {
+    return atlas_shader_view_.get();
+  }
+
   // Compositor:
   virtual Texture* CreateTexture() OVERRIDE;
 
   virtual void Blur(const gfx::Rect& bounds) OVERRIDE;
 
  protected:
-  virtual void OnNotifyStart(bool clear) OVERRIDE;
+  virtual void OnNotifyStart(bool clear,
+                             const gfx::Rect& damage_rect) OVERRIDE;
   virtual void OnNotifyEnd() OVERRIDE;
   virtual void OnWidgetSizeChanged() OVERRIDE;
 
@@ -130,8 +177,10 @@ class CompositorWin : public Compositor {
   // being drawn to along the appropriate axis.
   void UpdateBlurKernel(Direction direction, int size);
 
-  // Creates a texture, render target view and shader.
+  // Creates a texture, render target view and shader. A |gdi_compatible|
+  // texture is BGRA, and GDI can draw from it.
   void CreateTexture(const gfx::Size& size,
+                     bool gdi_compatible,
                      ID3D10Texture2D** texture,
                      ID3D10RenderTargetView** render_target_view,
                      ID3D10ShaderResourceView** shader_resource_view);
@@ -142,12 +191,28 @@ class CompositorWin : public Compositor {
   // Creates |index_buffer_|.
   void CreateIndexBuffer();
 
+  // Creates |scissor_rasterizer_state_|.
+  void CreateRasterizerState();
+
+  // Limits the drawing to |rect|.
+  void SetScissorRect(const gfx::Rect& rect);
+
+  // Updates the damaged area of the layered window from |main_texture_|.
+  void UpdateLayeredWindow();
+
   // Creates a vertex buffer for the specified region. The caller owns the
   // return value.
   ID3D10Buffer* CreateVertexBufferForRegion(const gfx::Rect& bounds);
 
   gfx::AcceleratedWidget host_;
 
+  // True if |host_| is a layered window. There is then no swap chain: the
+  // window is updated with UpdateLayeredWindowIndirect(), from a DC of
+  // |main_texture_|, for the damaged area of each frame only, which is kept
+  // in |layered_damage_rect_|.
+  bool layered_;
+  gfx::Rect layered_damage_rect_;
+
   ScopedComPtr<ID3D10Device> device_;
   ScopedComPtr<IDXGISwapChain> swap_chain_;
   ScopedComPtr<ID3D10RenderTargetView> dest_render_target_view_;
@@ -165,6 +230,10 @@ class CompositorWin : public Compositor {
   // Index buffer used for drawing a rectangle.
   ScopedComPtr<ID3D10Buffer> index_buffer_;
 
+  // Clips the drawing to the scissor rect, which is set to the damaged area
+  // of the frame.
+  ScopedComPtr<ID3D10RasterizerState> scissor_rasterizer_state_;
+
   // Used for bluring.
   ScopedComPtr<ID3D10Effect, NULL> blur_fx_;
   ID3D10EffectTechnique* blur_technique_;
@@ -172,7 +241,8 @@ class CompositorWin : public Compositor {
   // All rendering is done to the main_texture. Effects (such as bloom) render
   // into the blur texture, and are then copied back to the main texture. When
   // rendering is done |main_texture_| is drawn back to
-  // |dest_render_target_view_|.
+  // |dest_render_target_view_|, or, for a layered window, which has no swap
+  // chain, the window is updated from it.
   ScopedComPtr<ID3D10Texture2D> main_texture_;
   ScopedComPtr<ID3D10RenderTargetView> main_render_target_view_;
   ScopedComPtr<ID3D10ShaderResourceView> main_texture_shader_view_;
@@ -181,18 +251,37 @@ class CompositorWin : public Compositor {
   ScopedComPtr<ID3D10RenderTargetView> blur_render_target_view_;
   ScopedComPtr<ID3D10ShaderResourceView> blur_texture_shader_view_;
 
+  // Shared by the textures of small layers. Created with the first cell
+  // allocated, and kept with the device. The textures may be released on the
+  // UI thread while the compositor thread allocates cells, so the free cells
+  // are guarded by |atlas_lock_|.
+  ScopedComPtr<ID3D10Texture2D> atlas_texture_;
+  ScopedComPtr<ID3D10ShaderResourceView> atlas_shader_view_;
+  base::Lock atlas_lock_;
+  std::vector<gfx::Point> free_atlas_cells_;
+
   DISALLOW_COPY_AND_ASSIGN(CompositorWin);
 };
 
+// The atlas is split in square cells of kAtlasCellSize. A layer uses one if
+// it fits with a pixel of border all around, which repeats its edges so that
+// the filtering doesn't pick up the neighbouring cells.
+const int kAtlasSize = 1024;
+const int kAtlasCellSize = 128;
+const int kAtlasCellBorder = 1;
+const int kMaxAtlasLayerSize = kAtlasCellSize - 2 * kAtlasCellBorder;
+
 ViewTexture::ViewTexture(CompositorWin* compositor,
                          ID3D10Device* device,
                          ID3D10Effect* effect)
     : compositor_(compositor),
+      in_atlas_(false),
       device_(device),
       effect_(effect) {
 }
 
 ViewTexture::~ViewTexture() {
+  ReleaseStorage();
 }
 
 void ViewTexture::SetCanvas(const SkCanvas& canvas,
@@ -200,44 +289,48 @@ void ViewTexture::SetCanvas(const SkCanvas& canvas,
                             const gfx::Size& overall_size) {
   view_size_ = overall_size;
 
-  scoped_array<uint32> converted_data;
+  // The storage is kept as long as the size of the layer doesn't change, so
+  // that repainting it, in full or in part, only uploads the pixels painted.
   const SkBitmap& bitmap = canvas.getDevice()->accessBitmap(false);
-  ConvertBitmapToD3DData(bitmap, &converted_data);
-  if (gfx::Size(bitmap.width(), bitmap.height()) == overall_size) {
-    shader_view_.Release();
-    texture_.Release();
+  if (overall_size.IsEmpty() || bitmap.empty()) {
+    if (overall_size.IsEmpty())
+      ReleaseStorage();
+    return;
+  }
+  if (storage_size_ != overall_size || (!in_atlas_ && !texture_.get())) {
+    // Parts of new storage would be left undefined.
+    DCHECK(origin.x() == 0 && origin.y() == 0 &&
+           gfx::Size(bitmap.width(), bitmap.height()) == overall_size);
+    ReleaseStorage();
+    if (!AllocateStorage())
+      return;
+  }
 
-    D3D10_TEXTURE2D_DESC texture_desc;
-    texture_desc.Width = bitmap.width();
-    texture_desc.Height = bitmap.height();
-    texture_desc.MipLevels = 1;
-    texture_desc.ArraySize = 1;
-    texture_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    texture_desc.SampleDesc.Count = 1;
-    texture_desc.SampleDesc.Quality = 0;
-    texture_desc.Usage = D3D10_USAGE_DEFAULT;
-    texture_desc.BindFlags = D3D10_BIND_SHADER_RESOURCE;
-    texture_desc.CPUAccessFlags = 0;
-    texture_desc.MiscFlags = 0;
-    D3D10_SUBRESOURCE_DATA texture_data;
-    texture_data.pSysMem = converted_data.get();
-    texture_data.SysMemPitch = texture_desc.Width * 4;
-    texture_data.SysMemSlicePitch = 0;
-    RETURN_IF_FAILED(device_->CreateTexture2D(&texture_desc,
-                                              &texture_data,
-                                              texture_.Receive()));
-    RETURN_IF_FAILED(
-        device_->CreateShaderResourceView(texture_.get(), NULL,
-                                          shader_view_.Receive()));
-  } else {
-    // Only part of the texture was updated.
-    DCHECK(texture_.get());
-    D3D10_BOX dst_box = { origin.x(), origin.y(), 0,
-                          origin.x() + bitmap.width(),
-                          origin.y() + bitmap.height(), 1 };
-    device_->UpdateSubresource(texture_.get(), 0, &dst_box,
-                               converted_data.get(), bitmap.width() * 4, 0);
+  gfx::Rect rect(0, 0, bitmap.width(), bitmap.height());
+  gfx::Point dest_origin = origin;
+  ID3D10Texture2D* dest = texture_.get();
+  if (in_atlas_) {
+    // The border of the cell repeats the edges of the layer, wherever the
+    // update reaches them.
+    int left = origin.x() == 0 ? kAtlasCellBorder : 0;
+    int top = origin.y() == 0 ? kAtlasCellBorder : 0;
+    int right = origin.x() + bitmap.width() == view_size_.width() ?
+        kAtlasCellBorder : 0;
+    int bottom = origin.y() + bitmap.height() == view_size_.height() ?
+        kAtlasCellBorder : 0;
+    rect.SetRect(-left, -top, bitmap.width() + left + right,
+                 bitmap.height() + top + bottom);
+    dest_origin.SetPoint(
+        atlas_origin_.x() + kAtlasCellBorder + origin.x() - left,
+        atlas_origin_.y() + kAtlasCellBorder + origin.y() - top);
+    dest = compositor_->atlas_texture();
   }
+  ConvertBitmapToD3DData(bitmap, rect);
+  D3D10_BOX dst_box = { dest_origin.x(), dest_origin.y(), 0,
+                        dest_origin.x() + rect.width(),
+                        dest_origin.y() + rect.height(), 1 };
+  device_->UpdateSubresource(dest, 0, &dst_box, &converted_data_[0],
+                             rect.width() * 4, 0);
 }
 
 void ViewTexture::Draw(const ui::TextureDrawParams& params,
@@ -247,13 +340,15 @@ void ViewTexture::Draw(const ui::TextureDrawParams& params,
   // Make texture active.
   RETURN_IF_FAILED(
       effect_->GetVariableByName("textureMap")->AsShaderResource()->
-      SetResource(shader_view_.get()));
+      SetResource(in_atlas_ ? compositor_->atlas_shader_view() :
+                              shader_view_.get()));
 
   RETURN_IF_FAILED(effect_->GetVariableByName("alpha")->AsScalar()->SetFloat(
                    params.opacity));
 
-  ID3D10EffectTechnique* technique = effect_->GetTechniqueByName("ViewTech");
-  DCHECK(technique);
+  ID3D10EffectTechnique* technique = PrepareFilter(params);
+  if (!technique)
+    return;
   D3D10_TECHNIQUE_DESC tech_desc;
   technique->GetDesc(&tech_desc);
   for(UINT p = 0; p < tech_desc.Passes; ++p)
@@ -269,24 +364,162 @@ void ViewTexture::Draw(const ui::TextureDrawParams& params,
   device_->DrawIndexed(6, 0, 0);
 }
 
+ID3D10ShaderResourceView* ViewTexture::GetShaderView(D3DXVECTOR2* origin,
+                                                     D3DXVECTOR2* size) {
+  if (in_atlas_) {
+    const float atlas_size = static_cast<float>(kAtlasSize);
+    *origin = D3DXVECTOR2((atlas_origin_.x() + kAtlasCellBorder) / atlas_size,
+                          (atlas_origin_.y() + kAtlasCellBorder) / atlas_size);
+    *size = D3DXVECTOR2(storage_size_.width() / atlas_size,
+                        storage_size_.height() / atlas_size);
+    return compositor_->atlas_shader_view();
+  }
+  *origin = D3DXVECTOR2(0.0f, 0.0f);
+  *size = D3DXVECTOR2(1.0f, 1.0f);
+  return shader_view_.get();
+}
+
+ID3D10EffectTechnique* ViewTexture::PrepareFilter(
+    const ui::TextureDrawParams& params) {
+  const TextureFilter& filter = params.filter;
+  TextureFilter::Type type = filter.type;
+  // The filter textures are made by CreateTexture(), so are ViewTextures.
+  ViewTexture* filter_texture =
+      static_cast<ViewTexture*>(params.filter_texture);
+  D3DXVECTOR2 filter_origin, filter_size;
+  ID3D10ShaderResourceView* filter_view = NULL;
+  if (filter.UsesFilterTexture() && filter_texture)
+    filter_view = filter_texture->GetShaderView(&filter_origin, &filter_size);
+  if (filter.UsesFilterTexture() &&
+      (!filter_view || params.filter_texture_bounds.IsEmpty()))
+    type = TextureFilter::FILTER_NONE;
+
+  const char* technique_name = "ViewTech";
+  switch (type) {
+    case TextureFilter::FILTER_NONE:
+      break;
+    case TextureFilter::FILTER_GRAYSCALE:
+      technique_name = "GrayscaleTech";
+      break;
+    case TextureFilter::FILTER_HSL_SHIFT:
+      technique_name = "HSLShiftTech";
+      break;
+    case TextureFilter::FILTER_MASK:
+      technique_name = "MaskTech";
+      break;
+    case TextureFilter::FILTER_BLEND:
+      technique_name = "BlendTech";
+      break;
+  }
+
+  if (type == TextureFilter::FILTER_GRAYSCALE ||
+      type == TextureFilter::FILTER_BLEND) {
+    if (effect_->GetVariableByName("filterAmount")->AsScalar()->SetFloat(
+            filter.amount) != S_OK)
+      return NULL;
+  }
+  if (type == TextureFilter::FILTER_HSL_SHIFT) {
+    float hsl_shift[] = {
+      static_cast<float>(filter.hsl_shift.h),
+      static_cast<float>(filter.hsl_shift.s),
+      static_cast<float>(filter.hsl_shift.l),
+    };
+    if (effect_->GetVariableByName("hslShift")->AsVector()->SetFloatVector(
+            hsl_shift) != S_OK)
+      return NULL;
+  }
+  if (type == TextureFilter::FILTER_MASK ||
+      type == TextureFilter::FILTER_BLEND) {
+    // Maps the pixels of the layer over |filter_texture_bounds| onto the
+    // pixels of the filter texture.
+    const gfx::Rect& bounds = params.filter_texture_bounds;
+    float scale[] = {
+      filter_size.x / bounds.width(),
+      filter_size.y / bounds.height(),
+    };
+    float offset[] = {
+      filter_origin.x - bounds.x() * scale[0],
+      filter_origin.y - bounds.y() * scale[1],
+    };
+    if (effect_->GetVariableByName("filterMap")->AsShaderResource()->
+            SetResource(filter_view) != S_OK ||
+        effect_->GetVariableByName("filterScale")->AsVector()->
+            SetFloatVector(scale) != S_OK ||
+        effect_->GetVariableByName("filterOffset")->AsVector()->
+            SetFloatVector(offset) != S_OK)
+      return NULL;
+  }
+
+  ID3D10EffectTechnique* technique =
+      effect_->GetTechniqueByName(technique_name);
+  DCHECK(technique);
+  return technique;
+}
+
 void ViewTexture::Errored(HRESULT result) {
   // TODO: figure out error handling.
   DCHECK(false);
 }
 
-void ViewTexture::ConvertBitmapToD3DData(
-    const SkBitmap& bitmap,
-    scoped_array<uint32>* converted_data) {
-  int width = bitmap.width();
-  int height = bitmap.height();
+bool ViewTexture::AllocateStorage() {
+  storage_size_ = view_size_;
+  if (view_size_.width() <= kMaxAtlasLayerSize &&
+      view_size_.height() <= kMaxAtlasLayerSize &&
+      compositor_->AllocateAtlasCell(&atlas_origin_)) {
+    in_atlas_ = true;
+    return true;
+  }
+
+  D3D10_TEXTURE2D_DESC texture_desc;
+  texture_desc.Width = view_size_.width();
+  texture_desc.Height = view_size_.height();
+  texture_desc.MipLevels = 1;
+  texture_desc.ArraySize = 1;
+  texture_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+  texture_desc.SampleDesc.Count = 1;
+  texture_desc.SampleDesc.Quality = 0;
+  texture_desc.Usage = D3D10_USAGE_DEFAULT;
+  texture_desc.BindFlags = D3D10_BIND_SHADER_RESOURCE;
+  texture_desc.CPUAccessFlags = 0;
+  texture_desc.MiscFlags = 0;
+  HRESULT result = device_->CreateTexture2D(&texture_desc, NULL,
+                                            texture_.Receive());
+  if (result == S_OK) {
+    result = device_->CreateShaderResourceView(texture_.get(), NULL,
+                                               shader_view_.Receive());
+  }
+  if (result != S_OK) {
+    ReleaseStorage();
+    Errored(result);
+    return false;
+  }
+  return true;
+}
+
+void ViewTexture::ReleaseStorage() {
+  if (in_atlas_)
+    compositor_->FreeAtlasCell(atlas_origin_);
+  in_atlas_ = false;
+  shader_view_.Release();
+  texture_.Release();
+  storage_size_ = gfx::Size();
+}
+
+void ViewTexture::ConvertBitmapToD3DData(const SkBitmap& bitmap,
+                                         const gfx::Rect& rect) {
+  DCHECK(rect.x() >= -1 && rect.y() >= -1 &&
+         rect.right() <= bitmap.width() + 1 &&
+         rect.bottom() <= bitmap.height() + 1);
   SkAutoLockPixels pixel_lock(bitmap);
   // D3D wants colors in ABGR format (premultiplied).
-  converted_data->reset(new uint32[width * height]);
-  uint32_t* bitmap_data = bitmap.getAddr32(0, 0);
-  for (int x = 0, offset = 0; x < width; ++x) {
-    for (int y = 0; y < height; ++y, ++offset) {
-      SkColor color = bitmap_data[offset];
-      (*converted_data)[offset] =
+  converted_data_.resize(rect.width() * rect.height());
+  uint32* converted = &converted_data_[0];
+  for (int y = rect.y(); y < rect.bottom(); ++y) {
+    const uint32_t* row = bitmap.getAddr32(
+        0, std::max(0, std::min(y, bitmap.height() - 1)));
+    for (int x = rect.x(); x < rect.right(); ++x, ++converted) {
+      SkColor color = row[std::max(0, std::min(x, bitmap.width() - 1))];
+      *converted =
           (SkColorGetA(color) << 24) |
           (SkColorGetB(color) << 16) |
           (SkColorGetG(color) << 8) |
@@ -301,10 +534,22 @@ void ViewTexture::CreateVertexBufferForRegion(const gfx::Rect& bounds) {
   float max_x = bounds.right();
   float y = bounds.y();
   float max_y = bounds.bottom();
-  float tex_x = x / static_cast<float>(view_size_.width());
-  float max_tex_x = max_x / static_cast<float>(view_size_.width());
-  float tex_y = y / static_cast<float>(view_size_.width());
-  float max_tex_y = max_y / static_cast<float>(view_size_.height());
+  // The texture coordinates of the region, in the cell of the atlas or in the
+  // texture of the layer.
+  float tex_x, max_tex_x, tex_y, max_tex_y;
+  if (in_atlas_) {
+    float cell_x = atlas_origin_.x() + kAtlasCellBorder;
+    float cell_y = atlas_origin_.y() + kAtlasCellBorder;
+    tex_x = (cell_x + x) / kAtlasSize;
+    max_tex_x = (cell_x + max_x) / kAtlasSize;
+    tex_y = (cell_y + y) / kAtlasSize;
+    max_tex_y = (cell_y + max_y) / kAtlasSize;
+  } else {
+    tex_x = x / static_cast<float>(view_size_.width());
+    max_tex_x = max_x / static_cast<float>(view_size_.width());
+    tex_y = y / static_cast<float>(view_size_.height());
+    max_tex_y = max_y / static_cast<float>(view_size_.height());
+  }
   Vertex vertices[] = {
     { D3DXVECTOR3(    x, -max_y, 0.0f), D3DXVECTOR2(    tex_x, max_tex_y) },
     { D3DXVECTOR3(    x,     -y, 0.0f), D3DXVECTOR2(    tex_x,     tex_y) },
@@ -330,6 +575,7 @@ CompositorWin::CompositorWin(CompositorDelegate* delegate,
                              const gfx::Size& size)
     : Compositor(delegate, size),
       host_(widget),
+      layered_(!!(GetWindowLong(widget, GWL_EXSTYLE) & WS_EX_LAYERED)),
       technique_(NULL) {
 }
 
@@ -340,6 +586,7 @@ void CompositorWin::Init() {
   InitVertexLayout();
   CreateVertexBuffer();
   CreateIndexBuffer();
+  CreateRasterizerState();
 }
 
 void CompositorWin::UpdatePerspective(const ui::Transform& transform,
@@ -387,18 +634,68 @@ ID3D10Buffer* CompositorWin::GetTextureIndexBuffer() {
   return index_buffer_.get();
 }
 
+bool CompositorWin::AllocateAtlasCell(gfx::Point* origin) {
+  base::AutoLock lock(atlas_lock_);
+  if (!atlas_texture_.get()) {
+    D3D10_TEXTURE2D_DESC texture_desc;
+    texture_desc.Width = kAtlasSize;
+    texture_desc.Height = kAtlasSize;
+    texture_desc.MipLevels = 1;
+    texture_desc.ArraySize = 1;
+    texture_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    texture_desc.SampleDesc.Count = 1;
+    texture_desc.SampleDesc.Quality = 0;
+    texture_desc.Usage = D3D10_USAGE_DEFAULT;
+    texture_desc.BindFlags = D3D10_BIND_SHADER_RESOURCE;
+    texture_desc.CPUAccessFlags = 0;
+    texture_desc.MiscFlags = 0;
+    if (device_->CreateTexture2D(&texture_desc, NULL,
+                                 atlas_texture_.Receive()) != S_OK ||
+        device_->CreateShaderResourceView(atlas_texture_.get(), NULL,
+                                          atlas_shader_view_.Receive()) !=
+            S_OK) {
+      // The layers get textures of their own instead.
+      atlas_texture_.Release();
+      atlas_shader_view_.Release();
+      return false;
+    }
+    // Handing the cells out from the back gives the top left one first.
+    for (int y = kAtlasSize - kAtlasCellSize; y >= 0; y -= kAtlasCellSize) {
+      for (int x = kAtlasSize - kAtlasCellSize; x >= 0; x -= kAtlasCellSize)
+        free_atlas_cells_.push_back(gfx::Point(x, y));
+    }
+  }
+  if (free_atlas_cells_.empty())
+    return false;
+  *origin = free_atlas_cells_.back();
+  free_atlas_cells_.pop_back();
+  return true;
+}
+
+void CompositorWin::FreeAtlasCell(const gfx::Point& origin) {
+  base::AutoLock lock(atlas_lock_);
+  DCHECK(std::find(free_atlas_cells_.begin(), free_atlas_cells_.end(),
+                   origin) == free_atlas_cells_.end());
+  free_atlas_cells_.push_back(origin);
+}
+
 Texture* CompositorWin::CreateTexture() {
   return new ViewTexture(this, device_.get(), fx_.get());
 }
 
-void CompositorWin::OnNotifyStart(bool clear) {
+void CompositorWin::OnNotifyStart(bool clear, const gfx::Rect& damage_rect) {
   ID3D10RenderTargetView* target_view = main_render_target_view_.get();
   device_->OMSetRenderTargets(1, &target_view, depth_stencil_view_.get());
 
-  // Clear the background and stencil view.
-  // TODO(vollick) see if |clear| can be used to avoid unnecessary clearing.
-  device_->ClearRenderTargetView(target_view,
-                                 D3DXCOLOR(0.0f, 0.0f, 0.0f, 0.0f));
+  // |main_texture_| keeps the last frame, so only the damaged area is drawn
+  // again. The root layer clobbers the pixels under it, which is all of them
+  // unless a clear was asked for.
+  SetScissorRect(damage_rect);
+  layered_damage_rect_ = damage_rect;
+  if (clear) {
+    device_->ClearRenderTargetView(target_view,
+                                   D3DXCOLOR(0.0f, 0.0f, 0.0f, 0.0f));
+  }
   device_->ClearDepthStencilView(
       depth_stencil_view_.get(), D3D10_CLEAR_DEPTH|D3D10_CLEAR_STENCIL,
       1.0f, 0);
@@ -412,8 +709,16 @@ void CompositorWin::OnNotifyStart(bool clear) {
 }
 
 void CompositorWin::OnNotifyEnd() {
+  if (layered_) {
+    UpdateLayeredWindow();
+    return;
+  }
+
   // Copy from main_render_target_view_| (where all are rendering was done) back
   // to |dest_render_target_view_|.
+  // The swap chain discards its buffer when presenting, so all of it is
+  // copied.
+  SetScissorRect(gfx::Rect(size()));
   ID3D10RenderTargetView* target_view = dest_render_target_view_.get();
   device_->OMSetRenderTargets(1, &target_view, NULL);
   device_->ClearRenderTargetView(target_view,
@@ -505,6 +810,57 @@ void CompositorWin::Blur(const gfx::Rect& bounds) {
 #endif
 }
 
+void CompositorWin::CreateRasterizerState() {
+  D3D10_RASTERIZER_DESC rasterizer_desc;
+  rasterizer_desc.FillMode = D3D10_FILL_SOLID;
+  rasterizer_desc.CullMode = D3D10_CULL_BACK;
+  rasterizer_desc.FrontCounterClockwise = FALSE;
+  rasterizer_desc.DepthBias = 0;
+  rasterizer_desc.DepthBiasClamp = 0.0f;
+  rasterizer_desc.SlopeScaledDepthBias = 0.0f;
+  rasterizer_desc.DepthClipEnable = TRUE;
+  rasterizer_desc.ScissorEnable = TRUE;
+  rasterizer_desc.MultisampleEnable = FALSE;
+  rasterizer_desc.AntialiasedLineEnable = FALSE;
+  RETURN_IF_FAILED(device_->CreateRasterizerState(
+                       &rasterizer_desc, scissor_rasterizer_state_.Receive()));
+  device_->RSSetState(scissor_rasterizer_state_.get());
+}
+
+void CompositorWin::SetScissorRect(const gfx::Rect& rect) {
+  D3D10_RECT scissor_rect = rect.ToRECT();
+  device_->RSSetScissorRects(1, &scissor_rect);
+}
+
+void CompositorWin::UpdateLayeredWindow() {
+  // GDI reads the texture, which mustn't be bound while it has the DC.
+  device_->OMSetRenderTargets(0, NULL, NULL);
+  ScopedComPtr<IDXGISurface1> surface;
+  RETURN_IF_FAILED(surface.QueryFrom(main_texture_.get()));
+  HDC dc = NULL;
+  RETURN_IF_FAILED(surface->GetDC(FALSE, &dc));
+
+  // The rest of the window keeps the pixels of the last update. The opacity
+  // of the window is that of the root layer.
+  SIZE window_size = { size().width(), size().height() };
+  POINT origin = { 0, 0 };
+  RECT dirty_rect = layered_damage_rect_.ToRECT();
+  BLENDFUNCTION blend = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+  UPDATELAYEREDWINDOWINFO info = { sizeof(info) };
+  info.psize = &window_size;
+  info.hdcSrc = dc;
+  info.pptSrc = &origin;
+  info.pblend = &blend;
+  info.dwFlags = ULW_ALPHA;
+  info.prcDirty = &dirty_rect;
+  if (!UpdateLayeredWindowIndirect(host_, &info))
+    VLOG(1) << "UpdateLayeredWindowIndirect failed " << GetLastError();
+
+  // GDI didn't draw into the texture.
+  RECT unchanged_rect = { 0, 0, 0, 0 };
+  surface->ReleaseDC(&unchanged_rect);
+}
+
 void CompositorWin::OnWidgetSizeChanged() {
   dest_render_target_view_ = NULL;
   depth_stencil_buffer_ = NULL;
@@ -518,24 +874,26 @@ void CompositorWin::OnWidgetSizeChanged() {
   blur_texture_ = NULL;
   blur_texture_shader_view_ = NULL;
 
-  CreateTexture(size(), main_texture_.Receive(),
+  CreateTexture(size(), layered_, main_texture_.Receive(),
                 main_render_target_view_.Receive(),
                 main_texture_shader_view_.Receive());
 
-  CreateTexture(size(), blur_texture_.Receive(),
+  CreateTexture(size(), false, blur_texture_.Receive(),
                 blur_render_target_view_.Receive(),
                 blur_texture_shader_view_.Receive());
 
-  // Resize the swap chain and recreate the render target view.
-  RETURN_IF_FAILED(swap_chain_->ResizeBuffers(
-      1, size().width(), size().height(), DXGI_FORMAT_R8G8B8A8_UNORM, 0));
-  ScopedComPtr<ID3D10Texture2D> back_buffer;
-  RETURN_IF_FAILED(swap_chain_->GetBuffer(
-                       0, __uuidof(ID3D10Texture2D),
-                       reinterpret_cast<void**>(back_buffer.Receive())));
-  RETURN_IF_FAILED(device_->CreateRenderTargetView(
-                       back_buffer.get(), 0,
-                       dest_render_target_view_.Receive()));
+  if (!layered_) {
+    // Resize the swap chain and recreate the render target view.
+    RETURN_IF_FAILED(swap_chain_->ResizeBuffers(
+        1, size().width(), size().height(), DXGI_FORMAT_R8G8B8A8_UNORM, 0));
+    ScopedComPtr<ID3D10Texture2D> back_buffer;
+    RETURN_IF_FAILED(swap_chain_->GetBuffer(
+                         0, __uuidof(ID3D10Texture2D),
+                         reinterpret_cast<void**>(back_buffer.Receive())));
+    RETURN_IF_FAILED(device_->CreateRenderTargetView(
+                         back_buffer.get(), 0,
+                         dest_render_target_view_.Receive()));
+  }
 
   // Create the depth/stencil buffer and view.
   D3D10_TEXTURE2D_DESC depth_stencil_desc;
@@ -579,6 +937,30 @@ void CompositorWin::Errored(HRESULT error_code) {
 }
 
 void CompositorWin::CreateDevice() {
+  // Create the device. It is used on the compositor thread when compositing
+  // is threaded, and the textures may be released on the UI thread, so it
+  // mustn't be D3D10_CREATE_DEVICE_SINGLETHREADED.
+  UINT createDeviceFlags = 0;
+#if !defined(NDEBUG)
+  createDeviceFlags |= D3D10_CREATE_DEVICE_DEBUG;
+#endif
+
+  if (layered_) {
+    // The GDI compatible textures are BGRA, which takes a 10.1 device.
+    ScopedComPtr<ID3D10Device1> device;
+    RETURN_IF_FAILED(
+        D3D10CreateDevice1(
+            0,  //default adapter
+            D3D10_DRIVER_TYPE_HARDWARE,
+            0,  // no software device
+            createDeviceFlags | D3D10_CREATE_DEVICE_BGRA_SUPPORT,
+            D3D10_FEATURE_LEVEL_10_0,
+            D3D10_1_SDK_VERSION,
+            device.Receive()));
+    device_ = device.get();
+    return;
+  }
+
   DXGI_SWAP_CHAIN_DESC sd;
   sd.BufferDesc.Width = size().width();
   sd.BufferDesc.Height = size().height();
@@ -599,11 +981,6 @@ void CompositorWin::CreateDevice() {
   sd.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
   sd.Flags = 0;
 
-  // Create the device.
-  UINT createDeviceFlags = 0;
-#if !defined(NDEBUG)
-  createDeviceFlags |= D3D10_CREATE_DEVICE_DEBUG;
-#endif
   RETURN_IF_FAILED(
       D3D10CreateDeviceAndSwapChain(
           0,  //default adapter
@@ -679,6 +1056,7 @@ void CompositorWin::UpdateBlurKernel(Direction direction, int size) {
 
 void CompositorWin::CreateTexture(
     const gfx::Size& size,
+    bool gdi_compatible,
     ID3D10Texture2D** texture,
     ID3D10RenderTargetView** render_target_view,
     ID3D10ShaderResourceView** shader_resource_view) {
@@ -686,14 +1064,16 @@ void CompositorWin::CreateTexture(
   texture_desc.Width = size.width();
   texture_desc.Height = size.height();
   texture_desc.MipLevels = 1;
-  texture_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+  texture_desc.Format = gdi_compatible ?
+      DXGI_FORMAT_B8G8R8A8_UNORM : DXGI_FORMAT_R8G8B8A8_UNORM;
   texture_desc.SampleDesc.Count = 1;
   texture_desc.SampleDesc.Quality = 0;
   texture_desc.Usage = D3D10_USAGE_DEFAULT;
   texture_desc.BindFlags =
       D3D10_BIND_RENDER_TARGET | D3D10_BIND_SHADER_RESOURCE;
   texture_desc.CPUAccessFlags = 0;
-  texture_desc.MiscFlags = 0;
+  texture_desc.MiscFlags =
+      gdi_compatible ? D3D10_RESOURCE_MISC_GDI_COMPATIBLE : 0;
   texture_desc.ArraySize = 1;
   RETURN_IF_FAILED(device_->CreateTexture2D(&texture_desc, NULL, texture));
 
@@ -5,12 +5,58 @@
 #include "ui/gfx/compositor/layer.h"
 
 #include <algorithm>
+#include <utility>
 
+#include "base/bind.h"
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/threading/parallel_chunks.h"
 #include "ui/gfx/canvas_skia.h"
+#include "ui/gfx/compositor/tiled_texture.h"
 #include "ui/gfx/point3.h"
 
+namespace {
+
+// The most tiles out of view of the compositor that a tiled layer paints at
+// each commit, besides those in view.
+const size_t kMaxOffscreenTilesPerCommit = 4;
+
+// A tile out of view, and how far it is from the view.
+typedef std::pair<int, gfx::Rect> OffscreenTile;
+
+bool IsNearer(const OffscreenTile& a, const OffscreenTile& b) {
+  return a.first < b.first;
+}
+
+// Has |delegate| paint |draw_rect| of its layer, and copies the pixels into
+// |bitmap|, since the compositor may upload them on its thread, after the
+// canvas is gone.
+void PaintDelegate(ui::LayerDelegate* delegate,
+                   const gfx::Rect& draw_rect,
+                   SkBitmap* bitmap) {
+  scoped_ptr<gfx::Canvas> canvas(gfx::Canvas::CreateCanvas(
+      draw_rect.width(), draw_rect.height(), false));
+  canvas->TranslateInt(-draw_rect.x(), -draw_rect.y());
+  delegate->OnPaintLayer(canvas.get());
+  canvas->AsCanvasSkia()->getDevice()->accessBitmap(false).copyTo(
+      bitmap, SkBitmap::kARGB_8888_Config);
+}
+
+// A layer whose invalid rect may be painted on any thread, and its pixels.
+struct LayerPaintJob {
+  ui::LayerDelegate* delegate;
+  gfx::Rect draw_rect;
+  SkBitmap bitmap;
+};
+
+// Paints job |index| of |jobs|.
+void PaintJob(std::vector<LayerPaintJob>* jobs, int index) {
+  LayerPaintJob& job = (*jobs)[index];
+  PaintDelegate(job.delegate, job.draw_rect, &job.bitmap);
+}
+
+}  // namespace
+
 namespace ui {
 
 Layer::Layer(Compositor* compositor)
@@ -19,35 +65,51 @@ Layer::Layer(Compositor* compositor)
       parent_(NULL),
       visible_(true),
       fills_bounds_opaquely_(false),
+      masks_to_bounds_(false),
+      transform_to_root_valid_(false),
+      tiled_(false),
       layer_updated_externally_(false),
       opacity_(1.0f),
+      frame_count_(0),
       delegate_(NULL) {
 }
 
 Layer::Layer(Compositor* compositor, TextureParam texture_param)
     : compositor_(compositor),
-      texture_(texture_param == LAYER_HAS_TEXTURE ?
-          compositor->CreateTexture() : NULL),
       parent_(NULL),
       visible_(true),
       fills_bounds_opaquely_(false),
+      masks_to_bounds_(false),
+      transform_to_root_valid_(false),
+      tiled_(texture_param == LAYER_HAS_TILED_TEXTURE),
       layer_updated_externally_(false),
       opacity_(1.0f),
+      frame_count_(0),
       delegate_(NULL) {
+  if (texture_param == LAYER_HAS_TEXTURE)
+    texture_ = compositor->CreateTexture();
+  else if (texture_param == LAYER_HAS_TILED_TEXTURE)
+    texture_ = new TiledTexture(compositor);
 }
 
 Layer::~Layer() {
+  if (compositor_->root_layer() == this)
+    compositor_->set_root_layer(NULL);
   if (parent_)
     parent_->Remove(this);
-  for (size_t i = 0; i < children_.size(); ++i)
+  for (size_t i = 0; i < children_.size(); ++i) {
     children_[i]->parent_ = NULL;
+    children_[i]->InvalidateTransformToRoot();
+  }
 }
 
 void Layer::Add(Layer* child) {
   if (child->parent_)
     child->parent_->Remove(child);
   child->parent_ = this;
+  child->InvalidateTransformToRoot();
   children_.push_back(child);
+  child->DamageTree();
 
   if (child->fills_bounds_opaquely())
     RecomputeHole();
@@ -57,8 +119,10 @@ void Layer::Remove(Layer* child) {
   std::vector<Layer*>::iterator i =
       std::find(children_.begin(), children_.end(), child);
   DCHECK(i != children_.end());
+  child->DamageTree();
   children_.erase(i);
   child->parent_ = NULL;
+  child->InvalidateTransformToRoot();
 
   if (child->fills_bounds_opaquely())
     RecomputeHole();
@@ -73,14 +137,39 @@ bool Layer::Contains(const Layer* other) const {
 }
 
 void Layer::SetTransform(const ui::Transform& transform) {
-  transform_ = transform;
+  // The compositor draws the animated transform.
+  if (transform != transform_ &&
+      HasCompositorAnimation(CompositorAnimation::TRANSFORM)) {
+    transform_ = transform;
+    InvalidateTransformToRoot();
+  } else if (transform != transform_) {
+    DamageTree();
+    transform_ = transform;
+    InvalidateTransformToRoot();
+    DamageTree();
+  }
 
   if (parent() && fills_bounds_opaquely_)
     parent()->RecomputeHole();
 }
 
 void Layer::SetBounds(const gfx::Rect& bounds) {
-  bounds_ = bounds;
+  // The compositor draws the animated location.
+  if (bounds.origin() != bounds_.origin())
+    InvalidateTransformToRoot();
+  if (tiled_ && bounds.size() != bounds_.size()) {
+    // The texture drops its tiles when the size changes.
+    dirty_tiles_.assign(
+        TiledTexture::GetTileGridSize(bounds.size()).GetArea(), true);
+  }
+  if (bounds != bounds_ && bounds.size() == bounds_.size() &&
+      HasCompositorAnimation(CompositorAnimation::LOCATION)) {
+    bounds_ = bounds;
+  } else if (bounds != bounds_) {
+    DamageTree();
+    bounds_ = bounds;
+    DamageTree();
+  }
 
   if (parent() && fills_bounds_opaquely_)
     parent()->RecomputeHole();
@@ -90,6 +179,19 @@ void Layer::SetBounds(const gfx::Rect& bounds) {
 void Layer::ConvertPointToLayer(const Layer* source,
                                 const Layer* target,
                                 gfx::Point* point) {
+  DCHECK(source->Contains(target) || target->Contains(source));
+  // Both transforms are cached, so this doesn't walk the tree, unless the
+  // target can't be inverted, which the walk handles by itself.
+  ui::Transform from_root;
+  if (target->GetTransformToRoot().GetInverse(&from_root)) {
+    ui::Transform transform(source->GetTransformToRoot());
+    transform.ConcatTransform(from_root);
+    gfx::Point3f p(*point);
+    transform.TransformPoint(p);
+    *point = p.AsPoint();
+    return;
+  }
+
   const Layer* inner = NULL;
   const Layer* outer = NULL;
   if (source->Contains(target)) {
@@ -105,100 +207,156 @@ void Layer::ConvertPointToLayer(const Layer* source,
   }
 }
 
+void Layer::SetVisible(bool visible) {
+  if (visible_ == visible)
+    return;
+
+  // The layers are damaged while they are visible.
+  if (!visible)
+    DamageTree();
+  visible_ = visible;
+  if (visible)
+    DamageTree();
+}
+
 void Layer::SetFillsBoundsOpaquely(bool fills_bounds_opaquely) {
   if (fills_bounds_opaquely_ == fills_bounds_opaquely)
     return;
 
   fills_bounds_opaquely_ = fills_bounds_opaquely;
+  // Blending depends on it.
+  DamageRect(gfx::Rect(bounds_.size()));
+  compositor_->SchedulePaint();
 
   if (parent())
     parent()->RecomputeHole();
 }
 
+void Layer::SetMasksToBounds(bool masks_to_bounds) {
+  if (masks_to_bounds == masks_to_bounds_)
+    return;
+  // Damaged with the children drawn outside the bounds.
+  if (masks_to_bounds)
+    DamageTree();
+  masks_to_bounds_ = masks_to_bounds;
+  if (!masks_to_bounds)
+    DamageTree();
+}
+
 void Layer::SetExternalTexture(ui::Texture* texture) {
   DCHECK(texture);
   layer_updated_externally_ = true;
   texture_ = texture;
+  DamageRect(gfx::Rect(bounds_.size()));
+  compositor_->SchedulePaint();
 }
 
-void Layer::SetCanvas(const SkCanvas& canvas, const gfx::Point& origin) {
-  texture_->SetCanvas(canvas, origin, bounds_.size());
-  invalid_rect_ = gfx::Rect();
+void Layer::SetFilter(const TextureFilter& filter) {
+  filter_ = filter;
+  DamageRect(gfx::Rect(bounds_.size()));
+  compositor_->SchedulePaint();
 }
 
-void Layer::SchedulePaint(const gfx::Rect& invalid_rect) {
-  invalid_rect_ = invalid_rect_.Union(invalid_rect);
+void Layer::SetFilterBitmap(const SkBitmap& bitmap) {
+  if (!filter_texture_.get())
+    filter_texture_ = compositor_->CreateTexture();
+  CommittedLayerTree::Upload upload;
+  bitmap.copyTo(&upload.bitmap, SkBitmap::kARGB_8888_Config);
+  pending_filter_uploads_.push_back(upload);
+  if (filter_.UsesFilterTexture()) {
+    DamageRect(gfx::Rect(bounds_.size()));
+    compositor_->SchedulePaint();
+  }
+}
+
+void Layer::SetFrames(const SkBitmap& frames,
+                      int frame_count,
+                      base::TimeTicks start_time,
+                      base::TimeDelta frame_time) {
+  DCHECK_GT(frame_count, 0);
+  DCHECK_EQ(0, frames.width() % frame_count);
+  if (!frames_texture_.get())
+    frames_texture_ = compositor_->CreateTexture();
+  CommittedLayerTree::Upload upload;
+  frames.copyTo(&upload.bitmap, SkBitmap::kARGB_8888_Config);
+  pending_frames_uploads_.clear();
+  pending_frames_uploads_.push_back(upload);
+  frame_count_ = frame_count;
+  frame_size_.SetSize(frames.width() / frame_count, frames.height());
+  frames_start_time_ = start_time;
+  frame_time_ = frame_time;
+  DamageRect(gfx::Rect(bounds_.size()));
   compositor_->SchedulePaint();
 }
 
-void Layer::Draw() {
-  const float combined_opacity = GetCombinedOpacity();
-  if (!texture_.get() || combined_opacity == 0.0f)
+void Layer::ClearFrames() {
+  if (!frames_texture_.get())
     return;
+  frames_texture_ = NULL;
+  pending_frames_uploads_.clear();
+  frame_count_ = 0;
+  DamageRect(gfx::Rect(bounds_.size()));
+  compositor_->SchedulePaint();
+}
 
-  UpdateLayerCanvas();
+void Layer::SetCanvas(const SkCanvas& canvas, const gfx::Point& origin) {
+  const SkBitmap& bitmap = canvas.getDevice()->accessBitmap(false);
+  CommittedLayerTree::Upload upload;
+  bitmap.copyTo(&upload.bitmap, SkBitmap::kARGB_8888_Config);
+  upload.origin = origin;
+  pending_uploads_.push_back(upload);
+  invalid_rect_ = gfx::Rect();
+  DamageRect(gfx::Rect(origin, gfx::Size(bitmap.width(), bitmap.height())));
+  compositor_->SchedulePaint();
+}
 
-  ui::TextureDrawParams texture_draw_params;
-  for (Layer* layer = this; layer; layer = layer->parent_) {
-    texture_draw_params.transform.ConcatTransform(layer->transform_);
-    texture_draw_params.transform.ConcatTranslate(
-        static_cast<float>(layer->bounds_.x()),
-        static_cast<float>(layer->bounds_.y()));
-  }
+void Layer::SchedulePaint(const gfx::Rect& invalid_rect) {
+  if (tiled_)
+    InvalidateTiles(invalid_rect);
+  else
+    invalid_rect_ = invalid_rect_.Union(invalid_rect);
+  DamageRect(invalid_rect);
+  compositor_->SchedulePaint();
+}
 
-  // Only blend for transparent child layers (and when we're forcing
-  // transparency). The root layer will clobber the cleared bg.
-  const bool is_root = parent_ == NULL;
-  const bool forcing_transparency = combined_opacity < 1.0f;
-  const bool is_opaque = fills_bounds_opaquely_ || !has_valid_alpha_channel();
-  texture_draw_params.blend = !is_root && (forcing_transparency || !is_opaque);
+void Layer::CommitTree(CommittedLayerTree* tree) {
+  if (!visible_)
+    return;
+  PaintLayersInParallel();
+  CommitNode(tree, -1);
+}
 
-  texture_draw_params.compositor_size = compositor_->size();
-  texture_draw_params.opacity = combined_opacity;
-  texture_draw_params.has_valid_alpha_channel = has_valid_alpha_channel();
+void Layer::SetCompositorAnimation(const CompositorAnimation& animation) {
+  RemoveCompositorAnimation(animation.property);
+  compositor_animations_.push_back(animation);
+  DamageTree();
+}
 
-  hole_rect_ = hole_rect_.Intersect(
-      gfx::Rect(0, 0, bounds_.width(), bounds_.height()));
-  if (hole_rect_.IsEmpty()) {
-    DrawRegion(texture_draw_params,
-               gfx::Rect(0, 0, bounds_.width(), bounds_.height()));
-  } else {
-    // Top (above the hole).
-    DrawRegion(texture_draw_params, gfx::Rect(0,
-                                              0,
-                                              bounds_.width(),
-                                              hole_rect_.y()));
-    // Left (of the hole).
-    DrawRegion(texture_draw_params, gfx::Rect(0,
-                                              hole_rect_.y(),
-                                              hole_rect_.x(),
-                                              hole_rect_.height()));
-    // Right (of the hole).
-    DrawRegion(texture_draw_params, gfx::Rect(
-        hole_rect_.right(),
-        hole_rect_.y(),
-        bounds_.width() - hole_rect_.right(),
-        hole_rect_.height()));
-
-    // Bottom (below the hole).
-    DrawRegion(texture_draw_params, gfx::Rect(
-        0,
-        hole_rect_.bottom(),
-        bounds_.width(),
-        bounds_.height() - hole_rect_.bottom()));
+void Layer::RemoveCompositorAnimation(CompositorAnimation::Property property) {
+  for (size_t i = 0; i < compositor_animations_.size(); ++i) {
+    if (compositor_animations_[i].property == property) {
+      compositor_animations_.erase(compositor_animations_.begin() + i);
+      // Commits the value the UI thread has.
+      DamageTree();
+      return;
+    }
   }
 }
 
-void Layer::DrawTree() {
-  if (!visible_)
-    return;
-
-  Draw();
-  for (size_t i = 0; i < children_.size(); ++i)
-    children_.at(i)->DrawTree();
+bool Layer::HasCompositorAnimation(
+    CompositorAnimation::Property property) const {
+  for (size_t i = 0; i < compositor_animations_.size(); ++i) {
+    if (compositor_animations_[i].property == property)
+      return true;
+  }
+  return false;
 }
 
 void Layer::SetOpacity(float alpha) {
+  // The compositor draws the animated opacity.
+  if (alpha != opacity_ &&
+      !HasCompositorAnimation(CompositorAnimation::OPACITY))
+    DamageTree();
   bool was_opaque = GetCombinedOpacity() == 1.0f;
   opacity_ = alpha;
   bool is_opaque = GetCombinedOpacity() == 1.0f;
@@ -230,28 +388,183 @@ float Layer::GetCombinedOpacity() const {
   return opacity;
 }
 
-void Layer::DrawRegion(const ui::TextureDrawParams& params,
-                       const gfx::Rect& region_to_draw) {
-  if (!region_to_draw.IsEmpty())
-    texture_->Draw(params, region_to_draw);
+void Layer::UpdateLayerCanvas() {
+  if (tiled_) {
+    UpdateTiles();
+    return;
+  }
+  gfx::Rect draw_rect;
+  if (!GetDrawRect(&draw_rect))
+    return;
+  // The invalid rect was damaged when it was scheduled.
+  SkBitmap bitmap;
+  PaintDelegate(delegate_, draw_rect, &bitmap);
+  AddUpload(bitmap, draw_rect.origin());
 }
 
-void Layer::UpdateLayerCanvas() {
+bool Layer::GetDrawRect(gfx::Rect* draw_rect) {
   // If we have no delegate, that means that whoever constructed the Layer is
   // setting its canvas directly with SetCanvas().
   if (!delegate_ || layer_updated_externally_)
-    return;
+    return false;
   gfx::Rect local_bounds = gfx::Rect(gfx::Point(), bounds_.size());
-  gfx::Rect draw_rect = invalid_rect_.Intersect(local_bounds);
-  if (draw_rect.IsEmpty()) {
+  *draw_rect = invalid_rect_.Intersect(local_bounds);
+  if (draw_rect->IsEmpty()) {
     invalid_rect_ = gfx::Rect();
+    return false;
+  }
+  return true;
+}
+
+void Layer::AddUpload(const SkBitmap& bitmap, const gfx::Point& origin) {
+  CommittedLayerTree::Upload upload;
+  upload.bitmap = bitmap;
+  upload.origin = origin;
+  pending_uploads_.push_back(upload);
+  invalid_rect_ = gfx::Rect();
+}
+
+void Layer::UpdateTiles() {
+  if (!delegate_ || layer_updated_externally_)
     return;
+
+  gfx::Rect visible_rect(compositor_->size());
+  GetTransformToRoot().TransformRectReverse(&visible_rect);
+  visible_rect = visible_rect.Intersect(gfx::Rect(bounds_.size()));
+  ClipToMaskingAncestors(&visible_rect);
+
+  // The tiles in view are painted together, in one call to the delegate,
+  // with the up to date ones between them.
+  gfx::Size grid_size = TiledTexture::GetTileGridSize(bounds_.size());
+  gfx::Rect draw_rect;
+  std::vector<OffscreenTile> offscreen_tiles;
+  for (int row = 0; row < grid_size.height(); ++row) {
+    for (int column = 0; column < grid_size.width(); ++column) {
+      if (!dirty_tiles_[row * grid_size.width() + column])
+        continue;
+      gfx::Rect tile_rect =
+          TiledTexture::GetTileRect(bounds_.size(), column, row);
+      if (tile_rect.Intersects(visible_rect)) {
+        draw_rect = draw_rect.Union(tile_rect);
+        continue;
+      }
+      // Ordered by how far the tile is from the view.
+      gfx::Rect between = tile_rect.Union(visible_rect);
+      int distance = between.width() + between.height();
+      offscreen_tiles.push_back(OffscreenTile(distance, tile_rect));
+    }
   }
-  scoped_ptr<gfx::Canvas> canvas(gfx::Canvas::CreateCanvas(
-      draw_rect.width(), draw_rect.height(), false));
-  canvas->TranslateInt(-draw_rect.x(), -draw_rect.y());
-  delegate_->OnPaintLayer(canvas.get());
-  SetCanvas(*canvas->AsCanvasSkia(), draw_rect.origin());
+  if (!draw_rect.IsEmpty())
+    PaintTiles(draw_rect);
+
+  size_t num_offscreen =
+      std::min(offscreen_tiles.size(), kMaxOffscreenTilesPerCommit);
+  std::partial_sort(offscreen_tiles.begin(),
+                    offscreen_tiles.begin() + num_offscreen,
+                    offscreen_tiles.end(), IsNearer);
+  for (size_t i = 0; i < num_offscreen; ++i)
+    PaintTiles(offscreen_tiles[i].second);
+}
+
+void Layer::PaintTiles(const gfx::Rect& rect) {
+  SkBitmap bitmap;
+  PaintDelegate(delegate_, rect, &bitmap);
+  AddUpload(bitmap, rect.origin());
+
+  gfx::Size grid_size = TiledTexture::GetTileGridSize(bounds_.size());
+  int last_column = (rect.right() - 1) / TiledTexture::kTileSize;
+  int last_row = (rect.bottom() - 1) / TiledTexture::kTileSize;
+  for (int row = rect.y() / TiledTexture::kTileSize; row <= last_row; ++row) {
+    for (int column = rect.x() / TiledTexture::kTileSize;
+         column <= last_column; ++column)
+      dirty_tiles_[row * grid_size.width() + column] = false;
+  }
+}
+
+void Layer::InvalidateTiles(const gfx::Rect& rect) {
+  gfx::Rect invalid_rect = rect.Intersect(gfx::Rect(bounds_.size()));
+  if (invalid_rect.IsEmpty())
+    return;
+  gfx::Size grid_size = TiledTexture::GetTileGridSize(bounds_.size());
+  int last_column = (invalid_rect.right() - 1) / TiledTexture::kTileSize;
+  int last_row = (invalid_rect.bottom() - 1) / TiledTexture::kTileSize;
+  for (int row = invalid_rect.y() / TiledTexture::kTileSize; row <= last_row;
+       ++row) {
+    for (int column = invalid_rect.x() / TiledTexture::kTileSize;
+         column <= last_column; ++column)
+      dirty_tiles_[row * grid_size.width() + column] = true;
+  }
+}
+
+void Layer::PaintLayersInParallel() {
+  std::vector<Layer*> layers;
+  std::vector<LayerPaintJob> jobs;
+  std::vector<Layer*> to_visit(1, this);
+  while (!to_visit.empty()) {
+    Layer* layer = to_visit.back();
+    to_visit.pop_back();
+    LayerPaintJob job;
+    if (layer->texture_.get() && !layer->tiled_ && layer->delegate_ &&
+        layer->delegate_->CanPaintLayerOnAnyThread() &&
+        layer->GetDrawRect(&job.draw_rect)) {
+      job.delegate = layer->delegate_;
+      layers.push_back(layer);
+      jobs.push_back(job);
+    }
+    for (size_t i = 0; i < layer->children_.size(); ++i) {
+      if (layer->children_[i]->visible_)
+        to_visit.push_back(layer->children_[i]);
+    }
+  }
+  // A single layer paints faster on this thread than through a worker.
+  if (jobs.size() < 2)
+    return;
+
+  // The layers are handed out to whichever thread asks first, so this thread
+  // never waits for a layer that no worker has started.
+  base::RunParallelChunks(static_cast<int>(jobs.size()),
+                          base::Bind(&PaintJob, &jobs));
+  for (size_t i = 0; i < layers.size(); ++i)
+    layers[i]->AddUpload(jobs[i].bitmap, jobs[i].draw_rect.origin());
+}
+
+void Layer::CommitNode(CommittedLayerTree* tree, int parent) {
+  hole_rect_ = hole_rect_.Intersect(
+      gfx::Rect(0, 0, bounds_.width(), bounds_.height()));
+  DCHECK(texture_.get() || pending_uploads_.empty());
+  if (texture_.get())
+    UpdateLayerCanvas();
+
+  std::vector<CommittedLayerTree::Node>* nodes = tree->nodes();
+  int index = static_cast<int>(nodes->size());
+  nodes->push_back(CommittedLayerTree::Node());
+  CommittedLayerTree::Node& node = nodes->back();
+  node.texture = texture_;
+  node.parent = parent;
+  node.bounds = bounds_;
+  node.transform = transform_;
+  node.opacity = opacity_;
+  node.fills_bounds_opaquely = fills_bounds_opaquely_;
+  node.masks_to_bounds = masks_to_bounds_;
+  node.has_valid_alpha_channel = has_valid_alpha_channel();
+  node.animations = compositor_animations_;
+  node.uploads.swap(pending_uploads_);
+  node.filter = filter_;
+  node.filter_texture = filter_texture_;
+  node.filter_uploads.swap(pending_filter_uploads_);
+  node.frames_texture = frames_texture_;
+  node.frames_uploads.swap(pending_frames_uploads_);
+  node.frame_count = frame_count_;
+  node.frame_size = frame_size_;
+  node.frames_start_time = frames_start_time_;
+  node.frame_time = frame_time_;
+
+  for (size_t i = 0; i < children_.size(); ++i) {
+    if (children_[i]->visible_)
+      children_[i]->CommitNode(tree, index);
+  }
+  // |node| may have moved as the children were added.
+  (*nodes)[index].subtree_end = static_cast<int>(nodes->size());
 }
 
 void Layer::RecomputeHole() {
@@ -299,4 +612,70 @@ bool Layer::GetTransformRelativeTo(const Layer* ancestor,
   return p == ancestor;
 }
 
+const ui::Transform& Layer::GetTransformToRoot() const {
+  if (!transform_to_root_valid_) {
+    transform_to_root_ = transform_;
+    transform_to_root_.ConcatTranslate(static_cast<float>(bounds_.x()),
+                                       static_cast<float>(bounds_.y()));
+    if (parent_)
+      transform_to_root_.ConcatTransform(parent_->GetTransformToRoot());
+    transform_to_root_valid_ = true;
+  }
+  return transform_to_root_;
+}
+
+void Layer::InvalidateTransformToRoot() {
+  // The descendants of a layer whose cache is invalid are invalid too, since
+  // none of them can be computed without computing it.
+  if (!transform_to_root_valid_)
+    return;
+  transform_to_root_valid_ = false;
+  for (size_t i = 0; i < children_.size(); ++i)
+    children_[i]->InvalidateTransformToRoot();
+}
+
+void Layer::ClipToMaskingAncestors(gfx::Rect* rect) const {
+  // The origin of the Layer in the coordinates of |layer->parent_|.
+  gfx::Point origin;
+  for (const Layer* layer = this; layer->parent_; layer = layer->parent_) {
+    origin.Offset(layer->bounds_.x(), layer->bounds_.y());
+    const Layer* parent = layer->parent_;
+    if (!parent->masks_to_bounds_)
+      continue;
+    gfx::Rect clip(parent->bounds_.size());
+    clip.Offset(-origin.x(), -origin.y());
+    *rect = rect->Intersect(clip);
+  }
+}
+
+void Layer::DamageRect(const gfx::Rect& rect) {
+  for (const Layer* layer = this; layer; layer = layer->parent_) {
+    if (!layer->visible_)
+      return;
+  }
+  gfx::Rect damage_rect = rect.Intersect(gfx::Rect(bounds_.size()));
+  ClipToMaskingAncestors(&damage_rect);
+  if (damage_rect.IsEmpty())
+    return;
+  GetTransformToRoot().TransformRect(&damage_rect);
+  // The transformed corners are rounded, so the pixels on the edges of the
+  // box may be partly covered by the layer.
+  damage_rect.Inset(-1, -1);
+  compositor_->AddDamage(damage_rect);
+}
+
+void Layer::DamageTree() {
+  std::vector<Layer*> to_damage(1, this);
+  while (!to_damage.empty()) {
+    Layer* layer = to_damage.back();
+    to_damage.pop_back();
+    layer->DamageRect(gfx::Rect(layer->bounds_.size()));
+    for (size_t i = 0; i < layer->children_.size(); ++i) {
+      if (layer->children_[i]->visible_)
+        to_damage.push_back(layer->children_[i]);
+    }
+  }
+  compositor_->SchedulePaint();
+}
+
 }  // namespace ui
@@ -12,6 +12,7 @@
 #include "base/message_loop.h"
 #include "ui/gfx/rect.h"
 #include "ui/gfx/transform.h"
+#include "ui/gfx/compositor/committed_layer_tree.h"
 #include "ui/gfx/compositor/compositor.h"
 #include "ui/gfx/compositor/layer_delegate.h"
 
@@ -27,6 +28,12 @@ class Texture;
 // A Layer can also be created without a texture, in which case it renders
 // nothing and is simply used as a node in a hierarchy of layers.
 //
+// Changes to a Layer (its transform, bounds, opacity, visibility and
+// contents) damage the area of the compositor it covers, so that the
+// compositor only redraws that area on its next frame. The compositor draws a
+// copy of the tree of Layers, made by CommitTree(), and may do so on its own
+// thread: the Layers are only used on the UI thread.
+//
 // NOTE: unlike Views, each Layer does *not* own its children views. If you
 // delete a Layer and it has children, the parent of each child layer is set to
 // NULL, but the children are not deleted.
@@ -34,7 +41,10 @@ class COMPOSITOR_EXPORT Layer {
  public:
   enum TextureParam {
     LAYER_HAS_NO_TEXTURE = 0,
-    LAYER_HAS_TEXTURE = 1
+    LAYER_HAS_TEXTURE = 1,
+    // A TiledTexture, for the layers larger than a texture can be. The tiles
+    // in view are painted first, see UpdateTiles().
+    LAYER_HAS_TILED_TEXTURE = 2
   };
 
   explicit Layer(Compositor* compositor);
@@ -70,7 +80,7 @@ class COMPOSITOR_EXPORT Layer {
 
   // Sets |visible_|. The Layer is drawn by Draw() only when visible_ is true.
   bool visible() const { return visible_; }
-  void set_visible(bool visible) { visible_ = visible; }
+  void SetVisible(bool visible);
 
   // Converts a point from the coordinates of |source| to the coordinates of
   // |target|. Necessarily, |source| and |target| must inhabit the same Layer
@@ -83,6 +93,13 @@ class COMPOSITOR_EXPORT Layer {
   void SetFillsBoundsOpaquely(bool fills_bounds_opaquely);
   bool fills_bounds_opaquely() const { return fills_bounds_opaquely_; }
 
+  // Sets whether the descendants are only drawn within the bounds of the
+  // Layer, as a View clips its children, so that they can be moved within
+  // it, to scroll them, without being drawn outside. The clip ignores the
+  // transforms of the descendants under it.
+  void SetMasksToBounds(bool masks_to_bounds);
+  bool masks_to_bounds() const { return masks_to_bounds_; }
+
   const gfx::Rect& hole_rect() const {  return hole_rect_; }
 
   // The compositor.
@@ -97,16 +114,18 @@ class COMPOSITOR_EXPORT Layer {
   //             single-compositor world.
   void SetExternalTexture(ui::Texture* texture);
 
-  // Resets the canvas of the texture.
+  // Resets the canvas of the texture. The pixels are copied, and given to the
+  // texture by the next commit.
   void SetCanvas(const SkCanvas& canvas, const gfx::Point& origin);
 
-  // Adds |invalid_rect| to the Layer's pending invalid rect, and schedules a
-  // repaint if the Layer has an associated LayerDelegate that can handle the
-  // repaint.
+  // Adds |invalid_rect| to the Layer's pending invalid rect, damages it, and
+  // schedules a repaint.
   void SchedulePaint(const gfx::Rect& invalid_rect);
 
-  // Draws the layer with hole if hole is non empty.
-  // hole looks like:
+  // Adds a copy of the tree of Layers starting with the receiver, without the
+  // layers that aren't visible, to |tree|, after painting the invalid rects
+  // of the layers that have a delegate. The textures are drawn with a hole
+  // where an opaque child covers them:
   //
   //  layer____________________________
   //  |xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx|
@@ -122,11 +141,16 @@ class COMPOSITOR_EXPORT Layer {
   //
   // Legend:
   //   composited area: x
-  void Draw();
+  void CommitTree(CommittedLayerTree* tree);
 
-  // Draws a tree of Layers, by calling Draw() on each in the hierarchy starting
-  // with the receiver.
-  void DrawTree();
+  // Has the compositor run |animation| when it draws, on its thread if
+  // compositing is threaded, replacing the one of the same property. Setting
+  // the animated property then only changes the value the UI thread sees,
+  // until RemoveCompositorAnimation(), since the compositor draws the layer
+  // with the animated value.
+  void SetCompositorAnimation(const CompositorAnimation& animation);
+  void RemoveCompositorAnimation(CompositorAnimation::Property property);
+  bool HasCompositorAnimation(CompositorAnimation::Property property) const;
 
   // Sometimes the Layer is being updated by something other than SetCanvas
   // (e.g. the GPU process on TOUCH_UI).
@@ -135,6 +159,28 @@ class COMPOSITOR_EXPORT Layer {
   float opacity() const { return opacity_; }
   void SetOpacity(float alpha);
 
+  // Has the compositor draw the Layer through |filter|. Nothing is repainted,
+  // so the filter can be animated at no cost to the UI thread.
+  void SetFilter(const TextureFilter& filter);
+  const TextureFilter& filter() const { return filter_; }
+
+  // Sets the pixels the mask and blend filters sample, stretched over the
+  // Layer. The pixels are copied, and given to the texture by the next commit.
+  void SetFilterBitmap(const SkBitmap& bitmap);
+
+  // Has the compositor draw the Layer as one of the |frame_count| frames of
+  // |frames|, side by side in a strip, instead of its own pixels, stepping to
+  // the next every |frame_time| from |start_time|, and back to the first
+  // after the last. Only the region of the strip drawn changes, so the frames
+  // go on at no cost to the UI thread until ClearFrames(). The pixels are
+  // copied, and given to the texture by the next commit.
+  void SetFrames(const SkBitmap& frames,
+                 int frame_count,
+                 base::TimeTicks start_time,
+                 base::TimeDelta frame_time);
+  void ClearFrames();
+  bool has_frames() const { return frames_texture_.get() != NULL; }
+
  private:
   // TODO(vollick): Eventually, if a non-leaf node has an opacity of less than
   // 1.0, we'll render to a separate texture, and then apply the alpha.
@@ -142,14 +188,40 @@ class COMPOSITOR_EXPORT Layer {
   // use the combined result, but this is only temporary.
   float GetCombinedOpacity() const;
 
-  // calls Texture::Draw only if the region to be drawn is non empty
-  void DrawRegion(const ui::TextureDrawParams& params,
-                  const gfx::Rect& region_to_draw);
-
-  // Called during the Draw() pass to freshen the Layer's contents from the
+  // Called during the commit to freshen the Layer's contents from the
   // delegate.
   void UpdateLayerCanvas();
 
+  // Sets |draw_rect| to the part of the Layer that UpdateLayerCanvas() must
+  // have the delegate paint. Returns false, and clears the invalid rect if it
+  // is outside the Layer, if there is nothing to paint.
+  bool GetDrawRect(gfx::Rect* draw_rect);
+
+  // Queues |bitmap|, the pixels painted at |origin|, for the next commit.
+  void AddUpload(const SkBitmap& bitmap, const gfx::Point& origin);
+
+  // Paints the tiles of a tiled Layer whose pixels are out of date: all of
+  // those in view of the compositor, at once, then a few of the others,
+  // nearest first, so that scrolling mostly finds them painted. The others
+  // are left for the next commits.
+  void UpdateTiles();
+
+  // Has the delegate paint |rect|, made of whole tiles, and marks the tiles
+  // up to date.
+  void PaintTiles(const gfx::Rect& rect);
+
+  // Marks the tiles that |rect| touches out of date.
+  void InvalidateTiles(const gfx::Rect& rect);
+
+  // Paints on worker threads the visible layers of the tree whose delegates
+  // can paint on any thread, when there are several to paint, and returns
+  // once they are all painted. UpdateLayerCanvas() then paints the others.
+  void PaintLayersInParallel();
+
+  // Adds the Layer to |tree|, as a child of the node at |parent|, followed by
+  // its visible descendants.
+  void CommitNode(CommittedLayerTree* tree, int parent);
+
   // A hole in a layer is an area in the layer that does not get drawn
   // because this area is covered up with another layer which is known to be
   // opaque.
@@ -165,6 +237,29 @@ class COMPOSITOR_EXPORT Layer {
   bool GetTransformRelativeTo(const Layer* ancestor,
                               Transform* transform) const;
 
+  // Returns the transform from the coordinates of the Layer to those of the
+  // root, cached until the transform or the origin of the Layer or of one of
+  // its ancestors changes, or the Layer moves to another parent.
+  const ui::Transform& GetTransformToRoot() const;
+
+  // Drops the cached transform to the root of the Layer and of its
+  // descendants.
+  void InvalidateTransformToRoot();
+
+  // Intersects |rect|, in the coordinates of the Layer, with the bounds of
+  // the ancestors that mask their descendants to them.
+  void ClipToMaskingAncestors(gfx::Rect* rect) const;
+
+  // Adds |rect|, in the coordinates of the Layer, to the damage of the
+  // compositor, as the bounding box of where it is drawn.
+  void DamageRect(const gfx::Rect& rect);
+
+  // Damages the bounds of the Layer and of its visible descendants, when they
+  // move or change how they are drawn, and schedules a paint. Called before
+  // and after a change of geometry, to damage where the layers were and where
+  // they are now.
+  void DamageTree();
+
   // The only externally updated layers are ones that get their pixels from
   // WebKit and WebKit does not produce valid alpha values. All other layers
   // should have valid alpha.
@@ -186,15 +281,47 @@ class COMPOSITOR_EXPORT Layer {
 
   bool fills_bounds_opaquely_;
 
+  bool masks_to_bounds_;
+
+  // The cache of GetTransformToRoot(), if |transform_to_root_valid_|.
+  mutable ui::Transform transform_to_root_;
+  mutable bool transform_to_root_valid_;
+
   gfx::Rect hole_rect_;
 
   gfx::Rect invalid_rect_;
 
+  // True for the layers with a TiledTexture, whose invalid rect is tracked
+  // by tile, in |dirty_tiles_|, by row, then column.
+  bool tiled_;
+  std::vector<bool> dirty_tiles_;
+
+  // The pixels painted, or set, since the last commit.
+  std::vector<CommittedLayerTree::Upload> pending_uploads_;
+
+  std::vector<CompositorAnimation> compositor_animations_;
+
   // If true the layer is always up to date.
   bool layer_updated_externally_;
 
   float opacity_;
 
+  TextureFilter filter_;
+
+  // The texture the filter samples, created by SetFilterBitmap(), and the
+  // pixels it was given since the last commit.
+  scoped_refptr<ui::Texture> filter_texture_;
+  std::vector<CommittedLayerTree::Upload> pending_filter_uploads_;
+
+  // The strip of frames drawn instead of |texture_|, created by SetFrames(),
+  // the pixels it was given since the last commit, and how it is stepped.
+  scoped_refptr<ui::Texture> frames_texture_;
+  std::vector<CommittedLayerTree::Upload> pending_frames_uploads_;
+  int frame_count_;
+  gfx::Size frame_size_;
+  base::TimeTicks frames_start_time_;
+  base::TimeDelta frame_time_;
+
   LayerDelegate* delegate_;
 
   DISALLOW_COPY_AND_ASSIGN(Layer);
@@ -4,8 +4,12 @@
 
 #include "ui/gfx/compositor/layer_animator.h"
 
+#include <algorithm>
+
 #include "base/logging.h"
+#include "base/message_loop.h"
 #include "base/stl_util.h"
+#include "base/time.h"
 #include "ui/base/animation/animation_container.h"
 #include "ui/base/animation/multi_animation.h"
 #include "ui/gfx/compositor/compositor.h"
@@ -34,7 +38,10 @@ namespace ui {
 LayerAnimator::LayerAnimator(Layer* layer)
     : layer_(layer),
       duration_in_ms_(200),
-      animation_type_(ui::Tween::EASE_IN) {
+      animation_type_(ui::Tween::EASE_IN),
+      compositor_driven_(Compositor::IsThreaded()),
+      last_compositor_animation_id_(0),
+      ALLOW_THIS_IN_INITIALIZER_LIST(method_factory_(this)) {
 }
 
 LayerAnimator::~LayerAnimator() {
@@ -61,7 +68,7 @@ void LayerAnimator::AnimateToPoint(const gfx::Point& target) {
   element.params.location.start_y = layer_bounds.origin().y();
   element.params.location.target_x = target.x();
   element.params.location.target_y = target.y();
-  element.animation = CreateAndStartAnimation();
+  StartAnimation(LOCATION);
 }
 
 void LayerAnimator::AnimateTransform(const Transform& transform) {
@@ -77,22 +84,169 @@ void LayerAnimator::AnimateTransform(const Transform& transform) {
     element.params.transform.target[i] =
       GetMatrixElement(transform.matrix(), i);
   }
-  element.animation = CreateAndStartAnimation();
+  StartAnimation(TRANSFORM);
+}
+
+void LayerAnimator::AnimateOpacity(float opacity) {
+  StopAnimating(OPACITY);
+  if (opacity == layer_->opacity())
+    return;  // Already there.
+
+  Element& element = elements_[OPACITY];
+  element.params.opacity.start = layer_->opacity();
+  element.params.opacity.target = opacity;
+  StartAnimation(OPACITY);
 }
 
 void LayerAnimator::AnimationProgressed(const ui::Animation* animation) {
   Elements::iterator e = GetElementByAnimation(
       static_cast<const ui::MultiAnimation*>(animation));
   DCHECK(e != elements_.end());
+  SetLayerValue(e, e->second.animation->GetCurrentValue());
+  layer_->compositor()->SchedulePaint();
+}
+
+void LayerAnimator::AnimationEnded(const ui::Animation* animation) {
+  Elements::iterator e = GetElementByAnimation(
+      static_cast<const ui::MultiAnimation*>(animation));
+  DCHECK(e != elements_.end());
+  FinishAnimation(e);
+}
+
+void LayerAnimator::StopAnimating(AnimationProperty property) {
+  Elements::iterator e = elements_.find(property);
+  if (e == elements_.end())
+    return;
+
+  if (!e->second.animation) {
+    // The layer has kept the start value, so it is moved to where the
+    // compositor has it.
+    const Element& element = e->second;
+    double state = (base::TimeTicks::Now() - element.start_time)
+        .InMillisecondsF() / element.duration.InMillisecondsF();
+    SetLayerValue(e, ui::Tween::CalculateValue(
+        element.tween_type, std::min(std::max(state, 0.0), 1.0)));
+  }
+  RemoveAnimation(e);
+}
+
+void LayerAnimator::RemoveAnimation(Elements::iterator e) {
+  if (e->second.animation) {
+    // Reset the delegate so that we don't attempt to update the layer.
+    e->second.animation->set_delegate(NULL);
+    delete e->second.animation;
+  } else {
+    // The compositor goes back to drawing the value the layer has.
+    switch (e->first) {
+      case LOCATION:
+        layer_->RemoveCompositorAnimation(CompositorAnimation::LOCATION);
+        break;
+      case TRANSFORM:
+        layer_->RemoveCompositorAnimation(CompositorAnimation::TRANSFORM);
+        break;
+      case OPACITY:
+        layer_->RemoveCompositorAnimation(CompositorAnimation::OPACITY);
+        break;
+    }
+  }
+  elements_.erase(e);
+}
+
+void LayerAnimator::StartAnimation(AnimationProperty property) {
+  Element& element = elements_[property];
+  if (!compositor_driven_) {
+    element.animation = CreateAndStartAnimation();
+    return;
+  }
+
+  element.animation = NULL;
+  element.start_time = base::TimeTicks::Now();
+  element.duration = base::TimeDelta::FromMilliseconds(duration_in_ms_);
+  element.tween_type = animation_type_;
+  element.id = ++last_compositor_animation_id_;
+  StartCompositorAnimation(property);
+  MessageLoop::current()->PostDelayedTask(
+      FROM_HERE,
+      method_factory_.NewRunnableMethod(
+          &LayerAnimator::CompositorAnimationEnded, property, element.id),
+      duration_in_ms_);
+}
+
+ui::MultiAnimation* LayerAnimator::CreateAndStartAnimation() {
+  static ui::AnimationContainer* container = NULL;
+  if (!container) {
+    container = new AnimationContainer;
+    container->AddRef();
+  }
+  ui::MultiAnimation::Parts parts;
+  parts.push_back(ui::MultiAnimation::Part(duration_in_ms_, animation_type_));
+  ui::MultiAnimation* animation = new ui::MultiAnimation(parts);
+  animation->SetContainer(container);
+  animation->set_delegate(this);
+  animation->set_continuous(false);
+  animation->Start();
+  return animation;
+}
+
+void LayerAnimator::StartCompositorAnimation(AnimationProperty property) {
+  const Element& element = elements_[property];
+  const Params& params = element.params;
+  CompositorAnimation animation;
+  animation.start_time = element.start_time;
+  animation.duration = element.duration;
+  animation.tween_type = element.tween_type;
+  switch (property) {
+    case LOCATION:
+      animation.property = CompositorAnimation::LOCATION;
+      animation.start_location.SetPoint(params.location.start_x,
+                                        params.location.start_y);
+      animation.target_location.SetPoint(params.location.target_x,
+                                         params.location.target_y);
+      break;
+
+    case TRANSFORM:
+      animation.property = CompositorAnimation::TRANSFORM;
+      for (int i = 0; i < 16; ++i) {
+        SetMatrixElement(animation.start_transform.matrix(), i,
+                         params.transform.start[i]);
+        SetMatrixElement(animation.target_transform.matrix(), i,
+                         params.transform.target[i]);
+      }
+      break;
+
+    case OPACITY:
+      animation.property = CompositorAnimation::OPACITY;
+      animation.start_opacity = params.opacity.start;
+      animation.target_opacity = params.opacity.target;
+      break;
+
+    default:
+      NOTREACHED();
+  }
+  layer_->SetCompositorAnimation(animation);
+}
+
+void LayerAnimator::CompositorAnimationEnded(AnimationProperty property,
+                                             int id) {
+  // The animation may have been stopped, and replaced by another.
+  Elements::iterator e = elements_.find(property);
+  if (e == elements_.end() || e->second.animation || e->second.id != id)
+    return;
+  FinishAnimation(e);
+}
+
+void LayerAnimator::SetLayerValue(Elements::iterator e, double value) {
+  const Params& params = e->second.params;
   switch (e->first) {
     case LOCATION: {
       const gfx::Rect& current_bounds(layer_->bounds());
-      gfx::Rect new_bounds = e->second.animation->CurrentValueBetween(
-          gfx::Rect(gfx::Point(e->second.params.location.start_x,
-                               e->second.params.location.start_y),
+      gfx::Rect new_bounds = ui::Tween::ValueBetween(
+          value,
+          gfx::Rect(gfx::Point(params.location.start_x,
+                               params.location.start_y),
                     current_bounds.size()),
-          gfx::Rect(gfx::Point(e->second.params.location.target_x,
-                               e->second.params.location.target_y),
+          gfx::Rect(gfx::Point(params.location.target_x,
+                               params.location.target_y),
                     current_bounds.size()));
       layer_->SetBounds(new_bounds);
       break;
@@ -101,25 +255,27 @@ void LayerAnimator::AnimationProgressed(const ui::Animation* animation) {
     case TRANSFORM: {
       Transform transform;
       for (int i = 0; i < 16; ++i) {
-        SkMScalar value = e->second.animation->CurrentValueBetween(
-          e->second.params.transform.start[i],
-          e->second.params.transform.target[i]);
-        SetMatrixElement(transform.matrix(), i, value);
+        SkMScalar element_value = static_cast<SkMScalar>(
+            ui::Tween::ValueBetween(value, params.transform.start[i],
+                                    params.transform.target[i]));
+        SetMatrixElement(transform.matrix(), i, element_value);
       }
       layer_->SetTransform(transform);
       break;
     }
 
+    case OPACITY: {
+      layer_->SetOpacity(static_cast<float>(ui::Tween::ValueBetween(
+          value, params.opacity.start, params.opacity.target)));
+      break;
+    }
+
     default:
       NOTREACHED();
   }
-  layer_->compositor()->SchedulePaint();
 }
 
-void LayerAnimator::AnimationEnded(const ui::Animation* animation) {
-  Elements::iterator e = GetElementByAnimation(
-      static_cast<const ui::MultiAnimation*>(animation));
-  DCHECK(e != elements_.end());
+void LayerAnimator::FinishAnimation(Elements::iterator e) {
   switch (e->first) {
     case LOCATION: {
       gfx::Rect new_bounds(
@@ -141,41 +297,20 @@ void LayerAnimator::AnimationEnded(const ui::Animation* animation) {
       break;
     }
 
+    case OPACITY: {
+      layer_->SetOpacity(e->second.params.opacity.target);
+      break;
+    }
+
     default:
       NOTREACHED();
   }
-  StopAnimating(e->first);
-  // StopAnimating removes from the map, invalidating 'e'.
+  RemoveAnimation(e);
+  // RemoveAnimation removes from the map, invalidating 'e'.
   e = elements_.end();
   layer_->compositor()->SchedulePaint();
 }
 
-void LayerAnimator::StopAnimating(AnimationProperty property) {
-  if (elements_.count(property) == 0)
-    return;
-
-  // Reset the delegate so that we don't attempt to update the layer.
-  elements_[property].animation->set_delegate(NULL);
-  delete elements_[property].animation;
-  elements_.erase(property);
-}
-
-ui::MultiAnimation* LayerAnimator::CreateAndStartAnimation() {
-  static ui::AnimationContainer* container = NULL;
-  if (!container) {
-    container = new AnimationContainer;
-    container->AddRef();
-  }
-  ui::MultiAnimation::Parts parts;
-  parts.push_back(ui::MultiAnimation::Part(duration_in_ms_, animation_type_));
-  ui::MultiAnimation* animation = new ui::MultiAnimation(parts);
-  animation->SetContainer(container);
-  animation->set_delegate(this);
-  animation->set_continuous(false);
-  animation->Start();
-  return animation;
-}
-
 LayerAnimator::Elements::iterator LayerAnimator::GetElementByAnimation(
     const ui::MultiAnimation* animation) {
   for (Elements::iterator i = elements_.begin(); i != elements_.end(); ++i) {
@@ -10,6 +10,8 @@
 
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
+#include "base/task.h"
+#include "base/time.h"
 #include "third_party/skia/include/core/SkScalar.h"
 #include "third_party/skia/include/utils/SkMatrix44.h"
 #include "ui/base/animation/animation_delegate.h"
@@ -23,7 +25,14 @@ class Layer;
 class MultiAnimation;
 class Transform;
 
-// LayerAnimator manages animating various properties of a Layer.
+// LayerAnimator manages animating various properties of a Layer. By default,
+// the animations are stepped on the UI thread, which sets the property of the
+// Layer, and repaints, for each frame. When compositor driven, which it is
+// when compositing is threaded, the animations are instead handed to the
+// compositor as curves that it evaluates when drawing, so that the UI thread
+// has nothing to do until they end, and, with a compositor thread, so that
+// they don't stall while the UI thread is busy. The properties of the Layer
+// then keep their start values until the animations end, or are stopped.
 class COMPOSITOR_EXPORT LayerAnimator : public ui::AnimationDelegate {
  public:
   explicit LayerAnimator(Layer* layer);
@@ -35,6 +44,13 @@ class COMPOSITOR_EXPORT LayerAnimator : public ui::AnimationDelegate {
   // existing animations, only newly created animations.
   void SetAnimationDurationAndType(int duration, ui::Tween::Type tween_type);
 
+  // Sets whether the compositor runs the animations, see above. This does not
+  // effect existing animations, only newly created animations.
+  void set_compositor_driven(bool compositor_driven) {
+    compositor_driven_ = compositor_driven;
+  }
+  bool compositor_driven() const { return compositor_driven_; }
+
   // Animates the layer to the specified point. The point is relative to the
   // parent layer.
   void AnimateToPoint(const gfx::Point& target);
@@ -48,6 +64,12 @@ class COMPOSITOR_EXPORT LayerAnimator : public ui::AnimationDelegate {
     StopAnimating(TRANSFORM);
   }
 
+  // Animates the opacity from the current opacity to |opacity|.
+  void AnimateOpacity(float opacity);
+  void StopAnimatingOpacity() {
+    StopAnimating(OPACITY);
+  }
+
   // AnimationDelegate:
   virtual void AnimationProgressed(const Animation* animation) OVERRIDE;
   virtual void AnimationEnded(const Animation* animation) OVERRIDE;
@@ -56,7 +78,8 @@ class COMPOSITOR_EXPORT LayerAnimator : public ui::AnimationDelegate {
   // Types of properties that can be animated.
   enum AnimationProperty {
     LOCATION,
-    TRANSFORM
+    TRANSFORM,
+    OPACITY
   };
 
   // Parameters used when animating the location.
@@ -74,26 +97,65 @@ class COMPOSITOR_EXPORT LayerAnimator : public ui::AnimationDelegate {
     SkMScalar target[16];
   };
 
+  // Parameters used when animating the opacity.
+  struct OpacityParams {
+    float start;
+    float target;
+  };
+
   union Params {
     LocationParams location;
     TransformParams transform;
+    OpacityParams opacity;
   };
 
   // Used for tracking the animation of a particular property.
   struct Element {
     Params params;
+
+    // NULL if the compositor runs the animation.
     ui::MultiAnimation* animation;
+
+    // For the animations the compositor runs: when they started, how long
+    // they last and how they are tweened, and an id that tells the task
+    // posted for the end of one from those of the animations before it.
+    base::TimeTicks start_time;
+    base::TimeDelta duration;
+    ui::Tween::Type tween_type;
+    int id;
   };
 
   typedef std::map<AnimationProperty, Element> Elements;
 
   // Stops animating the specified property. This does not set the property
-  // being animated to its final value.
+  // being animated to its final value: it is left where the animation is.
   void StopAnimating(AnimationProperty property);
 
+  // Stops the animation of |e|, and removes it from |elements_|, leaving the
+  // property of the layer as it is.
+  void RemoveAnimation(Elements::iterator e);
+
+  // Starts animating |property|, from the params of its element.
+  void StartAnimation(AnimationProperty property);
+
   // Creates an animation.
   ui::MultiAnimation* CreateAndStartAnimation();
 
+  // Has the compositor run the animation of |property|.
+  void StartCompositorAnimation(AnimationProperty property);
+
+  // Called when the animation |id| of |property|, which the compositor runs,
+  // is over.
+  void CompositorAnimationEnded(AnimationProperty property, int id);
+
+  // Sets the property of the layer that |e| animates to |value|, tweened, of
+  // the way from the start to the target.
+  void SetLayerValue(Elements::iterator e, double value);
+
+  // Sets the property of the layer that |e| animates to the target, and stops
+  // animating it.
+  void FinishAnimation(Elements::iterator e);
+
   // Returns an iterator into |elements_| that matches the specified animation.
   Elements::iterator GetElementByAnimation(const ui::MultiAnimation* animation);
 
@@ -109,6 +171,14 @@ class COMPOSITOR_EXPORT LayerAnimator : public ui::AnimationDelegate {
   // Type of animation for newly created animations.
   ui::Tween::Type animation_type_;
 
+  // Whether newly created animations are run by the compositor.
+  bool compositor_driven_;
+
+  // The id of the last animation run by the compositor.
+  int last_compositor_animation_id_;
+
+  ScopedRunnableMethodFactory<LayerAnimator> method_factory_;
+
   DISALLOW_COPY_AND_ASSIGN(LayerAnimator);
 };
 
@@ -21,6 +21,13 @@ class COMPOSITOR_EXPORT LayerDelegate {
   // clipped to the Layer's invalid rect.
   virtual void OnPaintLayer(gfx::Canvas* canvas) = 0;
 
+  // Returns true if OnPaintLayer() may be called on a worker thread, while
+  // the UI thread waits, at the same time as the delegates of other layers.
+  // The delegates of the layers that only draw their own images, or a cached
+  // bitmap, without touching the UI state, can do so, and are then painted
+  // in parallel when several of them are invalid at the same commit.
+  virtual bool CanPaintLayerOnAnyThread() const { return false; }
+
  protected:
   virtual ~LayerDelegate() {}
 };
@@ -0,0 +1,127 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/gfx/compositor/tiled_texture.h"
+
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkCanvas.h"
+#include "third_party/skia/include/core/SkDevice.h"
+#include "ui/gfx/point.h"
+
+namespace ui {
+
+// Small enough for the textures of any device, and to not upload much more
+// than what was painted, while keeping the number of draws low.
+const int TiledTexture::kTileSize = 256;
+
+TiledTexture::TiledTexture(Compositor* compositor)
+    : compositor_(compositor) {
+}
+
+// static
+gfx::Size TiledTexture::GetTileGridSize(const gfx::Size& size) {
+  return gfx::Size((size.width() + kTileSize - 1) / kTileSize,
+                   (size.height() + kTileSize - 1) / kTileSize);
+}
+
+// static
+gfx::Rect TiledTexture::GetTileRect(const gfx::Size& size,
+                                    int column,
+                                    int row) {
+  return gfx::Rect(column * kTileSize, row * kTileSize, kTileSize,
+                   kTileSize).Intersect(gfx::Rect(size));
+}
+
+void TiledTexture::SetCanvas(const SkCanvas& canvas,
+                             const gfx::Point& origin,
+                             const gfx::Size& overall_size) {
+  if (overall_size != size_)
+    Reset(overall_size);
+
+  const SkBitmap& bitmap = canvas.getDevice()->accessBitmap(false);
+  gfx::Rect rect(origin, gfx::Size(bitmap.width(), bitmap.height()));
+  rect = rect.Intersect(gfx::Rect(size_));
+  if (rect.IsEmpty())
+    return;
+
+  int first_column = rect.x() / kTileSize;
+  int last_column = (rect.right() - 1) / kTileSize;
+  int first_row = rect.y() / kTileSize;
+  int last_row = (rect.bottom() - 1) / kTileSize;
+  for (int row = first_row; row <= last_row; ++row) {
+    for (int column = first_column; column <= last_column; ++column) {
+      gfx::Rect tile_rect = GetTileRect(size_, column, row);
+      gfx::Rect update_rect = tile_rect.Intersect(rect);
+      scoped_refptr<Texture>& tile = tiles_[row * grid_size_.width() + column];
+
+      SkBitmap update;
+      if (!tile.get() && update_rect != tile_rect) {
+        // A new tile is set in full, with what wasn't painted left clear.
+        update.setConfig(SkBitmap::kARGB_8888_Config, tile_rect.width(),
+                         tile_rect.height());
+        update.allocPixels();
+        update.eraseARGB(0, 0, 0, 0);
+        SkCanvas update_canvas(update);
+        update_canvas.drawBitmap(
+            bitmap, SkIntToScalar(origin.x() - tile_rect.x()),
+            SkIntToScalar(origin.y() - tile_rect.y()));
+        update_rect = tile_rect;
+      } else {
+        SkIRect subset = { update_rect.x() - origin.x(),
+                           update_rect.y() - origin.y(),
+                           update_rect.right() - origin.x(),
+                           update_rect.bottom() - origin.y() };
+        bitmap.extractSubset(&update, subset);
+      }
+
+      if (!tile.get())
+        tile = compositor_->CreateTexture();
+      SkCanvas update_canvas(update);
+      tile->SetCanvas(update_canvas,
+                      update_rect.origin().Subtract(tile_rect.origin()),
+                      tile_rect.size());
+    }
+  }
+}
+
+void TiledTexture::Draw(const ui::TextureDrawParams& params,
+                        const gfx::Rect& clip_bounds_in_texture) {
+  gfx::Rect clip = clip_bounds_in_texture.Intersect(gfx::Rect(size_));
+  if (clip.IsEmpty())
+    return;
+
+  int first_column = clip.x() / kTileSize;
+  int last_column = (clip.right() - 1) / kTileSize;
+  int first_row = clip.y() / kTileSize;
+  int last_row = (clip.bottom() - 1) / kTileSize;
+  for (int row = first_row; row <= last_row; ++row) {
+    for (int column = first_column; column <= last_column; ++column) {
+      Texture* tile = tiles_[row * grid_size_.width() + column].get();
+      if (!tile)
+        continue;
+      gfx::Rect tile_rect = GetTileRect(size_, column, row);
+      gfx::Rect tile_clip = tile_rect.Intersect(clip);
+      tile_clip.Offset(-tile_rect.x(), -tile_rect.y());
+
+      ui::TextureDrawParams tile_params = params;
+      tile_params.transform.SetTranslate(static_cast<float>(tile_rect.x()),
+                                         static_cast<float>(tile_rect.y()));
+      tile_params.transform.ConcatTransform(params.transform);
+      tile_params.filter_texture_bounds.Offset(-tile_rect.x(), -tile_rect.y());
+      tile->Draw(tile_params, tile_clip);
+    }
+  }
+}
+
+TiledTexture::~TiledTexture() {
+}
+
+void TiledTexture::Reset(const gfx::Size& size) {
+  size_ = size;
+  grid_size_ = GetTileGridSize(size);
+  tiles_.clear();
+  tiles_.resize(grid_size_.width() * grid_size_.height());
+}
+
+}  // namespace ui
@@ -0,0 +1,72 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef UI_GFX_COMPOSITOR_TILED_TEXTURE_H_
+#define UI_GFX_COMPOSITOR_TILED_TEXTURE_H_
+#pragma once
+
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/memory/ref_counted.h"
+#include "ui/gfx/compositor/compositor.h"
+#include "ui/gfx/compositor/compositor_export.h"
+#include "ui/gfx/rect.h"
+#include "ui/gfx/size.h"
+
+namespace ui {
+
+// A Texture split into square tiles of kTileSize, each a Texture of the
+// compositor, for the layers too large for a single texture, such as the
+// contents of a tall scroll view. The tiles are created as the pixels of
+// their area are first set, so that the parts of the layer that were never
+// painted take no storage, and each SetCanvas() only uploads to the tiles it
+// covers. A tile is drawn only where the clip of Draw() reaches it.
+//
+// The tiles are dropped when the size of the layer changes.
+class COMPOSITOR_EXPORT TiledTexture : public Texture {
+ public:
+  // The width and height of the tiles.
+  static const int kTileSize;
+
+  explicit TiledTexture(Compositor* compositor);
+
+  // Returns the number of columns and rows of tiles of a layer of |size|.
+  static gfx::Size GetTileGridSize(const gfx::Size& size);
+
+  // Returns the bounds of the tile at |column| and |row|, within a layer of
+  // |size|. The tiles of the last column and row are cut to the layer.
+  static gfx::Rect GetTileRect(const gfx::Size& size, int column, int row);
+
+  // Texture:
+  virtual void SetCanvas(const SkCanvas& canvas,
+                         const gfx::Point& origin,
+                         const gfx::Size& overall_size) OVERRIDE;
+  virtual void Draw(const ui::TextureDrawParams& params,
+                    const gfx::Rect& clip_bounds_in_texture) OVERRIDE;
+
+ private:
+  virtual ~TiledTexture();
+
+  // Drops the tiles, and makes room for those of a layer of |size|.
+  void Reset(const gfx::Size& size);
+
+  Compositor* compositor_;
+
+  // The size of the layer.
+  gfx::Size size_;
+
+  // The number of columns and rows of tiles.
+  gfx::Size grid_size_;
+
+  // The tiles, by row, then column. NULL for the tiles never set.
+  std::vector<scoped_refptr<Texture> > tiles_;
+
+  DISALLOW_COPY_AND_ASSIGN(TiledTexture);
+};
+
+}  // namespace ui
+
+#endif  // UI_GFX_COMPOSITOR_TILED_TEXTURE_H_
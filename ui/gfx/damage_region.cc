@@ -0,0 +1,132 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/gfx/damage_region.h"
+
+#include "base/logging.h"
+#include "third_party/skia/include/core/SkCanvas.h"
+#include "third_party/skia/include/core/SkRegion.h"
+
+namespace {
+
+int64 Area(const gfx::Rect& rect) {
+  return static_cast<int64>(rect.width()) * rect.height();
+}
+
+// Returns the area of the union of |a| and |b| that neither covers.
+int64 WastedArea(const gfx::Rect& a, const gfx::Rect& b) {
+  return Area(a.Union(b)) - Area(a) - Area(b) + Area(a.Intersect(b));
+}
+
+// Two rectangles are merged, however many rectangles there are, when their
+// union wastes at most a quarter of the area they cover.
+bool IsWorthMerging(const gfx::Rect& a, const gfx::Rect& b) {
+  int64 covered = Area(a) + Area(b) - Area(a.Intersect(b));
+  return WastedArea(a, b) * 4 <= covered;
+}
+
+}  // namespace
+
+namespace gfx {
+
+DamageRegion::DamageRegion() : max_rects_(kDefaultMaxRects) {
+}
+
+DamageRegion::DamageRegion(size_t max_rects) : max_rects_(max_rects) {
+  DCHECK_GT(max_rects, 0u);
+}
+
+DamageRegion::~DamageRegion() {
+}
+
+void DamageRegion::Add(const Rect& rect) {
+  if (rect.IsEmpty())
+    return;
+  for (size_t i = 0; i < rects_.size(); ++i) {
+    if (rects_[i].Contains(rect))
+      return;
+  }
+  rects_.push_back(rect);
+  Simplify();
+}
+
+void DamageRegion::Clear() {
+  rects_.clear();
+}
+
+Rect DamageRegion::GetBounds() const {
+  Rect bounds;
+  for (size_t i = 0; i < rects_.size(); ++i)
+    bounds = bounds.Union(rects_[i]);
+  return bounds;
+}
+
+bool DamageRegion::Intersects(const Rect& rect) const {
+  for (size_t i = 0; i < rects_.size(); ++i) {
+    if (rects_[i].Intersects(rect))
+      return true;
+  }
+  return false;
+}
+
+bool DamageRegion::ClipCanvas(SkCanvas* canvas) const {
+  const SkMatrix& matrix = canvas->getTotalMatrix();
+  DCHECK(!(matrix.getType() & ~SkMatrix::kTranslate_Mask));
+  int dx = SkScalarRound(matrix.getTranslateX());
+  int dy = SkScalarRound(matrix.getTranslateY());
+
+  // clipRegion() takes device coordinates.
+  SkRegion region;
+  for (size_t i = 0; i < rects_.size(); ++i) {
+    const Rect& rect = rects_[i];
+    SkIRect device_rect;
+    device_rect.set(rect.x() + dx, rect.y() + dy,
+                    rect.right() + dx, rect.bottom() + dy);
+    region.op(device_rect, SkRegion::kUnion_Op);
+  }
+  return canvas->clipRegion(region);
+}
+
+void DamageRegion::Simplify() {
+  // The last rectangle is the new one: merge it, and then what it was merged
+  // into, with the rectangles worth merging with, and drop those it contains.
+  size_t current = rects_.size() - 1;
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    for (size_t i = 0; i < rects_.size(); ++i) {
+      if (i == current)
+        continue;
+      if (rects_[current].Contains(rects_[i]) ||
+          IsWorthMerging(rects_[current], rects_[i])) {
+        rects_[current] = rects_[current].Union(rects_[i]);
+        rects_.erase(rects_.begin() + i);
+        if (i < current)
+          current--;
+        merged = true;
+        break;
+      }
+    }
+  }
+
+  while (rects_.size() > max_rects_) {
+    size_t best_a = 0;
+    size_t best_b = 1;
+    int64 best_waste = WastedArea(rects_[0], rects_[1]);
+    for (size_t a = 0; a < rects_.size(); ++a) {
+      for (size_t b = a + 1; b < rects_.size(); ++b) {
+        int64 waste = WastedArea(rects_[a], rects_[b]);
+        if (waste < best_waste) {
+          best_a = a;
+          best_b = b;
+          best_waste = waste;
+        }
+      }
+    }
+    rects_[best_a] = rects_[best_a].Union(rects_[best_b]);
+    rects_.erase(rects_.begin() + best_b);
+  }
+}
+
+}  // namespace gfx
@@ -0,0 +1,65 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef UI_GFX_DAMAGE_REGION_H_
+#define UI_GFX_DAMAGE_REGION_H_
+#pragma once
+
+#include <vector>
+
+#include "base/basictypes.h"
+#include "ui/base/ui_export.h"
+#include "ui/gfx/rect.h"
+
+class SkCanvas;
+
+namespace gfx {
+
+// The area of a window that needs to be painted again, as a few rectangles.
+// Unlike the union of the invalidated rectangles, two small updates in
+// opposite corners of a window don't cover the rest of it. Rectangles are
+// merged when the union of two of them wastes little area, and otherwise only
+// when there are more than |max_rects|, so that painting the region stays
+// cheap.
+class UI_EXPORT DamageRegion {
+ public:
+  static const size_t kDefaultMaxRects = 8;
+
+  DamageRegion();
+  explicit DamageRegion(size_t max_rects);
+  ~DamageRegion();
+
+  // Adds |rect| to the region. Empty rectangles are ignored.
+  void Add(const Rect& rect);
+
+  void Clear();
+
+  bool IsEmpty() const { return rects_.empty(); }
+
+  // Returns the union of the rectangles of the region.
+  Rect GetBounds() const;
+
+  // Returns true if |rect| intersects one of the rectangles of the region.
+  bool Intersects(const Rect& rect) const;
+
+  // Intersects the clip of |canvas| with the region, whose coordinates are
+  // those of the current matrix of the canvas, which must be a translation.
+  // Views that don't intersect the region then skip painting, since
+  // View::Paint() clips to their bounds. Returns false if the clip is empty.
+  bool ClipCanvas(SkCanvas* canvas) const;
+
+  const std::vector<Rect>& rects() const { return rects_; }
+
+ private:
+  // Merges the rectangles that are worth merging, and then, while there are
+  // too many, those whose union wastes the least area.
+  void Simplify();
+
+  std::vector<Rect> rects_;
+  size_t max_rects_;
+};
+
+}  // namespace gfx
+
+#endif  // UI_GFX_DAMAGE_REGION_H_
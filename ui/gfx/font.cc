@@ -62,6 +62,11 @@ int Font::GetStringWidth(const string16& text) const {
   return platform_font_->GetStringWidth(text);
 }
 
+void Font::GetPrefixWidths(const string16& text,
+                           std::vector<int>* extents) const {
+  platform_font_->GetPrefixWidths(text, extents);
+}
+
 int Font::GetExpectedTextWidth(int length) const {
   return platform_font_->GetExpectedTextWidth(length);
 }
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "base/memory/ref_counted.h"
 #include "base/string16.h"
@@ -77,6 +78,12 @@ class UI_EXPORT Font {
   // string.
   int GetStringWidth(const string16& text) const;
 
+  // Sets |extents| to the widths of the prefixes of |text|, measured at once:
+  // the i-th is the width of the first i + 1 characters. Unlike
+  // GetStringWidth(), this doesn't account for the shaping of complex
+  // scripts.
+  void GetPrefixWidths(const string16& text, std::vector<int>* extents) const;
+
   // Returns the expected number of horizontal pixels needed to display the
   // specified length of characters. Call GetStringWidth() to retrieve the
   // actual number.
@@ -0,0 +1,782 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This program measures the performance of the image and drawing code of
+// ui/gfx: PNG and JPEG encoding and decoding, the SkBitmapOperations
+// (blending, masking, HSL shifting, tiling and downsampling), the color
+// analysis helpers, text drawing on a CanvasSkia, and the conversion of
+// points through the ui::Transforms of a tree of compositor layers.
+//
+// Every benchmark runs on a fixed corpus: the images are generated from
+// fixed seeds and the strings are constants, so runs on different changes
+// measure the same work. Each benchmark is run a few times to warm up the
+// caches, then timed over a number of trials of a number of iterations each.
+// The time of one iteration is reported as the minimum, median, mean and
+// maximum over the trials; the median is the number to compare across runs.
+//
+// The output is either a table, a CSV file or the "RESULT" lines understood
+// by the performance dashboards:
+//   RESULT <benchmark>: <input>= <median> us
+//
+// With -pak, the PNG images of a data pack, such as resources.pak, are also
+// decoded, all of them per iteration, the way ResourceBundle loads them.
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/basictypes.h"
+#include "base/command_line.h"
+#include "base/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/ref_counted_memory.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/string_number_conversions.h"
+#include "base/string_piece.h"
+#include "base/string_util.h"
+#include "base/time.h"
+#include "base/utf_string_conversions.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkColorPriv.h"
+#include "ui/base/resource/data_pack.h"
+#include "ui/gfx/canvas_skia.h"
+#include "ui/gfx/codec/jpeg_codec.h"
+#include "ui/gfx/codec/png_codec.h"
+#include "ui/gfx/color_analysis.h"
+#include "ui/gfx/color_utils.h"
+#include "ui/gfx/font.h"
+#include "ui/gfx/point.h"
+#include "ui/gfx/point3.h"
+#include "ui/gfx/size.h"
+#include "ui/gfx/skbitmap_operations.h"
+#include "ui/gfx/transform.h"
+
+namespace {
+
+// The results of each iteration are folded into this, so that the compiler
+// can not drop the work being measured.
+volatile uint32 g_sink = 0;
+
+// Deterministic pseudo-random numbers, so that the corpus is the same on
+// every run and every platform.
+class Random {
+ public:
+  explicit Random(uint32 seed) : state_(seed) {}
+
+  uint32 Next() {
+    state_ = state_ * 1103515245 + 12345;
+    return state_ >> 16;
+  }
+
+ private:
+  uint32 state_;
+};
+
+// An image of the corpus, with everything the benchmarks need prepared
+// ahead of time.
+struct CorpusImage {
+  std::string name;
+  SkBitmap bitmap;
+  // A different bitmap of the same size, to blend with |bitmap|.
+  SkBitmap other;
+  // An alpha mask of the same size.
+  SkBitmap mask;
+  std::vector<unsigned char> png;
+  std::vector<unsigned char> jpeg;
+  scoped_refptr<RefCountedBytes> png_memory;
+};
+
+struct CorpusText {
+  std::string name;
+  string16 text;
+};
+
+// The path from a leaf of a layer tree to its root: the transform of each
+// layer, followed by the translation to its origin in its parent.
+struct CorpusLayerTree {
+  std::string name;
+  std::vector<ui::Transform> layers;
+};
+
+// The PNG images of a data pack.
+struct CorpusPak {
+  std::string name;
+  std::vector<std::string> pngs;
+};
+
+struct Corpus {
+  std::vector<CorpusImage> images;
+  std::vector<CorpusText> texts;
+  std::vector<CorpusLayerTree> layer_trees;
+  std::vector<CorpusPak> paks;
+  gfx::Font font;
+};
+
+enum LayerKind {
+  // Only offset in its parent, like most of the layers of views.
+  LAYER_TRANSLATE,
+  // Scaled, as during a zoom animation.
+  LAYER_SCALE,
+  // Rotated, as during a screen rotation.
+  LAYER_ROTATE,
+};
+
+enum ImageKind {
+  // Smooth opaque gradient with a little noise, like a photograph.
+  IMAGE_PHOTO,
+  // Few flat colors with hard edges and transparency, like an icon or a
+  // screenshot of a page.
+  IMAGE_GRAPHIC,
+  // Opaque noise, the worst case for the codecs.
+  IMAGE_NOISE,
+};
+
+SkBitmap MakeBitmap(ImageKind kind, int width, int height, uint32 seed) {
+  SkBitmap bitmap;
+  bitmap.setConfig(SkBitmap::kARGB_8888_Config, width, height);
+  bitmap.allocPixels();
+  bitmap.setIsOpaque(kind != IMAGE_GRAPHIC);
+
+  Random random(seed);
+  SkAutoLockPixels lock(bitmap);
+  for (int y = 0; y < height; ++y) {
+    uint32* row = bitmap.getAddr32(0, y);
+    for (int x = 0; x < width; ++x) {
+      unsigned a = 255, r, g, b;
+      switch (kind) {
+        case IMAGE_PHOTO: {
+          int noise = static_cast<int>(random.Next() & 15) - 8;
+          r = std::max(0, std::min(255, x * 255 / width + noise));
+          g = std::max(0, std::min(255, y * 255 / height + noise));
+          b = std::max(0, std::min(255, (x + y) * 127 / (width + height) +
+                                        64 + noise));
+          break;
+        }
+        case IMAGE_GRAPHIC: {
+          int cell = ((x / 8) + (y / 8) * 3 + seed) % 4;
+          static const SkColor kColors[] = {
+            0x00000000, SK_ColorWHITE, 0xFF3366CC, 0x80CC3333,
+          };
+          SkColor color = kColors[cell];
+          a = SkColorGetA(color);
+          r = SkColorGetR(color);
+          g = SkColorGetG(color);
+          b = SkColorGetB(color);
+          break;
+        }
+        default:
+          r = random.Next() & 255;
+          g = random.Next() & 255;
+          b = random.Next() & 255;
+          break;
+      }
+      row[x] = SkPreMultiplyARGB(a, r, g, b);
+    }
+  }
+  return bitmap;
+}
+
+SkBitmap MakeMask(int width, int height) {
+  SkBitmap mask;
+  mask.setConfig(SkBitmap::kARGB_8888_Config, width, height);
+  mask.allocPixels();
+
+  SkAutoLockPixels lock(mask);
+  for (int y = 0; y < height; ++y) {
+    uint32* row = mask.getAddr32(0, y);
+    for (int x = 0; x < width; ++x) {
+      unsigned a = (x + y) * 255 / (width + height);
+      row[x] = SkPackARGB32(a, a, a, a);
+    }
+  }
+  return mask;
+}
+
+void AddImage(const char* name, ImageKind kind, int width, int height,
+              Corpus* corpus) {
+  corpus->images.push_back(CorpusImage());
+  CorpusImage& image = corpus->images.back();
+  image.name = name;
+  image.bitmap = MakeBitmap(kind, width, height, 1);
+  image.other = MakeBitmap(kind, width, height, 2);
+  image.mask = MakeMask(width, height);
+
+  gfx::PNGCodec::EncodeBGRASkBitmap(image.bitmap, false, &image.png);
+  image.png_memory = new RefCountedBytes(image.png);
+
+  SkAutoLockPixels lock(image.bitmap);
+  gfx::JPEGCodec::Encode(
+      reinterpret_cast<const unsigned char*>(image.bitmap.getPixels()),
+      gfx::JPEGCodec::FORMAT_SkBitmap, width, height,
+      static_cast<int>(image.bitmap.rowBytes()), 90, &image.jpeg);
+}
+
+void AddText(const char* name, const char* utf8, Corpus* corpus) {
+  CorpusText text;
+  text.name = name;
+  text.text = UTF8ToUTF16(utf8);
+  corpus->texts.push_back(text);
+}
+
+void AddLayerTree(const char* name, const LayerKind* kinds, size_t depth,
+                  Corpus* corpus) {
+  CorpusLayerTree tree;
+  tree.name = name;
+  for (size_t i = 0; i < depth; ++i) {
+    ui::Transform transform;
+    if (kinds[i] == LAYER_SCALE)
+      transform.SetScale(1.25f, 1.25f);
+    else if (kinds[i] == LAYER_ROTATE)
+      transform.SetRotate(30.0f);
+    transform.ConcatTranslate(10.0f + i, 20.0f + i);
+    tree.layers.push_back(transform);
+  }
+  corpus->layer_trees.push_back(tree);
+}
+
+void BuildCorpus(Corpus* corpus) {
+  AddImage("icon_32x32", IMAGE_GRAPHIC, 32, 32, corpus);
+  AddImage("graphic_256x256", IMAGE_GRAPHIC, 256, 256, corpus);
+  AddImage("thumbnail_212x132", IMAGE_PHOTO, 212, 132, corpus);
+  AddImage("photo_1024x768", IMAGE_PHOTO, 1024, 768, corpus);
+  AddImage("noise_512x512", IMAGE_NOISE, 512, 512, corpus);
+
+  AddText("label", "Bookmarks", corpus);
+  AddText("sentence",
+          "The quick brown fox jumps over the lazy dog, 0123456789 times.",
+          corpus);
+  AddText("paragraph",
+          "Lorem ipsum dolor sit amet, consectetur adipisicing elit, sed do "
+          "eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim "
+          "ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut "
+          "aliquip ex ea commodo consequat.", corpus);
+  AddText("mixed_scripts",
+          "Caf\xC3\xA9 \xD0\x9C\xD0\xBE\xD1\x81\xD0\xBA\xD0\xB2\xD0\xB0 "
+          "\xE6\x9D\xB1\xE4\xBA\xAC \xD7\xA9\xD7\x9C\xD7\x95\xD7\x9D",
+          corpus);
+
+  static const LayerKind kTranslated[] = {
+    LAYER_TRANSLATE, LAYER_TRANSLATE, LAYER_TRANSLATE, LAYER_TRANSLATE,
+    LAYER_TRANSLATE, LAYER_TRANSLATE, LAYER_TRANSLATE, LAYER_TRANSLATE,
+  };
+  static const LayerKind kScaled[] = {
+    LAYER_TRANSLATE, LAYER_TRANSLATE, LAYER_TRANSLATE, LAYER_SCALE,
+    LAYER_TRANSLATE, LAYER_TRANSLATE, LAYER_TRANSLATE, LAYER_TRANSLATE,
+  };
+  static const LayerKind kRotated[] = {
+    LAYER_TRANSLATE, LAYER_TRANSLATE, LAYER_TRANSLATE, LAYER_SCALE,
+    LAYER_TRANSLATE, LAYER_TRANSLATE, LAYER_TRANSLATE, LAYER_ROTATE,
+  };
+  AddLayerTree("translated_8", kTranslated, arraysize(kTranslated), corpus);
+  AddLayerTree("scaled_8", kScaled, arraysize(kScaled), corpus);
+  AddLayerTree("rotated_8", kRotated, arraysize(kRotated), corpus);
+}
+
+// Adds the PNG images of the data pack at |path|. Returns false if it can't
+// be loaded.
+bool AddPak(const FilePath& path, Corpus* corpus) {
+  ui::DataPack pack;
+  if (!pack.Load(path))
+    return false;
+
+  static const char kPNGSignature[] = "\x89PNG\r\n\x1A\n";
+  const size_t kSignatureSize = arraysize(kPNGSignature) - 1;
+  CorpusPak pak;
+  pak.name = path.BaseName().MaybeAsASCII();
+  std::vector<uint16> ids;
+  pack.GetResourceIds(&ids);
+  for (size_t i = 0; i < ids.size(); ++i) {
+    base::StringPiece data;
+    if (pack.GetStringPiece(ids[i], &data) && data.size() > kSignatureSize &&
+        data.starts_with(base::StringPiece(kPNGSignature, kSignatureSize)))
+      pak.pngs.push_back(data.as_string());
+  }
+  corpus->paks.push_back(pak);
+  return true;
+}
+
+// Benchmarks ------------------------------------------------------------------
+
+void ConsumeBitmap(const SkBitmap& bitmap) {
+  g_sink += bitmap.width() + bitmap.height();
+}
+
+void PNGEncode(const Corpus& corpus, size_t index) {
+  std::vector<unsigned char> png;
+  gfx::PNGCodec::EncodeBGRASkBitmap(corpus.images[index].bitmap, false, &png);
+  g_sink += png.size();
+}
+
+void PNGEncodeSpeed(const Corpus& corpus, size_t index) {
+  std::vector<unsigned char> png;
+  gfx::PNGCodec::EncodeBGRASkBitmapWithOptions(
+      corpus.images[index].bitmap, false,
+      gfx::PNGCodec::EncodeOptions(
+          gfx::PNGCodec::EncodeOptions::PROFILE_SPEED),
+      &png);
+  g_sink += png.size();
+}
+
+void PNGDecode(const Corpus& corpus, size_t index) {
+  const std::vector<unsigned char>& png = corpus.images[index].png;
+  SkBitmap bitmap;
+  gfx::PNGCodec::Decode(&png[0], png.size(), &bitmap);
+  ConsumeBitmap(bitmap);
+}
+
+void PakPNGDecode(const Corpus& corpus, size_t index) {
+  const std::vector<std::string>& pngs = corpus.paks[index].pngs;
+  for (size_t i = 0; i < pngs.size(); ++i) {
+    const unsigned char* png =
+        reinterpret_cast<const unsigned char*>(pngs[i].data());
+    SkBitmap bitmap;
+    gfx::PNGCodec::Decode(png, pngs[i].size(), &bitmap);
+    ConsumeBitmap(bitmap);
+  }
+}
+
+void JPEGEncode(const Corpus& corpus, size_t index) {
+  const SkBitmap& bitmap = corpus.images[index].bitmap;
+  SkAutoLockPixels lock(bitmap);
+  std::vector<unsigned char> jpeg;
+  gfx::JPEGCodec::Encode(
+      reinterpret_cast<const unsigned char*>(bitmap.getPixels()),
+      gfx::JPEGCodec::FORMAT_SkBitmap, bitmap.width(), bitmap.height(),
+      static_cast<int>(bitmap.rowBytes()), 90, &jpeg);
+  g_sink += jpeg.size();
+}
+
+void JPEGEncodeFast(const Corpus& corpus, size_t index) {
+  const SkBitmap& bitmap = corpus.images[index].bitmap;
+  SkAutoLockPixels lock(bitmap);
+  std::vector<unsigned char> jpeg;
+  gfx::JPEGCodec::Encode(
+      reinterpret_cast<const unsigned char*>(bitmap.getPixels()),
+      gfx::JPEGCodec::FORMAT_SkBitmap, bitmap.width(), bitmap.height(),
+      static_cast<int>(bitmap.rowBytes()), 90, gfx::JPEGCodec::ENCODE_FAST,
+      &jpeg);
+  g_sink += jpeg.size();
+}
+
+void JPEGDecode(const Corpus& corpus, size_t index) {
+  const std::vector<unsigned char>& jpeg = corpus.images[index].jpeg;
+  scoped_ptr<SkBitmap> bitmap(gfx::JPEGCodec::Decode(&jpeg[0], jpeg.size()));
+  if (bitmap.get())
+    ConsumeBitmap(*bitmap);
+}
+
+void JPEGDecodeThumbnail(const Corpus& corpus, size_t index) {
+  const CorpusImage& image = corpus.images[index];
+  const std::vector<unsigned char>& jpeg = image.jpeg;
+  // A quarter of the size of the image, which libjpeg can decode directly.
+  scoped_ptr<SkBitmap> bitmap(gfx::JPEGCodec::Decode(
+      &jpeg[0], jpeg.size(), image.bitmap.width() / 4,
+      image.bitmap.height() / 4));
+  if (bitmap.get())
+    ConsumeBitmap(*bitmap);
+}
+
+void Blend(const Corpus& corpus, size_t index) {
+  const CorpusImage& image = corpus.images[index];
+  ConsumeBitmap(SkBitmapOperations::CreateBlendedBitmap(image.bitmap,
+                                                        image.other, 0.3));
+}
+
+void Masked(const Corpus& corpus, size_t index) {
+  const CorpusImage& image = corpus.images[index];
+  ConsumeBitmap(SkBitmapOperations::CreateMaskedBitmap(image.bitmap,
+                                                       image.mask));
+}
+
+void ButtonBackground(const Corpus& corpus, size_t index) {
+  const CorpusImage& image = corpus.images[index];
+  ConsumeBitmap(SkBitmapOperations::CreateButtonBackground(
+      0xFF336699, image.other, image.mask));
+}
+
+void HSLShift(const Corpus& corpus, size_t index) {
+  const color_utils::HSL shift = { 0.6, 0.7, 0.4 };
+  // Measures the shift itself rather than the cache of shifted bitmaps.
+  SkBitmapOperations::ClearHSLShiftedBitmapCache();
+  ConsumeBitmap(SkBitmapOperations::CreateHSLShiftedBitmap(
+      corpus.images[index].bitmap, shift));
+}
+
+void Tiled(const Corpus& corpus, size_t index) {
+  const SkBitmap& bitmap = corpus.images[index].bitmap;
+  // Covers a 2x2 tiling of the image starting from its middle.
+  ConsumeBitmap(SkBitmapOperations::CreateTiledBitmap(
+      bitmap, bitmap.width() / 2, bitmap.height() / 2,
+      bitmap.width() * 2, bitmap.height() * 2));
+}
+
+void DownsampleByTwo(const Corpus& corpus, size_t index) {
+  ConsumeBitmap(SkBitmapOperations::DownsampleByTwo(
+      corpus.images[index].bitmap));
+}
+
+void LumaHistogram(const Corpus& corpus, size_t index) {
+  SkBitmap bitmap = corpus.images[index].bitmap;
+  int histogram[256] = { 0 };
+  color_utils::BuildLumaHistogram(&bitmap, histogram);
+  g_sink += histogram[128];
+}
+
+void KMeanColor(const Corpus& corpus, size_t index) {
+  // The grid sampler picks the same starting centroids on every run.
+  color_utils::GridSampler sampler;
+  g_sink += color_utils::CalculateKMeanColorOfPNG(
+      corpus.images[index].png_memory, 100, 665, sampler);
+}
+
+void DrawText(const Corpus& corpus, size_t index) {
+  gfx::CanvasSkia canvas(400, 100, true);
+  canvas.DrawStringInt(corpus.texts[index].text, corpus.font, SK_ColorBLACK,
+                       0, 0, 400, 100, gfx::Canvas::MULTI_LINE);
+  g_sink += canvas.getDevice()->width();
+}
+
+void DrawTextLine(const Corpus& corpus, size_t index) {
+  // A single line of LTR text takes the glyph cache path on Windows.
+  gfx::CanvasSkia canvas(400, 100, true);
+  canvas.DrawStringInt(corpus.texts[index].text, corpus.font, SK_ColorBLACK,
+                       0, 0, 400, 100, gfx::Canvas::NO_ELLIPSIS);
+  g_sink += canvas.getDevice()->width();
+}
+
+void SizeText(const Corpus& corpus, size_t index) {
+  int width = 400, height = 0;
+  gfx::CanvasSkia::SizeStringInt(corpus.texts[index].text, corpus.font,
+                                 &width, &height, gfx::Canvas::MULTI_LINE);
+  g_sink += width + height;
+}
+
+// The number of points each layer tree benchmark converts, as when the
+// events of a drag are routed to a layer.
+const int kLayerPoints = 1000;
+
+// Combines the transforms of a layer tree, leaf first.
+ui::Transform GetTransformToRoot(const CorpusLayerTree& tree) {
+  ui::Transform transform;
+  for (size_t i = 0; i < tree.layers.size(); ++i)
+    transform.ConcatTransform(tree.layers[i]);
+  return transform;
+}
+
+void ConvertPointToLayer(const Corpus& corpus, size_t index) {
+  // Combines the transforms for every point, as a tree walk does.
+  const CorpusLayerTree& tree = corpus.layer_trees[index];
+  for (int i = 0; i < kLayerPoints; ++i) {
+    gfx::Point3f point(gfx::Point(i % 640, i / 640));
+    GetTransformToRoot(tree).TransformPointReverse(point);
+    g_sink += point.AsPoint().x();
+  }
+}
+
+void ConvertPointToLayerCached(const Corpus& corpus, size_t index) {
+  // Combines and inverts the transforms once, as the cache of Layer does.
+  ui::Transform from_root;
+  GetTransformToRoot(corpus.layer_trees[index]).GetInverse(&from_root);
+  for (int i = 0; i < kLayerPoints; ++i) {
+    gfx::Point3f point(gfx::Point(i % 640, i / 640));
+    from_root.TransformPoint(point);
+    g_sink += point.AsPoint().x();
+  }
+}
+
+enum InputKind {
+  INPUT_IMAGES,
+  INPUT_TEXTS,
+  INPUT_LAYER_TREES,
+  INPUT_PAKS,
+};
+
+struct BenchmarkInfo {
+  const char* name;
+  InputKind input;
+  void (*run)(const Corpus& corpus, size_t index);
+};
+
+const BenchmarkInfo kBenchmarks[] = {
+  { "png_encode", INPUT_IMAGES, &PNGEncode },
+  { "png_encode_speed", INPUT_IMAGES, &PNGEncodeSpeed },
+  { "png_decode", INPUT_IMAGES, &PNGDecode },
+  { "pak_png_decode", INPUT_PAKS, &PakPNGDecode },
+  { "jpeg_encode", INPUT_IMAGES, &JPEGEncode },
+  { "jpeg_encode_fast", INPUT_IMAGES, &JPEGEncodeFast },
+  { "jpeg_decode", INPUT_IMAGES, &JPEGDecode },
+  { "jpeg_decode_thumbnail", INPUT_IMAGES, &JPEGDecodeThumbnail },
+  { "blend", INPUT_IMAGES, &Blend },
+  { "masked", INPUT_IMAGES, &Masked },
+  { "button_background", INPUT_IMAGES, &ButtonBackground },
+  { "hsl_shift", INPUT_IMAGES, &HSLShift },
+  { "tiled", INPUT_IMAGES, &Tiled },
+  { "downsample_by_two", INPUT_IMAGES, &DownsampleByTwo },
+  { "luma_histogram", INPUT_IMAGES, &LumaHistogram },
+  { "kmean_color", INPUT_IMAGES, &KMeanColor },
+  { "draw_text", INPUT_TEXTS, &DrawText },
+  { "draw_text_line", INPUT_TEXTS, &DrawTextLine },
+  { "size_text", INPUT_TEXTS, &SizeText },
+  { "convert_point", INPUT_LAYER_TREES, &ConvertPointToLayer },
+  { "convert_point_cached", INPUT_LAYER_TREES, &ConvertPointToLayerCached },
+};
+
+// Runner ----------------------------------------------------------------------
+
+enum OutputFormat {
+  OUTPUT_TEXT,
+  OUTPUT_CSV,
+  OUTPUT_PERF,
+};
+
+// Microseconds per iteration, over all trials.
+struct Timing {
+  double min_us;
+  double median_us;
+  double mean_us;
+  double max_us;
+};
+
+class BenchmarkRunner {
+ public:
+  static const int kDefaultWarmup;
+  static const int kDefaultTrials;
+  static const int kDefaultIterations;
+
+  BenchmarkRunner()
+      : warmup_(kDefaultWarmup),
+        trials_(kDefaultTrials),
+        iterations_(kDefaultIterations),
+        format_(OUTPUT_TEXT) {}
+
+  // Returns true if command line parsing was successful, false otherwise.
+  bool ParseArgs(const CommandLine* command_line);
+
+  // Runs all the benchmarks whose name contains the filter, and prints their
+  // results.
+  void Run(const Corpus& corpus) const;
+
+  static void Usage();
+
+  // The data pack given with -pak, or empty.
+  const FilePath& pak_path() const { return pak_path_; }
+
+ private:
+  Timing Measure(const BenchmarkInfo& info, const Corpus& corpus,
+                 size_t index) const;
+  void PrintHeader() const;
+  void PrintResult(const BenchmarkInfo& info, const std::string& input,
+                   const Timing& timing) const;
+
+  int warmup_;
+  int trials_;
+  int iterations_;
+  OutputFormat format_;
+  std::string filter_;
+  FilePath pak_path_;
+};
+
+// static
+const int BenchmarkRunner::kDefaultWarmup = 2;
+const int BenchmarkRunner::kDefaultTrials = 5;
+const int BenchmarkRunner::kDefaultIterations = 10;
+
+void BenchmarkRunner::Usage() {
+  printf("gfx_bench [-filter f] [-warmup w] [-trials t] [-iterations i] "
+         "[-format text|csv|perf] [-pak file] [-help]\n"
+         "  -filter f: only run the benchmarks whose name contains f\n"
+         "  -warmup w: untimed iterations before the trials (default:%d)\n"
+         "  -trials t: number of timed trials (default:%d)\n"
+         "  -iterations i: iterations per trial (default:%d)\n"
+         "  -format: output a table, CSV or RESULT lines (default:text)\n"
+         "  -pak file: also decode the PNG images of the data pack file\n"
+         "  -help: prints this help and exits\n"
+         "Benchmarks:",
+         kDefaultWarmup, kDefaultTrials, kDefaultIterations);
+  for (size_t i = 0; i < arraysize(kBenchmarks); ++i)
+    printf(" %s", kBenchmarks[i].name);
+  printf("\n");
+}
+
+bool BenchmarkRunner::ParseArgs(const CommandLine* command_line) {
+  const CommandLine::SwitchMap& switches = command_line->GetSwitches();
+  bool need_help = false;
+
+  for (CommandLine::SwitchMap::const_iterator iter = switches.begin();
+       iter != switches.end();
+       ++iter) {
+    const std::string& s = iter->first;
+    std::string value;
+#if defined(OS_WIN)
+    value = WideToUTF8(iter->second);
+#else
+    value = iter->second;
+#endif
+    if (s == "filter") {
+      filter_ = value;
+    } else if (s == "warmup") {
+      if (!base::StringToInt(value, &warmup_) || warmup_ < 0)
+        need_help = true;
+    } else if (s == "trials") {
+      if (!base::StringToInt(value, &trials_) || trials_ <= 0)
+        need_help = true;
+    } else if (s == "iterations") {
+      if (!base::StringToInt(value, &iterations_) || iterations_ <= 0)
+        need_help = true;
+    } else if (s == "format") {
+      if (value == "text") {
+        format_ = OUTPUT_TEXT;
+      } else if (value == "csv") {
+        format_ = OUTPUT_CSV;
+      } else if (value == "perf") {
+        format_ = OUTPUT_PERF;
+      } else {
+        printf("Invalid format '%s' specified\n", value.c_str());
+        need_help = true;
+      }
+    } else if (s == "pak") {
+      pak_path_ = FilePath(iter->second);
+      if (pak_path_.empty())
+        need_help = true;
+    } else {
+      need_help = true;
+    }
+  }
+  return !need_help;
+}
+
+Timing BenchmarkRunner::Measure(const BenchmarkInfo& info,
+                                const Corpus& corpus,
+                                size_t index) const {
+  for (int i = 0; i < warmup_; ++i)
+    info.run(corpus, index);
+
+  std::vector<double> trial_us(trials_);
+  for (int trial = 0; trial < trials_; ++trial) {
+    const base::TimeTicks start = base::TimeTicks::HighResNow();
+    for (int i = 0; i < iterations_; ++i)
+      info.run(corpus, index);
+    const base::TimeDelta elapsed = base::TimeTicks::HighResNow() - start;
+    trial_us[trial] = static_cast<double>(elapsed.InMicroseconds()) /
+        iterations_;
+  }
+
+  std::sort(trial_us.begin(), trial_us.end());
+  Timing timing;
+  timing.min_us = trial_us.front();
+  timing.max_us = trial_us.back();
+  timing.median_us = (trial_us[(trials_ - 1) / 2] + trial_us[trials_ / 2]) / 2;
+  double total_us = 0;
+  for (int trial = 0; trial < trials_; ++trial)
+    total_us += trial_us[trial];
+  timing.mean_us = total_us / trials_;
+  return timing;
+}
+
+void BenchmarkRunner::PrintHeader() const {
+  if (format_ == OUTPUT_TEXT) {
+    printf("%-18s %-18s %12s %12s %12s %12s\n", "benchmark", "input",
+           "min_us", "median_us", "mean_us", "max_us");
+  } else if (format_ == OUTPUT_CSV) {
+    printf("benchmark,input,warmup,trials,iterations,"
+           "min_us,median_us,mean_us,max_us\n");
+  }
+}
+
+void BenchmarkRunner::PrintResult(const BenchmarkInfo& info,
+                                  const std::string& input,
+                                  const Timing& timing) const {
+  switch (format_) {
+    case OUTPUT_TEXT:
+      printf("%-18s %-18s %12.1f %12.1f %12.1f %12.1f\n", info.name,
+             input.c_str(), timing.min_us, timing.median_us, timing.mean_us,
+             timing.max_us);
+      break;
+    case OUTPUT_CSV:
+      printf("%s,%s,%d,%d,%d,%.1f,%.1f,%.1f,%.1f\n", info.name, input.c_str(),
+             warmup_, trials_, iterations_, timing.min_us, timing.median_us,
+             timing.mean_us, timing.max_us);
+      break;
+    case OUTPUT_PERF:
+      printf("RESULT %s: %s= %.1f us\n", info.name, input.c_str(),
+             timing.median_us);
+      break;
+  }
+  fflush(stdout);
+}
+
+void BenchmarkRunner::Run(const Corpus& corpus) const {
+  PrintHeader();
+  for (size_t i = 0; i < arraysize(kBenchmarks); ++i) {
+    const BenchmarkInfo& info = kBenchmarks[i];
+    if (!filter_.empty() &&
+        std::string(info.name).find(filter_) == std::string::npos)
+      continue;
+
+    size_t num_inputs = 0;
+    if (info.input == INPUT_IMAGES)
+      num_inputs = corpus.images.size();
+    else if (info.input == INPUT_TEXTS)
+      num_inputs = corpus.texts.size();
+    else if (info.input == INPUT_LAYER_TREES)
+      num_inputs = corpus.layer_trees.size();
+    else
+      num_inputs = corpus.paks.size();
+    for (size_t index = 0; index < num_inputs; ++index) {
+      std::string input;
+      if (info.input == INPUT_IMAGES)
+        input = corpus.images[index].name;
+      else if (info.input == INPUT_TEXTS)
+        input = corpus.texts[index].name;
+      else if (info.input == INPUT_LAYER_TREES)
+        input = corpus.layer_trees[index].name;
+      else
+        input = corpus.paks[index].name;
+      PrintResult(info, input, Measure(info, corpus, index));
+    }
+  }
+}
+
+// A small class to automatically call Reset on the global command line to
+// avoid nasty valgrind complaints for the leak of the global command line.
+class CommandLineAutoReset {
+ public:
+  CommandLineAutoReset(int argc, char** argv) {
+    CommandLine::Init(argc, argv);
+  }
+  ~CommandLineAutoReset() {
+    CommandLine::Reset();
+  }
+
+  const CommandLine* Get() const {
+    return CommandLine::ForCurrentProcess();
+  }
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  // For the caches of the benchmarked operations, which are LazyInstances.
+  base::AtExitManager at_exit_manager;
+  BenchmarkRunner runner;
+  CommandLineAutoReset command_line(argc, argv);
+
+  if (!runner.ParseArgs(command_line.Get())) {
+    BenchmarkRunner::Usage();
+    return 1;
+  }
+
+  Corpus corpus;
+  BuildCorpus(&corpus);
+  if (!runner.pak_path().empty() && !AddPak(runner.pak_path(), &corpus)) {
+    printf("Can't load the data pack %s\n",
+           runner.pak_path().MaybeAsASCII().c_str());
+    return 1;
+  }
+  runner.Run(corpus);
+  return 0;
+}
@@ -0,0 +1,304 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/gfx/glyph_cache_win.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "third_party/skia/include/core/SkColorPriv.h"
+#include "ui/gfx/color_utils.h"
+#include "ui/gfx/gdi_util.h"
+
+namespace {
+
+// The atlas is this wide, and grows in height, by doubling, up to
+// kMaxAtlasHeight. The UI fonts of a dialog take a few shelves each.
+const int kAtlasWidth = 256;
+const int kInitialAtlasHeight = 32;
+const int kMaxAtlasHeight = 512;
+
+// GetGlyphIndices() gives this for the characters the font doesn't have.
+const WORD kMissingGlyph = 0xffff;
+
+// Returns true for the characters that are drawn with a glyph of their own,
+// one after the other: Latin, without the combining marks and the controls.
+// The soft hyphen isn't, since DrawText() only draws it at line breaks.
+bool IsSimpleCharacter(wchar_t c) {
+  return (c >= 0x20 && c < 0x7f) || (c >= 0xa0 && c < 0x250 && c != 0xad);
+}
+
+// Returns |background| covered by |text| in |coverage| / 255 of the pixel.
+inline int BlendChannel(int text, int background, int coverage) {
+  return (text * coverage + background * (255 - coverage) + 127) / 255;
+}
+
+}  // namespace
+
+namespace gfx {
+
+GlyphCache::Run::Run() : width(0), dark(true) {
+}
+
+GlyphCache::Run::~Run() {
+}
+
+GlyphCache::GlyphCache(HFONT font)
+    : font_(font),
+      height_(0),
+      ascent_(0),
+      glyph_padding_(0),
+      dc_(NULL),
+      old_font_(NULL),
+      shelf_x_(0),
+      shelf_y_(0),
+      shelf_height_(0),
+      reset_count_(0) {
+  TEXTMETRIC metrics;
+  GetTextMetrics(GetFontDC(), &metrics);
+  height_ = metrics.tmHeight;
+  ascent_ = metrics.tmAscent;
+  glyph_padding_ = std::max(2, static_cast<int>(metrics.tmHeight) / 4);
+}
+
+GlyphCache::~GlyphCache() {
+  if (dc_) {
+    SelectObject(dc_, old_font_);
+    DeleteDC(dc_);
+  }
+}
+
+bool GlyphCache::LayoutString(const string16& text, SkColor color, Run* run) {
+  run->dark = color_utils::GetLuminanceForColor(color) < 128;
+  // Rasterizing a glyph may reset the atlas, dropping those of the run that
+  // came before it. Since the run then fits in the atlas alone, it is laid out
+  // once more.
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    int reset_count = reset_count_;
+    run->glyphs.clear();
+    run->width = 0;
+    for (size_t i = 0; i < text.length(); ++i) {
+      if (!IsSimpleCharacter(text[i]))
+        return false;
+      int glyph = GetGlyph(text[i], run->dark);
+      if (glyph < 0)
+        return false;
+      run->glyphs.push_back(glyph);
+      run->width += glyphs_[glyph].advance;
+    }
+    if (reset_count == reset_count_)
+      return true;
+  }
+  return false;
+}
+
+void GlyphCache::DrawRun(const Run& run,
+                         SkColor color,
+                         int x,
+                         int baseline,
+                         const SkIRect& clip,
+                         SkBitmap* bitmap) {
+  DCHECK_EQ(SkBitmap::kARGB_8888_Config, bitmap->config());
+  DCHECK(clip.isEmpty() ||
+         (clip.fLeft >= 0 && clip.fTop >= 0 &&
+          clip.fRight <= bitmap->width() && clip.fBottom <= bitmap->height()));
+  if (clip.isEmpty() || run.glyphs.empty())
+    return;
+
+  SkAutoLockPixels bitmap_lock(*bitmap);
+  SkAutoLockPixels atlas_lock(atlas_);
+  const int text_r = SkColorGetR(color);
+  const int text_g = SkColorGetG(color);
+  const int text_b = SkColorGetB(color);
+  int pen_x = x;
+  for (size_t i = 0; i < run.glyphs.size(); ++i) {
+    const Glyph& glyph = glyphs_[run.glyphs[i]];
+    SkIRect dest;
+    dest.setXYWH(pen_x + glyph.left, baseline + glyph.top,
+                 glyph.bounds.width(), glyph.bounds.height());
+    pen_x += glyph.advance;
+    SkIRect visible = dest;
+    if (glyph.bounds.isEmpty() || !visible.intersect(clip))
+      continue;
+
+    for (int y = visible.fTop; y < visible.fBottom; ++y) {
+      const uint32_t* mask = atlas_.getAddr32(
+          glyph.bounds.fLeft + visible.fLeft - dest.fLeft,
+          glyph.bounds.fTop + y - dest.fTop);
+      uint32_t* pixel = bitmap->getAddr32(visible.fLeft, y);
+      for (int j = 0; j < visible.width(); ++j) {
+        if (!SkGetPackedA32(mask[j]))
+          continue;
+        pixel[j] = SkPackARGB32(
+            0xff,
+            BlendChannel(text_r, SkGetPackedR32(pixel[j]),
+                         SkGetPackedR32(mask[j])),
+            BlendChannel(text_g, SkGetPackedG32(pixel[j]),
+                         SkGetPackedG32(mask[j])),
+            BlendChannel(text_b, SkGetPackedB32(pixel[j]),
+                         SkGetPackedB32(mask[j])));
+      }
+    }
+  }
+}
+
+int GlyphCache::GetGlyph(wchar_t c, bool dark) {
+  std::map<wchar_t, WORD>::iterator index = glyph_indices_.find(c);
+  if (index == glyph_indices_.end()) {
+    WORD glyph_index;
+    if (GetGlyphIndices(GetFontDC(), &c, 1, &glyph_index,
+                        GGI_MARK_NONEXISTING_GLYPHS) == GDI_ERROR) {
+      glyph_index = kMissingGlyph;
+    }
+    index = glyph_indices_.insert(std::make_pair(c, glyph_index)).first;
+  }
+  if (index->second == kMissingGlyph)
+    return -1;
+
+  GlyphKey key(index->second, dark);
+  std::map<GlyphKey, int>::const_iterator i = glyph_map_.find(key);
+  if (i != glyph_map_.end())
+    return i->second;
+
+  Glyph glyph;
+  if (!RasterizeGlyph(index->second, dark, &glyph))
+    return -1;
+  glyphs_.push_back(glyph);
+  int glyph_id = static_cast<int>(glyphs_.size()) - 1;
+  glyph_map_[key] = glyph_id;
+  return glyph_id;
+}
+
+bool GlyphCache::RasterizeGlyph(WORD glyph_index, bool dark, Glyph* glyph) {
+  HDC dc = GetFontDC();
+  // Only fonts with glyph outlines have ABC widths.
+  ABC abc;
+  if (!GetCharABCWidthsI(dc, glyph_index, 1, NULL, &abc))
+    return false;
+  glyph->advance = abc.abcA + abc.abcB + abc.abcC;
+
+  // GDI draws the glyph in a cell of its own, the black box of which starts
+  // |glyph_padding_| in.
+  const int cell_width = static_cast<int>(abc.abcB) + 2 * glyph_padding_;
+  const int cell_height = height_ + 2 * glyph_padding_;
+  const int origin_x = glyph_padding_ - abc.abcA;
+  BITMAPINFOHEADER header;
+  gfx::CreateBitmapHeader(cell_width, cell_height, &header);
+  void* bits = NULL;
+  HBITMAP cell = CreateDIBSection(dc, reinterpret_cast<BITMAPINFO*>(&header),
+                                  DIB_RGB_COLORS, &bits, NULL, 0);
+  if (!cell)
+    return false;
+  HGDIOBJ old_bitmap = SelectObject(dc, cell);
+
+  // Dark text is drawn black on white, and light text white on black.
+  uint32_t* cell_pixels = static_cast<uint32_t*>(bits);
+  std::fill(cell_pixels, cell_pixels + cell_width * cell_height,
+            dark ? 0x00ffffff : 0);
+  SetBkMode(dc, TRANSPARENT);
+  SetTextAlign(dc, TA_TOP | TA_LEFT);
+  SetTextColor(dc, dark ? RGB(0, 0, 0) : RGB(255, 255, 255));
+  ExtTextOut(dc, origin_x, glyph_padding_, ETO_GLYPH_INDEX, NULL,
+             reinterpret_cast<const wchar_t*>(&glyph_index), 1, NULL);
+  GdiFlush();
+
+  // The coverage of the channels, in the cell.
+  const uint32_t invert = dark ? 0x00ffffff : 0;
+  SkIRect bounds;
+  bounds.setEmpty();
+  for (int y = 0; y < cell_height; ++y) {
+    for (int x = 0; x < cell_width; ++x) {
+      uint32_t& pixel = cell_pixels[y * cell_width + x];
+      pixel = (pixel ^ invert) & 0x00ffffff;
+      if (!pixel)
+        continue;
+      SkIRect pixel_bounds;
+      pixel_bounds.setXYWH(x, y, 1, 1);
+      bounds.join(pixel_bounds);
+    }
+  }
+
+  bool result = true;
+  glyph->left = 0;
+  glyph->top = 0;
+  glyph->bounds.setEmpty();
+  if (!bounds.isEmpty()) {
+    if (AllocateAtlasRect(bounds.width(), bounds.height(), &glyph->bounds)) {
+      glyph->left = bounds.fLeft - origin_x;
+      glyph->top = bounds.fTop - glyph_padding_ - ascent_;
+      SkAutoLockPixels atlas_lock(atlas_);
+      for (int y = 0; y < bounds.height(); ++y) {
+        const uint32_t* coverage =
+            cell_pixels + (bounds.fTop + y) * cell_width + bounds.fLeft;
+        uint32_t* mask = atlas_.getAddr32(glyph->bounds.fLeft,
+                                          glyph->bounds.fTop + y);
+        for (int x = 0; x < bounds.width(); ++x) {
+          int r = (coverage[x] >> 16) & 0xff;
+          int g = (coverage[x] >> 8) & 0xff;
+          int b = coverage[x] & 0xff;
+          mask[x] = SkPackARGB32(std::max(r, std::max(g, b)), r, g, b);
+        }
+      }
+    } else {
+      result = false;
+    }
+  }
+
+  SelectObject(dc, old_bitmap);
+  DeleteObject(cell);
+  return result;
+}
+
+bool GlyphCache::AllocateAtlasRect(int width, int height, SkIRect* rect) {
+  if (width > kAtlasWidth || height > kMaxAtlasHeight)
+    return false;
+
+  if (shelf_x_ + width > kAtlasWidth) {
+    shelf_y_ += shelf_height_;
+    shelf_x_ = 0;
+    shelf_height_ = 0;
+  }
+  if (shelf_y_ + height > kMaxAtlasHeight)
+    Reset();
+  if (shelf_y_ + height > atlas_.height()) {
+    int atlas_height = std::max(atlas_.height(), kInitialAtlasHeight);
+    while (atlas_height < shelf_y_ + height)
+      atlas_height *= 2;
+    SkBitmap atlas;
+    atlas.setConfig(SkBitmap::kARGB_8888_Config, kAtlasWidth,
+                    std::min(atlas_height, kMaxAtlasHeight));
+    atlas.allocPixels();
+    atlas.eraseARGB(0, 0, 0, 0);
+    if (!atlas_.isNull()) {
+      SkAutoLockPixels atlas_lock(atlas_);
+      SkAutoLockPixels grown_lock(atlas);
+      memcpy(atlas.getPixels(), atlas_.getPixels(), atlas_.getSize());
+    }
+    atlas_ = atlas;
+  }
+
+  rect->setXYWH(shelf_x_, shelf_y_, width, height);
+  shelf_x_ += width;
+  shelf_height_ = std::max(shelf_height_, height);
+  return true;
+}
+
+void GlyphCache::Reset() {
+  glyph_map_.clear();
+  glyphs_.clear();
+  shelf_x_ = 0;
+  shelf_y_ = 0;
+  shelf_height_ = 0;
+  ++reset_count_;
+}
+
+HDC GlyphCache::GetFontDC() {
+  if (!dc_) {
+    dc_ = CreateCompatibleDC(NULL);
+    old_font_ = SelectObject(dc_, font_);
+  }
+  return dc_;
+}
+
+}  // namespace gfx
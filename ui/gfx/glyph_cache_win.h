@@ -0,0 +1,144 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef UI_GFX_GLYPH_CACHE_WIN_H_
+#define UI_GFX_GLYPH_CACHE_WIN_H_
+#pragma once
+
+#include <windows.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/string16.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkColor.h"
+#include "third_party/skia/include/core/SkRect.h"
+
+namespace gfx {
+
+// The glyphs of a font, rasterized by GDI once and kept in an atlas, so that
+// single lines of text can be drawn into a bitmap without going through GDI.
+// The glyphs are rasterized as coverage masks, one per color channel, so
+// that they keep the ClearType filtering GDI gives them. Since what GDI
+// gives depends on the contrast of the text with its background, dark and
+// light text have masks of their own.
+//
+// Only the simple scripts, those without shaping or combining marks, are laid
+// out; DrawText() must be used for the others. The HFontRef of the font owns
+// its cache, which is only used on the UI thread.
+class GlyphCache {
+ public:
+  // The font is not owned, and must outlive the cache.
+  explicit GlyphCache(HFONT font);
+  ~GlyphCache();
+
+  // The glyphs of a string laid out on a line.
+  struct Run {
+    Run();
+    ~Run();
+
+    // Indices of the glyphs in the cache.
+    std::vector<int> glyphs;
+
+    // The sum of the advances of the glyphs.
+    int width;
+
+    // Whether the run is to be drawn dark on light, or light on dark.
+    bool dark;
+  };
+
+  // Lays |text| out on one line, to be drawn in |color|, rasterizing the
+  // glyphs that weren't yet. Returns false if it can't, because of the
+  // script of the text, or because the font doesn't have all of its glyphs
+  // (DrawText() would then link another font).
+  bool LayoutString(const string16& text, SkColor color, Run* run);
+
+  // Blends the glyphs of |run| in |color| into |bitmap|, whose pixels must be
+  // opaque, the pen starting at |x| on the |baseline|. Only the pixels within
+  // |clip| are touched. |run| must have been laid out since the last glyph
+  // was added to the cache.
+  void DrawRun(const Run& run,
+               SkColor color,
+               int x,
+               int baseline,
+               const SkIRect& clip,
+               SkBitmap* bitmap);
+
+  int height() const { return height_; }
+  int ascent() const { return ascent_; }
+
+ private:
+  struct Glyph {
+    // The pen moves this much after the glyph.
+    int advance;
+
+    // The rasterized glyph in |atlas_|, empty for blank glyphs, and where its
+    // top left is relative to the pen on the baseline.
+    SkIRect bounds;
+    int left;
+    int top;
+  };
+
+  // Returns the index in |glyphs_| of the glyph of |c|, rasterizing it if
+  // needed, or -1 if the font doesn't have it.
+  int GetGlyph(wchar_t c, bool dark);
+
+  // Rasterizes the glyph of |glyph_index| into the atlas. Returns false if
+  // GDI fails.
+  bool RasterizeGlyph(WORD glyph_index, bool dark, Glyph* glyph);
+
+  // Finds room for a |width| by |height| glyph in the atlas, growing it, or
+  // calling Reset() when it can't grow anymore. Returns false if the glyph
+  // is larger than the atlas can be.
+  bool AllocateAtlasRect(int width, int height, SkIRect* rect);
+
+  // Drops all the glyphs, when the atlas is full. Runs laid out before then
+  // must be laid out again.
+  void Reset();
+
+  // Returns a DC with the font selected in it, created as needed.
+  HDC GetFontDC();
+
+  HFONT font_;
+  int height_;
+  int ascent_;
+
+  // Pixels of room every rasterized glyph is given around its black box,
+  // for what GDI draws outside of it (ClearType filtering, italics).
+  int glyph_padding_;
+
+  // Created by GetFontDC(), and deleted with the cache.
+  HDC dc_;
+  HGDIOBJ old_font_;
+
+  // The glyph indices of the characters, in the font. 0xffff for missing
+  // glyphs.
+  std::map<wchar_t, WORD> glyph_indices_;
+
+  // The index of each glyph in |glyphs_|, by glyph index and whether it is
+  // dark.
+  typedef std::pair<WORD, bool> GlyphKey;
+  std::map<GlyphKey, int> glyph_map_;
+  std::vector<Glyph> glyphs_;
+
+  // The rasterized glyphs. Each channel of a pixel is the coverage of that
+  // color channel, and alpha their maximum. The glyphs are packed in shelves,
+  // the last of which starts at |shelf_y_|.
+  SkBitmap atlas_;
+  int shelf_x_;
+  int shelf_y_;
+  int shelf_height_;
+
+  // The number of times Reset() was called.
+  int reset_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(GlyphCache);
+};
+
+}  // namespace gfx
+
+#endif  // UI_GFX_GLYPH_CACHE_WIN_H_
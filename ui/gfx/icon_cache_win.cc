@@ -0,0 +1,217 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/gfx/icon_cache_win.h"
+
+#include <objbase.h>
+#include <shellapi.h>
+
+#include <algorithm>
+
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/singleton.h"
+#include "base/message_loop_proxy.h"
+#include "base/threading/worker_pool.h"
+#include "ui/gfx/icon_util.h"
+#include "ui/gfx/size.h"
+
+namespace {
+
+// The most files whose icons one worker task extracts. Each batch of icons
+// is converted through one DIB section, and replied to the UI thread in one
+// task.
+const size_t kIconsPerBatch = 64;
+
+gfx::Size GetIconSize(IconCache::IconSize size) {
+  if (size == IconCache::SMALL) {
+    return gfx::Size(::GetSystemMetrics(SM_CXSMICON),
+                     ::GetSystemMetrics(SM_CYSMICON));
+  }
+  return gfx::Size(::GetSystemMetrics(SM_CXICON),
+                   ::GetSystemMetrics(SM_CYICON));
+}
+
+UINT GetShellIconFlag(IconCache::IconSize size) {
+  return size == IconCache::SMALL ? SHGFI_SMALLICON : SHGFI_LARGEICON;
+}
+
+}  // namespace
+
+// Extracts the icons of some files on a worker thread. The icons the cache
+// already has when the batch starts are only looked up, not extracted.
+class IconCache::Batch : public base::RefCountedThreadSafe<Batch> {
+ public:
+  Batch(const std::vector<FilePath>& paths,
+        IconSize size,
+        const std::set<int>& known_indices,
+        int generation)
+      : paths_(paths),
+        size_(size),
+        known_indices_(known_indices),
+        generation_(generation),
+        origin_loop_(base::MessageLoopProxy::current()) {
+  }
+
+  // Runs on a worker thread, then replies with |callback| on the thread the
+  // batch was created on.
+  void Load(const base::Closure& callback) {
+    // SHGetFileInfo() needs COM on the thread.
+    HRESULT hr = ::CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+
+    UINT size_flag = GetShellIconFlag(size_);
+    std::vector<HICON> icons;
+    std::vector<int> icon_indices;
+    indices_.resize(paths_.size(), -1);
+    for (size_t i = 0; i < paths_.size(); ++i) {
+      // Looking up the index in the system image list is much cheaper than
+      // extracting the icon, which the files of a type share.
+      SHFILEINFO info = {0};
+      if (!::SHGetFileInfo(paths_[i].value().c_str(), 0, &info, sizeof(info),
+                           SHGFI_SYSICONINDEX | size_flag))
+        continue;
+      indices_[i] = info.iIcon;
+      if (known_indices_.count(info.iIcon) ||
+          std::find(icon_indices.begin(), icon_indices.end(), info.iIcon) !=
+              icon_indices.end())
+        continue;
+      if (!::SHGetFileInfo(paths_[i].value().c_str(), 0, &info, sizeof(info),
+                           SHGFI_ICON | size_flag) || !info.hIcon)
+        continue;
+      icons.push_back(info.hIcon);
+      icon_indices.push_back(indices_[i]);
+    }
+
+    std::vector<SkBitmap> bitmaps;
+    IconUtil::CreateSkBitmapsFromHICONs(icons, GetIconSize(size_), &bitmaps);
+    for (size_t i = 0; i < icons.size(); ++i) {
+      ::DestroyIcon(icons[i]);
+      if (!bitmaps[i].empty())
+        new_icons_[icon_indices[i]] = bitmaps[i];
+    }
+
+    if (SUCCEEDED(hr))
+      ::CoUninitialize();
+    origin_loop_->PostTask(FROM_HERE, callback);
+  }
+
+  const std::vector<FilePath>& paths() const { return paths_; }
+  IconSize size() const { return size_; }
+  int generation() const { return generation_; }
+
+  // The index in the system image list of the icon of each path, or -1 if
+  // the shell doesn't know the file.
+  const std::vector<int>& indices() const { return indices_; }
+
+  // The icons the batch extracted, by index.
+  const std::map<int, SkBitmap>& new_icons() const { return new_icons_; }
+
+ private:
+  friend class base::RefCountedThreadSafe<Batch>;
+
+  ~Batch() {}
+
+  const std::vector<FilePath> paths_;
+  const IconSize size_;
+  const std::set<int> known_indices_;
+  const int generation_;
+  const scoped_refptr<base::MessageLoopProxy> origin_loop_;
+  std::vector<int> indices_;
+  std::map<int, SkBitmap> new_icons_;
+
+  DISALLOW_COPY_AND_ASSIGN(Batch);
+};
+
+// static
+IconCache* IconCache::GetInstance() {
+  return Singleton<IconCache>::get();
+}
+
+const SkBitmap* IconCache::GetIcon(const FilePath& path,
+                                   IconSize size) const {
+  std::map<PathKey, int>::const_iterator index =
+      icon_indices_.find(PathKey(path, size));
+  if (index == icon_indices_.end())
+    return NULL;
+  std::map<IconKey, SkBitmap>::const_iterator icon =
+      icons_.find(IconKey(index->second, size));
+  return icon == icons_.end() ? NULL : &icon->second;
+}
+
+void IconCache::LoadIcons(const std::vector<FilePath>& paths,
+                          IconSize size,
+                          const IconsLoadedCallback& callback) {
+  std::set<int> known_indices;
+  for (std::map<IconKey, SkBitmap>::const_iterator i = icons_.begin();
+       i != icons_.end(); ++i) {
+    if (i->first.second == size)
+      known_indices.insert(i->first.first);
+  }
+
+  std::vector<FilePath> batch_paths;
+  for (size_t i = 0; i < paths.size(); ++i) {
+    PathKey key(paths[i], size);
+    if (icon_indices_.count(key) || !pending_.insert(key).second)
+      continue;
+    batch_paths.push_back(paths[i]);
+    if (batch_paths.size() == kIconsPerBatch) {
+      StartBatch(batch_paths, size, known_indices, callback);
+      batch_paths.clear();
+    }
+  }
+  if (!batch_paths.empty())
+    StartBatch(batch_paths, size, known_indices, callback);
+}
+
+void IconCache::Clear() {
+  icon_indices_.clear();
+  icons_.clear();
+  pending_.clear();
+  ++generation_;
+}
+
+IconCache::IconCache() : generation_(0) {
+}
+
+IconCache::~IconCache() {
+}
+
+void IconCache::StartBatch(const std::vector<FilePath>& paths,
+                           IconSize size,
+                           const std::set<int>& known_indices,
+                           const IconsLoadedCallback& callback) {
+  scoped_refptr<Batch> batch(
+      new Batch(paths, size, known_indices, generation_));
+  // Slow, since the shell may go to the disk, or the network.
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&Batch::Load, batch,
+                 base::Bind(&IconCache::OnBatchLoaded, base::Unretained(this),
+                            batch, callback)),
+      true);
+}
+
+void IconCache::OnBatchLoaded(Batch* batch,
+                              const IconsLoadedCallback& callback) {
+  if (batch->generation() != generation_)
+    return;
+
+  const std::map<int, SkBitmap>& new_icons = batch->new_icons();
+  for (std::map<int, SkBitmap>::const_iterator i = new_icons.begin();
+       i != new_icons.end(); ++i)
+    icons_[IconKey(i->first, batch->size())] = i->second;
+
+  std::vector<FilePath> loaded;
+  for (size_t i = 0; i < batch->paths().size(); ++i) {
+    PathKey key(batch->paths()[i], batch->size());
+    pending_.erase(key);
+    int index = batch->indices()[i];
+    if (index < 0 || !icons_.count(IconKey(index, batch->size())))
+      continue;
+    icon_indices_[key] = index;
+    loaded.push_back(batch->paths()[i]);
+  }
+  callback.Run(loaded);
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef UI_GFX_ICON_CACHE_WIN_H_
+#define UI_GFX_ICON_CACHE_WIN_H_
+#pragma once
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/file_path.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "ui/base/ui_export.h"
+
+template <typename T> struct DefaultSingletonTraits;
+
+// The shell icons of files, as SkBitmaps. The icons are extracted with
+// SHGetFileInfo() on base::WorkerPool threads, and converted in batches by
+// IconUtil::CreateSkBitmapsFromHICONs(), so that listing a folder of
+// thousands of files doesn't extract their icons on the UI thread. The
+// bitmaps are kept by their index in the system image list, which the files
+// of a type share, so each icon is converted only once.
+//
+// The cache is used on the UI thread only.
+class UI_EXPORT IconCache {
+ public:
+  enum IconSize {
+    SMALL,  // SM_CXSMICON by SM_CYSMICON, as in lists.
+    LARGE,  // SM_CXICON by SM_CYICON.
+  };
+
+  // Receives the paths whose icons were loaded by a batch.
+  typedef base::Callback<void(const std::vector<FilePath>&)>
+      IconsLoadedCallback;
+
+  static IconCache* GetInstance();
+
+  // Returns the icon of |path| at |size|, or NULL if it isn't loaded. The
+  // bitmap stays valid until Clear().
+  const SkBitmap* GetIcon(const FilePath& path, IconSize size) const;
+
+  // Loads the icons at |size| of the |paths| that aren't loaded or loading,
+  // on worker threads. |callback| is run on the calling thread, which must
+  // have a MessageLoop, once per batch, with the paths whose icons the batch
+  // loaded; it isn't run for the paths that were already loaded. Returns
+  // immediately.
+  void LoadIcons(const std::vector<FilePath>& paths,
+                 IconSize size,
+                 const IconsLoadedCallback& callback);
+
+  // Drops the loaded icons, for when the shell icons change. The batches
+  // still loading are dropped when they come back.
+  void Clear();
+
+ private:
+  friend struct DefaultSingletonTraits<IconCache>;
+  class Batch;
+
+  // The index of an icon in the system image list, and its size.
+  typedef std::pair<int, IconSize> IconKey;
+
+  // A file, and the size of its icon.
+  typedef std::pair<FilePath, IconSize> PathKey;
+
+  IconCache();
+  ~IconCache();
+
+  // Posts the loading of the icons of |paths| to a worker thread. The icons
+  // of |known_indices| are already loaded.
+  void StartBatch(const std::vector<FilePath>& paths,
+                  IconSize size,
+                  const std::set<int>& known_indices,
+                  const IconsLoadedCallback& callback);
+
+  // Takes in the icons a batch loaded, unless Clear() was called since it
+  // started, and runs its callback.
+  void OnBatchLoaded(Batch* batch, const IconsLoadedCallback& callback);
+
+  // The index of the icon of each file whose icon is loaded.
+  std::map<PathKey, int> icon_indices_;
+
+  // The loaded icons.
+  std::map<IconKey, SkBitmap> icons_;
+
+  // The files whose icons are loading.
+  std::set<PathKey> pending_;
+
+  // Incremented by Clear(), so that the batches started before are dropped.
+  int generation_;
+
+  DISALLOW_COPY_AND_ASSIGN(IconCache);
+};
+
+#endif  // UI_GFX_ICON_CACHE_WIN_H_
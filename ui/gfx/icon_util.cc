@@ -12,6 +12,23 @@
 #include "third_party/skia/include/core/SkBitmap.h"
 #include "ui/gfx/size.h"
 
+namespace {
+
+// Returns true if |icon| is an icon, rather than a cursor or a bad handle.
+bool IsValidIcon(HICON icon) {
+  ICONINFO icon_info;
+  if (!icon || !::GetIconInfo(icon, &icon_info))
+    return false;
+  // GetIconInfo() gives out copies of the masks, which are ours to delete.
+  if (icon_info.hbmMask)
+    ::DeleteObject(icon_info.hbmMask);
+  if (icon_info.hbmColor)
+    ::DeleteObject(icon_info.hbmColor);
+  return icon_info.fIcon != FALSE;
+}
+
+}  // namespace
+
 // Defining the dimensions for the icon images. We store only one value because
 // we always resize to a square image; that is, the value 48 means that we are
 // going to resize the given bitmap to a 48 by 48 pixels bitmap.
@@ -102,9 +119,7 @@ HICON IconUtil::CreateHICONFromSkBitmap(const SkBitmap& bitmap) {
 
 SkBitmap* IconUtil::CreateSkBitmapFromHICON(HICON icon, const gfx::Size& s) {
   // We start with validating parameters.
-  ICONINFO icon_info;
-  if (!icon || !(::GetIconInfo(icon, &icon_info)) ||
-      !icon_info.fIcon || s.IsEmpty())
+  if (!IsValidIcon(icon) || s.IsEmpty())
     return NULL;
 
   // Allocating memory for the SkBitmap object. We are going to create an ARGB
@@ -113,8 +128,6 @@ SkBitmap* IconUtil::CreateSkBitmapFromHICON(HICON icon, const gfx::Size& s) {
   DCHECK(bitmap);
   bitmap->setConfig(SkBitmap::kARGB_8888_Config, s.width(), s.height());
   bitmap->allocPixels();
-  bitmap->eraseARGB(0, 0, 0, 0);
-  SkAutoLockPixels bitmap_lock(*bitmap);
 
   // Now we should create a DIB so that we can use ::DrawIconEx in order to
   // obtain the icon's image.
@@ -127,63 +140,51 @@ SkBitmap* IconUtil::CreateSkBitmapFromHICON(HICON icon, const gfx::Size& s) {
   DCHECK(dib);
   HDC dib_dc = CreateCompatibleDC(dc);
   DCHECK(dib_dc);
-  ::SelectObject(dib_dc, dib);
+  HGDIOBJ old_dib = ::SelectObject(dib_dc, dib);
 
-  // Windows icons are defined using two different masks. The XOR mask, which
-  // represents the icon image and an AND mask which is a monochrome bitmap
-  // which indicates the transparency of each pixel.
-  //
-  // To make things more complex, the icon image itself can be an ARGB bitmap
-  // and therefore contain an alpha channel which specifies the transparency
-  // for each pixel. Unfortunately, there is no easy way to determine whether
-  // or not a bitmap has an alpha channel and therefore constructing the bitmap
-  // for the icon is nothing but straightforward.
-  //
-  // The idea is to read the AND mask but use it only if we know for sure that
-  // the icon image does not have an alpha channel. The only way to tell if the
-  // bitmap has an alpha channel is by looking through the pixels and checking
-  // whether there are non-zero alpha bytes.
-  //
-  // We start by drawing the AND mask into our DIB.
-  size_t num_pixels = s.GetArea();
-  memset(bits, 0, num_pixels * 4);
-  ::DrawIconEx(dib_dc, 0, 0, icon, s.width(), s.height(), 0, NULL, DI_MASK);
+  DrawIconIntoSkBitmap(icon, s, dib_dc, bits, bitmap);
 
-  // Capture boolean opacity. We may not use it if we find out the bitmap has
-  // an alpha channel.
-  bool* opaque = new bool[num_pixels];
-  DCHECK(opaque);
-  for (size_t i = 0; i < num_pixels; ++i)
-    opaque[i] = !bits[i];
+  ::SelectObject(dib_dc, old_dib);
+  ::DeleteDC(dib_dc);
+  ::DeleteObject(dib);
+  ::ReleaseDC(NULL, dc);
 
-  // Then draw the image itself which is really the XOR mask.
-  memset(bits, 0, num_pixels * 4);
-  ::DrawIconEx(dib_dc, 0, 0, icon, s.width(), s.height(), 0, NULL, DI_NORMAL);
-  memcpy(bitmap->getPixels(), static_cast<void*>(bits), num_pixels * 4);
+  return bitmap;
+}
 
-  // Finding out whether the bitmap has an alpha channel.
-  bool bitmap_has_alpha_channel = PixelsHaveAlpha(
-      static_cast<const uint32*>(bitmap->getPixels()), num_pixels);
+void IconUtil::CreateSkBitmapsFromHICONs(const std::vector<HICON>& icons,
+                                         const gfx::Size& s,
+                                         std::vector<SkBitmap>* bitmaps) {
+  DCHECK(bitmaps);
+  bitmaps->clear();
+  bitmaps->resize(icons.size());
+  if (icons.empty() || s.IsEmpty())
+    return;
 
-  // If the bitmap does not have an alpha channel, we need to build it using
-  // the previously captured AND mask. Otherwise, we are done.
-  if (!bitmap_has_alpha_channel) {
-    uint32* p = static_cast<uint32*>(bitmap->getPixels());
-    for (size_t i = 0; i < num_pixels; ++p, ++i) {
-      DCHECK_EQ((*p & 0xff000000), 0u);
-      if (opaque[i])
-        *p |= 0xff000000;
-      else
-        *p &= 0x00ffffff;
+  // One DIB, and DC to draw into it, serve all the icons.
+  BITMAPV5HEADER h;
+  InitializeBitmapHeader(&h, s.width(), s.height());
+  HDC dc = ::GetDC(NULL);
+  uint32* bits;
+  HBITMAP dib = ::CreateDIBSection(dc, reinterpret_cast<BITMAPINFO*>(&h),
+      DIB_RGB_COLORS, reinterpret_cast<void**>(&bits), NULL, 0);
+  HDC dib_dc = dib ? CreateCompatibleDC(dc) : NULL;
+  if (dib_dc) {
+    HGDIOBJ old_dib = ::SelectObject(dib_dc, dib);
+    for (size_t i = 0; i < icons.size(); ++i) {
+      if (!IsValidIcon(icons[i]))
+        continue;
+      SkBitmap& bitmap = (*bitmaps)[i];
+      bitmap.setConfig(SkBitmap::kARGB_8888_Config, s.width(), s.height());
+      bitmap.allocPixels();
+      DrawIconIntoSkBitmap(icons[i], s, dib_dc, bits, &bitmap);
     }
+    ::SelectObject(dib_dc, old_dib);
+    ::DeleteDC(dib_dc);
   }
-
-  delete [] opaque;
-  ::DeleteDC(dib_dc);
-  ::DeleteObject(dib);
+  if (dib)
+    ::DeleteObject(dib);
   ::ReleaseDC(NULL, dc);
-
-  return bitmap;
 }
 
 bool IconUtil::CreateIconFileFromSkBitmap(const SkBitmap& bitmap,
@@ -264,6 +265,48 @@ bool IconUtil::PixelsHaveAlpha(const uint32* pixels, size_t num_pixels) {
   return false;
 }
 
+void IconUtil::DrawIconIntoSkBitmap(HICON icon, const gfx::Size& s,
+                                    HDC dib_dc, uint32* bits,
+                                    SkBitmap* bitmap) {
+  SkAutoLockPixels bitmap_lock(*bitmap);
+
+  // Windows icons are defined using two different masks. The XOR mask, which
+  // represents the icon image and an AND mask which is a monochrome bitmap
+  // which indicates the transparency of each pixel.
+  //
+  // To make things more complex, the icon image itself can be an ARGB bitmap
+  // and therefore contain an alpha channel which specifies the transparency
+  // for each pixel. Unfortunately, there is no easy way to determine whether
+  // or not a bitmap has an alpha channel and therefore constructing the bitmap
+  // for the icon is nothing but straightforward.
+  //
+  // The idea is to draw the image itself, which is really the XOR mask, and
+  // to look through the pixels for non-zero alpha bytes. Only if there are
+  // none do we need the AND mask, which most icons these days don't, so it is
+  // only drawn then.
+  size_t num_pixels = s.GetArea();
+  memset(bits, 0, num_pixels * 4);
+  ::DrawIconEx(dib_dc, 0, 0, icon, s.width(), s.height(), 0, NULL, DI_NORMAL);
+  ::GdiFlush();
+  memcpy(bitmap->getPixels(), bits, num_pixels * 4);
+  if (PixelsHaveAlpha(bits, num_pixels))
+    return;
+
+  // The bitmap does not have an alpha channel, so we build it using the AND
+  // mask, drawn into the DIB now that the image is saved in |bitmap|.
+  memset(bits, 0, num_pixels * 4);
+  ::DrawIconEx(dib_dc, 0, 0, icon, s.width(), s.height(), 0, NULL, DI_MASK);
+  ::GdiFlush();
+  uint32* p = static_cast<uint32*>(bitmap->getPixels());
+  for (size_t i = 0; i < num_pixels; ++p, ++i) {
+    DCHECK_EQ((*p & 0xff000000), 0u);
+    if (!bits[i])
+      *p |= 0xff000000;
+    else
+      *p &= 0x00ffffff;
+  }
+}
+
 void IconUtil::InitializeBitmapHeader(BITMAPV5HEADER* header, int width,
                                       int height) {
   DCHECK(header);
@@ -71,6 +71,15 @@ class UI_EXPORT IconUtil {
   // it when it is no longer needed.
   static SkBitmap* CreateSkBitmapFromHICON(HICON icon, const gfx::Size& s);
 
+  // Like CreateSkBitmapFromHICON(), for several icons of the same size at
+  // once: sets |bitmaps| to the conversions of |icons|, in the same order,
+  // leaving empty the bitmaps of the icons that can't be converted. The icons
+  // are all drawn through one DIB section, which is cheaper than converting
+  // them one by one.
+  static void CreateSkBitmapsFromHICONs(const std::vector<HICON>& icons,
+                                        const gfx::Size& s,
+                                        std::vector<SkBitmap>* bitmaps);
+
   // Given an initialized SkBitmap object and a file name, this function
   // creates a .ico file with the given name using the provided bitmap. The
   // icon file is created with multiple icon images of varying predefined
@@ -132,6 +141,12 @@ class UI_EXPORT IconUtil {
   // Returns true if any pixel in the given pixels buffer has an non-zero alpha.
   static bool PixelsHaveAlpha(const uint32* pixels, size_t num_pixels);
 
+  // Draws |icon| into |bitmap|, an allocated ARGB bitmap of size |s|, through
+  // |dib_dc|, which must have a top-down 32 bpp DIB section of that size,
+  // whose pixels are |bits|, selected into it.
+  static void DrawIconIntoSkBitmap(HICON icon, const gfx::Size& s, HDC dib_dc,
+                                   uint32* bits, SkBitmap* bitmap);
+
   // A helper function that initializes a BITMAPV5HEADER structure with a set
   // of values.
   static void InitializeBitmapHeader(BITMAPV5HEADER* header, int width,
@@ -5,10 +5,14 @@
 #include "ui/gfx/image/image.h"
 
 #include <algorithm>
+#include <list>
 
+#include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/stl_util.h"
+#include "base/synchronization/lock.h"
 #include "third_party/skia/include/core/SkBitmap.h"
+#include "ui/gfx/size.h"
 
 #if defined(TOOLKIT_USES_GTK)
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -43,6 +47,108 @@ const SkBitmap* GdkPixbufToSkBitmap(GdkPixbuf* pixbuf) {
 class ImageRepSkia;
 class ImageRepGdk;
 class ImageRepCocoa;
+class ImageStorage;
+
+// The most bytes the resized bitmaps of GetResizedSkBitmap() take.
+const size_t kMaxResizedBitmapBytes = 8 * 1024 * 1024;
+
+// The resized bitmaps of all the Images, which are dropped least recently
+// used first past kMaxResizedBitmapBytes.
+class ResizedBitmapCache {
+ public:
+  ResizedBitmapCache() : bytes_(0) {}
+
+  // Sets |bitmap| to the bitmap of |storage| resized to |size| with |method|,
+  // and returns true, if it is cached.
+  bool Get(const ImageStorage* storage, const gfx::Size& size,
+           skia::ImageOperations::ResizeMethod method, SkBitmap* bitmap) {
+    base::AutoLock lock(lock_);
+    IndexMap::iterator found = index_.find(Key(storage, size, method));
+    if (found == index_.end())
+      return false;
+    entries_.splice(entries_.begin(), entries_, found->second);
+    *bitmap = found->second->second;
+    return true;
+  }
+
+  void Put(const ImageStorage* storage, const gfx::Size& size,
+           skia::ImageOperations::ResizeMethod method,
+           const SkBitmap& bitmap) {
+    size_t bytes = bitmap.getSize();
+    if (bytes > kMaxResizedBitmapBytes)
+      return;
+    base::AutoLock lock(lock_);
+    Key key(storage, size, method);
+    if (index_.count(key))
+      return;
+    entries_.push_front(std::make_pair(key, bitmap));
+    index_[key] = entries_.begin();
+    bytes_ += bytes;
+    while (bytes_ > kMaxResizedBitmapBytes) {
+      bytes_ -= entries_.back().second.getSize();
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+  }
+
+  // Drops the bitmaps of |storage|, which is being deleted.
+  void Remove(const ImageStorage* storage) {
+    base::AutoLock lock(lock_);
+    const Key first(storage, gfx::Size(),
+                    skia::ImageOperations::RESIZE_FIRST_QUALITY_METHOD);
+    IndexMap::iterator i = index_.lower_bound(first);
+    while (i != index_.end() && i->first.storage == storage) {
+      bytes_ -= i->second->second.getSize();
+      entries_.erase(i->second);
+      index_.erase(i++);
+    }
+  }
+
+ private:
+  struct Key {
+    Key(const ImageStorage* storage, const gfx::Size& size,
+        skia::ImageOperations::ResizeMethod method)
+        : storage(storage),
+          width(size.width()),
+          height(size.height()),
+          method(method) {
+    }
+
+    bool operator<(const Key& other) const {
+      if (storage != other.storage)
+        return storage < other.storage;
+      if (width != other.width)
+        return width < other.width;
+      if (height != other.height)
+        return height < other.height;
+      return method < other.method;
+    }
+
+    const ImageStorage* storage;
+    int width;
+    int height;
+    skia::ImageOperations::ResizeMethod method;
+  };
+
+  // Most recently used first.
+  typedef std::list<std::pair<Key, SkBitmap> > EntryList;
+  typedef std::map<Key, EntryList::iterator> IndexMap;
+
+  // Images are mostly used on the UI thread, but the ResourceBundle loads
+  // them on others too.
+  base::Lock lock_;
+
+  EntryList entries_;
+  IndexMap index_;
+  size_t bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(ResizedBitmapCache);
+};
+
+// Leaky, since Images may be deleted at exit, after the AtExitManager.
+base::LazyInstance<ResizedBitmapCache,
+                   base::LeakyLazyInstanceTraits<ResizedBitmapCache> >
+    g_resized_bitmap_cache(base::LINKER_INITIALIZED);
 
 // An ImageRep is the object that holds the backing memory for an Image. Each
 // RepresentationType has an ImageRep subclass that is responsible for freeing
@@ -164,7 +270,8 @@ class ImageRepCocoa : public ImageRep {
 class ImageStorage : public base::RefCounted<ImageStorage> {
  public:
   ImageStorage(gfx::Image::RepresentationType default_type)
-      : default_representation_type_(default_type) {
+      : default_representation_type_(default_type),
+        has_resized_bitmaps_(false) {
   }
 
   gfx::Image::RepresentationType default_representation_type() {
@@ -172,8 +279,12 @@ class ImageStorage : public base::RefCounted<ImageStorage> {
   }
   gfx::Image::RepresentationMap& representations() { return representations_; }
 
+  void set_has_resized_bitmaps() { has_resized_bitmaps_ = true; }
+
  private:
   ~ImageStorage() {
+    if (has_resized_bitmaps_)
+      g_resized_bitmap_cache.Get().Remove(this);
     for (gfx::Image::RepresentationMap::iterator it = representations_.begin();
          it != representations_.end();
          ++it) {
@@ -190,6 +301,9 @@ class ImageStorage : public base::RefCounted<ImageStorage> {
   // more for any converted representations.
   gfx::Image::RepresentationMap representations_;
 
+  // Whether the ResizedBitmapCache may have bitmaps of this Image.
+  bool has_resized_bitmaps_;
+
   friend class base::RefCounted<ImageStorage>;
 };
 
@@ -293,6 +407,44 @@ Image::operator NSImage*() const {
 }
 #endif
 
+SkBitmap Image::GetResizedSkBitmap(
+    const gfx::Size& size,
+    skia::ImageOperations::ResizeMethod method) const {
+  if (size.IsEmpty())
+    return SkBitmap();
+  const std::vector<const SkBitmap*>& bitmaps =
+      GetRepresentation(Image::kImageRepSkia)->AsImageRepSkia()->bitmaps();
+  const SkBitmap* source = NULL;
+  const SkBitmap* biggest = bitmaps[0];
+  for (size_t i = 0; i < bitmaps.size(); ++i) {
+    const SkBitmap* bitmap = bitmaps[i];
+    if (bitmap->width() * bitmap->height() >
+        biggest->width() * biggest->height()) {
+      biggest = bitmap;
+    }
+    if (bitmap->width() >= size.width() && bitmap->height() >= size.height() &&
+        (!source ||
+         bitmap->width() * bitmap->height() <
+             source->width() * source->height())) {
+      source = bitmap;
+    }
+  }
+  if (!source)
+    source = biggest;
+  if (source->width() == size.width() && source->height() == size.height())
+    return *source;
+
+  internal::ResizedBitmapCache& cache = internal::g_resized_bitmap_cache.Get();
+  SkBitmap resized;
+  if (cache.Get(storage_.get(), size, method, &resized))
+    return resized;
+  resized = skia::ImageOperations::Resize(*source, method, size.width(),
+                                          size.height());
+  storage_->set_has_resized_bitmaps();
+  cache.Put(storage_.get(), size, method, resized);
+  return resized;
+}
+
 bool Image::HasRepresentation(RepresentationType type) const {
   return storage_->representations().count(type) != 0;
 }
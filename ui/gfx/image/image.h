@@ -23,6 +23,7 @@
 #include "base/basictypes.h"
 #include "base/gtest_prod_util.h"
 #include "base/memory/ref_counted.h"
+#include "skia/ext/image_operations.h"
 #include "ui/base/ui_export.h"
 #include "ui/gfx/native_widget_types.h"
 
@@ -35,6 +36,8 @@ class ImageMacTest;
 
 namespace gfx {
 
+class Size;
+
 namespace internal {
 class ImageRep;
 class ImageStorage;
@@ -122,6 +125,15 @@ class UI_EXPORT Image {
   // guaranteed.
   const SkBitmap* GetSkBitmapAtIndex(size_t index) const;
 
+  // Returns the Skia representation resized to |size| with |method|, from its
+  // smallest bitmap that is at least as big, or else its biggest. The resized
+  // bitmaps of all the Images are cached, up to a global budget, so that
+  // drawing an Image at the same size again doesn't resize it again. The
+  // pixels of the result are shared with the cache and must not be modified.
+  SkBitmap GetResizedSkBitmap(
+      const gfx::Size& size,
+      skia::ImageOperations::ResizeMethod method) const;
+
   // Inspects the representations map to see if the given type exists.
   bool HasRepresentation(RepresentationType type) const;
 
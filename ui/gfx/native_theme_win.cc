@@ -9,6 +9,8 @@
 #include <vsstyle.h>
 #include <vssym32.h>
 
+#include <algorithm>
+
 #include "base/logging.h"
 #include "base/memory/scoped_handle.h"
 #include "base/memory/scoped_ptr.h"
@@ -25,6 +27,12 @@
 
 namespace {
 
+// Parts larger than this are painted directly; they are rarely repeated.
+const int kMaxCachedPartPixels = 256 * 64;
+
+// The cache is dropped when its renderings reach this size.
+const size_t kMaxPartCacheBytes = 4 * 1024 * 1024;
+
 void SetCheckerboardShader(SkPaint* paint, const RECT& align_rect) {
   // Create a 2x2 checkerboard pattern using the 3D face and highlight colors.
   SkColor face = skia::COLORREFToSkColor(GetSysColor(COLOR_3DFACE));
@@ -80,7 +88,8 @@ NativeThemeWin::NativeThemeWin()
       close_theme_(NULL),
       set_theme_properties_(NULL),
       is_theme_active_(NULL),
-      get_theme_int_(NULL) {
+      get_theme_int_(NULL),
+      part_cache_bytes_(0) {
   if (theme_dll_) {
     draw_theme_ = reinterpret_cast<DrawThemeBackgroundPtr>(
         GetProcAddress(theme_dll_, "DrawThemeBackground"));
@@ -155,9 +164,9 @@ void NativeThemeWin::PaintToNonPlatformCanvas(SkCanvas* canvas,
                                               const gfx::Rect& rect,
                                               const ExtraParams& extra) const {
   // TODO(asvitkine): This path is pretty inefficient - for each paint operation
-  //                  it creates a new offscreen bitmap Skia canvas. This can
-  //                  be sped up by doing it only once per part/state and
-  //                  keeping a cache of the resulting bitmaps.
+  //                  it creates a new offscreen bitmap Skia canvas. Paint()
+  //                  only gets here for the parts GetPartCacheKey() doesn't
+  //                  cache.
 
   // Create an offscreen canvas that is backed by an HDC.
   scoped_ptr<SkCanvas> offscreen_canvas(
@@ -181,7 +190,8 @@ void NativeThemeWin::PaintToNonPlatformCanvas(SkCanvas* canvas,
   adjusted_extra.progress_bar.value_rect_x = 0;
   adjusted_extra.progress_bar.value_rect_y = 0;
   // Draw the theme controls using existing HDC-drawing code.
-  Paint(offscreen_canvas.get(), part, state, adjusted_rect, adjusted_extra);
+  PaintDirect(offscreen_canvas.get(), part, state, adjusted_rect,
+              adjusted_extra);
 
   // Copy the pixels to a bitmap that has ref-counted pixel storage, which is
   // necessary to have when drawing to a SkPicture.
@@ -215,12 +225,33 @@ void NativeThemeWin::Paint(SkCanvas* canvas,
                            State state,
                            const gfx::Rect& rect,
                            const ExtraParams& extra) const {
+  if (rect.IsEmpty())
+    return;
+
+  PartCacheKey key;
+  if (GetPartCacheKey(part, state, rect, extra, &key)) {
+    const SkBitmap* bitmap = GetCachedPart(key, part, state, extra);
+    if (bitmap) {
+      canvas->drawBitmap(*bitmap, SkIntToScalar(rect.x()),
+                         SkIntToScalar(rect.y()));
+      return;
+    }
+  }
+
   if (!skia::SupportsPlatformPaint(canvas)) {
     // This block will only get hit with --enable-accelerated-drawing flag.
     PaintToNonPlatformCanvas(canvas, part, state, rect, extra);
     return;
   }
 
+  PaintDirect(canvas, part, state, rect, extra);
+}
+
+void NativeThemeWin::PaintDirect(SkCanvas* canvas,
+                                 Part part,
+                                 State state,
+                                 const gfx::Rect& rect,
+                                 const ExtraParams& extra) const {
   skia::ScopedPlatformPaint scoped_platform_paint(canvas);
   HDC hdc = scoped_platform_paint.GetPlatformSurface();
 
@@ -304,6 +335,153 @@ void NativeThemeWin::Paint(SkCanvas* canvas,
   }
 }
 
+bool NativeThemeWin::PartCacheKey::operator<(
+    const PartCacheKey& other) const {
+  if (part != other.part)
+    return part < other.part;
+  if (state != other.state)
+    return state < other.state;
+  if (width != other.width)
+    return width < other.width;
+  if (height != other.height)
+    return height < other.height;
+  return std::lexicographical_compare(extra, extra + arraysize(extra),
+                                      other.extra,
+                                      other.extra + arraysize(other.extra));
+}
+
+// static
+bool NativeThemeWin::GetPartCacheKey(Part part,
+                                     State state,
+                                     const gfx::Rect& rect,
+                                     const ExtraParams& extra,
+                                     PartCacheKey* key) {
+  if (rect.width() * rect.height() > kMaxCachedPartPixels)
+    return false;
+
+  memset(key, 0, sizeof(*key));
+  key->part = part;
+  key->state = state;
+  key->width = rect.width();
+  key->height = rect.height();
+
+  // Only the members the part is painted with are copied, as the others may
+  // not be initialized.
+  switch (part) {
+    case kCheckbox:
+    case kRadio:
+    case kPushButton:
+      key->extra[0] = extra.button.checked;
+      key->extra[1] = extra.button.indeterminate;
+      key->extra[2] = extra.button.is_default;
+      key->extra[3] = extra.button.has_border;
+      key->extra[4] = extra.button.classic_state;
+      key->extra[5] = static_cast<int>(extra.button.background_color);
+      return true;
+    case kMenuPopupArrow:
+      key->extra[0] = extra.menu_arrow.pointing_right;
+      key->extra[1] = extra.menu_arrow.is_selected;
+      return true;
+    case kMenuPopupGutter:
+    case kMenuCheckBackground:
+      return true;
+    case kMenuPopupSeparator:
+      key->extra[0] = extra.menu_separator.has_gutter;
+      return true;
+    case kMenuCheck:
+      key->extra[0] = extra.menu_check.is_radio;
+      key->extra[1] = extra.menu_check.is_selected;
+      return true;
+    case kMenuItemBackground:
+      key->extra[0] = extra.menu_item.is_selected;
+      return true;
+    case kScrollbarDownArrow:
+    case kScrollbarUpArrow:
+    case kScrollbarLeftArrow:
+    case kScrollbarRightArrow:
+      key->extra[0] = extra.scrollbar_arrow.is_hovering;
+      return true;
+    case kScrollbarHorizontalThumb:
+    case kScrollbarVerticalThumb:
+    case kScrollbarHorizontalGripper:
+    case kScrollbarVerticalGripper:
+      key->extra[0] = extra.scrollbar_thumb.is_hovering;
+      return true;
+    case kInnerSpinButton:
+      key->extra[0] = extra.inner_spin.spin_up;
+      key->extra[1] = extra.inner_spin.read_only;
+      key->extra[2] = extra.inner_spin.classic_state;
+      return true;
+    default:
+      // The scrollbar track's checkerboard and the trackbar are aligned to
+      // their position, the progress bar is animated, and the others are
+      // too large or too rare to be worth caching.
+      return false;
+  }
+}
+
+const SkBitmap* NativeThemeWin::GetCachedPart(const PartCacheKey& key,
+                                              Part part,
+                                              State state,
+                                              const ExtraParams& extra) const {
+  PartCache::const_iterator it = part_cache_.find(key);
+  if (it != part_cache_.end())
+    return &it->second;
+
+  // The part is painted on opaque black and on opaque white: the difference
+  // tells how much of each pixel it covers, which is needed as uxtheme and GDI
+  // don't all write alpha.
+  gfx::Rect part_rect(key.width, key.height);
+  scoped_ptr<SkCanvas> on_black(
+      skia::CreateBitmapCanvas(key.width, key.height, false));
+  scoped_ptr<SkCanvas> on_white(
+      skia::CreateBitmapCanvas(key.width, key.height, false));
+  if (!on_black.get() || !on_white.get())
+    return NULL;
+  on_black->clear(SK_ColorBLACK);
+  on_white->clear(SK_ColorWHITE);
+  PaintDirect(on_black.get(), part, state, part_rect, extra);
+  PaintDirect(on_white.get(), part, state, part_rect, extra);
+
+  const SkBitmap& black = on_black->getDevice()->accessBitmap(false);
+  const SkBitmap& white = on_white->getDevice()->accessBitmap(false);
+  SkBitmap bitmap;
+  bitmap.setConfig(SkBitmap::kARGB_8888_Config, key.width, key.height);
+  if (!bitmap.allocPixels())
+    return NULL;
+  bitmap.eraseARGB(0, 0, 0, 0);
+
+  SkAutoLockPixels black_lock(black);
+  SkAutoLockPixels white_lock(white);
+  SkAutoLockPixels bitmap_lock(bitmap);
+  for (int y = 0; y < key.height; ++y) {
+    const SkPMColor* black_row = black.getAddr32(0, y);
+    const SkPMColor* white_row = white.getAddr32(0, y);
+    SkPMColor* row = bitmap.getAddr32(0, y);
+    for (int x = 0; x < key.width; ++x) {
+      // Painted over black, a pixel is its premultiplied color; over white,
+      // that plus the white showing through.
+      int alpha = 0xFF - (static_cast<int>(SkGetPackedG32(white_row[x])) -
+                          static_cast<int>(SkGetPackedG32(black_row[x])));
+      alpha = std::max(0, std::min(alpha, 0xFF));
+      row[x] = SkPackARGB32(
+          alpha,
+          std::min(static_cast<int>(SkGetPackedR32(black_row[x])), alpha),
+          std::min(static_cast<int>(SkGetPackedG32(black_row[x])), alpha),
+          std::min(static_cast<int>(SkGetPackedB32(black_row[x])), alpha));
+    }
+  }
+  bitmap.setIsOpaque(false);
+
+  size_t bytes = bitmap.getSize();
+  if (part_cache_bytes_ + bytes > kMaxPartCacheBytes) {
+    part_cache_.clear();
+    part_cache_bytes_ = 0;
+  }
+  part_cache_bytes_ += bytes;
+  return &(part_cache_[key] = bitmap);
+}
+
 HRESULT NativeThemeWin::PaintScrollbarArrow(
     HDC hdc,
     Part part,
@@ -1338,6 +1516,8 @@ void NativeThemeWin::DisableTheming() const {
   if (!set_theme_properties_)
     return;
   set_theme_properties_(0);
+  part_cache_.clear();
+  part_cache_bytes_ = 0;
 }
 
 HRESULT NativeThemeWin::PaintFrameControl(HDC hdc,
@@ -1397,6 +1577,9 @@ HRESULT NativeThemeWin::PaintFrameControl(HDC hdc,
 }
 
 void NativeThemeWin::CloseHandles() const {
+  part_cache_.clear();
+  part_cache_bytes_ = 0;
+
   if (!close_theme_)
     return;
 
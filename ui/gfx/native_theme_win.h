@@ -15,7 +15,10 @@
 #include <windows.h>
 #include <uxtheme.h>
 
+#include <map>
+
 #include "base/basictypes.h"
+#include "third_party/skia/include/core/SkBitmap.h"
 #include "third_party/skia/include/core/SkColor.h"
 #include "ui/gfx/native_theme.h"
 #include "ui/gfx/size.h"
@@ -77,8 +80,8 @@ class UI_EXPORT NativeThemeWin : public NativeTheme {
   // consistent visual results.
   void DisableTheming() const;
 
-  // Closes cached theme handles so we can unload the DLL or update our UI
-  // for a theme change.
+  // Closes cached theme handles and drops the cached renderings of parts so
+  // we can unload the DLL or update our UI for a theme change.
   void CloseHandles() const;
 
   // Returns true if classic theme is in use.
@@ -97,6 +100,18 @@ class UI_EXPORT NativeThemeWin : public NativeTheme {
                          bool draw_edges) const;
 
  private:
+  // Identifies a rendering of a part that only depends on the part, its
+  // state, its size and the members of its ExtraParams in |extra|.
+  struct PartCacheKey {
+    bool operator<(const PartCacheKey& other) const;
+
+    int part;
+    int state;
+    int width;
+    int height;
+    int extra[6];
+  };
+
   NativeThemeWin();
   ~NativeThemeWin();
 
@@ -110,12 +125,34 @@ class UI_EXPORT NativeThemeWin : public NativeTheme {
                      const gfx::Rect& rect,
                      const ExtraParams& extra) const;
 
+  // Paints through the canvas' HDC, which it must support.
+  void PaintDirect(SkCanvas* canvas,
+                   Part part,
+                   State state,
+                   const gfx::Rect& rect,
+                   const ExtraParams& extra) const;
+
   void PaintToNonPlatformCanvas(SkCanvas* canvas,
                                 Part part,
                                 State state,
                                 const gfx::Rect& rect,
                                 const ExtraParams& extra) const;
 
+  // Fills |key| and returns true if the part can be painted from the cache.
+  // Parts that depend on their position or on the time can't be.
+  static bool GetPartCacheKey(Part part,
+                              State state,
+                              const gfx::Rect& rect,
+                              const ExtraParams& extra,
+                              PartCacheKey* key);
+
+  // Returns the cached rendering of the part, rendering it first if it isn't
+  // cached yet. Returns NULL if it can't be rendered.
+  const SkBitmap* GetCachedPart(const PartCacheKey& key,
+                                Part part,
+                                State state,
+                                const ExtraParams& extra) const;
+
   HRESULT GetThemePartSize(ThemeName themeName,
                            HDC hdc,
                            int part_id,
@@ -321,6 +358,13 @@ class UI_EXPORT NativeThemeWin : public NativeTheme {
   // A cache of open theme handles.
   mutable HANDLE theme_handles_[LAST];
 
+  // Renderings of parts, with premultiplied alpha, and the bytes of their
+  // pixels. Repeated buttons, checkboxes, scrollbar arrows and menu items are
+  // blitted from here without calling into uxtheme.
+  typedef std::map<PartCacheKey, SkBitmap> PartCache;
+  mutable PartCache part_cache_;
+  mutable size_t part_cache_bytes_;
+
   DISALLOW_COPY_AND_ASSIGN(NativeThemeWin);
 };
 
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "base/memory/ref_counted.h"
 #include "base/string16.h"
@@ -50,6 +51,11 @@ class UI_EXPORT PlatformFont : public base::RefCounted<PlatformFont> {
   // string.
   virtual int GetStringWidth(const string16& text) const = 0;
 
+  // Sets |extents| to the widths of the prefixes of |text|, measured at once:
+  // the i-th is the width of the first i + 1 characters.
+  virtual void GetPrefixWidths(const string16& text,
+                               std::vector<int>* extents) const = 0;
+
   // Returns the expected number of horizontal pixels needed to display the
   // specified length of characters. Call GetStringWidth() to retrieve the
   // actual number.
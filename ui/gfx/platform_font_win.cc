@@ -10,11 +10,13 @@
 #include <algorithm>
 
 #include "base/logging.h"
+#include "base/metrics/startup_timeline.h"
 #include "base/string_util.h"
 #include "base/utf_string_conversions.h"
 #include "base/win/win_util.h"
 #include "ui/gfx/canvas_skia.h"
 #include "ui/gfx/font.h"
+#include "ui/gfx/glyph_cache_win.h"
 
 namespace {
 
@@ -22,6 +24,12 @@ namespace {
 // font is bold.
 const int kTextMetricWeightBold = 700;
 
+// The number of string sizes each font keeps.
+const size_t kMaxCachedStringSizes = 256;
+
+// Longer strings, which are rarely measured twice, aren't kept.
+const size_t kMaxCachedStringLength = 512;
+
 // Returns either minimum font allowed for a current locale or
 // lf_height + size_delta value.
 int AdjustFontSize(int lf_height, int size_delta) {
@@ -49,6 +57,9 @@ namespace gfx {
 // static
 PlatformFontWin::HFontRef* PlatformFontWin::base_font_ref_;
 
+// static
+int PlatformFontWin::text_cache_generation_ = 0;
+
 // static
 PlatformFontWin::AdjustFontCallback
     PlatformFontWin::adjust_font_callback = NULL;
@@ -74,17 +85,97 @@ PlatformFontWin::PlatformFontWin(const string16& font_name,
   InitWithFontNameAndSize(font_name, font_size);
 }
 
+PlatformFontWin::MeasuredFont::MeasuredFont()
+    : hfont(NULL),
+      height(0),
+      baseline(0),
+      ave_char_width(0),
+      style(0),
+      dlu_base_x(0) {
+}
+
+PlatformFontWin::PlatformFontWin(const MeasuredFont& measured_font)
+    : font_ref_(CreateHFontRefFromMeasuredFont(measured_font)) {
+}
+
+// static
+void PlatformFontWin::GetBaseFontInfo(LOGFONT* font_info) {
+  NONCLIENTMETRICS metrics;
+  base::win::GetNonClientMetrics(&metrics);
+
+  if (adjust_font_callback)
+    adjust_font_callback(&metrics.lfMessageFont);
+  metrics.lfMessageFont.lfHeight =
+      AdjustFontSize(metrics.lfMessageFont.lfHeight, 0);
+  *font_info = metrics.lfMessageFont;
+}
+
+// static
+void PlatformFontWin::DeriveFontInfo(int size_delta,
+                                     int style,
+                                     LOGFONT* font_info) {
+  font_info->lfHeight = AdjustFontSize(font_info->lfHeight, size_delta);
+  font_info->lfUnderline =
+      ((style & gfx::Font::UNDERLINED) == gfx::Font::UNDERLINED);
+  font_info->lfItalic = ((style & gfx::Font::ITALIC) == gfx::Font::ITALIC);
+  font_info->lfWeight = (style & gfx::Font::BOLD) ? FW_BOLD : FW_NORMAL;
+}
+
+// static
+bool PlatformFontWin::CreateMeasuredFont(const LOGFONT& font_info,
+                                         MeasuredFont* measured_font) {
+  HFONT font = CreateFontIndirect(&font_info);
+  if (!font)
+    return false;
+  MeasureFont(font, measured_font);
+  return true;
+}
+
+// static
+void PlatformFontWin::SetBaseFont(const MeasuredFont& measured_font) {
+  if (base_font_ref_) {
+    DeleteObject(measured_font.hfont);
+    return;
+  }
+  base_font_ref_ = CreateHFontRefFromMeasuredFont(measured_font);
+  // base_font_ref_ is global, up the ref count so it's never deleted.
+  base_font_ref_->AddRef();
+}
+
+bool PlatformFontWin::GetCachedStringSize(const string16& text,
+                                          int flags,
+                                          int* width,
+                                          int* height) const {
+  return font_ref_->GetCachedStringSize(text, flags, width, height);
+}
+
+void PlatformFontWin::CacheStringSize(const string16& text,
+                                      int flags,
+                                      int in_width,
+                                      int in_height,
+                                      int width,
+                                      int height) const {
+  font_ref_->CacheStringSize(text, flags, in_width, in_height, width, height);
+}
+
+GlyphCache* PlatformFontWin::GetGlyphCache() const {
+  return font_ref_->GetGlyphCache();
+}
+
+// static
+void PlatformFontWin::ClearTextCaches() {
+  // Each font forgets its sizes and glyphs the next time it is asked for
+  // them.
+  ++text_cache_generation_;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // PlatformFontWin, PlatformFont implementation:
 
 Font PlatformFontWin::DeriveFont(int size_delta, int style) const {
   LOGFONT font_info;
   GetObject(GetNativeFont(), sizeof(LOGFONT), &font_info);
-  font_info.lfHeight = AdjustFontSize(font_info.lfHeight, size_delta);
-  font_info.lfUnderline =
-      ((style & gfx::Font::UNDERLINED) == gfx::Font::UNDERLINED);
-  font_info.lfItalic = ((style & gfx::Font::ITALIC) == gfx::Font::ITALIC);
-  font_info.lfWeight = (style & gfx::Font::BOLD) ? FW_BOLD : FW_NORMAL;
+  DeriveFontInfo(size_delta, style, &font_info);
 
   HFONT hfont = CreateFontIndirect(&font_info);
   return Font(new PlatformFontWin(CreateHFontRef(hfont)));
@@ -109,6 +200,20 @@ int PlatformFontWin::GetStringWidth(const string16& text) const {
   return width;
 }
 
+void PlatformFontWin::GetPrefixWidths(const string16& text,
+                                      std::vector<int>* extents) const {
+  extents->assign(text.length(), 0);
+  if (text.empty())
+    return;
+  HDC dc = GetDC(NULL);
+  HFONT old_font = static_cast<HFONT>(SelectObject(dc, GetNativeFont()));
+  SIZE size;
+  GetTextExtentExPoint(dc, text.c_str(), static_cast<int>(text.length()), 0,
+                       NULL, &(*extents)[0], &size);
+  SelectObject(dc, old_font);
+  ReleaseDC(NULL, dc);
+}
+
 int PlatformFontWin::GetExpectedTextWidth(int length) const {
   return length * std::min(font_ref_->dlu_base_x(), GetAverageCharacterWidth());
 }
@@ -163,14 +268,9 @@ void PlatformFontWin::InitWithFontNameAndSize(const string16& font_name,
 // static
 PlatformFontWin::HFontRef* PlatformFontWin::GetBaseFontRef() {
   if (base_font_ref_ == NULL) {
-    NONCLIENTMETRICS metrics;
-    base::win::GetNonClientMetrics(&metrics);
-
-    if (adjust_font_callback)
-      adjust_font_callback(&metrics.lfMessageFont);
-    metrics.lfMessageFont.lfHeight =
-        AdjustFontSize(metrics.lfMessageFont.lfHeight, 0);
-    HFONT font = CreateFontIndirect(&metrics.lfMessageFont);
+    LOGFONT font_info;
+    GetBaseFontInfo(&font_info);
+    HFONT font = CreateFontIndirect(&font_info);
     DLOG_ASSERT(font);
     base_font_ref_ = PlatformFontWin::CreateHFontRef(font);
     // base_font_ref_ is global, up the ref count so it's never deleted.
@@ -180,6 +280,14 @@ PlatformFontWin::HFontRef* PlatformFontWin::GetBaseFontRef() {
 }
 
 PlatformFontWin::HFontRef* PlatformFontWin::CreateHFontRef(HFONT font) {
+  base::StartupTimeline::ScopedStep startup_step("FontLoad");
+  MeasuredFont measured_font;
+  MeasureFont(font, &measured_font);
+  return CreateHFontRefFromMeasuredFont(measured_font);
+}
+
+// static
+void PlatformFontWin::MeasureFont(HFONT font, MeasuredFont* measured_font) {
   TEXTMETRIC font_metrics;
   HDC screen_dc = GetDC(NULL);
   HFONT previous_font = static_cast<HFONT>(SelectObject(screen_dc, font));
@@ -209,8 +317,20 @@ PlatformFontWin::HFontRef* PlatformFontWin::CreateHFontRef(HFONT font) {
   if (font_metrics.tmWeight >= kTextMetricWeightBold)
     style |= Font::BOLD;
 
-  return new HFontRef(font, height, baseline, ave_char_width, style,
-                      dlu_base_x);
+  measured_font->hfont = font;
+  measured_font->height = height;
+  measured_font->baseline = baseline;
+  measured_font->ave_char_width = ave_char_width;
+  measured_font->style = style;
+  measured_font->dlu_base_x = dlu_base_x;
+}
+
+// static
+PlatformFontWin::HFontRef* PlatformFontWin::CreateHFontRefFromMeasuredFont(
+    const MeasuredFont& measured_font) {
+  return new HFontRef(measured_font.hfont, measured_font.height,
+                      measured_font.baseline, measured_font.ave_char_width,
+                      measured_font.style, measured_font.dlu_base_x);
 }
 
 PlatformFontWin::PlatformFontWin(HFontRef* hfont_ref) : font_ref_(hfont_ref) {
@@ -230,7 +350,8 @@ PlatformFontWin::HFontRef::HFontRef(HFONT hfont,
       baseline_(baseline),
       ave_char_width_(ave_char_width),
       style_(style),
-      dlu_base_x_(dlu_base_x) {
+      dlu_base_x_(dlu_base_x),
+      cache_generation_(text_cache_generation_) {
   DLOG_ASSERT(hfont);
 
   LOGFONT font_info;
@@ -239,9 +360,90 @@ PlatformFontWin::HFontRef::HFontRef(HFONT hfont,
 }
 
 PlatformFontWin::HFontRef::~HFontRef() {
+  // The glyph cache has the font selected in its DC.
+  glyph_cache_.reset();
   DeleteObject(hfont_);
 }
 
+bool PlatformFontWin::HFontRef::GetCachedStringSize(const string16& text,
+                                                    int flags,
+                                                    int* width,
+                                                    int* height) {
+  CheckTextCacheGeneration();
+  if (text.length() > kMaxCachedStringLength)
+    return false;
+  StringSizeMap::iterator i =
+      string_size_map_.find(StringSizeKey(text, flags, *width, *height));
+  if (i == string_size_map_.end())
+    return false;
+  string_sizes_.splice(string_sizes_.begin(), string_sizes_, i->second);
+  *width = i->second->second.width();
+  *height = i->second->second.height();
+  return true;
+}
+
+void PlatformFontWin::HFontRef::CacheStringSize(const string16& text,
+                                                int flags,
+                                                int in_width,
+                                                int in_height,
+                                                int width,
+                                                int height) {
+  CheckTextCacheGeneration();
+  if (text.length() > kMaxCachedStringLength)
+    return;
+  StringSizeKey key(text, flags, in_width, in_height);
+  StringSizeMap::iterator i = string_size_map_.find(key);
+  if (i != string_size_map_.end()) {
+    string_sizes_.erase(i->second);
+    string_size_map_.erase(i);
+  } else if (string_sizes_.size() >= kMaxCachedStringSizes) {
+    string_size_map_.erase(string_sizes_.back().first);
+    string_sizes_.pop_back();
+  }
+  string_sizes_.push_front(std::make_pair(key, gfx::Size(width, height)));
+  string_size_map_[key] = string_sizes_.begin();
+}
+
+GlyphCache* PlatformFontWin::HFontRef::GetGlyphCache() {
+  CheckTextCacheGeneration();
+  if (!glyph_cache_.get())
+    glyph_cache_.reset(new GlyphCache(hfont_));
+  return glyph_cache_.get();
+}
+
+void PlatformFontWin::HFontRef::CheckTextCacheGeneration() {
+  if (cache_generation_ == text_cache_generation_)
+    return;
+  string_sizes_.clear();
+  string_size_map_.clear();
+  glyph_cache_.reset();
+  cache_generation_ = text_cache_generation_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// PlatformFontWin::HFontRef::StringSizeKey:
+
+PlatformFontWin::HFontRef::StringSizeKey::StringSizeKey(const string16& text,
+                                                        int flags,
+                                                        int width,
+                                                        int height)
+    : text(text),
+      flags(flags),
+      width(width),
+      height(height) {
+}
+
+bool PlatformFontWin::HFontRef::StringSizeKey::operator<(
+    const StringSizeKey& other) const {
+  if (flags != other.flags)
+    return flags < other.flags;
+  if (width != other.width)
+    return width < other.width;
+  if (height != other.height)
+    return height < other.height;
+  return text < other.text;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // PlatformFont, public:
 
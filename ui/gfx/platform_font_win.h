@@ -6,12 +6,21 @@
 #define UI_GFX_PLATFORM_FONT_WIN_
 #pragma once
 
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
 #include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
 #include "ui/base/ui_export.h"
 #include "ui/gfx/platform_font.h"
+#include "ui/gfx/size.h"
 
 namespace gfx {
 
+class GlyphCache;
+
 class UI_EXPORT PlatformFontWin : public PlatformFont {
  public:
   PlatformFontWin();
@@ -20,6 +29,40 @@ class UI_EXPORT PlatformFontWin : public PlatformFont {
   PlatformFontWin(const string16& font_name,
                   int font_size);
 
+  // A font created and measured by CreateMeasuredFont(). It holds no
+  // reference counted state, so that it can be passed between threads, and
+  // be made a PlatformFontWin on the UI thread, which then owns the HFONT.
+  struct MeasuredFont {
+    MeasuredFont();
+
+    HFONT hfont;
+    int height;
+    int baseline;
+    int ave_char_width;
+    int style;
+    int dlu_base_x;
+  };
+  explicit PlatformFontWin(const MeasuredFont& measured_font);
+
+  // Sets |font_info| to the LOGFONT the base font is created with, adjusted
+  // by the callbacks below. UI thread only.
+  static void GetBaseFontInfo(LOGFONT* font_info);
+
+  // Changes |font_info| to that of the font DeriveFont() derives from it.
+  // UI thread only.
+  static void DeriveFontInfo(int size_delta, int style, LOGFONT* font_info);
+
+  // Creates the font of |font_info| and measures it, which is what takes time
+  // when a font is created, the first time GDI uses the font file. May be
+  // called on any thread. Returns false if the font can't be created.
+  static bool CreateMeasuredFont(const LOGFONT& font_info,
+                                 MeasuredFont* measured_font);
+
+  // Makes |measured_font|, created from GetBaseFontInfo(), the base font,
+  // taking ownership of its HFONT, unless the base font was created already.
+  // UI thread only.
+  static void SetBaseFont(const MeasuredFont& measured_font);
+
   // Dialog units to pixels conversion.
   // See http://support.microsoft.com/kb/145994 for details.
   int horizontal_dlus_to_pixels(int dlus) const {
@@ -41,12 +84,38 @@ class UI_EXPORT PlatformFontWin : public PlatformFont {
   typedef void (*AdjustFontCallback)(LOGFONT* lf);
   static AdjustFontCallback adjust_font_callback;
 
+  // CanvasSkia::SizeStringInt() keeps the sizes it measures with the font,
+  // since laying out measures the same strings over and over. A size is
+  // found by the text, the flags, and the |width| and |height| passed in,
+  // which are set to the size. Returns false if it wasn't measured yet.
+  bool GetCachedStringSize(const string16& text,
+                           int flags,
+                           int* width,
+                           int* height) const;
+  void CacheStringSize(const string16& text,
+                       int flags,
+                       int in_width,
+                       int in_height,
+                       int width,
+                       int height) const;
+
+  // Returns the glyphs of the font, which CanvasSkia::DrawStringInt() draws
+  // simple lines of text with. Created as needed; only used on the UI thread.
+  GlyphCache* GetGlyphCache() const;
+
+  // Forgets the measured sizes and the rasterized glyphs of all the fonts.
+  // Must be called when what the text looks like may have changed, like the
+  // locale or the font smoothing settings.
+  static void ClearTextCaches();
+
   // Overridden from PlatformFont:
   virtual Font DeriveFont(int size_delta, int style) const;
   virtual int GetHeight() const;
   virtual int GetBaseline() const;
   virtual int GetAverageCharacterWidth() const;
   virtual int GetStringWidth(const string16& text) const;
+  virtual void GetPrefixWidths(const string16& text,
+                               std::vector<int>* extents) const;
   virtual int GetExpectedTextWidth(int length) const;
   virtual int GetStyle() const;
   virtual string16 GetFontName() const;
@@ -84,11 +153,46 @@ class UI_EXPORT PlatformFontWin : public PlatformFont {
     int dlu_base_x() const { return dlu_base_x_; }
     const string16& font_name() const { return font_name_; }
 
+    // See PlatformFontWin::GetCachedStringSize().
+    bool GetCachedStringSize(const string16& text,
+                             int flags,
+                             int* width,
+                             int* height);
+    void CacheStringSize(const string16& text,
+                         int flags,
+                         int in_width,
+                         int in_height,
+                         int width,
+                         int height);
+
+    // See PlatformFontWin::GetGlyphCache().
+    GlyphCache* GetGlyphCache();
+
    private:
     friend class  base::RefCounted<HFontRef>;
 
+    // What a size was measured for.
+    struct StringSizeKey {
+      StringSizeKey(const string16& text, int flags, int width, int height);
+
+      bool operator<(const StringSizeKey& other) const;
+
+      string16 text;
+      int flags;
+      int width;
+      int height;
+    };
+
+    // The most recently used sizes are at the front.
+    typedef std::list<std::pair<StringSizeKey, gfx::Size> > StringSizeList;
+    typedef std::map<StringSizeKey, StringSizeList::iterator> StringSizeMap;
+
     ~HFontRef();
 
+    // Forgets the sizes and the glyphs if ClearTextCaches() was called since
+    // they were cached.
+    void CheckTextCacheGeneration();
+
     const HFONT hfont_;
     const int height_;
     const int baseline_;
@@ -98,6 +202,13 @@ class UI_EXPORT PlatformFontWin : public PlatformFont {
     const int dlu_base_x_;
     string16 font_name_;
 
+    StringSizeList string_sizes_;
+    StringSizeMap string_size_map_;
+    scoped_ptr<GlyphCache> glyph_cache_;
+    // The PlatformFontWin::text_cache_generation_ the sizes and the glyphs were
+    // cached in.
+    int cache_generation_;
+
     DISALLOW_COPY_AND_ASSIGN(HFontRef);
   };
 
@@ -115,6 +226,13 @@ class UI_EXPORT PlatformFontWin : public PlatformFont {
   // Creates and returns a new HFONTRef from the specified HFONT.
   static HFontRef* CreateHFontRef(HFONT font);
 
+  // Measures |font| into |measured_font|. May be called on any thread.
+  static void MeasureFont(HFONT font, MeasuredFont* measured_font);
+
+  // Creates a new HFontRef, owning the HFONT of |measured_font|.
+  static HFontRef* CreateHFontRefFromMeasuredFont(
+      const MeasuredFont& measured_font);
+
   // Creates a new PlatformFontWin with the specified HFontRef. Used when
   // constructing a Font from a HFONT we don't want to copy.
   explicit PlatformFontWin(HFontRef* hfont_ref);
@@ -122,6 +240,9 @@ class UI_EXPORT PlatformFontWin : public PlatformFont {
     // Reference to the base font all fonts are derived from.
   static HFontRef* base_font_ref_;
 
+  // Bumped by ClearTextCaches().
+  static int text_cache_generation_;
+
   // Indirect reference to the HFontRef, which references the underlying HFONT.
   scoped_refptr<HFontRef> font_ref_;
 };
@@ -0,0 +1,223 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/gfx/pooled_pixel_allocator.h"
+
+#include <string.h>
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "third_party/skia/include/core/SkFlattenable.h"
+#include "third_party/skia/include/core/SkMallocPixelRef.h"
+#include "third_party/skia/include/core/SkPixelRef.h"
+
+namespace {
+
+// The smallest size class; smaller bitmaps use buffers of this size.
+const size_t kMinBufferBytes = 1024;
+
+// Budget of the shared allocator: the free buffers it keeps, and the largest
+// one, enough for a 1024x1024 layer.
+const size_t kSharedMaxPooledBytes = 16 * 1024 * 1024;
+const size_t kSharedMaxBufferBytes = 4 * 1024 * 1024;
+
+struct SharedAllocator {
+  SharedAllocator()
+      : allocator(new gfx::PooledPixelAllocator(kSharedMaxPooledBytes,
+                                                kSharedMaxBufferBytes)) {
+  }
+
+  gfx::PooledPixelAllocator* allocator;
+};
+
+// Leaky, since bitmaps may still use the pooled buffers at exit.
+base::LazyInstance<SharedAllocator,
+                   base::LeakyLazyInstanceTraits<SharedAllocator> >
+    g_shared_allocator(base::LINKER_INITIALIZED);
+
+}  // namespace
+
+namespace gfx {
+
+// PooledPixelRef --------------------------------------------------------------
+
+class PooledPixelAllocator::PooledPixelRef : public SkPixelRef {
+ public:
+  PooledPixelRef(PooledPixelAllocator* allocator, void* buffer,
+                 size_t size, size_t size_class, SkColorTable* ctable)
+      : allocator_(allocator),
+        buffer_(buffer),
+        size_(size),
+        size_class_(size_class),
+        ctable_(ctable) {
+    allocator_->ref();
+    SkSafeRef(ctable_);
+  }
+
+  virtual ~PooledPixelRef() {
+    SkSafeUnref(ctable_);
+    allocator_->FreeBuffer(buffer_, size_class_);
+    allocator_->unref();
+  }
+
+  // SkPixelRef overrides. The pixels are written the way SkMallocPixelRef
+  // writes them, and read back into one, since there may not be a pool on the
+  // other side.
+  virtual void flatten(SkFlattenableWriteBuffer& buffer) const {
+    SkPixelRef::flatten(buffer);
+    buffer.write32(size_);
+    buffer.writePad(buffer_, size_);
+    if (ctable_) {
+      buffer.writeBool(true);
+      ctable_->flatten(buffer);
+    } else {
+      buffer.writeBool(false);
+    }
+  }
+  virtual Factory getFactory() const {
+    return SkMallocPixelRef::Create;
+  }
+
+ protected:
+  virtual void* onLockPixels(SkColorTable** ctable) {
+    *ctable = ctable_;
+    return buffer_;
+  }
+  virtual void onUnlockPixels() {
+  }
+
+ private:
+  PooledPixelAllocator* allocator_;
+  void* buffer_;
+  size_t size_;
+  size_t size_class_;
+  SkColorTable* ctable_;
+
+  DISALLOW_COPY_AND_ASSIGN(PooledPixelRef);
+};
+
+// PooledPixelAllocator --------------------------------------------------------
+
+PooledPixelAllocator::PooledPixelAllocator(size_t max_pooled_bytes,
+                                           size_t max_buffer_bytes)
+    : max_pooled_bytes_(max_pooled_bytes),
+      max_buffer_bytes_(max_buffer_bytes) {
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+PooledPixelAllocator::~PooledPixelAllocator() {
+  // Each pixel ref holds a reference to the allocator.
+  DCHECK_EQ(0u, stats_.buffers_in_use);
+  Purge();
+}
+
+// static
+PooledPixelAllocator* PooledPixelAllocator::GetInstance() {
+  return g_shared_allocator.Get().allocator;
+}
+
+bool PooledPixelAllocator::allocPixelRef(SkBitmap* bitmap,
+                                         SkColorTable* ctable) {
+  Sk64 size = bitmap->getSize64();
+  if (size.isNeg() || !size.is32())
+    return false;
+  if (static_cast<size_t>(size.get32()) > max_buffer_bytes_) {
+    SkBitmap::HeapAllocator heap_allocator;
+    return heap_allocator.allocPixelRef(bitmap, ctable);
+  }
+
+  size_t size_class = GetSizeClass(size.get32());
+  void* buffer = AllocateBuffer(size_class);
+  if (!buffer)
+    return false;
+
+  bitmap->setPixelRef(new PooledPixelRef(this, buffer, size.get32(),
+                                         size_class, ctable))->unref();
+  // Like SkBitmap::HeapAllocator, since the pixels are already allocated.
+  bitmap->lockPixels();
+  return true;
+}
+
+PooledPixelAllocator::Stats PooledPixelAllocator::GetStats() const {
+  base::AutoLock lock(lock_);
+  return stats_;
+}
+
+void PooledPixelAllocator::Purge() {
+  FreeBufferMap free_buffers;
+  {
+    base::AutoLock lock(lock_);
+    free_buffers.swap(free_buffers_);
+    stats_.hits = 0;
+    stats_.misses = 0;
+    stats_.pooled_buffers = 0;
+    stats_.pooled_bytes = 0;
+  }
+  for (FreeBufferMap::iterator i = free_buffers.begin();
+       i != free_buffers.end(); ++i) {
+    for (size_t j = 0; j < i->second.size(); ++j)
+      sk_free(i->second[j]);
+  }
+}
+
+// static
+size_t PooledPixelAllocator::GetSizeClass(size_t size) {
+  if (size <= kMinBufferBytes)
+    return kMinBufferBytes;
+
+  // Rounds up to a multiple of a quarter of the largest power of two that
+  // is not larger than |size|, which wastes less than 25%.
+  size_t power = kMinBufferBytes;
+  while (power <= size / 2)
+    power *= 2;
+  size_t step = power / 4;
+  return (size + step - 1) / step * step;
+}
+
+void* PooledPixelAllocator::AllocateBuffer(size_t size_class) {
+  {
+    base::AutoLock lock(lock_);
+    stats_.buffers_in_use++;
+    stats_.bytes_in_use += size_class;
+
+    FreeBufferMap::iterator found = free_buffers_.find(size_class);
+    if (found != free_buffers_.end()) {
+      void* buffer = found->second.back();
+      found->second.pop_back();
+      if (found->second.empty())
+        free_buffers_.erase(found);
+      stats_.hits++;
+      stats_.pooled_buffers--;
+      stats_.pooled_bytes -= size_class;
+      return buffer;
+    }
+    stats_.misses++;
+  }
+
+  // Allocates outside of the lock. Returns NULL on failure.
+  void* buffer = sk_malloc_flags(size_class, 0);
+  if (!buffer) {
+    base::AutoLock lock(lock_);
+    stats_.buffers_in_use--;
+    stats_.bytes_in_use -= size_class;
+  }
+  return buffer;
+}
+
+void PooledPixelAllocator::FreeBuffer(void* buffer, size_t size_class) {
+  {
+    base::AutoLock lock(lock_);
+    stats_.buffers_in_use--;
+    stats_.bytes_in_use -= size_class;
+    if (stats_.pooled_bytes + size_class <= max_pooled_bytes_) {
+      free_buffers_[size_class].push_back(buffer);
+      stats_.pooled_buffers++;
+      stats_.pooled_bytes += size_class;
+      return;
+    }
+  }
+  sk_free(buffer);
+}
+
+}  // namespace gfx
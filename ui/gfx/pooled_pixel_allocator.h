@@ -0,0 +1,97 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef UI_GFX_POOLED_PIXEL_ALLOCATOR_H_
+#define UI_GFX_POOLED_PIXEL_ALLOCATOR_H_
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/synchronization/lock.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "ui/base/ui_export.h"
+
+namespace gfx {
+
+// An SkBitmap::Allocator that recycles pixel buffers instead of returning them
+// to the heap. Bitmaps of the same few sizes that are allocated and freed over
+// and over, such as tab thumbnails, icons and layer contents while scrolling
+// or animating, then reuse the same memory instead of fragmenting the heap.
+//
+// Buffers are grouped in size classes a quarter of a power of two apart, so
+// that bitmaps of similar sizes share buffers. When the last bitmap using a
+// buffer goes away, the buffer is kept for reuse, unless the free buffers
+// already take up the budget of the pool. Recycled buffers are not cleared.
+//
+// The allocator is thread safe, and the pixels it allocates keep it alive:
+//   SkBitmap bitmap;
+//   bitmap.setConfig(SkBitmap::kARGB_8888_Config, width, height);
+//   bitmap.allocPixels(gfx::PooledPixelAllocator::GetInstance(), NULL);
+class UI_EXPORT PooledPixelAllocator : public SkBitmap::Allocator {
+ public:
+  struct Stats {
+    // Allocations served from the pool, and from the heap. Bitmaps too large
+    // to be pooled are not counted, here or below.
+    size_t hits;
+    size_t misses;
+
+    // Buffers handed out and not freed yet, and their size.
+    size_t buffers_in_use;
+    size_t bytes_in_use;
+
+    // Free buffers kept for reuse, and their size.
+    size_t pooled_buffers;
+    size_t pooled_bytes;
+  };
+
+  // Keeps at most |max_pooled_bytes| of free buffers. Bitmaps larger than
+  // |max_buffer_bytes| are allocated from the heap as usual.
+  PooledPixelAllocator(size_t max_pooled_bytes, size_t max_buffer_bytes);
+  virtual ~PooledPixelAllocator();
+
+  // Returns the allocator shared by ui/gfx. It is never deleted.
+  static PooledPixelAllocator* GetInstance();
+
+  // SkBitmap::Allocator implementation. The bitmap's pixels are locked on
+  // success, as with the default allocator.
+  virtual bool allocPixelRef(SkBitmap* bitmap, SkColorTable* ctable) OVERRIDE;
+
+  Stats GetStats() const;
+
+  // Frees the pooled buffers, and resets the hit and miss counts.
+  void Purge();
+
+ private:
+  // Owns a buffer, and gives it back to the allocator when deleted.
+  class PooledPixelRef;
+  friend class PooledPixelRef;
+
+  // Returns the size of the buffers used for |size| bytes of pixels.
+  static size_t GetSizeClass(size_t size);
+
+  // Returns a buffer of |size_class| bytes, or NULL when out of memory.
+  void* AllocateBuffer(size_t size_class);
+  void FreeBuffer(void* buffer, size_t size_class);
+
+  const size_t max_pooled_bytes_;
+  const size_t max_buffer_bytes_;
+
+  // Protects the members below.
+  mutable base::Lock lock_;
+
+  // Free buffers, by size class.
+  typedef std::map<size_t, std::vector<void*> > FreeBufferMap;
+  FreeBufferMap free_buffers_;
+
+  Stats stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(PooledPixelAllocator);
+};
+
+}  // namespace gfx
+
+#endif  // UI_GFX_POOLED_PIXEL_ALLOCATOR_H_
@@ -0,0 +1,303 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/gfx/recording_canvas.h"
+
+#include <vector>
+
+#include "base/logging.h"
+#include "third_party/skia/include/core/SkColorPriv.h"
+#include "third_party/skia/include/core/SkDevice.h"
+#include "third_party/skia/include/core/SkPicture.h"
+#include "ui/gfx/color_utils.h"
+#include "ui/gfx/rect.h"
+
+namespace gfx {
+
+RecordingCanvas::RecordingCanvas(SkPicture* picture, int width, int height)
+    : recorder_(picture->beginRecording(width, height)),
+      picture_(picture),
+      op_count_(0),
+      recorded_all_(true) {
+  // A device of the size of the picture, without pixels, bounds the clip.
+  SkBitmap bitmap;
+  bitmap.setConfig(SkBitmap::kARGB_8888_Config, width, height);
+  SkDevice* device = new SkDevice(bitmap);
+  setDevice(device);
+  device->unref();  // Was created with refcount 1, and setDevice also refs.
+}
+
+RecordingCanvas::~RecordingCanvas() {
+  picture_->endRecording();
+}
+
+void RecordingCanvas::DrawStringInt(const string16& text,
+                                    const gfx::Font& font,
+                                    const SkColor& color,
+                                    int x, int y, int w, int h,
+                                    int flags) {
+  // Only the part of the text within the clip is rasterized.
+  SkRect clip;
+  if (!getClipBounds(&clip))
+    return;
+  SkIRect bounds;
+  clip.roundOut(&bounds);
+  if (!bounds.intersect(x, y, x + w, y + h))
+    return;
+
+  // The text is drawn black on white, so that the luma of each pixel gives
+  // its coverage, the way DrawFadeTruncatingString() draws the faded parts.
+  CanvasSkia text_canvas(bounds.width(), bounds.height(), true);
+  text_canvas.drawColor(SK_ColorWHITE);
+  text_canvas.DrawStringInt(text, font, SK_ColorBLACK, x - bounds.fLeft,
+                            y - bounds.fTop, w, h, flags);
+
+  SkBitmap text_bitmap = text_canvas.ExtractBitmap();
+  text_bitmap.setIsOpaque(false);
+  SkAutoLockPixels lock(text_bitmap);
+  int width = text_bitmap.width();
+  std::vector<unsigned char> lumas(width);
+  U8CPU alpha = SkColorGetA(color);
+  U8CPU r = SkColorGetR(color);
+  U8CPU g = SkColorGetG(color);
+  U8CPU b = SkColorGetB(color);
+  for (int row_y = 0; row_y < text_bitmap.height(); ++row_y) {
+    uint32_t* row = text_bitmap.getAddr32(0, row_y);
+    color_utils::GetLuminancesForColors(row, width, &lumas[0]);
+    for (int row_x = 0; row_x < width; ++row_x) {
+      U8CPU coverage = 0xFF - lumas[row_x];
+      row[row_x] = SkPreMultiplyColor(
+          SkColorSetARGB(SkMulDiv255Round(coverage, alpha), r, g, b));
+    }
+  }
+  drawBitmap(text_bitmap, SkIntToScalar(bounds.fLeft),
+             SkIntToScalar(bounds.fTop));
+}
+
+#if defined(OS_WIN)
+void RecordingCanvas::DrawFadeTruncatingString(
+    const string16& text,
+    TruncateFadeMode truncate_mode,
+    size_t desired_characters_to_truncate_from_head,
+    const gfx::Font& font,
+    const SkColor& color,
+    const gfx::Rect& display_rect) {
+  // The fades are blended with GDI. The text is recorded without them.
+  recorded_all_ = false;
+  DrawStringInt(text, font, color, display_rect.x(), display_rect.y(),
+                display_rect.width(), display_rect.height(), NO_ELLIPSIS);
+}
+#endif
+
+gfx::NativeDrawingContext RecordingCanvas::BeginPlatformPaint() {
+  recorded_all_ = false;
+  // The platform calls draw into a pixel that is thrown away.
+  if (!platform_canvas_.get())
+    platform_canvas_.reset(new CanvasSkia(1, 1, false));
+  return platform_canvas_->BeginPlatformPaint();
+}
+
+void RecordingCanvas::EndPlatformPaint() {
+  DCHECK(platform_canvas_.get());
+  platform_canvas_->EndPlatformPaint();
+}
+
+// The matrix and clip calls go to both canvases, so that the clip queries see
+// what the recording will be clipped to.
+
+int RecordingCanvas::save(SaveFlags flags) {
+  recorder_->save(flags);
+  return SkCanvas::save(flags);
+}
+
+int RecordingCanvas::saveLayer(const SkRect* bounds,
+                               const SkPaint* paint,
+                               SaveFlags flags) {
+  recorder_->saveLayer(bounds, paint, flags);
+  // Without pixels, a layer is only a save, clipped to its bounds.
+  int count = SkCanvas::save(kMatrixClip_SaveFlag);
+  if (bounds)
+    SkCanvas::clipRect(*bounds);
+  return count;
+}
+
+void RecordingCanvas::restore() {
+  recorder_->restore();
+  SkCanvas::restore();
+}
+
+bool RecordingCanvas::translate(SkScalar dx, SkScalar dy) {
+  recorder_->translate(dx, dy);
+  return SkCanvas::translate(dx, dy);
+}
+
+bool RecordingCanvas::scale(SkScalar sx, SkScalar sy) {
+  recorder_->scale(sx, sy);
+  return SkCanvas::scale(sx, sy);
+}
+
+bool RecordingCanvas::rotate(SkScalar degrees) {
+  recorder_->rotate(degrees);
+  return SkCanvas::rotate(degrees);
+}
+
+bool RecordingCanvas::skew(SkScalar sx, SkScalar sy) {
+  recorder_->skew(sx, sy);
+  return SkCanvas::skew(sx, sy);
+}
+
+bool RecordingCanvas::concat(const SkMatrix& matrix) {
+  recorder_->concat(matrix);
+  return SkCanvas::concat(matrix);
+}
+
+void RecordingCanvas::setMatrix(const SkMatrix& matrix) {
+  recorder_->setMatrix(matrix);
+  SkCanvas::setMatrix(matrix);
+}
+
+bool RecordingCanvas::clipRect(const SkRect& rect, SkRegion::Op op) {
+  recorder_->clipRect(rect, op);
+  return SkCanvas::clipRect(rect, op);
+}
+
+bool RecordingCanvas::clipPath(const SkPath& path, SkRegion::Op op) {
+  recorder_->clipPath(path, op);
+  return SkCanvas::clipPath(path, op);
+}
+
+bool RecordingCanvas::clipRegion(const SkRegion& device_region,
+                                 SkRegion::Op op) {
+  recorder_->clipRegion(device_region, op);
+  return SkCanvas::clipRegion(device_region, op);
+}
+
+// The drawing calls only go to the recording canvas.
+
+void RecordingCanvas::clear(SkColor color) {
+  ++op_count_;
+  recorder_->clear(color);
+}
+
+void RecordingCanvas::drawPaint(const SkPaint& paint) {
+  ++op_count_;
+  recorder_->drawPaint(paint);
+}
+
+void RecordingCanvas::drawPoints(PointMode mode,
+                                 size_t count,
+                                 const SkPoint pts[],
+                                 const SkPaint& paint) {
+  ++op_count_;
+  recorder_->drawPoints(mode, count, pts, paint);
+}
+
+void RecordingCanvas::drawRect(const SkRect& rect, const SkPaint& paint) {
+  ++op_count_;
+  recorder_->drawRect(rect, paint);
+}
+
+void RecordingCanvas::drawPath(const SkPath& path, const SkPaint& paint) {
+  ++op_count_;
+  recorder_->drawPath(path, paint);
+}
+
+void RecordingCanvas::drawBitmap(const SkBitmap& bitmap,
+                                 SkScalar left,
+                                 SkScalar top,
+                                 const SkPaint* paint) {
+  ++op_count_;
+  recorder_->drawBitmap(bitmap, left, top, paint);
+}
+
+void RecordingCanvas::drawBitmapRect(const SkBitmap& bitmap,
+                                     const SkIRect* src,
+                                     const SkRect& dst,
+                                     const SkPaint* paint) {
+  ++op_count_;
+  recorder_->drawBitmapRect(bitmap, src, dst, paint);
+}
+
+void RecordingCanvas::drawBitmapMatrix(const SkBitmap& bitmap,
+                                       const SkMatrix& m,
+                                       const SkPaint* paint) {
+  ++op_count_;
+  recorder_->drawBitmapMatrix(bitmap, m, paint);
+}
+
+void RecordingCanvas::drawBitmapNine(const SkBitmap& bitmap,
+                                     const SkIRect& center,
+                                     const SkRect& dst,
+                                     const SkPaint* paint) {
+  ++op_count_;
+  recorder_->drawBitmapNine(bitmap, center, dst, paint);
+}
+
+void RecordingCanvas::drawSprite(const SkBitmap& bitmap,
+                                 int left,
+                                 int top,
+                                 const SkPaint* paint) {
+  ++op_count_;
+  recorder_->drawSprite(bitmap, left, top, paint);
+}
+
+void RecordingCanvas::drawText(const void* text,
+                               size_t byte_length,
+                               SkScalar x,
+                               SkScalar y,
+                               const SkPaint& paint) {
+  ++op_count_;
+  recorder_->drawText(text, byte_length, x, y, paint);
+}
+
+void RecordingCanvas::drawPosText(const void* text,
+                                  size_t byte_length,
+                                  const SkPoint pos[],
+                                  const SkPaint& paint) {
+  ++op_count_;
+  recorder_->drawPosText(text, byte_length, pos, paint);
+}
+
+void RecordingCanvas::drawPosTextH(const void* text,
+                                   size_t byte_length,
+                                   const SkScalar xpos[],
+                                   SkScalar const_y,
+                                   const SkPaint& paint) {
+  ++op_count_;
+  recorder_->drawPosTextH(text, byte_length, xpos, const_y, paint);
+}
+
+void RecordingCanvas::drawTextOnPath(const void* text,
+                                     size_t byte_length,
+                                     const SkPath& path,
+                                     const SkMatrix* matrix,
+                                     const SkPaint& paint) {
+  ++op_count_;
+  recorder_->drawTextOnPath(text, byte_length, path, matrix, paint);
+}
+
+void RecordingCanvas::drawPicture(SkPicture& picture) {
+  ++op_count_;
+  recorder_->drawPicture(picture);
+}
+
+void RecordingCanvas::drawVertices(VertexMode mode,
+                                   int vertex_count,
+                                   const SkPoint vertices[],
+                                   const SkPoint texs[],
+                                   const SkColor colors[],
+                                   SkXfermode* xmode,
+                                   const uint16_t indices[],
+                                   int index_count,
+                                   const SkPaint& paint) {
+  ++op_count_;
+  recorder_->drawVertices(mode, vertex_count, vertices, texs, colors, xmode,
+                          indices, index_count, paint);
+}
+
+void RecordingCanvas::drawData(const void* data, size_t length) {
+  recorder_->drawData(data, length);
+}
+
+}  // namespace gfx
@@ -0,0 +1,144 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef UI_GFX_RECORDING_CANVAS_H_
+#define UI_GFX_RECORDING_CANVAS_H_
+#pragma once
+
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/memory/scoped_ptr.h"
+#include "ui/gfx/canvas_skia.h"
+
+class SkPicture;
+
+namespace gfx {
+
+// A CanvasSkia that records what is drawn into it in an SkPicture, rather
+// than rasterizing it, so that it can be drawn again, into any canvas and at
+// any scale, without running the code that drew it. The canvas has no
+// pixels: it keeps the matrix and clip of what is drawn, for the clip
+// queries, and hands the drawing to the recording canvas of the picture.
+//
+// Text is rasterized as it is drawn, since both the glyph cache and GDI draw
+// it into the pixels, alone in a bitmap from which it is recorded. It is
+// antialiased in grayscale, as on any transparent bitmap.
+//
+// The platform calls can't be recorded either. BeginPlatformPaint() gives a
+// surface whose drawing is lost, and recorded_all() is false from then on.
+// The code that goes to skia::BeginPlatformPaint() directly, such as
+// NativeTheme's, gets no surface and draws nothing, since
+// skia::SupportsPlatformPaint() is false for the canvas.
+//
+//   SkPicture* picture = new SkPicture;
+//   {
+//     gfx::RecordingCanvas canvas(picture, view->width(), view->height());
+//     view->Paint(&canvas);
+//   }
+//   thumbnail_canvas->scale(0.5f, 0.5f);
+//   thumbnail_canvas->drawPicture(*picture);
+//   picture->unref();
+class UI_EXPORT RecordingCanvas : public CanvasSkia {
+ public:
+  // Starts recording a |width| by |height| drawing into |picture|, which
+  // must outlive the canvas. The recording ends when the canvas is deleted.
+  RecordingCanvas(SkPicture* picture, int width, int height);
+  virtual ~RecordingCanvas();
+
+  // The number of drawing calls recorded so far. A picture drawn into the
+  // canvas counts as one.
+  int op_count() const { return op_count_; }
+
+  // False if something was drawn with platform calls, which wasn't recorded.
+  bool recorded_all() const { return recorded_all_; }
+
+  // Overridden from Canvas:
+  using CanvasSkia::DrawStringInt;
+  virtual void DrawStringInt(const string16& text,
+                             const gfx::Font& font,
+                             const SkColor& color,
+                             int x, int y, int w, int h,
+                             int flags) OVERRIDE;
+#if defined(OS_WIN)
+  virtual void DrawFadeTruncatingString(
+      const string16& text,
+      TruncateFadeMode truncate_mode,
+      size_t desired_characters_to_truncate_from_head,
+      const gfx::Font& font,
+      const SkColor& color,
+      const gfx::Rect& display_rect) OVERRIDE;
+#endif
+  virtual gfx::NativeDrawingContext BeginPlatformPaint() OVERRIDE;
+  virtual void EndPlatformPaint() OVERRIDE;
+
+  // Overridden from SkCanvas:
+  virtual int save(SaveFlags flags = kMatrixClip_SaveFlag) OVERRIDE;
+  virtual int saveLayer(const SkRect* bounds, const SkPaint* paint,
+                        SaveFlags flags = kARGB_ClipLayer_SaveFlag) OVERRIDE;
+  virtual void restore() OVERRIDE;
+  virtual bool translate(SkScalar dx, SkScalar dy) OVERRIDE;
+  virtual bool scale(SkScalar sx, SkScalar sy) OVERRIDE;
+  virtual bool rotate(SkScalar degrees) OVERRIDE;
+  virtual bool skew(SkScalar sx, SkScalar sy) OVERRIDE;
+  virtual bool concat(const SkMatrix& matrix) OVERRIDE;
+  virtual void setMatrix(const SkMatrix& matrix) OVERRIDE;
+  virtual bool clipRect(const SkRect& rect,
+                        SkRegion::Op op = SkRegion::kIntersect_Op) OVERRIDE;
+  virtual bool clipPath(const SkPath& path,
+                        SkRegion::Op op = SkRegion::kIntersect_Op) OVERRIDE;
+  virtual bool clipRegion(const SkRegion& device_region,
+                          SkRegion::Op op = SkRegion::kIntersect_Op) OVERRIDE;
+  virtual void clear(SkColor color) OVERRIDE;
+  virtual void drawPaint(const SkPaint& paint) OVERRIDE;
+  virtual void drawPoints(PointMode mode, size_t count, const SkPoint pts[],
+                          const SkPaint& paint) OVERRIDE;
+  virtual void drawRect(const SkRect& rect, const SkPaint& paint) OVERRIDE;
+  virtual void drawPath(const SkPath& path, const SkPaint& paint) OVERRIDE;
+  virtual void drawBitmap(const SkBitmap& bitmap, SkScalar left, SkScalar top,
+                          const SkPaint* paint = NULL) OVERRIDE;
+  virtual void drawBitmapRect(const SkBitmap& bitmap, const SkIRect* src,
+                              const SkRect& dst,
+                              const SkPaint* paint = NULL) OVERRIDE;
+  virtual void drawBitmapMatrix(const SkBitmap& bitmap, const SkMatrix& m,
+                                const SkPaint* paint = NULL) OVERRIDE;
+  virtual void drawBitmapNine(const SkBitmap& bitmap, const SkIRect& center,
+                              const SkRect& dst,
+                              const SkPaint* paint = NULL) OVERRIDE;
+  virtual void drawSprite(const SkBitmap& bitmap, int left, int top,
+                          const SkPaint* paint = NULL) OVERRIDE;
+  virtual void drawText(const void* text, size_t byte_length, SkScalar x,
+                        SkScalar y, const SkPaint& paint) OVERRIDE;
+  virtual void drawPosText(const void* text, size_t byte_length,
+                           const SkPoint pos[], const SkPaint& paint) OVERRIDE;
+  virtual void drawPosTextH(const void* text, size_t byte_length,
+                            const SkScalar xpos[], SkScalar const_y,
+                            const SkPaint& paint) OVERRIDE;
+  virtual void drawTextOnPath(const void* text, size_t byte_length,
+                              const SkPath& path, const SkMatrix* matrix,
+                              const SkPaint& paint) OVERRIDE;
+  virtual void drawPicture(SkPicture& picture) OVERRIDE;
+  virtual void drawVertices(VertexMode mode, int vertex_count,
+                            const SkPoint vertices[], const SkPoint texs[],
+                            const SkColor colors[], SkXfermode* xmode,
+                            const uint16_t indices[], int index_count,
+                            const SkPaint& paint) OVERRIDE;
+  virtual void drawData(const void* data, size_t length) OVERRIDE;
+
+ private:
+  // Owned by |picture_|.
+  SkCanvas* recorder_;
+  SkPicture* picture_;
+
+  int op_count_;
+  bool recorded_all_;
+
+  // Given to the platform calls, created as needed.
+  scoped_ptr<CanvasSkia> platform_canvas_;
+
+  DISALLOW_COPY_AND_ASSIGN(RecordingCanvas);
+};
+
+}  // namespace gfx
+
+#endif  // UI_GFX_RECORDING_CANVAS_H_
@@ -6,6 +6,9 @@
 
 Texture2D textureMap;
 
+// The texture sampled by the mask and blend filters.
+Texture2D filterMap;
+
 // Blender to give source-over for textures.
 BlendState SrcAlphaBlendingAdd {
   BlendEnable[0] = TRUE;
@@ -26,6 +29,11 @@ DepthStencilState StencilState {
 
 cbuffer cbPerObject {
   float4x4 gWVP;
+
+  // Map the position of a vertex, in pixels of the layer, to the coordinates
+  // of |filterMap|.
+  float2 filterScale;
+  float2 filterOffset;
 };
 
 struct VS_IN {
@@ -36,6 +44,7 @@ struct VS_IN {
 struct VS_OUT {
   float4 posW : SV_POSITION;
   float2 texC : TEXC;
+  float2 filterC : FILTERC;
 };
 
 SamplerState Sampler {
@@ -48,15 +57,103 @@ VS_OUT VS(VS_IN vIn) {
   VS_OUT vOut;
   vOut.posW = mul(float4(vIn.posL, 1.0f), gWVP);
   vOut.texC = vIn.texC;
+  // The y of the vertices is flipped.
+  vOut.filterC = float2(vIn.posL.x, -vIn.posL.y) * filterScale + filterOffset;
   return vOut;
 }
 
 float alpha = 1.0f;
 
+// The parameters of the filters, see ui::TextureFilter. The components of
+// |hslShift| that are negative leave hue, saturation or lightness unchanged.
+float filterAmount = 1.0f;
+float3 hslShift = float3(-1.0f, -1.0f, -1.0f);
+
 float4 PS(VS_OUT pIn) : SV_Target {
   return textureMap.Sample(Sampler, float2(pIn.texC)) * alpha;
 }
 
+float4 GrayscalePS(VS_OUT pIn) : SV_Target {
+  // The colors are premultiplied, which the luminance is linear in.
+  float4 color = textureMap.Sample(Sampler, float2(pIn.texC));
+  float luma = dot(color.rgb, float3(0.299f, 0.587f, 0.114f));
+  color.rgb = lerp(color.rgb, float3(luma, luma, luma), filterAmount);
+  return color * alpha;
+}
+
+float3 RGBToHSL(float3 rgb) {
+  float max_c = max(rgb.r, max(rgb.g, rgb.b));
+  float min_c = min(rgb.r, min(rgb.g, rgb.b));
+  float l = (max_c + min_c) / 2.0f;
+  float delta = max_c - min_c;
+  if (delta == 0.0f)
+    return float3(0.0f, 0.0f, l);
+  float s = l > 0.5f ? delta / (2.0f - max_c - min_c) :
+                       delta / (max_c + min_c);
+  float h;
+  if (max_c == rgb.r)
+    h = (rgb.g - rgb.b) / delta + (rgb.g < rgb.b ? 6.0f : 0.0f);
+  else if (max_c == rgb.g)
+    h = (rgb.b - rgb.r) / delta + 2.0f;
+  else
+    h = (rgb.r - rgb.g) / delta + 4.0f;
+  return float3(h / 6.0f, s, l);
+}
+
+float HueToRGB(float p, float q, float hue) {
+  hue = frac(hue);
+  if (hue < 1.0f / 6.0f)
+    return p + (q - p) * 6.0f * hue;
+  if (hue < 0.5f)
+    return q;
+  if (hue < 2.0f / 3.0f)
+    return p + (q - p) * (2.0f / 3.0f - hue) * 6.0f;
+  return p;
+}
+
+float3 HSLToRGB(float3 hsl) {
+  if (hsl.y == 0.0f)
+    return float3(hsl.z, hsl.z, hsl.z);
+  float q = hsl.z < 0.5f ? hsl.z * (1.0f + hsl.y) :
+                           hsl.z + hsl.y - hsl.z * hsl.y;
+  float p = 2.0f * hsl.z - q;
+  return float3(HueToRGB(p, q, hsl.x + 1.0f / 3.0f),
+                HueToRGB(p, q, hsl.x),
+                HueToRGB(p, q, hsl.x - 1.0f / 3.0f));
+}
+
+// Shifts the colors as color_utils::HSLShift() does.
+float4 HSLShiftPS(VS_OUT pIn) : SV_Target {
+  float4 color = textureMap.Sample(Sampler, float2(pIn.texC));
+  if (color.a == 0.0f)
+    return color;
+  float3 hsl = RGBToHSL(color.rgb / color.a);
+  if (hslShift.x >= 0.0f)
+    hsl.x = hslShift.x;
+  if (hslShift.y >= 0.0f) {
+    hsl.y = hslShift.y <= 0.5f ? hsl.y * hslShift.y * 2.0f :
+                                 hsl.y + (1.0f - hsl.y) *
+                                         (hslShift.y - 0.5f) * 2.0f;
+  }
+  float3 rgb = HSLToRGB(hsl);
+  if (hslShift.z >= 0.0f) {
+    rgb = hslShift.z <= 0.5f ? rgb * hslShift.z * 2.0f :
+                               rgb + (1.0f - rgb) * (hslShift.z - 0.5f) * 2.0f;
+  }
+  return float4(rgb * color.a, color.a) * alpha;
+}
+
+float4 MaskPS(VS_OUT pIn) : SV_Target {
+  float4 color = textureMap.Sample(Sampler, float2(pIn.texC));
+  return color * filterMap.Sample(Sampler, float2(pIn.filterC)).a * alpha;
+}
+
+float4 BlendPS(VS_OUT pIn) : SV_Target {
+  float4 color = textureMap.Sample(Sampler, float2(pIn.texC));
+  float4 other = filterMap.Sample(Sampler, float2(pIn.filterC));
+  return lerp(color, other, filterAmount) * alpha;
+}
+
 technique10 ViewTech {
   pass P0 {
     SetVertexShader(CompileShader(vs_4_0, VS()));
@@ -67,3 +164,47 @@ technique10 ViewTech {
                   0xFFFFFFFF);
   }
 }
+
+technique10 GrayscaleTech {
+  pass P0 {
+    SetVertexShader(CompileShader(vs_4_0, VS()));
+    SetGeometryShader(NULL);
+    SetPixelShader(CompileShader(ps_4_0, GrayscalePS()));
+    SetDepthStencilState(StencilState, 0);
+    SetBlendState(SrcAlphaBlendingAdd, float4(0.0f, 0.0f, 0.0f, 0.0f),
+                  0xFFFFFFFF);
+  }
+}
+
+technique10 HSLShiftTech {
+  pass P0 {
+    SetVertexShader(CompileShader(vs_4_0, VS()));
+    SetGeometryShader(NULL);
+    SetPixelShader(CompileShader(ps_4_0, HSLShiftPS()));
+    SetDepthStencilState(StencilState, 0);
+    SetBlendState(SrcAlphaBlendingAdd, float4(0.0f, 0.0f, 0.0f, 0.0f),
+                  0xFFFFFFFF);
+  }
+}
+
+technique10 MaskTech {
+  pass P0 {
+    SetVertexShader(CompileShader(vs_4_0, VS()));
+    SetGeometryShader(NULL);
+    SetPixelShader(CompileShader(ps_4_0, MaskPS()));
+    SetDepthStencilState(StencilState, 0);
+    SetBlendState(SrcAlphaBlendingAdd, float4(0.0f, 0.0f, 0.0f, 0.0f),
+                  0xFFFFFFFF);
+  }
+}
+
+technique10 BlendTech {
+  pass P0 {
+    SetVertexShader(CompileShader(vs_4_0, VS()));
+    SetGeometryShader(NULL);
+    SetPixelShader(CompileShader(ps_4_0, BlendPS()));
+    SetDepthStencilState(StencilState, 0);
+    SetBlendState(SrcAlphaBlendingAdd, float4(0.0f, 0.0f, 0.0f, 0.0f),
+                  0xFFFFFFFF);
+  }
+}
@@ -0,0 +1,13 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/at_exit.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+int main(int argc, char** argv) {
+  // For the LazyInstances and Singletons of the code under test.
+  base::AtExitManager at_exit_manager;
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
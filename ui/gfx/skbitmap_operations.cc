@@ -5,13 +5,274 @@
 #include "ui/gfx/skbitmap_operations.h"
 
 #include <algorithm>
+#include <list>
+#include <map>
 #include <string.h>
 
+#include "base/lazy_instance.h"
 #include "base/logging.h"
+#include "base/synchronization/lock.h"
+#include "skia/ext/convolver.h"
 #include "third_party/skia/include/core/SkBitmap.h"
-#include "third_party/skia/include/core/SkCanvas.h"
 #include "third_party/skia/include/core/SkColorPriv.h"
+#include "third_party/skia/include/core/SkPixelRef.h"
 #include "third_party/skia/include/core/SkUnPreMultiply.h"
+#include "ui/gfx/skbitmap_operations_simd.h"
+
+#if defined(SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Row kernels -----------------------------------------------------------------
+
+// The C versions of the per-pixel loops that have SIMD versions; see
+// skbitmap_operations_simd.h.
+
+void BlendRow_C(const uint32* first, const uint32* second, double alpha,
+                int width, uint32* out) {
+  double first_alpha = 1 - alpha;
+
+  for (int x = 0; x < width; ++x) {
+    uint32 first_pixel = first[x];
+    uint32 second_pixel = second[x];
+
+    int a = static_cast<int>((SkColorGetA(first_pixel) * first_alpha) +
+                             (SkColorGetA(second_pixel) * alpha));
+    int r = static_cast<int>((SkColorGetR(first_pixel) * first_alpha) +
+                             (SkColorGetR(second_pixel) * alpha));
+    int g = static_cast<int>((SkColorGetG(first_pixel) * first_alpha) +
+                             (SkColorGetG(second_pixel) * alpha));
+    int b = static_cast<int>((SkColorGetB(first_pixel) * first_alpha) +
+                             (SkColorGetB(second_pixel) * alpha));
+
+    out[x] = SkColorSetARGB(a, r, g, b);
+  }
+}
+
+void MaskRow_C(const uint32* rgb, const uint32* alpha, int width,
+               uint32* out) {
+  for (int x = 0; x < width; ++x) {
+    SkColor rgb_pixel = SkUnPreMultiply::PMColorToColor(rgb[x]);
+    int a = SkAlphaMul(SkColorGetA(rgb_pixel), SkColorGetA(alpha[x]));
+    out[x] = SkColorSetARGB(a,
+                            SkAlphaMul(SkColorGetR(rgb_pixel), a),
+                            SkAlphaMul(SkColorGetG(rgb_pixel), a),
+                            SkAlphaMul(SkColorGetB(rgb_pixel), a));
+  }
+}
+
+void SrcOverRow_C(const uint32* src, int width, uint32* dst) {
+  for (int x = 0; x < width; ++x)
+    dst[x] = SkPMSrcOver(src[x], dst[x]);
+}
+
+void UnPreMultiplyRow_C(const uint32* src, int width, uint32* out) {
+  for (int x = 0; x < width; ++x)
+    out[x] = SkUnPreMultiply::PMColorToColor(src[x]);
+}
+
+#if defined(SIMD_SSE2)
+
+// Blends two channels, 32 bits each in the low half of the registers, with
+// the same double precision operations as the C version, so that the
+// truncated results are the same.
+inline __m128i BlendChannels_SSE2(__m128i first, __m128i second,
+                                  __m128d first_alpha, __m128d second_alpha) {
+  __m128d sum = _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(first), first_alpha),
+                           _mm_mul_pd(_mm_cvtepi32_pd(second), second_alpha));
+  return _mm_cvttpd_epi32(sum);
+}
+
+// Blends the four channels of one pixel, 32 bits each.
+inline __m128i BlendPixel_SSE2(__m128i first, __m128i second,
+                               __m128d first_alpha, __m128d second_alpha) {
+  __m128i low = BlendChannels_SSE2(first, second, first_alpha, second_alpha);
+  __m128i high = BlendChannels_SSE2(_mm_srli_si128(first, 8),
+                                    _mm_srli_si128(second, 8),
+                                    first_alpha, second_alpha);
+  return _mm_unpacklo_epi64(low, high);
+}
+
+int BlendRow_SSE2(const uint32* first, const uint32* second, double alpha,
+                  int width, uint32* out) {
+  const __m128d first_alpha = _mm_set1_pd(1 - alpha);
+  const __m128d second_alpha = _mm_set1_pd(alpha);
+  const __m128i zero = _mm_setzero_si128();
+
+  int x = 0;
+  for (; x + 2 <= width; x += 2) {
+    __m128i f = _mm_unpacklo_epi8(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(first + x)), zero);
+    __m128i s = _mm_unpacklo_epi8(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(second + x)), zero);
+    __m128i p0 = BlendPixel_SSE2(_mm_unpacklo_epi16(f, zero),
+                                 _mm_unpacklo_epi16(s, zero),
+                                 first_alpha, second_alpha);
+    __m128i p1 = BlendPixel_SSE2(_mm_unpackhi_epi16(f, zero),
+                                 _mm_unpackhi_epi16(s, zero),
+                                 first_alpha, second_alpha);
+    // The channels are all in 0..255, so the saturating packs are exact.
+    __m128i pixels = _mm_packus_epi16(_mm_packs_epi32(p0, p1), zero);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), pixels);
+  }
+  return x;
+}
+
+// SkUnPreMultiply::ApplyScale() of four components. SSE2 has no 32 bit
+// multiply, so the product of the 32 bit scale and the 8 bit component is
+// put together from the 16 bit products of each half of the scale; it wraps
+// around exactly like the C one.
+inline __m128i ApplyScale_SSE2(__m128i scale, __m128i component) {
+  __m128i c = _mm_or_si128(component, _mm_slli_epi32(component, 16));
+  __m128i product = _mm_add_epi32(
+      _mm_mullo_epi16(scale, c),
+      _mm_slli_epi32(_mm_mulhi_epu16(scale, c), 16));
+  return _mm_srli_epi32(_mm_add_epi32(product, _mm_set1_epi32(1 << 23)), 24);
+}
+
+// Unpremultiplies the four pixels at |src| into one register per channel, 32
+// bits per pixel.
+inline void UnPreMultiplyPixels_SSE2(const uint32* src, __m128i* a,
+                                     __m128i* r, __m128i* g, __m128i* b) {
+  const SkUnPreMultiply::Scale* table = SkUnPreMultiply::GetScaleTable();
+  const __m128i mask = _mm_set1_epi32(0xFF);
+
+  __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  __m128i scale = _mm_setr_epi32(static_cast<int>(table[src[0] >> 24]),
+                                 static_cast<int>(table[src[1] >> 24]),
+                                 static_cast<int>(table[src[2] >> 24]),
+                                 static_cast<int>(table[src[3] >> 24]));
+  *a = _mm_srli_epi32(pixels, 24);
+  *r = ApplyScale_SSE2(scale, _mm_and_si128(_mm_srli_epi32(pixels, 16), mask));
+  *g = ApplyScale_SSE2(scale, _mm_and_si128(_mm_srli_epi32(pixels, 8), mask));
+  *b = ApplyScale_SSE2(scale, _mm_and_si128(pixels, mask));
+}
+
+inline __m128i PackPixels_SSE2(__m128i a, __m128i r, __m128i g, __m128i b) {
+  return _mm_or_si128(
+      _mm_or_si128(_mm_slli_epi32(a, 24), _mm_slli_epi32(r, 16)),
+      _mm_or_si128(_mm_slli_epi32(g, 8), b));
+}
+
+int MaskRow_SSE2(const uint32* rgb, const uint32* alpha, int width,
+                 uint32* out) {
+  int x = 0;
+  for (; x + 4 <= width; x += 4) {
+    __m128i a, r, g, b;
+    UnPreMultiplyPixels_SSE2(rgb + x, &a, &r, &g, &b);
+    __m128i mask_a = _mm_srli_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(alpha + x)), 24);
+
+    // All the products fit in 16 bits, so 16 bit multiplies are exact.
+    a = _mm_srli_epi32(_mm_mullo_epi16(a, mask_a), 8);
+    r = _mm_srli_epi32(_mm_mullo_epi16(r, a), 8);
+    g = _mm_srli_epi32(_mm_mullo_epi16(g, a), 8);
+    b = _mm_srli_epi32(_mm_mullo_epi16(b, a), 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x),
+                     PackPixels_SSE2(a, r, g, b));
+  }
+  return x;
+}
+
+int SrcOverRow_SSE2(const uint32* src, int width, uint32* dst) {
+  const __m128i rb_mask = _mm_set1_epi32(0x00FF00FF);
+  const __m128i c_256 = _mm_set1_epi16(0x0100);
+
+  int x = 0;
+  for (; x + 4 <= width; x += 4) {
+    __m128i src_pixels =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+    __m128i dst_pixels =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + x));
+
+    // 256 - alpha of the source, in both 16 bit halves of each pixel.
+    __m128i scale = _mm_srli_epi16(src_pixels, 8);
+    scale = _mm_shufflehi_epi16(scale, 0xF5);
+    scale = _mm_shufflelo_epi16(scale, 0xF5);
+    scale = _mm_sub_epi16(c_256, scale);
+
+    // SkAlphaMulQ() of the destination.
+    __m128i dst_rb = _mm_and_si128(rb_mask, dst_pixels);
+    __m128i dst_ag = _mm_srli_epi16(dst_pixels, 8);
+    dst_rb = _mm_srli_epi16(_mm_mullo_epi16(dst_rb, scale), 8);
+    dst_ag = _mm_andnot_si128(rb_mask, _mm_mullo_epi16(dst_ag, scale));
+
+    // 32 bit additions, like the C version.
+    __m128i result = _mm_add_epi32(src_pixels, _mm_or_si128(dst_rb, dst_ag));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), result);
+  }
+  return x;
+}
+
+int UnPreMultiplyRow_SSE2(const uint32* src, int width, uint32* out) {
+  int x = 0;
+  for (; x + 4 <= width; x += 4) {
+    __m128i a, r, g, b;
+    UnPreMultiplyPixels_SSE2(src + x, &a, &r, &g, &b);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x),
+                     PackPixels_SSE2(a, r, g, b));
+  }
+  return x;
+}
+
+#endif  // defined(SIMD_SSE2)
+
+// Fills |procs| with the kernels for the instruction set picked by
+// skia::BestConvolutionSIMD(), or with NULL to use the C versions only.
+void SetupProcs(gfx::SkBitmapOperationsProcs* procs) {
+  memset(procs, 0, sizeof(*procs));
+  // The kernels read the channels of SkPMColors at the positions they have in
+  // SkColors, like the C versions do through SkColorGetA() and friends.
+#if SK_A32_SHIFT == 24 && SK_R32_SHIFT == 16 && SK_G32_SHIFT == 8 && \
+    SK_B32_SHIFT == 0
+  skia::ConvolutionSIMD simd = skia::BestConvolutionSIMD();
+  if (simd == skia::CONVOLUTION_SIMD_AVX2 &&
+      gfx::SetupAVX2SkBitmapOperationsProcs(procs))
+    return;
+#if defined(SIMD_SSE2)
+  if (simd == skia::CONVOLUTION_SIMD_AVX2 ||
+      simd == skia::CONVOLUTION_SIMD_SSE2) {
+    procs->blend_row = &BlendRow_SSE2;
+    procs->mask_row = &MaskRow_SSE2;
+    procs->src_over_row = &SrcOverRow_SSE2;
+    procs->unpremultiply_row = &UnPreMultiplyRow_SSE2;
+  }
+#endif
+#endif
+}
+
+// Run the kernel of |procs| if there is one, and the C version on the rest of
+// the row.
+void BlendRow(const gfx::SkBitmapOperationsProcs& procs,
+              const uint32* first, const uint32* second, double alpha,
+              int width, uint32* out) {
+  int done = procs.blend_row ?
+      procs.blend_row(first, second, alpha, width, out) : 0;
+  BlendRow_C(first + done, second + done, alpha, width - done, out + done);
+}
+
+void MaskRow(const gfx::SkBitmapOperationsProcs& procs,
+             const uint32* rgb, const uint32* alpha, int width, uint32* out) {
+  int done = procs.mask_row ? procs.mask_row(rgb, alpha, width, out) : 0;
+  MaskRow_C(rgb + done, alpha + done, width - done, out + done);
+}
+
+void SrcOverRow(const gfx::SkBitmapOperationsProcs& procs,
+                const uint32* src, int width, uint32* dst) {
+  int done = procs.src_over_row ? procs.src_over_row(src, width, dst) : 0;
+  SrcOverRow_C(src + done, width - done, dst + done);
+}
+
+void UnPreMultiplyRow(const gfx::SkBitmapOperationsProcs& procs,
+                      const uint32* src, int width, uint32* out) {
+  int done = procs.unpremultiply_row ?
+      procs.unpremultiply_row(src, width, out) : 0;
+  UnPreMultiplyRow_C(src + done, width - done, out + done);
+}
+
+}  // namespace
 
 // static
 SkBitmap SkBitmapOperations::CreateInvertedBitmap(const SkBitmap& image) {
@@ -54,18 +315,23 @@ SkBitmap SkBitmapOperations::CreateSuperimposedBitmap(const SkBitmap& first,
   superimposed.setConfig(SkBitmap::kARGB_8888_Config,
                          first.width(), first.height());
   superimposed.allocPixels();
-  superimposed.eraseARGB(0, 0, 0, 0);
-
-  SkCanvas canvas(superimposed);
-
-  SkRect rect;
-  rect.fLeft = 0;
-  rect.fTop = 0;
-  rect.fRight = SkIntToScalar(first.width());
-  rect.fBottom = SkIntToScalar(first.height());
-
-  canvas.drawBitmapRect(first, NULL, rect);
-  canvas.drawBitmapRect(second, NULL, rect);
+  SkAutoLockPixels lock_superimposed(superimposed);
+
+  // This gives what drawing both bitmaps on a transparent canvas gives: the
+  // first one drawn on transparent pixels is copied, and an opaque second one
+  // is copied too.
+  gfx::SkBitmapOperationsProcs procs;
+  SetupProcs(&procs);
+  size_t row_bytes = static_cast<size_t>(first.width()) * sizeof(uint32);
+  for (int y = 0; y < first.height(); ++y) {
+    uint32* dst_row = superimposed.getAddr32(0, y);
+    if (second.isOpaque()) {
+      memcpy(dst_row, second.getAddr32(0, y), row_bytes);
+    } else {
+      memcpy(dst_row, first.getAddr32(0, y), row_bytes);
+      SrcOverRow(procs, second.getAddr32(0, y), first.width(), dst_row);
+    }
+  }
 
   return superimposed;
 }
@@ -97,28 +363,11 @@ SkBitmap SkBitmapOperations::CreateBlendedBitmap(const SkBitmap& first,
   blended.allocPixels();
   blended.eraseARGB(0, 0, 0, 0);
 
-  double first_alpha = 1 - alpha;
-
+  gfx::SkBitmapOperationsProcs procs;
+  SetupProcs(&procs);
   for (int y = 0; y < first.height(); ++y) {
-    uint32* first_row = first.getAddr32(0, y);
-    uint32* second_row = second.getAddr32(0, y);
-    uint32* dst_row = blended.getAddr32(0, y);
-
-    for (int x = 0; x < first.width(); ++x) {
-      uint32 first_pixel = first_row[x];
-      uint32 second_pixel = second_row[x];
-
-      int a = static_cast<int>((SkColorGetA(first_pixel) * first_alpha) +
-                               (SkColorGetA(second_pixel) * alpha));
-      int r = static_cast<int>((SkColorGetR(first_pixel) * first_alpha) +
-                               (SkColorGetR(second_pixel) * alpha));
-      int g = static_cast<int>((SkColorGetG(first_pixel) * first_alpha) +
-                               (SkColorGetG(second_pixel) * alpha));
-      int b = static_cast<int>((SkColorGetB(first_pixel) * first_alpha) +
-                               (SkColorGetB(second_pixel) * alpha));
-
-      dst_row[x] = SkColorSetARGB(a, r, g, b);
-    }
+    BlendRow(procs, first.getAddr32(0, y), second.getAddr32(0, y), alpha,
+             first.width(), blended.getAddr32(0, y));
   }
 
   return blended;
@@ -142,19 +391,11 @@ SkBitmap SkBitmapOperations::CreateMaskedBitmap(const SkBitmap& rgb,
   SkAutoLockPixels lock_alpha(alpha);
   SkAutoLockPixels lock_masked(masked);
 
+  gfx::SkBitmapOperationsProcs procs;
+  SetupProcs(&procs);
   for (int y = 0; y < masked.height(); ++y) {
-    uint32* rgb_row = rgb.getAddr32(0, y);
-    uint32* alpha_row = alpha.getAddr32(0, y);
-    uint32* dst_row = masked.getAddr32(0, y);
-
-    for (int x = 0; x < masked.width(); ++x) {
-      SkColor rgb_pixel = SkUnPreMultiply::PMColorToColor(rgb_row[x]);
-      int alpha = SkAlphaMul(SkColorGetA(rgb_pixel), SkColorGetA(alpha_row[x]));
-      dst_row[x] = SkColorSetARGB(alpha,
-                                  SkAlphaMul(SkColorGetR(rgb_pixel), alpha),
-                                  SkAlphaMul(SkColorGetG(rgb_pixel), alpha),
-                                  SkAlphaMul(SkColorGetB(rgb_pixel), alpha));
-    }
+    MaskRow(procs, rgb.getAddr32(0, y), alpha.getAddr32(0, y), masked.width(),
+            masked.getAddr32(0, y));
   }
 
   return masked;
@@ -250,12 +491,55 @@ namespace HSLShift {
 //    |x * y == x_y_num / den|, and |xy_num2| if |x * y == x_y_num2 / den2|. In
 //    the latter case, notice that one can calculate |x_y_num2 = x_num * y_num|.
 
+// Remembers the colors that the default line processor shifted, since images
+// usually repeat colors and shifting one in floating point is slow. This is a
+// direct mapped cache, indexed by a hash of the premultiplied color.
+class ShiftedColorCache {
+ public:
+  explicit ShiftedColorCache(const color_utils::HSL& hsl_shift);
+
+  SkPMColor Shift(SkPMColor color) {
+    size_t slot = (color * 2654435761U) >> (32 - kSlotBits);
+    if (colors_[slot] != color) {
+      colors_[slot] = color;
+      shifted_[slot] = ShiftColor(color);
+    }
+    return shifted_[slot];
+  }
+
+ private:
+  enum { kSlotBits = 10 };
+
+  SkPMColor ShiftColor(SkPMColor color) const {
+    return SkPreMultiplyColor(color_utils::HSLShift(
+        SkUnPreMultiply::PMColorToColor(color), hsl_shift_));
+  }
+
+  const color_utils::HSL hsl_shift_;
+  SkPMColor colors_[1 << kSlotBits];
+  SkPMColor shifted_[1 << kSlotBits];
+
+  DISALLOW_COPY_AND_ASSIGN(ShiftedColorCache);
+};
+
+ShiftedColorCache::ShiftedColorCache(const color_utils::HSL& hsl_shift)
+    : hsl_shift_(hsl_shift) {
+  // Start with every slot holding transparent black, so that there is no need
+  // to track empty slots.
+  SkPMColor shifted = ShiftColor(0);
+  for (int slot = 0; slot < (1 << kSlotBits); ++slot) {
+    colors_[slot] = 0;
+    shifted_[slot] = shifted;
+  }
+}
+
 // Routine used to process a line; typically specialized for specific kinds of
-// HSL shifts (to optimize).
+// HSL shifts (to optimize). Only the default one uses |cache|.
 typedef void (*LineProcessor)(const color_utils::HSL&,
                               const SkPMColor*,
                               SkPMColor*,
-                              int width);
+                              int width,
+                              ShiftedColorCache* cache);
 
 enum OperationOnH { kOpHNone = 0, kOpHShift, kNumHOps };
 enum OperationOnS { kOpSNone = 0, kOpSDec, kOpSInc, kNumSOps };
@@ -270,18 +554,18 @@ const double epsilon = 0.0005;
 void LineProcDefault(const color_utils::HSL& hsl_shift,
                      const SkPMColor* in,
                      SkPMColor* out,
-                     int width) {
-  for (int x = 0; x < width; x++) {
-    out[x] = SkPreMultiplyColor(color_utils::HSLShift(
-        SkUnPreMultiply::PMColorToColor(in[x]), hsl_shift));
-  }
+                     int width,
+                     ShiftedColorCache* cache) {
+  for (int x = 0; x < width; x++)
+    out[x] = cache->Shift(in[x]);
 }
 
 // Line processor: no-op (i.e., copy).
 void LineProcCopy(const color_utils::HSL& hsl_shift,
                   const SkPMColor* in,
                   SkPMColor* out,
-                  int width) {
+                  int width,
+                  ShiftedColorCache* cache) {
   DCHECK(hsl_shift.h < 0);
   DCHECK(hsl_shift.s < 0 || fabs(hsl_shift.s - 0.5) < HSLShift::epsilon);
   DCHECK(hsl_shift.l < 0 || fabs(hsl_shift.l - 0.5) < HSLShift::epsilon);
@@ -292,7 +576,8 @@ void LineProcCopy(const color_utils::HSL& hsl_shift,
 void LineProcHnopSnopLdec(const color_utils::HSL& hsl_shift,
                           const SkPMColor* in,
                           SkPMColor* out,
-                          int width) {
+                          int width,
+                          ShiftedColorCache* cache) {
   const uint32_t den = 65536;
 
   DCHECK(hsl_shift.h < 0);
@@ -316,7 +601,8 @@ void LineProcHnopSnopLdec(const color_utils::HSL& hsl_shift,
 void LineProcHnopSnopLinc(const color_utils::HSL& hsl_shift,
                           const SkPMColor* in,
                           SkPMColor* out,
-                          int width) {
+                          int width,
+                          ShiftedColorCache* cache) {
   const uint32_t den = 65536;
 
   DCHECK(hsl_shift.h < 0);
@@ -363,7 +649,8 @@ void LineProcHnopSnopLinc(const color_utils::HSL& hsl_shift,
 void LineProcHnopSdecLnop(const color_utils::HSL& hsl_shift,
                           const SkPMColor* in,
                           SkPMColor* out,
-                          int width) {
+                          int width,
+                          ShiftedColorCache* cache) {
   DCHECK(hsl_shift.h < 0);
   DCHECK(hsl_shift.s >= 0 && hsl_shift.s <= 0.5 - HSLShift::epsilon);
   DCHECK(hsl_shift.l < 0 || fabs(hsl_shift.l - 0.5) < HSLShift::epsilon);
@@ -400,7 +687,8 @@ void LineProcHnopSdecLnop(const color_utils::HSL& hsl_shift,
 void LineProcHnopSdecLdec(const color_utils::HSL& hsl_shift,
                           const SkPMColor* in,
                           SkPMColor* out,
-                          int width) {
+                          int width,
+                          ShiftedColorCache* cache) {
   DCHECK(hsl_shift.h < 0);
   DCHECK(hsl_shift.s >= 0 && hsl_shift.s <= 0.5 - HSLShift::epsilon);
   DCHECK(hsl_shift.l >= 0 && hsl_shift.l <= 0.5 - HSLShift::epsilon);
@@ -439,7 +727,8 @@ void LineProcHnopSdecLdec(const color_utils::HSL& hsl_shift,
 void LineProcHnopSdecLinc(const color_utils::HSL& hsl_shift,
                           const SkPMColor* in,
                           SkPMColor* out,
-                          int width) {
+                          int width,
+                          ShiftedColorCache* cache) {
   DCHECK(hsl_shift.h < 0);
   DCHECK(hsl_shift.s >= 0 && hsl_shift.s <= 0.5 - HSLShift::epsilon);
   DCHECK(hsl_shift.l >= 0.5 + HSLShift::epsilon && hsl_shift.l <= 1);
@@ -515,7 +804,399 @@ const LineProcessor kLineProcessors[kNumHOps][kNumSOps][kNumLOps] = {
   }
 };
 
+#if defined(SIMD_SSE2)
+
+// SSE2 versions of the fixed-point line processors. They compute exactly what
+// the C versions compute, including the wraparound of their 32 bit arithmetic,
+// four pixels at a time, and leave the end of the line to the C versions.
+// SSE2 has no 32 bit multiplication, minimum or maximum, so the helpers below
+// build them from other instructions.
+
+// The low 32 bits of the products of the 32 bit values of |a| and |b|, which
+// are the same for signed and unsigned values.
+inline __m128i MulLo32(__m128i a, __m128i b) {
+  __m128i even = _mm_mul_epu32(a, b);
+  __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Signed division by 2^|shift|, rounding towards zero like C division does.
+template<int shift>
+inline __m128i DivPow2(__m128i x) {
+  __m128i bias = _mm_srli_epi32(_mm_srai_epi32(x, 31), 32 - shift);
+  return _mm_srai_epi32(_mm_add_epi32(x, bias), shift);
+}
+
+inline __m128i Max32(__m128i a, __m128i b) {
+  __m128i a_greater = _mm_cmpgt_epi32(a, b);
+  return _mm_or_si128(_mm_and_si128(a_greater, a),
+                      _mm_andnot_si128(a_greater, b));
+}
+
+inline __m128i Min32(__m128i a, __m128i b) {
+  __m128i a_greater = _mm_cmpgt_epi32(a, b);
+  return _mm_or_si128(_mm_and_si128(a_greater, b),
+                      _mm_andnot_si128(a_greater, a));
+}
+
+// Splits four pixels into one register per channel, 32 bits per pixel.
+inline void LoadPixels(const SkPMColor* in, __m128i* a, __m128i* r,
+                       __m128i* g, __m128i* b) {
+  const __m128i mask = _mm_set1_epi32(0xFF);
+  __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+  *a = _mm_and_si128(_mm_srli_epi32(pixels, SK_A32_SHIFT), mask);
+  *r = _mm_and_si128(_mm_srli_epi32(pixels, SK_R32_SHIFT), mask);
+  *g = _mm_and_si128(_mm_srli_epi32(pixels, SK_G32_SHIFT), mask);
+  *b = _mm_and_si128(_mm_srli_epi32(pixels, SK_B32_SHIFT), mask);
+}
+
+// SkPackARGB32() of four pixels.
+inline void StorePixels(SkPMColor* out, __m128i a, __m128i r, __m128i g,
+                        __m128i b) {
+  __m128i pixels = _mm_or_si128(
+      _mm_or_si128(_mm_slli_epi32(a, SK_A32_SHIFT),
+                   _mm_slli_epi32(r, SK_R32_SHIFT)),
+      _mm_or_si128(_mm_slli_epi32(g, SK_G32_SHIFT),
+                   _mm_slli_epi32(b, SK_B32_SHIFT)));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), pixels);
+}
+
+// (vmax + vmin) of four pixels.
+inline __m128i MaxPlusMin(__m128i r, __m128i g, __m128i b) {
+  return _mm_add_epi32(Max32(Max32(r, g), b), Min32(Min32(r, g), b));
+}
+
+void LineProcHnopSnopLdec_SSE2(const color_utils::HSL& hsl_shift,
+                               const SkPMColor* in,
+                               SkPMColor* out,
+                               int width,
+                               ShiftedColorCache* cache) {
+  const uint32_t den = 65536;
+  const __m128i ldec_num =
+      _mm_set1_epi32(static_cast<uint32_t>(hsl_shift.l * 2 * den));
+  int x = 0;
+  for (; x + 4 <= width; x += 4) {
+    __m128i a, r, g, b;
+    LoadPixels(in + x, &a, &r, &g, &b);
+    r = _mm_srli_epi32(MulLo32(r, ldec_num), 16);
+    g = _mm_srli_epi32(MulLo32(g, ldec_num), 16);
+    b = _mm_srli_epi32(MulLo32(b, ldec_num), 16);
+    StorePixels(out + x, a, r, g, b);
+  }
+  LineProcHnopSnopLdec(hsl_shift, in + x, out + x, width - x, cache);
+}
+
+void LineProcHnopSnopLinc_SSE2(const color_utils::HSL& hsl_shift,
+                               const SkPMColor* in,
+                               SkPMColor* out,
+                               int width,
+                               ShiftedColorCache* cache) {
+  const uint32_t den = 65536;
+  const __m128i linc_num =
+      _mm_set1_epi32(static_cast<uint32_t>((hsl_shift.l - 0.5) * 2 * den));
+  int x = 0;
+  for (; x + 4 <= width; x += 4) {
+    __m128i a, r, g, b;
+    LoadPixels(in + x, &a, &r, &g, &b);
+    r = _mm_add_epi32(r, _mm_srli_epi32(
+        MulLo32(_mm_sub_epi32(a, r), linc_num), 16));
+    g = _mm_add_epi32(g, _mm_srli_epi32(
+        MulLo32(_mm_sub_epi32(a, g), linc_num), 16));
+    b = _mm_add_epi32(b, _mm_srli_epi32(
+        MulLo32(_mm_sub_epi32(a, b), linc_num), 16));
+    StorePixels(out + x, a, r, g, b);
+  }
+  LineProcHnopSnopLinc(hsl_shift, in + x, out + x, width - x, cache);
+}
+
+void LineProcHnopSdecLnop_SSE2(const color_utils::HSL& hsl_shift,
+                               const SkPMColor* in,
+                               SkPMColor* out,
+                               int width,
+                               ShiftedColorCache* cache) {
+  const int32_t denom = 65536;
+  const __m128i s_numer =
+      _mm_set1_epi32(static_cast<int32_t>(hsl_shift.s * 2 * denom));
+  int x = 0;
+  for (; x + 4 <= width; x += 4) {
+    __m128i a, r, g, b;
+    LoadPixels(in + x, &a, &r, &g, &b);
+    __m128i max_plus_min = MaxPlusMin(r, g, b);
+    // denom_l - s_numer_l.
+    __m128i base = _mm_sub_epi32(_mm_slli_epi32(max_plus_min, 15),
+                                 DivPow2<1>(MulLo32(max_plus_min, s_numer)));
+    r = DivPow2<16>(_mm_add_epi32(base, MulLo32(r, s_numer)));
+    g = DivPow2<16>(_mm_add_epi32(base, MulLo32(g, s_numer)));
+    b = DivPow2<16>(_mm_add_epi32(base, MulLo32(b, s_numer)));
+    StorePixels(out + x, a, r, g, b);
+  }
+  LineProcHnopSdecLnop(hsl_shift, in + x, out + x, width - x, cache);
+}
+
+void LineProcHnopSdecLdec_SSE2(const color_utils::HSL& hsl_shift,
+                               const SkPMColor* in,
+                               SkPMColor* out,
+                               int width,
+                               ShiftedColorCache* cache) {
+  const int32_t denom = 1024;
+  const __m128i l_numer =
+      _mm_set1_epi32(static_cast<int32_t>(hsl_shift.l * 2 * denom));
+  const __m128i s_numer =
+      _mm_set1_epi32(static_cast<int32_t>(hsl_shift.s * 2 * denom));
+  int x = 0;
+  for (; x + 4 <= width; x += 4) {
+    __m128i a, r, g, b;
+    LoadPixels(in + x, &a, &r, &g, &b);
+    __m128i max_plus_min = MaxPlusMin(r, g, b);
+    __m128i base = _mm_sub_epi32(_mm_slli_epi32(max_plus_min, 9),
+                                 DivPow2<1>(MulLo32(max_plus_min, s_numer)));
+    r = DivPow2<20>(MulLo32(_mm_add_epi32(base, MulLo32(r, s_numer)),
+                            l_numer));
+    g = DivPow2<20>(MulLo32(_mm_add_epi32(base, MulLo32(g, s_numer)),
+                            l_numer));
+    b = DivPow2<20>(MulLo32(_mm_add_epi32(base, MulLo32(b, s_numer)),
+                            l_numer));
+    StorePixels(out + x, a, r, g, b);
+  }
+  LineProcHnopSdecLdec(hsl_shift, in + x, out + x, width - x, cache);
+}
+
+// (r * denom + (a * denom - r) * l_numer) / (denom * denom), for denom = 1024.
+inline __m128i LightenSdec(__m128i a, __m128i r, __m128i l_numer) {
+  __m128i lighter = MulLo32(_mm_sub_epi32(_mm_slli_epi32(a, 10), r), l_numer);
+  return DivPow2<20>(_mm_add_epi32(_mm_slli_epi32(r, 10), lighter));
+}
+
+void LineProcHnopSdecLinc_SSE2(const color_utils::HSL& hsl_shift,
+                               const SkPMColor* in,
+                               SkPMColor* out,
+                               int width,
+                               ShiftedColorCache* cache) {
+  const int32_t denom = 1024;
+  const __m128i l_numer =
+      _mm_set1_epi32(static_cast<int32_t>((hsl_shift.l - 0.5) * 2 * denom));
+  const __m128i s_numer =
+      _mm_set1_epi32(static_cast<int32_t>(hsl_shift.s * 2 * denom));
+  int x = 0;
+  for (; x + 4 <= width; x += 4) {
+    __m128i a, r, g, b;
+    LoadPixels(in + x, &a, &r, &g, &b);
+    __m128i max_plus_min = MaxPlusMin(r, g, b);
+    __m128i base = _mm_sub_epi32(_mm_slli_epi32(max_plus_min, 9),
+                                 DivPow2<1>(MulLo32(max_plus_min, s_numer)));
+    r = LightenSdec(a, _mm_add_epi32(base, MulLo32(r, s_numer)), l_numer);
+    g = LightenSdec(a, _mm_add_epi32(base, MulLo32(g, s_numer)), l_numer);
+    b = LightenSdec(a, _mm_add_epi32(base, MulLo32(b, s_numer)), l_numer);
+    StorePixels(out + x, a, r, g, b);
+  }
+  LineProcHnopSdecLinc(hsl_shift, in + x, out + x, width - x, cache);
+}
+
+// kLineProcessors, with the SSE2 versions where there are some.
+const LineProcessor kLineProcessorsSSE2[kNumHOps][kNumSOps][kNumLOps] = {
+  { // H: kOpHNone
+    { // S: kOpSNone
+      LineProcCopy,              // L: kOpLNone
+      LineProcHnopSnopLdec_SSE2, // L: kOpLDec
+      LineProcHnopSnopLinc_SSE2  // L: kOpLInc
+    },
+    { // S: kOpSDec
+      LineProcHnopSdecLnop_SSE2, // L: kOpLNone
+      LineProcHnopSdecLdec_SSE2, // L: kOpLDec
+      LineProcHnopSdecLinc_SSE2  // L: kOpLInc
+    },
+    { // S: kOpSInc
+      LineProcDefault, // L: kOpLNone
+      LineProcDefault, // L: kOpLDec
+      LineProcDefault  // L: kOpLInc
+    }
+  },
+  { // H: kOpHShift
+    { // S: kOpSNone
+      LineProcDefault, // L: kOpLNone
+      LineProcDefault, // L: kOpLDec
+      LineProcDefault  // L: kOpLInc
+    },
+    { // S: kOpSDec
+      LineProcDefault, // L: kOpLNone
+      LineProcDefault, // L: kOpLDec
+      LineProcDefault  // L: kOpLInc
+    },
+    { // S: kOpSInc
+      LineProcDefault, // L: kOpLNone
+      LineProcDefault, // L: kOpLDec
+      LineProcDefault  // L: kOpLInc
+    }
+  }
+};
+
+#endif  // defined(SIMD_SSE2)
+
 }  // namespace HSLShift
+
+// The shifted bitmaps most recently returned by CreateHSLShiftedBitmap(),
+// since themes shift the same images by the same amounts again and again.
+// Sources are identified by their pixel ref, the generation ID of their
+// pixels and their geometry. Only sources whose pixels are immutable are
+// cached: a caller writing to the pixels directly, without
+// notifyPixelsChanged(), would keep the generation ID.
+class HSLShiftedBitmapCache {
+ public:
+  HSLShiftedBitmapCache() : bytes_(0) {}
+
+  // Returns true and sets |shifted| if |bitmap| shifted by |hsl_shift| is in
+  // the cache.
+  bool Lookup(const SkBitmap& bitmap,
+              const color_utils::HSL& hsl_shift,
+              SkBitmap* shifted);
+
+  // Adds |bitmap| shifted by |hsl_shift|, evicting the least recently used
+  // bitmaps to stay within the budget.
+  void Insert(const SkBitmap& bitmap,
+              const color_utils::HSL& hsl_shift,
+              const SkBitmap& shifted);
+
+  void Clear();
+
+ private:
+  struct Key {
+    Key(const SkBitmap& bitmap, const color_utils::HSL& hsl_shift);
+    bool operator<(const Key& other) const;
+
+    const SkPixelRef* pixel_ref;
+    uint32_t generation_id;
+    size_t pixel_ref_offset;
+    int width;
+    int height;
+    size_t row_bytes;
+    double h;
+    double s;
+    double l;
+  };
+
+  struct Entry {
+    Entry(const Key& key, const SkBitmap& shifted)
+        : key(key),
+          shifted(shifted),
+          shifted_generation_id(shifted.getGenerationID()) {}
+
+    Key key;
+    SkBitmap shifted;
+    // Differs from the generation ID of |shifted| once a caller modified it.
+    uint32_t shifted_generation_id;
+  };
+
+  typedef std::list<Entry> EntryList;
+  typedef std::map<Key, EntryList::iterator> EntryMap;
+
+  // Total size of the pixels of the cached bitmaps.
+  static const size_t kMaxBytes = 4 * 1024 * 1024;
+
+  // Whether the pixels of |bitmap| are immutable. Without a pixel ref, the
+  // pixels have no generation ID.
+  static bool IsCacheable(const SkBitmap& bitmap) {
+    return bitmap.pixelRef() && bitmap.pixelRef()->isImmutable();
+  }
+
+  void Erase(EntryMap::iterator found);
+
+  base::Lock lock_;
+  EntryList entries_;  // Most recently used first.
+  EntryMap index_;
+  size_t bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(HSLShiftedBitmapCache);
+};
+
+HSLShiftedBitmapCache::Key::Key(const SkBitmap& bitmap,
+                                const color_utils::HSL& hsl_shift)
+    : pixel_ref(bitmap.pixelRef()),
+      generation_id(bitmap.getGenerationID()),
+      pixel_ref_offset(bitmap.pixelRefOffset()),
+      width(bitmap.width()),
+      height(bitmap.height()),
+      row_bytes(bitmap.rowBytes()),
+      h(hsl_shift.h),
+      s(hsl_shift.s),
+      l(hsl_shift.l) {
+}
+
+bool HSLShiftedBitmapCache::Key::operator<(const Key& other) const {
+  if (pixel_ref != other.pixel_ref)
+    return pixel_ref < other.pixel_ref;
+  if (generation_id != other.generation_id)
+    return generation_id < other.generation_id;
+  if (pixel_ref_offset != other.pixel_ref_offset)
+    return pixel_ref_offset < other.pixel_ref_offset;
+  if (width != other.width)
+    return width < other.width;
+  if (height != other.height)
+    return height < other.height;
+  if (row_bytes != other.row_bytes)
+    return row_bytes < other.row_bytes;
+  if (h != other.h)
+    return h < other.h;
+  if (s != other.s)
+    return s < other.s;
+  return l < other.l;
+}
+
+bool HSLShiftedBitmapCache::Lookup(const SkBitmap& bitmap,
+                                   const color_utils::HSL& hsl_shift,
+                                   SkBitmap* shifted) {
+  if (!IsCacheable(bitmap))
+    return false;
+
+  base::AutoLock lock(lock_);
+  EntryMap::iterator found = index_.find(Key(bitmap, hsl_shift));
+  if (found == index_.end())
+    return false;
+  Entry& entry = *found->second;
+  if (entry.shifted.getGenerationID() != entry.shifted_generation_id) {
+    Erase(found);
+    return false;
+  }
+  entries_.splice(entries_.begin(), entries_, found->second);
+  *shifted = entry.shifted;
+  return true;
+}
+
+void HSLShiftedBitmapCache::Insert(const SkBitmap& bitmap,
+                                   const color_utils::HSL& hsl_shift,
+                                   const SkBitmap& shifted) {
+  size_t size = shifted.getSize();
+  if (!IsCacheable(bitmap) || size > kMaxBytes)
+    return;
+
+  base::AutoLock lock(lock_);
+  Key key(bitmap, hsl_shift);
+  // Another thread may have shifted the same bitmap meanwhile.
+  if (index_.find(key) != index_.end())
+    return;
+  while (bytes_ + size > kMaxBytes)
+    Erase(index_.find(entries_.back().key));
+  entries_.push_front(Entry(key, shifted));
+  index_[key] = entries_.begin();
+  bytes_ += size;
+}
+
+void HSLShiftedBitmapCache::Clear() {
+  base::AutoLock lock(lock_);
+  entries_.clear();
+  index_.clear();
+  bytes_ = 0;
+}
+
+void HSLShiftedBitmapCache::Erase(EntryMap::iterator found) {
+  bytes_ -= found->second->shifted.getSize();
+  entries_.erase(found->second);
+  index_.erase(found);
+}
+
+base::LazyInstance<HSLShiftedBitmapCache> g_hsl_shifted_bitmap_cache(
+    base::LINKER_INITIALIZED);
+
 }  // namespace
 
 // static
@@ -544,11 +1225,20 @@ SkBitmap SkBitmapOperations::CreateHSLShiftedBitmap(
 
   HSLShift::LineProcessor line_proc =
       HSLShift::kLineProcessors[H_op][S_op][L_op];
+#if defined(SIMD_SSE2)
+  skia::ConvolutionSIMD simd = skia::BestConvolutionSIMD();
+  if (simd == skia::CONVOLUTION_SIMD_SSE2 ||
+      simd == skia::CONVOLUTION_SIMD_AVX2)
+    line_proc = HSLShift::kLineProcessorsSSE2[H_op][S_op][L_op];
+#endif
 
   DCHECK(bitmap.empty() == false);
   DCHECK(bitmap.config() == SkBitmap::kARGB_8888_Config);
 
   SkBitmap shifted;
+  if (g_hsl_shifted_bitmap_cache.Get().Lookup(bitmap, hsl_shift, &shifted))
+    return shifted;
+
   shifted.setConfig(SkBitmap::kARGB_8888_Config, bitmap.width(),
                     bitmap.height(), 0);
   shifted.allocPixels();
@@ -559,16 +1249,24 @@ SkBitmap SkBitmapOperations::CreateHSLShiftedBitmap(
   SkAutoLockPixels lock_shifted(shifted);
 
   // Loop through the pixels of the original bitmap.
+  HSLShift::ShiftedColorCache color_cache(hsl_shift);
   for (int y = 0; y < bitmap.height(); ++y) {
     SkPMColor* pixels = bitmap.getAddr32(0, y);
     SkPMColor* tinted_pixels = shifted.getAddr32(0, y);
 
-    (*line_proc)(hsl_shift, pixels, tinted_pixels, bitmap.width());
+    (*line_proc)(hsl_shift, pixels, tinted_pixels, bitmap.width(),
+                 &color_cache);
   }
 
+  g_hsl_shifted_bitmap_cache.Get().Insert(bitmap, hsl_shift, shifted);
   return shifted;
 }
 
+// static
+void SkBitmapOperations::ClearHSLShiftedBitmapCache() {
+  g_hsl_shifted_bitmap_cache.Get().Clear();
+}
+
 // static
 SkBitmap SkBitmapOperations::CreateTiledBitmap(const SkBitmap& source,
                                                int src_x, int src_y,
@@ -611,7 +1309,9 @@ SkBitmap SkBitmapOperations::DownsampleByTwoUntilSize(const SkBitmap& bitmap,
       (min_w < 0) || (min_h < 0))
     return bitmap;
 
-  // Since bitmaps are refcounted, this copy will be fast.
+  // Halve one step at a time: each step rounds down and repeats the last row
+  // and column of odd sizes, so one pass by the whole power of 2 would give
+  // other pixels. Since bitmaps are refcounted, this copy will be fast.
   SkBitmap current = bitmap;
   while ((current.width() >= min_w * 2) && (current.height() >= min_h * 2) &&
          (current.width() > 1) && (current.height() > 1))
@@ -625,63 +1325,26 @@ SkBitmap SkBitmapOperations::DownsampleByTwo(const SkBitmap& bitmap) {
   if ((bitmap.width() <= 1) || (bitmap.height() <= 1))
     return bitmap;
 
+  return DownsampleByFactor(bitmap, 2);
+}
+
+// static
+SkBitmap SkBitmapOperations::DownsampleByFactor(const SkBitmap& bitmap,
+                                                int factor) {
   SkBitmap result;
   result.setConfig(SkBitmap::kARGB_8888_Config,
-                   (bitmap.width() + 1) / 2, (bitmap.height() + 1) / 2);
+                   (bitmap.width() + factor - 1) / factor,
+                   (bitmap.height() + factor - 1) / factor);
   result.allocPixels();
 
   SkAutoLockPixels lock(bitmap);
-
-  const int resultLastX = result.width() - 1;
-  const int srcLastX = bitmap.width() - 1;
-
-  for (int dest_y = 0; dest_y < result.height(); ++dest_y) {
-    const int src_y = dest_y << 1;
-    const SkPMColor* SK_RESTRICT cur_src0 = bitmap.getAddr32(0, src_y);
-    const SkPMColor* SK_RESTRICT cur_src1 = cur_src0;
-    if (src_y + 1 < bitmap.height())
-      cur_src1 = bitmap.getAddr32(0, src_y + 1);
-
-    SkPMColor* SK_RESTRICT cur_dst = result.getAddr32(0, dest_y);
-
-    for (int dest_x = 0; dest_x <= resultLastX; ++dest_x) {
-      // This code is based on downsampleby2_proc32 in SkBitmap.cpp. It is very
-      // clever in that it does two channels at once: alpha and green ("ag")
-      // and red and blue ("rb"). Each channel gets averaged across 4 pixels
-      // to get the result.
-      int bump_x = (dest_x << 1) < srcLastX;
-      SkPMColor tmp, ag, rb;
-
-      // Top left pixel of the 2x2 block.
-      tmp = cur_src0[0];
-      ag = (tmp >> 8) & 0xFF00FF;
-      rb = tmp & 0xFF00FF;
-
-      // Top right pixel of the 2x2 block.
-      tmp = cur_src0[bump_x];
-      ag += (tmp >> 8) & 0xFF00FF;
-      rb += tmp & 0xFF00FF;
-
-      // Bottom left pixel of the 2x2 block.
-      tmp = cur_src1[0];
-      ag += (tmp >> 8) & 0xFF00FF;
-      rb += tmp & 0xFF00FF;
-
-      // Bottom right pixel of the 2x2 block.
-      tmp = cur_src1[bump_x];
-      ag += (tmp >> 8) & 0xFF00FF;
-      rb += tmp & 0xFF00FF;
-
-      // Put the channels back together, dividing each by 4 to get the average.
-      // |ag| has the alpha and green channels shifted right by 8 bits from
-      // there they should end up, so shifting left by 6 gives them in the
-      // correct position divided by 4.
-      *cur_dst++ = ((rb >> 2) & 0xFF00FF) | ((ag << 6) & 0xFF00FF00);
-
-      cur_src0 += 2;
-      cur_src1 += 2;
-    }
-  }
+  skia::BGRABoxDownsample(
+      static_cast<const unsigned char*>(bitmap.getPixels()),
+      static_cast<int>(bitmap.rowBytes()),
+      bitmap.width(), bitmap.height(), factor, factor,
+      static_cast<int>(result.rowBytes()),
+      static_cast<unsigned char*>(result.getPixels()),
+      skia::BestConvolutionSIMD());
 
   return result;
 }
@@ -700,13 +1363,11 @@ SkBitmap SkBitmapOperations::UnPreMultiply(const SkBitmap& bitmap) {
   {
     SkAutoLockPixels bitmap_lock(bitmap);
     SkAutoLockPixels opaque_bitmap_lock(opaque_bitmap);
+    gfx::SkBitmapOperationsProcs procs;
+    SetupProcs(&procs);
     for (int y = 0; y < opaque_bitmap.height(); y++) {
-      for (int x = 0; x < opaque_bitmap.width(); x++) {
-        uint32 src_pixel = *bitmap.getAddr32(x, y);
-        uint32* dst_pixel = opaque_bitmap.getAddr32(x, y);
-        SkColor unmultiplied = SkUnPreMultiply::PMColorToColor(src_pixel);
-        *dst_pixel = unmultiplied;
-      }
+      UnPreMultiplyRow(procs, bitmap.getAddr32(0, y), opaque_bitmap.width(),
+                       opaque_bitmap.getAddr32(0, y));
     }
   }
 
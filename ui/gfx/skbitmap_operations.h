@@ -62,9 +62,16 @@ class UI_EXPORT SkBitmapOperations {
   //    0 = remove all lightness (make all pixels black).
   //    0.5 = leave unchanged.
   //    1 = full lightness (make all pixels white).
+  // The recent results for the bitmaps whose pixels are immutable, see
+  // SkPixelRef::setImmutable(), are cached, keyed by the pixels of |bitmap|
+  // and by |hsl_shift|. The result may then share its pixels with those
+  // returned to other callers: copy it before modifying it.
   static SkBitmap CreateHSLShiftedBitmap(const SkBitmap& bitmap,
                                          const color_utils::HSL& hsl_shift);
 
+  // Empties the cache of CreateHSLShiftedBitmap().
+  static void ClearHSLShiftedBitmapCache();
+
   // Create a bitmap that is cropped from another bitmap. This is special
   // because it tiles the original bitmap, so your coordinates can extend
   // outside the bounds of the original image.
@@ -96,6 +103,10 @@ class UI_EXPORT SkBitmapOperations {
  private:
   SkBitmapOperations();  // Class for scoping only.
 
+  // Averages each |factor| x |factor| block of pixels; the last row and
+  // column are repeated to fill partial blocks.
+  static SkBitmap DownsampleByFactor(const SkBitmap& bitmap, int factor);
+
   FRIEND_TEST_ALL_PREFIXES(SkBitmapOperationsTest, DownsampleByTwo);
   FRIEND_TEST_ALL_PREFIXES(SkBitmapOperationsTest, DownsampleByTwoSmall);
 };
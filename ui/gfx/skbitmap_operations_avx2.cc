@@ -0,0 +1,173 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/gfx/skbitmap_operations_simd.h"
+
+#include "third_party/skia/include/core/SkUnPreMultiply.h"
+
+// This file is compiled with AVX2 code generation enabled (see ui.gyp), so
+// __AVX2__ tells whether the compiler supports it.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace gfx {
+
+#if defined(__AVX2__)
+
+namespace {
+
+// Blends the four channels of one pixel, 32 bits each, with the same double
+// precision operations as the C version, so that the truncated results are
+// the same.
+inline __m128i BlendPixel(__m128i first, __m128i second,
+                          __m256d first_alpha, __m256d second_alpha) {
+  __m256d sum = _mm256_add_pd(
+      _mm256_mul_pd(_mm256_cvtepi32_pd(first), first_alpha),
+      _mm256_mul_pd(_mm256_cvtepi32_pd(second), second_alpha));
+  return _mm256_cvttpd_epi32(sum);
+}
+
+int BlendRow_AVX2(const uint32* first, const uint32* second, double alpha,
+                  int width, uint32* out) {
+  const __m256d first_alpha = _mm256_set1_pd(1 - alpha);
+  const __m256d second_alpha = _mm256_set1_pd(alpha);
+
+  int x = 0;
+  for (; x + 4 <= width; x += 4) {
+    __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + x));
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(second + x));
+    __m128i p0 = BlendPixel(_mm_cvtepu8_epi32(f), _mm_cvtepu8_epi32(s),
+                            first_alpha, second_alpha);
+    __m128i p1 = BlendPixel(_mm_cvtepu8_epi32(_mm_srli_si128(f, 4)),
+                            _mm_cvtepu8_epi32(_mm_srli_si128(s, 4)),
+                            first_alpha, second_alpha);
+    __m128i p2 = BlendPixel(_mm_cvtepu8_epi32(_mm_srli_si128(f, 8)),
+                            _mm_cvtepu8_epi32(_mm_srli_si128(s, 8)),
+                            first_alpha, second_alpha);
+    __m128i p3 = BlendPixel(_mm_cvtepu8_epi32(_mm_srli_si128(f, 12)),
+                            _mm_cvtepu8_epi32(_mm_srli_si128(s, 12)),
+                            first_alpha, second_alpha);
+    // The channels are all in 0..255, so the saturating packs are exact.
+    __m128i pixels = _mm_packus_epi16(_mm_packs_epi32(p0, p1),
+                                      _mm_packs_epi32(p2, p3));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), pixels);
+  }
+  return x;
+}
+
+// SkUnPreMultiply::ApplyScale() of eight components. The 32 bit products wrap
+// around exactly like the C ones.
+inline __m256i ApplyScale(__m256i scale, __m256i component) {
+  __m256i product = _mm256_mullo_epi32(scale, component);
+  return _mm256_srli_epi32(
+      _mm256_add_epi32(product, _mm256_set1_epi32(1 << 23)), 24);
+}
+
+// Unpremultiplies eight pixels into one register per channel, 32 bits per
+// pixel.
+inline void UnPreMultiplyPixels(__m256i pixels, __m256i* a, __m256i* r,
+                                __m256i* g, __m256i* b) {
+  const int* table =
+      reinterpret_cast<const int*>(SkUnPreMultiply::GetScaleTable());
+  const __m256i mask = _mm256_set1_epi32(0xFF);
+
+  *a = _mm256_srli_epi32(pixels, 24);
+  __m256i scale = _mm256_i32gather_epi32(table, *a, 4);
+  *r = ApplyScale(scale, _mm256_and_si256(_mm256_srli_epi32(pixels, 16), mask));
+  *g = ApplyScale(scale, _mm256_and_si256(_mm256_srli_epi32(pixels, 8), mask));
+  *b = ApplyScale(scale, _mm256_and_si256(pixels, mask));
+}
+
+inline __m256i PackPixels(__m256i a, __m256i r, __m256i g, __m256i b) {
+  return _mm256_or_si256(
+      _mm256_or_si256(_mm256_slli_epi32(a, 24), _mm256_slli_epi32(r, 16)),
+      _mm256_or_si256(_mm256_slli_epi32(g, 8), b));
+}
+
+int MaskRow_AVX2(const uint32* rgb, const uint32* alpha, int width,
+                 uint32* out) {
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    __m256i a, r, g, b;
+    UnPreMultiplyPixels(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgb + x)),
+        &a, &r, &g, &b);
+    __m256i mask_a = _mm256_srli_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(alpha + x)), 24);
+
+    // All the products fit in 16 bits, so 16 bit multiplies are exact.
+    a = _mm256_srli_epi32(_mm256_mullo_epi16(a, mask_a), 8);
+    r = _mm256_srli_epi32(_mm256_mullo_epi16(r, a), 8);
+    g = _mm256_srli_epi32(_mm256_mullo_epi16(g, a), 8);
+    b = _mm256_srli_epi32(_mm256_mullo_epi16(b, a), 8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x),
+                        PackPixels(a, r, g, b));
+  }
+  return x;
+}
+
+int SrcOverRow_AVX2(const uint32* src, int width, uint32* dst) {
+  const __m256i rb_mask = _mm256_set1_epi32(0x00FF00FF);
+  const __m256i c_256 = _mm256_set1_epi16(0x0100);
+
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    __m256i src_pixels =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x));
+    __m256i dst_pixels =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + x));
+
+    // 256 - alpha of the source, in both 16 bit halves of each pixel.
+    __m256i scale = _mm256_srli_epi16(src_pixels, 8);
+    scale = _mm256_shufflehi_epi16(scale, 0xF5);
+    scale = _mm256_shufflelo_epi16(scale, 0xF5);
+    scale = _mm256_sub_epi16(c_256, scale);
+
+    // SkAlphaMulQ() of the destination.
+    __m256i dst_rb = _mm256_and_si256(rb_mask, dst_pixels);
+    __m256i dst_ag = _mm256_srli_epi16(dst_pixels, 8);
+    dst_rb = _mm256_srli_epi16(_mm256_mullo_epi16(dst_rb, scale), 8);
+    dst_ag = _mm256_andnot_si256(rb_mask, _mm256_mullo_epi16(dst_ag, scale));
+
+    // 32 bit additions, like the C version.
+    __m256i result = _mm256_add_epi32(src_pixels,
+                                      _mm256_or_si256(dst_rb, dst_ag));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), result);
+  }
+  return x;
+}
+
+int UnPreMultiplyRow_AVX2(const uint32* src, int width, uint32* out) {
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    __m256i a, r, g, b;
+    UnPreMultiplyPixels(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x)),
+        &a, &r, &g, &b);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x),
+                        PackPixels(a, r, g, b));
+  }
+  return x;
+}
+
+}  // namespace
+
+bool SetupAVX2SkBitmapOperationsProcs(SkBitmapOperationsProcs* procs) {
+  procs->blend_row = &BlendRow_AVX2;
+  procs->mask_row = &MaskRow_AVX2;
+  procs->src_over_row = &SrcOverRow_AVX2;
+  procs->unpremultiply_row = &UnPreMultiplyRow_AVX2;
+  return true;
+}
+
+#else  // !defined(__AVX2__)
+
+bool SetupAVX2SkBitmapOperationsProcs(SkBitmapOperationsProcs* procs) {
+  return false;
+}
+
+#endif  // defined(__AVX2__)
+
+}  // namespace gfx
@@ -0,0 +1,45 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Internal to SkBitmapOperations: the tables of SIMD kernels for the per-pixel
+// loops of some of the operations. The AVX2 kernels live in their own file,
+// since they must be compiled with their own flags (see ui.gyp).
+
+#ifndef UI_GFX_SKBITMAP_OPERATIONS_SIMD_H_
+#define UI_GFX_SKBITMAP_OPERATIONS_SIMD_H_
+#pragma once
+
+#include "base/basictypes.h"
+
+namespace gfx {
+
+// The kernels for one instruction set. They compute exactly what the C
+// versions in skbitmap_operations.cc compute, on the largest part of the row
+// that they can process in blocks of pixels, and return the number of pixels
+// that they processed; the C versions do the rest of the row. They assume
+// that SkPMColor has the same layout as SkColor (see SetupProcs()).
+struct SkBitmapOperationsProcs {
+  // Per channel, |first| * (1 - |alpha|) + |second| * |alpha|, truncated.
+  int (*blend_row)(const uint32* first, const uint32* second, double alpha,
+                   int width, uint32* out);
+
+  // Unpremultiplies |rgb|, multiplies its alpha by the alpha of |alpha|, and
+  // premultiplies the result by that alpha; see CreateMaskedBitmap().
+  int (*mask_row)(const uint32* rgb, const uint32* alpha, int width,
+                  uint32* out);
+
+  // Draws |src| over |dst|, as SkPMSrcOver() does.
+  int (*src_over_row)(const uint32* src, int width, uint32* dst);
+
+  // SkUnPreMultiply::PMColorToColor() of each pixel.
+  int (*unpremultiply_row)(const uint32* src, int width, uint32* out);
+};
+
+// Fills |procs| and returns true if the AVX2 kernels were compiled into this
+// binary. They do not check that the processor supports them.
+bool SetupAVX2SkBitmapOperationsProcs(SkBitmapOperationsProcs* procs);
+
+}  // namespace gfx
+
+#endif  // UI_GFX_SKBITMAP_OPERATIONS_SIMD_H_
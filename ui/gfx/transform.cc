@@ -16,6 +16,75 @@ static int SymmetricRound(float x) {
       : std::ceil(x - 0.5f));
 }
 
+// The layers of the compositor mostly just translate, some scale, and few
+// rotate, so the matrices that only translate, or scale and translate, and
+// the affine ones, have fast paths that skip the full 4x4 multiplications and
+// inversions.
+
+// Returns true if the last row of |m| is [0 0 0 1].
+bool IsAffine(const SkMatrix44& m) {
+  return m.get(3, 0) == 0 && m.get(3, 1) == 0 && m.get(3, 2) == 0 &&
+         m.get(3, 3) == 1;
+}
+
+// Returns true if |m| scales and translates, without rotating, skewing or
+// projecting.
+bool IsScaleOrTranslation(const SkMatrix44& m) {
+  return IsAffine(m) &&
+         m.get(0, 1) == 0 && m.get(0, 2) == 0 &&
+         m.get(1, 0) == 0 && m.get(1, 2) == 0 &&
+         m.get(2, 0) == 0 && m.get(2, 1) == 0;
+}
+
+// Returns true if |m| only translates.
+bool IsTranslation(const SkMatrix44& m) {
+  return IsScaleOrTranslation(m) &&
+         m.get(0, 0) == 1 && m.get(1, 1) == 1 && m.get(2, 2) == 1;
+}
+
+// Returns |a| * |b|.
+SkMatrix44 ConcatMatrices(const SkMatrix44& a, const SkMatrix44& b) {
+  if (IsTranslation(a) && IsAffine(b)) {
+    SkMatrix44 result(b);
+    result.postTranslate(a.get(0, 3), a.get(1, 3), a.get(2, 3));
+    return result;
+  }
+  if (IsAffine(a) && IsTranslation(b)) {
+    // The translation of |b| goes through the linear part of |a|.
+    SkMatrix44 result(a);
+    for (int row = 0; row < 3; ++row) {
+      result.set(row, 3, a.get(row, 0) * b.get(0, 3) +
+                         a.get(row, 1) * b.get(1, 3) +
+                         a.get(row, 2) * b.get(2, 3) + a.get(row, 3));
+    }
+    return result;
+  }
+  if (IsScaleOrTranslation(a) && IsScaleOrTranslation(b)) {
+    SkMatrix44 result;
+    for (int row = 0; row < 3; ++row) {
+      result.set(row, row, a.get(row, row) * b.get(row, row));
+      result.set(row, 3, a.get(row, row) * b.get(row, 3) + a.get(row, 3));
+    }
+    return result;
+  }
+  return SkMatrix44(a, b);
+}
+
+// Sets |inverse| to the inverse of |m|, and returns false if it has none.
+bool InvertMatrix(const SkMatrix44& m, SkMatrix44* inverse) {
+  if (!IsScaleOrTranslation(m))
+    return m.invert(inverse);
+  inverse->reset();
+  for (int row = 0; row < 3; ++row) {
+    SkMScalar scale = m.get(row, row);
+    if (scale == 0)
+      return false;
+    inverse->set(row, row, 1 / scale);
+    inverse->set(row, 3, -m.get(row, 3) / scale);
+  }
+  return true;
+}
+
 } // namespace
 
 namespace ui {
@@ -81,6 +150,10 @@ void Transform::ConcatScale(float x, float y) {
 }
 
 void Transform::ConcatTranslate(float x, float y) {
+  if (IsAffine(matrix_)) {
+    matrix_.postTranslate(SkFloatToScalar(x), SkFloatToScalar(y), 0);
+    return;
+  }
   SkMatrix44 translate;
   translate.setTranslate(SkFloatToScalar(x), SkFloatToScalar(y), 0);
   matrix_.postConcat(translate);
@@ -88,16 +161,20 @@ void Transform::ConcatTranslate(float x, float y) {
 
 void Transform::PreconcatTransform(const Transform& transform) {
   if (!transform.matrix_.isIdentity()) {
-    matrix_.preConcat(transform.matrix_);
+    matrix_ = ConcatMatrices(matrix_, transform.matrix_);
   }
 }
 
 void Transform::ConcatTransform(const Transform& transform) {
   if (!transform.matrix_.isIdentity()) {
-    matrix_.postConcat(transform.matrix_);
+    matrix_ = ConcatMatrices(transform.matrix_, matrix_);
   }
 }
 
+bool Transform::GetInverse(Transform* inverse) const {
+  return InvertMatrix(matrix_, &inverse->matrix_);
+}
+
 bool Transform::HasChange() const {
   return !matrix_.isIdentity();
 }
@@ -111,9 +188,8 @@ void Transform::TransformPoint(gfx::Point3f& point) const {
 }
 
 bool Transform::TransformPointReverse(gfx::Point& point) const {
-  // TODO(sad): Try to avoid trying to invert the matrix.
   SkMatrix44 inverse;
-  if (!matrix_.invert(&inverse))
+  if (!InvertMatrix(matrix_, &inverse))
     return false;
 
   TransformPointInternal(inverse, point);
@@ -121,9 +197,8 @@ bool Transform::TransformPointReverse(gfx::Point& point) const {
 }
 
 bool Transform::TransformPointReverse(gfx::Point3f& point) const {
-  // TODO(sad): Try to avoid trying to invert the matrix.
   SkMatrix44 inverse;
-  if (!matrix_.invert(&inverse))
+  if (!InvertMatrix(matrix_, &inverse))
     return false;
 
   TransformPointInternal(inverse, point);
@@ -139,7 +214,7 @@ void Transform::TransformRect(gfx::Rect* rect) const {
 
 bool Transform::TransformRectReverse(gfx::Rect* rect) const {
   SkMatrix44 inverse;
-  if (!matrix_.invert(&inverse))
+  if (!InvertMatrix(matrix_, &inverse))
     return false;
   const SkMatrix& matrix = inverse;
   SkRect src = gfx::RectToSkRect(*rect);
@@ -150,6 +225,14 @@ bool Transform::TransformRectReverse(gfx::Rect* rect) const {
 
 void Transform::TransformPointInternal(const SkMatrix44& xform,
                                        gfx::Point3f& point) const {
+  if (IsScaleOrTranslation(xform)) {
+    point.SetPoint(
+        static_cast<float>(xform.get(0, 0) * point.x() + xform.get(0, 3)),
+        static_cast<float>(xform.get(1, 1) * point.y() + xform.get(1, 3)),
+        static_cast<float>(xform.get(2, 2) * point.z() + xform.get(2, 3)));
+    return;
+  }
+
   SkScalar p[4] = {
     SkFloatToScalar(point.x()),
     SkFloatToScalar(point.y()),
@@ -167,6 +250,15 @@ void Transform::TransformPointInternal(const SkMatrix44& xform,
 
 void Transform::TransformPointInternal(const SkMatrix44& xform,
                                        gfx::Point& point) const {
+  if (IsScaleOrTranslation(xform)) {
+    point.SetPoint(
+        SymmetricRound(
+            static_cast<float>(xform.get(0, 0) * point.x() + xform.get(0, 3))),
+        SymmetricRound(
+            static_cast<float>(xform.get(1, 1) * point.y() + xform.get(1, 3))));
+    return;
+  }
+
   SkScalar p[4] = {
     SkIntToScalar(point.x()),
     SkIntToScalar(point.y()),
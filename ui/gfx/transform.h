@@ -66,6 +66,10 @@ class UI_EXPORT Transform {
   // (i.e. 'this = transform * this;').
   void ConcatTransform(const Transform& transform);
 
+  // Sets |inverse| to the inverse of the transformation. Returns false if the
+  // transformation can't be inverted.
+  bool GetInverse(Transform* inverse) const;
+
   // Does the transformation change anything?
   bool HasChange() const;
 
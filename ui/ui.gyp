@@ -28,6 +28,8 @@
 		    'gfx/brush.h',
 		    'gfx/rect.h',
 		    'gfx/rect.cc',
+		    'gfx/damage_region.h',
+		    'gfx/damage_region.cc',
 		    'gfx/transform.h',
 		    'gfx/transform.cc',
 		    'gfx/point.h',
@@ -49,9 +51,13 @@
         'gfx/insets.cc',
         'base/l10n/l10n_util_win.h',
         'base/l10n/l10n_util_win.cc',
+        'base/resource/decoded_image_cache.cc',
+        'base/resource/decoded_image_cache.h',
         'base/resource/resource_bundle.h',
         'base/resource/resource_bundle.cc',
         'base/resource/resource_bundle_win.cc',
+        'base/resource/resource_image.cc',
+        'base/resource/resource_image.h',
         'base/strings/app_locale_settings.grd',
         'gfx/codec/png_codec.h',
         'gfx/codec/png_codec.cc',
@@ -65,6 +71,8 @@
         'base/animation/animation_container_element.h',
         'base/animation/animation_container_observer.h',
         'base/animation/animation_delegate.h',
+        'base/animation/frame_clock.cc',
+        'base/animation/frame_clock.h',
         'base/animation/linear_animation.cc',
         'base/animation/linear_animation.h',
         'base/animation/multi_animation.cc',
@@ -148,6 +156,10 @@
         'gfx/gdi_util.h',
         'gfx/gfx_paths.cc',
         'gfx/gfx_paths.h',
+        'gfx/glyph_cache_win.cc',
+        'gfx/glyph_cache_win.h',
+        'gfx/icon_cache_win.cc',
+        'gfx/icon_cache_win.h',
         'gfx/icon_util.cc',
         'gfx/icon_util.h',
         'gfx/image/image_util.cc',
@@ -161,12 +173,17 @@
         'gfx/path.cc',
         'gfx/path.h',
         'gfx/path_win.cc',
+        'gfx/pooled_pixel_allocator.cc',
+        'gfx/pooled_pixel_allocator.h',
+        'gfx/recording_canvas.cc',
+        'gfx/recording_canvas.h',
         'gfx/screen.h',
         'gfx/screen_win.cc',
         'gfx/scrollbar_size.cc',
         'gfx/scrollbar_size.h',
         'gfx/skbitmap_operations.cc',
         'gfx/skbitmap_operations.h',
+        'gfx/skbitmap_operations_simd.h',
         'gfx/win_util.cc',
         'gfx/win_util.h',
         'base/events.h',
@@ -198,6 +215,7 @@
         '../third_party/libjpeg_turbo/libjpeg.gyp:libjpeg',
         'base/strings/ui_strings.gyp:ui_strings',
         'gfx_resources',
+        'ui_opts_avx2',
       ],
 
       'direct_dependent_settings': {
@@ -205,7 +223,82 @@
           '..',
         ],
       },
+    },
+    # The AVX2 SkBitmapOperations kernels need AVX2 code generation, and must
+    # not share a target with the rest of ui, which has to run on processors
+    # without AVX2. They are only used if skia::BestConvolutionSIMD() picks
+    # AVX2; with compilers that do not support AVX2, the file is empty.
+    {
+      'target_name': 'ui_opts_avx2',
+      'type': 'static_library',
+      'dependencies': [
+        '../skia/skia.gyp:skia',
+      ],
+      'include_dirs': [
+        '..',
+      ],
+      'conditions': [
+        [ 'os_posix == 1 and OS != "mac" and target_arch != "arm"', {
+          'cflags': [
+            '-mavx2',
+          ],
+        }],
+        [ 'OS == "mac"', {
+          'xcode_settings': {
+            'OTHER_CFLAGS': [
+              '-mavx2',
+            ],
+          },
+        }],
+        [ 'OS == "win"', {
+          'msvs_settings': {
+            'VCCLCompilerTool': {
+              'AdditionalOptions': [
+                '/arch:AVX2',
+              ],
+            },
+          },
+        }],
+      ],
+      'sources': [
+        'gfx/skbitmap_operations_avx2.cc',
+        'gfx/skbitmap_operations_simd.h',
+      ],
     },
+    {
+      'target_name': 'gfx_bench',
+      'type': 'executable',
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../skia/skia.gyp:skia',
+        'ui',
+      ],
+      'include_dirs': [
+        '..',
+      ],
+      'sources': [
+        'gfx/gfx_bench.cc',
+      ],
+    },
+    {
+      'target_name': 'gfx_unittests',
+      'type': 'executable',
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../skia/skia.gyp:skia',
+        '../testing/gtest.gyp:gtest',
+        '../third_party/libpng/libpng.gyp:libpng',
+        'ui',
+      ],
+      'include_dirs': [
+        '..',
+      ],
+      'sources': [
+        'gfx/codec/png_codec_unittest.cc',
+        'gfx/color_analysis_unittest.cc',
+        'gfx/run_all_unittests.cc',
+      ],
+    },
     {
       'target_name': 'gfx_resources',
       'type': 'none',
@@ -27,7 +27,9 @@ scoped_refptr<NativeViewAccessibilityWin> NativeViewAccessibilityWin::Create(
   return scoped_refptr<NativeViewAccessibilityWin>(instance);
 }
 
-NativeViewAccessibilityWin::NativeViewAccessibilityWin() : view_(NULL) {
+NativeViewAccessibilityWin::NativeViewAccessibilityWin()
+    : view_(NULL),
+      state_valid_(false) {
 }
 
 NativeViewAccessibilityWin::~NativeViewAccessibilityWin() {
@@ -259,9 +261,7 @@ STDMETHODIMP NativeViewAccessibilityWin::get_accDefaultAction(
   if (!view_)
     return E_FAIL;
 
-  ui::AccessibleViewState state;
-  view_->GetAccessibleState(&state);
-  string16 temp_action = state.default_action;
+  string16 temp_action = GetViewState().default_action;
 
   if (!temp_action.empty()) {
     *def_action = SysAllocString(temp_action.c_str());
@@ -327,9 +327,7 @@ STDMETHODIMP NativeViewAccessibilityWin::get_accKeyboardShortcut(
   if (!view_)
     return E_FAIL;
 
-  ui::AccessibleViewState state;
-  view_->GetAccessibleState(&state);
-  string16 temp_key = state.keyboard_shortcut;
+  string16 temp_key = GetViewState().keyboard_shortcut;
 
   if (!temp_key.empty()) {
     *acc_key = SysAllocString(temp_key.c_str());
@@ -349,9 +347,7 @@ STDMETHODIMP NativeViewAccessibilityWin::get_accName(
     return E_FAIL;
 
   // Retrieve the current view's name.
-  ui::AccessibleViewState state;
-  view_->GetAccessibleState(&state);
-  string16 temp_name = state.name;
+  string16 temp_name = GetViewState().name;
   if (!temp_name.empty()) {
     // Return name retrieved.
     *name = SysAllocString(temp_name.c_str());
@@ -410,10 +406,8 @@ STDMETHODIMP NativeViewAccessibilityWin::get_accRole(
   if (!view_)
     return E_FAIL;
 
-  ui::AccessibleViewState state;
-  view_->GetAccessibleState(&state);
   role->vt = VT_I4;
-  role->lVal = MSAARole(state.role);
+  role->lVal = MSAARole(GetViewState().role);
   return S_OK;
 }
 
@@ -446,9 +440,7 @@ STDMETHODIMP NativeViewAccessibilityWin::get_accValue(
     return E_FAIL;
 
   // Retrieve the current view's value.
-  ui::AccessibleViewState state;
-  view_->GetAccessibleState(&state);
-  string16 temp_value = state.value;
+  string16 temp_value = GetViewState().value;
 
   if (!temp_value.empty()) {
     // Return value retrieved.
@@ -513,9 +505,17 @@ void NativeViewAccessibilityWin::SetState(
     msaa_state->lVal |= STATE_SYSTEM_FOCUSED;
 
   // Add on any view-specific states.
-   ui::AccessibleViewState view_state;
-   view->GetAccessibleState(&view_state);
-   msaa_state->lVal |= MSAAState(view_state.state);
+  DCHECK_EQ(view_, view);
+  msaa_state->lVal |= MSAAState(GetViewState().state);
+}
+
+const ui::AccessibleViewState& NativeViewAccessibilityWin::GetViewState() {
+  if (!state_valid_) {
+    state_ = ui::AccessibleViewState();
+    view_->GetAccessibleState(&state_);
+    state_valid_ = true;
+  }
+  return state_;
 }
 
 // IAccessible functions not supported.
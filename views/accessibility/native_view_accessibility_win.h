@@ -42,7 +42,14 @@ class ATL_NO_VTABLE NativeViewAccessibilityWin
 
   virtual ~NativeViewAccessibilityWin();
 
-  void set_view(views::View* view) { view_ = view; }
+  void set_view(views::View* view) {
+    view_ = view;
+    InvalidateState();
+  }
+
+  // Drops the cached accessible state of the view, which the next query gets
+  // from View::GetAccessibleState() again.
+  void InvalidateState() { state_valid_ = false; }
 
   // Supported IAccessible methods.
 
@@ -144,12 +151,21 @@ class ATL_NO_VTABLE NativeViewAccessibilityWin
   // Helper function which sets applicable states of view.
   void SetState(VARIANT* msaa_state, views::View* view);
 
+  // Returns the accessible state of the view, getting it if it isn't cached.
+  // Screen readers query the name, role, state and value of each view in
+  // turn, for each event, so each would have had its own GetAccessibleState().
+  const ui::AccessibleViewState& GetViewState();
+
   // Give CComObject access to the class constructor.
   template <class Base> friend class CComObject;
 
   // Member View needed for view-specific calls.
   views::View* view_;
 
+  // The cached accessible state of |view_|, valid while |state_valid_|.
+  ui::AccessibleViewState state_;
+  bool state_valid_;
+
   DISALLOW_COPY_AND_ASSIGN(NativeViewAccessibilityWin);
 };
 
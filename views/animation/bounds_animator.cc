@@ -7,7 +7,9 @@
 #include "base/memory/scoped_ptr.h"
 #include "ui/base/animation/animation_container.h"
 #include "ui/base/animation/slide_animation.h"
+#include "views/paint_lock.h"
 #include "views/view.h"
+#include "views/widget/widget.h"
 
 // Duration in milliseconds for animations.
 static const int kAnimationDuration = 200;
@@ -22,6 +24,7 @@ namespace views {
 BoundsAnimator::BoundsAnimator(View* parent)
     : parent_(parent),
       observer_(NULL),
+      use_layers_(false),
       container_(new AnimationContainer()) {
   container_->set_observer(this);
 }
@@ -61,6 +64,19 @@ void BoundsAnimator::AnimateViewTo(View* view, const gfx::Rect& target) {
   data.target_bounds = target;
   data.animation = CreateAnimation();
 
+  // A view that was promoted for the animation it had stays on its layer.
+  if (existing_data.promoted_to_layer) {
+    data.promoted_to_layer = true;
+    existing_data.promoted_to_layer = false;
+  } else if (use_layers_ && !view->layer() && view->GetWidget() &&
+             view->GetWidget()->GetCompositor()) {
+    // What the view painted into the layer of its parent is repainted there
+    // without it.
+    view->SchedulePaint();
+    view->SetPaintToLayer(true);
+    data.promoted_to_layer = true;
+  }
+
   animation_to_view_[data.animation] = view;
 
   data.animation->Show();
@@ -167,6 +183,13 @@ void BoundsAnimator::CleanupData(bool send_cancel, Data* data, View* view) {
     delete data->animation;
     data->animation = NULL;
   }
+
+  if (data->promoted_to_layer && view) {
+    view->SetPaintToLayer(false);
+    // Without the layer, the view is drawn where it is by its parent.
+    view->SchedulePaint();
+    data->promoted_to_layer = false;
+  }
 }
 
 Animation* BoundsAnimator::ResetAnimationForView(View* view) {
@@ -215,15 +238,21 @@ void BoundsAnimator::AnimationProgressed(const Animation* animation) {
   gfx::Rect new_bounds =
       animation->CurrentValueBetween(data.start_bounds, data.target_bounds);
   if (new_bounds != view->bounds()) {
-    gfx::Rect total_bounds = new_bounds.Union(view->bounds());
-
-    // Build up the region to repaint in repaint_bounds_. We'll do the repaint
-    // when all animations complete (in AnimationContainerProgressed).
-    if (repaint_bounds_.IsEmpty())
-      repaint_bounds_ = total_bounds;
-    else
-      repaint_bounds_ = repaint_bounds_.Union(total_bounds);
+    // A layer that keeps its size is moved by the compositor, without a paint.
+    if (!view->layer() || new_bounds.size() != view->size()) {
+      gfx::Rect total_bounds = new_bounds.Union(view->bounds());
+
+      // Build up the region to repaint in repaint_bounds_. We'll do the repaint
+      // when all animations complete (in AnimationContainerProgressed).
+      if (repaint_bounds_.IsEmpty())
+        repaint_bounds_ = total_bounds;
+      else
+        repaint_bounds_ = repaint_bounds_.Union(total_bounds);
+    }
 
+    // The paints the view schedules as it moves stop at the parent, which
+    // repaints all of repaint_bounds_ once for the whole step.
+    PaintLock lock(parent_);
     view->SetBoundsRect(new_bounds);
   }
 
@@ -39,6 +39,10 @@ class BoundsAnimatorObserver {
 // You can attach an AnimationDelegate to the individual animation for a view
 // by way of SetAnimationDelegate. Additionally you can attach an observer to
 // the BoundsAnimator that is notified when all animations are complete.
+//
+// The views don't schedule their own paints as they move. The area they cover
+// on each step of the animations is repainted at once, when all the views
+// have been moved.
 class VIEWS_EXPORT BoundsAnimator : public ui::AnimationDelegate,
                                     public ui::AnimationContainerObserver {
  public:
@@ -96,6 +100,12 @@ class VIEWS_EXPORT BoundsAnimator : public ui::AnimationDelegate,
     observer_ = observer;
   }
 
+  // If true, the views that are animated paint to layers of their own until
+  // they stop, so that moving them is left to the compositor, rather than
+  // painted. Only the views of a widget with a compositor, that don't have a
+  // layer already, are given one. The default is false.
+  void set_use_layers(bool use_layers) { use_layers_ = use_layers; }
+
  protected:
   // Creates the animation to use for animating views.
   virtual ui::SlideAnimation* CreateAnimation();
@@ -105,12 +115,17 @@ class VIEWS_EXPORT BoundsAnimator : public ui::AnimationDelegate,
   struct Data {
     Data()
         : delete_delegate_when_done(false),
+          promoted_to_layer(false),
           animation(NULL),
           delegate(NULL) {}
 
     // If true the delegate is deleted when done.
     bool delete_delegate_when_done;
 
+    // If true the view was made to paint to a layer for the animation, see
+    // set_use_layers().
+    bool promoted_to_layer;
+
     // The initial bounds.
     gfx::Rect start_bounds;
 
@@ -140,6 +155,8 @@ class VIEWS_EXPORT BoundsAnimator : public ui::AnimationDelegate,
 
   // Does the necessary cleanup for |data|. If |send_cancel| is true and a
   // delegate has been installed on |data| AnimationCanceled is invoked on it.
+  // If |view| is non-NULL and was promoted to a layer, it paints without one
+  // again.
   void CleanupData(bool send_cancel, Data* data, View* view);
 
   // Used when changing the animation for a view. This resets the maps for
@@ -165,6 +182,9 @@ class VIEWS_EXPORT BoundsAnimator : public ui::AnimationDelegate,
 
   BoundsAnimatorObserver* observer_;
 
+  // See set_use_layers().
+  bool use_layers_;
+
   // All animations we create up with the same container.
   scoped_refptr<ui::AnimationContainer> container_;
 
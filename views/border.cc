@@ -5,7 +5,9 @@
 #include "views/border.h"
 
 #include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
 #include "ui/gfx/canvas.h"
+#include "views/painter.h"
 
 namespace views {
 
@@ -71,6 +73,32 @@ class EmptyBorder : public Border {
 
   DISALLOW_COPY_AND_ASSIGN(EmptyBorder);
 };
+
+class BorderPainter : public Border {
+ public:
+  BorderPainter(Painter* painter, const gfx::Insets& insets)
+      : painter_(painter),
+        insets_(insets) {
+    DCHECK(painter);
+  }
+
+  virtual void Paint(const View& view, gfx::Canvas* canvas) const {
+    Painter::PaintPainterAt(0, 0, view.width(), view.height(), canvas,
+                            painter_.get());
+  }
+
+  virtual void GetInsets(gfx::Insets* insets) const {
+    DCHECK(insets);
+    insets->Set(insets_.top(), insets_.left(), insets_.bottom(),
+                insets_.right());
+  }
+
+ private:
+  scoped_ptr<Painter> painter_;
+  gfx::Insets insets_;
+
+  DISALLOW_COPY_AND_ASSIGN(BorderPainter);
+};
 }
 
 Border::Border() {
@@ -89,4 +117,10 @@ Border* Border::CreateEmptyBorder(int top, int left, int bottom, int right) {
   return new EmptyBorder(top, left, bottom, right);
 }
 
+// static
+Border* Border::CreateBorderPainter(Painter* painter,
+                                    const gfx::Insets& insets) {
+  return new BorderPainter(painter, insets);
+}
+
 }  // namespace views
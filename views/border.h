@@ -16,6 +16,7 @@ class Canvas;
 
 namespace views {
 
+class Painter;
 class View;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -47,6 +48,13 @@ class VIEWS_EXPORT Border {
   // paint anything.
   static Border* CreateEmptyBorder(int top, int left, int bottom, int right);
 
+  // Creates a border that paints |painter| over the bounds of the view, and
+  // reserves |insets| for it. Use Painter::CreateImagePainter() for a border
+  // made of an image, which it then repaints with a single bitmap. Takes
+  // ownership of |painter|.
+  static Border* CreateBorderPainter(Painter* painter,
+                                     const gfx::Insets& insets);
+
   // Renders the border for the specified view.
   virtual void Paint(const View& view, gfx::Canvas* canvas) const = 0;
 
@@ -8,6 +8,7 @@
 #include "ui/base/animation/throb_animation.h"
 #include "ui/base/keycodes/keyboard_codes.h"
 #include "ui/gfx/screen.h"
+#include "views/focus/focus_search.h"
 #include "views/widget/widget.h"
 
 namespace views {
@@ -43,6 +44,9 @@ void CustomButton::SetState(ButtonState state) {
     }
   }
 
+  // Disabled buttons aren't focusable.
+  if (state_ == BS_DISABLED || state == BS_DISABLED)
+    FocusSearch::InvalidateFocusOrders();
   state_ = state;
   SchedulePaint();
 }
@@ -276,6 +280,13 @@ void CustomButton::ViewHierarchyChanged(bool is_add, View *parent,
                                         View *child) {
   if (!is_add && state_ != BS_DISABLED)
     SetState(BS_NORMAL);
+
+  // The hover animation only paints, so it can pause while the widget can't
+  // be seen.
+  if (child->Contains(this)) {
+    hover_animation_->SetContainer(
+        is_add && GetWidget() ? GetWidget()->GetAnimationContainer() : NULL);
+  }
 }
 
 bool CustomButton::IsFocusable() const {
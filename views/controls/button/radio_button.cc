@@ -6,6 +6,7 @@
 
 #include "base/logging.h"
 #include "ui/base/accessibility/accessible_view_state.h"
+#include "views/focus/focus_search.h"
 #include "views/widget/widget.h"
 
 namespace views {
@@ -55,6 +56,8 @@ void RadioButton::SetChecked(bool checked) {
     }
   }
   Checkbox::SetChecked(checked);
+  // The checked button is the one of the group the focus goes to.
+  FocusSearch::InvalidateFocusOrders();
 }
 
 std::string RadioButton::GetClassName() const {
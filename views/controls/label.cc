@@ -4,10 +4,12 @@
 
 #include "views/controls/label.h"
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
 #include "base/i18n/rtl.h"
+#include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/string_split.h"
 #include "base/string_util.h"
@@ -23,10 +25,19 @@
 
 namespace views {
 
+// The number of widths the size of a multi-line label is kept for. Layouts
+// mostly ask for the preferred width, and the width they settle on.
+static const size_t kMaxMultiLineTextSizes = 4;
+
 // The colors to use for enabled and disabled labels.
 static SkColor kEnabledColor;
 static SkColor kDisabledColor;
 
+// Labels elide their text every time they paint, so the elided texts of all
+// the labels are kept.
+static base::LazyInstance<ui::ElidedTextCache> g_elided_text_cache(
+    base::LINKER_INITIALIZED);
+
 // static
 const char Label::kViewClassName[] = "views/Label";
 
@@ -49,7 +60,7 @@ Label::~Label() {
 
 void Label::SetFont(const gfx::Font& font) {
   font_ = font;
-  text_size_valid_ = false;
+  InvalidateTextSizes();
   PreferredSizeChanged();
   SchedulePaint();
 }
@@ -57,7 +68,7 @@ void Label::SetFont(const gfx::Font& font) {
 void Label::SetText(const std::wstring& text) {
   text_ = WideToUTF16Hack(text);
   url_set_ = false;
-  text_size_valid_ = false;
+  InvalidateTextSizes();
   PreferredSizeChanged();
   SchedulePaint();
 }
@@ -105,7 +116,7 @@ void Label::SetMultiLine(bool multi_line) {
   DCHECK(!multi_line || !elide_in_middle_);
   if (multi_line != is_multi_line_) {
     is_multi_line_ = multi_line;
-    text_size_valid_ = false;
+    InvalidateTextSizes();
     PreferredSizeChanged();
     SchedulePaint();
   }
@@ -114,7 +125,7 @@ void Label::SetMultiLine(bool multi_line) {
 void Label::SetAllowCharacterBreak(bool allow_character_break) {
   if (allow_character_break != allow_character_break_) {
     allow_character_break_ = allow_character_break;
-    text_size_valid_ = false;
+    InvalidateTextSizes();
     PreferredSizeChanged();
     SchedulePaint();
   }
@@ -124,7 +135,7 @@ void Label::SetElideInMiddle(bool elide_in_middle) {
   DCHECK(!elide_in_middle || !is_multi_line_);
   if (elide_in_middle != elide_in_middle_) {
     elide_in_middle_ = elide_in_middle;
-    text_size_valid_ = false;
+    InvalidateTextSizes();
     PreferredSizeChanged();
     SchedulePaint();
   }
@@ -166,7 +177,7 @@ void Label::SizeToFit(int max_width) {
 void Label::SetHasFocusBorder(bool has_focus_border) {
   has_focus_border_ = has_focus_border;
   if (is_multi_line_) {
-    text_size_valid_ = false;
+    InvalidateTextSizes();
     PreferredSizeChanged();
   }
 }
@@ -204,10 +215,7 @@ int Label::GetHeightForWidth(int w) {
     return View::GetHeightForWidth(w);
 
   w = std::max(0, w - GetInsets().width());
-  int h = font_.GetHeight();
-  gfx::CanvasSkia::SizeStringInt(text_, font_, &w, &h,
-                                 ComputeMultiLineFlags());
-  return h + GetInsets().height();
+  return GetMultiLineTextSize(w).height() + GetInsets().height();
 }
 
 void Label::OnEnabledChanged() {
@@ -277,20 +285,20 @@ void Label::PaintText(gfx::Canvas* canvas,
 
 gfx::Size Label::GetTextSize() const {
   if (!text_size_valid_) {
-    // For single-line strings, we supply the largest possible width, because
-    // while adding NO_ELLIPSIS to the flags works on Windows for forcing
-    // SizeStringInt() to calculate the desired width, it doesn't seem to work
-    // on Linux.
-    int w = is_multi_line_ ?
-        GetAvailableRect().width() : std::numeric_limits<int>::max();
-    int h = font_.GetHeight();
-    // For single-line strings, ignore the available width and calculate how
-    // wide the text wants to be.
-    int flags = ComputeMultiLineFlags();
-    if (!is_multi_line_)
-      flags |= gfx::Canvas::NO_ELLIPSIS;
-    gfx::CanvasSkia::SizeStringInt(text_, font_, &w, &h, flags);
-    text_size_.SetSize(w, h);
+    if (is_multi_line_) {
+      text_size_ = GetMultiLineTextSize(GetAvailableRect().width());
+    } else {
+      // For single-line strings, we supply the largest possible width,
+      // because while adding NO_ELLIPSIS to the flags works on Windows for
+      // forcing SizeStringInt() to calculate the desired width, it doesn't
+      // seem to work on Linux. The available width is ignored, to calculate
+      // how wide the text wants to be.
+      int w = std::numeric_limits<int>::max();
+      int h = font_.GetHeight();
+      int flags = ComputeMultiLineFlags() | gfx::Canvas::NO_ELLIPSIS;
+      gfx::CanvasSkia::SizeStringInt(text_, font_, &w, &h, flags);
+      text_size_.SetSize(w, h);
+    }
     text_size_valid_ = true;
   }
 
@@ -426,6 +434,33 @@ int Label::ComputeMultiLineFlags() const {
   return flags;
 }
 
+gfx::Size Label::GetMultiLineTextSize(int width) const {
+  DCHECK(is_multi_line_);
+  for (size_t i = 0; i < multi_line_text_sizes_.size(); ++i) {
+    if (multi_line_text_sizes_[i].first == width) {
+      std::rotate(multi_line_text_sizes_.begin(),
+                  multi_line_text_sizes_.begin() + i,
+                  multi_line_text_sizes_.begin() + i + 1);
+      return multi_line_text_sizes_.front().second;
+    }
+  }
+
+  int w = width;
+  int h = font_.GetHeight();
+  gfx::CanvasSkia::SizeStringInt(text_, font_, &w, &h,
+                                 ComputeMultiLineFlags());
+  if (multi_line_text_sizes_.size() >= kMaxMultiLineTextSizes)
+    multi_line_text_sizes_.pop_back();
+  multi_line_text_sizes_.insert(multi_line_text_sizes_.begin(),
+                                std::make_pair(width, gfx::Size(w, h)));
+  return gfx::Size(w, h);
+}
+
+void Label::InvalidateTextSizes() {
+  text_size_valid_ = false;
+  multi_line_text_sizes_.clear();
+}
+
 gfx::Rect Label::GetAvailableRect() const {
   gfx::Rect bounds(gfx::Point(), size());
   gfx::Insets insets(GetInsets());
@@ -457,7 +492,7 @@ void Label::CalculateDrawStringParams(std::wstring* paint_text,
     *paint_text = UTF16ToWide(base::i18n::GetDisplayStringInLTRDirectionality(
         WideToUTF16(*paint_text)));
   } else if (elide_in_middle_) {
-    *paint_text = UTF16ToWideHack(ui::ElideText(text_,
+    *paint_text = UTF16ToWideHack(g_elided_text_cache.Get().ElideText(text_,
         font_, GetAvailableRect().width(), true));
   } else {
     *paint_text = UTF16ToWideHack(text_);
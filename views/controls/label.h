@@ -7,6 +7,8 @@
 #pragma once
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/gtest_prod_util.h"
 // #include "googleurl/src/gurl.h"
@@ -186,7 +188,7 @@ class VIEWS_EXPORT Label : public View {
                          const gfx::Rect& text_bounds,
                          int flags);
 
-  void invalidate_text_size() { text_size_valid_ = false; }
+  void invalidate_text_size() { InvalidateTextSizes(); }
 
   virtual gfx::Size GetTextSize() const;
 
@@ -224,6 +226,15 @@ class VIEWS_EXPORT Label : public View {
 
   int ComputeMultiLineFlags() const;
 
+  // Returns the size of the multi-line text laid out in |width|, which is
+  // measured once per width, since layouts ask for the height of a label for
+  // the same widths over and over.
+  gfx::Size GetMultiLineTextSize(int width) const;
+
+  // Forgets the measured sizes of the text, when it changed or how it is laid
+  // out did.
+  void InvalidateTextSizes();
+
   gfx::Rect GetAvailableRect() const;
 
   // Returns parameters to be used for the DrawString call.
@@ -237,6 +248,9 @@ class VIEWS_EXPORT Label : public View {
   SkColor color_;
   mutable gfx::Size text_size_;
   mutable bool text_size_valid_;
+  // The sizes of the multi-line text, with the widths they were measured for,
+  // the most recently used first.
+  mutable std::vector<std::pair<int, gfx::Size> > multi_line_text_sizes_;
   bool is_multi_line_;
   bool allow_character_break_;
   bool elide_in_middle_;
@@ -1177,6 +1177,18 @@ MenuItemView* MenuController::GetMenuItemAt(View* source, int x, int y) {
   return NULL;
 }
 
+MenuItemView* MenuController::GetMenuItemInSubmenuAt(SubmenuView* menu,
+                                                    const gfx::Point& loc) {
+  View* child;
+  if (!menu->GetLaidOutChildAt(loc, &child))
+    return GetMenuItemAt(menu, loc.x(), loc.y());
+  if (child && child->IsEnabled() &&
+      child->id() == MenuItemView::kMenuItemViewID) {
+    return static_cast<MenuItemView*>(child);
+  }
+  return NULL;
+}
+
 MenuItemView* MenuController::GetEmptyMenuItemAt(View* source, int x, int y) {
   View* child_under_mouse = source->GetEventHandlerForPoint(gfx::Point(x, y));
   if (child_under_mouse &&
@@ -1254,7 +1266,7 @@ bool MenuController::GetMenuPartByScreenCoordinateImpl(
   if (DoesSubmenuContainLocation(menu, screen_loc)) {
     gfx::Point menu_loc = screen_loc;
     View::ConvertPointToView(NULL, menu, &menu_loc);
-    part->menu = GetMenuItemAt(menu, menu_loc.x(), menu_loc.y());
+    part->menu = GetMenuItemInSubmenuAt(menu, menu_loc);
     part->type = MenuPart::MENU_ITEM;
     part->submenu = menu;
     if (!part->menu)
@@ -1373,7 +1385,9 @@ void MenuController::OpenMenuImpl(MenuItemView* item, bool show) {
     int old_count = item->GetSubmenu()->child_count();
     item->GetDelegate()->WillShowMenu(item);
     if (old_count != item->GetSubmenu()->child_count()) {
-      // If the number of children changed then we may need to add empty items.
+      // If the number of children changed then we may need to add empty items,
+      // or remove the one added before the delegate added the first children.
+      item->RemoveEmptyMenus();
       item->AddEmptyMenus();
     }
   }
@@ -1656,12 +1670,14 @@ MenuItemView* MenuController::FindNextSelectableMenuItem(MenuItemView* parent,
 void MenuController::OpenSubmenuChangeSelectionIfCan() {
   MenuItemView* item = pending_state_.item;
   if (item->HasSubmenu() && item->IsEnabled()) {
+    if (item->GetSubmenu()->GetMenuItemCount() == 0) {
+      // No menu items, just show the sub-menu. The delegate may add the items
+      // as it is shown.
+      SetSelection(item, SELECTION_OPEN_SUBMENU | SELECTION_UPDATE_IMMEDIATELY);
+    }
     if (item->GetSubmenu()->GetMenuItemCount() > 0) {
       SetSelection(item->GetSubmenu()->GetMenuItemAt(0),
                    SELECTION_UPDATE_IMMEDIATELY);
-    } else {
-      // No menu items, just show the sub-menu.
-      SetSelection(item, SELECTION_OPEN_SUBMENU | SELECTION_UPDATE_IMMEDIATELY);
     }
   }
 }
@@ -265,6 +265,12 @@ class VIEWS_EXPORT MenuController : public MessageLoop::Dispatcher {
   // over_any_menu to be true. For example, the user clicked on a separator.
   MenuItemView* GetMenuItemAt(View* menu, int x, int y);
 
+  // Like GetMenuItemAt(), using the bounds |menu| laid its children out at
+  // to find the item, while they are up to date. |loc| is in the
+  // coordinates of |menu|.
+  MenuItemView* GetMenuItemInSubmenuAt(SubmenuView* menu,
+                                       const gfx::Point& loc);
+
   // If there is an empty menu item at the specified location, it is returned.
   MenuItemView* GetEmptyMenuItemAt(View* source, int x, int y);
 
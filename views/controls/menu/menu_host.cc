@@ -4,6 +4,10 @@
 
 #include "views/controls/menu/menu_host.h"
 
+#include <algorithm>
+#include <vector>
+
+#include "base/lazy_instance.h"
 #include "views/controls/menu/menu_controller.h"
 #include "views/controls/menu/menu_host_root_view.h"
 #include "views/controls/menu/menu_item_view.h"
@@ -14,11 +18,26 @@
 
 namespace views {
 
+namespace {
+
+// The most hidden menu hosts kept for reuse. A context menu and the submenus
+// open at once rarely need more.
+const size_t kMaxPooledMenuHosts = 4;
+
+// The hidden menu hosts kept for reuse, all on the UI thread.
+typedef std::vector<MenuHost*> MenuHosts;
+base::LazyInstance<MenuHosts, base::LeakyLazyInstanceTraits<MenuHosts> >
+    g_pooled_menu_hosts(base::LINKER_INITIALIZED);
+
+}  // namespace
+
 ////////////////////////////////////////////////////////////////////////////////
 // MenuHost, public:
 
 MenuHost::MenuHost(SubmenuView* submenu)
     : submenu_(submenu),
+      parent_(NULL),
+      initialized_(false),
       destroying_(false),
       ignore_capture_lost_(false) {
 }
@@ -26,15 +45,40 @@ MenuHost::MenuHost(SubmenuView* submenu)
 MenuHost::~MenuHost() {
 }
 
+// static
+MenuHost* MenuHost::GetMenuHost(SubmenuView* submenu, Widget* parent) {
+  MenuHosts* pooled_hosts = g_pooled_menu_hosts.Pointer();
+  for (MenuHosts::iterator i = pooled_hosts->begin();
+       i != pooled_hosts->end(); ++i) {
+    // The parent owns the window of the menu host, which can't be changed.
+    if ((*i)->parent_ != parent)
+      continue;
+    MenuHost* host = *i;
+    pooled_hosts->erase(i);
+    host->submenu_ = submenu;
+    host->destroying_ = false;
+    static_cast<MenuHostRootView*>(host->GetRootView())->set_submenu(submenu);
+    return host;
+  }
+  return new MenuHost(submenu);
+}
+
 void MenuHost::InitMenuHost(Widget* parent,
                             const gfx::Rect& bounds,
                             View* contents_view,
                             bool do_capture) {
-  Widget::InitParams params(Widget::InitParams::TYPE_MENU);
-  params.has_dropshadow = true;
-  params.parent_widget = parent;
-  params.bounds = bounds;
-  Init(params);
+  if (initialized_) {
+    DCHECK_EQ(parent_, parent);
+    SetBounds(bounds);
+  } else {
+    Widget::InitParams params(Widget::InitParams::TYPE_MENU);
+    params.has_dropshadow = true;
+    params.parent_widget = parent;
+    params.bounds = bounds;
+    Init(params);
+    parent_ = parent;
+    initialized_ = true;
+  }
   SetContentsView(contents_view);
   ShowMenuHost(do_capture);
 }
@@ -67,6 +111,16 @@ void MenuHost::DestroyMenuHost() {
   HideMenuHost();
   destroying_ = true;
   static_cast<MenuHostRootView*>(GetRootView())->ClearSubmenu();
+  MenuHosts* pooled_hosts = g_pooled_menu_hosts.Pointer();
+  // A windowless menu host is cheap to create, and might not fit next time.
+  if (!is_windowless_popup() && pooled_hosts->size() < kMaxPooledMenuHosts) {
+    // The views of the submenu aren't owned by the root view, which only lets
+    // go of them.
+    GetRootView()->RemoveAllChildViews(true);
+    submenu_ = NULL;
+    pooled_hosts->push_back(this);
+    return;
+  }
   Close();
 }
 
@@ -101,6 +155,11 @@ void MenuHost::OnMouseCaptureLost() {
 }
 
 void MenuHost::OnNativeWidgetDestroyed() {
+  // A kept menu host goes with the window of its parent.
+  MenuHosts* pooled_hosts = g_pooled_menu_hosts.Pointer();
+  pooled_hosts->erase(
+      std::remove(pooled_hosts->begin(), pooled_hosts->end(), this),
+      pooled_hosts->end());
   if (!destroying_) {
     // We weren't explicitly told to destroy ourselves, which means the menu was
     // deleted out from under us (the window we're parented to was closed). Tell
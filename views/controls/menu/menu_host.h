@@ -26,12 +26,22 @@ class Widget;
 // OS destroys the widget out from under us, in which case |MenuHostDestroyed|
 // is invoked back on the SubmenuView and the SubmenuView then drops references
 // to the MenuHost.
+//
+// Rather than destroying its window, |DestroyMenuHost| keeps a few hidden
+// MenuHosts, which |GetMenuHost| hands to the next menus shown with the same
+// parent, so that frequently shown menus don't create and destroy a window,
+// a RootView and a layered window bitmap each time.
 class MenuHost : public Widget {
  public:
   explicit MenuHost(SubmenuView* submenu);
   virtual ~MenuHost();
 
-  // Initializes and shows the MenuHost.
+  // Returns a hidden MenuHost kept for |parent|, now housing |submenu|, or a
+  // new one if there is none.
+  static MenuHost* GetMenuHost(SubmenuView* submenu, Widget* parent);
+
+  // Initializes and shows the MenuHost. A MenuHost from |GetMenuHost| that
+  // was initialized before only takes the new bounds and contents.
   void InitMenuHost(Widget* parent,
                     const gfx::Rect& bounds,
                     View* contents_view,
@@ -47,7 +57,7 @@ class MenuHost : public Widget {
   // Hides the menu host.
   void HideMenuHost();
 
-  // Destroys and deletes the menu host.
+  // Destroys and deletes the menu host, or hides it and keeps it for reuse.
   void DestroyMenuHost();
 
   // Sets the bounds of the menu host.
@@ -63,9 +73,13 @@ class MenuHost : public Widget {
   virtual void OnMouseCaptureLost() OVERRIDE;
   virtual void OnNativeWidgetDestroyed() OVERRIDE;
 
-  // The view we contain.
+  // The view we contain. NULL while the menu host is kept for reuse.
   SubmenuView* submenu_;
 
+  // The parent given to |InitMenuHost|, and whether it was invoked.
+  Widget* parent_;
+  bool initialized_;
+
   // If true, DestroyMenuHost has been invoked.
   bool destroying_;
 
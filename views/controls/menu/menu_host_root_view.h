@@ -24,6 +24,7 @@ class MenuHostRootView : public internal::RootView {
   MenuHostRootView(Widget* widget, SubmenuView* submenu);
 
   void ClearSubmenu() { submenu_ = NULL; }
+  void set_submenu(SubmenuView* submenu) { submenu_ = submenu; }
 
   // Overridden from View:
   virtual bool OnMousePressed(const MouseEvent& event) OVERRIDE;
@@ -290,6 +290,7 @@ void MenuItemView::SetTitle(const std::wstring& title) {
   title_ = WideToUTF16Hack(title);
   accessible_name_ = GetAccessibleNameForMenuItem(title_, GetAcceleratorText());
   pref_size_.SetSize(0, 0);  // Triggers preferred size recalculation.
+  InvalidateParentSubmenuLayouts();
 }
 
 void MenuItemView::SetSelected(bool selected) {
@@ -441,6 +442,7 @@ void MenuItemView::SetMargins(int top_margin, int bottom_margin) {
 
   // invalidate GetPreferredSize() cache
   pref_size_.SetSize(0,0);
+  InvalidateParentSubmenuLayouts();
 }
 
 MenuItemView::MenuItemView(MenuItemView* parent,
@@ -663,6 +665,11 @@ int MenuItemView::GetBottomMargin() {
         MenuConfig::instance().item_no_icon_bottom_margin;
 }
 
+void MenuItemView::InvalidateParentSubmenuLayouts() {
+  if (parent_menu_item_ && parent_menu_item_->HasSubmenu())
+    parent_menu_item_->GetSubmenu()->InvalidateChildLayouts();
+}
+
 gfx::Size MenuItemView::GetChildPreferredSize() {
   if (!has_children())
     return gfx::Size();
@@ -392,6 +392,9 @@ class VIEWS_EXPORT MenuItemView : public View {
   // Returns the preferred size (and padding) of any children.
   gfx::Size GetChildPreferredSize();
 
+  // Has the submenu this item is in measure it again.
+  void InvalidateParentSubmenuLayouts();
+
   // Calculates the preferred size.
   gfx::Size CalculatePreferredSize();
 
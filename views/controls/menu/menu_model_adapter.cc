@@ -35,9 +35,12 @@ void MenuModelAdapter::BuildMenu(MenuItemView* menu) {
   // Leave entries in the map if the menu is being shown.  This
   // allows the map to find the menu model of submenus being closed
   // so ui::MenuModel::MenuClosed() can be called.
-  if (!menu->GetMenuController())
+  if (!menu->GetMenuController()) {
     menu_map_.clear();
+    unbuilt_menus_.clear();
+  }
   menu_map_[menu] = menu_model_;
+  unbuilt_menus_.erase(menu);
 
   // Repopulate the menu.
   BuildMenuImpl(menu, menu_model_);
@@ -154,6 +157,11 @@ void MenuModelAdapter::WillShowMenu(MenuItemView* menu) {
       menu_map_.find(menu);
   if (map_iterator != menu_map_.end()) {
     map_iterator->second->MenuWillShow();
+
+    // Add the items now that the submenu is needed.  MenuController adds the
+    // empty menu items as the number of children changed.
+    if (unbuilt_menus_.erase(menu))
+      BuildMenuImpl(menu, map_iterator->second);
     return;
   }
 
@@ -188,9 +196,10 @@ void MenuModelAdapter::BuildMenuImpl(MenuItemView* menu, ui::MenuModel* model) {
       DCHECK_EQ(MenuItemView::SUBMENU, item->GetType());
       ui::MenuModel* submodel = model->GetSubmenuModelAt(index);
       DCHECK(submodel);
-      BuildMenuImpl(item, submodel);
-
+      // Menus such as bookmarks nest thousands of items, most of which are
+      // never shown, so the submenu is only built by WillShowMenu().
       menu_map_[item] = submodel;
+      unbuilt_menus_.insert(item);
     }
   }
 
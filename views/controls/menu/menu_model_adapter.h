@@ -7,6 +7,7 @@
 #pragma once
 
 #include <map>
+#include <set>
 
 #include "views/controls/menu/menu_delegate.h"
 
@@ -26,8 +27,8 @@ class VIEWS_EXPORT MenuModelAdapter : public MenuDelegate {
   explicit MenuModelAdapter(ui::MenuModel* menu_model);
   virtual ~MenuModelAdapter();
 
-  // Populate a MenuItemView menu with the ui::MenuModel items
-  // (including submenus).
+  // Populate a MenuItemView menu with the ui::MenuModel items.  The items of
+  // submenus are added when the submenu is first shown.
   virtual void BuildMenu(MenuItemView* menu);
 
   // Convenience for creating and populating a menu. The caller owns the
@@ -72,6 +73,9 @@ class VIEWS_EXPORT MenuModelAdapter : public MenuDelegate {
   // Map MenuItems to MenuModels.  Used to implement WillShowMenu().
   std::map<MenuItemView*, ui::MenuModel*> menu_map_;
 
+  // Submenus whose items haven't been added yet.  WillShowMenu() adds them.
+  std::set<MenuItemView*> unbuilt_menus_;
+
   DISALLOW_COPY_AND_ASSIGN(MenuModelAdapter);
 };
 
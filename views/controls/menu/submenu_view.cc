@@ -4,6 +4,8 @@
 
 #include "views/controls/menu/submenu_view.h"
 
+#include <algorithm>
+
 #include "ui/base/accessibility/accessible_view_state.h"
 #include "ui/gfx/canvas.h"
 #include "views/controls/menu/menu_config.h"
@@ -39,7 +41,9 @@ SubmenuView::SubmenuView(MenuItemView* parent)
       scroll_view_container_(NULL),
       max_accelerator_width_(0),
       minimum_preferred_width_(0),
-      resize_open_menu_(false) {
+      resize_open_menu_(false),
+      child_layouts_valid_(false),
+      child_bounds_valid_(false) {
   DCHECK(parent);
   // We'll delete ourselves, otherwise the ScrollView would delete us on close.
   set_parent_owned(false);
@@ -73,7 +77,25 @@ MenuItemView* SubmenuView::GetMenuItemAt(int index) {
   return NULL;
 }
 
+bool SubmenuView::GetLaidOutChildAt(const gfx::Point& point, View** child) {
+  if (!child_bounds_valid_)
+    return false;
+  *child = NULL;
+  std::vector<ChildLayout>::const_iterator i =
+      std::upper_bound(child_layouts_.begin(), child_layouts_.end(),
+                       point.y(), &SubmenuView::IsAboveBottom);
+  if (i != child_layouts_.end() && i->child->bounds().Contains(point))
+    *child = i->child;
+  return true;
+}
+
+void SubmenuView::InvalidateChildLayouts() {
+  child_layouts_valid_ = false;
+  child_bounds_valid_ = false;
+}
+
 void SubmenuView::ChildPreferredSizeChanged(View* child) {
+  InvalidateChildLayouts();
   if (!resize_open_menu_)
     return;
 
@@ -101,48 +123,33 @@ void SubmenuView::Layout() {
     new_y = 0;
   SetBounds(x(), new_y, parent()->width(), pref_height);
 
+  // The children don't change while they are laid out, so the heights
+  // measured for GetPreferredSize() are those to give them.
+  UpdateChildLayouts();
   gfx::Insets insets = GetInsets();
   int x = insets.left();
   int y = insets.top();
   int menu_item_width = width() - insets.width();
-  for (int i = 0; i < child_count(); ++i) {
-    View* child = child_at(i);
-    if (child->IsVisible()) {
-      gfx::Size child_pref_size = child->GetPreferredSize();
-      child->SetBounds(x, y, menu_item_width, child_pref_size.height());
-      y += child_pref_size.height();
-    }
+  for (size_t i = 0; i < child_layouts_.size(); ++i) {
+    ChildLayout& child_layout = child_layouts_[i];
+    child_layout.child->SetBounds(x, y, menu_item_width, child_layout.height);
+    y += child_layout.height;
+    child_layout.bottom = y;
   }
+  child_bounds_valid_ = child_layouts_valid_;
 }
 
 gfx::Size SubmenuView::GetPreferredSize() {
   if (!has_children())
     return gfx::Size();
 
-  max_accelerator_width_ = 0;
-  int max_width = 0;
-  int height = 0;
-  for (int i = 0; i < child_count(); ++i) {
-    View* child = child_at(i);
-    gfx::Size child_pref_size = child->IsVisible() ?
-        child->GetPreferredSize() : gfx::Size();
-    max_width = std::max(max_width, child_pref_size.width());
-    height += child_pref_size.height();
-    if (child->id() == MenuItemView::kMenuItemViewID) {
-      MenuItemView* menu = static_cast<MenuItemView*>(child);
-      max_accelerator_width_ =
-          std::max(max_accelerator_width_, menu->GetAcceleratorTextWidth());
-    }
-  }
-  if (max_accelerator_width_ > 0) {
-    max_accelerator_width_ +=
-        MenuConfig::instance().label_to_accelerator_padding;
-  }
+  UpdateChildLayouts();
   gfx::Insets insets = GetInsets();
   return gfx::Size(
-      std::max(max_width + max_accelerator_width_ + insets.width(),
+      std::max(children_size_.width() + max_accelerator_width_ +
+                   insets.width(),
                minimum_preferred_width_ - 2 * kSubmenuBorderSize),
-      height + insets.height());
+      children_size_.height() + insets.height());
 }
 
 void SubmenuView::GetAccessibleState(ui::AccessibleViewState* state) {
@@ -242,6 +249,43 @@ bool SubmenuView::OnMouseWheel(const MouseWheelEvent& e) {
   return true;
 }
 
+void SubmenuView::UpdateChildLayouts() {
+  if (child_layouts_valid_)
+    return;
+
+  max_accelerator_width_ = 0;
+  int max_width = 0;
+  int height = 0;
+  child_layouts_.clear();
+  for (int i = 0; i < child_count(); ++i) {
+    View* child = child_at(i);
+    if (!child->IsVisible())
+      continue;
+    gfx::Size child_pref_size = child->GetPreferredSize();
+    ChildLayout child_layout = { child, child_pref_size.height(), 0 };
+    child_layouts_.push_back(child_layout);
+    max_width = std::max(max_width, child_pref_size.width());
+    height += child_pref_size.height();
+    if (child->id() == MenuItemView::kMenuItemViewID) {
+      MenuItemView* menu = static_cast<MenuItemView*>(child);
+      max_accelerator_width_ =
+          std::max(max_accelerator_width_, menu->GetAcceleratorTextWidth());
+    }
+  }
+  if (max_accelerator_width_ > 0) {
+    max_accelerator_width_ +=
+        MenuConfig::instance().label_to_accelerator_padding;
+  }
+  children_size_.SetSize(max_width, height);
+  child_layouts_valid_ = true;
+  child_bounds_valid_ = false;
+}
+
+// static
+bool SubmenuView::IsAboveBottom(int y, const ChildLayout& child_layout) {
+  return y < child_layout.bottom;
+}
+
 bool SubmenuView::IsShowing() {
   return host_ && host_->IsMenuHostVisible();
 }
@@ -249,10 +293,12 @@ bool SubmenuView::IsShowing() {
 void SubmenuView::ShowAt(Widget* parent,
                          const gfx::Rect& bounds,
                          bool do_capture) {
+  // The sizes of the menu parts may have changed since the menu last ran.
+  InvalidateChildLayouts();
   if (host_) {
     host_->ShowMenuHost(do_capture);
   } else {
-    host_ = new MenuHost(this);
+    host_ = MenuHost::GetMenuHost(this, parent);
     // Force construction of the scroll view container.
     GetScrollViewContainer();
     // Make sure the first row is visible.
@@ -350,6 +396,18 @@ void SubmenuView::OnBoundsChanged(const gfx::Rect& previous_bounds) {
   SchedulePaint();
 }
 
+void SubmenuView::ChildVisibilityChanged(View* child) {
+  InvalidateChildLayouts();
+}
+
+void SubmenuView::ViewHierarchyChanged(bool is_add,
+                                       View* parent,
+                                       View* child) {
+  // The items are added and removed as the menu model changes.
+  if (parent == this)
+    InvalidateChildLayouts();
+}
+
 void SubmenuView::PaintDropIndicator(gfx::Canvas* canvas,
                                      MenuItemView* item,
                                      MenuDelegate::DropPosition position) {
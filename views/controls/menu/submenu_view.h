@@ -7,6 +7,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "views/controls/menu/menu_delegate.h"
 #include "views/view.h"
@@ -48,6 +49,17 @@ class VIEWS_EXPORT SubmenuView : public View {
   // Returns the MenuItemView at the specified index.
   MenuItemView* GetMenuItemAt(int index);
 
+  // Finds the child whose bounds contain |point|, in the coordinates of the
+  // submenu, by a binary search of the bounds the last Layout() gave the
+  // children. Sets |child| to NULL if no child is there. Returns false if the
+  // children changed since, in which case the caller has to look for it.
+  bool GetLaidOutChildAt(const gfx::Point& point, View** child);
+
+  // Drops the preferred sizes of the children, and their bounds, that are
+  // kept between layouts. Invoked by the children whose sizes change without
+  // a PreferredSizeChanged(), such as when a menu item's title is set.
+  void InvalidateChildLayouts();
+
   // Positions and sizes the child views. This tiles the views vertically,
   // giving each child the available width.
   virtual void Layout() OVERRIDE;
@@ -154,8 +166,25 @@ class VIEWS_EXPORT SubmenuView : public View {
   virtual void OnBoundsChanged(const gfx::Rect& previous_bounds) OVERRIDE;
 
   virtual void ChildPreferredSizeChanged(View* child) OVERRIDE;
+  virtual void ChildVisibilityChanged(View* child) OVERRIDE;
+  virtual void ViewHierarchyChanged(bool is_add,
+                                    View* parent,
+                                    View* child) OVERRIDE;
 
  private:
+  // A visible child, with its preferred height and, once laid out, the
+  // bottom of its bounds.
+  struct ChildLayout {
+    View* child;
+    int height;
+    int bottom;
+  };
+
+  // Measures the visible children into |child_layouts_|, if they changed
+  // since they were last measured.
+  void UpdateChildLayouts();
+
+  static bool IsAboveBottom(int y, const ChildLayout& child_layout);
   // Paints the drop indicator. This is only invoked if item is non-NULL and
   // position is not DROP_NONE.
   void PaintDropIndicator(gfx::Canvas* canvas,
@@ -195,6 +224,20 @@ class VIEWS_EXPORT SubmenuView : public View {
   // Reposition open menu when contained views change size.
   bool resize_open_menu_;
 
+  // The visible children, in order, so sorted by y once laid out. Measuring
+  // the menu items is costly, and the mouse moving over the menu would
+  // otherwise measure them and walk all of them again and again.
+  std::vector<ChildLayout> child_layouts_;
+
+  // The widest preferred width of the children and the sum of their
+  // preferred heights, when |child_layouts_valid_|.
+  gfx::Size children_size_;
+
+  // Whether |child_layouts_| has the current children, and whether it has
+  // the bounds Layout() gave them.
+  bool child_layouts_valid_;
+  bool child_bounds_valid_;
+
   DISALLOW_COPY_AND_ASSIGN(SubmenuView);
 };
 
@@ -4,14 +4,32 @@
 
 #include "views/controls/scroll_view.h"
 
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "base/i18n/rtl.h"
 #include "base/logging.h"
+#include "ui/gfx/compositor/compositor.h"
 #include "views/controls/scrollbar/native_scroll_bar.h"
+#include "views/paint_lock.h"
 #include "views/widget/root_view.h"
+#include "views/widget/widget.h"
 
 namespace views {
 
 const char* const ScrollView::kViewClassName = "views/ScrollView";
 
+namespace {
+
+// Each frame of the smooth scroll of the wheel covers this much of the
+// distance left, so that it eases out at the same speed at any frame rate.
+const double kWheelScrollFraction = 0.3;
+const double kWheelScrollFrameMs = 1000.0 / 60.0;
+
+}  // namespace
+
 // Viewport contains the contents View of the ScrollView.
 class Viewport : public View {
  public:
@@ -49,6 +67,8 @@ ScrollView::ScrollView(ScrollBar* horizontal_scrollbar,
 }
 
 ScrollView::~ScrollView() {
+  StopWheelScroll();
+
   // If scrollbars are currently not used, delete them
   if (!horiz_sb_->parent())
     delete horiz_sb_;
@@ -61,6 +81,7 @@ ScrollView::~ScrollView() {
 }
 
 void ScrollView::SetContents(View* a_view) {
+  StopWheelScroll();
   if (contents_ && contents_ != a_view) {
     viewport_->RemoveChildView(contents_);
     delete contents_;
@@ -70,6 +91,7 @@ void ScrollView::SetContents(View* a_view) {
   if (a_view) {
     contents_ = a_view;
     viewport_->AddChildView(contents_);
+    UpdateContentsLayer();
   }
 
   Layout();
@@ -79,6 +101,23 @@ View* ScrollView::GetContents() const {
   return contents_;
 }
 
+void ScrollView::SetScrollWithLayers(bool scroll_with_layers) {
+  if (scroll_with_layers == scroll_with_layers_)
+    return;
+  StopWheelScroll();
+  scroll_with_layers_ = scroll_with_layers;
+  viewport_->SetLayerMasksToBounds(scroll_with_layers_);
+  viewport_->SetPaintToLayer(scroll_with_layers_);
+  UpdateContentsLayer();
+}
+
+void ScrollView::UpdateContentsLayer() {
+  if (!contents_)
+    return;
+  contents_->SetLayerTiled(scroll_with_layers_);
+  contents_->SetPaintToLayer(scroll_with_layers_);
+}
+
 void ScrollView::Init(ScrollBar* horizontal_scrollbar,
                       ScrollBar* vertical_scrollbar,
                       View* resize_corner) {
@@ -88,6 +127,9 @@ void ScrollView::Init(ScrollBar* horizontal_scrollbar,
   horiz_sb_ = horizontal_scrollbar;
   vert_sb_ = vertical_scrollbar;
   resize_corner_ = resize_corner;
+  scroll_with_layers_ = false;
+  wheel_scroll_bar_ = NULL;
+  wheel_scroll_target_ = 0;
 
   viewport_ = new Viewport();
   AddChildView(viewport_);
@@ -310,6 +352,7 @@ void ScrollView::ScrollContentsRegionToBeVisible(const gfx::Rect& rect) {
   const int new_y =
       (vis_rect.y() > y) ? y : std::max(0, max_y - viewport_->height());
 
+  StopWheelScroll();
   contents_->SetX(-new_x);
   contents_->SetY(-new_y);
   UpdateScrollBarPositions();
@@ -334,8 +377,12 @@ void ScrollView::UpdateScrollBarPositions() {
   }
 }
 
-// TODO(ACW): We should really use ScrollWindowEx as needed
 void ScrollView::ScrollToPosition(ScrollBar* source, int position) {
+  StopWheelScroll();
+  ScrollContentsTo(source, position);
+}
+
+void ScrollView::ScrollContentsTo(ScrollBar* source, int position) {
   if (!contents_)
     return;
 
@@ -349,8 +396,7 @@ void ScrollView::ScrollToPosition(ScrollBar* source, int position) {
         position = 0;
       else if (position > max_pos)
         position = max_pos;
-      contents_->SetX(-position);
-      contents_->SchedulePaintInRect(contents_->GetVisibleBounds());
+      MoveContents(-position, contents_->y());
     }
   } else if (source == vert_sb_ && vert_sb_->IsVisible()) {
     int vh = viewport_->height();
@@ -362,12 +408,62 @@ void ScrollView::ScrollToPosition(ScrollBar* source, int position) {
         position = 0;
       else if (position > max_pos)
         position = max_pos;
-      contents_->SetY(-position);
-      contents_->SchedulePaintInRect(contents_->GetVisibleBounds());
+      MoveContents(contents_->x(), -position);
     }
   }
 }
 
+void ScrollView::MoveContents(int x, int y) {
+  int dx = x - contents_->x();
+  int dy = y - contents_->y();
+  if (!dx && !dy)
+    return;
+  if (contents_->layer()) {
+    // The compositor moves the pixels of the layer, and the tiles it
+    // uncovers are painted when it commits.
+    contents_->SetPosition(gfx::Point(x, y));
+    return;
+  }
+  gfx::Rect visible = viewport_->GetVisibleBounds();
+  Widget* widget = GetWidget();
+  // Mirroring reverses horizontal scrolling on the screen.
+  bool can_move = widget && !visible.IsEmpty() &&
+      abs(dx) < visible.width() && abs(dy) < visible.height() &&
+      !(dx && base::i18n::IsRTL());
+  for (const View* v = contents_; can_move && v; v = v->parent())
+    can_move = !v->layer() && !v->GetTransform().HasChange();
+
+  {
+    // The viewport is painted below, rather than the old and the new bounds
+    // of the contents.
+    PaintLock lock(contents_);
+    contents_->SetPosition(gfx::Point(x, y));
+  }
+  if (!can_move ||
+      !widget->ScrollRect(viewport_->ConvertRectToWidget(visible),
+                          gfx::Point(dx, dy))) {
+    viewport_->SchedulePaintInRect(visible);
+    return;
+  }
+
+  // What the contents paint doesn't change, but what the viewport and its
+  // ancestors paint does, which this clears the paint caches of.
+  gfx::Rect uncovered = visible;
+  if (dx > 0) {
+    uncovered.set_width(dx);
+  } else if (dx < 0) {
+    uncovered.set_x(visible.right() + dx);
+    uncovered.set_width(-dx);
+  }
+  if (dy > 0) {
+    uncovered.set_height(dy);
+  } else if (dy < 0) {
+    uncovered.set_y(visible.bottom() + dy);
+    uncovered.set_height(-dy);
+  }
+  viewport_->SchedulePaintInRect(uncovered);
+}
+
 int ScrollView::GetScrollIncrement(ScrollBar* source, bool is_page,
                                    bool is_positive) {
   bool is_horizontal = source->IsHorizontal();
@@ -402,6 +498,16 @@ bool ScrollView::OnKeyPressed(const KeyEvent& event) {
 }
 
 bool ScrollView::OnMouseWheel(const MouseWheelEvent& e) {
+  if (contents_ && contents_->layer() && GetCompositor()) {
+    // Give vertical scrollbar priority
+    ScrollBar* scroll_bar = vert_sb_->IsVisible() ? vert_sb_ :
+        (horiz_sb_->IsVisible() ? horiz_sb_ : NULL);
+    if (!scroll_bar)
+      return false;
+    AnimateWheelScroll(scroll_bar, -e.offset());
+    return true;
+  }
+
   bool processed = false;
   // Give vertical scrollbar priority
   if (vert_sb_->IsVisible()) {
@@ -417,6 +523,77 @@ std::string ScrollView::GetClassName() const {
   return kViewClassName;
 }
 
+void ScrollView::OnCompositingEnded(ui::Compositor* compositor) {
+  if (compositor != wheel_scroll_compositor_.get())
+    return;
+  if (compositor != GetCompositor() || !contents_ || !contents_->layer()) {
+    StopWheelScroll();
+    return;
+  }
+  StepWheelScroll();
+}
+
+void ScrollView::AnimateWheelScroll(ScrollBar* scroll_bar, int offset) {
+  bool is_horizontal = scroll_bar->IsHorizontal();
+  int position = is_horizontal ? -contents_->x() : -contents_->y();
+  if (scroll_bar != wheel_scroll_bar_) {
+    StopWheelScroll();
+    wheel_scroll_bar_ = scroll_bar;
+    wheel_scroll_target_ = position;
+  }
+  int max_position = is_horizontal ?
+      std::max(0, contents_->width() - viewport_->width()) :
+      std::max(0, contents_->height() - viewport_->height());
+  wheel_scroll_target_ =
+      std::max(0, std::min(max_position, wheel_scroll_target_ + offset));
+
+  if (!wheel_scroll_compositor_.get()) {
+    wheel_scroll_compositor_ = GetCompositor();
+    wheel_scroll_compositor_->AddObserver(this);
+    // The first step is a frame's, taken now. The layer it moves has the
+    // compositor draw the frame whose end takes the next.
+    wheel_scroll_frame_time_ = base::TimeTicks::Now() -
+        base::TimeDelta::FromMicroseconds(
+            static_cast<int64>(kWheelScrollFrameMs * 1000));
+    StepWheelScroll();
+  }
+}
+
+void ScrollView::StepWheelScroll() {
+  base::TimeTicks now = base::TimeTicks::Now();
+  double frames =
+      (now - wheel_scroll_frame_time_).InMillisecondsF() / kWheelScrollFrameMs;
+  wheel_scroll_frame_time_ = now;
+
+  bool is_horizontal = wheel_scroll_bar_->IsHorizontal();
+  int position = is_horizontal ? -contents_->x() : -contents_->y();
+  int remaining = wheel_scroll_target_ - position;
+  if (!remaining) {
+    StopWheelScroll();
+    return;
+  }
+  // At least a pixel, so that the layer moves, and the next frame is drawn.
+  int step = static_cast<int>(
+      remaining * (1.0 - pow(1.0 - kWheelScrollFraction, frames)));
+  if (!step)
+    step = remaining > 0 ? 1 : -1;
+  ScrollContentsTo(wheel_scroll_bar_, position + step);
+  UpdateScrollBarPositions();
+
+  int new_position = is_horizontal ? -contents_->x() : -contents_->y();
+  // The contents may have shrunk under the target.
+  if (new_position == wheel_scroll_target_ || new_position == position)
+    StopWheelScroll();
+}
+
+void ScrollView::StopWheelScroll() {
+  if (wheel_scroll_compositor_.get()) {
+    wheel_scroll_compositor_->RemoveObserver(this);
+    wheel_scroll_compositor_ = NULL;
+  }
+  wheel_scroll_bar_ = NULL;
+}
+
 int ScrollView::GetScrollBarWidth() const {
   return vert_sb_->GetLayoutSize();
 }
@@ -8,6 +8,10 @@
 
 #include <string>
 
+#include "base/compiler_specific.h"
+#include "base/memory/ref_counted.h"
+#include "base/time.h"
+#include "ui/gfx/compositor/compositor_observer.h"
 #include "views/controls/scrollbar/scroll_bar.h"
 
 namespace views {
@@ -24,9 +28,16 @@ namespace views {
 //
 // The scrollview supports keyboard UI and mousewheel.
 //
+// When it scrolls with layers, and the Widget has a compositor, the contents
+// paint to a tiled layer, in a layer of the viewport that clips it. Scrolling
+// then only moves the layer, and paints the tiles it uncovers, and the mouse
+// wheel scrolls smoothly, a step at each frame the compositor draws.
+//
 /////////////////////////////////////////////////////////////////////////////
 
-class VIEWS_EXPORT ScrollView : public View, public ScrollBarController {
+class VIEWS_EXPORT ScrollView : public View,
+                                public ScrollBarController,
+                                public ui::CompositorObserver {
  public:
   static const char* const kViewClassName;
 
@@ -42,6 +53,10 @@ class VIEWS_EXPORT ScrollView : public View, public ScrollBarController {
   void SetContents(View* a_view);
   View* GetContents() const;
 
+  // Sets whether the contents scroll with layers, see above. Off by default.
+  void SetScrollWithLayers(bool scroll_with_layers);
+  bool scroll_with_layers() const { return scroll_with_layers_; }
+
   // Overridden to layout the viewport and scrollbars.
   virtual void Layout();
 
@@ -77,6 +92,9 @@ class VIEWS_EXPORT ScrollView : public View, public ScrollBarController {
 
   virtual std::string GetClassName() const;
 
+  // ui::CompositorObserver:
+  virtual void OnCompositingEnded(ui::Compositor* compositor) OVERRIDE;
+
   // Retrieves the vertical scrollbar width.
   int GetScrollBarWidth() const;
 
@@ -107,6 +125,30 @@ class VIEWS_EXPORT ScrollView : public View, public ScrollBarController {
   // Update the scrollbars positions given viewport and content sizes.
   void UpdateScrollBarPositions();
 
+  // Moves the contents to |x|, |y| and schedules the painting of the
+  // viewport: only of the part the contents uncover if the Widget can move
+  // the pixels of the rest, which it can't when they have a layer or a
+  // transform. The views over the viewport, if any, move with it.
+  void MoveContents(int x, int y);
+
+  // Scrolls the contents to |position| of |source|, within its range.
+  void ScrollContentsTo(ScrollBar* source, int position);
+
+  // Has the contents paint to a tiled layer, under the viewport's layer that
+  // clips it, if |scroll_with_layers_|, and to the viewport otherwise.
+  void UpdateContentsLayer();
+
+  // Starts, or extends, the smooth scroll of the wheel, by |offset| of the
+  // position of |scroll_bar|.
+  void AnimateWheelScroll(ScrollBar* scroll_bar, int offset);
+
+  // Takes the step of the smooth scroll of the wheel for the frame that the
+  // compositor drew last, or ends it.
+  void StepWheelScroll();
+
+  // Stops the smooth scroll of the wheel, where it is.
+  void StopWheelScroll();
+
   // Make sure the content is not scrolled out of bounds
   void CheckScrollBounds();
 
@@ -128,6 +170,16 @@ class VIEWS_EXPORT ScrollView : public View, public ScrollBarController {
   // Resize corner.
   View* resize_corner_;
 
+  bool scroll_with_layers_;
+
+  // The compositor whose frames step the smooth scroll of the wheel, while
+  // it runs, the scroll bar whose position it scrolls, the position it
+  // scrolls to, and when the last frame was drawn.
+  scoped_refptr<ui::Compositor> wheel_scroll_compositor_;
+  ScrollBar* wheel_scroll_bar_;
+  int wheel_scroll_target_;
+  base::TimeTicks wheel_scroll_frame_time_;
+
   DISALLOW_COPY_AND_ASSIGN(ScrollView);
 };
 
@@ -4,6 +4,8 @@
 
 #include "views/controls/table/group_table_view.h"
 
+#include <algorithm>
+
 #include "base/compiler_specific.h"
 #include "base/message_loop.h"
 #include "base/task.h"
@@ -27,7 +29,8 @@ GroupTableView::GroupTableView(GroupTableModel* model,
                 autosize_columns),
     model_(model),
     draw_group_separators_(draw_group_separators),
-    ALLOW_THIS_IN_INITIALIZER_LIST(sync_selection_factory_(this)) {
+    ALLOW_THIS_IN_INITIALIZER_LIST(sync_selection_factory_(this)),
+    group_row_count_(0) {
 }
 
 GroupTableView::~GroupTableView() {
@@ -38,7 +41,7 @@ void GroupTableView::SyncSelection() {
   int row_count = model_->RowCount();
   GroupRange group_range;
   while (index < row_count) {
-    model_->GetGroupRangeForItem(index, &group_range);
+    GetGroupRange(index, &group_range);
     if (group_range.length == 1) {
       // No synching required for single items.
       index++;
@@ -111,7 +114,7 @@ bool GroupTableView::OnKeyDown(ui::KeyboardCode virtual_keycode) {
 
   // Nothing to do if the item which has the focus is not part of a group.
   GroupRange group_range;
-  model_->GetGroupRangeForItem(focused_index, &group_range);
+  GetGroupRange(focused_index, &group_range);
   if (group_range.length == 1)
     return false;
 
@@ -129,20 +132,18 @@ bool GroupTableView::OnKeyDown(ui::KeyboardCode virtual_keycode) {
 }
 
 void GroupTableView::PrepareForSort() {
-  GroupRange range;
-  int row_count = RowCount();
-  model_index_to_range_start_map_.clear();
-  for (int model_row = 0; model_row < row_count;) {
-    model_->GetGroupRangeForItem(model_row, &range);
-    for (int range_counter = 0; range_counter < range.length; range_counter++)
-      model_index_to_range_start_map_[range_counter + model_row] = model_row;
-    model_row += range.length;
+  if (model_->RowCount() > 0) {
+    GroupRange range;
+    GetGroupRange(0, &range);
   }
 }
 
 int GroupTableView::CompareRows(int model_row1, int model_row2) {
-  int range1 = model_index_to_range_start_map_[model_row1];
-  int range2 = model_index_to_range_start_map_[model_row2];
+  GroupRange group1, group2;
+  GetGroupRange(model_row1, &group1);
+  GetGroupRange(model_row2, &group2);
+  int range1 = group1.start;
+  int range2 = group2.start;
   if (range1 == range2) {
     // The two rows are in the same group, sort so that items in the same group
     // always appear in the same order.
@@ -174,7 +175,7 @@ void GroupTableView::PostPaint(int model_row, int column, bool selected,
     return;
 
   GroupRange group_range;
-  model_->GetGroupRangeForItem(model_row, &group_range);
+  GetGroupRange(model_row, &group_range);
 
   // We always paint a vertical line at the end of the last cell.
   HPEN hPen = CreatePen(PS_SOLID, kSeparatorLineThickness, kSeparatorLineColor);
@@ -197,4 +198,47 @@ std::string GroupTableView::GetClassName() const {
   return kViewClassName;
 }
 
+void GroupTableView::OnModelChanged() {
+  group_starts_.clear();
+  TableView::OnModelChanged();
+}
+
+void GroupTableView::OnItemsChanged(int start, int length) {
+  group_starts_.clear();
+  TableView::OnItemsChanged(start, length);
+}
+
+void GroupTableView::OnItemsAdded(int start, int length) {
+  group_starts_.clear();
+  TableView::OnItemsAdded(start, length);
+}
+
+void GroupTableView::OnItemsRemoved(int start, int length) {
+  group_starts_.clear();
+  TableView::OnItemsRemoved(start, length);
+}
+
+void GroupTableView::GetGroupRange(int model_row, GroupRange* range) {
+  if (group_starts_.empty()) {
+    group_row_count_ = model_->RowCount();
+    GroupRange group;
+    for (int row = 0; row < group_row_count_;
+         row += std::max(group.length, 1)) {
+      model_->GetGroupRangeForItem(row, &group);
+      DCHECK_EQ(row, group.start);
+      DCHECK_GT(group.length, 0);
+      group_starts_.push_back(row);
+    }
+  }
+  DCHECK(model_row >= 0 && model_row < group_row_count_);
+
+  // The group of |model_row| is the last one starting at or before it.
+  std::vector<int>::const_iterator next =
+      std::upper_bound(group_starts_.begin(), group_starts_.end(), model_row);
+  DCHECK(next != group_starts_.begin());
+  range->start = *(next - 1);
+  range->length =
+      (next == group_starts_.end() ? group_row_count_ : *next) - range->start;
+}
+
 }  // namespace views
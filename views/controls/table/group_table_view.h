@@ -6,6 +6,8 @@
 #define VIEWS_CONTROLS_TABLE_GROUP_TABLE_VIEW_H_
 #pragma once
 
+#include <vector>
+
 #include "base/task.h"
 #include "ui/base/models/table_model.h"
 #include "views/controls/table/table_view.h"
@@ -43,6 +45,13 @@ class VIEWS_EXPORT GroupTableView : public TableView {
 
   virtual std::string GetClassName() const;
 
+  // Overridden from TableView, to drop the group ranges, which the rows
+  // changing may change.
+  virtual void OnModelChanged() OVERRIDE;
+  virtual void OnItemsChanged(int start, int length) OVERRIDE;
+  virtual void OnItemsAdded(int start, int length) OVERRIDE;
+  virtual void OnItemsRemoved(int start, int length) OVERRIDE;
+
  protected:
   // Notification from the ListView that the selected state of an item has
   // changed.
@@ -62,13 +71,18 @@ class VIEWS_EXPORT GroupTableView : public TableView {
   // Overriden to make sure rows in the same group stay grouped together.
   virtual int CompareRows(int model_row1, int model_row2);
 
-  // Updates model_index_to_range_start_map_ from the model.
+  // Builds the group ranges before the rows are compared.
   virtual void PrepareForSort();
 
  private:
   // Make the selection of group consistent.
   void SyncSelection();
 
+  // Sets |range| to the group of |model_row|, looked up in |group_starts_|,
+  // which is built from the model for the first lookup after the rows
+  // change, rather than asking the model, which may have to scan each time.
+  void GetGroupRange(int model_row, GroupRange* range);
+
   GroupTableModel* model_;
 
   // If true, draw separators between groups.
@@ -77,8 +91,10 @@ class VIEWS_EXPORT GroupTableView : public TableView {
   // A factory to make the selection consistent among groups.
   ScopedRunnableMethodFactory<GroupTableView> sync_selection_factory_;
 
-  // Maps from model row to start of group.
-  std::map<int,int> model_index_to_range_start_map_;
+  // The first model row of each group, in order, and the row count they were
+  // built for. Empty until the first GetGroupRange() after the rows change.
+  std::vector<int> group_starts_;
+  int group_row_count_;
 
   DISALLOW_COPY_AND_ASSIGN(GroupTableView);
 };
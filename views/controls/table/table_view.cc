@@ -9,8 +9,13 @@
 
 #include <algorithm>
 
+#include "base/atomicops.h"
+#include "base/bind.h"
 #include "base/i18n/rtl.h"
+#include "base/message_loop.h"
+#include "base/message_loop_proxy.h"
 #include "base/string_util.h"
+#include "base/threading/worker_pool.h"
 #include "skia/ext/skia_utils_win.h"
 #include "third_party/skia/include/core/SkBitmap.h"
 #include "third_party/skia/include/core/SkColorFilter.h"
@@ -35,6 +40,16 @@ int GetViewIndexFromPoint(HWND window, const gfx::Point& p) {
   return ListView_HitTest(window, &hit_info);
 }
 
+// Returns the index model_row has after length rows were added to the model at
+// start, or removed if add is false, or -1 if it was removed.
+int GetMovedModelRow(int model_row, int start, int length, bool add) {
+  if (model_row < start)
+    return model_row;
+  if (add)
+    return model_row + length;
+  return model_row < start + length ? -1 : model_row - length;
+}
+
 }  // namespace
 
 namespace views {
@@ -43,6 +58,167 @@ namespace views {
 const int kListViewTextPadding = 15;
 // Additional column width necessary if column has icons.
 const int kListViewIconWidthAndPadding = 18;
+// Number of added rows measured to size the columns of an owner data table.
+// Measuring all of them would take as long as inserting them.
+const int kOwnerDataMeasuredRows = 100;
+// Maximum number of rows kept in the cache of an owner data table.
+const int kMaxOwnerDataCachedRows = 256;
+// Tables with fewer rows are sorted right away, even with background sorts.
+const int kMinBackgroundSortRows = 1000;
+// Number of rows whose sort keys are computed per task of a background sort.
+const int kSortKeyRowsPerTask = 1000;
+
+// TableView::RowComparator ---------------------------------------------------
+
+class TableView::RowComparator {
+ public:
+  explicit RowComparator(TableView* table_view) : table_view_(table_view) {}
+
+  bool operator()(int model_row1, int model_row2) const {
+    return table_view_->CompareRows(model_row1, model_row2) < 0;
+  }
+
+ private:
+  TableView* table_view_;
+};
+
+// TableView::BackgroundSort --------------------------------------------------
+
+// The sort keys of the rows are computed on the UI thread, a batch at a time,
+// as only it can use the model. The rows are then sorted by their keys on a
+// base::WorkerPool thread, and their order is posted back to the UI thread.
+class TableView::BackgroundSort
+    : public base::RefCountedThreadSafe<TableView::BackgroundSort> {
+ public:
+  BackgroundSort(TableView* table_view,
+                 const SortDescriptors& sort_descriptors)
+      : table_view_(table_view),
+        sort_descriptors_(sort_descriptors),
+        origin_loop_(base::MessageLoopProxy::current()),
+        has_groups_(table_view->model()->HasGroups()),
+        row_count_(table_view->model()->RowCount()),
+        cancelled_(0) {
+    rows_.reserve(row_count_);
+  }
+
+  const SortDescriptors& sort_descriptors() const { return sort_descriptors_; }
+  int rows_done() const { return static_cast<int>(rows_.size()); }
+  int row_count() const { return row_count_; }
+
+  // The model rows in their sorted order, once the sort is done.
+  std::vector<int>* sorted_rows() { return &sorted_rows_; }
+
+  // Computes the sort keys of up to |max_rows| more rows. Returns false if
+  // the model has no sort keys.
+  bool ComputeKeys(ui::TableModel* model, int max_rows) {
+    int end = std::min(rows_done() + max_rows, row_count_);
+    for (int row = rows_done(); row < end; ++row) {
+      rows_.push_back(SortRow());
+      SortRow& sort_row = rows_.back();
+      sort_row.group_id = has_groups_ ? model->GetGroupID(row) : 0;
+      for (size_t i = 0; i < arraysize(sort_row.keys) &&
+           i < sort_descriptors_.size(); ++i) {
+        int column_id = sort_descriptors_[i].column_id;
+        if (column_id != -1 &&
+            !model->GetSortKey(row, column_id, &sort_row.keys[i])) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Sorts the rows on a worker thread, once all the keys are computed.
+  void Start() {
+    DCHECK_EQ(row_count_, rows_done());
+    base::WorkerPool::PostTask(
+        FROM_HERE, base::Bind(&BackgroundSort::Sort, this), false);
+  }
+
+  // Makes the sort stop as soon as it can, and not reply.
+  void Cancel() {
+    table_view_ = NULL;
+    base::subtle::NoBarrier_Store(&cancelled_, 1);
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<BackgroundSort>;
+
+  struct SortRow {
+    int group_id;
+    // The keys of the primary and secondary sort columns.
+    std::string keys[2];
+  };
+
+  // Orders the indices of rows as TableView::CompareRows does, and then by
+  // index.
+  class SortRowLess {
+   public:
+    SortRowLess(const std::vector<SortRow>& rows,
+                const SortDescriptors& sort_descriptors,
+                bool has_groups)
+        : rows_(&rows),
+          sort_descriptors_(&sort_descriptors),
+          has_groups_(has_groups) {
+    }
+
+    bool operator()(int index1, int index2) const {
+      const SortRow& row1 = (*rows_)[index1];
+      const SortRow& row2 = (*rows_)[index2];
+      if (has_groups_ && row1.group_id != row2.group_id)
+        return row1.group_id < row2.group_id;
+      for (size_t i = 0; i < arraysize(row1.keys) &&
+           i < sort_descriptors_->size(); ++i) {
+        int result = row1.keys[i].compare(row2.keys[i]);
+        if (result != 0)
+          return (*sort_descriptors_)[i].ascending ? result < 0 : result > 0;
+      }
+      return index1 < index2;
+    }
+
+   private:
+    const std::vector<SortRow>* rows_;
+    const SortDescriptors* sort_descriptors_;
+    bool has_groups_;
+  };
+
+  ~BackgroundSort() {}
+
+  void Sort() {
+    if (base::subtle::NoBarrier_Load(&cancelled_))
+      return;
+    sorted_rows_.resize(rows_.size());
+    for (size_t i = 0; i < sorted_rows_.size(); ++i)
+      sorted_rows_[i] = static_cast<int>(i);
+    std::sort(sorted_rows_.begin(), sorted_rows_.end(),
+              SortRowLess(rows_, sort_descriptors_, has_groups_));
+    if (base::subtle::NoBarrier_Load(&cancelled_))
+      return;
+    origin_loop_->PostTask(FROM_HERE,
+                           base::Bind(&BackgroundSort::Reply, this));
+  }
+
+  void Reply() {
+    if (table_view_)
+      table_view_->OnBackgroundSortDone();
+  }
+
+  // Only used on the UI thread.
+  TableView* table_view_;
+
+  const SortDescriptors sort_descriptors_;
+  const scoped_refptr<base::MessageLoopProxy> origin_loop_;
+  const bool has_groups_;
+  const int row_count_;
+
+  // The rows, by model index.
+  std::vector<SortRow> rows_;
+  std::vector<int> sorted_rows_;
+
+  base::subtle::Atomic32 cancelled_;
+
+  DISALLOW_COPY_AND_ASSIGN(BackgroundSort);
+};
 
 // TableView ------------------------------------------------------------------
 
@@ -60,6 +236,9 @@ TableView::TableView(ui::TableModel* model,
       visible_columns_(),
       all_columns_(),
       column_count_(static_cast<int>(columns.size())),
+      owner_data_(false),
+      owner_data_cache_start_(0),
+      owner_data_cache_count_(0),
       table_type_(table_type),
       single_selection_(single_selection),
       ignore_listview_change_(false),
@@ -71,7 +250,13 @@ TableView::TableView(ui::TableModel* model,
       original_handler_(NULL),
       ALLOW_THIS_IN_INITIALIZER_LIST(table_view_wrapper_(this)),
       custom_cell_font_(NULL),
-      content_offset_(0) {
+      content_offset_(0),
+      background_sort_(false),
+      ALLOW_THIS_IN_INITIALIZER_LIST(sort_keys_factory_(this)),
+      update_depth_(0),
+      batched_changes_start_(0),
+      batched_changes_end_(0),
+      batched_sort_pending_(false) {
   for (std::vector<ui::TableColumn>::const_iterator i = columns.begin();
        i != columns.end(); ++i) {
     AddColumn(*i);
@@ -80,6 +265,7 @@ TableView::TableView(ui::TableModel* model,
 }
 
 TableView::~TableView() {
+  StopPendingSort();
   if (list_view_) {
     if (model_)
       model_->SetObserver(NULL);
@@ -101,7 +287,38 @@ void TableView::SetModel(ui::TableModel* model) {
     OnModelChanged();
 }
 
+void TableView::SetOwnerData(bool owner_data) {
+  // The style of the ListView can't change once it is created.
+  DCHECK(!list_view_);
+  owner_data_ = owner_data;
+}
+
 void TableView::SetSortDescriptors(const SortDescriptors& sort_descriptors) {
+  CancelSort();
+  // Sorting a few rows is faster than starting a background sort.
+  if (background_sort_ && list_view_ && model_ && !sort_descriptors.empty() &&
+      RowCount() >= kMinBackgroundSortRows) {
+    StartBackgroundSort(sort_descriptors);
+    return;
+  }
+  ApplySortDescriptors(sort_descriptors);
+}
+
+void TableView::SetBackgroundSort(bool background_sort) {
+  background_sort_ = background_sort;
+  if (!background_sort_)
+    CancelSort();
+}
+
+void TableView::CancelSort() {
+  if (!pending_sort_.get())
+    return;
+  StopPendingSort();
+  if (table_view_observer_)
+    table_view_observer_->OnSortDone(true);
+}
+
+void TableView::ApplySortDescriptors(const SortDescriptors& sort_descriptors) {
   if (!sort_descriptors_.empty()) {
     ResetColumnSortImage(sort_descriptors_[0].column_id,
                          NO_SORT);
@@ -119,9 +336,15 @@ void TableView::SetSortDescriptors(const SortDescriptors& sort_descriptors) {
   // isn't updated when done.
   SendMessage(list_view_, WM_SETREDRAW, static_cast<WPARAM>(FALSE), 0);
 
-  UpdateItemsLParams(0, 0);
+  if (owner_data_) {
+    ignore_listview_change_ = true;
+    UpdateOwnerDataItems(0, 0, true);
+    ignore_listview_change_ = false;
+  } else {
+    UpdateItemsLParams(0, 0);
 
-  SortItemsAndUpdateMapping();
+    SortItemsAndUpdateMapping();
+  }
 
   SendMessage(list_view_, WM_SETREDRAW, static_cast<WPARAM>(TRUE), 0);
 }
@@ -226,18 +449,53 @@ TableView::iterator TableView::SelectionEnd() {
   return TableView::iterator(this, -1);
 }
 
+void TableView::BeginUpdate() {
+  if (update_depth_++ == 0 && list_view_)
+    SendMessage(list_view_, WM_SETREDRAW, static_cast<WPARAM>(FALSE), 0);
+}
+
+void TableView::EndUpdate() {
+  DCHECK_GT(update_depth_, 0);
+  if (--update_depth_ > 0 || !list_view_)
+    return;
+
+  if (batched_sort_pending_) {
+    batched_sort_pending_ = false;
+    ignore_listview_change_ = true;
+    if (owner_data_) {
+      bool removed_selection = UpdateOwnerDataItems(0, 0, true);
+      DCHECK(!removed_selection);
+    } else {
+      SortItemsAndUpdateMapping();
+    }
+    ignore_listview_change_ = false;
+  }
+  SendMessage(list_view_, WM_SETREDRAW, static_cast<WPARAM>(TRUE), 0);
+
+  // The changed rows of a sorted table may have moved anywhere in view.
+  if (batched_changes_end_ > batched_changes_start_) {
+    if (is_sorted())
+      RedrawVisibleItems(0, RowCount() - 1);
+    else
+      RedrawVisibleItems(batched_changes_start_, batched_changes_end_ - 1);
+  }
+  batched_changes_start_ = batched_changes_end_ = 0;
+}
+
 void TableView::OnItemsChanged(int start, int length) {
   if (!list_view_)
     return;
 
+  RestartPendingSort();
+
   if (length == -1) {
     DCHECK_GE(start, 0);
     length = model_->RowCount() - start;
   }
   int row_count = RowCount();
   DCHECK(start >= 0 && length > 0 && start + length <= row_count);
-  SendMessage(list_view_, WM_SETREDRAW, static_cast<WPARAM>(FALSE), 0);
-  if (table_type_ == ICON_AND_TEXT) {
+  SetListViewRedraw(false);
+  if (table_type_ == ICON_AND_TEXT && !owner_data_) {
     // The redraw event does not include the icon in the clip rect, preventing
     // our icon from being repainted. So far the only way I could find around
     // this is to change the image for the item. Even if the image does not
@@ -259,13 +517,15 @@ void TableView::OnItemsChanged(int start, int length) {
     }
   }
   UpdateListViewCache(start, length, false);
-  SendMessage(list_view_, WM_SETREDRAW, static_cast<WPARAM>(TRUE), 0);
+  SetListViewRedraw(true);
 }
 
 void TableView::OnModelChanged() {
   if (!list_view_)
     return;
 
+  RestartPendingSort();
+
   UpdateGroups();
 
   int current_row_count = ListView_GetItemCount(list_view_);
@@ -279,30 +539,44 @@ void TableView::OnItemsAdded(int start, int length) {
   if (!list_view_)
     return;
 
+  RestartPendingSort();
+
   DCHECK(start >= 0 && length > 0 && start <= RowCount());
-  SendMessage(list_view_, WM_SETREDRAW, static_cast<WPARAM>(FALSE), 0);
+  SetListViewRedraw(false);
   UpdateListViewCache(start, length, true);
-  SendMessage(list_view_, WM_SETREDRAW, static_cast<WPARAM>(TRUE), 0);
+  SetListViewRedraw(true);
 }
 
 void TableView::OnItemsRemoved(int start, int length) {
   if (!list_view_)
     return;
 
+  RestartPendingSort();
+
   if (start < 0 || length < 0 || start + length > RowCount()) {
     NOTREACHED();
     return;
   }
 
-  SendMessage(list_view_, WM_SETREDRAW, static_cast<WPARAM>(FALSE), 0);
+  SetListViewRedraw(false);
 
   bool had_selection = (SelectedRowCount() > 0);
   int old_row_count = RowCount();
+  // The rows after those removed move up.
+  if (update_depth_)
+    AddBatchedChange(start, old_row_count - start);
   if (start == 0 && length == RowCount()) {
     // Everything was removed.
     ListView_DeleteAllItems(list_view_);
     view_to_model_.reset(NULL);
     model_to_view_.reset(NULL);
+    ClearOwnerDataCache();
+  } else if (owner_data_) {
+    ignore_listview_change_ = true;
+    bool removed_selection = UpdateOwnerDataItems(start, length, false);
+    ignore_listview_change_ = false;
+    if (removed_selection)
+      OnSelectedStateChanged();
   } else {
     // Only a portion of the data was removed.
     if (is_sorted()) {
@@ -343,7 +617,7 @@ void TableView::OnItemsRemoved(int start, int length) {
     }
   }
 
-  SendMessage(list_view_, WM_SETREDRAW, static_cast<WPARAM>(TRUE), 0);
+  SetListViewRedraw(true);
 
   // If the row count goes to zero and we had a selection LVN_ITEMCHANGED isn't
   // invoked, so we handle it here.
@@ -385,6 +659,7 @@ void TableView::SetColumns(const std::vector<ui::TableColumn>& columns) {
 
 void TableView::OnColumnsChanged() {
   column_count_ = static_cast<int>(visible_columns_.size());
+  ClearOwnerDataCache();
   ResetColumnSizes();
 }
 
@@ -760,6 +1035,8 @@ HWND TableView::CreateNativeControl(HWND parent_container) {
   int style = WS_CHILD | LVS_REPORT | LVS_SHOWSELALWAYS;
   if (single_selection_)
     style |= LVS_SINGLESEL;
+  if (owner_data_)
+    style |= LVS_OWNERDATA;
   // If there's only one column and the title string is empty, don't show a
   // header.
   if (all_columns_.size() == 1) {
@@ -843,7 +1120,9 @@ HWND TableView::CreateNativeControl(HWND parent_container) {
 }
 
 void TableView::ToggleSortOrder(int column_id) {
-  SortDescriptors sort = sort_descriptors();
+  // Toggles the sort the user asked for last.
+  SortDescriptors sort = is_sorting() ? pending_sort_->sort_descriptors() :
+                                        sort_descriptors();
   if (!sort.empty() && sort[0].column_id == column_id) {
     sort[0].ascending = !sort[0].ascending;
   } else {
@@ -880,12 +1159,22 @@ void TableView::SortItemsAndUpdateMapping() {
     return;
   }
 
-  PrepareForSort();
+  if (!sorted_rows_.empty() &&
+      static_cast<int>(sorted_rows_.size()) == RowCount()) {
+    // A background sort already ordered the rows.
+    std::vector<int> ranks(sorted_rows_.size());
+    for (size_t i = 0; i < sorted_rows_.size(); ++i)
+      ranks[sorted_rows_[i]] = static_cast<int>(i);
+    ListView_SortItems(list_view_, &TableView::RankSortFunc,
+                       reinterpret_cast<LPARAM>(&ranks[0]));
+  } else {
+    PrepareForSort();
 
-  // Sort the items.
-  ListView_SortItems(list_view_, &TableView::SortFunc, this);
+    // Sort the items.
+    ListView_SortItems(list_view_, &TableView::SortFunc, this);
 
-  model_->ClearCollator();
+    model_->ClearCollator();
+  }
 
   // Update internal mapping to match how items were actually sorted.
   int row_count = RowCount();
@@ -946,6 +1235,79 @@ int CALLBACK TableView::NaturalSortFunc(LPARAM model_index_1_p,
   return model_index_1_p - model_index_2_p;
 }
 
+// static
+int CALLBACK TableView::RankSortFunc(LPARAM model_index_1_p,
+                                     LPARAM model_index_2_p,
+                                     LPARAM table_view_param) {
+  const int* ranks = reinterpret_cast<const int*>(table_view_param);
+  return ranks[model_index_1_p] - ranks[model_index_2_p];
+}
+
+void TableView::StartBackgroundSort(const SortDescriptors& sort_descriptors) {
+  DCHECK(!pending_sort_.get());
+  pending_sort_ = new BackgroundSort(this, sort_descriptors);
+  MessageLoop::current()->PostTask(FROM_HERE,
+      sort_keys_factory_.NewRunnableMethod(&TableView::ComputeSortKeys));
+}
+
+void TableView::ComputeSortKeys() {
+  DCHECK(pending_sort_.get());
+  if (!pending_sort_->ComputeKeys(model_, kSortKeyRowsPerTask)) {
+    // The model has no sort keys, sort the rows the usual way.
+    SortDescriptors sort_descriptors = pending_sort_->sort_descriptors();
+    StopPendingSort();
+    ApplySortDescriptors(sort_descriptors);
+    if (table_view_observer_)
+      table_view_observer_->OnSortDone(false);
+    return;
+  }
+
+  if (table_view_observer_) {
+    table_view_observer_->OnSortProgress(pending_sort_->rows_done(),
+                                         pending_sort_->row_count());
+    // The observer may have cancelled the sort.
+    if (!pending_sort_.get())
+      return;
+  }
+
+  if (pending_sort_->rows_done() < pending_sort_->row_count()) {
+    MessageLoop::current()->PostTask(FROM_HERE,
+        sort_keys_factory_.NewRunnableMethod(&TableView::ComputeSortKeys));
+  } else {
+    pending_sort_->Start();
+  }
+}
+
+void TableView::OnBackgroundSortDone() {
+  scoped_refptr<BackgroundSort> sort(pending_sort_);
+  StopPendingSort();
+  sorted_rows_.swap(*sort->sorted_rows());
+  ApplySortDescriptors(sort->sort_descriptors());
+  sorted_rows_.clear();
+  if (table_view_observer_)
+    table_view_observer_->OnSortDone(false);
+}
+
+void TableView::RestartPendingSort() {
+  if (!pending_sort_.get())
+    return;
+  if (!model_) {
+    CancelSort();
+    return;
+  }
+  SortDescriptors sort_descriptors = pending_sort_->sort_descriptors();
+  StopPendingSort();
+  StartBackgroundSort(sort_descriptors);
+}
+
+void TableView::StopPendingSort() {
+  if (!pending_sort_.get())
+    return;
+  sort_keys_factory_.RevokeAll();
+  pending_sort_->Cancel();
+  pending_sort_ = NULL;
+}
+
 void TableView::ResetColumnSortImage(int column_id, SortDirection direction) {
   if (!list_view_ || column_id == -1)
     return;
@@ -1093,6 +1455,52 @@ LRESULT TableView::OnNotify(int w_param, LPNMHDR hdr) {
       return 1;
     }
 
+    case LVN_GETDISPINFO: {
+      // An owner data ListView asks for the parts of the items it paints.
+      DCHECK(owner_data_);
+      LVITEM& item = reinterpret_cast<NMLVDISPINFO*>(hdr)->item;
+      if (item.iItem < 0 || item.iItem >= RowCount())
+        break;
+      if ((item.mask & LVIF_TEXT) && item.cchTextMax > 0 &&
+          item.iSubItem < column_count_) {
+        std::wstring text = GetOwnerDataText(item.iItem, item.iSubItem);
+        base::wcslcpy(item.pszText, text.c_str(), item.cchTextMax);
+      }
+      // The icons are painted on CDDS_ITEMPOSTPAINT, see OnItemsChanged.
+      if (item.mask & LVIF_IMAGE)
+        item.iImage = 0;
+      if (item.mask & LVIF_INDENT)
+        item.iIndent = model_->ShouldIndent(ViewToModel(item.iItem)) ? 1 : 0;
+      break;
+    }
+
+    case LVN_ODCACHEHINT: {
+      // Sent before an owner data ListView asks for the rows it is about to
+      // paint.
+      NMLVCACHEHINT* cache_hint = reinterpret_cast<NMLVCACHEHINT*>(hdr);
+      CacheOwnerDataRows(cache_hint->iFrom, cache_hint->iTo);
+      break;
+    }
+
+    case LVN_ODFINDITEM: {
+      // An owner data ListView asks for the row starting with the text the
+      // user typed.
+      NMLVFINDITEM* find_item = reinterpret_cast<NMLVFINDITEM*>(hdr);
+      if (!(find_item->lvfi.flags & (LVFI_STRING | LVFI_PARTIAL)) ||
+          column_count_ == 0) {
+        return -1;
+      }
+      std::wstring prefix(find_item->lvfi.psz);
+      int row_count = RowCount();
+      int start = std::max(find_item->iStart, 0);
+      for (int i = 0; i < row_count; ++i) {
+        int view_index = (start + i) % row_count;
+        if (StartsWith(GetOwnerDataText(view_index, 0), prefix, false))
+          return view_index;
+      }
+      return -1;
+    }
+
     default:
       break;
   }
@@ -1220,7 +1628,8 @@ LRESULT TableView::OnCustomDraw(NMLVCUSTOMDRAW* draw_info) {
       LRESULT r = CDRF_DODEFAULT;
       // First let's take care of painting the right icon.
       if (table_type_ == ICON_AND_TEXT) {
-        SkBitmap image = model_->GetIcon(model_index);
+        SkBitmap image = owner_data_ ? GetOwnerDataIcon(view_index) :
+                                       model_->GetIcon(model_index);
         if (!image.isNull()) {
           // Get the rect that holds the icon.
           RECT icon_rect, client_rect;
@@ -1406,15 +1815,25 @@ void TableView::SetAltText(const std::wstring& alt_text) {
 }
 
 void TableView::UpdateListViewCache0(int start, int length, bool add) {
-  if (is_sorted()) {
+  // Batched changes are sorted once, by EndUpdate(). Added rows move down
+  // those after them.
+  if (update_depth_) {
     if (add)
-      UpdateItemsLParams(start, length);
+      AddBatchedChange(start, model_->RowCount() - start);
     else
+      AddBatchedChange(start, length);
+  }
+  const bool defer_sort = update_depth_ && !add && is_sorted();
+
+  if (is_sorted() && !owner_data_) {
+    if (add)
+      UpdateItemsLParams(start, length);
+    else if (!defer_sort)
       UpdateItemsLParams(0, 0);
   }
 
   LVITEM item = {0};
-  if (add) {
+  if (add && !owner_data_) {
     const bool has_groups = model_->HasGroups();
     for (int i = start; i < start + length; ++i) {
       item.mask = has_groups ? (LVIF_GROUPID | LVIF_PARAM) : LVIF_PARAM;
@@ -1434,19 +1853,24 @@ void TableView::UpdateListViewCache0(int start, int length, bool add) {
   item.mask =
       (table_type_ == ICON_AND_TEXT) ? (LVIF_IMAGE | LVIF_TEXT) : LVIF_TEXT;
   item.stateMask = 0;
+  // An owner data ListView gets the text of the items when it needs it.
+  int measured_length =
+      owner_data_ ? std::min(length, kOwnerDataMeasuredRows) : length;
   for (int j = 0; j < column_count_; ++j) {
     ui::TableColumn& col = all_columns_[visible_columns_[j]];
     int max_text_width = ListView_GetStringWidth(list_view_, col.title.c_str());
-    for (int i = start; i < start + length; ++i) {
-      // Set item.
-      item.iItem = add ? i : ModelToView(i);
-      item.iSubItem = j;
+    for (int i = start; i < start + measured_length; ++i) {
       std::wstring text = model_->GetText(i, visible_columns_[j]);
-      item.pszText = const_cast<LPWSTR>(text.c_str());
-      ListView_SetItem(list_view_, &item);
+      if (!owner_data_) {
+        // Set item.
+        item.iItem = add ? i : ModelToView(i);
+        item.iSubItem = j;
+        item.pszText = const_cast<LPWSTR>(text.c_str());
+        ListView_SetItem(list_view_, &item);
+      }
 
       // Compute width in px, using current font.
-      int string_width = ListView_GetStringWidth(list_view_, item.pszText);
+      int string_width = ListView_GetStringWidth(list_view_, text.c_str());
       // The width of an icon belongs to the first column.
       if (j == 0 && table_type_ == ICON_AND_TEXT)
         string_width += kListViewIconWidthAndPadding;
@@ -1464,13 +1888,173 @@ void TableView::UpdateListViewCache0(int start, int length, bool add) {
     }
   }
 
-  if (is_sorted()) {
-    // NOTE: As most of our tables are smallish I'm not going to optimize this.
-    // If our tables become large and frequently update, then it'll make sense
-    // to optimize this.
+  if (defer_sort) {
+    batched_sort_pending_ = true;
+    if (owner_data_)
+      ClearOwnerDataCache();
+    return;
+  }
 
+  if (owner_data_) {
+    if (add || is_sorted()) {
+      // Changed rows may sort differently.
+      UpdateOwnerDataItems(start, add ? length : 0, true);
+      batched_sort_pending_ = false;
+    } else {
+      ClearOwnerDataCache();
+      if (!update_depth_)
+        ListView_RedrawItems(list_view_, start, start + length - 1);
+    }
+    return;
+  }
+
+  if (is_sorted()) {
     SortItemsAndUpdateMapping();
+    batched_sort_pending_ = false;
+  }
+}
+
+bool TableView::UpdateOwnerDataItems(int start, int length, bool add) {
+  std::vector<int> selected_rows;
+  for (int view_index = ListView_GetNextItem(list_view_, -1, LVNI_SELECTED);
+       view_index != -1;
+       view_index = ListView_GetNextItem(list_view_, view_index,
+                                         LVNI_SELECTED)) {
+    selected_rows.push_back(ViewToModel(view_index));
+  }
+  int focused_view_index = ListView_GetNextItem(list_view_, -1, LVNI_FOCUSED);
+  int focused_row =
+      focused_view_index == -1 ? -1 : ViewToModel(focused_view_index);
+  if (!selected_rows.empty())
+    ListView_SetItemState(list_view_, -1, 0, LVIS_SELECTED);
+
+  // This invalidates all the items, so they are painted again.
+  ListView_SetItemCountEx(list_view_, model_->RowCount(), LVSICF_NOSCROLL);
+  ClearOwnerDataCache();
+  SortOwnerDataMapping();
+
+  bool removed_selection = false;
+  for (size_t i = 0; i < selected_rows.size(); ++i) {
+    int row = GetMovedModelRow(selected_rows[i], start, length, add);
+    if (row != -1) {
+      ListView_SetItemState(list_view_, ModelToView(row), LVIS_SELECTED,
+                            LVIS_SELECTED);
+    } else {
+      removed_selection = true;
+    }
   }
+  if (focused_row != -1)
+    focused_row = GetMovedModelRow(focused_row, start, length, add);
+  if (focused_row != -1) {
+    ListView_SetItemState(list_view_, ModelToView(focused_row), LVIS_FOCUSED,
+                          LVIS_FOCUSED);
+  }
+  return removed_selection;
+}
+
+void TableView::SortOwnerDataMapping() {
+  if (!is_sorted()) {
+    view_to_model_.reset(NULL);
+    model_to_view_.reset(NULL);
+    return;
+  }
+
+  int row_count = RowCount();
+  view_to_model_.reset(new int[row_count]);
+  if (static_cast<int>(sorted_rows_.size()) == row_count && row_count > 0) {
+    // A background sort already ordered the rows.
+    std::copy(sorted_rows_.begin(), sorted_rows_.end(), view_to_model_.get());
+  } else {
+    PrepareForSort();
+
+    for (int i = 0; i < row_count; ++i)
+      view_to_model_[i] = i;
+    std::stable_sort(view_to_model_.get(), view_to_model_.get() + row_count,
+                     RowComparator(this));
+
+    model_->ClearCollator();
+  }
+
+  model_to_view_.reset(new int[row_count]);
+  for (int i = 0; i < row_count; ++i)
+    model_to_view_[view_to_model_[i]] = i;
+}
+
+std::wstring TableView::GetOwnerDataText(int view_index, int column) {
+  int cache_index = view_index - owner_data_cache_start_;
+  if (cache_index >= 0 && cache_index < owner_data_cache_count_)
+    return owner_data_cache_text_[cache_index * column_count_ + column];
+  return model_->GetText(ViewToModel(view_index), visible_columns_[column]);
+}
+
+SkBitmap TableView::GetOwnerDataIcon(int view_index) {
+  DCHECK_EQ(ICON_AND_TEXT, table_type_);
+  int cache_index = view_index - owner_data_cache_start_;
+  if (cache_index >= 0 && cache_index < owner_data_cache_count_)
+    return owner_data_cache_icons_[cache_index];
+  return model_->GetIcon(ViewToModel(view_index));
+}
+
+void TableView::CacheOwnerDataRows(int first_view_index, int last_view_index) {
+  first_view_index = std::max(first_view_index, 0);
+  last_view_index = std::min(
+      last_view_index,
+      std::min(first_view_index + kMaxOwnerDataCachedRows, RowCount()) - 1);
+  if (first_view_index >= owner_data_cache_start_ &&
+      last_view_index < owner_data_cache_start_ + owner_data_cache_count_) {
+    return;
+  }
+
+  ClearOwnerDataCache();
+  if (last_view_index < first_view_index)
+    return;
+  owner_data_cache_start_ = first_view_index;
+  owner_data_cache_count_ = last_view_index - first_view_index + 1;
+  owner_data_cache_text_.reserve(owner_data_cache_count_ * column_count_);
+  for (int i = first_view_index; i <= last_view_index; ++i) {
+    int model_index = ViewToModel(i);
+    for (int j = 0; j < column_count_; ++j) {
+      owner_data_cache_text_.push_back(
+          model_->GetText(model_index, visible_columns_[j]));
+    }
+    if (table_type_ == ICON_AND_TEXT)
+      owner_data_cache_icons_.push_back(model_->GetIcon(model_index));
+  }
+}
+
+void TableView::ClearOwnerDataCache() {
+  owner_data_cache_start_ = 0;
+  owner_data_cache_count_ = 0;
+  owner_data_cache_text_.clear();
+  owner_data_cache_icons_.clear();
+}
+
+void TableView::SetListViewRedraw(bool redraw) {
+  if (!update_depth_) {
+    SendMessage(list_view_, WM_SETREDRAW,
+                static_cast<WPARAM>(redraw ? TRUE : FALSE), 0);
+  }
+}
+
+void TableView::AddBatchedChange(int start, int length) {
+  if (length <= 0)
+    return;
+  if (batched_changes_end_ <= batched_changes_start_) {
+    batched_changes_start_ = start;
+    batched_changes_end_ = start + length;
+    return;
+  }
+  batched_changes_start_ = std::min(batched_changes_start_, start);
+  batched_changes_end_ = std::max(batched_changes_end_, start + length);
+}
+
+void TableView::RedrawVisibleItems(int first, int last) {
+  int top = ListView_GetTopIndex(list_view_);
+  first = std::max(first, top);
+  last = std::min(last, std::min(top + ListView_GetCountPerPage(list_view_),
+                                 RowCount() - 1));
+  if (first <= last)
+    ListView_RedrawItems(list_view_, first, last);
 }
 
 void TableView::OnDoubleClick() {
@@ -1551,6 +2135,8 @@ void TableView::UpdateContentOffset() {
 void TableView::UpdateGroups() {
   // Add the groups.
   if (model_ && model_->HasGroups()) {
+    // Owner data ListViews don't support groups.
+    DCHECK(!owner_data_);
     ListView_RemoveAllGroups(list_view_);
 
     // Windows XP seems to disable groups if we remove them, so we
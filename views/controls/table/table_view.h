@@ -7,10 +7,14 @@
 #pragma once
 
 #include <map>
+#include <string>
 #include <vector>
 
 #include "base/gtest_prod_util.h"
+#include "base/memory/ref_counted.h"
+#include "base/task.h"
 #include "build/build_config.h"
+#include "third_party/skia/include/core/SkBitmap.h"
 #include "third_party/skia/include/core/SkColor.h"
 #include "ui/base/keycodes/keyboard_codes.h"
 #include "ui/base/models/table_model_observer.h"
@@ -25,8 +29,6 @@
 typedef struct tagNMLVCUSTOMDRAW NMLVCUSTOMDRAW;
 #endif  // defined(OS_WIN)
 
-class SkBitmap;
-
 namespace gfx {
 class Font;
 }
@@ -58,6 +60,11 @@ class TableModel;
 // sort by way of overriding CompareValues.
 //
 // TableView is a wrapper around the window type ListView in report mode.
+//
+// By default every row is inserted into the ListView, which takes time and
+// memory proportional to the number of rows. Tables with many rows should
+// SetOwnerData(true) before being added to a Widget, so that the ListView
+// only asks for the rows it shows.
 namespace views {
 
 class ListView;
@@ -158,6 +165,28 @@ class VIEWS_EXPORT TableView : public NativeControl,
   // Current sort.
   const SortDescriptors& sort_descriptors() const { return sort_descriptors_; }
 
+  // Makes the sorts of tables with many rows run in the background: the rows
+  // keep their order, and sort_descriptors() the previous sort, until the new
+  // order is computed, and the observer is told of the progress. The model
+  // must give sort keys (see ui::TableModel::GetSortKey), and CompareRows
+  // must not be overridden.
+  void SetBackgroundSort(bool background_sort);
+
+  // Returns true while a background sort is in progress.
+  bool is_sorting() const { return pending_sort_.get() != NULL; }
+
+  // Cancels the background sort in progress, if any. The rows keep their
+  // current order.
+  void CancelSort();
+
+  // Makes the ListView an owner data (virtual) one, which doesn't store the
+  // rows but gets them from the model as they are painted, so that adding
+  // rows takes constant time rather than time proportional to their number.
+  // Sorting still orders all the rows. Must be called before the native
+  // control is created, and models with groups are not supported.
+  void SetOwnerData(bool owner_data);
+  bool owner_data() const { return owner_data_; }
+
   // Returns the number of rows in the TableView.
   int RowCount() const;
 
@@ -192,6 +221,29 @@ class VIEWS_EXPORT TableView : public NativeControl,
   iterator SelectionBegin();
   iterator SelectionEnd();
 
+  // Batches the changes the model notifies until the matching EndUpdate():
+  // the ListView isn't redrawn, the rows changed are merged into one range,
+  // and a sorted table is sorted once, by EndUpdate(), which then redraws the
+  // changed rows that are in view. Models that change many rows at a time,
+  // such as those of live status tables, should notify between the two.
+  // Calls may nest.
+  void BeginUpdate();
+  void EndUpdate();
+
+  // Batches the changes notified while it is in scope.
+  class ScopedUpdate {
+   public:
+    explicit ScopedUpdate(TableView* table) : table_(table) {
+      table_->BeginUpdate();
+    }
+    ~ScopedUpdate() { table_->EndUpdate(); }
+
+   private:
+    TableView* table_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedUpdate);
+  };
+
   // ui::TableModelObserver methods.
   virtual void OnModelChanged();
   virtual void OnItemsChanged(int start, int length);
@@ -331,6 +383,14 @@ class VIEWS_EXPORT TableView : public NativeControl,
   FRIEND_TEST_ALL_PREFIXES(GroupModelTableViewTest, ShiftSelectAcrossGroups);
   FRIEND_TEST_ALL_PREFIXES(GroupModelTableViewTest, ShiftSelectSameGroup);
 
+  // Orders model rows with CompareRows, to sort an owner data ListView.
+  class RowComparator;
+  friend class RowComparator;
+
+  // Sorts the rows by their sort keys, on a worker thread.
+  class BackgroundSort;
+  friend class BackgroundSort;
+
   LRESULT OnCustomDraw(NMLVCUSTOMDRAW* draw_info);
 
   // Invoked when the user clicks on a column to toggle the sort order. If
@@ -347,6 +407,26 @@ class VIEWS_EXPORT TableView : public NativeControl,
   // model_to_view) appropriately.
   void SortItemsAndUpdateMapping();
 
+  // Does the work of SetSortDescriptors, sorting the rows right away.
+  void ApplySortDescriptors(const SortDescriptors& sort_descriptors);
+
+  // Starts a background sort of the rows, replacing the one in progress.
+  void StartBackgroundSort(const SortDescriptors& sort_descriptors);
+
+  // Computes the sort keys of the next batch of rows of the background sort,
+  // and posts a task to do the next batch, or hands the keys to a worker
+  // thread once they are all computed.
+  void ComputeSortKeys();
+
+  // Invoked by the background sort in progress once the rows are sorted.
+  void OnBackgroundSortDone();
+
+  // Starts the background sort in progress again, as the model changed.
+  void RestartPendingSort();
+
+  // Stops the background sort in progress, without telling the observer.
+  void StopPendingSort();
+
   // Selects multiple items from the current view row to the marked view row
   // (implements shift-click behavior). |view_index| is the most recent row
   // that the user clicked on, and so there is no guarantee that
@@ -365,6 +445,12 @@ class VIEWS_EXPORT TableView : public NativeControl,
                                       LPARAM model_index_2_p,
                                       LPARAM table_view_param);
 
+  // Method invoked by ListView to order the rows as a background sort did.
+  // table_view_param points to the rank of each model index.
+  static int CALLBACK RankSortFunc(LPARAM model_index_1_p,
+                                   LPARAM model_index_2_p,
+                                   LPARAM table_view_param);
+
   // Resets the sort image displayed for the specified column.
   void ResetColumnSortImage(int column_id, SortDirection direction);
 
@@ -386,6 +472,40 @@ class VIEWS_EXPORT TableView : public NativeControl,
   // range start - [start + length] are updated from the model.
   void UpdateListViewCache0(int start, int length, bool add);
 
+  // Sets the number of items of the owner data ListView after length rows
+  // were added to the model at start, or removed if add is false, and sorts
+  // them again. An owner data ListView keeps the selection by view index, so
+  // the selected and focused rows are moved to their new view indices.
+  // Returns true if selected rows were removed.
+  bool UpdateOwnerDataItems(int start, int length, bool add);
+
+  // Sorts view_to_model_ and model_to_view_ for an owner data ListView, which
+  // can't sort its items itself.
+  void SortOwnerDataMapping();
+
+  // Returns the text of the cell at view_index and column position column, or
+  // the icon of the row, of an owner data ListView, from the rows cached on
+  // LVN_ODCACHEHINT if possible.
+  std::wstring GetOwnerDataText(int view_index, int column);
+  SkBitmap GetOwnerDataIcon(int view_index);
+
+  // Fills the owner data cache with the rows from first_view_index to
+  // last_view_index, inclusive.
+  void CacheOwnerDataRows(int first_view_index, int last_view_index);
+
+  // Clears the owner data cache, after the rows or columns changed.
+  void ClearOwnerDataCache();
+
+  // Turns the redrawing of the ListView off or back on around a change,
+  // unless an update is batched, during which it stays off.
+  void SetListViewRedraw(bool redraw);
+
+  // Adds the model rows from |start| to the batched update's changed range.
+  void AddBatchedChange(int start, int length);
+
+  // Redraws the rows between view indices |first| and |last| that are in view.
+  void RedrawVisibleItems(int first, int last);
+
   // Returns the index of the selected item before |view_index|, or -1 if
   // |view_index| is the first selected item.
   //
@@ -443,6 +563,17 @@ class VIEWS_EXPORT TableView : public NativeControl,
   // Cached value of columns_.size()
   int column_count_;
 
+  // Reflects the value passed to SetOwnerData.
+  bool owner_data_;
+
+  // The rows the owner data ListView asked for last on LVN_ODCACHEHINT,
+  // starting at view index owner_data_cache_start_: the texts of all their
+  // columns, row after row, and their icons if the table has icons.
+  int owner_data_cache_start_;
+  int owner_data_cache_count_;
+  std::vector<std::wstring> owner_data_cache_text_;
+  std::vector<SkBitmap> owner_data_cache_icons_;
+
   // Selection mode.
   bool single_selection_;
 
@@ -489,6 +620,26 @@ class VIEWS_EXPORT TableView : public NativeControl,
   // Current sort.
   SortDescriptors sort_descriptors_;
 
+  // Reflects the value passed to SetBackgroundSort.
+  bool background_sort_;
+
+  // The background sort in progress, if any, and the factory of the tasks
+  // computing its sort keys.
+  scoped_refptr<BackgroundSort> pending_sort_;
+  ScopedRunnableMethodFactory<TableView> sort_keys_factory_;
+
+  // When not empty, the model rows in the order computed by a background
+  // sort, which the next sort uses rather than comparing the rows.
+  std::vector<int> sorted_rows_;
+
+  // The nesting of BeginUpdate(), the model rows changed since the first
+  // one, from |batched_changes_start_| until before |batched_changes_end_|,
+  // and whether they are to be sorted by the last EndUpdate().
+  int update_depth_;
+  int batched_changes_start_;
+  int batched_changes_end_;
+  bool batched_sort_pending_;
+
   // Mappings used when sorted.
   scoped_array<int> view_to_model_;
   scoped_array<int> model_to_view_;
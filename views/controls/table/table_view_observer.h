@@ -33,6 +33,15 @@ class TableViewObserver {
   // Invoked when the user presses the delete key.
   virtual void OnTableViewDelete(TableView* table_view) {}
 
+  // Optional method invoked as a background sort progresses (see
+  // TableView::SetBackgroundSort), once the sort keys of |rows_done| of the
+  // |row_count| rows were computed.
+  virtual void OnSortProgress(int rows_done, int row_count) {}
+
+  // Optional method invoked when a background sort is done: applied, or
+  // cancelled by TableView::CancelSort.
+  virtual void OnSortDone(bool cancelled) {}
+
   // Invoked when the user presses the delete key.
   virtual void OnTableView2Delete(TableView2* table_view) {}
 };
@@ -196,10 +196,19 @@ void NativeTextfieldWin::UpdateText() {
 }
 
 void NativeTextfieldWin::AppendText(const string16& text) {
+  // The control neither redraws nor notifies while the text is inserted, and
+  // is redrawn once after, which matters when appending large batches.
+  SetRedraw(FALSE);
+  DWORD event_mask = GetEventMask();
+  SetEventMask(0);
   int text_length = GetWindowTextLength();
-  ::SendMessage(m_hWnd, TBM_SETSEL, true, MAKELPARAM(text_length, text_length));
+  SetSel(text_length, text_length);
   ::SendMessage(m_hWnd, EM_REPLACESEL, false,
                 reinterpret_cast<LPARAM>(text.c_str()));
+  SetEventMask(event_mask);
+  SetRedraw(TRUE);
+  Invalidate();
+  UpdateAccessibleValue(textfield_->text());
 }
 
 string16 NativeTextfieldWin::GetSelectedText() const {
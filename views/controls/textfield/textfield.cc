@@ -8,8 +8,10 @@
 #include <gdk/gdkkeysyms.h>
 #endif
 
+#include <algorithm>
 #include <string>
 
+#include "base/message_loop.h"
 #include "base/string_util.h"
 #include "base/utf_string_conversions.h"
 #include "ui/base/accessibility/accessible_view_state.h"
@@ -20,6 +22,7 @@
 #include "views/controls/native/native_view_host.h"
 #include "views/controls/textfield/native_textfield_wrapper.h"
 #include "views/controls/textfield/textfield_controller.h"
+#include "views/focus/focus_search.h"
 #include "views/widget/widget.h"
 
 #if defined(OS_LINUX)
@@ -55,7 +58,11 @@ Textfield::Textfield()
       initialized_(false),
       horizontal_margins_were_set_(false),
       vertical_margins_were_set_(false),
-      text_input_type_(ui::TEXT_INPUT_TYPE_TEXT) {
+      text_input_type_(ui::TEXT_INPUT_TYPE_TEXT),
+      batch_appends_(false),
+      max_lines_(0),
+      lines_dropped_(false),
+      ALLOW_THIS_IN_INITIALIZER_LIST(append_factory_(this)) {
   set_focusable(true);
 }
 
@@ -73,7 +80,11 @@ Textfield::Textfield(StyleFlags style)
       initialized_(false),
       horizontal_margins_were_set_(false),
       vertical_margins_were_set_(false),
-      text_input_type_(ui::TEXT_INPUT_TYPE_TEXT) {
+      text_input_type_(ui::TEXT_INPUT_TYPE_TEXT),
+      batch_appends_(false),
+      max_lines_(0),
+      lines_dropped_(false),
+      ALLOW_THIS_IN_INITIALIZER_LIST(append_factory_(this)) {
   set_focusable(true);
   if (IsPassword())
     SetTextInputType(ui::TEXT_INPUT_TYPE_PASSWORD);
@@ -92,6 +103,8 @@ TextfieldController* Textfield::GetController() const {
 
 void Textfield::SetReadOnly(bool read_only) {
   read_only_ = read_only;
+  // Read-only textfields aren't focusable.
+  FocusSearch::InvalidateFocusOrders();
   if (native_wrapper_) {
     native_wrapper_->UpdateReadOnly();
     native_wrapper_->UpdateTextColor();
@@ -131,16 +144,41 @@ void Textfield::SetTextInputType(ui::TextInputType type) {
 
 void Textfield::SetText(const string16& text) {
   text_ = text;
+  pending_append_.clear();
+  lines_dropped_ = false;
+  append_factory_.RevokeAll();
+  TrimToMaxLines();
   if (native_wrapper_)
     native_wrapper_->UpdateText();
 }
 
 void Textfield::AppendText(const string16& text) {
   text_ += text;
-  if (native_wrapper_)
+  if (!native_wrapper_)
+    return;
+  if (batch_appends_) {
+    if (append_factory_.empty()) {
+      MessageLoop::current()->PostTask(FROM_HERE,
+          append_factory_.NewRunnableMethod(&Textfield::FlushAppendedText));
+    }
+    pending_append_ += text;
+    return;
+  }
+  if (TrimToMaxLines())
+    native_wrapper_->UpdateText();
+  else
     native_wrapper_->AppendText(text);
 }
 
+void Textfield::SetAppendBatching(bool batched, size_t max_lines) {
+  if (!batched)
+    FlushAppendedText();
+  batch_appends_ = batched;
+  max_lines_ = max_lines;
+  if (TrimToMaxLines() && native_wrapper_)
+    native_wrapper_->UpdateText();
+}
+
 void Textfield::SelectAll() {
   if (native_wrapper_)
     native_wrapper_->SelectAll();
@@ -264,6 +302,31 @@ void Textfield::SyncText() {
   }
 }
 
+void Textfield::FlushAppendedText() {
+  append_factory_.RevokeAll();
+  if (!native_wrapper_ || pending_append_.empty())
+    return;
+  // The lines are dropped once per batch, and the whole text set then.
+  if (TrimToMaxLines())
+    native_wrapper_->UpdateText();
+  else
+    native_wrapper_->AppendText(pending_append_);
+  pending_append_.clear();
+}
+
+bool Textfield::TrimToMaxLines() {
+  if (!max_lines_)
+    return false;
+  size_t lines = std::count(text_.begin(), text_.end(), '\n') + 1;
+  if (lines <= max_lines_)
+    return false;
+  size_t start = 0;
+  for (size_t i = max_lines_; i < lines; ++i)
+    start = text_.find('\n', start) + 1;
+  text_.erase(0, start);
+  return true;
+}
+
 bool Textfield::IsIMEComposing() const {
   return native_wrapper_ && native_wrapper_->IsIMEComposing();
 }
@@ -13,6 +13,7 @@
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
 #include "base/string16.h"
+#include "base/task.h"
 #include "third_party/skia/include/core/SkColor.h"
 #include "ui/base/ime/text_input_type.h"
 #include "ui/base/keycodes/keyboard_codes.h"
@@ -85,6 +86,12 @@ class VIEWS_EXPORT Textfield : public View {
   // Appends the given string to the previously-existing text in the field.
   void AppendText(const string16& text);
 
+  // Makes AppendText() batch the text appended within a message loop turn into
+  // one update of the native control, at the end of the turn, for fields that
+  // log a lot of text. Unless |max_lines| is 0, only the last |max_lines| lines
+  // are kept, the oldest being dropped as more are appended.
+  void SetAppendBatching(bool batched, size_t max_lines);
+
   // Returns the text that is currently selected.
   string16 GetSelectedText() const;
 
@@ -238,6 +245,13 @@ class VIEWS_EXPORT Textfield : public View {
   NativeTextfieldWrapper* native_wrapper_;
 
  private:
+  // Sends the text appended since the last call to the native control.
+  void FlushAppendedText();
+
+  // Drops the oldest lines of |text_| beyond |max_lines_|. Returns whether
+  // there were any.
+  bool TrimToMaxLines();
+
   // This is the current listener for events from this Textfield.
   TextfieldController* controller_;
 
@@ -298,6 +312,15 @@ class VIEWS_EXPORT Textfield : public View {
   // The input type of this text field.
   ui::TextInputType text_input_type_;
 
+  // Set by SetAppendBatching(). The text appended since the native control
+  // was last updated, and whether lines were dropped since, in which case the
+  // whole text is set again.
+  bool batch_appends_;
+  size_t max_lines_;
+  string16 pending_append_;
+  bool lines_dropped_;
+  ScopedRunnableMethodFactory<Textfield> append_factory_;
+
   DISALLOW_COPY_AND_ASSIGN(Textfield);
 };
 
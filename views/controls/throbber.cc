@@ -7,11 +7,14 @@
 #include "base/time.h"
 #include "grit/ui_resources.h"
 #include "third_party/skia/include/core/SkBitmap.h"
+#include "ui/base/animation/animation_container.h"
 #include "ui/base/resource/resource_bundle.h"
 #include "ui/gfx/canvas.h"
+#include "ui/gfx/compositor/layer.h"
+#include "views/widget/widget.h"
 
-using base::Time;
 using base::TimeDelta;
+using base::TimeTicks;
 
 namespace views {
 
@@ -20,7 +23,8 @@ Throbber::Throbber(int frame_time_ms,
     : running_(false),
       paint_while_stopped_(paint_while_stopped),
       frames_(NULL),
-      frame_time_(TimeDelta::FromMilliseconds(frame_time_ms)) {
+      frame_time_(TimeDelta::FromMilliseconds(frame_time_ms)),
+      layer_steps_frames_(false) {
   SetFrames(ResourceBundle::GetSharedInstance().GetBitmapNamed(IDR_THROBBER));
 }
 
@@ -32,10 +36,9 @@ void Throbber::Start() {
   if (running_)
     return;
 
-  start_time_ = Time::Now();
+  start_time_ = TimeTicks::Now();
 
-  timer_.Start(FROM_HERE, frame_time_ - TimeDelta::FromMilliseconds(10),
-               this, &Throbber::Run);
+  StartStepping();
 
   running_ = true;
 
@@ -46,7 +49,7 @@ void Throbber::Stop() {
   if (!running_)
     return;
 
-  timer_.Stop();
+  StopStepping();
 
   running_ = false;
   SchedulePaint();  // Important if we're not painting while stopped
@@ -58,14 +61,64 @@ void Throbber::SetFrames(SkBitmap* frames) {
   DCHECK(frames_->width() % frames_->height() == 0);
   frame_count_ = frames_->width() / frames_->height();
   PreferredSizeChanged();
+  if (layer_steps_frames_) {
+    layer()->SetFrames(*frames_, frame_count_, start_time_, frame_time_);
+    SchedulePaint();
+  }
+}
+
+void Throbber::SetStartTime(base::TimeTicks start_time) {
 }
 
-void Throbber::Run() {
+void Throbber::Step(base::TimeTicks time_now) {
   DCHECK(running_);
 
   SchedulePaint();
 }
 
+base::TimeDelta Throbber::GetTimerInterval() const {
+  return frame_time_ - TimeDelta::FromMilliseconds(10);
+}
+
+void Throbber::ViewHierarchyChanged(bool is_add, View* parent, View* child) {
+  // Moves to the container of the new widget.
+  if (running_ && child->Contains(this)) {
+    StopStepping();
+    if (is_add)
+      StartStepping();
+  }
+}
+
+void Throbber::StartStepping() {
+  // The compositor draws the frames out of the strip itself, so nothing is
+  // painted for them.
+  if (GetCompositor()) {
+    SetPaintToLayer(true);
+    if (layer()) {
+      layer()->SetFrames(*frames_, frame_count_, start_time_, frame_time_);
+      layer_steps_frames_ = true;
+      return;
+    }
+    SetPaintToLayer(false);
+  }
+  container_ = GetWidget() ? GetWidget()->GetAnimationContainer() :
+                             new ui::AnimationContainer;
+  container_->Start(this);
+}
+
+void Throbber::StopStepping() {
+  if (layer_steps_frames_) {
+    layer_steps_frames_ = false;
+    if (layer())
+      layer()->ClearFrames();
+    SetPaintToLayer(false);
+  }
+  if (!container_.get())
+    return;
+  container_->Stop(this);
+  container_ = NULL;
+}
+
 gfx::Size Throbber::GetPreferredSize() {
   return gfx::Size(frames_->height(), frames_->height());
 }
@@ -74,7 +127,7 @@ void Throbber::OnPaint(gfx::Canvas* canvas) {
   if (!running_ && !paint_while_stopped_)
     return;
 
-  const TimeDelta elapsed_time = Time::Now() - start_time_;
+  const TimeDelta elapsed_time = TimeTicks::Now() - start_time_;
   const int current_frame =
       static_cast<int>(elapsed_time / frame_time_) % frame_count_;
 
@@ -9,15 +9,27 @@
 #pragma once
 
 #include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/memory/ref_counted.h"
 #include "base/time.h"
 #include "base/timer.h"
+#include "ui/base/animation/animation_container_element.h"
 #include "views/view.h"
 
 class SkBitmap;
 
+namespace ui {
+class AnimationContainer;
+}
+
 namespace views {
 
-class VIEWS_EXPORT Throbber : public View {
+// The frames of a Throbber are stepped by the compositor, from a layer that
+// draws them out of one strip, when the widget has a compositor, and else by
+// the animation container of its widget, so that it doesn't wake the UI
+// thread while the widget can't be seen.
+class VIEWS_EXPORT Throbber : public View,
+                              public ui::AnimationContainerElement {
  public:
   // |frame_time_ms| is the amount of time that should elapse between frames
   //                 (in milliseconds)
@@ -38,19 +50,35 @@ class VIEWS_EXPORT Throbber : public View {
   virtual gfx::Size GetPreferredSize();
   virtual void OnPaint(gfx::Canvas* canvas);
 
+  // Overridden from ui::AnimationContainerElement:
+  virtual void SetStartTime(base::TimeTicks start_time) OVERRIDE;
+  virtual void Step(base::TimeTicks time_now) OVERRIDE;
+  virtual base::TimeDelta GetTimerInterval() const OVERRIDE;
+
  protected:
+  // Overridden from View:
+  virtual void ViewHierarchyChanged(bool is_add,
+                                    View* parent,
+                                    View* child) OVERRIDE;
+
   // Specifies whether the throbber is currently animating or not
   bool running_;
 
  private:
-  void Run();
+  // Starts the stepping of the frames in the layer of the throbber, or in
+  // the container of the widget, or in one of the throbber's own outside of
+  // a widget.
+  void StartStepping();
+  void StopStepping();
 
   bool paint_while_stopped_;
   int frame_count_;  // How many frames we have.
-  base::Time start_time_;  // Time when Start was called.
+  base::TimeTicks start_time_;  // Time when Start was called.
   SkBitmap* frames_;  // Frames bitmaps.
   base::TimeDelta frame_time_;  // How long one frame is displayed.
-  base::RepeatingTimer<Throbber> timer_;  // Used to schedule Run calls.
+  // Steps the frames while running, unless |layer_steps_frames_|.
+  scoped_refptr<ui::AnimationContainer> container_;
+  bool layer_steps_frames_;
 
   DISALLOW_COPY_AND_ASSIGN(Throbber);
 };
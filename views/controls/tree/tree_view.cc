@@ -294,6 +294,30 @@ void TreeView::TreeNodeChanged(TreeModel* model, TreeModelNode* node) {
   TreeView_SetItem(tree_view_, &tv_item);
 }
 
+void TreeView::TreeNodeChildrenLoaded(TreeModel* model, TreeModelNode* parent) {
+  if (node_to_details_map_.find(parent) == node_to_details_map_.end()) {
+    // There is no item for |parent|: it is the hidden root, whose children
+    // were added to the tree, or the user hasn't navigated to it.
+    return;
+  }
+  NodeDetails* details = GetNodeDetails(parent);
+  int child_count = model_->GetChildCount(parent);
+  // The number of children the tree has cached may have been a guess.
+  TV_ITEM tv_item = {0};
+  tv_item.mask = TVIF_CHILDREN;
+  tv_item.cChildren = child_count;
+  tv_item.hItem = details->tree_item;
+  TreeView_SetItem(tree_view_, &tv_item);
+
+  if (details->expand_when_loaded) {
+    details->expand_when_loaded = false;
+    if (child_count) {
+      TreeView_Expand(tree_view_, details->tree_item, TVE_EXPAND);
+      AutoExpandChildren(parent);
+    }
+  }
+}
+
 gfx::Point TreeView::GetKeyboardContextMenuLocation() {
   int y = height() / 2;
   if (GetSelectedNode()) {
@@ -363,8 +387,9 @@ LRESULT TreeView::OnNotify(int w_param, LPNMHDR l_param) {
       if (!id_to_details_map_.empty()) {
         const NodeDetails* details =
             GetNodeDetailsByID(static_cast<int>(info->item.lParam));
+        // The children of the node may not be loaded yet.
         if (info->item.mask & TVIF_CHILDREN)
-          info->item.cChildren = model_->GetChildCount(details->node);
+          info->item.cChildren = model_->HasChildren(details->node) ? 1 : 0;
         if (info->item.mask & TVIF_TEXT) {
           std::wstring text = details->node->GetTitle();
           DCHECK(info->item.cchTextMax);
@@ -396,15 +421,8 @@ LRESULT TreeView::OnNotify(int w_param, LPNMHDR l_param) {
       NMTREEVIEW* info = reinterpret_cast<NMTREEVIEW*>(l_param);
       NodeDetails* details =
           GetNodeDetailsByID(static_cast<int>(info->itemNew.lParam));
-      if (!details->loaded_children) {
-        details->loaded_children = true;
-        for (int i = 0; i < model_->GetChildCount(details->node); ++i) {
-          CreateItem(details->tree_item, TVI_LAST,
-                       model_->GetChild(details->node, i));
-          if (auto_expand_children_)
-            Expand(model_->GetChild(details->node, i));
-        }
-      }
+      if (!details->loaded_children)
+        CreateChildItems(details);
       // Return FALSE to allow the item to be expanded.
       return FALSE;
     }
@@ -573,6 +591,9 @@ void TreeView::CreateRootItems() {
   TreeModelNode* root = model_->GetRoot();
   if (root_shown_) {
     CreateItem(NULL, TVI_LAST, root);
+  } else if (!model_->AreChildrenLoaded(root)) {
+    // TreeNodesAdded creates the items as the children are loaded.
+    model_->LoadChildren(root);
   } else {
     for (int i = 0; i < model_->GetChildCount(root); ++i)
       CreateItem(NULL, TVI_LAST, model_->GetChild(root, i));
@@ -619,6 +640,33 @@ void TreeView::CreateItem(HTREEITEM parent_item,
   node_details->tree_item = TreeView_InsertItem(tree_view_, &insert_struct);
 }
 
+void TreeView::CreateChildItems(NodeDetails* details) {
+  DCHECK(!details->loaded_children);
+  details->loaded_children = true;
+  TreeModelNode* node = details->node;
+  if (model_->AreChildrenLoaded(node)) {
+    for (int i = 0; i < model_->GetChildCount(node); ++i)
+      CreateItem(details->tree_item, TVI_LAST, model_->GetChild(node, i));
+    AutoExpandChildren(node);
+    return;
+  }
+
+  // Now that loaded_children is true, TreeNodesAdded creates the items as
+  // the children are loaded, which may happen before LoadChildren returns.
+  model_->LoadChildren(node);
+  if (model_->AreChildrenLoaded(node))
+    AutoExpandChildren(node);
+  else
+    details->expand_when_loaded = true;
+}
+
+void TreeView::AutoExpandChildren(TreeModelNode* node) {
+  if (!auto_expand_children_)
+    return;
+  for (int i = 0; i < model_->GetChildCount(node); ++i)
+    Expand(model_->GetChild(node, i));
+}
+
 void TreeView::RecursivelyDelete(NodeDetails* node) {
   DCHECK(node);
   HTREEITEM item = node->tree_item;
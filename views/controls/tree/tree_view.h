@@ -45,6 +45,10 @@ class TreeViewController {
 // TreeView displays hierarchical data as returned from a TreeModel. The user
 // can expand, collapse and edit the items. A Controller may be attached to
 // receive notification of selection changes and restrict editing.
+//
+// Items are only created for the nodes the user navigates to, and the model
+// is asked to load the children of a node as it is first expanded (see
+// TreeModel::LoadChildren), so that trees of any size show in constant time.
 class VIEWS_EXPORT TreeView : public NativeControl, ui::TreeModelObserver {
  public:
   TreeView();
@@ -130,6 +134,8 @@ class VIEWS_EXPORT TreeView : public NativeControl, ui::TreeModelObserver {
                                 int count) OVERRIDE;
   virtual void TreeNodeChanged(ui::TreeModel* model,
                                ui::TreeModelNode* node) OVERRIDE;
+  virtual void TreeNodeChildrenLoaded(ui::TreeModel* model,
+                                      ui::TreeModelNode* parent) OVERRIDE;
   // End TreeModelObserver implementation.
 
   // Sets the controller, which may be null. TreeView does not take ownership
@@ -203,7 +209,11 @@ class VIEWS_EXPORT TreeView : public NativeControl, ui::TreeModelObserver {
   // as the user expands nodes.
   struct NodeDetails {
     NodeDetails(int id, ui::TreeModelNode* node)
-        : id(id), node(node), tree_item(NULL), loaded_children(false) {}
+        : id(id),
+          node(node),
+          tree_item(NULL),
+          loaded_children(false),
+          expand_when_loaded(false) {}
 
     // Unique identifier for the node. This corresponds to the lParam of
     // the tree item.
@@ -220,6 +230,10 @@ class VIEWS_EXPORT TreeView : public NativeControl, ui::TreeModelObserver {
 
     // Whether the children have been loaded.
     bool loaded_children;
+
+    // Whether the node is to be expanded once the model has loaded its
+    // children, as the user expanded it before.
+    bool expand_when_loaded;
   };
 
   // Cleanup all resources used by treeview.
@@ -246,6 +260,14 @@ class VIEWS_EXPORT TreeView : public NativeControl, ui::TreeModelObserver {
   void CreateItem(HTREEITEM parent_item, HTREEITEM after,
                   ui::TreeModelNode* node);
 
+  // Creates the items of the children of the node of |details|, which is
+  // expanding for the first time, or asks the model to load them if it hasn't
+  // yet, in which case they are created as they are added.
+  void CreateChildItems(NodeDetails* details);
+
+  // Expands the children of |node| if auto_expand_children_ is true.
+  void AutoExpandChildren(ui::TreeModelNode* node);
+
   // Removes entries from the map for item. This method will also
   // remove the items from the TreeView because the process of
   // deleting an item will send an TVN_GETDISPINFO message, consulting
@@ -0,0 +1,222 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "views/controls/virtual_list_view.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+
+namespace views {
+
+// VirtualListViewModel --------------------------------------------------------
+
+int VirtualListViewModel::GetRowHeight(int row) {
+  NOTREACHED() << "The model must give the row heights, or the list a fixed "
+                  "row height";
+  return 0;
+}
+
+// VirtualListView -------------------------------------------------------------
+
+// static
+const char VirtualListView::kViewClassName[] = "views/VirtualListView";
+
+VirtualListView::VirtualListView(VirtualListViewModel* model)
+    : model_(model),
+      fixed_row_height_(0),
+      row_count_(0),
+      first_visible_row_(0),
+      ALLOW_THIS_IN_INITIALIZER_LIST(scroll_helper_(this)) {
+  DCHECK(model_);
+  UpdateRows();
+}
+
+VirtualListView::~VirtualListView() {
+}
+
+void VirtualListView::SetFixedRowHeight(int height) {
+  DCHECK_GE(height, 0);
+  if (height == fixed_row_height_)
+    return;
+  fixed_row_height_ = height;
+  OnModelChanged();
+}
+
+void VirtualListView::OnModelChanged() {
+  UpdateRows();
+
+  // All the visible rows may have changed.
+  free_row_views_.insert(free_row_views_.end(), visible_row_views_.begin(),
+                         visible_row_views_.end());
+  visible_row_views_.clear();
+  if (!UpdateSize())
+    UpdateVisibleRows();
+
+  // Lets the ScrollView update its scrollbars.
+  InvalidateLayout();
+}
+
+void VirtualListView::OnRowsChanged(int start, int length) {
+  for (size_t i = 0; i < visible_row_views_.size(); ++i) {
+    int row = first_visible_row_ + static_cast<int>(i);
+    if (row >= start && row < start + length)
+      model_->BindRowView(row, visible_row_views_[i]);
+  }
+}
+
+int VirtualListView::GetRowAt(int y) const {
+  if (row_count_ == 0)
+    return -1;
+  if (y <= 0)
+    return 0;
+  int row;
+  if (fixed_row_height_ > 0) {
+    row = y / fixed_row_height_;
+  } else {
+    row = static_cast<int>(std::upper_bound(row_offsets_.begin(),
+                                            row_offsets_.end(), y) -
+                           row_offsets_.begin()) - 1;
+  }
+  return std::min(row, row_count_ - 1);
+}
+
+gfx::Rect VirtualListView::GetRowBounds(int row) const {
+  DCHECK(row >= 0 && row < row_count_);
+  int y = GetRowY(row);
+  return gfx::Rect(0, y, width(), GetRowY(row + 1) - y);
+}
+
+void VirtualListView::ScrollRowToVisible(int row) {
+  ScrollRectToVisible(GetRowBounds(row));
+}
+
+View* VirtualListView::GetViewForRow(int row) {
+  int index = row - first_visible_row_;
+  if (index < 0 || index >= static_cast<int>(visible_row_views_.size()))
+    return NULL;
+  return visible_row_views_[index];
+}
+
+void VirtualListView::Layout() {
+  if (!UpdateSize())
+    UpdateVisibleRows();
+}
+
+gfx::Size VirtualListView::GetPreferredSize() {
+  return gfx::Size(0, GetRowY(row_count_));
+}
+
+std::string VirtualListView::GetClassName() const {
+  return kViewClassName;
+}
+
+int VirtualListView::GetPageScrollIncrement(ScrollView* scroll_view,
+                                            bool is_horizontal,
+                                            bool is_positive) {
+  return scroll_helper_.GetPageScrollIncrement(scroll_view, is_horizontal,
+                                               is_positive);
+}
+
+int VirtualListView::GetLineScrollIncrement(ScrollView* scroll_view,
+                                            bool is_horizontal,
+                                            bool is_positive) {
+  return scroll_helper_.GetLineScrollIncrement(scroll_view, is_horizontal,
+                                               is_positive);
+}
+
+VariableRowHeightScrollHelper::RowInfo VirtualListView::GetRowInfo(int y) {
+  int row = GetRowAt(y);
+  if (row < 0)
+    return VariableRowHeightScrollHelper::RowInfo(0, 0);
+  int row_y = GetRowY(row);
+  return VariableRowHeightScrollHelper::RowInfo(row_y,
+                                                GetRowY(row + 1) - row_y);
+}
+
+bool VirtualListView::NeedsNotificationWhenVisibleBoundsChange() const {
+  return true;
+}
+
+void VirtualListView::OnVisibleBoundsChanged() {
+  UpdateVisibleRows();
+}
+
+int VirtualListView::GetRowY(int row) const {
+  DCHECK(row >= 0 && row <= row_count_);
+  if (fixed_row_height_ > 0)
+    return row * fixed_row_height_;
+  return row_offsets_[row];
+}
+
+void VirtualListView::UpdateRows() {
+  row_count_ = std::max(model_->GetRowCount(), 0);
+  row_offsets_.clear();
+  if (fixed_row_height_ > 0)
+    return;
+
+  row_offsets_.reserve(row_count_ + 1);
+  int y = 0;
+  for (int row = 0; row < row_count_; ++row) {
+    row_offsets_.push_back(y);
+    y += std::max(model_->GetRowHeight(row), 0);
+  }
+  row_offsets_.push_back(y);
+}
+
+bool VirtualListView::UpdateSize() {
+  gfx::Size size(parent() ? parent()->width() : width(),
+                 GetRowY(row_count_));
+  if (size == this->size())
+    return false;
+  // Lays out the list when the size changes.
+  SetSize(size);
+  return true;
+}
+
+void VirtualListView::UpdateVisibleRows() {
+  int first = 0;
+  int last = -1;
+  gfx::Rect visible_bounds = GetVisibleBounds();
+  if (!visible_bounds.IsEmpty() && row_count_ > 0) {
+    first = GetRowAt(visible_bounds.y());
+    last = GetRowAt(visible_bounds.bottom() - 1);
+  }
+
+  // Keeps the views of the rows that are still visible, and frees the others.
+  std::vector<View*> row_views(last - first + 1, NULL);
+  for (size_t i = 0; i < visible_row_views_.size(); ++i) {
+    int row = first_visible_row_ + static_cast<int>(i);
+    if (row >= first && row <= last)
+      row_views[row - first] = visible_row_views_[i];
+    else
+      free_row_views_.push_back(visible_row_views_[i]);
+  }
+
+  for (int row = first; row <= last; ++row) {
+    View* view = row_views[row - first];
+    if (!view) {
+      if (!free_row_views_.empty()) {
+        view = free_row_views_.back();
+        free_row_views_.pop_back();
+      } else {
+        view = model_->CreateRowView();
+        AddChildView(view);
+      }
+      model_->BindRowView(row, view);
+      view->SetVisible(true);
+      row_views[row - first] = view;
+    }
+    view->SetBoundsRect(GetRowBounds(row));
+  }
+
+  // The free views are kept for the rows scrolled into view next.
+  for (size_t i = 0; i < free_row_views_.size(); ++i)
+    free_row_views_[i]->SetVisible(false);
+
+  visible_row_views_.swap(row_views);
+  first_visible_row_ = first;
+}
+
+}  // namespace views
@@ -0,0 +1,142 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef VIEWS_CONTROLS_VIRTUAL_LIST_VIEW_H_
+#define VIEWS_CONTROLS_VIRTUAL_LIST_VIEW_H_
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "base/compiler_specific.h"
+#include "views/controls/scroll_view.h"
+#include "views/view.h"
+
+namespace views {
+
+// The rows shown by a VirtualListView, which are bound to the row views that
+// it creates as needed.
+class VirtualListViewModel {
+ public:
+  // Returns the number of rows.
+  virtual int GetRowCount() = 0;
+
+  // Returns the height of |row|. Only called if the VirtualListView doesn't
+  // have a fixed row height, for every row, when the model changes.
+  virtual int GetRowHeight(int row);
+
+  // Creates a view to show rows in. The VirtualListView owns it, and shows
+  // different rows in it over time.
+  virtual View* CreateRowView() = 0;
+
+  // Makes |view|, created by CreateRowView(), show |row|.
+  virtual void BindRowView(int row, View* view) = 0;
+
+ protected:
+  virtual ~VirtualListViewModel() {}
+};
+
+// A list of rows, meant to be the contents of a ScrollView, that only has
+// views for the rows that are visible. As the list is scrolled, the views of
+// the rows that go out of view are bound to those that come into view, so
+// that a list of any length only takes a viewport worth of views:
+//   VirtualListView* list = new VirtualListView(model);
+//   list->SetFixedRowHeight(20);
+//   scroll_view->SetContents(list);
+//
+// The list is as wide as the viewport, and as high as its rows.
+class VIEWS_EXPORT VirtualListView
+    : public View,
+      public VariableRowHeightScrollHelper::Controller {
+ public:
+  static const char kViewClassName[];
+
+  // |model| is not owned, and must outlive the list.
+  explicit VirtualListView(VirtualListViewModel* model);
+  virtual ~VirtualListView();
+
+  // Gives all the rows |height|, so that the model isn't asked for the
+  // height of each of them. 0, the default, asks the model.
+  void SetFixedRowHeight(int height);
+  int fixed_row_height() const { return fixed_row_height_; }
+
+  // Must be called when the model changes: rows were added, removed or
+  // changed height. The visible rows are bound again.
+  void OnModelChanged();
+
+  // Must be called when rows, from |start| to |start| + |length|, changed
+  // without changing height. Those that are visible are bound again.
+  void OnRowsChanged(int start, int length);
+
+  // Returns the row at |y|, clamped to the rows, or -1 if there are none.
+  int GetRowAt(int y) const;
+
+  // Returns the bounds of |row|, in the coordinates of the list.
+  gfx::Rect GetRowBounds(int row) const;
+
+  // Scrolls |row| into view.
+  void ScrollRowToVisible(int row);
+
+  // Returns the view showing |row|, or NULL if |row| is not visible.
+  View* GetViewForRow(int row);
+
+  // View overrides:
+  virtual void Layout() OVERRIDE;
+  virtual gfx::Size GetPreferredSize() OVERRIDE;
+  virtual std::string GetClassName() const OVERRIDE;
+  virtual int GetPageScrollIncrement(ScrollView* scroll_view,
+                                     bool is_horizontal,
+                                     bool is_positive) OVERRIDE;
+  virtual int GetLineScrollIncrement(ScrollView* scroll_view,
+                                     bool is_horizontal,
+                                     bool is_positive) OVERRIDE;
+
+  // VariableRowHeightScrollHelper::Controller implementation:
+  virtual VariableRowHeightScrollHelper::RowInfo GetRowInfo(int y) OVERRIDE;
+
+ protected:
+  // View overrides:
+  virtual bool NeedsNotificationWhenVisibleBoundsChange() const OVERRIDE;
+  virtual void OnVisibleBoundsChanged() OVERRIDE;
+
+ private:
+  // Returns the y coordinate of the top of |row|, which may be the row count
+  // to get the height of all the rows.
+  int GetRowY(int row) const;
+
+  // Asks the model for the row count and heights again.
+  void UpdateRows();
+
+  // Sizes the list to the width of its parent and the height of its rows.
+  // Returns true if the size changed, in which case the list was laid out.
+  bool UpdateSize();
+
+  // Binds the views to the rows that are visible, reusing those of the rows
+  // that no longer are, and those that are free.
+  void UpdateVisibleRows();
+
+  VirtualListViewModel* model_;
+
+  int fixed_row_height_;
+
+  int row_count_;
+
+  // The y coordinate of the top of each row, and of the end of the last one.
+  // Empty if the rows have a fixed height.
+  std::vector<int> row_offsets_;
+
+  // The views of the visible rows, starting with |first_visible_row_|. They
+  // are children of the list, as are |free_row_views_|, which are hidden.
+  int first_visible_row_;
+  std::vector<View*> visible_row_views_;
+  std::vector<View*> free_row_views_;
+
+  VariableRowHeightScrollHelper scroll_helper_;
+
+  DISALLOW_COPY_AND_ASSIGN(VirtualListView);
+};
+
+}  // namespace views
+
+#endif  // VIEWS_CONTROLS_VIRTUAL_LIST_VIEW_H_
@@ -4,8 +4,11 @@
 
 #include "views/drag_utils.h"
 
+#include "base/bind.h"
 #include "base/file_util.h"
 #include "base/logging.h"
+#include "base/message_loop_proxy.h"
+#include "base/threading/worker_pool.h"
 #include "base/utf_string_conversions.h"
 // #include "googleurl/src/gurl.h"
 #include "grit/ui_resources.h"
@@ -13,6 +16,8 @@
 #include "ui/base/resource/resource_bundle.h"
 #include "ui/gfx/canvas_skia.h"
 #include "ui/gfx/font.h"
+#include "ui/gfx/point.h"
+#include "ui/gfx/size.h"
 #include "views/controls/button/text_button.h"
 
 using ui::OSExchangeData;
@@ -55,6 +60,44 @@ static const SkColor kFileDragImageTextColor = SK_ColorBLACK;
 //       gfx::Point(prefsize.width() / 2, prefsize.height() / 2), data);
 // }
 
+static gfx::Size GetFileDragImageSize(const gfx::Font& font,
+                                      const SkBitmap& icon) {
+  // Add +2 here to allow room for the halo.
+  return gfx::Size(kFileDragImageMaxWidth,
+                   font.GetHeight() + icon.height() + kLinkDragImageVPadding +
+                       2);
+}
+
+// The point of the image under the cursor, for any size of the text.
+static gfx::Point GetFileDragImageCursorOffset(const gfx::Size& size) {
+  return gfx::Point(size.width() / 2, kLinkDragImageVPadding);
+}
+
+// Paints the drag image of GetFileDragImageSize() into |canvas|.
+static void PaintFileDragImage(const std::wstring& name,
+                               const SkBitmap& icon,
+                               const gfx::Font& font,
+                               gfx::CanvasSkia* canvas) {
+  const int width = kFileDragImageMaxWidth;
+
+  // Paint the icon.
+  canvas->DrawBitmapInt(icon, (width - icon.width()) / 2, 0);
+
+#if defined(OS_WIN)
+  // Paint the file name. We inset it one pixel to allow room for the halo.
+  canvas->DrawStringWithHalo(name, font, kFileDragImageTextColor,
+                             SK_ColorWHITE, 1,
+                             icon.height() + kLinkDragImageVPadding + 1,
+                             width - 2, font.GetHeight(),
+                             gfx::Canvas::TEXT_ALIGN_CENTER);
+#else
+  canvas->DrawStringInt(WideToUTF16Hack(name), font, kFileDragImageTextColor,
+                        0, icon.height() + kLinkDragImageVPadding,
+                        width, font.GetHeight(),
+                        gfx::Canvas::TEXT_ALIGN_CENTER);
+#endif
+}
+
 void CreateDragImageForFile(const FilePath& file_name,
                             const SkBitmap* icon,
                             OSExchangeData* data_object) {
@@ -65,31 +108,103 @@ void CreateDragImageForFile(const FilePath& file_name,
   ResourceBundle& rb = ResourceBundle::GetSharedInstance();
   gfx::Font font = rb.GetFont(ResourceBundle::BaseFont);
 
-  const int width = kFileDragImageMaxWidth;
-  // Add +2 here to allow room for the halo.
-  const int height = font.GetHeight() + icon->height() +
-                     kLinkDragImageVPadding + 2;
-  gfx::CanvasSkia canvas(width, height, false /* translucent */);
+  gfx::Size size = GetFileDragImageSize(font, *icon);
+  gfx::CanvasSkia canvas(size.width(), size.height(), false /* translucent */);
+  PaintFileDragImage(UTF16ToWide(file_name.BaseName().LossyDisplayName()),
+                     *icon, font, &canvas);
 
-  // Paint the icon.
-  canvas.DrawBitmapInt(*icon, (width - icon->width()) / 2, 0);
+  SetDragImageOnDataObject(canvas, size, GetFileDragImageCursorOffset(size),
+                           data_object);
+}
 
-  std::wstring name = UTF16ToWide(file_name.BaseName().LossyDisplayName());
-#if defined(OS_WIN)
-  // Paint the file name. We inset it one pixel to allow room for the halo.
-  canvas.DrawStringWithHalo(name, font, kFileDragImageTextColor, SK_ColorWHITE,
-                            1, icon->height() + kLinkDragImageVPadding + 1,
-                            width - 2, font.GetHeight(),
-                            gfx::Canvas::TEXT_ALIGN_CENTER);
-#else
-  canvas.DrawStringInt(WideToUTF16Hack(name), font, kFileDragImageTextColor,
-                       0, icon->height() + kLinkDragImageVPadding,
-                       width, font.GetHeight(), gfx::Canvas::TEXT_ALIGN_CENTER);
-#endif
+// Renders the image of an AsyncFileDragImage on a worker thread, and hands it
+// to the drag on the UI thread. Everything the worker thread uses is copied
+// on the UI thread beforehand.
+class AsyncFileDragImage::Job
+    : public base::RefCountedThreadSafe<AsyncFileDragImage::Job> {
+ public:
+  Job(const FilePath& file_name,
+      const SkBitmap& icon,
+      OSExchangeData* data_object)
+      : name_(UTF16ToWide(file_name.BaseName().LossyDisplayName())),
+        data_object_(data_object),
+        message_loop_(base::MessageLoopProxy::current()) {
+    DCHECK(message_loop_);
+    // The pixels of |icon| may be shared with a bitmap the UI thread keeps
+    // drawing, so the worker thread gets a copy of its own.
+    icon.copyTo(&icon_, SkBitmap::kARGB_8888_Config);
+    gfx::Font font =
+        ResourceBundle::GetSharedInstance().GetFont(ResourceBundle::BaseFont);
+    font_name_ = font.GetFontName();
+    font_size_ = font.GetFontSize();
+  }
 
-  SetDragImageOnDataObject(canvas, gfx::Size(width, height),
-                           gfx::Point(width / 2, kLinkDragImageVPadding),
-                           data_object);
+  void Start() {
+    if (!base::WorkerPool::PostTask(
+            FROM_HERE, base::Bind(&Job::RenderOnWorkerThread, this), false)) {
+      // Without a worker thread, the image is rendered here.
+      RenderOnWorkerThread();
+    }
+  }
+
+  void Cancel() {
+    DCHECK(message_loop_->BelongsToCurrentThread());
+    data_object_ = NULL;
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<AsyncFileDragImage::Job>;
+
+  ~Job() {}
+
+  void RenderOnWorkerThread() {
+    gfx::Font font(font_name_, font_size_);
+    gfx::Size size = GetFileDragImageSize(font, icon_);
+    gfx::CanvasSkia canvas(size.width(), size.height(), false);
+    PaintFileDragImage(name_, icon_, font, &canvas);
+    message_loop_->PostTask(
+        FROM_HERE,
+        base::Bind(&Job::SetImage, this, canvas.ExtractBitmap(), size));
+  }
+
+  void SetImage(const SkBitmap& bitmap, const gfx::Size& size) {
+    if (!data_object_)
+      return;
+    UpdateDragImageOnDataObject(bitmap, size,
+                                GetFileDragImageCursorOffset(size),
+                                data_object_);
+  }
+
+  const std::wstring name_;
+  SkBitmap icon_;
+  string16 font_name_;
+  int font_size_;
+
+  // NULL once the AsyncFileDragImage is deleted. Only used on the UI thread.
+  OSExchangeData* data_object_;
+
+  scoped_refptr<base::MessageLoopProxy> message_loop_;
+
+  DISALLOW_COPY_AND_ASSIGN(Job);
+};
+
+AsyncFileDragImage::AsyncFileDragImage(const FilePath& file_name,
+                                       const SkBitmap& icon,
+                                       OSExchangeData* data_object)
+    : job_(new Job(file_name, icon, data_object)) {
+  DCHECK(data_object);
+  // The icon goes where it will be in the whole image, under the cursor.
+  if (!icon.isNull()) {
+    SetDragImageOnDataObject(icon, gfx::Size(icon.width(), icon.height()),
+                             gfx::Point(icon.width() / 2,
+                                        kLinkDragImageVPadding),
+                             data_object);
+  }
+  job_->Start();
+}
+
+AsyncFileDragImage::~AsyncFileDragImage() {
+  job_->Cancel();
 }
 
 void SetDragImageOnDataObject(const gfx::Canvas& canvas,
@@ -8,7 +8,9 @@
 
 #include <string>
 
+#include "base/basictypes.h"
 #include "base/file_path.h"
+#include "base/memory/ref_counted.h"
 #include "views/views_export.h"
 
 class GURL;
@@ -42,6 +44,38 @@ VIEWS_EXPORT void CreateDragImageForFile(const FilePath& file_name,
                                          const SkBitmap* icon,
                                          OSExchangeData* data_object);
 
+// Like CreateDragImageForFile(), without holding up the start of the drag
+// for the rendering of the image: the icon alone is set on the data_object
+// right away, and the whole image is rendered on a WorkerPool thread. It then
+// replaces the icon with UpdateDragImageOnDataObject(), on the UI thread, if
+// the drag is still running. Create it before RunShellDrag(), and delete it
+// once that returns. The image comes in a task, which the drag's nested
+// message loop only runs if nestable tasks are allowed:
+//
+//   ui::OSExchangeData data;
+//   data.SetFilename(path);
+//   drag_utils::AsyncFileDragImage drag_image(path, icon, &data);
+//   MessageLoop::ScopedNestableTaskAllower allow(MessageLoop::current());
+//   GetWidget()->RunShellDrag(this, data, ui::DragDropTypes::DRAG_COPY);
+//
+// Fonts aren't thread-safe, so the worker thread draws the file name with a
+// font of its own, of the name and size of the ResourceBundle's base font.
+class VIEWS_EXPORT AsyncFileDragImage {
+ public:
+  AsyncFileDragImage(const FilePath& file_name,
+                     const SkBitmap& icon,
+                     OSExchangeData* data_object);
+  // Drops the image if it isn't ready yet.
+  ~AsyncFileDragImage();
+
+ private:
+  class Job;
+
+  scoped_refptr<Job> job_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncFileDragImage);
+};
+
 // Sets the drag image on data_object from the supplied canvas. width/height
 // are the size of the image to use, and the offsets give the location of
 // the hotspot for the drag image.
@@ -58,6 +92,13 @@ VIEWS_EXPORT void SetDragImageOnDataObject(const SkBitmap& bitmap,
                                            const gfx::Point& cursor_offset,
                                            OSExchangeData* data_object);
 
+// Like SetDragImageOnDataObject(), for a drag of data_object that has
+// already started: the image that is shown is replaced.
+VIEWS_EXPORT void UpdateDragImageOnDataObject(const SkBitmap& bitmap,
+                                              const gfx::Size& size,
+                                              const gfx::Point& cursor_offset,
+                                              OSExchangeData* data_object);
+
 } // namespace drag_utils
 
 #endif  // #ifndef VIEWS_DRAG_UTILS_H_
@@ -38,6 +38,28 @@ static void SetDragImageOnDataObject(HBITMAP hbitmap,
   }
 }
 
+// Has the drag window of the shell, which shows the image of a drag that
+// has started, load the image of |data_object| again.
+static void UpdateDragWindow(IDataObject* data_object) {
+  static CLIPFORMAT drag_window_format =
+      static_cast<CLIPFORMAT>(RegisterClipboardFormat(L"DragWindow"));
+  FORMATETC format_etc =
+      { drag_window_format, NULL, DVASPECT_CONTENT, -1, TYMED_HGLOBAL };
+  STGMEDIUM medium;
+  if (FAILED(data_object->GetData(&format_etc, &medium)))
+    return;
+  if (medium.tymed == TYMED_HGLOBAL && medium.hGlobal) {
+    HWND* drag_window = static_cast<HWND*>(GlobalLock(medium.hGlobal));
+    if (drag_window) {
+      // DDWM_UPDATEWINDOW, which isn't in the SDK headers.
+      const UINT kUpdateWindowMessage = WM_USER + 3;
+      PostMessage(*drag_window, kUpdateWindowMessage, 0, 0);
+      GlobalUnlock(medium.hGlobal);
+    }
+  }
+  ReleaseStgMedium(&medium);
+}
+
 // Blit the contents of the canvas to a new HBITMAP. It is the caller's
 // responsibility to release the |bits| buffer.
 static HBITMAP CreateHBITMAPFromSkBitmap(const SkBitmap& sk_bitmap) {
@@ -72,4 +94,14 @@ void SetDragImageOnDataObject(const SkBitmap& sk_bitmap,
       OSExchangeDataProviderWin::GetIDataObject(*data_object));
 }
 
+void UpdateDragImageOnDataObject(const SkBitmap& sk_bitmap,
+                                 const gfx::Size& size,
+                                 const gfx::Point& cursor_offset,
+                                 OSExchangeData* data_object) {
+  // The helper replaces the image it stored in the data object, which the
+  // drag window only shows once told to.
+  SetDragImageOnDataObject(sk_bitmap, size, cursor_offset, data_object);
+  UpdateDragWindow(OSExchangeDataProviderWin::GetIDataObject(*data_object));
+}
+
 } // namespace drag_utils
@@ -6,6 +6,8 @@
 #define VIEWS_EVENTS_EVENT_H_
 #pragma once
 
+#include <vector>
+
 #include "base/basictypes.h"
 #include "base/time.h"
 #include "ui/base/events.h"
@@ -297,6 +299,11 @@ class VIEWS_EXPORT TouchEvent : public LocatedEvent {
   DISALLOW_COPY_AND_ASSIGN(TouchEvent);
 };
 
+// The touch events read together from the device, one for each touch point
+// that changed, in the order they were read. RootView::OnTouchFrame()
+// dispatches them in one pass.
+typedef std::vector<const TouchEvent*> TouchFrame;
+
 ////////////////////////////////////////////////////////////////////////////////
 // KeyEvent class
 //
@@ -0,0 +1,127 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Starts up the way an application does, with one window, and prints where
+// the time went until the window's first paint: the StartupTimeline milestones
+// and steps, the PathService cache hits, then the instances that
+// StartupInstanceReport recorded.
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/command_line.h"
+#include "base/compiler_specific.h"
+#include "base/message_loop.h"
+#include "base/metrics/startup_timeline.h"
+#include "base/path_service.h"
+#include "base/process_util.h"
+#include "base/startup_instance_report.h"
+#include "base/stringprintf.h"
+#include "base/threading/platform_thread.h"
+#include "skia/ext/font_cache.h"
+#include "ui/base/resource/resource_bundle.h"
+#include "ui/base/ui_base_paths.h"
+#include "views/controls/label.h"
+#include "views/layout/fill_layout.h"
+#include "views/widget/widget.h"
+#include "views/widget/widget_delegate.h"
+
+#if defined(OS_WIN)
+#include "base/win/library_preloader.h"
+#endif
+
+namespace {
+
+// How long to wait for the first paint before printing what was recorded.
+const int kMaxPaintWaitMs = 5000;
+const int kPaintWaitStepMs = 10;
+
+class StartupTimelineView : public views::WidgetDelegateView {
+ public:
+  StartupTimelineView() {
+    SetLayoutManager(new views::FillLayout);
+    AddChildView(new views::Label(L"Measuring startup..."));
+  }
+
+  virtual ~StartupTimelineView() {}
+
+  // Overridden from views::WidgetDelegate:
+  virtual std::wstring GetWindowTitle() const OVERRIDE {
+    return L"Startup Timeline";
+  }
+  virtual views::View* GetContentsView() OVERRIDE {
+    return this;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(StartupTimelineView);
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+#if defined(OS_WIN)
+  OleInitialize(NULL);
+#endif
+  CommandLine::Init(argc, argv);
+
+  base::EnableTerminationOnHeapCorruption();
+
+  // The exit manager is in charge of calling the dtors of singleton objects.
+  base::AtExitManager exit_manager;
+
+  ui::RegisterPathProvider();
+  ui::ResourceBundle::InitSharedInstanceAsync("en-US");
+  skia::EnableFontCachePurging();
+
+#if defined(OS_WIN)
+  // The libraries the window loads on first use.
+  std::vector<string16> preload_libraries;
+  preload_libraries.push_back(L"uxtheme.dll");
+  preload_libraries.push_back(L"dbghelp.dll");
+#if defined(VIEWS_COMPOSITOR)
+  preload_libraries.push_back(L"d3d10.dll");
+  preload_libraries.push_back(L"d3d10_1.dll");
+  preload_libraries.push_back(L"d3dx10_43.dll");
+#endif
+  base::win::LibraryPreloader::PreloadAsync(preload_libraries);
+#endif
+
+  MessageLoopForUI main_message_loop;
+
+  views::Widget* window = views::Widget::CreateWindowWithBounds(
+      new StartupTimelineView, gfx::Rect(0, 0, 400, 100));
+  window->Show();
+
+  // NativeWidgetWin finishes the timeline when it first paints.
+  for (int waited = 0;
+       waited < kMaxPaintWaitMs && base::StartupTimeline::IsRecording();
+       waited += kPaintWaitStepMs) {
+    MessageLoopForUI::current()->RunAllPending();
+    if (base::StartupTimeline::IsRecording())
+      base::PlatformThread::Sleep(kPaintWaitStepMs);
+  }
+  base::StartupTimeline::Finish();
+
+  std::string report;
+  base::StartupTimeline::WriteAscii(&report);
+  int path_hits, path_misses;
+  if (PathService::GetCacheStats(&path_hits, &path_misses)) {
+    base::StringAppendF(&report, "PathService cache: %d hits, %d misses\n",
+                        path_hits, path_misses);
+  }
+  report.append("\n");
+  base::StartupInstanceReport::WriteAscii(&report);
+  fputs(report.c_str(), stdout);
+
+  window->CloseNow();
+
+#if defined(OS_WIN)
+  OleUninitialize();
+#endif
+  return 0;
+}
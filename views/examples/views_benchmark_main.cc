@@ -0,0 +1,425 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Times the views operations on synthetic view trees, without showing a
+// window: each tree is the contents of a NativeWidgetViews widget inside a
+// hidden top-level widget. The trees are deep, wide, GridLayout-heavy and
+// text-heavy, and the operations are a Layout() after a resize,
+// GetPreferredSize(), Paint() into a CanvasSkia, GetEventHandlerForPoint()
+// and FocusManager::AdvanceFocus().
+//
+// Each operation runs a warm-up trial, then --repetitions trials of
+// --iterations calls. The time per call is reported as the median and the
+// mean with its 95% confidence interval across the trials, with the heap
+// allocations per call, which don't vary between runs and so catch
+// regressions the timings are too noisy for. --filter=<substring> runs the
+// trees and operations whose name matches.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/command_line.h"
+#include "base/compiler_specific.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop.h"
+#include "base/process_util.h"
+#include "base/string_number_conversions.h"
+#include "base/stringprintf.h"
+#include "base/time.h"
+#include "base/utf_string_conversions.h"
+#include "ui/base/resource/resource_bundle.h"
+#include "ui/base/ui_base_paths.h"
+#include "ui/gfx/canvas_skia.h"
+#include "views/background.h"
+#include "views/border.h"
+#include "views/controls/label.h"
+#include "views/focus/focus_manager.h"
+#include "views/layout/box_layout.h"
+#include "views/layout/fill_layout.h"
+#include "views/layout/grid_layout.h"
+#include "views/view.h"
+#include "views/widget/native_widget_views.h"
+#include "views/widget/widget.h"
+
+namespace {
+
+const int kDefaultIterations = 200;
+const int kDefaultRepetitions = 10;
+
+// The size the trees are laid out at, and the one they are resized to.
+const int kTreeWidth = 800;
+const int kTreeHeight = 600;
+const int kResizedWidth = 780;
+
+// The points GetEventHandlerForPoint() is timed on, kHitTestPoints by
+// kHitTestPoints spread over the tree.
+const int kHitTestPoints = 8;
+
+// The heap allocations since the start, counted by the operator new below.
+base::subtle::Atomic32 g_allocations = 0;
+
+void* CountedNew(size_t size, bool nothrow) {
+  base::subtle::NoBarrier_AtomicIncrement(&g_allocations, 1);
+  void* ptr = malloc(size ? size : 1);
+  if (!ptr && !nothrow)
+    abort();
+  return ptr;
+}
+
+// Returns the two-sided 95% quantile of Student's t distribution with
+// |degrees| degrees of freedom.
+double StudentT95(int degrees) {
+  static const double kTable[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+  };
+  if (degrees <= 0)
+    return 0;
+  if (degrees <= static_cast<int>(arraysize(kTable)))
+    return kTable[degrees - 1];
+  return 1.960;
+}
+
+// A leaf of the trees: a focusable box of a fixed preferred size, with a
+// background to paint.
+class LeafView : public views::View {
+ public:
+  explicit LeafView(int index) {
+    set_focusable(true);
+    set_background(views::Background::CreateSolidBackground(
+        (index * 37) % 256, (index * 59) % 256, (index * 83) % 256));
+  }
+
+  virtual gfx::Size GetPreferredSize() OVERRIDE {
+    return gfx::Size(24, 16);
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(LeafView);
+};
+
+// A chain of nested views, each filling its parent inside a one pixel
+// border.
+views::View* CreateDeepTree() {
+  const int kDepth = 200;
+  views::View* root = new views::View;
+  views::View* parent = root;
+  for (int i = 0; i < kDepth; ++i) {
+    parent->SetLayoutManager(new views::FillLayout);
+    views::View* child = i == kDepth - 1 ? new LeafView(i) : new views::View;
+    child->set_border(views::Border::CreateEmptyBorder(1, 1, 1, 1));
+    parent->AddChildView(child);
+    parent = child;
+  }
+  return root;
+}
+
+// Rows of leaves, laid out by BoxLayouts.
+views::View* CreateWideTree() {
+  const int kRows = 50;
+  const int kColumns = 20;
+  views::View* root = new views::View;
+  root->SetLayoutManager(
+      new views::BoxLayout(views::BoxLayout::kVertical, 0, 0, 2));
+  for (int i = 0; i < kRows; ++i) {
+    views::View* row = new views::View;
+    row->SetLayoutManager(
+        new views::BoxLayout(views::BoxLayout::kHorizontal, 0, 0, 2));
+    for (int j = 0; j < kColumns; ++j)
+      row->AddChildView(new LeafView(i * kColumns + j));
+    root->AddChildView(row);
+  }
+  return root;
+}
+
+// A form: rows of a label, then two resizable leaves.
+views::View* CreateGridTree() {
+  const int kRows = 100;
+  views::View* root = new views::View;
+  views::GridLayout* layout = views::GridLayout::CreatePanel(root);
+  root->SetLayoutManager(layout);
+  views::ColumnSet* columns = layout->AddColumnSet(0);
+  columns->AddColumn(views::GridLayout::LEADING, views::GridLayout::CENTER, 0,
+                     views::GridLayout::USE_PREF, 0, 0);
+  columns->AddPaddingColumn(0, 8);
+  columns->AddColumn(views::GridLayout::FILL, views::GridLayout::FILL, 1,
+                     views::GridLayout::USE_PREF, 0, 0);
+  columns->AddPaddingColumn(0, 8);
+  columns->AddColumn(views::GridLayout::FILL, views::GridLayout::FILL, 1,
+                     views::GridLayout::USE_PREF, 0, 0);
+  for (int i = 0; i < kRows; ++i) {
+    layout->StartRowWithPadding(0, 0, 0, 4);
+    layout->AddView(new views::Label(
+        UTF8ToWide(base::StringPrintf("Setting %d", i))));
+    layout->AddView(new LeafView(2 * i));
+    layout->AddView(new LeafView(2 * i + 1));
+  }
+  return root;
+}
+
+// Labels of varied lengths, one in four on several lines.
+views::View* CreateTextTree() {
+  const int kLabels = 300;
+  views::View* root = new views::View;
+  root->SetLayoutManager(
+      new views::BoxLayout(views::BoxLayout::kVertical, 4, 4, 2));
+  for (int i = 0; i < kLabels; ++i) {
+    std::string text = base::StringPrintf("Label %d:", i);
+    for (int j = 0; j < i % 12; ++j)
+      text.append(" the quick brown fox jumps over the lazy dog");
+    views::Label* label = new views::Label(UTF8ToWide(text));
+    label->SetMultiLine(i % 4 == 0);
+    label->SetHorizontalAlignment(views::Label::ALIGN_LEFT);
+    root->AddChildView(label);
+  }
+  return root;
+}
+
+// A tree in its own widget, and the state its operations carry between
+// calls.
+class Benchmark {
+ public:
+  Benchmark(views::Widget* host, views::View* root)
+      : widget_(new views::Widget),
+        root_(root),
+        canvas_(kTreeWidth, kTreeHeight, true),
+        resized_(false),
+        hit_test_index_(0) {
+    views::Widget::InitParams params(views::Widget::InitParams::TYPE_CONTROL);
+    params.parent_widget = host;
+    params.native_widget = new views::NativeWidgetViews(widget_);
+    params.bounds = gfx::Rect(0, 0, kTreeWidth, kTreeHeight);
+    widget_->Init(params);
+    widget_->SetContentsView(root_);
+    root_->SetBounds(0, 0, kTreeWidth, kTreeHeight);
+  }
+
+  ~Benchmark() {
+    widget_->CloseNow();
+  }
+
+  // Resizes the tree, so that its layout managers lay it out again, as when
+  // the window is resized.
+  void Layout() {
+    views::View::ScopedLayoutPass layout_pass;
+    resized_ = !resized_;
+    root_->SetSize(gfx::Size(resized_ ? kResizedWidth : kTreeWidth,
+                             kTreeHeight));
+  }
+
+  // Computes the preferred size of the whole tree, which outside of a layout
+  // pass asks every view again.
+  void GetPreferredSize() {
+    root_->GetPreferredSize();
+  }
+
+  void Paint() {
+    root_->Paint(&canvas_);
+  }
+
+  void HitTest() {
+    int x = hit_test_index_ % kHitTestPoints;
+    int y = hit_test_index_ / kHitTestPoints % kHitTestPoints;
+    ++hit_test_index_;
+    root_->GetEventHandlerForPoint(gfx::Point(
+        (2 * x + 1) * root_->width() / (2 * kHitTestPoints),
+        (2 * y + 1) * root_->height() / (2 * kHitTestPoints)));
+  }
+
+  // Moves the focus to the next focusable view, as Tab does.
+  void AdvanceFocus() {
+    widget_->GetFocusManager()->AdvanceFocus(false);
+  }
+
+ private:
+  views::Widget* widget_;
+  views::View* root_;
+  gfx::CanvasSkia canvas_;
+  bool resized_;
+  int hit_test_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(Benchmark);
+};
+
+typedef views::View* (*CreateTreeFunction)();
+typedef void (Benchmark::*Operation)();
+
+struct TreeType {
+  const char* name;
+  CreateTreeFunction create;
+};
+
+const TreeType kTrees[] = {
+  { "deep", &CreateDeepTree },
+  { "wide", &CreateWideTree },
+  { "grid", &CreateGridTree },
+  { "text", &CreateTextTree },
+};
+
+struct OperationType {
+  const char* name;
+  Operation operation;
+};
+
+const OperationType kOperations[] = {
+  { "Layout", &Benchmark::Layout },
+  { "GetPreferredSize", &Benchmark::GetPreferredSize },
+  { "Paint", &Benchmark::Paint },
+  { "HitTest", &Benchmark::HitTest },
+  { "AdvanceFocus", &Benchmark::AdvanceFocus },
+};
+
+// Runs |operation| on |benchmark| and prints the statistics of its time per
+// call, in microseconds, and its allocations per call.
+void RunOperation(const std::string& name,
+                  Benchmark* benchmark,
+                  Operation operation,
+                  int iterations,
+                  int repetitions) {
+  for (int i = 0; i < iterations; ++i)
+    (benchmark->*operation)();
+
+  std::vector<double> samples;
+  base::subtle::Atomic32 allocations = 0;
+  for (int i = 0; i < repetitions; ++i) {
+    base::subtle::Atomic32 allocations_before =
+        base::subtle::NoBarrier_Load(&g_allocations);
+    base::TimeTicks start = base::TimeTicks::HighResNow();
+    for (int j = 0; j < iterations; ++j)
+      (benchmark->*operation)();
+    base::TimeDelta elapsed = base::TimeTicks::HighResNow() - start;
+    allocations += base::subtle::NoBarrier_Load(&g_allocations) -
+        allocations_before;
+    samples.push_back(elapsed.InMillisecondsF() * 1000.0 / iterations);
+  }
+  std::sort(samples.begin(), samples.end());
+
+  size_t count = samples.size();
+  double median = count % 2 ? samples[count / 2] :
+      (samples[count / 2 - 1] + samples[count / 2]) / 2;
+  double mean = 0;
+  for (size_t i = 0; i < count; ++i)
+    mean += samples[i];
+  mean /= count;
+  double variance = 0;
+  for (size_t i = 0; i < count; ++i)
+    variance += (samples[i] - mean) * (samples[i] - mean);
+  double stddev = count > 1 ? sqrt(variance / (count - 1)) : 0;
+  double interval = StudentT95(static_cast<int>(count) - 1) * stddev /
+      sqrt(static_cast<double>(count));
+
+  printf("%-24s %10.2f %10.2f +- %-8.2f %10.1f\n", name.c_str(), median, mean,
+         interval, static_cast<double>(allocations) / (iterations * count));
+}
+
+int GetIntSwitch(const CommandLine& command_line,
+                 const char* name,
+                 int default_value) {
+  int value;
+  if (!command_line.HasSwitch(name) ||
+      !base::StringToInt(command_line.GetSwitchValueASCII(name), &value) ||
+      value <= 0)
+    return default_value;
+  return value;
+}
+
+}  // namespace
+
+// Only this executable gets the counting operator new and delete, so it must
+// not depend on base.gyp:heap_profiler_new.
+void* operator new(size_t size) {
+  return CountedNew(size, false);
+}
+
+void* operator new[](size_t size) {
+  return CountedNew(size, false);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) throw() {
+  return CountedNew(size, true);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) throw() {
+  return CountedNew(size, true);
+}
+
+void operator delete(void* ptr) throw() {
+  free(ptr);
+}
+
+void operator delete[](void* ptr) throw() {
+  free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) throw() {
+  free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) throw() {
+  free(ptr);
+}
+
+int main(int argc, char** argv) {
+#if defined(OS_WIN)
+  OleInitialize(NULL);
+#endif
+  CommandLine::Init(argc, argv);
+  const CommandLine& command_line = *CommandLine::ForCurrentProcess();
+
+  base::EnableTerminationOnHeapCorruption();
+
+  // The exit manager is in charge of calling the dtors of singleton objects.
+  base::AtExitManager exit_manager;
+
+  ui::RegisterPathProvider();
+  ui::ResourceBundle::InitSharedInstance("en-US");
+
+  MessageLoopForUI main_message_loop;
+
+  int iterations = GetIntSwitch(command_line, "iterations", kDefaultIterations);
+  int repetitions =
+      GetIntSwitch(command_line, "repetitions", kDefaultRepetitions);
+  std::string filter = command_line.GetSwitchValueASCII("filter");
+
+  // The top-level widget is never shown.
+  views::Widget* host = new views::Widget;
+  views::Widget::InitParams params(
+      views::Widget::InitParams::TYPE_WINDOW_FRAMELESS);
+  params.bounds = gfx::Rect(0, 0, kTreeWidth, kTreeHeight);
+  host->Init(params);
+
+  printf("%d trials of %d calls, in us per call\n", repetitions, iterations);
+  printf("%-24s %10s %24s %10s\n", "benchmark", "median", "mean, 95% CI",
+         "allocs");
+  for (size_t i = 0; i < arraysize(kTrees); ++i) {
+    scoped_ptr<Benchmark> benchmark;
+    for (size_t j = 0; j < arraysize(kOperations); ++j) {
+      std::string name =
+          std::string(kTrees[i].name) + "." + kOperations[j].name;
+      if (!filter.empty() && name.find(filter) == std::string::npos)
+        continue;
+      if (!benchmark.get())
+        benchmark.reset(new Benchmark(host, kTrees[i].create()));
+      RunOperation(name, benchmark.get(), kOperations[j].operation,
+                   iterations, repetitions);
+    }
+  }
+
+  host->CloseNow();
+
+#if defined(OS_WIN)
+  OleUninitialize();
+#endif
+  return 0;
+}
@@ -24,6 +24,7 @@ FocusManager::FocusManager(Widget* widget)
     : widget_(widget),
       focused_view_(NULL),
       focus_change_reason_(kReasonDirectFocusChange),
+      accelerator_key_code_counts_(kMaxAcceleratorKeyCode + 1, 0),
       is_changing_focus_(false) {
   DCHECK(widget_);
   stored_focused_view_storage_id_ =
@@ -85,7 +86,10 @@ bool FocusManager::OnKeyEvent(const KeyEvent& event) {
 
   // Process keyboard accelerators.
   // If the key combination matches an accelerator, the accelerator is
-  // triggered, otherwise the key event is processed as usual.
+  // triggered, otherwise the key event is processed as usual. Most keys typed
+  // have no accelerator.
+  if (!HasAcceleratorForKeyCode(key_code))
+    return true;
   Accelerator accelerator(event.key_code(),
                           event.IsShiftDown(),
                           event.IsControlDown(),
@@ -357,45 +361,93 @@ View* FocusManager::FindFocusableView(FocusTraversable* focus_traversable,
 void FocusManager::RegisterAccelerator(
     const Accelerator& accelerator,
     AcceleratorTarget* target) {
-  AcceleratorTargetList& targets = accelerators_[accelerator];
-  DCHECK(std::find(targets.begin(), targets.end(), target) == targets.end())
+  RegisterAccelerator(accelerator, kNormalPriority, target);
+}
+
+void FocusManager::RegisterAccelerator(
+    const Accelerator& accelerator,
+    AcceleratorPriority priority,
+    AcceleratorTarget* target) {
+  AcceleratorTargets& targets =
+      accelerators_[GetAcceleratorKey(accelerator)];
+  DCHECK(std::find(targets.targets.begin(), targets.targets.end(), target) ==
+         targets.targets.end())
       << "Registering the same target multiple times";
-  targets.push_front(target);
+  if (priority == kHighPriority) {
+    targets.targets.push_front(target);
+    ++targets.high_priority_count;
+  } else {
+    AcceleratorTargetList::iterator first_normal = targets.targets.begin();
+    std::advance(first_normal, targets.high_priority_count);
+    targets.targets.insert(first_normal, target);
+  }
+  if (accelerator.key_code() <= kMaxAcceleratorKeyCode)
+    ++accelerator_key_code_counts_[accelerator.key_code()];
 }
 
 void FocusManager::UnregisterAccelerator(const Accelerator& accelerator,
                                          AcceleratorTarget* target) {
-  AcceleratorMap::iterator map_iter = accelerators_.find(accelerator);
+  AcceleratorMap::iterator map_iter =
+      accelerators_.find(GetAcceleratorKey(accelerator));
   if (map_iter == accelerators_.end()) {
     NOTREACHED() << "Unregistering non-existing accelerator";
     return;
   }
 
-  AcceleratorTargetList* targets = &map_iter->second;
+  AcceleratorTargets* targets = &map_iter->second;
   AcceleratorTargetList::iterator target_iter =
-      std::find(targets->begin(), targets->end(), target);
-  if (target_iter == targets->end()) {
+      std::find(targets->targets.begin(), targets->targets.end(), target);
+  if (target_iter == targets->targets.end()) {
     NOTREACHED() << "Unregistering accelerator for wrong target";
     return;
   }
 
-  targets->erase(target_iter);
+  if (static_cast<size_t>(std::distance(targets->targets.begin(),
+                                        target_iter)) <
+      targets->high_priority_count)
+    --targets->high_priority_count;
+  targets->targets.erase(target_iter);
+  if (targets->targets.empty())
+    accelerators_.erase(map_iter);
+  if (accelerator.key_code() <= kMaxAcceleratorKeyCode)
+    --accelerator_key_code_counts_[accelerator.key_code()];
 }
 
 void FocusManager::UnregisterAccelerators(AcceleratorTarget* target) {
   for (AcceleratorMap::iterator map_iter = accelerators_.begin();
-       map_iter != accelerators_.end(); ++map_iter) {
-    AcceleratorTargetList* targets = &map_iter->second;
-    targets->remove(target);
+       map_iter != accelerators_.end();) {
+    AcceleratorTargets* targets = &map_iter->second;
+    AcceleratorTargetList::iterator target_iter =
+        std::find(targets->targets.begin(), targets->targets.end(), target);
+    if (target_iter == targets->targets.end()) {
+      ++map_iter;
+      continue;
+    }
+    if (static_cast<size_t>(std::distance(targets->targets.begin(),
+                                          target_iter)) <
+        targets->high_priority_count)
+      --targets->high_priority_count;
+    targets->targets.erase(target_iter);
+    int64 key = map_iter->first;
+    ui::KeyboardCode key_code = static_cast<ui::KeyboardCode>(key >> 32);
+    if (key_code <= kMaxAcceleratorKeyCode)
+      --accelerator_key_code_counts_[key_code];
+    if (targets->targets.empty())
+      accelerators_.erase(map_iter++);
+    else
+      ++map_iter;
   }
 }
 
 bool FocusManager::ProcessAccelerator(const Accelerator& accelerator) {
-  AcceleratorMap::iterator map_iter = accelerators_.find(accelerator);
+  if (!HasAcceleratorForKeyCode(accelerator.key_code()))
+    return false;
+  AcceleratorMap::iterator map_iter =
+      accelerators_.find(GetAcceleratorKey(accelerator));
   if (map_iter != accelerators_.end()) {
     // We have to copy the target list here, because an AcceleratorPressed
     // event handler may modify the list.
-    AcceleratorTargetList targets(map_iter->second);
+    AcceleratorTargetList targets(map_iter->second.targets);
     for (AcceleratorTargetList::iterator iter = targets.begin();
          iter != targets.end(); ++iter) {
       if ((*iter)->AcceleratorPressed(accelerator))
@@ -407,10 +459,23 @@ bool FocusManager::ProcessAccelerator(const Accelerator& accelerator) {
 
 AcceleratorTarget* FocusManager::GetCurrentTargetForAccelerator(
     const views::Accelerator& accelerator) const {
-  AcceleratorMap::const_iterator map_iter = accelerators_.find(accelerator);
-  if (map_iter == accelerators_.end() || map_iter->second.empty())
+  AcceleratorMap::const_iterator map_iter =
+      accelerators_.find(GetAcceleratorKey(accelerator));
+  if (map_iter == accelerators_.end() || map_iter->second.targets.empty())
     return NULL;
-  return map_iter->second.front();
+  return map_iter->second.targets.front();
+}
+
+// static
+int64 FocusManager::GetAcceleratorKey(const Accelerator& accelerator) {
+  return (static_cast<int64>(accelerator.key_code()) << 32) |
+      static_cast<uint32>(accelerator.modifiers());
+}
+
+bool FocusManager::HasAcceleratorForKeyCode(ui::KeyboardCode key_code) const {
+  // Key codes out of the table are looked up.
+  return key_code < 0 || key_code > kMaxAcceleratorKeyCode ||
+      accelerator_key_code_counts_[key_code] > 0;
 }
 
 void FocusManager::FocusNativeView(gfx::NativeView native_view) {
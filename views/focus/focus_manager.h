@@ -7,9 +7,10 @@
 #pragma once
 
 #include <list>
-#include <map>
+#include <vector>
 
 #include "base/basictypes.h"
+#include "base/hash_tables.h"
 #include "base/observer_list.h"
 #include "ui/gfx/native_widget_types.h"
 #include "views/accelerator.h"
@@ -174,9 +175,16 @@ class VIEWS_EXPORT FocusManager {
   // Returns true if in the process of changing the focused view.
   bool is_changing_focus() const { return is_changing_focus_; }
 
+  // The priority of the targets of an accelerator: high priority targets
+  // are tried before the normal priority ones, whenever they registered.
+  enum AcceleratorPriority {
+    kNormalPriority,
+    kHighPriority
+  };
+
   // Register a keyboard accelerator for the specified target. If multiple
-  // targets are registered for an accelerator, a target registered later has
-  // higher priority.
+  // targets are registered for an accelerator with the same priority, a target
+  // registered later has higher priority.
   // Note that we are currently limited to accelerators that are either:
   // - a key combination including Ctrl or Alt
   // - the escape key
@@ -185,6 +193,9 @@ class VIEWS_EXPORT FocusManager {
   // - any browser specific keys (as available on special keyboards)
   void RegisterAccelerator(const Accelerator& accelerator,
                            AcceleratorTarget* target);
+  void RegisterAccelerator(const Accelerator& accelerator,
+                           AcceleratorPriority priority,
+                           AcceleratorTarget* target);
 
   // Unregister the specified keyboard accelerator for the specified target.
   void UnregisterAccelerator(const Accelerator& accelerator,
@@ -198,7 +209,8 @@ class VIEWS_EXPORT FocusManager {
   // is called, and if that handler processes the event (i.e. returns true),
   // this method immediately returns. If not, we do the same thing on the next
   // target, and so on.
-  // Returns true if an accelerator was activated.
+  // Returns true if an accelerator was activated. Keys that no accelerator is
+  // registered for, whatever the modifiers, are rejected without a lookup.
   bool ProcessAccelerator(const Accelerator& accelerator);
 
   // Called by a RootView when a view within its hierarchy is removed
@@ -254,11 +266,35 @@ class VIEWS_EXPORT FocusManager {
   // The reason why the focus most recently changed.
   FocusChangeReason focus_change_reason_;
 
-  // The accelerators and associated targets.
+  // The targets of an accelerator, in the order they are tried: the high
+  // priority ones, which are the first |high_priority_count|, then the others,
+  // each the most recently registered first.
   typedef std::list<AcceleratorTarget*> AcceleratorTargetList;
-  typedef std::map<Accelerator, AcceleratorTargetList> AcceleratorMap;
+  struct AcceleratorTargets {
+    AcceleratorTargets() : high_priority_count(0) {}
+
+    AcceleratorTargetList targets;
+    size_t high_priority_count;
+  };
+
+  // The accelerators and associated targets, by GetAcceleratorKey().
+  typedef base::hash_map<int64, AcceleratorTargets> AcceleratorMap;
+
+  // Returns the key of |accelerator| in |accelerators_|: its key code and its
+  // modifiers.
+  static int64 GetAcceleratorKey(const Accelerator& accelerator);
+
+  // Returns whether an accelerator is registered for |key_code|, with any
+  // modifiers.
+  bool HasAcceleratorForKeyCode(ui::KeyboardCode key_code) const;
+
   AcceleratorMap accelerators_;
 
+  // The number of targets registered for each key code, whatever the
+  // modifiers, for the key codes up to kMaxAcceleratorKeyCode.
+  static const int kMaxAcceleratorKeyCode = 0xFF;
+  std::vector<int> accelerator_key_code_counts_;
+
   // The list of registered FocusChange listeners.
   ObserverList<FocusChangeListener, true> focus_change_listeners_;
 
@@ -1,4 +1,4 @@
-// Copyright (c) 2010 The Chromium Authors. All rights reserved.
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
@@ -9,10 +9,28 @@
 
 namespace views {
 
+// static
+int FocusSearch::generation_ = 0;
+
+FocusSearch::SearchResult::SearchResult()
+    : view(NULL),
+      focus_traversable(NULL),
+      focus_traversable_view(NULL) {
+}
+
 FocusSearch::FocusSearch(View* root, bool cycle, bool accessibility_mode)
     : root_(root),
       cycle_(cycle),
-      accessibility_mode_(accessibility_mode) {
+      accessibility_mode_(accessibility_mode),
+      order_generation_(generation_) {
+}
+
+FocusSearch::~FocusSearch() {
+}
+
+// static
+void FocusSearch::InvalidateFocusOrders() {
+  ++generation_;
 }
 
 View* FocusSearch::FindNextFocusableView(View* starting_view,
@@ -21,6 +39,50 @@ View* FocusSearch::FindNextFocusableView(View* starting_view,
                                          bool check_starting_view,
                                          FocusTraversable** focus_traversable,
                                          View** focus_traversable_view) {
+  // What FocusManager searches when moving the focus is cached, the rest
+  // isn't.
+  if (direction != DOWN || check_starting_view) {
+    return SearchNextFocusableView(starting_view, reverse, direction,
+                                   check_starting_view, focus_traversable,
+                                   focus_traversable_view);
+  }
+
+  if (order_generation_ != generation_) {
+    next_order_.clear();
+    previous_order_.clear();
+    order_generation_ = generation_;
+  }
+  FocusOrder* order = reverse ? &previous_order_ : &next_order_;
+  FocusOrder::const_iterator found = order->find(starting_view);
+  if (found == order->end()) {
+    CacheFocusOrder(starting_view, reverse, order);
+    found = order->find(starting_view);
+  }
+  *focus_traversable = found->second.focus_traversable;
+  *focus_traversable_view = found->second.focus_traversable_view;
+  return found->second.view;
+}
+
+void FocusSearch::CacheFocusOrder(View* starting_view,
+                                  bool reverse,
+                                  FocusOrder* order) {
+  View* view = starting_view;
+  do {
+    SearchResult& result = (*order)[view];
+    result.view = SearchNextFocusableView(view, reverse, DOWN, false,
+                                          &result.focus_traversable,
+                                          &result.focus_traversable_view);
+    view = result.view;
+  } while (view && order->find(view) == order->end());
+}
+
+View* FocusSearch::SearchNextFocusableView(
+    View* starting_view,
+    bool reverse,
+    Direction direction,
+    bool check_starting_view,
+    FocusTraversable** focus_traversable,
+    View** focus_traversable_view) {
   *focus_traversable = NULL;
   *focus_traversable_view = NULL;
 
@@ -73,8 +135,8 @@ View* FocusSearch::FindNextFocusableView(View* starting_view,
 
   // If |cycle_| is true, prefer to keep cycling rather than returning NULL.
   if (cycle_ && !v && initial_starting_view) {
-    v = FindNextFocusableView(NULL, reverse, direction, check_starting_view,
-                              focus_traversable, focus_traversable_view);
+    v = SearchNextFocusableView(NULL, reverse, direction, check_starting_view,
+                                focus_traversable, focus_traversable_view);
     DCHECK(IsFocusable(v));
     return v;
   }
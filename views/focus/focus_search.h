@@ -6,6 +6,8 @@
 #define VIEWS_WIDGET_FOCUS_SEARCH_H_
 #pragma once
 
+#include <map>
+
 #include "views/view.h"
 
 namespace views {
@@ -14,6 +16,13 @@ class FocusTraversable;
 
 // FocusSearch is an object that implements the algorithm to find the
 // next view to focus.
+//
+// The searches FocusManager makes to move the focus forward or backward
+// within a hierarchy are cached: the first one walks the focus order from
+// its starting view to the end, and records the view each view of that order
+// is followed by, so that the next ones are lookups. The cached orders of
+// all the FocusSearches are dropped whenever a view hierarchy or the
+// focusability of a view changes (see InvalidateFocusOrders()).
 class VIEWS_EXPORT FocusSearch {
  public:
   // The direction in which the focus traversal is going.
@@ -38,7 +47,13 @@ class VIEWS_EXPORT FocusSearch {
   //   needed and you  want to check IsAccessibilityFocusableInRootView(),
   //   rather than IsFocusableInRootView().
   FocusSearch(View* root, bool cycle, bool accessibility_mode);
-  virtual ~FocusSearch() {}
+  virtual ~FocusSearch();
+
+  // Drops the focus orders cached by all the FocusSearches. View calls it when
+  // views are added or removed, or are made visible, enabled or focusable, or
+  // the opposite; views whose IsFocusable(), GetSelectedViewForGroup() or
+  // GetFocusTraversable() depend on more must call it when that changes.
+  static void InvalidateFocusOrders();
 
   // Finds the next view that should be focused and returns it. If a
   // FocusTraversable is found while searching for the focusable view,
@@ -70,6 +85,31 @@ class VIEWS_EXPORT FocusSearch {
                                       View** focus_traversable_view);
 
  private:
+  // The result of a search.
+  struct SearchResult {
+    SearchResult();
+
+    View* view;
+    FocusTraversable* focus_traversable;
+    View* focus_traversable_view;
+  };
+
+  // The result of the search from each view of a focus order, NULL for the
+  // first view, when going down without checking the starting view.
+  typedef std::map<View*, SearchResult> FocusOrder;
+
+  // FindNextFocusableView(), without the cache.
+  View* SearchNextFocusableView(View* starting_view,
+                                bool reverse,
+                                Direction direction,
+                                bool check_starting_view,
+                                FocusTraversable** focus_traversable,
+                                View** focus_traversable_view);
+
+  // Adds to |order| the focus order from |starting_view| on, until its end,
+  // a FocusTraversable, or a view already in it.
+  void CacheFocusOrder(View* starting_view, bool reverse, FocusOrder* order);
+
   // Convenience method that returns true if a view is focusable and does not
   // belong to the specified group.
   bool IsViewFocusableCandidate(View* v, int skip_group_id);
@@ -114,6 +154,15 @@ class VIEWS_EXPORT FocusSearch {
   bool cycle_;
   bool accessibility_mode_;
 
+  // The cached focus orders, forward and reverse, and the value of
+  // |generation_| they were cached at.
+  FocusOrder next_order_;
+  FocusOrder previous_order_;
+  int order_generation_;
+
+  // Incremented by InvalidateFocusOrders().
+  static int generation_;
+
   DISALLOW_COPY_AND_ASSIGN(FocusSearch);
 };
 
@@ -15,6 +15,8 @@ namespace internal {
 
 LayerHelper::LayerHelper()
     : fills_bounds_opaquely_(false),
+      masks_to_bounds_(false),
+      tiled_(false),
       paint_to_layer_(false),
       property_setter_explicitly_set_(false),
       needs_paint_all_(true) {
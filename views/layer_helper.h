@@ -63,6 +63,16 @@ class LayerHelper {
   }
   bool fills_bounds_opaquely() const { return fills_bounds_opaquely_; }
 
+  // See description in View for details
+  void set_masks_to_bounds(bool masks_to_bounds) {
+    masks_to_bounds_ = masks_to_bounds;
+  }
+  bool masks_to_bounds() const { return masks_to_bounds_; }
+
+  // See description in View for details
+  void set_tiled(bool tiled) { tiled_ = tiled; }
+  bool tiled() const { return tiled_; }
+
   void SetPropertySetter(LayerPropertySetter* setter);
   LayerPropertySetter* property_setter() {
     return property_setter_.get();
@@ -95,6 +105,10 @@ class LayerHelper {
 
   bool fills_bounds_opaquely_;
 
+  bool masks_to_bounds_;
+
+  bool tiled_;
+
   // Should the View paint to a layer?
   bool paint_to_layer_;
 
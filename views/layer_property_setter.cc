@@ -75,6 +75,9 @@ void AnimatingSetter::Installed(ui::Layer* layer) {
 }
 
 void AnimatingSetter::Uninstalled(ui::Layer* layer) {
+  // The compositor would otherwise go on drawing the animations it runs.
+  animator_->StopAnimatingToPoint();
+  animator_->StopAnimatingTransform();
   animator_.reset();
 }
 
@@ -34,7 +34,7 @@ void BoxLayout::Layout(View* host) {
     View* child = host->child_at(i);
     if (child->IsVisible()) {
       gfx::Rect bounds(x, y, child_area.width(), child_area.height());
-      gfx::Size size(child->GetPreferredSize());
+      gfx::Size size(child->GetCachedPreferredSize());
       if (orientation_ == kHorizontal) {
         bounds.set_width(size.width());
         x += size.width() + between_child_spacing_;
@@ -54,7 +54,7 @@ gfx::Size BoxLayout::GetPreferredSize(View* host) {
   for (int i = 0; i < host->child_count(); ++i) {
     View* child = host->child_at(i);
     if (child->IsVisible()) {
-      gfx::Size size(child->GetPreferredSize());
+      gfx::Size size(child->GetCachedPreferredSize());
       if (orientation_ == kHorizontal) {
         gfx::Rect child_bounds(position, 0, size.width(), size.height());
         bounds = bounds.Union(child_bounds);
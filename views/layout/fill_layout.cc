@@ -23,8 +23,9 @@ void FillLayout::Layout(View* host) {
 }
 
 gfx::Size FillLayout::GetPreferredSize(View* host) {
-  DCHECK_EQ(1, host->child_count());
-  return host->child_at(0)->GetPreferredSize();
+  // A RootView may have windowless popups after its contents view.
+  DCHECK(host->has_children());
+  return host->child_at(0)->GetCachedPreferredSize();
 }
 
 }  // namespace views
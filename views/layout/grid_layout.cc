@@ -269,7 +269,11 @@ class Row : public LayoutElement {
       height_(height),
       column_set_(column_set),
       max_ascent_(0),
-      max_descent_(0) {
+      max_descent_(0),
+      size_valid_(false),
+      saved_size_(0),
+      saved_max_ascent_(0),
+      saved_max_descent_(0) {
   }
 
   virtual ~Row() {}
@@ -298,6 +302,30 @@ class Row : public LayoutElement {
     return max_descent_;
   }
 
+  // The size the views that only span this row give it is kept between
+  // layouts, until the size of one of them changes.
+  bool size_valid() const {
+    return size_valid_;
+  }
+
+  void InvalidateSize() {
+    size_valid_ = false;
+  }
+
+  void SaveSize() {
+    saved_size_ = Size();
+    saved_max_ascent_ = max_ascent_;
+    saved_max_descent_ = max_descent_;
+    size_valid_ = true;
+  }
+
+  void RestoreSize() {
+    DCHECK(size_valid_);
+    SetSize(saved_size_);
+    max_ascent_ = saved_max_ascent_;
+    max_descent_ = saved_max_descent_;
+  }
+
  private:
   const bool fixed_height_;
   const int height_;
@@ -307,6 +335,11 @@ class Row : public LayoutElement {
   int max_ascent_;
   int max_descent_;
 
+  bool size_valid_;
+  int saved_size_;
+  int saved_max_ascent_;
+  int saved_max_descent_;
+
   DISALLOW_COPY_AND_ASSIGN(Row);
 };
 
@@ -332,7 +365,14 @@ struct ViewState {
         pref_height(pref_height),
         remaining_width(0),
         remaining_height(0),
-        baseline(-1) {
+        baseline(-1),
+        sizes_valid(false),
+        view_baseline(-1),
+        has_height_for_width(false),
+        height_for_width_width(0),
+        height_for_width(0),
+        row_height(-1),
+        row_baseline(-1) {
     DCHECK(view && start_col >= 0 && start_row >= 0 && col_span > 0 &&
            row_span > 0 && start_col < column_set->num_columns() &&
            (start_col + col_span) <= column_set->num_columns());
@@ -364,6 +404,22 @@ struct ViewState {
   // The baseline. Only used if the view is vertically aligned along the
   // baseline.
   int baseline;
+
+  // The sizes obtained from the view, which are kept between layouts until
+  // the layout of the view is invalidated: its preferred size, its baseline,
+  // and its height for the last width it was given that differed from its
+  // preferred width, if any.
+  bool sizes_valid;
+  gfx::Size view_pref;
+  int view_baseline;
+  bool has_height_for_width;
+  int height_for_width_width;
+  int height_for_width;
+
+  // The height and baseline that the view last gave its rows, to tell when
+  // they must be sized again.
+  int row_height;
+  int row_baseline;
 };
 
 static bool CompareByColumnSpan(const ViewState* v1, const ViewState* v2) {
@@ -376,7 +432,7 @@ static bool CompareByRowSpan(const ViewState* v1, const ViewState* v2) {
 
 // ColumnSet -------------------------------------------------------------
 
-ColumnSet::ColumnSet(int id) : id_(id) {
+ColumnSet::ColumnSet(int id) : id_(id), sizes_valid_(false) {
 }
 
 ColumnSet::~ColumnSet() {
@@ -423,6 +479,7 @@ void ColumnSet::AddColumn(GridLayout::Alignment h_align,
                               fixed_width, min_width, columns_.size(),
                               is_padding);
   columns_.push_back(column);
+  sizes_valid_ = false;
 }
 
 void ColumnSet::AddViewState(ViewState* view_state) {
@@ -432,6 +489,7 @@ void ColumnSet::AddViewState(ViewState* view_state) {
                                                     view_state,
                                                     CompareByColumnSpan);
   view_states_.insert(i, view_state);
+  sizes_valid_ = false;
 }
 
 void ColumnSet::CalculateMasterColumns() {
@@ -605,8 +663,15 @@ void ColumnSet::CalculateSize() {
   for (std::vector<ViewState*>::iterator i = view_states_.begin();
        i != view_states_.end(); ++i) {
     ViewState* view_state = *i;
+    if (!view_state->sizes_valid) {
+      view_state->view_pref = view_state->view->GetCachedPreferredSize();
+      view_state->view_baseline = view_state->v_align == GridLayout::BASELINE ?
+          view_state->view->GetBaseline() : -1;
+      view_state->has_height_for_width = false;
+      view_state->sizes_valid = true;
+    }
     if (!view_state->pref_width_fixed || !view_state->pref_height_fixed) {
-      pref = view_state->view->GetPreferredSize();
+      pref = view_state->view_pref;
       if (!view_state->pref_width_fixed)
         view_state->pref_width = pref.width();
       if (!view_state->pref_height_fixed)
@@ -616,6 +681,15 @@ void ColumnSet::CalculateSize() {
     view_state->remaining_height = pref.height();
   }
 
+  // The columns only need to be sized again if the width of one of the views
+  // may have changed.
+  if (sizes_valid_) {
+    DCHECK_EQ(columns_.size(), saved_sizes_.size());
+    for (size_t i = 0; i < columns_.size(); ++i)
+      columns_[i]->SetSize(saved_sizes_[i]);
+    return;
+  }
+
   // Let layout element reset the sizes for us.
   LayoutElement::ResetSizes(&columns_);
 
@@ -647,6 +721,11 @@ void ColumnSet::CalculateSize() {
     // This may need to be combined with previous step.
     UnifySameSizedColumnSizes();
   }
+
+  saved_sizes_.resize(columns_.size());
+  for (size_t i = 0; i < columns_.size(); ++i)
+    saved_sizes_[i] = columns_[i]->Size();
+  sizes_valid_ = true;
 }
 
 void ColumnSet::Resize(int delta) {
@@ -797,6 +876,20 @@ void GridLayout::ViewRemoved(View* host, View* view) {
   DCHECK(host_ == host);
 }
 
+void GridLayout::ViewInvalidated(View* host, View* view) {
+  DCHECK(host_ == host);
+  // Only the column set of the view is sized again. Its rows are if its
+  // height turns out to have changed.
+  for (std::vector<ViewState*>::iterator i = view_states_.begin();
+       i != view_states_.end(); ++i) {
+    ViewState* view_state = *i;
+    if (view_state->view == view) {
+      view_state->sizes_valid = false;
+      view_state->column_set->sizes_valid_ = false;
+    }
+  }
+}
+
 void GridLayout::Layout(View* host) {
   DCHECK(host_ == host);
   // SizeRowsAndColumns sets the size and location of each row/column, but
@@ -872,9 +965,6 @@ void GridLayout::SizeRowsAndColumns(bool layout, int width, int height,
     (*i)->ResetColumnXCoordinates();
   }
 
-  // Reset the height of each row.
-  LayoutElement::ResetSizes(&rows_);
-
   // Do the following:
   // . If the view is aligned along it's baseline, obtain the baseline from the
   //   view and update the rows ascent/descent.
@@ -887,7 +977,7 @@ void GridLayout::SizeRowsAndColumns(bool layout, int width, int height,
     view_state->remaining_height = view_state->pref_height;
 
     if (view_state->v_align == BASELINE)
-      view_state->baseline = view_state->view->GetBaseline();
+      view_state->baseline = view_state->view_baseline;
 
     if (view_state->h_align == FILL) {
       // The view is resizable. As the pref height may vary with the width,
@@ -899,11 +989,38 @@ void GridLayout::SizeRowsAndColumns(bool layout, int width, int height,
           !view_state->pref_height_fixed) {
         // The width this view will get differs from it's preferred. Some Views
         // pref height varies with it's width; ask for the preferred again.
-        view_state->pref_height =
-            view_state->view->GetHeightForWidth(actual_width);
+        if (!view_state->has_height_for_width ||
+            view_state->height_for_width_width != actual_width) {
+          view_state->height_for_width =
+              view_state->view->GetHeightForWidth(actual_width);
+          view_state->has_height_for_width = true;
+          view_state->height_for_width_width = actual_width;
+        }
+        view_state->pref_height = view_state->height_for_width;
         view_state->remaining_height = view_state->pref_height;
       }
     }
+
+    // A row is sized again when the height of one of its views changes.
+    if (view_state->row_span == 1 &&
+        (view_state->pref_height != view_state->row_height ||
+         view_state->baseline != view_state->row_baseline)) {
+      rows_[view_state->start_row]->InvalidateSize();
+      view_state->row_height = view_state->pref_height;
+      view_state->row_baseline = view_state->baseline;
+    }
+  }
+
+  // Reset the height of the rows that are sized again, and restore that of
+  // the others.
+  std::vector<Row*> rows_to_size;
+  for (std::vector<Row*>::iterator i = rows_.begin(); i != rows_.end(); ++i) {
+    if ((*i)->size_valid()) {
+      (*i)->RestoreSize();
+    } else {
+      (*i)->ResetSize();
+      rows_to_size.push_back(*i);
+    }
   }
 
   // Update the height/ascent/descent of each row from the views.
@@ -912,6 +1029,10 @@ void GridLayout::SizeRowsAndColumns(bool layout, int width, int height,
       (*view_states_iterator)->row_span == 1; ++view_states_iterator) {
     ViewState* view_state = *view_states_iterator;
     Row* row = rows_[view_state->start_row];
+    if (row->size_valid()) {
+      view_state->remaining_height = 0;
+      continue;
+    }
     row->AdjustSize(view_state->remaining_height);
     if (view_state->baseline != -1 &&
         view_state->baseline <= view_state->pref_height) {
@@ -920,6 +1041,10 @@ void GridLayout::SizeRowsAndColumns(bool layout, int width, int height,
     }
     view_state->remaining_height = 0;
   }
+  for (std::vector<Row*>::iterator i = rows_to_size.begin();
+       i != rows_to_size.end(); ++i) {
+    (*i)->SaveSize();
+  }
 
   // Distribute the height of each view with a row span > 1.
   for (; view_states_iterator != view_states_.end(); ++view_states_iterator) {
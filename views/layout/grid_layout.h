@@ -174,6 +174,11 @@ class VIEWS_EXPORT GridLayout : public LayoutManager {
   // Notification that a view has been removed.
   virtual void ViewRemoved(View* host, View* view);
 
+  // Notification that the preferred size of a view may have changed. The
+  // sizes of the views are kept between layouts until then, and only the
+  // columns and rows of the view are sized again.
+  virtual void ViewInvalidated(View* host, View* view);
+
   // Layouts out the components.
   virtual void Layout(View* host);
 
@@ -343,7 +348,8 @@ class VIEWS_EXPORT ColumnSet {
   void ResetColumnXCoordinates();
 
   // Calculate the preferred width of each view in this column set, as well
-  // as updating the remaining_width.
+  // as updating the remaining_width. The sizes of the columns are kept until
+  // a view is added, or the layout of one of the views is invalidated.
   void CalculateSize();
 
   // Distributes delta amoung the resizable columns.
@@ -363,6 +369,10 @@ class VIEWS_EXPORT ColumnSet {
   // for a description of what the master column is.
   std::vector<Column*> master_columns_;
 
+  // Whether |saved_sizes_| holds the sizes CalculateSize() gives the columns.
+  bool sizes_valid_;
+  std::vector<int> saved_sizes_;
+
   DISALLOW_COPY_AND_ASSIGN(ColumnSet);
 };
 
@@ -27,4 +27,7 @@ void LayoutManager::ViewAdded(View* host, View* view) {
 void LayoutManager::ViewRemoved(View* host, View* view) {
 }
 
+void LayoutManager::ViewInvalidated(View* host, View* view) {
+}
+
 }  // namespace views
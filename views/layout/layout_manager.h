@@ -54,6 +54,12 @@ class VIEWS_EXPORT LayoutManager {
 
   // Notification that a view has been removed.
   virtual void ViewRemoved(View* host, View* view);
+
+  // Notification that the layout of a view, or of one of its descendants, has
+  // been invalidated, which is how views signal that their preferred size may
+  // have changed. Layout managers that keep the sizes of the views between
+  // layouts must compute those of |view| again.
+  virtual void ViewInvalidated(View* host, View* view);
 };
 
 }  // namespace views
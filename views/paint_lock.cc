@@ -8,12 +8,14 @@
 
 namespace views {
 
-PaintLock::PaintLock(View* view) : view_(view) {
+PaintLock::PaintLock(View* view)
+    : view_(view),
+      was_enabled_(view->painting_enabled_) {
   view_->set_painting_enabled(false);
 }
 
 PaintLock::~PaintLock() {
-  view_->set_painting_enabled(true);
+  view_->set_painting_enabled(was_enabled_);
 }
 
 } // namespace views
@@ -17,7 +17,7 @@ class View;
 // (compositing is not disabled). When the class is destroyed, painting is
 // re-enabled. This can be useful during operations like animations, that are
 // sensitive to costly paints, and during which only composting, not painting,
-// is required.
+// is required. Locks nest, painting is only re-enabled by the outermost one.
 class VIEWS_EXPORT PaintLock {
  public:
   // The paint lock does not own the view. It is an error for the view to be
@@ -28,6 +28,9 @@ class VIEWS_EXPORT PaintLock {
  private:
   View* view_;
 
+  // Whether painting was enabled when the lock was taken.
+  bool was_enabled_;
+
   DISALLOW_COPY_AND_ASSIGN(PaintLock);
 };
 
@@ -5,6 +5,7 @@
 #include "views/painter.h"
 
 #include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
 #include "third_party/skia/include/core/SkBitmap.h"
 #include "third_party/skia/include/effects/SkGradientShader.h"
 #include "ui/base/resource/resource_bundle.h"
@@ -16,6 +17,10 @@ namespace views {
 
 namespace {
 
+// Sizes larger than this are painted directly by CachedPainter, rather than
+// keeping a bitmap of them.
+const int kMaxCachedPainterPixels = 512 * 512;
+
 class GradientPainter : public Painter {
  public:
   GradientPainter(bool horizontal, const SkColor& top, const SkColor& bottom)
@@ -140,6 +145,42 @@ class ImagePainter : public Painter {
   DISALLOW_COPY_AND_ASSIGN(ImagePainter);
 };
 
+class CachedPainter : public Painter {
+ public:
+  explicit CachedPainter(Painter* painter) : painter_(painter) {
+    DCHECK(painter);
+  }
+
+  virtual ~CachedPainter() {
+  }
+
+  virtual void Paint(int w, int h, gfx::Canvas* canvas) {
+    if (w <= 0 || h <= 0)
+      return;
+
+    if (bitmap_.width() != w || bitmap_.height() != h) {
+      if (w * h > kMaxCachedPainterPixels) {
+        bitmap_.reset();
+        painter_->Paint(w, h, canvas);
+        return;
+      }
+      gfx::CanvasSkia offscreen(w, h, false);
+      offscreen.drawColor(SK_ColorTRANSPARENT, SkXfermode::kClear_Mode);
+      painter_->Paint(w, h, &offscreen);
+      bitmap_ = offscreen.ExtractBitmap();
+    }
+    canvas->DrawBitmapInt(bitmap_, 0, 0);
+  }
+
+ private:
+  scoped_ptr<Painter> painter_;
+
+  // What |painter_| painted at the size of the bitmap.
+  SkBitmap bitmap_;
+
+  DISALLOW_COPY_AND_ASSIGN(CachedPainter);
+};
+
 }  // namespace
 
 // static
@@ -168,7 +209,12 @@ Painter* Painter::CreateVerticalGradient(SkColor c1, SkColor c2) {
 Painter* Painter::CreateImagePainter(const SkBitmap& image,
                                      const gfx::Insets& insets,
                                      bool paint_center) {
-  return new ImagePainter(image, insets, paint_center);
+  return CreateCachedPainter(new ImagePainter(image, insets, paint_center));
+}
+
+// static
+Painter* Painter::CreateCachedPainter(Painter* painter) {
+  return new CachedPainter(painter);
 }
 
 HorizontalPainter::HorizontalPainter(const int image_resource_names[]) {
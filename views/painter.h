@@ -36,12 +36,20 @@ class VIEWS_EXPORT Painter {
   // are rendered at the size specified in insets (for example, the upper
   // left corners is rendered at 0x0 with a size of
   // insets.left()xinsets.right()). The four edges are stretched to fill the
-  // destination size.
+  // destination size. The nine regions are composed into one bitmap, which is
+  // reused until the painter paints at another size.
   // Ownership is passed to the caller.
   static Painter* CreateImagePainter(const SkBitmap& image,
                                      const gfx::Insets& insets,
                                      bool paint_center);
 
+  // Creates a painter that paints |painter| into a bitmap the first time it
+  // paints at a size, and then paints that bitmap until the size changes.
+  // This suits painters that draw many pieces, painted often at one size.
+  // Takes ownership of |painter|; ownership of the result is passed to the
+  // caller.
+  static Painter* CreateCachedPainter(Painter* painter);
+
   virtual ~Painter() {}
 
   // Paints the painter in the specified region.
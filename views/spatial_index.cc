@@ -0,0 +1,154 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "views/spatial_index.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "base/logging.h"
+
+namespace {
+
+// Smaller cells would mostly list the same rects as their neighbors.
+const int kMinCellSize = 16;
+
+}  // namespace
+
+namespace views {
+
+namespace internal {
+
+SpatialIndex::SpatialIndex()
+    : cell_size_(kMinCellSize),
+      columns_(0),
+      rows_(0) {
+}
+
+SpatialIndex::~SpatialIndex() {
+}
+
+void SpatialIndex::Reset(const gfx::Rect& area,
+                         const std::vector<gfx::Rect>& rects) {
+  area_ = area;
+  cells_.clear();
+  columns_ = rows_ = 0;
+  if (area_.IsEmpty())
+    return;
+
+  double cell_area = static_cast<double>(area_.width()) * area_.height() /
+      std::max(rects.size(), static_cast<size_t>(1));
+  cell_size_ = std::max(static_cast<int>(sqrt(cell_area)), kMinCellSize);
+  columns_ = (area_.width() + cell_size_ - 1) / cell_size_;
+  rows_ = (area_.height() + cell_size_ - 1) / cell_size_;
+  cells_.resize(columns_ * rows_);
+
+  // Inserting in increasing order keeps the cells sorted.
+  for (size_t i = 0; i < rects.size(); ++i) {
+    int first_column, first_row, last_column, last_row;
+    if (!GetCellRange(rects[i], &first_column, &first_row, &last_column,
+                      &last_row)) {
+      continue;
+    }
+    for (int row = first_row; row <= last_row; ++row) {
+      for (int column = first_column; column <= last_column; ++column)
+        cells_[row * columns_ + column].push_back(static_cast<int>(i));
+    }
+  }
+}
+
+void SpatialIndex::Update(int index,
+                          const gfx::Rect& old_rect,
+                          const gfx::Rect& new_rect) {
+  if (old_rect == new_rect)
+    return;
+  Remove(index, old_rect);
+  Insert(index, new_rect);
+}
+
+bool SpatialIndex::Query(const gfx::Rect& rect,
+                         std::vector<int>* indices) const {
+  if (!area_.Contains(rect))
+    return false;
+
+  int first_column, first_row, last_column, last_row;
+  if (!GetCellRange(rect, &first_column, &first_row, &last_column,
+                    &last_row)) {
+    indices->clear();
+    return true;
+  }
+  int cell_count = (last_column - first_column + 1) *
+      (last_row - first_row + 1);
+  if (cell_count > static_cast<int>(cells_.size()) / 2)
+    return false;
+
+  indices->clear();
+  for (int row = first_row; row <= last_row; ++row) {
+    for (int column = first_column; column <= last_column; ++column) {
+      const Cell& cell = cells_[row * columns_ + column];
+      indices->insert(indices->end(), cell.begin(), cell.end());
+    }
+  }
+  if (cell_count > 1) {
+    std::sort(indices->begin(), indices->end());
+    indices->erase(std::unique(indices->begin(), indices->end()),
+                   indices->end());
+  }
+  return true;
+}
+
+bool SpatialIndex::QueryPoint(const gfx::Point& point,
+                              const std::vector<int>** indices) const {
+  if (!area_.Contains(point))
+    return false;
+  int column = (point.x() - area_.x()) / cell_size_;
+  int row = (point.y() - area_.y()) / cell_size_;
+  *indices = &cells_[row * columns_ + column];
+  return true;
+}
+
+bool SpatialIndex::GetCellRange(const gfx::Rect& rect,
+                                int* first_column, int* first_row,
+                                int* last_column, int* last_row) const {
+  gfx::Rect clipped = rect.Intersect(area_);
+  if (clipped.IsEmpty())
+    return false;
+  *first_column = (clipped.x() - area_.x()) / cell_size_;
+  *first_row = (clipped.y() - area_.y()) / cell_size_;
+  *last_column = (clipped.right() - 1 - area_.x()) / cell_size_;
+  *last_row = (clipped.bottom() - 1 - area_.y()) / cell_size_;
+  return true;
+}
+
+void SpatialIndex::Insert(int index, const gfx::Rect& rect) {
+  int first_column, first_row, last_column, last_row;
+  if (!GetCellRange(rect, &first_column, &first_row, &last_column, &last_row))
+    return;
+  for (int row = first_row; row <= last_row; ++row) {
+    for (int column = first_column; column <= last_column; ++column) {
+      Cell& cell = cells_[row * columns_ + column];
+      cell.insert(std::lower_bound(cell.begin(), cell.end(), index), index);
+    }
+  }
+}
+
+void SpatialIndex::Remove(int index, const gfx::Rect& rect) {
+  int first_column, first_row, last_column, last_row;
+  if (!GetCellRange(rect, &first_column, &first_row, &last_column, &last_row))
+    return;
+  for (int row = first_row; row <= last_row; ++row) {
+    for (int column = first_column; column <= last_column; ++column) {
+      Cell& cell = cells_[row * columns_ + column];
+      Cell::iterator i = std::lower_bound(cell.begin(), cell.end(), index);
+      DCHECK(i != cell.end() && *i == index);
+      if (i != cell.end() && *i == index)
+        cell.erase(i);
+    }
+  }
+}
+
+}  // namespace internal
+
+}  // namespace views
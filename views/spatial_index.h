@@ -0,0 +1,71 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef VIEWS_SPATIAL_INDEX_H_
+#define VIEWS_SPATIAL_INDEX_H_
+#pragma once
+
+#include <vector>
+
+#include "base/basictypes.h"
+#include "ui/gfx/rect.h"
+
+namespace views {
+
+// This is a views-internal API and should not be used externally. View uses
+// this class to find the children under a point or in a rect without looking
+// at all of them; see View::SetChildIndexEnabled().
+namespace internal {
+
+// A uniform grid over an area, each cell of which lists, in increasing order,
+// the indices of the rects that intersect it. The cells are sized so that
+// there are about as many cells as rects.
+class SpatialIndex {
+ public:
+  SpatialIndex();
+  ~SpatialIndex();
+
+  // Indexes |rects| within |area|. Rects, or the parts of them, outside of
+  // |area| are not indexed.
+  void Reset(const gfx::Rect& area, const std::vector<gfx::Rect>& rects);
+
+  // Moves the rect at |index| from |old_rect| to |new_rect|.
+  void Update(int index, const gfx::Rect& old_rect, const gfx::Rect& new_rect);
+
+  // Sets |indices| to the indices, in increasing order, of the rects that may
+  // intersect |rect|, which is a superset of those that do. Returns false,
+  // leaving |indices| unchanged, if |rect| is not within the area, or covers
+  // so much of it that looking at all of the rects is as fast.
+  bool Query(const gfx::Rect& rect, std::vector<int>* indices) const;
+
+  // Like Query(), for the rects that may contain |point|. The indices of the
+  // cell are only valid until the index changes.
+  bool QueryPoint(const gfx::Point& point,
+                  const std::vector<int>** indices) const;
+
+ private:
+  typedef std::vector<int> Cell;
+
+  // Sets the cells that |rect| intersects, returning false if none.
+  bool GetCellRange(const gfx::Rect& rect,
+                    int* first_column, int* first_row,
+                    int* last_column, int* last_row) const;
+
+  void Insert(int index, const gfx::Rect& rect);
+  void Remove(int index, const gfx::Rect& rect);
+
+  gfx::Rect area_;
+  int cell_size_;
+  int columns_;
+  int rows_;
+  std::vector<Cell> cells_;
+
+  DISALLOW_COPY_AND_ASSIGN(SpatialIndex);
+};
+
+}  // namespace internal
+
+}  // namespace views
+
+#endif  // VIEWS_SPATIAL_INDEX_H_
@@ -64,6 +64,22 @@ bool GestureManager::ProcessTouchEventForGesture(const TouchEvent& event,
   return true;
 }
 
+bool GestureManager::ProcessTouchFrameForGesture(const TouchFrame& events,
+                                                 View* source) {
+  bool fired = false;
+  for (size_t i = 0; i < events.size(); ++i) {
+    if (events[i]->type() == ui::ET_TOUCH_MOVED && i + 1 < events.size() &&
+        events[i + 1]->type() == ui::ET_TOUCH_MOVED) {
+      continue;
+    }
+    if (ProcessTouchEventForGesture(*events[i], source,
+                                    ui::TOUCH_STATUS_UNKNOWN)) {
+      fired = true;
+    }
+  }
+  return fired;
+}
+
 GestureManager::GestureManager() {
 }
 
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "base/memory/singleton.h"
+#include "views/events/event.h"
 #include "views/view.h"
 
 namespace ui {
@@ -39,6 +40,15 @@ class VIEWS_EXPORT GestureManager {
                                            View* source,
                                            ui::TouchStatus status);
 
+  // Invoked once per touch frame with the frame's events that no view
+  // handled, in order. The default passes them to
+  // ProcessTouchEventForGesture(), except for moves followed by another move:
+  // the synthetic mouse follows one point, so only its last position in the
+  // frame matters.
+  // Returns true if any of the events resulted in firing a synthetic event.
+  virtual bool ProcessTouchFrameForGesture(const TouchFrame& events,
+                                           View* source);
+
   // TODO(rjkroege): Write the remainder of this class.
   // It will appear in a subsequent CL.
 
@@ -12,6 +12,7 @@
 #include "base/message_loop.h"
 #include "base/stringprintf.h"
 #include "base/utf_string_conversions.h"
+#include "third_party/skia/include/core/SkPicture.h"
 #include "third_party/skia/include/core/SkRect.h"
 #include "ui/base/accessibility/accessibility_types.h"
 #include "ui/base/dragdrop/drag_drop_types.h"
@@ -21,12 +22,16 @@
 #include "ui/gfx/interpolated_transform.h"
 #include "ui/gfx/path.h"
 #include "ui/gfx/point3.h"
+#include "ui/gfx/recording_canvas.h"
 #include "ui/gfx/transform.h"
 #include "views/background.h"
 #include "views/context_menu_controller.h"
 #include "views/drag_controller.h"
+#include "views/focus/focus_search.h"
 #include "views/layer_property_setter.h"
 #include "views/layout/layout_manager.h"
+#include "views/spatial_index.h"
+#include "views/view_profiler.h"
 #include "views/views_delegate.h"
 #include "views/widget/native_widget_private.h"
 #include "views/widget/native_widget_views.h"
@@ -76,6 +81,26 @@ class ScopedCanvas {
   DISALLOW_COPY_AND_ASSIGN(ScopedCanvas);
 };
 
+// The number of View::ScopedLayoutPass alive, and the id of the outermost,
+// counted from 1.
+int layout_pass_depth = 0;
+int layout_pass_id = 0;
+
+// Returns in |clip| the bounds of the clip of |canvas|, rounded out, or false
+// if |canvas| isn't a gfx::CanvasSkia.
+bool GetClipBounds(gfx::Canvas* canvas, gfx::Rect* clip) {
+  gfx::CanvasSkia* canvas_skia = canvas->AsCanvasSkia();
+  SkRect clip_bounds;
+  if (!canvas_skia ||
+      !canvas_skia->getClipBounds(&clip_bounds, SkCanvas::kBW_EdgeType))
+    return false;
+  SkIRect clip_int;
+  clip_bounds.roundOut(&clip_int);
+  *clip = gfx::Rect(clip_int.fLeft, clip_int.fTop, clip_int.width(),
+                    clip_int.height());
+  return true;
+}
+
 }  // namespace
 
 namespace views {
@@ -108,10 +133,18 @@ View::View()
       visible_(true),
       enabled_(true),
       painting_enabled_(true),
+      paint_cache_enabled_(false),
+      paint_cache_valid_(false),
+      paint_recording_enabled_(false),
+      paint_recording_(NULL),
+      paint_recording_valid_(false),
+      paint_recording_op_count_(0),
+      child_index_valid_(false),
       registered_for_visible_bounds_notification_(false),
       clip_x_(0.0),
       clip_y_(0.0),
       needs_layout_(true),
+      cached_preferred_size_pass_(0),
       flip_canvas_on_paint_for_rtl_ui_(false),
       accelerator_registration_delayed_(false),
       accelerator_focus_manager_(NULL),
@@ -138,6 +171,10 @@ View::~View() {
   if (native_view_accessibility_win_.get())
     native_view_accessibility_win_->set_view(NULL);
 #endif
+
+  ResetPaintRecording();
+  if (ViewProfiler::IsEnabled())
+    ViewProfiler::OnViewDestroyed(this);
 }
 
 // Tree operations -------------------------------------------------------------
@@ -169,6 +206,7 @@ void View::AddChildViewAt(View* view, int index) {
   // Let's insert the view.
   view->parent_ = this;
   children_.insert(children_.begin() + index, view);
+  InvalidateChildIndex();
 
   if (GetWidget()) {
     // Sending out notification of insert may result in adding other views.
@@ -214,6 +252,7 @@ void View::ReorderChildView(View* view, int index) {
   // Add it in the specified index now.
   InitFocusSiblings(view, index);
   children_.insert(children_.begin() + index, view);
+  InvalidateChildIndex();
 }
 
 void View::RemoveChildView(View* view) {
@@ -249,6 +288,7 @@ void View::SetBoundsRect(const gfx::Rect& bounds) {
   if (bounds == bounds_) {
     if (needs_layout_) {
       needs_layout_ = false;
+      ViewProfiler::ScopedTimer timer(this, ViewProfiler::PHASE_LAYOUT);
       Layout();
       SchedulePaint();
     }
@@ -348,12 +388,29 @@ gfx::Size View::GetPreferredSize() {
   return gfx::Size();
 }
 
+gfx::Size View::GetCachedPreferredSize() {
+  if (!layout_pass_depth) {
+    ViewProfiler::ScopedTimer timer(this, ViewProfiler::PHASE_PREFERRED_SIZE);
+    return GetPreferredSize();
+  }
+  if (cached_preferred_size_pass_ != layout_pass_id) {
+    ViewProfiler::ScopedTimer timer(this, ViewProfiler::PHASE_PREFERRED_SIZE);
+    cached_preferred_size_ = GetPreferredSize();
+    cached_preferred_size_pass_ = layout_pass_id;
+  }
+  return cached_preferred_size_;
+}
+
 int View::GetBaseline() const {
   return -1;
 }
 
 void View::SizeToPreferredSize() {
-  gfx::Size prefsize = GetPreferredSize();
+  gfx::Size prefsize;
+  {
+    ViewProfiler::ScopedTimer timer(this, ViewProfiler::PHASE_PREFERRED_SIZE);
+    prefsize = GetPreferredSize();
+  }
   if ((prefsize.width() != width()) || (prefsize.height() != height()))
     SetBounds(x(), y(), prefsize.width(), prefsize.height());
 }
@@ -376,14 +433,24 @@ void View::SetVisible(bool visible) {
 
     visible_ = visible;
 
-    if (visible_)
+    // Which children are visible changes the preferred size of the ancestors.
+    for (View* v = parent_; v; v = v->parent_)
+      v->cached_preferred_size_pass_ = 0;
+
+    if (visible_) {
       CreateLayerIfNecessary();
-    else
+    } else {
       // Destroy layer if the View is invisible as invisible Views never paint.
       DestroyLayerRecurse();
+      paint_cache_.reset();
+      ResetPaintRecording();
+    }
 
     // This notifies all sub-views recursively.
     PropagateVisibilityNotifications(this, visible_);
+    FocusSearch::InvalidateFocusOrders();
+    if (parent_)
+      parent_->ChildVisibilityChanged(this);
 
     // If we are newly visible, schedule paint.
     if (visible_)
@@ -402,6 +469,7 @@ bool View::IsVisibleInRootView() const {
 void View::SetEnabled(bool enabled) {
   if (enabled != enabled_) {
     enabled_ = enabled;
+    FocusSearch::InvalidateFocusOrders();
     OnEnabledChanged();
   }
 }
@@ -422,6 +490,9 @@ const ui::Transform& View::GetTransform() const {
 }
 
 void View::SetTransform(const ui::Transform& transform) {
+  if (parent_)
+    parent_->InvalidateChildIndex();
+
   if (!transform.HasChange()) {
     if (!layer_helper_.get() || !this->transform())
       return;
@@ -472,6 +543,20 @@ void View::SetPaintToLayer(bool value) {
   }
 }
 
+void View::SetLayerMasksToBounds(bool masks_to_bounds) {
+  if (!layer_helper_.get())
+    layer_helper_.reset(new internal::LayerHelper());
+  layer_helper_->set_masks_to_bounds(masks_to_bounds);
+  if (layer())
+    layer()->SetMasksToBounds(masks_to_bounds);
+}
+
+void View::SetLayerTiled(bool tiled) {
+  if (!layer_helper_.get())
+    layer_helper_.reset(new internal::LayerHelper());
+  layer_helper_->set_tiled(tiled);
+}
+
 void View::SetLayerPropertySetter(LayerPropertySetter* setter) {
   if ((layer_helper_.get() && layer_helper_->property_setter() == setter) ||
       (!layer_helper_.get() && setter == NULL)) {
@@ -532,6 +617,7 @@ void View::Layout() {
     View* child = child_at(i);
     if (child->needs_layout_ || !layout_manager_.get()) {
       child->needs_layout_ = false;
+      ViewProfiler::ScopedTimer timer(child, ViewProfiler::PHASE_LAYOUT);
       child->Layout();
     }
   }
@@ -541,8 +627,26 @@ void View::InvalidateLayout() {
   // Always invalidate up. This is needed to handle the case of us already being
   // valid, but not our parent.
   needs_layout_ = true;
-  if (parent_)
+  cached_preferred_size_pass_ = 0;
+  if (parent_) {
+    if (parent_->layout_manager_.get())
+      parent_->layout_manager_->ViewInvalidated(parent_, this);
     parent_->InvalidateLayout();
+  } else {
+    Widget* widget = GetWidget();
+    if (widget)
+      widget->ScheduleLayout();
+  }
+}
+
+View::ScopedLayoutPass::ScopedLayoutPass() {
+  if (layout_pass_depth++ == 0)
+    ++layout_pass_id;
+}
+
+View::ScopedLayoutPass::~ScopedLayoutPass() {
+  DCHECK_GT(layout_pass_depth, 0);
+  --layout_pass_depth;
 }
 
 LayoutManager* View::GetLayoutManager() const {
@@ -592,6 +696,7 @@ void View::SetGroup(int gid) {
   // Don't change the group id once it's set.
   DCHECK(group_ == -1 || group_ == gid);
   group_ = gid;
+  FocusSearch::InvalidateFocusOrders();
 }
 
 int View::GetGroup() const {
@@ -677,6 +782,12 @@ void View::SchedulePaint() {
 }
 
 void View::SchedulePaintInRect(const gfx::Rect& rect) {
+  // The children schedule their painting through their parent, which clears
+  // the paint cache of all their ancestors, and their accessible state, which
+  // may be made of that of their children.
+  paint_cache_valid_ = false;
+  paint_recording_valid_ = false;
+  InvalidateAccessibleState();
   if (!IsVisible() || !painting_enabled_)
     return;
 
@@ -701,6 +812,10 @@ void View::Paint(gfx::Canvas* canvas) {
   // Note that the X (or left) position we pass to ClipRectInt takes into
   // consideration whether or not the view uses a right-to-left layout so that
   // we paint our view in its mirrored position if need be.
+  //
+  // The clip of the canvas may be the several rectangles of the damage region
+  // of the widget (see gfx::DamageRegion), in which case the View and its
+  // children are skipped unless their bounds intersect one of them.
   if (!canvas->ClipRectInt(GetMirroredX(), y(),
                            width() - static_cast<int>(clip_x_),
                            height() - static_cast<int>(clip_y_))) {
@@ -713,7 +828,59 @@ void View::Paint(gfx::Canvas* canvas) {
   if (transform())
     canvas->Transform(*transform());
 
-  PaintCommon(canvas);
+  if (paint_recording_enabled_)
+    PaintFromRecording(canvas);
+  else if (paint_cache_enabled_)
+    PaintFromCache(canvas);
+  else
+    PaintCommon(canvas);
+}
+
+void View::SetPaintCacheEnabled(bool enabled) {
+  paint_cache_enabled_ = enabled;
+  paint_cache_.reset();
+  paint_cache_valid_ = false;
+}
+
+void View::SetPaintRecordingEnabled(bool enabled) {
+  paint_recording_enabled_ = enabled;
+  ResetPaintRecording();
+}
+
+SkPicture* View::GetPaintRecording() {
+  if (!paint_recording_enabled_ || !IsVisible() || !painting_enabled_ ||
+      width() <= 0 || height() <= 0) {
+    return NULL;
+  }
+
+  if (paint_recording_ && (paint_recording_->width() != width() ||
+                           paint_recording_->height() != height())) {
+    paint_recording_valid_ = false;
+  }
+  if (paint_recording_valid_)
+    return paint_recording_;
+
+  // A new picture is recorded rather than the old one recorded over, since
+  // the recordings of the ancestors may still hold it.
+  ResetPaintRecording();
+  SkPicture* picture = new SkPicture;
+  bool recorded_all;
+  {
+    gfx::RecordingCanvas canvas(picture, width(), height());
+    PaintCommon(&canvas);
+    recorded_all = canvas.recorded_all();
+    paint_recording_op_count_ = canvas.op_count();
+  }
+  if (!recorded_all) {
+    DVLOG(1) << "Can't record the painting of " << GetClassName();
+    picture->unref();
+    paint_recording_enabled_ = false;
+    paint_recording_op_count_ = 0;
+    return NULL;
+  }
+  paint_recording_ = picture;
+  paint_recording_valid_ = true;
+  return paint_recording_;
 }
 
 ThemeProvider* View::GetThemeProvider() const {
@@ -736,6 +903,24 @@ bool View::get_use_acceleration_when_possible() {
 // Input -----------------------------------------------------------------------
 
 View* View::GetEventHandlerForPoint(const gfx::Point& point) {
+  // Only the children indexed under the point may contain it.
+  const internal::SpatialIndex* child_index = GetChildIndex();
+  const std::vector<int>* candidates = NULL;
+  if (child_index && child_index->QueryPoint(point, &candidates)) {
+    for (std::vector<int>::const_reverse_iterator i = candidates->rbegin();
+         i != candidates->rend(); ++i) {
+      View* child = child_at(*i);
+      if (!child->IsVisible())
+        continue;
+
+      gfx::Point point_in_child_coords(point);
+      View::ConvertPointToView(this, child, &point_in_child_coords);
+      if (child->HitTest(point_in_child_coords))
+        return child->GetEventHandlerForPoint(point_in_child_coords);
+    }
+    return this;
+  }
+
   // Walk the child Views recursively looking for the View that most
   // tightly encloses the specified point.
   for (int i = child_count() - 1; i >= 0; --i) {
@@ -751,6 +936,13 @@ View* View::GetEventHandlerForPoint(const gfx::Point& point) {
   return this;
 }
 
+void View::SetChildIndexEnabled(bool enabled) {
+  if (enabled == child_index_enabled())
+    return;
+  child_index_.reset(enabled ? new internal::SpatialIndex() : NULL);
+  child_index_valid_ = false;
+}
+
 gfx::NativeCursor View::GetCursor(const MouseEvent& event) {
 #if defined(OS_WIN)
   static HCURSOR arrow = LoadCursor(NULL, IDC_ARROW);
@@ -910,6 +1102,21 @@ View* View::GetPreviousFocusableView() {
 void View::SetNextFocusableView(View* view) {
   view->previous_focusable_view_ = this;
   next_focusable_view_ = view;
+  FocusSearch::InvalidateFocusOrders();
+}
+
+void View::set_focusable(bool focusable) {
+  if (focusable != focusable_) {
+    focusable_ = focusable;
+    FocusSearch::InvalidateFocusOrders();
+  }
+}
+
+void View::set_accessibility_focusable(bool accessibility_focusable) {
+  if (accessibility_focusable != accessibility_focusable_) {
+    accessibility_focusable_ = accessibility_focusable;
+    FocusSearch::InvalidateFocusOrders();
+  }
 }
 
 bool View::IsFocusableInRootView() const {
@@ -1003,6 +1210,15 @@ bool View::ExceededDragThreshold(int delta_x, int delta_y) {
           abs(delta_y) > GetVerticalDragThreshold());
 }
 
+// Accessibility ---------------------------------------------------------------
+
+void View::InvalidateAccessibleState() {
+#if defined(OS_WIN)
+  if (native_view_accessibility_win_.get())
+    native_view_accessibility_win_->InvalidateState();
+#endif
+}
+
 // Scrolling -------------------------------------------------------------------
 
 void View::ScrollRectToVisible(const gfx::Rect& rect) {
@@ -1075,8 +1291,23 @@ void View::NativeViewHierarchyChanged(bool attached,
 // Painting --------------------------------------------------------------------
 
 void View::PaintChildren(gfx::Canvas* canvas) {
-  for (int i = 0, count = child_count(); i < count; ++i)
-    child_at(i)->Paint(canvas);
+  // Only the children indexed in the clip may intersect it.
+  const internal::SpatialIndex* child_index = GetChildIndex();
+  gfx::Rect clip;
+  std::vector<int> candidates;
+  if (child_index && GetClipBounds(canvas, &clip) &&
+      child_index->Query(clip, &candidates)) {
+    for (size_t i = 0; i < candidates.size(); ++i)
+      child_at(candidates[i])->Paint(canvas);
+    return;
+  }
+
+  std::vector<bool> hidden;
+  int first = std::max(FindHiddenChildren(canvas, &hidden), 0);
+  for (int i = first, count = child_count(); i < count; ++i) {
+    if (hidden.empty() || !hidden[i])
+      child_at(i)->Paint(canvas);
+  }
 }
 
 void View::OnPaint(gfx::Canvas* canvas) {
@@ -1107,11 +1338,17 @@ void View::SetFillsBoundsOpaquely(bool fills_bounds_opaquely) {
     layer_helper_.reset(new internal::LayerHelper());
 
   layer_helper_->set_fills_bounds_opaquely(fills_bounds_opaquely);
+  // The cache is created as opaque or not.
+  paint_cache_.reset();
 
   if (layer())
     layer()->SetFillsBoundsOpaquely(fills_bounds_opaquely);
 }
 
+bool View::FillsBoundsOpaquely() const {
+  return layer_helper_.get() && layer_helper_->fills_bounds_opaquely();
+}
+
 bool View::SetExternalTexture(ui::Texture* texture) {
   DCHECK(texture);
   if (!layer_helper_.get())
@@ -1196,7 +1433,10 @@ void View::UpdateLayerBounds(const gfx::Point& offset) {
 
 void View::OnPaintLayer(gfx::Canvas* canvas) {
   canvas->AsCanvasSkia()->drawColor(SK_ColorBLACK, SkXfermode::kClear_Mode);
-  PaintCommon(canvas);
+  if (paint_recording_enabled_)
+    PaintFromRecording(canvas);
+  else
+    PaintCommon(canvas);
 }
 
 // Input -----------------------------------------------------------------------
@@ -1444,7 +1684,8 @@ void View::PaintCommon(gfx::Canvas* canvas) {
   if (!IsVisible() || !painting_enabled_)
     return;
 
-  {
+  // A child covering all of the clip hides what the View paints.
+  if (FindHiddenChildren(canvas, NULL) < 0) {
     // If the View we are about to paint requested the canvas to be flipped, we
     // should change the transform appropriately.
     // The canvas mirroring is undone once the View is done painting so that we
@@ -1456,12 +1697,145 @@ void View::PaintCommon(gfx::Canvas* canvas) {
       canvas->ScaleInt(-1, 1);
     }
 
+    ViewProfiler::ScopedTimer timer(this, ViewProfiler::PHASE_PAINT);
     OnPaint(canvas);
   }
 
+  ViewProfiler::ScopedTimer timer(this, ViewProfiler::PHASE_PAINT_CHILDREN);
   PaintChildren(canvas);
 }
 
+void View::PaintFromCache(gfx::Canvas* canvas) {
+  if (!IsVisible() || !painting_enabled_ || width() <= 0 || height() <= 0)
+    return;
+
+  bool is_opaque = FillsBoundsOpaquely();
+  if (paint_cache_.get()) {
+    const SkBitmap& cached = paint_cache_->getDevice()->accessBitmap(false);
+    if (cached.width() != width() || cached.height() != height())
+      paint_cache_.reset();
+  }
+  if (!paint_cache_.get()) {
+    paint_cache_.reset(new gfx::CanvasSkia(width(), height(), is_opaque));
+    paint_cache_valid_ = false;
+  }
+
+  if (!paint_cache_valid_) {
+    if (!is_opaque)
+      paint_cache_->drawColor(SK_ColorBLACK, SkXfermode::kClear_Mode);
+    PaintCommon(paint_cache_.get());
+    paint_cache_valid_ = true;
+  }
+  canvas->DrawBitmapInt(paint_cache_->getDevice()->accessBitmap(false), 0, 0);
+}
+
+void View::PaintFromRecording(gfx::Canvas* canvas) {
+  SkPicture* recording = GetPaintRecording();
+  if (recording)
+    canvas->AsCanvasSkia()->drawPicture(*recording);
+  else
+    PaintCommon(canvas);
+}
+
+void View::ResetPaintRecording() {
+  if (paint_recording_)
+    paint_recording_->unref();
+  paint_recording_ = NULL;
+  paint_recording_valid_ = false;
+}
+
+bool View::GetOpaqueBoundsInParent(gfx::Rect* bounds) const {
+  // A layer is composited separately, and a transform moves the pixels out of
+  // the bounds.
+  if (!IsVisible() || !painting_enabled_ || !FillsBoundsOpaquely() ||
+      layer() || transform()) {
+    return false;
+  }
+  *bounds = gfx::Rect(GetMirroredX(), y(),
+                      width() - static_cast<int>(clip_x_),
+                      height() - static_cast<int>(clip_y_));
+  return !bounds->IsEmpty();
+}
+
+int View::FindHiddenChildren(gfx::Canvas* canvas,
+                             std::vector<bool>* hidden) const {
+  // The number of opaque children that are checked against the children
+  // below them, which keeps this linear in the number of children.
+  const size_t kMaxOccluders = 4;
+
+  // Looking at every child would defeat the child index.
+  gfx::Rect clip;
+  if (child_index_.get() || !GetClipBounds(canvas, &clip))
+    return -1;
+
+  std::vector<gfx::Rect> occluders;
+  for (int i = child_count() - 1; i >= 0; --i) {
+    const View* child = child_at(i);
+    if (hidden && !occluders.empty() && !child->layer() &&
+        !child->transform()) {
+      gfx::Rect visible_bounds = child->GetMirroredBounds().Intersect(clip);
+      for (size_t j = 0; j < occluders.size(); ++j) {
+        if (occluders[j].Contains(visible_bounds)) {
+          if (hidden->empty())
+            hidden->resize(child_count(), false);
+          (*hidden)[i] = true;
+          break;
+        }
+      }
+    }
+
+    gfx::Rect opaque_bounds;
+    if (child->GetOpaqueBoundsInParent(&opaque_bounds)) {
+      if (opaque_bounds.Contains(clip))
+        return i;
+      if (occluders.size() < kMaxOccluders)
+        occluders.push_back(opaque_bounds);
+    }
+  }
+  return -1;
+}
+
+// Child index -----------------------------------------------------------------
+
+const internal::SpatialIndex* View::GetChildIndex() {
+  if (!child_index_.get())
+    return NULL;
+  if (!child_index_valid_) {
+    std::vector<gfx::Rect> rects;
+    rects.reserve(children_.size());
+    for (int i = 0, count = child_count(); i < count; ++i) {
+      const View* child = child_at(i);
+      rects.push_back(GetChildIndexRect(child, child->bounds()));
+    }
+    child_index_->Reset(GetLocalBounds(), rects);
+    child_index_valid_ = true;
+  }
+  return child_index_.get();
+}
+
+gfx::Rect View::GetChildIndexRect(const View* child,
+                                  const gfx::Rect& bounds) const {
+  // A transformed child may be anywhere.
+  if (child->transform())
+    return GetLocalBounds();
+  return gfx::Rect(GetMirroredXForRect(bounds), bounds.y(), bounds.width(),
+                   bounds.height());
+}
+
+void View::InvalidateChildIndex() {
+  child_index_valid_ = false;
+}
+
+void View::UpdateChildIndex(const View* child,
+                            const gfx::Rect& previous_bounds) {
+  if (!child_index_.get() || !child_index_valid_)
+    return;
+  int index = GetIndexOf(child);
+  DCHECK_GE(index, 0);
+  child_index_->Update(index, GetChildIndexRect(child, previous_bounds),
+                       GetChildIndexRect(child, child->bounds()));
+}
+
 // Tree operations -------------------------------------------------------------
 
 void View::DoRemoveChildView(View* view,
@@ -1492,6 +1866,7 @@ void View::DoRemoveChildView(View* view,
       view_to_be_deleted.reset(view);
 
     children_.erase(i);
+    InvalidateChildIndex();
   }
 
   if (update_tool_tip)
@@ -1546,8 +1921,11 @@ void View::ViewHierarchyChangedImpl(bool register_accelerators,
     }
   }
 
+  FocusSearch::InvalidateFocusOrders();
   ViewHierarchyChanged(is_add, parent, child);
   parent->needs_layout_ = true;
+  for (View* v = parent; v; v = v->parent_)
+    v->cached_preferred_size_pass_ = 0;
 }
 
 // Size and disposition --------------------------------------------------------
@@ -1567,6 +1945,12 @@ void View::VisibilityChangedImpl(View* starting_from, bool is_visible) {
 }
 
 void View::BoundsChanged(const gfx::Rect& previous_bounds) {
+  if (parent_)
+    parent_->UpdateChildIndex(this, previous_bounds);
+  // The children are indexed in the local bounds, and mirrored in them.
+  if (previous_bounds.size() != size())
+    InvalidateChildIndex();
+
   if (IsVisible()) {
     // Paint the new bounds.
     SchedulePaintBoundsChanged(
@@ -1607,6 +1991,7 @@ void View::BoundsChanged(const gfx::Rect& previous_bounds) {
 
   if (previous_bounds.size() != size()) {
     needs_layout_ = false;
+    ViewProfiler::ScopedTimer timer(this, ViewProfiler::PHASE_LAYOUT);
     Layout();
   }
 
@@ -1785,9 +2170,12 @@ void View::CreateLayer() {
 
   DCHECK(layer_parent || parent_ == NULL);
 
-  layer_helper_->SetLayer(new ui::Layer(compositor));
+  layer_helper_->SetLayer(new ui::Layer(
+      compositor, layer_helper_->tiled() ? ui::Layer::LAYER_HAS_TILED_TEXTURE :
+                                           ui::Layer::LAYER_HAS_TEXTURE));
   layer()->set_delegate(this);
   layer()->SetFillsBoundsOpaquely(layer_helper_->fills_bounds_opaquely());
+  layer()->SetMasksToBounds(layer_helper_->masks_to_bounds());
   layer()->SetBounds(gfx::Rect(offset.x(), offset.y(), width(), height()));
   layer()->SetTransform(GetTransform());
   if (layer_parent)
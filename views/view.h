@@ -27,8 +27,11 @@
 
 using ui::OSExchangeData;
 
+class SkPicture;
+
 namespace gfx {
 class Canvas;
+class CanvasSkia;
 class Insets;
 class Path;
 }
@@ -65,6 +68,7 @@ class Widget;
 namespace internal {
 class NativeWidgetView;
 class RootView;
+class SpatialIndex;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -224,6 +228,12 @@ class VIEWS_EXPORT View : public ui::LayerDelegate,
   // Get the size the View would like to be, if enough space were available.
   virtual gfx::Size GetPreferredSize();
 
+  // Returns GetPreferredSize(), which during a ScopedLayoutPass is computed
+  // only once unless the View's layout is invalidated in between. Layout
+  // managers use it to size the children, so that laying out a hierarchy
+  // doesn't compute the preferred size of the same views over and over.
+  gfx::Size GetCachedPreferredSize();
+
   // Convenience method that sizes this view to its preferred size.
   void SizeToPreferredSize();
 
@@ -258,8 +268,11 @@ class VIEWS_EXPORT View : public ui::LayerDelegate,
   // This indicates that the view completely fills its bounds in an opaque
   // color.
   // This doesn't affect compositing but is a hint to the compositor to optimize
-  // painting.
+  // painting. Without a layer, the siblings below the view that it covers, and
+  // the background of its parent, are not painted where it covers all of the
+  // area being painted.
   void SetFillsBoundsOpaquely(bool fills_bounds_opaquely);
+  bool FillsBoundsOpaquely() const;
 
   // Transformations -----------------------------------------------------------
 
@@ -286,6 +299,17 @@ class VIEWS_EXPORT View : public ui::LayerDelegate,
   // Compositor.
   void SetPaintToLayer(bool value);
 
+  // Sets whether the layer clips the layers of the descendants to the bounds
+  // of the view, as views clip their children, so that a descendant layer
+  // can be moved under it without being drawn outside.
+  void SetLayerMasksToBounds(bool masks_to_bounds);
+
+  // Sets whether the layer has a tiled texture, which paints the tiles in
+  // view first, and the others over the next commits, for the views larger
+  // than a texture can be, or that scroll under a layer that masks them.
+  // Applies to the layer created next.
+  void SetLayerTiled(bool tiled);
+
   // Sets the LayerPropertySetter for this view. A value of NULL resets the
   // LayerPropertySetter to the default (immediate).
   void SetLayerPropertySetter(LayerPropertySetter* setter);
@@ -352,9 +376,23 @@ class VIEWS_EXPORT View : public ui::LayerDelegate,
   // TODO(beng): I think we should remove this.
   // Mark this view and all parents to require a relayout. This ensures the
   // next call to Layout() will propagate to this view, even if the bounds of
-  // parent views do not change.
+  // parent views do not change. If the View is in a Widget, the Widget lays
+  // out its RootView before it paints next, once for all the invalidations
+  // since; see Widget::ScheduleLayout().
   void InvalidateLayout();
 
+  // Groups the Layout() calls made during its lifetime into one layout pass,
+  // during which GetCachedPreferredSize() keeps the preferred sizes it
+  // computes. Passes may be nested, in which case the outermost one counts.
+  class VIEWS_EXPORT ScopedLayoutPass {
+   public:
+    ScopedLayoutPass();
+    ~ScopedLayoutPass();
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(ScopedLayoutPass);
+  };
+
   // Gets/Sets the Layout Manager used by this view to size and place its
   // children.
   // The LayoutManager is owned by the View and is deleted when the view is
@@ -465,6 +503,39 @@ class VIEWS_EXPORT View : public ui::LayerDelegate,
   // the hierarchy beneath it.
   virtual void Paint(gfx::Canvas* canvas);
 
+  // Caches what the View and its children paint in a bitmap that Paint()
+  // draws from then on, until SchedulePaint() is called on the View or one of
+  // its children. Meant for views that rarely change, whose painting is
+  // costly, such as toolbars and dialogs, which are then not painted again
+  // when a sibling changes. The cache takes width() * height() * 4 bytes. Its
+  // pixels are not opaque unless the View fills its bounds opaquely, which
+  // keeps text from being painted with ClearType.
+  void SetPaintCacheEnabled(bool enabled);
+  bool paint_cache_enabled() const { return paint_cache_enabled_; }
+
+  // Records what the View and its children paint in an SkPicture that Paint()
+  // and the layer of the View draw from then on, until SchedulePaint() is
+  // called on the View or one of its children. Unlike the paint cache, the
+  // recording has no pixels of its own, and can be drawn at any scale. Text
+  // is recorded antialiased in grayscale, without ClearType. A View that
+  // paints with platform calls, which can't be recorded, is painted directly
+  // once it is found to, and recording is turned off. The views that paint
+  // through NativeTheme must not be recorded, since they would paint nothing.
+  // Takes precedence over the paint cache.
+  void SetPaintRecordingEnabled(bool enabled);
+  bool paint_recording_enabled() const { return paint_recording_enabled_; }
+
+  // Returns what the View and its children paint, recorded now if it wasn't
+  // since the last SchedulePaint(), such as to draw a thumbnail of it without
+  // painting the views again. Returns NULL if recording isn't enabled or the
+  // View paints nothing. The picture is owned by the View, and must be ref()ed
+  // to be kept past the next SchedulePaint().
+  SkPicture* GetPaintRecording();
+
+  // The number of drawing calls in the recording of GetPaintRecording(), in
+  // which a child drawn from its own recording counts as one.
+  int paint_recording_op_count() const { return paint_recording_op_count_; }
+
   // The background object is owned by this object and may be NULL.
   void set_background(Background* b) { background_.reset(b); }
   const Background* background() const { return background_.get(); }
@@ -519,6 +590,17 @@ class VIEWS_EXPORT View : public ui::LayerDelegate,
   // Returns the deepest visible descendant that contains the specified point.
   virtual View* GetEventHandlerForPoint(const gfx::Point& point);
 
+  // Indexes the bounds of the children in a grid, so that hit testing and
+  // painting only look at the children near the point or in the clip, rather
+  // than at all of them. Meant for views with hundreds of children or more,
+  // such as large icon grids. The index is kept up to date as the children
+  // are moved, and rebuilt when children are added, removed or reordered, or
+  // when the View is resized. Children are found by their bounds, or anywhere
+  // in the View if they are transformed, so those with a HitTest() that goes
+  // beyond their bounds are not found there.
+  void SetChildIndexEnabled(bool enabled);
+  bool child_index_enabled() const { return child_index_.get() != NULL; }
+
   // Return the cursor that should be used for this view or the default cursor.
   // The event location is in the receiver's coordinate system. The caller is
   // responsible for managing the lifetime of the returned object, though that
@@ -674,7 +756,7 @@ class VIEWS_EXPORT View : public ui::LayerDelegate,
   // Sets whether this view can accept the focus.
   // Note that this is false by default so that a view used as a container does
   // not get the focus.
-  void set_focusable(bool focusable) { focusable_ = focusable; }
+  void set_focusable(bool focusable);
 
   // Returns true if the view is focusable (IsFocusable) and visible in the root
   // view. See also IsFocusable.
@@ -687,9 +769,7 @@ class VIEWS_EXPORT View : public ui::LayerDelegate,
   // Set whether this view can be made focusable if the user requires
   // full keyboard access, even though it's not normally focusable.
   // Note that this is false by default.
-  void set_accessibility_focusable(bool accessibility_focusable) {
-    accessibility_focusable_ = accessibility_focusable;
-  }
+  void set_accessibility_focusable(bool accessibility_focusable);
 
   // Convenience method to retrieve the FocusManager associated with the
   // Widget that contains this view.  This can return NULL if this view is not
@@ -840,6 +920,12 @@ class VIEWS_EXPORT View : public ui::LayerDelegate,
   // Returns an instance of the native accessibility interface for this view.
   virtual gfx::NativeViewAccessible GetNativeViewAccessible();
 
+  // Drops the accessible state of this view that the native accessibility
+  // interface cached, so that the next query gets it again. Called for the
+  // view of each Widget::NotifyAccessibilityEvent(), and when the view
+  // schedules a paint, which views that don't notify do as they change.
+  void InvalidateAccessibleState();
+
   // Scrolling -----------------------------------------------------------------
   // TODO(beng): Figure out if this can live somewhere other than View, i.e.
   //             closer to ScrollView.
@@ -884,6 +970,10 @@ class VIEWS_EXPORT View : public ui::LayerDelegate,
   // parent an opportunity to do a fresh layout if that makes sense.
   virtual void ChildPreferredSizeChanged(View* child) {}
 
+  // Called when a child view is shown or hidden, which changes how the
+  // parent lays out its children.
+  virtual void ChildVisibilityChanged(View* child) {}
+
   // Invalidates the layout and calls ChildPreferredSizeChanged on the parent
   // if there is one. Be sure to call View::PreferredSizeChanged when
   // overriding such that the layout is properly invalidated.
@@ -941,7 +1031,8 @@ class VIEWS_EXPORT View : public ui::LayerDelegate,
   // Painting ------------------------------------------------------------------
 
   // Responsible for calling Paint() on child Views. Override to control the
-  // order child Views are painted.
+  // order child Views are painted. Children hidden by a later opaque sibling
+  // (see SetFillsBoundsOpaquely()) within the clip of |canvas| are skipped.
   virtual void PaintChildren(gfx::Canvas* canvas);
 
   // Override to provide rendering in any part of the View's bounds. Typically
@@ -1139,6 +1230,45 @@ class VIEWS_EXPORT View : public ui::LayerDelegate,
   // invoke OnPaint() on the View.
   void PaintCommon(gfx::Canvas* canvas);
 
+  // Paints the View and its children into |paint_cache_| if it isn't valid,
+  // and then draws it into |canvas|.
+  void PaintFromCache(gfx::Canvas* canvas);
+
+  // Draws GetPaintRecording() into |canvas|, or paints the View and its
+  // children if it can't be recorded.
+  void PaintFromRecording(gfx::Canvas* canvas);
+
+  // Releases |paint_recording_|.
+  void ResetPaintRecording();
+
+  // Returns in |bounds| the part of the bounds of the view, in the coordinates
+  // of its parent, that it paints opaquely into the canvas of its parent, if
+  // it fills its bounds opaquely and paints like its parent.
+  bool GetOpaqueBoundsInParent(gfx::Rect* bounds) const;
+
+  // Finds, front to back, the children that are hidden by an opaque sibling
+  // within the clip of |canvas|, and sets them in |hidden| if it isn't NULL.
+  // Returns the index of the frontmost child that covers all of the clip,
+  // below which every child is hidden, or -1.
+  int FindHiddenChildren(gfx::Canvas* canvas, std::vector<bool>* hidden) const;
+
+  // Child index ---------------------------------------------------------------
+
+  // Returns the index of SetChildIndexEnabled(), rebuilding it if needed, or
+  // NULL if it isn't enabled.
+  const internal::SpatialIndex* GetChildIndex();
+
+  // Returns the rect under which |child| is indexed.
+  gfx::Rect GetChildIndexRect(const View* child,
+                              const gfx::Rect& bounds) const;
+
+  // Marks the index to be rebuilt the next time it is used.
+  void InvalidateChildIndex();
+
+  // Moves |child| in the index after its bounds changed from
+  // |previous_bounds|.
+  void UpdateChildIndex(const View* child, const gfx::Rect& previous_bounds);
+
   // Tree operations -----------------------------------------------------------
 
   // Removes |view| from the hierarchy tree.  If |update_focus_cycle| is true,
@@ -1352,6 +1482,24 @@ class VIEWS_EXPORT View : public ui::LayerDelegate,
   // Whether this view is painting.
   bool painting_enabled_;
 
+  // The cache of SetPaintCacheEnabled(), if it was painted, and whether it
+  // still holds what the view paints.
+  bool paint_cache_enabled_;
+  scoped_ptr<gfx::CanvasSkia> paint_cache_;
+  bool paint_cache_valid_;
+
+  // The recording of SetPaintRecordingEnabled(), if it was made, whether it
+  // still holds what the view paints, and how many calls it is made of.
+  bool paint_recording_enabled_;
+  SkPicture* paint_recording_;
+  bool paint_recording_valid_;
+  int paint_recording_op_count_;
+
+  // The index of SetChildIndexEnabled(), if enabled, and whether it is up to
+  // date.
+  scoped_ptr<internal::SpatialIndex> child_index_;
+  bool child_index_valid_;
+
   // Whether or not RegisterViewForVisibleBoundsNotification on the RootView
   // has been invoked.
   bool registered_for_visible_bounds_notification_;
@@ -1371,6 +1519,11 @@ class VIEWS_EXPORT View : public ui::LayerDelegate,
   // Whether the view needs to be laid out.
   bool needs_layout_;
 
+  // The preferred size kept by GetCachedPreferredSize(), and the layout pass
+  // it was computed in, or 0.
+  gfx::Size cached_preferred_size_;
+  int cached_preferred_size_pass_;
+
   // The View's LayoutManager defines the sizing heuristics applied to child
   // Views. The default is absolute positioning according to bounds_.
   scoped_ptr<LayoutManager> layout_manager_;
@@ -0,0 +1,185 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "views/view_profiler.h"
+
+#include <algorithm>
+#include <map>
+
+#include "base/command_line.h"
+#include "base/debug/trace_event.h"
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/stringprintf.h"
+#include "ui/base/ui_base_switches.h"
+#include "ui/gfx/canvas.h"
+#include "views/view.h"
+
+namespace views {
+
+namespace {
+
+// The names of the trace events of the phases.
+const char* const kPhaseNames[ViewProfiler::PHASE_COUNT] = {
+  "View::OnPaint",
+  "View::PaintChildren",
+  "View::Layout",
+  "View::GetPreferredSize",
+};
+
+// An OnPaint() of this long or longer gets the reddest tint of the heat map.
+const double kHeatMapFullCostMs = 4.0;
+const int kHeatMapMaxAlpha = 0xC0;
+
+// Only used on the UI thread.
+struct ProfileData {
+  ProfileData()
+      : enabled(false),
+        heat_map_enabled(false) {
+    const CommandLine& command_line = *CommandLine::ForCurrentProcess();
+    heat_map_enabled =
+        command_line.HasSwitch(switches::kShowViewPaintHeatMap);
+    enabled = heat_map_enabled ||
+        command_line.HasSwitch(switches::kProfileViews);
+  }
+
+  bool enabled;
+  bool heat_map_enabled;
+
+  std::map<std::string, ViewProfiler::ClassStats> class_stats;
+
+  // The time the last OnPaint() of each view took, for the heat map.
+  std::map<const View*, base::TimeDelta> paint_times;
+};
+
+base::LazyInstance<ProfileData, base::LeakyLazyInstanceTraits<ProfileData> >
+    g_profile_data(base::LINKER_INITIALIZED);
+
+bool IsCostlier(const ViewProfiler::ClassStats& a,
+                const ViewProfiler::ClassStats& b) {
+  return a.GetTotalTime() > b.GetTotalTime();
+}
+
+void PaintHeatMapImpl(const ProfileData& data,
+                      const View* view,
+                      gfx::Canvas* canvas) {
+  std::map<const View*, base::TimeDelta>::const_iterator it =
+      data.paint_times.find(view);
+  if (it != data.paint_times.end()) {
+    double cost = std::min(it->second.InMillisecondsF() / kHeatMapFullCostMs,
+                           1.0);
+    int alpha = static_cast<int>(cost * kHeatMapMaxAlpha);
+    if (alpha) {
+      canvas->FillRectInt(SkColorSetARGB(alpha, 0xFF, 0, 0), 0, 0,
+                          view->width(), view->height());
+    }
+  }
+
+  for (int i = 0, count = view->child_count(); i < count; ++i) {
+    const View* child = view->child_at(i);
+    // The views with a layer don't paint into |canvas|.
+    if (!child->IsVisible() || child->layer())
+      continue;
+    canvas->Save();
+    canvas->TranslateInt(child->GetMirroredX(), child->y());
+    PaintHeatMapImpl(data, child, canvas);
+    canvas->Restore();
+  }
+}
+
+}  // namespace
+
+ViewProfiler::ClassStats::ClassStats() {
+  for (int i = 0; i < PHASE_COUNT; ++i)
+    count[i] = 0;
+}
+
+ViewProfiler::ClassStats::~ClassStats() {
+}
+
+base::TimeDelta ViewProfiler::ClassStats::GetTotalTime() const {
+  base::TimeDelta total;
+  for (int i = 0; i < PHASE_COUNT; ++i)
+    total += time[i];
+  return total;
+}
+
+ViewProfiler::ScopedTimer::ScopedTimer(const View* view, Phase phase)
+    : view_(NULL),
+      phase_(phase) {
+  if (!IsEnabled())
+    return;
+  view_ = view;
+  class_name_ = view->GetClassName();
+  TRACE_EVENT_COPY_BEGIN1("View", kPhaseNames[phase_], "class", class_name_);
+  start_ = base::TimeTicks::HighResNow();
+}
+
+ViewProfiler::ScopedTimer::~ScopedTimer() {
+  if (!view_)
+    return;
+  base::TimeDelta time = base::TimeTicks::HighResNow() - start_;
+  TRACE_EVENT_END0("View", kPhaseNames[phase_]);
+
+  ProfileData& data = g_profile_data.Get();
+  ClassStats& stats = data.class_stats[class_name_];
+  if (stats.class_name.empty())
+    stats.class_name = class_name_;
+  stats.count[phase_]++;
+  stats.time[phase_] += time;
+  if (phase_ == PHASE_PAINT && data.heat_map_enabled)
+    data.paint_times[view_] = time;
+}
+
+// static
+bool ViewProfiler::IsEnabled() {
+  return g_profile_data.Get().enabled;
+}
+
+// static
+bool ViewProfiler::IsHeatMapEnabled() {
+  return g_profile_data.Get().heat_map_enabled;
+}
+
+// static
+void ViewProfiler::GetClassStats(std::vector<ClassStats>* stats) {
+  const ProfileData& data = g_profile_data.Get();
+  stats->clear();
+  for (std::map<std::string, ClassStats>::const_iterator it =
+           data.class_stats.begin();
+       it != data.class_stats.end(); ++it)
+    stats->push_back(it->second);
+  std::sort(stats->begin(), stats->end(), &IsCostlier);
+}
+
+// static
+void ViewProfiler::LogClassStats() {
+  std::vector<ClassStats> stats;
+  GetClassStats(&stats);
+  LOG(INFO) << "View costs, in ms (calls): paint, paint children, layout, "
+               "preferred size";
+  for (size_t i = 0; i < stats.size(); ++i) {
+    const ClassStats& s = stats[i];
+    std::string line = s.class_name;
+    for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+      base::StringAppendF(&line, " %.2f (%d)",
+                          s.time[phase].InMillisecondsF(), s.count[phase]);
+    }
+    LOG(INFO) << line;
+  }
+}
+
+// static
+void ViewProfiler::PaintHeatMap(const View* view, gfx::Canvas* canvas) {
+  const ProfileData& data = g_profile_data.Get();
+  if (data.heat_map_enabled)
+    PaintHeatMapImpl(data, view, canvas);
+}
+
+// static
+void ViewProfiler::OnViewDestroyed(const View* view) {
+  g_profile_data.Get().paint_times.erase(view);
+}
+
+}  // namespace views
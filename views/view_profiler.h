@@ -0,0 +1,98 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef VIEWS_VIEW_PROFILER_H_
+#define VIEWS_VIEW_PROFILER_H_
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/time.h"
+#include "views/views_export.h"
+
+namespace gfx {
+class Canvas;
+}
+
+namespace views {
+
+class View;
+
+// Times the painting and layout of the views when the --profile-views switch
+// is given, so that the costly views can be found in the field. Each call is
+// a trace event, with the class of the view, and the times add up by class
+// name, which are logged when a widget closes. With --show-view-paint-heat-map,
+// each view is also tinted in red by how long its OnPaint() took.
+//
+// The times include what the call does for the descendants: PaintChildren()
+// paints them, and a Layout() lays out those that change size. Only the
+// GetPreferredSize() calls of the layout managers and SizeToPreferredSize()
+// are timed; those made from the views themselves add to their caller's.
+class VIEWS_EXPORT ViewProfiler {
+ public:
+  enum Phase {
+    PHASE_PAINT,
+    PHASE_PAINT_CHILDREN,
+    PHASE_LAYOUT,
+    PHASE_PREFERRED_SIZE,
+    PHASE_COUNT
+  };
+
+  // The calls of a class of views.
+  struct VIEWS_EXPORT ClassStats {
+    ClassStats();
+    ~ClassStats();
+
+    // The times of all the phases.
+    base::TimeDelta GetTotalTime() const;
+
+    std::string class_name;
+    int count[PHASE_COUNT];
+    base::TimeDelta time[PHASE_COUNT];
+  };
+
+  // Times a phase of |view| for the scope, if profiling is on.
+  class VIEWS_EXPORT ScopedTimer {
+   public:
+    ScopedTimer(const View* view, Phase phase);
+    ~ScopedTimer();
+
+   private:
+    // NULL if profiling is off.
+    const View* view_;
+    Phase phase_;
+    std::string class_name_;
+    base::TimeTicks start_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedTimer);
+  };
+
+  // Whether the views are profiled, which is decided by the switches once.
+  static bool IsEnabled();
+
+  // Whether the heat map is painted.
+  static bool IsHeatMapEnabled();
+
+  // Returns the stats of each class, the costliest first.
+  static void GetClassStats(std::vector<ClassStats>* stats);
+
+  // Logs GetClassStats().
+  static void LogClassStats();
+
+  // Tints |view| and its descendants in red by how long they took to paint,
+  // over their painting. |canvas| is in the coordinates of |view|.
+  static void PaintHeatMap(const View* view, gfx::Canvas* canvas);
+
+  // Forgets the paint time of |view|, which is being deleted.
+  static void OnViewDestroyed(const View* view);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(ViewProfiler);
+};
+
+}  // namespace views
+
+#endif  // VIEWS_VIEW_PROFILER_H_
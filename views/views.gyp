@@ -250,6 +250,8 @@
         'controls/throbber.h',
         'controls/tree/tree_view.cc',
         'controls/tree/tree_view.h',
+        'controls/virtual_list_view.cc',
+        'controls/virtual_list_view.h',
         #'debug_utils.cc',
         #'debug_utils.h',
         'drag_controller.h',
@@ -334,6 +336,8 @@
         'painter.h',
         'repeat_controller.cc',
         'repeat_controller.h',
+        'spatial_index.cc',
+        'spatial_index.h',
         'touchui/gesture_manager.cc',
         'touchui/gesture_manager.h',
         #'touchui/touch_factory.cc',
@@ -347,6 +351,8 @@
         #'view_aura.cc',
         'view_constants.cc',
         'view_constants.h',
+        'view_profiler.cc',
+        'view_profiler.h',
         #'view_gtk.cc',
         'view_text_utils.cc',
         'view_text_utils.h',
@@ -400,6 +406,8 @@
         'widget/widget.h',
         'widget/widget_delegate.cc',
         'widget/widget_delegate.h',
+        'widget/widget_preparer.cc',
+        'widget/widget_preparer.h',
         'widget/window_manager.cc',
         'widget/window_manager.h',
         'window/client_view.cc',
@@ -627,5 +635,78 @@
         }],
       ],
     },
+    {
+      # Prints where startup time goes until the first paint of a window.
+      'target_name': 'views_startup_timeline',
+      'type': 'executable',
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../skia/skia.gyp:skia',
+        '../ui/ui.gyp:ui',
+        '../ui/ui.gyp:gfx_resources',
+        '../ui/ui.gyp:ui_resources',
+        '../ui/ui.gyp:ui_resources_standard',
+        'views',
+      ],
+      'include_dirs': [
+        '..',
+      ],
+      'sources': [
+        'examples/startup_timeline_main.cc',
+        '<(SHARED_INTERMEDIATE_DIR)/ui/gfx/gfx_resources.rc',
+        '<(SHARED_INTERMEDIATE_DIR)/ui/ui_resources/ui_resources.rc',
+        '<(SHARED_INTERMEDIATE_DIR)/ui/ui_resources_standard/ui_resources_standard.rc',
+      ],
+      'conditions': [
+        ['OS=="win"', {
+          'link_settings': {
+            'libraries': [
+              '-limm32.lib',
+              '-loleacc.lib',
+            ]
+          },
+          'include_dirs': [
+            '<(DEPTH)/third_party/wtl/include',
+          ],
+        }],
+      ],
+    },
+    {
+      # Times layout, paint, hit testing and focus traversal on synthetic
+      # view trees.
+      'target_name': 'views_benchmark',
+      'type': 'executable',
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../skia/skia.gyp:skia',
+        '../ui/ui.gyp:ui',
+        '../ui/ui.gyp:gfx_resources',
+        '../ui/ui.gyp:ui_resources',
+        '../ui/ui.gyp:ui_resources_standard',
+        'views',
+      ],
+      'include_dirs': [
+        '..',
+      ],
+      'sources': [
+        'examples/views_benchmark_main.cc',
+        '<(SHARED_INTERMEDIATE_DIR)/ui/gfx/gfx_resources.rc',
+        '<(SHARED_INTERMEDIATE_DIR)/ui/ui_resources/ui_resources.rc',
+        '<(SHARED_INTERMEDIATE_DIR)/ui/ui_resources_standard/ui_resources_standard.rc',
+      ],
+      'conditions': [
+        ['OS=="win"', {
+          'link_settings': {
+            'libraries': [
+              '-limm32.lib',
+              '-loleacc.lib',
+            ]
+          },
+          'include_dirs': [
+            '<(DEPTH)/third_party/wtl/include',
+          ],
+        }],
+      ],
+    },
   ],
 }
@@ -56,6 +56,10 @@ class VIEWS_EXPORT NativeWidgetDelegate {
   // Called when the window is shown/hidden.
   virtual void OnNativeWidgetVisibilityChanged(bool visible) = 0;
 
+  // Called when the window is minimized, and when it is restored from being
+  // minimized.
+  virtual void OnNativeWidgetMinimizedChanged(bool minimized) = 0;
+
   // Called when the native widget is created.
   virtual void OnNativeWidgetCreated() = 0;
 
@@ -97,6 +101,8 @@ class VIEWS_EXPORT NativeWidgetDelegate {
   virtual bool OnMouseEvent(const MouseEvent& event) = 0;
   virtual void OnMouseCaptureLost() = 0;
   virtual ui::TouchStatus OnTouchEvent(const TouchEvent& event) = 0;
+  // Dispatches the touch events read together, see RootView::OnTouchFrame().
+  virtual ui::TouchStatus OnTouchFrame(const TouchFrame& frame) = 0;
 
   // Runs the specified native command. Returns true if the command is handled.
   virtual bool ExecuteCommand(int command_id) = 0;
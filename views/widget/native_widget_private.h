@@ -198,6 +198,7 @@ class VIEWS_EXPORT NativeWidgetPrivate : public NativeWidget,
                             const ui::OSExchangeData& data,
                             int operation) = 0;
   virtual void SchedulePaintInRect(const gfx::Rect& rect) = 0;
+  virtual bool ScrollRect(const gfx::Rect& rect, const gfx::Point& amount) = 0;
   virtual void SetCursor(gfx::NativeCursor cursor) = 0;
   virtual void ClearNativeFocus() = 0;
   virtual void FocusNativeView(gfx::NativeView native_view) = 0;
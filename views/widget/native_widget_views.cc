@@ -34,7 +34,8 @@ NativeWidgetViews::NativeWidgetViews(internal::NativeWidgetDelegate* delegate)
       always_on_top_(false),
       ALLOW_THIS_IN_INITIALIZER_LIST(close_widget_factory_(this)),
       ownership_(Widget::InitParams::NATIVE_WIDGET_OWNS_WIDGET),
-      delete_native_view_(true) {
+      delete_native_view_(true),
+      windowless_popup_(false) {
 }
 
 NativeWidgetViews::~NativeWidgetViews() {
@@ -59,6 +60,31 @@ const View* NativeWidgetViews::GetView() const {
   return view_;
 }
 
+// static
+Widget* NativeWidgetViews::GetWindowlessPopupHost(
+    const Widget::InitParams& params) {
+  // With pure views, all the widgets are already windowless.
+  if (!Widget::IsWindowlessPopups() || Widget::IsPureViews())
+    return NULL;
+  if (params.type != Widget::InitParams::TYPE_MENU &&
+      params.type != Widget::InitParams::TYPE_POPUP &&
+      params.type != Widget::InitParams::TYPE_BUBBLE)
+    return NULL;
+  if (params.child || params.can_activate)
+    return NULL;
+
+  Widget* parent = params.parent_widget;
+  if (!parent && params.parent)
+    parent = Widget::GetWidgetForNativeView(params.parent);
+  Widget* host = parent ? parent->GetTopLevelWidget() : NULL;
+  if (!host || !host->IsVisible() || !host->GetContentsView())
+    return NULL;
+  if (params.bounds.IsEmpty() ||
+      !host->GetClientAreaScreenBounds().Contains(params.bounds))
+    return NULL;
+  return host;
+}
+
 void NativeWidgetViews::OnActivate(bool active) {
   // TODO(oshima): find out if we should check toplevel here.
   if (active_ == active)
@@ -115,7 +141,13 @@ void NativeWidgetViews::InitNativeWidget(const Widget::InitParams& params) {
   ownership_ = params.ownership;
   always_on_top_ = params.keep_on_top;
   View* parent_view = NULL;
-  if (params.parent_widget) {
+  gfx::Rect bounds = params.bounds;
+  if (windowless_popup_) {
+    Widget* host = GetWindowlessPopupHost(params);
+    DCHECK(host);
+    parent_view = host->GetRootView();
+    bounds = ConvertScreenBoundsToParent(bounds, parent_view);
+  } else if (params.parent_widget) {
     parent_view = params.parent_widget->GetChildViewParent();
   } else if (ViewsDelegate::views_delegate &&
              ViewsDelegate::views_delegate->GetDefaultParentView() &&
@@ -127,10 +159,14 @@ void NativeWidgetViews::InitNativeWidget(const Widget::InitParams& params) {
   }
 
   view_ = new internal::NativeWidgetView(this);
-  view_->SetBoundsRect(params.bounds);
+  view_->SetBoundsRect(bounds);
 #if !defined(USE_AURA)
   // TODO(beng): re-enable this once we have a consolidated layer tree.
-  view_->SetPaintToLayer(params.create_layer);
+  // A windowless popup is painted with its top-level widget, unless that one
+  // composites its layers.
+  view_->SetPaintToLayer(windowless_popup_ ?
+      parent_view->GetWidget()->GetCompositor() != NULL :
+      params.create_layer);
 #endif
 
   // With the default NATIVE_WIDGET_OWNS_WIDGET ownership, the
@@ -246,14 +282,37 @@ void NativeWidgetViews::SendNativeAccessibilityEvent(
 }
 
 void NativeWidgetViews::SetMouseCapture() {
+  if (windowless_popup_) {
+    internal::RootView* root_view = GetHostRootView();
+    if (!root_view)
+      return;
+    root_view->SetMouseCaptureView(view_);
+    // The window of the top-level widget gets the events outside of it.
+    if (!GetParentNativeWidget()->HasMouseCapture())
+      GetParentNativeWidget()->SetMouseCapture();
+    return;
+  }
   WindowManager::Get()->SetMouseCapture(GetWidget());
 }
 
 void NativeWidgetViews::ReleaseMouseCapture() {
+  if (windowless_popup_) {
+    internal::RootView* root_view = GetHostRootView();
+    if (!root_view || root_view->mouse_capture_view() != view_)
+      return;
+    root_view->SetMouseCaptureView(NULL);
+    if (GetParentNativeWidget()->HasMouseCapture())
+      GetParentNativeWidget()->ReleaseMouseCapture();
+    return;
+  }
   WindowManager::Get()->ReleaseMouseCapture(GetWidget());
 }
 
 bool NativeWidgetViews::HasMouseCapture() const {
+  if (windowless_popup_) {
+    internal::RootView* root_view = GetHostRootView();
+    return root_view && root_view->mouse_capture_view() == view_;
+  }
   return WindowManager::Get()->HasMouseCapture(GetWidget());
 }
 
@@ -319,7 +378,12 @@ gfx::Rect NativeWidgetViews::GetRestoredBounds() const {
 }
 
 void NativeWidgetViews::SetBounds(const gfx::Rect& bounds) {
-  // |bounds| are supplied in the coordinates of the parent.
+  // |bounds| are supplied in the coordinates of the parent, or of the screen
+  // for a windowless popup.
+  if (windowless_popup_ && view_->parent()) {
+    view_->SetBoundsRect(ConvertScreenBoundsToParent(bounds, view_->parent()));
+    return;
+  }
   view_->SetBoundsRect(bounds);
 }
 
@@ -503,6 +567,11 @@ void NativeWidgetViews::SchedulePaintInRect(const gfx::Rect& rect) {
   view_->SchedulePaintInRect(rect);
 }
 
+bool NativeWidgetViews::ScrollRect(const gfx::Rect& rect,
+                                   const gfx::Point& amount) {
+  return false;
+}
+
 void NativeWidgetViews::SetCursor(gfx::NativeCursor cursor) {
   view_->set_cursor(cursor);
   GetParentNativeWidget()->SetCursor(cursor);
@@ -562,6 +631,24 @@ const internal::NativeWidgetPrivate*
       NULL;
 }
 
+internal::RootView* NativeWidgetViews::GetHostRootView() const {
+  Widget* containing_widget = view_ ? view_->GetWidget() : NULL;
+  return containing_widget ?
+      static_cast<internal::RootView*>(containing_widget->GetRootView()) :
+      NULL;
+}
+
+// static
+gfx::Rect NativeWidgetViews::ConvertScreenBoundsToParent(
+    const gfx::Rect& bounds,
+    const View* parent) {
+  gfx::Point parent_origin;
+  View::ConvertPointToScreen(parent, &parent_origin);
+  gfx::Rect parent_bounds(bounds);
+  parent_bounds.Offset(-parent_origin.x(), -parent_origin.y());
+  return parent_bounds;
+}
+
 bool NativeWidgetViews::HandleWindowOperation(const MouseEvent& event) {
   if (event.type() != ui::ET_MOUSE_PRESSED)
     return false;
@@ -21,6 +21,7 @@ class DesktopWindowView;
 
 namespace internal {
 class NativeWidgetView;
+class RootView;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -28,11 +29,24 @@ class NativeWidgetView;
 //
 //  A NativeWidget implementation that uses another View as its native widget.
 //
+//  As a windowless popup, it is a child of the RootView of the top-level widget
+//  of its parent, after the contents view, and its bounds are in the
+//  coordinates of the screen, like those of a popup with a window. It paints
+//  with the top-level widget and gets its mouse events from its RootView. See
+//  Widget::IsWindowlessPopups().
+//
 class VIEWS_EXPORT NativeWidgetViews : public internal::NativeWidgetPrivate {
  public:
   explicit NativeWidgetViews(internal::NativeWidgetDelegate* delegate);
   virtual ~NativeWidgetViews();
 
+  // Returns the top-level widget a widget created with |params| is drawn into
+  // as a windowless popup, or NULL if it needs a window: if windowless popups
+  // are off, the widget isn't a menu, popup or bubble, it can be activated,
+  // which needs the keyboard focus of a window, or it doesn't fit in the
+  // client area of the top-level widget, which clips it.
+  static Widget* GetWindowlessPopupHost(const Widget::InitParams& params);
+
   // TODO(beng): remove.
   View* GetView();
   const View* GetView() const;
@@ -45,6 +59,12 @@ class VIEWS_EXPORT NativeWidgetViews : public internal::NativeWidgetPrivate {
     delete_native_view_ = delete_native_view;
   }
 
+  // Makes the widget a windowless popup. Must be called before it is
+  // initialized, with params for which GetWindowlessPopupHost() is not NULL.
+  void set_windowless_popup(bool windowless_popup) {
+    windowless_popup_ = windowless_popup;
+  }
+
   internal::NativeWidgetDelegate* delegate() const { return delegate_; }
 
  protected:
@@ -131,6 +151,8 @@ class VIEWS_EXPORT NativeWidgetViews : public internal::NativeWidgetPrivate {
                             const ui::OSExchangeData& data,
                             int operation) OVERRIDE;
   virtual void SchedulePaintInRect(const gfx::Rect& rect) OVERRIDE;
+  virtual bool ScrollRect(const gfx::Rect& rect,
+                          const gfx::Point& amount) OVERRIDE;
   virtual void SetCursor(gfx::NativeCursor cursor) OVERRIDE;
   virtual void ClearNativeFocus() OVERRIDE;
   virtual void FocusNativeView(gfx::NativeView native_view) OVERRIDE;
@@ -148,6 +170,14 @@ class VIEWS_EXPORT NativeWidgetViews : public internal::NativeWidgetPrivate {
   internal::NativeWidgetPrivate* GetParentNativeWidget();
   const internal::NativeWidgetPrivate* GetParentNativeWidget() const;
 
+  // The RootView a windowless popup is drawn into. May return NULL during
+  // Widget destruction.
+  internal::RootView* GetHostRootView() const;
+
+  // Converts |bounds| in the coordinates of the screen to those of |parent|.
+  static gfx::Rect ConvertScreenBoundsToParent(const gfx::Rect& bounds,
+                                               const View* parent);
+
   bool HandleWindowOperation(const MouseEvent& event);
 
   internal::NativeWidgetDelegate* delegate_;
@@ -173,6 +203,8 @@ class VIEWS_EXPORT NativeWidgetViews : public internal::NativeWidgetPrivate {
 
   bool delete_native_view_;
 
+  bool windowless_popup_;
+
   std::map<const char*, void*> window_properties_;
 
   DISALLOW_COPY_AND_ASSIGN(NativeWidgetViews);
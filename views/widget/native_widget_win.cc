@@ -9,11 +9,14 @@
 
 #include <algorithm>
 
+#include "base/metrics/startup_timeline.h"
+#include "base/startup_instance_report.h"
 #include "base/string_util.h"
 #include "base/system_monitor/system_monitor.h"
 #include "base/win/scoped_gdi_object.h"
 #include "base/win/win_util.h"
 #include "base/win/windows_version.h"
+#include "skia/ext/dib_section_pool_win.h"
 #include "ui/base/dragdrop/drag_drop_types.h"
 #include "ui/base/dragdrop/drag_source.h"
 #include "ui/base/dragdrop/os_exchange_data.h"
@@ -24,9 +27,11 @@
 #include "ui/base/view_prop.h"
 #include "ui/base/win/hwnd_util.h"
 #include "ui/base/win/mouse_wheel_util.h"
+#include "ui/gfx/blit.h"
 #include "ui/gfx/canvas_skia.h"
 #include "ui/gfx/canvas_skia_paint.h"
 #include "ui/gfx/compositor/compositor.h"
+#include "ui/gfx/compositor/layer.h"
 #include "ui/gfx/icon_util.h"
 #include "ui/gfx/native_theme_win.h"
 #include "ui/gfx/font.h"
@@ -303,6 +308,30 @@ const int kMonitorEdgePadding = 10;
 
 const int kDragFrameWindowAlpha = 200;
 
+// Adds the rectangles of |region| to |damage|.
+void AddRegionToDamage(HRGN region, gfx::DamageRegion* damage) {
+  DWORD size = GetRegionData(region, 0, NULL);
+  if (!size)
+    return;
+  scoped_array<char> buffer(new char[size]);
+  RGNDATA* region_data = reinterpret_cast<RGNDATA*>(buffer.get());
+  if (!GetRegionData(region, size, region_data))
+    return;
+  const RECT* rects = reinterpret_cast<const RECT*>(region_data->Buffer);
+  for (DWORD i = 0; i < region_data->rdh.nCount; ++i)
+    damage->Add(gfx::Rect(rects[i]));
+}
+
+// Adds the update region of |hwnd| to |damage| if it is more than a rectangle.
+// Windows keeps the exact union of the invalidated rectangles, which the
+// damage region simplifies.
+void GetUpdateDamageRegion(HWND hwnd, gfx::DamageRegion* damage) {
+  base::win::ScopedRegion update_region(CreateRectRgn(0, 0, 0, 0));
+  if (GetUpdateRgn(hwnd, update_region, FALSE) != COMPLEXREGION)
+    return;
+  AddRegionToDamage(update_region, damage);
+}
+
 }  // namespace
 
 // static
@@ -391,6 +420,8 @@ NativeWidgetWin::NativeWidgetWin(internal::NativeWidgetDelegate* delegate)
       ignore_pos_changes_factory_(this),
       last_monitor_(NULL),
       is_right_mouse_pressed_on_caption_(false),
+      mouse_move_time_(0),
+      previous_mouse_move_time_(0),
       restored_enabled_(false),
       destroyed_(NULL),
       has_non_client_view_(false) {
@@ -472,6 +503,45 @@ void NativeWidgetWin::ClearAccessibilityViewEvent(View* view) {
   }
 }
 
+void NativeWidgetWin::GetCoalescedMousePoints(
+    std::vector<gfx::Point>* points) const {
+  points->clear();
+  if (!mouse_move_time_)
+    return;
+
+  // The history holds the positions in virtual screen coordinates, which are
+  // truncated to 16 bits.
+  MOUSEMOVEPOINT current = { 0 };
+  current.x = mouse_move_screen_point_.x & 0xFFFF;
+  current.y = mouse_move_screen_point_.y & 0xFFFF;
+  current.time = mouse_move_time_;
+  MOUSEMOVEPOINT history[64];
+  int count = GetMouseMovePointsEx(sizeof(MOUSEMOVEPOINT), &current, history,
+                                   arraysize(history),
+                                   GMMP_USE_DISPLAY_POINTS);
+  if (count <= 0) {
+    // The current position isn't in the history anymore.
+    POINT point = mouse_move_screen_point_;
+    ScreenToClient(hwnd(), &point);
+    points->push_back(gfx::Point(point.x, point.y));
+    return;
+  }
+
+  // The history is newest first, and starts with |current|.
+  for (int i = count - 1; i >= 0; --i) {
+    if (i > 0 && previous_mouse_move_time_ &&
+        static_cast<LONG>(history[i].time - previous_mouse_move_time_) <= 0) {
+      continue;
+    }
+    POINT point = { history[i].x > 0x7FFF ? history[i].x - 0x10000 :
+                                            history[i].x,
+                    history[i].y > 0x7FFF ? history[i].y - 0x10000 :
+                                            history[i].y };
+    ScreenToClient(hwnd(), &point);
+    points->push_back(gfx::Point(point.x, point.y));
+  }
+}
+
 void NativeWidgetWin::PushForceHidden() {
   if (force_hidden_count_++ == 0)
     Hide();
@@ -488,6 +558,16 @@ void NativeWidgetWin::PopForceHidden() {
 // NativeWidgetWin, CompositorDelegate implementation:
 
 void NativeWidgetWin::ScheduleCompositorPaint() {
+  // Layered windows get no WM_PAINT; the compositor updates them itself.
+  if (use_layered_buffer_) {
+    if (paint_layered_window_factory_.empty()) {
+      MessageLoop::current()->PostTask(FROM_HERE,
+          paint_layered_window_factory_.NewRunnableMethod(
+          &NativeWidgetWin::RedrawLayeredWindowContents));
+    }
+    return;
+  }
+
   RECT rect;
   ::GetClientRect(GetNativeView(), &rect);
   InvalidateRect(GetNativeView(), &rect, FALSE);
@@ -1034,6 +1114,13 @@ bool NativeWidgetWin::IsFullscreen() const {
 
 void NativeWidgetWin::SetOpacity(unsigned char opacity) {
   layered_alpha_ = static_cast<BYTE>(opacity);
+  // The compositor draws the layered window with the opacity of the root
+  // layer.
+  if (use_layered_buffer_ && compositor_.get()) {
+    ui::Layer* root_layer = GetWidget()->GetRootView()->layer();
+    if (root_layer)
+      root_layer->SetOpacity(opacity / 255.0f);
+  }
 }
 
 void NativeWidgetWin::SetUseDragFrame(bool use_drag_frame) {
@@ -1071,7 +1158,7 @@ void NativeWidgetWin::SchedulePaintInRect(const gfx::Rect& rect) {
   if (use_layered_buffer_) {
     // We must update the back-buffer immediately, since Windows' handling of
     // invalid rects is somewhat mysterious.
-    invalid_rect_ = invalid_rect_.Union(rect);
+    invalid_region_.Add(rect);
 
     // In some situations, such as drag and drop, when Windows itself runs a
     // nested message loop our message loop appears to be starved and we don't
@@ -1087,7 +1174,68 @@ void NativeWidgetWin::SchedulePaintInRect(const gfx::Rect& rect) {
     // InvalidateRect() expects client coordinates.
     RECT r = rect.ToRECT();
     InvalidateRect(hwnd(), &r, FALSE);
+    if (back_buffer_.get()) {
+      // The pixels scrolled into |rect| have to be painted again.
+      base::win::ScopedRegion rect_region(CreateRectRgnIndirect(&r));
+      CombineRgn(scrolled_region_, scrolled_region_, rect_region, RGN_DIFF);
+    }
+  }
+}
+
+bool NativeWidgetWin::ScrollRect(const gfx::Rect& rect,
+                                 const gfx::Point& amount) {
+  // Layered windows and the compositor keep their own buffers, and the
+  // coordinates of the widget are those of the window rather than of the
+  // client area when it has a custom frame.
+  if (use_layered_buffer_ || compositor_.get() || !WidgetSizeIsClientSize())
+    return false;
+
+  CRect client_rect;
+  GetClientRect(&client_rect);
+  if (client_rect.IsRectEmpty())
+    return false;
+  if (!back_buffer_.get() ||
+      back_buffer_->getDevice()->width() != client_rect.Width() ||
+      back_buffer_->getDevice()->height() != client_rect.Height()) {
+    // The back buffer only has up to date pixels to move once it has been
+    // painted entirely, which the next paint does.
+    back_buffer_.reset(new gfx::CanvasSkia(client_rect.Width(),
+                                           client_rect.Height(), true));
+    scrolled_region_.Set(CreateRectRgn(0, 0, 0, 0));
+    InvalidateRect(hwnd(), NULL, FALSE);
+    return false;
   }
+
+  gfx::Rect scroll_rect = rect.Intersect(gfx::Rect(client_rect));
+  if (scroll_rect.IsEmpty())
+    return false;
+  gfx::Rect moved_rect = scroll_rect;
+  moved_rect.Offset(amount);
+  moved_rect = moved_rect.Intersect(scroll_rect);
+  if (moved_rect.IsEmpty())
+    return false;
+
+  // The pixels of |scroll_rect| that need painting, those of the update region
+  // that weren't scrolled there before, still need painting where they move.
+  RECT r = scroll_rect.ToRECT();
+  RECT moved_r = moved_rect.ToRECT();
+  base::win::ScopedRegion scroll_region(CreateRectRgnIndirect(&r));
+  base::win::ScopedRegion stale_region(CreateRectRgn(0, 0, 0, 0));
+  GetUpdateRgn(hwnd(), stale_region, FALSE);
+  CombineRgn(stale_region, stale_region, scrolled_region_, RGN_DIFF);
+  CombineRgn(stale_region, stale_region, scroll_region, RGN_AND);
+  OffsetRgn(stale_region, amount.x(), amount.y());
+
+  gfx::ScrollCanvas(back_buffer_.get(), scroll_rect, amount);
+
+  // What moved is up to date but for the stale pixels, and the screen is
+  // updated from the back buffer by the next paint.
+  base::win::ScopedRegion moved_region(CreateRectRgnIndirect(&moved_r));
+  CombineRgn(moved_region, moved_region, stale_region, RGN_DIFF);
+  CombineRgn(scrolled_region_, scrolled_region_, scroll_region, RGN_DIFF);
+  CombineRgn(scrolled_region_, scrolled_region_, moved_region, RGN_OR);
+  InvalidateRect(hwnd(), &r, FALSE);
+  return true;
 }
 
 void NativeWidgetWin::SetCursor(gfx::NativeCursor cursor) {
@@ -1180,6 +1328,10 @@ void NativeWidgetWin::OnActivate(UINT action, BOOL minimized, HWND window) {
 }
 
 void NativeWidgetWin::OnActivateApp(BOOL active, DWORD thread_id) {
+  // The bitmaps painted into are kept for the next paint, which won't come
+  // soon when the application is in the background.
+  if (!active)
+    skia::DIBSectionPool::GetInstance()->Trim();
   if (GetWidget()->non_client_view() && !active &&
       thread_id != GetCurrentThreadId()) {
     // Another application was activated, we should reset any state that
@@ -1287,8 +1439,12 @@ LRESULT NativeWidgetWin::OnCreate(CREATESTRUCT* create_struct) {
           hwnd(),
           gfx::Size(window_rect.Width(), window_rect.Height()));
     }
-    if (compositor_.get())
+    if (compositor_.get()) {
       delegate_->AsWidget()->GetRootView()->SetPaintToLayer(true);
+      // The compositor updates layered windows from the GPU, only where its
+      // layers are damaged.
+      layered_window_contents_.reset();
+    }
   }
 #endif
 
@@ -1537,6 +1693,9 @@ LRESULT NativeWidgetWin::OnMouseRange(UINT message,
     SetMouseCapture();
   }
 
+  if (message == WM_MOUSEMOVE)
+    CoalesceMouseMoves(w_param, &l_param);
+
   MSG msg = { hwnd(), message, w_param, l_param, 0,
               { GET_X_LPARAM(l_param), GET_Y_LPARAM(l_param) } };
   MouseEvent event(msg);
@@ -1578,6 +1737,31 @@ LRESULT NativeWidgetWin::OnMouseRange(UINT message,
   return 0;
 }
 
+void NativeWidgetWin::CoalesceMouseMoves(WPARAM w_param, LPARAM* l_param) {
+  previous_mouse_move_time_ = mouse_move_time_;
+  mouse_move_time_ = static_cast<DWORD>(GetMessageTime());
+
+  // Mouse messages are queued in order, so the moves that follow this one
+  // before any other mouse message are coalesced into it. A change of the
+  // buttons or keys held ends the run, so that presses are seen where they
+  // happened.
+  MSG next;
+  while (PeekMessage(&next, hwnd(), WM_MOUSEFIRST, WM_MOUSELAST,
+                     PM_NOREMOVE | PM_NOYIELD) &&
+         next.message == WM_MOUSEMOVE && next.wParam == w_param) {
+    if (!PeekMessage(&next, hwnd(), WM_MOUSEMOVE, WM_MOUSEMOVE,
+                     PM_REMOVE | PM_NOYIELD)) {
+      break;
+    }
+    *l_param = next.lParam;
+    mouse_move_time_ = next.time;
+  }
+
+  mouse_move_screen_point_.x = GET_X_LPARAM(*l_param);
+  mouse_move_screen_point_.y = GET_Y_LPARAM(*l_param);
+  ClientToScreen(hwnd(), &mouse_move_screen_point_);
+}
+
 void NativeWidgetWin::OnMove(const CPoint& point) {
   // TODO(beng): move to Widget.
   GetWidget()->widget_delegate()->OnWidgetMove();
@@ -1854,6 +2038,10 @@ LRESULT NativeWidgetWin::OnNotify(int w_param, NMHDR* l_param) {
 }
 
 void NativeWidgetWin::OnPaint(HDC dc) {
+  // Startup ends with the first paint.
+  if (base::StartupInstanceReport::IsRecording())
+    base::StartupInstanceReport::StopRecording();
+
   RECT dirty_rect;
   // Try to paint accelerated first.
   if (GetUpdateRect(hwnd(), &dirty_rect, FALSE) &&
@@ -1861,12 +2049,27 @@ void NativeWidgetWin::OnPaint(HDC dc) {
     if (delegate_->OnNativeWidgetPaintAccelerated(
         gfx::Rect(dirty_rect))) {
       ValidateRect(hwnd(), NULL);
+    } else if (back_buffer_.get()) {
+      PaintBackBuffer();
     } else {
+      // The update region must be read before BeginPaint() validates it.
+      gfx::DamageRegion damage;
+      GetUpdateDamageRegion(hwnd(), &damage);
       scoped_ptr<gfx::CanvasPaint> canvas(
           gfx::CanvasPaint::CreateCanvasPaint(hwnd()));
+      // Clipping to the damage region, rather than to its bounds, skips the
+      // views in between distant invalidated rectangles. The DC is clipped to
+      // the update region, so the pixels outside of it are not copied.
+      if (!damage.IsEmpty())
+        damage.ClipCanvas(canvas->AsCanvas()->AsCanvasSkia());
       delegate_->OnNativeWidgetPaint(canvas->AsCanvas());
     }
   }
+
+  if (base::StartupTimeline::IsRecording()) {
+    base::StartupTimeline::RecordMilestone("FirstPaint");
+    base::StartupTimeline::Finish();
+  }
 }
 
 LRESULT NativeWidgetWin::OnPowerBroadcast(DWORD power_event, DWORD data) {
@@ -1928,6 +2131,11 @@ void NativeWidgetWin::OnSettingChange(UINT flags, const wchar_t* section) {
 }
 
 void NativeWidgetWin::OnSize(UINT param, const CSize& size) {
+  // The animations of the widget are suspended while it is minimized.
+  if (param == SIZE_MINIMIZED)
+    delegate_->OnNativeWidgetMinimizedChanged(true);
+  else if (param == SIZE_RESTORED || param == SIZE_MAXIMIZED)
+    delegate_->OnNativeWidgetMinimizedChanged(false);
   RedrawWindow(GetNativeView(), NULL, NULL, RDW_INVALIDATE | RDW_ALLCHILDREN);
   // ResetWindowRegion is going to trigger WM_NCPAINT. By doing it after we've
   // invoked OnSize we ensure the RootView has been laid out.
@@ -2292,15 +2500,21 @@ void NativeWidgetWin::RedrawInvalidRect() {
 }
 
 void NativeWidgetWin::RedrawLayeredWindowContents() {
-  if (invalid_rect_.IsEmpty())
+  if (compositor_.get()) {
+    // Unlike the update region of WM_PAINT, the invalid region of a layered
+    // window only has what was scheduled, so all of it is damage.
+    compositor_->AddDamage(invalid_region_.GetBounds());
+    invalid_region_.Clear();
+    delegate_->OnNativeWidgetPaintAccelerated(gfx::Rect());
+    return;
+  }
+
+  if (invalid_region_.IsEmpty())
     return;
 
-  // We need to clip to the dirty rect ourselves.
+  // We need to clip to the dirty region ourselves.
   layered_window_contents_->save(SkCanvas::kClip_SaveFlag);
-  layered_window_contents_->ClipRectInt(invalid_rect_.x(),
-                                        invalid_rect_.y(),
-                                        invalid_rect_.width(),
-                                        invalid_rect_.height());
+  invalid_region_.ClipCanvas(layered_window_contents_.get());
   GetWidget()->GetRootView()->Paint(layered_window_contents_.get());
   layered_window_contents_->restore();
 
@@ -2313,10 +2527,51 @@ void NativeWidgetWin::RedrawLayeredWindowContents() {
   BLENDFUNCTION blend = {AC_SRC_OVER, 0, layered_alpha_, AC_SRC_ALPHA};
   UpdateLayeredWindow(hwnd(), NULL, &position, &size, dib_dc, &zero,
                       RGB(0xFF, 0xFF, 0xFF), &blend, ULW_ALPHA);
-  invalid_rect_.SetRect(0, 0, 0, 0);
+  invalid_region_.Clear();
   skia::EndPlatformPaint(layered_window_contents_.get());
 }
 
+void NativeWidgetWin::PaintBackBuffer() {
+  CRect client_rect;
+  GetClientRect(&client_rect);
+  if (back_buffer_->getDevice()->width() != client_rect.Width() ||
+      back_buffer_->getDevice()->height() != client_rect.Height()) {
+    // The window was resized, so the new back buffer is painted entirely.
+    scrolled_region_.Set(CreateRectRgn(0, 0, 0, 0));
+    if (client_rect.IsRectEmpty()) {
+      back_buffer_.reset();
+      ValidateRect(hwnd(), NULL);
+      return;
+    }
+    back_buffer_.reset(new gfx::CanvasSkia(client_rect.Width(),
+                                           client_rect.Height(), true));
+    InvalidateRect(hwnd(), NULL, FALSE);
+  }
+
+  // The update region must be read before BeginPaint() validates it.
+  base::win::ScopedRegion paint_region(CreateRectRgn(0, 0, 0, 0));
+  GetUpdateRgn(hwnd(), paint_region, FALSE);
+  CombineRgn(paint_region, paint_region, scrolled_region_, RGN_DIFF);
+  gfx::DamageRegion damage;
+  AddRegionToDamage(paint_region, &damage);
+  SetRectRgn(scrolled_region_, 0, 0, 0, 0);
+
+  PAINTSTRUCT ps;
+  HDC dc = BeginPaint(hwnd(), &ps);
+  if (!damage.IsEmpty()) {
+    back_buffer_->save(SkCanvas::kClip_SaveFlag);
+    if (damage.ClipCanvas(back_buffer_.get()))
+      delegate_->OnNativeWidgetPaint(back_buffer_.get());
+    back_buffer_->restore();
+  }
+  // The DC is clipped to the update region, so only it is copied.
+  if (!IsRectEmpty(&ps.rcPaint)) {
+    skia::DrawToNativeContext(back_buffer_.get(), dc, ps.rcPaint.left,
+                              ps.rcPaint.top, &ps.rcPaint);
+  }
+  EndPaint(hwnd(), &ps);
+}
+
 void NativeWidgetWin::LockUpdates() {
   // We skip locked updates when Aero is on for two reasons:
   // 1. Because it isn't necessary
@@ -2358,7 +2613,7 @@ void NativeWidgetWin::ClientAreaSizeChanged() {
   if (compositor_.get())
     compositor_->WidgetSizeChanged(s);
   delegate_->OnNativeWidgetSizeChanged(s);
-  if (use_layered_buffer_) {
+  if (use_layered_buffer_ && !compositor_.get()) {
     layered_window_contents_.reset(
         new gfx::CanvasSkia(s.width(), s.height(), false));
   }
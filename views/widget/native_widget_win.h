@@ -19,9 +19,12 @@
 #include "base/memory/scoped_vector.h"
 #include "base/message_loop.h"
 #include "base/win/scoped_comptr.h"
+#include "base/win/scoped_gdi_object.h"
 #include "base/win/win_util.h"
 #include "ui/base/win/window_impl.h"
 #include "ui/gfx/compositor/compositor.h"
+#include "ui/gfx/damage_region.h"
+#include "ui/gfx/point.h"
 #include "views/focus/focus_manager.h"
 #include "views/layout/layout_manager.h"
 #include "views/widget/native_widget_private.h"
@@ -117,6 +120,13 @@ class VIEWS_EXPORT NativeWidgetWin : public ui::WindowImpl,
   // Clear a view that has recently been removed on a hierarchy change.
   void ClearAccessibilityViewEvent(View* view);
 
+  // Consecutive WM_MOUSEMOVEs are coalesced, so that a view is sent one mouse
+  // moved or dragged event for all the moves queued when it handled the last
+  // one. Returns the points the mouse went through from the previous event to
+  // the current one, oldest first, in the client coordinates of the window.
+  // Views that draw the mouse's path call this from OnMouseDragged().
+  void GetCoalescedMousePoints(std::vector<gfx::Point>* points) const;
+
   // Hides the window if it hasn't already been force-hidden. The force hidden
   // count is tracked, so calling multiple times is allowed, you just have to
   // be sure to call PopForceHidden the same number of times.
@@ -261,6 +271,8 @@ class VIEWS_EXPORT NativeWidgetWin : public ui::WindowImpl,
                             const ui::OSExchangeData& data,
                             int operation) OVERRIDE;
   virtual void SchedulePaintInRect(const gfx::Rect& rect) OVERRIDE;
+  virtual bool ScrollRect(const gfx::Rect& rect,
+                          const gfx::Point& amount) OVERRIDE;
   virtual void SetCursor(gfx::NativeCursor cursor) OVERRIDE;
   virtual void ClearNativeFocus() OVERRIDE;
   virtual void FocusNativeView(gfx::NativeView native_view) OVERRIDE;
@@ -459,6 +471,11 @@ class VIEWS_EXPORT NativeWidgetWin : public ui::WindowImpl,
   // messages too.
   void TrackMouseEvents(DWORD mouse_tracking_flags);
 
+  // Removes the WM_MOUSEMOVEs queued right after the one being handled that
+  // hold the same buttons and keys, replacing |l_param| with the position of
+  // the last one.
+  void CoalesceMouseMoves(WPARAM w_param, LPARAM* l_param);
+
   // Called when a MSAA screen reader client is detected.
   virtual void OnScreenReaderDetected();
 
@@ -473,7 +490,7 @@ class VIEWS_EXPORT NativeWidgetWin : public ui::WindowImpl,
 
   scoped_refptr<DropTargetWin> drop_target_;
 
-  const gfx::Rect& invalid_rect() const { return invalid_rect_; }
+  gfx::Rect invalid_rect() const { return invalid_region_.GetBounds(); }
 
   // Saved window information from before entering fullscreen mode.
   // TODO(beng): move to private once GetRestoredBounds() moves onto Widget.
@@ -496,6 +513,11 @@ class VIEWS_EXPORT NativeWidgetWin : public ui::WindowImpl,
   // layered windows only.
   void RedrawLayeredWindowContents();
 
+  // Handles WM_PAINT once the window has a back buffer: paints the update
+  // region into it, but where ScrollRect() moved up to date pixels, then
+  // copies it to the screen.
+  void PaintBackBuffer();
+
   // Lock or unlock the window from being able to redraw itself in response to
   // updates to its invalid region.
   class ScopedRedrawLock;
@@ -563,18 +585,28 @@ class VIEWS_EXPORT NativeWidgetWin : public ui::WindowImpl,
   // window.
   scoped_ptr<gfx::CanvasSkia> layered_window_contents_;
 
-  // We must track the invalid rect ourselves, for two reasons:
+  // We must track the invalid region ourselves, for two reasons:
   // For layered windows, Windows will not do this properly with
   // InvalidateRect()/GetUpdateRect(). (In fact, it'll return misleading
   // information from GetUpdateRect()).
   // We also need to keep track of the invalid rectangle for the RootView should
   // we need to paint the non-client area. The data supplied to WM_NCPAINT seems
   // to be insufficient.
-  gfx::Rect invalid_rect_;
+  gfx::DamageRegion invalid_region_;
 
   // A factory that allows us to schedule a redraw for layered windows.
   ScopedRunnableMethodFactory<NativeWidgetWin> paint_layered_window_factory_;
 
+  // The contents of the client area, kept from one paint to the next once
+  // ScrollRect() was first called, so that scrolling moves the pixels in it
+  // rather than painting them again. NULL until then, and for layered and
+  // composited windows.
+  scoped_ptr<gfx::CanvasSkia> back_buffer_;
+
+  // The part of the update region where ScrollRect() moved pixels that are up
+  // to date in |back_buffer_|, which the next paint only copies to the screen.
+  base::win::ScopedRegion scrolled_region_;
+
   // See class documentation for Widget in widget.h for a note about ownership.
   Widget::InitParams::Ownership ownership_;
 
@@ -647,6 +679,12 @@ class VIEWS_EXPORT NativeWidgetWin : public ui::WindowImpl,
   // area. We need this so we can correctly show the context menu on mouse-up.
   bool is_right_mouse_pressed_on_caption_;
 
+  // The screen position and message time of the WM_MOUSEMOVE being handled,
+  // and the time of the one before it, for GetCoalescedMousePoints().
+  POINT mouse_move_screen_point_;
+  DWORD mouse_move_time_;
+  DWORD previous_mouse_move_time_;
+
   // Whether all ancestors have been enabled. This is only used if is_modal_ is
   // true.
   bool restored_enabled_;
@@ -7,6 +7,7 @@
 #include <algorithm>
 
 #include "base/logging.h"
+#include "base/memory/scoped_vector.h"
 #include "base/message_loop.h"
 #include "ui/base/accessibility/accessible_view_state.h"
 #include "ui/base/dragdrop/drag_drop_types.h"
@@ -15,6 +16,7 @@
 #include "views/focus/view_storage.h"
 #include "views/layout/fill_layout.h"
 #include "views/touchui/gesture_manager.h"
+#include "views/view_profiler.h"
 #include "views/widget/widget.h"
 
 namespace views {
@@ -34,6 +36,7 @@ RootView::RootView(Widget* widget)
       mouse_move_handler_(NULL),
       last_click_handler_(NULL),
       explicit_mouse_handler_(false),
+      mouse_capture_view_(NULL),
       last_mouse_event_flags_(0),
       last_mouse_event_x_(-1),
       last_mouse_event_y_(-1),
@@ -49,6 +52,9 @@ RootView::~RootView() {
   // notification is sent for each one of them.
   if (has_children())
     RemoveAllChildViews(true);
+
+  if (ViewProfiler::IsEnabled())
+    ViewProfiler::LogClassStats();
 }
 
 // Tree operations -------------------------------------------------------------
@@ -59,9 +65,14 @@ void RootView::SetContentsView(View* contents_view) {
   // The ContentsView must be set up _after_ the window is created so that its
   // Widget pointer is valid.
   SetLayoutManager(new FillLayout);
-  if (has_children())
-    RemoveAllChildViews(true);
-  AddChildView(contents_view);
+  // Only the contents view is replaced, the windowless popups over it stay.
+  View* old_contents_view = GetContentsView();
+  if (old_contents_view) {
+    RemoveChildView(old_contents_view);
+    if (old_contents_view->parent_owned())
+      delete old_contents_view;
+  }
+  AddChildViewAt(contents_view, 0);
 
   // Force a layout now, since the attached hierarchy won't be ready for the
   // containing window's bounds. Note that we call Layout directly rather than
@@ -166,6 +177,11 @@ bool RootView::OnMousePressed(const MouseEvent& event) {
   UpdateCursor(e);
   SetMouseLocationAndFlags(e);
 
+  // The view with the capture handles the pressed -> drag -> released
+  // session, wherever the press is.
+  if (mouse_capture_view_ && !mouse_pressed_handler_)
+    SetMouseHandler(mouse_capture_view_);
+
   // If mouse_pressed_handler_ is non null, we are currently processing
   // a pressed -> drag -> released session. In that case we send the
   // event to mouse_pressed_handler_
@@ -280,7 +296,8 @@ void RootView::OnMouseCaptureLost() {
 
 void RootView::OnMouseMoved(const MouseEvent& event) {
   MouseEvent e(event, this);
-  View* v = GetEventHandlerForPoint(e.location());
+  View* v = mouse_capture_view_ ? mouse_capture_view_ :
+      GetEventHandlerForPoint(e.location());
   // Find the first enabled view, or the existing move handler, whichever comes
   // first.  The check for the existing handler is because if a view becomes
   // disabled while handling moves, it's wrong to suddenly send ET_MOUSE_EXITED
@@ -322,67 +339,13 @@ bool RootView::OnMouseWheel(const MouseWheelEvent& event) {
 }
 
 ui::TouchStatus RootView::OnTouchEvent(const TouchEvent& event) {
-  TouchEvent e(event, this);
-
-  // If touch_pressed_handler_ is non null, we are currently processing
-  // a touch down on the screen situation. In that case we send the
-  // event to touch_pressed_handler_
-  ui::TouchStatus status = ui::TOUCH_STATUS_UNKNOWN;
-
-  if (touch_pressed_handler_) {
-    TouchEvent touch_event(e, this, touch_pressed_handler_);
-    status = touch_pressed_handler_->ProcessTouchEvent(touch_event);
-    if (gesture_manager_->ProcessTouchEventForGesture(e, this, status))
-      status = ui::TOUCH_STATUS_SYNTH_MOUSE;
-    if (status == ui::TOUCH_STATUS_END)
-      touch_pressed_handler_ = NULL;
-    return status;
-  }
-
-  // Walk up the tree until we find a view that wants the touch event.
-  for (touch_pressed_handler_ = GetEventHandlerForPoint(e.location());
-       touch_pressed_handler_ && (touch_pressed_handler_ != this);
-       touch_pressed_handler_ = touch_pressed_handler_->parent()) {
-    if (!touch_pressed_handler_->IsEnabled()) {
-      // Disabled views eat events but are treated as not handled by the
-      // the GestureManager.
-      status = ui::TOUCH_STATUS_UNKNOWN;
-      break;
-    }
-
-    // See if this view wants to handle the touch
-    TouchEvent touch_event(e, this, touch_pressed_handler_);
-    status = touch_pressed_handler_->ProcessTouchEvent(touch_event);
-
-    // The view could have removed itself from the tree when handling
-    // OnTouchEvent(). So handle as per OnMousePressed. NB: we
-    // assume that the RootView itself cannot be so removed.
-    if (!touch_pressed_handler_)
-      break;
-
-    // The touch event wasn't processed. Go up the view hierarchy and dispatch
-    // the touch event.
-    if (status == ui::TOUCH_STATUS_UNKNOWN)
-      continue;
-
-    // If the touch didn't initiate a touch-sequence, then reset the touch event
-    // handler. Otherwise, leave it set so that subsequent touch events are
-    // dispatched to the same handler.
-    if (status != ui::TOUCH_STATUS_START)
-      touch_pressed_handler_ = NULL;
-
-    if (gesture_manager_->ProcessTouchEventForGesture(e, this, status))
-      status = ui::TOUCH_STATUS_SYNTH_MOUSE;
-    return status;
-  }
-
-  // Reset touch_pressed_handler_ to indicate that no processing is occurring.
-  touch_pressed_handler_ = NULL;
+  TouchFrame frame(1, &event);
+  return OnTouchFrame(frame);
+}
 
-  // Give the touch event to the gesture manager.
-  if (gesture_manager_->ProcessTouchEventForGesture(e, this, status))
-    status = ui::TOUCH_STATUS_SYNTH_MOUSE;
-  return status;
+void RootView::SetMouseCaptureView(View* view) {
+  DCHECK(!view || Contains(view));
+  mouse_capture_view_ = view;
 }
 
 void RootView::SetMouseHandler(View *new_mh) {
@@ -395,6 +358,29 @@ void RootView::GetAccessibleState(ui::AccessibleViewState* state) {
   state->role = ui::AccessibilityTypes::ROLE_APPLICATION;
 }
 
+ui::TouchStatus RootView::OnTouchFrame(const TouchFrame& frame) {
+  ui::TouchStatus status = ui::TOUCH_STATUS_UNKNOWN;
+  // The events in the coordinates of this view, and those no view handled.
+  ScopedVector<TouchEvent> events;
+  TouchFrame unhandled;
+  bool nothing_hit = false;
+  for (size_t i = 0; i < frame.size(); ++i) {
+    TouchEvent* e = new TouchEvent(*frame[i], this);
+    events.push_back(e);
+    status = DispatchTouchEvent(*e, &nothing_hit);
+    if (status == ui::TOUCH_STATUS_UNKNOWN)
+      unhandled.push_back(e);
+  }
+
+  // Give the touch events no view wanted to the gesture manager.
+  if (!unhandled.empty() &&
+      gesture_manager_->ProcessTouchFrameForGesture(unhandled, this) &&
+      status == ui::TOUCH_STATUS_UNKNOWN) {
+    status = ui::TOUCH_STATUS_SYNTH_MOUSE;
+  }
+  return status;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // RootView, protected:
 
@@ -408,6 +394,11 @@ void RootView::ViewHierarchyChanged(bool is_add, View* parent, View* child) {
       mouse_move_handler_ = NULL;
     if (touch_pressed_handler_ == child)
       touch_pressed_handler_ = NULL;
+    if (mouse_capture_view_ && child->Contains(mouse_capture_view_)) {
+      if (mouse_pressed_handler_ == mouse_capture_view_)
+        SetMouseHandler(NULL);
+      mouse_capture_view_ = NULL;
+    }
   }
 }
 
@@ -417,6 +408,12 @@ void RootView::OnPaint(gfx::Canvas* canvas) {
 #endif
 }
 
+void RootView::PaintChildren(gfx::Canvas* canvas) {
+  View::PaintChildren(canvas);
+  if (ViewProfiler::IsHeatMapEnabled())
+    ViewProfiler::PaintHeatMap(this, canvas);
+}
+
 const ui::Compositor* RootView::GetCompositor() const {
   return widget_->GetCompositor();
 }
@@ -435,6 +432,65 @@ void RootView::CalculateOffsetToAncestorWithLayer(gfx::Point* offset,
 ////////////////////////////////////////////////////////////////////////////////
 // RootView, private:
 
+ui::TouchStatus RootView::DispatchTouchEvent(const TouchEvent& e,
+                                             bool* nothing_hit) {
+  // If touch_pressed_handler_ is non null, we are currently processing
+  // a touch down on the screen situation. In that case we send the
+  // event to touch_pressed_handler_
+  ui::TouchStatus status = ui::TOUCH_STATUS_UNKNOWN;
+
+  if (touch_pressed_handler_) {
+    TouchEvent touch_event(e, this, touch_pressed_handler_);
+    status = touch_pressed_handler_->ProcessTouchEvent(touch_event);
+    if (status == ui::TOUCH_STATUS_END)
+      touch_pressed_handler_ = NULL;
+    return status;
+  }
+
+  if (*nothing_hit)
+    return status;
+
+  // Walk up the tree until we find a view that wants the touch event.
+  for (touch_pressed_handler_ = GetEventHandlerForPoint(e.location());
+       touch_pressed_handler_ && (touch_pressed_handler_ != this);
+       touch_pressed_handler_ = touch_pressed_handler_->parent()) {
+    if (!touch_pressed_handler_->IsEnabled()) {
+      // Disabled views eat events but are treated as not handled by the
+      // the GestureManager.
+      status = ui::TOUCH_STATUS_UNKNOWN;
+      break;
+    }
+
+    // See if this view wants to handle the touch
+    TouchEvent touch_event(e, this, touch_pressed_handler_);
+    status = touch_pressed_handler_->ProcessTouchEvent(touch_event);
+
+    // The view could have removed itself from the tree when handling
+    // OnTouchEvent(). So handle as per OnMousePressed. NB: we
+    // assume that the RootView itself cannot be so removed.
+    if (!touch_pressed_handler_)
+      break;
+
+    // The touch event wasn't processed. Go up the view hierarchy and dispatch
+    // the touch event.
+    if (status == ui::TOUCH_STATUS_UNKNOWN)
+      continue;
+
+    // If the touch didn't initiate a touch-sequence, then reset the touch event
+    // handler. Otherwise, leave it set so that subsequent touch events are
+    // dispatched to the same handler.
+    if (status != ui::TOUCH_STATUS_START)
+      touch_pressed_handler_ = NULL;
+    return status;
+  }
+
+  // Reset touch_pressed_handler_ to indicate that no processing is occurring.
+  touch_pressed_handler_ = NULL;
+  if (status == ui::TOUCH_STATUS_UNKNOWN)
+    *nothing_hit = true;
+  return status;
+}
+
 // Input -----------------------------------------------------------------------
 
 void RootView::UpdateCursor(const MouseEvent& event) {
@@ -53,8 +53,10 @@ class VIEWS_EXPORT RootView : public View, public FocusTraversable {
 
   // Tree operations -----------------------------------------------------------
 
-  // Sets the "contents view" of the RootView. This is the single child view
-  // that is responsible for laying out the contents of the widget.
+  // Sets the "contents view" of the RootView. This is the first child view,
+  // responsible for laying out the contents of the widget. The others are the
+  // windowless popups drawn over it (see Widget::IsWindowlessPopups()), which
+  // are kept when the contents view is replaced.
   void SetContentsView(View* contents_view);
   View* GetContentsView();
 
@@ -69,6 +71,21 @@ class VIEWS_EXPORT RootView : public View, public FocusTraversable {
   // it. Returns whether anyone consumed the event.
   bool OnKeyEvent(const KeyEvent& event);
 
+  // Dispatches the touch events of a frame, in order. The view handling a
+  // touch sequence gets them without hit testing; otherwise the frame's first
+  // touch finds its view, and if there is none, the frame's other touches
+  // aren't hit tested either. The gesture manager is given the unhandled
+  // touches once per frame. Returns the status of the last event.
+  // OnTouchEvent() dispatches a frame of one event.
+  ui::TouchStatus OnTouchFrame(const TouchFrame& frame);
+
+  // Sends all the mouse events to |view|, a descendant, the way a window with
+  // the mouse capture gets them, until it is set to NULL or |view| is removed.
+  // Used by the windowless popups, which get the events of their top-level
+  // widget's RootView.
+  void SetMouseCaptureView(View* view);
+  View* mouse_capture_view() const { return mouse_capture_view_; }
+
   // Provided only for testing:
   void SetGestureManagerForTesting(GestureManager* g) { gesture_manager_ = g; }
 
@@ -118,6 +135,7 @@ class VIEWS_EXPORT RootView : public View, public FocusTraversable {
   virtual void ViewHierarchyChanged(bool is_add, View* parent,
                                     View* child) OVERRIDE;
   virtual void OnPaint(gfx::Canvas* canvas) OVERRIDE;
+  virtual void PaintChildren(gfx::Canvas* canvas) OVERRIDE;
   virtual const ui::Compositor* GetCompositor() const OVERRIDE;
   virtual ui::Compositor* GetCompositor() OVERRIDE;
   virtual void CalculateOffsetToAncestorWithLayer(
@@ -134,6 +152,12 @@ class VIEWS_EXPORT RootView : public View, public FocusTraversable {
 
   // Input ---------------------------------------------------------------------
 
+  // Dispatches one event of a touch frame to the view handling the touch
+  // sequence, or to the view under it. |*nothing_hit| is set once the hit
+  // test of the frame found no view, and skips it for the rest of the frame.
+  ui::TouchStatus DispatchTouchEvent(const TouchEvent& event,
+                                     bool* nothing_hit);
+
   // Update the cursor given a mouse event. This is called by non mouse_move
   // event handlers to honor the cursor desired by views located under the
   // cursor during drag operations. The location of the mouse should be in the
@@ -168,6 +192,9 @@ class VIEWS_EXPORT RootView : public View, public FocusTraversable {
   // true if mouse_pressed_handler_ has been explicitly set
   bool explicit_mouse_handler_;
 
+  // The view getting all the mouse events, see SetMouseCaptureView().
+  View* mouse_capture_view_;
+
   // Last position/flag of a mouse press/drag. Used if capture stops and we need
   // to synthesize a release.
   int last_mouse_event_flags_;
@@ -27,6 +27,10 @@ static int tooltip_height_ = 0;
 // Timeout is mentioned in milliseconds.
 static const int kDefaultTimeout = 4000;
 
+// The trimmed tooltips kept, beyond which they are all dropped. Far more than
+// the views of a toolbar.
+static const size_t kMaxTrimmedTooltips = 64;
+
 // static
 int TooltipManager::GetTooltipHeight() {
   DCHECK_GT(tooltip_height_, 0);
@@ -71,6 +75,7 @@ TooltipManagerWin::TooltipManagerWin(Widget* widget)
       last_tooltip_view_(NULL),
       last_view_out_of_sync_(false),
       tooltip_width_(0),
+      tooltip_border_valid_(false),
       keyboard_tooltip_hwnd_(NULL),
       ALLOW_THIS_IN_INITIALIZER_LIST(keyboard_tooltip_factory_(this)) {
   DCHECK(widget);
@@ -171,8 +176,8 @@ LRESULT TooltipManagerWin::OnNotify(int w_param,
             clipped_text_ = tooltip_text_;
             gfx::Point screen_loc = last_mouse_pos_;
             View::ConvertPointToScreen(widget_->GetRootView(), &screen_loc);
-            TrimTooltipToFit(&clipped_text_, &tooltip_width_, &line_count_,
-                             screen_loc.x(), screen_loc.y());
+            TrimTooltip(&clipped_text_, &tooltip_width_, &line_count_,
+                        screen_loc.x(), screen_loc.y());
             // Adjust the clipped tooltip text for locale direction.
             base::i18n::AdjustStringForLocaleDirection(&clipped_text_);
             tooltip_info->lpszText = const_cast<WCHAR*>(clipped_text_.c_str());
@@ -223,7 +228,18 @@ bool TooltipManagerWin::SetTooltipPosition(int text_x, int text_y) {
                   view_loc.y() + text_y,
                   view_loc.x() + text_x + tooltip_width_,
                   view_loc.y() + line_count_ * GetTooltipHeight() };
-  SendMessage(tooltip_hwnd_, TTM_ADJUSTRECT, TRUE, (LPARAM)&bounds);
+  // The border only depends on the style and font of the window, which don't
+  // change.
+  if (!tooltip_border_valid_) {
+    SetRectEmpty(&tooltip_border_);
+    SendMessage(tooltip_hwnd_, TTM_ADJUSTRECT, TRUE,
+                reinterpret_cast<LPARAM>(&tooltip_border_));
+    tooltip_border_valid_ = true;
+  }
+  bounds.left += tooltip_border_.left;
+  bounds.top += tooltip_border_.top;
+  bounds.right += tooltip_border_.right;
+  bounds.bottom += tooltip_border_.bottom;
 
   // Make sure the rectangle completely fits on the current monitor. If it
   // doesn't, return false so that windows positions the tooltip at the
@@ -340,8 +356,8 @@ void TooltipManagerWin::ShowKeyboardTooltip(View* focused_view) {
               std::numeric_limits<int16>::max());
   int tooltip_width;
   int line_count;
-  TrimTooltipToFit(&tooltip_text, &tooltip_width, &line_count,
-                   screen_point.x(), screen_point.y());
+  TrimTooltip(&tooltip_text, &tooltip_width, &line_count,
+              screen_point.x(), screen_point.y());
   ReplaceSubstringsAfterOffset(&tooltip_text, 0, L"\n", L"\r\n");
   TOOLINFO keyboard_toolinfo;
   memset(&keyboard_toolinfo, 0, sizeof(keyboard_toolinfo));
@@ -385,4 +401,25 @@ void TooltipManagerWin::DestroyKeyboardTooltipWindow(HWND window_to_destroy) {
     HideKeyboardTooltip();
 }
 
+void TooltipManagerWin::TrimTooltip(string16* text,
+                                    int* max_width,
+                                    int* line_count,
+                                    int x,
+                                    int y) {
+  std::pair<string16, int> key(*text, GetMaxWidth(x, y));
+  TrimmedTooltips::const_iterator i = trimmed_tooltips_.find(key);
+  if (i == trimmed_tooltips_.end()) {
+    TrimmedTooltip trimmed;
+    trimmed.text = *text;
+    TrimTooltipToFit(&trimmed.text, &trimmed.width, &trimmed.line_count,
+                     x, y);
+    if (trimmed_tooltips_.size() >= kMaxTrimmedTooltips)
+      trimmed_tooltips_.clear();
+    i = trimmed_tooltips_.insert(std::make_pair(key, trimmed)).first;
+  }
+  *text = i->second.text;
+  *max_width = i->second.width;
+  *line_count = i->second.line_count;
+}
+
 }  // namespace views
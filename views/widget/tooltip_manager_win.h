@@ -8,7 +8,9 @@
 
 #include <windows.h>
 #include <commctrl.h>
+#include <map>
 #include <string>
+#include <utility>
 
 #include "base/basictypes.h"
 #include "base/string16.h"
@@ -114,6 +116,12 @@ class TooltipManagerWin : public TooltipManager {
   // Invoked when the timer elapses and tooltip has to be destroyed.
   void DestroyKeyboardTooltipWindow(HWND window_to_destroy);
 
+  // TrimTooltipToFit() through |trimmed_tooltips_|, so that moving the mouse
+  // back and forth over views doesn't elide and measure their tooltips each
+  // time they are shown.
+  void TrimTooltip(string16* text, int* max_width, int* line_count,
+                   int x, int y);
+
   // Hosting Widget.
   Widget* widget_;
 
@@ -138,6 +146,21 @@ class TooltipManagerWin : public TooltipManager {
   // Width of the last tooltip.
   int tooltip_width_;
 
+  // What TrimTooltipToFit() made of a tooltip text, for the width available
+  // to it. All the tooltips have the same font, so it isn't part of the key.
+  struct TrimmedTooltip {
+    string16 text;
+    int width;
+    int line_count;
+  };
+  typedef std::map<std::pair<string16, int>, TrimmedTooltip> TrimmedTooltips;
+  TrimmedTooltips trimmed_tooltips_;
+
+  // The border TTM_ADJUSTRECT adds around the text of the tooltip window, as
+  // offsets to the sides, asked of the window the first time it shows.
+  RECT tooltip_border_;
+  bool tooltip_border_valid_;
+
   // control window for tooltip displayed using keyboard.
   HWND keyboard_tooltip_hwnd_;
 
@@ -4,11 +4,15 @@
 
 #include "views/widget/widget.h"
 
+#include "base/command_line.h"
 #include "base/logging.h"
 #include "base/message_loop.h"
+#include "base/metrics/startup_timeline.h"
 #include "base/utf_string_conversions.h"
+#include "ui/base/animation/animation_container.h"
 #include "ui/base/l10n/l10n_font_util.h"
 #include "ui/base/resource/resource_bundle.h"
+#include "ui/base/ui_base_switches.h"
 #include "ui/gfx/compositor/compositor.h"
 #include "ui/gfx/compositor/layer.h"
 #include "views/controls/menu/menu_controller.h"
@@ -20,6 +24,7 @@
 #include "views/views_delegate.h"
 #include "views/widget/default_theme_provider.h"
 #include "views/widget/native_widget_private.h"
+#include "views/widget/native_widget_views.h"
 #include "views/widget/root_view.h"
 #include "views/widget/tooltip_manager.h"
 #include "views/widget/widget_delegate.h"
@@ -30,6 +35,9 @@ namespace {
 // Set to true if a pure Views implementation is preferred
 bool use_pure_views = false;
 
+// Set to true to draw the popups into their top-level widget when they can.
+bool use_windowless_popups = false;
+
 // True to enable debug paint that indicates where to be painted.
 bool debug_paint = false;
 
@@ -163,9 +171,12 @@ Widget::Widget()
       minimum_size_(100, 100),
       focus_on_creation_(true),
       is_top_level_(false),
+      is_windowless_popup_(false),
       native_widget_initialized_(false),
       is_mouse_button_pressed_(false),
-      last_mouse_event_was_move_(false) {
+      last_mouse_event_was_move_(false),
+      minimized_(false),
+      ALLOW_THIS_IN_INITIALIZER_LIST(layout_factory_(this)) {
 }
 
 Widget::~Widget() {
@@ -225,6 +236,17 @@ bool Widget::IsPureViews() {
 #endif
 }
 
+// static
+void Widget::SetWindowlessPopups(bool windowless) {
+  use_windowless_popups = windowless;
+}
+
+// static
+bool Widget::IsWindowlessPopups() {
+  return use_windowless_popups ||
+      CommandLine::ForCurrentProcess()->HasSwitch(switches::kWindowlessPopups);
+}
+
 // static
 Widget* Widget::GetWidgetForNativeView(gfx::NativeView native_view) {
   internal::NativeWidgetPrivate* native_widget =
@@ -302,9 +324,16 @@ void Widget::Init(const InitParams& params) {
   widget_delegate_ = params.delegate ?
       params.delegate : new DefaultWidgetDelegate(this, params);
   ownership_ = params.ownership;
-  native_widget_ = params.native_widget ?
-      params.native_widget->AsNativeWidgetPrivate() :
-      internal::NativeWidgetPrivate::CreateNativeWidget(this);
+  if (params.native_widget) {
+    native_widget_ = params.native_widget->AsNativeWidgetPrivate();
+  } else if (NativeWidgetViews::GetWindowlessPopupHost(params)) {
+    NativeWidgetViews* native_widget = new NativeWidgetViews(this);
+    native_widget->set_windowless_popup(true);
+    native_widget_ = native_widget;
+    is_windowless_popup_ = true;
+  } else {
+    native_widget_ = internal::NativeWidgetPrivate::CreateNativeWidget(this);
+  }
   GetRootView();
   default_theme_provider_.reset(new DefaultThemeProvider);
   if (params.type == InitParams::TYPE_MENU) {
@@ -327,6 +356,7 @@ void Widget::Init(const InitParams& params) {
     UpdateWindowTitle();
   }
   native_widget_initialized_ = true;
+  base::StartupTimeline::RecordMilestone("FirstWidgetInit");
 }
 
 // Unconverted methods (see header) --------------------------------------------
@@ -597,6 +627,18 @@ bool Widget::IsAccessibleWidget() const {
   return native_widget_->IsAccessibleWidget();
 }
 
+ui::AnimationContainer* Widget::GetAnimationContainer() {
+  Widget* top_level_widget = GetTopLevelWidget();
+  if (top_level_widget && top_level_widget != this)
+    return top_level_widget->GetAnimationContainer();
+
+  if (!animation_container_.get()) {
+    animation_container_ = new ui::AnimationContainer;
+    animation_container_->SetSuspended(!IsVisible() || minimized_);
+  }
+  return animation_container_.get();
+}
+
 ThemeProvider* Widget::GetThemeProvider() const {
   const Widget* root_widget = GetTopLevelWidget();
   if (root_widget && root_widget != this) {
@@ -650,6 +692,17 @@ void Widget::SchedulePaintInRect(const gfx::Rect& rect) {
   native_widget_->SchedulePaintInRect(rect);
 }
 
+bool Widget::ScrollRect(const gfx::Rect& rect, const gfx::Point& amount) {
+  return native_widget_->ScrollRect(rect, amount);
+}
+
+void Widget::ScheduleLayout() {
+  if (!layout_factory_.empty())
+    return;
+  MessageLoop::current()->PostTask(FROM_HERE,
+      layout_factory_.NewRunnableMethod(&Widget::RunPendingLayout));
+}
+
 void Widget::SetCursor(gfx::NativeCursor cursor) {
   native_widget_->SetCursor(cursor);
 }
@@ -770,6 +823,9 @@ void Widget::NotifyAccessibilityEvent(
     View* view,
     ui::AccessibilityTypes::Event event_type,
     bool send_native_event) {
+  // What changed is queried again.
+  view->InvalidateAccessibleState();
+
   // Send the notification to the delegate.
   if (ViewsDelegate::views_delegate)
     ViewsDelegate::views_delegate->NotifyAccessibilityEvent(view, event_type);
@@ -868,11 +924,19 @@ void Widget::OnNativeBlur(gfx::NativeView focused_view) {
 }
 
 void Widget::OnNativeWidgetVisibilityChanged(bool visible) {
+  if (animation_container_.get())
+    animation_container_->SetSuspended(!visible || minimized_);
   GetRootView()->PropagateVisibilityNotifications(GetRootView(), visible);
   FOR_EACH_OBSERVER(Observer, observers_,
                     OnWidgetVisibilityChanged(this, visible));
 }
 
+void Widget::OnNativeWidgetMinimizedChanged(bool minimized) {
+  minimized_ = minimized;
+  if (animation_container_.get())
+    animation_container_->SetSuspended(!IsVisible() || minimized_);
+}
+
 void Widget::OnNativeWidgetCreated() {
   if (is_top_level())
     focus_manager_.reset(FocusManagerFactory::Create(this));
@@ -903,7 +967,10 @@ gfx::Size Widget::GetMinimumSize() {
 }
 
 void Widget::OnNativeWidgetSizeChanged(const gfx::Size& new_size) {
-  root_view_->SetSize(new_size);
+  {
+    View::ScopedLayoutPass layout_pass;
+    root_view_->SetSize(new_size);
+  }
 
   // Size changed notifications can fire prior to full initialization
   // i.e. during session restore.  Avoid saving session state during these
@@ -925,6 +992,8 @@ bool Widget::HasFocusManager() const {
 }
 
 bool Widget::OnNativeWidgetPaintAccelerated(const gfx::Rect& dirty_region) {
+  RunPendingLayout();
+
   ui::Compositor* compositor = GetCompositor();
   if (!compositor)
     return false;
@@ -954,12 +1023,21 @@ bool Widget::OnNativeWidgetPaintAccelerated(const gfx::Rect& dirty_region) {
     }
   }
 
+  // The compositor only redraws what its layers damaged. The paints it
+  // schedules invalidate all of the client area, so |dirty_region| is only
+  // damage of its own when the system asks for a paint, having lost pixels.
+  if (!compositor->paint_scheduled())
+    compositor->AddDamage(dirty_region);
+
   compositor->set_root_layer(GetRootView()->layer());
   compositor->Draw(force_clear);
   return true;
 }
 
 void Widget::OnNativeWidgetPaint(gfx::Canvas* canvas) {
+  // Views moved by the layout schedule the painting of their new bounds,
+  // which may be outside of |canvas|, for the next paint.
+  RunPendingLayout();
   GetRootView()->Paint(canvas);
 }
 
@@ -1032,6 +1110,13 @@ ui::TouchStatus Widget::OnTouchEvent(const TouchEvent& event) {
   return static_cast<internal::RootView*>(GetRootView())->OnTouchEvent(event);
 }
 
+ui::TouchStatus Widget::OnTouchFrame(const TouchFrame& frame) {
+  if (frame.empty())
+    return ui::TOUCH_STATUS_UNKNOWN;
+  ScopedEvent scoped(this, *frame.back());
+  return static_cast<internal::RootView*>(GetRootView())->OnTouchFrame(frame);
+}
+
 bool Widget::ExecuteCommand(int command_id) {
   return widget_delegate_->ExecuteWindowsCommand(command_id);
 }
@@ -1178,6 +1263,17 @@ void Widget::ReplaceInputMethod(InputMethod* input_method) {
   }
 }
 
+void Widget::RunPendingLayout() {
+  if (layout_factory_.empty())
+    return;
+  layout_factory_.RevokeAll();
+  if (!root_view_.get())
+    return;
+
+  View::ScopedLayoutPass layout_pass;
+  root_view_->Layout();
+}
+
 namespace internal {
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -9,8 +9,10 @@
 #include <stack>
 
 #include "base/gtest_prod_util.h"
+#include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/observer_list.h"
+#include "base/task.h"
 #include "ui/base/accessibility/accessibility_types.h"
 #include "ui/base/ui_base_types.h"
 #include "ui/gfx/native_widget_types.h"
@@ -42,6 +44,7 @@ class Rect;
 
 namespace ui {
 class Accelerator;
+class AnimationContainer;
 class Compositor;
 class OSExchangeData;
 class ThemeProvider;
@@ -197,6 +200,14 @@ class VIEWS_EXPORT Widget : public internal::NativeWidgetDelegate,
   static void SetPureViews(bool pure);
   static bool IsPureViews();
 
+  // SetWindowlessPopups and IsWindowlessPopups update and return the state of
+  // a global setting, also turned on by --windowless-popups, that draws the
+  // menus and popups that don't activate into the RootView of their top-level
+  // widget, with a NativeWidgetViews, when they fit in its client area.
+  // Creating them then makes no window, and they paint with the window.
+  static void SetWindowlessPopups(bool windowless);
+  static bool IsWindowlessPopups();
+
   // Retrieves the Widget implementation associated with the given
   // NativeView or Window, or NULL if the supplied handle has no associated
   // Widget.
@@ -390,6 +401,11 @@ class VIEWS_EXPORT Widget : public internal::NativeWidgetDelegate,
   // Returns whether the Widget is customized for accessibility.
   bool IsAccessibleWidget() const;
 
+  // Returns the container for the animations of the views of the top level
+  // widget, which is suspended while the widget is hidden or minimized. See
+  // ui::AnimationContainer::SetSuspended() for the animations that may use it.
+  ui::AnimationContainer* GetAnimationContainer();
+
   // Returns the ThemeProvider that provides theme resources for this Widget.
   virtual ThemeProvider* GetThemeProvider() const;
 
@@ -417,6 +433,18 @@ class VIEWS_EXPORT Widget : public internal::NativeWidgetDelegate,
   // redrawn.
   void SchedulePaintInRect(const gfx::Rect& rect);
 
+  // Moves the pixels of |rect|, in client area coordinates, by |amount|, for
+  // example when its contents scroll, so that only the part of |rect| they
+  // uncover has to be painted again, which the caller schedules. Returns false
+  // if the pixels can't be moved, in which case the caller must schedule the
+  // painting of all of |rect|.
+  bool ScrollRect(const gfx::Rect& rect, const gfx::Point& amount);
+
+  // Lays out the RootView soon, top-down, and at the latest before the Widget
+  // is painted next. Only the views whose layout was invalidated are laid out
+  // again, however many times it was. Called by View::InvalidateLayout().
+  void ScheduleLayout();
+
   // Sets the currently visible cursor. If |cursor| is NULL, the cursor used
   // before the current is restored.
   void SetCursor(gfx::NativeCursor cursor);
@@ -570,6 +598,10 @@ class VIEWS_EXPORT Widget : public internal::NativeWidgetDelegate,
   // TYPE_CONTROL and TYPE_TOOLTIP is not considered top level.
   bool is_top_level() const { return is_top_level_; }
 
+  // True if the widget is drawn into the RootView of its top-level widget,
+  // rather than having a window. See IsWindowlessPopups().
+  bool is_windowless_popup() const { return is_windowless_popup_; }
+
   // Returns the bounds of work area in the screen that Widget belongs to.
   gfx::Rect GetWorkAreaBoundsInScreen() const;
 
@@ -583,6 +615,7 @@ class VIEWS_EXPORT Widget : public internal::NativeWidgetDelegate,
   virtual void OnNativeFocus(gfx::NativeView focused_view) OVERRIDE;
   virtual void OnNativeBlur(gfx::NativeView focused_view) OVERRIDE;
   virtual void OnNativeWidgetVisibilityChanged(bool visible) OVERRIDE;
+  virtual void OnNativeWidgetMinimizedChanged(bool minimized) OVERRIDE;
   virtual void OnNativeWidgetCreated() OVERRIDE;
   virtual void OnNativeWidgetDestroying() OVERRIDE;
   virtual void OnNativeWidgetDestroyed() OVERRIDE;
@@ -599,6 +632,7 @@ class VIEWS_EXPORT Widget : public internal::NativeWidgetDelegate,
   virtual bool OnMouseEvent(const MouseEvent& event) OVERRIDE;
   virtual void OnMouseCaptureLost() OVERRIDE;
   virtual ui::TouchStatus OnTouchEvent(const TouchEvent& event) OVERRIDE;
+  virtual ui::TouchStatus OnTouchFrame(const TouchFrame& frame) OVERRIDE;
   virtual bool ExecuteCommand(int command_id) OVERRIDE;
   virtual InputMethod* GetInputMethodDirect() OVERRIDE;
   virtual Widget* AsWidget() OVERRIDE;
@@ -648,6 +682,9 @@ class VIEWS_EXPORT Widget : public internal::NativeWidgetDelegate,
   // It's only for testing purpose.
   void ReplaceInputMethod(InputMethod* input_method);
 
+  // Runs the layout of ScheduleLayout(), if there is one pending.
+  void RunPendingLayout();
+
   internal::NativeWidgetPrivate* native_widget_;
 
   ObserverList<Observer> observers_;
@@ -721,6 +758,9 @@ class VIEWS_EXPORT Widget : public internal::NativeWidgetDelegate,
   // See |is_top_level()| accessor.
   bool is_top_level_;
 
+  // See |is_windowless_popup()| accessor.
+  bool is_windowless_popup_;
+
   // Factory used to create Compositors. Settable by tests.
   static ui::Compositor*(*compositor_factory_)();
 
@@ -738,6 +778,15 @@ class VIEWS_EXPORT Widget : public internal::NativeWidgetDelegate,
   bool last_mouse_event_was_move_;
   gfx::Point last_mouse_event_position_;
 
+  // See GetAnimationContainer(). Created when first asked for.
+  scoped_refptr<ui::AnimationContainer> animation_container_;
+
+  // True while the native widget is minimized.
+  bool minimized_;
+
+  // Holds the task of ScheduleLayout() while a layout is pending.
+  ScopedRunnableMethodFactory<Widget> layout_factory_;
+
   DISALLOW_COPY_AND_ASSIGN(Widget);
 };
 
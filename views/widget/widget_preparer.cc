@@ -0,0 +1,92 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "views/widget/widget_preparer.h"
+
+#include "base/bind.h"
+#include "base/logging.h"
+#include "base/message_loop_proxy.h"
+#include "base/threading/worker_pool.h"
+#include "ui/base/resource/resource_bundle.h"
+#include "views/view.h"
+
+namespace views {
+
+WidgetPreparer::WidgetPreparer(Delegate* delegate)
+    : delegate_(delegate) {
+  DCHECK(delegate_);
+}
+
+WidgetPreparer::~WidgetPreparer() {
+  // The last reference may go on the worker thread, but the contents only
+  // live while a step is pending on the UI thread, so they are deleted there.
+}
+
+void WidgetPreparer::AddImage(int resource_id) {
+  DCHECK(!message_loop_);
+  image_ids_.push_back(resource_id);
+}
+
+void WidgetPreparer::AddWorkerTask(const base::Closure& task) {
+  DCHECK(!message_loop_);
+  worker_tasks_.push_back(task);
+}
+
+void WidgetPreparer::Start() {
+  DCHECK(!message_loop_);
+  message_loop_ = base::MessageLoopProxy::current();
+  DCHECK(message_loop_);
+  if (!base::WorkerPool::PostTask(
+          FROM_HERE,
+          base::Bind(&WidgetPreparer::PrepareOnWorkerThread, this),
+          false)) {
+    // Without a worker thread, the work is done here.
+    PrepareOnWorkerThread();
+  }
+}
+
+void WidgetPreparer::Cancel() {
+  DCHECK(message_loop_->BelongsToCurrentThread());
+  delegate_ = NULL;
+  contents_.reset();
+}
+
+void WidgetPreparer::PrepareOnWorkerThread() {
+  for (size_t i = 0; i < worker_tasks_.size(); ++i)
+    worker_tasks_[i].Run();
+  worker_tasks_.clear();
+  if (!image_ids_.empty())
+    ui::ResourceBundle::PreDecodeImages(image_ids_);
+  PostStep(&WidgetPreparer::CreateContents);
+}
+
+void WidgetPreparer::CreateContents() {
+  if (!delegate_)
+    return;
+  contents_.reset(delegate_->CreateContents());
+  DCHECK(contents_.get());
+  PostStep(&WidgetPreparer::LayOutContents);
+}
+
+void WidgetPreparer::LayOutContents() {
+  if (!delegate_)
+    return;
+  // Resizing lays the contents out.
+  contents_->SetSize(contents_->GetPreferredSize());
+  PostStep(&WidgetPreparer::FinishPreparing);
+}
+
+void WidgetPreparer::FinishPreparing() {
+  if (!delegate_)
+    return;
+  Delegate* delegate = delegate_;
+  delegate_ = NULL;
+  delegate->OnContentsPrepared(contents_.release());
+}
+
+void WidgetPreparer::PostStep(void (WidgetPreparer::*step)()) {
+  message_loop_->PostTask(FROM_HERE, base::Bind(step, this));
+}
+
+}  // namespace views
@@ -0,0 +1,111 @@
+// Copyright (c) 2011 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef VIEWS_WIDGET_WIDGET_PREPARER_H_
+#define VIEWS_WIDGET_WIDGET_PREPARER_H_
+#pragma once
+
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "views/views_export.h"
+
+namespace base {
+class MessageLoopProxy;
+}
+
+namespace views {
+
+class View;
+
+// Prepares the contents of a widget that is slow to open, such as a heavy
+// dialog, without blocking input on the UI thread for all of it.
+//
+// Views, fonts and their text measurement caches are not thread-safe, so the
+// view hierarchy itself can't be built on another thread. What can runs first
+// on a WorkerPool thread: the tasks given to AddWorkerTask(), which read and
+// parse whatever the contents show, and the decoding of the ResourceBundle
+// images given to AddImage(). The rest runs on the UI thread as separate
+// tasks, between which the message loop handles input: the delegate builds
+// the contents, the preparer sizes them to their preferred size and lays them
+// out, and the delegate creates the widget with them. Sized so, the contents
+// aren't laid out again when the widget is, and the first paint finds their
+// images decoded.
+//
+//   scoped_refptr<views::WidgetPreparer> preparer(
+//       new views::WidgetPreparer(this));
+//   preparer->AddImage(IDR_MY_DIALOG_BANNER);
+//   preparer->AddWorkerTask(base::Bind(&MyData::Load, data));
+//   preparer->Start();
+class VIEWS_EXPORT WidgetPreparer
+    : public base::RefCountedThreadSafe<WidgetPreparer> {
+ public:
+  // Called on the UI thread.
+  class VIEWS_EXPORT Delegate {
+   public:
+    // Builds the contents, once the worker thread is done. They are not in a
+    // widget yet.
+    virtual View* CreateContents() = 0;
+
+    // Takes the |contents|, now sized and laid out, and typically creates the
+    // widget whose contents view they are.
+    virtual void OnContentsPrepared(View* contents) = 0;
+
+   protected:
+    virtual ~Delegate() {}
+  };
+
+  // |delegate| is not owned, and must outlive the preparing, or Cancel() it.
+  explicit WidgetPreparer(Delegate* delegate);
+
+  // Decodes the image |resource_id| on the worker thread.
+  void AddImage(int resource_id);
+
+  // Runs |task| on the worker thread, before the images are decoded. It must
+  // not touch any views, nor the delegate.
+  void AddWorkerTask(const base::Closure& task);
+
+  // Starts preparing, on the UI thread.
+  void Start();
+
+  // Stops preparing, on the UI thread: the delegate is not called again, and
+  // the contents, if they were built, are deleted.
+  void Cancel();
+
+ private:
+  friend class base::RefCountedThreadSafe<WidgetPreparer>;
+
+  ~WidgetPreparer();
+
+  // The steps, in order.
+  void PrepareOnWorkerThread();
+  void CreateContents();
+  void LayOutContents();
+  void FinishPreparing();
+
+  // Runs |step| in a task of its own on the UI thread.
+  void PostStep(void (WidgetPreparer::*step)());
+
+  // Not owned. NULL once cancelled.
+  Delegate* delegate_;
+
+  // The work of the worker thread.
+  std::vector<int> image_ids_;
+  std::vector<base::Closure> worker_tasks_;
+
+  // The loop of the UI thread.
+  scoped_refptr<base::MessageLoopProxy> message_loop_;
+
+  // The contents, between CreateContents() and FinishPreparing().
+  scoped_ptr<View> contents_;
+
+  DISALLOW_COPY_AND_ASSIGN(WidgetPreparer);
+};
+
+}  // namespace views
+
+#endif  // VIEWS_WIDGET_WIDGET_PREPARER_H_